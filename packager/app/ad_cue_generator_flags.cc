@@ -17,3 +17,9 @@ DEFINE_string(ad_cues,
               "{start_time}[,{duration}][;{start_time}[,{duration}]]..."
               "The start_time represents the start of the cue marker in "
               "seconds relative to the start of the program.");
+DEFINE_double(cue_alignment_horizon,
+              0,
+              "How far, in seconds, past a cuepoint the audio and text "
+              "streams may buffer samples while waiting for the cuepoint to be "
+              "aligned with the other streams, instead of blocking as soon as "
+              "they reach it. Zero blocks right away.");
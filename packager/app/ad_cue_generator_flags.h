@@ -10,5 +10,6 @@
 #include <gflags/gflags.h>
 
 DECLARE_string(ad_cues);
+DECLARE_double(cue_alignment_horizon);
 
 #endif  // PACKAGER_APP_AD_CUE_GENERATOR_FLAGS_H_
@@ -8,6 +8,8 @@
 
 #include <stdio.h>
 
+#include "packager/app/gflags_hex_bytes.h"
+
 DEFINE_string(protection_scheme,
               "cenc",
               "Specify a protection scheme, 'cenc' or 'cbc1' or pattern-based "
@@ -27,9 +29,27 @@ DEFINE_int32(
     "Apply to video streams with 'cbcs' and 'cens' protection schemes only; "
     "ignored otherwise.");
 DEFINE_bool(vp9_subsample_encryption, true, "Enable VP9 subsample encryption.");
+DEFINE_int32(num_encryption_threads,
+             1,
+             "Number of threads used to encrypt the samples of each stream. "
+             "Samples are encrypted in parallel and re-sequenced if greater "
+             "than 1.");
 DEFINE_string(playready_extra_header_data,
               "",
               "Extra XML data to add to PlayReady headers.");
+DEFINE_string(key_cache_dir,
+              "",
+              "Directory of a cache of the Widevine and PlayReady key server "
+              "responses, reused by restarted and sibling packager processes "
+              "instead of requesting the keys again. The directory must exist. "
+              "Requires --key_cache_key.");
+DEFINE_hex_bytes(key_cache_key,
+                 "",
+                 "16-byte AES key in hex string the key cache files are "
+                 "encrypted with.");
+DEFINE_int32(key_cache_validity,
+             24 * 60 * 60,
+             "How long a cached key server response is reused, in seconds.");
 
 bool ValueNotGreaterThanTen(const char* flagname, int32_t value) {
   if (value > 10) {
@@ -54,6 +74,16 @@ bool ValueIsXml(const char* flagname, const std::string& value) {
   return true;
 }
 
+bool ValueIsPositive(const char* flagname, int32_t value) {
+  if (value <= 0) {
+    fprintf(stderr, "ERROR: %s must be positive.\n", flagname);
+    return false;
+  }
+  return true;
+}
+
 DEFINE_validator(crypt_byte_block, &ValueNotGreaterThanTen);
 DEFINE_validator(skip_byte_block, &ValueNotGreaterThanTen);
 DEFINE_validator(playready_extra_header_data, &ValueIsXml);
+DEFINE_validator(num_encryption_threads, &ValueIsPositive);
+DEFINE_validator(key_cache_validity, &ValueIsPositive);
@@ -12,10 +12,16 @@
 
 #include <gflags/gflags.h>
 
+#include "packager/app/gflags_hex_bytes.h"
+
 DECLARE_string(protection_scheme);
 DECLARE_int32(crypt_byte_block);
 DECLARE_int32(skip_byte_block);
 DECLARE_bool(vp9_subsample_encryption);
+DECLARE_int32(num_encryption_threads);
 DECLARE_string(playready_extra_header_data);
+DECLARE_string(key_cache_dir);
+DECLARE_hex_bytes(key_cache_key);
+DECLARE_int32(key_cache_validity);
 
 #endif  // PACKAGER_APP_CRYPTO_FLAGS_H_
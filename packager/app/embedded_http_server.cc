@@ -0,0 +1,113 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/embedded_http_server.h"
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/third_party/libevent/evhttp.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+// libevent 1.4 cannot be woken up from another thread, so the event loop
+// exits periodically to check for a stop request.
+const int64_t kDefaultPollIntervalInMicroseconds = 100 * 1000;
+}  // namespace
+
+EmbeddedHttpServer::EmbeddedHttpServer(const std::string& name)
+    : name_(name), poll_interval_in_us_(kDefaultPollIntervalInMicroseconds) {}
+
+EmbeddedHttpServer::~EmbeddedHttpServer() {
+  Close();
+}
+
+bool EmbeddedHttpServer::Bind(const std::string& address, uint16_t port) {
+  DCHECK(!event_base_);
+  event_base_ = event_base_new();
+  if (!event_base_) {
+    LOG(ERROR) << "Failed to create the " << name_ << " event loop.";
+    return false;
+  }
+  http_ = evhttp_new(event_base_);
+  if (!http_ || evhttp_bind_socket(http_, address.c_str(), port) != 0) {
+    LOG(ERROR) << "Failed to bind the " << name_ << " to " << address << ":"
+               << port;
+    Close();
+    return false;
+  }
+  stop_requested_ = false;
+  return true;
+}
+
+void EmbeddedHttpServer::SetHandler(const char* path,
+                                    RequestHandler handler,
+                                    void* arg) {
+  DCHECK(http_);
+  evhttp_set_cb(http_, path, handler, arg);
+}
+
+void EmbeddedHttpServer::SetDefaultHandler(RequestHandler handler,
+                                           void* arg) {
+  DCHECK(http_);
+  evhttp_set_gencb(http_, handler, arg);
+}
+
+void EmbeddedHttpServer::SetPollCallback(
+    int64_t interval_in_us,
+    const std::function<void()>& callback) {
+  DCHECK_GT(interval_in_us, 0);
+  poll_interval_in_us_ = interval_in_us;
+  poll_callback_ = callback;
+}
+
+bool EmbeddedHttpServer::Run() {
+  DCHECK(http_);
+  while (!stop_requested_) {
+    timeval poll_interval = {
+        static_cast<long>(poll_interval_in_us_ / 1000000),
+        static_cast<long>(poll_interval_in_us_ % 1000000)};
+    event_base_loopexit(event_base_, &poll_interval);
+    if (event_base_dispatch(event_base_) < 0) {
+      LOG(ERROR) << "The " << name_ << " event loop failed.";
+      return false;
+    }
+    if (poll_callback_)
+      poll_callback_();
+  }
+  return true;
+}
+
+void EmbeddedHttpServer::Start() {
+  DCHECK(!thread_);
+  thread_.reset(new ClosureThread(
+      name_, base::Bind(base::IgnoreResult(&EmbeddedHttpServer::Run),
+                        base::Unretained(this))));
+  thread_->Start();
+}
+
+void EmbeddedHttpServer::Stop() {
+  stop_requested_ = true;
+  // ClosureThread joins on destruction.
+  thread_.reset();
+}
+
+void EmbeddedHttpServer::Close() {
+  Stop();
+  if (http_) {
+    evhttp_free(http_);
+    http_ = nullptr;
+  }
+  if (event_base_) {
+    event_base_free(event_base_);
+    event_base_ = nullptr;
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
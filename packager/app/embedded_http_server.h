@@ -0,0 +1,84 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_APP_EMBEDDED_HTTP_SERVER_H_
+#define PACKAGER_APP_EMBEDDED_HTTP_SERVER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+
+struct event_base;
+struct evhttp;
+struct evhttp_request;
+
+namespace shaka {
+namespace media {
+
+class ClosureThread;
+
+/// libevent HTTP server shared by the servers embedded in the packager. It
+/// owns the event loop, which runs either on the calling thread, see Run(),
+/// or on a thread of its own, see Start(). The requests are passed to the
+/// handlers registered after Bind(), on the event loop thread.
+class EmbeddedHttpServer {
+ public:
+  /// Signature of the evhttp request callbacks.
+  typedef void (*RequestHandler)(evhttp_request* request, void* arg);
+
+  /// @param name names the server in the logs and its thread.
+  explicit EmbeddedHttpServer(const std::string& name);
+  /// Stops and closes the server.
+  ~EmbeddedHttpServer();
+
+  /// Binds the server to @a port of @a address, e.g. 127.0.0.1, or 0.0.0.0
+  /// for all the network interfaces.
+  /// @return false if the port cannot be bound.
+  bool Bind(const std::string& address, uint16_t port);
+  /// Passes the requests to @a path to @a handler. Must be called after
+  /// Bind().
+  void SetHandler(const char* path, RequestHandler handler, void* arg);
+  /// Passes the requests to the paths without a handler to @a handler. Must
+  /// be called after Bind().
+  void SetDefaultHandler(RequestHandler handler, void* arg);
+  /// Runs @a callback on the event loop thread every @a interval_in_us
+  /// microseconds, e.g. to send the data produced on other threads. Must be
+  /// called before the event loop runs.
+  void SetPollCallback(int64_t interval_in_us,
+                       const std::function<void()>& callback);
+
+  /// Serves the requests on the calling thread until Stop() is called.
+  /// @return false if the event loop fails.
+  bool Run();
+  /// Serves the requests on a thread of its own until Stop() is called.
+  void Start();
+  /// Makes the event loop return, and waits for the thread started by
+  /// Start(). Can be called from any thread.
+  void Stop();
+  /// Stops the server and frees it, which also closes its connections. It
+  /// can be bound again afterwards.
+  void Close();
+
+ private:
+  EmbeddedHttpServer(const EmbeddedHttpServer&) = delete;
+  EmbeddedHttpServer& operator=(const EmbeddedHttpServer&) = delete;
+
+  const std::string name_;
+  event_base* event_base_ = nullptr;
+  evhttp* http_ = nullptr;
+  int64_t poll_interval_in_us_;
+  std::function<void()> poll_callback_;
+  std::atomic<bool> stop_requested_{false};
+  std::unique_ptr<ClosureThread> thread_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_EMBEDDED_HTTP_SERVER_H_
@@ -0,0 +1,125 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_APP_FAKE_ORIGIN_HANDLER_H_
+#define PACKAGER_APP_FAKE_ORIGIN_HANDLER_H_
+
+#include <atomic>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/media/origin/origin_handler.h"
+
+namespace shaka {
+namespace media {
+
+// An origin handler for the job tests, which takes |num_steps| steps to
+// complete, and is only ready to run them once its "input" has arrived.
+class FakeOriginHandler : public OriginHandler {
+ public:
+  explicit FakeOriginHandler(int num_steps)
+      : num_steps_(num_steps),
+        input_event_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
+                     base::WaitableEvent::InitialState::NOT_SIGNALED),
+        done_event_(base::WaitableEvent::ResetPolicy::MANUAL,
+                    base::WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+  // Runs the steps, waiting for the input when it is not ready.
+  Status Run() override {
+    Status status;
+    bool done = false;
+    while (!done) {
+      while (!IsReadyToRunStep())
+        input_event_.Wait();
+      status = RunStep(&done);
+    }
+    return status;
+  }
+
+  Status RunStep(bool* done) override {
+    thread_id_ = base::PlatformThread::CurrentId();
+    if (cancelled_) {
+      *done = true;
+      done_event_.Signal();
+      return Status(error::CANCELLED, "Cancelled.");
+    }
+    ++steps_run_;
+    if (steps_log_) {
+      base::AutoLock auto_lock(*steps_log_lock_);
+      steps_log_->push_back(this);
+    }
+    *done = steps_run_ >= num_steps_;
+    if (*done)
+      done_event_.Signal();
+    return *done ? final_status_ : Status::OK;
+  }
+
+  bool IsReadyToRunStep() override { return cancelled_ || ready_; }
+
+  void SetReadyEvent(base::WaitableEvent* event) override {
+    ready_event_ = event;
+  }
+
+  void Cancel() override {
+    cancelled_ = true;
+    input_event_.Signal();
+    if (ready_event_)
+      ready_event_->Signal();
+  }
+
+  // Sets whether the "input" of the handler has arrived. Can be called from
+  // another thread.
+  void SetReady(bool ready) {
+    ready_ = ready;
+    if (!ready)
+      return;
+    input_event_.Signal();
+    if (ready_event_)
+      ready_event_->Signal();
+  }
+
+  // Waits for the last step to run.
+  void WaitUntilDone() { done_event_.Wait(); }
+
+  // Appends the handler to |steps_log| on each step.
+  void set_steps_log(std::vector<const FakeOriginHandler*>* steps_log,
+                     base::Lock* steps_log_lock) {
+    steps_log_ = steps_log;
+    steps_log_lock_ = steps_log_lock;
+  }
+
+  // The status of the last step.
+  void set_final_status(const Status& status) { final_status_ = status; }
+
+  int steps_run() const { return steps_run_; }
+  bool cancelled() const { return cancelled_; }
+  // The thread which ran the last step.
+  base::PlatformThreadId thread_id() const { return thread_id_; }
+
+ protected:
+  Status InitializeInternal() override { return Status::OK; }
+
+ private:
+  const int num_steps_;
+  std::atomic<int> steps_run_{0};
+  std::atomic<bool> ready_{true};
+  std::atomic<bool> cancelled_{false};
+  // Signaled when the input arrives or the handler is cancelled, for Run().
+  base::WaitableEvent input_event_;
+  base::WaitableEvent done_event_;
+  base::WaitableEvent* ready_event_ = nullptr;
+  std::vector<const FakeOriginHandler*>* steps_log_ = nullptr;
+  base::Lock* steps_log_lock_ = nullptr;
+  Status final_status_;
+  base::PlatformThreadId thread_id_ = base::kInvalidThreadId;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_FAKE_ORIGIN_HANDLER_H_
@@ -30,3 +30,27 @@ DEFINE_int32(hls_media_sequence_number,
               "EXT-X-MEDIA-SEQUENCE value, which allows continuous media "
               "sequence across packager restarts. See #691 for more "
               "information about the reasoning of this and its use cases.");
+DEFINE_double(hls_delta_update_skip_until,
+              0,
+              "Enables Playlist Delta Updates for LIVE and EVENT playlists if "
+              "positive. CAN-SKIP-UNTIL, in seconds, is set to this value, "
+              "raised to six target durations if it is smaller. The delta "
+              "update of a media playlist is written next to it with a "
+              "'_delta' suffix before the extension. The origin server must "
+              "serve it for requests with the _HLS_skip=YES query parameter.");
+DEFINE_double(hls_gap_timeout,
+              0,
+              "Seconds without a new segment after which a stream of a LIVE "
+              "or EVENT playlist is considered stalled. Segments tagged with "
+              "EXT-X-GAP, with the duration of the previous segment, are then "
+              "added to its playlist to cover the time since its last "
+              "segment, until its input resumes, so the playlist keeps "
+              "moving. Disabled if not positive.");
+DEFINE_bool(hls_low_latency_mode,
+            false,
+            "Generate Low-Latency HLS playlists. Every fragment, defined by "
+            "--fragment_duration, is also written as a partial segment and "
+            "signalled with EXT-X-PART as soon as it is available. Only "
+            "applies to fMP4 outputs with LIVE or EVENT playlists. Blocking "
+            "playlist reload, advertised with EXT-X-SERVER-CONTROL, must be "
+            "implemented by the origin server.");
@@ -14,5 +14,8 @@ DECLARE_string(hls_base_url);
 DECLARE_string(hls_key_uri);
 DECLARE_string(hls_playlist_type);
 DECLARE_int32(hls_media_sequence_number);
+DECLARE_bool(hls_low_latency_mode);
+DECLARE_double(hls_delta_update_skip_until);
+DECLARE_double(hls_gap_timeout);
 
 #endif  // PACKAGER_APP_HLS_FLAGS_H_
@@ -0,0 +1,108 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/interleaved_jobs.h"
+
+#include <algorithm>
+
+namespace shaka {
+namespace media {
+
+InterleavedJobs::InterleavedJobs()
+    : idle_event_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
+                  base::WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+void InterleavedJobs::AddJob(std::shared_ptr<OriginHandler> handler) {
+  DCHECK(!initialized());
+  handler->SetReadyEvent(ready_event_);
+  jobs_.push_back(std::move(handler));
+}
+
+Status InterleavedJobs::InitializeInternal() {
+  Status status;
+  for (const auto& job : jobs_)
+    status.Update(job->Initialize());
+  return status;
+}
+
+Status InterleavedJobs::Run() {
+  bool done = false;
+  while (!done) {
+    if (!IsReadyToRunStep()) {
+      // A handler which turns ready in the meantime has signaled the event
+      // already, so this does not miss it.
+      const base::TimeDelta max_wait = GetMaxTimeUntilReady();
+      if (max_wait.is_max())
+        ready_event_->Wait();
+      else
+        ready_event_->TimedWait(max_wait);
+      continue;
+    }
+    RunStep(&done);
+  }
+  return status_;
+}
+
+Status InterleavedJobs::RunStep(bool* done) {
+  if (!started_) {
+    for (const auto& job : jobs_)
+      active_jobs_.push_back(job.get());
+    started_ = true;
+  }
+
+  auto iter = active_jobs_.begin();
+  while (iter != active_jobs_.end()) {
+    if (!(*iter)->IsReadyToRunStep()) {
+      ++iter;
+      continue;
+    }
+    bool job_done = false;
+    const Status step_status = (*iter)->RunStep(&job_done);
+    if (!job_done) {
+      ++iter;
+      continue;
+    }
+    iter = active_jobs_.erase(iter);
+    // Like JobManager, stop the other jobs once a job fails.
+    if (status_.ok() && !step_status.ok())
+      Cancel();
+    status_.Update(step_status);
+  }
+  *done = active_jobs_.empty();
+  return *done ? status_ : Status::OK;
+}
+
+bool InterleavedJobs::IsReadyToRunStep() {
+  if (!started_ || active_jobs_.empty())
+    return true;
+  for (OriginHandler* job : active_jobs_) {
+    if (job->IsReadyToRunStep())
+      return true;
+  }
+  return false;
+}
+
+void InterleavedJobs::SetReadyEvent(base::WaitableEvent* event) {
+  ready_event_ = event;
+  for (const auto& job : jobs_)
+    job->SetReadyEvent(event);
+}
+
+base::TimeDelta InterleavedJobs::GetMaxTimeUntilReady() {
+  base::TimeDelta max_wait = base::TimeDelta::Max();
+  for (OriginHandler* job : active_jobs_)
+    max_wait = std::min(max_wait, job->GetMaxTimeUntilReady());
+  return max_wait;
+}
+
+void InterleavedJobs::Cancel() {
+  for (const auto& job : jobs_)
+    job->Cancel();
+  ready_event_->Signal();
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,67 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_APP_INTERLEAVED_JOBS_H_
+#define PACKAGER_APP_INTERLEAVED_JOBS_H_
+
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/media/origin/origin_handler.h"
+
+namespace shaka {
+namespace media {
+
+// An origin handler that runs several origin handlers a step at a time in
+// turns, skipping those waiting for input, so that they share the thread that
+// runs it. When none of them is ready, it waits for their ready event. It
+// suits the lightweight jobs, e.g. the text pipelines, which would otherwise
+// leave a mostly idle thread each. The handlers must not depend on
+// each other to make progress, e.g. through cue alignment.
+class InterleavedJobs : public OriginHandler {
+ public:
+  InterleavedJobs();
+
+  // Add |handler| to the handlers to run. Must be called before |Initialize|.
+  void AddJob(std::shared_ptr<OriginHandler> handler);
+
+  Status Run() override;
+  // Runs a step of each of the handlers ready to run one.
+  Status RunStep(bool* done) override;
+  // Returns true if any of the handlers is ready to run a step.
+  bool IsReadyToRunStep() override;
+  // The handlers signal |event| instead of the event |Run| waits for, when
+  // this is run by another InterleavedJobs.
+  void SetReadyEvent(base::WaitableEvent* event) override;
+  base::TimeDelta GetMaxTimeUntilReady() override;
+  void Cancel() override;
+
+ protected:
+  // Initializes the handlers.
+  Status InitializeInternal() override;
+
+ private:
+  InterleavedJobs(const InterleavedJobs&) = delete;
+  InterleavedJobs& operator=(const InterleavedJobs&) = delete;
+
+  // Signaled by the handlers when they may be ready to run a step. Declared
+  // before |jobs_|, which may signal it until they are destroyed.
+  base::WaitableEvent idle_event_;
+  base::WaitableEvent* ready_event_ = &idle_event_;
+  std::vector<std::shared_ptr<OriginHandler>> jobs_;
+  // The handlers which are not done yet, in the order they take turns.
+  std::list<OriginHandler*> active_jobs_;
+  bool started_ = false;
+  // The first error of the handlers.
+  Status status_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_INTERLEAVED_JOBS_H_
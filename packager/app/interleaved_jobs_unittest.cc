@@ -0,0 +1,141 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "packager/app/fake_origin_handler.h"
+#include "packager/app/interleaved_jobs.h"
+#include "packager/base/bind.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const int kNumSteps = 3;
+
+}  // namespace
+
+class InterleavedJobsTest : public ::testing::Test {
+ protected:
+  std::shared_ptr<FakeOriginHandler> AddJob(int num_steps) {
+    auto job = std::make_shared<FakeOriginHandler>(num_steps);
+    job->set_steps_log(&steps_log_, &steps_log_lock_);
+    jobs_.AddJob(job);
+    return job;
+  }
+
+  InterleavedJobs jobs_;
+  std::vector<const FakeOriginHandler*> steps_log_;
+  base::Lock steps_log_lock_;
+};
+
+TEST_F(InterleavedJobsTest, RunsJobsInTurns) {
+  std::shared_ptr<FakeOriginHandler> job1 = AddJob(kNumSteps);
+  std::shared_ptr<FakeOriginHandler> job2 = AddJob(kNumSteps - 1);
+  ASSERT_OK(jobs_.Initialize());
+  ASSERT_OK(jobs_.Run());
+
+  const std::vector<const FakeOriginHandler*> expected_steps = {
+      job1.get(), job2.get(), job1.get(), job2.get(), job1.get()};
+  EXPECT_EQ(expected_steps, steps_log_);
+}
+
+TEST_F(InterleavedJobsTest, SkipsJobsNotReady) {
+  std::shared_ptr<FakeOriginHandler> job1 = AddJob(kNumSteps);
+  std::shared_ptr<FakeOriginHandler> job2 = AddJob(kNumSteps);
+  job2->SetReady(false);
+  ASSERT_OK(jobs_.Initialize());
+
+  bool done = false;
+  ASSERT_OK(jobs_.RunStep(&done));
+  EXPECT_FALSE(done);
+  ASSERT_OK(jobs_.RunStep(&done));
+  EXPECT_EQ(2, job1->steps_run());
+  EXPECT_EQ(0, job2->steps_run());
+  EXPECT_TRUE(jobs_.IsReadyToRunStep());
+
+  ASSERT_OK(jobs_.RunStep(&done));
+  EXPECT_EQ(kNumSteps, job1->steps_run());
+  // Only |job2| is left, and it is waiting for input.
+  EXPECT_FALSE(done);
+  EXPECT_FALSE(jobs_.IsReadyToRunStep());
+
+  job2->SetReady(true);
+  EXPECT_TRUE(jobs_.IsReadyToRunStep());
+  while (!done)
+    ASSERT_OK(jobs_.RunStep(&done));
+  EXPECT_EQ(kNumSteps, job2->steps_run());
+}
+
+// Run() waits for the input of the jobs, which arrives on another thread.
+TEST_F(InterleavedJobsTest, WaitsForInput) {
+  std::shared_ptr<FakeOriginHandler> job = AddJob(kNumSteps);
+  job->SetReady(false);
+  ASSERT_OK(jobs_.Initialize());
+
+  ClosureThread input_thread(
+      "Input", base::Bind(&FakeOriginHandler::SetReady,
+                          base::Unretained(job.get()), true));
+  input_thread.Start();
+  ASSERT_OK(jobs_.Run());
+  EXPECT_EQ(kNumSteps, job->steps_run());
+}
+
+// Cancel() wakes up Run() when all the jobs are waiting for input.
+TEST_F(InterleavedJobsTest, CancelWhileWaiting) {
+  std::shared_ptr<FakeOriginHandler> job = AddJob(kNumSteps);
+  job->SetReady(false);
+  ASSERT_OK(jobs_.Initialize());
+
+  ClosureThread cancel_thread(
+      "Cancel",
+      base::Bind(&InterleavedJobs::Cancel, base::Unretained(&jobs_)));
+  cancel_thread.Start();
+  EXPECT_EQ(error::CANCELLED, jobs_.Run().error_code());
+  EXPECT_EQ(0, job->steps_run());
+}
+
+// Like JobManager, the other jobs are cancelled once a job fails.
+TEST_F(InterleavedJobsTest, FailureCancelsTheOtherJobs) {
+  std::shared_ptr<FakeOriginHandler> failing_job = AddJob(1);
+  failing_job->set_final_status(Status(error::PARSER_FAILURE, "Failed."));
+  std::shared_ptr<FakeOriginHandler> job = AddJob(kNumSteps);
+  job->SetReady(false);
+  ASSERT_OK(jobs_.Initialize());
+
+  EXPECT_EQ(error::PARSER_FAILURE, jobs_.Run().error_code());
+  EXPECT_TRUE(job->cancelled());
+  EXPECT_EQ(0, job->steps_run());
+}
+
+// The jobs of an InterleavedJobs run by another one signal the ready event of
+// the outer one.
+TEST_F(InterleavedJobsTest, Nested) {
+  auto inner_jobs = std::make_shared<InterleavedJobs>();
+  auto inner_job = std::make_shared<FakeOriginHandler>(kNumSteps);
+  inner_job->set_steps_log(&steps_log_, &steps_log_lock_);
+  inner_job->SetReady(false);
+  inner_jobs->AddJob(inner_job);
+  jobs_.AddJob(inner_jobs);
+  std::shared_ptr<FakeOriginHandler> job = AddJob(1);
+  ASSERT_OK(jobs_.Initialize());
+
+  ClosureThread input_thread(
+      "Input", base::Bind(&FakeOriginHandler::SetReady,
+                          base::Unretained(inner_job.get()), true));
+  input_thread.Start();
+  ASSERT_OK(jobs_.Run());
+  EXPECT_EQ(kNumSteps, inner_job->steps_run());
+  EXPECT_EQ(1, job->steps_run());
+}
+
+}  // namespace media
+}  // namespace shaka
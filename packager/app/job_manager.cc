@@ -6,7 +6,9 @@
 
 #include "packager/app/job_manager.h"
 
+#include "packager/app/interleaved_jobs.h"
 #include "packager/app/libcrypto_threading.h"
+#include "packager/file/thread_class.h"
 #include "packager/media/chunking/sync_point_queue.h"
 #include "packager/media/origin/origin_handler.h"
 
@@ -26,12 +28,15 @@ void Job::Cancel() {
 }
 
 void Job::Run() {
+  SetCurrentThreadClass(ThreadClass::kMedia);
   status_ = work_->Run();
   wait_.Signal();
 }
 
 JobManager::JobManager(std::unique_ptr<SyncPointQueue> sync_points)
-    : sync_points_(std::move(sync_points)) {}
+    : sync_points_(std::move(sync_points)),
+      jobs_added_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
+                  base::WaitableEvent::InitialState::NOT_SIGNALED) {}
 
 void JobManager::Add(const std::string& name,
                      std::shared_ptr<OriginHandler> handler) {
@@ -41,6 +46,16 @@ void JobManager::Add(const std::string& name,
   job_entries_.push_back({name, std::move(handler)});
 }
 
+void JobManager::AddToSharedThread(const std::string& name,
+                                   std::shared_ptr<OriginHandler> handler) {
+  std::shared_ptr<InterleavedJobs>& shared_thread = shared_threads_[name];
+  if (!shared_thread) {
+    shared_thread = std::make_shared<InterleavedJobs>();
+    Add(name, shared_thread);
+  }
+  shared_thread->AddJob(std::move(handler));
+}
+
 Status JobManager::InitializeJobs() {
   Status status;
   for (const JobEntry& job_entry : job_entries_)
@@ -63,41 +78,75 @@ Status JobManager::RunJobs() {
   std::vector<Job*> active_jobs;
   std::vector<base::WaitableEvent*> active_waits;
 
+  // The first wait is signalled when jobs are added by |AddInitializedJobs|.
+  active_jobs.push_back(nullptr);
+  active_waits.push_back(&jobs_added_);
+
   // Start every job and add it to the active jobs list so that we can wait
   // on each one.
-  for (auto& job : jobs_) {
-    job->Start();
+  {
+    base::AutoLock auto_lock(jobs_lock_);
+    for (auto& job : jobs_) {
+      job->Start();
 
-    active_jobs.push_back(job.get());
-    active_waits.push_back(job->wait());
+      active_jobs.push_back(job.get());
+      active_waits.push_back(job->wait());
+    }
   }
+  StartPendingJobs(&active_jobs, &active_waits);
 
   // Wait for all jobs to complete or an error occurs.
   Status status;
-  while (status.ok() && active_jobs.size()) {
+  while (status.ok() && active_jobs.size() > 1) {
     // Wait for an event to finish and then update our status so that we can
     // quit if something has gone wrong.
     const size_t done =
         base::WaitableEvent::WaitMany(active_waits.data(), active_waits.size());
+    if (done == 0) {
+      StartPendingJobs(&active_jobs, &active_waits);
+      continue;
+    }
     Job* job = active_jobs[done];
 
     job->Join();
-    status.Update(job->status());
+    {
+      base::AutoLock auto_lock(jobs_lock_);
+      if (stopped_jobs_.find(job) == stopped_jobs_.end())
+        status.Update(job->status());
+    }
 
     // Remove the job and the wait from our tracking.
     active_jobs.erase(active_jobs.begin() + done);
     active_waits.erase(active_waits.begin() + done);
   }
 
+  // The jobs added from now on are not run. The ones added since the last
+  // wait are cancelled right away.
+  std::vector<std::unique_ptr<Job>> pending_jobs;
+  {
+    base::AutoLock auto_lock(jobs_lock_);
+    jobs_finished_ = true;
+    pending_jobs.swap(pending_jobs_);
+  }
+
   // If the main loop has exited and there are still jobs running,
   // we need to cancel them and clean-up.
   if (sync_points_)
     sync_points_->Cancel();
-  for (auto& job : active_jobs) {
+  for (size_t i = 1; i < active_jobs.size(); ++i) {
+    active_jobs[i]->Cancel();
+  }
+  // A thread has to be joined once started, and started before it is
+  // destroyed.
+  for (auto& job : pending_jobs) {
     job->Cancel();
+    job->Start();
   }
 
-  for (auto& job : active_jobs) {
+  for (size_t i = 1; i < active_jobs.size(); ++i) {
+    active_jobs[i]->Join();
+  }
+  for (auto& job : pending_jobs) {
     job->Join();
   }
 
@@ -107,9 +156,101 @@ Status JobManager::RunJobs() {
 void JobManager::CancelJobs() {
   if (sync_points_)
     sync_points_->Cancel();
+  base::AutoLock auto_lock(jobs_lock_);
+  jobs_cancelled_ = true;
   for (auto& job : jobs_) {
     job->Cancel();
   }
+  for (auto& job : pending_jobs_) {
+    job->Cancel();
+  }
+}
+
+Status JobManager::AddInitializedJobs(uint32_t group_id, JobManager* jobs) {
+  DCHECK(jobs);
+  Status status;
+  {
+    base::AutoLock auto_lock(jobs_lock_);
+    if (jobs_cancelled_) {
+      status = Status(error::CANCELLED, "Jobs are cancelled.");
+    } else if (jobs_finished_) {
+      status = Status(error::INVALID_ARGUMENT, "Jobs are no longer running.");
+    } else {
+      for (auto& job : jobs->jobs_) {
+        job_groups_[job.get()] = group_id;
+        pending_jobs_.push_back(std::move(job));
+      }
+      jobs->jobs_.clear();
+      jobs_added_.Signal();
+      return Status::OK;
+    }
+  }
+
+  // The jobs are not run, but they must be started and joined before they
+  // are destroyed.
+  for (auto& job : jobs->jobs_) {
+    job->Cancel();
+    job->Start();
+    job->Join();
+  }
+  jobs->jobs_.clear();
+  return status;
+}
+
+Status JobManager::StopJobs(uint32_t group_id) {
+  auto in_group = [this, group_id](const std::unique_ptr<Job>& job) {
+    auto iter = job_groups_.find(job.get());
+    return iter != job_groups_.end() && iter->second == group_id;
+  };
+
+  std::vector<Job*> started_jobs;
+  std::vector<std::unique_ptr<Job>> unstarted_jobs;
+  {
+    base::AutoLock auto_lock(jobs_lock_);
+    if (jobs_finished_)
+      return Status(error::INVALID_ARGUMENT, "Jobs are no longer running.");
+
+    for (auto& job : jobs_) {
+      if (!in_group(job))
+        continue;
+      stopped_jobs_.insert(job.get());
+      job->Cancel();
+      started_jobs.push_back(job.get());
+    }
+    for (auto iter = pending_jobs_.begin(); iter != pending_jobs_.end();) {
+      if (!in_group(*iter)) {
+        ++iter;
+        continue;
+      }
+      stopped_jobs_.insert(iter->get());
+      unstarted_jobs.push_back(std::move(*iter));
+      iter = pending_jobs_.erase(iter);
+    }
+  }
+
+  // The jobs in |jobs_| are never removed, so |started_jobs| stay valid.
+  for (Job* job : started_jobs)
+    job->wait()->Wait();
+  for (auto& job : unstarted_jobs) {
+    job->Cancel();
+    job->Start();
+    job->Join();
+  }
+  return Status::OK;
+}
+
+void JobManager::StartPendingJobs(
+    std::vector<Job*>* active_jobs,
+    std::vector<base::WaitableEvent*>* active_waits) {
+  base::AutoLock auto_lock(jobs_lock_);
+  for (auto& job : pending_jobs_) {
+    job->Start();
+
+    active_jobs->push_back(job.get());
+    active_waits->push_back(job->wait());
+    jobs_.push_back(std::move(job));
+  }
+  pending_jobs_.clear();
 }
 
 }  // namespace media
@@ -7,15 +7,20 @@
 #ifndef PACKAGER_APP_JOB_MANAGER_H_
 #define PACKAGER_APP_JOB_MANAGER_H_
 
+#include <map>
 #include <memory>
+#include <set>
 #include <vector>
 
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/waitable_event.h"
 #include "packager/base/threading/simple_thread.h"
 #include "packager/status.h"
 
 namespace shaka {
 namespace media {
 
+class InterleavedJobs;
 class OriginHandler;
 class SyncPointQueue;
 
@@ -67,6 +72,13 @@ class JobManager {
   // the job, you need to call |RunJobs|.
   void Add(const std::string& name, std::shared_ptr<OriginHandler> handler);
 
+  // Like |Add|, but the handlers added with the same |name| are run in turns
+  // by a single job, see InterleavedJobs, instead of a thread each. It is
+  // meant for the lightweight jobs, e.g. text pipelines, which must not
+  // depend on each other to make progress, e.g. through cue alignment.
+  void AddToSharedThread(const std::string& name,
+                         std::shared_ptr<OriginHandler> handler);
+
   // Initialize all registered jobs. If any job fails to initialize, this will
   // return the error and it will not be safe to call |RunJobs| as not all jobs
   // will be properly initialized.
@@ -79,7 +91,22 @@ class JobManager {
 
   // Ask all jobs to stop running. This call is non-blocking and can be used to
   // unblock a call to |RunJobs|.
-  void CancelJobs();
+  virtual void CancelJobs();
+
+  // Take the jobs of |jobs|, which must have been initialized with
+  // |InitializeJobs|, and run them along with the other jobs, starting them
+  // right away if |RunJobs| is running. This can be called from another thread
+  // than |RunJobs|, e.g. to add live streams to a running packager.
+  // @param group_id identifies the jobs for |StopJobs|.
+  // @param jobs is usually a temporary JobManager, with no sync points, that
+  //        the jobs were added to.
+  // @return An error if |RunJobs| has exited or the jobs are cancelled.
+  virtual Status AddInitializedJobs(uint32_t group_id, JobManager* jobs);
+
+  // Stop the jobs added with |AddInitializedJobs| with |group_id| and wait
+  // for them to exit. Unlike the failure of the other jobs, it does not stop
+  // |RunJobs|.
+  virtual Status StopJobs(uint32_t group_id);
 
   SyncPointQueue* sync_points() { return sync_points_.get(); }
 
@@ -93,10 +120,32 @@ class JobManager {
   };
   // Stores Job entries for delayed construction of Job object.
   std::vector<JobEntry> job_entries_;
+  // The job of each shared thread name, which is also in |job_entries_|.
+  std::map<std::string, std::shared_ptr<InterleavedJobs>> shared_threads_;
   std::vector<std::unique_ptr<Job>> jobs_;
   // Stored in JobManager so JobManager can cancel |sync_points| when any job
   // fails or is cancelled.
   std::unique_ptr<SyncPointQueue> sync_points_;
+
+ private:
+  // Start the jobs in |pending_jobs_|, move them to |jobs_| and add them to
+  // the jobs waited for by |RunJobs|.
+  void StartPendingJobs(std::vector<Job*>* active_jobs,
+                        std::vector<base::WaitableEvent*>* active_waits);
+
+  // Protects |jobs_| once |RunJobs| may be running, and the members below.
+  base::Lock jobs_lock_;
+  // Signalled when jobs are added to |pending_jobs_| by |AddInitializedJobs|.
+  base::WaitableEvent jobs_added_;
+  // The jobs added by |AddInitializedJobs|, waiting to be started by
+  // |RunJobs|.
+  std::vector<std::unique_ptr<Job>> pending_jobs_;
+  // The group of the jobs added by |AddInitializedJobs|.
+  std::map<const Job*, uint32_t> job_groups_;
+  // The jobs stopped by |StopJobs|, whose status is ignored.
+  std::set<const Job*> stopped_jobs_;
+  bool jobs_cancelled_ = false;
+  bool jobs_finished_ = false;
 };
 
 }  // namespace media
@@ -0,0 +1,186 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <utility>
+
+#include "packager/app/fake_origin_handler.h"
+#include "packager/app/job_manager.h"
+#include "packager/base/bind.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const int kNumSteps = 3;
+const char kSharedThread[] = "SharedThread";
+const char kOtherSharedThread[] = "OtherSharedThread";
+const uint32_t kGroupId = 1;
+
+}  // namespace
+
+class JobManagerTest : public ::testing::Test {
+ protected:
+  // Starts RunJobs() on another thread.
+  void StartRunJobs() {
+    run_thread_.reset(new ClosureThread(
+        "RunJobs",
+        base::Bind(&JobManagerTest::RunJobs, base::Unretained(this))));
+    run_thread_->Start();
+  }
+
+  // Waits for RunJobs() to return.
+  Status WaitForRunJobs() {
+    // ClosureThread joins on destruction.
+    run_thread_.reset();
+    return run_status_;
+  }
+
+  // Initializes |job| and adds it to |job_manager_|, e.g. while it runs,
+  // with AddInitializedJobs().
+  Status AddInitializedJob(std::shared_ptr<FakeOriginHandler> job) {
+    JobManager jobs(nullptr);
+    jobs.Add("AddedJob", std::move(job));
+    EXPECT_OK(jobs.InitializeJobs());
+    return job_manager_.AddInitializedJobs(kGroupId, &jobs);
+  }
+
+  JobManager job_manager_{nullptr};
+
+ private:
+  void RunJobs() { run_status_ = job_manager_.RunJobs(); }
+
+  std::unique_ptr<ClosureThread> run_thread_;
+  Status run_status_;
+};
+
+TEST_F(JobManagerTest, AddToSharedThread) {
+  auto shared_job1 = std::make_shared<FakeOriginHandler>(kNumSteps);
+  auto shared_job2 = std::make_shared<FakeOriginHandler>(kNumSteps);
+  auto job = std::make_shared<FakeOriginHandler>(kNumSteps);
+  job_manager_.AddToSharedThread(kSharedThread, shared_job1);
+  job_manager_.Add("Job", job);
+  job_manager_.AddToSharedThread(kSharedThread, shared_job2);
+  ASSERT_OK(job_manager_.InitializeJobs());
+  ASSERT_OK(job_manager_.RunJobs());
+
+  EXPECT_EQ(kNumSteps, shared_job1->steps_run());
+  EXPECT_EQ(kNumSteps, shared_job2->steps_run());
+  EXPECT_EQ(kNumSteps, job->steps_run());
+  EXPECT_EQ(shared_job1->thread_id(), shared_job2->thread_id());
+  EXPECT_NE(shared_job1->thread_id(), job->thread_id());
+}
+
+TEST_F(JobManagerTest, AddToSharedThreadsByName) {
+  auto shared_job = std::make_shared<FakeOriginHandler>(kNumSteps);
+  auto other_shared_job = std::make_shared<FakeOriginHandler>(kNumSteps);
+  job_manager_.AddToSharedThread(kSharedThread, shared_job);
+  job_manager_.AddToSharedThread(kOtherSharedThread, other_shared_job);
+  ASSERT_OK(job_manager_.InitializeJobs());
+  ASSERT_OK(job_manager_.RunJobs());
+
+  EXPECT_EQ(kNumSteps, shared_job->steps_run());
+  EXPECT_EQ(kNumSteps, other_shared_job->steps_run());
+  EXPECT_NE(shared_job->thread_id(), other_shared_job->thread_id());
+}
+
+// The failure of a job on a shared thread cancels the jobs sharing it, even
+// while they wait for input.
+TEST_F(JobManagerTest, SharedThreadFailure) {
+  auto failing_job = std::make_shared<FakeOriginHandler>(1);
+  failing_job->set_final_status(Status(error::PARSER_FAILURE, "Failed."));
+  auto waiting_job = std::make_shared<FakeOriginHandler>(kNumSteps);
+  waiting_job->SetReady(false);
+  job_manager_.AddToSharedThread(kSharedThread, waiting_job);
+  job_manager_.AddToSharedThread(kSharedThread, failing_job);
+  ASSERT_OK(job_manager_.InitializeJobs());
+
+  EXPECT_EQ(error::PARSER_FAILURE, job_manager_.RunJobs().error_code());
+  EXPECT_TRUE(waiting_job->cancelled());
+  EXPECT_EQ(0, waiting_job->steps_run());
+}
+
+// CancelJobs() stops the shared thread while all its jobs wait for input.
+TEST_F(JobManagerTest, CancelSharedThread) {
+  auto waiting_job = std::make_shared<FakeOriginHandler>(kNumSteps);
+  waiting_job->SetReady(false);
+  job_manager_.AddToSharedThread(kSharedThread, waiting_job);
+  ASSERT_OK(job_manager_.InitializeJobs());
+
+  job_manager_.CancelJobs();
+  EXPECT_EQ(error::CANCELLED, job_manager_.RunJobs().error_code());
+  EXPECT_EQ(0, waiting_job->steps_run());
+}
+
+TEST_F(JobManagerTest, AddInitializedJobsWhileRunning) {
+  auto job = std::make_shared<FakeOriginHandler>(kNumSteps);
+  job->SetReady(false);
+  job_manager_.Add("Job", job);
+  ASSERT_OK(job_manager_.InitializeJobs());
+  StartRunJobs();
+
+  // The job added runs while the other one waits for input.
+  auto added_job = std::make_shared<FakeOriginHandler>(kNumSteps);
+  ASSERT_OK(AddInitializedJob(added_job));
+  added_job->WaitUntilDone();
+  EXPECT_EQ(kNumSteps, added_job->steps_run());
+  EXPECT_EQ(0, job->steps_run());
+
+  job->SetReady(true);
+  ASSERT_OK(WaitForRunJobs());
+  EXPECT_EQ(kNumSteps, job->steps_run());
+}
+
+TEST_F(JobManagerTest, StopJobsWhileRunning) {
+  auto job = std::make_shared<FakeOriginHandler>(kNumSteps);
+  job->SetReady(false);
+  job_manager_.Add("Job", job);
+  ASSERT_OK(job_manager_.InitializeJobs());
+  StartRunJobs();
+
+  auto added_job = std::make_shared<FakeOriginHandler>(kNumSteps);
+  added_job->SetReady(false);
+  ASSERT_OK(AddInitializedJob(added_job));
+  ASSERT_OK(job_manager_.StopJobs(kGroupId));
+  EXPECT_TRUE(added_job->cancelled());
+
+  // Stopping the jobs added does not stop the others, nor fail RunJobs().
+  EXPECT_FALSE(job->cancelled());
+  job->SetReady(true);
+  ASSERT_OK(WaitForRunJobs());
+  EXPECT_EQ(kNumSteps, job->steps_run());
+}
+
+TEST_F(JobManagerTest, AddInitializedJobsAfterRunning) {
+  job_manager_.Add("Job", std::make_shared<FakeOriginHandler>(kNumSteps));
+  ASSERT_OK(job_manager_.InitializeJobs());
+  ASSERT_OK(job_manager_.RunJobs());
+
+  auto added_job = std::make_shared<FakeOriginHandler>(kNumSteps);
+  EXPECT_EQ(error::INVALID_ARGUMENT,
+            AddInitializedJob(added_job).error_code());
+  // The job is cancelled before running.
+  EXPECT_TRUE(added_job->cancelled());
+  EXPECT_EQ(0, added_job->steps_run());
+}
+
+TEST_F(JobManagerTest, AddInitializedJobsAfterCancelling) {
+  job_manager_.Add("Job", std::make_shared<FakeOriginHandler>(kNumSteps));
+  ASSERT_OK(job_manager_.InitializeJobs());
+  job_manager_.CancelJobs();
+
+  auto added_job = std::make_shared<FakeOriginHandler>(kNumSteps);
+  EXPECT_EQ(error::CANCELLED, AddInitializedJob(added_job).error_code());
+  EXPECT_EQ(0, added_job->steps_run());
+  EXPECT_EQ(error::CANCELLED, job_manager_.RunJobs().error_code());
+}
+
+}  // namespace media
+}  // namespace shaka
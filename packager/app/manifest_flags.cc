@@ -33,3 +33,19 @@ DEFINE_string(default_text_language,
               "",
               "Same as above, but this applies to text tracks only, and "
               "overrides the default language for text tracks.");
+DEFINE_double(manifest_write_coalescing_window,
+              0,
+              "Window, in seconds, to coalesce the manifest writes triggered "
+              "by new segments of different streams in live packaging. A "
+              "manifest is written once all the streams it describes have "
+              "reported a new segment, or once the window has elapsed since "
+              "the previous write, which reduces the number of writes for "
+              "large ladders. Every new segment triggers a manifest write if "
+              "the value is zero.");
+DEFINE_bool(async_manifest_writes,
+            false,
+            "Write the manifests on a worker thread in live packaging, so "
+            "the media output does not block on the manifest output, e.g. a "
+            "slow manifest upload. Only the latest version of a manifest is "
+            "written if a newer version is available before the previous "
+            "one is written.");
@@ -15,5 +15,7 @@ DECLARE_double(time_shift_buffer_depth);
 DECLARE_uint64(preserved_segments_outside_live_window);
 DECLARE_string(default_language);
 DECLARE_string(default_text_language);
+DECLARE_double(manifest_write_coalescing_window);
+DECLARE_bool(async_manifest_writes);
 
 #endif  // PACKAGER_APP_MANIFEST_FLAGS_H_
@@ -0,0 +1,198 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/media_handler_stats_reporter.h"
+
+#include <inttypes.h>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/time/time.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/media/base/media_handler.h"
+#include "packager/media/base/muxer.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+std::string ToJsonString(const std::string& value) {
+  std::string json = "\"";
+  for (const char c : value) {
+    switch (c) {
+      case '"':
+        json += "\\\"";
+        break;
+      case '\\':
+        json += "\\\\";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20)
+          base::StringAppendF(&json, "\\u%04x", c);
+        else
+          json += c;
+        break;
+    }
+  }
+  json += "\"";
+  return json;
+}
+
+std::string ToJson(const MediaHandlerStats& stats) {
+  std::string json = base::StringPrintf(
+      "\"num_stream_data\":%" PRIu64 ",\"total_time_us\":%" PRId64
+      ",\"downstream_time_us\":%" PRId64 ",\"queue_depth\":%zu",
+      stats.num_stream_data, stats.total_time_us, stats.downstream_time_us,
+      stats.queue_depth);
+  json += ",\"time_histogram\":[";
+  for (size_t i = 0; i < stats.time_histogram.size(); ++i) {
+    if (i > 0)
+      json += ",";
+    base::StringAppendF(&json, "%" PRIu64, stats.time_histogram[i]);
+  }
+  json += "]";
+  return json;
+}
+
+}  // namespace
+
+MediaHandlerStatsReporter::MediaHandlerStatsReporter(
+    const HandlerStatsParams& params)
+    : params_(params),
+      stop_(base::WaitableEvent::ResetPolicy::MANUAL,
+            base::WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+MediaHandlerStatsReporter::~MediaHandlerStatsReporter() {
+  if (thread_) {
+    stop_.Signal();
+    // ClosureThread joins on destruction.
+    thread_.reset();
+  }
+}
+
+void MediaHandlerStatsReporter::AddHandler(
+    const std::string& stream_label,
+    const std::string& handler_name,
+    std::shared_ptr<MediaHandler> handler) {
+  DCHECK(!thread_);
+  if (!handler)
+    return;
+  if (streams_.empty() || streams_.back().first != stream_label) {
+    auto stream = streams_.begin();
+    while (stream != streams_.end() && stream->first != stream_label)
+      ++stream;
+    if (stream == streams_.end()) {
+      streams_.emplace_back(stream_label, std::vector<NamedHandler>());
+    } else {
+      // Keep the handlers of a stream together.
+      auto named_handlers = std::move(stream->second);
+      streams_.erase(stream);
+      streams_.emplace_back(stream_label, std::move(named_handlers));
+    }
+  }
+  for (const NamedHandler& named_handler : streams_.back().second) {
+    if (named_handler.handler == handler)
+      return;
+  }
+  streams_.back().second.push_back({handler_name, std::move(handler)});
+}
+
+void MediaHandlerStatsReporter::AddOutput(
+    const std::string& input,
+    const std::string& stream_label,
+    const std::string& output_name,
+    std::shared_ptr<Muxer> muxer,
+    std::shared_ptr<const OutputStatsMuxerListener::Stats> output_stats) {
+  DCHECK(!thread_);
+  DCHECK(muxer);
+  DCHECK(output_stats);
+  outputs_.push_back({input, stream_label, output_name, std::move(muxer),
+                      std::move(output_stats)});
+}
+
+void MediaHandlerStatsReporter::Start() {
+  DCHECK(!thread_);
+  if (!params_.stats_callback)
+    return;
+  stop_.Reset();
+  thread_.reset(new ClosureThread(
+      "MediaHandlerStatsReporter",
+      base::Bind(&MediaHandlerStatsReporter::ThreadMain,
+                 base::Unretained(this))));
+  thread_->Start();
+}
+
+void MediaHandlerStatsReporter::Stop() {
+  if (thread_) {
+    stop_.Signal();
+    thread_.reset();
+  }
+  if (params_.stats_callback)
+    params_.stats_callback(GetStatsJson());
+}
+
+std::string MediaHandlerStatsReporter::GetStatsJson() const {
+  std::string json = "{\"streams\":[";
+  for (size_t i = 0; i < streams_.size(); ++i) {
+    if (i > 0)
+      json += ",";
+    json += "{\"stream\":" + ToJsonString(streams_[i].first) +
+            ",\"handlers\":[";
+    const std::vector<NamedHandler>& named_handlers = streams_[i].second;
+    for (size_t j = 0; j < named_handlers.size(); ++j) {
+      if (j > 0)
+        json += ",";
+      json += "{\"name\":" + ToJsonString(named_handlers[j].name) + "," +
+              ToJson(named_handlers[j].handler->GetStats()) + "}";
+    }
+    json += "]}";
+  }
+  json += "]}";
+  return json;
+}
+
+std::vector<StreamStats> MediaHandlerStatsReporter::GetStreamStats() const {
+  std::vector<StreamStats> stream_stats(outputs_.size());
+  for (size_t i = 0; i < outputs_.size(); ++i) {
+    const Output& output = outputs_[i];
+    StreamStats& stats = stream_stats[i];
+    stats.stream_label = output.stream_label;
+    stats.output = output.name;
+    stats.num_samples = output.muxer->num_samples();
+    stats.media_time_in_seconds = output.muxer->media_time_in_seconds();
+    stats.bytes_written = output.stats->bytes_written;
+    AppendQueueDepths(output.input, &stats.queue_depths);
+    AppendQueueDepths(output.stream_label, &stats.queue_depths);
+  }
+  return stream_stats;
+}
+
+void MediaHandlerStatsReporter::ThreadMain() {
+  const base::TimeDelta interval = base::TimeDelta::FromMicroseconds(
+      static_cast<int64_t>(params_.interval_in_seconds *
+                           base::Time::kMicrosecondsPerSecond));
+  while (!stop_.TimedWait(interval))
+    params_.stats_callback(GetStatsJson());
+}
+
+void MediaHandlerStatsReporter::AppendQueueDepths(
+    const std::string& stream_label,
+    std::vector<std::pair<std::string, size_t>>* queue_depths) const {
+  for (const auto& stream : streams_) {
+    if (stream.first != stream_label)
+      continue;
+    for (const NamedHandler& named_handler : stream.second) {
+      queue_depths->emplace_back(
+          named_handler.name, named_handler.handler->GetStats().queue_depth);
+    }
+    return;
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
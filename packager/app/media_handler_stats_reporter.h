@@ -0,0 +1,109 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_APP_MEDIA_HANDLER_STATS_REPORTER_H_
+#define PACKAGER_APP_MEDIA_HANDLER_STATS_REPORTER_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/media/event/output_stats_muxer_listener.h"
+#include "packager/media/public/handler_stats_params.h"
+
+namespace shaka {
+namespace media {
+
+class ClosureThread;
+class MediaHandler;
+class Muxer;
+
+/// Reports the processing statistics of the media handlers of the streams to
+/// HandlerStatsParams::stats_callback, if set, periodically while packaging
+/// and once at the end. Statistics collection must be enabled with
+/// MediaHandler::EnableStats() for the callback. The progress of the outputs
+/// and the queue depths are always available from GetStreamStats().
+class MediaHandlerStatsReporter {
+ public:
+  explicit MediaHandlerStatsReporter(const HandlerStatsParams& params);
+  ~MediaHandlerStatsReporter();
+
+  /// Adds a handler to the statistics of a stream. Must be called before
+  /// Start().
+  /// @param stream_label is the label of the stream.
+  /// @param handler_name is the name of the handler in the statistics.
+  /// @param handler is the handler. Ignored if null.
+  void AddHandler(const std::string& stream_label,
+                  const std::string& handler_name,
+                  std::shared_ptr<MediaHandler> handler);
+
+  /// Adds an output to the progress returned by GetStreamStats(). Must be
+  /// called before Start().
+  /// @param input is the input of the stream.
+  /// @param stream_label is the label of the stream.
+  /// @param output_name is the output file name or segment template.
+  /// @param muxer is the muxer of the output.
+  /// @param output_stats are the counters of the OutputStatsMuxerListener of
+  ///        @a muxer.
+  void AddOutput(
+      const std::string& input,
+      const std::string& stream_label,
+      const std::string& output_name,
+      std::shared_ptr<Muxer> muxer,
+      std::shared_ptr<const OutputStatsMuxerListener::Stats> output_stats);
+
+  /// Starts reporting periodically.
+  void Start();
+  /// Stops reporting periodically and reports one last time.
+  void Stop();
+
+  /// @return the statistics of the handlers of all the streams as JSON.
+  std::string GetStatsJson() const;
+
+  /// @return The progress of the outputs, in the order they were added, with
+  ///         the queue depths of the handlers of their input and stream. Can
+  ///         be called from any thread.
+  std::vector<StreamStats> GetStreamStats() const;
+
+ private:
+  MediaHandlerStatsReporter(const MediaHandlerStatsReporter&) = delete;
+  MediaHandlerStatsReporter& operator=(const MediaHandlerStatsReporter&) =
+      delete;
+
+  struct NamedHandler {
+    std::string name;
+    std::shared_ptr<MediaHandler> handler;
+  };
+
+  struct Output {
+    std::string input;
+    std::string stream_label;
+    std::string name;
+    std::shared_ptr<Muxer> muxer;
+    std::shared_ptr<const OutputStatsMuxerListener::Stats> stats;
+  };
+
+  void ThreadMain();
+  // Appends the queue depths of the handlers of |stream_label| to
+  // |queue_depths|.
+  void AppendQueueDepths(
+      const std::string& stream_label,
+      std::vector<std::pair<std::string, size_t>>* queue_depths) const;
+
+  const HandlerStatsParams params_;
+  // Stream label and handlers, in the order the streams were added.
+  std::vector<std::pair<std::string, std::vector<NamedHandler>>> streams_;
+  std::vector<Output> outputs_;
+  base::WaitableEvent stop_;
+  std::unique_ptr<ClosureThread> thread_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_MEDIA_HANDLER_STATS_REPORTER_H_
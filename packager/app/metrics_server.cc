@@ -0,0 +1,89 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/metrics_server.h"
+
+#include <inttypes.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/file/file_upload_queue.h"
+#include "packager/media/base/metrics.h"
+#include "packager/third_party/libevent/evhttp.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const char kMetricsPath[] = "/metrics";
+
+void AppendMetric(const char* name,
+                  const char* type,
+                  const char* help,
+                  uint64_t value,
+                  std::string* text) {
+  base::StringAppendF(text, "# HELP %s %s\n# TYPE %s %s\n%s %" PRIu64 "\n",
+                      name, help, name, type, name, value);
+}
+
+// The file layer does not depend on Metrics, so the upload queue statistics
+// are sampled when scraped.
+void AppendUploadQueueMetrics(std::string* text) {
+  const FileUploadQueue::Stats stats =
+      FileUploadQueue::GetInstance()->GetStats();
+  AppendMetric("packager_http_upload_queue_depth", "gauge",
+               "Number of files queued for upload.", stats.queue_depth, text);
+  AppendMetric("packager_http_upload_queued_bytes", "gauge",
+               "Size of the files queued for upload, in bytes.",
+               stats.queued_bytes, text);
+  AppendMetric("packager_http_upload_retries_total", "counter",
+               "Number of upload attempts retried.", stats.num_retries, text);
+  AppendMetric("packager_http_upload_failures_total", "counter",
+               "Number of files which failed to be uploaded.",
+               stats.num_failures, text);
+}
+}  // namespace
+
+MetricsServer::MetricsServer() : server_("MetricsServer") {}
+
+MetricsServer::~MetricsServer() {
+  Stop();
+}
+
+bool MetricsServer::Start(uint16_t port) {
+  if (!server_.Bind("0.0.0.0", port))
+    return false;
+  server_.SetHandler(kMetricsPath, &MetricsServer::HandleMetricsRequest,
+                     nullptr);
+
+  Metrics::GetInstance()->Enable();
+  server_.Start();
+  LOG(INFO) << "Serving metrics on port " << port << " at " << kMetricsPath;
+  return true;
+}
+
+void MetricsServer::Stop() {
+  server_.Close();
+}
+
+void MetricsServer::HandleMetricsRequest(evhttp_request* request, void* arg) {
+  std::string text = Metrics::GetInstance()->ToPrometheusText();
+  if (FileUploadQueue::IsEnabled())
+    AppendUploadQueueMetrics(&text);
+  evbuffer* buffer = evbuffer_new();
+  if (!buffer) {
+    evhttp_send_error(request, HTTP_SERVUNAVAIL, "Out of memory");
+    return;
+  }
+  evbuffer_add(buffer, text.data(), text.size());
+  evhttp_add_header(request->output_headers, "Content-Type",
+                    "text/plain; version=0.0.4");
+  evhttp_send_reply(request, HTTP_OK, "OK", buffer);
+  evbuffer_free(buffer);
+}
+
+}  // namespace media
+}  // namespace shaka
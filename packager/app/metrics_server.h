@@ -0,0 +1,47 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_APP_METRICS_SERVER_H_
+#define PACKAGER_APP_METRICS_SERVER_H_
+
+#include <stdint.h>
+
+#include "packager/app/embedded_http_server.h"
+
+struct evhttp_request;
+
+namespace shaka {
+namespace media {
+
+/// Embedded HTTP server exposing the packager metrics, see Metrics, in the
+/// Prometheus text exposition format at /metrics. It runs on its own thread
+/// so scraping does not interfere with packaging.
+class MetricsServer {
+ public:
+  MetricsServer();
+  /// Stops the server if it is running.
+  ~MetricsServer();
+
+  /// Enables the metrics and starts serving them on @a port, on all the
+  /// network interfaces.
+  /// @return true on success, false if the port cannot be bound.
+  bool Start(uint16_t port);
+  /// Stops serving the metrics.
+  void Stop();
+
+ private:
+  MetricsServer(const MetricsServer&) = delete;
+  MetricsServer& operator=(const MetricsServer&) = delete;
+
+  static void HandleMetricsRequest(evhttp_request* request, void* arg);
+
+  EmbeddedHttpServer server_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_METRICS_SERVER_H_
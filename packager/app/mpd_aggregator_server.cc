@@ -0,0 +1,63 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/mpd_aggregator_server.h"
+
+#include <string>
+
+#include "packager/base/logging.h"
+#include "packager/mpd/base/mpd_aggregator.h"
+#include "packager/third_party/libevent/evhttp.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const char kEventsPath[] = "/mpd_events";
+}  // namespace
+
+MpdAggregatorServer::MpdAggregatorServer(MpdAggregator* aggregator)
+    : aggregator_(aggregator), server_("MpdAggregatorServer") {}
+
+MpdAggregatorServer::~MpdAggregatorServer() {}
+
+bool MpdAggregatorServer::Start(const std::string& address, uint16_t port) {
+  if (!server_.Bind(address, port))
+    return false;
+  server_.SetHandler(kEventsPath, &MpdAggregatorServer::HandleEventsRequest,
+                     this);
+  LOG(INFO) << "Aggregating MPD notifications on " << address << ":" << port
+            << " at " << kEventsPath;
+  return true;
+}
+
+bool MpdAggregatorServer::Run() {
+  return server_.Run();
+}
+
+void MpdAggregatorServer::Stop() {
+  server_.Stop();
+}
+
+void MpdAggregatorServer::HandleEventsRequest(evhttp_request* request,
+                                              void* arg) {
+  MpdAggregatorServer* server = static_cast<MpdAggregatorServer*>(arg);
+  if (request->type != EVHTTP_REQ_POST) {
+    evhttp_send_error(request, HTTP_BADREQUEST, "POST expected");
+    return;
+  }
+  const std::string events(
+      reinterpret_cast<const char*>(EVBUFFER_DATA(request->input_buffer)),
+      EVBUFFER_LENGTH(request->input_buffer));
+  if (!server->aggregator_->HandleEvents(events)) {
+    evhttp_send_error(request, HTTP_BADREQUEST, "Invalid notifications");
+    return;
+  }
+  evhttp_send_reply(request, HTTP_OK, "OK", nullptr);
+}
+
+}  // namespace media
+}  // namespace shaka
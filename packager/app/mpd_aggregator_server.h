@@ -0,0 +1,57 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_APP_MPD_AGGREGATOR_SERVER_H_
+#define PACKAGER_APP_MPD_AGGREGATOR_SERVER_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "packager/app/embedded_http_server.h"
+
+struct evhttp_request;
+
+namespace shaka {
+
+class MpdAggregator;
+
+namespace media {
+
+/// Embedded HTTP server receiving the notifications of the packagers run with
+/// --mpd_aggregator_url, which are posted to /mpd_events, and passing them to
+/// an MpdAggregator. The server has no authentication, so it should only be
+/// reachable from the packagers.
+class MpdAggregatorServer {
+ public:
+  /// @param aggregator is not owned and must outlive the server.
+  explicit MpdAggregatorServer(MpdAggregator* aggregator);
+  ~MpdAggregatorServer();
+
+  /// Binds the server to @a port of @a address, e.g. 127.0.0.1, or 0.0.0.0
+  /// for all the network interfaces.
+  /// @return false if the port cannot be bound.
+  bool Start(const std::string& address, uint16_t port);
+  /// Serves the requests on the calling thread until Stop() is called.
+  /// @return false if the event loop fails.
+  bool Run();
+  /// Makes Run() return. Can be called from any thread.
+  void Stop();
+
+ private:
+  MpdAggregatorServer(const MpdAggregatorServer&) = delete;
+  MpdAggregatorServer& operator=(const MpdAggregatorServer&) = delete;
+
+  static void HandleEventsRequest(evhttp_request* request, void* arg);
+
+  MpdAggregator* const aggregator_;
+  EmbeddedHttpServer server_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_MPD_AGGREGATOR_SERVER_H_
@@ -0,0 +1,116 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/app/mpd_aggregator_server.h"
+#include "packager/base/bind.h"
+#include "packager/file/file_closer.h"
+#include "packager/file/http_file.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/mpd/base/mock_mpd_notifier.h"
+#include "packager/mpd/base/mpd_aggregator.h"
+#include "packager/mpd/base/mpd_options.h"
+#include "packager/mpd/base/remote_mpd_notifier.h"
+
+namespace shaka {
+namespace media {
+
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::Return;
+using ::testing::SetArgPointee;
+
+namespace {
+
+const char kAddress[] = "127.0.0.1";
+const uint16_t kPort = 18734;
+const char kEventsUrl[] = "http://127.0.0.1:18734/mpd_events";
+const uint32_t kTimeoutInSeconds = 10;
+const uint32_t kAggregatedContainerId = 5;
+
+}  // namespace
+
+class MpdAggregatorServerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(server_.Start(kAddress, kPort));
+    thread_.reset(new ClosureThread(
+        "MpdAggregatorServer",
+        base::Bind(&MpdAggregatorServerTest::RunServer,
+                   base::Unretained(this))));
+    thread_->Start();
+  }
+
+  void TearDown() override {
+    server_.Stop();
+    // ClosureThread joins on destruction.
+    thread_.reset();
+  }
+
+  void RunServer() { EXPECT_TRUE(server_.Run()); }
+
+  // Posts |body| to the server.
+  // @return true if the server accepted it.
+  bool Post(const std::string& body) {
+    std::unique_ptr<HttpFile, FileCloser> file(
+        new HttpFile(HttpMethod::kPost, kEventsUrl, "application/x-protobuf",
+                     std::vector<std::string>(), kTimeoutInSeconds));
+    if (!file->Open())
+      return false;
+    if (file->Write(body.data(), body.size()) !=
+        static_cast<int64_t>(body.size())) {
+      return false;
+    }
+    file->Flush();
+    char buffer[64];
+    while (file->Read(buffer, sizeof(buffer)) > 0) {
+    }
+    return file.release()->CloseWithStatus().ok();
+  }
+
+  MpdOptions mpd_options_;
+  MockMpdNotifier mock_notifier_{mpd_options_};
+  MpdAggregator aggregator_{&mock_notifier_};
+  MpdAggregatorServer server_{&aggregator_};
+  std::unique_ptr<ClosureThread> thread_;
+};
+
+TEST_F(MpdAggregatorServerTest, ReceivesNotifications) {
+  EXPECT_CALL(mock_notifier_, NotifyNewContainer(_, _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(kAggregatedContainerId), Return(true)));
+  EXPECT_CALL(mock_notifier_,
+              NotifyNewSegment(kAggregatedContainerId, 0, 100, 1000))
+      .WillOnce(Return(true));
+  EXPECT_CALL(mock_notifier_, Flush()).WillOnce(Return(true));
+
+  RemoteMpdNotifier remote_notifier(mpd_options_, kEventsUrl);
+  MediaInfo media_info;
+  media_info.set_segment_template("video_$Number$.m4s");
+  uint32_t container_id = 0;
+  ASSERT_TRUE(remote_notifier.NotifyNewContainer(media_info, &container_id));
+  ASSERT_TRUE(remote_notifier.NotifyNewSegment(container_id, 0, 100, 1000));
+  EXPECT_TRUE(remote_notifier.Flush());
+}
+
+TEST_F(MpdAggregatorServerTest, RejectsInvalidNotifications) {
+  EXPECT_CALL(mock_notifier_, Flush()).Times(0);
+  EXPECT_FALSE(Post("invalid"));
+}
+
+TEST_F(MpdAggregatorServerTest, PortInUse) {
+  MpdAggregatorServer other_server(&aggregator_);
+  EXPECT_FALSE(other_server.Start(kAddress, kPort));
+}
+
+}  // namespace media
+}  // namespace shaka
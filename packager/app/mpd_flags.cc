@@ -21,6 +21,14 @@ DEFINE_bool(output_media_info,
             "Create a human readable format of MediaInfo. The output file name "
             "will be the name specified by output flag, suffixed with "
             "'.media_info'.");
+DEFINE_bool(binary_media_info,
+            false,
+            "Write the MediaInfo files of --output_media_info as binary "
+            "serialized protobuf instead of text format, which is smaller and "
+            "faster to parse, e.g. by mpd_generator.");
+DEFINE_bool(compress_media_info,
+            false,
+            "Compress the MediaInfo files of --binary_media_info with gzip.");
 DEFINE_string(mpd_output, "", "MPD output file name.");
 DEFINE_string(base_urls,
               "",
@@ -59,6 +67,12 @@ DEFINE_bool(
     "completely."
     "Ignored if $Time$ is used in segment template, since $Time$ requires "
     "accurate Segment Timeline.");
+DEFINE_double(approximate_segment_timeline_tolerance,
+              0,
+              "Tolerance, in seconds, within which segment times are "
+              "considered equal with --allow_approximate_segment_timeline. "
+              "Defaults to one sample, capped at 50 milliseconds, if it is "
+              "not positive.");
 DEFINE_bool(allow_codec_switching,
             false,
             "If enabled, allow adaptive switching between different codecs, "
@@ -75,3 +89,39 @@ DEFINE_bool(dash_force_segment_list,
             "content is huge and the total number of (sub)segment references "
             "is greater than what the sidx atom allows (65535). Currently "
             "this flag is only supported in DASH ondemand profile.");
+DEFINE_string(mpd_patch_output,
+              "",
+              "MPD Patch output file name, for dynamic MPDs. If set, every "
+              "MPD update also writes a patch with the changes since the "
+              "previous MPD, e.g. the SegmentTimeline S elements added and "
+              "removed, and the MPD refers to it with a PatchLocation "
+              "element.");
+DEFINE_string(mpd_aggregator_url,
+              "",
+              "URL of an MPD aggregator, i.e. a packager run with "
+              "--mpd_aggregator_port, e.g. http://host:port/mpd_events. If "
+              "set, the notifications of the streams are sent to the "
+              "aggregator, which generates a single MPD for the streams of "
+              "all the packagers sending to it, instead of generating an MPD "
+              "here. Requires segment_template.");
+DEFINE_int32(mpd_aggregator_port,
+             0,
+             "If positive, runs as an MPD aggregator on this port instead of "
+             "packaging: the notifications of the packagers run with "
+             "--mpd_aggregator_url are received at /mpd_events, and the MPD "
+             "of all their streams is written to --mpd_output, with the "
+             "other MPD flags.");
+DEFINE_string(mpd_aggregator_address,
+              "127.0.0.1",
+              "The address the MPD aggregator is bound to. Set it to 0.0.0.0 "
+              "to accept the packagers on other hosts. The aggregator has no "
+              "authentication, so only do so on a trusted network.");
+DEFINE_bool(low_latency_dash_mode,
+            false,
+            "If enabled, every fragment, defined by --fragment_duration, is "
+            "flushed to the segment file as soon as it is available, so the "
+            "segments can be delivered with chunked transfer encoding, and "
+            "the dynamic MPD signals availabilityTimeOffset and "
+            "availabilityTimeComplete=\"false\". Only applies to fMP4 outputs "
+            "with segment_template. 'sidx' is not generated in the media "
+            "segments.");
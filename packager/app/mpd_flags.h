@@ -13,6 +13,8 @@
 
 DECLARE_bool(generate_static_live_mpd);
 DECLARE_bool(output_media_info);
+DECLARE_bool(binary_media_info);
+DECLARE_bool(compress_media_info);
 DECLARE_string(mpd_output);
 DECLARE_string(base_urls);
 DECLARE_double(minimum_update_period);
@@ -21,8 +23,14 @@ DECLARE_double(suggested_presentation_delay);
 DECLARE_string(utc_timings);
 DECLARE_bool(generate_dash_if_iop_compliant_mpd);
 DECLARE_bool(allow_approximate_segment_timeline);
+DECLARE_double(approximate_segment_timeline_tolerance);
 DECLARE_bool(allow_codec_switching);
 DECLARE_bool(include_mspr_pro_for_playready);
 DECLARE_bool(dash_force_segment_list);
+DECLARE_string(mpd_patch_output);
+DECLARE_string(mpd_aggregator_url);
+DECLARE_int32(mpd_aggregator_port);
+DECLARE_string(mpd_aggregator_address);
+DECLARE_bool(low_latency_dash_mode);
 
 #endif  // APP_MPD_FLAGS_H_
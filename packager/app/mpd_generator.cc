@@ -12,7 +12,11 @@
 #include "packager/base/command_line.h"
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/threading/simple_thread.h"
+#include "packager/file/file.h"
 #include "packager/mpd/util/mpd_writer.h"
 #include "packager/tools/license_notice.h"
 #include "packager/version/version.h"
@@ -41,16 +45,28 @@ const char kUsage[] =
     "audio, and 1 text.\n"
     "Sample Usage:\n"
     "%s --input=\"video1.media_info,video2.media_info,audio1.media_info\" "
-    "--output=\"video_audio.mpd\"";
+    "--output=\"video_audio.mpd\"\n"
+    "%s --batch_input=\"titles.txt\" --num_threads=8 "
+    "--skip_unchanged_inputs";
 
 enum ExitStatus {
   kSuccess = 0,
   kEmptyInputError,
   kEmptyOutputError,
-  kFailedToWriteMpdToFileError
+  kFailedToWriteMpdToFileError,
+  kFailedToReadBatchInputError
+};
+
+// The inputs and output of an MPD.
+struct MpdTask {
+  std::vector<std::string> input_files;
+  std::string output;
 };
 
 ExitStatus CheckRequiredFlags() {
+  if (!FLAGS_batch_input.empty())
+    return kSuccess;
+
   if (FLAGS_input.empty()) {
     LOG(ERROR) << "--input is required.";
     return kEmptyInputError;
@@ -64,34 +80,155 @@ ExitStatus CheckRequiredFlags() {
   return kSuccess;
 }
 
-ExitStatus RunMpdGenerator() {
-  DCHECK_EQ(CheckRequiredFlags(), kSuccess);
-  std::vector<std::string> base_urls;
-  typedef std::vector<std::string>::const_iterator Iterator;
+std::vector<std::string> GetBaseUrls() {
+  if (FLAGS_base_urls.empty())
+    return std::vector<std::string>();
+  return base::SplitString(FLAGS_base_urls, ",", base::KEEP_WHITESPACE,
+                           base::SPLIT_WANT_ALL);
+}
 
-  std::vector<std::string> input_files = base::SplitString(
-      FLAGS_input, ",", base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
+// Returns true if |task| output was modified after all its inputs, which must
+// all be local files.
+bool IsMpdUpToDate(const MpdTask& task) {
+  const int64_t output_time = File::GetLastModifiedTime(task.output.c_str());
+  if (output_time < 0)
+    return false;
+  for (const std::string& file : task.input_files) {
+    const int64_t input_time = File::GetLastModifiedTime(file.c_str());
+    if (input_time < 0 || input_time >= output_time)
+      return false;
+  }
+  return true;
+}
 
-  if (!FLAGS_base_urls.empty()) {
-    base_urls = base::SplitString(FLAGS_base_urls, ",", base::KEEP_WHITESPACE,
-                                  base::SPLIT_WANT_ALL);
+bool GenerateMpd(const MpdTask& task,
+                 const std::vector<std::string>& base_urls) {
+  if (FLAGS_skip_unchanged_inputs && IsMpdUpToDate(task)) {
+    VLOG(1) << "Skipping " << task.output << " as its inputs are unchanged.";
+    return true;
   }
 
   MpdWriter mpd_writer;
-  for (Iterator it = base_urls.begin(); it != base_urls.end(); ++it)
-    mpd_writer.AddBaseUrl(*it);
+  for (const std::string& base_url : base_urls)
+    mpd_writer.AddBaseUrl(base_url);
 
-  for (const std::string& file : input_files) {
+  for (const std::string& file : task.input_files) {
     if (!mpd_writer.AddFile(file)) {
       LOG(WARNING) << "MpdWriter failed to read " << file << ", skipping.";
     }
   }
 
-  if (!mpd_writer.WriteMpdToFile(FLAGS_output.c_str())) {
-    LOG(ERROR) << "Failed to write MPD to " << FLAGS_output;
+  if (!mpd_writer.WriteMpdToFile(task.output.c_str())) {
+    LOG(ERROR) << "Failed to write MPD to " << task.output;
+    return false;
+  }
+  return true;
+}
+
+// Generates the MPDs of a batch on a number of threads, each generating the
+// next MPD of the batch until there are none left.
+class BatchMpdGenerator : public base::DelegateSimpleThread::Delegate {
+ public:
+  BatchMpdGenerator(std::vector<MpdTask> tasks,
+                    std::vector<std::string> base_urls)
+      : tasks_(std::move(tasks)), base_urls_(std::move(base_urls)) {}
+
+  // @return the number of MPDs which failed to be generated.
+  size_t Generate(int num_threads) {
+    if (num_threads <= 1) {
+      Run();
+      return num_failures_;
+    }
+    std::vector<std::unique_ptr<base::DelegateSimpleThread>> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back(
+          new base::DelegateSimpleThread(this, "MpdGenerator"));
+      threads.back()->Start();
+    }
+    for (auto& thread : threads)
+      thread->Join();
+    return num_failures_;
+  }
+
+  // base::DelegateSimpleThread::Delegate implementation.
+  void Run() override {
+    while (true) {
+      size_t task_index = 0;
+      {
+        base::AutoLock auto_lock(lock_);
+        if (next_task_index_ >= tasks_.size())
+          return;
+        task_index = next_task_index_++;
+      }
+      if (!GenerateMpd(tasks_[task_index], base_urls_)) {
+        base::AutoLock auto_lock(lock_);
+        ++num_failures_;
+      }
+    }
+  }
+
+ private:
+  const std::vector<MpdTask> tasks_;
+  const std::vector<std::string> base_urls_;
+
+  base::Lock lock_;
+  size_t next_task_index_ = 0;  // GUARDED_BY(lock_)
+  size_t num_failures_ = 0;     // GUARDED_BY(lock_)
+};
+
+bool ReadBatchInput(const std::string& batch_input,
+                    std::vector<MpdTask>* tasks) {
+  std::string content;
+  if (!File::ReadFileToString(batch_input.c_str(), &content)) {
+    LOG(ERROR) << "Failed to read " << batch_input;
+    return false;
+  }
+  for (const std::string& line :
+       base::SplitString(content, "\n", base::TRIM_WHITESPACE,
+                         base::SPLIT_WANT_NONEMPTY)) {
+    if (line[0] == '#')
+      continue;
+    const std::vector<std::string> fields = base::SplitString(
+        line, base::kWhitespaceASCII, base::TRIM_WHITESPACE,
+        base::SPLIT_WANT_NONEMPTY);
+    if (fields.size() != 2) {
+      LOG(ERROR) << "Invalid line in " << batch_input << ": " << line;
+      return false;
+    }
+    MpdTask task;
+    task.output = fields[0];
+    task.input_files = base::SplitString(fields[1], ",", base::KEEP_WHITESPACE,
+                                         base::SPLIT_WANT_ALL);
+    tasks->push_back(std::move(task));
+  }
+  return true;
+}
+
+ExitStatus RunBatchMpdGenerator() {
+  std::vector<MpdTask> tasks;
+  if (!ReadBatchInput(FLAGS_batch_input, &tasks))
+    return kFailedToReadBatchInputError;
+
+  BatchMpdGenerator generator(std::move(tasks), GetBaseUrls());
+  const size_t num_failures = generator.Generate(FLAGS_num_threads);
+  if (num_failures > 0) {
+    LOG(ERROR) << "Failed to write " << num_failures << " MPDs.";
     return kFailedToWriteMpdToFileError;
   }
+  return kSuccess;
+}
 
+ExitStatus RunMpdGenerator() {
+  DCHECK_EQ(CheckRequiredFlags(), kSuccess);
+  if (!FLAGS_batch_input.empty())
+    return RunBatchMpdGenerator();
+
+  MpdTask task;
+  task.input_files = base::SplitString(FLAGS_input, ",", base::KEEP_WHITESPACE,
+                                       base::SPLIT_WANT_ALL);
+  task.output = FLAGS_output;
+  if (!GenerateMpd(task, GetBaseUrls()))
+    return kFailedToWriteMpdToFileError;
   return kSuccess;
 }
 
@@ -106,7 +243,7 @@ int MpdMain(int argc, char** argv) {
   CHECK(logging::InitLogging(log_settings));
 
   google::SetVersionString(GetPackagerVersion());
-  google::SetUsageMessage(base::StringPrintf(kUsage, argv[0]));
+  google::SetUsageMessage(base::StringPrintf(kUsage, argv[0], argv[0]));
   google::ParseCommandLineFlags(&argc, &argv, true);
   if (FLAGS_licenses) {
     for (const char* line : kLicenseNotice)
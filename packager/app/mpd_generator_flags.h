@@ -15,4 +15,19 @@ DEFINE_string(base_urls,
               "",
               "Comma separated BaseURLs for the MPD. The values will be added "
               "as <BaseURL> element(s) immediately under the <MPD> element.");
+DEFINE_string(batch_input,
+              "",
+              "File listing the MPDs to generate in a single run, instead of "
+              "--input and --output. Each line has the MPD output file name "
+              "and the comma separated list of its MediaInfo input files, "
+              "separated by whitespace. Empty lines and lines starting with "
+              "'#' are ignored.");
+DEFINE_int32(num_threads,
+             1,
+             "Number of MPDs generated in parallel with --batch_input.");
+DEFINE_bool(skip_unchanged_inputs,
+            false,
+            "Skip generating the MPDs which were modified after all their "
+            "MediaInfo input files. Only local files can be checked, so the "
+            "MPDs with other inputs or output are always generated.");
 #endif  // APP_MPD_GENERATOR_FLAGS_H_
@@ -23,20 +23,21 @@ namespace media {
 MuxerFactory::MuxerFactory(const PackagingParams& packaging_params)
     : mp4_params_(packaging_params.mp4_output_params),
       temp_dir_(packaging_params.temp_dir),
+      segment_duration_in_seconds_(
+          packaging_params.chunking_params.segment_duration_in_seconds),
       transport_stream_timestamp_offset_ms_(
-          packaging_params.transport_stream_timestamp_offset_ms) {}
+          packaging_params.transport_stream_timestamp_offset_ms),
+      write_partial_segments_(
+          packaging_params.hls_params.low_latency_mode &&
+          !packaging_params.hls_params.master_playlist_output.empty()),
+      write_chunked_segments_(
+          packaging_params.mpd_params.low_latency_dash_mode &&
+          !packaging_params.mpd_params.mpd_output.empty()) {}
 
 std::shared_ptr<Muxer> MuxerFactory::CreateMuxer(
     MediaContainerName output_format,
     const StreamDescriptor& stream) {
-  MuxerOptions options;
-  options.mp4_params = mp4_params_;
-  options.transport_stream_timestamp_offset_ms =
-      transport_stream_timestamp_offset_ms_;
-  options.temp_dir = temp_dir_;
-  options.output_file_name = stream.output;
-  options.segment_template = stream.segment_template;
-  options.bandwidth = stream.bandwidth;
+  const MuxerOptions options = CreateMuxerOptions(stream);
 
   std::shared_ptr<Muxer> muxer;
 
@@ -80,6 +81,25 @@ std::shared_ptr<Muxer> MuxerFactory::CreateMuxer(
   return muxer;
 }
 
+MuxerOptions MuxerFactory::CreateMuxerOptions(
+    const StreamDescriptor& stream) const {
+  MuxerOptions options;
+  options.mp4_params = mp4_params_;
+  options.transport_stream_timestamp_offset_ms =
+      transport_stream_timestamp_offset_ms_;
+  options.temp_dir = temp_dir_;
+  options.output_file_name = stream.output;
+  options.segment_template = stream.segment_template;
+  options.bandwidth = stream.bandwidth;
+  options.segment_duration_in_seconds = segment_duration_in_seconds_;
+  options.write_partial_segments = write_partial_segments_ && !stream.dash_only;
+  options.write_chunked_segments = write_chunked_segments_ && !stream.hls_only;
+  options.segment_checkpoint = segment_checkpoint_;
+  options.segment_digests = segment_digests_;
+  options.segment_digest_file = segment_digest_file_;
+  return options;
+}
+
 void MuxerFactory::OverrideClock(base::Clock* clock) {
   clock_ = clock;
 }
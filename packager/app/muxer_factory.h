@@ -25,6 +25,8 @@ namespace media {
 
 class Muxer;
 class MuxerListener;
+class SegmentCheckpoint;
+struct MuxerOptions;
 
 /// To make it easier to create muxers, this factory allows for all
 /// configuration to be set at the factory level so that when a function
@@ -38,6 +40,9 @@ class MuxerFactory {
   std::shared_ptr<Muxer> CreateMuxer(MediaContainerName output_format,
                                      const StreamDescriptor& stream);
 
+  /// @return the options of the muxers created for the given stream.
+  MuxerOptions CreateMuxerOptions(const StreamDescriptor& stream) const;
+
   /// For testing, if you need to replace the clock that muxers work with
   /// this will replace the clock for all muxers created after this call.
   void OverrideClock(base::Clock* clock);
@@ -46,14 +51,35 @@ class MuxerFactory {
     transport_stream_timestamp_offset_ms_ = offset_ms;
   }
 
+  /// Sets the checkpoint of the segments written, which the muxers created
+  /// after this call do not write again. It is not owned.
+  void SetSegmentCheckpoint(SegmentCheckpoint* segment_checkpoint) {
+    segment_checkpoint_ = segment_checkpoint;
+  }
+
+  /// Sets the digests computed for the media segments of the muxers created
+  /// after this call, and the file they are recorded in, if not NULL. It is
+  /// not owned.
+  void SetSegmentDigests(const std::vector<DigestAlgorithm>& segment_digests,
+                         SegmentDigestFile* segment_digest_file) {
+    segment_digests_ = segment_digests;
+    segment_digest_file_ = segment_digest_file;
+  }
+
  private:
   MuxerFactory(const MuxerFactory&) = delete;
   MuxerFactory& operator=(const MuxerFactory&) = delete;
 
   const Mp4OutputParams mp4_params_;
   const std::string temp_dir_;
+  const double segment_duration_in_seconds_;
   uint32_t transport_stream_timestamp_offset_ms_ = 0;
+  const bool write_partial_segments_;
+  const bool write_chunked_segments_;
   base::Clock* clock_ = nullptr;
+  SegmentCheckpoint* segment_checkpoint_ = nullptr;
+  std::vector<DigestAlgorithm> segment_digests_;
+  SegmentDigestFile* segment_digest_file_ = nullptr;
 };
 
 }  // namespace media
@@ -25,6 +25,14 @@ DEFINE_double(segment_duration,
 DEFINE_bool(segment_sap_aligned,
             true,
             "Force segments to begin with stream access points.");
+DEFINE_double(max_empty_text_segment_duration,
+              0,
+              "Maximum duration in seconds of the text segments covering "
+              "periods with no cues. If positive, consecutive empty text "
+              "segments are coalesced into segments of up to this duration, "
+              "in multiples of segment_duration. Note that HLS uses the "
+              "longest segment of a playlist as its target duration. "
+              "Default 0, i.e. no coalescing.");
 DEFINE_double(fragment_duration,
               0,
               "Fragment duration in seconds. Should not be larger than "
@@ -46,6 +54,44 @@ DEFINE_string(temp_dir,
 DEFINE_bool(mp4_include_pssh_in_stream,
             true,
             "MP4 only: include pssh in the encrypted stream.");
+DEFINE_uint64(mp4_vod_header_reserved_size,
+              0,
+              "MP4 only: space, in bytes, to reserve at the beginning of "
+              "single segment outputs for 'ftyp', 'moov' and 'sidx' boxes. "
+              "If positive, media is written directly to the output instead of "
+              "a temporary file. A 'sidx' needs 12 bytes per subsegment. Falls "
+              "back to the temporary file if the boxes do not fit.");
+DEFINE_uint64(mp4_sidx_max_references,
+              0,
+              "MP4 only: if positive, the 'sidx' of single segment outputs "
+              "with more subsegments than this is split into a top-level "
+              "'sidx' referencing subsidiary 'sidx' boxes of at most this many "
+              "references each. Requires players supporting hierarchical "
+              "'sidx'.");
+DEFINE_bool(mp4_write_init_segment_early,
+            false,
+            "MP4 only: write the init segment of segment template outputs "
+            "when the stream is known instead of after the first sample. The "
+            "EditList is derived from --mp4_expected_edit_list_offset.");
+DEFINE_double(mp4_expected_edit_list_offset,
+              0,
+              "MP4 only: with --mp4_write_init_segment_early, the expected "
+              "offset, in seconds, between the presentation and decoding "
+              "timestamps of the first sample, or the audio priming "
+              "duration.");
+DEFINE_bool(mp4_progressive,
+            false,
+            "MP4 only: write progressive (non-fragmented) files, with 'moov' "
+            "before 'mdat', for progressive download clients. Only applies "
+            "to single segment outputs without encryption. Media is written "
+            "in a single pass if --mp4_vod_header_reserved_size is large "
+            "enough for 'moov'.");
+DEFINE_bool(mp4_fragment_passthrough,
+            false,
+            "MP4 only: copy the fragments of single track fragmented MP4 "
+            "inputs to segment template outputs without demuxing them. "
+            "Streams that need encryption or re-segmentation are demuxed as "
+            "before.");
 DEFINE_int32(transport_stream_timestamp_offset_ms,
              100,
              "A positive value, in milliseconds, by which output timestamps "
@@ -53,3 +99,9 @@ DEFINE_int32(transport_stream_timestamp_offset_ms,
              "input. For example, timestamps from ISO-BMFF after adjusted by "
              "EditList could be negative. In transport streams, timestamps are "
              "not allowed to be less than zero.");
+DEFINE_bool(ts_passthrough,
+            false,
+            "Copy the TS packets of the streams of MPEG2-TS inputs to "
+            "MPEG2-TS segment template outputs without reassembling their "
+            "PES packets. Streams that need encryption or sample processing, "
+            "or which do not carry the PCR, are demuxed as before.");
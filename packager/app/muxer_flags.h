@@ -14,11 +14,19 @@
 DECLARE_double(clear_lead);
 DECLARE_double(segment_duration);
 DECLARE_bool(segment_sap_aligned);
+DECLARE_double(max_empty_text_segment_duration);
 DECLARE_double(fragment_duration);
 DECLARE_bool(fragment_sap_aligned);
 DECLARE_bool(generate_sidx_in_media_segments);
 DECLARE_string(temp_dir);
 DECLARE_bool(mp4_include_pssh_in_stream);
+DECLARE_uint64(mp4_vod_header_reserved_size);
+DECLARE_uint64(mp4_sidx_max_references);
+DECLARE_bool(mp4_write_init_segment_early);
+DECLARE_double(mp4_expected_edit_list_offset);
+DECLARE_bool(mp4_progressive);
+DECLARE_bool(mp4_fragment_passthrough);
 DECLARE_int32(transport_stream_timestamp_offset_ms);
+DECLARE_bool(ts_passthrough);
 
 #endif  // APP_MUXER_FLAGS_H_
@@ -11,12 +11,15 @@
 #include "packager/app/crypto_flags.h"
 #include "packager/app/hls_flags.h"
 #include "packager/app/manifest_flags.h"
+#include "packager/app/metrics_server.h"
+#include "packager/app/mpd_aggregator_server.h"
 #include "packager/app/mpd_flags.h"
 #include "packager/app/muxer_flags.h"
 #include "packager/app/packager_util.h"
 #include "packager/app/playready_key_encryption_flags.h"
 #include "packager/app/protection_system_flags.h"
 #include "packager/app/raw_key_encryption_flags.h"
+#include "packager/app/segment_server.h"
 #include "packager/app/stream_descriptor.h"
 #include "packager/app/vlog_flags.h"
 #include "packager/app/widevine_encryption_flags.h"
@@ -27,7 +30,10 @@
 #include "packager/base/strings/string_split.h"
 #include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/base/time/time.h"
 #include "packager/file/file.h"
+#include "packager/mpd/base/mpd_aggregator.h"
+#include "packager/mpd/base/simple_mpd_notifier.h"
 #include "packager/packager.h"
 #include "packager/tools/license_notice.h"
 
@@ -45,12 +51,106 @@ DEFINE_bool(use_fake_clock_for_muxer,
             "Set to true to use a fake clock for muxer. With this flag set, "
             "creation time and modification time in outputs are set to 0. "
             "Should only be used for testing.");
+DEFINE_bool(print_startup_timing,
+            false,
+            "Print the time spent in each startup stage, from the start of "
+            "main() until packaging starts, to stderr.");
 DEFINE_string(test_packager_version,
               "",
               "Packager version for testing. Should be used for testing only.");
 DEFINE_bool(single_threaded,
             false,
             "If enabled, only use one thread when generating content.");
+DEFINE_bool(interleave_jobs,
+            false,
+            "With --single_threaded, run the jobs in turns, one buffer of "
+            "input at a time, skipping the jobs waiting for input, instead of "
+            "one after the other, so that live inputs can share the thread. "
+            "Ignored if ad cues are aligned across streams.");
+DEFINE_int32(num_worker_threads,
+             0,
+             "If positive, run the packaging jobs on a fixed pool of worker "
+             "threads of this size instead of one thread per input. Ignored "
+             "with UDP inputs or live playlists, as a live job never "
+             "completes and does not release its worker thread.");
+DEFINE_bool(process_streams_in_parallel,
+            false,
+            "If enabled, process each stream of an input on its own thread, "
+            "so the chunking, encryption and muxing of the streams of a "
+            "single input run concurrently with the demuxing. A stream is "
+            "still packaged in a single pass, so inputs with a single "
+            "stream are not sped up. Ignored if --single_threaded is set.");
+DEFINE_bool(mux_outputs_in_parallel,
+            false,
+            "If enabled, mux and write each output on its own thread, so a "
+            "slow output does not stall the demuxing and the other outputs "
+            "as long as its bounded queue is not full. The finalization and "
+            "writing of a segment then overlap with the demuxing and "
+            "chunking of the next one. Ignored if --single_threaded is set.");
+DEFINE_uint64(max_queued_sample_bytes,
+              256 << 20,
+              "Budget, in bytes, of the samples queued for the streams of an "
+              "input until the stream info of all of them is known. Demuxing "
+              "fails once it is exceeded, e.g. if a stream of the input never "
+              "gets its codec configuration.");
+DEFINE_uint64(memory_budget_bytes,
+              0,
+              "Budget, in bytes, of the memory held by the IO caches, the "
+              "queued and fragmented samples and the store:// files of the "
+              "process. While it is exceeded, input reads are delayed so the "
+              "outputs catch up. The memory use per subsystem is logged at the "
+              "end. 0 means no budget.");
+DEFINE_int32(metrics_port,
+             0,
+             "If positive, serve operational metrics, e.g. segments and bytes "
+             "written per stream and segment, key fetch and manifest write "
+             "latencies, in the Prometheus text format at "
+             "http://<host>:<metrics_port>/metrics while packaging.");
+DEFINE_int32(segment_server_port,
+             0,
+             "If positive, serve the outputs written to store://<name>, e.g. "
+             "live segments and manifests, from memory at "
+             "http://<host>:<segment_server_port>/<name>. Segments being "
+             "written are sent with chunked transfer encoding.");
+DEFINE_string(checkpoint_file,
+              "",
+              "If set, checkpoint the state of the live manifests, e.g. the "
+              "segments in the live window and the sequence numbers, to this "
+              "local file as they are updated.");
+DEFINE_double(checkpoint_interval,
+              0,
+              "Minimum interval, in seconds, between the writes of "
+              "--checkpoint_file. 0 means the checkpoint is written on every "
+              "manifest update.");
+DEFINE_string(segment_checkpoint_file,
+              "",
+              "If set, record the media segment files written by the MP4 and "
+              "MPEG2-TS outputs with a segment template to this local file, so "
+              "that an interrupted job, e.g. a long VOD job, does not write "
+              "them again when it is resumed.");
+DEFINE_bool(resume_from_checkpoint,
+            false,
+            "Resume from --checkpoint_file and --segment_checkpoint_file if "
+            "they exist, so that a restarted packager continues the live "
+            "manifests instead of starting them over, and does not write "
+            "again the segments already written.");
+DEFINE_string(segment_digests,
+              "",
+              "Comma separated list of the digests, md5 and sha256, computed "
+              "for each media segment file as it is written, e.g. for the "
+              "integrity checks of a CDN, instead of reading the files again. "
+              "Only applies to the outputs with a segment template.");
+DEFINE_string(segment_digest_file,
+              "",
+              "If set, record the --segment_digests of the media segment "
+              "files to this file, '<algorithm>:<hex digest>... <file name>' "
+              "per line.");
+DEFINE_string(trace_output,
+              "",
+              "If set, write trace events of the packaging pipeline, e.g. "
+              "demuxing, encryption, segment finalization, file writes and "
+              "manifest flushes per thread, to this file in the Chrome trace "
+              "JSON format, which can be loaded in Perfetto.");
 
 namespace shaka {
 namespace {
@@ -315,18 +415,44 @@ base::Optional<PackagingParams> GetPackagingParams() {
 
   packaging_params.temp_dir = FLAGS_temp_dir;
   packaging_params.single_threaded = FLAGS_single_threaded;
+  packaging_params.interleave_jobs = FLAGS_interleave_jobs;
+  packaging_params.num_worker_threads = FLAGS_num_worker_threads;
+  packaging_params.trace_output = FLAGS_trace_output;
+  packaging_params.process_streams_in_parallel =
+      FLAGS_process_streams_in_parallel;
+  packaging_params.mux_outputs_in_parallel = FLAGS_mux_outputs_in_parallel;
+  packaging_params.max_queued_sample_bytes = FLAGS_max_queued_sample_bytes;
+  packaging_params.memory_budget_bytes = FLAGS_memory_budget_bytes;
+  packaging_params.checkpoint_file = FLAGS_checkpoint_file;
+  packaging_params.checkpoint_interval = FLAGS_checkpoint_interval;
+  packaging_params.segment_checkpoint_file = FLAGS_segment_checkpoint_file;
+  packaging_params.resume_from_checkpoint = FLAGS_resume_from_checkpoint;
+  packaging_params.segment_digests = FLAGS_segment_digests;
+  packaging_params.segment_digest_file = FLAGS_segment_digest_file;
 
   AdCueGeneratorParams& ad_cue_generator_params =
       packaging_params.ad_cue_generator_params;
   if (!ParseAdCues(FLAGS_ad_cues, &ad_cue_generator_params.cue_points)) {
     return base::nullopt;
   }
+  if (FLAGS_cue_alignment_horizon < 0) {
+    LOG(ERROR) << "--cue_alignment_horizon should not be negative.";
+    return base::nullopt;
+  }
+  ad_cue_generator_params.cue_alignment_horizon_in_seconds =
+      FLAGS_cue_alignment_horizon;
 
   ChunkingParams& chunking_params = packaging_params.chunking_params;
   chunking_params.segment_duration_in_seconds = FLAGS_segment_duration;
   chunking_params.subsegment_duration_in_seconds = FLAGS_fragment_duration;
   chunking_params.segment_sap_aligned = FLAGS_segment_sap_aligned;
   chunking_params.subsegment_sap_aligned = FLAGS_fragment_sap_aligned;
+  if (FLAGS_max_empty_text_segment_duration < 0) {
+    LOG(ERROR) << "--max_empty_text_segment_duration should not be negative.";
+    return base::nullopt;
+  }
+  chunking_params.max_empty_text_segment_duration_in_seconds =
+      FLAGS_max_empty_text_segment_duration;
 
   int num_key_providers = 0;
   EncryptionParams& encryption_params = packaging_params.encryption_params;
@@ -364,11 +490,15 @@ base::Optional<PackagingParams> GetPackagingParams() {
     encryption_params.crypto_period_duration_in_seconds =
         FLAGS_crypto_period_duration;
     encryption_params.vp9_subsample_encryption = FLAGS_vp9_subsample_encryption;
+    encryption_params.num_encryption_threads = FLAGS_num_encryption_threads;
     encryption_params.stream_label_func = std::bind(
         &Packager::DefaultStreamLabelFunction, FLAGS_max_sd_pixels,
         FLAGS_max_hd_pixels, FLAGS_max_uhd1_pixels, std::placeholders::_1);
     encryption_params.playready_extra_header_data =
         FLAGS_playready_extra_header_data;
+    encryption_params.key_cache_dir = FLAGS_key_cache_dir;
+    encryption_params.key_cache_key = FLAGS_key_cache_key_bytes;
+    encryption_params.key_cache_validity_in_seconds = FLAGS_key_cache_validity;
   }
   switch (encryption_params.key_provider) {
     case KeyProvider::kWidevine: {
@@ -379,6 +509,8 @@ base::Optional<PackagingParams> GetPackagingParams() {
       widevine.policy = FLAGS_policy;
       widevine.group_id = FLAGS_group_id_bytes;
       widevine.enable_entitlement_license = FLAGS_enable_entitlement_license;
+      widevine.key_prefetch_crypto_periods = FLAGS_key_prefetch_crypto_periods;
+      widevine.max_concurrent_key_requests = FLAGS_max_concurrent_key_requests;
       if (!GetWidevineSigner(&widevine.signer))
         return base::nullopt;
       break;
@@ -435,11 +567,21 @@ base::Optional<PackagingParams> GetPackagingParams() {
   mp4_params.generate_sidx_in_media_segments =
       FLAGS_generate_sidx_in_media_segments;
   mp4_params.include_pssh_in_stream = FLAGS_mp4_include_pssh_in_stream;
+  mp4_params.vod_header_reserved_size = FLAGS_mp4_vod_header_reserved_size;
+  mp4_params.max_sidx_references =
+      static_cast<uint32_t>(FLAGS_mp4_sidx_max_references);
+  mp4_params.write_init_segment_early = FLAGS_mp4_write_init_segment_early;
+  mp4_params.expected_edit_list_offset = FLAGS_mp4_expected_edit_list_offset;
+  mp4_params.progressive = FLAGS_mp4_progressive;
+  mp4_params.fragment_passthrough = FLAGS_mp4_fragment_passthrough;
 
   packaging_params.transport_stream_timestamp_offset_ms =
       FLAGS_transport_stream_timestamp_offset_ms;
+  packaging_params.ts_passthrough = FLAGS_ts_passthrough;
 
   packaging_params.output_media_info = FLAGS_output_media_info;
+  packaging_params.binary_media_info = FLAGS_binary_media_info;
+  packaging_params.compress_media_info = FLAGS_compress_media_info;
 
   MpdParams& mpd_params = packaging_params.mpd_params;
   mpd_params.mpd_output = FLAGS_mpd_output;
@@ -472,8 +614,16 @@ base::Optional<PackagingParams> GetPackagingParams() {
       FLAGS_generate_dash_if_iop_compliant_mpd;
   mpd_params.allow_approximate_segment_timeline =
       FLAGS_allow_approximate_segment_timeline;
+  mpd_params.approximate_segment_timeline_tolerance =
+      FLAGS_approximate_segment_timeline_tolerance;
   mpd_params.allow_codec_switching = FLAGS_allow_codec_switching;
   mpd_params.include_mspr_pro = FLAGS_include_mspr_pro_for_playready;
+  mpd_params.mpd_patch_output = FLAGS_mpd_patch_output;
+  mpd_params.low_latency_dash_mode = FLAGS_low_latency_dash_mode;
+  mpd_params.manifest_write_coalescing_window =
+      FLAGS_manifest_write_coalescing_window;
+  mpd_params.async_manifest_writes = FLAGS_async_manifest_writes;
+  mpd_params.mpd_aggregator_url = FLAGS_mpd_aggregator_url;
 
   HlsParams& hls_params = packaging_params.hls_params;
   if (!GetHlsPlaylistType(FLAGS_hls_playlist_type, &hls_params.playlist_type)) {
@@ -488,6 +638,12 @@ base::Optional<PackagingParams> GetPackagingParams() {
   hls_params.default_language = FLAGS_default_language;
   hls_params.default_text_language = FLAGS_default_text_language;
   hls_params.media_sequence_number = FLAGS_hls_media_sequence_number;
+  hls_params.low_latency_mode = FLAGS_hls_low_latency_mode;
+  hls_params.delta_update_skip_until = FLAGS_hls_delta_update_skip_until;
+  hls_params.gap_timeout = FLAGS_hls_gap_timeout;
+  hls_params.manifest_write_coalescing_window =
+      FLAGS_manifest_write_coalescing_window;
+  hls_params.async_manifest_writes = FLAGS_async_manifest_writes;
 
   TestParams& test_params = packaging_params.test_params;
   test_params.dump_stream_info = FLAGS_dump_stream_info;
@@ -498,7 +654,54 @@ base::Optional<PackagingParams> GetPackagingParams() {
   return packaging_params;
 }
 
+// Records the duration of the startup stages for --print_startup_timing.
+class StartupTimer {
+ public:
+  StartupTimer() : start_time_(base::TimeTicks::Now()) {}
+
+  // Ends the current stage, which started when the previous one ended.
+  void EndStage(const char* stage) {
+    const base::TimeTicks now = base::TimeTicks::Now();
+    base::StringAppendF(&timing_, "%s %.2fms, ", stage,
+                        (now - stage_start_time_).InMillisecondsF());
+    stage_start_time_ = now;
+  }
+
+  void Print() const {
+    fprintf(stderr, "Startup timing: %stotal %.2fms.\n", timing_.c_str(),
+            (stage_start_time_ - start_time_).InMillisecondsF());
+  }
+
+ private:
+  const base::TimeTicks start_time_;
+  base::TimeTicks stage_start_time_ = start_time_;
+  std::string timing_;
+};
+
+// Generates the MPD of the packagers run with --mpd_aggregator_url. Only
+// returns on failure.
+int RunMpdAggregator(const MpdParams& mpd_params) {
+  if (mpd_params.mpd_output.empty()) {
+    LOG(ERROR) << "--mpd_output is required with --mpd_aggregator_port.";
+    return kArgumentValidationFailed;
+  }
+  // The packagers sending to the aggregator use the live profile.
+  SimpleMpdNotifier mpd_notifier(media::GetMpdOptions(false, mpd_params));
+  if (!mpd_notifier.Init())
+    return kArgumentValidationFailed;
+  MpdAggregator aggregator(&mpd_notifier);
+  media::MpdAggregatorServer server(&aggregator);
+  if (!server.Start(FLAGS_mpd_aggregator_address,
+                    static_cast<uint16_t>(FLAGS_mpd_aggregator_port))) {
+    return kArgumentValidationFailed;
+  }
+  server.Run();
+  return kPackagingFailed;
+}
+
 int PackagerMain(int argc, char** argv) {
+  StartupTimer startup_timer;
+
   // Needed to enable VLOG/DVLOG through --vmodule or --v.
   base::CommandLine::Init(argc, argv);
 
@@ -510,11 +713,18 @@ int PackagerMain(int argc, char** argv) {
   google::SetVersionString(shaka::Packager::GetLibraryVersion());
   google::SetUsageMessage(base::StringPrintf(kUsage, argv[0]));
   google::ParseCommandLineFlags(&argc, &argv, true);
+  startup_timer.EndStage("flags");
   if (FLAGS_licenses) {
     for (const char* line : kLicenseNotice)
       std::cout << line << std::endl;
     return kSuccess;
   }
+  if (FLAGS_mpd_aggregator_port > 0) {
+    base::Optional<PackagingParams> packaging_params = GetPackagingParams();
+    if (!packaging_params)
+      return kArgumentValidationFailed;
+    return RunMpdAggregator(packaging_params->mpd_params);
+  }
   if (argc < 2) {
     google::ShowUsageWithFlags("Usage");
     return kSuccess;
@@ -539,6 +749,19 @@ int PackagerMain(int argc, char** argv) {
       return kArgumentValidationFailed;
     stream_descriptors.push_back(stream_descriptor.value());
   }
+  startup_timer.EndStage("params");
+  media::MetricsServer metrics_server;
+  if (FLAGS_metrics_port > 0 &&
+      !metrics_server.Start(static_cast<uint16_t>(FLAGS_metrics_port))) {
+    return kArgumentValidationFailed;
+  }
+  media::SegmentServer segment_server;
+  if (FLAGS_segment_server_port > 0 &&
+      !segment_server.Start(static_cast<uint16_t>(FLAGS_segment_server_port))) {
+    return kArgumentValidationFailed;
+  }
+  startup_timer.EndStage("servers");
+
   Packager packager;
   Status status =
       packager.Initialize(packaging_params.value(), stream_descriptors);
@@ -546,6 +769,9 @@ int PackagerMain(int argc, char** argv) {
     LOG(ERROR) << "Failed to initialize packager: " << status.ToString();
     return kArgumentValidationFailed;
   }
+  startup_timer.EndStage("initialize");
+  if (FLAGS_print_startup_timing)
+    startup_timer.Print();
   status = packager.Run();
   if (!status.ok()) {
     LOG(ERROR) << "Packaging Error: " << status.ToString();
@@ -10,6 +10,7 @@
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_split.h"
 #include "packager/file/file.h"
+#include "packager/media/base/key_cache.h"
 #include "packager/media/base/media_handler.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/playready_key_source.h"
@@ -42,6 +43,22 @@ std::unique_ptr<RequestSigner> CreateSigner(const WidevineSigner& signer) {
   return request_signer;
 }
 
+// Returns true with a null |key_cache| if there is no key cache.
+bool CreateKeyCache(const EncryptionParams& encryption_params,
+                    std::unique_ptr<KeyCache>* key_cache) {
+  if (encryption_params.key_cache_dir.empty())
+    return true;
+  *key_cache = KeyCache::Create(encryption_params.key_cache_dir,
+                                encryption_params.key_cache_key,
+                                encryption_params.key_cache_validity_in_seconds);
+  if (!*key_cache) {
+    LOG(ERROR) << "Failed to create the key cache in "
+               << encryption_params.key_cache_dir;
+    return false;
+  }
+  return true;
+}
+
 }  // namespace
 
 std::unique_ptr<KeySource> CreateEncryptionKeySource(
@@ -73,6 +90,15 @@ std::unique_ptr<KeySource> CreateEncryptionKeySource(
       widevine_key_source->set_group_id(widevine.group_id);
       widevine_key_source->set_enable_entitlement_license(
           widevine.enable_entitlement_license);
+      widevine_key_source->set_key_prefetch_crypto_periods(
+          widevine.key_prefetch_crypto_periods);
+      widevine_key_source->set_max_concurrent_key_requests(
+          widevine.max_concurrent_key_requests);
+      std::unique_ptr<KeyCache> key_cache;
+      if (!CreateKeyCache(encryption_params, &key_cache))
+        return nullptr;
+      if (key_cache)
+        widevine_key_source->set_key_cache(std::move(key_cache));
 
       Status status =
           widevine_key_source->FetchKeys(widevine.content_id, widevine.policy);
@@ -102,6 +128,11 @@ std::unique_ptr<KeySource> CreateEncryptionKeySource(
         // private_key_password is allowed to be empty for unencrypted key.
         playready_key_source.reset(new PlayReadyKeySource(
             playready.key_server_url, encryption_params.protection_systems));
+        std::unique_ptr<KeyCache> key_cache;
+        if (!CreateKeyCache(encryption_params, &key_cache))
+          return nullptr;
+        if (key_cache)
+          playready_key_source->set_key_cache(std::move(key_cache));
         Status status = playready_key_source->FetchKeysWithProgramIdentifier(
             playready.program_identifier);
         if (!status.ok()) {
@@ -0,0 +1,176 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/segment_server.h"
+
+#include <stdlib.h>
+
+#include <limits>
+#include <string>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/file/segment_store.h"
+#include "packager/third_party/libevent/evhttp.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+// Interval at which the data written to the objects being streamed is sent.
+const int64_t kPollIntervalInMicroseconds = 20 * 1000;
+// Maximum size of a chunk sent to a streaming response.
+const size_t kMaxChunkSize = 1 << 20;
+
+struct ContentType {
+  const char* extension;
+  const char* type;
+};
+
+const ContentType kContentTypes[] = {
+    {".mpd", "application/dash+xml"},
+    {".m3u8", "application/vnd.apple.mpegurl"},
+    {".mp4", "video/mp4"},
+    {".m4s", "video/mp4"},
+    {".ts", "video/mp2t"},
+    {".aac", "audio/aac"},
+    {".vtt", "text/vtt"},
+    {".ttml", "application/ttml+xml"},
+    {".webm", "video/webm"},
+};
+
+const char* GetContentType(const std::string& name) {
+  for (const ContentType& content_type : kContentTypes) {
+    if (base::EndsWith(name, content_type.extension,
+                       base::CompareCase::INSENSITIVE_ASCII)) {
+      return content_type.type;
+    }
+  }
+  return "application/octet-stream";
+}
+
+// Returns the object name of the path of |uri|, i.e. without the leading '/'
+// and the query.
+std::string GetObjectName(const char* uri) {
+  std::string path(uri);
+  const size_t query = path.find('?');
+  if (query != std::string::npos)
+    path.resize(query);
+  char* decoded_path = evhttp_decode_uri(path.c_str());
+  if (decoded_path) {
+    path = decoded_path;
+    free(decoded_path);
+  }
+  return path.empty() || path[0] != '/' ? path : path.substr(1);
+}
+
+}  // namespace
+
+SegmentServer::SegmentServer() : server_("SegmentServer") {}
+
+SegmentServer::~SegmentServer() {
+  Stop();
+}
+
+bool SegmentServer::Start(uint16_t port) {
+  if (!server_.Bind("0.0.0.0", port))
+    return false;
+  server_.SetDefaultHandler(&SegmentServer::HandleRequest, this);
+  server_.SetPollCallback(kPollIntervalInMicroseconds,
+                          [this]() { SendStreamingData(); });
+  server_.Start();
+  LOG(INFO) << "Serving " << kSegmentStoreFilePrefix << " outputs on port "
+            << port;
+  return true;
+}
+
+void SegmentServer::Stop() {
+  // Closing the server closes the connections, and so the streaming
+  // responses.
+  server_.Close();
+  streaming_responses_.clear();
+}
+
+void SegmentServer::HandleRequest(evhttp_request* request, void* arg) {
+  SegmentServer* server = static_cast<SegmentServer*>(arg);
+  if (request->type != EVHTTP_REQ_GET && request->type != EVHTTP_REQ_HEAD) {
+    evhttp_send_error(request, 405, "Method Not Allowed");
+    return;
+  }
+  const std::string name = GetObjectName(evhttp_request_uri(request));
+  std::shared_ptr<const SegmentStoreObject> object =
+      SegmentStore::GetInstance()->Get(name);
+  if (!object) {
+    evhttp_send_error(request, HTTP_NOTFOUND, "Not Found");
+    return;
+  }
+
+  evbuffer* buffer = evbuffer_new();
+  if (!buffer) {
+    evhttp_send_error(request, HTTP_SERVUNAVAIL, "Out of memory");
+    return;
+  }
+  evhttp_add_header(request->output_headers, "Content-Type",
+                    GetContentType(name));
+  evhttp_add_header(request->output_headers, "Access-Control-Allow-Origin",
+                    "*");
+
+  // The size is not known before reading, as the object may be written
+  // concurrently.
+  std::string data;
+  if (object->Read(0, std::numeric_limits<size_t>::max(), &data)) {
+    evbuffer_add(buffer, data.data(), data.size());
+    evhttp_send_reply(request, HTTP_OK, "OK", buffer);
+  } else {
+    // The object is still being written. Its data is sent as it comes.
+    evhttp_send_reply_start(request, HTTP_OK, "OK");
+    if (!data.empty()) {
+      evbuffer_add(buffer, data.data(), data.size());
+      evhttp_send_reply_chunk(request, buffer);
+    }
+    evhttp_connection_set_closecb(request->evcon,
+                                  &SegmentServer::HandleConnectionClose,
+                                  server);
+    server->streaming_responses_.push_back({request, object, data.size()});
+  }
+  evbuffer_free(buffer);
+}
+
+void SegmentServer::HandleConnectionClose(evhttp_connection* connection,
+                                          void* arg) {
+  // The requests of the connection are freed after this returns.
+  SegmentServer* server = static_cast<SegmentServer*>(arg);
+  server->streaming_responses_.remove_if(
+      [connection](const StreamingResponse& response) {
+        return response.request->evcon == connection;
+      });
+}
+
+void SegmentServer::SendStreamingData() {
+  auto iter = streaming_responses_.begin();
+  while (iter != streaming_responses_.end()) {
+    std::string data;
+    const bool finished =
+        iter->object->Read(iter->offset, kMaxChunkSize, &data);
+    evhttp_request* request = iter->request;
+    evbuffer* buffer = data.empty() ? nullptr : evbuffer_new();
+    if (buffer) {
+      evbuffer_add(buffer, data.data(), data.size());
+      evhttp_send_reply_chunk(request, buffer);
+      evbuffer_free(buffer);
+      iter->offset += data.size();
+    }
+    if (finished) {
+      iter = streaming_responses_.erase(iter);
+      evhttp_send_reply_end(request);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,69 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_APP_SEGMENT_SERVER_H_
+#define PACKAGER_APP_SEGMENT_SERVER_H_
+
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+
+#include "packager/app/embedded_http_server.h"
+
+struct evhttp_connection;
+struct evhttp_request;
+
+namespace shaka {
+
+class SegmentStoreObject;
+
+namespace media {
+
+/// Embedded HTTP origin serving the segments and manifests of SegmentStore,
+/// i.e. the outputs written to store://<name>, at http://<host>:<port>/<name>.
+/// Objects still being written, e.g. low latency segments, are sent with
+/// chunked transfer encoding as their data is produced. It runs on its own
+/// thread so serving does not interfere with packaging.
+class SegmentServer {
+ public:
+  SegmentServer();
+  /// Stops the server if it is running.
+  ~SegmentServer();
+
+  /// Starts serving on @a port, on all the network interfaces.
+  /// @return true on success, false if the port cannot be bound.
+  bool Start(uint16_t port);
+  /// Stops serving.
+  void Stop();
+
+ private:
+  SegmentServer(const SegmentServer&) = delete;
+  SegmentServer& operator=(const SegmentServer&) = delete;
+
+  // A response to an object still being written.
+  struct StreamingResponse {
+    evhttp_request* request;
+    std::shared_ptr<const SegmentStoreObject> object;
+    uint64_t offset;
+  };
+
+  static void HandleRequest(evhttp_request* request, void* arg);
+  static void HandleConnectionClose(evhttp_connection* connection, void* arg);
+
+  // Sends the data written since the last call to the streaming responses,
+  // and ends those whose object is finished.
+  void SendStreamingData();
+
+  EmbeddedHttpServer server_;
+  // Only accessed on the server thread.
+  std::list<StreamingResponse> streaming_responses_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_SEGMENT_SERVER_H_
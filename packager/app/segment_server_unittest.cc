@@ -0,0 +1,100 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "packager/app/segment_server.h"
+#include "packager/file/file_closer.h"
+#include "packager/file/http_file.h"
+#include "packager/file/segment_store.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+const uint16_t kPort = 18735;
+const char kServerUrl[] = "http://127.0.0.1:18735/";
+
+}  // namespace
+
+class SegmentServerTest : public ::testing::Test {
+ protected:
+  void SetUp() override { ASSERT_TRUE(server_.Start(kPort)); }
+
+  void TearDown() override {
+    server_.Stop();
+    SegmentStore::GetInstance()->DeleteAll();
+  }
+
+  // Opens a request for the object named |name|.
+  std::unique_ptr<HttpFile, FileCloser> OpenRequest(const std::string& name) {
+    std::unique_ptr<HttpFile, FileCloser> file(
+        new HttpFile(HttpMethod::kGet, kServerUrl + name));
+    if (!file->Open())
+      file.reset();
+    return file;
+  }
+
+  // Reads |file| to the end of the response, appending to |contents|.
+  // @return true if the request succeeded.
+  bool ReadResponse(std::unique_ptr<HttpFile, FileCloser> file,
+                    std::string* contents) {
+    char buffer[64];
+    int64_t bytes_read;
+    while ((bytes_read = file->Read(buffer, sizeof(buffer))) > 0)
+      contents->append(buffer, static_cast<size_t>(bytes_read));
+    return file.release()->CloseWithStatus().ok() && bytes_read == 0;
+  }
+
+  SegmentServer server_;
+};
+
+TEST_F(SegmentServerTest, ServesFinishedObject) {
+  ASSERT_TRUE(File::WriteFileAtomically("store://live/manifest.mpd", "mpd"));
+  std::unique_ptr<HttpFile, FileCloser> request =
+      OpenRequest("live/manifest.mpd");
+  ASSERT_TRUE(request);
+  std::string contents;
+  ASSERT_TRUE(ReadResponse(std::move(request), &contents));
+  EXPECT_EQ("mpd", contents);
+}
+
+TEST_F(SegmentServerTest, ServesObjectWhileWritten) {
+  std::unique_ptr<File, FileCloser> writer(
+      File::Open("store://live/segment1.m4s", "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(4, writer->Write("moof", 4));
+
+  std::unique_ptr<HttpFile, FileCloser> request =
+      OpenRequest("live/segment1.m4s");
+  ASSERT_TRUE(request);
+  char buffer[4];
+  ASSERT_EQ(4, request->Read(buffer, sizeof(buffer)));
+  std::string contents(buffer, sizeof(buffer));
+  EXPECT_EQ("moof", contents);
+
+  // The data written, and finished, after the request started is sent too.
+  ASSERT_EQ(4, writer->Write("mdat", 4));
+  ASSERT_TRUE(writer.release()->Close());
+  ASSERT_TRUE(ReadResponse(std::move(request), &contents));
+  EXPECT_EQ("moofmdat", contents);
+}
+
+TEST_F(SegmentServerTest, ObjectNotFound) {
+  std::unique_ptr<HttpFile, FileCloser> request =
+      OpenRequest("live/missing.m4s");
+  ASSERT_TRUE(request);
+  std::string contents;
+  EXPECT_FALSE(ReadResponse(std::move(request), &contents));
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -6,6 +6,7 @@
 
 #include "packager/app/single_thread_job_manager.h"
 
+#include "packager/app/interleaved_jobs.h"
 #include "packager/media/chunking/sync_point_queue.h"
 #include "packager/media/origin/origin_handler.h"
 
@@ -13,8 +14,9 @@ namespace shaka {
 namespace media {
 
 SingleThreadJobManager::SingleThreadJobManager(
-    std::unique_ptr<SyncPointQueue> sync_points)
-    : JobManager(std::move(sync_points)) {}
+    std::unique_ptr<SyncPointQueue> sync_points,
+    bool interleave_jobs)
+    : JobManager(std::move(sync_points)), interleave_jobs_(interleave_jobs) {}
 
 Status SingleThreadJobManager::InitializeJobs() {
   Status status;
@@ -24,11 +26,43 @@ Status SingleThreadJobManager::InitializeJobs() {
 }
 
 Status SingleThreadJobManager::RunJobs() {
+  if (interleave_jobs_)
+    return RunJobsInterleaved();
   Status status;
   for (const JobEntry& job_entry : job_entries_)
     status.Update(job_entry.worker->Run());
   return status;
 }
 
+void SingleThreadJobManager::CancelJobs() {
+  if (sync_points())
+    sync_points()->Cancel();
+  for (const JobEntry& job_entry : job_entries_)
+    job_entry.worker->Cancel();
+}
+
+Status SingleThreadJobManager::RunJobsInterleaved() {
+  InterleavedJobs jobs;
+  for (const JobEntry& job_entry : job_entries_)
+    jobs.AddJob(job_entry.worker);
+  // The jobs are already initialized by InitializeJobs().
+  Status status = jobs.Initialize();
+  if (!status.ok())
+    return status;
+  return jobs.Run();
+}
+
+Status SingleThreadJobManager::AddInitializedJobs(uint32_t group_id,
+                                                 JobManager* jobs) {
+  return Status(error::UNIMPLEMENTED,
+                "Adding jobs while running is not supported with "
+                "a single thread.");
+}
+
+Status SingleThreadJobManager::StopJobs(uint32_t group_id) {
+  return Status(error::UNIMPLEMENTED,
+                "Stopping jobs is not supported with a single thread.");
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -20,10 +20,27 @@ class SingleThreadJobManager : public JobManager {
   // @param sync_points is an optional SyncPointQueue used to synchronize and
   //        align cue points. JobManager cancels @a sync_points when any job
   //        fails or is cancelled. It can be NULL.
-  explicit SingleThreadJobManager(std::unique_ptr<SyncPointQueue> sync_points);
+  // @param interleave_jobs runs the jobs a step at a time in turns, skipping
+  //        the jobs waiting for input, instead of one after the other, e.g.
+  //        so that live jobs can share the thread. The jobs must not depend
+  //        on each other to make progress, e.g. through cue alignment.
+  SingleThreadJobManager(std::unique_ptr<SyncPointQueue> sync_points,
+                         bool interleave_jobs);
 
   Status InitializeJobs() override;
   Status RunJobs() override;
+  void CancelJobs() override;
+  // Not supported: the jobs cannot be added or stopped while running.
+  Status AddInitializedJobs(uint32_t group_id, JobManager* jobs) override;
+  Status StopJobs(uint32_t group_id) override;
+
+ private:
+  SingleThreadJobManager(const SingleThreadJobManager&) = delete;
+  SingleThreadJobManager& operator=(const SingleThreadJobManager&) = delete;
+
+  Status RunJobsInterleaved();
+
+  const bool interleave_jobs_;
 };
 
 }  // namespace media
@@ -0,0 +1,96 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "packager/app/fake_origin_handler.h"
+#include "packager/app/single_thread_job_manager.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const int kNumSteps = 2;
+const bool kInterleaveJobs = true;
+
+}  // namespace
+
+class SingleThreadJobManagerTest : public ::testing::Test {
+ protected:
+  std::shared_ptr<FakeOriginHandler> AddJob(JobManager* job_manager,
+                                            int num_steps) {
+    auto job = std::make_shared<FakeOriginHandler>(num_steps);
+    job->set_steps_log(&steps_log_, &steps_log_lock_);
+    job_manager->Add("Job", job);
+    return job;
+  }
+
+  std::vector<const FakeOriginHandler*> steps_log_;
+  base::Lock steps_log_lock_;
+};
+
+TEST_F(SingleThreadJobManagerTest, RunsJobsOneAfterAnother) {
+  SingleThreadJobManager job_manager(nullptr, !kInterleaveJobs);
+  std::shared_ptr<FakeOriginHandler> job1 = AddJob(&job_manager, kNumSteps);
+  std::shared_ptr<FakeOriginHandler> job2 = AddJob(&job_manager, kNumSteps);
+  ASSERT_OK(job_manager.InitializeJobs());
+  ASSERT_OK(job_manager.RunJobs());
+
+  const std::vector<const FakeOriginHandler*> expected_steps = {
+      job1.get(), job1.get(), job2.get(), job2.get()};
+  EXPECT_EQ(expected_steps, steps_log_);
+}
+
+TEST_F(SingleThreadJobManagerTest, RunsJobsInterleaved) {
+  SingleThreadJobManager job_manager(nullptr, kInterleaveJobs);
+  std::shared_ptr<FakeOriginHandler> job1 = AddJob(&job_manager, kNumSteps);
+  std::shared_ptr<FakeOriginHandler> job2 = AddJob(&job_manager, kNumSteps);
+  ASSERT_OK(job_manager.InitializeJobs());
+  ASSERT_OK(job_manager.RunJobs());
+
+  const std::vector<const FakeOriginHandler*> expected_steps = {
+      job1.get(), job2.get(), job1.get(), job2.get()};
+  EXPECT_EQ(expected_steps, steps_log_);
+  EXPECT_EQ(job1->thread_id(), job2->thread_id());
+}
+
+TEST_F(SingleThreadJobManagerTest, InterleavedJobFailure) {
+  SingleThreadJobManager job_manager(nullptr, kInterleaveJobs);
+  std::shared_ptr<FakeOriginHandler> failing_job = AddJob(&job_manager, 1);
+  failing_job->set_final_status(Status(error::PARSER_FAILURE, "Failed."));
+  std::shared_ptr<FakeOriginHandler> job = AddJob(&job_manager, kNumSteps);
+  job->SetReady(false);
+  ASSERT_OK(job_manager.InitializeJobs());
+
+  EXPECT_EQ(error::PARSER_FAILURE, job_manager.RunJobs().error_code());
+  EXPECT_TRUE(job->cancelled());
+  EXPECT_EQ(0, job->steps_run());
+}
+
+TEST_F(SingleThreadJobManagerTest, CancelInterleavedJobs) {
+  SingleThreadJobManager job_manager(nullptr, kInterleaveJobs);
+  std::shared_ptr<FakeOriginHandler> job = AddJob(&job_manager, kNumSteps);
+  job->SetReady(false);
+  ASSERT_OK(job_manager.InitializeJobs());
+
+  job_manager.CancelJobs();
+  EXPECT_EQ(error::CANCELLED, job_manager.RunJobs().error_code());
+  EXPECT_EQ(0, job->steps_run());
+}
+
+TEST_F(SingleThreadJobManagerTest, AddInitializedJobsIsNotSupported) {
+  SingleThreadJobManager job_manager(nullptr, kInterleaveJobs);
+  JobManager other_jobs(nullptr);
+  EXPECT_EQ(error::UNIMPLEMENTED,
+            job_manager.AddInitializedJobs(0, &other_jobs).error_code());
+}
+
+}  // namespace media
+}  // namespace shaka
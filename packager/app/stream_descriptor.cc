@@ -36,6 +36,9 @@ enum FieldType {
   kDashRolesField,
   kDashOnlyField,
   kHlsOnlyField,
+  kStartTimeField,
+  kEndTimeField,
+  kNextInputsField,
 };
 
 struct FieldNameToTypeMapping {
@@ -83,6 +86,12 @@ const FieldNameToTypeMapping kFieldNameTypeMappings[] = {
     {"role", kDashRolesField},
     {"dash_only", kDashOnlyField},
     {"hls_only", kHlsOnlyField},
+    {"start_time", kStartTimeField},
+    {"start", kStartTimeField},
+    {"end_time", kEndTimeField},
+    {"end", kEndTimeField},
+    {"next_inputs", kNextInputsField},
+    {"then", kNextInputsField},
 };
 
 FieldType GetFieldType(const std::string& field_name) {
@@ -247,12 +256,40 @@ base::Optional<StreamDescriptor> ParseStreamDescriptor(
         }
         descriptor.hls_only = hls_only_value > 0;
         break;
+      case kStartTimeField:
+        if (!base::StringToDouble(iter->second,
+                                  &descriptor.start_time_in_seconds) ||
+            descriptor.start_time_in_seconds < 0) {
+          LOG(ERROR) << "Invalid start_time (" << iter->second
+                     << "), should be a non-negative number of seconds.";
+          return base::nullopt;
+        }
+        break;
+      case kEndTimeField:
+        if (!base::StringToDouble(iter->second,
+                                  &descriptor.end_time_in_seconds) ||
+            descriptor.end_time_in_seconds <= 0) {
+          LOG(ERROR) << "Invalid end_time (" << iter->second
+                     << "), should be a positive number of seconds.";
+          return base::nullopt;
+        }
+        break;
+      case kNextInputsField:
+        descriptor.next_inputs =
+            base::SplitString(iter->second, ";", base::TRIM_WHITESPACE,
+                              base::SPLIT_WANT_NONEMPTY);
+        break;
       default:
         LOG(ERROR) << "Unknown field in stream descriptor (\"" << iter->first
                    << "\").";
         return base::nullopt;
     }
   }
+  if (descriptor.end_time_in_seconds > 0 &&
+      descriptor.end_time_in_seconds <= descriptor.start_time_in_seconds) {
+    LOG(ERROR) << "Stream end_time should be after start_time.";
+    return base::nullopt;
+  }
   return descriptor;
 }
 
@@ -1539,6 +1539,57 @@ class PackagerFunctionalTest(PackagerAppTest):
     self._CheckTestResults(
         'encryption-and-output-media-info-and-mpd-from-media-info-segmentlist')
 
+  def testMpdGeneratorBatchInput(self):
+    self.assertPackageSuccess(
+        self._GetStreams(['video']), self._GetFlags(output_media_info=True))
+    self.assertMpdGeneratorSuccess()
+    media_infos = glob.glob(os.path.join(self.tmp_dir, '*.media_info'))
+
+    outputs = [
+        os.path.join(self.tmp_dir, 'batch%d.mpd' % i) for i in range(3)
+    ]
+    batch_input = os.path.join(self.tmp_dir, 'batch.txt')
+    with open(batch_input, 'w') as f:
+      f.write('# Comments and empty lines are ignored.\n\n')
+      for output in outputs:
+        f.write('%s %s\n' % (output, ','.join(media_infos)))
+
+    flags = ['--batch_input', batch_input, '--num_threads', '2']
+    flags += ['--test_packager_version', '<tag>-<hash>-<test>']
+    self.assertEqual(self.packager.MpdGenerator(flags), 0)
+    for output in outputs:
+      self.assertTrue(filecmp.cmp(self.mpd_output, output, shallow=False))
+
+  def testMpdGeneratorInvalidBatchInput(self):
+    batch_input = os.path.join(self.tmp_dir, 'batch.txt')
+    with open(batch_input, 'w') as f:
+      f.write('output.mpd\n')
+    self.assertNotEqual(
+        self.packager.MpdGenerator(['--batch_input', batch_input]), 0)
+
+  def testMpdGeneratorSkipUnchangedInputs(self):
+    self.assertPackageSuccess(
+        self._GetStreams(['video']), self._GetFlags(output_media_info=True))
+    media_infos = glob.glob(os.path.join(self.tmp_dir, '*.media_info'))
+    self.assertTrue(media_infos)
+    inputs_time = max(os.path.getmtime(f) for f in media_infos)
+
+    # An output modified after all its inputs is not generated again.
+    with open(self.mpd_output, 'w') as f:
+      f.write('up to date')
+    os.utime(self.mpd_output, (inputs_time + 10, inputs_time + 10))
+    flags = ['--input', ','.join(media_infos), '--output', self.mpd_output]
+    flags += ['--skip_unchanged_inputs']
+    self.assertEqual(self.packager.MpdGenerator(flags), 0)
+    with open(self.mpd_output, 'r') as f:
+      self.assertEqual(f.read(), 'up to date')
+
+    # It is generated again once an input is modified after it.
+    os.utime(media_infos[0], (inputs_time + 20, inputs_time + 20))
+    self.assertEqual(self.packager.MpdGenerator(flags), 0)
+    with open(self.mpd_output, 'r') as f:
+      self.assertIn('<MPD', f.read())
+
   def testHlsSingleSegmentMp4Encrypted(self):
     self.assertPackageSuccess(
         self._GetStreams(['audio', 'video'], hls=True),
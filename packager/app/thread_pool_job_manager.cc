@@ -0,0 +1,109 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/thread_pool_job_manager.h"
+
+#include <algorithm>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/file/thread_class.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/media/chunking/sync_point_queue.h"
+#include "packager/media/origin/origin_handler.h"
+
+namespace shaka {
+namespace media {
+
+ThreadPoolJobManager::ThreadPoolJobManager(
+    std::unique_ptr<SyncPointQueue> sync_points,
+    size_t num_worker_threads)
+    : JobManager(std::move(sync_points)),
+      num_worker_threads_(num_worker_threads) {
+  DCHECK_GT(num_worker_threads_, 0u);
+}
+
+Status ThreadPoolJobManager::InitializeJobs() {
+  Status status;
+  for (const JobEntry& job_entry : job_entries_)
+    status.Update(job_entry.worker->Initialize());
+  return status;
+}
+
+Status ThreadPoolJobManager::RunJobs() {
+  const size_t num_threads =
+      std::min(num_worker_threads_, job_entries_.size());
+  VLOG(1) << "Running " << job_entries_.size() << " jobs on " << num_threads
+          << " worker threads.";
+
+  std::vector<std::unique_ptr<ClosureThread>> threads;
+  for (size_t i = 0; i < num_threads; ++i) {
+    threads.emplace_back(new ClosureThread(
+        "WorkerThread", base::Bind(&ThreadPoolJobManager::WorkerThreadMain,
+                                   base::Unretained(this))));
+    threads.back()->Start();
+  }
+  for (auto& thread : threads)
+    thread->Join();
+
+  if (sync_points_)
+    sync_points_->Cancel();
+
+  base::AutoLock auto_lock(lock_);
+  return status_;
+}
+
+void ThreadPoolJobManager::CancelJobs() {
+  {
+    base::AutoLock auto_lock(lock_);
+    cancelled_ = true;
+  }
+  if (sync_points_)
+    sync_points_->Cancel();
+  for (const JobEntry& job_entry : job_entries_)
+    job_entry.worker->Cancel();
+}
+
+void ThreadPoolJobManager::WorkerThreadMain() {
+  SetCurrentThreadClass(ThreadClass::kMedia);
+  while (true) {
+    std::shared_ptr<OriginHandler> worker;
+    {
+      base::AutoLock auto_lock(lock_);
+      if (cancelled_ || !status_.ok() ||
+          next_job_index_ >= job_entries_.size()) {
+        return;
+      }
+      worker = job_entries_[next_job_index_++].worker;
+    }
+
+    const Status status = worker->Run();
+    if (!status.ok()) {
+      {
+        base::AutoLock auto_lock(lock_);
+        status_.Update(status);
+      }
+      // Stop the jobs that are still running, similar to JobManager.
+      CancelJobs();
+    }
+  }
+}
+
+Status ThreadPoolJobManager::AddInitializedJobs(uint32_t group_id,
+                                               JobManager* jobs) {
+  return Status(error::UNIMPLEMENTED,
+                "Adding jobs while running is not supported with "
+                "a pool of worker threads.");
+}
+
+Status ThreadPoolJobManager::StopJobs(uint32_t group_id) {
+  return Status(
+      error::UNIMPLEMENTED,
+      "Stopping jobs is not supported with a pool of worker threads.");
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,62 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_APP_THREAD_POOL_JOB_MANAGER_H_
+#define PACKAGER_APP_THREAD_POOL_JOB_MANAGER_H_
+
+#include <memory>
+
+#include "packager/app/job_manager.h"
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+namespace media {
+
+// A subclass of JobManager that runs the jobs on a fixed number of worker
+// threads instead of one thread per job. Each worker thread picks up the next
+// pending job as soon as it finishes its current one.
+//
+// Note that a job occupies its worker thread until it completes, so the jobs
+// must not depend on each other to make progress, e.g. through cue alignment
+// with a SyncPointQueue, unless there are at least as many worker threads as
+// jobs. It is mostly useful for VOD packaging of many renditions.
+class ThreadPoolJobManager : public JobManager {
+ public:
+  // @param sync_points is an optional SyncPointQueue used to synchronize and
+  //        align cue points. JobManager cancels @a sync_points when any job
+  //        fails or is cancelled. It can be NULL.
+  // @param num_worker_threads is the number of worker threads. Should be
+  //        positive.
+  ThreadPoolJobManager(std::unique_ptr<SyncPointQueue> sync_points,
+                       size_t num_worker_threads);
+
+  Status InitializeJobs() override;
+  Status RunJobs() override;
+  void CancelJobs() override;
+  // Not supported: the jobs cannot be added or stopped while running.
+  Status AddInitializedJobs(uint32_t group_id, JobManager* jobs) override;
+  Status StopJobs(uint32_t group_id) override;
+
+ private:
+  ThreadPoolJobManager(const ThreadPoolJobManager&) = delete;
+  ThreadPoolJobManager& operator=(const ThreadPoolJobManager&) = delete;
+
+  // Runs pending jobs until there are no more jobs or any job fails.
+  void WorkerThreadMain();
+
+  const size_t num_worker_threads_;
+
+  base::Lock lock_;
+  // Index of the next job in |job_entries_| to run.
+  size_t next_job_index_ = 0;  // GUARDED_BY(lock_)
+  bool cancelled_ = false;     // GUARDED_BY(lock_)
+  Status status_;              // GUARDED_BY(lock_)
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_THREAD_POOL_JOB_MANAGER_H_
@@ -0,0 +1,72 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/trace_writer.h"
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/trace_event/trace_log.h"
+#include "packager/file/file.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const char kTraceCategories[] = "shaka";
+}  // namespace
+
+TraceWriter::TraceWriter(const std::string& output) : output_(output) {}
+
+TraceWriter::~TraceWriter() {
+  if (started_)
+    base::trace_event::TraceLog::GetInstance()->SetDisabled();
+}
+
+void TraceWriter::Start() {
+  DCHECK(!started_);
+  base::trace_event::TraceLog::GetInstance()->SetEnabled(
+      base::trace_event::TraceConfig(
+          kTraceCategories, base::trace_event::RECORD_AS_MUCH_AS_POSSIBLE),
+      base::trace_event::TraceLog::RECORDING_MODE);
+  started_ = true;
+}
+
+Status TraceWriter::Stop() {
+  if (!started_)
+    return Status::OK;
+  started_ = false;
+
+  base::trace_event::TraceLog* trace_log =
+      base::trace_event::TraceLog::GetInstance();
+  trace_log->SetDisabled();
+  // The packager threads have no message loops, so the events are flushed
+  // synchronously on this thread.
+  trace_json_ = "{\"traceEvents\":[";
+  trace_log->Flush(base::Bind(&TraceWriter::OnTraceDataCollected,
+                              base::Unretained(this)));
+  trace_json_ += "]}\n";
+
+  if (!File::WriteFileAtomically(output_.c_str(), trace_json_)) {
+    return Status(error::FILE_FAILURE,
+                  "Failed to write trace events to " + output_);
+  }
+  trace_json_.clear();
+  return Status::OK;
+}
+
+void TraceWriter::OnTraceDataCollected(
+    const scoped_refptr<base::RefCountedString>& events,
+    bool has_more_events) {
+  // Each call passes a comma separated list of events.
+  if (events->data().empty())
+    return;
+  if (trace_json_.back() != '[')
+    trace_json_ += ",";
+  trace_json_ += events->data();
+}
+
+}  // namespace media
+}  // namespace shaka
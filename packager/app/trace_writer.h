@@ -0,0 +1,47 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_APP_TRACE_WRITER_H_
+#define PACKAGER_APP_TRACE_WRITER_H_
+
+#include <string>
+
+#include "packager/base/memory/ref_counted_memory.h"
+#include "packager/status.h"
+
+namespace shaka {
+namespace media {
+
+/// Records the trace events of the packager, i.e. TRACE_EVENT* of the
+/// "shaka" category, and writes them in the Chrome trace JSON format, which
+/// can be loaded in chrome://tracing or Perfetto.
+class TraceWriter {
+ public:
+  /// @param output is the file to write the trace events to.
+  explicit TraceWriter(const std::string& output);
+  ~TraceWriter();
+
+  /// Starts recording trace events.
+  void Start();
+  /// Stops recording trace events and writes them to the output.
+  Status Stop();
+
+ private:
+  TraceWriter(const TraceWriter&) = delete;
+  TraceWriter& operator=(const TraceWriter&) = delete;
+
+  void OnTraceDataCollected(const scoped_refptr<base::RefCountedString>& events,
+                            bool has_more_events);
+
+  const std::string output_;
+  bool started_ = false;
+  std::string trace_json_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_APP_TRACE_WRITER_H_
@@ -58,6 +58,17 @@ DEFINE_int32(crypto_period_duration,
              0,
              "Crypto period duration in seconds. If it is non-zero, key "
              "rotation is enabled.");
+DEFINE_int32(key_prefetch_crypto_periods,
+             40,
+             "With key rotation, the number of crypto periods to keep fetched "
+             "ahead of the latest crypto period being encrypted. Keys are "
+             "requested again as soon as fewer crypto periods are left, so a "
+             "slow key server does not stall the output at crypto period "
+             "boundaries.");
+DEFINE_int32(max_concurrent_key_requests,
+             1,
+             "With key rotation, the maximum number of key requests to the key "
+             "server in flight at the same time.");
 DEFINE_hex_bytes(group_id, "", "Identifier for a group of licenses (hex).");
 DEFINE_bool(enable_entitlement_license,
             false,
@@ -168,6 +179,14 @@ bool ValidateWidevineCryptoFlags() {
     PrintError("--crypto_period_duration should not be negative.");
     success = false;
   }
+  if (FLAGS_key_prefetch_crypto_periods < 0) {
+    PrintError("--key_prefetch_crypto_periods should not be negative.");
+    success = false;
+  }
+  if (FLAGS_max_concurrent_key_requests <= 0) {
+    PrintError("--max_concurrent_key_requests must be positive.");
+    success = false;
+  }
   return success;
 }
 
@@ -26,6 +26,8 @@ DECLARE_hex_bytes(aes_signing_key);
 DECLARE_hex_bytes(aes_signing_iv);
 DECLARE_string(rsa_signing_key_path);
 DECLARE_int32(crypto_period_duration);
+DECLARE_int32(key_prefetch_crypto_periods);
+DECLARE_int32(max_concurrent_key_requests);
 DECLARE_hex_bytes(group_id);
 DECLARE_bool(enable_entitlement_license);
 
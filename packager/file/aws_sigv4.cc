@@ -0,0 +1,140 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/aws_sigv4.h"
+
+#include <openssl/hmac.h>
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/base/strings/stringprintf.h"
+
+namespace shaka {
+namespace {
+
+const char kAlgorithm[] = "AWS4-HMAC-SHA256";
+
+std::string HexEncode(const uint8_t* data, size_t size) {
+  return base::ToLowerASCII(base::HexEncode(data, size));
+}
+
+std::string Sha256Hex(const std::string& data) {
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const uint8_t*>(data.data()), data.size(), digest);
+  return HexEncode(digest, sizeof(digest));
+}
+
+std::string HmacSha256(const std::string& key, const std::string& data) {
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  unsigned int digest_size = 0;
+  CHECK(HMAC(EVP_sha256(), key.data(), key.size(),
+             reinterpret_cast<const uint8_t*>(data.data()), data.size(), digest,
+             &digest_size));
+  return std::string(reinterpret_cast<const char*>(digest), digest_size);
+}
+
+}  // namespace
+
+std::vector<std::string> SignAwsRequest(const AwsCredentials& credentials,
+                                        const std::string& region,
+                                        const std::string& service,
+                                        const AwsRequest& request,
+                                        const std::string& amz_date) {
+  DCHECK_EQ(16u, amz_date.size());
+  const std::string date = amz_date.substr(0, 8);
+
+  std::map<std::string, std::string> headers = request.headers;
+  headers["host"] = request.host;
+  headers["x-amz-content-sha256"] = request.payload_hash;
+  headers["x-amz-date"] = amz_date;
+  if (!credentials.session_token.empty())
+    headers["x-amz-security-token"] = credentials.session_token;
+
+  std::string canonical_headers;
+  std::string signed_headers;
+  for (const auto& header : headers) {
+    base::StringAppendF(&canonical_headers, "%s:%s\n", header.first.c_str(),
+                        header.second.c_str());
+    if (!signed_headers.empty())
+      signed_headers += ';';
+    signed_headers += header.first;
+  }
+
+  const std::string canonical_request = base::StringPrintf(
+      "%s\n%s\n%s\n%s\n%s\n%s", request.method.c_str(), request.path.c_str(),
+      AwsCanonicalQuery(request.query).c_str(), canonical_headers.c_str(),
+      signed_headers.c_str(), request.payload_hash.c_str());
+  const std::string scope = base::StringPrintf(
+      "%s/%s/%s/aws4_request", date.c_str(), region.c_str(), service.c_str());
+  const std::string string_to_sign =
+      base::StringPrintf("%s\n%s\n%s\n%s", kAlgorithm, amz_date.c_str(),
+                         scope.c_str(), Sha256Hex(canonical_request).c_str());
+
+  std::string key = HmacSha256("AWS4" + credentials.secret_access_key, date);
+  key = HmacSha256(key, region);
+  key = HmacSha256(key, service);
+  key = HmacSha256(key, "aws4_request");
+  const std::string signature = HmacSha256(key, string_to_sign);
+
+  std::vector<std::string> result;
+  result.push_back("x-amz-date: " + amz_date);
+  result.push_back("x-amz-content-sha256: " + request.payload_hash);
+  if (!credentials.session_token.empty())
+    result.push_back("x-amz-security-token: " + credentials.session_token);
+  result.push_back(base::StringPrintf(
+      "Authorization: %s Credential=%s/%s, SignedHeaders=%s, Signature=%s",
+      kAlgorithm, credentials.access_key_id.c_str(), scope.c_str(),
+      signed_headers.c_str(),
+      HexEncode(reinterpret_cast<const uint8_t*>(signature.data()),
+                signature.size())
+          .c_str()));
+  return result;
+}
+
+std::string AwsUriEncode(const std::string& value, bool encode_slash) {
+  std::string result;
+  for (const char c : value) {
+    if (base::IsAsciiAlpha(c) || base::IsAsciiDigit(c) || c == '-' ||
+        c == '_' || c == '.' || c == '~' || (c == '/' && !encode_slash)) {
+      result += c;
+    } else {
+      base::StringAppendF(&result, "%%%02X", static_cast<uint8_t>(c));
+    }
+  }
+  return result;
+}
+
+std::string AwsCanonicalQuery(const std::string& query) {
+  std::vector<std::pair<std::string, std::string>> parameters;
+  for (const std::string& parameter : base::SplitString(
+           query, "&", base::KEEP_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    const size_t pos = parameter.find('=');
+    if (pos == std::string::npos)
+      parameters.emplace_back(parameter, "");
+    else
+      parameters.emplace_back(parameter.substr(0, pos),
+                              parameter.substr(pos + 1));
+  }
+  // By name, then by value. Sorting the "name=value" strings would put "a-b"
+  // before "a", as '-' sorts before '='.
+  std::sort(parameters.begin(), parameters.end());
+
+  std::string canonical_query;
+  for (const auto& parameter : parameters) {
+    if (!canonical_query.empty())
+      canonical_query += '&';
+    canonical_query += parameter.first + '=' + parameter.second;
+  }
+  return canonical_query;
+}
+
+}  // namespace shaka
@@ -0,0 +1,64 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_AWS_SIGV4_H_
+#define PACKAGER_FILE_AWS_SIGV4_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace shaka {
+
+/// Credentials of an AWS account, or of an S3 compatible service.
+struct AwsCredentials {
+  std::string access_key_id;
+  std::string secret_access_key;
+  /// Only set for temporary credentials.
+  std::string session_token;
+};
+
+/// An HTTP request to sign with AWS Signature Version 4.
+struct AwsRequest {
+  std::string method;
+  std::string host;
+  /// Path of the request, URI-encoded.
+  std::string path;
+  /// Query of the request, URI-encoded, without the leading '?'. The
+  /// parameters are sorted by name when signing.
+  std::string query;
+  /// Headers to sign other than host, x-amz-date, x-amz-content-sha256 and
+  /// x-amz-security-token, by lowercase name.
+  std::map<std::string, std::string> headers;
+  /// Hex encoded SHA-256 of the payload, or "UNSIGNED-PAYLOAD".
+  std::string payload_hash;
+};
+
+/// Signs @a request with AWS Signature Version 4.
+/// @param region is the region of the service, e.g. "us-east-1".
+/// @param service is the name of the service, e.g. "s3".
+/// @param amz_date is the time of the request, formatted as YYYYMMDDTHHMMSSZ.
+/// @return The headers to add to the request: x-amz-date,
+///         x-amz-content-sha256, x-amz-security-token if there is a session
+///         token, and Authorization.
+std::vector<std::string> SignAwsRequest(const AwsCredentials& credentials,
+                                        const std::string& region,
+                                        const std::string& service,
+                                        const AwsRequest& request,
+                                        const std::string& amz_date);
+
+/// URI-encodes @a value as AWS Signature Version 4 expects, i.e. every byte
+/// but the unreserved characters, and '/' if @a encode_slash is false.
+std::string AwsUriEncode(const std::string& value, bool encode_slash);
+
+/// Builds the canonical query string of AWS Signature Version 4 from
+/// @a query, which is URI-encoded: the parameters are sorted by name, then
+/// by value, and the parameters without a value are given an empty one.
+std::string AwsCanonicalQuery(const std::string& query);
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_AWS_SIGV4_H_
@@ -29,11 +29,26 @@ int64_t CallbackFile::Read(void* buffer, uint64_t length) {
 }
 
 int64_t CallbackFile::Write(const void* buffer, uint64_t length) {
-  if (!callback_params_->write_func) {
-    LOG(ERROR) << "Write function not defined.";
-    return -1;
+  if (callback_params_->write_func)
+    return callback_params_->write_func(name_, buffer, length);
+  if (callback_params_->write_buffers_func) {
+    const uint8_t* data = static_cast<const uint8_t*>(buffer);
+    std::shared_ptr<std::vector<uint8_t>> copy(
+        new std::vector<uint8_t>(data, data + length));
+    // The block shares the ownership of the copy.
+    SharedBuffer shared_buffer;
+    shared_buffer.data = std::shared_ptr<const uint8_t>(copy, copy->data());
+    shared_buffer.size = length;
+    return callback_params_->write_buffers_func(name_, {shared_buffer});
   }
-  return callback_params_->write_func(name_, buffer, length);
+  LOG(ERROR) << "Write function not defined.";
+  return -1;
+}
+
+int64_t CallbackFile::WriteShared(const std::vector<SharedBuffer>& buffers) {
+  if (callback_params_->write_buffers_func)
+    return callback_params_->write_buffers_func(name_, buffers);
+  return File::WriteShared(buffers);
 }
 
 int64_t CallbackFile::Size() {
@@ -24,6 +24,7 @@ class CallbackFile : public File {
   bool Close() override;
   int64_t Read(void* buffer, uint64_t length) override;
   int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t WriteShared(const std::vector<SharedBuffer>& buffers) override;
   int64_t Size() override;
   bool Flush() override;
   bool Seek(uint64_t position) override;
@@ -10,6 +10,7 @@
 #include <gtest/gtest.h>
 
 #include <memory>
+#include <vector>
 
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
@@ -163,4 +164,42 @@ TEST(CallbackFileTest, WriteFunctionNotDefined) {
   ASSERT_EQ(-1, writer->Write(kBuffer, kBufferSize));
 }
 
+TEST(CallbackFileTest, WriteSharedHandsOverBuffers) {
+  std::vector<SharedBuffer> received_buffers;
+  BufferCallbackParams callback_params;
+  callback_params.write_buffers_func =
+      [&received_buffers](const std::string& name,
+                          const std::vector<SharedBuffer>& buffers) {
+        EXPECT_EQ(kBufferLabel, name);
+        received_buffers.insert(received_buffers.end(), buffers.begin(),
+                                buffers.end());
+        uint64_t size = 0;
+        for (const SharedBuffer& buffer : buffers)
+          size += buffer.size;
+        return static_cast<int64_t>(size);
+      };
+
+  std::string file_name =
+      File::MakeCallbackFileName(callback_params, kBufferLabel);
+  std::unique_ptr<File, FileCloser> writer(File::Open(file_name.c_str(), "w"));
+  ASSERT_TRUE(writer);
+
+  SharedBuffer shared_buffer;
+  shared_buffer.data.reset(new uint8_t[kBufferSize],
+                           std::default_delete<uint8_t[]>());
+  shared_buffer.size = kBufferSize;
+  ASSERT_EQ(static_cast<int64_t>(kBufferSize),
+            writer->WriteShared({shared_buffer}));
+  // Plain writes are copied into a new buffer.
+  ASSERT_EQ(static_cast<int64_t>(kBufferSize),
+            writer->Write(kBuffer, kBufferSize));
+
+  ASSERT_EQ(2u, received_buffers.size());
+  EXPECT_EQ(shared_buffer.data, received_buffers[0].data);
+  EXPECT_EQ(std::vector<uint8_t>(kBuffer, kBuffer + kBufferSize),
+            std::vector<uint8_t>(received_buffers[1].data.get(),
+                                 received_buffers[1].data.get() +
+                                     received_buffers[1].size));
+}
+
 }  // namespace shaka
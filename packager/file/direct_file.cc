@@ -0,0 +1,229 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/direct_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "packager/base/logging.h"
+#include "packager/base/posix/eintr_wrapper.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/file/local_file.h"
+
+namespace shaka {
+namespace {
+
+// Maximum number of free blocks kept for the files opened next.
+const size_t kMaxPooledBlocks = 16;
+
+// Aligned blocks of the files closed, so that the files of a segmented output
+// do not allocate new ones.
+class BlockPool {
+ public:
+  uint8_t* Acquire(size_t size) {
+    {
+      base::AutoLock auto_lock(lock_);
+      for (auto it = blocks_.begin(); it != blocks_.end(); ++it) {
+        if (it->size == size) {
+          uint8_t* data = it->data;
+          blocks_.erase(it);
+          return data;
+        }
+      }
+    }
+    void* data = nullptr;
+    if (posix_memalign(&data, DirectFile::kAlignment, size) != 0)
+      return nullptr;
+    return static_cast<uint8_t*>(data);
+  }
+
+  void Release(uint8_t* data, size_t size) {
+    {
+      base::AutoLock auto_lock(lock_);
+      if (blocks_.size() < kMaxPooledBlocks) {
+        blocks_.push_back({data, size});
+        return;
+      }
+    }
+    free(data);
+  }
+
+ private:
+  struct Block {
+    uint8_t* data;
+    size_t size;
+  };
+
+  base::Lock lock_;
+  std::vector<Block> blocks_;
+};
+
+BlockPool* GetBlockPool() {
+  static BlockPool* const block_pool = new BlockPool;
+  return block_pool;
+}
+
+size_t AlignUp(size_t size) {
+  return (size + DirectFile::kAlignment - 1) / DirectFile::kAlignment *
+         DirectFile::kAlignment;
+}
+
+}  // namespace
+
+DirectFile::DirectFile(const char* file_name, size_t block_size)
+    : File(file_name),
+      block_size_(AlignUp(std::max<size_t>(block_size, 1))) {}
+
+bool DirectFile::Close() {
+  bool result = Flush();
+  if (fd_ >= 0 && IGNORE_EINTR(close(fd_)) != 0) {
+    PLOG(ERROR) << "Failed to close " << file_name();
+    result = false;
+  }
+  fd_ = -1;
+  delete this;
+  return result;
+}
+
+int64_t DirectFile::Read(void* buffer, uint64_t length) {
+  DCHECK(buffer);
+  // The data read back may still be in |block_|.
+  if (!Flush())
+    return -1;
+  const ssize_t result =
+      HANDLE_EINTR(pread(fd_, buffer, length, block_offset_));
+  if (result < 0) {
+    PLOG(ERROR) << "Failed to read " << file_name();
+    return -1;
+  }
+  block_offset_ += result;
+  return result;
+}
+
+int64_t DirectFile::Write(const void* buffer, uint64_t length) {
+  DCHECK(buffer);
+  DCHECK(block_);
+  const uint8_t* input = static_cast<const uint8_t*>(buffer);
+  uint64_t bytes_written = 0;
+  while (bytes_written < length) {
+    // Blocks end at aligned offsets, so the block following data written at
+    // an unaligned offset, e.g. after a seek, is aligned again.
+    const size_t capacity = block_size_ - block_offset_ % kAlignment;
+    const size_t size = std::min<uint64_t>(length - bytes_written,
+                                           capacity - block_data_size_);
+    memcpy(block_ + block_data_size_, input + bytes_written, size);
+    block_data_size_ += size;
+    bytes_written += size;
+    if (block_data_size_ == capacity && !WriteBlock())
+      return -1;
+  }
+  return bytes_written;
+}
+
+int64_t DirectFile::Size() {
+  if (!Flush()) {
+    LOG(ERROR) << "Cannot flush file.";
+    return -1;
+  }
+  struct stat info;
+  if (fstat(fd_, &info) != 0) {
+    PLOG(ERROR) << "Cannot get file size of " << file_name();
+    return -1;
+  }
+  return info.st_size;
+}
+
+bool DirectFile::Flush() {
+  return block_data_size_ == 0 || WriteBlock();
+}
+
+bool DirectFile::Seek(uint64_t position) {
+  if (!Flush())
+    return false;
+  block_offset_ = position;
+  return true;
+}
+
+bool DirectFile::Tell(uint64_t* position) {
+  DCHECK(position);
+  *position = block_offset_ + block_data_size_;
+  return true;
+}
+
+DirectFile::~DirectFile() {
+  if (direct_fd_ >= 0)
+    IGNORE_EINTR(close(direct_fd_));
+  if (fd_ >= 0)
+    IGNORE_EINTR(close(fd_));
+  if (block_)
+    GetBlockPool()->Release(block_, block_size_);
+}
+
+bool DirectFile::Open() {
+  if (!LocalFile::CreateParentDirectories(file_name().c_str()))
+    return false;
+  fd_ = HANDLE_EINTR(open(file_name().c_str(),
+                          O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+  if (fd_ < 0)
+    return false;
+  // Not every file system supports direct I/O, e.g. tmpfs.
+  direct_fd_ = HANDLE_EINTR(
+      open(file_name().c_str(), O_WRONLY | O_DIRECT | O_CLOEXEC));
+  if (direct_fd_ < 0) {
+    PLOG(WARNING) << "Cannot open " << file_name()
+                  << " for direct I/O, writing through the page cache.";
+  }
+
+  block_ = GetBlockPool()->Acquire(block_size_);
+  if (!block_) {
+    LOG(ERROR) << "Failed to allocate a block of " << block_size_
+               << " bytes for " << file_name();
+    return false;
+  }
+  return true;
+}
+
+bool DirectFile::WriteBlock() {
+  int fd = fd_;
+  if (direct_fd_ >= 0 && block_data_size_ == block_size_ &&
+      block_offset_ % kAlignment == 0) {
+    fd = direct_fd_;
+  }
+  size_t bytes_written = 0;
+  while (bytes_written < block_data_size_) {
+    const ssize_t result = HANDLE_EINTR(
+        pwrite(fd, block_ + bytes_written, block_data_size_ - bytes_written,
+               block_offset_ + bytes_written));
+    if (result < 0 && fd == direct_fd_ && errno == EINVAL) {
+      PLOG(WARNING) << "Direct I/O failed for " << file_name()
+                    << ", writing through the page cache.";
+      IGNORE_EINTR(close(direct_fd_));
+      direct_fd_ = -1;
+      fd = fd_;
+      continue;
+    }
+    if (result <= 0) {
+      PLOG(ERROR) << "Failed to write " << file_name();
+      return false;
+    }
+    bytes_written += result;
+    // The rest of a short write is not aligned anymore.
+    fd = fd_;
+  }
+  block_offset_ += block_data_size_;
+  block_data_size_ = 0;
+  return true;
+}
+
+}  // namespace shaka
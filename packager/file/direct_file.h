@@ -0,0 +1,70 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_DIRECT_FILE_H_
+#define PACKAGER_FILE_DIRECT_FILE_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "packager/file/file.h"
+
+namespace shaka {
+
+/// Implements a local output file which bypasses the page cache, so that
+/// large outputs do not evict the data of the inputs being read. The data is
+/// gathered in an aligned block, which is written with O_DIRECT once full.
+/// The data which does not fill a block, i.e. the tail of the file or the
+/// data written before a seek or a read, is written through the page cache
+/// instead. The data written can be read back, through the page cache. The
+/// blocks are pooled across files. Only available on Linux.
+class DirectFile : public File {
+ public:
+  /// The alignment of the buffers, offsets and sizes of direct writes.
+  static const size_t kAlignment = 4096;
+
+  /// @param file_name C string containing the name of the file to be accessed.
+  /// @param block_size is the size of the direct writes. It is rounded up to a
+  ///        multiple of kAlignment.
+  DirectFile(const char* file_name, size_t block_size);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+ protected:
+  ~DirectFile() override;
+
+  bool Open() override;
+
+ private:
+  // Writes the data in |block_| at |block_offset_|, directly if it is a full
+  // aligned block. Returns false on error.
+  bool WriteBlock();
+
+  const size_t block_size_;
+  // File descriptors of the file, with and without page cache.
+  int fd_ = -1;
+  int direct_fd_ = -1;
+  uint8_t* block_ = nullptr;
+  // File offset of |block_| and number of bytes in it.
+  uint64_t block_offset_ = 0;
+  size_t block_data_size_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(DirectFile);
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_DIRECT_FILE_H_
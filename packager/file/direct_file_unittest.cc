@@ -0,0 +1,118 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/direct_file.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include "packager/base/files/file_util.h"
+#include "packager/file/file_closer.h"
+
+namespace shaka {
+
+class DirectFileTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    // More than one block of the default size, with an unaligned tail.
+    const size_t kDataSize = (3 << 20) + 1234;
+    for (size_t i = 0; i < kDataSize; ++i)
+      data_.push_back(static_cast<char>(i * 7));
+    ASSERT_TRUE(base::CreateTemporaryFile(&test_file_path_));
+    file_name_ = kDirectFilePrefix + test_file_path_.AsUTF8Unsafe();
+  }
+
+  void TearDown() override { base::DeleteFile(test_file_path_, false); }
+
+  std::string ReadTestFile() {
+    std::string contents;
+    EXPECT_TRUE(base::ReadFileToString(test_file_path_, &contents));
+    return contents;
+  }
+
+  std::string data_;
+  base::FilePath test_file_path_;
+  std::string file_name_;
+};
+
+TEST_F(DirectFileTest, Write) {
+  std::unique_ptr<File, FileCloser> file(File::Open(file_name_.c_str(), "w"));
+  ASSERT_TRUE(file);
+  // Writes which are not aligned with the blocks.
+  const size_t kWriteSize = 100000;
+  for (size_t offset = 0; offset < data_.size(); offset += kWriteSize) {
+    const size_t size = std::min(kWriteSize, data_.size() - offset);
+    ASSERT_EQ(static_cast<int64_t>(size),
+              file->Write(data_.data() + offset, size));
+  }
+  uint64_t position = 0;
+  ASSERT_TRUE(file->Tell(&position));
+  EXPECT_EQ(data_.size(), position);
+  ASSERT_TRUE(file.release()->Close());
+  EXPECT_EQ(data_, ReadTestFile());
+
+  // The file can be read back through the same name.
+  file.reset(File::Open(file_name_.c_str(), "r"));
+  ASSERT_TRUE(file);
+  std::string buffer(10, 0);
+  ASSERT_EQ(10, file->Read(&buffer[0], buffer.size()));
+  EXPECT_EQ(data_.substr(0, 10), buffer);
+}
+
+TEST_F(DirectFileTest, SeekAndOverwrite) {
+  std::unique_ptr<File, FileCloser> file(File::Open(file_name_.c_str(), "w"));
+  ASSERT_TRUE(file);
+  ASSERT_EQ(static_cast<int64_t>(data_.size()),
+            file->Write(data_.data(), data_.size()));
+
+  // Rewrites data at an unaligned offset and writes across the next blocks.
+  const size_t kOffset = 1000;
+  const std::string kUpdate(3 * DirectFile::kAlignment, 'u');
+  ASSERT_TRUE(file->Seek(kOffset));
+  ASSERT_EQ(static_cast<int64_t>(kUpdate.size()),
+            file->Write(kUpdate.data(), kUpdate.size()));
+  EXPECT_EQ(static_cast<int64_t>(data_.size()), file->Size());
+  ASSERT_TRUE(file.release()->Close());
+
+  data_.replace(kOffset, kUpdate.size(), kUpdate);
+  EXPECT_EQ(data_, ReadTestFile());
+}
+
+TEST_F(DirectFileTest, ReadBack) {
+  std::unique_ptr<File, FileCloser> file(File::Open(file_name_.c_str(), "w"));
+  ASSERT_TRUE(file);
+  ASSERT_EQ(static_cast<int64_t>(data_.size()),
+            file->Write(data_.data(), data_.size()));
+
+  // Reads at an unaligned offset.
+  const size_t kOffset = data_.size() - DirectFile::kAlignment - 10;
+  const size_t kReadSize = DirectFile::kAlignment;
+  ASSERT_TRUE(file->Seek(kOffset));
+  std::string buffer(kReadSize, 0);
+  ASSERT_EQ(static_cast<int64_t>(kReadSize),
+            file->Read(&buffer[0], buffer.size()));
+  EXPECT_EQ(data_.substr(kOffset, kReadSize), buffer);
+  uint64_t position = 0;
+  ASSERT_TRUE(file->Tell(&position));
+  EXPECT_EQ(kOffset + kReadSize, position);
+
+  // Writes resume after the data read. The data written is still in the
+  // block when the next read, which stops at the end of file, happens.
+  const std::string kTail = "tail";
+  ASSERT_EQ(static_cast<int64_t>(kTail.size()),
+            file->Write(kTail.data(), kTail.size()));
+  buffer.assign(100, 0);
+  EXPECT_EQ(6, file->Read(&buffer[0], buffer.size()));
+  ASSERT_TRUE(file.release()->Close());
+
+  data_.replace(kOffset + kReadSize, kTail.size(), kTail);
+  EXPECT_EQ(data_, ReadTestFile());
+}
+
+}  // namespace shaka
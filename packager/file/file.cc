@@ -10,18 +10,29 @@
 #include <inttypes.h>
 #include <algorithm>
 #include <memory>
+#include <vector>
 #include "packager/base/files/file_util.h"
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_piece.h"
 #include "packager/base/strings/stringprintf.h"
 #include "packager/file/callback_file.h"
+#include "packager/file/file_upload_queue.h"
 #include "packager/file/file_util.h"
 #include "packager/file/local_file.h"
+#if defined(OS_LINUX)
+#include "packager/file/direct_file.h"
+#include "packager/file/io_uring_file.h"
+#endif  // defined(OS_LINUX)
 #include "packager/file/memory_file.h"
+#include "packager/file/memory_mapped_file.h"
+#include "packager/file/object_storage_file.h"
+#include "packager/file/pooled_output_file.h"
+#include "packager/file/segment_store.h"
 #include "packager/file/threaded_io_file.h"
 #include "packager/file/udp_file.h"
 #include "packager/file/http_file.h"
+#include "packager/file/http_range_file.h"
 
 DEFINE_uint64(io_cache_size,
               32ULL << 20,
@@ -30,6 +41,40 @@ DEFINE_uint64(io_cache_size,
 DEFINE_uint64(io_block_size,
               1ULL << 16,
               "Size of the block size used for threaded I/O, in bytes.");
+DEFINE_uint64(io_cache_min_size,
+              0,
+              "If non-zero, the threaded I/O cache of each file starts at "
+              "this size, in bytes, grows up to --io_cache_size when the "
+              "producer blocks on a full cache and shrinks back when the "
+              "cache is mostly unused, e.g. for low bitrate streams.");
+DEFINE_uint64(io_cache_memory_limit,
+              512ULL << 20,
+              "Maximum total size of the threaded I/O caches, in bytes, "
+              "beyond which the caches do not grow when --io_cache_min_size "
+              "is set.");
+DEFINE_bool(io_uring,
+            false,
+            "Do the I/O of local files through io_uring instead of a thread "
+            "per file. Only supported on Linux 5.1 or later, falls back to "
+            "threaded I/O otherwise.");
+DEFINE_uint64(io_uring_queue_depth,
+              4,
+              "Number of blocks of --io_block_size read ahead or written "
+              "behind for each file when --io_uring is set.");
+DEFINE_bool(sync_atomic_writes,
+            false,
+            "Flush the files written atomically, e.g. manifests, to the "
+            "storage device before they replace the previous version, so "
+            "that a crash of the system cannot leave them empty or partially "
+            "written. Costs a round trip to the device per write.");
+DEFINE_int32(pooled_output_threads,
+             0,
+             "Write the local output files on a pool of this many I/O "
+             "threads shared by all the files, instead of a thread and a "
+             "--io_cache_size cache per file. Saves memory and thread hops "
+             "when writing many small segments. 0 to disable.");
+DECLARE_int32(http_range_requests);
+DECLARE_uint64(http_range_size);
 
 // Needed for Windows weirdness which somewhere defines CopyFile as CopyFileW.
 #ifdef CopyFile
@@ -39,9 +84,14 @@ DEFINE_uint64(io_block_size,
 namespace shaka {
 
 const char* kCallbackFilePrefix = "callback://";
+const char* kDirectFilePrefix = "direct://";
 const char* kLocalFilePrefix = "file://";
 const char* kMemoryFilePrefix = "memory://";
+const char* kMemoryMappedFilePrefix = "mmap://";
 const char* kUdpFilePrefix = "udp://";
+const char* kSegmentStoreFilePrefix = "store://";
+const char* kS3FilePrefix = "s3://";
+const char* kGcsFilePrefix = "gs://";
 const char* kHttpFilePrefix = "http://";
 const char* kHttpsFilePrefix = "https://";
 
@@ -72,20 +122,63 @@ bool DeleteLocalFile(const char* file_name) {
   return LocalFile::Delete(file_name);
 }
 
+// Writes |contents| to the new local file |file_name|, flushing it to the
+// storage device if --sync_atomic_writes is set.
+bool WriteLocalTempFile(const std::string& file_name,
+                        const std::string& contents) {
+  // Without a ThreadedIoFile, since the file is written at once. Files
+  // without a prefix are always LocalFiles.
+  std::unique_ptr<LocalFile, FileCloser> file(static_cast<LocalFile*>(
+      File::OpenWithNoBuffering(file_name.c_str(), "w")));
+  if (!file) {
+    LOG(ERROR) << "Failed to open temporary file '" << file_name << "'.";
+    return false;
+  }
+  size_t bytes_written = 0;
+  while (bytes_written < contents.size()) {
+    const int64_t size = file->Write(contents.data() + bytes_written,
+                                     contents.size() - bytes_written);
+    if (size <= 0) {
+      LOG(ERROR) << "Failed to write temporary file '" << file_name << "'.";
+      return false;
+    }
+    bytes_written += size;
+  }
+  if (FLAGS_sync_atomic_writes && !file->SyncData()) {
+    LOG(ERROR) << "Failed to sync temporary file '" << file_name << "'.";
+    return false;
+  }
+  if (!file.release()->Close()) {
+    LOG(ERROR) << "Failed to close temporary file '" << file_name << "'.";
+    return false;
+  }
+  return true;
+}
+
 bool WriteLocalFileAtomically(const char* file_name,
                               const std::string& contents) {
   const base::FilePath file_path = base::FilePath::FromUTF8Unsafe(file_name);
   const std::string dir_name = file_path.DirName().AsUTF8Unsafe();
+  // The temporary file is in the same directory, so that it replaces the file
+  // with a rename, which readers see either before or after.
   std::string temp_file_name;
   if (!TempFilePath(dir_name, &temp_file_name))
     return false;
-  if (!File::WriteStringToFile(temp_file_name.c_str(), contents))
+  const base::FilePath temp_file_path =
+      base::FilePath::FromUTF8Unsafe(temp_file_name);
+  if (!WriteLocalTempFile(temp_file_name, contents)) {
+    base::DeleteFile(temp_file_path, false);
     return false;
+  }
   base::File::Error replace_file_error = base::File::FILE_OK;
-  if (!base::ReplaceFile(base::FilePath::FromUTF8Unsafe(temp_file_name),
-                         file_path, &replace_file_error)) {
+  if (!base::ReplaceFile(temp_file_path, file_path, &replace_file_error)) {
     LOG(ERROR) << "Failed to replace file '" << file_name << "' with '"
                << temp_file_name << "', error: " << replace_file_error;
+    base::DeleteFile(temp_file_path, false);
+    return false;
+  }
+  if (FLAGS_sync_atomic_writes && !LocalFile::SyncParentDirectory(file_name)) {
+    LOG(ERROR) << "Failed to sync the directory of '" << file_name << "'.";
     return false;
   }
   return true;
@@ -99,12 +192,22 @@ File* CreateUdpFile(const char* file_name, const char* mode) {
   return new UdpFile(file_name);
 }
 
+File* CreateHttpFileForUrl(const std::string& url, const char* mode) {
+  if (strcmp(mode, "r"))
+    return new HttpFile(HttpMethod::kPut, url);
+  if (FLAGS_http_range_requests > 0) {
+    return new HttpRangeFile(url, FLAGS_http_range_size,
+                             FLAGS_http_range_requests);
+  }
+  return new HttpFile(HttpMethod::kGet, url);
+}
+
 File* CreateHttpsFile(const char* file_name, const char* mode) {
-  return new HttpFile(HttpMethod::kPut, std::string("https://") + file_name);
+  return CreateHttpFileForUrl(std::string("https://") + file_name, mode);
 }
 
 File* CreateHttpFile(const char* file_name, const char* mode) {
-  return new HttpFile(HttpMethod::kPut, std::string("http://") + file_name);
+  return CreateHttpFileForUrl(std::string("http://") + file_name, mode);
 }
 
 File* CreateMemoryFile(const char* file_name, const char* mode) {
@@ -116,6 +219,66 @@ bool DeleteMemoryFile(const char* file_name) {
   return true;
 }
 
+File* CreateMemoryMappedFile(const char* file_name, const char* mode) {
+  return new MemoryMappedFile(file_name, mode);
+}
+
+File* CreateSegmentStoreFile(const char* file_name, const char* mode) {
+  return new SegmentStoreFile(file_name, mode);
+}
+
+bool DeleteSegmentStoreFile(const char* file_name) {
+  SegmentStore::GetInstance()->Delete(file_name);
+  return true;
+}
+
+File* CreateS3File(const char* file_name, const char* mode) {
+  return new ObjectStorageFile(ObjectStorageFile::Service::kS3, file_name,
+                               mode);
+}
+
+bool DeleteS3File(const char* file_name) {
+  return ObjectStorageFile::Delete(ObjectStorageFile::Service::kS3,
+                                   file_name);
+}
+
+// Objects are only visible once completely written, so a plain write is
+// atomic.
+bool WriteS3FileAtomically(const char* file_name,
+                           const std::string& contents) {
+  return File::WriteStringToFile(
+      (std::string(kS3FilePrefix) + file_name).c_str(), contents);
+}
+
+File* CreateGcsFile(const char* file_name, const char* mode) {
+  return new ObjectStorageFile(ObjectStorageFile::Service::kGcs, file_name,
+                               mode);
+}
+
+bool DeleteGcsFile(const char* file_name) {
+  return ObjectStorageFile::Delete(ObjectStorageFile::Service::kGcs,
+                                   file_name);
+}
+
+bool WriteGcsFileAtomically(const char* file_name,
+                            const std::string& contents) {
+  return File::WriteStringToFile(
+      (std::string(kGcsFilePrefix) + file_name).c_str(), contents);
+}
+
+// Size of the writes of DirectFile. Direct I/O works best with large writes.
+const size_t kDirectFileBlockSize = 1 << 20;
+
+File* CreateDirectFile(const char* file_name, const char* mode) {
+#if defined(OS_LINUX)
+  if (!strcmp(mode, "w"))
+    return new DirectFile(file_name, kDirectFileBlockSize);
+#endif  // defined(OS_LINUX)
+  // The other modes, and the platforms without direct I/O, use the page
+  // cache.
+  return new LocalFile(file_name, mode);
+}
+
 static const FileTypeInfo kFileTypeInfo[] = {
     {
         kLocalFilePrefix,
@@ -125,9 +288,17 @@ static const FileTypeInfo kFileTypeInfo[] = {
     },
     {kUdpFilePrefix, &CreateUdpFile, nullptr, nullptr},
     {kMemoryFilePrefix, &CreateMemoryFile, &DeleteMemoryFile, nullptr},
+    {kMemoryMappedFilePrefix, &CreateMemoryMappedFile, &DeleteLocalFile,
+     nullptr},
     {kCallbackFilePrefix, &CreateCallbackFile, nullptr, nullptr},
+    {kDirectFilePrefix, &CreateDirectFile, &DeleteLocalFile,
+     &WriteLocalFileAtomically},
     {kHttpFilePrefix, &CreateHttpFile, nullptr, nullptr},
     {kHttpsFilePrefix, &CreateHttpsFile, nullptr, nullptr},
+    {kSegmentStoreFilePrefix, &CreateSegmentStoreFile, &DeleteSegmentStoreFile,
+     &SegmentStoreFile::WriteAtomically},
+    {kS3FilePrefix, &CreateS3File, &DeleteS3File, &WriteS3FileAtomically},
+    {kGcsFilePrefix, &CreateGcsFile, &DeleteGcsFile, &WriteGcsFileAtomically},
 };
 
 base::StringPiece GetFileTypePrefix(base::StringPiece file_name) {
@@ -152,26 +323,63 @@ const FileTypeInfo* GetFileTypeInfo(base::StringPiece file_name,
 }  // namespace
 
 File* File::Create(const char* file_name, const char* mode) {
+  base::StringPiece file_type_prefix = GetFileTypePrefix(file_name);
+#if defined(OS_LINUX)
+  if (FLAGS_io_uring &&
+      (file_type_prefix.empty() || file_type_prefix == kLocalFilePrefix)) {
+    const char* real_file_name = file_name + file_type_prefix.size();
+    if (IoUringFile::IsSupported(real_file_name, mode)) {
+      return new IoUringFile(real_file_name, mode, FLAGS_io_block_size,
+                             FLAGS_io_uring_queue_depth);
+    }
+  }
+#endif  // defined(OS_LINUX)
+
+  // HTTP outputs are uploaded in the background once closed, if enabled.
+  if (FileUploadQueue::IsEnabled() && !strcmp(mode, "w") &&
+      (file_type_prefix == kHttpFilePrefix ||
+       file_type_prefix == kHttpsFilePrefix)) {
+    return FileUploadQueue::GetInstance()->CreateFile(file_name);
+  }
+
   std::unique_ptr<File, FileCloser> internal_file(
       CreateInternalFile(file_name, mode));
 
-  base::StringPiece file_type_prefix = GetFileTypePrefix(file_name);
   if (file_type_prefix == kMemoryFilePrefix ||
-      file_type_prefix == kCallbackFilePrefix) {
-    // Disable caching for memory and callback files.
+      file_type_prefix == kMemoryMappedFilePrefix ||
+      file_type_prefix == kCallbackFilePrefix ||
+      file_type_prefix == kSegmentStoreFilePrefix ||
+      file_type_prefix == kS3FilePrefix || file_type_prefix == kGcsFilePrefix) {
+    // Disable caching for memory, memory mapped, callback, segment store and
+    // object storage files. Memory mapped files are read in place, so there
+    // is nothing to prefetch, segment store files should be visible to
+    // readers as soon as written, and object storage files transfer parts in
+    // parallel already.
     return internal_file.release();
   }
 
+  if (FLAGS_pooled_output_threads > 0 &&
+      (!strcmp(mode, "w") || !strcmp(mode, "a")) &&
+      (file_type_prefix.empty() || file_type_prefix == kLocalFilePrefix)) {
+    return new PooledOutputFile(std::move(internal_file),
+                                FLAGS_pooled_output_threads,
+                                FLAGS_io_block_size);
+  }
+
   if (FLAGS_io_cache_size) {
+    const uint64_t min_io_cache_size =
+        FLAGS_io_cache_min_size ? FLAGS_io_cache_min_size : FLAGS_io_cache_size;
     // Enable threaded I/O for "r", "w", and "a" modes only.
     if (!strcmp(mode, "r")) {
-      return new ThreadedIoFile(std::move(internal_file),
-                                ThreadedIoFile::kInputMode, FLAGS_io_cache_size,
-                                FLAGS_io_block_size);
+      return new ThreadedIoFile(
+          std::move(internal_file), ThreadedIoFile::kInputMode,
+          FLAGS_io_cache_size, FLAGS_io_block_size, min_io_cache_size,
+          FLAGS_io_cache_memory_limit);
     } else if (!strcmp(mode, "w") || !strcmp(mode, "a")) {
-      return new ThreadedIoFile(std::move(internal_file),
-                                ThreadedIoFile::kOutputMode,
-                                FLAGS_io_cache_size, FLAGS_io_block_size);
+      return new ThreadedIoFile(
+          std::move(internal_file), ThreadedIoFile::kOutputMode,
+          FLAGS_io_cache_size, FLAGS_io_block_size, min_io_cache_size,
+          FLAGS_io_cache_memory_limit);
     }
   }
 
@@ -209,6 +417,41 @@ File* File::OpenWithNoBuffering(const char* file_name, const char* mode) {
   return file;
 }
 
+void File::DeleteMultiple(const std::vector<std::string>& file_names,
+                          std::vector<std::string>* failed_file_names) {
+  DCHECK(failed_file_names);
+  std::vector<std::string> s3_object_names;
+  std::vector<std::string> gcs_object_names;
+  for (const std::string& file_name : file_names) {
+    const base::StringPiece file_type_prefix = GetFileTypePrefix(file_name);
+    if (file_type_prefix == kS3FilePrefix) {
+      s3_object_names.push_back(file_name.substr(file_type_prefix.size()));
+    } else if (file_type_prefix == kGcsFilePrefix) {
+      gcs_object_names.push_back(file_name.substr(file_type_prefix.size()));
+    } else if (!Delete(file_name.c_str())) {
+      failed_file_names->push_back(file_name);
+    }
+  }
+  const struct {
+    ObjectStorageFile::Service service;
+    const char* prefix;
+    const std::vector<std::string>& object_names;
+  } object_storages[] = {
+      {ObjectStorageFile::Service::kS3, kS3FilePrefix, s3_object_names},
+      {ObjectStorageFile::Service::kGcs, kGcsFilePrefix, gcs_object_names},
+  };
+  for (const auto& object_storage : object_storages) {
+    if (object_storage.object_names.empty())
+      continue;
+    std::vector<std::string> failed_object_names;
+    ObjectStorageFile::DeleteMultiple(object_storage.service,
+                                      object_storage.object_names,
+                                      &failed_object_names);
+    for (const std::string& object_name : failed_object_names)
+      failed_file_names->push_back(object_storage.prefix + object_name);
+  }
+}
+
 bool File::Delete(const char* file_name) {
   static bool logged = false;
   base::StringPiece real_file_name;
@@ -384,11 +627,102 @@ int64_t File::CopyFile(File* source, File* destination, int64_t max_copy) {
   return bytes_copied;
 }
 
+bool File::ReadFully(File* file, void* data, uint64_t size) {
+  DCHECK(file);
+  uint8_t* position = static_cast<uint8_t*>(data);
+  while (size > 0) {
+    const int64_t bytes_read = file->Read(position, size);
+    if (bytes_read <= 0)
+      return false;
+    position += bytes_read;
+    size -= bytes_read;
+  }
+  return true;
+}
+
+bool File::ReadAt(File* file, uint64_t offset, uint64_t size, void* data) {
+  DCHECK(file);
+  return file->Seek(offset) && ReadFully(file, data, size);
+}
+
+bool File::WriteFully(File* file, const void* data, uint64_t size) {
+  DCHECK(file);
+  const uint8_t* position = static_cast<const uint8_t*>(data);
+  while (size > 0) {
+    const int64_t bytes_written = file->Write(position, size);
+    if (bytes_written <= 0)
+      return false;
+    position += bytes_written;
+    size -= bytes_written;
+  }
+  return true;
+}
+
+int64_t File::WriteV(const FileIoVector* buffers, size_t num_buffers) {
+  std::vector<uint8_t> data;
+  for (size_t i = 0; i < num_buffers; ++i) {
+    const uint8_t* buffer = static_cast<const uint8_t*>(buffers[i].buffer);
+    data.insert(data.end(), buffer, buffer + buffers[i].length);
+  }
+  uint64_t bytes_written = 0;
+  while (bytes_written < data.size()) {
+    const int64_t size =
+        Write(data.data() + bytes_written, data.size() - bytes_written);
+    if (size <= 0)
+      return bytes_written > 0 ? static_cast<int64_t>(bytes_written) : size;
+    bytes_written += size;
+  }
+  return bytes_written;
+}
+
+int64_t File::WriteShared(const std::vector<SharedBuffer>& buffers) {
+  std::vector<FileIoVector> vectors;
+  for (const SharedBuffer& buffer : buffers)
+    vectors.push_back({buffer.data.get(), buffer.size});
+
+  uint64_t bytes_written = 0;
+  size_t index = 0;
+  while (index < vectors.size()) {
+    int64_t size = WriteV(&vectors[index], vectors.size() - index);
+    if (size <= 0)
+      return size < 0 ? size : -1;
+    bytes_written += size;
+    // Skip the blocks written completely and the written part of the next one.
+    while (index < vectors.size() &&
+           static_cast<uint64_t>(size) >= vectors[index].length) {
+      size -= vectors[index].length;
+      ++index;
+    }
+    if (index < vectors.size()) {
+      vectors[index].buffer =
+          static_cast<const uint8_t*>(vectors[index].buffer) + size;
+      vectors[index].length -= size;
+    }
+  }
+  return bytes_written;
+}
+
+int64_t File::GetLastModifiedTime(const char* file_name) {
+  base::StringPiece real_file_name;
+  const FileTypeInfo* file_type = GetFileTypeInfo(file_name, &real_file_name);
+  DCHECK(file_type);
+  if (file_type->type != kLocalFilePrefix &&
+      file_type->type != kMemoryMappedFilePrefix)
+    return -1;
+  base::File::Info info;
+  if (!base::GetFileInfo(base::FilePath::FromUTF8Unsafe(real_file_name),
+                         &info)) {
+    return -1;
+  }
+  return (info.last_modified - base::Time::UnixEpoch()).InMicroseconds();
+}
+
 bool File::IsLocalRegularFile(const char* file_name) {
   base::StringPiece real_file_name;
   const FileTypeInfo* file_type = GetFileTypeInfo(file_name, &real_file_name);
   DCHECK(file_type);
-  if (file_type->type != kLocalFilePrefix)
+  if (file_type->type != kLocalFilePrefix &&
+      file_type->type != kMemoryMappedFilePrefix)
     return false;
 #if defined(OS_WIN)
   const base::FilePath file_path(
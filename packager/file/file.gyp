@@ -13,22 +13,48 @@
       'target_name': 'file',
       'type': '<(component)',
       'sources': [
+        'aws_sigv4.cc',
+        'aws_sigv4.h',
         'callback_file.cc',
         'callback_file.h',
         'file.cc',
         'file.h',
+        'file_deletion_queue.cc',
+        'file_deletion_queue.h',
+        'file_upload_queue.cc',
+        'file_upload_queue.h',
         'file_util.cc',
         'file_util.h',
         'file_closer.h',
         'http_file.cc',
         'http_file.h',
+        'http_range_file.cc',
+        'http_range_file.h',
+        'http_request.cc',
+        'http_request.h',
+        'http_multi_client.cc',
+        'http_multi_client.h',
         'io_cache.cc',
         'io_cache.h',
+        'large_buffer.cc',
+        'large_buffer.h',
         'local_file.cc',
         'local_file.h',
+        'memory_budget.cc',
+        'memory_budget.h',
         'memory_file.cc',
         'memory_file.h',
+        'memory_mapped_file.cc',
+        'memory_mapped_file.h',
+        'object_storage_file.cc',
+        'object_storage_file.h',
+        'pooled_output_file.cc',
+        'pooled_output_file.h',
         'public/buffer_callback_params.h',
+        'segment_store.cc',
+        'segment_store.h',
+        'thread_class.cc',
+        'thread_class.h',
         'threaded_io_file.cc',
         'threaded_io_file.h',
         'udp_file.cc',
@@ -40,6 +66,7 @@
         '../base/base.gyp:base',
         '../packager.gyp:status',
         '../third_party/gflags/gflags.gyp:gflags',
+        '../third_party/boringssl/boringssl.gyp:boringssl',
         '../third_party/curl/curl.gyp:libcurl',
         '../version/version.gyp:version',
       ],
@@ -50,17 +77,36 @@
             'SHAKA_IMPLEMENTATION',
           ],
         }],
+        ['OS == "linux"', {
+          'sources': [
+            'direct_file.cc',
+            'direct_file.h',
+            'io_uring.cc',
+            'io_uring.h',
+            'io_uring_file.cc',
+            'io_uring_file.h',
+          ],
+        }],
       ],
     },
     {
       'target_name': 'file_unittest',
       'type': '<(gtest_target_type)',
       'sources': [
+        'aws_sigv4_unittest.cc',
         'callback_file_unittest.cc',
+        'file_deletion_queue_unittest.cc',
+        'file_upload_queue_unittest.cc',
         'file_unittest.cc',
         'file_util_unittest.cc',
         'io_cache_unittest.cc',
+        'large_buffer_unittest.cc',
+        'memory_budget_unittest.cc',
         'memory_file_unittest.cc',
+        'memory_mapped_file_unittest.cc',
+        'object_storage_file_unittest.cc',
+        'segment_store_unittest.cc',
+        'thread_class_unittest.cc',
         'udp_options_unittest.cc',
         'http_file_unittest.cc',
       ],
@@ -73,6 +119,14 @@
         '../version/version.gyp:version',
         'file',
       ],
+      'conditions': [
+        ['OS == "linux"', {
+          'sources': [
+            'direct_file_unittest.cc',
+            'io_uring_file_unittest.cc',
+          ],
+        }],
+      ],
     },
   ],
 }
@@ -10,20 +10,36 @@
 #include <stdint.h>
 
 #include <string>
+#include <vector>
 
 #include "packager/base/macros.h"
 #include "packager/file/public/buffer_callback_params.h"
 #include "packager/status.h"
 
+namespace base {
+class WaitableEvent;
+}  // namespace base
+
 namespace shaka {
 
 extern const char* kCallbackFilePrefix;
+extern const char* kDirectFilePrefix;
 extern const char* kLocalFilePrefix;
 extern const char* kMemoryFilePrefix;
+extern const char* kMemoryMappedFilePrefix;
 extern const char* kUdpFilePrefix;
+extern const char* kSegmentStoreFilePrefix;
+extern const char* kS3FilePrefix;
+extern const char* kGcsFilePrefix;
 extern const char* kHttpFilePrefix;
 const int64_t kWholeFile = -1;
 
+/// A block of memory to be written by File::WriteV().
+struct FileIoVector {
+  const void* buffer;
+  uint64_t length;
+};
+
 /// Define an abstract file interface.
 class SHAKA_EXPORT File {
  public:
@@ -48,6 +64,14 @@ class SHAKA_EXPORT File {
   /// @return true if successful, false otherwise.
   static bool Delete(const char* file_name);
 
+  /// Delete the specified files, with batched requests where the file type
+  /// supports them, e.g. for S3 objects.
+  /// @param file_names contains the paths of the files to be deleted.
+  /// @param[out] failed_file_names gets the paths of the files which could
+  ///             not be deleted.
+  static void DeleteMultiple(const std::vector<std::string>& file_names,
+                             std::vector<std::string>* failed_file_names);
+
   /// Flush() and de-allocate resources associated with this file, and
   /// delete this File object.  THIS IS THE ONE TRUE WAY TO DEALLOCATE
   /// THIS OBJECT.
@@ -69,6 +93,22 @@ class SHAKA_EXPORT File {
   /// @return Number of bytes written, or a value < 0 on error.
   virtual int64_t Write(const void* buffer, uint64_t length) = 0;
 
+  /// Write several blocks of data, in order, as if they were one block. The
+  /// default implementation copies the blocks into one buffer and calls
+  /// Write(); files which can write the blocks without copying them override
+  /// it.
+  /// @param buffers points to @a num_buffers blocks of memory.
+  /// @param num_buffers indicates the number of blocks to write.
+  /// @return Number of bytes written, or a value < 0 on error.
+  virtual int64_t WriteV(const FileIoVector* buffers, size_t num_buffers);
+
+  /// Write all the reference counted blocks of @a buffers. Files which can
+  /// keep the references, e.g. callback files with a write_buffers_func, take
+  /// them over instead of copying the data. The default implementation writes
+  /// the blocks with WriteV().
+  /// @return Number of bytes written, or a value < 0 on error.
+  virtual int64_t WriteShared(const std::vector<SharedBuffer>& buffers);
+
   /// @return Size of the file in bytes. A return value less than zero
   ///         indicates a problem getting the size.
   virtual int64_t Size() = 0;
@@ -91,6 +131,32 @@ class SHAKA_EXPORT File {
   /// @return true on succcess, false otherwise.
   virtual bool Tell(uint64_t* position) = 0;
 
+  /// @return true if ReadInPlace() is supported by this file.
+  virtual bool SupportsReadInPlace() const { return false; }
+
+  /// Read data without copying it. Only valid if SupportsReadInPlace()
+  /// returns true.
+  /// @param[out] data points to the data read on success. It stays valid until
+  ///             the next call to the file, or until the file is closed for
+  ///             files mapped in memory.
+  /// @param length indicates the maximum number of bytes to be read.
+  /// @return Number of bytes read, or a value < 0 on error.
+  ///         Zero on end-of-file, or if 'length' is zero.
+  virtual int64_t ReadInPlace(const uint8_t** data, uint64_t length) {
+    return -1;
+  }
+
+  /// @return true if Read() returns without waiting for the data, e.g.
+  ///         because it is already buffered, or on end-of-file or error.
+  ///         Files which cannot tell return true.
+  virtual bool CanReadWithoutBlocking() { return true; }
+
+  /// Sets @a event to be signaled when CanReadWithoutBlocking() may have
+  /// become true. Files which cannot tell ignore it, as they can always read
+  /// without blocking.
+  /// @param event must outlive the file.
+  virtual void SetReadableEvent(base::WaitableEvent* event) {}
+
   /// @return The file name. Note that the file type prefix has been stripped
   ///         off.
   const std::string& file_name() const { return file_name_; }
@@ -144,10 +210,28 @@ class SHAKA_EXPORT File {
   /// @return Number of bytes written, or a value < 0 on error.
   static int64_t CopyFile(File* source, File* destination, int64_t max_copy);
 
+  /// Reads exactly @a size bytes from the current position of @a file.
+  /// @return true on success, false on error or if the file ends first.
+  static bool ReadFully(File* file, void* data, uint64_t size);
+
+  /// Reads exactly @a size bytes at @a offset of @a file.
+  /// @return true on success, false on error or if the file ends first.
+  static bool ReadAt(File* file, uint64_t offset, uint64_t size, void* data);
+
+  /// Writes all the @a size bytes of @a data to @a file.
+  /// @return true on success, false otherwise.
+  static bool WriteFully(File* file, const void* data, uint64_t size);
+
   /// @param file_name is the name of the file to be checked.
   /// @return true if `file_name` is a local and regular file.
   static bool IsLocalRegularFile(const char* file_name);
 
+  /// @param file_name is the name of the file to be checked.
+  /// @return The last modification time of a local file, in microseconds
+  ///         since the Unix epoch, or a negative value on error, e.g. if the
+  ///         file does not exist or is not a local file.
+  static int64_t GetLastModifiedTime(const char* file_name);
+
   /// Generate callback file name.
   /// NOTE: THE GENERATED NAME IS ONLY VAID WHILE @a callback_params IS VALID.
   /// @param callback_params references BufferCallbackParams, which will be
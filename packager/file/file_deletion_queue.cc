@@ -0,0 +1,96 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/file_deletion_queue.h"
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/file/file.h"
+
+namespace shaka {
+
+namespace {
+
+// Files are retried until they fail to be deleted this many times.
+const int kMaxDeleteAttempts = 3;
+
+}  // namespace
+
+FileDeletionQueue* FileDeletionQueue::GetInstance() {
+  static FileDeletionQueue* const instance = new FileDeletionQueue;
+  return instance;
+}
+
+void FileDeletionQueue::Delete(const std::string& file_name) {
+  base::AutoLock auto_lock(lock_);
+  if (!pending_files_.insert(file_name).second) {
+    VLOG(2) << file_name << " is already queued for deletion.";
+    return;
+  }
+  queued_files_.push_back(file_name);
+  if (deleting_)
+    return;
+  deleting_ = true;
+  idle_.Reset();
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&FileDeletionQueue::DeleteQueuedFiles,
+                 base::Unretained(this)),
+      true);
+}
+
+void FileDeletionQueue::Flush() {
+  idle_.Wait();
+}
+
+FileDeletionQueue::FileDeletionQueue()
+    : idle_(base::WaitableEvent::ResetPolicy::MANUAL,
+            base::WaitableEvent::InitialState::SIGNALED) {}
+
+FileDeletionQueue::~FileDeletionQueue() {}
+
+void FileDeletionQueue::DeleteQueuedFiles() {
+  std::vector<std::string> files;
+  {
+    base::AutoLock auto_lock(lock_);
+    // The files which failed to be deleted are retried once per task, i.e.
+    // when new files are queued, so they are not retried in a loop.
+    files.swap(failed_files_);
+    files.insert(files.end(), queued_files_.begin(), queued_files_.end());
+    queued_files_.clear();
+  }
+  while (!files.empty()) {
+    VLOG(2) << "Deleting " << files.size() << " files.";
+    std::vector<std::string> failed_files;
+    File::DeleteMultiple(files, &failed_files);
+    const std::set<std::string> failed_file_set(failed_files.begin(),
+                                                failed_files.end());
+
+    base::AutoLock auto_lock(lock_);
+    for (const std::string& file_name : files) {
+      if (failed_file_set.count(file_name) > 0) {
+        if (++failed_attempts_[file_name] < kMaxDeleteAttempts) {
+          LOG(WARNING) << "Failed to delete " << file_name
+                       << "; Will retry later.";
+          failed_files_.push_back(file_name);
+          continue;
+        }
+        LOG(WARNING) << "Failed to delete " << file_name << "; Giving up.";
+      }
+      failed_attempts_.erase(file_name);
+      pending_files_.erase(file_name);
+    }
+    files.swap(queued_files_);
+    queued_files_.clear();
+    if (files.empty()) {
+      deleting_ = false;
+      idle_.Signal();
+    }
+  }
+}
+
+}  // namespace shaka
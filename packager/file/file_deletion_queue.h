@@ -0,0 +1,72 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_FILE_DELETION_QUEUE_H_
+#define PACKAGER_FILE_FILE_DELETION_QUEUE_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/waitable_event.h"
+
+namespace shaka {
+
+/// Process-wide queue of the files to delete, e.g. the segments which are
+/// out of the live window of the HLS playlists and of the DASH manifests.
+/// The files are deleted on a worker thread, in batches, with
+/// File::DeleteMultiple(), so the manifest updates do not wait for the
+/// deletions, which are network round trips for remote outputs. A file
+/// queued again before it is deleted, e.g. a segment shared by HLS and DASH,
+/// is deleted once.
+///
+/// Files can be queued from any thread. The queue is only locked to take or
+/// record file names, not during the deletions.
+class FileDeletionQueue {
+ public:
+  /// @return the process-wide queue.
+  static FileDeletionQueue* GetInstance();
+
+  /// Queues @a file_name for deletion. Files which fail to be deleted are
+  /// retried with the next files queued, up to three times.
+  void Delete(const std::string& file_name);
+
+  /// Waits until the files queued are deleted, or failed to be.
+  void Flush();
+
+ private:
+  FileDeletionQueue();
+  ~FileDeletionQueue();
+
+  FileDeletionQueue(const FileDeletionQueue&) = delete;
+  FileDeletionQueue& operator=(const FileDeletionQueue&) = delete;
+
+  // Run on a worker thread.
+  void DeleteQueuedFiles();
+
+  base::Lock lock_;
+  // Guarded by |lock_|.
+  std::vector<std::string> queued_files_;
+  // Files which failed to be deleted, retried with the next files queued.
+  // Guarded by |lock_|.
+  std::vector<std::string> failed_files_;
+  // The number of failed attempts to delete |failed_files_|. Guarded by
+  // |lock_|.
+  std::map<std::string, int> failed_attempts_;
+  // The files queued, being deleted or failed, which are not queued again.
+  // Guarded by |lock_|.
+  std::set<std::string> pending_files_;
+  // Whether DeleteQueuedFiles() is posted or running. Guarded by |lock_|.
+  bool deleting_ = false;
+  // Signaled when there is no deletion in progress.
+  base::WaitableEvent idle_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_FILE_DELETION_QUEUE_H_
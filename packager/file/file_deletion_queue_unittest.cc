@@ -0,0 +1,74 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/file_deletion_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "packager/base/strings/stringprintf.h"
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/file/memory_file.h"
+
+namespace shaka {
+namespace {
+const int kNumFiles = 10;
+}  // namespace
+
+class FileDeletionQueueTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    for (int i = 0; i < kNumFiles; ++i)
+      ASSERT_TRUE(File::WriteStringToFile(FileName(i).c_str(), "content"));
+  }
+
+  void TearDown() override { MemoryFile::DeleteAll(); }
+
+  std::string FileName(int index) {
+    return base::StringPrintf("memory://segment%d.mp4", index);
+  }
+
+  bool FileExists(const std::string& file_name) {
+    std::unique_ptr<File, FileCloser> file(File::Open(file_name.c_str(), "r"));
+    return file != nullptr;
+  }
+};
+
+TEST_F(FileDeletionQueueTest, DeleteMultiple) {
+  std::vector<std::string> failed_file_names;
+  File::DeleteMultiple({FileName(0), FileName(1)}, &failed_file_names);
+  EXPECT_TRUE(failed_file_names.empty());
+  EXPECT_FALSE(FileExists(FileName(0)));
+  EXPECT_FALSE(FileExists(FileName(1)));
+  EXPECT_TRUE(FileExists(FileName(2)));
+}
+
+TEST_F(FileDeletionQueueTest, Delete) {
+  FileDeletionQueue* queue = FileDeletionQueue::GetInstance();
+  for (int i = 0; i < kNumFiles - 1; ++i) {
+    queue->Delete(FileName(i));
+    // Queued again, e.g. by another manifest.
+    queue->Delete(FileName(i));
+  }
+  queue->Flush();
+  for (int i = 0; i < kNumFiles - 1; ++i)
+    EXPECT_FALSE(FileExists(FileName(i)));
+  EXPECT_TRUE(FileExists(FileName(kNumFiles - 1)));
+
+  // Files are deleted again if they are queued again once deleted.
+  ASSERT_TRUE(File::WriteStringToFile(FileName(0).c_str(), "content"));
+  queue->Delete(FileName(0));
+  queue->Flush();
+  EXPECT_FALSE(FileExists(FileName(0)));
+}
+
+TEST_F(FileDeletionQueueTest, FlushWithoutFiles) {
+  FileDeletionQueue::GetInstance()->Flush();
+}
+
+}  // namespace shaka
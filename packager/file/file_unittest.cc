@@ -12,6 +12,8 @@
 
 DECLARE_uint64(io_cache_size);
 DECLARE_uint64(io_block_size);
+DECLARE_bool(sync_atomic_writes);
+DECLARE_int32(pooled_output_threads);
 
 namespace {
 const int kDataSize = 1024;
@@ -154,6 +156,25 @@ TEST_F(LocalFileTest, WriteRead) {
   EXPECT_EQ(data_, read_data);
 }
 
+TEST_F(LocalFileTest, WriteFullyReadAt) {
+  File* file = File::Open(local_file_name_.c_str(), "w");
+  ASSERT_TRUE(file != NULL);
+  EXPECT_TRUE(File::WriteFully(file, data_.data(), kDataSize));
+  EXPECT_TRUE(file->Close());
+
+  file = File::Open(local_file_name_.c_str(), "r");
+  ASSERT_TRUE(file != NULL);
+  const int kOffset = kDataSize / 4;
+  std::string read_data(kDataSize / 2, 0);
+  EXPECT_TRUE(File::ReadAt(file, kOffset, read_data.size(), &read_data[0]));
+  EXPECT_EQ(data_.substr(kOffset, read_data.size()), read_data);
+
+  // Reading past the end of the file fails.
+  read_data.resize(kDataSize);
+  EXPECT_FALSE(File::ReadAt(file, kOffset, read_data.size(), &read_data[0]));
+  EXPECT_TRUE(file->Close());
+}
+
 TEST_F(LocalFileTest, WriteStringReadString) {
   ASSERT_TRUE(
       File::WriteStringToFile(local_file_name_no_prefix_.c_str(), data_));
@@ -174,6 +195,19 @@ TEST_F(LocalFileTest, AtomicWriteRead) {
   EXPECT_EQ(data_, read_data);
 }
 
+TEST_F(LocalFileTest, AtomicWriteWithSyncReplacesFile) {
+  gflags::FlagSaver flag_saver;
+  FLAGS_sync_atomic_writes = true;
+  ASSERT_TRUE(File::WriteFileAtomically(local_file_name_no_prefix_.c_str(),
+                                        "previous contents"));
+  ASSERT_TRUE(
+      File::WriteFileAtomically(local_file_name_no_prefix_.c_str(), data_));
+  std::string read_data;
+  ASSERT_TRUE(
+      File::ReadFileToString(local_file_name_no_prefix_.c_str(), &read_data));
+  EXPECT_EQ(data_, read_data);
+}
+
 TEST_F(LocalFileTest, WriteFlushCheckSize) {
   const uint32_t kNumCycles(10);
   const uint32_t kNumWrites(10);
@@ -195,12 +229,48 @@ TEST_F(LocalFileTest, WriteFlushCheckSize) {
   }
 }
 
+TEST_F(LocalFileTest, PooledOutputWriteRead) {
+  gflags::FlagSaver flag_saver;
+  FLAGS_pooled_output_threads = 2;
+  // Write many blocks, split across the writes.
+  FLAGS_io_block_size = 100;
+  const int kNumWrites = 10;
+
+  File* file = File::Open(local_file_name_.c_str(), "w");
+  ASSERT_TRUE(file != NULL);
+  for (int i = 0; i < kNumWrites; ++i)
+    EXPECT_EQ(kDataSize, file->Write(data_.data(), kDataSize));
+  EXPECT_TRUE(file->Flush());
+  EXPECT_EQ(kDataSize * kNumWrites, file->Size());
+  EXPECT_EQ(kDataSize, file->Write(data_.data(), kDataSize));
+  EXPECT_TRUE(file->Close());
+
+  std::string read_data;
+  ASSERT_TRUE(File::ReadFileToString(local_file_name_.c_str(), &read_data));
+  ASSERT_EQ(static_cast<size_t>(kDataSize * (kNumWrites + 1)),
+            read_data.size());
+  for (int i = 0; i <= kNumWrites; ++i)
+    EXPECT_EQ(data_, read_data.substr(i * kDataSize, kDataSize));
+}
+
 TEST_F(LocalFileTest, IsLocalReguar) {
   ASSERT_EQ(kDataSize,
             base::WriteFile(test_file_path_, data_.data(), kDataSize));
   ASSERT_TRUE(File::IsLocalRegularFile(local_file_name_.c_str()));
 }
 
+TEST_F(LocalFileTest, GetLastModifiedTime) {
+  const base::Time kLastModified =
+      base::Time::UnixEpoch() + base::TimeDelta::FromSeconds(1000000);
+  ASSERT_TRUE(base::TouchFile(test_file_path_, kLastModified, kLastModified));
+  EXPECT_EQ(1000000 * base::Time::kMicrosecondsPerSecond,
+            File::GetLastModifiedTime(local_file_name_.c_str()));
+
+  base::DeleteFile(test_file_path_, false);
+  EXPECT_GT(0, File::GetLastModifiedTime(local_file_name_.c_str()));
+  EXPECT_GT(0, File::GetLastModifiedTime("memory://file"));
+}
+
 class ParamLocalFileTest : public LocalFileTest,
                            public ::testing::WithParamInterface<uint8_t> {};
 
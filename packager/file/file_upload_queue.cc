@@ -0,0 +1,210 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/file_upload_queue.h"
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/file/file.h"
+
+DEFINE_int32(http_upload_queue_size,
+             0,
+             "If positive, the files written to HTTP outputs are buffered in "
+             "memory and uploaded in the background, in order, with up to "
+             "this many files queued before the writers wait. Failed uploads "
+             "are retried instead of failing the packaging.");
+DEFINE_int32(http_upload_retries,
+             3,
+             "Number of times a failed background HTTP upload is retried, "
+             "with --http_upload_queue_size.");
+DEFINE_int32(http_upload_retry_delay_ms,
+             500,
+             "Delay before the first retry of a failed background HTTP "
+             "upload, in milliseconds, doubled with each retry.");
+
+namespace shaka {
+
+namespace {
+
+bool UploadWithoutBuffering(const std::string& file_name,
+                            const std::string& data) {
+  File* file = File::OpenWithNoBuffering(file_name.c_str(), "w");
+  if (!file)
+    return false;
+  const int64_t bytes_written = file->Write(data.data(), data.size());
+  // Close() is needed to complete the upload, and frees the file.
+  const bool closed = file->Close();
+  return closed && bytes_written == static_cast<int64_t>(data.size());
+}
+
+// Buffers the data written until closed, then queues it for upload.
+class QueuedUploadFile : public File {
+ public:
+  QueuedUploadFile(const std::string& file_name, FileUploadQueue* queue)
+      : File(file_name), queue_(queue) {}
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override {
+    queue_->Upload(file_name(), std::move(data_));
+    delete this;
+    return true;
+  }
+  int64_t Read(void* buffer, uint64_t length) override {
+    NOTIMPLEMENTED() << "QueuedUploadFile does not support Read().";
+    return -1;
+  }
+  int64_t Write(const void* buffer, uint64_t length) override {
+    data_.append(static_cast<const char*>(buffer), length);
+    return length;
+  }
+  int64_t Size() override { return data_.size(); }
+  bool Flush() override { return true; }
+  bool Seek(uint64_t position) override {
+    NOTIMPLEMENTED() << "QueuedUploadFile does not support Seek().";
+    return false;
+  }
+  bool Tell(uint64_t* position) override {
+    *position = data_.size();
+    return true;
+  }
+  /// @}
+
+ protected:
+  ~QueuedUploadFile() override {}
+  bool Open() override { return true; }
+
+ private:
+  QueuedUploadFile(const QueuedUploadFile&) = delete;
+  QueuedUploadFile& operator=(const QueuedUploadFile&) = delete;
+
+  FileUploadQueue* const queue_;
+  std::string data_;
+};
+
+}  // namespace
+
+FileUploadQueue* FileUploadQueue::GetInstance() {
+  static FileUploadQueue* const instance = new FileUploadQueue(
+      std::max(FLAGS_http_upload_queue_size, 1),
+      std::max(FLAGS_http_upload_retries, 0),
+      base::TimeDelta::FromMilliseconds(FLAGS_http_upload_retry_delay_ms),
+      &UploadWithoutBuffering);
+  return instance;
+}
+
+bool FileUploadQueue::IsEnabled() {
+  return FLAGS_http_upload_queue_size > 0;
+}
+
+FileUploadQueue::FileUploadQueue(size_t max_queued_files,
+                                 int max_retries,
+                                 base::TimeDelta initial_retry_delay,
+                                 UploadFunction upload_function)
+    : max_queued_files_(max_queued_files),
+      max_retries_(max_retries),
+      initial_retry_delay_(initial_retry_delay),
+      upload_function_(std::move(upload_function)),
+      file_dequeued_(&lock_),
+      idle_(base::WaitableEvent::ResetPolicy::MANUAL,
+            base::WaitableEvent::InitialState::SIGNALED) {}
+
+FileUploadQueue::~FileUploadQueue() {
+  Flush();
+}
+
+File* FileUploadQueue::CreateFile(const std::string& file_name) {
+  return new QueuedUploadFile(file_name, this);
+}
+
+void FileUploadQueue::Upload(const std::string& file_name, std::string data) {
+  base::AutoLock auto_lock(lock_);
+  while (queued_files_.size() >= max_queued_files_)
+    file_dequeued_.Wait();
+  stats_.queued_bytes += data.size();
+  queued_files_.push_back(QueuedFile{file_name, std::move(data)});
+  stats_.queue_depth = queued_files_.size();
+  if (uploading_)
+    return;
+  uploading_ = true;
+  idle_.Reset();
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&FileUploadQueue::UploadQueuedFiles, base::Unretained(this)),
+      true);
+}
+
+bool FileUploadQueue::Flush() {
+  idle_.Wait();
+  base::AutoLock auto_lock(lock_);
+  const bool upload_failed = upload_failed_;
+  upload_failed_ = false;
+  return !upload_failed;
+}
+
+FileUploadQueue::Stats FileUploadQueue::GetStats() const {
+  base::AutoLock auto_lock(lock_);
+  return stats_;
+}
+
+void FileUploadQueue::UploadQueuedFiles() {
+  while (true) {
+    const QueuedFile* file = nullptr;
+    {
+      base::AutoLock auto_lock(lock_);
+      if (queued_files_.empty()) {
+        uploading_ = false;
+        idle_.Signal();
+        return;
+      }
+      // The file stays queued, and counted in the queue depth, while it is
+      // uploaded. Only this thread removes files from the queue.
+      file = &queued_files_.front();
+    }
+    const bool uploaded = UploadWithRetries(*file);
+
+    base::AutoLock auto_lock(lock_);
+    if (uploaded) {
+      ++stats_.num_uploads;
+    } else {
+      ++stats_.num_failures;
+      upload_failed_ = true;
+    }
+    stats_.queued_bytes -= queued_files_.front().data.size();
+    queued_files_.pop_front();
+    stats_.queue_depth = queued_files_.size();
+    file_dequeued_.Signal();
+  }
+}
+
+bool FileUploadQueue::UploadWithRetries(const QueuedFile& file) {
+  base::TimeDelta retry_delay = initial_retry_delay_;
+  for (int attempt = 0;; ++attempt) {
+    if (upload_function_(file.file_name, file.data))
+      return true;
+    if (attempt >= max_retries_) {
+      LOG(ERROR) << "Failed to upload " << file.file_name << " after "
+                 << attempt + 1 << " attempts; Giving up.";
+      return false;
+    }
+    LOG(WARNING) << "Failed to upload " << file.file_name << "; Retrying in "
+                 << retry_delay.InMilliseconds() << " ms.";
+    {
+      base::AutoLock auto_lock(lock_);
+      ++stats_.num_retries;
+    }
+    base::PlatformThread::Sleep(retry_delay);
+    retry_delay *= 2;
+  }
+}
+
+}  // namespace shaka
@@ -0,0 +1,130 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_FILE_UPLOAD_QUEUE_H_
+#define PACKAGER_FILE_FILE_UPLOAD_QUEUE_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+
+class File;
+
+/// Process-wide queue of the files written to HTTP outputs, e.g. segments
+/// and manifests, which are uploaded in the background. Each file is buffered
+/// in memory until closed, then queued, so a slow or failing upload does not
+/// stall the thread writing it. Failed uploads are retried with an
+/// exponential backoff. The files are uploaded one at a time, in the order
+/// they are closed, so a manifest is not uploaded before its segments.
+///
+/// The queue is bounded: closing a file waits for room in the queue once it
+/// is full, so the writers slow down to the upload rate instead of buffering
+/// without limit.
+///
+/// The queue is shared by the writers of all the jobs, which queue and flush
+/// files concurrently with the worker thread uploading them.
+class FileUploadQueue {
+ public:
+  /// Uploads @a data to @a file_name, returning false on failure.
+  typedef std::function<bool(const std::string& file_name,
+                             const std::string& data)>
+      UploadFunction;
+
+  struct Stats {
+    /// Number of files queued, including the file being uploaded.
+    size_t queue_depth = 0;
+    /// Size of the files queued, in bytes.
+    uint64_t queued_bytes = 0;
+    /// Number of files uploaded.
+    uint64_t num_uploads = 0;
+    /// Number of upload attempts retried.
+    uint64_t num_retries = 0;
+    /// Number of files which failed to be uploaded after all the retries.
+    uint64_t num_failures = 0;
+  };
+
+  /// @return the process-wide queue of the HTTP uploads, configured with
+  ///         --http_upload_queue_size, --http_upload_retries and
+  ///         --http_upload_retry_delay_ms.
+  static FileUploadQueue* GetInstance();
+
+  /// @return true if the HTTP outputs are uploaded in the background.
+  static bool IsEnabled();
+
+  /// @param max_queued_files is the number of files queued before Upload()
+  ///        waits.
+  /// @param max_retries is the number of times a failed upload is retried.
+  /// @param initial_retry_delay is the delay before the first retry, which
+  ///        doubles with each retry.
+  /// @param upload_function uploads a file.
+  FileUploadQueue(size_t max_queued_files,
+                  int max_retries,
+                  base::TimeDelta initial_retry_delay,
+                  UploadFunction upload_function);
+  ~FileUploadQueue();
+
+  /// @return a file buffering what is written to @a file_name, which is
+  ///         queued for upload when closed.
+  File* CreateFile(const std::string& file_name);
+
+  /// Queues @a data to be uploaded to @a file_name, waiting for room in the
+  /// queue if it is full.
+  void Upload(const std::string& file_name, std::string data);
+
+  /// Waits until the files queued are uploaded, or failed to be.
+  /// @return false if a file failed to be uploaded since the last call.
+  bool Flush();
+
+  /// @return the statistics of the queue.
+  Stats GetStats() const;
+
+ private:
+  FileUploadQueue(const FileUploadQueue&) = delete;
+  FileUploadQueue& operator=(const FileUploadQueue&) = delete;
+
+  struct QueuedFile {
+    std::string file_name;
+    std::string data;
+  };
+
+  // Run on a worker thread.
+  void UploadQueuedFiles();
+  // Uploads |file|, retrying on failure. Returns false if it failed for good.
+  bool UploadWithRetries(const QueuedFile& file);
+
+  const size_t max_queued_files_;
+  const int max_retries_;
+  const base::TimeDelta initial_retry_delay_;
+  const UploadFunction upload_function_;
+
+  mutable base::Lock lock_;
+  // Signaled when a file is removed from the queue.
+  base::ConditionVariable file_dequeued_;
+  // The files to upload, the first one being uploaded while |uploading_|.
+  // Guarded by |lock_|.
+  std::deque<QueuedFile> queued_files_;
+  // Whether UploadQueuedFiles() is posted or running. Guarded by |lock_|.
+  bool uploading_ = false;
+  // Whether an upload failed since the last Flush(). Guarded by |lock_|.
+  bool upload_failed_ = false;
+  // Guarded by |lock_|.
+  Stats stats_;
+  // Signaled when there is no upload in progress.
+  base::WaitableEvent idle_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_FILE_UPLOAD_QUEUE_H_
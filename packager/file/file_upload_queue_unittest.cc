@@ -0,0 +1,104 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/file_upload_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/file/file.h"
+
+namespace shaka {
+
+class FileUploadQueueTest : public testing::Test {
+ protected:
+  // Creates a queue whose uploads of a file fail |num_failures_[file_name]|
+  // times before succeeding.
+  std::unique_ptr<FileUploadQueue> CreateQueue(size_t max_queued_files,
+                                               int max_retries) {
+    return std::unique_ptr<FileUploadQueue>(new FileUploadQueue(
+        max_queued_files, max_retries, base::TimeDelta::FromMilliseconds(1),
+        [this](const std::string& file_name, const std::string& data) {
+          base::AutoLock auto_lock(lock_);
+          if (num_failures_[file_name] > 0) {
+            --num_failures_[file_name];
+            return false;
+          }
+          uploads_.push_back(file_name + ":" + data);
+          return true;
+        }));
+  }
+
+  base::Lock lock_;
+  std::map<std::string, int> num_failures_;
+  std::vector<std::string> uploads_;
+};
+
+TEST_F(FileUploadQueueTest, UploadsInOrder) {
+  std::unique_ptr<FileUploadQueue> queue = CreateQueue(1, 0);
+  queue->Upload("segment1.m4s", "a");
+  queue->Upload("segment2.m4s", "b");
+  queue->Upload("manifest.mpd", "c");
+  EXPECT_TRUE(queue->Flush());
+  EXPECT_EQ(std::vector<std::string>(
+                {"segment1.m4s:a", "segment2.m4s:b", "manifest.mpd:c"}),
+            uploads_);
+
+  const FileUploadQueue::Stats stats = queue->GetStats();
+  EXPECT_EQ(0u, stats.queue_depth);
+  EXPECT_EQ(0u, stats.queued_bytes);
+  EXPECT_EQ(3u, stats.num_uploads);
+  EXPECT_EQ(0u, stats.num_retries);
+}
+
+TEST_F(FileUploadQueueTest, RetriesFailedUploads) {
+  num_failures_["segment1.m4s"] = 2;
+  std::unique_ptr<FileUploadQueue> queue = CreateQueue(4, 2);
+  queue->Upload("segment1.m4s", "a");
+  queue->Upload("segment2.m4s", "b");
+  EXPECT_TRUE(queue->Flush());
+  EXPECT_EQ(std::vector<std::string>({"segment1.m4s:a", "segment2.m4s:b"}),
+            uploads_);
+
+  const FileUploadQueue::Stats stats = queue->GetStats();
+  EXPECT_EQ(2u, stats.num_uploads);
+  EXPECT_EQ(2u, stats.num_retries);
+  EXPECT_EQ(0u, stats.num_failures);
+}
+
+TEST_F(FileUploadQueueTest, GivesUpAfterRetries) {
+  num_failures_["segment1.m4s"] = 3;
+  std::unique_ptr<FileUploadQueue> queue = CreateQueue(4, 2);
+  queue->Upload("segment1.m4s", "a");
+  queue->Upload("segment2.m4s", "b");
+  // The failure is reported once.
+  EXPECT_FALSE(queue->Flush());
+  EXPECT_TRUE(queue->Flush());
+  EXPECT_EQ(std::vector<std::string>({"segment2.m4s:b"}), uploads_);
+  EXPECT_EQ(1u, queue->GetStats().num_failures);
+}
+
+TEST_F(FileUploadQueueTest, QueuedUploadFile) {
+  std::unique_ptr<FileUploadQueue> queue = CreateQueue(1, 0);
+  File* file = queue->CreateFile("segment1.m4s");
+  ASSERT_EQ(3, file->Write("abc", 3));
+  ASSERT_EQ(3, file->Write("def", 3));
+  uint64_t position = 0;
+  ASSERT_TRUE(file->Tell(&position));
+  EXPECT_EQ(6u, position);
+  // Nothing is uploaded until the file is closed.
+  EXPECT_TRUE(queue->Flush());
+  EXPECT_TRUE(uploads_.empty());
+  EXPECT_TRUE(file->Close());
+  EXPECT_TRUE(queue->Flush());
+  EXPECT_EQ(std::vector<std::string>({"segment1.m4s:abcdef"}), uploads_);
+}
+
+}  // namespace shaka
@@ -9,11 +9,14 @@
 #include <curl/curl.h>
 #include <gflags/gflags.h>
 
+#include <algorithm>
+
 #include "packager/base/bind.h"
 #include "packager/base/files/file_util.h"
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/base/threading/worker_pool.h"
 #include "packager/version/version.h"
 
@@ -36,6 +39,12 @@ DEFINE_bool(disable_peer_verification,
             false,
             "Disable peer verification. This is needed to talk to servers "
             "without valid certificates.");
+DEFINE_int32(http_max_in_flight_requests,
+             0,
+             "If positive, HTTP transfers of all files share a single client "
+             "which reuses connections, multiplexes HTTP/2 requests and runs "
+             "at most this many requests at a time. Otherwise every file is "
+             "transferred on its own connection.");
 DECLARE_uint64(io_cache_size);
 
 namespace shaka {
@@ -148,8 +157,62 @@ bool AppendHeader(const std::string& header, List* list) {
   }
 }
 
+// Shares the DNS cache, TLS sessions and open connections of all transfers,
+// so that successive requests to a server, e.g. key requests with key rotation
+// or segment uploads, resume TLS sessions and reuse kept-alive connections
+// instead of connecting again.
+class CurlShare {
+ public:
+  CurlShare() : share_(curl_share_init()) {
+    curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, &CurlShare::LockCallback);
+    curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, &CurlShare::UnlockCallback);
+    curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900  // 7.57.0
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+  }
+
+  CURLSH* get() { return share_; }
+
+  CurlShare(const CurlShare&) = delete;
+  CurlShare& operator=(const CurlShare&) = delete;
+
+ private:
+  static void LockCallback(CURL* /* handle */,
+                           curl_lock_data data,
+                           curl_lock_access /* access */,
+                           void* user) {
+    static_cast<CurlShare*>(user)->locks_[data].Acquire();
+  }
+
+  static void UnlockCallback(CURL* /* handle */,
+                             curl_lock_data data,
+                             void* user) {
+    static_cast<CurlShare*>(user)->locks_[data].Release();
+  }
+
+  CURLSH* const share_;
+  base::Lock locks_[CURL_LOCK_DATA_LAST];
+};
+
+HttpMultiClient* GetSharedHttpClient() {
+  // Intentionally leaked: transfers may still be completing at exit.
+  static HttpMultiClient* client =
+      new HttpMultiClient(FLAGS_http_max_in_flight_requests);
+  return client;
+}
+
 }  // namespace
 
+CURLSH* HttpFile::GetCurlShare() {
+  static LibCurlInitializer lib_curl_initializer;
+  // Intentionally leaked, like the shared client.
+  static CurlShare* share = new CurlShare;
+  return share->get();
+}
+
 HttpFile::HttpFile(HttpMethod method, const std::string& url)
     : HttpFile(method, url, kBinaryContentType, {}, 0) {}
 
@@ -170,7 +233,7 @@ HttpFile::HttpFile(HttpMethod method,
       user_agent_(FLAGS_user_agent),
       task_exit_event_(base::WaitableEvent::ResetPolicy::MANUAL,
                        base::WaitableEvent::InitialState::NOT_SIGNALED) {
-  static LibCurlInitializer lib_curl_initializer;
+  GetCurlShare();
   if (user_agent_.empty()) {
     user_agent_ += "ShakaPackager/" + GetPackagerVersion();
   }
@@ -212,6 +275,15 @@ bool HttpFile::Open() {
   // TODO: Implement retrying with exponential backoff, see
   // "widevine_key_source.cc"
 
+  if (FLAGS_http_max_in_flight_requests > 0) {
+    SetupRequest();
+    transfer_ = GetSharedHttpClient()->Start(
+        curl_.get(), method_ == HttpMethod::kGet ? nullptr : &upload_cache_,
+        method_ == HttpMethod::kPut ? nullptr : &download_cache_,
+        base::Bind(&HttpFile::OnTransferDone, base::Unretained(this)));
+    return true;
+  }
+
   base::WorkerPool::PostTask(
       FROM_HERE, base::Bind(&HttpFile::ThreadMain, base::Unretained(this)),
       /* task_is_slow= */ true);
@@ -225,6 +297,7 @@ Status HttpFile::CloseWithStatus() {
   // will wait for more data forever.
   download_cache_.Close();
   upload_cache_.Close();
+  NotifyTransfer();
   task_exit_event_.Wait();
 
   const Status result = status_;
@@ -239,12 +312,31 @@ bool HttpFile::Close() {
 
 int64_t HttpFile::Read(void* buffer, uint64_t length) {
   VLOG(2) << "Reading from " << url_ << ", length=" << length;
-  return download_cache_.Read(buffer, length);
+  const int64_t bytes_read = download_cache_.Read(buffer, length);
+  NotifyTransfer();
+  return bytes_read;
 }
 
 int64_t HttpFile::Write(const void* buffer, uint64_t length) {
   VLOG(2) << "Writing to " << url_ << ", length=" << length;
-  return upload_cache_.Write(buffer, length);
+  if (!transfer_)
+    return upload_cache_.Write(buffer, length);
+
+  // Write in pieces no larger than the cache and notify the client after each
+  // one, so a transfer paused on an empty cache is resumed before this thread
+  // can block on a full cache.
+  const uint8_t* data = static_cast<const uint8_t*>(buffer);
+  uint64_t bytes_written = 0;
+  while (bytes_written < length) {
+    const uint64_t chunk_size =
+        std::min(length - bytes_written,
+                 static_cast<uint64_t>(FLAGS_io_cache_size));
+    if (upload_cache_.Write(data + bytes_written, chunk_size) == 0)
+      break;
+    bytes_written += chunk_size;
+    NotifyTransfer();
+  }
+  return bytes_written;
 }
 
 int64_t HttpFile::Size() {
@@ -254,6 +346,7 @@ int64_t HttpFile::Size() {
 
 bool HttpFile::Flush() {
   upload_cache_.Close();
+  NotifyTransfer();
   return true;
 }
 
@@ -295,6 +388,8 @@ void HttpFile::SetupRequest() {
   curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout_in_seconds_);
   curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
   curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_SHARE, GetCurlShare());
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &CurlWriteCallback);
   curl_easy_setopt(curl, CURLOPT_WRITEDATA,
                    method_ == HttpMethod::kPut ? nullptr : &download_cache_);
@@ -335,7 +430,11 @@ void HttpFile::SetupRequest() {
 void HttpFile::ThreadMain() {
   SetupRequest();
 
-  CURLcode res = curl_easy_perform(curl_.get());
+  OnTransferDone(curl_easy_perform(curl_.get()));
+}
+
+void HttpFile::OnTransferDone(int result) {
+  const CURLcode res = static_cast<CURLcode>(result);
   if (res != CURLE_OK) {
     std::string error_message = curl_easy_strerror(res);
     if (res == CURLE_HTTP_RETURNED_ERROR) {
@@ -354,4 +453,9 @@ void HttpFile::ThreadMain() {
   task_exit_event_.Signal();
 }
 
+void HttpFile::NotifyTransfer() {
+  if (transfer_)
+    GetSharedHttpClient()->Notify(transfer_);
+}
+
 }  // namespace shaka
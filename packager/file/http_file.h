@@ -12,10 +12,12 @@
 
 #include "packager/base/synchronization/waitable_event.h"
 #include "packager/file/file.h"
+#include "packager/file/http_multi_client.h"
 #include "packager/file/io_cache.h"
 #include "packager/status.h"
 
 typedef void CURL;
+typedef void CURLSH;
 struct curl_slist;
 
 namespace shaka {
@@ -61,6 +63,11 @@ class HttpFile : public File {
   bool Open() override;
   /// @}
 
+  /// @return The curl share handle of all the HTTP transfers, which shares
+  ///         their DNS cache, TLS sessions and connections. libcurl is
+  ///         initialized on the first call.
+  static CURLSH* GetCurlShare();
+
  protected:
   ~HttpFile() override;
 
@@ -72,6 +79,9 @@ class HttpFile : public File {
 
   void SetupRequest();
   void ThreadMain();
+  void OnTransferDone(int result);
+  // Lets the shared client resume the transfer after the caches changed.
+  void NotifyTransfer();
 
   const std::string url_;
   const std::string upload_content_type_;
@@ -85,6 +95,9 @@ class HttpFile : public File {
   Status status_;
   std::string user_agent_;
 
+  // Set if the transfer runs on the shared HttpMultiClient.
+  std::shared_ptr<HttpMultiClient::Transfer> transfer_;
+
   // Signaled when the "curl easy perform" task completes.
   base::WaitableEvent task_exit_event_;
 };
@@ -6,6 +6,7 @@
 
 #include "packager/file/http_file.h"
 
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
 #include <memory>
@@ -15,6 +16,9 @@
 #include "packager/base/values.h"
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
+#include "packager/file/http_range_file.h"
+
+DECLARE_int32(http_max_in_flight_requests);
 
 #define ASSERT_JSON_STRING(json, key, value)        \
   do {                                              \
@@ -199,4 +203,57 @@ TEST(HttpFileTest, DISABLED_TimeoutNotTriggered) {
   ASSERT_TRUE(file.release()->Close());
 }
 
+TEST(HttpFileTest, DISABLED_ConcurrentRequestsOnSharedClient) {
+  FLAGS_http_max_in_flight_requests = 2;
+
+  const size_t kNumFiles = 4;
+  std::vector<FilePtr> files;
+  for (size_t i = 0; i < kNumFiles; ++i) {
+    files.emplace_back(new HttpFile(HttpMethod::kPost,
+                                    "https://httpbin.org/anything"));
+    ASSERT_TRUE(files.back()->Open());
+  }
+
+  for (size_t i = 0; i < kNumFiles; ++i) {
+    const std::string data = "data" + std::to_string(i);
+    ASSERT_EQ(files[i]->Write(data.data(), data.size()),
+              static_cast<int64_t>(data.size()));
+    ASSERT_TRUE(files[i]->Flush());
+  }
+
+  for (size_t i = 0; i < kNumFiles; ++i) {
+    auto json = HandleResponse(files[i]);
+    ASSERT_TRUE(json);
+    ASSERT_TRUE(files[i].release()->Close());
+    ASSERT_JSON_STRING(json, "method", "POST");
+    ASSERT_JSON_STRING(json, "data", "data" + std::to_string(i));
+  }
+
+  FLAGS_http_max_in_flight_requests = 0;
+}
+
+TEST(HttpFileTest, DISABLED_RangeReadsAndSeek) {
+  // httpbin serves the lowercase alphabet repeated, with byte ranges.
+  const size_t kSize = 1000;
+  std::string expected;
+  for (size_t i = 0; i < kSize; ++i)
+    expected += static_cast<char>('a' + i % 26);
+
+  std::unique_ptr<HttpRangeFile, FileCloser> file(new HttpRangeFile(
+      "https://httpbin.org/range/" + std::to_string(kSize), 64, 4));
+  ASSERT_TRUE(file->Open());
+  ASSERT_EQ(static_cast<int64_t>(kSize), file->Size());
+
+  std::string data(kSize, 0);
+  ASSERT_EQ(static_cast<int64_t>(kSize), file->Read(&data[0], kSize));
+  EXPECT_EQ(expected, data);
+  EXPECT_EQ(0, file->Read(&data[0], kSize));
+
+  // Seeks back into a range which was freed.
+  ASSERT_TRUE(file->Seek(100));
+  ASSERT_EQ(50, file->Read(&data[0], 50));
+  EXPECT_EQ(expected.substr(100, 50), data.substr(0, 50));
+  ASSERT_TRUE(file.release()->Close());
+}
+
 }  // namespace shaka
@@ -0,0 +1,251 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/http_multi_client.h"
+
+#include <curl/curl.h>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/threading/worker_pool.h"
+
+// curl_multi_poll() and curl_multi_wakeup() were added in curl 7.68.0.
+#if LIBCURL_VERSION_NUM >= 0x074400
+#define HAS_CURL_MULTI_WAKEUP 1
+#else
+#define HAS_CURL_MULTI_WAKEUP 0
+#endif
+
+namespace shaka {
+
+class HttpMultiClient::Transfer {
+ public:
+  Transfer(CURL* curl,
+           IoCache* upload_cache,
+           IoCache* download_cache,
+           const DoneCallback& done_callback)
+      : curl(curl),
+        upload_cache(upload_cache),
+        download_cache(download_cache),
+        done_callback(done_callback) {}
+
+  // Returns true if the paused transfer can make progress.
+  bool CanResume() {
+    if (read_paused.load() &&
+        (upload_cache->BytesCached() > 0 || upload_cache->closed())) {
+      return true;
+    }
+    if (write_paused.load() &&
+        (download_cache->BytesFree() >= pending_write_size ||
+         download_cache->closed())) {
+      return true;
+    }
+    return false;
+  }
+
+  CURL* const curl;
+  IoCache* const upload_cache;
+  IoCache* const download_cache;
+  const DoneCallback done_callback;
+
+  // Set by the curl callbacks on the worker thread and checked by Notify() on
+  // the file threads.
+  std::atomic<bool> read_paused{false};
+  std::atomic<bool> write_paused{false};
+  // Size of the data curl failed to deliver when the transfer was paused.
+  uint64_t pending_write_size = 0;
+};
+
+namespace {
+
+#if HAS_CURL_MULTI_WAKEUP
+const int kMaxWaitMs = 1000;
+#else
+// A trade-off between the latency of resuming a paused transfer and CPU
+// wakeups when curl_multi_wakeup() is not available.
+const int kPollIntervalMs = 10;
+#endif  // HAS_CURL_MULTI_WAKEUP
+
+size_t MultiReadCallback(char* buffer, size_t size, size_t nitems, void* user) {
+  HttpMultiClient::Transfer* transfer =
+      static_cast<HttpMultiClient::Transfer*>(user);
+  IoCache* cache = transfer->upload_cache;
+  if (cache->BytesCached() == 0 && !cache->closed()) {
+    // The flag is set before checking the cache again, and Notify() checks the
+    // flag after the cache is updated, so a resume cannot be missed.
+    transfer->read_paused.store(true);
+    if (cache->BytesCached() == 0 && !cache->closed())
+      return CURL_READFUNC_PAUSE;
+    transfer->read_paused.store(false);
+  }
+  // This does not block: there is either data or the cache is closed.
+  return cache->Read(buffer, size * nitems);
+}
+
+size_t MultiWriteCallback(char* buffer, size_t size, size_t nmemb, void* user) {
+  HttpMultiClient::Transfer* transfer =
+      static_cast<HttpMultiClient::Transfer*>(user);
+  IoCache* cache = transfer->download_cache;
+  const size_t length = size * nmemb;
+  if (!cache) {
+    // The response is not consumed. Return the size of the data to avoid curl
+    // errors.
+    return length;
+  }
+  if (cache->BytesFree() < length && !cache->closed()) {
+    // See comments in MultiReadCallback.
+    transfer->pending_write_size = length;
+    transfer->write_paused.store(true);
+    if (cache->BytesFree() < length && !cache->closed())
+      return CURL_WRITEFUNC_PAUSE;
+    transfer->write_paused.store(false);
+  }
+  return cache->Write(buffer, length);
+}
+
+}  // namespace
+
+HttpMultiClient::HttpMultiClient(size_t max_in_flight_transfers)
+    : max_in_flight_transfers_(max_in_flight_transfers),
+      multi_(curl_multi_init()) {
+  CHECK(multi_) << "curl_multi_init() failed.";
+  // Multiplex transfers to the same HTTP/2 server over one connection.
+  curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+}
+
+HttpMultiClient::~HttpMultiClient() {
+  {
+    base::AutoLock auto_lock(lock_);
+    DCHECK(!thread_running_);
+  }
+  curl_multi_cleanup(multi_);
+}
+
+std::shared_ptr<HttpMultiClient::Transfer> HttpMultiClient::Start(
+    CURL* curl,
+    IoCache* upload_cache,
+    IoCache* download_cache,
+    const DoneCallback& done_callback) {
+  std::shared_ptr<Transfer> transfer(
+      new Transfer(curl, upload_cache, download_cache, done_callback));
+
+  if (upload_cache) {
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, &MultiReadCallback);
+    curl_easy_setopt(curl, CURLOPT_READDATA, transfer.get());
+  }
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &MultiWriteCallback);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, transfer.get());
+  // Prefer waiting for an existing connection that can multiplex over opening
+  // a new one.
+  curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+
+  base::AutoLock auto_lock(lock_);
+  queued_transfers_.push_back(transfer);
+  if (thread_running_) {
+    Wakeup();
+  } else {
+    thread_running_ = true;
+    base::WorkerPool::PostTask(
+        FROM_HERE,
+        base::Bind(&HttpMultiClient::ThreadMain, base::Unretained(this)),
+        /* task_is_slow= */ true);
+  }
+  return transfer;
+}
+
+void HttpMultiClient::Notify(const std::shared_ptr<Transfer>& transfer) {
+  if (transfer->read_paused.load() || transfer->write_paused.load())
+    Wakeup();
+}
+
+void HttpMultiClient::ThreadMain() {
+  while (StartQueuedTransfers()) {
+    ResumeTransfers();
+
+    int running_handles = 0;
+    CURLMcode res = curl_multi_perform(multi_, &running_handles);
+    LOG_IF(ERROR, res != CURLM_OK)
+        << "curl_multi_perform() failed: " << curl_multi_strerror(res);
+
+    FinishCompletedTransfers();
+    if (active_transfers_.empty())
+      continue;
+
+#if HAS_CURL_MULTI_WAKEUP
+    res = curl_multi_poll(multi_, nullptr, 0, kMaxWaitMs, nullptr);
+#else
+    // Without a wakeup, resumable and newly queued transfers are only noticed
+    // after the wait times out.
+    res = curl_multi_wait(multi_, nullptr, 0, kPollIntervalMs, nullptr);
+#endif  // HAS_CURL_MULTI_WAKEUP
+    LOG_IF(ERROR, res != CURLM_OK)
+        << "Waiting for HTTP transfers failed: " << curl_multi_strerror(res);
+  }
+}
+
+bool HttpMultiClient::StartQueuedTransfers() {
+  base::AutoLock auto_lock(lock_);
+  while (!queued_transfers_.empty() &&
+         (max_in_flight_transfers_ == 0 ||
+          active_transfers_.size() < max_in_flight_transfers_)) {
+    std::shared_ptr<Transfer> transfer = queued_transfers_.front();
+    queued_transfers_.pop_front();
+    CURLMcode res = curl_multi_add_handle(multi_, transfer->curl);
+    if (res != CURLM_OK) {
+      LOG(ERROR) << "curl_multi_add_handle() failed: "
+                 << curl_multi_strerror(res);
+      transfer->done_callback.Run(CURLE_FAILED_INIT);
+      continue;
+    }
+    active_transfers_[transfer->curl] = transfer;
+  }
+  if (active_transfers_.empty()) {
+    // Checked and cleared under the lock, so Start() either sees the thread
+    // running or starts a new one.
+    thread_running_ = false;
+    return false;
+  }
+  return true;
+}
+
+void HttpMultiClient::ResumeTransfers() {
+  for (const auto& entry : active_transfers_) {
+    Transfer* transfer = entry.second.get();
+    if (!transfer->CanResume())
+      continue;
+    transfer->read_paused.store(false);
+    transfer->write_paused.store(false);
+    // This may call the read and write callbacks right away, which pause the
+    // transfer again if it still cannot make progress.
+    curl_easy_pause(transfer->curl, CURLPAUSE_CONT);
+  }
+}
+
+void HttpMultiClient::FinishCompletedTransfers() {
+  int messages_left = 0;
+  while (CURLMsg* message = curl_multi_info_read(multi_, &messages_left)) {
+    if (message->msg != CURLMSG_DONE)
+      continue;
+    CURL* curl = message->easy_handle;
+    const CURLcode result = message->data.result;
+    curl_multi_remove_handle(multi_, curl);
+
+    auto iter = active_transfers_.find(curl);
+    DCHECK(iter != active_transfers_.end());
+    std::shared_ptr<Transfer> transfer = iter->second;
+    active_transfers_.erase(iter);
+    // The owner of |curl| may destroy it once notified.
+    transfer->done_callback.Run(result);
+  }
+}
+
+void HttpMultiClient::Wakeup() {
+#if HAS_CURL_MULTI_WAKEUP
+  curl_multi_wakeup(multi_);
+#endif  // HAS_CURL_MULTI_WAKEUP
+}
+
+}  // namespace shaka
@@ -0,0 +1,91 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_HTTP_MULTI_CLIENT_H_
+#define PACKAGER_FILE_HTTP_MULTI_CLIENT_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+
+#include "packager/base/callback.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/file/io_cache.h"
+
+typedef void CURL;
+typedef void CURLM;
+
+namespace shaka {
+
+/// Drives HTTP transfers of many files on a single curl multi handle, so
+/// connections and TLS sessions are reused across files, and requests to the
+/// same HTTP/2 server are multiplexed on one connection. All transfers run on
+/// one worker thread, which only runs while there are transfers.
+///
+/// Transfers exchange data through IoCache objects without ever blocking the
+/// worker thread: a transfer is paused while its upload cache is empty or its
+/// download cache is full, and resumed after Notify() is called.
+class HttpMultiClient {
+ public:
+  /// Called on the worker thread when a transfer completes, with the curl
+  /// result code.
+  typedef base::Callback<void(int)> DoneCallback;
+
+  class Transfer;
+
+  /// @param max_in_flight_transfers is the maximum number of concurrent
+  ///        transfers. Transfers started beyond that are queued. 0 means no
+  ///        limit.
+  explicit HttpMultiClient(size_t max_in_flight_transfers);
+  ~HttpMultiClient();
+
+  /// Start the transfer set up in @a curl. The read and write callbacks of @a
+  /// curl are overridden to use the caches.
+  /// @param upload_cache is the source of the request body, can be null.
+  /// @param download_cache receives the response body, can be null, in which
+  ///        case the response body is discarded.
+  /// @param done_callback is called when the transfer completes. @a curl and
+  ///        the caches must stay alive until then.
+  /// @return The transfer, to be passed to Notify().
+  std::shared_ptr<Transfer> Start(CURL* curl,
+                                  IoCache* upload_cache,
+                                  IoCache* download_cache,
+                                  const DoneCallback& done_callback);
+
+  /// Notify the client that data was written to the upload cache, data was
+  /// read from the download cache, or that one of them was closed, so that
+  /// @a transfer can resume if it was paused.
+  void Notify(const std::shared_ptr<Transfer>& transfer);
+
+  HttpMultiClient(const HttpMultiClient&) = delete;
+  HttpMultiClient& operator=(const HttpMultiClient&) = delete;
+
+ private:
+  void ThreadMain();
+  // Adds queued transfers to the multi handle. Returns false if there is
+  // nothing left to transfer, in which case the worker thread should exit.
+  bool StartQueuedTransfers();
+  void ResumeTransfers();
+  void FinishCompletedTransfers();
+  void Wakeup();
+
+  const size_t max_in_flight_transfers_;
+  CURLM* multi_;
+
+  base::Lock lock_;
+  std::deque<std::shared_ptr<Transfer>> queued_transfers_;
+  bool thread_running_ = false;
+
+  // Only accessed on the worker thread.
+  std::map<CURL*, std::shared_ptr<Transfer>> active_transfers_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_HTTP_MULTI_CLIENT_H_
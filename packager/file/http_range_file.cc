@@ -0,0 +1,270 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/http_range_file.h"
+
+#include <gflags/gflags.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/file/http_file.h"
+#include "packager/file/http_request.h"
+#include "packager/status_macros.h"
+
+DEFINE_int32(http_range_requests,
+             0,
+             "If positive, HTTP inputs are read with this many concurrent "
+             "ranged GET requests ahead of the read position, and can seek. "
+             "Otherwise they are read with a single GET request.");
+DEFINE_uint64(http_range_size,
+              8 << 20,
+              "Size of the ranges requested when --http_range_requests is "
+              "set.");
+
+namespace shaka {
+
+namespace {
+
+// Sends a HEAD request if |range| is empty, or a GET request of |range|
+// otherwise.
+Status PerformRequest(const std::string& url,
+                      const std::string& range,
+                      HttpResponse* response) {
+  HttpRequest request;
+  request.method = range.empty() ? "HEAD" : "GET";
+  request.url = url;
+  if (!range.empty())
+    request.headers.push_back("Range: bytes=" + range);
+  request.follow_redirects = true;
+  RETURN_IF_ERROR(PerformHttpRequest(request, response));
+  // A range request answered with the whole resource is a failure too.
+  if (!range.empty() && response->code != 206) {
+    return Status(error::HTTP_FAILURE,
+                  base::StringPrintf("GET %s: response code %ld.", url.c_str(),
+                                     response->code));
+  }
+  return Status::OK;
+}
+
+}  // namespace
+
+struct HttpRangeFile::Range {
+  Range()
+      : done(base::WaitableEvent::ResetPolicy::AUTOMATIC,
+             base::WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+  // The data of the range. Its capacity is kept when the range is reused.
+  std::string data;
+  uint64_t offset = 0;
+  size_t size = 0;
+  Status status;
+  // Signaled when the range is received.
+  base::WaitableEvent done;
+};
+
+HttpRangeFile::HttpRangeFile(const std::string& url,
+                             size_t range_size,
+                             int max_requests)
+    : File(url),
+      url_(url),
+      range_size_(std::max(range_size, static_cast<size_t>(1))),
+      max_requests_(std::max(max_requests, 1)) {}
+
+HttpRangeFile::~HttpRangeFile() {}
+
+bool HttpRangeFile::Open() {
+  HttpResponse response;
+  Status status = PerformRequest(url_, "", &response);
+  if (!status.ok()) {
+    LOG(ERROR) << "Cannot open " << url_ << ": " << status;
+    return false;
+  }
+  if (response.headers["accept-ranges"] != "bytes" ||
+      !base::StringToUint64(response.headers["content-length"], &size_)) {
+    VLOG(1) << url_ << " does not support ranges. Reading it sequentially.";
+    sequential_file_ = new HttpFile(HttpMethod::kGet, url_);
+    if (!sequential_file_->Open()) {
+      sequential_file_->Close();
+      sequential_file_ = nullptr;
+      return false;
+    }
+    return true;
+  }
+
+  for (int i = 0; i < max_requests_; ++i) {
+    ranges_.emplace_back(new Range);
+    free_ranges_.push_back(ranges_.back().get());
+  }
+  return true;
+}
+
+bool HttpRangeFile::Close() {
+  bool result = true;
+  if (sequential_file_)
+    result = sequential_file_->Close();
+  DrainRequests();
+  delete this;
+  return result;
+}
+
+int64_t HttpRangeFile::Read(void* buffer, uint64_t length) {
+  if (sequential_file_) {
+    const int64_t bytes_read = sequential_file_->Read(buffer, length);
+    if (bytes_read > 0)
+      position_ += bytes_read;
+    return bytes_read;
+  }
+  if (!status_.ok())
+    return -1;
+
+  uint8_t* data = static_cast<uint8_t*>(buffer);
+  uint64_t bytes_read = 0;
+  while (bytes_read < length && position_ < size_) {
+    if (!current_range_) {
+      QueueRequests();
+      DCHECK(!queued_ranges_.empty());
+      Range* range = queued_ranges_.front();
+      queued_ranges_.pop_front();
+      range->done.Wait();
+      if (!range->status.ok()) {
+        status_ = range->status;
+        LOG(ERROR) << "Cannot read " << url_ << ": " << status_;
+        free_ranges_.push_back(range);
+        return bytes_read > 0 ? static_cast<int64_t>(bytes_read) : -1;
+      }
+      current_range_ = range;
+    }
+
+    const size_t offset_in_range =
+        static_cast<size_t>(position_ - current_range_->offset);
+    const size_t size =
+        std::min(current_range_->data.size() - offset_in_range,
+                 static_cast<size_t>(length - bytes_read));
+    memcpy(data + bytes_read, current_range_->data.data() + offset_in_range,
+           size);
+    bytes_read += size;
+    position_ += size;
+    if (offset_in_range + size == current_range_->data.size()) {
+      free_ranges_.push_back(current_range_);
+      current_range_ = nullptr;
+    }
+  }
+  return bytes_read;
+}
+
+int64_t HttpRangeFile::Write(const void* buffer, uint64_t length) {
+  NOTIMPLEMENTED() << "HttpRangeFile is read only.";
+  return -1;
+}
+
+int64_t HttpRangeFile::Size() {
+  return sequential_file_ ? -1 : size_;
+}
+
+bool HttpRangeFile::Flush() {
+  NOTIMPLEMENTED() << "HttpRangeFile is read only.";
+  return false;
+}
+
+bool HttpRangeFile::Seek(uint64_t position) {
+  if (sequential_file_) {
+    LOG(ERROR) << url_ << " does not support ranges, so it cannot seek.";
+    return false;
+  }
+  if (!status_.ok())
+    return false;
+  position = std::min(position, size_);
+  if (current_range_ && position >= current_range_->offset &&
+      position < current_range_->offset + current_range_->data.size()) {
+    position_ = position;
+    return true;
+  }
+  if (current_range_) {
+    free_ranges_.push_back(current_range_);
+    current_range_ = nullptr;
+  }
+  // Keeps the ranges requested if they follow the new position, e.g. when
+  // skipping forward.
+  while (!queued_ranges_.empty() &&
+         queued_ranges_.front()->offset + queued_ranges_.front()->size <=
+             position) {
+    Range* range = queued_ranges_.front();
+    queued_ranges_.pop_front();
+    range->done.Wait();
+    free_ranges_.push_back(range);
+  }
+  if (queued_ranges_.empty() || queued_ranges_.front()->offset > position) {
+    DrainRequests();
+    request_offset_ = position;
+  }
+  position_ = position;
+  return true;
+}
+
+bool HttpRangeFile::Tell(uint64_t* position) {
+  *position = position_;
+  return true;
+}
+
+void HttpRangeFile::QueueRequests() {
+  while (!free_ranges_.empty() && request_offset_ < size_) {
+    Range* range = free_ranges_.back();
+    free_ranges_.pop_back();
+    range->offset = request_offset_;
+    range->size = static_cast<size_t>(
+        std::min(static_cast<uint64_t>(range_size_), size_ - request_offset_));
+    request_offset_ += range->size;
+    queued_ranges_.push_back(range);
+    base::WorkerPool::PostTask(
+        FROM_HERE,
+        base::Bind(&HttpRangeFile::FetchRange, base::Unretained(this),
+                   base::Unretained(range)),
+        true);
+  }
+}
+
+void HttpRangeFile::DrainRequests() {
+  while (!queued_ranges_.empty()) {
+    Range* range = queued_ranges_.front();
+    queued_ranges_.pop_front();
+    range->done.Wait();
+    free_ranges_.push_back(range);
+  }
+  if (current_range_) {
+    free_ranges_.push_back(current_range_);
+    current_range_ = nullptr;
+  }
+}
+
+void HttpRangeFile::FetchRange(Range* range) {
+  HttpResponse response;
+  // The capacity of the range data is kept across requests.
+  response.body.swap(range->data);
+  range->status = PerformRequest(
+      url_,
+      base::StringPrintf("%" PRIu64 "-%" PRIu64, range->offset,
+                         range->offset + range->size - 1),
+      &response);
+  range->data.swap(response.body);
+  if (range->status.ok() && range->data.size() != range->size) {
+    range->status = Status(
+        error::HTTP_FAILURE,
+        base::StringPrintf("Expecting %zu bytes at offset %" PRIu64
+                           ", received %zu.",
+                           range->size, range->offset, range->data.size()));
+  }
+  range->done.Signal();
+}
+
+}  // namespace shaka
@@ -0,0 +1,87 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_HTTP_RANGE_FILE_H_
+#define PACKAGER_FILE_HTTP_RANGE_FILE_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/file/file.h"
+#include "packager/status.h"
+
+namespace shaka {
+
+/// Reads an HTTP resource with several concurrent ranged GET requests ahead of
+/// the read position, and supports Seek(), unlike HttpFile. Falls back to a
+/// single GET request through HttpFile if the server does not advertise
+/// support for byte ranges.
+class HttpRangeFile : public File {
+ public:
+  /// @param url is the URL of the resource.
+  /// @param range_size is the size of the ranges requested.
+  /// @param max_requests is the maximum number of ranges requested at a time.
+  HttpRangeFile(const std::string& url, size_t range_size, int max_requests);
+
+  HttpRangeFile(const HttpRangeFile&) = delete;
+  HttpRangeFile& operator=(const HttpRangeFile&) = delete;
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+ protected:
+  ~HttpRangeFile() override;
+
+  bool Open() override;
+
+ private:
+  struct Range;
+
+  // Requests the ranges following the last one requested, for the free
+  // ranges.
+  void QueueRequests();
+  // Waits for the ranges requested, ignoring their status, and frees them.
+  void DrainRequests();
+
+  // Run on worker threads.
+  void FetchRange(Range* range);
+
+  const std::string url_;
+  const size_t range_size_;
+  const int max_requests_;
+  Status status_;
+
+  uint64_t size_ = 0;
+  uint64_t position_ = 0;
+  // Offset of the range following the last range requested.
+  uint64_t request_offset_ = 0;
+
+  std::vector<std::unique_ptr<Range>> ranges_;
+  std::vector<Range*> free_ranges_;
+  // Ranges requested, in order.
+  std::deque<Range*> queued_ranges_;
+  // The range being read from, if any.
+  Range* current_range_ = nullptr;
+
+  // Set if the server does not support ranges.
+  File* sequential_file_ = nullptr;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_HTTP_RANGE_FILE_H_
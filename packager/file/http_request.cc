@@ -0,0 +1,145 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/http_request.h"
+
+#include <curl/curl.h>
+#include <gflags/gflags.h>
+
+#include <memory>
+#include <utility>
+
+#include "packager/base/strings/string_util.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/time/time.h"
+#include "packager/file/http_file.h"
+#include "packager/version/version.h"
+
+DECLARE_string(user_agent);
+DECLARE_string(ca_file);
+DECLARE_bool(disable_peer_verification);
+
+namespace shaka {
+
+namespace {
+
+const int kMaxAttempts = 3;
+
+size_t AppendToString(char* data, size_t size, size_t nmemb, void* user) {
+  static_cast<std::string*>(user)->append(data, size * nmemb);
+  return size * nmemb;
+}
+
+size_t ParseHeader(char* data, size_t size, size_t nitems, void* user) {
+  const std::string header(data, size * nitems);
+  const size_t colon = header.find(':');
+  if (colon != std::string::npos) {
+    std::string value;
+    base::TrimWhitespaceASCII(header.substr(colon + 1), base::TRIM_ALL,
+                              &value);
+    (*static_cast<std::map<std::string, std::string>*>(user))
+        [base::ToLowerASCII(header.substr(0, colon))] = value;
+  }
+  return size * nitems;
+}
+
+HttpRequestHandler* GetRequestHandlerForTesting() {
+  static HttpRequestHandler* handler = new HttpRequestHandler;
+  return handler;
+}
+
+}  // namespace
+
+Status PerformHttpRequest(const HttpRequest& request, HttpResponse* response) {
+  const HttpRequestHandler& handler_for_testing =
+      *GetRequestHandlerForTesting();
+  if (handler_for_testing)
+    return handler_for_testing(request, response);
+
+  std::unique_ptr<curl_slist, void (*)(curl_slist*)> headers(
+      nullptr, &curl_slist_free_all);
+  for (const std::string& header : request.headers) {
+    headers.reset(curl_slist_append(headers.release(), header.c_str()));
+    if (!headers)
+      return Status(error::HTTP_FAILURE, "Cannot allocate request headers.");
+  }
+
+  const std::string user_agent =
+      FLAGS_user_agent.empty() ? "ShakaPackager/" + GetPackagerVersion()
+                               : FLAGS_user_agent;
+  Status status;
+  for (int attempt = 1; attempt <= kMaxAttempts; ++attempt) {
+    if (attempt > 1)
+      base::PlatformThread::Sleep(base::TimeDelta::FromSeconds(attempt - 1));
+
+    std::unique_ptr<CURL, void (*)(CURL*)> curl(curl_easy_init(),
+                                                &curl_easy_cleanup);
+    if (!curl)
+      return Status(error::HTTP_FAILURE, "Cannot initialize curl.");
+    response->code = 0;
+    response->body.clear();
+    response->headers.clear();
+
+    if (request.method == "GET") {
+      curl_easy_setopt(curl.get(), CURLOPT_HTTPGET, 1L);
+    } else if (request.method == "HEAD") {
+      curl_easy_setopt(curl.get(), CURLOPT_NOBODY, 1L);
+    } else {
+      curl_easy_setopt(curl.get(), CURLOPT_CUSTOMREQUEST,
+                       request.method.c_str());
+      if (request.method != "DELETE") {
+        curl_easy_setopt(curl.get(), CURLOPT_POSTFIELDS,
+                         request.body ? request.body : "");
+        curl_easy_setopt(curl.get(), CURLOPT_POSTFIELDSIZE_LARGE,
+                         static_cast<curl_off_t>(request.body_size));
+      }
+    }
+    curl_easy_setopt(curl.get(), CURLOPT_URL, request.url.c_str());
+    curl_easy_setopt(curl.get(), CURLOPT_USERAGENT, user_agent.c_str());
+    curl_easy_setopt(curl.get(), CURLOPT_HTTPHEADER, headers.get());
+    if (request.follow_redirects)
+      curl_easy_setopt(curl.get(), CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl.get(), CURLOPT_SHARE, HttpFile::GetCurlShare());
+    curl_easy_setopt(curl.get(), CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, &AppendToString);
+    curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &response->body);
+    curl_easy_setopt(curl.get(), CURLOPT_HEADERFUNCTION, &ParseHeader);
+    curl_easy_setopt(curl.get(), CURLOPT_HEADERDATA, &response->headers);
+    if (FLAGS_disable_peer_verification)
+      curl_easy_setopt(curl.get(), CURLOPT_SSL_VERIFYPEER, 0L);
+    if (!FLAGS_ca_file.empty())
+      curl_easy_setopt(curl.get(), CURLOPT_CAINFO, FLAGS_ca_file.c_str());
+
+    const CURLcode res = curl_easy_perform(curl.get());
+    if (res != CURLE_OK) {
+      status = Status(
+          res == CURLE_OPERATION_TIMEDOUT ? error::TIME_OUT
+                                          : error::HTTP_FAILURE,
+          base::StringPrintf("%s %s: %s", request.method.c_str(),
+                             request.url.c_str(), curl_easy_strerror(res)));
+      continue;
+    }
+    curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &response->code);
+    if (response->code < 300)
+      return Status::OK;
+    status = Status(error::HTTP_FAILURE,
+                    base::StringPrintf("%s %s: response code %ld. %s",
+                                       request.method.c_str(),
+                                       request.url.c_str(), response->code,
+                                       response->body.c_str()));
+    // Only server errors and throttling are worth retrying.
+    if (response->code < 500 && response->code != 429)
+      break;
+  }
+  return status;
+}
+
+void SetHttpRequestHandlerForTesting(HttpRequestHandler handler) {
+  *GetRequestHandlerForTesting() = std::move(handler);
+}
+
+}  // namespace shaka
@@ -0,0 +1,58 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_HTTP_REQUEST_H_
+#define PACKAGER_FILE_HTTP_REQUEST_H_
+
+#include <stddef.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "packager/status.h"
+
+namespace shaka {
+
+/// A single HTTP request, with its whole body in memory, unlike the streams of
+/// HttpFile.
+struct HttpRequest {
+  /// GET, HEAD, or any other method, which then sends @a body.
+  std::string method = "GET";
+  std::string url;
+  /// Each in the "Name: value" form.
+  std::vector<std::string> headers;
+  const char* body = nullptr;
+  size_t body_size = 0;
+  bool follow_redirects = false;
+};
+
+struct HttpResponse {
+  long code = 0;
+  std::string body;
+  /// By lowercase name.
+  std::map<std::string, std::string> headers;
+};
+
+/// Performs @a request with the --user_agent, --ca_file and
+/// --disable_peer_verification settings of HttpFile, sharing its connections.
+/// Network failures, server errors and throttling are retried.
+/// @return OK if the response code is less than 300. @a response holds the
+///         response of the last attempt in any case.
+Status PerformHttpRequest(const HttpRequest& request, HttpResponse* response);
+
+using HttpRequestHandler =
+    std::function<Status(const HttpRequest& request, HttpResponse* response)>;
+
+/// Makes PerformHttpRequest() pass the requests to @a handler instead of
+/// sending them, e.g. to fake a server in tests. @a handler is called from
+/// any thread. A null handler restores the default.
+void SetHttpRequestHandlerForTesting(HttpRequestHandler handler);
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_HTTP_REQUEST_H_
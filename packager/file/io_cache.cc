@@ -14,22 +14,21 @@
 
 namespace shaka {
 
-using base::AutoLock;
-using base::AutoUnlock;
-
 IoCache::IoCache(uint64_t cache_size)
     : cache_size_(cache_size),
+      circular_buffer_(cache_size),
+      circular_buffer_memory_(MemorySubsystem::kIoCache),
+      read_pos_(0),
+      write_pos_(0),
+      closed_(false),
+      reader_waiting_(false),
+      writer_waiting_(false),
       read_event_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
                   base::WaitableEvent::InitialState::NOT_SIGNALED),
       write_event_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
-                   base::WaitableEvent::InitialState::NOT_SIGNALED),
-      // Make the buffer one byte larger than the cache so that when the
-      // condition r_ptr == w_ptr is unambiguous (buffer empty).
-      circular_buffer_(cache_size + 1),
-      end_ptr_(&circular_buffer_[0] + cache_size + 1),
-      r_ptr_(circular_buffer_.data()),
-      w_ptr_(circular_buffer_.data()),
-      closed_(false) {}
+                   base::WaitableEvent::InitialState::NOT_SIGNALED) {
+  circular_buffer_memory_.Set(cache_size);
+}
 
 IoCache::~IoCache() {
   Close();
@@ -38,119 +37,168 @@ IoCache::~IoCache() {
 uint64_t IoCache::Read(void* buffer, uint64_t size) {
   DCHECK(buffer);
 
-  AutoLock lock(lock_);
-  while (!closed_ && (BytesCachedInternal() == 0)) {
-    AutoUnlock unlock(lock_);
-    write_event_.Wait();
-  }
-
-  size = std::min(size, BytesCachedInternal());
-  uint64_t first_chunk_size(
-      std::min(size, static_cast<uint64_t>(end_ptr_ - r_ptr_)));
-  memcpy(buffer, r_ptr_, first_chunk_size);
-  r_ptr_ += first_chunk_size;
-  DCHECK_GE(end_ptr_, r_ptr_);
-  if (r_ptr_ == end_ptr_)
-    r_ptr_ = &circular_buffer_[0];
-  uint64_t second_chunk_size(size - first_chunk_size);
+  while (!closed_.load() && BytesCached() == 0)
+    WaitForData();
+
+  // Only this thread updates |read_pos_|.
+  const uint64_t read_pos = read_pos_.load(std::memory_order_relaxed);
+  size = std::min(size, write_pos_.load() - read_pos);
+  // The buffer may be resized by the writer while the cache is empty.
+  if (size == 0)
+    return 0;
+  const uint64_t cache_size = cache_size_.load();
+  const uint64_t offset = read_pos % cache_size;
+  const uint64_t first_chunk_size = std::min(size, cache_size - offset);
+  memcpy(buffer, &circular_buffer_[offset], first_chunk_size);
+  const uint64_t second_chunk_size = size - first_chunk_size;
   if (second_chunk_size) {
-    memcpy(static_cast<uint8_t*>(buffer) + first_chunk_size, r_ptr_,
-           second_chunk_size);
-    r_ptr_ += second_chunk_size;
-    DCHECK_GT(end_ptr_, r_ptr_);
+    memcpy(static_cast<uint8_t*>(buffer) + first_chunk_size,
+           circular_buffer_.data(), second_chunk_size);
   }
-  read_event_.Signal();
+  read_pos_.store(read_pos + size);
+
+  if (writer_waiting_.load())
+    read_event_.Signal();
   return size;
 }
 
+uint64_t IoCache::Peek(const uint8_t** data, uint64_t size) {
+  DCHECK(data);
+
+  while (!closed_.load() && BytesCached() == 0)
+    WaitForData();
+
+  const uint64_t read_pos = read_pos_.load(std::memory_order_relaxed);
+  size = std::min(size, write_pos_.load() - read_pos);
+  if (size == 0)
+    return 0;
+  // The writer neither resizes nor overwrites the buffer before the data is
+  // consumed.
+  const uint64_t cache_size = cache_size_.load();
+  const uint64_t offset = read_pos % cache_size;
+  *data = &circular_buffer_[offset];
+  return std::min(size, cache_size - offset);
+}
+
+void IoCache::Consume(uint64_t size) {
+  DCHECK_LE(size, BytesCached());
+  read_pos_.store(read_pos_.load(std::memory_order_relaxed) + size);
+
+  if (writer_waiting_.load())
+    read_event_.Signal();
+}
+
 uint64_t IoCache::Write(const void* buffer, uint64_t size) {
   DCHECK(buffer);
 
   const uint8_t* r_ptr(static_cast<const uint8_t*>(buffer));
   uint64_t bytes_left(size);
   while (bytes_left) {
-    AutoLock lock(lock_);
-    while (!closed_ && (BytesFreeInternal() == 0)) {
-      AutoUnlock unlock(lock_);
+    while (!closed_.load() && BytesFree() == 0) {
       VLOG(1) << "Circular buffer is full, which can happen if data arrives "
                  "faster than being consumed by packager. Ignore if it is not "
                  "live packaging. Otherwise, try increasing --io_cache_size.";
-      read_event_.Wait();
+      ++writer_stats_.num_waits_for_space;
+      WaitForSpace();
     }
-    if (closed_)
+    if (closed_.load())
       return 0;
 
-    uint64_t write_size(std::min(bytes_left, BytesFreeInternal()));
-    uint64_t first_chunk_size(
-        std::min(write_size, static_cast<uint64_t>(end_ptr_ - w_ptr_)));
-    memcpy(w_ptr_, r_ptr, first_chunk_size);
-    w_ptr_ += first_chunk_size;
-    DCHECK_GE(end_ptr_, w_ptr_);
-    if (w_ptr_ == end_ptr_)
-      w_ptr_ = &circular_buffer_[0];
+    // Only this thread updates |write_pos_|.
+    const uint64_t write_pos = write_pos_.load(std::memory_order_relaxed);
+    const uint64_t write_size(std::min(bytes_left, BytesFree()));
+    const uint64_t cache_size = cache_size_.load(std::memory_order_relaxed);
+    const uint64_t offset = write_pos % cache_size;
+    const uint64_t first_chunk_size =
+        std::min(write_size, cache_size - offset);
+    memcpy(&circular_buffer_[offset], r_ptr, first_chunk_size);
     r_ptr += first_chunk_size;
-    uint64_t second_chunk_size(write_size - first_chunk_size);
+    const uint64_t second_chunk_size(write_size - first_chunk_size);
     if (second_chunk_size) {
-      memcpy(w_ptr_, r_ptr, second_chunk_size);
-      w_ptr_ += second_chunk_size;
-      DCHECK_GT(end_ptr_, w_ptr_);
+      memcpy(circular_buffer_.data(), r_ptr, second_chunk_size);
       r_ptr += second_chunk_size;
     }
+    write_pos_.store(write_pos + write_size);
     bytes_left -= write_size;
-    write_event_.Signal();
+    writer_stats_.bytes_written += write_size;
+    writer_stats_.max_bytes_cached =
+        std::max(writer_stats_.max_bytes_cached, BytesCached());
+
+    if (reader_waiting_.load())
+      write_event_.Signal();
   }
   return size;
 }
 
 void IoCache::Clear() {
-  AutoLock lock(lock_);
-  r_ptr_ = w_ptr_ = circular_buffer_.data();
+  read_pos_.store(write_pos_.load());
   // Let any writers know that there is room in the cache.
   read_event_.Signal();
 }
 
 void IoCache::Close() {
-  AutoLock lock(lock_);
-  closed_ = true;
+  closed_.store(true);
   read_event_.Signal();
   write_event_.Signal();
 }
 
 void IoCache::Reopen() {
-  AutoLock lock(lock_);
-  CHECK(closed_);
-  r_ptr_ = w_ptr_ = circular_buffer_.data();
-  closed_ = false;
+  CHECK(closed_.load());
+  read_pos_.store(0);
+  write_pos_.store(0);
   read_event_.Reset();
   write_event_.Reset();
+  closed_.store(false);
 }
 
 uint64_t IoCache::BytesCached() {
-  AutoLock lock(lock_);
-  return BytesCachedInternal();
+  return write_pos_.load() - read_pos_.load();
 }
 
 uint64_t IoCache::BytesFree() {
-  AutoLock lock(lock_);
-  return BytesFreeInternal();
+  return cache_size_.load() - BytesCached();
 }
 
-uint64_t IoCache::BytesCachedInternal() {
-  return (r_ptr_ <= w_ptr_)
-             ? w_ptr_ - r_ptr_
-             : (end_ptr_ - r_ptr_) + (w_ptr_ - circular_buffer_.data());
+bool IoCache::ResizeIfEmpty(uint64_t cache_size) {
+  DCHECK_GT(cache_size, 0u);
+  // The reader does not touch the buffer while the cache is empty, and the
+  // cache cannot be filled but by this thread.
+  if (closed_.load() || BytesCached() != 0)
+    return false;
+  circular_buffer_.Reset(cache_size);
+  circular_buffer_memory_.Set(cache_size);
+  cache_size_.store(cache_size);
+  writer_stats_ = WriterStats();
+  return true;
 }
 
-uint64_t IoCache::BytesFreeInternal() {
-  return cache_size_ - BytesCachedInternal();
+void IoCache::WaitUntilEmptyOrClosed() {
+  // See comments in WaitForData.
+  while (!closed_.load() && BytesCached()) {
+    writer_waiting_.store(true);
+    if (!closed_.load() && BytesCached())
+      read_event_.Wait();
+    writer_waiting_.store(false);
+  }
 }
 
-void IoCache::WaitUntilEmptyOrClosed() {
-  AutoLock lock(lock_);
-  while (!closed_ && BytesCachedInternal()) {
-    AutoUnlock unlock(lock_);
+void IoCache::WaitForData() {
+  // The flag is set before checking the condition again, and the writer
+  // checks the flag after updating |write_pos_|; with sequentially consistent
+  // atomics, either this thread sees the new data or the writer sees the flag
+  // and signals the event, so a wake up cannot be missed.
+  reader_waiting_.store(true);
+  if (!closed_.load() && BytesCached() == 0)
+    write_event_.Wait();
+  reader_waiting_.store(false);
+}
+
+void IoCache::WaitForSpace() {
+  // See comments in WaitForData.
+  writer_waiting_.store(true);
+  if (!closed_.load() && BytesFree() == 0)
     read_event_.Wait();
-  }
+  writer_waiting_.store(false);
 }
 
 }  // namespace shaka
@@ -8,14 +8,22 @@
 #define PACKAGER_FILE_IO_CACHE_H_
 
 #include <stdint.h>
-#include <vector>
+
+#include <atomic>
+
 #include "packager/base/macros.h"
-#include "packager/base/synchronization/lock.h"
 #include "packager/base/synchronization/waitable_event.h"
+#include "packager/file/large_buffer.h"
+#include "packager/file/memory_budget.h"
 
 namespace shaka {
 
-/// Declaration of class which implements a thread-safe circular buffer.
+/// Declaration of class which implements a thread-safe circular buffer for a
+/// single producer and a single consumer. Read and Write do not take any locks;
+/// they only block, waiting on an event, when the cache is empty or full
+/// respectively.
+/// Read must be called from one thread and Write from one (other) thread.
+/// Close can be called from any thread.
 class IoCache {
  public:
   explicit IoCache(uint64_t cache_size);
@@ -29,6 +37,22 @@ class IoCache {
   ///         unblocked because the cache has been closed and is empty.
   uint64_t Read(void* buffer, uint64_t size);
 
+  /// Get the cached data in place, without copying it. This function may
+  /// block until there is data in the cache. The data stays in the cache until
+  /// Consume() is called.
+  /// @param data receives a pointer to the cached data.
+  /// @param size is the maximum number of bytes wanted.
+  /// @return the number of contiguous bytes at @a data, which may be less
+  ///         than the bytes cached if they wrap around the circular buffer,
+  ///         or 0 if the call unblocked because the cache has been closed and
+  ///         is empty.
+  uint64_t Peek(const uint8_t** data, uint64_t size);
+
+  /// Removes data returned by Peek() from the cache.
+  /// @param size is the number of bytes to remove, which should not be larger
+  ///        than the value returned by Peek().
+  void Consume(uint64_t size);
+
   /// Write data to the cache. This function may block until there is enough
   /// room in the cache.
   /// @param buffer is a buffer containing the data to be written to the cache.
@@ -38,7 +62,7 @@ class IoCache {
   ///         closed.
   uint64_t Write(const void* buffer, uint64_t size);
 
-  /// Empties the cache.
+  /// Empties the cache. Should be called from the reader thread.
   void Clear();
 
   /// Close the cache. This will call any blocking calls to unblock, and the
@@ -46,9 +70,10 @@ class IoCache {
   void Close();
 
   /// @return true if the cache is closed, false otherwise.
-  bool closed() { return closed_; }
+  bool closed() { return closed_.load(); }
 
-  /// Reopens the cache. Any data still in the cache will be lost.
+  /// Reopens the cache. Any data still in the cache will be lost. Should not be
+  /// called while there are Read or Write calls in progress.
   void Reopen();
 
   /// Returns the number of bytes in the cache.
@@ -59,22 +84,57 @@ class IoCache {
   /// @return the number of free bytes in the cache.
   uint64_t BytesFree();
 
-  /// Waits until the cache is empty or has been closed.
+  /// Waits until the cache is empty or has been closed. Should be called from
+  /// the writer thread.
   void WaitUntilEmptyOrClosed();
 
- private:
-  uint64_t BytesCachedInternal();
-  uint64_t BytesFreeInternal();
+  /// Statistics of the writes since the cache was created or last resized.
+  struct WriterStats {
+    /// Number of bytes written.
+    uint64_t bytes_written = 0;
+    /// Maximum number of bytes cached after a write.
+    uint64_t max_bytes_cached = 0;
+    /// Number of times the writer blocked because the cache was full.
+    uint64_t num_waits_for_space = 0;
+  };
 
-  const uint64_t cache_size_;
-  base::Lock lock_;
+  /// @return the statistics of the writes. Should be called from the writer
+  ///         thread.
+  const WriterStats& writer_stats() const { return writer_stats_; }
+
+  /// @return the size of the cache.
+  uint64_t size() const { return cache_size_.load(); }
+
+  /// Changes the size of the cache, if it is empty and open, and resets the
+  /// writer statistics. Should be called from the writer thread.
+  /// @return true if the cache was resized, false otherwise.
+  bool ResizeIfEmpty(uint64_t cache_size);
+
+ private:
+  // Block the reader until data is written or the cache is closed.
+  void WaitForData();
+  // Block the writer until data is read or the cache is closed.
+  void WaitForSpace();
+
+  // Only changed by the writer while the cache is empty, so the reader never
+  // uses the buffer while it is being replaced.
+  std::atomic<uint64_t> cache_size_;
+  LargeBuffer circular_buffer_;
+  AccountedMemory circular_buffer_memory_;
+  // Total number of bytes read from and written to the cache, which are only
+  // updated by the reader and writer respectively. The positions in
+  // |circular_buffer_| are these counters modulo |cache_size_|.
+  std::atomic<uint64_t> read_pos_;
+  std::atomic<uint64_t> write_pos_;
+  std::atomic<bool> closed_;
+  // Set while the reader / writer is blocked, so the other side only signals
+  // the events when needed.
+  std::atomic<bool> reader_waiting_;
+  std::atomic<bool> writer_waiting_;
   base::WaitableEvent read_event_;
   base::WaitableEvent write_event_;
-  std::vector<uint8_t> circular_buffer_;
-  const uint8_t* end_ptr_;
-  uint8_t* r_ptr_;
-  uint8_t* w_ptr_;
-  bool closed_;
+  // Only accessed by the writer.
+  WriterStats writer_stats_;
 
   DISALLOW_COPY_AND_ASSIGN(IoCache);
 };
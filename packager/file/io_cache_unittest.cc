@@ -10,7 +10,9 @@
 #include <algorithm>
 #include "packager/base/bind.h"
 #include "packager/base/bind_helpers.h"
+#include "packager/base/logging.h"
 #include "packager/base/threading/simple_thread.h"
+#include "packager/base/time/time.h"
 
 namespace {
 const uint64_t kBlockSize = 256;
@@ -237,6 +239,66 @@ TEST_F(IoCacheTest, Reopen) {
   EXPECT_EQ(write_buffer, read_buffer);
 }
 
+TEST_F(IoCacheTest, ResizeIfEmpty) {
+  std::vector<uint8_t> write_buffer;
+  GenerateTestBuffer(kBlockSize, &write_buffer);
+  ASSERT_EQ(kBlockSize, cache_->Write(write_buffer.data(), kBlockSize));
+  EXPECT_EQ(kBlockSize, cache_->writer_stats().bytes_written);
+  EXPECT_FALSE(cache_->ResizeIfEmpty(kCacheSize * 2));
+
+  std::vector<uint8_t> read_buffer(kBlockSize);
+  ASSERT_EQ(kBlockSize, cache_->Read(read_buffer.data(), kBlockSize));
+  ASSERT_TRUE(cache_->ResizeIfEmpty(kCacheSize * 2));
+  EXPECT_EQ(kCacheSize * 2, cache_->size());
+  EXPECT_EQ(0u, cache_->writer_stats().bytes_written);
+
+  // Data wraps around the new buffer.
+  const uint64_t kTestBytes(kCacheSize * 2 - 1);
+  GenerateTestBuffer(kTestBytes, &write_buffer);
+  ASSERT_EQ(kTestBytes, cache_->Write(write_buffer.data(), kTestBytes));
+  read_buffer.resize(kTestBytes);
+  ASSERT_EQ(kTestBytes, cache_->Read(read_buffer.data(), kTestBytes));
+  EXPECT_EQ(write_buffer, read_buffer);
+}
+
+TEST_F(IoCacheTest, PeekAndConsume) {
+  std::vector<uint8_t> write_buffer;
+  GenerateTestBuffer(kCacheSize - kBlockSize, &write_buffer);
+  ASSERT_EQ(write_buffer.size(),
+            cache_->Write(write_buffer.data(), write_buffer.size()));
+  std::vector<uint8_t> read_buffer(kCacheSize - 2 * kBlockSize);
+  ASSERT_EQ(read_buffer.size(),
+            cache_->Read(read_buffer.data(), read_buffer.size()));
+
+  // The data written now wraps around the end of the circular buffer.
+  GenerateTestBuffer(2 * kBlockSize, &write_buffer);
+  ASSERT_EQ(write_buffer.size(),
+            cache_->Write(write_buffer.data(), write_buffer.size()));
+
+  // The last block of the first write, then the new data up to the end of the
+  // circular buffer.
+  const uint8_t* data = nullptr;
+  ASSERT_EQ(kBlockSize, cache_->Peek(&data, kBlockSize));
+  EXPECT_EQ(0, memcmp(reference_block_, data, kBlockSize));
+  // Peeking again returns the same data until it is consumed.
+  const uint8_t* same_data = nullptr;
+  ASSERT_EQ(2 * kBlockSize, cache_->Peek(&same_data, kCacheSize));
+  EXPECT_EQ(data, same_data);
+  cache_->Consume(kBlockSize);
+  EXPECT_EQ(2 * kBlockSize, cache_->BytesCached());
+
+  ASSERT_EQ(kBlockSize, cache_->Peek(&data, kCacheSize));
+  EXPECT_EQ(0, memcmp(write_buffer.data(), data, kBlockSize));
+  cache_->Consume(kBlockSize);
+  ASSERT_EQ(kBlockSize, cache_->Peek(&data, kCacheSize));
+  EXPECT_EQ(0, memcmp(write_buffer.data() + kBlockSize, data, kBlockSize));
+  cache_->Consume(kBlockSize);
+  EXPECT_EQ(0u, cache_->BytesCached());
+
+  cache_->Close();
+  EXPECT_EQ(0u, cache_->Peek(&data, kCacheSize));
+}
+
 TEST_F(IoCacheTest, SingleLargeWrite) {
   const uint64_t kTestBytes(kCacheSize * 10);
 
@@ -272,4 +334,25 @@ TEST_F(IoCacheTest, LargeRead) {
   cache_->Close();
 }
 
+TEST_F(IoCacheTest, Throughput) {
+  const uint64_t kNumWrites(kCacheSize * 10000 / kBlockSize);
+
+  std::vector<uint8_t> write_buffer;
+  GenerateTestBuffer(kBlockSize, &write_buffer);
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  WriteToCacheThreaded(write_buffer, kNumWrites, 0, true);
+  std::vector<uint8_t> read_buffer(kBlockSize);
+  uint64_t total_bytes_read(0);
+  while (uint64_t bytes_read =
+             cache_->Read(read_buffer.data(), read_buffer.size())) {
+    total_bytes_read += bytes_read;
+  }
+  const base::TimeDelta elapsed = base::TimeTicks::Now() - start_time;
+  EXPECT_EQ(kNumWrites * kBlockSize, total_bytes_read);
+  LOG(INFO) << "IoCache throughput: "
+            << total_bytes_read / std::max(elapsed.InSecondsF(), 1e-6) /
+                   (1 << 20)
+            << " MB/s.";
+}
+
 }  // namespace shaka
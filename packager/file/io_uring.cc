@@ -0,0 +1,215 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/io_uring.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/threading/worker_pool.h"
+
+// The io_uring system calls have the same numbers on every architecture, but
+// older C libraries do not define them.
+#if !defined(__NR_io_uring_setup)
+#define __NR_io_uring_setup 425
+#endif
+#if !defined(__NR_io_uring_enter)
+#define __NR_io_uring_enter 426
+#endif
+
+namespace shaka {
+namespace {
+
+// Number of submission queue entries. The completion queue is twice as large.
+const uint32_t kRingEntries = 256;
+
+int IoUringSetup(uint32_t entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IoUringEnter(int ring_fd,
+                 uint32_t to_submit,
+                 uint32_t min_complete,
+                 uint32_t flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+void* MapRing(int ring_fd, size_t size, off_t offset) {
+  void* ring = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+  return ring == MAP_FAILED ? nullptr : ring;
+}
+
+}  // namespace
+
+IoUring::Request::Request()
+    : done(base::WaitableEvent::ResetPolicy::AUTOMATIC,
+           base::WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+IoUring::Request::~Request() {}
+
+IoUring* IoUring::GetInstance() {
+  // Leaked on purpose: files may still be closed during exit.
+  static IoUring* const instance = []() -> IoUring* {
+    IoUring* io_uring = new IoUring;
+    if (!io_uring->Initialize(kRingEntries)) {
+      delete io_uring;
+      return nullptr;
+    }
+    return io_uring;
+  }();
+  return instance;
+}
+
+void IoUring::Submit(Request* const* requests, size_t num_requests) {
+  base::AutoLock auto_lock(lock_);
+  size_t num_submitted = 0;
+  while (num_submitted < num_requests) {
+    while (num_in_flight_ == entries_)
+      requests_completed_.Wait();
+
+    // Only this thread, which holds |lock_|, moves the tail, and the kernel
+    // consumes the entries queued during io_uring_enter().
+    uint32_t tail = *sq_tail_;
+    const size_t first_request = num_submitted;
+    while (num_submitted < num_requests && num_in_flight_ < entries_) {
+      Request* request = requests[num_submitted++];
+      const uint32_t index = tail++ & sq_mask_;
+      io_uring_sqe* sqe = &sqes_[index];
+      memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = request->type == Request::kRead ? IORING_OP_READV
+                                                    : IORING_OP_WRITEV;
+      sqe->fd = request->fd;
+      sqe->off = request->offset;
+      sqe->addr = reinterpret_cast<uint64_t>(&request->iov);
+      sqe->len = 1;
+      sqe->user_data = reinterpret_cast<uint64_t>(request);
+      sq_array_[index] = index;
+      ++num_in_flight_;
+    }
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+    uint32_t to_submit = static_cast<uint32_t>(num_submitted - first_request);
+    while (to_submit > 0) {
+      const int result = IoUringEnter(ring_fd_, to_submit, 0, 0);
+      if (result > 0) {
+        to_submit -= result;
+        continue;
+      }
+      if (result < 0 && (errno == EINTR || errno == EAGAIN))
+        continue;
+      // The entries left are taken back and their requests fail.
+      const int error = result < 0 ? errno : EIO;
+      PLOG(ERROR) << "Failed to submit " << to_submit << " I/O requests";
+      __atomic_store_n(sq_tail_, tail - to_submit, __ATOMIC_RELEASE);
+      num_in_flight_ -= to_submit;
+      for (size_t i = num_submitted - to_submit; i < num_submitted; ++i) {
+        requests[i]->result = -error;
+        requests[i]->done.Signal();
+      }
+      break;
+    }
+
+    if (num_in_flight_ > 0 && !thread_running_) {
+      thread_running_ = true;
+      base::WorkerPool::PostTask(
+          FROM_HERE, base::Bind(&IoUring::ThreadMain, base::Unretained(this)),
+          /* task_is_slow= */ true);
+    }
+  }
+}
+
+IoUring::IoUring() : requests_completed_(&lock_) {}
+
+IoUring::~IoUring() {
+  if (cq_ring_)
+    munmap(cq_ring_, cq_ring_size_);
+  if (sqes_)
+    munmap(sqes_, sqes_size_);
+  if (sq_ring_)
+    munmap(sq_ring_, sq_ring_size_);
+  if (ring_fd_ >= 0)
+    close(ring_fd_);
+}
+
+bool IoUring::Initialize(uint32_t entries) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = IoUringSetup(entries, &params);
+  if (ring_fd_ < 0) {
+    PLOG(WARNING) << "io_uring is not available";
+    return false;
+  }
+  entries_ = params.sq_entries;
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  sq_ring_ = MapRing(ring_fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = static_cast<io_uring_sqe*>(
+      MapRing(ring_fd_, sqes_size_, IORING_OFF_SQES));
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  cq_ring_ = MapRing(ring_fd_, cq_ring_size_, IORING_OFF_CQ_RING);
+  if (!sq_ring_ || !sqes_ || !cq_ring_) {
+    PLOG(ERROR) << "Failed to map the io_uring queues";
+    return false;
+  }
+
+  uint8_t* sq_ring = static_cast<uint8_t*>(sq_ring_);
+  sq_tail_ = reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.array);
+
+  uint8_t* cq_ring = static_cast<uint8_t*>(cq_ring_);
+  cq_head_ = reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+  return true;
+}
+
+void IoUring::ThreadMain() {
+  while (true) {
+    if (IoUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+        errno != EINTR) {
+      PLOG(ERROR) << "Failed to wait for I/O completions";
+    }
+    const uint32_t num_completed = ReapCompletions();
+
+    base::AutoLock auto_lock(lock_);
+    num_in_flight_ -= num_completed;
+    if (num_completed > 0)
+      requests_completed_.Broadcast();
+    if (num_in_flight_ == 0) {
+      thread_running_ = false;
+      return;
+    }
+  }
+}
+
+uint32_t IoUring::ReapCompletions() {
+  // This thread is the only consumer of the completion queue.
+  uint32_t head = *cq_head_;
+  const uint32_t tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  const uint32_t num_completed = tail - head;
+  for (; head != tail; ++head) {
+    const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+    Request* request = reinterpret_cast<Request*>(cqe.user_data);
+    request->result = cqe.res;
+    // The request may be reused or destroyed as soon as it is signalled.
+    request->done.Signal();
+  }
+  __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  return num_completed;
+}
+
+}  // namespace shaka
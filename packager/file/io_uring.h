@@ -0,0 +1,103 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_IO_URING_H_
+#define PACKAGER_FILE_IO_URING_H_
+
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/waitable_event.h"
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+namespace shaka {
+
+/// An io_uring instance shared by all the files of the process. Requests are
+/// submitted from the threads doing the I/O, several at a time, and their
+/// completions are reaped by a single completion thread, which only runs while
+/// there are requests in flight. Only available on Linux 5.1 or later.
+class IoUring {
+ public:
+  /// A read or a write of a single buffer at a given file offset.
+  struct Request {
+    enum Type { kRead, kWrite };
+
+    Request();
+    ~Request();
+
+    Type type = kRead;
+    int fd = -1;
+    uint64_t offset = 0;
+    /// The buffer, which must stay valid until the request completes.
+    struct iovec iov = {};
+    /// Number of bytes transferred, or a negative errno value on failure.
+    /// Only valid once @a done is signalled.
+    int32_t result = 0;
+    /// Signalled when the request completes.
+    base::WaitableEvent done;
+
+    Request(const Request&) = delete;
+    Request& operator=(const Request&) = delete;
+  };
+
+  /// @return The instance of the process, or null if io_uring is not supported
+  ///         by the kernel.
+  static IoUring* GetInstance();
+
+  /// Submit @a requests to the kernel, with one system call if they all fit in
+  /// the ring. Blocks while the ring is full. The requests must stay alive
+  /// until they complete. A request which cannot be submitted completes
+  /// immediately with an error.
+  void Submit(Request* const* requests, size_t num_requests);
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+ private:
+  IoUring();
+  ~IoUring();
+
+  bool Initialize(uint32_t entries);
+  void ThreadMain();
+  // Completes the requests in the completion queue. Returns the number of
+  // requests completed.
+  uint32_t ReapCompletions();
+
+  int ring_fd_ = -1;
+  uint32_t entries_ = 0;
+
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  uint32_t* sq_tail_ = nullptr;
+  uint32_t sq_mask_ = 0;
+  uint32_t* sq_array_ = nullptr;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  uint32_t* cq_head_ = nullptr;
+  uint32_t* cq_tail_ = nullptr;
+  uint32_t cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+
+  base::Lock lock_;
+  // Signalled when requests complete, so that blocked submitters can use the
+  // ring entries freed.
+  base::ConditionVariable requests_completed_;
+  // Requests submitted and not completed yet. It is kept at or below
+  // |entries_| so that the completion queue never overflows.
+  uint32_t num_in_flight_ = 0;
+  bool thread_running_ = false;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_IO_URING_H_
@@ -0,0 +1,388 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/io_uring_file.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+#include "packager/base/posix/eintr_wrapper.h"
+#include "packager/file/local_file.h"
+
+namespace shaka {
+
+IoUringFile::IoUringFile(const char* file_name,
+                         const char* mode,
+                         uint64_t block_size,
+                         size_t num_blocks)
+    : File(file_name),
+      file_mode_(mode),
+      block_size_(block_size),
+      num_blocks_(std::max<size_t>(num_blocks, 2)),
+      io_uring_(IoUring::GetInstance()) {
+  DCHECK(io_uring_);
+}
+
+bool IoUringFile::Close() {
+  bool result = true;
+  if (fd_ >= 0) {
+    if (is_reading()) {
+      if (current_block_)
+        FreeBlock(current_block_);
+      current_block_ = nullptr;
+      DrainReads();
+    } else {
+      result = Flush();
+    }
+    if (IGNORE_EINTR(close(fd_)) != 0) {
+      PLOG(ERROR) << "Failed to close " << file_name();
+      result = false;
+    }
+    fd_ = -1;
+  }
+  delete this;
+  return result;
+}
+
+int64_t IoUringFile::Read(void* buffer, uint64_t length) {
+  DCHECK(buffer);
+  DCHECK(is_reading());
+  uint8_t* output = static_cast<uint8_t*>(buffer);
+  uint64_t bytes_read = 0;
+  while (bytes_read < length && !error_) {
+    if (!current_block_ && !ReadNextBlock())
+      break;
+
+    const size_t size = std::min<uint64_t>(
+        length - bytes_read, current_block_->size - current_block_->position);
+    memcpy(output + bytes_read,
+           current_block_->data.data() + current_block_->position, size);
+    current_block_->position += size;
+    bytes_read += size;
+    if (current_block_->position == current_block_->size) {
+      FreeBlock(current_block_);
+      current_block_ = nullptr;
+    }
+  }
+  if (bytes_read == 0 && error_)
+    return -1;
+  position_ += bytes_read;
+  return bytes_read;
+}
+
+bool IoUringFile::SupportsReadInPlace() const {
+  return is_reading();
+}
+
+int64_t IoUringFile::ReadInPlace(const uint8_t** data, uint64_t length) {
+  DCHECK(data);
+  DCHECK(is_reading());
+  if (length == 0)
+    return 0;
+  // The block returned by the previous call is kept until now, as the caller
+  // may still use its data.
+  if (current_block_ && current_block_->position == current_block_->size) {
+    FreeBlock(current_block_);
+    current_block_ = nullptr;
+  }
+  if (!current_block_ && !ReadNextBlock())
+    return error_ ? -1 : 0;
+
+  // The blocks following |current_block_| are read while its data is used.
+  const size_t size = std::min<uint64_t>(
+      length, current_block_->size - current_block_->position);
+  *data = current_block_->data.data() + current_block_->position;
+  current_block_->position += size;
+  position_ += size;
+  return size;
+}
+
+int64_t IoUringFile::Write(const void* buffer, uint64_t length) {
+  DCHECK(buffer);
+  DCHECK(!is_reading());
+  const uint8_t* input = static_cast<const uint8_t*>(buffer);
+  uint64_t bytes_written = 0;
+  while (bytes_written < length && !error_) {
+    if (!current_block_) {
+      // The writes of the blocks filled so far go first, as a full queue is
+      // freed by waiting for them.
+      SubmitRequests();
+      current_block_ = GetFreeBlock();
+      current_block_->request.offset = position_ + bytes_written;
+    }
+
+    const size_t size = std::min<uint64_t>(length - bytes_written,
+                                           block_size_ - current_block_->size);
+    memcpy(current_block_->data.data() + current_block_->size,
+           input + bytes_written, size);
+    current_block_->size += size;
+    bytes_written += size;
+    if (current_block_->size == block_size_) {
+      QueueWrite(current_block_);
+      current_block_ = nullptr;
+    }
+  }
+  SubmitRequests();
+  if (error_)
+    return -1;
+  position_ += bytes_written;
+  return bytes_written;
+}
+
+int64_t IoUringFile::WriteV(const FileIoVector* buffers, size_t num_buffers) {
+  // The data is copied to the blocks anyway, so there is no need to gather it
+  // first.
+  DCHECK(buffers);
+  uint64_t bytes_written = 0;
+  for (size_t i = 0; i < num_buffers; ++i) {
+    const int64_t size = Write(buffers[i].buffer, buffers[i].length);
+    if (size < 0)
+      return bytes_written > 0 ? static_cast<int64_t>(bytes_written) : size;
+    bytes_written += size;
+  }
+  return bytes_written;
+}
+
+int64_t IoUringFile::Size() {
+  if (!Flush()) {
+    LOG(ERROR) << "Cannot flush file.";
+    return -1;
+  }
+  struct stat info;
+  if (fstat(fd_, &info) != 0) {
+    PLOG(ERROR) << "Cannot get file size of " << file_name();
+    return -1;
+  }
+  return info.st_size;
+}
+
+bool IoUringFile::Flush() {
+  if (is_reading())
+    return !error_;
+
+  if (current_block_) {
+    if (current_block_->size > 0)
+      QueueWrite(current_block_);
+    else
+      FreeBlock(current_block_);
+    current_block_ = nullptr;
+  }
+  SubmitRequests();
+  while (!queued_blocks_.empty()) {
+    Block* block = queued_blocks_.front();
+    queued_blocks_.pop_front();
+    WaitForBlock(block);
+    FreeBlock(block);
+  }
+  return !error_;
+}
+
+bool IoUringFile::Seek(uint64_t position) {
+  if (!is_reading()) {
+    if (!Flush())
+      return false;
+    position_ = position;
+    return true;
+  }
+
+  // Seeking within the block being read keeps it, which makes short seeks,
+  // e.g. to skip boxes, cheap.
+  if (current_block_) {
+    const uint64_t block_offset = current_block_->request.offset;
+    if (position >= block_offset &&
+        position < block_offset + current_block_->size) {
+      current_block_->position = position - block_offset;
+      position_ = position;
+      return true;
+    }
+    FreeBlock(current_block_);
+    current_block_ = nullptr;
+  }
+  DrainReads();
+  read_offset_ = position;
+  position_ = position;
+  eof_ = false;
+  return !error_;
+}
+
+bool IoUringFile::Tell(uint64_t* position) {
+  DCHECK(position);
+  *position = position_;
+  return true;
+}
+
+bool IoUringFile::IsSupported(const char* file_name, const char* mode) {
+  if (strcmp(mode, "r") && strcmp(mode, "w") && strcmp(mode, "a"))
+    return false;
+  // Pipes and devices cannot be accessed at an offset.
+  struct stat info;
+  if (stat(file_name, &info) == 0 && !S_ISREG(info.st_mode))
+    return false;
+  return IoUring::GetInstance() != nullptr;
+}
+
+IoUringFile::~IoUringFile() {}
+
+bool IoUringFile::Open() {
+  int flags = O_RDONLY;
+  if (file_mode_ == "w") {
+    if (!LocalFile::CreateParentDirectories(file_name().c_str()))
+      return false;
+    flags = O_WRONLY | O_CREAT | O_TRUNC;
+  } else if (file_mode_ == "a") {
+    // The file is not opened with O_APPEND, which would make the blocks in
+    // flight land in completion order. They are written at the end of the
+    // file explicitly instead.
+    flags = O_WRONLY | O_CREAT;
+  } else if (file_mode_ != "r") {
+    LOG(ERROR) << "IoUringFile does not support mode '" << file_mode_ << "'.";
+    return false;
+  }
+
+  fd_ = HANDLE_EINTR(open(file_name().c_str(), flags | O_CLOEXEC, 0666));
+  if (fd_ < 0)
+    return false;
+  if (file_mode_ == "a") {
+    const off_t size = lseek(fd_, 0, SEEK_END);
+    if (size < 0) {
+      PLOG(ERROR) << "Failed to seek to the end of " << file_name();
+      IGNORE_EINTR(close(fd_));
+      fd_ = -1;
+      return false;
+    }
+    position_ = size;
+  }
+
+  blocks_.resize(num_blocks_);
+  for (std::unique_ptr<Block>& block : blocks_) {
+    block.reset(new Block);
+    block->data.resize(block_size_);
+    block->request.fd = fd_;
+    free_blocks_.push_back(block.get());
+  }
+  return true;
+}
+
+bool IoUringFile::ReadNextBlock() {
+  DCHECK(!current_block_);
+  if (eof_ || error_)
+    return false;
+  ReadAhead();
+  Block* block = queued_blocks_.front();
+  queued_blocks_.pop_front();
+  if (!WaitForBlock(block)) {
+    FreeBlock(block);
+    return false;
+  }
+  block->size = block->request.result;
+  block->position = 0;
+  if (block->size == 0) {
+    eof_ = true;
+    FreeBlock(block);
+    DrainReads();
+    return false;
+  }
+  if (block->size < block_size_) {
+    // The blocks read ahead do not follow a short read, so they are read
+    // again.
+    DrainReads();
+    read_offset_ = block->request.offset + block->size;
+  }
+  current_block_ = block;
+  return true;
+}
+
+void IoUringFile::ReadAhead() {
+  while (!free_blocks_.empty()) {
+    Block* block = free_blocks_.back();
+    free_blocks_.pop_back();
+    block->request.type = IoUring::Request::kRead;
+    block->request.offset = read_offset_;
+    block->request.iov.iov_base = block->data.data();
+    block->request.iov.iov_len = block_size_;
+    read_offset_ += block_size_;
+    queued_blocks_.push_back(block);
+    pending_requests_.push_back(&block->request);
+  }
+  SubmitRequests();
+}
+
+void IoUringFile::DrainReads() {
+  // Errors of the reads ahead which are discarded do not matter.
+  for (Block* block : queued_blocks_) {
+    block->request.done.Wait();
+    FreeBlock(block);
+  }
+  queued_blocks_.clear();
+}
+
+void IoUringFile::QueueWrite(Block* block) {
+  block->request.type = IoUring::Request::kWrite;
+  block->request.iov.iov_base = block->data.data();
+  block->request.iov.iov_len = block->size;
+  queued_blocks_.push_back(block);
+  pending_requests_.push_back(&block->request);
+}
+
+void IoUringFile::SubmitRequests() {
+  if (pending_requests_.empty())
+    return;
+  io_uring_->Submit(pending_requests_.data(), pending_requests_.size());
+  pending_requests_.clear();
+}
+
+bool IoUringFile::WaitForBlock(Block* block) {
+  IoUring::Request* request = &block->request;
+  while (true) {
+    request->done.Wait();
+    const bool is_read = request->type == IoUring::Request::kRead;
+    if (request->result < 0) {
+      LOG(ERROR) << "Failed to " << (is_read ? "read " : "write ")
+                 << file_name() << ": " << strerror(-request->result);
+      error_ = true;
+      return false;
+    }
+    const size_t size = request->result;
+    if (is_read || size == request->iov.iov_len)
+      return true;
+    if (size == 0) {
+      LOG(ERROR) << "Failed to write " << file_name() << ": no progress.";
+      error_ = true;
+      return false;
+    }
+    // The rest of a short write is written again.
+    request->offset += size;
+    request->iov.iov_base = static_cast<uint8_t*>(request->iov.iov_base) + size;
+    request->iov.iov_len -= size;
+    io_uring_->Submit(&request, 1);
+  }
+}
+
+IoUringFile::Block* IoUringFile::GetFreeBlock() {
+  if (free_blocks_.empty()) {
+    DCHECK(!queued_blocks_.empty());
+    Block* block = queued_blocks_.front();
+    queued_blocks_.pop_front();
+    WaitForBlock(block);
+    FreeBlock(block);
+  }
+  Block* block = free_blocks_.back();
+  free_blocks_.pop_back();
+  return block;
+}
+
+void IoUringFile::FreeBlock(Block* block) {
+  block->size = 0;
+  block->position = 0;
+  free_blocks_.push_back(block);
+}
+
+}  // namespace shaka
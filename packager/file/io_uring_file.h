@@ -0,0 +1,119 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_IO_URING_FILE_H_
+#define PACKAGER_FILE_IO_URING_FILE_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/file/file.h"
+#include "packager/file/io_uring.h"
+
+namespace shaka {
+
+/// Implements a local file doing its I/O through the IoUring of the process,
+/// as an alternative to a LocalFile wrapped in a ThreadedIoFile which does not
+/// need a thread per file. In read mode, the blocks following the read
+/// position are read ahead, and can be accessed in place through
+/// ReadInPlace(). In write mode, the data is written behind in
+/// blocks, and the blocks filled by a single call are submitted together.
+class IoUringFile : public File {
+ public:
+  /// @param file_name C string containing the name of the file to be accessed.
+  /// @param mode C string containing a file access mode. Only "r", "w" and "a"
+  ///        are supported.
+  /// @param block_size is the size of the blocks read or written.
+  /// @param num_blocks is the number of blocks that can be in flight, at least
+  ///        two.
+  IoUringFile(const char* file_name,
+              const char* mode,
+              uint64_t block_size,
+              size_t num_blocks);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  bool SupportsReadInPlace() const override;
+  int64_t ReadInPlace(const uint8_t** data, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t WriteV(const FileIoVector* buffers, size_t num_buffers) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+  /// @return true if @a file_name can be accessed by an IoUringFile in @a mode,
+  ///         i.e. if io_uring is available, the mode is supported and the file
+  ///         is a regular file or does not exist yet.
+  static bool IsSupported(const char* file_name, const char* mode);
+
+ protected:
+  ~IoUringFile() override;
+
+  bool Open() override;
+
+ private:
+  struct Block {
+    IoUring::Request request;
+    std::vector<uint8_t> data;
+    // Bytes of |data| holding file data, and bytes of it already read.
+    size_t size = 0;
+    size_t position = 0;
+  };
+
+  bool is_reading() const { return file_mode_ == "r"; }
+
+  // Waits for the next block read and makes it |current_block_|. Returns false
+  // on end of file or error.
+  bool ReadNextBlock();
+  // Queues reads for the free blocks, in one submission.
+  void ReadAhead();
+  // Waits for the reads queued and frees their blocks.
+  void DrainReads();
+  // Queues a write of the data in |block|, which is submitted by the next
+  // SubmitRequests().
+  void QueueWrite(Block* block);
+  void SubmitRequests();
+  // Waits for |block|, and completes it if it was a short write. Returns false
+  // on error.
+  bool WaitForBlock(Block* block);
+  // Returns a free block, waiting for the oldest block queued if needed.
+  Block* GetFreeBlock();
+  void FreeBlock(Block* block);
+
+  const std::string file_mode_;
+  const size_t block_size_;
+  const size_t num_blocks_;
+  IoUring* const io_uring_;
+  int fd_ = -1;
+  bool error_ = false;
+  bool eof_ = false;
+  uint64_t position_ = 0;
+  // File offset of the next block read.
+  uint64_t read_offset_ = 0;
+
+  std::vector<std::unique_ptr<Block>> blocks_;
+  std::vector<Block*> free_blocks_;
+  // Blocks read or written, in file offset order.
+  std::deque<Block*> queued_blocks_;
+  // Requests of the blocks queued and not submitted yet.
+  std::vector<IoUring::Request*> pending_requests_;
+  // The block being read from or written to, if any.
+  Block* current_block_ = nullptr;
+
+  DISALLOW_COPY_AND_ASSIGN(IoUringFile);
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_IO_URING_FILE_H_
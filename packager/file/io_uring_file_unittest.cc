@@ -0,0 +1,161 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/io_uring_file.h"
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include "packager/base/files/file_util.h"
+#include "packager/base/logging.h"
+#include "packager/file/file_closer.h"
+
+DECLARE_bool(io_uring);
+DECLARE_uint64(io_block_size);
+DECLARE_uint64(io_uring_queue_depth);
+
+namespace shaka {
+namespace {
+const size_t kBlockSize = 100;
+const size_t kNumBlocks = 3;
+const size_t kDataSize = 1234;
+}  // namespace
+
+class IoUringFileTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_io_uring = true;
+    FLAGS_io_block_size = kBlockSize;
+    FLAGS_io_uring_queue_depth = kNumBlocks;
+
+    for (size_t i = 0; i < kDataSize; ++i)
+      data_.push_back(static_cast<char>(i * 7));
+    ASSERT_TRUE(base::CreateTemporaryFile(&test_file_path_));
+    file_name_ = test_file_path_.AsUTF8Unsafe();
+    // io_uring is not available on older kernels and in some sandboxes, in
+    // which case the files fall back to threaded I/O.
+    LOG_IF(WARNING, !IoUringFile::IsSupported(file_name_.c_str(), "r"))
+        << "io_uring is not supported, testing the fallback.";
+  }
+
+  void TearDown() override { base::DeleteFile(test_file_path_, false); }
+
+  File* OpenFile(const char* mode) {
+    return File::Open(file_name_.c_str(), mode);
+  }
+
+  google::FlagSaver flag_saver_;
+  std::string data_;
+  base::FilePath test_file_path_;
+  std::string file_name_;
+};
+
+TEST_F(IoUringFileTest, WriteAndAppend) {
+  // Writes spanning more blocks than can be in flight, and partial blocks.
+  const size_t kFirstWriteSize = 450;
+  const size_t kSecondWriteSize = 37;
+  std::unique_ptr<File, FileCloser> file(OpenFile("w"));
+  ASSERT_TRUE(file);
+  ASSERT_EQ(static_cast<int64_t>(kFirstWriteSize),
+            file->Write(data_.data(), kFirstWriteSize));
+  ASSERT_EQ(static_cast<int64_t>(kSecondWriteSize),
+            file->Write(data_.data() + kFirstWriteSize, kSecondWriteSize));
+  EXPECT_EQ(static_cast<int64_t>(kFirstWriteSize + kSecondWriteSize),
+            file->Size());
+  ASSERT_TRUE(file.release()->Close());
+
+  const size_t kWritten = kFirstWriteSize + kSecondWriteSize;
+  file.reset(OpenFile("a"));
+  ASSERT_TRUE(file);
+  const FileIoVector buffers[] = {
+      {data_.data() + kWritten, 5},
+      {data_.data() + kWritten + 5, kDataSize - kWritten - 5},
+  };
+  ASSERT_EQ(static_cast<int64_t>(kDataSize - kWritten),
+            file->WriteV(buffers, 2));
+  uint64_t position = 0;
+  ASSERT_TRUE(file->Tell(&position));
+  EXPECT_EQ(kDataSize, position);
+  ASSERT_TRUE(file.release()->Close());
+
+  std::string contents;
+  ASSERT_TRUE(base::ReadFileToString(test_file_path_, &contents));
+  EXPECT_EQ(data_, contents);
+}
+
+TEST_F(IoUringFileTest, ReadAndSeek) {
+  ASSERT_EQ(static_cast<int>(kDataSize),
+            base::WriteFile(test_file_path_, data_.data(), kDataSize));
+
+  std::unique_ptr<File, FileCloser> file(OpenFile("r"));
+  ASSERT_TRUE(file);
+  EXPECT_EQ(static_cast<int64_t>(kDataSize), file->Size());
+
+  std::string buffer(kDataSize, 0);
+  ASSERT_EQ(250, file->Read(&buffer[0], 250));
+  EXPECT_EQ(data_.substr(0, 250), buffer.substr(0, 250));
+
+  // Within the block being read, then backwards and forwards.
+  for (uint64_t position : {220, 10, 900}) {
+    ASSERT_TRUE(file->Seek(position));
+    ASSERT_EQ(20, file->Read(&buffer[0], 20));
+    EXPECT_EQ(data_.substr(position, 20), buffer.substr(0, 20));
+  }
+
+  ASSERT_TRUE(file->Seek(0));
+  ASSERT_EQ(static_cast<int64_t>(kDataSize),
+            file->Read(&buffer[0], kDataSize + 10));
+  EXPECT_EQ(data_, buffer);
+  EXPECT_EQ(0, file->Read(&buffer[0], 10));
+  uint64_t position = 0;
+  ASSERT_TRUE(file->Tell(&position));
+  EXPECT_EQ(kDataSize, position);
+}
+
+TEST_F(IoUringFileTest, ReadInPlace) {
+  ASSERT_EQ(static_cast<int>(kDataSize),
+            base::WriteFile(test_file_path_, data_.data(), kDataSize));
+
+  std::unique_ptr<File, FileCloser> file(OpenFile("r"));
+  ASSERT_TRUE(file);
+  if (!file->SupportsReadInPlace()) {
+    LOG(WARNING) << "io_uring is not supported, skipping the test.";
+    return;
+  }
+
+  // Reads in place return at most the rest of the block being read.
+  const uint8_t* data = nullptr;
+  ASSERT_EQ(64, file->ReadInPlace(&data, 64));
+  EXPECT_EQ(data_.substr(0, 64),
+            std::string(reinterpret_cast<const char*>(data), 64));
+  ASSERT_EQ(static_cast<int64_t>(kBlockSize - 64),
+            file->ReadInPlace(&data, kDataSize));
+  EXPECT_EQ(data_.substr(64, kBlockSize - 64),
+            std::string(reinterpret_cast<const char*>(data), kBlockSize - 64));
+
+  // Mixed with reads and seeks.
+  std::string buffer(20, 0);
+  ASSERT_EQ(20, file->Read(&buffer[0], 20));
+  EXPECT_EQ(data_.substr(kBlockSize, 20), buffer);
+  ASSERT_TRUE(file->Seek(10));
+
+  std::string contents = data_.substr(0, 10);
+  int64_t bytes_read = 0;
+  while ((bytes_read = file->ReadInPlace(&data, 64)) > 0)
+    contents.append(reinterpret_cast<const char*>(data), bytes_read);
+  EXPECT_EQ(0, bytes_read);
+  EXPECT_EQ(data_, contents);
+}
+
+TEST_F(IoUringFileTest, NotSupportedMode) {
+  EXPECT_FALSE(IoUringFile::IsSupported(file_name_.c_str(), "r+"));
+  EXPECT_FALSE(IoUringFile::IsSupported("/dev/null", "w"));
+}
+
+}  // namespace shaka
@@ -0,0 +1,109 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/large_buffer.h"
+
+#if !defined(OS_WIN)
+#include <sys/mman.h>
+#endif  // !defined(OS_WIN)
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+
+namespace {
+
+// Smaller buffers are allocated on the heap, as a mapping costs a system call
+// and at least a page.
+const size_t kMinMappedSize = 1 << 20;
+
+#if defined(OS_LINUX)
+// The size of the transparent huge pages on x86-64 and most ARM64 kernels.
+const size_t kHugePageSize = 2 << 20;
+#endif  // defined(OS_LINUX)
+
+#if !defined(OS_WIN)
+// Maps at least |size| bytes.
+// @return the start of the mapping, or nullptr on failure.
+uint8_t* Map(size_t size, size_t* mapped_size) {
+#if defined(OS_LINUX)
+  // Huge pages can only back the parts of a mapping aligned to them, so the
+  // mapping is over-allocated by a huge page, and trimmed to the alignment.
+  const size_t aligned_size =
+      (size + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+  const size_t map_size = aligned_size + kHugePageSize;
+#else
+  const size_t map_size = size;
+#endif  // defined(OS_LINUX)
+
+  void* mapping = mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    PLOG(WARNING) << "Failed to map a buffer of " << size << " bytes.";
+    return nullptr;
+  }
+  uint8_t* data = static_cast<uint8_t*>(mapping);
+
+#if defined(OS_LINUX)
+  uint8_t* aligned_data = reinterpret_cast<uint8_t*>(
+      (reinterpret_cast<uintptr_t>(data) + kHugePageSize - 1) &
+      ~(kHugePageSize - 1));
+  if (aligned_data != data)
+    munmap(data, aligned_data - data);
+  uint8_t* aligned_end = aligned_data + aligned_size;
+  if (aligned_end != data + map_size)
+    munmap(aligned_end, data + map_size - aligned_end);
+  // Fails if transparent huge pages are disabled, which is not an error.
+  if (madvise(aligned_data, aligned_size, MADV_HUGEPAGE) != 0)
+    VPLOG(1) << "madvise(MADV_HUGEPAGE) failed.";
+  *mapped_size = aligned_size;
+  return aligned_data;
+#else
+  *mapped_size = map_size;
+  return data;
+#endif  // defined(OS_LINUX)
+}
+#endif  // !defined(OS_WIN)
+
+}  // namespace
+
+LargeBuffer::LargeBuffer(size_t size) {
+  Reset(size);
+}
+
+LargeBuffer::~LargeBuffer() {
+  Free();
+}
+
+void LargeBuffer::Reset(size_t size) {
+  // Freed first, so the old and the new buffers are not both allocated.
+  Free();
+  size_ = size;
+  if (size == 0)
+    return;
+#if !defined(OS_WIN)
+  if (size >= kMinMappedSize) {
+    data_ = Map(size, &mapped_size_);
+    if (data_)
+      return;
+  }
+#endif  // !defined(OS_WIN)
+  heap_data_.reset(new uint8_t[size]);
+  data_ = heap_data_.get();
+}
+
+void LargeBuffer::Free() {
+#if !defined(OS_WIN)
+  if (mapped_size_ > 0 && munmap(data_, mapped_size_) != 0)
+    PLOG(WARNING) << "Failed to unmap a buffer.";
+#endif  // !defined(OS_WIN)
+  heap_data_.reset();
+  data_ = nullptr;
+  size_ = 0;
+  mapped_size_ = 0;
+}
+
+}  // namespace shaka
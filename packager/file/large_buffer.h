@@ -0,0 +1,59 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_LARGE_BUFFER_H_
+#define PACKAGER_FILE_LARGE_BUFFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#include "packager/base/macros.h"
+
+namespace shaka {
+
+/// Implements an uninitialized byte buffer for large I/O buffers, e.g. of
+/// IoCache and Demuxer. Large buffers are mapped anonymously where supported,
+/// so their pages are only allocated when first touched, on the NUMA node of
+/// the thread touching them, which is usually the thread using the buffer
+/// rather than the one creating it. On Linux, they are aligned to and advised
+/// for transparent huge pages, to reduce TLB misses when they are streamed
+/// through.
+class LargeBuffer {
+ public:
+  LargeBuffer() = default;
+  /// @param size is the size of the buffer, in bytes.
+  explicit LargeBuffer(size_t size);
+  ~LargeBuffer();
+
+  /// Replaces the buffer by a new buffer, not initialized either.
+  /// @param size is the size of the new buffer, in bytes.
+  void Reset(size_t size);
+
+  uint8_t* data() { return data_; }
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  uint8_t& operator[](size_t index) { return data_[index]; }
+  const uint8_t& operator[](size_t index) const { return data_[index]; }
+
+ private:
+  void Free();
+
+  uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  // Set if the buffer is not mapped.
+  std::unique_ptr<uint8_t[]> heap_data_;
+  // The size of the mapping, if the buffer is mapped.
+  size_t mapped_size_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(LargeBuffer);
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_LARGE_BUFFER_H_
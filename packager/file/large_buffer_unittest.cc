@@ -0,0 +1,62 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/large_buffer.h"
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+namespace shaka {
+namespace {
+const size_t kSmallSize = 1024;
+const size_t kLargeSize = (3 << 20) + 100;
+}  // namespace
+
+TEST(LargeBufferTest, Empty) {
+  LargeBuffer buffer;
+  EXPECT_EQ(nullptr, buffer.data());
+  EXPECT_EQ(0u, buffer.size());
+}
+
+TEST(LargeBufferTest, Small) {
+  LargeBuffer buffer(kSmallSize);
+  ASSERT_TRUE(buffer.data());
+  EXPECT_EQ(kSmallSize, buffer.size());
+  memset(buffer.data(), 0xab, buffer.size());
+  EXPECT_EQ(0xab, buffer[kSmallSize - 1]);
+}
+
+TEST(LargeBufferTest, Large) {
+  LargeBuffer buffer(kLargeSize);
+  ASSERT_TRUE(buffer.data());
+  EXPECT_EQ(kLargeSize, buffer.size());
+  memset(buffer.data(), 0xab, buffer.size());
+  EXPECT_EQ(0xab, buffer[0]);
+  EXPECT_EQ(0xab, buffer[kLargeSize - 1]);
+#if defined(OS_LINUX)
+  // Aligned to the transparent huge pages.
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(buffer.data()) % (2 << 20));
+#endif  // defined(OS_LINUX)
+}
+
+TEST(LargeBufferTest, Reset) {
+  LargeBuffer buffer(kSmallSize);
+  buffer.Reset(kLargeSize);
+  ASSERT_TRUE(buffer.data());
+  EXPECT_EQ(kLargeSize, buffer.size());
+  buffer[kLargeSize - 1] = 1;
+
+  buffer.Reset(kSmallSize);
+  ASSERT_TRUE(buffer.data());
+  EXPECT_EQ(kSmallSize, buffer.size());
+  buffer[kSmallSize - 1] = 1;
+
+  buffer.Reset(0);
+  EXPECT_EQ(nullptr, buffer.data());
+  EXPECT_EQ(0u, buffer.size());
+}
+
+}  // namespace shaka
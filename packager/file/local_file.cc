@@ -8,13 +8,23 @@
 
 #include <stdio.h>
 #if defined(OS_WIN)
+#include <io.h>
 #include <windows.h>
 #else
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 #endif  // defined(OS_WIN)
+#include <algorithm>
+#include <vector>
+
 #include "packager/base/files/file_path.h"
 #include "packager/base/files/file_util.h"
 #include "packager/base/logging.h"
+#include "packager/base/trace_event/trace_event.h"
 
 namespace shaka {
 namespace {
@@ -124,6 +134,7 @@ int64_t LocalFile::Read(void* buffer, uint64_t length) {
 }
 
 int64_t LocalFile::Write(const void* buffer, uint64_t length) {
+  TRACE_EVENT1("shaka", "LocalFile::Write", "length", length);
   DCHECK(buffer != NULL);
   DCHECK(internal_file_ != NULL);
   size_t bytes_written = fwrite(buffer, sizeof(char), length, internal_file_);
@@ -135,6 +146,61 @@ int64_t LocalFile::Write(const void* buffer, uint64_t length) {
   return bytes_written;
 }
 
+int64_t LocalFile::WriteV(const FileIoVector* buffers, size_t num_buffers) {
+  TRACE_EVENT0("shaka", "LocalFile::WriteV");
+#if defined(OS_WIN)
+  return File::WriteV(buffers, num_buffers);
+#else
+  DCHECK(buffers != NULL);
+  DCHECK(internal_file_ != NULL);
+  // The data buffered by previous Write() calls goes first.
+  if (fflush(internal_file_) != 0)
+    return -1;
+
+  std::vector<struct iovec> iovecs(num_buffers);
+  for (size_t i = 0; i < num_buffers; ++i) {
+    iovecs[i].iov_base = const_cast<void*>(buffers[i].buffer);
+    iovecs[i].iov_len = buffers[i].length;
+  }
+
+  const int fd = fileno(internal_file_);
+  uint64_t bytes_written = 0;
+  size_t index = 0;
+  while (index < iovecs.size()) {
+    const int count =
+        static_cast<int>(std::min<size_t>(iovecs.size() - index, IOV_MAX));
+    ssize_t size = writev(fd, &iovecs[index], count);
+    VLOG(2) << "WriteV " << count << " blocks return " << size;
+    if (size < 0) {
+      if (errno == EINTR)
+        continue;
+      if (bytes_written > 0)
+        break;
+      return -1;
+    }
+    bytes_written += size;
+    // Skip the blocks written completely and the written part of the next one.
+    while (index < iovecs.size() &&
+           static_cast<size_t>(size) >= iovecs[index].iov_len) {
+      size -= iovecs[index].iov_len;
+      ++index;
+    }
+    if (index < iovecs.size()) {
+      iovecs[index].iov_base = static_cast<uint8_t*>(iovecs[index].iov_base) +
+                               size;
+      iovecs[index].iov_len -= size;
+    }
+  }
+
+  // writev() moves the file descriptor offset behind the back of the stream,
+  // so the stream position is synchronized before the next stream operation.
+  const off_t position = lseek(fd, 0, SEEK_CUR);
+  if (position < 0 || fseeko(internal_file_, position, SEEK_SET) < 0)
+    return -1;
+  return bytes_written;
+#endif  // defined(OS_WIN)
+}
+
 int64_t LocalFile::Size() {
   DCHECK(internal_file_ != NULL);
 
@@ -158,6 +224,33 @@ bool LocalFile::Flush() {
   return ((fflush(internal_file_) == 0) && !ferror(internal_file_));
 }
 
+bool LocalFile::SyncData() {
+  if (!Flush())
+    return false;
+#if defined(OS_WIN)
+  return _commit(_fileno(internal_file_)) == 0;
+#elif defined(OS_MACOSX)
+  return fsync(fileno(internal_file_)) == 0;
+#else
+  return fdatasync(fileno(internal_file_)) == 0;
+#endif  // defined(OS_WIN)
+}
+
+bool LocalFile::SyncParentDirectory(const char* file_name) {
+#if defined(OS_WIN)
+  return true;
+#else
+  const base::FilePath dir_path =
+      base::FilePath::FromUTF8Unsafe(file_name).DirName();
+  const int fd = open(dir_path.value().c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  const bool result = fsync(fd) == 0;
+  close(fd);
+  return result;
+#endif  // defined(OS_WIN)
+}
+
 bool LocalFile::Seek(uint64_t position) {
 #if defined(OS_WIN)
   return _fseeki64(internal_file_, static_cast<__int64>(position), SEEK_SET) ==
@@ -186,10 +279,8 @@ bool LocalFile::Open() {
 
   // Create upper level directories for write mode.
   if (file_mode_.find("w") != std::string::npos) {
-    // The function returns true if the directories already exist.
-    if (!shaka::CreateDirectory(file_path.DirName())) {
+    if (!CreateParentDirectories(file_name().c_str()))
       return false;
-    }
   }
 
   internal_file_ = base::OpenFile(file_path, file_mode_.c_str());
@@ -200,4 +291,10 @@ bool LocalFile::Delete(const char* file_name) {
   return base::DeleteFile(base::FilePath::FromUTF8Unsafe(file_name), false);
 }
 
+bool LocalFile::CreateParentDirectories(const char* file_name) {
+  // The function returns true if the directories already exist.
+  return shaka::CreateDirectory(
+      base::FilePath::FromUTF8Unsafe(file_name).DirName());
+}
+
 }  // namespace shaka
@@ -29,6 +29,7 @@ class LocalFile : public File {
   bool Close() override;
   int64_t Read(void* buffer, uint64_t length) override;
   int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t WriteV(const FileIoVector* buffers, size_t num_buffers) override;
   int64_t Size() override;
   bool Flush() override;
   bool Seek(uint64_t position) override;
@@ -40,6 +41,24 @@ class LocalFile : public File {
   /// @return true if successful, or false otherwise.
   static bool Delete(const char* file_name);
 
+  /// Create the missing parent directories of a local file. The new
+  /// directories get the permissions of the closest existing one.
+  /// @param file_name is the path of the file.
+  /// @return true if successful or if the directories already exist, or false
+  ///         otherwise.
+  static bool CreateParentDirectories(const char* file_name);
+
+  /// Flush the data written so far to the storage device, e.g. with
+  /// fdatasync(), so that it survives a crash of the system.
+  /// @return true if successful, or false otherwise.
+  bool SyncData();
+
+  /// Flush the entries of the directory of a local file, e.g. after the file
+  /// is created or renamed, to the storage device. Does nothing on Windows.
+  /// @param file_name is the path of the file.
+  /// @return true if successful, or false otherwise.
+  static bool SyncParentDirectory(const char* file_name);
+
  protected:
   ~LocalFile() override;
 
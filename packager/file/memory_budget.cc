@@ -0,0 +1,151 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/memory_budget.h"
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+
+namespace shaka {
+
+namespace {
+
+const char* SubsystemName(MemorySubsystem subsystem) {
+  switch (subsystem) {
+    case MemorySubsystem::kIoCache:
+      return "io_cache";
+    case MemorySubsystem::kDemuxerQueue:
+      return "demuxer_queue";
+    case MemorySubsystem::kFragmenter:
+      return "fragmenter";
+    case MemorySubsystem::kSegmentStore:
+      return "segment_store";
+    case MemorySubsystem::kNumSubsystems:
+      break;
+  }
+  NOTREACHED();
+  return "";
+}
+
+double ToMegabytes(uint64_t size) {
+  return size / static_cast<double>(1 << 20);
+}
+
+}  // namespace
+
+MemoryBudget* MemoryBudget::GetInstance() {
+  static MemoryBudget* const instance = new MemoryBudget;
+  return instance;
+}
+
+void MemoryBudget::set_limit(uint64_t limit) {
+  limit_ = limit;
+  if (num_waiters_ > 0 && !exceeded()) {
+    base::AutoLock auto_lock(lock_);
+    budget_available_.Broadcast();
+  }
+}
+
+void MemoryBudget::Add(MemorySubsystem subsystem, uint64_t size) {
+  if (size == 0)
+    return;
+  subsystem_usage_[static_cast<size_t>(subsystem)] += size;
+  const uint64_t total_usage = total_usage_ += size;
+
+  uint64_t peak_usage = peak_usage_.load(std::memory_order_relaxed);
+  while (total_usage > peak_usage &&
+         !peak_usage_.compare_exchange_weak(peak_usage, total_usage)) {
+  }
+
+  const uint64_t limit = limit_.load(std::memory_order_relaxed);
+  if (limit > 0 && total_usage > limit && !exceeded_logged_.exchange(true)) {
+    LOG(WARNING) << "The memory budget of " << limit
+                 << " bytes is exceeded. Input reads are slowed down until "
+                    "the memory use is within the budget. "
+                 << ToString();
+  }
+}
+
+void MemoryBudget::Remove(MemorySubsystem subsystem, uint64_t size) {
+  if (size == 0)
+    return;
+  DCHECK_GE(subsystem_usage_[static_cast<size_t>(subsystem)].load(), size);
+  subsystem_usage_[static_cast<size_t>(subsystem)] -= size;
+  total_usage_ -= size;
+  // WaitForBudget() registers as a waiter before checking the usage, so
+  // either it sees the release, or the release sees the waiter.
+  if (num_waiters_ > 0 && !exceeded()) {
+    base::AutoLock auto_lock(lock_);
+    budget_available_.Broadcast();
+  }
+}
+
+uint64_t MemoryBudget::usage(MemorySubsystem subsystem) const {
+  return subsystem_usage_[static_cast<size_t>(subsystem)];
+}
+
+bool MemoryBudget::exceeded() const {
+  const uint64_t limit = limit_.load(std::memory_order_relaxed);
+  return limit > 0 && total_usage_.load(std::memory_order_relaxed) > limit;
+}
+
+void MemoryBudget::WaitForBudget(base::TimeDelta max_wait) {
+  if (!exceeded())
+    return;
+  const base::TimeTicks deadline = base::TimeTicks::Now() + max_wait;
+  base::AutoLock auto_lock(lock_);
+  ++num_waiters_;
+  while (exceeded()) {
+    const base::TimeDelta remaining = deadline - base::TimeTicks::Now();
+    if (remaining <= base::TimeDelta())
+      break;
+    budget_available_.TimedWait(remaining);
+  }
+  --num_waiters_;
+}
+
+std::string MemoryBudget::ToString() const {
+  std::string stats = base::StringPrintf(
+      "Memory use: %.1fMB, peak %.1fMB", ToMegabytes(usage()),
+      ToMegabytes(peak_usage()));
+  if (limit() > 0)
+    base::StringAppendF(&stats, ", budget %.1fMB", ToMegabytes(limit()));
+  for (size_t i = 0;
+       i < static_cast<size_t>(MemorySubsystem::kNumSubsystems); ++i) {
+    const MemorySubsystem subsystem = static_cast<MemorySubsystem>(i);
+    base::StringAppendF(&stats, ", %s %.1fMB", SubsystemName(subsystem),
+                        ToMegabytes(usage(subsystem)));
+  }
+  return stats + ".";
+}
+
+MemoryBudget::MemoryBudget() : budget_available_(&lock_) {
+  for (auto& subsystem_usage : subsystem_usage_)
+    subsystem_usage = 0;
+}
+
+MemoryBudget::~MemoryBudget() {}
+
+AccountedMemory::AccountedMemory(MemorySubsystem subsystem)
+    : subsystem_(subsystem) {}
+
+AccountedMemory::~AccountedMemory() {
+  Set(0);
+}
+
+void AccountedMemory::Set(uint64_t size) {
+  if (size > size_)
+    MemoryBudget::GetInstance()->Add(subsystem_, size - size_);
+  else
+    MemoryBudget::GetInstance()->Remove(subsystem_, size_ - size);
+  size_ = size;
+}
+
+void AccountedMemory::Add(uint64_t size) {
+  Set(size_ + size);
+}
+
+}  // namespace shaka
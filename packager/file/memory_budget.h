@@ -0,0 +1,125 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_MEMORY_BUDGET_H_
+#define PACKAGER_FILE_MEMORY_BUDGET_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+
+/// The subsystems whose memory use is accounted by MemoryBudget.
+enum class MemorySubsystem {
+  /// The circular buffers of the threaded and pooled files.
+  kIoCache,
+  /// The samples demuxers queue until the stream info of all their streams is
+  /// known.
+  kDemuxerQueue,
+  /// The samples of the MP4 fragments being built.
+  kFragmenter,
+  /// The objects of SegmentStore, i.e. the store:// files.
+  kSegmentStore,
+  kNumSubsystems,
+};
+
+/// Process-wide accounting of the memory used by the subsystems which hold
+/// the most memory, against an optional budget shared by all the packaging
+/// jobs of the process. Once the budget is exceeded, the demuxers wait before
+/// reading more input, so the outputs, and the other jobs, catch up and
+/// release memory instead of the process growing until it is killed.
+///
+/// The usage is updated by the threads of all the jobs, without locking, and
+/// the readers waiting for the budget are woken up when memory is released.
+class MemoryBudget {
+ public:
+  /// @return the process-wide budget.
+  static MemoryBudget* GetInstance();
+
+  /// Sets the budget, in bytes. 0 means no budget, which is the default.
+  void set_limit(uint64_t limit);
+  uint64_t limit() const { return limit_; }
+
+  /// Accounts @a size more bytes used by @a subsystem.
+  void Add(MemorySubsystem subsystem, uint64_t size);
+  /// Accounts @a size bytes released by @a subsystem.
+  void Remove(MemorySubsystem subsystem, uint64_t size);
+
+  /// @return the bytes used by all the subsystems.
+  uint64_t usage() const { return total_usage_; }
+  /// @return the bytes used by @a subsystem.
+  uint64_t usage(MemorySubsystem subsystem) const;
+  /// @return the peak of usage().
+  uint64_t peak_usage() const { return peak_usage_; }
+  /// @return true if there is a budget and usage() exceeds it.
+  bool exceeded() const;
+
+  /// Waits until the memory use is within the budget, or for at most
+  /// @a max_wait, to slow down a producer of memory use, e.g. an input.
+  /// Returns immediately if there is no budget. The wait is bounded so a
+  /// job, whose own input drives the release of its memory, cannot deadlock.
+  void WaitForBudget(base::TimeDelta max_wait);
+
+  /// @return the limit, the peak and the current use of each subsystem, in a
+  ///         human readable format.
+  std::string ToString() const;
+
+ private:
+  MemoryBudget();
+  ~MemoryBudget();
+
+  MemoryBudget(const MemoryBudget&) = delete;
+  MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+  std::atomic<uint64_t> limit_{0};
+  std::atomic<uint64_t> total_usage_{0};
+  std::atomic<uint64_t> peak_usage_{0};
+  std::atomic<uint64_t>
+      subsystem_usage_[static_cast<size_t>(MemorySubsystem::kNumSubsystems)];
+  // The budget being exceeded is logged once per process.
+  std::atomic<bool> exceeded_logged_{false};
+
+  // Signaled when the memory use gets back within the budget. Remove() only
+  // takes the lock when a thread is waiting.
+  base::Lock lock_;
+  base::ConditionVariable budget_available_;
+  std::atomic<int> num_waiters_{0};
+};
+
+/// Memory accounted to a subsystem of MemoryBudget by one of its objects,
+/// which is released when it is destroyed.
+///
+/// Thread Safety: Not thread safe, but distinct objects can be used
+/// concurrently.
+class AccountedMemory {
+ public:
+  explicit AccountedMemory(MemorySubsystem subsystem);
+  ~AccountedMemory();
+
+  /// Sets the bytes used by the object.
+  void Set(uint64_t size);
+  /// Adds @a size bytes to the bytes used by the object.
+  void Add(uint64_t size);
+
+  uint64_t size() const { return size_; }
+
+ private:
+  AccountedMemory(const AccountedMemory&) = delete;
+  AccountedMemory& operator=(const AccountedMemory&) = delete;
+
+  const MemorySubsystem subsystem_;
+  uint64_t size_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_MEMORY_BUDGET_H_
@@ -0,0 +1,112 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/memory_budget.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/threading/simple_thread.h"
+
+namespace shaka {
+namespace {
+const uint64_t kSize = 1000;
+}  // namespace
+
+class MemoryBudgetTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    budget_ = MemoryBudget::GetInstance();
+    initial_usage_ = budget_->usage();
+  }
+
+  void TearDown() override { budget_->set_limit(0); }
+
+  MemoryBudget* budget_ = nullptr;
+  uint64_t initial_usage_ = 0;
+};
+
+TEST_F(MemoryBudgetTest, AccountedMemory) {
+  const uint64_t initial_fragmenter_usage =
+      budget_->usage(MemorySubsystem::kFragmenter);
+  {
+    AccountedMemory memory(MemorySubsystem::kFragmenter);
+    memory.Add(kSize);
+    memory.Add(kSize);
+    EXPECT_EQ(2 * kSize, memory.size());
+    EXPECT_EQ(initial_usage_ + 2 * kSize, budget_->usage());
+    EXPECT_EQ(initial_fragmenter_usage + 2 * kSize,
+              budget_->usage(MemorySubsystem::kFragmenter));
+    EXPECT_LE(initial_usage_ + 2 * kSize, budget_->peak_usage());
+
+    memory.Set(kSize);
+    EXPECT_EQ(initial_usage_ + kSize, budget_->usage());
+  }
+  // Released when destroyed.
+  EXPECT_EQ(initial_usage_, budget_->usage());
+  EXPECT_EQ(initial_fragmenter_usage,
+            budget_->usage(MemorySubsystem::kFragmenter));
+}
+
+TEST_F(MemoryBudgetTest, Exceeded) {
+  EXPECT_FALSE(budget_->exceeded());
+
+  AccountedMemory memory(MemorySubsystem::kDemuxerQueue);
+  memory.Set(kSize);
+  budget_->set_limit(initial_usage_ + kSize);
+  EXPECT_FALSE(budget_->exceeded());
+  memory.Add(1);
+  EXPECT_TRUE(budget_->exceeded());
+  memory.Set(0);
+  EXPECT_FALSE(budget_->exceeded());
+}
+
+TEST_F(MemoryBudgetTest, WaitForBudgetIsBounded) {
+  AccountedMemory memory(MemorySubsystem::kIoCache);
+  memory.Set(kSize);
+  budget_->set_limit(1);
+  const base::TimeTicks start = base::TimeTicks::Now();
+  budget_->WaitForBudget(base::TimeDelta::FromMilliseconds(20));
+  EXPECT_LE(base::TimeDelta::FromMilliseconds(20),
+            base::TimeTicks::Now() - start);
+}
+
+TEST_F(MemoryBudgetTest, WaitForBudgetReturnsOnRelease) {
+  class ReleaseThread : public base::SimpleThread {
+   public:
+    explicit ReleaseThread(AccountedMemory* memory)
+        : base::SimpleThread("ReleaseThread"), memory_(memory) {}
+
+    void Run() override {
+      base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(20));
+      memory_->Set(0);
+    }
+
+   private:
+    AccountedMemory* memory_;
+  };
+
+  AccountedMemory memory(MemorySubsystem::kIoCache);
+  memory.Set(kSize);
+  budget_->set_limit(initial_usage_ + 1);
+  ReleaseThread release_thread(&memory);
+  release_thread.Start();
+  const base::TimeTicks start = base::TimeTicks::Now();
+  budget_->WaitForBudget(base::TimeDelta::FromSeconds(60));
+  EXPECT_GT(base::TimeDelta::FromSeconds(30), base::TimeTicks::Now() - start);
+  EXPECT_FALSE(budget_->exceeded());
+  release_thread.Join();
+}
+
+TEST_F(MemoryBudgetTest, ToString) {
+  budget_->set_limit(4 << 20);
+  const std::string stats = budget_->ToString();
+  EXPECT_NE(std::string::npos, stats.find("budget 4.0MB"));
+  EXPECT_NE(std::string::npos, stats.find("io_cache"));
+  EXPECT_NE(std::string::npos, stats.find("segment_store"));
+}
+
+}  // namespace shaka
@@ -0,0 +1,130 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/memory_mapped_file.h"
+
+#include <string.h>
+#if !defined(OS_WIN)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // !defined(OS_WIN)
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+#include "packager/base/posix/eintr_wrapper.h"
+
+namespace shaka {
+
+MemoryMappedFile::MemoryMappedFile(const char* file_name, const char* mode)
+    : File(file_name), file_mode_(mode) {}
+
+bool MemoryMappedFile::Close() {
+#if !defined(OS_WIN)
+  if (data_ && munmap(const_cast<uint8_t*>(data_), size_) != 0)
+    PLOG(WARNING) << "Failed to unmap " << file_name();
+#endif  // !defined(OS_WIN)
+  data_ = nullptr;
+  delete this;
+  return true;
+}
+
+int64_t MemoryMappedFile::Read(void* buffer, uint64_t length) {
+  DCHECK(buffer);
+  const uint8_t* data = nullptr;
+  const int64_t bytes_read = ReadInPlace(&data, length);
+  if (bytes_read > 0)
+    memcpy(buffer, data, bytes_read);
+  return bytes_read;
+}
+
+int64_t MemoryMappedFile::Write(const void* buffer, uint64_t length) {
+  NOTIMPLEMENTED() << "MemoryMappedFile is read only.";
+  return -1;
+}
+
+int64_t MemoryMappedFile::Size() {
+  return size_;
+}
+
+bool MemoryMappedFile::Flush() {
+  return true;
+}
+
+bool MemoryMappedFile::Seek(uint64_t position) {
+  if (position > size_)
+    return false;
+  position_ = position;
+  return true;
+}
+
+bool MemoryMappedFile::Tell(uint64_t* position) {
+  *position = position_;
+  return true;
+}
+
+bool MemoryMappedFile::SupportsReadInPlace() const {
+  return true;
+}
+
+int64_t MemoryMappedFile::ReadInPlace(const uint8_t** data, uint64_t length) {
+  DCHECK(data);
+  DCHECK_LE(position_, size_);
+  const uint64_t bytes_read = std::min(length, size_ - position_);
+  *data = data_ + position_;
+  position_ += bytes_read;
+  return bytes_read;
+}
+
+MemoryMappedFile::~MemoryMappedFile() {}
+
+bool MemoryMappedFile::Open() {
+  if (file_mode_ != "r") {
+    LOG(ERROR) << "MemoryMappedFile only supports read mode, got '"
+               << file_mode_ << "' for " << file_name();
+    return false;
+  }
+#if defined(OS_WIN)
+  NOTIMPLEMENTED() << "MemoryMappedFile is not supported on Windows.";
+  return false;
+#else
+  const int fd = HANDLE_EINTR(open(file_name().c_str(), O_RDONLY));
+  if (fd < 0) {
+    PLOG(ERROR) << "Failed to open " << file_name();
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+    LOG(ERROR) << file_name() << " is not a regular file.";
+    close(fd);
+    return false;
+  }
+  size_ = info.st_size;
+
+  // mmap does not accept zero length mappings. An empty file is just at
+  // end-of-file from the start.
+  if (size_ > 0) {
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      PLOG(ERROR) << "Failed to mmap " << file_name();
+      close(fd);
+      return false;
+    }
+    if (madvise(mapping, size_, MADV_SEQUENTIAL) != 0)
+      PLOG(WARNING) << "madvise(MADV_SEQUENTIAL) failed for " << file_name();
+    data_ = static_cast<const uint8_t*>(mapping);
+  }
+
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+  return true;
+#endif  // defined(OS_WIN)
+}
+
+}  // namespace shaka
@@ -0,0 +1,59 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_MEMORY_MAPPED_FILE_H_
+#define PACKAGER_FILE_MEMORY_MAPPED_FILE_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "packager/file/file.h"
+
+namespace shaka {
+
+/// Implements a read-only File backed by a memory mapping of a local regular
+/// file. Data can be accessed in place through ReadInPlace() without being
+/// copied into an intermediate buffer. The mapping is advised for sequential
+/// access so the kernel reads ahead aggressively and drops pages behind the
+/// read position early.
+class MemoryMappedFile : public File {
+ public:
+  /// @param file_name C string containing the name of the file to be accessed.
+  /// @param mode C string containing a file access mode. Only "r" is
+  ///        supported.
+  MemoryMappedFile(const char* file_name, const char* mode);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  bool SupportsReadInPlace() const override;
+  int64_t ReadInPlace(const uint8_t** data, uint64_t length) override;
+  /// @}
+
+ protected:
+  ~MemoryMappedFile() override;
+
+  bool Open() override;
+
+ private:
+  std::string file_mode_;
+  const uint8_t* data_ = nullptr;
+  uint64_t size_ = 0;
+  uint64_t position_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(MemoryMappedFile);
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_MEMORY_MAPPED_FILE_H_
@@ -0,0 +1,86 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/memory_mapped_file.h"
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <memory>
+
+#include "packager/base/files/file_util.h"
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+
+namespace shaka {
+namespace {
+const int kDataSize = 1024;
+}  // namespace
+
+class MemoryMappedFileTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    data_.resize(kDataSize);
+    for (int i = 0; i < kDataSize; ++i)
+      data_[i] = i % 256;
+
+    ASSERT_TRUE(base::CreateTemporaryFile(&test_file_path_));
+    ASSERT_EQ(kDataSize,
+              base::WriteFile(test_file_path_, data_.data(), kDataSize));
+    file_name_ = kMemoryMappedFilePrefix + test_file_path_.AsUTF8Unsafe();
+  }
+
+  void TearDown() override { base::DeleteFile(test_file_path_, false); }
+
+  std::string data_;
+  base::FilePath test_file_path_;
+  std::string file_name_;
+};
+
+TEST_F(MemoryMappedFileTest, ReadInPlace) {
+  std::unique_ptr<File, FileCloser> file(File::Open(file_name_.c_str(), "r"));
+  ASSERT_TRUE(file);
+  ASSERT_TRUE(file->SupportsReadInPlace());
+  EXPECT_EQ(kDataSize, file->Size());
+
+  const int kChunkSize = 600;
+  const uint8_t* data = nullptr;
+  ASSERT_EQ(kChunkSize, file->ReadInPlace(&data, kChunkSize));
+  EXPECT_EQ(0, memcmp(data_.data(), data, kChunkSize));
+
+  ASSERT_EQ(kDataSize - kChunkSize, file->ReadInPlace(&data, kChunkSize));
+  EXPECT_EQ(0, memcmp(data_.data() + kChunkSize, data, kDataSize - kChunkSize));
+
+  EXPECT_EQ(0, file->ReadInPlace(&data, kChunkSize));
+}
+
+TEST_F(MemoryMappedFileTest, ReadSeekAndTell) {
+  std::unique_ptr<File, FileCloser> file(File::Open(file_name_.c_str(), "r"));
+  ASSERT_TRUE(file);
+
+  const int kSeekPosition = kDataSize / 2;
+  ASSERT_TRUE(file->Seek(kSeekPosition));
+  uint64_t position = 0;
+  ASSERT_TRUE(file->Tell(&position));
+  EXPECT_EQ(static_cast<uint64_t>(kSeekPosition), position);
+
+  std::string read_data(kDataSize, 0);
+  ASSERT_EQ(kDataSize - kSeekPosition, file->Read(&read_data[0], kDataSize));
+  read_data.resize(kDataSize - kSeekPosition);
+  EXPECT_EQ(data_.substr(kSeekPosition), read_data);
+
+  EXPECT_FALSE(file->Seek(kDataSize + 1));
+}
+
+TEST_F(MemoryMappedFileTest, WriteModeNotSupported) {
+  EXPECT_FALSE(File::Open(file_name_.c_str(), "w"));
+}
+
+TEST_F(MemoryMappedFileTest, IsLocalRegularFile) {
+  EXPECT_TRUE(File::IsLocalRegularFile(file_name_.c_str()));
+}
+
+}  // namespace shaka
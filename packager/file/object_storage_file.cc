@@ -0,0 +1,784 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/object_storage_file.h"
+
+#include <ctype.h>
+#include <gflags/gflags.h>
+#include <inttypes.h>
+#include <openssl/md5.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+
+#include "packager/base/base64.h"
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/base/time/time.h"
+#include "packager/file/aws_sigv4.h"
+#include "packager/file/http_request.h"
+#include "packager/status_macros.h"
+
+DEFINE_string(s3_region,
+              "",
+              "Region of the S3 buckets. Defaults to the AWS_REGION or "
+              "AWS_DEFAULT_REGION environment variable, or to us-east-1.");
+DEFINE_string(s3_endpoint,
+              "",
+              "Endpoint of an S3 compatible service, e.g. "
+              "http://localhost:9000, which is sent path-style requests. "
+              "Amazon S3 is used if empty.");
+DEFINE_uint64(object_storage_part_size,
+              16 << 20,
+              "Size of the parts in which s3:// and gs:// objects are "
+              "uploaded and downloaded. At least 5 MiB.");
+DEFINE_int32(object_storage_parallel_parts,
+             4,
+             "Number of parts of an s3:// or gs:// object uploaded or "
+             "downloaded at a time.");
+
+namespace shaka {
+
+namespace {
+
+// The minimum size of the parts of a multipart upload, but for the last one.
+const uint64_t kMinPartSize = 5 << 20;
+const char kGcsHost[] = "storage.googleapis.com";
+const char kUnsignedPayload[] = "UNSIGNED-PAYLOAD";
+const char kBinaryContentType[] = "Content-Type: application/octet-stream";
+// The maximum number of objects of an S3 multi-object delete request.
+const size_t kMaxObjectsPerDeleteRequest = 1000;
+
+// A request on an object, whose URL and authorization headers are added by
+// PerformRequest().
+struct ObjectRequest {
+  std::string method = "GET";
+  // Without the leading '?'.
+  std::string query;
+  std::vector<std::string> headers;
+  const char* body = nullptr;
+  size_t body_size = 0;
+};
+
+std::string GetEnv(const char* name) {
+  const char* value = getenv(name);
+  return value ? value : "";
+}
+
+std::string GetS3Region() {
+  if (!FLAGS_s3_region.empty())
+    return FLAGS_s3_region;
+  std::string region = GetEnv("AWS_REGION");
+  if (region.empty())
+    region = GetEnv("AWS_DEFAULT_REGION");
+  return region.empty() ? "us-east-1" : region;
+}
+
+std::string GetAmzDate() {
+  base::Time::Exploded now;
+  base::Time::Now().UTCExplode(&now);
+  return base::StringPrintf("%04d%02d%02dT%02d%02d%02dZ", now.year, now.month,
+                            now.day_of_month, now.hour, now.minute,
+                            now.second);
+}
+
+bool ParseObjectName(const std::string& object_name,
+                     std::string* bucket,
+                     std::string* key) {
+  const size_t slash = object_name.find('/');
+  if (slash == 0 || slash == std::string::npos ||
+      slash + 1 == object_name.size()) {
+    LOG(ERROR) << "Invalid object name '" << object_name
+               << "', expecting bucket/key.";
+    return false;
+  }
+  *bucket = object_name.substr(0, slash);
+  *key = object_name.substr(slash + 1);
+  return true;
+}
+
+// Performs |request| on the object |key| of |bucket|, retrying on transient
+// failures. Statuses of 300 and more are failures.
+Status PerformRequest(ObjectStorageFile::Service service,
+                      const std::string& bucket,
+                      const std::string& key,
+                      const ObjectRequest& request,
+                      HttpResponse* response) {
+  std::string scheme = "https://";
+  std::string host;
+  std::string path;
+  if (service == ObjectStorageFile::Service::kGcs) {
+    host = kGcsHost;
+    path = "/" + bucket + "/" + AwsUriEncode(key, false);
+  } else if (FLAGS_s3_endpoint.empty()) {
+    host = bucket + ".s3." + GetS3Region() + ".amazonaws.com";
+    path = "/" + AwsUriEncode(key, false);
+  } else {
+    host = FLAGS_s3_endpoint;
+    const size_t scheme_end = host.find("://");
+    if (scheme_end != std::string::npos) {
+      scheme = host.substr(0, scheme_end + 3);
+      host = host.substr(scheme_end + 3);
+    }
+    if (!host.empty() && host.back() == '/')
+      host.pop_back();
+    path = "/" + bucket + "/" + AwsUriEncode(key, false);
+  }
+  HttpRequest http_request;
+  http_request.method = request.method;
+  http_request.url = scheme + host + path;
+  if (!request.query.empty())
+    http_request.url += "?" + request.query;
+  // Avoids the 100-continue round trip of uploads.
+  http_request.headers.push_back("Expect:");
+  http_request.headers.insert(http_request.headers.end(),
+                              request.headers.begin(), request.headers.end());
+  if (service == ObjectStorageFile::Service::kGcs) {
+    const std::string token = GetEnv("GOOGLE_OAUTH_ACCESS_TOKEN");
+    if (!token.empty())
+      http_request.headers.push_back("Authorization: Bearer " + token);
+  } else {
+    AwsCredentials credentials;
+    credentials.access_key_id = GetEnv("AWS_ACCESS_KEY_ID");
+    credentials.secret_access_key = GetEnv("AWS_SECRET_ACCESS_KEY");
+    credentials.session_token = GetEnv("AWS_SESSION_TOKEN");
+    if (!credentials.access_key_id.empty()) {
+      AwsRequest aws_request;
+      aws_request.method = request.method;
+      aws_request.host = host;
+      aws_request.path = path;
+      aws_request.query = request.query;
+      aws_request.payload_hash = kUnsignedPayload;
+      for (const std::string& header :
+           SignAwsRequest(credentials, GetS3Region(), "s3", aws_request,
+                          GetAmzDate())) {
+        http_request.headers.push_back(header);
+      }
+    }
+  }
+  http_request.body = request.body;
+  http_request.body_size = request.body_size;
+  return PerformHttpRequest(http_request, response);
+}
+
+// Returns the text of the first |tag| element of |xml|, or an empty string.
+std::string GetXmlElement(const std::string& xml, const std::string& tag) {
+  const std::string start_tag = "<" + tag + ">";
+  const size_t start = xml.find(start_tag);
+  if (start == std::string::npos)
+    return "";
+  const size_t text_start = start + start_tag.size();
+  const size_t end = xml.find("</" + tag + ">", text_start);
+  if (end == std::string::npos)
+    return "";
+  return xml.substr(text_start, end - text_start);
+}
+
+std::string XmlEscape(const std::string& text) {
+  std::string escaped;
+  for (const char c : text) {
+    switch (c) {
+      case '&':
+        escaped += "&amp;";
+        break;
+      case '<':
+        escaped += "&lt;";
+        break;
+      case '>':
+        escaped += "&gt;";
+        break;
+      default:
+        escaped += c;
+    }
+  }
+  return escaped;
+}
+
+// Appends |code_point| to |text| in UTF-8.
+void AppendUtf8(uint32_t code_point, std::string* text) {
+  if (code_point < 0x80) {
+    *text += static_cast<char>(code_point);
+  } else if (code_point < 0x800) {
+    *text += static_cast<char>(0xC0 | (code_point >> 6));
+    *text += static_cast<char>(0x80 | (code_point & 0x3F));
+  } else if (code_point < 0x10000) {
+    *text += static_cast<char>(0xE0 | (code_point >> 12));
+    *text += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    *text += static_cast<char>(0x80 | (code_point & 0x3F));
+  } else {
+    *text += static_cast<char>(0xF0 | (code_point >> 18));
+    *text += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+    *text += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    *text += static_cast<char>(0x80 | (code_point & 0x3F));
+  }
+}
+
+// Replaces the predefined and numeric character references of |text|.
+// Unknown or malformed references are kept as is.
+std::string XmlUnescape(const std::string& text) {
+  static const struct {
+    const char* reference;
+    char c;
+  } kPredefinedReferences[] = {
+      {"&amp;", '&'},  {"&lt;", '<'},   {"&gt;", '>'},
+      {"&quot;", '"'}, {"&apos;", '\''},
+  };
+
+  std::string unescaped;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    const size_t amp = text.find('&', pos);
+    if (amp == std::string::npos) {
+      unescaped.append(text, pos, std::string::npos);
+      break;
+    }
+    unescaped.append(text, pos, amp - pos);
+    pos = amp;
+    const size_t semicolon = text.find(';', amp);
+    if (semicolon == std::string::npos) {
+      unescaped.append(text, pos, std::string::npos);
+      break;
+    }
+    const std::string reference = text.substr(amp, semicolon - amp + 1);
+    bool replaced = false;
+    for (const auto& predefined : kPredefinedReferences) {
+      if (reference == predefined.reference) {
+        unescaped += predefined.c;
+        replaced = true;
+        break;
+      }
+    }
+    if (!replaced && reference.size() > 3 && reference[1] == '#') {
+      const bool hex = reference[2] == 'x' || reference[2] == 'X';
+      const std::string digits =
+          reference.substr(hex ? 3 : 2, reference.size() - (hex ? 4 : 3));
+      char* digits_end = nullptr;
+      const unsigned long code_point =
+          strtoul(digits.c_str(), &digits_end, hex ? 16 : 10);
+      if (!digits.empty() && isxdigit(digits[0]) && *digits_end == '\0' &&
+          code_point > 0 && code_point <= 0x10FFFF) {
+        AppendUtf8(static_cast<uint32_t>(code_point), &unescaped);
+        replaced = true;
+      }
+    }
+    if (replaced) {
+      pos = semicolon + 1;
+    } else {
+      unescaped += '&';
+      pos = amp + 1;
+    }
+  }
+  return unescaped;
+}
+
+// Deletes |keys| of the S3 |bucket| with a multi-object delete request, and
+// appends the keys which could not be deleted to |failed_keys|.
+void DeleteS3Objects(const std::string& bucket,
+                     const std::vector<std::string>& keys,
+                     std::vector<std::string>* failed_keys) {
+  // Only the errors are listed in the response in quiet mode.
+  std::string body = "<Delete><Quiet>true</Quiet>";
+  for (const std::string& key : keys)
+    body += "<Object><Key>" + XmlEscape(key) + "</Key></Object>";
+  body += "</Delete>";
+
+  uint8_t md5[MD5_DIGEST_LENGTH];
+  MD5(reinterpret_cast<const uint8_t*>(body.data()), body.size(), md5);
+  std::string md5_base64;
+  base::Base64Encode(
+      base::StringPiece(reinterpret_cast<const char*>(md5), sizeof(md5)),
+      &md5_base64);
+
+  ObjectRequest request;
+  request.method = "POST";
+  request.query = "delete";
+  request.headers.push_back("Content-Type: application/xml");
+  request.headers.push_back("Content-MD5: " + md5_base64);
+  request.body = body.data();
+  request.body_size = body.size();
+  HttpResponse response;
+  Status status =
+      PerformRequest(ObjectStorageFile::Service::kS3, bucket, "", request,
+                     &response);
+  if (!status.ok()) {
+    LOG(ERROR) << "Cannot delete " << keys.size() << " objects of " << bucket
+               << ": " << status;
+    failed_keys->insert(failed_keys->end(), keys.begin(), keys.end());
+    return;
+  }
+  size_t error_start = 0;
+  while ((error_start = response.body.find("<Error>", error_start)) !=
+         std::string::npos) {
+    const size_t error_end = response.body.find("</Error>", error_start);
+    const std::string error = response.body.substr(
+        error_start, error_end == std::string::npos ? std::string::npos
+                                                    : error_end - error_start);
+    LOG(ERROR) << "Cannot delete an object of " << bucket << ": " << error;
+    failed_keys->push_back(XmlUnescape(GetXmlElement(error, "Key")));
+    if (error_end == std::string::npos)
+      break;
+    error_start = error_end;
+  }
+}
+
+}  // namespace
+
+struct ObjectStorageFile::Part {
+  Part()
+      : done(base::WaitableEvent::ResetPolicy::AUTOMATIC,
+             base::WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+  // The data of the part. Its capacity is kept when the part is reused.
+  std::string data;
+  // Offset of the part in the object, for downloads.
+  uint64_t offset = 0;
+  // Size of the part downloaded.
+  size_t size = 0;
+  // Number and ETag of the part uploaded.
+  int number = 0;
+  std::string etag;
+  Status status;
+  // Signaled when the part is downloaded or uploaded.
+  base::WaitableEvent done;
+};
+
+ObjectStorageFile::ObjectStorageFile(Service service,
+                                     const char* object_name,
+                                     const char* mode)
+    : File(std::string(service == Service::kS3 ? kS3FilePrefix
+                                               : kGcsFilePrefix) +
+           object_name),
+      service_(service),
+      object_name_(object_name),
+      mode_(mode),
+      part_size_(std::max(FLAGS_object_storage_part_size, kMinPartSize)) {}
+
+ObjectStorageFile::~ObjectStorageFile() {}
+
+bool ObjectStorageFile::Open() {
+  if (!ParseObjectName(object_name_, &bucket_, &key_))
+    return false;
+  if (mode_ != "r" && mode_ != "w") {
+    LOG(ERROR) << "Unsupported mode '" << mode_ << "' for " << file_name();
+    return false;
+  }
+
+  const int num_parts = std::max(FLAGS_object_storage_parallel_parts, 1);
+  for (int i = 0; i < num_parts; ++i) {
+    parts_.emplace_back(new Part);
+    free_parts_.push_back(parts_.back().get());
+  }
+
+  if (mode_ == "r") {
+    ObjectRequest request;
+    request.method = "HEAD";
+    HttpResponse response;
+    Status status =
+        PerformRequest(service_, bucket_, key_, request, &response);
+    if (!status.ok()) {
+      LOG(ERROR) << "Cannot open " << file_name() << ": " << status;
+      return false;
+    }
+    if (!base::StringToUint64(response.headers["content-length"], &size_)) {
+      LOG(ERROR) << "Unknown size of " << file_name();
+      return false;
+    }
+  }
+  return true;
+}
+
+Status ObjectStorageFile::CloseWithStatus() {
+  Status status;
+  if (mode_ == "r") {
+    DrainParts();
+  } else if (status_.ok()) {
+    status = CompleteUpload();
+  } else {
+    status = status_;
+  }
+  if (!status.ok() && !upload_id_.empty()) {
+    // Waits for the parts uploading before aborting, so that they do not
+    // outlive the upload.
+    DrainParts();
+    ObjectRequest request;
+    request.method = "DELETE";
+    request.query = "uploadId=" + AwsUriEncode(upload_id_, true);
+    HttpResponse response;
+    Status abort_status =
+        PerformRequest(service_, bucket_, key_, request, &response);
+    if (!abort_status.ok())
+      LOG(WARNING) << "Cannot abort the upload of " << file_name() << ": "
+                   << abort_status;
+  }
+  delete this;
+  return status;
+}
+
+bool ObjectStorageFile::Close() {
+  const std::string name = file_name();
+  Status status = CloseWithStatus();
+  if (!status.ok()) {
+    LOG(ERROR) << "Cannot write " << name << ": " << status;
+    return false;
+  }
+  return true;
+}
+
+int64_t ObjectStorageFile::Read(void* buffer, uint64_t length) {
+  DCHECK_EQ(mode_, "r");
+  if (!status_.ok())
+    return -1;
+
+  uint8_t* data = static_cast<uint8_t*>(buffer);
+  uint64_t bytes_read = 0;
+  while (bytes_read < length && position_ < size_) {
+    if (!current_part_) {
+      QueueDownloads();
+      DCHECK(!queued_parts_.empty());
+      Part* part = queued_parts_.front();
+      queued_parts_.pop_front();
+      part->done.Wait();
+      if (!part->status.ok()) {
+        status_ = part->status;
+        LOG(ERROR) << "Cannot read " << file_name() << ": " << status_;
+        FreePart(part);
+        return bytes_read > 0 ? static_cast<int64_t>(bytes_read) : -1;
+      }
+      current_part_ = part;
+    }
+
+    const size_t offset_in_part =
+        static_cast<size_t>(position_ - current_part_->offset);
+    const size_t size =
+        std::min(current_part_->data.size() - offset_in_part,
+                 static_cast<size_t>(length - bytes_read));
+    memcpy(data + bytes_read, current_part_->data.data() + offset_in_part,
+           size);
+    bytes_read += size;
+    position_ += size;
+    if (offset_in_part + size == current_part_->data.size()) {
+      FreePart(current_part_);
+      current_part_ = nullptr;
+    }
+  }
+  return bytes_read;
+}
+
+int64_t ObjectStorageFile::Write(const void* buffer, uint64_t length) {
+  DCHECK_EQ(mode_, "w");
+  if (!status_.ok())
+    return -1;
+
+  const char* data = static_cast<const char*>(buffer);
+  uint64_t bytes_written = 0;
+  while (bytes_written < length) {
+    if (!current_part_) {
+      current_part_ = GetFreePart();
+      if (!status_.ok())
+        return -1;
+      current_part_->data.clear();
+      current_part_->data.reserve(part_size_);
+    }
+
+    const size_t size =
+        std::min(part_size_ - current_part_->data.size(),
+                 static_cast<size_t>(length - bytes_written));
+    current_part_->data.append(data + bytes_written, size);
+    bytes_written += size;
+    position_ += size;
+    if (current_part_->data.size() == part_size_) {
+      Part* part = current_part_;
+      current_part_ = nullptr;
+      status_ = QueueUpload(part);
+      if (!status_.ok()) {
+        LOG(ERROR) << "Cannot write " << file_name() << ": " << status_;
+        return -1;
+      }
+    }
+  }
+  return bytes_written;
+}
+
+int64_t ObjectStorageFile::Size() {
+  return mode_ == "r" ? size_ : position_;
+}
+
+bool ObjectStorageFile::Flush() {
+  // Parts are uploaded as soon as they are full, and the object is only
+  // visible once the upload completes on Close().
+  return status_.ok();
+}
+
+bool ObjectStorageFile::Seek(uint64_t position) {
+  if (mode_ != "r") {
+    LOG(ERROR) << "Seek is not supported when writing " << file_name();
+    return false;
+  }
+  if (!status_.ok())
+    return false;
+  position = std::min(position, size_);
+  if (current_part_ && position >= current_part_->offset &&
+      position < current_part_->offset + current_part_->data.size()) {
+    position_ = position;
+    return true;
+  }
+  if (current_part_) {
+    FreePart(current_part_);
+    current_part_ = nullptr;
+  }
+  // Keeps the parts downloading if they follow the new position.
+  while (!queued_parts_.empty() &&
+         queued_parts_.front()->offset + queued_parts_.front()->size <=
+             position) {
+    Part* part = queued_parts_.front();
+    queued_parts_.pop_front();
+    part->done.Wait();
+    FreePart(part);
+  }
+  if (queued_parts_.empty() || queued_parts_.front()->offset > position) {
+    DrainParts();
+    download_offset_ = position;
+  }
+  position_ = position;
+  return true;
+}
+
+bool ObjectStorageFile::Tell(uint64_t* position) {
+  *position = position_;
+  return true;
+}
+
+bool ObjectStorageFile::Delete(Service service, const char* object_name) {
+  std::string bucket;
+  std::string key;
+  if (!ParseObjectName(object_name, &bucket, &key))
+    return false;
+  ObjectRequest request;
+  request.method = "DELETE";
+  HttpResponse response;
+  Status status = PerformRequest(service, bucket, key, request, &response);
+  if (!status.ok()) {
+    LOG(ERROR) << "Cannot delete " << object_name << ": " << status;
+    return false;
+  }
+  return true;
+}
+
+void ObjectStorageFile::DeleteMultiple(
+    Service service,
+    const std::vector<std::string>& object_names,
+    std::vector<std::string>* failed_object_names) {
+  DCHECK(failed_object_names);
+  if (service == Service::kGcs) {
+    for (const std::string& object_name : object_names) {
+      if (!Delete(service, object_name.c_str()))
+        failed_object_names->push_back(object_name);
+    }
+    return;
+  }
+
+  std::map<std::string, std::vector<std::string>> keys_by_bucket;
+  for (const std::string& object_name : object_names) {
+    std::string bucket;
+    std::string key;
+    if (!ParseObjectName(object_name, &bucket, &key)) {
+      failed_object_names->push_back(object_name);
+      continue;
+    }
+    keys_by_bucket[bucket].push_back(key);
+  }
+  for (const auto& bucket_keys : keys_by_bucket) {
+    const std::string& bucket = bucket_keys.first;
+    const std::vector<std::string>& keys = bucket_keys.second;
+    for (size_t i = 0; i < keys.size(); i += kMaxObjectsPerDeleteRequest) {
+      const size_t end = std::min(i + kMaxObjectsPerDeleteRequest, keys.size());
+      std::vector<std::string> failed_keys;
+      DeleteS3Objects(bucket,
+                      std::vector<std::string>(keys.begin() + i,
+                                               keys.begin() + end),
+                      &failed_keys);
+      for (const std::string& key : failed_keys)
+        failed_object_names->push_back(bucket + "/" + key);
+    }
+  }
+}
+
+void ObjectStorageFile::QueueDownloads() {
+  while (!free_parts_.empty() && download_offset_ < size_) {
+    Part* part = free_parts_.back();
+    free_parts_.pop_back();
+    part->offset = download_offset_;
+    part->size = static_cast<size_t>(
+        std::min(static_cast<uint64_t>(part_size_), size_ - download_offset_));
+    download_offset_ += part->size;
+    queued_parts_.push_back(part);
+    base::WorkerPool::PostTask(
+        FROM_HERE,
+        base::Bind(&ObjectStorageFile::DownloadPart, base::Unretained(this),
+                   base::Unretained(part)),
+        true);
+  }
+}
+
+void ObjectStorageFile::DrainParts() {
+  while (!queued_parts_.empty()) {
+    Part* part = queued_parts_.front();
+    queued_parts_.pop_front();
+    part->done.Wait();
+    FreePart(part);
+  }
+  if (current_part_) {
+    FreePart(current_part_);
+    current_part_ = nullptr;
+  }
+}
+
+Status ObjectStorageFile::QueueUpload(Part* part) {
+  if (upload_id_.empty()) {
+    ObjectRequest request;
+    request.method = "POST";
+    request.query = "uploads";
+    HttpResponse response;
+    RETURN_IF_ERROR(
+        PerformRequest(service_, bucket_, key_, request, &response));
+    upload_id_ = GetXmlElement(response.body, "UploadId");
+    if (upload_id_.empty()) {
+      return Status(error::HTTP_FAILURE,
+                    "No UploadId in the response: " + response.body);
+    }
+  }
+  part->number = static_cast<int>(uploaded_parts_.size() +
+                                  queued_parts_.size()) +
+                 1;
+  queued_parts_.push_back(part);
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&ObjectStorageFile::UploadPart, base::Unretained(this),
+                 base::Unretained(part)),
+      true);
+  return Status::OK;
+}
+
+Status ObjectStorageFile::WaitForUpload(Part* part) {
+  part->done.Wait();
+  if (part->status.ok())
+    uploaded_parts_.emplace_back(part->number, part->etag);
+  return part->status;
+}
+
+ObjectStorageFile::Part* ObjectStorageFile::GetFreePart() {
+  if (free_parts_.empty()) {
+    DCHECK(!queued_parts_.empty());
+    Part* part = queued_parts_.front();
+    queued_parts_.pop_front();
+    status_ = WaitForUpload(part);
+    if (!status_.ok())
+      LOG(ERROR) << "Cannot write " << file_name() << ": " << status_;
+    FreePart(part);
+  }
+  Part* part = free_parts_.back();
+  free_parts_.pop_back();
+  return part;
+}
+
+void ObjectStorageFile::FreePart(Part* part) {
+  free_parts_.push_back(part);
+}
+
+Status ObjectStorageFile::CompleteUpload() {
+  if (upload_id_.empty()) {
+    // The object fits in a part.
+    ObjectRequest request;
+    request.method = "PUT";
+    request.headers.push_back(kBinaryContentType);
+    if (current_part_) {
+      request.body = current_part_->data.data();
+      request.body_size = current_part_->data.size();
+    }
+    HttpResponse response;
+    return PerformRequest(service_, bucket_, key_, request, &response);
+  }
+
+  if (current_part_ && !current_part_->data.empty()) {
+    Part* part = current_part_;
+    current_part_ = nullptr;
+    RETURN_IF_ERROR(QueueUpload(part));
+  }
+  Status status;
+  while (!queued_parts_.empty()) {
+    Part* part = queued_parts_.front();
+    queued_parts_.pop_front();
+    status.Update(WaitForUpload(part));
+    FreePart(part);
+  }
+  RETURN_IF_ERROR(status);
+
+  std::string body = "<CompleteMultipartUpload>";
+  for (const auto& part : uploaded_parts_) {
+    base::StringAppendF(&body,
+                        "<Part><PartNumber>%d</PartNumber>"
+                        "<ETag>%s</ETag></Part>",
+                        part.first, part.second.c_str());
+  }
+  body += "</CompleteMultipartUpload>";
+
+  ObjectRequest request;
+  request.method = "POST";
+  request.query = "uploadId=" + AwsUriEncode(upload_id_, true);
+  request.headers.push_back("Content-Type: application/xml");
+  request.body = body.data();
+  request.body_size = body.size();
+  HttpResponse response;
+  RETURN_IF_ERROR(PerformRequest(service_, bucket_, key_, request, &response));
+  // The completion may fail after the response status is sent.
+  if (response.body.find("<Error>") != std::string::npos) {
+    return Status(error::HTTP_FAILURE,
+                  "Cannot complete the upload: " + response.body);
+  }
+  return Status::OK;
+}
+
+void ObjectStorageFile::DownloadPart(Part* part) {
+  ObjectRequest request;
+  request.headers.push_back(
+      base::StringPrintf("Range: bytes=%" PRIu64 "-%" PRIu64, part->offset,
+                         part->offset + part->size - 1));
+  HttpResponse response;
+  part->status = PerformRequest(service_, bucket_, key_, request, &response);
+  if (part->status.ok() && response.body.size() != part->size) {
+    part->status = Status(
+        error::HTTP_FAILURE,
+        base::StringPrintf("Expecting %zu bytes at offset %" PRIu64
+                           ", received %zu.",
+                           part->size, part->offset, response.body.size()));
+  }
+  part->data.swap(response.body);
+  part->done.Signal();
+}
+
+void ObjectStorageFile::UploadPart(Part* part) {
+  ObjectRequest request;
+  request.method = "PUT";
+  request.query = base::StringPrintf("partNumber=%d&uploadId=%s", part->number,
+                                     AwsUriEncode(upload_id_, true).c_str());
+  request.headers.push_back(kBinaryContentType);
+  request.body = part->data.data();
+  request.body_size = part->data.size();
+  HttpResponse response;
+  part->status = PerformRequest(service_, bucket_, key_, request, &response);
+  part->etag = response.headers["etag"];
+  if (part->status.ok() && part->etag.empty())
+    part->status = Status(error::HTTP_FAILURE, "No ETag for the part.");
+  part->done.Signal();
+}
+
+}  // namespace shaka
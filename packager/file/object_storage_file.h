@@ -0,0 +1,141 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_OBJECT_STORAGE_FILE_H_
+#define PACKAGER_FILE_OBJECT_STORAGE_FILE_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "packager/file/file.h"
+#include "packager/status.h"
+
+namespace shaka {
+
+/// Implements a File for the objects of Amazon S3, or of an S3 compatible
+/// service, named s3://bucket/key, and of Google Cloud Storage, named
+/// gs://bucket/key.
+///
+/// Objects written are uploaded in parts of --object_storage_part_size bytes,
+/// several at a time, with a multipart upload completed on Close(), or with a
+/// single PUT request if they fit in a part. Objects read are downloaded with
+/// ranged GET requests, several at a time, ahead of the read position. The
+/// requests share the connections of HttpFile.
+///
+/// S3 requests are signed with the credentials of the AWS_ACCESS_KEY_ID,
+/// AWS_SECRET_ACCESS_KEY and AWS_SESSION_TOKEN environment variables. GCS
+/// requests are authorized with the OAuth 2.0 access token of the
+/// GOOGLE_OAUTH_ACCESS_TOKEN environment variable. Requests are anonymous if
+/// there are no credentials.
+class ObjectStorageFile : public File {
+ public:
+  enum class Service {
+    kS3,
+    kGcs,
+  };
+
+  /// @param service is the storage service of the object.
+  /// @param object_name is the name of the object, i.e. "bucket/key".
+  /// @param mode C string containing a file access mode. Only "r" and "w" are
+  ///        supported.
+  ObjectStorageFile(Service service, const char* object_name, const char* mode);
+
+  ObjectStorageFile(const ObjectStorageFile&) = delete;
+  ObjectStorageFile& operator=(const ObjectStorageFile&) = delete;
+
+  Status CloseWithStatus();
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+  /// Delete an object.
+  /// @param service is the storage service of the object.
+  /// @param object_name is the name of the object, i.e. "bucket/key".
+  /// @return true if successful, or false otherwise.
+  static bool Delete(Service service, const char* object_name);
+
+  /// Delete objects with as few requests as possible. The objects of an S3
+  /// bucket are deleted with multi-object delete requests of up to 1000
+  /// objects. GCS does not support them, so its objects are deleted one by
+  /// one.
+  /// @param service is the storage service of the objects.
+  /// @param object_names are the names of the objects, i.e. "bucket/key".
+  /// @param[out] failed_object_names gets the names of the objects which
+  ///             could not be deleted.
+  static void DeleteMultiple(Service service,
+                             const std::vector<std::string>& object_names,
+                             std::vector<std::string>* failed_object_names);
+
+ protected:
+  ~ObjectStorageFile() override;
+
+  bool Open() override;
+
+ private:
+  struct Part;
+
+  // Queues downloads of the parts following the last one queued, for the free
+  // parts.
+  void QueueDownloads();
+  // Waits for the parts queued, ignoring their status, and frees them.
+  void DrainParts();
+  // Uploads |part| as the next part of the multipart upload, which is created
+  // first if needed.
+  Status QueueUpload(Part* part);
+  // Waits for the upload of |part| and records its ETag.
+  Status WaitForUpload(Part* part);
+  // Returns a free part, waiting for the oldest part queued if needed.
+  Part* GetFreePart();
+  void FreePart(Part* part);
+  Status CompleteUpload();
+
+  // Run on worker threads.
+  void DownloadPart(Part* part);
+  void UploadPart(Part* part);
+
+  const Service service_;
+  const std::string object_name_;
+  const std::string mode_;
+  const size_t part_size_;
+  std::string bucket_;
+  std::string key_;
+  Status status_;
+
+  // Size of the object read, and read or write position.
+  uint64_t size_ = 0;
+  uint64_t position_ = 0;
+  // Offset of the part following the last part queued for download.
+  uint64_t download_offset_ = 0;
+
+  std::vector<std::unique_ptr<Part>> parts_;
+  std::vector<Part*> free_parts_;
+  // Parts downloaded or uploaded, in order.
+  std::deque<Part*> queued_parts_;
+  // The part being read from or written to, if any.
+  Part* current_part_ = nullptr;
+
+  // The multipart upload, if it is started, and the number and ETag of its
+  // parts uploaded.
+  std::string upload_id_;
+  std::vector<std::pair<int, std::string>> uploaded_parts_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_OBJECT_STORAGE_FILE_H_
@@ -0,0 +1,471 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/object_storage_file.h"
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/file/file_closer.h"
+#include "packager/file/http_request.h"
+
+DECLARE_string(s3_endpoint);
+DECLARE_uint64(object_storage_part_size);
+DECLARE_int32(object_storage_parallel_parts);
+
+namespace shaka {
+namespace {
+
+const char kEndpoint[] = "http://fake-s3";
+const char kGcsEndpoint[] = "https://storage.googleapis.com";
+const char kObjectName[] = "bucket/object.mp4";
+const char kFileName[] = "s3://bucket/object.mp4";
+// The minimum part size.
+const size_t kPartSize = 5 << 20;
+const int kParallelParts = 2;
+
+// |size| bytes which differ from part to part.
+std::string GetData(size_t size) {
+  std::string data(size, 0);
+  for (size_t i = 0; i < size; ++i)
+    data[i] = static_cast<char>(i * 7 + i / kPartSize);
+  return data;
+}
+
+// A fake S3 compatible service, which keeps its objects in memory.
+class FakeObjectStorage {
+ public:
+  Status HandleRequest(const HttpRequest& request, HttpResponse* response) {
+    base::AutoLock auto_lock(lock_);
+    // GCS objects are in the same namespace as the S3 ones.
+    std::string prefix = std::string(kEndpoint) + "/";
+    if (!base::StartsWith(request.url, prefix, base::CompareCase::SENSITIVE))
+      prefix = std::string(kGcsEndpoint) + "/";
+    EXPECT_TRUE(base::StartsWith(request.url, prefix,
+                                 base::CompareCase::SENSITIVE));
+    std::string object_name = request.url.substr(prefix.size());
+    std::map<std::string, std::string> query;
+    const size_t query_start = object_name.find('?');
+    if (query_start != std::string::npos) {
+      for (const std::string& param :
+           base::SplitString(object_name.substr(query_start + 1), "&",
+                             base::KEEP_WHITESPACE,
+                             base::SPLIT_WANT_NONEMPTY)) {
+        const size_t equal = param.find('=');
+        query[param.substr(0, equal)] =
+            equal == std::string::npos ? "" : param.substr(equal + 1);
+      }
+      object_name.resize(query_start);
+    }
+    const std::string body(request.body ? request.body : "",
+                           request.body_size);
+    response->code = 200;
+
+    if (request.method == "POST" && query.count("uploads")) {
+      const std::string upload_id =
+          "upload" + base::IntToString(++num_uploads_);
+      uploads_[upload_id].object_name = object_name;
+      response->body = "<InitiateMultipartUploadResult><UploadId>" +
+                       upload_id +
+                       "</UploadId></InitiateMultipartUploadResult>";
+    } else if (request.method == "PUT" && query.count("partNumber")) {
+      int part_number = 0;
+      EXPECT_TRUE(base::StringToInt(query["partNumber"], &part_number));
+      if (part_number == failing_part_number_)
+        return Fail(500, response);
+      auto upload = uploads_.find(query["uploadId"]);
+      if (upload == uploads_.end())
+        return Fail(404, response);
+      upload->second.parts[part_number] = body;
+      response->headers["etag"] =
+          "\"etag" + base::IntToString(part_number) + "\"";
+    } else if (request.method == "POST" && query.count("uploadId")) {
+      auto upload = uploads_.find(query["uploadId"]);
+      if (upload == uploads_.end())
+        return Fail(404, response);
+      // Assembles the parts listed, in order.
+      std::string data;
+      size_t start = 0;
+      while ((start = body.find("<PartNumber>", start)) != std::string::npos) {
+        int part_number = 0;
+        start += strlen("<PartNumber>");
+        EXPECT_TRUE(base::StringToInt(
+            body.substr(start, body.find('<', start) - start), &part_number));
+        const std::string etag =
+            "<ETag>\"etag" + base::IntToString(part_number) + "\"</ETag>";
+        EXPECT_NE(std::string::npos, body.find(etag, start));
+        part_sizes_.push_back(upload->second.parts[part_number].size());
+        data += upload->second.parts[part_number];
+      }
+      objects_[upload->second.object_name] = data;
+      uploads_.erase(upload);
+    } else if (request.method == "DELETE" && query.count("uploadId")) {
+      if (!uploads_.erase(query["uploadId"]))
+        return Fail(404, response);
+      ++num_aborted_uploads_;
+    } else if (request.method == "PUT") {
+      ++num_single_puts_;
+      objects_[object_name] = body;
+    } else if (request.method == "HEAD" || request.method == "GET") {
+      auto object = objects_.find(object_name);
+      if (object == objects_.end())
+        return Fail(404, response);
+      const std::string& data = object->second;
+      response->headers["content-length"] = base::Uint64ToString(data.size());
+      if (request.method == "HEAD")
+        return Status::OK;
+      uint64_t first = 0;
+      uint64_t last = data.size() - 1;
+      for (const std::string& header : request.headers) {
+        if (sscanf(header.c_str(), "Range: bytes=%" SCNu64 "-%" SCNu64,
+                   &first, &last) == 2) {
+          ++num_range_requests_;
+        }
+      }
+      EXPECT_LT(last, data.size());
+      response->body = data.substr(first, last - first + 1);
+    } else if (request.method == "POST" && query.count("delete")) {
+      // A multi-object delete of the bucket |object_name|, in quiet mode.
+      EXPECT_EQ('/', object_name.back());
+      std::vector<std::string> keys;
+      size_t start = 0;
+      while ((start = body.find("<Key>", start)) != std::string::npos) {
+        start += strlen("<Key>");
+        keys.push_back(
+            Unescape(body.substr(start, body.find("</Key>", start) - start)));
+      }
+      delete_request_sizes_.push_back(keys.size());
+      response->body = "<DeleteResult>";
+      for (const std::string& key : keys) {
+        if (undeletable_objects_.count(object_name + key)) {
+          response->body += "<Error><Key>" + Escape(key) +
+                            "</Key><Code>AccessDenied</Code>"
+                            "<Message>Access Denied</Message></Error>";
+        } else {
+          objects_.erase(object_name + key);
+        }
+      }
+      response->body += "</DeleteResult>";
+    } else if (request.method == "DELETE") {
+      ++num_single_deletes_;
+      if (undeletable_objects_.count(object_name))
+        return Fail(403, response);
+      objects_.erase(object_name);
+    } else {
+      ADD_FAILURE() << "Unexpected request " << request.method << " "
+                    << request.url;
+      return Fail(400, response);
+    }
+    return Status::OK;
+  }
+
+  // Fails the uploads of the parts numbered |part_number|.
+  void set_failing_part_number(int part_number) {
+    failing_part_number_ = part_number;
+  }
+
+  // Fails the deletes of |object_names|.
+  void set_undeletable_objects(const std::set<std::string>& object_names) {
+    undeletable_objects_ = object_names;
+  }
+
+  std::map<std::string, std::string>& objects() { return objects_; }
+  // The sizes of the parts of the multipart uploads completed.
+  const std::vector<size_t>& part_sizes() const { return part_sizes_; }
+  // The multipart uploads neither completed nor aborted.
+  size_t num_pending_uploads() const { return uploads_.size(); }
+  int num_uploads() const { return num_uploads_; }
+  int num_aborted_uploads() const { return num_aborted_uploads_; }
+  int num_single_puts() const { return num_single_puts_; }
+  int num_range_requests() const { return num_range_requests_; }
+  // The numbers of keys of the multi-object delete requests.
+  const std::vector<size_t>& delete_request_sizes() const {
+    return delete_request_sizes_;
+  }
+  int num_single_deletes() const { return num_single_deletes_; }
+
+ private:
+  struct Upload {
+    std::string object_name;
+    std::map<int, std::string> parts;
+  };
+
+  // Escapes all the characters S3 escapes in its responses, some of them
+  // with numeric references.
+  static std::string Escape(const std::string& text) {
+    std::string escaped;
+    for (const char c : text) {
+      switch (c) {
+        case '&':
+          escaped += "&amp;";
+          break;
+        case '<':
+          escaped += "&lt;";
+          break;
+        case '>':
+          escaped += "&gt;";
+          break;
+        case '"':
+          escaped += "&quot;";
+          break;
+        case '\'':
+          escaped += "&#39;";
+          break;
+        case '\t':
+          escaped += "&#x9;";
+          break;
+        default:
+          escaped += c;
+      }
+    }
+    return escaped;
+  }
+
+  // Unescapes the references of the requests, i.e. &amp; &lt; and &gt;.
+  static std::string Unescape(const std::string& text) {
+    std::string unescaped = text;
+    base::ReplaceSubstringsAfterOffset(&unescaped, 0, "&lt;", "<");
+    base::ReplaceSubstringsAfterOffset(&unescaped, 0, "&gt;", ">");
+    base::ReplaceSubstringsAfterOffset(&unescaped, 0, "&amp;", "&");
+    return unescaped;
+  }
+
+  Status Fail(long code, HttpResponse* response) {
+    response->code = code;
+    return Status(error::HTTP_FAILURE,
+                  "response code " + base::Int64ToString(code));
+  }
+
+  base::Lock lock_;
+  std::map<std::string, std::string> objects_;
+  std::map<std::string, Upload> uploads_;
+  std::vector<size_t> part_sizes_;
+  std::set<std::string> undeletable_objects_;
+  std::vector<size_t> delete_request_sizes_;
+  int failing_part_number_ = 0;
+  int num_uploads_ = 0;
+  int num_aborted_uploads_ = 0;
+  int num_single_puts_ = 0;
+  int num_range_requests_ = 0;
+  int num_single_deletes_ = 0;
+};
+
+}  // namespace
+
+class ObjectStorageFileTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_s3_endpoint = kEndpoint;
+    FLAGS_object_storage_part_size = kPartSize;
+    FLAGS_object_storage_parallel_parts = kParallelParts;
+    SetHttpRequestHandlerForTesting(
+        [this](const HttpRequest& request, HttpResponse* response) {
+          return storage_.HandleRequest(request, response);
+        });
+  }
+
+  void TearDown() override { SetHttpRequestHandlerForTesting(nullptr); }
+
+  // Writes |data| to kFileName in chunks of |chunk_size| bytes.
+  bool WriteObject(const std::string& data, size_t chunk_size) {
+    File* file = File::Open(kFileName, "w");
+    if (!file)
+      return false;
+    bool written = true;
+    for (size_t offset = 0; offset < data.size() && written;
+         offset += chunk_size) {
+      const size_t size = std::min(chunk_size, data.size() - offset);
+      written = file->Write(data.data() + offset, size) ==
+                static_cast<int64_t>(size);
+    }
+    return file->Close() && written;
+  }
+
+  google::FlagSaver flag_saver_;
+  FakeObjectStorage storage_;
+};
+
+TEST_F(ObjectStorageFileTest, WriteInParts) {
+  // Chunks which straddle the part boundaries.
+  const size_t kChunkSize = (1 << 20) + 7;
+  const std::string data = GetData(2 * kPartSize + kPartSize / 2);
+  ASSERT_TRUE(WriteObject(data, kChunkSize));
+
+  EXPECT_EQ(data, storage_.objects()[kObjectName]);
+  EXPECT_EQ(std::vector<size_t>({kPartSize, kPartSize, kPartSize / 2}),
+            storage_.part_sizes());
+  EXPECT_EQ(1, storage_.num_uploads());
+  EXPECT_EQ(0, storage_.num_single_puts());
+  EXPECT_EQ(0u, storage_.num_pending_uploads());
+}
+
+TEST_F(ObjectStorageFileTest, WriteWholeParts) {
+  // More parts than are uploaded at a time.
+  const size_t kNumParts = kParallelParts + 1;
+  const std::string data = GetData(kNumParts * kPartSize);
+  ASSERT_TRUE(WriteObject(data, kPartSize));
+
+  EXPECT_EQ(data, storage_.objects()[kObjectName]);
+  // No empty last part.
+  EXPECT_EQ(std::vector<size_t>(kNumParts, kPartSize), storage_.part_sizes());
+  EXPECT_EQ(0u, storage_.num_pending_uploads());
+}
+
+TEST_F(ObjectStorageFileTest, WriteObjectSmallerThanAPart) {
+  const std::string data = GetData(kPartSize - 1);
+  ASSERT_TRUE(WriteObject(data, data.size()));
+
+  EXPECT_EQ(data, storage_.objects()[kObjectName]);
+  EXPECT_EQ(0, storage_.num_uploads());
+  EXPECT_EQ(1, storage_.num_single_puts());
+}
+
+TEST_F(ObjectStorageFileTest, WriteEmptyObject) {
+  ASSERT_TRUE(WriteObject("", 1));
+
+  ASSERT_EQ(1u, storage_.objects().count(kObjectName));
+  EXPECT_TRUE(storage_.objects()[kObjectName].empty());
+  EXPECT_EQ(0, storage_.num_uploads());
+}
+
+TEST_F(ObjectStorageFileTest, PartFailureAbortsTheUpload) {
+  storage_.set_failing_part_number(2);
+  const std::string data = GetData(3 * kPartSize + 1);
+  EXPECT_FALSE(WriteObject(data, kPartSize));
+
+  EXPECT_EQ(0u, storage_.objects().count(kObjectName));
+  EXPECT_EQ(1, storage_.num_aborted_uploads());
+  EXPECT_EQ(0u, storage_.num_pending_uploads());
+}
+
+TEST_F(ObjectStorageFileTest, LastPartFailureAbortsTheUpload) {
+  // The last part is only uploaded on Close().
+  storage_.set_failing_part_number(2);
+  const std::string data = GetData(kPartSize + 1);
+  EXPECT_FALSE(WriteObject(data, data.size()));
+
+  EXPECT_EQ(0u, storage_.objects().count(kObjectName));
+  EXPECT_EQ(1, storage_.num_aborted_uploads());
+  EXPECT_EQ(0u, storage_.num_pending_uploads());
+}
+
+TEST_F(ObjectStorageFileTest, Read) {
+  const std::string data = GetData(3 * kPartSize + kPartSize / 3);
+  storage_.objects()[kObjectName] = data;
+
+  std::string content;
+  ASSERT_TRUE(File::ReadFileToString(kFileName, &content));
+  EXPECT_EQ(data, content);
+  // A ranged request per part.
+  EXPECT_EQ(4, storage_.num_range_requests());
+}
+
+TEST_F(ObjectStorageFileTest, SeekAndRead) {
+  const std::string data = GetData(3 * kPartSize);
+  storage_.objects()[kObjectName] = data;
+  std::unique_ptr<File, FileCloser> file(File::Open(kFileName, "r"));
+  ASSERT_TRUE(file);
+  EXPECT_EQ(static_cast<int64_t>(data.size()), file->Size());
+
+  // Reads across a part boundary, after a seek back and forth.
+  const size_t kReadSize = 100;
+  const uint64_t kPositions[] = {2 * kPartSize - kReadSize / 2, 10,
+                                 kPartSize - 1};
+  for (const uint64_t position : kPositions) {
+    ASSERT_TRUE(file->Seek(position));
+    std::string buffer(kReadSize, 0);
+    ASSERT_EQ(static_cast<int64_t>(kReadSize),
+              file->Read(&buffer[0], buffer.size()));
+    EXPECT_EQ(data.substr(position, kReadSize), buffer);
+  }
+}
+
+TEST_F(ObjectStorageFileTest, OpenMissingObject) {
+  EXPECT_FALSE(File::Open(kFileName, "r"));
+}
+
+TEST_F(ObjectStorageFileTest, DeleteMultiple) {
+  // Keys with characters which are escaped in the requests and responses.
+  const std::string kDeletable = "bucket/a&b<c>.mp4";
+  const std::string kUndeletable = "bucket/it's \"d\"\t&<e>.mp4";
+  const std::string kOtherBucket = "other/f.mp4";
+  const std::string kInvalid = "no-key/";
+  for (const std::string& name : {kDeletable, kUndeletable, kOtherBucket})
+    storage_.objects()[name] = "data";
+  storage_.set_undeletable_objects({kUndeletable});
+
+  std::vector<std::string> failed_object_names;
+  ObjectStorageFile::DeleteMultiple(
+      ObjectStorageFile::Service::kS3,
+      {kDeletable, kInvalid, kUndeletable, kOtherBucket},
+      &failed_object_names);
+
+  std::sort(failed_object_names.begin(), failed_object_names.end());
+  EXPECT_EQ(std::vector<std::string>({kUndeletable, kInvalid}),
+            failed_object_names);
+  EXPECT_EQ(0u, storage_.objects().count(kDeletable));
+  EXPECT_EQ(1u, storage_.objects().count(kUndeletable));
+  EXPECT_EQ(0u, storage_.objects().count(kOtherBucket));
+  // A request per bucket.
+  EXPECT_EQ(std::vector<size_t>({2, 1}), storage_.delete_request_sizes());
+  EXPECT_EQ(0, storage_.num_single_deletes());
+}
+
+TEST_F(ObjectStorageFileTest, DeleteMultipleInBatches) {
+  const size_t kNumObjects = 2500;
+  std::vector<std::string> object_names;
+  for (size_t i = 0; i < kNumObjects; ++i) {
+    object_names.push_back("bucket/segment" + base::SizeTToString(i) +
+                           ".m4s");
+    storage_.objects()[object_names.back()] = "data";
+  }
+
+  std::vector<std::string> failed_object_names;
+  ObjectStorageFile::DeleteMultiple(ObjectStorageFile::Service::kS3,
+                                    object_names, &failed_object_names);
+
+  EXPECT_TRUE(failed_object_names.empty());
+  EXPECT_TRUE(storage_.objects().empty());
+  // At most 1000 keys per request.
+  EXPECT_EQ(std::vector<size_t>({1000, 1000, 500}),
+            storage_.delete_request_sizes());
+}
+
+TEST_F(ObjectStorageFileTest, DeleteMultipleGcsObjects) {
+  const std::string kDeletable = "bucket/a.mp4";
+  const std::string kUndeletable = "bucket/b.mp4";
+  storage_.objects()[kDeletable] = "data";
+  storage_.objects()[kUndeletable] = "data";
+  storage_.set_undeletable_objects({kUndeletable});
+
+  std::vector<std::string> failed_object_names;
+  ObjectStorageFile::DeleteMultiple(ObjectStorageFile::Service::kGcs,
+                                    {kDeletable, kUndeletable},
+                                    &failed_object_names);
+
+  EXPECT_EQ(std::vector<std::string>({kUndeletable}), failed_object_names);
+  EXPECT_EQ(0u, storage_.objects().count(kDeletable));
+  EXPECT_EQ(1u, storage_.objects().count(kUndeletable));
+  // GCS has no multi-object delete: a request per object.
+  EXPECT_EQ(2, storage_.num_single_deletes());
+  EXPECT_TRUE(storage_.delete_request_sizes().empty());
+}
+
+}  // namespace shaka
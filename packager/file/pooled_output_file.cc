@@ -0,0 +1,254 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/pooled_output_file.h"
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+#include "packager/base/threading/simple_thread.h"
+#include "packager/file/thread_class.h"
+
+namespace shaka {
+
+namespace {
+
+// Maximum number of blocks of a file waiting to be written, before writes to
+// the file block.
+const size_t kMaxQueuedBlocks = 4;
+// Maximum number of free blocks kept for reuse.
+const size_t kMaxFreeBlocks = 64;
+
+// Keeps the blocks of the files closed for the next files, so that writing
+// many small files does not allocate a block for each.
+class BlockPool {
+ public:
+  static BlockPool* GetInstance() {
+    // Intentionally leaked, like the I/O threads.
+    static BlockPool* pool = new BlockPool;
+    return pool;
+  }
+
+  std::vector<uint8_t> Take(uint64_t block_size) {
+    std::vector<uint8_t> block;
+    {
+      base::AutoLock auto_lock(lock_);
+      if (!free_blocks_.empty()) {
+        block = std::move(free_blocks_.back());
+        free_blocks_.pop_back();
+      }
+    }
+    block.clear();
+    block.reserve(block_size);
+    return block;
+  }
+
+  void Return(std::vector<uint8_t> block) {
+    if (block.capacity() == 0)
+      return;
+    base::AutoLock auto_lock(lock_);
+    if (free_blocks_.size() < kMaxFreeBlocks)
+      free_blocks_.push_back(std::move(block));
+  }
+
+ private:
+  base::Lock lock_;
+  std::vector<std::vector<uint8_t>> free_blocks_;
+};
+
+// The I/O threads, which write the blocks queued of the files scheduled, one
+// file at a time.
+class IoThreadPool : public base::DelegateSimpleThread::Delegate {
+ public:
+  static IoThreadPool* GetInstance(int num_threads) {
+    // Intentionally leaked: the threads run until exit.
+    static IoThreadPool* pool = new IoThreadPool(num_threads);
+    return pool;
+  }
+
+  void Schedule(PooledOutputFile* file) {
+    base::AutoLock auto_lock(lock_);
+    files_.push_back(file);
+    file_scheduled_.Signal();
+  }
+
+  // base::DelegateSimpleThread::Delegate implementation.
+  void Run() override {
+    SetCurrentThreadClass(ThreadClass::kIo);
+    while (true) {
+      PooledOutputFile* file = nullptr;
+      {
+        base::AutoLock auto_lock(lock_);
+        while (files_.empty())
+          file_scheduled_.Wait();
+        file = files_.front();
+        files_.pop_front();
+      }
+      file->WriteQueuedBlocks();
+    }
+  }
+
+ private:
+  explicit IoThreadPool(int num_threads) : file_scheduled_(&lock_) {
+    for (int i = 0; i < num_threads; ++i) {
+      threads_.emplace_back(
+          new base::DelegateSimpleThread(this, "PooledOutputFile"));
+      threads_.back()->Start();
+    }
+  }
+
+  base::Lock lock_;
+  base::ConditionVariable file_scheduled_;
+  std::deque<PooledOutputFile*> files_;
+  std::vector<std::unique_ptr<base::DelegateSimpleThread>> threads_;
+};
+
+bool WriteBlock(const std::vector<uint8_t>& block, File* file) {
+  size_t bytes_written = 0;
+  while (bytes_written < block.size()) {
+    const int64_t size = file->Write(block.data() + bytes_written,
+                                     block.size() - bytes_written);
+    if (size <= 0)
+      return false;
+    bytes_written += size;
+  }
+  return true;
+}
+
+}  // namespace
+
+PooledOutputFile::PooledOutputFile(
+    std::unique_ptr<File, FileCloser> internal_file,
+    int num_threads,
+    uint64_t block_size)
+    : File(internal_file->file_name()),
+      internal_file_(std::move(internal_file)),
+      num_threads_(std::max(num_threads, 1)),
+      block_size_(std::max(block_size, static_cast<uint64_t>(1))),
+      block_written_(&lock_) {}
+
+PooledOutputFile::~PooledOutputFile() {}
+
+bool PooledOutputFile::Open() {
+  if (!internal_file_->Open())
+    return false;
+  current_block_ = BlockPool::GetInstance()->Take(block_size_);
+  return true;
+}
+
+bool PooledOutputFile::Close() {
+  bool result = WaitForQueuedBlocks();
+  BlockPool::GetInstance()->Return(std::move(current_block_));
+  if (!internal_file_.release()->Close())
+    result = false;
+  delete this;
+  return result;
+}
+
+int64_t PooledOutputFile::Read(void* buffer, uint64_t length) {
+  NOTIMPLEMENTED() << "PooledOutputFile is write only.";
+  return -1;
+}
+
+int64_t PooledOutputFile::Write(const void* buffer, uint64_t length) {
+  {
+    base::AutoLock auto_lock(lock_);
+    if (write_failed_)
+      return -1;
+  }
+  const uint8_t* data = static_cast<const uint8_t*>(buffer);
+  uint64_t bytes_written = 0;
+  while (bytes_written < length) {
+    const size_t size = static_cast<size_t>(std::min(
+        block_size_ - current_block_.size(), length - bytes_written));
+    current_block_.insert(current_block_.end(), data + bytes_written,
+                          data + bytes_written + size);
+    bytes_written += size;
+    if (current_block_.size() == block_size_)
+      QueueCurrentBlock();
+  }
+  position_ += length;
+  return length;
+}
+
+int64_t PooledOutputFile::Size() {
+  if (!WaitForQueuedBlocks())
+    return -1;
+  return internal_file_->Size();
+}
+
+bool PooledOutputFile::Flush() {
+  return WaitForQueuedBlocks() && internal_file_->Flush();
+}
+
+bool PooledOutputFile::Seek(uint64_t position) {
+  if (!WaitForQueuedBlocks() || !internal_file_->Seek(position))
+    return false;
+  position_ = position;
+  return true;
+}
+
+bool PooledOutputFile::Tell(uint64_t* position) {
+  *position = position_;
+  return true;
+}
+
+void PooledOutputFile::WriteQueuedBlocks() {
+  while (true) {
+    std::vector<uint8_t> block;
+    bool write_failed = false;
+    {
+      base::AutoLock auto_lock(lock_);
+      if (queued_blocks_.empty()) {
+        scheduled_ = false;
+        // The file may be deleted as soon as the lock is released.
+        block_written_.Broadcast();
+        return;
+      }
+      block = std::move(queued_blocks_.front());
+      queued_blocks_.pop_front();
+      write_failed = write_failed_;
+    }
+    // The blocks following a failed write are dropped.
+    if (!write_failed && !WriteBlock(block, internal_file_.get())) {
+      LOG(ERROR) << "Failed to write " << file_name();
+      write_failed = true;
+    }
+    BlockPool::GetInstance()->Return(std::move(block));
+    base::AutoLock auto_lock(lock_);
+    write_failed_ = write_failed;
+    block_written_.Broadcast();
+  }
+}
+
+void PooledOutputFile::QueueCurrentBlock() {
+  if (current_block_.empty())
+    return;
+  bool schedule = false;
+  {
+    base::AutoLock auto_lock(lock_);
+    while (queued_blocks_.size() >= kMaxQueuedBlocks)
+      block_written_.Wait();
+    queued_blocks_.push_back(std::move(current_block_));
+    if (!scheduled_) {
+      scheduled_ = true;
+      schedule = true;
+    }
+  }
+  if (schedule)
+    IoThreadPool::GetInstance(num_threads_)->Schedule(this);
+  current_block_ = BlockPool::GetInstance()->Take(block_size_);
+}
+
+bool PooledOutputFile::WaitForQueuedBlocks() {
+  QueueCurrentBlock();
+  base::AutoLock auto_lock(lock_);
+  while (scheduled_)
+    block_written_.Wait();
+  return !write_failed_;
+}
+
+}  // namespace shaka
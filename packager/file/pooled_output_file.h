@@ -0,0 +1,85 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_POOLED_OUTPUT_FILE_H_
+#define PACKAGER_FILE_POOLED_OUTPUT_FILE_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+
+namespace shaka {
+
+/// Writes a file behind the caller on a fixed set of I/O threads shared by all
+/// the pooled output files, instead of a thread task and a cache per file like
+/// ThreadedIoFile, which is costly for the many small segments of audio and
+/// text streams. The data is buffered in blocks taken from a shared pool,
+/// which are written in order by one of the I/O threads once full, and on
+/// Flush() or Close(), which wait for them to be written.
+class PooledOutputFile : public File {
+ public:
+  /// @param internal_file is the file written, not opened yet.
+  /// @param num_threads is the number of I/O threads of the pool, which is
+  ///        created by the first file.
+  /// @param block_size is the size of the blocks written.
+  PooledOutputFile(std::unique_ptr<File, FileCloser> internal_file,
+                   int num_threads,
+                   uint64_t block_size);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+  /// Writes the blocks queued, in order. Runs on an I/O thread.
+  void WriteQueuedBlocks();
+
+ protected:
+  ~PooledOutputFile() override;
+
+  bool Open() override;
+
+ private:
+  PooledOutputFile(const PooledOutputFile&) = delete;
+  PooledOutputFile& operator=(const PooledOutputFile&) = delete;
+
+  // Queues |current_block_| to be written, waiting for room in the queue.
+  void QueueCurrentBlock();
+  // Queues |current_block_| and waits for all the blocks to be written.
+  // Returns false if a write failed.
+  bool WaitForQueuedBlocks();
+
+  std::unique_ptr<File, FileCloser> internal_file_;
+  const int num_threads_;
+  const uint64_t block_size_;
+  std::vector<uint8_t> current_block_;
+  uint64_t position_ = 0;
+
+  base::Lock lock_;
+  // Signaled when a block is written.
+  base::ConditionVariable block_written_;
+  std::deque<std::vector<uint8_t>> queued_blocks_;
+  // Whether the file is queued on, or being written by, an I/O thread.
+  bool scheduled_ = false;
+  bool write_failed_ = false;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_POOLED_OUTPUT_FILE_H_
@@ -7,10 +7,21 @@
 #ifndef PACKAGER_FILE_PUBLIC_BUFFER_CALLBACK_PARAMS_H_
 #define PACKAGER_FILE_PUBLIC_BUFFER_CALLBACK_PARAMS_H_
 
+#include <stdint.h>
+
 #include <functional>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace shaka {
 
+/// A reference counted block of data. The data is never modified once shared.
+struct SharedBuffer {
+  std::shared_ptr<const uint8_t> data;
+  uint64_t size = 0;
+};
+
 /// Buffer callback params.
 struct BufferCallbackParams {
   /// If this function is specified, packager treats @a StreamDescriptor.input
@@ -28,6 +39,17 @@ struct BufferCallbackParams {
   std::function<
       int64_t(const std::string& name, const void* buffer, uint64_t size)>
       write_func;
+  /// Like @a write_func, but media segments are handed over without copying,
+  /// as the reference counted blocks they are assembled from, e.g. the moof
+  /// box and the samples of the mdat box. The function may keep the
+  /// references after returning, e.g. to serve the segments from memory. It
+  /// returns the number of bytes taken, i.e. the total size of @a buffers, or
+  /// a negative value on error. If @a write_func is not specified, other
+  /// outputs, e.g. manifests, are copied into a single block and handed over
+  /// through this function too.
+  std::function<int64_t(const std::string& name,
+                        const std::vector<SharedBuffer>& buffers)>
+      write_buffers_func;
 };
 
 }  // namespace shaka
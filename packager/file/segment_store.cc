@@ -0,0 +1,191 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/segment_store.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+
+SegmentStoreObject::SegmentStoreObject()
+    : data_memory_(MemorySubsystem::kSegmentStore) {}
+
+SegmentStoreObject::~SegmentStoreObject() {}
+
+void SegmentStoreObject::Append(const void* data, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  base::AutoLock auto_lock(lock_);
+  DCHECK(!finished_);
+  data_.insert(data_.end(), bytes, bytes + size);
+  data_memory_.Set(data_.capacity());
+}
+
+void SegmentStoreObject::Finish() {
+  base::AutoLock auto_lock(lock_);
+  finished_ = true;
+}
+
+bool SegmentStoreObject::Read(uint64_t offset,
+                              size_t max_size,
+                              std::string* data) const {
+  base::AutoLock auto_lock(lock_);
+  if (offset < data_.size()) {
+    const size_t size = std::min(max_size, data_.size() - offset);
+    data->append(reinterpret_cast<const char*>(data_.data()) + offset, size);
+    offset += size;
+  }
+  return finished_ && offset >= data_.size();
+}
+
+uint64_t SegmentStoreObject::size() const {
+  base::AutoLock auto_lock(lock_);
+  return data_.size();
+}
+
+bool SegmentStoreObject::finished() const {
+  base::AutoLock auto_lock(lock_);
+  return finished_;
+}
+
+SegmentStore::SegmentStore() {}
+
+SegmentStore::~SegmentStore() {}
+
+SegmentStore* SegmentStore::GetInstance() {
+  static SegmentStore instance;
+  return &instance;
+}
+
+std::shared_ptr<SegmentStoreObject> SegmentStore::Create(
+    const std::string& name) {
+  std::shared_ptr<SegmentStoreObject> object(new SegmentStoreObject);
+  Put(name, object);
+  return object;
+}
+
+void SegmentStore::Put(const std::string& name,
+                       std::shared_ptr<SegmentStoreObject> object) {
+  base::AutoLock auto_lock(lock_);
+  objects_[name] = std::move(object);
+}
+
+std::shared_ptr<const SegmentStoreObject> SegmentStore::Get(
+    const std::string& name) const {
+  base::AutoLock auto_lock(lock_);
+  auto iter = objects_.find(name);
+  if (iter == objects_.end())
+    return nullptr;
+  return iter->second;
+}
+
+bool SegmentStore::Delete(const std::string& name) {
+  base::AutoLock auto_lock(lock_);
+  return objects_.erase(name) > 0;
+}
+
+void SegmentStore::DeleteAll() {
+  base::AutoLock auto_lock(lock_);
+  objects_.clear();
+}
+
+uint64_t SegmentStore::TotalSize() const {
+  base::AutoLock auto_lock(lock_);
+  uint64_t total_size = 0;
+  for (const auto& entry : objects_)
+    total_size += entry.second->size();
+  return total_size;
+}
+
+SegmentStoreFile::SegmentStoreFile(const char* file_name, const char* mode)
+    : File(file_name), mode_(mode) {}
+
+SegmentStoreFile::~SegmentStoreFile() {}
+
+bool SegmentStoreFile::Close() {
+  if (written_object_)
+    written_object_->Finish();
+  delete this;
+  return true;
+}
+
+int64_t SegmentStoreFile::Read(void* buffer, uint64_t length) {
+  if (!object_) {
+    LOG(ERROR) << "SegmentStoreFile " << file_name()
+               << " is not open for reading.";
+    return -1;
+  }
+  std::string data;
+  object_->Read(position_, static_cast<size_t>(length), &data);
+  const size_t size = data.size();
+  memcpy(buffer, data.data(), size);
+  position_ += size;
+  return size;
+}
+
+int64_t SegmentStoreFile::Write(const void* buffer, uint64_t length) {
+  if (!written_object_) {
+    LOG(ERROR) << "SegmentStoreFile " << file_name()
+               << " is not open for writing.";
+    return -1;
+  }
+  written_object_->Append(buffer, length);
+  position_ += length;
+  return length;
+}
+
+int64_t SegmentStoreFile::Size() {
+  return written_object_ ? written_object_->size() : object_->size();
+}
+
+bool SegmentStoreFile::Flush() {
+  // The data is visible to readers as soon as it is written.
+  return true;
+}
+
+bool SegmentStoreFile::Seek(uint64_t position) {
+  if (written_object_) {
+    VLOG(1) << "SegmentStoreFile does not support Seek() when writing.";
+    return false;
+  }
+  if (position > object_->size())
+    return false;
+  position_ = position;
+  return true;
+}
+
+bool SegmentStoreFile::Tell(uint64_t* position) {
+  *position = position_;
+  return true;
+}
+
+bool SegmentStoreFile::WriteAtomically(const char* file_name,
+                                       const std::string& contents) {
+  std::shared_ptr<SegmentStoreObject> object(new SegmentStoreObject);
+  object->Append(contents.data(), contents.size());
+  object->Finish();
+  SegmentStore::GetInstance()->Put(file_name, std::move(object));
+  return true;
+}
+
+bool SegmentStoreFile::Open() {
+  if (mode_ == "r") {
+    object_ = SegmentStore::GetInstance()->Get(file_name());
+    return object_ != nullptr;
+  }
+  if (mode_ == "w") {
+    written_object_ = SegmentStore::GetInstance()->Create(file_name());
+    return true;
+  }
+  NOTIMPLEMENTED() << "File mode '" << mode_
+                   << "' not supported by SegmentStoreFile";
+  return false;
+}
+
+}  // namespace shaka
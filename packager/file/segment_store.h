@@ -0,0 +1,134 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_SEGMENT_STORE_H_
+#define PACKAGER_FILE_SEGMENT_STORE_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/file/file.h"
+#include "packager/file/memory_budget.h"
+
+namespace shaka {
+
+/// The data of an object of SegmentStore. It can be read while it is being
+/// written, e.g. to serve low latency segments while they are produced.
+class SegmentStoreObject {
+ public:
+  SegmentStoreObject();
+  ~SegmentStoreObject();
+
+  /// Appends @a size bytes of @a data. Must not be called once finished.
+  void Append(const void* data, size_t size);
+  /// Marks the object complete.
+  void Finish();
+
+  /// Appends the data from @a offset to the current end of the object, up to
+  /// @a max_size bytes, to @a data.
+  /// @return true if the object is complete and @a data reaches its end, i.e.
+  ///         no data will follow.
+  bool Read(uint64_t offset, size_t max_size, std::string* data) const;
+  uint64_t size() const;
+  bool finished() const;
+
+ private:
+  SegmentStoreObject(const SegmentStoreObject&) = delete;
+  SegmentStoreObject& operator=(const SegmentStoreObject&) = delete;
+
+  mutable base::Lock lock_;
+  std::vector<uint8_t> data_;
+  AccountedMemory data_memory_;
+  bool finished_ = false;
+};
+
+/// A thread-safe in-memory store of the segments and manifests written to
+/// store:// files, from which they can be served directly, see
+/// SegmentServer. Unlike MemoryFile, objects can be read while they are
+/// written, and are replaced when written again. Objects are only removed when
+/// deleted, so live outputs should remove the segments which leave the time
+/// shift window, see HlsParams::preserved_segments_outside_live_window and
+/// MpdParams::preserved_segments_outside_live_window.
+class SegmentStore {
+ public:
+  static SegmentStore* GetInstance();
+
+  /// Creates an empty, unfinished, object named @a name, replacing any
+  /// object with that name. Readers of the replaced object keep it.
+  std::shared_ptr<SegmentStoreObject> Create(const std::string& name);
+  /// Stores @a object as the object named @a name, replacing any object
+  /// with that name.
+  void Put(const std::string& name,
+           std::shared_ptr<SegmentStoreObject> object);
+  /// @return The object named @a name, or nullptr if there is none.
+  std::shared_ptr<const SegmentStoreObject> Get(const std::string& name) const;
+  /// Deletes the object named @a name.
+  /// @return true if the object existed.
+  bool Delete(const std::string& name);
+  /// Deletes all the objects.
+  void DeleteAll();
+
+  /// @return The total size of the objects stored, in bytes.
+  uint64_t TotalSize() const;
+
+ private:
+  SegmentStore();
+  ~SegmentStore();
+  SegmentStore(const SegmentStore&) = delete;
+  SegmentStore& operator=(const SegmentStore&) = delete;
+
+  mutable base::Lock lock_;
+  std::map<std::string, std::shared_ptr<SegmentStoreObject>> objects_;
+};
+
+/// Implements a File which reads or writes an object of SegmentStore. Written
+/// objects are visible to readers as soon as the file is opened, and are
+/// finished when it is closed.
+class SegmentStoreFile : public File {
+ public:
+  /// @param file_name is the name of the object, without the store:// prefix.
+  /// @param mode C string containing a file access mode. Only "r" and "w" are
+  ///        supported.
+  SegmentStoreFile(const char* file_name, const char* mode);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+  /// Writes @a contents as the object named @a file_name, which becomes
+  /// visible to readers once finished.
+  static bool WriteAtomically(const char* file_name,
+                              const std::string& contents);
+
+ protected:
+  ~SegmentStoreFile() override;
+  bool Open() override;
+
+ private:
+  SegmentStoreFile(const SegmentStoreFile&) = delete;
+  SegmentStoreFile& operator=(const SegmentStoreFile&) = delete;
+
+  const std::string mode_;
+  std::shared_ptr<const SegmentStoreObject> object_;
+  std::shared_ptr<SegmentStoreObject> written_object_;
+  uint64_t position_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_SEGMENT_STORE_H_
@@ -0,0 +1,75 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/segment_store.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "packager/file/file_closer.h"
+
+namespace shaka {
+
+class SegmentStoreTest : public testing::Test {
+ protected:
+  void TearDown() override { SegmentStore::GetInstance()->DeleteAll(); }
+};
+
+TEST_F(SegmentStoreTest, ReadWhileWriting) {
+  std::unique_ptr<File, FileCloser> writer(
+      File::Open("store://live/segment1.m4s", "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(4, writer->Write("moof", 4));
+
+  std::shared_ptr<const SegmentStoreObject> object =
+      SegmentStore::GetInstance()->Get("live/segment1.m4s");
+  ASSERT_TRUE(object);
+  std::string data;
+  EXPECT_FALSE(object->Read(0, 100, &data));
+  EXPECT_EQ("moof", data);
+
+  ASSERT_EQ(4, writer->Write("mdat", 4));
+  ASSERT_TRUE(writer.release()->Close());
+  EXPECT_TRUE(object->Read(data.size(), 100, &data));
+  EXPECT_EQ("moofmdat", data);
+}
+
+TEST_F(SegmentStoreTest, ReadPartOfFinishedObject) {
+  ASSERT_TRUE(File::WriteFileAtomically("store://live/segment1.m4s",
+                                        "moofmdat"));
+  std::shared_ptr<const SegmentStoreObject> object =
+      SegmentStore::GetInstance()->Get("live/segment1.m4s");
+  ASSERT_TRUE(object);
+  std::string data;
+  // Not complete as there is data left to read.
+  EXPECT_FALSE(object->Read(0, 4, &data));
+  EXPECT_EQ("moof", data);
+  EXPECT_TRUE(object->Read(data.size(), 4, &data));
+  EXPECT_EQ("moofmdat", data);
+}
+
+TEST_F(SegmentStoreTest, WriteAtomicallyAndDelete) {
+  ASSERT_TRUE(File::WriteFileAtomically("store://live/manifest.mpd", "mpd"));
+  std::string contents;
+  ASSERT_TRUE(File::ReadFileToString("store://live/manifest.mpd", &contents));
+  EXPECT_EQ("mpd", contents);
+
+  // Readers keep the object they opened when it is replaced.
+  std::unique_ptr<File, FileCloser> reader(
+      File::Open("store://live/manifest.mpd", "r"));
+  ASSERT_TRUE(reader);
+  ASSERT_TRUE(File::WriteFileAtomically("store://live/manifest.mpd", "new"));
+  char buffer[10];
+  ASSERT_EQ(3, reader->Read(buffer, sizeof(buffer)));
+  EXPECT_EQ("mpd", std::string(buffer, 3));
+
+  ASSERT_TRUE(File::Delete("store://live/manifest.mpd"));
+  EXPECT_FALSE(SegmentStore::GetInstance()->Get("live/manifest.mpd"));
+  EXPECT_EQ(0u, SegmentStore::GetInstance()->TotalSize());
+}
+
+}  // namespace shaka
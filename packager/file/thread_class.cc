@@ -0,0 +1,176 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/thread_class.h"
+
+#include <gflags/gflags.h>
+#include <stdio.h>
+#if defined(OS_LINUX)
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif  // defined(OS_LINUX)
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_split.h"
+
+namespace {
+
+const char kNormalClass[] = "normal";
+const char kLiveClass[] = "live";
+const char kBackgroundClass[] = "background";
+// Larger CPU numbers are rejected, as they are likely typos.
+const int kMaxCpu = 4095;
+
+bool IsValidThreadClass(const char* flagname, const std::string& value) {
+  if (value == kNormalClass || value == kLiveClass ||
+      value == kBackgroundClass) {
+    return true;
+  }
+  fprintf(stderr, "ERROR: --%s should be 'normal', 'live' or 'background'.\n",
+          flagname);
+  return false;
+}
+
+bool IsValidCpuList(const char* flagname, const std::string& value) {
+  std::vector<int> cpus;
+  if (shaka::ParseCpuList(value, &cpus))
+    return true;
+  fprintf(stderr,
+          "ERROR: --%s should be a comma separated list of CPUs and CPU "
+          "ranges, e.g. '0-3,8'.\n",
+          flagname);
+  return false;
+}
+
+}  // namespace
+
+DEFINE_string(media_thread_class,
+              kNormalClass,
+              "Scheduling class of the threads running the packaging jobs: "
+              "'normal', 'live' for real-time round-robin scheduling, which "
+              "needs CAP_SYS_NICE, or 'background' for batch scheduling at a "
+              "lower priority. For instance, live channels can use 'live' and "
+              "VOD jobs on the same host 'background'. Linux only.");
+DEFINE_string(media_thread_cpus,
+              "",
+              "CPUs the threads running the packaging jobs may run on, e.g. "
+              "'0-3,8'. All the CPUs if empty. Linux only.");
+DEFINE_string(io_thread_class,
+              kNormalClass,
+              "Scheduling class of the threads reading and writing files and "
+              "fetching keys. See --media_thread_class.");
+DEFINE_string(io_thread_cpus,
+              "",
+              "CPUs the threads reading and writing files and fetching keys "
+              "may run on, e.g. '0-3,8'. All the CPUs if empty. Linux only.");
+DEFINE_validator(media_thread_class, &IsValidThreadClass);
+DEFINE_validator(media_thread_cpus, &IsValidCpuList);
+DEFINE_validator(io_thread_class, &IsValidThreadClass);
+DEFINE_validator(io_thread_cpus, &IsValidCpuList);
+
+namespace shaka {
+
+namespace {
+
+#if defined(OS_LINUX)
+// The lowest real-time priority, which is enough to run before all the
+// threads with the normal scheduling policy.
+const int kLiveThreadPriority = 1;
+const int kBackgroundThreadNiceness = 10;
+
+void SetScheduling(const std::string& thread_class) {
+  sched_param param = {};
+  int policy = SCHED_OTHER;
+  int niceness = 0;
+  if (thread_class == kLiveClass) {
+    policy = SCHED_RR;
+    param.sched_priority = kLiveThreadPriority;
+  } else if (thread_class == kBackgroundClass) {
+    policy = SCHED_BATCH;
+    niceness = kBackgroundThreadNiceness;
+  }
+  // Threads inherit the scheduling of the thread that created them, which
+  // can be of another class, so the normal scheduling is also set.
+  if (sched_getscheduler(0) != policy &&
+      sched_setscheduler(0, policy, &param) != 0) {
+    PLOG(WARNING) << "Failed to set the scheduling policy of the '"
+                  << thread_class << "' thread class.";
+  }
+  // The niceness is a per-thread attribute on Linux, so this only changes the
+  // calling thread.
+  if (policy != SCHED_RR && getpriority(PRIO_PROCESS, 0) != niceness &&
+      setpriority(PRIO_PROCESS, 0, niceness) != 0) {
+    PLOG(WARNING) << "Failed to set the niceness of the '" << thread_class
+                  << "' thread class.";
+  }
+}
+
+void SetAffinity(const std::string& cpu_list) {
+  std::vector<int> cpus;
+  if (!ParseCpuList(cpu_list, &cpus))
+    return;
+  if (cpus.empty()) {
+    for (int cpu = 0; cpu < sysconf(_SC_NPROCESSORS_CONF); ++cpu)
+      cpus.push_back(cpu);
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    if (cpu < CPU_SETSIZE)
+      CPU_SET(cpu, &cpu_set);
+  }
+  if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0)
+    PLOG(WARNING) << "Failed to set the CPU affinity to " << cpu_list << ".";
+}
+#endif  // defined(OS_LINUX)
+
+}  // namespace
+
+bool ParseCpuList(const std::string& cpu_list, std::vector<int>* cpus) {
+  for (const std::string& range :
+       base::SplitString(cpu_list, ",", base::TRIM_WHITESPACE,
+                         base::SPLIT_WANT_NONEMPTY)) {
+    const std::vector<std::string> bounds = base::SplitString(
+        range, "-", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL);
+    int first = 0;
+    int last = 0;
+    if (bounds.size() > 2 || !base::StringToInt(bounds.front(), &first) ||
+        !base::StringToInt(bounds.back(), &last) || first < 0 ||
+        last < first || last > kMaxCpu) {
+      return false;
+    }
+    for (int cpu = first; cpu <= last; ++cpu)
+      cpus->push_back(cpu);
+  }
+  return true;
+}
+
+void SetCurrentThreadClass(ThreadClass thread_class) {
+  // Nothing is changed if no thread class is configured, which is the common
+  // case.
+  if (FLAGS_media_thread_class == kNormalClass &&
+      FLAGS_io_thread_class == kNormalClass &&
+      FLAGS_media_thread_cpus.empty() && FLAGS_io_thread_cpus.empty()) {
+    return;
+  }
+#if defined(OS_LINUX)
+  const bool is_media = thread_class == ThreadClass::kMedia;
+  SetScheduling(is_media ? FLAGS_media_thread_class : FLAGS_io_thread_class);
+  SetAffinity(is_media ? FLAGS_media_thread_cpus : FLAGS_io_thread_cpus);
+#else
+  static std::atomic<bool> warned(false);
+  if (!warned.exchange(true))
+    LOG(WARNING) << "Thread classes are only supported on Linux.";
+#endif  // defined(OS_LINUX)
+}
+
+}  // namespace shaka
@@ -0,0 +1,39 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_THREAD_CLASS_H_
+#define PACKAGER_FILE_THREAD_CLASS_H_
+
+#include <string>
+#include <vector>
+
+namespace shaka {
+
+/// The classes of the threads of the packager, which are scheduled with the
+/// settings of their --*_thread_class and --*_thread_cpus flags, e.g. so that
+/// the threads of live channels are not slowed down by the VOD packaging jobs
+/// sharing the host.
+enum class ThreadClass {
+  /// The threads running the packaging jobs and their media handlers.
+  kMedia,
+  /// The threads reading and writing files, and fetching keys.
+  kIo,
+};
+
+/// Applies the scheduling settings of @a thread_class to the calling thread.
+/// Threads call it when they start, or when they start running a task of the
+/// class. Only supported on Linux. Failures, e.g. without the privilege to use
+/// real-time scheduling, are logged and leave the thread as it was.
+void SetCurrentThreadClass(ThreadClass thread_class);
+
+/// Parses the value of a --*_thread_cpus flag, a comma separated list of CPUs
+/// and CPU ranges, e.g. "0-3,8", and appends the CPUs to @a cpus.
+/// @return false if @a cpu_list is malformed or has a CPU out of range.
+bool ParseCpuList(const std::string& cpu_list, std::vector<int>* cpus);
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_THREAD_CLASS_H_
@@ -0,0 +1,49 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "packager/file/thread_class.h"
+
+namespace shaka {
+
+TEST(ParseCpuListTest, Empty) {
+  std::vector<int> cpus;
+  EXPECT_TRUE(ParseCpuList("", &cpus));
+  EXPECT_TRUE(cpus.empty());
+}
+
+TEST(ParseCpuListTest, CpusAndRanges) {
+  std::vector<int> cpus;
+  ASSERT_TRUE(ParseCpuList("0-3,8, 10 - 11,5-5", &cpus));
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 8, 10, 11, 5}), cpus);
+}
+
+TEST(ParseCpuListTest, IgnoresEmptyEntries) {
+  std::vector<int> cpus;
+  ASSERT_TRUE(ParseCpuList(",1,,2,", &cpus));
+  EXPECT_EQ(std::vector<int>({1, 2}), cpus);
+}
+
+TEST(ParseCpuListTest, Malformed) {
+  for (const char* cpu_list :
+       {"a", "1,b", "1-", "-1", "1-2-3", "3-1", "1.5", "0x1", "1;2"}) {
+    std::vector<int> cpus;
+    EXPECT_FALSE(ParseCpuList(cpu_list, &cpus)) << cpu_list;
+  }
+}
+
+TEST(ParseCpuListTest, OutOfRange) {
+  std::vector<int> cpus;
+  EXPECT_TRUE(ParseCpuList("4095", &cpus));
+  EXPECT_FALSE(ParseCpuList("4096", &cpus));
+  EXPECT_FALSE(ParseCpuList("0-4096", &cpus));
+  EXPECT_FALSE(ParseCpuList("99999999999", &cpus));
+}
+
+}  // namespace shaka
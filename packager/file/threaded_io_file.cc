@@ -6,22 +6,43 @@
 
 #include "packager/file/threaded_io_file.h"
 
+#include <algorithm>
+
 #include "packager/base/bind.h"
 #include "packager/base/bind_helpers.h"
 #include "packager/base/location.h"
 #include "packager/base/threading/worker_pool.h"
+#include "packager/file/thread_class.h"
 
 namespace shaka {
 
+namespace {
+
+// The cache shrinks when less than a quarter of it was used while this many
+// times its size was written.
+const uint64_t kShrinkWindowInCacheSizes = 8;
+
+// Total size of the caches of all the files.
+std::atomic<uint64_t> g_total_cache_size(0);
+
+}  // namespace
+
 ThreadedIoFile::ThreadedIoFile(std::unique_ptr<File, FileCloser> internal_file,
                                Mode mode,
                                uint64_t io_cache_size,
-                               uint64_t io_block_size)
+                               uint64_t io_block_size,
+                               uint64_t min_io_cache_size,
+                               uint64_t io_cache_memory_limit)
     : File(internal_file->file_name()),
       internal_file_(std::move(internal_file)),
       mode_(mode),
-      cache_(io_cache_size),
-      io_buffer_(io_block_size),
+      min_cache_size_(std::min(std::max(min_io_cache_size, io_block_size),
+                               io_cache_size)),
+      max_cache_size_(io_cache_size),
+      cache_memory_limit_(io_cache_memory_limit),
+      io_block_size_(io_block_size),
+      cache_(min_cache_size_),
+      io_buffer_(mode == kInputMode ? io_block_size : 0),
       position_(0),
       size_(0),
       eof_(false),
@@ -32,9 +53,12 @@ ThreadedIoFile::ThreadedIoFile(std::unique_ptr<File, FileCloser> internal_file,
       task_exit_event_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
                        base::WaitableEvent::InitialState::NOT_SIGNALED) {
   DCHECK(internal_file_);
+  g_total_cache_size += cache_.size();
 }
 
-ThreadedIoFile::~ThreadedIoFile() {}
+ThreadedIoFile::~ThreadedIoFile() {
+  g_total_cache_size -= cache_.size();
+}
 
 bool ThreadedIoFile::Open() {
   DCHECK(internal_file_);
@@ -90,6 +114,7 @@ int64_t ThreadedIoFile::Write(const void* buffer, uint64_t length) {
   if (internal_file_error_.load(std::memory_order_relaxed))
     return internal_file_error_.load(std::memory_order_relaxed);
 
+  AdaptCacheSize();
   uint64_t bytes_written = cache_.Write(buffer, length);
   position_ += bytes_written;
   if (position_ > size_)
@@ -98,6 +123,24 @@ int64_t ThreadedIoFile::Write(const void* buffer, uint64_t length) {
   return bytes_written;
 }
 
+int64_t ThreadedIoFile::WriteV(const FileIoVector* buffers,
+                               size_t num_buffers) {
+  // The blocks are copied into the cache one after the other, which is the
+  // only copy needed.
+  int64_t bytes_written = 0;
+  for (size_t i = 0; i < num_buffers; ++i) {
+    if (buffers[i].length == 0)
+      continue;
+    const int64_t size = Write(buffers[i].buffer, buffers[i].length);
+    if (size <= 0)
+      return bytes_written > 0 ? bytes_written : size;
+    bytes_written += size;
+    if (static_cast<uint64_t>(size) < buffers[i].length)
+      break;
+  }
+  return bytes_written;
+}
+
 int64_t ThreadedIoFile::Size() {
   DCHECK(internal_file_);
 
@@ -149,6 +192,15 @@ bool ThreadedIoFile::Seek(uint64_t position) {
   return true;
 }
 
+bool ThreadedIoFile::CanReadWithoutBlocking() {
+  // The cache is closed on end-of-file or error.
+  return mode_ != kInputMode || cache_.BytesCached() > 0 || cache_.closed();
+}
+
+void ThreadedIoFile::SetReadableEvent(base::WaitableEvent* event) {
+  readable_event_ = event;
+}
+
 bool ThreadedIoFile::Tell(uint64_t* position) {
   DCHECK(position);
 
@@ -157,6 +209,8 @@ bool ThreadedIoFile::Tell(uint64_t* position) {
 }
 
 void ThreadedIoFile::TaskHandler() {
+  // The worker pool threads are shared with other tasks.
+  SetCurrentThreadClass(ThreadClass::kIo);
   if (mode_ == kInputMode)
     RunInInputMode();
   else
@@ -175,12 +229,53 @@ void ThreadedIoFile::RunInInputMode() {
       eof_.store(read_result == 0, std::memory_order_relaxed);
       internal_file_error_.store(read_result, std::memory_order_relaxed);
       cache_.Close();
+      SignalReadable();
       return;
     }
+    AdaptCacheSize();
     if (cache_.Write(&io_buffer_[0], read_result) == 0) {
       return;
     }
+    SignalReadable();
+  }
+}
+
+void ThreadedIoFile::SignalReadable() {
+  base::WaitableEvent* event = readable_event_.load();
+  if (event)
+    event->Signal();
+}
+
+void ThreadedIoFile::AdaptCacheSize() {
+  if (min_cache_size_ == max_cache_size_ || cache_.BytesCached() != 0)
+    return;
+
+  const IoCache::WriterStats& stats = cache_.writer_stats();
+  const uint64_t cache_size = cache_.size();
+  uint64_t new_cache_size = cache_size;
+  if (stats.num_waits_for_space > 0) {
+    new_cache_size = std::min(cache_size * 2, max_cache_size_);
+  } else if (stats.bytes_written >= kShrinkWindowInCacheSizes * cache_size &&
+             stats.max_bytes_cached < cache_size / 4) {
+    new_cache_size = std::max(cache_size / 2, min_cache_size_);
+  }
+  if (new_cache_size == cache_size)
+    return;
+
+  if (new_cache_size > cache_size) {
+    const uint64_t growth = new_cache_size - cache_size;
+    if (g_total_cache_size.fetch_add(growth) + growth > cache_memory_limit_ ||
+        !cache_.ResizeIfEmpty(new_cache_size)) {
+      g_total_cache_size -= growth;
+      return;
+    }
+  } else {
+    if (!cache_.ResizeIfEmpty(new_cache_size))
+      return;
+    g_total_cache_size -= cache_size - new_cache_size;
   }
+  VLOG(2) << "Resized the I/O cache of " << file_name() << " from "
+          << cache_size << " to " << cache_.size() << " bytes.";
 }
 
 void ThreadedIoFile::RunInOutputMode() {
@@ -188,7 +283,9 @@ void ThreadedIoFile::RunInOutputMode() {
   DCHECK_EQ(kOutputMode, mode_);
 
   while (true) {
-    uint64_t write_bytes = cache_.Read(&io_buffer_[0], io_buffer_.size());
+    // The data is written straight from the cache, without copying it first.
+    const uint8_t* data = nullptr;
+    uint64_t write_bytes = cache_.Peek(&data, io_block_size_);
     if (write_bytes == 0) {
       if (flushing_) {
         cache_.Reopen();
@@ -201,7 +298,7 @@ void ThreadedIoFile::RunInOutputMode() {
       uint64_t bytes_written(0);
       while (bytes_written < write_bytes) {
         int64_t write_result = internal_file_->Write(
-            &io_buffer_[bytes_written], write_bytes - bytes_written);
+            data + bytes_written, write_bytes - bytes_written);
         if (write_result < 0) {
           internal_file_error_.store(write_result, std::memory_order_relaxed);
           cache_.Close();
@@ -213,6 +310,7 @@ void ThreadedIoFile::RunInOutputMode() {
         }
         bytes_written += write_result;
       }
+      cache_.Consume(write_bytes);
     }
   }
 }
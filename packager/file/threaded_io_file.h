@@ -21,20 +21,34 @@ class ThreadedIoFile : public File {
  public:
   enum Mode { kInputMode, kOutputMode };
 
+  /// @param io_cache_size is the maximum size of the cache.
+  /// @param io_block_size is the size of the blocks read from or written to
+  ///        @a internal_file.
+  /// @param min_io_cache_size is the size the cache starts with. The cache
+  ///        grows, up to @a io_cache_size, when the cache is often full, and
+  ///        shrinks back when it is mostly unused. Equal to @a io_cache_size
+  ///        for a fixed size cache.
+  /// @param io_cache_memory_limit is the maximum total size of the caches of
+  ///        all the files beyond which the caches do not grow.
   ThreadedIoFile(std::unique_ptr<File, FileCloser> internal_file,
                  Mode mode,
                  uint64_t io_cache_size,
-                 uint64_t io_block_size);
+                 uint64_t io_block_size,
+                 uint64_t min_io_cache_size,
+                 uint64_t io_cache_memory_limit);
 
   /// @name File implementation overrides.
   /// @{
   bool Close() override;
   int64_t Read(void* buffer, uint64_t length) override;
   int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t WriteV(const FileIoVector* buffers, size_t num_buffers) override;
   int64_t Size() override;
   bool Flush() override;
   bool Seek(uint64_t position) override;
   bool Tell(uint64_t* position) override;
+  bool CanReadWithoutBlocking() override;
+  void SetReadableEvent(base::WaitableEvent* event) override;
   /// @}
 
  protected:
@@ -48,10 +62,21 @@ class ThreadedIoFile : public File {
   void TaskHandler();
   void RunInInputMode();
   void RunInOutputMode();
+  // Grows or shrinks |cache_| depending on its use, when it is empty. Called
+  // from the thread writing to |cache_|.
+  void AdaptCacheSize();
+  // Signals |readable_event_|, if any. Called from the thread writing to
+  // |cache_| in input mode.
+  void SignalReadable();
 
   std::unique_ptr<File, FileCloser> internal_file_;
   const Mode mode_;
+  const uint64_t min_cache_size_;
+  const uint64_t max_cache_size_;
+  const uint64_t cache_memory_limit_;
+  const uint64_t io_block_size_;
   IoCache cache_;
+  // Only used in input mode. In output mode, data is written from |cache_|.
   std::vector<uint8_t> io_buffer_;
   uint64_t position_;
   uint64_t size_;
@@ -61,6 +86,7 @@ class ThreadedIoFile : public File {
   std::atomic<int32_t> internal_file_error_;
   // Signalled when thread task exits.
   base::WaitableEvent task_exit_event_;
+  std::atomic<base::WaitableEvent*> readable_event_{nullptr};
 
   DISALLOW_COPY_AND_ASSIGN(ThreadedIoFile);
 };
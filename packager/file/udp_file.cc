@@ -30,8 +30,16 @@
 #define IP_MULTICAST_ALL      49
 #endif
 
+// Likewise for SO_RXQ_OVFL, supported since kernel version 2.6.33.
+#if defined(__linux__) && !defined(SO_RXQ_OVFL)
+#define SO_RXQ_OVFL 40
+#endif
+
 #endif  // defined(OS_WIN)
 
+#include <string.h>
+
+#include <algorithm>
 #include <limits>
 
 #include "packager/base/logging.h"
@@ -41,6 +49,14 @@ namespace shaka {
 
 namespace {
 
+#if defined(__linux__)
+// Each datagram of a batch is received in a slot large enough for any UDP
+// datagram, so none of them is truncated.
+const size_t kMaxDatagramSize = 65535;
+// Space for the SO_RXQ_OVFL drop counter received with each datagram.
+const size_t kDatagramControlSize = CMSG_SPACE(sizeof(uint32_t));
+#endif  // defined(__linux__)
+
 bool IsIpv4MulticastAddress(const struct in_addr& addr) {
   return (ntohl(addr.s_addr) & 0xf0000000) == 0xe0000000;
 }
@@ -81,6 +97,11 @@ int64_t UdpFile::Read(void* buffer, uint64_t length) {
   if (socket_ == INVALID_SOCKET)
     return -1;
 
+#if defined(__linux__)
+  if (batch_size_ > 1)
+    return ReadBatched(buffer, length);
+#endif  // defined(__linux__)
+
   int64_t result;
   do {
     result =
@@ -90,6 +111,73 @@ int64_t UdpFile::Read(void* buffer, uint64_t length) {
   return result;
 }
 
+#if defined(__linux__)
+int64_t UdpFile::ReadBatched(void* buffer, uint64_t length) {
+  if (next_message_ == num_messages_) {
+    for (struct mmsghdr& message : batch_messages_)
+      message.msg_hdr.msg_controllen = kDatagramControlSize;
+    // MSG_WAITFORONE blocks, subject to the socket timeout, until the first
+    // datagram arrives and then takes whatever else is already queued.
+    int result;
+    do {
+      result = recvmmsg(socket_, batch_messages_.data(),
+                        batch_messages_.size(), MSG_WAITFORONE, nullptr);
+    } while (result == -1 && GetSocketErrorCode() == EINTR_CODE);
+    if (result < 0)
+      return result;
+    next_message_ = 0;
+    num_messages_ = result;
+    UpdateDroppedDatagrams();
+  }
+
+  uint8_t* output = reinterpret_cast<uint8_t*>(buffer);
+  uint64_t bytes_read = 0;
+  // The caller is expected to handle the datagrams as a byte stream, so
+  // several of them are returned at once.
+  while (next_message_ < num_messages_) {
+    const size_t datagram_size = batch_messages_[next_message_].msg_len;
+    if (datagram_size > length - bytes_read) {
+      if (bytes_read > 0)
+        break;
+      // Like recvfrom(), which discards the excess bytes, rather than
+      // returning 0, which would read as the end of the stream.
+      LOG(WARNING) << "UDP datagram of " << datagram_size
+                   << " bytes truncated to the read buffer size " << length
+                   << ".";
+      memcpy(output, batch_iovecs_[next_message_].iov_base, length);
+      ++next_message_;
+      return length;
+    }
+    memcpy(output + bytes_read, batch_iovecs_[next_message_].iov_base,
+           datagram_size);
+    bytes_read += datagram_size;
+    ++next_message_;
+  }
+  return bytes_read;
+}
+
+void UdpFile::UpdateDroppedDatagrams() {
+  if (num_messages_ == 0)
+    return;
+  struct msghdr* message = &batch_messages_[num_messages_ - 1].msg_hdr;
+  for (struct cmsghdr* control = CMSG_FIRSTHDR(message); control;
+       control = CMSG_NXTHDR(message, control)) {
+    if (control->cmsg_level != SOL_SOCKET || control->cmsg_type != SO_RXQ_OVFL)
+      continue;
+    uint32_t dropped_datagrams = 0;
+    memcpy(&dropped_datagrams, CMSG_DATA(control), sizeof(dropped_datagrams));
+    if (dropped_datagrams != dropped_datagrams_) {
+      LOG(WARNING) << "Receive buffer overrun: "
+                   << static_cast<uint32_t>(dropped_datagrams -
+                                            dropped_datagrams_)
+                   << " UDP datagrams dropped, " << dropped_datagrams
+                   << " in total.";
+      dropped_datagrams_ = dropped_datagrams;
+    }
+  }
+}
+#endif  // defined(__linux__)
+
 int64_t UdpFile::Write(const void* buffer, uint64_t length) {
   NOTIMPLEMENTED();
   return -1;
@@ -290,6 +378,37 @@ bool UdpFile::Open() {
     }
   }
 
+#if defined(__linux__)
+  if (options->batch_size() > 1) {
+    batch_size_ = std::min<size_t>(options->batch_size(), UIO_MAXIOV);
+    const int optval_one = 1;
+    if (setsockopt(new_socket.get(), SOL_SOCKET, SO_RXQ_OVFL, &optval_one,
+                   sizeof(optval_one)) < 0) {
+      LOG(WARNING) << "Failed to enable SO_RXQ_OVFL option, dropped datagrams "
+                      "will not be reported, error = "
+                   << GetSocketErrorCode();
+    }
+
+    batch_buffer_.resize(batch_size_ * kMaxDatagramSize);
+    batch_control_buffer_.resize(batch_size_ * kDatagramControlSize);
+    batch_iovecs_.resize(batch_size_);
+    batch_messages_.resize(batch_size_);
+    for (size_t i = 0; i < batch_size_; ++i) {
+      batch_iovecs_[i].iov_base = &batch_buffer_[i * kMaxDatagramSize];
+      batch_iovecs_[i].iov_len = kMaxDatagramSize;
+      struct msghdr& message = batch_messages_[i].msg_hdr;
+      memset(&message, 0, sizeof(message));
+      message.msg_iov = &batch_iovecs_[i];
+      message.msg_iovlen = 1;
+      message.msg_control = &batch_control_buffer_[i * kDatagramControlSize];
+      message.msg_controllen = kDatagramControlSize;
+    }
+  }
+#else
+  if (options->batch_size() > 1)
+    LOG(WARNING) << "UDP option batch_size is only supported on Linux.";
+#endif  // defined(__linux__)
+
   socket_ = new_socket.release();
   return true;
 }
@@ -10,6 +10,7 @@
 #include <stdint.h>
 
 #include <string>
+#include <vector>
 
 #include "packager/base/compiler_specific.h"
 #include "packager/file/file.h"
@@ -20,6 +21,11 @@
 typedef int SOCKET;
 #endif  // defined(OS_WIN)
 
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif  // defined(__linux__)
+
 namespace shaka {
 
 /// Implements UdpFile, which receives UDP unicast and multicast streams.
@@ -46,7 +52,30 @@ class UdpFile : public File {
   bool Open() override;
 
  private:
+#if defined(__linux__)
+  // Receives up to |batch_size_| datagrams with a single system call and
+  // returns as many of them as fit in |buffer|.
+  int64_t ReadBatched(void* buffer, uint64_t length);
+  // Logs the datagrams dropped by the kernel since the last call, as reported
+  // with the last received datagram.
+  void UpdateDroppedDatagrams();
+#endif  // defined(__linux__)
+
   SOCKET socket_;
+#if defined(__linux__)
+  // Only used if more than one datagram is received per system call.
+  size_t batch_size_ = 0;
+  std::vector<uint8_t> batch_buffer_;
+  std::vector<uint8_t> batch_control_buffer_;
+  std::vector<struct iovec> batch_iovecs_;
+  std::vector<struct mmsghdr> batch_messages_;
+  // Datagrams in |batch_messages_| from |next_message_| to |num_messages_|
+  // have not been returned by Read yet.
+  size_t next_message_ = 0;
+  size_t num_messages_ = 0;
+  // Number of datagrams dropped by the kernel, as last reported by the kernel.
+  uint32_t dropped_datagrams_ = 0;
+#endif  // defined(__linux__)
 #if defined(OS_WIN)
   // For Winsock in Windows.
   bool wsa_started_ = false;
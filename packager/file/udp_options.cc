@@ -22,6 +22,7 @@ namespace {
 
 enum FieldType {
   kUnknownField = 0,
+  kBatchSizeField,
   kBufferSizeField,
   kInterfaceAddressField,
   kMulticastSourceField,
@@ -35,6 +36,7 @@ struct FieldNameToTypeMapping {
 };
 
 const FieldNameToTypeMapping kFieldNameTypeMappings[] = {
+    {"batch_size", kBatchSizeField},
     {"buffer_size", kBufferSizeField},
     {"interface", kInterfaceAddressField},
     {"reuse", kReuseField},
@@ -89,6 +91,13 @@ std::unique_ptr<UdpOptions> UdpOptions::ParseFromString(
     }
     for (const auto& pair : pairs) {
       switch (GetFieldType(pair.first)) {
+        case kBatchSizeField:
+          if (!base::StringToUint(pair.second, &options->batch_size_)) {
+            LOG(ERROR) << "Invalid udp option for batch_size field "
+                       << pair.second;
+            return nullptr;
+          }
+          break;
         case kBufferSizeField:
           if (!base::StringToInt(pair.second, &options->buffer_size_)) {
             LOG(ERROR) << "Invalid udp option for buffer_size field "
@@ -31,6 +31,7 @@ class UdpOptions {
     return is_source_specific_multicast_;
   }
   int buffer_size() const { return buffer_size_; }
+  unsigned batch_size() const { return batch_size_; }
 
  private:
   UdpOptions() = default;
@@ -52,6 +53,9 @@ class UdpOptions {
   // by the underlying operating system ('sysctl net.core.rmem_max' on Linux
   // returns the maximum receive memory size).
   int buffer_size_ = 0;
+  // Maximum number of datagrams received per system call. 0 or 1 to receive
+  // one datagram at a time. Only supported on Linux.
+  unsigned batch_size_ = 0;
 };
 
 }  // namespace shaka
@@ -122,4 +122,13 @@ TEST_F(UdpOptionsTest, BufferSize) {
   EXPECT_EQ(1234, options->buffer_size());
 }
 
+TEST_F(UdpOptionsTest, BatchSize) {
+  auto options = UdpOptions::ParseFromString("224.1.2.30:88?batch_size=32");
+  EXPECT_EQ(32u, options->batch_size());
+}
+
+TEST_F(UdpOptionsTest, InvalidBatchSize) {
+  ASSERT_FALSE(UdpOptions::ParseFromString("224.1.2.30:88?batch_size=-1"));
+}
+
 }  // namespace shaka
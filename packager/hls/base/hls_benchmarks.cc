@@ -0,0 +1,135 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Benchmarks of the HLS playlist generation as the number of streams and
+// segments grows. SimpleHlsNotifier is driven with synthetic timelines, then
+// the time and the number of allocations per flush, i.e. per write of all the
+// playlists, are reported in the format of testing/perf/perf_test.h, so they
+// can be compared across versions.
+//
+// Run from the packager repository root, e.g.
+//   out/Release/hls_benchmarks --gtest_filter=HlsBenchmark.*
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/time/time.h"
+#include "packager/hls/base/simple_hls_notifier.h"
+#include "packager/mpd/base/media_info.pb.h"
+#include "packager/mpd/test/allocation_counter.h"
+#include "packager/testing/perf/perf_test.h"
+
+namespace shaka {
+namespace hls {
+namespace {
+
+const char kMasterPlaylistOutput[] = "memory://benchmark/master.m3u8";
+const uint32_t kTimeScale = 90000;
+const uint64_t kSegmentDuration = 2 * kTimeScale;
+const uint64_t kSegmentSize = 500000;
+// A cue, i.e. a placement opportunity, every this many segments with cues.
+const size_t kSegmentsPerCue = 150;
+const size_t kNumFlushes = 10;
+
+const size_t kNumStreams[] = {1, 10, 50};
+const size_t kNumSegments[] = {100, 1000, 10000, 100000};
+
+MediaInfo GetVideoMediaInfo(size_t stream) {
+  MediaInfo media_info;
+  MediaInfo::VideoInfo* video_info = media_info.mutable_video_info();
+  video_info->set_codec("avc1.64001f");
+  video_info->set_width(1280);
+  video_info->set_height(720);
+  video_info->set_time_scale(kTimeScale);
+  video_info->set_frame_duration(3000);
+  video_info->set_pixel_width(1);
+  video_info->set_pixel_height(1);
+  media_info.set_container_type(MediaInfo::CONTAINER_MP4);
+  media_info.set_reference_time_scale(kTimeScale);
+  media_info.set_bandwidth(1000000 * (stream + 1));
+  media_info.set_init_segment_name(
+      base::StringPrintf("memory://benchmark/video_%zu_init.mp4", stream));
+  return media_info;
+}
+
+}  // namespace
+
+class HlsBenchmark : public ::testing::Test {
+ protected:
+  void RunBenchmark(size_t num_streams, size_t num_segments, bool with_cues) {
+    HlsParams hls_params;
+    // VOD playlists are only written on flushes, which are timed alone.
+    hls_params.playlist_type = HlsPlaylistType::kVod;
+    hls_params.master_playlist_output = kMasterPlaylistOutput;
+    hls_params.is_independent_segments = true;
+    SimpleHlsNotifier notifier(hls_params);
+    ASSERT_TRUE(notifier.Init());
+
+    std::vector<uint32_t> stream_ids(num_streams);
+    for (size_t i = 0; i < num_streams; ++i) {
+      ASSERT_TRUE(notifier.NotifyNewStream(
+          GetVideoMediaInfo(i),
+          base::StringPrintf("memory://benchmark/video_%zu.m3u8", i),
+          base::StringPrintf("video_%zu", i), "video", &stream_ids[i]));
+    }
+    uint64_t start_time = 0;
+    size_t segment = 0;
+    auto add_segment = [&]() {
+      // The durations vary slightly, as with real encoders.
+      const uint64_t duration = kSegmentDuration + (segment % 3) * 3000;
+      for (size_t i = 0; i < num_streams; ++i) {
+        if (with_cues && segment > 0 && segment % kSegmentsPerCue == 0)
+          ASSERT_TRUE(notifier.NotifyCueEvent(stream_ids[i], start_time));
+        ASSERT_TRUE(notifier.NotifyNewSegment(
+            stream_ids[i],
+            base::StringPrintf("memory://benchmark/video_%zu_%zu.m4s", i,
+                               segment),
+            start_time, duration, 0, kSegmentSize));
+      }
+      start_time += duration;
+      ++segment;
+    };
+    while (segment < num_segments)
+      add_segment();
+
+    base::TimeDelta flush_time;
+    uint64_t num_allocations = 0;
+    for (size_t i = 0; i < kNumFlushes; ++i) {
+      add_segment();
+      const uint64_t allocations_before = GetNumAllocations();
+      const base::TimeTicks flush_start = base::TimeTicks::Now();
+      ASSERT_TRUE(notifier.Flush());
+      flush_time += base::TimeTicks::Now() - flush_start;
+      num_allocations += GetNumAllocations() - allocations_before;
+    }
+
+    const std::string trace =
+        base::StringPrintf("%zu_streams_%zu_segments%s", num_streams,
+                           num_segments, with_cues ? "_cues" : "");
+    perf_test::PrintResult("hls_flush_time", "", trace,
+                           flush_time.InMillisecondsF() / kNumFlushes, "ms",
+                           true);
+    perf_test::PrintResult(
+        "hls_flush_allocations", "", trace,
+        static_cast<size_t>(num_allocations / kNumFlushes), "allocations",
+        true);
+  }
+};
+
+TEST_F(HlsBenchmark, Flush) {
+  for (size_t num_streams : kNumStreams) {
+    for (size_t num_segments : kNumSegments) {
+      RunBenchmark(num_streams, num_segments, false);
+      RunBenchmark(num_streams, num_segments, true);
+    }
+  }
+}
+
+}  // namespace hls
+}  // namespace shaka
@@ -65,6 +65,27 @@ class HlsNotifier {
                                 uint64_t start_byte_offset,
                                 uint64_t size) = 0;
 
+  /// Called on every partial segment in low latency mode, before the
+  /// containing segment is notified with NotifyNewSegment().
+  /// @param stream_id is the value set by NotifyNewStream().
+  /// @param partial_segment_name is the name of the new partial segment.
+  /// @param start_time is the start time of the partial segment in timescale
+  ///        units passed in @a media_info.
+  /// @param duration is also in terms of timescale.
+  /// @param size is the size in bytes.
+  /// @param independent is true if the partial segment starts with a key
+  ///        frame.
+  /// @param next_partial_segment_name is the name of the next partial
+  ///        segment, which is advertised with EXT-X-PRELOAD-HINT.
+  virtual bool NotifyNewPartialSegment(
+      uint32_t stream_id,
+      const std::string& partial_segment_name,
+      uint64_t start_time,
+      uint64_t duration,
+      uint64_t size,
+      bool independent,
+      const std::string& next_partial_segment_name) = 0;
+
   /// Called on every key frame. For Video only.
   /// @param stream_id is the value set by NotifyNewStream().
   /// @param timestamp is the timesamp of the key frame in timescale units
@@ -81,6 +102,12 @@ class HlsNotifier {
   /// @return true on success, false otherwise.
   virtual bool NotifyCueEvent(uint32_t stream_id, uint64_t timestamp) = 0;
 
+  /// Called when the stream goes on with a different codec configuration,
+  /// e.g. at the boundary of concatenated inputs.
+  /// @param stream_id is the value set by NotifyNewStream().
+  /// @return true on success, false otherwise.
+  virtual bool NotifyDiscontinuity(uint32_t stream_id) = 0;
+
   /// @param stream_id is the value set by NotifyNewStream().
   /// @param key_id is the key ID for the stream.
   /// @param system_id is the DRM system ID in e.g. PSSH boxes. For example this
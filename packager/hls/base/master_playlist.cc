@@ -6,7 +6,8 @@
 
 #include "packager/hls/base/master_playlist.h"
 
-#include <algorithm>  // std::max
+#include <algorithm>  // std::equal, std::max
+#include <utility>
 
 #include <inttypes.h>
 
@@ -14,9 +15,9 @@
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
-#include "packager/file/file.h"
 #include "packager/hls/base/media_playlist.h"
 #include "packager/hls/base/tag.h"
+#include "packager/mpd/base/async_manifest_writer.h"
 #include "packager/version/version.h"
 
 namespace shaka {
@@ -25,6 +26,18 @@ namespace {
 const char* kDefaultAudioGroupId = "default-audio-group";
 const char* kDefaultSubtitleGroupId = "default-text-group";
 const char* kUnexpectedGroupId = "unexpected-group";
+// Relative change of the bitrates of a Media Playlist which is not worth
+// rewriting the Master Playlist for. The average bitrate estimate changes
+// with every segment.
+const double kBitrateTolerance = 0.02;
+
+// Whether |bitrate| is within kBitrateTolerance of |written_bitrate|.
+bool IsBitrateWithinTolerance(uint64_t written_bitrate, uint64_t bitrate) {
+  const uint64_t difference = bitrate > written_bitrate
+                                  ? bitrate - written_bitrate
+                                  : written_bitrate - bitrate;
+  return difference <= written_bitrate * kBitrateTolerance;
+}
 
 void AppendVersionString(std::string* content) {
   const std::string version = GetPackagerVersion();
@@ -495,10 +508,45 @@ MasterPlaylist::MasterPlaylist(const std::string& file_name,
 
 MasterPlaylist::~MasterPlaylist() {}
 
+bool MasterPlaylist::PlaylistState::MatchesWritten(
+    const PlaylistState& written) const {
+  // BANDWIDTH must not be below the peak bitrate, so any increase of the
+  // maximum bitrate is written.
+  return playlist == written.playlist &&
+         attributes_version == written.attributes_version &&
+         max_bitrate <= written.max_bitrate &&
+         IsBitrateWithinTolerance(written.max_bitrate, max_bitrate) &&
+         IsBitrateWithinTolerance(written.avg_bitrate, avg_bitrate);
+}
+
 bool MasterPlaylist::WriteMasterPlaylist(
     const std::string& base_url,
     const std::string& output_dir,
     const std::list<MediaPlaylist*>& playlists) {
+  // Rendering the variants is quadratic in the number of playlists and every
+  // live segment triggers a write, so skip it if none of its inputs changed.
+  std::vector<PlaylistState> states;
+  states.reserve(playlists.size());
+  for (const MediaPlaylist* playlist : playlists) {
+    PlaylistState state = {playlist, playlist->attributes_version(), 0, 0};
+    // Text bitrates are not reported in the Master Playlist.
+    if (playlist->stream_type() !=
+        MediaPlaylist::MediaPlaylistStreamType::kSubtitle) {
+      state.max_bitrate = playlist->MaxBitrate();
+      state.avg_bitrate = playlist->AvgBitrate();
+    }
+    states.push_back(state);
+  }
+  if (written_ && base_url == written_base_url_ &&
+      output_dir == written_output_dir_ &&
+      states.size() == written_states_.size() &&
+      std::equal(states.begin(), states.end(), written_states_.begin(),
+                 [](const PlaylistState& state, const PlaylistState& written) {
+                   return state.MatchesWritten(written);
+                 })) {
+    return true;
+  }
+
   std::string content = "#EXTM3U\n";
   AppendVersionString(&content);
 
@@ -508,19 +556,19 @@ bool MasterPlaylist::WriteMasterPlaylist(
   AppendPlaylists(default_audio_language_, default_text_language_, base_url,
                   playlists, &content);
 
-  // Skip if the playlist is already written.
-  if (content == written_playlist_)
-    return true;
-
   std::string file_path =
       base::FilePath::FromUTF8Unsafe(output_dir)
           .Append(base::FilePath::FromUTF8Unsafe(file_name_))
           .AsUTF8Unsafe();
-  if (!File::WriteFileAtomically(file_path.c_str(), content)) {
-    LOG(ERROR) << "Failed to write master playlist to: " << file_path;
+  if (async_writer_) {
+    async_writer_->Write(file_path, content);
+  } else if (!file_writer_.Write(file_path, content)) {
     return false;
   }
-  written_playlist_ = content;
+  written_ = true;
+  written_base_url_ = base_url;
+  written_output_dir_ = output_dir;
+  written_states_ = std::move(states);
   return true;
 }
 
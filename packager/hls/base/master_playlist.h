@@ -7,10 +7,18 @@
 #ifndef PACKAGER_HLS_BASE_MASTER_PLAYLIST_H_
 #define PACKAGER_HLS_BASE_MASTER_PLAYLIST_H_
 
+#include <stdint.h>
+
 #include <list>
 #include <string>
+#include <vector>
+
+#include "packager/mpd/base/manifest_file_writer.h"
 
 namespace shaka {
+
+class AsyncManifestWriter;
+
 namespace hls {
 
 class MediaPlaylist;
@@ -43,15 +51,41 @@ class MasterPlaylist {
                                    const std::string& output_dir,
                                    const std::list<MediaPlaylist*>& playlists);
 
+  /// Sets the writer used by WriteMasterPlaylist() to write the playlist
+  /// asynchronously. The playlist is written synchronously if it is not set.
+  /// @param writer is not owned and must outlive this object.
+  void set_async_writer(AsyncManifestWriter* writer) { async_writer_ = writer; }
+
  private:
   MasterPlaylist(const MasterPlaylist&) = delete;
   MasterPlaylist& operator=(const MasterPlaylist&) = delete;
 
-  std::string written_playlist_;
+  // The inputs of a Media Playlist that affect the Master Playlist.
+  struct PlaylistState {
+    const MediaPlaylist* playlist;
+    uint64_t attributes_version;
+    uint64_t max_bitrate;
+    uint64_t avg_bitrate;
+
+    // Whether the Master Playlist written for |written| is still accurate
+    // enough for this state.
+    bool MatchesWritten(const PlaylistState& written) const;
+  };
+
+  // Set after a successful write. The playlist is only regenerated when
+  // these inputs change.
+  bool written_ = false;
+  std::string written_base_url_;
+  std::string written_output_dir_;
+  std::vector<PlaylistState> written_states_;
+
   const std::string file_name_;
   const std::string default_audio_language_;
   const std::string default_text_language_;
   bool is_independent_segments_;
+  AsyncManifestWriter* async_writer_ = nullptr;
+  // Writes the playlist if |async_writer_| is not set.
+  ManifestFileWriter file_writer_;
 };
 
 }  // namespace hls
@@ -180,6 +180,52 @@ TEST_F(MasterPlaylistTest, WriteMasterPlaylistOneVideo) {
   ASSERT_EQ(expected, actual);
 }
 
+TEST_F(MasterPlaylistTest, WriteMasterPlaylistOnlyWhenInputsChange) {
+  std::unique_ptr<MockMediaPlaylist> mock_playlist =
+      CreateVideoPlaylist("media1.m3u8", "avc1", 435889, 235889);
+
+  const char kBaseUrl[] = "http://myplaylistdomain.com/";
+  EXPECT_TRUE(master_playlist_->WriteMasterPlaylist(kBaseUrl, test_output_dir_,
+                                                   {mock_playlist.get()}));
+
+  // Nothing is regenerated or written if the inputs have not changed.
+  ASSERT_TRUE(File::Delete(master_playlist_path_.c_str()));
+  EXPECT_TRUE(master_playlist_->WriteMasterPlaylist(kBaseUrl, test_output_dir_,
+                                                   {mock_playlist.get()}));
+  std::string actual;
+  EXPECT_FALSE(File::ReadFileToString(master_playlist_path_.c_str(), &actual));
+
+  mock_playlist->SetCodecForTesting("avc1.64001e");
+  EXPECT_TRUE(master_playlist_->WriteMasterPlaylist(kBaseUrl, test_output_dir_,
+                                                   {mock_playlist.get()}));
+  ASSERT_TRUE(File::ReadFileToString(master_playlist_path_.c_str(), &actual));
+  EXPECT_THAT(actual, ::testing::HasSubstr("CODECS=\"avc1.64001e\""));
+
+  // Small changes of the average bitrate, and small decreases of the maximum
+  // bitrate, are not written.
+  ASSERT_TRUE(File::Delete(master_playlist_path_.c_str()));
+  EXPECT_CALL(*mock_playlist, AvgBitrate()).WillRepeatedly(Return(238000));
+  EXPECT_CALL(*mock_playlist, MaxBitrate()).WillRepeatedly(Return(435000));
+  EXPECT_TRUE(master_playlist_->WriteMasterPlaylist(kBaseUrl, test_output_dir_,
+                                                   {mock_playlist.get()}));
+  EXPECT_FALSE(File::ReadFileToString(master_playlist_path_.c_str(), &actual));
+
+  // Any increase of the maximum bitrate is written.
+  EXPECT_CALL(*mock_playlist, MaxBitrate()).WillRepeatedly(Return(435890));
+  EXPECT_TRUE(master_playlist_->WriteMasterPlaylist(kBaseUrl, test_output_dir_,
+                                                   {mock_playlist.get()}));
+  ASSERT_TRUE(File::ReadFileToString(master_playlist_path_.c_str(), &actual));
+  EXPECT_THAT(actual, ::testing::HasSubstr("BANDWIDTH=435890,"));
+  EXPECT_THAT(actual, ::testing::HasSubstr("AVERAGE-BANDWIDTH=238000,"));
+
+  // So are larger changes of the average bitrate.
+  EXPECT_CALL(*mock_playlist, AvgBitrate()).WillRepeatedly(Return(250000));
+  EXPECT_TRUE(master_playlist_->WriteMasterPlaylist(kBaseUrl, test_output_dir_,
+                                                   {mock_playlist.get()}));
+  ASSERT_TRUE(File::ReadFileToString(master_playlist_path_.c_str(), &actual));
+  EXPECT_THAT(actual, ::testing::HasSubstr("AVERAGE-BANDWIDTH=250000,"));
+}
+
 TEST_F(MasterPlaylistTest, 
        WriteMasterPlaylistOneVideoWithIndependentSegments) {
   const uint64_t kMaxBitrate = 435889;
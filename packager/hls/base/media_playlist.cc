@@ -7,6 +7,7 @@
 #include "packager/hls/base/media_playlist.h"
 
 #include <inttypes.h>
+#include <stdio.h>
 
 #include <algorithm>
 #include <cmath>
@@ -14,17 +15,31 @@
 
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
-#include "packager/file/file.h"
+#include "packager/file/file_deletion_queue.h"
 #include "packager/hls/base/tag.h"
 #include "packager/media/base/language_utils.h"
+#include "packager/media/base/metrics.h"
 #include "packager/media/base/muxer_util.h"
+#include "packager/mpd/base/async_manifest_writer.h"
 #include "packager/version/version.h"
 
 namespace shaka {
 namespace hls {
 
 namespace {
+// Partial segments are only listed for the last three target durations of the
+// playlist. The same number of partial segment target durations is used for
+// PART-HOLD-BACK.
+const double kNumTargetDurationsWithPartialSegments = 3;
+// The skip boundary of Playlist Delta Updates must be at least six target
+// durations.
+const double kMinNumTargetDurationsToSkipUntil = 6;
+const char kDeltaPlaylistSuffix[] = "_delta";
+const bool kIsDeltaUpdate = true;
+
 uint32_t GetTimeScale(const MediaInfo& media_info) {
   if (media_info.has_reference_time_scale())
     return media_info.reference_time_scale();
@@ -101,13 +116,30 @@ void AppendExtXMap(const MediaInfo& media_info, std::string* out) {
   }
 }
 
+// Returns the path of the Playlist Delta Update of the playlist at
+// |file_path|, e.g. "video_delta.m3u8" for "video.m3u8".
+std::string GetDeltaPlaylistPath(const std::string& file_path) {
+  const std::string extension = ".m3u8";
+  if (base::EndsWith(file_path, extension, base::CompareCase::SENSITIVE)) {
+    return file_path.substr(0, file_path.size() - extension.size()) +
+           kDeltaPlaylistSuffix + extension;
+  }
+  return file_path + kDeltaPlaylistSuffix;
+}
+
+// |can_skip_until| is zero if the playlist does not support Playlist Delta
+// Updates. |is_delta_update| is true if the header is for a Playlist Delta
+// Update, which requires version 9.
 std::string CreatePlaylistHeader(
     const MediaInfo& media_info,
     uint32_t target_duration,
     HlsPlaylistType type,
     MediaPlaylist::MediaPlaylistStreamType stream_type,
     uint32_t media_sequence_number,
-    int discontinuity_sequence_number) {
+    int discontinuity_sequence_number,
+    double part_target_duration,
+    double can_skip_until,
+    bool is_delta_update) {
   const std::string version = GetPackagerVersion();
   std::string version_line;
   if (!version.empty()) {
@@ -119,10 +151,10 @@ std::string CreatePlaylistHeader(
   // 6 is required for EXT-X-MAP without EXT-X-I-FRAMES-ONLY.
   std::string header = base::StringPrintf(
       "#EXTM3U\n"
-      "#EXT-X-VERSION:6\n"
+      "#EXT-X-VERSION:%d\n"
       "%s"
       "#EXT-X-TARGETDURATION:%d\n",
-      version_line.c_str(), target_duration);
+      is_delta_update ? 9 : 6, version_line.c_str(), target_duration);
 
   switch (type) {
     case HlsPlaylistType::kVod:
@@ -148,6 +180,22 @@ std::string CreatePlaylistHeader(
       MediaPlaylist::MediaPlaylistStreamType::kVideoIFramesOnly) {
     base::StringAppendF(&header, "#EXT-X-I-FRAMES-ONLY\n");
   }
+  // A zero |part_target_duration| means that there are no partial segments.
+  if (part_target_duration > 0 || can_skip_until > 0) {
+    Tag tag("#EXT-X-SERVER-CONTROL", &header);
+    if (part_target_duration > 0) {
+      tag.AddString("CAN-BLOCK-RELOAD", "YES");
+      tag.AddFloat("PART-HOLD-BACK", kNumTargetDurationsWithPartialSegments *
+                                         part_target_duration);
+    }
+    if (can_skip_until > 0)
+      tag.AddFloat("CAN-SKIP-UNTIL", can_skip_until);
+    header += "\n";
+  }
+  if (part_target_duration > 0) {
+    base::StringAppendF(&header, "#EXT-X-PART-INF:PART-TARGET=%.3f\n",
+                        part_target_duration);
+  }
 
   // Put EXT-X-MAP at the end since the rest of the playlist is about the
   // segment and key info.
@@ -173,11 +221,20 @@ class SegmentInfoEntry : public HlsEntry {
                    uint64_t previous_segment_end_offset);
 
   std::string ToString() override;
+  const std::string& file_name() const { return file_name_; }
   int64_t start_time() const { return start_time_; }
   double duration_seconds() const { return duration_seconds_; }
   void set_duration_seconds(double duration_seconds) {
     duration_seconds_ = duration_seconds;
   }
+  // Marks the segment missing with EXT-X-GAP. Clients do not load it.
+  void set_is_gap(bool is_gap) { is_gap_ = is_gap; }
+  bool is_gap() const { return is_gap_; }
+  uint64_t start_byte_offset() const { return start_byte_offset_; }
+  uint64_t segment_file_size() const { return segment_file_size_; }
+  uint64_t previous_segment_end_offset() const {
+    return previous_segment_end_offset_;
+  }
 
  private:
   SegmentInfoEntry(const SegmentInfoEntry&) = delete;
@@ -186,6 +243,7 @@ class SegmentInfoEntry : public HlsEntry {
   const std::string file_name_;
   const int64_t start_time_;
   double duration_seconds_;
+  bool is_gap_ = false;
   const bool use_byte_range_;
   const uint64_t start_byte_offset_;
   const uint64_t segment_file_size_;
@@ -209,7 +267,8 @@ SegmentInfoEntry::SegmentInfoEntry(const std::string& file_name,
       previous_segment_end_offset_(previous_segment_end_offset) {}
 
 std::string SegmentInfoEntry::ToString() {
-  std::string result = base::StringPrintf("#EXTINF:%.3f,", duration_seconds_);
+  std::string result = is_gap_ ? "#EXT-X-GAP\n" : "";
+  base::StringAppendF(&result, "#EXTINF:%.3f,", duration_seconds_);
 
   if (use_byte_range_) {
     base::StringAppendF(&result, "\n#EXT-X-BYTERANGE:%" PRIu64,
@@ -224,6 +283,43 @@ std::string SegmentInfoEntry::ToString() {
   return result;
 }
 
+class PartialSegmentEntry : public HlsEntry {
+ public:
+  // |duration_seconds| is duration in seconds.
+  PartialSegmentEntry(const std::string& file_name,
+                      double duration_seconds,
+                      bool independent);
+
+  std::string ToString() override;
+  double duration_seconds() const { return duration_seconds_; }
+
+ private:
+  PartialSegmentEntry(const PartialSegmentEntry&) = delete;
+  PartialSegmentEntry& operator=(const PartialSegmentEntry&) = delete;
+
+  const std::string file_name_;
+  const double duration_seconds_;
+  const bool independent_;
+};
+
+PartialSegmentEntry::PartialSegmentEntry(const std::string& file_name,
+                                         double duration_seconds,
+                                         bool independent)
+    : HlsEntry(HlsEntry::EntryType::kExtPart),
+      file_name_(file_name),
+      duration_seconds_(duration_seconds),
+      independent_(independent) {}
+
+std::string PartialSegmentEntry::ToString() {
+  std::string tag_string;
+  Tag tag("#EXT-X-PART", &tag_string);
+  tag.AddFloat("DURATION", duration_seconds_);
+  tag.AddQuotedString("URI", file_name_);
+  if (independent_)
+    tag.AddString("INDEPENDENT", "YES");
+  return tag_string;
+}
+
 class EncryptionInfoEntry : public HlsEntry {
  public:
   EncryptionInfoEntry(MediaPlaylist::EncryptionMethod method,
@@ -294,6 +390,27 @@ std::string EncryptionInfoEntry::ToString() {
   return tag_string;
 }
 
+// An entry restored from a checkpoint as the text it was rendered to.
+class RenderedEntry : public HlsEntry {
+ public:
+  RenderedEntry(HlsEntry::EntryType type, const std::string& text);
+
+  std::string ToString() override;
+
+ private:
+  RenderedEntry(const RenderedEntry&) = delete;
+  RenderedEntry& operator=(const RenderedEntry&) = delete;
+
+  const std::string text_;
+};
+
+RenderedEntry::RenderedEntry(HlsEntry::EntryType type, const std::string& text)
+    : HlsEntry(type), text_(text) {}
+
+std::string RenderedEntry::ToString() {
+  return text_;
+}
+
 class DiscontinuityEntry : public HlsEntry {
  public:
   DiscontinuityEntry();
@@ -331,6 +448,13 @@ std::string PlacementOpportunityEntry::ToString() {
   return "#EXT-X-PLACEMENT-OPPORTUNITY";
 }
 
+// Identifies the output of the stream in Metrics, as the muxers do.
+std::string GetOutputMetricLabel(const MediaInfo& media_info) {
+  return media::MetricLabel("output", media_info.has_segment_template()
+                                          ? media_info.segment_template()
+                                          : media_info.media_file_name());
+}
+
 }  // namespace
 
 HlsEntry::HlsEntry(HlsEntry::EntryType type) : type_(type) {}
@@ -355,19 +479,23 @@ MediaPlaylist::~MediaPlaylist() {}
 void MediaPlaylist::SetStreamTypeForTesting(
     MediaPlaylistStreamType stream_type) {
   stream_type_ = stream_type;
+  ++attributes_version_;
 }
 
 void MediaPlaylist::SetCodecForTesting(const std::string& codec) {
   codec_ = codec;
+  ++attributes_version_;
 }
 
 void MediaPlaylist::SetLanguageForTesting(const std::string& language) {
   language_ = language;
+  ++attributes_version_;
 }
 
 void MediaPlaylist::SetCharacteristicsForTesting(
     const std::vector<std::string>& characteristics) {
   characteristics_ = characteristics;
+  ++attributes_version_;
 }
 
 bool MediaPlaylist::SetMediaInfo(const MediaInfo& media_info) {
@@ -396,13 +524,16 @@ bool MediaPlaylist::SetMediaInfo(const MediaInfo& media_info) {
   characteristics_ =
       std::vector<std::string>(media_info_.hls_characteristics().begin(),
                                media_info_.hls_characteristics().end());
+  ++attributes_version_;
 
   return true;
 }
 
 void MediaPlaylist::SetSampleDuration(uint32_t sample_duration) {
-  if (media_info_.has_video_info())
+  if (media_info_.has_video_info()) {
     media_info_.mutable_video_info()->set_frame_duration(sample_duration);
+    ++attributes_version_;
+  }
 }
 
 void MediaPlaylist::AddSegment(const std::string& file_name,
@@ -429,10 +560,29 @@ void MediaPlaylist::AddSegment(const std::string& file_name,
     key_frames_.clear();
     return;
   }
+  publication_latency_.OnSegmentWritten(GetOutputMetricLabel(media_info_));
   return AddSegmentInfoEntry(file_name, start_time, duration, start_byte_offset,
                              size);
 }
 
+void MediaPlaylist::AddPartialSegment(const std::string& file_name,
+                                      int64_t duration,
+                                      bool independent,
+                                      const std::string& next_file_name) {
+  if (time_scale_ == 0) {
+    LOG(WARNING) << "Timescale is not set and the duration for " << duration
+                 << " cannot be calculated. The partial segment is ignored.";
+    return;
+  }
+  const double duration_seconds = static_cast<double>(duration) / time_scale_;
+  longest_partial_segment_duration_seconds_ =
+      std::max(longest_partial_segment_duration_seconds_, duration_seconds);
+  entries_.emplace_back(
+      new PartialSegmentEntry(file_name, duration_seconds, independent));
+  next_partial_segment_file_name_ = next_file_name;
+  publication_latency_.OnSegmentWritten(GetOutputMetricLabel(media_info_));
+}
+
 void MediaPlaylist::AddKeyFrame(int64_t timestamp,
                                 uint64_t start_byte_offset,
                                 uint64_t size) {
@@ -444,6 +594,7 @@ void MediaPlaylist::AddKeyFrame(int64_t timestamp,
     }
     stream_type_ = MediaPlaylistStreamType::kVideoIFramesOnly;
     use_byte_range_ = true;
+    ++attributes_version_;
   }
   key_frames_.push_back({timestamp, start_byte_offset, size});
 }
@@ -469,27 +620,275 @@ void MediaPlaylist::AddPlacementOpportunity() {
   entries_.emplace_back(new PlacementOpportunityEntry());
 }
 
+void MediaPlaylist::AddDiscontinuity() {
+  entries_.emplace_back(new DiscontinuityEntry());
+}
+
+double MediaPlaylist::AddGapSegment() {
+  if (time_scale_ == 0 || use_byte_range_)
+    return 0;
+  auto last_segment = std::find_if(
+      entries_.rbegin(), entries_.rend(),
+      [](const std::unique_ptr<HlsEntry>& entry) {
+        return entry->type() == HlsEntry::EntryType::kExtInf;
+      });
+  if (last_segment == entries_.rend())
+    return 0;
+  const SegmentInfoEntry* previous_segment =
+      static_cast<SegmentInfoEntry*>(last_segment->get());
+  // The gap continues the timeline with the duration of the previous segment.
+  // Its URI is the one of the previous segment, as it has to be valid but is
+  // not loaded.
+  const double duration_seconds = previous_segment->duration_seconds();
+  const int64_t start_time =
+      previous_segment->start_time() +
+      static_cast<int64_t>(duration_seconds * time_scale_);
+  const std::string file_name = previous_segment->file_name();
+
+  SlideWindow();
+  current_buffer_depth_ += duration_seconds;
+  std::unique_ptr<SegmentInfoEntry> gap_segment(new SegmentInfoEntry(
+      file_name, start_time, duration_seconds, use_byte_range_, 0, 0,
+      previous_segment_end_offset_));
+  gap_segment->set_is_gap(true);
+  entries_.push_back(std::move(gap_segment));
+  return duration_seconds;
+}
+
+std::string MediaPlaylist::GetCheckpointState() {
+  std::string state = base::StringPrintf(
+      "media_sequence_number %u\ndiscontinuity_sequence_number %d\n"
+      "previous_segment_end_offset %" PRIu64 "\nremoved_gap_segments %u\n",
+      media_sequence_number_, discontinuity_sequence_number_,
+      previous_segment_end_offset_, num_removed_gap_segments_);
+  for (const std::unique_ptr<HlsEntry>& entry : entries_) {
+    switch (entry->type()) {
+      case HlsEntry::EntryType::kExtInf: {
+        const SegmentInfoEntry* segment =
+            static_cast<const SegmentInfoEntry*>(entry.get());
+        base::StringAppendF(
+            &state,
+            "segment %" PRId64 " %.17g %" PRIu64 " %" PRIu64 " %" PRIu64
+            " %d %s\n",
+            segment->start_time(), segment->duration_seconds(),
+            segment->start_byte_offset(), segment->segment_file_size(),
+            segment->previous_segment_end_offset(), segment->is_gap() ? 1 : 0,
+            segment->file_name().c_str());
+        break;
+      }
+      case HlsEntry::EntryType::kExtKey:
+        state += "key " + entry->ToString() + "\n";
+        break;
+      case HlsEntry::EntryType::kExtDiscontinuity:
+        state += "discontinuity\n";
+        break;
+      case HlsEntry::EntryType::kExtPlacementOpportunity:
+      case HlsEntry::EntryType::kExtPart:
+        // Only relevant to the segments being generated.
+        break;
+    }
+  }
+  return state;
+}
+
+bool MediaPlaylist::RestoreCheckpointState(const std::string& state) {
+  DCHECK(entries_.empty());
+  uint32_t media_sequence_number = media_sequence_number_;
+  int discontinuity_sequence_number = discontinuity_sequence_number_;
+  uint64_t previous_segment_end_offset = previous_segment_end_offset_;
+  uint32_t num_removed_gap_segments = num_removed_gap_segments_;
+  std::deque<std::unique_ptr<HlsEntry>> entries;
+  double buffer_depth = 0;
+  double longest_segment_duration_seconds = 0;
+  for (const std::string& line : base::SplitString(
+           state, "\n", base::KEEP_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    const size_t space = line.find(' ');
+    const std::string name = line.substr(0, space);
+    const std::string value =
+        space == std::string::npos ? "" : line.substr(space + 1);
+    bool valid = true;
+    if (name == "media_sequence_number") {
+      valid = base::StringToUint(value, &media_sequence_number);
+    } else if (name == "discontinuity_sequence_number") {
+      valid = base::StringToInt(value, &discontinuity_sequence_number);
+    } else if (name == "previous_segment_end_offset") {
+      valid = base::StringToUint64(value, &previous_segment_end_offset);
+    } else if (name == "removed_gap_segments") {
+      valid = base::StringToUint(value, &num_removed_gap_segments);
+    } else if (name == "key") {
+      entries.emplace_back(
+          new RenderedEntry(HlsEntry::EntryType::kExtKey, value));
+    } else if (name == "discontinuity") {
+      entries.emplace_back(new DiscontinuityEntry());
+    } else if (name == "segment") {
+      int64_t start_time = 0;
+      double duration_seconds = 0;
+      uint64_t start_byte_offset = 0;
+      uint64_t size = 0;
+      uint64_t segment_previous_end_offset = 0;
+      int is_gap = 0;
+      int file_name_start = 0;
+      valid = sscanf(value.c_str(),
+                     "%" SCNd64 " %lf %" SCNu64 " %" SCNu64 " %" SCNu64
+                     " %d %n",
+                     &start_time, &duration_seconds, &start_byte_offset, &size,
+                     &segment_previous_end_offset, &is_gap,
+                     &file_name_start) == 6 &&
+              file_name_start > 0;
+      if (valid) {
+        std::unique_ptr<SegmentInfoEntry> segment(new SegmentInfoEntry(
+            value.substr(file_name_start), start_time, duration_seconds,
+            use_byte_range_, start_byte_offset, size,
+            segment_previous_end_offset));
+        segment->set_is_gap(is_gap != 0);
+        entries.push_back(std::move(segment));
+        buffer_depth += duration_seconds;
+        longest_segment_duration_seconds =
+            std::max(longest_segment_duration_seconds, duration_seconds);
+      }
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      LOG(ERROR) << "Invalid checkpoint state of playlist " << file_name_
+                 << ": " << line;
+      return false;
+    }
+  }
+
+  media_sequence_number_ = media_sequence_number;
+  discontinuity_sequence_number_ = discontinuity_sequence_number;
+  previous_segment_end_offset_ = previous_segment_end_offset;
+  num_removed_gap_segments_ = num_removed_gap_segments;
+  entries_.swap(entries);
+  current_buffer_depth_ = buffer_depth;
+  longest_segment_duration_seconds_ = longest_segment_duration_seconds;
+  return true;
+}
+
 bool MediaPlaylist::WriteToFile(const std::string& file_path) {
   if (!target_duration_set_) {
     SetTargetDuration(ceil(GetLongestSegmentDuration()));
   }
+  // Partial segments are not generated for all the stream formats.
+  const bool low_latency = hls_params_.low_latency_mode &&
+                           hls_params_.playlist_type != HlsPlaylistType::kVod &&
+                           longest_partial_segment_duration_seconds_ > 0;
+  if (low_latency)
+    RemoveOldPartialSegments();
+
+  // The entries before the last segment entry never change, so their rendered
+  // text is cached and only the header and the tail are rendered every time.
+  const size_t num_immutable_entries = GetNumImmutableEntries();
+  for (size_t i = rendered_entry_sizes_.size(); i < num_immutable_entries;
+       ++i) {
+    const size_t previous_size = rendered_entries_.size();
+    base::StringAppendF(&rendered_entries_, "%s\n",
+                        entries_[i]->ToString().c_str());
+    rendered_entry_sizes_.push_back(rendered_entries_.size() - previous_size);
+  }
 
-  std::string content = CreatePlaylistHeader(
-      media_info_, target_duration_, hls_params_.playlist_type, stream_type_,
-      media_sequence_number_, discontinuity_sequence_number_);
-
-  for (const auto& entry : entries_)
-    base::StringAppendF(&content, "%s\n", entry->ToString().c_str());
+  // PART-TARGET must not be exceeded by any partial segment.
+  const double part_target_duration =
+      low_latency ? std::max(hls_params_.target_part_duration,
+                             longest_partial_segment_duration_seconds_)
+                  : 0;
+  const bool delta_update = hls_params_.delta_update_skip_until > 0 &&
+                            hls_params_.playlist_type != HlsPlaylistType::kVod;
+  const double can_skip_until =
+      delta_update
+          ? std::max(hls_params_.delta_update_skip_until,
+                     kMinNumTargetDurationsToSkipUntil * target_duration_)
+          : 0;
+
+  // The entries that may still change, which are rendered every time.
+  std::string tail;
+  for (size_t i = num_immutable_entries; i < entries_.size(); ++i)
+    base::StringAppendF(&tail, "%s\n", entries_[i]->ToString().c_str());
+  if (low_latency && !next_partial_segment_file_name_.empty()) {
+    Tag tag("#EXT-X-PRELOAD-HINT", &tail);
+    tag.AddString("TYPE", "PART");
+    tag.AddQuotedString("URI", next_partial_segment_file_name_);
+    tail += "\n";
+  }
 
   if (hls_params_.playlist_type == HlsPlaylistType::kVod) {
-    content += "#EXT-X-ENDLIST\n";
+    tail += "#EXT-X-ENDLIST\n";
   }
 
-  if (!File::WriteFileAtomically(file_path.c_str(), content)) {
-    LOG(ERROR) << "Failed to write playlist to: " << file_path;
+  std::string& content = playlist_buffer_;
+  content.clear();
+  content.append(CreatePlaylistHeader(
+      media_info_, target_duration_, hls_params_.playlist_type, stream_type_,
+      media_sequence_number_, discontinuity_sequence_number_,
+      part_target_duration, can_skip_until, !kIsDeltaUpdate));
+  content += rendered_entries_;
+  content += tail;
+
+  if (!WritePlaylist(file_path, content))
     return false;
+  publication_latency_.OnManifestPublished();
+  if (!delta_update)
+    return true;
+
+  size_t num_skipped_entries = 0;
+  size_t num_skipped_segments = 0;
+  GetSkippedEntries(can_skip_until, num_immutable_entries,
+                    &num_skipped_entries, &num_skipped_segments);
+  size_t num_skipped_bytes = 0;
+  for (size_t i = 0; i < num_skipped_entries; ++i)
+    num_skipped_bytes += rendered_entry_sizes_[i];
+
+  std::string delta = CreatePlaylistHeader(
+      media_info_, target_duration_, hls_params_.playlist_type, stream_type_,
+      media_sequence_number_, discontinuity_sequence_number_,
+      part_target_duration, can_skip_until, kIsDeltaUpdate);
+  if (num_skipped_segments > 0) {
+    Tag tag("#EXT-X-SKIP", &delta);
+    tag.AddNumber("SKIPPED-SEGMENTS", num_skipped_segments);
+    delta += "\n";
+  }
+  delta.append(rendered_entries_, num_skipped_bytes, std::string::npos);
+  delta += tail;
+  return WritePlaylist(GetDeltaPlaylistPath(file_path), delta);
+}
+
+bool MediaPlaylist::WritePlaylist(const std::string& file_path,
+                                  const std::string& content) {
+  if (async_writer_) {
+    async_writer_->Write(file_path, content);
+    return true;
+  }
+  return file_writer_.Write(file_path, content);
+}
+
+void MediaPlaylist::GetSkippedEntries(double can_skip_until,
+                                      size_t num_immutable_entries,
+                                      size_t* num_skipped_entries,
+                                      size_t* num_skipped_segments) const {
+  // Segments ending at least |can_skip_until| before the end of the playlist,
+  // together with the tags before them, can be skipped.
+  *num_skipped_entries = 0;
+  double duration_after_segment = 0;
+  for (size_t i = entries_.size(); i > 0; --i) {
+    if (entries_[i - 1]->type() != HlsEntry::EntryType::kExtInf)
+      continue;
+    if (duration_after_segment >= can_skip_until) {
+      *num_skipped_entries = i;
+      break;
+    }
+    duration_after_segment +=
+        static_cast<const SegmentInfoEntry*>(entries_[i - 1].get())
+            ->duration_seconds();
+  }
+  // Only the entries with cached rendered text are skipped.
+  *num_skipped_entries = std::min(*num_skipped_entries, num_immutable_entries);
+
+  *num_skipped_segments = 0;
+  for (size_t i = 0; i < *num_skipped_entries; ++i) {
+    if (entries_[i]->type() == HlsEntry::EntryType::kExtInf)
+      ++*num_skipped_segments;
   }
-  return true;
 }
 
 uint64_t MediaPlaylist::MaxBitrate() const {
@@ -607,16 +1006,23 @@ void MediaPlaylist::AddSegmentInfoEntry(const std::string& segment_file_name,
   bandwidth_estimator_.AddBlock(size, segment_duration_seconds);
   current_buffer_depth_ += segment_duration_seconds;
 
-  if (!entries_.empty() &&
-      entries_.back()->type() == HlsEntry::EntryType::kExtInf) {
+  // The partial segments of this segment, if any, are already added.
+  auto last_entry = std::find_if(
+      entries_.rbegin(), entries_.rend(),
+      [](const std::unique_ptr<HlsEntry>& entry) {
+        return entry->type() != HlsEntry::EntryType::kExtPart;
+      });
+  if (last_entry != entries_.rend() &&
+      (*last_entry)->type() == HlsEntry::EntryType::kExtInf) {
     const SegmentInfoEntry* segment_info =
-        static_cast<SegmentInfoEntry*>(entries_.back().get());
+        static_cast<SegmentInfoEntry*>(last_entry->get());
     if (segment_info->start_time() > start_time) {
       LOG(WARNING)
           << "Insert a discontinuity tag after the segment with start time "
           << segment_info->start_time() << " as the next segment starts at "
           << start_time << ".";
-      entries_.emplace_back(new DiscontinuityEntry());
+      // Insert it before the partial segments of this segment.
+      entries_.emplace(last_entry.base(), new DiscontinuityEntry());
     }
   }
 
@@ -676,12 +1082,12 @@ void MediaPlaylist::SlideWindow() {
   //    #EXT-X-KEY   <2>
   //    #EXTINF      <3>
   //    #EXTINF      <4>
-  std::list<std::unique_ptr<HlsEntry>> ext_x_keys;
+  std::vector<std::unique_ptr<HlsEntry>> ext_x_keys;
   // Consecutive key entries are either fully removed or not removed at all.
   // Keep track of entry types so we know if it is consecutive key entries.
   HlsEntry::EntryType prev_entry_type = HlsEntry::EntryType::kExtInf;
 
-  std::list<std::unique_ptr<HlsEntry>>::iterator last = entries_.begin();
+  auto last = entries_.begin();
   for (; last != entries_.end(); ++last) {
     HlsEntry::EntryType entry_type = last->get()->type();
     if (entry_type == HlsEntry::EntryType::kExtKey) {
@@ -690,6 +1096,8 @@ void MediaPlaylist::SlideWindow() {
       ext_x_keys.push_back(std::move(*last));
     } else if (entry_type == HlsEntry::EntryType::kExtDiscontinuity) {
       ++discontinuity_sequence_number_;
+    } else if (entry_type == HlsEntry::EntryType::kExtPart) {
+      // Partial segments are removed together with the segments around them.
     } else {
       DCHECK_EQ(entry_type, HlsEntry::EntryType::kExtInf);
 
@@ -703,34 +1111,127 @@ void MediaPlaylist::SlideWindow() {
       if (segment_within_time_shift_buffer)
         break;
       current_buffer_depth_ -= segment_info.duration_seconds();
-      RemoveOldSegment(segment_info.start_time());
+      // Gap segments reuse the file of the previous segment, and their start
+      // time may be the one of the segment after them.
+      if (segment_info.is_gap())
+        ++num_removed_gap_segments_;
+      else
+        RemoveOldSegment(segment_info.start_time());
       media_sequence_number_++;
     }
     prev_entry_type = entry_type;
   }
+  const size_t num_removed_entries = last - entries_.begin();
   entries_.erase(entries_.begin(), last);
+  UpdateRenderedEntriesAfterSlide(num_removed_entries, ext_x_keys);
   // Add key entries back.
   entries_.insert(entries_.begin(), std::make_move_iterator(ext_x_keys.begin()),
                   std::make_move_iterator(ext_x_keys.end()));
 }
 
+void MediaPlaylist::RemoveOldPartialSegments() {
+  const double window_seconds =
+      kNumTargetDurationsWithPartialSegments * target_duration_;
+  // Find the first segment entry that starts outside of the window. The
+  // partial segments after the last segment entry belong to the segment in
+  // progress.
+  double duration_from_end_seconds = 0;
+  bool after_last_segment = true;
+  size_t window_start = entries_.size();
+  for (; window_start > 0; --window_start) {
+    const HlsEntry* entry = entries_[window_start - 1].get();
+    if (entry->type() == HlsEntry::EntryType::kExtInf) {
+      after_last_segment = false;
+      duration_from_end_seconds +=
+          static_cast<const SegmentInfoEntry*>(entry)->duration_seconds();
+    } else if (entry->type() == HlsEntry::EntryType::kExtPart &&
+               after_last_segment) {
+      duration_from_end_seconds +=
+          static_cast<const PartialSegmentEntry*>(entry)->duration_seconds();
+    }
+    if (duration_from_end_seconds > window_seconds)
+      break;
+  }
+  if (window_start == 0)
+    return;
+
+  // There are no partial segment entries in the rendered entries, see
+  // GetNumImmutableEntries().
+  const size_t scan_start =
+      std::min(rendered_entry_sizes_.size(), window_start - 1);
+  auto window_begin = entries_.begin() + (window_start - 1);
+  entries_.erase(
+      std::remove_if(entries_.begin() + scan_start, window_begin,
+                     [](const std::unique_ptr<HlsEntry>& entry) {
+                       return entry->type() == HlsEntry::EntryType::kExtPart;
+                     }),
+      window_begin);
+}
+
+size_t MediaPlaylist::GetNumImmutableEntries() const {
+  // Only the last segment entry can be updated, see
+  // AdjustLastSegmentInfoEntryDuration(). Partial segment entries can be
+  // removed, see RemoveOldPartialSegments().
+  size_t num_immutable_entries = entries_.size();
+  for (size_t i = entries_.size(); i > 0; --i) {
+    if (entries_[i - 1]->type() == HlsEntry::EntryType::kExtInf) {
+      num_immutable_entries = i - 1;
+      break;
+    }
+  }
+  for (size_t i = rendered_entry_sizes_.size(); i < num_immutable_entries;
+       ++i) {
+    if (entries_[i]->type() == HlsEntry::EntryType::kExtPart)
+      return i;
+  }
+  return num_immutable_entries;
+}
+
+void MediaPlaylist::UpdateRenderedEntriesAfterSlide(
+    size_t num_removed_entries,
+    const std::vector<std::unique_ptr<HlsEntry>>& kept_ext_x_keys) {
+  if (num_removed_entries > rendered_entry_sizes_.size()) {
+    rendered_entries_.clear();
+    rendered_entry_sizes_.clear();
+    return;
+  }
+
+  size_t num_removed_bytes = 0;
+  for (size_t i = 0; i < num_removed_entries; ++i) {
+    num_removed_bytes += rendered_entry_sizes_.front();
+    rendered_entry_sizes_.pop_front();
+  }
+
+  std::string rendered_ext_x_keys;
+  std::vector<size_t> rendered_ext_x_key_sizes;
+  for (const auto& entry : kept_ext_x_keys) {
+    const size_t previous_size = rendered_ext_x_keys.size();
+    base::StringAppendF(&rendered_ext_x_keys, "%s\n",
+                        entry->ToString().c_str());
+    rendered_ext_x_key_sizes.push_back(rendered_ext_x_keys.size() -
+                                       previous_size);
+  }
+  rendered_entries_.replace(0, num_removed_bytes, rendered_ext_x_keys);
+  rendered_entry_sizes_.insert(rendered_entry_sizes_.begin(),
+                               rendered_ext_x_key_sizes.begin(),
+                               rendered_ext_x_key_sizes.end());
+}
+
 void MediaPlaylist::RemoveOldSegment(int64_t start_time) {
   if (hls_params_.preserved_segments_outside_live_window == 0)
     return;
   if (stream_type_ == MediaPlaylistStreamType::kVideoIFramesOnly)
     return;
 
+  // The segment numbers do not count the gap segments.
+  const uint32_t segment_index =
+      media_sequence_number_ - num_removed_gap_segments_;
   segments_to_be_removed_.push_back(
       media::GetSegmentName(media_info_.segment_template(), start_time,
-                            media_sequence_number_, media_info_.bandwidth()));
+                            segment_index, media_info_.bandwidth()));
   while (segments_to_be_removed_.size() >
          hls_params_.preserved_segments_outside_live_window) {
-    VLOG(2) << "Deleting " << segments_to_be_removed_.front();
-    if (!File::Delete(segments_to_be_removed_.front().c_str())) {
-      LOG(WARNING) << "Failed to delete " << segments_to_be_removed_.front()
-                   << "; Will retry later.";
-      break;
-    }
+    FileDeletionQueue::GetInstance()->Delete(segments_to_be_removed_.front());
     segments_to_be_removed_.pop_front();
   }
 }
@@ -7,6 +7,7 @@
 #ifndef PACKAGER_HLS_BASE_MEDIA_PLAYLIST_H_
 #define PACKAGER_HLS_BASE_MEDIA_PLAYLIST_H_
 
+#include <deque>
 #include <list>
 #include <memory>
 #include <string>
@@ -14,11 +15,14 @@
 
 #include "packager/base/macros.h"
 #include "packager/hls/public/hls_params.h"
+#include "packager/media/base/metrics.h"
 #include "packager/mpd/base/bandwidth_estimator.h"
+#include "packager/mpd/base/manifest_file_writer.h"
 #include "packager/mpd/base/media_info.pb.h"
 
 namespace shaka {
 
+class AsyncManifestWriter;
 class File;
 
 namespace hls {
@@ -30,6 +34,7 @@ class HlsEntry {
     kExtKey,
     kExtDiscontinuity,
     kExtPlacementOpportunity,
+    kExtPart,
   };
   virtual ~HlsEntry();
 
@@ -80,6 +85,10 @@ class MediaPlaylist {
   MediaPlaylistStreamType stream_type() const { return stream_type_; }
   const std::string& codec() const { return codec_; }
 
+  /// @return a number that changes whenever an attribute reported in the
+  ///         Master Playlist, e.g. the codec or the resolution, changes.
+  uint64_t attributes_version() const { return attributes_version_; }
+
   /// For testing only.
   void SetStreamTypeForTesting(MediaPlaylistStreamType stream_type);
 
@@ -118,6 +127,20 @@ class MediaPlaylist {
                           uint64_t start_byte_offset,
                           uint64_t size);
 
+  /// Partial segments must be added in order, before the containing segment
+  /// is added with AddSegment(). Only applies to low latency LIVE and EVENT
+  /// playlists.
+  /// @param file_name is the file name of the partial segment.
+  /// @param duration is in terms of the timescale of the media.
+  /// @param independent is true if the partial segment starts with a key
+  ///        frame.
+  /// @param next_file_name is the file name of the next partial segment,
+  ///        which is advertised with EXT-X-PRELOAD-HINT.
+  virtual void AddPartialSegment(const std::string& file_name,
+                                 int64_t duration,
+                                 bool independent,
+                                 const std::string& next_file_name);
+
   /// Keyframes must be added in order. It is also called before the containing
   /// segment being called.
   /// @param timestamp is the timestamp of the key frame in timescale of the
@@ -150,6 +173,28 @@ class MediaPlaylist {
   /// https://support.google.com/dfp_premium/answer/7295798?hl=en.
   virtual void AddPlacementOpportunity();
 
+  /// Add #EXT-X-DISCONTINUITY before the next segment, e.g. when the codec
+  /// configuration of the stream changes.
+  virtual void AddDiscontinuity();
+
+  /// Adds a segment tagged with EXT-X-GAP after the last segment, with the
+  /// same duration, for LIVE and EVENT playlists whose input stalled, so the
+  /// playlist keeps moving. Not supported with byte ranges.
+  /// @return the duration of the gap segment in seconds, or 0 if there is no
+  ///         segment yet to continue from.
+  virtual double AddGapSegment();
+
+  /// @return the state of the playlist to checkpoint, i.e. the segments,
+  ///         EXT-X-KEY and discontinuity tags of the live window, and the
+  ///         media sequence and discontinuity sequence numbers.
+  virtual std::string GetCheckpointState();
+
+  /// Restores the state returned by GetCheckpointState() of a previous run,
+  /// so that the playlist continues where it stopped. Must be called after
+  /// SetMediaInfo() and before any segment is added.
+  /// @return true on success, false if @a state cannot be parsed.
+  virtual bool RestoreCheckpointState(const std::string& state);
+
   /// Write the playlist to |file_path|.
   /// This does not close the file.
   /// If target duration is not set explicitly, this will try to find the target
@@ -162,6 +207,11 @@ class MediaPlaylist {
   /// @return true on success, false otherwise.
   virtual bool WriteToFile(const std::string& file_path);
 
+  /// Sets the writer used by WriteToFile() to write the playlist
+  /// asynchronously. The playlist is written synchronously if it is not set.
+  /// @param writer is not owned and must outlive this object.
+  void set_async_writer(AsyncManifestWriter* writer) { async_writer_ = writer; }
+
   /// If bitrate is specified in MediaInfo then it will use that value.
   /// Otherwise, returns the max bitrate.
   /// @return the max bitrate (in bits per second) of this MediaPlaylist.
@@ -247,6 +297,29 @@ class MediaPlaylist {
   // happen at a later time depending on the value of
   // |preserved_segment_outside_live_window| in |hls_params_|.
   void RemoveOldSegment(int64_t start_time);
+  // Remove the partial segment entries which are more than three target
+  // durations from the end of the playlist.
+  void RemoveOldPartialSegments();
+  // Returns the number of entries at the front of |entries_| which cannot be
+  // updated anymore, i.e. the entries before the last segment entry and before
+  // the first partial segment entry.
+  size_t GetNumImmutableEntries() const;
+  // Writes |content| to |file_path|, with |async_writer_| if it is set.
+  bool WritePlaylist(const std::string& file_path, const std::string& content);
+  // Gets the number of entries at the front of |entries_| skipped by a
+  // Playlist Delta Update with |can_skip_until|, and the number of segments
+  // in them. The skipped entries are a subset of the first
+  // |num_immutable_entries| entries.
+  void GetSkippedEntries(double can_skip_until,
+                         size_t num_immutable_entries,
+                         size_t* num_skipped_entries,
+                         size_t* num_skipped_segments) const;
+  // Drops the rendered text of the |num_removed_entries| entries removed from
+  // the front of |entries_| and prepends the rendered text of
+  // |kept_ext_x_keys|, which are added back to the front of |entries_|.
+  void UpdateRenderedEntriesAfterSlide(
+      size_t num_removed_entries,
+      const std::vector<std::unique_ptr<HlsEntry>>& kept_ext_x_keys);
 
   const HlsParams& hls_params_;
   // Mainly for MasterPlaylist to use these values.
@@ -258,13 +331,21 @@ class MediaPlaylist {
   // Whether to use byte range for SegmentInfoEntry.
   bool use_byte_range_ = false;
   std::string codec_;
+  // Bumped whenever an attribute reported in the Master Playlist changes.
+  uint64_t attributes_version_ = 0;
   std::string language_;
   std::vector<std::string> characteristics_;
   uint32_t media_sequence_number_ = 0;
+  // The number of EXT-X-GAP segments which slid out of the live window. They
+  // count in |media_sequence_number_| but have no segment file of their own.
+  uint32_t num_removed_gap_segments_ = 0;
   bool inserted_discontinuity_tag_ = false;
   int discontinuity_sequence_number_ = 0;
 
   double longest_segment_duration_seconds_ = 0.0;
+  double longest_partial_segment_duration_seconds_ = 0.0;
+  // The file name of the next partial segment for EXT-X-PRELOAD-HINT.
+  std::string next_partial_segment_file_name_;
   uint32_t time_scale_ = 0;
 
   BandwidthEstimator bandwidth_estimator_;
@@ -279,11 +360,20 @@ class MediaPlaylist {
 
   // TODO(kqyang): This could be managed better by a separate class, than having
   // all them managed in MediaPlaylist.
-  std::list<std::unique_ptr<HlsEntry>> entries_;
+  // A deque so that the entries sliding out of the live window are popped
+  // from the front in O(1).
+  std::deque<std::unique_ptr<HlsEntry>> entries_;
   double current_buffer_depth_ = 0;
   // A list to hold the file names of the segments to be removed temporarily.
   // Once a file is actually removed, it is removed from the list.
-  std::list<std::string> segments_to_be_removed_;
+  std::deque<std::string> segments_to_be_removed_;
+
+  // Rendered text of the first entries in |entries_|, which cannot be updated
+  // anymore, and the size of the rendered text of each of them.
+  std::string rendered_entries_;
+  std::deque<size_t> rendered_entry_sizes_;
+  // Reused across WriteToFile() calls to avoid reallocations.
+  std::string playlist_buffer_;
 
   // Used by kVideoIFrameOnly playlists to track the i-frames (key frames).
   struct KeyFrameInfo {
@@ -294,6 +384,11 @@ class MediaPlaylist {
   };
   std::list<KeyFrameInfo> key_frames_;
 
+  AsyncManifestWriter* async_writer_ = nullptr;
+  // Writes the playlist if |async_writer_| is not set.
+  ManifestFileWriter file_writer_;
+  media::SegmentPublicationLatencyMetric publication_latency_;
+
   DISALLOW_COPY_AND_ASSIGN(MediaPlaylist);
 };
 
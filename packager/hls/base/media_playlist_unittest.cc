@@ -10,6 +10,7 @@
 #include "packager/base/strings/stringprintf.h"
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
+#include "packager/file/file_deletion_queue.h"
 #include "packager/file/file_test_util.h"
 #include "packager/hls/base/media_playlist.h"
 #include "packager/version/version.h"
@@ -354,6 +355,34 @@ TEST_F(MediaPlaylistMultiSegmentTest,
   ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
 }
 
+TEST_F(MediaPlaylistMultiSegmentTest, WriteToFileWithDiscontinuity) {
+  valid_video_media_info_.set_reference_time_scale(90000);
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+
+  media_playlist_->AddSegment("file1.ts", 0, 10 * kTimeScale, kZeroByteOffset,
+                              kMBytes);
+  media_playlist_->AddDiscontinuity();
+  media_playlist_->AddSegment("file2.ts", 10 * kTimeScale, 30 * kTimeScale,
+                              kZeroByteOffset, 5 * kMBytes);
+  const char kExpectedOutput[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:30\n"
+      "#EXT-X-PLAYLIST-TYPE:VOD\n"
+      "#EXTINF:10.000,\n"
+      "file1.ts\n"
+      "#EXT-X-DISCONTINUITY\n"
+      "#EXTINF:30.000,\n"
+      "file2.ts\n"
+      "#EXT-X-ENDLIST\n";
+
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
+}
+
 TEST_F(MediaPlaylistMultiSegmentTest, WriteToFileWithEncryptionInfo) {
   valid_video_media_info_.set_reference_time_scale(90000);
   ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
@@ -686,6 +715,37 @@ TEST_F(LiveMediaPlaylistTest, Basic) {
   ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
 }
 
+TEST_F(LiveMediaPlaylistTest, GapSegments) {
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+  // Nothing to continue from.
+  EXPECT_EQ(0, media_playlist_->AddGapSegment());
+
+  media_playlist_->AddSegment("file1.ts", 0, 10 * kTimeScale, kZeroByteOffset,
+                              kMBytes);
+  EXPECT_EQ(10, media_playlist_->AddGapSegment());
+  // The input resumes before the end of the gap.
+  media_playlist_->AddSegment("file2.ts", 15 * kTimeScale, 5 * kTimeScale,
+                              kZeroByteOffset, kMBytes);
+  const char kExpectedOutput[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:10\n"
+      "#EXTINF:10.000,\n"
+      "file1.ts\n"
+      "#EXT-X-GAP\n"
+      "#EXTINF:10.000,\n"
+      "file1.ts\n"
+      "#EXT-X-DISCONTINUITY\n"
+      "#EXTINF:5.000,\n"
+      "file2.ts\n";
+
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
+}
+
 TEST_F(LiveMediaPlaylistTest, TimeShifted) {
   ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
 
@@ -752,6 +812,51 @@ TEST_F(LiveMediaPlaylistTest, TimeShiftedWithEncryptionInfo) {
   ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
 }
 
+TEST_F(LiveMediaPlaylistTest, RestoreCheckpointState) {
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+  media_playlist_->AddSegment("file1.ts", 0, 10 * kTimeScale, kZeroByteOffset,
+                              kMBytes);
+  media_playlist_->AddEncryptionInfo(
+      MediaPlaylist::EncryptionMethod::kSampleAes, "http://example.com", "",
+      "0x12345678", "com.widevine", "1/2/4");
+  media_playlist_->AddSegment("file2.ts", 10 * kTimeScale, 20 * kTimeScale,
+                              kZeroByteOffset, 2 * kMBytes);
+  media_playlist_->AddSegment("file3.ts", 30 * kTimeScale, 20 * kTimeScale,
+                              kZeroByteOffset, 2 * kMBytes);
+
+  // A playlist restarted from the checkpoint continues the same way.
+  MediaPlaylist restored_playlist(hls_params_, default_file_name_,
+                                  default_name_, default_group_id_);
+  ASSERT_TRUE(restored_playlist.SetMediaInfo(valid_video_media_info_));
+  ASSERT_TRUE(restored_playlist.RestoreCheckpointState(
+      media_playlist_->GetCheckpointState()));
+  EXPECT_EQ(media_playlist_->GetCheckpointState(),
+            restored_playlist.GetCheckpointState());
+
+  media_playlist_->AddSegment("file4.ts", 50 * kTimeScale, 20 * kTimeScale,
+                              kZeroByteOffset, 2 * kMBytes);
+  restored_playlist.AddSegment("file4.ts", 50 * kTimeScale, 20 * kTimeScale,
+                               kZeroByteOffset, 2 * kMBytes);
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  const char kRestoredMemoryFilePath[] = "memory://restored_media.m3u8";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  EXPECT_TRUE(restored_playlist.WriteToFile(kRestoredMemoryFilePath));
+  std::string expected_output;
+  ASSERT_TRUE(File::ReadFileToString(kMemoryFilePath, &expected_output));
+  ASSERT_FILE_STREQ(kRestoredMemoryFilePath, expected_output);
+}
+
+TEST_F(LiveMediaPlaylistTest, RestoreInvalidCheckpointState) {
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+  EXPECT_FALSE(media_playlist_->RestoreCheckpointState(
+      "media_sequence_number 3\nsegment 0 abc\n"));
+  // Nothing is restored.
+  EXPECT_EQ(
+      "media_sequence_number 0\ndiscontinuity_sequence_number 0\n"
+      "previous_segment_end_offset 0\nremoved_gap_segments 0\n",
+      media_playlist_->GetCheckpointState());
+}
+
 TEST_F(LiveMediaPlaylistTest, TimeShiftedWithEncryptionInfoShifted) {
   ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
 
@@ -819,6 +924,131 @@ TEST_F(LiveMediaPlaylistTest, TimeShiftedWithEncryptionInfoShifted) {
   ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
 }
 
+// Verify that writing the playlist after every segment, which reuses the
+// rendered entries, generates the same playlist as writing it once.
+TEST_F(LiveMediaPlaylistTest, TimeShiftedWrittenAfterEverySegment) {
+  MediaPlaylist reference_playlist(hls_params_, default_file_name_,
+                                   default_name_, default_group_id_);
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+  ASSERT_TRUE(reference_playlist.SetMediaInfo(valid_video_media_info_));
+
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  const char kReferenceMemoryFilePath[] = "memory://reference.m3u8";
+  const int kNumSegments = 10;
+  for (int i = 0; i < kNumSegments; ++i) {
+    const std::string iv = base::StringPrintf("0x%08d", i);
+    const std::string segment_name = base::StringPrintf("file%d.ts", i);
+    for (MediaPlaylist* playlist :
+         {media_playlist_.get(), &reference_playlist}) {
+      if (i % 3 == 0) {
+        playlist->AddEncryptionInfo(
+            MediaPlaylist::EncryptionMethod::kSampleAes, "http://example.com",
+            "", iv, "com.widevine", "1/2/4");
+      }
+      playlist->AddSegment(segment_name, i * 10 * kTimeScale, 10 * kTimeScale,
+                           kZeroByteOffset, kMBytes);
+    }
+    EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  }
+
+  EXPECT_TRUE(reference_playlist.WriteToFile(kReferenceMemoryFilePath));
+  std::string expected_output;
+  ASSERT_TRUE(
+      File::ReadFileToString(kReferenceMemoryFilePath, &expected_output));
+  ASSERT_FILE_STREQ(kMemoryFilePath, expected_output);
+}
+
+TEST_F(LiveMediaPlaylistTest, LowLatency) {
+  mutable_hls_params()->low_latency_mode = true;
+  mutable_hls_params()->target_part_duration = 1;
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+
+  const int kNumSegments = 4;
+  for (int i = 1; i <= kNumSegments; ++i) {
+    const std::string segment_name = base::StringPrintf("file%d.mp4", i);
+    media_playlist_->AddPartialSegment(
+        base::StringPrintf("file%d.part0.mp4", i), kTimeScale, true,
+        base::StringPrintf("file%d.part1.mp4", i));
+    media_playlist_->AddPartialSegment(
+        base::StringPrintf("file%d.part1.mp4", i), kTimeScale, false,
+        base::StringPrintf("file%d.part0.mp4", i + 1));
+    media_playlist_->AddSegment(segment_name, (i - 1) * 2 * kTimeScale,
+                                2 * kTimeScale, kZeroByteOffset, kMBytes);
+  }
+  media_playlist_->AddPartialSegment("file5.part0.mp4", kTimeScale, true,
+                                     "file5.part1.mp4");
+
+  // Only the partial segments within three target durations from the end of
+  // the playlist are listed.
+  const char kExpectedOutput[] =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=3.000\n"
+      "#EXT-X-PART-INF:PART-TARGET=1.000\n"
+      "#EXTINF:2.000,\n"
+      "file1.mp4\n"
+      "#EXTINF:2.000,\n"
+      "file2.mp4\n"
+      "#EXT-X-PART:DURATION=1.000,URI=\"file3.part0.mp4\",INDEPENDENT=YES\n"
+      "#EXT-X-PART:DURATION=1.000,URI=\"file3.part1.mp4\"\n"
+      "#EXTINF:2.000,\n"
+      "file3.mp4\n"
+      "#EXT-X-PART:DURATION=1.000,URI=\"file4.part0.mp4\",INDEPENDENT=YES\n"
+      "#EXT-X-PART:DURATION=1.000,URI=\"file4.part1.mp4\"\n"
+      "#EXTINF:2.000,\n"
+      "file4.mp4\n"
+      "#EXT-X-PART:DURATION=1.000,URI=\"file5.part0.mp4\",INDEPENDENT=YES\n"
+      "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"file5.part1.mp4\"\n";
+
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
+}
+
+// Verify that the partial segments do not break the reuse of the rendered
+// entries.
+TEST_F(LiveMediaPlaylistTest, LowLatencyWrittenAfterEveryPartialSegment) {
+  mutable_hls_params()->low_latency_mode = true;
+  mutable_hls_params()->target_part_duration = 1;
+  MediaPlaylist reference_playlist(hls_params_, default_file_name_,
+                                   default_name_, default_group_id_);
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+  ASSERT_TRUE(reference_playlist.SetMediaInfo(valid_video_media_info_));
+  media_playlist_->SetTargetDuration(2);
+  reference_playlist.SetTargetDuration(2);
+
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  const char kReferenceMemoryFilePath[] = "memory://reference.m3u8";
+  const int kNumSegments = 20;
+  for (int i = 0; i < kNumSegments; ++i) {
+    for (int part = 0; part < 2; ++part) {
+      for (MediaPlaylist* playlist :
+           {media_playlist_.get(), &reference_playlist}) {
+        playlist->AddPartialSegment(
+            base::StringPrintf("file%d.part%d.mp4", i, part), kTimeScale,
+            part == 0, "next.mp4");
+      }
+      EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+    }
+    for (MediaPlaylist* playlist :
+         {media_playlist_.get(), &reference_playlist}) {
+      playlist->AddSegment(base::StringPrintf("file%d.mp4", i),
+                           i * 2 * kTimeScale, 2 * kTimeScale, kZeroByteOffset,
+                           kMBytes);
+    }
+    EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  }
+
+  EXPECT_TRUE(reference_playlist.WriteToFile(kReferenceMemoryFilePath));
+  std::string expected_output;
+  ASSERT_TRUE(
+      File::ReadFileToString(kReferenceMemoryFilePath, &expected_output));
+  ASSERT_FILE_STREQ(kMemoryFilePath, expected_output);
+}
+
 class EventMediaPlaylistTest : public MediaPlaylistMultiSegmentTest {
  protected:
   EventMediaPlaylistTest()
@@ -849,6 +1079,55 @@ TEST_F(EventMediaPlaylistTest, Basic) {
   ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
 }
 
+TEST_F(EventMediaPlaylistTest, DeltaUpdate) {
+  // Raised to six target durations, i.e. 12 seconds.
+  mutable_hls_params()->delta_update_skip_until = 1;
+  ASSERT_TRUE(media_playlist_->SetMediaInfo(valid_video_media_info_));
+
+  const int kNumSegments = 8;
+  for (int i = 0; i < kNumSegments; ++i) {
+    media_playlist_->AddSegment(base::StringPrintf("file%d.ts", i + 1),
+                                i * 2 * kTimeScale, 2 * kTimeScale,
+                                kZeroByteOffset, kMBytes);
+  }
+
+  // The segments ending at least 12 seconds before the end are skipped.
+  const int kNumSkippedSegments = 2;
+  std::string expected_skipped_segments;
+  std::string expected_segments_after_skip;
+  for (int i = 0; i < kNumSegments; ++i) {
+    base::StringAppendF(i < kNumSkippedSegments
+                            ? &expected_skipped_segments
+                            : &expected_segments_after_skip,
+                        "#EXTINF:2.000,\nfile%d.ts\n", i + 1);
+  }
+  const std::string kExpectedOutput =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:6\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-PLAYLIST-TYPE:EVENT\n"
+      "#EXT-X-SERVER-CONTROL:CAN-SKIP-UNTIL=12.000\n" +
+      expected_skipped_segments + expected_segments_after_skip;
+  const std::string kExpectedDeltaOutput =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:9\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-PLAYLIST-TYPE:EVENT\n"
+      "#EXT-X-SERVER-CONTROL:CAN-SKIP-UNTIL=12.000\n"
+      "#EXT-X-SKIP:SKIPPED-SEGMENTS=2\n" +
+      expected_segments_after_skip;
+
+  const char kMemoryFilePath[] = "memory://media.m3u8";
+  const char kMemoryDeltaFilePath[] = "memory://media_delta.m3u8";
+  EXPECT_TRUE(media_playlist_->WriteToFile(kMemoryFilePath));
+  ASSERT_FILE_STREQ(kMemoryFilePath, kExpectedOutput);
+  ASSERT_FILE_STREQ(kMemoryDeltaFilePath, kExpectedDeltaOutput);
+}
+
 class IFrameMediaPlaylistTest : public MediaPlaylistTest {};
 
 TEST_F(IFrameMediaPlaylistTest, MediaPlaylistType) {
@@ -1037,6 +1316,7 @@ class MediaPlaylistDeleteSegmentsTest
   }
 
   bool SegmentDeleted(const std::string& segment_name) {
+    FileDeletionQueue::GetInstance()->Flush();
     std::unique_ptr<File, FileCloser> file_closer(
         File::Open(segment_name.c_str(), "r"));
     return file_closer.get() == nullptr;
@@ -1080,6 +1360,24 @@ TEST_P(MediaPlaylistDeleteSegmentsTest, ManySegments) {
   EXPECT_TRUE(SegmentDeleted(GetSegmentName(last_available_segment_index - 1)));
 }
 
+// Gap segments have no file of their own. The segment resuming after a gap
+// starts at the time of the gap here, so a file deleted for the gap would be
+// the one of that segment.
+TEST_P(MediaPlaylistDeleteSegmentsTest, GapSegmentsNotDeleted) {
+  media_playlist_->AddSegment(kIgnoredSegmentName, GetTime(0), kDuration,
+                              kZeroByteOffset, kMBytes);
+  EXPECT_EQ(1, media_playlist_->AddGapSegment());
+  // The first segment, the gap and three more segments slide out of the live
+  // window. Only the files of the other segments are preserved, so just the
+  // first one is deleted.
+  for (int i = 1; i <= kMaxNumSegmentsAvailable; ++i) {
+    media_playlist_->AddSegment(kIgnoredSegmentName, GetTime(i), kDuration,
+                                kZeroByteOffset, kMBytes);
+  }
+  EXPECT_TRUE(SegmentDeleted(GetSegmentName(0)));
+  EXPECT_FALSE(SegmentDeleted(GetSegmentName(1)));
+}
+
 INSTANTIATE_TEST_CASE_P(
     TimeOrNumber,
     MediaPlaylistDeleteSegmentsTest,
@@ -30,6 +30,11 @@ class MockMediaPlaylist : public MediaPlaylist {
                     int64_t duration,
                     uint64_t start_byte_offset,
                     uint64_t size));
+  MOCK_METHOD4(AddPartialSegment,
+               void(const std::string& file_name,
+                    int64_t duration,
+                    bool independent,
+                    const std::string& next_file_name));
   MOCK_METHOD3(AddKeyFrame,
                void(int64_t timestamp,
                     uint64_t start_byte_offset,
@@ -42,6 +47,10 @@ class MockMediaPlaylist : public MediaPlaylist {
                     const std::string& key_format,
                     const std::string& key_format_versions));
   MOCK_METHOD0(AddPlacementOpportunity, void());
+  MOCK_METHOD0(AddDiscontinuity, void());
+  MOCK_METHOD0(AddGapSegment, double());
+  MOCK_METHOD0(GetCheckpointState, std::string());
+  MOCK_METHOD1(RestoreCheckpointState, bool(const std::string& state));
   MOCK_METHOD1(WriteToFile, bool(const std::string& file_path));
   MOCK_CONST_METHOD0(MaxBitrate, uint64_t());
   MOCK_CONST_METHOD0(AvgBitrate, uint64_t());
@@ -7,15 +7,20 @@
 #include "packager/hls/base/simple_hls_notifier.h"
 
 #include <gflags/gflags.h>
+#include <string.h>
 #include <cmath>
 
 #include "packager/base/base64.h"
+#include "packager/base/bind.h"
 #include "packager/base/files/file_path.h"
 #include "packager/base/logging.h"
 #include "packager/base/optional.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/base/trace_event/trace_event.h"
+#include "packager/file/file.h"
 #include "packager/hls/base/media_playlist.h"
+#include "packager/media/base/closure_thread.h"
 #include "packager/media/base/protection_system_ids.h"
 #include "packager/media/base/protection_system_specific_info.h"
 #include "packager/media/base/proto_json_util.h"
@@ -80,7 +85,13 @@ std::string VectorToString(const std::vector<uint8_t>& v) {
 std::string MakePathRelative(const std::string& media_path,
                              const FilePath& parent_path) {
   FilePath relative_path;
-  const FilePath child_path = FilePath::FromUTF8Unsafe(media_path);
+  // Outputs written with direct I/O are referred to by their path.
+  const size_t prefix_size =
+      media_path.compare(0, strlen(kDirectFilePrefix), kDirectFilePrefix) == 0
+          ? strlen(kDirectFilePrefix)
+          : 0;
+  const FilePath child_path =
+      FilePath::FromUTF8Unsafe(media_path.substr(prefix_size));
   const bool is_child =
       parent_path.AppendRelativePath(child_path, &relative_path);
   if (!is_child)
@@ -279,7 +290,10 @@ std::unique_ptr<MediaPlaylist> MediaPlaylistFactory::Create(
 
 SimpleHlsNotifier::SimpleHlsNotifier(const HlsParams& hls_params)
     : HlsNotifier(hls_params),
-      media_playlist_factory_(new MediaPlaylistFactory()) {
+      media_playlist_factory_(new MediaPlaylistFactory()),
+      write_coalescer_(hls_params.manifest_write_coalescing_window),
+      stop_gap_watchdog_(base::WaitableEvent::ResetPolicy::MANUAL,
+                         base::WaitableEvent::InitialState::NOT_SIGNALED) {
   const base::FilePath master_playlist_path(
       base::FilePath::FromUTF8Unsafe(hls_params.master_playlist_output));
   master_playlist_dir_ = master_playlist_path.DirName().AsUTF8Unsafe();
@@ -292,11 +306,29 @@ SimpleHlsNotifier::SimpleHlsNotifier(const HlsParams& hls_params)
       new MasterPlaylist(master_playlist_path.BaseName().AsUTF8Unsafe(),
                          default_audio_langauge, default_text_language, 
                          hls_params.is_independent_segments));
+  if (hls_params.async_manifest_writes) {
+    manifest_writer_.reset(new AsyncManifestWriter());
+    master_playlist_->set_async_writer(manifest_writer_.get());
+  }
 }
 
-SimpleHlsNotifier::~SimpleHlsNotifier() {}
+SimpleHlsNotifier::~SimpleHlsNotifier() {
+  if (gap_watchdog_thread_) {
+    stop_gap_watchdog_.Signal();
+    // ClosureThread joins on destruction.
+    gap_watchdog_thread_.reset();
+  }
+}
 
 bool SimpleHlsNotifier::Init() {
+  if (hls_params().gap_timeout > 0 &&
+      hls_params().playlist_type != HlsPlaylistType::kVod &&
+      !gap_watchdog_thread_) {
+    gap_watchdog_thread_.reset(new media::ClosureThread(
+        "HlsGapWatchdog", base::Bind(&SimpleHlsNotifier::GapWatchdogMain,
+                                     base::Unretained(this))));
+    gap_watchdog_thread_->Start();
+  }
   return true;
 }
 
@@ -313,6 +345,7 @@ bool SimpleHlsNotifier::NotifyNewStream(const MediaInfo& media_info,
   std::unique_ptr<MediaPlaylist> media_playlist =
       media_playlist_factory_->Create(hls_params(), relative_playlist_path,
                                       name, group_id);
+  media_playlist->set_async_writer(manifest_writer_.get());
   MediaInfo adjusted_media_info = MakeMediaInfoPathsRelativeToPlaylist(
       media_info, hls_params().base_url, master_playlist_dir_,
       media_playlist->file_name());
@@ -320,6 +353,21 @@ bool SimpleHlsNotifier::NotifyNewStream(const MediaInfo& media_info,
     LOG(ERROR) << "Failed to set media info for playlist " << playlist_name;
     return false;
   }
+  // The longest duration of the segments restored from the checkpoint.
+  uint32_t longest_segment_duration = 0;
+  if (checkpoint_) {
+    const std::string state =
+        checkpoint_->GetState(CheckpointKey(*media_playlist));
+    if (!state.empty()) {
+      if (media_playlist->RestoreCheckpointState(state)) {
+        longest_segment_duration = static_cast<uint32_t>(
+            ceil(media_playlist->GetLongestSegmentDuration()));
+      } else {
+        LOG(WARNING) << "Failed to restore playlist " << playlist_name
+                     << " from the checkpoint. Starting it over.";
+      }
+    }
+  }
 
   MediaPlaylist::EncryptionMethod encryption_method =
       MediaPlaylist::EncryptionMethod::kNone;
@@ -336,23 +384,31 @@ bool SimpleHlsNotifier::NotifyNewStream(const MediaInfo& media_info,
     encryption_method = enc_method.value();
   }
 
-  base::AutoLock auto_lock(lock_);
+  base::subtle::AutoWriteLock write_lock(lock_);
   *stream_id = sequence_number_++;
   media_playlists_.push_back(media_playlist.get());
-  stream_map_[*stream_id].reset(
-      new StreamEntry{std::move(media_playlist), encryption_method});
+  StreamEntry* entry = new StreamEntry;
+  entry->media_playlist = std::move(media_playlist);
+  entry->encryption_method = encryption_method;
+  stream_map_[*stream_id].reset(entry);
+  base::AutoLock state_lock(state_lock_);
+  write_coalescer_.AddStream(*stream_id);
+  // The restored segments may be longer than the ones of the other streams.
+  if (longest_segment_duration > target_duration_) {
+    target_duration_ = longest_segment_duration;
+    target_duration_updated_ = true;
+  }
   return true;
 }
 
 bool SimpleHlsNotifier::NotifySampleDuration(uint32_t stream_id,
                                              uint32_t sample_duration) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  base::subtle::AutoReadLock read_lock(lock_);
+  StreamEntry* entry = GetStreamEntry(stream_id);
+  if (!entry)
     return false;
-  }
-  auto& media_playlist = stream_iterator->second->media_playlist;
+  base::AutoLock stream_lock(entry->lock);
+  auto& media_playlist = entry->media_playlist;
   media_playlist->SetSampleDuration(sample_duration);
   return true;
 }
@@ -363,95 +419,165 @@ bool SimpleHlsNotifier::NotifyNewSegment(uint32_t stream_id,
                                          uint64_t duration,
                                          uint64_t start_byte_offset,
                                          uint64_t size) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
-    return false;
+  uint32_t longest_segment_duration = 0;
+  {
+    base::subtle::AutoReadLock read_lock(lock_);
+    StreamEntry* entry = GetStreamEntry(stream_id);
+    if (!entry)
+      return false;
+    base::AutoLock stream_lock(entry->lock);
+    auto& media_playlist = entry->media_playlist;
+    const std::string& segment_url =
+        GenerateSegmentUrl(segment_name, hls_params().base_url,
+                           master_playlist_dir_, media_playlist->file_name());
+    media_playlist->AddSegment(segment_url, start_time, duration,
+                               start_byte_offset, size);
+    if (hls_params().gap_timeout > 0) {
+      entry->last_segment_time = base::TimeTicks::Now();
+      entry->gap_duration_seconds = 0;
+    }
+    longest_segment_duration = static_cast<uint32_t>(
+        ceil(media_playlist->GetLongestSegmentDuration()));
+    if (checkpoint_) {
+      checkpoint_->SetState(CheckpointKey(*media_playlist),
+                            media_playlist->GetCheckpointState());
+    }
   }
-  auto& media_playlist = stream_iterator->second->media_playlist;
-  const std::string& segment_url =
-      GenerateSegmentUrl(segment_name, hls_params().base_url,
-                         master_playlist_dir_, media_playlist->file_name());
-  media_playlist->AddSegment(segment_url, start_time, duration,
-                             start_byte_offset, size);
 
-  // Update target duration.
-  uint32_t longest_segment_duration =
-      static_cast<uint32_t>(ceil(media_playlist->GetLongestSegmentDuration()));
-  bool target_duration_updated = false;
-  if (longest_segment_duration > target_duration_) {
-    target_duration_ = longest_segment_duration;
-    target_duration_updated = true;
-  }
-
-  // Update the playlists when there is new segments in live mode.
-  if (hls_params().playlist_type == HlsPlaylistType::kLive ||
-      hls_params().playlist_type == HlsPlaylistType::kEvent) {
-    // Update all playlists if target duration is updated.
-    if (target_duration_updated) {
-      for (MediaPlaylist* playlist : media_playlists_) {
-        playlist->SetTargetDuration(target_duration_);
-        if (!WriteMediaPlaylist(master_playlist_dir_, playlist))
-          return false;
-      }
-    } else {
-      if (!WriteMediaPlaylist(master_playlist_dir_, media_playlist.get()))
+  {
+    base::AutoLock state_lock(state_lock_);
+    // Update target duration.
+    if (longest_segment_duration > target_duration_) {
+      target_duration_ = longest_segment_duration;
+      target_duration_updated_ = true;
+    }
+    if (hls_params().playlist_type == HlsPlaylistType::kVod ||
+        !write_coalescer_.OnStreamUpdated(stream_id)) {
+      return true;
+    }
+  }
+
+  // Update the playlists when there is new segments in live mode. The
+  // playlists are written from the latest state, so it does not matter if
+  // another update is written in between.
+  base::subtle::AutoWriteLock write_lock(lock_);
+  base::AutoLock state_lock(state_lock_);
+  // Update all playlists if target duration is updated.
+  if (target_duration_updated_) {
+    for (MediaPlaylist* playlist : media_playlists_) {
+      playlist->SetTargetDuration(target_duration_);
+      if (!WriteMediaPlaylist(master_playlist_dir_, playlist))
         return false;
     }
-    if (!master_playlist_->WriteMasterPlaylist(
-            hls_params().base_url, master_playlist_dir_, media_playlists_)) {
-      LOG(ERROR) << "Failed to write master playlist.";
-      return false;
+  } else {
+    for (uint32_t updated_stream_id : write_coalescer_.updated_streams()) {
+      MediaPlaylist* playlist =
+          stream_map_[updated_stream_id]->media_playlist.get();
+      if (!WriteMediaPlaylist(master_playlist_dir_, playlist))
+        return false;
     }
   }
-  return true;
+  target_duration_updated_ = false;
+  write_coalescer_.OnManifestWritten();
+  if (!master_playlist_->WriteMasterPlaylist(
+          hls_params().base_url, master_playlist_dir_, media_playlists_)) {
+    LOG(ERROR) << "Failed to write master playlist.";
+    return false;
+  }
+  // The checkpoint is saved once the playlists it resumes are written.
+  return !checkpoint_ || checkpoint_->MaybeWrite();
+}
+
+bool SimpleHlsNotifier::NotifyNewPartialSegment(
+    uint32_t stream_id,
+    const std::string& partial_segment_name,
+    uint64_t start_time,
+    uint64_t duration,
+    uint64_t size,
+    bool independent,
+    const std::string& next_partial_segment_name) {
+  base::subtle::AutoReadLock read_lock(lock_);
+  StreamEntry* entry = GetStreamEntry(stream_id);
+  if (!entry)
+    return false;
+  base::AutoLock stream_lock(entry->lock);
+  auto& media_playlist = entry->media_playlist;
+  const std::string partial_segment_url =
+      GenerateSegmentUrl(partial_segment_name, hls_params().base_url,
+                         master_playlist_dir_, media_playlist->file_name());
+  const std::string next_partial_segment_url =
+      GenerateSegmentUrl(next_partial_segment_name, hls_params().base_url,
+                         master_playlist_dir_, media_playlist->file_name());
+  media_playlist->AddPartialSegment(partial_segment_url, duration, independent,
+                                    next_partial_segment_url);
+
+  uint32_t target_duration = 0;
+  {
+    base::AutoLock state_lock(state_lock_);
+    target_duration = target_duration_;
+  }
+  // The target duration is not known until the first segment is added.
+  if (hls_params().playlist_type == HlsPlaylistType::kVod ||
+      target_duration == 0) {
+    return true;
+  }
+  // Partial segments are published right away, i.e. they are not coalesced
+  // with the updates of the other streams, which would defeat their purpose.
+  // The master playlist does not change.
+  media_playlist->SetTargetDuration(target_duration);
+  return WriteMediaPlaylist(master_playlist_dir_, media_playlist.get());
 }
 
 bool SimpleHlsNotifier::NotifyKeyFrame(uint32_t stream_id,
                                        uint64_t timestamp,
                                        uint64_t start_byte_offset,
                                        uint64_t size) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  base::subtle::AutoReadLock read_lock(lock_);
+  StreamEntry* entry = GetStreamEntry(stream_id);
+  if (!entry)
     return false;
-  }
-  auto& media_playlist = stream_iterator->second->media_playlist;
+  base::AutoLock stream_lock(entry->lock);
+  auto& media_playlist = entry->media_playlist;
   media_playlist->AddKeyFrame(timestamp, start_byte_offset, size);
   return true;
 }
 
 bool SimpleHlsNotifier::NotifyCueEvent(uint32_t stream_id, uint64_t timestamp) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  base::subtle::AutoReadLock read_lock(lock_);
+  StreamEntry* entry = GetStreamEntry(stream_id);
+  if (!entry)
     return false;
-  }
-  auto& media_playlist = stream_iterator->second->media_playlist;
+  base::AutoLock stream_lock(entry->lock);
+  auto& media_playlist = entry->media_playlist;
   media_playlist->AddPlacementOpportunity();
   return true;
 }
 
+bool SimpleHlsNotifier::NotifyDiscontinuity(uint32_t stream_id) {
+  base::subtle::AutoReadLock read_lock(lock_);
+  StreamEntry* entry = GetStreamEntry(stream_id);
+  if (!entry)
+    return false;
+  base::AutoLock stream_lock(entry->lock);
+  entry->media_playlist->AddDiscontinuity();
+  return true;
+}
+
 bool SimpleHlsNotifier::NotifyEncryptionUpdate(
     uint32_t stream_id,
     const std::vector<uint8_t>& key_id,
     const std::vector<uint8_t>& system_id,
     const std::vector<uint8_t>& iv,
     const std::vector<uint8_t>& protection_system_specific_data) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  base::subtle::AutoReadLock read_lock(lock_);
+  StreamEntry* entry = GetStreamEntry(stream_id);
+  if (!entry)
     return false;
-  }
+  base::AutoLock stream_lock(entry->lock);
 
-  std::unique_ptr<MediaPlaylist>& media_playlist =
-      stream_iterator->second->media_playlist;
+  std::unique_ptr<MediaPlaylist>& media_playlist = entry->media_playlist;
   const MediaPlaylist::EncryptionMethod encryption_method =
-      stream_iterator->second->encryption_method;
+      entry->encryption_method;
   LOG_IF(WARNING, encryption_method == MediaPlaylist::EncryptionMethod::kNone)
       << "Got encryption notification but the encryption method is NONE";
   if (IsWidevineSystemId(system_id)) {
@@ -498,7 +624,11 @@ bool SimpleHlsNotifier::NotifyEncryptionUpdate(
 }
 
 bool SimpleHlsNotifier::Flush() {
-  base::AutoLock auto_lock(lock_);
+  TRACE_EVENT0("shaka", "SimpleHlsNotifier::Flush");
+  base::subtle::AutoWriteLock write_lock(lock_);
+  base::AutoLock state_lock(state_lock_);
+  target_duration_updated_ = false;
+  write_coalescer_.OnManifestWritten();
   for (MediaPlaylist* playlist : media_playlists_) {
     playlist->SetTargetDuration(target_duration_);
     if (!WriteMediaPlaylist(master_playlist_dir_, playlist))
@@ -509,8 +639,83 @@ bool SimpleHlsNotifier::Flush() {
     LOG(ERROR) << "Failed to write master playlist.";
     return false;
   }
+  if (checkpoint_ && !checkpoint_->Write())
+    return false;
+  return !manifest_writer_ || manifest_writer_->Flush();
+}
+
+void SimpleHlsNotifier::GapWatchdogMain() {
+  const base::TimeDelta interval = base::TimeDelta::FromMicroseconds(
+      static_cast<int64_t>(hls_params().gap_timeout *
+                           base::Time::kMicrosecondsPerSecond / 2));
+  while (!stop_gap_watchdog_.TimedWait(interval)) {
+    if (!FillGaps(base::TimeTicks::Now()))
+      LOG(ERROR) << "Failed to write the playlists with gap segments.";
+  }
+}
+
+bool SimpleHlsNotifier::FillGaps(base::TimeTicks now) {
+  const double gap_timeout = hls_params().gap_timeout;
+  base::subtle::AutoWriteLock write_lock(lock_);
+  std::vector<MediaPlaylist*> updated_playlists;
+  for (auto& stream : stream_map_) {
+    StreamEntry* entry = stream.second.get();
+    if (entry->last_segment_time.is_null())
+      continue;
+    const double stalled_seconds =
+        (now - entry->last_segment_time).InSecondsF();
+    if (stalled_seconds < gap_timeout)
+      continue;
+    // The gaps follow the wall clock, so the playlist moves at the pace of
+    // the streams which are not stalled.
+    bool updated = false;
+    while (entry->gap_duration_seconds < stalled_seconds) {
+      const double gap_duration_seconds =
+          entry->media_playlist->AddGapSegment();
+      if (gap_duration_seconds <= 0)
+        break;
+      entry->gap_duration_seconds += gap_duration_seconds;
+      updated = true;
+    }
+    if (!updated)
+      continue;
+    LOG(WARNING) << "No new segment for " << stalled_seconds
+                 << " seconds in playlist "
+                 << entry->media_playlist->file_name()
+                 << ". Gap segments are added up to "
+                 << entry->gap_duration_seconds << " seconds.";
+    updated_playlists.push_back(entry->media_playlist.get());
+  }
+  if (updated_playlists.empty())
+    return true;
+
+  base::AutoLock state_lock(state_lock_);
+  for (MediaPlaylist* playlist : updated_playlists) {
+    playlist->SetTargetDuration(target_duration_);
+    if (!WriteMediaPlaylist(master_playlist_dir_, playlist))
+      return false;
+  }
+  if (!master_playlist_->WriteMasterPlaylist(
+          hls_params().base_url, master_playlist_dir_, media_playlists_)) {
+    LOG(ERROR) << "Failed to write master playlist.";
+    return false;
+  }
   return true;
 }
 
+std::string SimpleHlsNotifier::CheckpointKey(const MediaPlaylist& playlist) {
+  return "hls:" + playlist.file_name();
+}
+
+SimpleHlsNotifier::StreamEntry* SimpleHlsNotifier::GetStreamEntry(
+    uint32_t stream_id) {
+  auto stream_iterator = stream_map_.find(stream_id);
+  if (stream_iterator == stream_map_.end()) {
+    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+    return nullptr;
+  }
+  return stream_iterator->second.get();
+}
+
 }  // namespace hls
 }  // namespace shaka
@@ -15,12 +15,23 @@
 
 #include "packager/base/macros.h"
 #include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/read_write_lock.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/time/time.h"
 #include "packager/hls/base/hls_notifier.h"
 #include "packager/hls/base/master_playlist.h"
 #include "packager/hls/base/media_playlist.h"
 #include "packager/hls/public/hls_params.h"
+#include "packager/mpd/base/async_manifest_writer.h"
+#include "packager/mpd/base/manifest_checkpoint.h"
+#include "packager/mpd/base/manifest_write_coalescer.h"
 
 namespace shaka {
+
+namespace media {
+class ClosureThread;
+}  // namespace media
+
 namespace hls {
 
 /// For testing.
@@ -57,11 +68,20 @@ class SimpleHlsNotifier : public HlsNotifier {
                         uint64_t duration,
                         uint64_t start_byte_offset,
                         uint64_t size) override;
+  bool NotifyNewPartialSegment(
+      uint32_t stream_id,
+      const std::string& partial_segment_name,
+      uint64_t start_time,
+      uint64_t duration,
+      uint64_t size,
+      bool independent,
+      const std::string& next_partial_segment_name) override;
   bool NotifyKeyFrame(uint32_t stream_id,
                       uint64_t timestamp,
                       uint64_t start_byte_offset,
                       uint64_t size) override;
   bool NotifyCueEvent(uint32_t container_id, uint64_t timestamp) override;
+  bool NotifyDiscontinuity(uint32_t stream_id) override;
   bool NotifyEncryptionUpdate(
       uint32_t stream_id,
       const std::vector<uint8_t>& key_id,
@@ -71,17 +91,53 @@ class SimpleHlsNotifier : public HlsNotifier {
   bool Flush() override;
   /// }@
 
+  /// Sets the checkpoint which the playlists are restored from when the
+  /// streams are added, and saved to when they are updated. Must be called
+  /// before Init().
+  /// @param checkpoint is not owned and must outlive the notifier.
+  void set_checkpoint(ManifestCheckpoint* checkpoint) {
+    checkpoint_ = checkpoint;
+  }
+
  private:
   friend class SimpleHlsNotifierTest;
 
   struct StreamEntry {
     std::unique_ptr<MediaPlaylist> media_playlist;
     MediaPlaylist::EncryptionMethod encryption_method;
+    // When the last segment was added, or null if there is none yet.
+    base::TimeTicks last_segment_time;
+    // Duration of the gap segments added since the last segment.
+    double gap_duration_seconds = 0;
+    // Guards |media_playlist| while |lock_| is held shared.
+    base::Lock lock;
   };
 
+  // Checks the streams for stalls every half gap timeout until
+  // |stop_gap_watchdog_| is signaled.
+  void GapWatchdogMain();
+  // Adds gap segments to the playlists of the streams without new segments for
+  // longer than the gap timeout, to cover the wall clock time since their last
+  // segment, and writes the updated playlists.
+  bool FillGaps(base::TimeTicks now);
+
+  // Returns the checkpoint key of |playlist|.
+  static std::string CheckpointKey(const MediaPlaylist& playlist);
+
+  // Returns the entry of |stream_id|, or nullptr if there is no such stream.
+  // Entries are never removed. |lock_| must be held.
+  StreamEntry* GetStreamEntry(uint32_t stream_id);
+
   std::string master_playlist_dir_;
+  // Guarded by |state_lock_|.
   uint32_t target_duration_ = 0;
+  // Whether |target_duration_| is updated since the playlists were written.
+  // Guarded by |state_lock_|.
+  bool target_duration_updated_ = false;
 
+  // Only set if the playlists are written asynchronously. It outlives the
+  // playlists which write through it.
+  std::unique_ptr<AsyncManifestWriter> manifest_writer_;
   std::unique_ptr<MediaPlaylistFactory> media_playlist_factory_;
   std::unique_ptr<MasterPlaylist> master_playlist_;
 
@@ -91,7 +147,23 @@ class SimpleHlsNotifier : public HlsNotifier {
 
   uint32_t sequence_number_ = 0;
 
-  base::Lock lock_;
+  // Guarded by |state_lock_|.
+  ManifestWriteCoalescer write_coalescer_;
+
+  // Updates of a single stream hold |lock_| shared, together with the lock of
+  // the stream, so that streams are updated concurrently. Adding streams and
+  // writing the playlists of all streams hold |lock_| exclusively.
+  base::subtle::ReadWriteLock lock_;
+  // Guards the state shared by the streams. Acquired after |lock_| and the
+  // stream locks if they are held.
+  base::Lock state_lock_;
+
+  // Not owned. Only set to resume from and to save checkpoints.
+  ManifestCheckpoint* checkpoint_ = nullptr;
+
+  // Only set for LIVE and EVENT playlists with a gap timeout.
+  base::WaitableEvent stop_gap_watchdog_;
+  std::unique_ptr<media::ClosureThread> gap_watchdog_thread_;
 
   DISALLOW_COPY_AND_ASSIGN(SimpleHlsNotifier);
 };
@@ -8,10 +8,13 @@
 #include <gtest/gtest.h>
 
 #include <gflags/gflags.h>
+#include <functional>
 #include <memory>
 
 #include "packager/base/base64.h"
 #include "packager/base/files/file_path.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/threading/simple_thread.h"
 #include "packager/hls/base/mock_media_playlist.h"
 #include "packager/hls/base/simple_hls_notifier.h"
 #include "packager/media/base/protection_system_ids.h"
@@ -27,6 +30,7 @@ using ::testing::_;
 using ::testing::ElementsAre;
 using ::testing::Eq;
 using ::testing::InSequence;
+using ::testing::Invoke;
 using ::testing::Mock;
 using ::testing::Property;
 using ::testing::Return;
@@ -86,6 +90,25 @@ const uint64_t kAnySize = 2000;
 const char kCencProtectionScheme[] = "cenc";
 const char kSampleAesProtectionScheme[] = "cbca";
 
+// Long enough for a blocked notification to be considered deadlocked.
+const int64_t kTimeoutInSeconds = 10;
+
+// Runs |task| on a new thread, joined on destruction.
+class TaskThread : public base::SimpleThread {
+ public:
+  explicit TaskThread(std::function<void()> task)
+      : base::SimpleThread("TaskThread"), task_(std::move(task)) {
+    Start();
+  }
+
+  ~TaskThread() override { Join(); }
+
+  void Run() override { task_(); }
+
+ private:
+  const std::function<void()> task_;
+};
+
 }  // namespace
 
 class SimpleHlsNotifierTest : public ::testing::Test {
@@ -121,6 +144,10 @@ class SimpleHlsNotifierTest : public ::testing::Test {
     return notifier.stream_map_.size();
   }
 
+  bool FillGaps(base::TimeTicks now, SimpleHlsNotifier* notifier) {
+    return notifier->FillGaps(now);
+  }
+
   uint32_t SetupStream(const std::string& protection_scheme,
                        MockMediaPlaylist* mock_media_playlist,
                        SimpleHlsNotifier* notifier) {
@@ -253,6 +280,77 @@ TEST_F(SimpleHlsNotifierTest, NotifyNewSegment) {
   EXPECT_TRUE(notifier.Flush());
 }
 
+// Verify that different streams are updated concurrently: the update of the
+// first stream blocks until the second stream is updated.
+TEST_F(SimpleHlsNotifierTest, NotifyNewSegmentConcurrently) {
+  std::unique_ptr<MockMasterPlaylist> mock_master_playlist(
+      new MockMasterPlaylist());
+  std::unique_ptr<MockMediaPlaylistFactory> factory(
+      new MockMediaPlaylistFactory());
+
+  // Pointers released by SimpleHlsNotifier.
+  MockMediaPlaylist* mock_media_playlist1 =
+      new MockMediaPlaylist("playlist1.m3u8", "", "");
+  MockMediaPlaylist* mock_media_playlist2 =
+      new MockMediaPlaylist("playlist2.m3u8", "", "");
+
+  EXPECT_CALL(*factory, CreateMock(_, StrEq("playlist1.m3u8"), _, _))
+      .WillOnce(Return(mock_media_playlist1));
+  EXPECT_CALL(*mock_media_playlist1, SetMediaInfo(_)).WillOnce(Return(true));
+  EXPECT_CALL(*factory, CreateMock(_, StrEq("playlist2.m3u8"), _, _))
+      .WillOnce(Return(mock_media_playlist2));
+  EXPECT_CALL(*mock_media_playlist2, SetMediaInfo(_)).WillOnce(Return(true));
+
+  SimpleHlsNotifier notifier(hls_params_);
+  InjectMasterPlaylist(std::move(mock_master_playlist), &notifier);
+  InjectMediaPlaylistFactory(std::move(factory), &notifier);
+  EXPECT_TRUE(notifier.Init());
+
+  MediaInfo media_info;
+  uint32_t stream_id1;
+  ASSERT_TRUE(notifier.NotifyNewStream(media_info, "playlist1.m3u8", "name",
+                                       "groupid", &stream_id1));
+  uint32_t stream_id2;
+  ASSERT_TRUE(notifier.NotifyNewStream(media_info, "playlist2.m3u8", "name",
+                                       "groupid", &stream_id2));
+
+  base::WaitableEvent first_update_started(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  base::WaitableEvent second_update_done(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  bool second_update_done_first = false;
+
+  EXPECT_CALL(*mock_media_playlist1, AddSegment(_, _, _, _, _))
+      .WillOnce(Invoke([&](const std::string&, int64_t, int64_t, uint64_t,
+                           uint64_t) {
+        first_update_started.Signal();
+        second_update_done_first = second_update_done.TimedWait(
+            base::TimeDelta::FromSeconds(kTimeoutInSeconds));
+      }));
+  EXPECT_CALL(*mock_media_playlist2, AddSegment(_, _, _, _, _))
+      .WillOnce(Invoke([&](const std::string&, int64_t, int64_t, uint64_t,
+                           uint64_t) { second_update_done.Signal(); }));
+  EXPECT_CALL(*mock_media_playlist1, GetLongestSegmentDuration())
+      .WillOnce(Return(kAnyDuration));
+  EXPECT_CALL(*mock_media_playlist2, GetLongestSegmentDuration())
+      .WillOnce(Return(kAnyDuration));
+
+  {
+    TaskThread thread([&]() {
+      EXPECT_TRUE(notifier.NotifyNewSegment(stream_id1, "segment1",
+                                            kAnyStartTime, kAnyDuration, 0,
+                                            kAnySize));
+    });
+    first_update_started.Wait();
+    EXPECT_TRUE(notifier.NotifyNewSegment(stream_id2, "segment2",
+                                          kAnyStartTime, kAnyDuration, 0,
+                                          kAnySize));
+  }
+  EXPECT_TRUE(second_update_done_first);
+}
+
 TEST_F(SimpleHlsNotifierTest, NotifyKeyFrame) {
   // Pointer released by SimpleHlsNotifier.
   MockMediaPlaylist* mock_media_playlist =
@@ -373,6 +471,19 @@ TEST_F(SimpleHlsNotifierTest, NotifyCueEvent) {
   EXPECT_TRUE(notifier.NotifyCueEvent(stream_id, kCueEventTimestamp));
 }
 
+TEST_F(SimpleHlsNotifierTest, NotifyDiscontinuity) {
+  // Pointer released by SimpleHlsNotifier.
+  MockMediaPlaylist* mock_media_playlist =
+      new MockMediaPlaylist("playlist.m3u8", "", "");
+  SimpleHlsNotifier notifier(hls_params_);
+  const uint32_t stream_id =
+      SetupStream(kCencProtectionScheme, mock_media_playlist, &notifier);
+
+  EXPECT_CALL(*mock_media_playlist, AddDiscontinuity());
+  EXPECT_TRUE(notifier.NotifyDiscontinuity(stream_id));
+  EXPECT_FALSE(notifier.NotifyDiscontinuity(stream_id + 1));
+}
+
 struct RebaseUrlTestData {
   // Base URL is the prefix of segment URL and media playlist URL if it is
   // specified; otherwise, relative URL is used for the relavent URLs.
@@ -577,6 +688,124 @@ TEST_P(LiveOrEventSimpleHlsNotifierTest, NotifyNewSegment) {
                                         kDuration, 0, kSize));
 }
 
+TEST_P(LiveOrEventSimpleHlsNotifierTest, FillGaps) {
+  std::unique_ptr<MockMasterPlaylist> mock_master_playlist(
+      new MockMasterPlaylist());
+  std::unique_ptr<MockMediaPlaylistFactory> factory(
+      new MockMediaPlaylistFactory());
+
+  // Pointer released by SimpleHlsNotifier.
+  MockMediaPlaylist* mock_media_playlist =
+      new MockMediaPlaylist("playlist.m3u8", "", "");
+
+  EXPECT_CALL(*mock_media_playlist, SetMediaInfo(_)).WillOnce(Return(true));
+  EXPECT_CALL(*factory, CreateMock(_, _, _, _))
+      .WillOnce(Return(mock_media_playlist));
+  EXPECT_CALL(*mock_media_playlist, AddSegment(_, _, _, _, _));
+  EXPECT_CALL(*mock_media_playlist, GetLongestSegmentDuration())
+      .WillOnce(Return(30));
+
+  // Written for the new segment, then for the gap segments.
+  EXPECT_CALL(*mock_master_playlist, WriteMasterPlaylist(_, _, _))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(*mock_media_playlist, SetTargetDuration(30)).Times(2);
+  EXPECT_CALL(*mock_media_playlist, WriteToFile(_))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+  // Three 30 second gap segments cover 65 seconds.
+  EXPECT_CALL(*mock_media_playlist, AddGapSegment())
+      .Times(3)
+      .WillRepeatedly(Return(30));
+
+  hls_params_.playlist_type = GetParam();
+  // Long enough for the watchdog not to fill the gaps during the test.
+  hls_params_.gap_timeout = 60;
+  SimpleHlsNotifier notifier(hls_params_);
+  InjectMasterPlaylist(std::move(mock_master_playlist), &notifier);
+  InjectMediaPlaylistFactory(std::move(factory), &notifier);
+  EXPECT_TRUE(notifier.Init());
+  MediaInfo media_info;
+  uint32_t stream_id;
+  EXPECT_TRUE(notifier.NotifyNewStream(media_info, "playlist.m3u8", "name",
+                                       "groupid", &stream_id));
+  EXPECT_TRUE(FillGaps(base::TimeTicks::Now(), &notifier));
+
+  EXPECT_TRUE(notifier.NotifyNewSegment(stream_id, "segmentname", 0, 1000, 0,
+                                        1000));
+  // Not stalled yet.
+  EXPECT_TRUE(FillGaps(base::TimeTicks::Now(), &notifier));
+  EXPECT_TRUE(FillGaps(
+      base::TimeTicks::Now() + base::TimeDelta::FromSeconds(65), &notifier));
+}
+
+TEST_P(LiveOrEventSimpleHlsNotifierTest, NotifyNewPartialSegment) {
+  std::unique_ptr<MockMasterPlaylist> mock_master_playlist(
+      new MockMasterPlaylist());
+  std::unique_ptr<MockMediaPlaylistFactory> factory(
+      new MockMediaPlaylistFactory());
+
+  // Pointer released by SimpleHlsNotifier.
+  MockMediaPlaylist* mock_media_playlist =
+      new MockMediaPlaylist("playlist.m3u8", "", "");
+
+  EXPECT_CALL(*mock_media_playlist, SetMediaInfo(_)).WillOnce(Return(true));
+  EXPECT_CALL(*factory, CreateMock(_, _, _, _))
+      .WillOnce(Return(mock_media_playlist));
+
+  const uint64_t kStartTime = 1328;
+  const uint64_t kPartialSegmentDuration = 90000;
+  const uint64_t kDuration = 2 * kPartialSegmentDuration;
+  const uint64_t kSize = 6595840;
+  const double kLongestSegmentDuration = 1.6;
+  const uint32_t kTargetDuration = 2;  // ceil(kLongestSegmentDuration).
+  const std::string kTestPrefixString = kTestPrefix;
+  EXPECT_CALL(*mock_media_playlist,
+              AddPartialSegment(StrEq(kTestPrefixString + "seg.part0"),
+                                kPartialSegmentDuration, true,
+                                StrEq(kTestPrefixString + "seg.part1")));
+  EXPECT_CALL(*mock_media_playlist,
+              AddSegment(StrEq(kTestPrefixString + "seg"), kStartTime,
+                         kDuration, _, kSize));
+  EXPECT_CALL(*mock_media_playlist,
+              AddPartialSegment(StrEq(kTestPrefixString + "seg2.part0"),
+                                kPartialSegmentDuration, true,
+                                StrEq(kTestPrefixString + "seg2.part1")));
+  EXPECT_CALL(*mock_media_playlist, GetLongestSegmentDuration())
+      .WillOnce(Return(kLongestSegmentDuration));
+  EXPECT_CALL(*mock_media_playlist, SetTargetDuration(kTargetDuration))
+      .Times(2);
+  // The playlist is not written for the partial segment before the first
+  // segment, as the target duration is not known yet. It is written for the
+  // segment and for the following partial segment.
+  EXPECT_CALL(*mock_media_playlist, WriteToFile(_))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+  // The master playlist is not updated for partial segments.
+  EXPECT_CALL(*mock_master_playlist, WriteMasterPlaylist(_, _, _))
+      .WillOnce(Return(true));
+
+  hls_params_.playlist_type = GetParam();
+  hls_params_.low_latency_mode = true;
+  SimpleHlsNotifier notifier(hls_params_);
+  InjectMasterPlaylist(std::move(mock_master_playlist), &notifier);
+  InjectMediaPlaylistFactory(std::move(factory), &notifier);
+  EXPECT_TRUE(notifier.Init());
+  MediaInfo media_info;
+  uint32_t stream_id;
+  EXPECT_TRUE(notifier.NotifyNewStream(media_info, "playlist.m3u8", "name",
+                                       "groupid", &stream_id));
+
+  EXPECT_TRUE(notifier.NotifyNewPartialSegment(
+      stream_id, "seg.part0", kStartTime, kPartialSegmentDuration, kSize, true,
+      "seg.part1"));
+  EXPECT_TRUE(notifier.NotifyNewSegment(stream_id, "seg", kStartTime,
+                                        kDuration, 0, kSize));
+  EXPECT_TRUE(notifier.NotifyNewPartialSegment(
+      stream_id, "seg2.part0", kStartTime + kDuration, kPartialSegmentDuration,
+      kSize, true, "seg2.part1"));
+}
+
 TEST_P(LiveOrEventSimpleHlsNotifierTest, NotifyNewSegmentsWithMultipleStreams) {
   const uint64_t kStartTime = 1328;
   const uint64_t kDuration = 398407;
@@ -664,6 +893,86 @@ TEST_P(LiveOrEventSimpleHlsNotifierTest, NotifyNewSegmentsWithMultipleStreams) {
                                         kDuration, 0, kSize));
 }
 
+TEST_P(LiveOrEventSimpleHlsNotifierTest, NotifyNewSegmentsCoalesced) {
+  const uint64_t kStartTime = 1328;
+  const uint64_t kDuration = 398407;
+  const uint64_t kSize = 6595840;
+  const double kLongCoalescingWindow = 3600;
+
+  std::unique_ptr<MockMasterPlaylist> mock_master_playlist(
+      new MockMasterPlaylist());
+  std::unique_ptr<MockMediaPlaylistFactory> factory(
+      new MockMediaPlaylistFactory());
+
+  // Pointer released by SimpleHlsNotifier.
+  MockMediaPlaylist* mock_media_playlist1 =
+      new MockMediaPlaylist("playlist1.m3u8", "", "");
+  MockMediaPlaylist* mock_media_playlist2 =
+      new MockMediaPlaylist("playlist2.m3u8", "", "");
+
+  EXPECT_CALL(*factory, CreateMock(_, StrEq("playlist1.m3u8"), _, _))
+      .WillOnce(Return(mock_media_playlist1));
+  EXPECT_CALL(*mock_media_playlist1, SetMediaInfo(_)).WillOnce(Return(true));
+  EXPECT_CALL(*factory, CreateMock(_, StrEq("playlist2.m3u8"), _, _))
+      .WillOnce(Return(mock_media_playlist2));
+  EXPECT_CALL(*mock_media_playlist2, SetMediaInfo(_)).WillOnce(Return(true));
+
+  hls_params_.playlist_type = GetParam();
+  hls_params_.manifest_write_coalescing_window = kLongCoalescingWindow;
+  SimpleHlsNotifier notifier(hls_params_);
+  MockMasterPlaylist* mock_master_playlist_ptr = mock_master_playlist.get();
+  InjectMasterPlaylist(std::move(mock_master_playlist), &notifier);
+  InjectMediaPlaylistFactory(std::move(factory), &notifier);
+  EXPECT_TRUE(notifier.Init());
+
+  MediaInfo media_info;
+  uint32_t stream_id1;
+  EXPECT_TRUE(notifier.NotifyNewStream(media_info, "playlist1.m3u8", "name",
+                                       "groupid", &stream_id1));
+  uint32_t stream_id2;
+  EXPECT_TRUE(notifier.NotifyNewStream(media_info, "playlist2.m3u8", "name",
+                                       "groupid", &stream_id2));
+
+  // The first segment is written immediately, updating both playlists as the
+  // target duration is updated.
+  const double kLongestSegmentDuration = 11.3;
+  EXPECT_CALL(*mock_media_playlist1, AddSegment(_, _, _, _, _)).Times(1);
+  EXPECT_CALL(*mock_media_playlist1, GetLongestSegmentDuration())
+      .WillOnce(Return(kLongestSegmentDuration));
+  EXPECT_CALL(*mock_media_playlist1, SetTargetDuration(_)).Times(1);
+  EXPECT_CALL(*mock_media_playlist2, SetTargetDuration(_)).Times(1);
+  EXPECT_CALL(*mock_media_playlist1, WriteToFile(_)).WillOnce(Return(true));
+  EXPECT_CALL(*mock_media_playlist2, WriteToFile(_)).WillOnce(Return(true));
+  EXPECT_CALL(*mock_master_playlist_ptr, WriteMasterPlaylist(_, _, _))
+      .WillOnce(Return(true));
+  EXPECT_TRUE(notifier.NotifyNewSegment(stream_id1, "segment_name", kStartTime,
+                                        kDuration, 0, kSize));
+  Mock::VerifyAndClearExpectations(mock_media_playlist1);
+  Mock::VerifyAndClearExpectations(mock_media_playlist2);
+  Mock::VerifyAndClearExpectations(mock_master_playlist_ptr);
+
+  // The second segment of the first stream is not written until the second
+  // stream reports its segment.
+  EXPECT_CALL(*mock_media_playlist1, AddSegment(_, _, _, _, _)).Times(1);
+  EXPECT_CALL(*mock_media_playlist1, GetLongestSegmentDuration())
+      .WillOnce(Return(kLongestSegmentDuration));
+  EXPECT_CALL(*mock_media_playlist1, WriteToFile(_)).Times(0);
+  EXPECT_TRUE(notifier.NotifyNewSegment(stream_id1, "segment_name",
+                                        kStartTime + kDuration, kDuration, 0,
+                                        kSize));
+  Mock::VerifyAndClearExpectations(mock_media_playlist1);
+
+  EXPECT_CALL(*mock_media_playlist2, AddSegment(_, _, _, _, _)).Times(1);
+  EXPECT_CALL(*mock_media_playlist2, GetLongestSegmentDuration())
+      .WillOnce(Return(kLongestSegmentDuration));
+  EXPECT_CALL(*mock_media_playlist1, WriteToFile(_)).WillOnce(Return(true));
+  EXPECT_CALL(*mock_media_playlist2, WriteToFile(_)).WillOnce(Return(true));
+  EXPECT_CALL(*mock_master_playlist_ptr, WriteMasterPlaylist(_, _, _))
+      .WillOnce(Return(true));
+  EXPECT_TRUE(notifier.NotifyNewSegment(stream_id2, "segment_name", kStartTime,
+                                        kDuration, 0, kSize));
+}
+
 INSTANTIATE_TEST_CASE_P(PlaylistTypes,
                         LiveOrEventSimpleHlsNotifierTest,
                         ::testing::Values(HlsPlaylistType::kLive,
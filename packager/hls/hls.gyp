@@ -34,6 +34,25 @@
         '../third_party/gflags/gflags.gyp:gflags',
       ],
     },
+    {
+      # Not part of hls_unittest, as the benchmarks take a while and their
+      # results are only meaningful in release builds.
+      'target_name': 'hls_benchmarks',
+      'type': '<(gtest_target_type)',
+      'sources': [
+        '../mpd/test/allocation_counter.cc',
+        '../mpd/test/allocation_counter.h',
+        'base/hls_benchmarks.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../media/test/media_test.gyp:run_tests_with_atexit_manager',
+        '../mpd/mpd.gyp:media_info_proto',
+        '../testing/gtest.gyp:gtest',
+        '../testing/perf/perf_test.gyp:perf_test',
+        'hls_builder',
+      ],
+    },
     {
       'target_name': 'hls_unittest',
       'type': '<(gtest_target_type)',
@@ -62,6 +62,41 @@ struct HlsParams {
   /// Custom EXT-X-MEDIA-SEQUENCE value to allow continuous media playback
   /// across packager restarts. See #691 for details.
   uint32_t media_sequence_number = 0;
+  /// Window, in seconds, to coalesce the playlist writes triggered by new
+  /// segments of different streams in LIVE and EVENT playlists. The updated
+  /// playlists are written once all streams have reported a new segment, or
+  /// once the window has elapsed since the previous write. Every new segment
+  /// triggers a write if it is not positive.
+  double manifest_write_coalescing_window = 0;
+  /// Write the LIVE and EVENT playlists on a worker thread, so the media
+  /// threads do not block on the playlist output. An explicit flush still
+  /// waits for the writes.
+  bool async_manifest_writes = false;
+  /// Generate Low-Latency HLS playlists for LIVE and EVENT playlists. Every
+  /// subsegment of an fMP4 segment is also written as a partial segment and
+  /// listed with EXT-X-PART, followed by EXT-X-PRELOAD-HINT for the next
+  /// partial segment. EXT-X-SERVER-CONTROL advertises blocking playlist
+  /// reload, which must be implemented by the origin server.
+  bool low_latency_mode = false;
+  /// The target partial segment duration, i.e. the value of PART-TARGET in
+  /// EXT-X-PART-INF. It will be populated from subsegment duration specified
+  /// in ChunkingParams if not specified.
+  double target_part_duration = 0;
+  /// Enables Playlist Delta Updates for LIVE and EVENT playlists if positive.
+  /// EXT-X-SERVER-CONTROL advertises CAN-SKIP-UNTIL with this value, in
+  /// seconds, raised to six target durations if it is smaller. A delta
+  /// update, with the segments before the skip boundary replaced by
+  /// EXT-X-SKIP, is written next to each media playlist with a "_delta"
+  /// suffix, e.g. "video_delta.m3u8" for "video.m3u8". The origin server is
+  /// expected to serve it for requests with the _HLS_skip=YES query parameter.
+  double delta_update_skip_until = 0;
+  /// Wall clock time, in seconds, after which a stream of a LIVE or EVENT
+  /// playlist without new segments is considered stalled. Segments tagged
+  /// with EXT-X-GAP are then added to its playlist to cover the time since
+  /// its last segment, until new segments arrive, so the playlist keeps
+  /// moving while the other streams are published. Disabled if it is not
+  /// positive.
+  double gap_timeout = 0;
 };
 
 }  // namespace shaka
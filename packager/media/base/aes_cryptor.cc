@@ -11,6 +11,9 @@
 #include <openssl/err.h>
 #include <openssl/rand.h>
 
+#include <string.h>
+
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -18,6 +21,11 @@
 
 namespace {
 
+// Size of the buffer the crypted parts of the strides are gathered in by
+// GatherCryptStrides(). Large enough to amortize the cost of an AES call, and
+// to let its multi-block paths kick in, while staying in the L1 cache.
+const size_t kStrideGatherBufferSize = 4096;
+
 // According to ISO/IEC 23001-7:2016 CENC spec, IV should be either
 // 64-bit (8-byte) or 128-bit (16-byte).
 bool IsIvSizeValid(size_t iv_size) {
@@ -79,6 +87,10 @@ bool AesCryptor::SetIv(const std::vector<uint8_t>& iv) {
 }
 
 void AesCryptor::UpdateIv() {
+  UpdateIv(num_crypt_bytes_);
+}
+
+void AesCryptor::UpdateIv(size_t num_crypt_bytes) {
   if (constant_iv_flag_ == kUseConstantIv)
     return;
 
@@ -95,7 +107,7 @@ void AesCryptor::UpdateIv() {
     increment = 1;
   } else {
     DCHECK_EQ(16u, iv_.size());
-    increment = (num_crypt_bytes_ + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+    increment = (num_crypt_bytes + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
   }
 
   for (int i = iv_.size() - 1; increment > 0 && i >= 0; --i) {
@@ -126,6 +138,87 @@ bool AesCryptor::GenerateRandomIv(FourCC protection_scheme,
   return true;
 }
 
+void AesCryptor::CbcCryptStrides(int mode,
+                                 uint8_t* iv,
+                                 const uint8_t* text,
+                                 size_t crypt_size,
+                                 size_t stride_size,
+                                 size_t num_strides,
+                                 uint8_t* crypt_text) const {
+  DCHECK_EQ(0u, crypt_size % AES_BLOCK_SIZE);
+  GatherCryptStrides(
+      [this, mode, iv](const uint8_t* text, size_t text_size,
+                       uint8_t* crypt_text) {
+        AES_cbc_encrypt(text, crypt_text, text_size, aes_key(), iv, mode);
+        return true;
+      },
+      text, crypt_size, stride_size, num_strides, crypt_text);
+}
+
+bool AesCryptor::GatherCryptStrides(const ContiguousCryptFunction& crypt,
+                                    const uint8_t* text,
+                                    size_t crypt_size,
+                                    size_t stride_size,
+                                    size_t num_strides,
+                                    uint8_t* crypt_text) const {
+  DCHECK_LE(crypt_size, stride_size);
+  const size_t clear_size = stride_size - crypt_size;
+  const size_t strides_per_batch = kStrideGatherBufferSize / crypt_size;
+  if (strides_per_batch <= 1) {
+    // Large enough to be crypted in place.
+    for (size_t i = 0; i < num_strides; ++i) {
+      if (!crypt(text, crypt_size, crypt_text))
+        return false;
+      if (text != crypt_text)
+        memcpy(crypt_text + crypt_size, text + crypt_size, clear_size);
+      text += stride_size;
+      crypt_text += stride_size;
+    }
+    return true;
+  }
+
+  uint8_t buffer[kStrideGatherBufferSize];
+  while (num_strides > 0) {
+    const size_t batch_size = std::min(num_strides, strides_per_batch);
+    for (size_t i = 0; i < batch_size; ++i)
+      memcpy(buffer + i * crypt_size, text + i * stride_size, crypt_size);
+    if (!crypt(buffer, batch_size * crypt_size, buffer))
+      return false;
+    for (size_t i = 0; i < batch_size; ++i) {
+      memcpy(crypt_text + i * stride_size, buffer + i * crypt_size,
+             crypt_size);
+      if (text != crypt_text) {
+        memcpy(crypt_text + i * stride_size + crypt_size,
+               text + i * stride_size + crypt_size, clear_size);
+      }
+    }
+    text += batch_size * stride_size;
+    crypt_text += batch_size * stride_size;
+    num_strides -= batch_size;
+  }
+  return true;
+}
+
+bool AesCryptor::CryptStridesInternal(const uint8_t* text,
+                                      size_t crypt_size,
+                                      size_t stride_size,
+                                      size_t num_strides,
+                                      uint8_t* crypt_text) {
+  DCHECK_LE(crypt_size, stride_size);
+  for (size_t i = 0; i < num_strides; ++i) {
+    size_t crypt_text_size = crypt_size;
+    if (!CryptInternal(text, crypt_size, crypt_text, &crypt_text_size))
+      return false;
+    if (text != crypt_text) {
+      memcpy(crypt_text + crypt_size, text + crypt_size,
+             stride_size - crypt_size);
+    }
+    text += stride_size;
+    crypt_text += stride_size;
+  }
+  return true;
+}
+
 size_t AesCryptor::NumPaddingBytes(size_t size) const {
   // No padding by default.
   return 0;
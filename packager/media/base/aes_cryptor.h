@@ -7,6 +7,7 @@
 #ifndef PACKAGER_MEDIA_BASE_AES_CRYPTOR_H_
 #define PACKAGER_MEDIA_BASE_AES_CRYPTOR_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -68,6 +69,29 @@ class AesCryptor {
   }
   /// @}
 
+  /// Crypts the beginning of each of @a num_strides strides of @a stride_size
+  /// bytes, as if the crypted parts of the strides were contiguous, and copies
+  /// the rest of each stride as is. This is how a pattern is crypted, with
+  /// fewer calls than crypting every stride separately.
+  /// @param crypt_size is the number of bytes to crypt at the beginning of
+  ///        each stride. It should be a positive multiple of AES_BLOCK_SIZE
+  ///        not larger than @a stride_size.
+  /// @param crypt_text should have at least @a num_strides * @a stride_size
+  ///        bytes.
+  /// @return true on success, false otherwise.
+  bool CryptStrides(const uint8_t* text,
+                    size_t crypt_size,
+                    size_t stride_size,
+                    size_t num_strides,
+                    uint8_t* crypt_text) {
+    if (constant_iv_flag_ == kUseConstantIv)
+      SetIvInternal();
+    else
+      num_crypt_bytes_ += crypt_size * num_strides;
+    return CryptStridesInternal(text, crypt_size, stride_size, num_strides,
+                                crypt_text);
+  }
+
   /// Set IV. SetIv() implementation guarantees that the iv passed to SetIv()
   /// is set to iv() and then calls SetIvInternal().
   /// @return true if successful, false if the input is invalid.
@@ -78,6 +102,13 @@ class AesCryptor {
   /// This is used by encryptors only. It is a NOP if using kUseConstantIv.
   void UpdateIv();
 
+  /// Update IV for next sample as if @a num_crypt_bytes bytes had been crypted
+  /// since the last IV update. Unlike UpdateIv(), the result does not depend on
+  /// earlier Crypt calls, which allows IVs of subsequent samples to be derived
+  /// before the current sample is crypted, e.g. when crypting in parallel.
+  /// This is used by encryptors only. It is a NOP if using kUseConstantIv.
+  void UpdateIv(size_t num_crypt_bytes);
+
   /// @return The current iv.
   const std::vector<uint8_t>& iv() const { return iv_; }
 
@@ -95,6 +126,35 @@ class AesCryptor {
   const AES_KEY* aes_key() const { return aes_key_.get(); }
   AES_KEY* mutable_aes_key() { return aes_key_.get(); }
 
+  /// Crypts @a text_size contiguous bytes from @a text to @a crypt_text, which
+  /// may be the same address.
+  typedef std::function<bool(const uint8_t* text,
+                             size_t text_size,
+                             uint8_t* crypt_text)>
+      ContiguousCryptFunction;
+
+  /// Implements CryptStrides() with the crypted parts of consecutive strides
+  /// gathered in a buffer, so a single @a crypt call processes many of them.
+  /// @return true on success, false if @a crypt fails.
+  bool GatherCryptStrides(const ContiguousCryptFunction& crypt,
+                          const uint8_t* text,
+                          size_t crypt_size,
+                          size_t stride_size,
+                          size_t num_strides,
+                          uint8_t* crypt_text) const;
+
+  /// Implements CryptStrides() for AES-CBC with no padding, with
+  /// GatherCryptStrides().
+  /// @param mode is AES_ENCRYPT or AES_DECRYPT.
+  /// @param iv is the 16-byte cipher block chain, updated on return.
+  void CbcCryptStrides(int mode,
+                       uint8_t* iv,
+                       const uint8_t* text,
+                       size_t crypt_size,
+                       size_t stride_size,
+                       size_t num_strides,
+                       uint8_t* crypt_text) const;
+
  private:
   // Internal implementation of crypt function.
   // |text| points to the input text.
@@ -111,6 +171,14 @@ class AesCryptor {
                              uint8_t* crypt_text,
                              size_t* crypt_text_size) = 0;
 
+  // Internal implementation of CryptStrides(). The default implementation
+  // calls CryptInternal() for each stride.
+  virtual bool CryptStridesInternal(const uint8_t* text,
+                                    size_t crypt_size,
+                                    size_t stride_size,
+                                    size_t num_strides,
+                                    uint8_t* crypt_text);
+
   // Internal implementation of SetIv, which setup internal iv.
   virtual void SetIvInternal() = 0;
 
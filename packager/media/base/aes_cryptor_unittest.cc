@@ -6,6 +6,7 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <memory>
 
 #include "packager/base/logging.h"
@@ -183,6 +184,19 @@ TEST_F(AesCtrEncryptorTest, 128BitIVBoundaryCaseEncryption) {
   EXPECT_EQ(encrypted, encrypted_verify);
 }
 
+TEST_F(AesCtrEncryptorTest, 128BitIvUpdateWithCryptBytes) {
+  std::vector<uint8_t> iv_max64(kIv128Max64,
+                                kIv128Max64 + arraysize(kIv128Max64));
+  ASSERT_TRUE(encryptor_.InitializeWithIv(key_, iv_max64));
+
+  // The IV should advance by the number of blocks specified, without any
+  // Crypt calls.
+  std::vector<uint8_t> iv_one_and_three(
+      kIv128OneAndThree, kIv128OneAndThree + arraysize(kIv128OneAndThree));
+  encryptor_.UpdateIv(plaintext_.size());
+  EXPECT_EQ(iv_one_and_three, encryptor_.iv());
+}
+
 TEST_F(AesCtrEncryptorTest, 64BitIvUpdate) {
   std::vector<uint8_t> iv_zero(kIv64Zero, kIv64Zero + arraysize(kIv64Zero));
   ASSERT_TRUE(encryptor_.InitializeWithIv(key_, iv_zero));
@@ -197,6 +211,37 @@ TEST_F(AesCtrEncryptorTest, 64BitIvUpdate) {
   EXPECT_EQ(iv_one, encryptor_.iv());
 }
 
+TEST_F(AesCtrEncryptorTest, LargeBufferMatchesSplitCrypt) {
+  // Exercise the multi-block key stream path with a buffer spanning the 64-bit
+  // counter wrap around, and verify it matches encrypting in small chunks
+  // which do not start or end at block boundaries.
+  std::vector<uint8_t> iv_max64(kIv128Max64,
+                                kIv128Max64 + arraysize(kIv128Max64));
+  std::vector<uint8_t> plaintext(kAesBlockSize * 100 + 7);
+  for (size_t i = 0; i < plaintext.size(); ++i)
+    plaintext[i] = static_cast<uint8_t>(i * 31);
+
+  ASSERT_TRUE(encryptor_.InitializeWithIv(key_, iv_max64));
+  std::vector<uint8_t> encrypted;
+  ASSERT_TRUE(encryptor_.Crypt(plaintext, &encrypted));
+  EXPECT_EQ(7u, encryptor_.block_offset());
+
+  ASSERT_TRUE(encryptor_.InitializeWithIv(key_, iv_max64));
+  std::vector<uint8_t> encrypted_in_chunks(plaintext.size());
+  const size_t kChunkSize = 13;
+  for (size_t offset = 0; offset < plaintext.size(); offset += kChunkSize) {
+    const size_t size = std::min(kChunkSize, plaintext.size() - offset);
+    ASSERT_TRUE(encryptor_.Crypt(&plaintext[offset], size,
+                                 &encrypted_in_chunks[offset]));
+  }
+  EXPECT_EQ(encrypted, encrypted_in_chunks);
+
+  ASSERT_TRUE(decryptor_.InitializeWithIv(key_, iv_max64));
+  std::vector<uint8_t> decrypted;
+  ASSERT_TRUE(decryptor_.Crypt(encrypted, &decrypted));
+  EXPECT_EQ(plaintext, decrypted);
+}
+
 TEST_F(AesCtrEncryptorTest, GenerateRandomIv) {
   const uint8_t kCencIvSize = 8;
   std::vector<uint8_t> iv;
@@ -660,5 +705,21 @@ TEST_F(AesPerformanceTest, AesCtr) {
     ASSERT_TRUE(ctr_encryptor_.Crypt(plaintext_, &encrypted));
 }
 
+TEST_F(AesPerformanceTest, AesCtrUnalignedSubsamples) {
+  // Subsample boundaries are usually not block aligned, which forces the key
+  // stream of the partial block to be carried across Crypt calls.
+  const size_t kSubsampleSize = 1000;
+  ASSERT_TRUE(ctr_encryptor_.InitializeWithIv(key_, iv_));
+  std::vector<uint8_t> encrypted(plaintext_.size());
+  for (int i = 0; i < 0x100; i++) {
+    for (size_t offset = 0; offset < plaintext_.size();
+         offset += kSubsampleSize) {
+      const size_t size = std::min(kSubsampleSize, plaintext_.size() - offset);
+      ASSERT_TRUE(
+          ctr_encryptor_.Crypt(&plaintext_[offset], size, &encrypted[offset]));
+    }
+  }
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -153,6 +153,23 @@ bool AesCbcDecryptor::CryptInternal(const uint8_t* ciphertext,
   return true;
 }
 
+bool AesCbcDecryptor::CryptStridesInternal(const uint8_t* ciphertext,
+                                           size_t crypt_size,
+                                           size_t stride_size,
+                                           size_t num_strides,
+                                           uint8_t* plaintext) {
+  // Pkcs5 padding would be stripped from every stride.
+  if (padding_scheme_ == kPkcs5Padding) {
+    return AesCryptor::CryptStridesInternal(ciphertext, crypt_size,
+                                            stride_size, num_strides,
+                                            plaintext);
+  }
+  DCHECK(aes_key());
+  CbcCryptStrides(AES_DECRYPT, internal_iv_.data(), ciphertext, crypt_size,
+                  stride_size, num_strides, plaintext);
+  return true;
+}
+
 void AesCbcDecryptor::SetIvInternal() {
   internal_iv_ = iv();
   internal_iv_.resize(AES_BLOCK_SIZE, 0);
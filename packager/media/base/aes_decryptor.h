@@ -53,6 +53,11 @@ class AesCbcDecryptor : public AesCryptor {
                      size_t ciphertext_size,
                      uint8_t* plaintext,
                      size_t* plaintext_size) override;
+  bool CryptStridesInternal(const uint8_t* ciphertext,
+                            size_t crypt_size,
+                            size_t stride_size,
+                            size_t num_strides,
+                            uint8_t* plaintext) override;
   void SetIvInternal() override;
 
   const CbcPaddingScheme padding_scheme_;
@@ -7,19 +7,19 @@
 #include "packager/media/base/aes_encryptor.h"
 
 #include <openssl/aes.h>
+#include <string.h>
 
 #include "packager/base/logging.h"
 
 namespace {
 
-// Increment an 8-byte counter by 1. Return true if overflowed.
-bool Increment64(uint8_t* counter) {
+// Read an 8-byte big endian counter.
+uint64_t ReadCounter64(const uint8_t* counter) {
   DCHECK(counter);
-  for (int i = 7; i >= 0; --i) {
-    if (++counter[i] != 0)
-      return false;
-  }
-  return true;
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i)
+    value = (value << 8) | counter[i];
+  return value;
 }
 
 // AES defines three key sizes: 128, 192 and 256 bits.
@@ -57,7 +57,6 @@ AesCtrEncryptor::AesCtrEncryptor()
 
 AesCtrEncryptor::~AesCtrEncryptor() {}
 
-
 bool AesCtrEncryptor::CryptInternal(const uint8_t* plaintext,
                                     size_t plaintext_size,
                                     uint8_t* ciphertext,
@@ -74,22 +73,61 @@ bool AesCtrEncryptor::CryptInternal(const uint8_t* plaintext,
   }
   *ciphertext_size = plaintext_size;
 
-  for (size_t i = 0; i < plaintext_size; ++i) {
-    if (block_offset_ == 0) {
-      AES_encrypt(&counter_[0], &encrypted_counter_[0], aes_key());
-      // As mentioned in ISO/IEC 23001-7:2016 CENC spec, of the 16 byte counter
-      // block, bytes 8 to 15 (i.e. the least significant bytes) are used as a
-      // simple 64 bit unsigned integer that is incremented by one for each
-      // subsequent block of sample data processed and is kept in network byte
-      // order.
-      Increment64(&counter_[8]);
+  // As mentioned in ISO/IEC 23001-7:2016 CENC spec, of the 16 byte counter
+  // block, bytes 8 to 15 (i.e. the least significant bytes) are used as a
+  // simple 64 bit unsigned integer that is incremented by one for each
+  // subsequent block of sample data processed and is kept in network byte
+  // order. AES_ctr128_encrypt, which generates the key stream for many blocks
+  // at a time (using hardware acceleration if available), increments the whole
+  // 128 bit counter instead, so the input is split at the point where the
+  // lower 64 bits wrap around and the carry into the upper 64 bits is undone.
+  while (plaintext_size > 0) {
+    size_t chunk_size = plaintext_size;
+    const size_t bytes_left_in_block =
+        block_offset_ == 0 ? 0 : AES_BLOCK_SIZE - block_offset_;
+    if (chunk_size > bytes_left_in_block) {
+      // Number of new counter blocks that can be generated before wrapping
+      // around, minus one.
+      const uint64_t max_blocks_minus_one = ~ReadCounter64(&counter_[8]);
+      const uint64_t num_blocks =
+          (chunk_size - bytes_left_in_block + AES_BLOCK_SIZE - 1) /
+          AES_BLOCK_SIZE;
+      if (num_blocks - 1 > max_blocks_minus_one) {
+        chunk_size = bytes_left_in_block +
+                     (max_blocks_minus_one + 1) * AES_BLOCK_SIZE;
+      }
     }
-    ciphertext[i] = plaintext[i] ^ encrypted_counter_[block_offset_];
-    block_offset_ = (block_offset_ + 1) % AES_BLOCK_SIZE;
+
+    uint8_t counter_high[8];
+    memcpy(counter_high, &counter_[0], sizeof(counter_high));
+    unsigned int block_offset = block_offset_;
+    AES_ctr128_encrypt(plaintext, ciphertext, chunk_size, aes_key(),
+                       &counter_[0], &encrypted_counter_[0], &block_offset);
+    block_offset_ = block_offset;
+    memcpy(&counter_[0], counter_high, sizeof(counter_high));
+
+    plaintext += chunk_size;
+    ciphertext += chunk_size;
+    plaintext_size -= chunk_size;
   }
   return true;
 }
 
+bool AesCtrEncryptor::CryptStridesInternal(const uint8_t* plaintext,
+                                           size_t crypt_size,
+                                           size_t stride_size,
+                                           size_t num_strides,
+                                           uint8_t* ciphertext) {
+  // The key stream continues across the crypted parts of the strides, so they
+  // can be crypted as one contiguous text.
+  return GatherCryptStrides(
+      [this](const uint8_t* text, size_t text_size, uint8_t* crypt_text) {
+        size_t crypt_text_size = text_size;
+        return CryptInternal(text, text_size, crypt_text, &crypt_text_size);
+      },
+      plaintext, crypt_size, stride_size, num_strides, ciphertext);
+}
+
 void AesCtrEncryptor::SetIvInternal() {
   block_offset_ = 0;
   counter_ = iv();
@@ -134,7 +172,8 @@ bool AesCbcEncryptor::CryptInternal(const uint8_t* plaintext,
                     internal_iv_.data(), AES_ENCRYPT);
   } else if (padding_scheme_ == kCtsPadding) {
     // Don't have a full block, leave unencrypted.
-    memcpy(ciphertext, plaintext, plaintext_size);
+    if (ciphertext != plaintext)
+      memcpy(ciphertext, plaintext, plaintext_size);
     return true;
   }
   if (residual_block_size == 0 && padding_scheme_ != kPkcs5Padding) {
@@ -144,7 +183,10 @@ bool AesCbcEncryptor::CryptInternal(const uint8_t* plaintext,
 
   if (padding_scheme_ == kNoPadding) {
     // The residual block is left unencrypted.
-    memcpy(ciphertext + cbc_size, plaintext + cbc_size, residual_block_size);
+    if (ciphertext != plaintext) {
+      memcpy(ciphertext + cbc_size, plaintext + cbc_size,
+             residual_block_size);
+    }
     return true;
   }
 
@@ -184,6 +226,22 @@ bool AesCbcEncryptor::CryptInternal(const uint8_t* plaintext,
   return true;
 }
 
+bool AesCbcEncryptor::CryptStridesInternal(const uint8_t* plaintext,
+                                           size_t crypt_size,
+                                           size_t stride_size,
+                                           size_t num_strides,
+                                           uint8_t* ciphertext) {
+  // Pkcs5 padding would be added to every stride.
+  if (padding_scheme_ == kPkcs5Padding) {
+    return AesCryptor::CryptStridesInternal(plaintext, crypt_size, stride_size,
+                                            num_strides, ciphertext);
+  }
+  DCHECK(aes_key());
+  CbcCryptStrides(AES_ENCRYPT, internal_iv_.data(), plaintext, crypt_size,
+                  stride_size, num_strides, ciphertext);
+  return true;
+}
+
 void AesCbcEncryptor::SetIvInternal() {
   internal_iv_ = iv();
   internal_iv_.resize(AES_BLOCK_SIZE, 0);
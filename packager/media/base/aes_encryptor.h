@@ -51,6 +51,11 @@ class AesCtrEncryptor : public AesEncryptor {
                      size_t plaintext_size,
                      uint8_t* ciphertext,
                      size_t* ciphertext_size) override;
+  bool CryptStridesInternal(const uint8_t* plaintext,
+                            size_t crypt_size,
+                            size_t stride_size,
+                            size_t num_strides,
+                            uint8_t* ciphertext) override;
   void SetIvInternal() override;
 
   // Current block offset.
@@ -99,6 +104,11 @@ class AesCbcEncryptor : public AesEncryptor {
                      size_t plaintext_size,
                      uint8_t* ciphertext,
                      size_t* ciphertext_size) override;
+  bool CryptStridesInternal(const uint8_t* plaintext,
+                            size_t crypt_size,
+                            size_t stride_size,
+                            size_t num_strides,
+                            uint8_t* ciphertext) override;
   void SetIvInternal() override;
   size_t NumPaddingBytes(size_t size) const override;
 
@@ -49,9 +49,30 @@ bool AesPatternCryptor::CryptInternal(const uint8_t* text,
   }
   *crypt_text_size = text_size;
 
-  while (text_size > 0) {
-    const size_t crypt_byte_size = crypt_byte_block_ * AES_BLOCK_SIZE;
+  const size_t crypt_byte_size = crypt_byte_block_ * AES_BLOCK_SIZE;
+  const size_t stride_size =
+      crypt_byte_size + skip_byte_block_ * AES_BLOCK_SIZE;
+  // Complete patterns are crypted in a single call. The last pattern is left
+  // to the loop below if it could be subject to the partial pattern rules,
+  // i.e. if it has no skipped blocks and nothing follows it.
+  if (crypt_byte_size > 0) {
+    size_t num_strides = text_size / stride_size;
+    if (num_strides > 0 && skip_byte_block_ == 0 &&
+        num_strides * stride_size == text_size) {
+      --num_strides;
+    }
+    if (num_strides > 0) {
+      if (!cryptor_->CryptStrides(text, crypt_byte_size, stride_size,
+                                  num_strides, crypt_text)) {
+        return false;
+      }
+      text += num_strides * stride_size;
+      text_size -= num_strides * stride_size;
+      crypt_text += num_strides * stride_size;
+    }
+  }
 
+  while (text_size > 0) {
     if (text_size <= crypt_byte_size) {
       const bool need_encrypt =
           encryption_mode_ != kSkipIfCryptByteBlockRemaining &&
@@ -69,7 +90,8 @@ bool AesPatternCryptor::CryptInternal(const uint8_t* text,
       }
 
       // The remaining bytes are not encrypted.
-      memcpy(crypt_text, text, text_size);
+      if (crypt_text != text)
+        memcpy(crypt_text, text, text_size);
       return true;
     }
 
@@ -81,7 +103,8 @@ bool AesPatternCryptor::CryptInternal(const uint8_t* text,
 
     const size_t skip_byte_size = std::min(
         static_cast<size_t>(skip_byte_block_ * AES_BLOCK_SIZE), text_size);
-    memcpy(crypt_text, text, skip_byte_size);
+    if (crypt_text != text)
+      memcpy(crypt_text, text, skip_byte_size);
     text += skip_byte_size;
     text_size -= skip_byte_size;
     crypt_text += skip_byte_size;
@@ -8,6 +8,8 @@
 #include <gtest/gtest.h>
 
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/media/base/aes_decryptor.h"
+#include "packager/media/base/aes_encryptor.h"
 #include "packager/media/base/aes_pattern_cryptor.h"
 #include "packager/media/base/mock_aes_cryptor.h"
 
@@ -208,5 +210,82 @@ TEST(SampleAesPatternCryptor, MoreThan16Bytes) {
   ASSERT_TRUE(pattern_cryptor.Crypt("0123456789abcdef012", &crypt_text));
 }
 
+TEST(CbcsPatternCryptor, MatchesBlockByBlockEncryption) {
+  const uint8_t kCbcsCryptByteBlock = 1;
+  const uint8_t kCbcsSkipByteBlock = 9;
+  const size_t kBlockSize = 16;
+  const std::vector<uint8_t> kKey(16, 'k');
+  const std::vector<uint8_t> kIv(16, 'i');
+
+  // Long enough for the crypted blocks to go through several gather buffers,
+  // and ending with a partial pattern.
+  std::vector<uint8_t> text(100 * 160 + 40);
+  for (size_t i = 0; i < text.size(); ++i)
+    text[i] = static_cast<uint8_t>(i * 7);
+
+  // Reference: every crypted block encrypted separately on the same chain.
+  AesCbcEncryptor block_encryptor(kNoPadding);
+  ASSERT_TRUE(block_encryptor.InitializeWithIv(kKey, kIv));
+  std::vector<uint8_t> expected_crypt_text = text;
+  for (size_t offset = 0; offset + kBlockSize <= text.size();
+       offset += (kCbcsCryptByteBlock + kCbcsSkipByteBlock) * kBlockSize) {
+    ASSERT_TRUE(block_encryptor.Crypt(&text[offset], kBlockSize,
+                                      &expected_crypt_text[offset]));
+  }
+
+  AesPatternCryptor pattern_encryptor(
+      kCbcsCryptByteBlock, kCbcsSkipByteBlock,
+      AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
+      AesCryptor::kDontUseConstantIv,
+      std::unique_ptr<AesCryptor>(new AesCbcEncryptor(kNoPadding)));
+  ASSERT_TRUE(pattern_encryptor.InitializeWithIv(kKey, kIv));
+  std::vector<uint8_t> crypt_text;
+  ASSERT_TRUE(pattern_encryptor.Crypt(text, &crypt_text));
+  EXPECT_EQ(expected_crypt_text, crypt_text);
+
+  AesPatternCryptor pattern_decryptor(
+      kCbcsCryptByteBlock, kCbcsSkipByteBlock,
+      AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
+      AesCryptor::kDontUseConstantIv,
+      std::unique_ptr<AesCryptor>(new AesCbcDecryptor(kNoPadding)));
+  ASSERT_TRUE(pattern_decryptor.InitializeWithIv(kKey, kIv));
+  // In place.
+  ASSERT_TRUE(pattern_decryptor.Crypt(crypt_text, &crypt_text));
+  EXPECT_EQ(text, crypt_text);
+}
+
+TEST(CensPatternCryptor, MatchesBlockByBlockEncryption) {
+  const uint8_t kCensCryptByteBlock = 1;
+  const uint8_t kCensSkipByteBlock = 9;
+  const size_t kBlockSize = 16;
+  const std::vector<uint8_t> kKey(16, 'k');
+  const std::vector<uint8_t> kIv(8, 'i');
+
+  std::vector<uint8_t> text(100 * 160 + 40);
+  for (size_t i = 0; i < text.size(); ++i)
+    text[i] = static_cast<uint8_t>(i * 7);
+
+  // Reference: every crypted block encrypted separately on the same key
+  // stream.
+  AesCtrEncryptor block_encryptor;
+  ASSERT_TRUE(block_encryptor.InitializeWithIv(kKey, kIv));
+  std::vector<uint8_t> expected_crypt_text = text;
+  for (size_t offset = 0; offset + kBlockSize <= text.size();
+       offset += (kCensCryptByteBlock + kCensSkipByteBlock) * kBlockSize) {
+    ASSERT_TRUE(block_encryptor.Crypt(&text[offset], kBlockSize,
+                                      &expected_crypt_text[offset]));
+  }
+
+  AesPatternCryptor pattern_encryptor(
+      kCensCryptByteBlock, kCensSkipByteBlock,
+      AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
+      AesCryptor::kDontUseConstantIv,
+      std::unique_ptr<AesCryptor>(new AesCtrEncryptor));
+  ASSERT_TRUE(pattern_encryptor.InitializeWithIv(kKey, kIv));
+  std::vector<uint8_t> crypt_text;
+  ASSERT_TRUE(pattern_encryptor.Crypt(text, &crypt_text));
+  EXPECT_EQ(expected_crypt_text, crypt_text);
+}
+
 }  // namespace media
 }  // namespace shaka
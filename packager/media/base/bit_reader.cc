@@ -4,7 +4,9 @@
 
 #include "packager/media/base/bit_reader.h"
 
-#include <algorithm>
+#include <string.h>
+
+#include "packager/base/sys_byteorder.h"
 
 namespace shaka {
 namespace media {
@@ -13,100 +15,106 @@ BitReader::BitReader(const uint8_t* data, size_t size)
     : data_(data),
       initial_size_(size),
       bytes_left_(size),
-      num_remaining_bits_in_curr_byte_(0) {
+      cache_(0),
+      num_cached_bits_(0) {
   DCHECK(data_ != NULL && bytes_left_ > 0);
 
-  UpdateCurrByte();
+  RefillCache();
 }
 
 BitReader::~BitReader() {}
 
 bool BitReader::SkipBits(size_t num_bits) {
-  // Skip any bits in the current byte waiting to be processed, then
-  // process full bytes until less than 8 bits remaining.
-  if (num_bits > num_remaining_bits_in_curr_byte_) {
-    num_bits -= num_remaining_bits_in_curr_byte_;
-    num_remaining_bits_in_curr_byte_ = 0;
-
-    size_t num_bytes = num_bits / 8;
-    num_bits %= 8;
-    if (bytes_left_ < num_bytes) {
-      bytes_left_ = 0;
-      return false;
-    }
-    bytes_left_ -= num_bytes;
+  if (num_bits > bits_available()) {
+    SetEndOfStream();
+    return false;
+  }
+  if (num_bits > num_cached_bits_) {
+    // Drop the cached bits, then skip the whole bytes without reading them.
+    num_bits -= num_cached_bits_;
+    const size_t num_bytes = num_bits / 8;
     data_ += num_bytes;
-    UpdateCurrByte();
-
-    // If there is no more data remaining, only return true if we
-    // skipped all that were requested.
-    if (num_remaining_bits_in_curr_byte_ == 0)
-      return (num_bits == 0);
+    bytes_left_ -= num_bytes;
+    num_bits %= 8;
+    cache_ = 0;
+    num_cached_bits_ = 0;
+    RefillCache();
   }
-
-  // Less than 8 bits remaining to skip. Use ReadBitsInternal to verify
-  // that the remaining bits we need exist, and adjust them as necessary
-  // for subsequent operations.
-  uint64_t not_needed;
-  return ReadBitsInternal(num_bits, &not_needed);
+  TakeCachedBits(num_bits);
+  return true;
 }
 
 void BitReader::SkipToNextByte() {
-  // Already aligned.
-  if (num_remaining_bits_in_curr_byte_ == 8)
-    return;
-
-  num_remaining_bits_in_curr_byte_ = 0;
-  UpdateCurrByte();
+  // cache_ always ends at a byte boundary of the stream.
+  TakeCachedBits(num_cached_bits_ % 8);
 }
 
 bool BitReader::SkipBytes(size_t num_bytes) {
   if (num_bytes == 0)
     return true;
-  if (num_remaining_bits_in_curr_byte_ != 8)
-    return false;
-
-  data_ += num_bytes - 1;  // One additional byte in curr_byte_.
-  if (num_bytes > bytes_left_ + 1)
+  if (num_cached_bits_ % 8 != 0 || num_bytes * 8 > bits_available())
     return false;
-  bytes_left_ -= num_bytes - 1;
-  num_remaining_bits_in_curr_byte_ = 0;
-  UpdateCurrByte();
-  return true;
+  return SkipBits(num_bytes * 8);
 }
 
 bool BitReader::ReadBitsInternal(size_t num_bits, uint64_t* out) {
   DCHECK_LE(num_bits, 64u);
 
-  *out = 0;
-
-  while (num_remaining_bits_in_curr_byte_ != 0 && num_bits != 0) {
-    size_t bits_to_take = std::min(num_remaining_bits_in_curr_byte_, num_bits);
-
-    *out <<= bits_to_take;
-    *out += curr_byte_ >> (num_remaining_bits_in_curr_byte_ - bits_to_take);
-    num_bits -= bits_to_take;
-    num_remaining_bits_in_curr_byte_ -= bits_to_take;
-    curr_byte_ &= (1 << num_remaining_bits_in_curr_byte_) - 1;
-
-    if (num_remaining_bits_in_curr_byte_ == 0)
-      UpdateCurrByte();
+  if (num_bits <= num_cached_bits_) {
+    *out = TakeCachedBits(num_bits);
+    return true;
   }
-
-  return num_bits == 0;
+  if (num_bits > bits_available()) {
+    SetEndOfStream();
+    *out = 0;
+    return false;
+  }
+  // Less than 64 bits may fit in cache_ at once if it is not byte aligned.
+  const size_t num_high_bits = num_cached_bits_;
+  const uint64_t high_bits = TakeCachedBits(num_high_bits);
+  RefillCache();
+  const size_t num_low_bits = num_bits - num_high_bits;
+  const uint64_t low_bits = TakeCachedBits(num_low_bits);
+  *out = num_low_bits == 64 ? low_bits : (high_bits << num_low_bits) | low_bits;
+  return true;
 }
 
-void BitReader::UpdateCurrByte() {
-  DCHECK_EQ(num_remaining_bits_in_curr_byte_, 0u);
-
-  if (bytes_left_ == 0)
+void BitReader::RefillCache() {
+  if (bytes_left_ >= sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data_, sizeof(word));
+    // The bits of the partially loaded byte are the next bits of the stream,
+    // which are loaded again by the next refill.
+    cache_ |= base::NetToHost64(word) >> num_cached_bits_;
+    const size_t num_bytes = (64 - num_cached_bits_) / 8;
+    data_ += num_bytes;
+    bytes_left_ -= num_bytes;
+    num_cached_bits_ += num_bytes * 8;
     return;
+  }
+  while (bytes_left_ > 0 && num_cached_bits_ <= 56) {
+    cache_ |= static_cast<uint64_t>(*data_) << (56 - num_cached_bits_);
+    ++data_;
+    --bytes_left_;
+    num_cached_bits_ += 8;
+  }
+}
+
+uint64_t BitReader::TakeCachedBits(size_t num_bits) {
+  DCHECK_LE(num_bits, num_cached_bits_);
+  if (num_bits == 0)
+    return 0;
+  const uint64_t bits = cache_ >> (64 - num_bits);
+  cache_ = num_bits == 64 ? 0 : cache_ << num_bits;
+  num_cached_bits_ -= num_bits;
+  return bits;
+}
 
-  // Load a new byte and advance pointers.
-  curr_byte_ = *data_;
-  ++data_;
-  --bytes_left_;
-  num_remaining_bits_in_curr_byte_ = 8;
+void BitReader::SetEndOfStream() {
+  data_ += bytes_left_;
+  bytes_left_ = 0;
+  cache_ = 0;
+  num_cached_bits_ = 0;
 }
 
 }  // namespace media
@@ -86,40 +86,46 @@ class BitReader {
   bool SkipBytes(size_t num_bytes);
 
   /// @return The number of bits available for reading.
-  size_t bits_available() const {
-    return 8 * bytes_left_ + num_remaining_bits_in_curr_byte_;
-  }
+  size_t bits_available() const { return 8 * bytes_left_ + num_cached_bits_; }
 
   /// @return The current bit position.
   size_t bit_position() const { return 8 * initial_size_ - bits_available(); }
 
   /// @return A pointer to the current byte.
-  const uint8_t* current_byte_ptr() const { return data_ - 1; }
+  const uint8_t* current_byte_ptr() const {
+    return data_ - (num_cached_bits_ + 7) / 8;
+  }
 
  private:
   // Help function used by ReadBits to avoid inlining the bit reading logic.
   bool ReadBitsInternal(size_t num_bits, uint64_t* out);
 
-  // Advance to the next byte, loading it into curr_byte_.
-  // If the num_remaining_bits_in_curr_byte_ is 0 after this function returns,
-  // the stream has reached the end.
-  void UpdateCurrByte();
+  // Loads as many whole bytes as fit into cache_, with a single 64-bit load
+  // if at least 8 bytes are left.
+  void RefillCache();
+
+  // Takes |num_bits| (at most num_cached_bits_) from cache_.
+  uint64_t TakeCachedBits(size_t num_bits);
+
+  // Drops all the bits left, after a read or skip past the end of the stream.
+  void SetEndOfStream();
 
-  // Pointer to the next unread (not in curr_byte_) byte in the stream.
+  // Pointer to the next byte in the stream not loaded into cache_.
   const uint8_t* data_;
 
   // Initial size of the input data.
   size_t initial_size_;
 
-  // Bytes left in the stream (without the curr_byte_).
+  // Bytes left in the stream (without the bytes in cache_).
   size_t bytes_left_;
 
-  // Contents of the current byte; first unread bit starting at position
-  // 8 - num_remaining_bits_in_curr_byte_ from MSB.
-  uint8_t curr_byte_;
+  // The next bits of the stream, first unread bit at the MSB. The bits after
+  // the first num_cached_bits_ are either zeros or the following bits of the
+  // stream, so a refill can OR the next bytes in.
+  uint64_t cache_;
 
-  // Number of bits remaining in curr_byte_
-  size_t num_remaining_bits_in_curr_byte_;
+  // Number of bits available in cache_.
+  size_t num_cached_bits_;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(BitReader);
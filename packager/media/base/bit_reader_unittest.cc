@@ -37,6 +37,31 @@ TEST(BitReaderTest, NormalOperationTest) {
   EXPECT_TRUE(reader2.ReadBits(0, &value8));
 }
 
+TEST(BitReaderTest, ReadBitsAcrossCachedWords) {
+  uint8_t value8;
+  uint16_t value16;
+  uint64_t value64;
+  uint8_t buffer[24];
+  for (size_t i = 0; i < sizeof(buffer); ++i)
+    buffer[i] = static_cast<uint8_t>(0x11 + i);
+  BitReader reader(buffer, sizeof(buffer));
+
+  EXPECT_TRUE(reader.ReadBits(3, &value8));
+  EXPECT_EQ(0, value8);
+  // Spans 9 bytes.
+  EXPECT_TRUE(reader.ReadBits(64, &value64));
+  EXPECT_EQ(0x889098a0a8b0b8c0ull, value64);
+  EXPECT_TRUE(reader.ReadBits(13, &value16));
+  EXPECT_EQ(0x191a, value16);
+  EXPECT_EQ(112u, reader.bits_available());
+  EXPECT_TRUE(reader.SkipBits(64));
+  EXPECT_EQ(buffer + 18, reader.current_byte_ptr());
+  EXPECT_TRUE(reader.ReadBits(8, &value8));
+  EXPECT_EQ(0x23, value8);
+  EXPECT_FALSE(reader.ReadBits(64, &value64));
+  EXPECT_EQ(0u, reader.bits_available());
+}
+
 TEST(BitReaderTest, ReadBeyondEndTest) {
   uint8_t value8;
   uint8_t buffer[] = {0x12};
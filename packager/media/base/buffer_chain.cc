@@ -0,0 +1,89 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/buffer_chain.h"
+
+#include "packager/base/logging.h"
+#include "packager/file/file.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/status_macros.h"
+
+namespace shaka {
+namespace media {
+
+BufferChain::BufferChain() {}
+BufferChain::~BufferChain() {}
+
+void BufferChain::AppendBuffer(BufferWriter* buffer) {
+  DCHECK(buffer);
+  if (buffer->Size() == 0)
+    return;
+  std::shared_ptr<std::vector<uint8_t>> data(new std::vector<uint8_t>);
+  buffer->SwapBuffer(data.get());
+  const size_t size = data->size();
+  // The block shares the ownership of the vector.
+  AppendSharedData(std::shared_ptr<const uint8_t>(data, data->data()), size);
+}
+
+void BufferChain::AppendSharedData(std::shared_ptr<const uint8_t> data,
+                                   size_t size) {
+  if (size == 0)
+    return;
+  DCHECK(data);
+  blocks_.push_back({std::move(data), size});
+  size_ += size;
+}
+
+void BufferChain::AppendChain(const BufferChain& chain) {
+  blocks_.insert(blocks_.end(), chain.blocks_.begin(), chain.blocks_.end());
+  size_ += chain.size_;
+}
+
+void BufferChain::Clear() {
+  blocks_.clear();
+  size_ = 0;
+}
+
+void BufferChain::VisitBlocks(
+    const std::function<void(const uint8_t* data, size_t size)>& visitor)
+    const {
+  for (const Block& block : blocks_)
+    visitor(block.data.get(), block.size);
+}
+
+Status BufferChain::WriteToFile(size_t offset, File* file) const {
+  DCHECK(file);
+  DCHECK_LE(offset, size_);
+
+  std::vector<SharedBuffer> buffers;
+  size_t block_offset = 0;
+  for (const Block& block : blocks_) {
+    if (block_offset + block.size > offset) {
+      const size_t skipped_size = offset > block_offset ? offset - block_offset
+                                                        : 0;
+      // Shares the ownership of the block.
+      buffers.push_back({std::shared_ptr<const uint8_t>(
+                             block.data, block.data.get() + skipped_size),
+                         block.size - skipped_size});
+    }
+    block_offset += block.size;
+  }
+  if (buffers.empty())
+    return Status::OK;
+
+  if (file->WriteShared(buffers) != static_cast<int64_t>(size_ - offset))
+    return Status(error::FILE_FAILURE, "Fail to write to file in BufferChain");
+  return Status::OK;
+}
+
+Status BufferChain::WriteToFile(File* file) {
+  RETURN_IF_ERROR(WriteToFile(0, file));
+  Clear();
+  return Status::OK;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,83 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_BUFFER_CHAIN_H_
+#define PACKAGER_MEDIA_BASE_BUFFER_CHAIN_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/status.h"
+
+namespace shaka {
+
+class File;
+
+namespace media {
+
+class BufferWriter;
+
+/// A sequence of reference counted data blocks, e.g. box headers and sample
+/// data, which is written to file with File::WriteShared() without
+/// concatenating the blocks first.
+class BufferChain {
+ public:
+  BufferChain();
+  ~BufferChain();
+
+  /// Append the content of @a buffer, which is taken over without copying.
+  /// @a buffer is empty afterwards.
+  void AppendBuffer(BufferWriter* buffer);
+
+  /// Append a reference to @a data. No data copying is involved. The data must
+  /// not be modified afterwards.
+  /// @param data points to the data to append.
+  /// @param size is the size of @a data in bytes.
+  void AppendSharedData(std::shared_ptr<const uint8_t> data, size_t size);
+
+  /// Append the references in @a chain.
+  void AppendChain(const BufferChain& chain);
+
+  void Clear();
+  size_t Size() const { return size_; }
+
+  /// Call @a visitor with each block of data, in order.
+  void VisitBlocks(
+      const std::function<void(const uint8_t* data, size_t size)>& visitor)
+      const;
+
+  /// Write the data from @a offset to the end to file. The chain is not
+  /// modified.
+  /// @param offset should not be larger than Size().
+  /// @param file should not be NULL.
+  /// @return OK on success.
+  Status WriteToFile(size_t offset, File* file) const;
+
+  /// Write the data to file. The chain will be cleared after writing.
+  /// @param file should not be NULL.
+  /// @return OK on success.
+  Status WriteToFile(File* file);
+
+ private:
+  struct Block {
+    std::shared_ptr<const uint8_t> data;
+    size_t size;
+  };
+
+  std::vector<Block> blocks_;
+  size_t size_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(BufferChain);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_BUFFER_CHAIN_H_
@@ -0,0 +1,101 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/buffer_chain.h"
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+
+#include "packager/base/files/file_util.h"
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const char kHeader[] = "header";
+const char kSample1[] = "first sample";
+const char kSample2[] = "second sample";
+const char kMemoryFileName[] = "memory://buffer_chain";
+
+std::shared_ptr<const uint8_t> MakeSharedData(const char* data) {
+  const size_t size = strlen(data);
+  std::shared_ptr<uint8_t> shared_data(new uint8_t[size],
+                                       std::default_delete<uint8_t[]>());
+  memcpy(shared_data.get(), data, size);
+  return shared_data;
+}
+}  // namespace
+
+class BufferChainTest : public testing::Test {
+ public:
+  void SetUp() override {
+    BufferWriter header;
+    header.AppendString(kHeader);
+    chain_.AppendBuffer(&header);
+    EXPECT_EQ(0u, header.Size());
+
+    BufferChain samples;
+    samples.AppendSharedData(MakeSharedData(kSample1), strlen(kSample1));
+    samples.AppendSharedData(nullptr, 0);
+    samples.AppendSharedData(MakeSharedData(kSample2), strlen(kSample2));
+    chain_.AppendChain(samples);
+    expected_ = std::string(kHeader) + kSample1 + kSample2;
+  }
+
+  void TearDown() override { File::Delete(kMemoryFileName); }
+
+ protected:
+  BufferChain chain_;
+  std::string expected_;
+};
+
+TEST_F(BufferChainTest, WriteToLocalFile) {
+  base::FilePath path;
+  ASSERT_TRUE(base::CreateTemporaryFile(&path));
+  const std::string file_name = path.AsUTF8Unsafe();
+
+  // Without buffering, the chain is written with writev() where available.
+  std::unique_ptr<File, FileCloser> file(
+      File::OpenWithNoBuffering(file_name.c_str(), "w"));
+  ASSERT_TRUE(file);
+  ASSERT_EQ(3, file->Write("pre", 3));
+  ASSERT_EQ(expected_.size(), chain_.Size());
+  ASSERT_OK(chain_.WriteToFile(file.get()));
+  EXPECT_EQ(0u, chain_.Size());
+  ASSERT_EQ(4, file->Write("post", 4));
+  ASSERT_TRUE(file.release()->Close());
+
+  std::string content;
+  ASSERT_TRUE(File::ReadFileToString(file_name.c_str(), &content));
+  EXPECT_EQ("pre" + expected_ + "post", content);
+  base::DeleteFile(path, false);
+}
+
+TEST_F(BufferChainTest, WriteToFileFromOffset) {
+  // Offsets in the first block, at a block boundary and in the last block.
+  for (size_t offset : {size_t(2), strlen(kHeader), expected_.size() - 1}) {
+    std::unique_ptr<File, FileCloser> file(File::Open(kMemoryFileName, "w"));
+    ASSERT_TRUE(file);
+    ASSERT_OK(chain_.WriteToFile(offset, file.get()));
+    ASSERT_TRUE(file.release()->Close());
+
+    std::string content;
+    ASSERT_TRUE(File::ReadFileToString(kMemoryFileName, &content));
+    EXPECT_EQ(expected_.substr(offset), content);
+  }
+  // The chain is not modified.
+  EXPECT_EQ(expected_.size(), chain_.Size());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -6,6 +6,8 @@
 
 #include "packager/media/base/buffer_writer.h"
 
+#include <algorithm>
+
 #include "packager/base/logging.h"
 #include "packager/base/sys_byteorder.h"
 #include "packager/file/file.h"
@@ -67,6 +69,19 @@ void BufferWriter::AppendBuffer(const BufferWriter& buffer) {
   buf_.insert(buf_.end(), buffer.buf_.begin(), buffer.buf_.end());
 }
 
+uint8_t* BufferWriter::Grow(size_t size) {
+  const size_t old_size = buf_.size();
+  buf_.resize(old_size + size);
+  return buf_.data() + old_size;
+}
+
+void BufferWriter::Reserve(size_t size) {
+  const size_t required_capacity = buf_.size() + size;
+  // Grow geometrically so that repeated reservations stay amortized O(1).
+  if (required_capacity > buf_.capacity())
+    buf_.reserve(std::max(required_capacity, 2 * buf_.capacity()));
+}
+
 Status BufferWriter::WriteToFile(File* file) {
   DCHECK(file);
   DCHECK(!buf_.empty());
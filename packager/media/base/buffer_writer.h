@@ -52,6 +52,16 @@ class BufferWriter {
   void AppendArray(const uint8_t* buf, size_t size);
   void AppendBuffer(const BufferWriter& buffer);
 
+  /// Grow the buffer by @a size bytes, which are to be written in place by the
+  /// caller.
+  /// @return A pointer to the new bytes. It is invalidated by the next call
+  ///         that modifies the buffer.
+  uint8_t* Grow(size_t size);
+
+  /// Make sure that @a size more bytes can be appended without reallocating
+  /// the buffer.
+  void Reserve(size_t size);
+
   void Swap(BufferWriter* buffer) { buf_.swap(buffer->buf_); }
   void SwapBuffer(std::vector<uint8_t>* buffer) { buf_.swap(*buffer); }
 
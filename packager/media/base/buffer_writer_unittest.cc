@@ -148,6 +148,20 @@ TEST_F(BufferWriterTest, AppendBufferWriter) {
   ASSERT_NO_FATAL_FAILURE(ReadAndExpect(kuint32));
 }
 
+TEST_F(BufferWriterTest, Grow) {
+  writer_->AppendInt(kuint16);
+  uint8_t* data = writer_->Grow(sizeof(kuint8Array));
+  memcpy(data, kuint8Array, sizeof(kuint8Array));
+  ASSERT_EQ(sizeof(kuint16) + sizeof(kuint8Array), writer_->Size());
+
+  CreateReader();
+  ASSERT_NO_FATAL_FAILURE(ReadAndExpect(kuint16));
+  std::vector<uint8_t> data_read;
+  ASSERT_TRUE(reader_->ReadToVector(&data_read, sizeof(kuint8Array)));
+  for (size_t i = 0; i < sizeof(kuint8Array); ++i)
+    EXPECT_EQ(kuint8Array[i], data_read[i]);
+}
+
 TEST_F(BufferWriterTest, Swap) {
   BufferWriter local_writer;
   local_writer.AppendInt(kuint16);
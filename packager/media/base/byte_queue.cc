@@ -31,8 +31,15 @@ void ByteQueue::Push(const uint8_t* data, int size) {
 
   size_t size_needed = used_ + size;
 
-  // Check to see if we need a bigger buffer.
-  if (size_needed > size_) {
+  // Check to see if we need a bigger buffer. Moving the data to the front of
+  // the buffer only pays off if it frees at least as many bytes as it moves.
+  // Otherwise, e.g. with a large 'mdat' box buffered and little data popped,
+  // the same data would be moved again on almost every push, so the buffer
+  // grows instead. Either way the bytes copied are amortized over the bytes
+  // pushed.
+  const bool data_needs_moving = offset_ + used_ + size > size_;
+  if (size_needed > size_ ||
+      (data_needs_moving && static_cast<size_t>(used_) > offset_)) {
     size_t new_size = 2 * size_;
     while (size_needed > new_size && new_size > size_)
       new_size *= 2;
@@ -49,7 +56,7 @@ void ByteQueue::Push(const uint8_t* data, int size) {
     buffer_.reset(new_buffer.release());
     size_ = new_size;
     offset_ = 0;
-  } else if ((offset_ + used_ + size) > size_) {
+  } else if (data_needs_moving) {
     // The buffer is big enough, but we need to move the data in the queue.
     memmove(buffer_.get(), front(), used_);
     offset_ = 0;
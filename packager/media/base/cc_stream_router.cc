@@ -0,0 +1,120 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/cc_stream_router.h"
+
+#include "packager/media/base/stream_info.h"
+#include "packager/media/base/text_sample.h"
+#include "packager/media/base/text_stream_info.h"
+
+namespace shaka {
+namespace media {
+
+CcStreamRouter::CcStreamRouter(const std::vector<Output>& outputs)
+    : outputs_(outputs) {
+  for (size_t i = 0; i < outputs_.size(); ++i) {
+    all_outputs_.push_back(i);
+    if (outputs_[i].cc_index < 0)
+      unfiltered_outputs_.push_back(i);
+  }
+  // The outputs of each sub-stream are kept in the order of their indices,
+  // as with the Replicator.
+  for (const Output& output : outputs_) {
+    if (output.cc_index < 0 || sub_stream_outputs_.count(output.cc_index))
+      continue;
+    std::vector<size_t>& sub_stream_outputs =
+        sub_stream_outputs_[output.cc_index];
+    for (size_t i = 0; i < outputs_.size(); ++i) {
+      if (outputs_[i].cc_index < 0 || outputs_[i].cc_index == output.cc_index)
+        sub_stream_outputs.push_back(i);
+    }
+  }
+}
+
+Status CcStreamRouter::InitializeInternal() {
+  if (output_handlers().size() != outputs_.size()) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Expecting " + std::to_string(outputs_.size()) +
+                      " outputs in CcStreamRouter.");
+  }
+  return Status::OK;
+}
+
+Status CcStreamRouter::Process(std::unique_ptr<StreamData> stream_data) {
+  switch (stream_data->stream_data_type) {
+    case StreamDataType::kTextSample: {
+      const int32_t sub_stream_index =
+          stream_data->text_sample()->sub_stream_index();
+      if (sub_stream_index == -1)
+        return DispatchTo(all_outputs_, std::move(stream_data));
+      auto it = sub_stream_outputs_.find(sub_stream_index);
+      return DispatchTo(it != sub_stream_outputs_.end() ? it->second
+                                                        : unfiltered_outputs_,
+                        std::move(stream_data));
+    }
+    case StreamDataType::kStreamInfo:
+      if (stream_data->stream_info()->stream_type() == kStreamText)
+        return ProcessStreamInfo(std::move(stream_data));
+      return DispatchTo(all_outputs_, std::move(stream_data));
+    default:
+      return DispatchTo(all_outputs_, std::move(stream_data));
+  }
+}
+
+bool CcStreamRouter::ValidateOutputStreamIndex(size_t stream_index) const {
+  return stream_index < outputs_.size();
+}
+
+Status CcStreamRouter::OnFlushRequest(size_t input_stream_index) {
+  DCHECK_EQ(input_stream_index, 0u);
+  return FlushAllDownstreams();
+}
+
+Status CcStreamRouter::DispatchTo(const std::vector<size_t>& output_indices,
+                                  std::unique_ptr<StreamData> stream_data) {
+  Status status;
+  size_t outputs_left = output_indices.size();
+  for (size_t output_index : output_indices) {
+    // The last output gets the original message, as with the Replicator.
+    std::unique_ptr<StreamData> copy =
+        --outputs_left == 0
+            ? std::move(stream_data)
+            : std::unique_ptr<StreamData>(new StreamData(*stream_data));
+    copy->stream_index = output_index;
+    status.Update(Dispatch(std::move(copy)));
+  }
+  return status;
+}
+
+Status CcStreamRouter::ProcessStreamInfo(
+    std::unique_ptr<StreamData> stream_data) {
+  Status status;
+  for (size_t i = 0; i < outputs_.size(); ++i) {
+    const Output& output = outputs_[i];
+    std::shared_ptr<const StreamInfo> stream_info = stream_data->stream_info();
+    if (output.cc_index >= 0) {
+      // Overwrite the per-input-stream language with our per-output-stream
+      // language; this requires cloning the stream info as it is used by
+      // other output streams.
+      auto clone = stream_info->Clone();
+      if (!output.language.empty()) {
+        clone->set_language(output.language);
+      } else {
+        // Try to find the language in the sub-stream info.
+        auto* text_info = static_cast<TextStreamInfo*>(clone.get());
+        auto it = text_info->sub_streams().find(output.cc_index);
+        if (it != text_info->sub_streams().end())
+          clone->set_language(it->second.language);
+      }
+      stream_info = std::move(clone);
+    }
+    status.Update(Dispatch(StreamData::FromStreamInfo(i, stream_info)));
+  }
+  return status;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,69 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_CC_STREAM_ROUTER_H_
+#define PACKAGER_MEDIA_BASE_CC_STREAM_ROUTER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "packager/media/base/media_handler.h"
+#include "packager/status.h"
+
+namespace shaka {
+namespace media {
+
+/// A media handler that routes the text samples of a stream to its outputs
+/// based on their sub-stream index, i.e. the cc_index field of the outputs.
+/// Some text formats allow multiple "channels" per stream, e.g. the pages of
+/// DVB subtitles; each text sample is only passed to the outputs of its
+/// channel, so the cost per sample does not grow with the number of channels.
+/// The other stream data is passed to all the outputs, like with Replicator.
+class CcStreamRouter : public MediaHandler {
+ public:
+  /// The settings of an output, in the order of the output stream indices.
+  struct Output {
+    /// The language of the output, which overrides the language of the
+    /// sub-stream if not empty.
+    std::string language;
+    /// The sub-stream index of the samples of the output, or -1 for all the
+    /// samples.
+    int32_t cc_index = -1;
+  };
+
+  explicit CcStreamRouter(const std::vector<Output>& outputs);
+  ~CcStreamRouter() override = default;
+
+ protected:
+  Status InitializeInternal() override;
+  Status Process(std::unique_ptr<StreamData> stream_data) override;
+  bool ValidateOutputStreamIndex(size_t stream_index) const override;
+  Status OnFlushRequest(size_t input_stream_index) override;
+
+ private:
+  CcStreamRouter(const CcStreamRouter&) = delete;
+  CcStreamRouter& operator=(const CcStreamRouter&) = delete;
+
+  // Passes |stream_data| to the outputs at |output_indices|.
+  Status DispatchTo(const std::vector<size_t>& output_indices,
+                    std::unique_ptr<StreamData> stream_data);
+  Status ProcessStreamInfo(std::unique_ptr<StreamData> stream_data);
+
+  const std::vector<Output> outputs_;
+  // The indices of all the outputs.
+  std::vector<size_t> all_outputs_;
+  // The indices of the outputs of all the samples, i.e. with no cc_index.
+  std::vector<size_t> unfiltered_outputs_;
+  // The indices of the outputs of the samples of each sub-stream, including
+  // the unfiltered outputs.
+  std::map<int32_t, std::vector<size_t>> sub_stream_outputs_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_CC_STREAM_ROUTER_H_
@@ -0,0 +1,98 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/cc_stream_router.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/media/base/media_handler_test_base.h"
+#include "packager/media/base/text_stream_info.h"
+#include "packager/status_test_util.h"
+
+using ::testing::_;
+
+namespace shaka {
+namespace media {
+
+namespace {
+const size_t kStreamIndex = 0;
+const uint32_t kTimeScale = 1000;
+const int64_t kStart = 0;
+const int64_t kEnd = 1000;
+const char kId[] = "id";
+const char kPayload[] = "payload";
+const bool kEncrypted = true;
+}  // namespace
+
+class CcStreamRouterTest : public MediaHandlerTestBase {
+ protected:
+  // Sets up a router with an output for each of |cc_indices|.
+  void SetUpRouter(const std::vector<int32_t>& cc_indices) {
+    std::vector<CcStreamRouter::Output> outputs;
+    for (int32_t cc_index : cc_indices) {
+      CcStreamRouter::Output output;
+      output.language = cc_index == 2 ? "fr" : "";
+      output.cc_index = cc_index;
+      outputs.push_back(output);
+    }
+    ASSERT_OK(SetUpAndInitializeGraph(std::make_shared<CcStreamRouter>(outputs),
+                                      1, cc_indices.size()));
+  }
+
+  Status DispatchTextSample(int32_t sub_stream_index) {
+    std::unique_ptr<TextSample> sample =
+        GetTextSample(kId, kStart, kEnd, kPayload);
+    sample->set_sub_stream_index(sub_stream_index);
+    return Input(0)->Dispatch(
+        StreamData::FromTextSample(kStreamIndex, std::move(sample)));
+  }
+};
+
+TEST_F(CcStreamRouterTest, RoutesTextSamplesBySubStream) {
+  SetUpRouter({1, 2, -1});
+
+  EXPECT_CALL(*Output(0), OnProcess(IsTextSample(0, kId, kStart, kEnd)))
+      .Times(2);
+  EXPECT_CALL(*Output(1), OnProcess(IsTextSample(1, kId, kStart, kEnd)))
+      .Times(2);
+  EXPECT_CALL(*Output(2), OnProcess(IsTextSample(2, kId, kStart, kEnd)))
+      .Times(4);
+
+  ASSERT_OK(DispatchTextSample(1));
+  ASSERT_OK(DispatchTextSample(2));
+  // Without a sub-stream, the samples go to all the outputs.
+  ASSERT_OK(DispatchTextSample(-1));
+  // Unknown sub-streams only go to the unfiltered outputs.
+  ASSERT_OK(DispatchTextSample(3));
+}
+
+TEST_F(CcStreamRouterTest, SetsLanguageOfSubStreams) {
+  SetUpRouter({1, 2, -1});
+
+  std::unique_ptr<StreamInfo> info = GetTextStreamInfo(kTimeScale);
+  info->set_language("en");
+  TextSubStreamInfo sub_stream;
+  sub_stream.language = "de";
+  static_cast<TextStreamInfo*>(info.get())->AddSubStream(1, sub_stream);
+
+  EXPECT_CALL(*Output(0),
+              OnProcess(IsStreamInfo(0, kTimeScale, !kEncrypted, "de")));
+  EXPECT_CALL(*Output(1),
+              OnProcess(IsStreamInfo(1, kTimeScale, !kEncrypted, "fr")));
+  EXPECT_CALL(*Output(2),
+              OnProcess(IsStreamInfo(2, kTimeScale, !kEncrypted, "en")));
+  EXPECT_CALL(*Output(0), OnFlush(0));
+  EXPECT_CALL(*Output(1), OnFlush(1));
+  EXPECT_CALL(*Output(2), OnFlush(2));
+
+  ASSERT_OK(Input(0)->Dispatch(
+      StreamData::FromStreamInfo(kStreamIndex, std::move(info))));
+  ASSERT_OK(Input(0)->FlushAllDownstreams());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -1651,6 +1651,7 @@ bool CheckTtml(const uint8_t* buffer, int buffer_size) {
   // Make sure that it can be parsed so that it doesn't error later in the
   // process. Not doing a schema check to allow TTMLs that makes some sense but
   // not necessarily compliant to the schema.
+  xml::InitializeLibXml();
   xml::scoped_xml_ptr<xmlDoc> doc(
       xmlParseMemory(reinterpret_cast<const char*>(buffer), buffer_size));
   if (!doc)
@@ -1662,6 +1663,37 @@ bool CheckTtml(const uint8_t* buffer, int buffer_size) {
   return root_node_name == "tt";
 }
 
+// Run only the probe of |hint|, i.e. the container suggested by the file name.
+// Returns the container found, which matches what the full probe chain in
+// DetermineContainer() reports for the same data, or CONTAINER_UNKNOWN.
+MediaContainerName CheckHintedContainer(MediaContainerName hint,
+                                        const uint8_t* buffer,
+                                        int buffer_size) {
+  switch (hint) {
+    case CONTAINER_MOV:
+      return CheckMov(buffer, buffer_size) ? CONTAINER_MOV : CONTAINER_UNKNOWN;
+    case CONTAINER_MPEG2TS:
+      return CheckMpeg2TransportStream(buffer, buffer_size)
+                 ? CONTAINER_MPEG2TS
+                 : CONTAINER_UNKNOWN;
+    case CONTAINER_WVM:
+      // WVM files are reported as MPEG2PS, see Demuxer::InitializeParser().
+      return CheckMpeg2ProgramStream(buffer, buffer_size) ? CONTAINER_MPEG2PS
+                                                          : CONTAINER_UNKNOWN;
+    case CONTAINER_WEBM:
+      return CheckWebm(buffer, buffer_size) ? CONTAINER_WEBM
+                                            : CONTAINER_UNKNOWN;
+    case CONTAINER_WEBVTT:
+      return CheckWebVtt(buffer, buffer_size) ? CONTAINER_WEBVTT
+                                              : CONTAINER_UNKNOWN;
+    case CONTAINER_TTML:
+      return CheckTtml(buffer, buffer_size) ? CONTAINER_TTML
+                                            : CONTAINER_UNKNOWN;
+    default:
+      return CONTAINER_UNKNOWN;
+  }
+}
+
 }  // namespace
 
 // Attempt to determine the container name from the buffer provided.
@@ -1724,6 +1756,18 @@ MediaContainerName DetermineContainer(const uint8_t* buffer, int buffer_size) {
   return CONTAINER_UNKNOWN;
 }
 
+MediaContainerName DetermineContainer(const uint8_t* buffer,
+                                      int buffer_size,
+                                      MediaContainerName hint) {
+  DCHECK(buffer);
+
+  const MediaContainerName result =
+      CheckHintedContainer(hint, buffer, buffer_size);
+  if (result != CONTAINER_UNKNOWN)
+    return result;
+  return DetermineContainer(buffer, buffer_size);
+}
+
 MediaContainerName DetermineContainerFromFormatName(
     const std::string& format_name) {
   if (base::EqualsCaseInsensitiveASCII(format_name, "aac") ||
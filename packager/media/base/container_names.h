@@ -62,6 +62,15 @@ enum MediaContainerName {
 /// Determine the container type from input data.
 MediaContainerName DetermineContainer(const uint8_t* buffer, int buffer_size);
 
+/// Determine the container type from input data, trying the probe of the
+/// expected container first.
+/// @param hint Specifies the expected container, e.g. the container derived
+///        from the file name. The full set of probes is run only if the data
+///        does not match it.
+MediaContainerName DetermineContainer(const uint8_t* buffer,
+                                      int buffer_size,
+                                      MediaContainerName hint);
+
 /// Determine the container type from the format name.
 /// @param format_name Specifies the format, e.g. 'webm', 'mov', 'mp4'.
 MediaContainerName DetermineContainerFromFormatName(
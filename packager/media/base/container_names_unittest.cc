@@ -200,6 +200,24 @@ TEST(ContainerNamesTest, WebVtt) {
                 static_cast<int>(webvtt_with_utf8_byte_order_mark.size())));
 }
 
+TEST(ContainerNamesTest, WithHint) {
+  const char kWebVtt[] =
+      "WEBVTT\n"
+      "\n"
+      "00:1.000 --> 00:2.000\n"
+      "Subtitle";
+  const uint8_t* buffer = reinterpret_cast<const uint8_t*>(kWebVtt);
+  const int buffer_size = arraysize(kWebVtt);
+
+  EXPECT_EQ(CONTAINER_WEBVTT,
+            DetermineContainer(buffer, buffer_size, CONTAINER_WEBVTT));
+  // A wrong hint falls back to the full set of probes.
+  EXPECT_EQ(CONTAINER_WEBVTT,
+            DetermineContainer(buffer, buffer_size, CONTAINER_MPEG2TS));
+  EXPECT_EQ(CONTAINER_WEBVTT,
+            DetermineContainer(buffer, buffer_size, CONTAINER_UNKNOWN));
+}
+
 TEST(ContainerNamesTest, FileCheckOGG) {
   TestFile(CONTAINER_OGG, GetTestDataFilePath("bear.ogv"));
   TestFile(CONTAINER_OGG, GetTestDataFilePath("9ch.ogg"));
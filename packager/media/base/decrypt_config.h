@@ -12,6 +12,7 @@
 
 #include "packager/base/macros.h"
 #include "packager/media/base/fourccs.h"
+#include "packager/media/base/object_pool.h"
 
 namespace shaka {
 namespace media {
@@ -36,8 +37,9 @@ struct SubsampleEntry {
 };
 
 /// Contains all the information that a decryptor needs to decrypt a media
-/// sample.
-class DecryptConfig {
+/// sample. DecryptConfig objects are allocated from a thread local pool, see
+/// PooledObject.
+class DecryptConfig : public PooledObject<DecryptConfig> {
  public:
   /// Keys are always 128 bits.
   static const size_t kDecryptionKeySize = 16;
@@ -35,25 +35,93 @@ bool DecryptorSource::DecryptSampleBuffer(const DecryptConfig* decrypt_config,
                                           const uint8_t* encrypted_buffer,
                                           size_t buffer_size,
                                           uint8_t* decrypted_buffer) {
+  return CryptSampleBuffer(decrypt_config, encrypted_buffer, buffer_size,
+                           nullptr, decrypted_buffer);
+}
+
+bool DecryptorSource::ReencryptSampleBuffer(
+    const DecryptConfig* decrypt_config,
+    const uint8_t* encrypted_buffer,
+    size_t buffer_size,
+    AesCryptor* encryptor,
+    uint8_t* reencrypted_buffer) {
+  DCHECK(encryptor);
+  return CryptSampleBuffer(decrypt_config, encrypted_buffer, buffer_size,
+                           encryptor, reencrypted_buffer);
+}
+
+bool DecryptorSource::CryptSampleBuffer(const DecryptConfig* decrypt_config,
+                                        const uint8_t* encrypted_buffer,
+                                        size_t buffer_size,
+                                        AesCryptor* encryptor,
+                                        uint8_t* output_buffer) {
   DCHECK(decrypt_config);
   DCHECK(encrypted_buffer);
-  DCHECK(decrypted_buffer);
+  DCHECK(output_buffer);
 
-  if (CheckMemoryOverlap(encrypted_buffer, buffer_size, decrypted_buffer)) {
+  if (CheckMemoryOverlap(encrypted_buffer, buffer_size, output_buffer)) {
     LOG(ERROR) << "Encrypted buffer and decrypted buffer cannot overlap.";
     return false;
   }
 
+  AesCryptor* decryptor = GetDecryptor(decrypt_config);
+  if (!decryptor)
+    return false;
+
+  // The decrypted data is encrypted again while it is still in cache.
+  auto crypt = [decryptor, encryptor](const uint8_t* source, size_t size,
+                                      uint8_t* dest) {
+    if (!decryptor->Crypt(source, size, dest))
+      return false;
+    return !encryptor || encryptor->Crypt(dest, size, dest);
+  };
+
+  if (decrypt_config->subsamples().empty()) {
+    // Sample not encrypted using subsample encryption. Decrypt whole.
+    if (!crypt(encrypted_buffer, buffer_size, output_buffer)) {
+      LOG(ERROR) << "Error during bulk sample decryption.";
+      return false;
+    }
+    return true;
+  }
+
+  // Subsample decryption.
+  const std::vector<SubsampleEntry>& subsamples = decrypt_config->subsamples();
+  const uint8_t* current_ptr = encrypted_buffer;
+  const uint8_t* const buffer_end = encrypted_buffer + buffer_size;
+  for (const auto& subsample : subsamples) {
+    if ((current_ptr + subsample.clear_bytes + subsample.cipher_bytes) >
+        buffer_end) {
+      LOG(ERROR) << "Subsamples overflow sample buffer.";
+      return false;
+    }
+    memcpy(output_buffer, current_ptr, subsample.clear_bytes);
+    current_ptr += subsample.clear_bytes;
+    output_buffer += subsample.clear_bytes;
+    if (!crypt(current_ptr, subsample.cipher_bytes, output_buffer)) {
+      LOG(ERROR) << "Error decrypting subsample buffer.";
+      return false;
+    }
+    current_ptr += subsample.cipher_bytes;
+    output_buffer += subsample.cipher_bytes;
+  }
+  return true;
+}
+
+AesCryptor* DecryptorSource::GetDecryptor(const DecryptConfig* decrypt_config) {
   // Get the decryptor object.
   AesCryptor* decryptor = nullptr;
-  auto found = decryptor_map_.find(decrypt_config->key_id());
+  const DecryptorKey decryptor_key(
+      decrypt_config->key_id(), decrypt_config->protection_scheme(),
+      decrypt_config->crypt_byte_block(), decrypt_config->skip_byte_block());
+  auto found = decryptor_map_.find(decryptor_key);
   if (found == decryptor_map_.end()) {
     // Create new AesDecryptor based on decryption mode.
     EncryptionKey key;
     Status status(key_source_->GetKey(decrypt_config->key_id(), &key));
     if (!status.ok()) {
       LOG(ERROR) << "Error retrieving decryption key: " << status;
-      return false;
+      return nullptr;
     }
 
     std::unique_ptr<AesCryptor> aes_decryptor;
@@ -83,54 +151,23 @@ bool DecryptorSource::DecryptSampleBuffer(const DecryptConfig* decrypt_config,
       default:
         LOG(ERROR) << "Unsupported protection scheme: "
                    << decrypt_config->protection_scheme();
-        return false;
+        return nullptr;
     }
 
     if (!aes_decryptor->InitializeWithIv(key.key, decrypt_config->iv())) {
       LOG(ERROR) << "Failed to initialize AesDecryptor for decryption.";
-      return false;
+      return nullptr;
     }
     decryptor = aes_decryptor.get();
-    decryptor_map_[decrypt_config->key_id()] = std::move(aes_decryptor);
+    decryptor_map_[decryptor_key] = std::move(aes_decryptor);
   } else {
     decryptor = found->second.get();
   }
   if (!decryptor->SetIv(decrypt_config->iv())) {
     LOG(ERROR) << "Invalid initialization vector.";
-    return false;
-  }
-
-  if (decrypt_config->subsamples().empty()) {
-    // Sample not encrypted using subsample encryption. Decrypt whole.
-    if (!decryptor->Crypt(encrypted_buffer, buffer_size, decrypted_buffer)) {
-      LOG(ERROR) << "Error during bulk sample decryption.";
-      return false;
-    }
-    return true;
-  }
-
-  // Subsample decryption.
-  const std::vector<SubsampleEntry>& subsamples = decrypt_config->subsamples();
-  const uint8_t* current_ptr = encrypted_buffer;
-  const uint8_t* const buffer_end = encrypted_buffer + buffer_size;
-  for (const auto& subsample : subsamples) {
-    if ((current_ptr + subsample.clear_bytes + subsample.cipher_bytes) >
-        buffer_end) {
-      LOG(ERROR) << "Subsamples overflow sample buffer.";
-      return false;
-    }
-    memcpy(decrypted_buffer, current_ptr, subsample.clear_bytes);
-    current_ptr += subsample.clear_bytes;
-    decrypted_buffer += subsample.clear_bytes;
-    if (!decryptor->Crypt(current_ptr, subsample.cipher_bytes,
-                          decrypted_buffer)) {
-      LOG(ERROR) << "Error decrypting subsample buffer.";
-      return false;
-    }
-    current_ptr += subsample.cipher_bytes;
-    decrypted_buffer += subsample.cipher_bytes;
+    return nullptr;
   }
-  return true;
+  return decryptor;
 }
 
 }  // namespace media
@@ -9,6 +9,7 @@
 
 #include <map>
 #include <memory>
+#include <tuple>
 #include <vector>
 
 #include "packager/media/base/aes_decryptor.h"
@@ -40,9 +41,46 @@ class DecryptorSource {
                            size_t buffer_size,
                            uint8_t* decrypted_buffer);
 
+  /// Re-encrypt encrypted buffer with another encryptor, keeping its subsample
+  /// layout. Each subsample is decrypted and encrypted again in a single pass
+  /// into @a reencrypted_buffer, so no clear copy of the buffer is made.
+  /// @param decrypt_config contains decrypt configuration of the encrypted
+  ///        buffer. Its subsamples are also used for the re-encryption.
+  /// @param encrypted_buffer points to the encrypted buffer that is to be
+  ///        re-encrypted. It should not overlap with @a reencrypted_buffer.
+  /// @param buffer_size is the size of encrypted buffer and re-encrypted
+  ///        buffer.
+  /// @param encryptor is the encryptor, initialized with the new key and IV.
+  ///        It must support encrypting in place.
+  /// @param reencrypted_buffer points to the re-encrypted buffer. It should
+  ///        not overlap with @a encrypted_buffer.
+  /// @return true if success, false otherwise.
+  bool ReencryptSampleBuffer(const DecryptConfig* decrypt_config,
+                             const uint8_t* encrypted_buffer,
+                             size_t buffer_size,
+                             AesCryptor* encryptor,
+                             uint8_t* reencrypted_buffer);
+
  private:
+  // Decrypts |encrypted_buffer| into |output_buffer|, and encrypts the
+  // decrypted subsamples in place with |encryptor| if it is not null.
+  bool CryptSampleBuffer(const DecryptConfig* decrypt_config,
+                         const uint8_t* encrypted_buffer,
+                         size_t buffer_size,
+                         AesCryptor* encryptor,
+                         uint8_t* output_buffer);
+  // Returns the decryptor for |decrypt_config|, with its IV set, or null on
+  // error.
+  AesCryptor* GetDecryptor(const DecryptConfig* decrypt_config);
+
+  // Key id, protection scheme, crypt byte block and skip byte block.
+  typedef std::tuple<std::vector<uint8_t>, FourCC, uint8_t, uint8_t>
+      DecryptorKey;
+
   KeySource* key_source_;
-  std::map<std::vector<uint8_t>, std::unique_ptr<AesCryptor>> decryptor_map_;
+  // The decryptors are kept across samples, and only created for a new key or
+  // a new way of using it.
+  std::map<DecryptorKey, std::unique_ptr<AesCryptor>> decryptor_map_;
 
   DISALLOW_COPY_AND_ASSIGN(DecryptorSource);
 };
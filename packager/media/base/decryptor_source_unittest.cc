@@ -10,6 +10,7 @@
 #include <gtest/gtest.h>
 
 #include "packager/base/macros.h"
+#include "packager/media/base/aes_encryptor.h"
 #include "packager/media/base/raw_key_source.h"
 
 using ::testing::Return;
@@ -144,6 +145,52 @@ TEST_F(DecryptorSourceTest, SubsampleDecryption) {
             decrypted_buffer_);
 }
 
+TEST_F(DecryptorSourceTest, SubsampleReencryption) {
+  EncryptionKey encryption_key;
+  encryption_key.key.assign(kMockKey, kMockKey + arraysize(kMockKey));
+  EXPECT_CALL(mock_key_source_, GetKey(key_id_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(encryption_key), Return(Status::OK)));
+
+  const SubsampleEntry kSubsamples[] = {
+    {2, 3},
+    {3, 13},
+  };
+  DecryptConfig decrypt_config(
+      key_id_, std::vector<uint8_t>(kIv, kIv + arraysize(kIv)),
+      std::vector<SubsampleEntry>(kSubsamples,
+                                  kSubsamples + arraysize(kSubsamples)));
+  ASSERT_TRUE(decryptor_source_.DecryptSampleBuffer(
+      &decrypt_config, &encrypted_buffer_[0], encrypted_buffer_.size(),
+      &decrypted_buffer_[0]));
+
+  // Encrypt the decrypted buffer again with another key and IV.
+  const uint8_t kNewKey[] = {
+    0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18,
+    0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20,
+  };
+  const std::vector<uint8_t> new_key(kNewKey, kNewKey + arraysize(kNewKey));
+  const std::vector<uint8_t> new_iv(kIv2, kIv2 + arraysize(kIv2));
+  AesCtrEncryptor encryptor;
+  ASSERT_TRUE(encryptor.InitializeWithIv(new_key, new_iv));
+  std::vector<uint8_t> expected_buffer(decrypted_buffer_);
+  size_t offset = 0;
+  for (const SubsampleEntry& subsample : kSubsamples) {
+    offset += subsample.clear_bytes;
+    ASSERT_TRUE(encryptor.Crypt(&decrypted_buffer_[offset],
+                                subsample.cipher_bytes,
+                                &expected_buffer[offset]));
+    offset += subsample.cipher_bytes;
+  }
+
+  AesCtrEncryptor reencryptor;
+  ASSERT_TRUE(reencryptor.InitializeWithIv(new_key, new_iv));
+  std::vector<uint8_t> reencrypted_buffer(encrypted_buffer_.size());
+  ASSERT_TRUE(decryptor_source_.ReencryptSampleBuffer(
+      &decrypt_config, &encrypted_buffer_[0], encrypted_buffer_.size(),
+      &reencryptor, &reencrypted_buffer[0]));
+  EXPECT_EQ(expected_buffer, reencrypted_buffer);
+}
+
 TEST_F(DecryptorSourceTest, SubsampleDecryptionSizeValidation) {
   EncryptionKey encryption_key;
   encryption_key.key.assign(kMockKey, kMockKey + arraysize(kMockKey));
@@ -0,0 +1,90 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/gzip_util.h"
+
+#include <stdint.h>
+
+#include "packager/base/logging.h"
+#include "packager/third_party/zlib/zlib.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+// Adds 16 to the default window bits to write and read a gzip header and
+// trailer instead of a zlib wrapper.
+const int kGzipWindowBits = MAX_WBITS + 16;
+const int kGzipMemoryLevel = 8;
+const size_t kDecompressBufferSize = 0x10000;  // 64KB.
+}  // namespace
+
+GzipCompressor::GzipCompressor(Level level) : level_(level) {}
+
+GzipCompressor::~GzipCompressor() {
+  if (stream_)
+    deflateEnd(stream_.get());
+}
+
+bool GzipCompressor::Compress(const std::string& input, std::string* output) {
+  DCHECK(output);
+  if (stream_) {
+    deflateReset(stream_.get());
+  } else {
+    stream_.reset(new z_stream());
+    if (deflateInit2(stream_.get(), level_, Z_DEFLATED, kGzipWindowBits,
+                     kGzipMemoryLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+      LOG(ERROR) << "Failed to initialize the gzip compressor.";
+      stream_.reset();
+      return false;
+    }
+  }
+
+  z_stream* stream = stream_.get();
+  output->resize(deflateBound(stream, input.size()));
+  stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  stream->avail_in = static_cast<uInt>(input.size());
+  stream->next_out = reinterpret_cast<Bytef*>(&(*output)[0]);
+  stream->avail_out = static_cast<uInt>(output->size());
+  if (deflate(stream, Z_FINISH) != Z_STREAM_END)
+    return false;
+  output->resize(stream->total_out);
+  return true;
+}
+
+bool GzipCompress(const std::string& input, std::string* output) {
+  return GzipCompressor(GzipCompressor::kDefaultCompression)
+      .Compress(input, output);
+}
+
+bool GzipDecompress(const std::string& input, std::string* output) {
+  DCHECK(output);
+  z_stream stream = {};
+  if (inflateInit2(&stream, kGzipWindowBits) != Z_OK)
+    return false;
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  stream.avail_in = static_cast<uInt>(input.size());
+
+  std::unique_ptr<char[]> buffer(new char[kDecompressBufferSize]);
+  output->clear();
+  int result = Z_OK;
+  while (result == Z_OK) {
+    stream.next_out = reinterpret_cast<Bytef*>(buffer.get());
+    stream.avail_out = kDecompressBufferSize;
+    result = inflate(&stream, Z_NO_FLUSH);
+    output->append(buffer.get(), kDecompressBufferSize - stream.avail_out);
+  }
+  inflateEnd(&stream);
+  return result == Z_STREAM_END;
+}
+
+bool IsGzipCompressed(const std::string& data) {
+  return data.size() >= 2 && static_cast<uint8_t>(data[0]) == 0x1f &&
+         static_cast<uint8_t>(data[1]) == 0x8b;
+}
+
+}  // namespace media
+}  // namespace shaka
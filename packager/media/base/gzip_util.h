@@ -0,0 +1,57 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_GZIP_UTIL_H_
+#define PACKAGER_MEDIA_BASE_GZIP_UTIL_H_
+
+#include <memory>
+#include <string>
+
+struct z_stream_s;
+
+namespace shaka {
+namespace media {
+
+/// Compresses data in the gzip format. The zlib state is reused across the
+/// calls, so that it is only allocated once when many inputs are compressed.
+class GzipCompressor {
+ public:
+  /// zlib compression levels.
+  enum Level {
+    kDefaultCompression = -1,
+    kBestCompression = 9,
+  };
+
+  explicit GzipCompressor(Level level);
+  ~GzipCompressor();
+
+  /// Compresses @a input to @a output.
+  /// @return true on success, false otherwise.
+  bool Compress(const std::string& input, std::string* output);
+
+ private:
+  GzipCompressor(const GzipCompressor&) = delete;
+  GzipCompressor& operator=(const GzipCompressor&) = delete;
+
+  const Level level_;
+  std::unique_ptr<z_stream_s> stream_;
+};
+
+/// Compresses @a input in the gzip format with the default level.
+/// @return true on success, false otherwise.
+bool GzipCompress(const std::string& input, std::string* output);
+
+/// Decompresses the gzip data in @a input to @a output.
+/// @return true on success, false if @a input is not complete gzip data.
+bool GzipDecompress(const std::string& input, std::string* output);
+
+/// @return true if @a data starts with the gzip magic number.
+bool IsGzipCompressed(const std::string& data);
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_GZIP_UTIL_H_
@@ -0,0 +1,50 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/gzip_util.h"
+
+#include <gtest/gtest.h>
+
+namespace shaka {
+namespace media {
+
+TEST(GzipUtilTest, CompressDecompress) {
+  const std::string kInput(100000, 'a');
+  std::string compressed;
+  ASSERT_TRUE(GzipCompress(kInput, &compressed));
+  EXPECT_TRUE(IsGzipCompressed(compressed));
+  EXPECT_LT(compressed.size(), kInput.size());
+
+  std::string decompressed;
+  ASSERT_TRUE(GzipDecompress(compressed, &decompressed));
+  EXPECT_EQ(kInput, decompressed);
+}
+
+TEST(GzipUtilTest, CompressorIsReused) {
+  GzipCompressor compressor(GzipCompressor::kBestCompression);
+  std::string compressed;
+  std::string decompressed;
+  ASSERT_TRUE(compressor.Compress("content1", &compressed));
+  ASSERT_TRUE(GzipDecompress(compressed, &decompressed));
+  EXPECT_EQ("content1", decompressed);
+  ASSERT_TRUE(compressor.Compress("content2", &compressed));
+  ASSERT_TRUE(GzipDecompress(compressed, &decompressed));
+  EXPECT_EQ("content2", decompressed);
+}
+
+TEST(GzipUtilTest, DecompressInvalidData) {
+  std::string decompressed;
+  EXPECT_FALSE(IsGzipCompressed("text"));
+  EXPECT_FALSE(GzipDecompress("text", &decompressed));
+
+  std::string compressed;
+  ASSERT_TRUE(GzipCompress("content", &compressed));
+  compressed.resize(compressed.size() - 4);
+  EXPECT_FALSE(GzipDecompress(compressed, &decompressed));
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,75 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/hot_path_log.h"
+
+#include <gflags/gflags.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "packager/base/strings/string_split.h"
+
+namespace shaka {
+namespace media {
+namespace internal {
+std::atomic<uint32_t> g_hot_path_log_modules(0);
+}  // namespace internal
+}  // namespace media
+}  // namespace shaka
+
+namespace {
+
+using shaka::media::HotPathLogModule;
+
+const struct {
+  const char* name;
+  HotPathLogModule module;
+} kHotPathLogModules[] = {
+    {"demuxer", HotPathLogModule::kDemuxer},
+    {"chunking", HotPathLogModule::kChunking},
+    {"fragmenter", HotPathLogModule::kFragmenter},
+    {"ts_segmenter", HotPathLogModule::kTsSegmenter},
+    {"es_parser", HotPathLogModule::kEsParser},
+};
+
+// Also sets the enabled modules, as the validator is called whenever the flag
+// is set.
+bool SetHotPathLogModules(const char* flagname, const std::string& value) {
+  uint32_t modules = 0;
+  for (const std::string& name :
+       base::SplitString(value, ",", base::TRIM_WHITESPACE,
+                         base::SPLIT_WANT_NONEMPTY)) {
+    bool found = false;
+    for (const auto& module : kHotPathLogModules) {
+      if (name == module.name) {
+        modules |= static_cast<uint32_t>(module.module);
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      fprintf(stderr,
+              "ERROR: --%s has unknown module '%s'. The modules are demuxer, "
+              "chunking, fragmenter, ts_segmenter and es_parser.\n",
+              flagname, name.c_str());
+      return false;
+    }
+  }
+  shaka::media::internal::g_hot_path_log_modules.store(
+      modules, std::memory_order_relaxed);
+  return true;
+}
+
+}  // namespace
+
+DEFINE_string(hot_path_logs,
+              "",
+              "Comma separated list of the modules logging each sample, at "
+              "the INFO level: demuxer, chunking, fragmenter, ts_segmenter "
+              "or es_parser. These logs are verbose, and only meant for "
+              "diagnostics.");
+DEFINE_validator(hot_path_logs, &SetHotPathLogModules);
@@ -0,0 +1,58 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_HOT_PATH_LOG_H_
+#define PACKAGER_MEDIA_BASE_HOT_PATH_LOG_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+
+/// The modules with logs for each sample, which are enabled with
+/// --hot_path_logs.
+enum class HotPathLogModule : uint32_t {
+  kDemuxer = 1 << 0,
+  kChunking = 1 << 1,
+  kFragmenter = 1 << 2,
+  kTsSegmenter = 1 << 3,
+  kEsParser = 1 << 4,
+};
+
+namespace internal {
+// The HotPathLogModule bits of the modules in --hot_path_logs.
+extern std::atomic<uint32_t> g_hot_path_log_modules;
+}  // namespace internal
+
+/// @return true if the logs of @a module are enabled.
+inline bool IsHotPathLogOn(HotPathLogModule module) {
+  return (internal::g_hot_path_log_modules.load(std::memory_order_relaxed) &
+          static_cast<uint32_t>(module)) != 0;
+}
+
+}  // namespace media
+}  // namespace shaka
+
+/// Logs for each sample of a HotPathLogModule, e.g.
+///   HOT_PATH_LOG(kDemuxer) << sample->ToString();
+/// The stream arguments are only evaluated if the module is in --hot_path_logs,
+/// which costs a load and a test on the hot path otherwise, instead of the
+/// lookup of the level of the file with VLOG. The logs are compiled out
+/// with DISABLE_HOT_PATH_LOGS, i.e. with hot_path_logs=0 in GYP_DEFINES.
+#if defined(DISABLE_HOT_PATH_LOGS)
+#define HOT_PATH_LOG(module) EAT_STREAM_PARAMETERS
+#else
+#define HOT_PATH_LOG(module)                                   \
+  LAZY_STREAM(LOG_STREAM(INFO),                                \
+              ::shaka::media::IsHotPathLogOn(                  \
+                  ::shaka::media::HotPathLogModule::module))
+#endif  // defined(DISABLE_HOT_PATH_LOGS)
+
+#endif  // PACKAGER_MEDIA_BASE_HOT_PATH_LOG_H_
@@ -0,0 +1,35 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/hot_path_log.h"
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+namespace shaka {
+namespace media {
+
+TEST(HotPathLogTest, EnablesModulesOfFlag) {
+  gflags::FlagSaver flag_saver;
+  EXPECT_FALSE(IsHotPathLogOn(HotPathLogModule::kDemuxer));
+
+  ASSERT_FALSE(
+      gflags::SetCommandLineOption("hot_path_logs", "demuxer, es_parser")
+          .empty());
+  EXPECT_TRUE(IsHotPathLogOn(HotPathLogModule::kDemuxer));
+  EXPECT_TRUE(IsHotPathLogOn(HotPathLogModule::kEsParser));
+  EXPECT_FALSE(IsHotPathLogOn(HotPathLogModule::kChunking));
+
+  // Unknown modules are rejected, keeping the enabled modules.
+  EXPECT_TRUE(gflags::SetCommandLineOption("hot_path_logs", "muxer").empty());
+  EXPECT_TRUE(IsHotPathLogOn(HotPathLogModule::kDemuxer));
+
+  ASSERT_FALSE(gflags::SetCommandLineOption("hot_path_logs", "").empty());
+  EXPECT_FALSE(IsHotPathLogOn(HotPathLogModule::kDemuxer));
+}
+
+}  // namespace media
+}  // namespace shaka
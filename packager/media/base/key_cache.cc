@@ -0,0 +1,165 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/key_cache.h"
+
+#include <openssl/rand.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/sha1.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/time/time.h"
+#include "packager/file/file.h"
+#include "packager/media/base/aes_decryptor.h"
+#include "packager/media/base/aes_encryptor.h"
+#include "packager/media/base/buffer_reader.h"
+#include "packager/media/base/buffer_writer.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kIvSize = 16;
+
+// A cache file is a random IV followed by the AES-CBC encryption of:
+//   SHA-1 of the request (20 bytes)
+//   expiration time in seconds since the Unix epoch (8 bytes)
+//   response
+//   SHA-1 of all of the above (20 bytes)
+// The trailing hash detects files encrypted with another cache key.
+std::string EncodeCacheEntry(const std::string& request_hash,
+                             int64_t expiration_time,
+                             const std::string& response) {
+  BufferWriter writer;
+  writer.AppendString(request_hash);
+  writer.AppendInt(expiration_time);
+  writer.AppendString(response);
+  std::string entry(writer.Buffer(), writer.Buffer() + writer.Size());
+  entry += base::SHA1HashString(entry);
+  return entry;
+}
+
+bool DecodeCacheEntry(const std::string& entry,
+                      std::string* request_hash,
+                      int64_t* expiration_time,
+                      std::string* response) {
+  if (entry.size() < 2 * base::kSHA1Length + sizeof(*expiration_time))
+    return false;
+  const size_t payload_size = entry.size() - base::kSHA1Length;
+  if (base::SHA1HashString(entry.substr(0, payload_size)) !=
+      entry.substr(payload_size)) {
+    return false;
+  }
+  BufferReader reader(reinterpret_cast<const uint8_t*>(entry.data()),
+                      payload_size);
+  return reader.ReadToString(request_hash, base::kSHA1Length) &&
+         reader.Read8s(expiration_time) &&
+         reader.ReadToString(response, payload_size - reader.pos());
+}
+
+}  // namespace
+
+std::unique_ptr<KeyCache> KeyCache::Create(
+    const std::string& cache_dir,
+    const std::vector<uint8_t>& cache_key,
+    int64_t validity_in_seconds) {
+  AesCbcEncryptor encryptor(kPkcs5Padding, AesCryptor::kUseConstantIv);
+  if (!encryptor.InitializeWithIv(cache_key, std::vector<uint8_t>(kIvSize))) {
+    LOG(ERROR) << "Invalid key cache key of size " << cache_key.size();
+    return nullptr;
+  }
+  return std::unique_ptr<KeyCache>(
+      new KeyCache(cache_dir, cache_key, validity_in_seconds));
+}
+
+KeyCache::KeyCache(const std::string& cache_dir,
+                   const std::vector<uint8_t>& cache_key,
+                   int64_t validity_in_seconds)
+    : cache_dir_(cache_dir),
+      cache_key_(cache_key),
+      validity_in_seconds_(validity_in_seconds) {}
+
+KeyCache::~KeyCache() {}
+
+bool KeyCache::Get(const std::string& request, std::string* response) {
+  DCHECK(response);
+  const std::string file_name = GetFileName(request);
+  std::string contents;
+  // A missing file is the common case of a cache miss.
+  if (!File::ReadFileToString(file_name.c_str(), &contents))
+    return false;
+  if (contents.size() <= kIvSize) {
+    LOG(WARNING) << "Ignoring truncated key cache file " << file_name;
+    return false;
+  }
+
+  AesCbcDecryptor decryptor(kPkcs5Padding, AesCryptor::kUseConstantIv);
+  std::string entry;
+  if (!decryptor.InitializeWithIv(
+          cache_key_,
+          std::vector<uint8_t>(contents.begin(), contents.begin() + kIvSize)) ||
+      !decryptor.Crypt(contents.substr(kIvSize), &entry)) {
+    LOG(WARNING) << "Failed to decrypt key cache file " << file_name;
+    return false;
+  }
+
+  std::string request_hash;
+  int64_t expiration_time = 0;
+  if (!DecodeCacheEntry(entry, &request_hash, &expiration_time, response)) {
+    LOG(WARNING) << "Ignoring invalid key cache file " << file_name;
+    return false;
+  }
+  if (request_hash != base::SHA1HashString(request))
+    return false;
+  if (base::Time::Now().ToTimeT() >= expiration_time) {
+    VLOG(1) << "Key cache file " << file_name << " expired.";
+    return false;
+  }
+  VLOG(1) << "Using keys from key cache file " << file_name;
+  return true;
+}
+
+bool KeyCache::Put(const std::string& request, const std::string& response) {
+  std::vector<uint8_t> iv(kIvSize);
+  if (RAND_bytes(iv.data(), iv.size()) != 1) {
+    LOG(ERROR) << "Failed to generate the key cache file IV.";
+    return false;
+  }
+  AesCbcEncryptor encryptor(kPkcs5Padding, AesCryptor::kUseConstantIv);
+  std::string encrypted_entry;
+  if (!encryptor.InitializeWithIv(cache_key_, iv) ||
+      !encryptor.Crypt(
+          EncodeCacheEntry(base::SHA1HashString(request),
+                           base::Time::Now().ToTimeT() + validity_in_seconds_,
+                           response),
+          &encrypted_entry)) {
+    LOG(ERROR) << "Failed to encrypt the key cache entry.";
+    return false;
+  }
+
+  const std::string file_name = GetFileName(request);
+  // Written atomically, as other packager processes may read the file at the
+  // same time.
+  if (!File::WriteFileAtomically(
+          file_name.c_str(),
+          std::string(iv.begin(), iv.end()) + encrypted_entry)) {
+    LOG(ERROR) << "Failed to write key cache file " << file_name;
+    return false;
+  }
+  return true;
+}
+
+std::string KeyCache::GetFileName(const std::string& request) const {
+  const std::string request_hash = base::SHA1HashString(request);
+  std::string file_name = cache_dir_;
+  if (!file_name.empty() && file_name.back() != '/')
+    file_name += '/';
+  return file_name + base::HexEncode(request_hash.data(), request_hash.size()) +
+         ".key";
+}
+
+}  // namespace media
+}  // namespace shaka
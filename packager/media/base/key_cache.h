@@ -0,0 +1,68 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_KEY_CACHE_H_
+#define PACKAGER_MEDIA_BASE_KEY_CACHE_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/macros.h"
+
+namespace shaka {
+namespace media {
+
+/// A cache of key server responses, stored encrypted in a directory so that
+/// restarted and sibling packager processes can reuse the keys already
+/// obtained instead of requesting them again. Each response is stored in its
+/// own file, written atomically, and is reused until its validity expires.
+/// Get() and Put() can be called from multiple threads.
+class KeyCache {
+ public:
+  /// Creates a KeyCache.
+  /// @param cache_dir is the directory of the cache files. It must exist.
+  /// @param cache_key is the 16-byte AES key the cache files are encrypted
+  ///        with.
+  /// @param validity_in_seconds is how long a response is reused after it is
+  ///        stored.
+  /// @return the KeyCache, or null if @a cache_key is invalid.
+  static std::unique_ptr<KeyCache> Create(const std::string& cache_dir,
+                                          const std::vector<uint8_t>& cache_key,
+                                          int64_t validity_in_seconds);
+  ~KeyCache();
+
+  /// Looks up a response.
+  /// @param request identifies the response, e.g. the key server url and the
+  ///        request message.
+  /// @param[out] response gets the response on success.
+  /// @return true if a valid response is cached for @a request.
+  bool Get(const std::string& request, std::string* response);
+
+  /// Stores a response.
+  /// @return true on success, false otherwise.
+  bool Put(const std::string& request, const std::string& response);
+
+ private:
+  KeyCache(const std::string& cache_dir,
+           const std::vector<uint8_t>& cache_key,
+           int64_t validity_in_seconds);
+
+  std::string GetFileName(const std::string& request) const;
+
+  const std::string cache_dir_;
+  const std::vector<uint8_t> cache_key_;
+  const int64_t validity_in_seconds_;
+
+  DISALLOW_COPY_AND_ASSIGN(KeyCache);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_KEY_CACHE_H_
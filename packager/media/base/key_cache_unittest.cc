@@ -0,0 +1,80 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/key_cache.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/file/memory_file.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const char kCacheDir[] = "memory://key_cache";
+const uint8_t kCacheKey[] = {
+    0x6f, 0xc9, 0x6f, 0xe6, 0x28, 0xa2, 0x65, 0xb1,
+    0x3a, 0xed, 0xde, 0xc0, 0xbc, 0x42, 0x1f, 0x4d,
+};
+const uint8_t kOtherCacheKey[] = {
+    0xe5, 0x00, 0x7e, 0x6e, 0x9d, 0xcd, 0x5a, 0xc0,
+    0x95, 0x20, 0x2e, 0xd3, 0x75, 0x83, 0x82, 0xcd,
+};
+const int64_t kValidityInSeconds = 3600;
+const char kRequest[] = "https://license.uat.widevine.com\nrequest";
+const char kResponse[] = "response";
+}  // namespace
+
+class KeyCacheTest : public testing::Test {
+ protected:
+  void TearDown() override { MemoryFile::DeleteAll(); }
+
+  std::unique_ptr<KeyCache> CreateKeyCache(const uint8_t* cache_key,
+                                           int64_t validity_in_seconds) {
+    return KeyCache::Create(
+        kCacheDir,
+        std::vector<uint8_t>(cache_key, cache_key + sizeof(kCacheKey)),
+        validity_in_seconds);
+  }
+};
+
+TEST_F(KeyCacheTest, InvalidCacheKey) {
+  EXPECT_FALSE(KeyCache::Create(kCacheDir, std::vector<uint8_t>(5),
+                                kValidityInSeconds));
+}
+
+TEST_F(KeyCacheTest, SharedAcrossInstances) {
+  std::string response;
+  std::unique_ptr<KeyCache> key_cache =
+      CreateKeyCache(kCacheKey, kValidityInSeconds);
+  ASSERT_TRUE(key_cache);
+  EXPECT_FALSE(key_cache->Get(kRequest, &response));
+  ASSERT_TRUE(key_cache->Put(kRequest, kResponse));
+
+  std::unique_ptr<KeyCache> other_key_cache =
+      CreateKeyCache(kCacheKey, kValidityInSeconds);
+  ASSERT_TRUE(other_key_cache->Get(kRequest, &response));
+  EXPECT_EQ(kResponse, response);
+  EXPECT_FALSE(other_key_cache->Get("another request", &response));
+}
+
+TEST_F(KeyCacheTest, WrongCacheKey) {
+  std::string response;
+  ASSERT_TRUE(CreateKeyCache(kCacheKey, kValidityInSeconds)
+                  ->Put(kRequest, kResponse));
+  EXPECT_FALSE(CreateKeyCache(kOtherCacheKey, kValidityInSeconds)
+                   ->Get(kRequest, &response));
+}
+
+TEST_F(KeyCacheTest, Expired) {
+  std::string response;
+  std::unique_ptr<KeyCache> key_cache = CreateKeyCache(kCacheKey, 0);
+  ASSERT_TRUE(key_cache->Put(kRequest, kResponse));
+  EXPECT_FALSE(key_cache->Get(kRequest, &response));
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -29,14 +29,16 @@
         'bit_reader.h',
         'bit_writer.cc',
         'bit_writer.h',
+        'buffer_chain.cc',
+        'buffer_chain.h',
         'buffer_reader.cc',
         'buffer_reader.h',
         'buffer_writer.cc',
         'buffer_writer.h',
         'byte_queue.cc',
         'byte_queue.h',
-        'cc_stream_filter.cc',
-        'cc_stream_filter.h',
+        'cc_stream_router.cc',
+        'cc_stream_router.h',
         'closure_thread.cc',
         'closure_thread.h',
         'common_pssh_generator.cc',
@@ -49,10 +51,16 @@
         'decryptor_source.h',
         'encryption_config.h',
         'fourccs.h',
+        'gzip_util.cc',
+        'gzip_util.h',
+        'hot_path_log.cc',
+        'hot_path_log.h',
         'http_key_fetcher.cc',
         'http_key_fetcher.h',
         'id3_tag.cc',
         'id3_tag.h',
+        'key_cache.cc',
+        'key_cache.h',
         'key_fetcher.cc',
         'key_fetcher.h',
         'key_source.cc',
@@ -66,6 +74,8 @@
         'media_parser.h',
         'media_sample.cc',
         'media_sample.h',
+        'metrics.cc',
+        'metrics.h',
         'muxer.cc',
         'muxer.h',
         'muxer_options.cc',
@@ -74,6 +84,7 @@
         'muxer_util.h',
         'network_util.cc',
         'network_util.h',
+        'object_pool.h',
         'offset_byte_queue.cc',
         'offset_byte_queue.h',
         'playready_key_source.cc',
@@ -98,6 +109,10 @@
         'request_signer.h',
         'rsa_key.cc',
         'rsa_key.h',
+        'segment_checkpoint.cc',
+        'segment_checkpoint.h',
+        'segment_digest.cc',
+        'segment_digest.h',
         'stream_info.cc',
         'stream_info.h',
         'text_muxer.cc',
@@ -109,6 +124,8 @@
         'text_track.h',
         'text_track_config.cc',
         'text_track_config.h',
+        'threaded_handler.cc',
+        'threaded_handler.h',
         'timestamp.h',
         'video_stream_info.cc',
         'video_stream_info.h',
@@ -123,11 +140,13 @@
         'widevine_common_encryption_proto',
         'widevine_pssh_data_proto',
         '../../base/base.gyp:base',
+        '../../file/file.gyp:file',
         '../../packager.gyp:status',
         '../../third_party/boringssl/boringssl.gyp:boringssl',
         '../../third_party/curl/curl.gyp:libcurl',
         '../../third_party/gflags/gflags.gyp:gflags',
         '../../third_party/libxml/libxml.gyp:libxml',
+        '../../third_party/zlib/zlib.gyp:zlib',
         '../../version/version.gyp:version',
       ],
     },
@@ -176,24 +195,35 @@
         'audio_timestamp_helper_unittest.cc',
         'bit_reader_unittest.cc',
         'bit_writer_unittest.cc',
+        'buffer_chain_unittest.cc',
         'buffer_writer_unittest.cc',
+        'cc_stream_router_unittest.cc',
         'closure_thread_unittest.cc',
         'container_names_unittest.cc',
         'decryptor_source_unittest.cc',
+        'gzip_util_unittest.cc',
+        'hot_path_log_unittest.cc',
         'http_key_fetcher_unittest.cc',
         'id3_tag_unittest.cc',
+        'key_cache_unittest.cc',
+        'media_handler_unittest.cc',
+        'metrics_unittest.cc',
         'muxer_util_unittest.cc',
+        'object_pool_unittest.cc',
         'offset_byte_queue_unittest.cc',
         'producer_consumer_queue_unittest.cc',
         'protection_system_specific_info_unittest.cc',
         'pssh_generator_unittest.cc',
         'raw_key_source_unittest.cc',
         'rsa_key_unittest.cc',
+        'segment_checkpoint_unittest.cc',
+        'segment_digest_unittest.cc',
         'status_test_util_unittest.cc',
         'test/fake_prng.cc',  # For rsa_key_unittest
         'test/fake_prng.h',   # For rsa_key_unittest
         'test/rsa_test_data.cc',  # For rsa_key_unittest
         'test/rsa_test_data.h',   # For rsa_key_unittest
+        'threaded_handler_unittest.cc',
         'video_util_unittest.cc',
         'widevine_key_source_unittest.cc',
       ],
@@ -204,6 +234,7 @@
         '../../third_party/boringssl/boringssl.gyp:boringssl',
         '../test/media_test.gyp:media_test_support',
         'media_base',
+        'media_handler_test_base',
       ],
     },
   ],
@@ -6,11 +6,106 @@
 
 #include "packager/media/base/media_handler.h"
 
+#include "packager/base/logging.h"
+#include "packager/base/time/time.h"
 #include "packager/status_macros.h"
 
 namespace shaka {
 namespace media {
 
+namespace {
+bool g_stats_enabled = false;
+}  // namespace
+
+StreamData::StreamData(const StreamData& other)
+    : stream_index(other.stream_index),
+      stream_data_type(other.stream_data_type) {
+  switch (stream_data_type) {
+    case StreamDataType::kStreamInfo:
+      new (&stream_info_)
+          std::shared_ptr<const StreamInfo>(other.stream_info_);
+      break;
+    case StreamDataType::kMediaSample:
+      new (&media_sample_)
+          std::shared_ptr<const MediaSample>(other.media_sample_);
+      break;
+    case StreamDataType::kTextSample:
+      new (&text_sample_) std::shared_ptr<const TextSample>(other.text_sample_);
+      break;
+    case StreamDataType::kSegmentInfo:
+      new (&segment_info_)
+          std::shared_ptr<const SegmentInfo>(other.segment_info_);
+      break;
+    case StreamDataType::kScte35Event:
+      new (&scte35_event_)
+          std::shared_ptr<const Scte35Event>(other.scte35_event_);
+      break;
+    case StreamDataType::kCueEvent:
+      new (&cue_event_) std::shared_ptr<const CueEvent>(other.cue_event_);
+      break;
+    case StreamDataType::kUnknown:
+      break;
+  }
+}
+
+StreamData::StreamData(StreamData&& other)
+    : stream_index(other.stream_index),
+      stream_data_type(other.stream_data_type) {
+  switch (stream_data_type) {
+    case StreamDataType::kStreamInfo:
+      new (&stream_info_)
+          std::shared_ptr<const StreamInfo>(std::move(other.stream_info_));
+      break;
+    case StreamDataType::kMediaSample:
+      new (&media_sample_)
+          std::shared_ptr<const MediaSample>(std::move(other.media_sample_));
+      break;
+    case StreamDataType::kTextSample:
+      new (&text_sample_)
+          std::shared_ptr<const TextSample>(std::move(other.text_sample_));
+      break;
+    case StreamDataType::kSegmentInfo:
+      new (&segment_info_)
+          std::shared_ptr<const SegmentInfo>(std::move(other.segment_info_));
+      break;
+    case StreamDataType::kScte35Event:
+      new (&scte35_event_)
+          std::shared_ptr<const Scte35Event>(std::move(other.scte35_event_));
+      break;
+    case StreamDataType::kCueEvent:
+      new (&cue_event_)
+          std::shared_ptr<const CueEvent>(std::move(other.cue_event_));
+      break;
+    case StreamDataType::kUnknown:
+      break;
+  }
+}
+
+StreamData::~StreamData() {
+  switch (stream_data_type) {
+    case StreamDataType::kStreamInfo:
+      stream_info_.~shared_ptr();
+      break;
+    case StreamDataType::kMediaSample:
+      media_sample_.~shared_ptr();
+      break;
+    case StreamDataType::kTextSample:
+      text_sample_.~shared_ptr();
+      break;
+    case StreamDataType::kSegmentInfo:
+      segment_info_.~shared_ptr();
+      break;
+    case StreamDataType::kScte35Event:
+      scte35_event_.~shared_ptr();
+      break;
+    case StreamDataType::kCueEvent:
+      cue_event_.~shared_ptr();
+      break;
+    case StreamDataType::kUnknown:
+      break;
+  }
+}
+
 std::string StreamDataTypeToString(StreamDataType type) {
   switch (type) {
     case StreamDataType::kStreamInfo:
@@ -91,7 +186,17 @@ bool MediaHandler::ValidateOutputStreamIndex(size_t stream_index) const {
   return stream_index < num_input_streams_;
 }
 
+Status MediaHandler::ProcessBatch(StreamDataBatch batch) {
+  for (auto& stream_data : batch)
+    RETURN_IF_ERROR(Process(std::move(stream_data)));
+  return Status::OK;
+}
+
 Status MediaHandler::Dispatch(std::unique_ptr<StreamData> stream_data) const {
+  if (dispatched_batch_) {
+    dispatched_batch_->push_back(std::move(stream_data));
+    return Status::OK;
+  }
   size_t output_stream_index = stream_data->stream_index;
   auto handler_it = output_handlers_.find(output_stream_index);
   if (handler_it == output_handlers_.end()) {
@@ -99,7 +204,107 @@ Status MediaHandler::Dispatch(std::unique_ptr<StreamData> stream_data) const {
                   "No output handler exist at the specified index.");
   }
   stream_data->stream_index = handler_it->second.second;
-  return handler_it->second.first->Process(std::move(stream_data));
+  MediaHandler* handler = handler_it->second.first.get();
+  if (!g_stats_enabled)
+    return handler->Process(std::move(stream_data));
+
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  Status status = handler->Process(std::move(stream_data));
+  RecordDownstreamCall(handler, 1,
+                       (base::TimeTicks::Now() - start_time).InMicroseconds());
+  return status;
+}
+
+Status MediaHandler::DispatchBatch(StreamDataBatch batch) const {
+  DCHECK(!dispatched_batch_);
+  size_t run_start = 0;
+  while (run_start < batch.size()) {
+    const size_t output_stream_index = batch[run_start]->stream_index;
+    size_t run_end = run_start + 1;
+    while (run_end < batch.size() &&
+           batch[run_end]->stream_index == output_stream_index) {
+      ++run_end;
+    }
+
+    auto handler_it = output_handlers_.find(output_stream_index);
+    if (handler_it == output_handlers_.end()) {
+      return Status(error::NOT_FOUND,
+                    "No output handler exist at the specified index.");
+    }
+    StreamDataBatch run;
+    if (run_start == 0 && run_end == batch.size()) {
+      run.swap(batch);
+    } else {
+      run.reserve(run_end - run_start);
+      for (size_t i = run_start; i < run_end; ++i)
+        run.push_back(std::move(batch[i]));
+    }
+    for (auto& stream_data : run)
+      stream_data->stream_index = handler_it->second.second;
+    MediaHandler* handler = handler_it->second.first.get();
+    if (g_stats_enabled) {
+      const base::TimeTicks start_time = base::TimeTicks::Now();
+      Status status = handler->ProcessBatch(std::move(run));
+      RecordDownstreamCall(
+          handler, run_end - run_start,
+          (base::TimeTicks::Now() - start_time).InMicroseconds());
+      RETURN_IF_ERROR(status);
+    } else {
+      RETURN_IF_ERROR(handler->ProcessBatch(std::move(run)));
+    }
+    run_start = run_end;
+  }
+  return Status::OK;
+}
+
+Status MediaHandler::ProcessBatchAndDispatchBatch(StreamDataBatch batch) {
+  DCHECK(!dispatched_batch_);
+  StreamDataBatch dispatched_batch;
+  dispatched_batch.reserve(batch.size());
+  dispatched_batch_ = &dispatched_batch;
+  Status status;
+  for (auto& stream_data : batch) {
+    status = Process(std::move(stream_data));
+    if (!status.ok())
+      break;
+  }
+  dispatched_batch_ = nullptr;
+  // The stream data processed before an error are still passed downstream.
+  status.Update(DispatchBatch(std::move(dispatched_batch)));
+  return status;
+}
+
+void MediaHandler::EnableStats(bool enabled) {
+  g_stats_enabled = enabled;
+}
+
+MediaHandlerStats MediaHandler::GetStats() const {
+  MediaHandlerStats stats;
+  {
+    base::AutoLock auto_lock(stats_lock_);
+    stats = stats_;
+  }
+  stats.queue_depth = NumQueuedStreamData();
+  return stats;
+}
+
+void MediaHandler::RecordDownstreamCall(MediaHandler* handler,
+                                        uint64_t num_stream_data,
+                                        int64_t time_us) const {
+  {
+    base::AutoLock auto_lock(stats_lock_);
+    stats_.downstream_time_us += time_us;
+  }
+
+  size_t bucket = 0;
+  while (bucket + 1 < MediaHandlerStats::kNumTimeBuckets &&
+         time_us >= (static_cast<int64_t>(1) << bucket)) {
+    ++bucket;
+  }
+  base::AutoLock auto_lock(handler->stats_lock_);
+  handler->stats_.num_stream_data += num_stream_data;
+  handler->stats_.total_time_us += time_us;
+  ++handler->stats_.time_histogram[bucket];
 }
 
 Status MediaHandler::FlushDownstream(size_t output_stream_index) {
@@ -7,11 +7,16 @@
 #ifndef PACKAGER_MEDIA_BASE_MEDIA_HANDLER_H_
 #define PACKAGER_MEDIA_BASE_MEDIA_HANDLER_H_
 
+#include <array>
 #include <map>
 #include <memory>
+#include <new>
 #include <utility>
+#include <vector>
 
+#include "packager/base/synchronization/lock.h"
 #include "packager/media/base/media_sample.h"
+#include "packager/media/base/object_pool.h"
 #include "packager/media/base/stream_info.h"
 #include "packager/media/base/text_sample.h"
 #include "packager/status.h"
@@ -64,16 +69,75 @@ struct SegmentInfo {
 };
 
 // TODO(kqyang): Should we use protobuf?
-struct StreamData {
+// StreamData is allocated for every sample dispatched, so it is pooled. It
+// only holds the payload of |stream_data_type|, in the space shared by all the
+// payload types; the accessors of the other payloads return null. Handlers
+// which take over the payload move it out with the release_*() methods, so
+// that the StreamData does not keep a reference to it.
+struct StreamData : public PooledObject<StreamData> {
+  StreamData() {}
+  StreamData(const StreamData& other);
+  StreamData(StreamData&& other);
+  ~StreamData();
+
   size_t stream_index = static_cast<size_t>(-1);
   StreamDataType stream_data_type = StreamDataType::kUnknown;
 
-  std::shared_ptr<const StreamInfo> stream_info;
-  std::shared_ptr<const MediaSample> media_sample;
-  std::shared_ptr<const TextSample> text_sample;
-  std::shared_ptr<const SegmentInfo> segment_info;
-  std::shared_ptr<const Scte35Event> scte35_event;
-  std::shared_ptr<const CueEvent> cue_event;
+  const std::shared_ptr<const StreamInfo>& stream_info() const {
+    return stream_data_type == StreamDataType::kStreamInfo
+               ? stream_info_
+               : NullPayload<StreamInfo>();
+  }
+  const std::shared_ptr<const MediaSample>& media_sample() const {
+    return stream_data_type == StreamDataType::kMediaSample
+               ? media_sample_
+               : NullPayload<MediaSample>();
+  }
+  const std::shared_ptr<const TextSample>& text_sample() const {
+    return stream_data_type == StreamDataType::kTextSample
+               ? text_sample_
+               : NullPayload<TextSample>();
+  }
+  const std::shared_ptr<const SegmentInfo>& segment_info() const {
+    return stream_data_type == StreamDataType::kSegmentInfo
+               ? segment_info_
+               : NullPayload<SegmentInfo>();
+  }
+  const std::shared_ptr<const Scte35Event>& scte35_event() const {
+    return stream_data_type == StreamDataType::kScte35Event
+               ? scte35_event_
+               : NullPayload<Scte35Event>();
+  }
+  const std::shared_ptr<const CueEvent>& cue_event() const {
+    return stream_data_type == StreamDataType::kCueEvent
+               ? cue_event_
+               : NullPayload<CueEvent>();
+  }
+
+  /// @return the payload, which is moved out of this StreamData, or null if
+  ///         the payload is of another type.
+  /// @{
+  std::shared_ptr<const StreamInfo> release_stream_info() {
+    return stream_data_type == StreamDataType::kStreamInfo
+               ? std::move(stream_info_)
+               : nullptr;
+  }
+  std::shared_ptr<const MediaSample> release_media_sample() {
+    return stream_data_type == StreamDataType::kMediaSample
+               ? std::move(media_sample_)
+               : nullptr;
+  }
+  std::shared_ptr<const TextSample> release_text_sample() {
+    return stream_data_type == StreamDataType::kTextSample
+               ? std::move(text_sample_)
+               : nullptr;
+  }
+  std::shared_ptr<const CueEvent> release_cue_event() {
+    return stream_data_type == StreamDataType::kCueEvent
+               ? std::move(cue_event_)
+               : nullptr;
+  }
+  /// @}
 
   static std::unique_ptr<StreamData> FromStreamInfo(
       size_t stream_index,
@@ -81,7 +145,8 @@ struct StreamData {
     std::unique_ptr<StreamData> stream_data(new StreamData);
     stream_data->stream_index = stream_index;
     stream_data->stream_data_type = StreamDataType::kStreamInfo;
-    stream_data->stream_info = std::move(stream_info);
+    new (&stream_data->stream_info_)
+        std::shared_ptr<const StreamInfo>(std::move(stream_info));
     return stream_data;
   }
 
@@ -91,7 +156,8 @@ struct StreamData {
     std::unique_ptr<StreamData> stream_data(new StreamData);
     stream_data->stream_index = stream_index;
     stream_data->stream_data_type = StreamDataType::kMediaSample;
-    stream_data->media_sample = std::move(media_sample);
+    new (&stream_data->media_sample_)
+        std::shared_ptr<const MediaSample>(std::move(media_sample));
     return stream_data;
   }
 
@@ -101,7 +167,8 @@ struct StreamData {
     std::unique_ptr<StreamData> stream_data(new StreamData);
     stream_data->stream_index = stream_index;
     stream_data->stream_data_type = StreamDataType::kTextSample;
-    stream_data->text_sample = std::move(text_sample);
+    new (&stream_data->text_sample_)
+        std::shared_ptr<const TextSample>(std::move(text_sample));
     return stream_data;
   }
 
@@ -111,7 +178,8 @@ struct StreamData {
     std::unique_ptr<StreamData> stream_data(new StreamData);
     stream_data->stream_index = stream_index;
     stream_data->stream_data_type = StreamDataType::kSegmentInfo;
-    stream_data->segment_info = std::move(segment_info);
+    new (&stream_data->segment_info_)
+        std::shared_ptr<const SegmentInfo>(std::move(segment_info));
     return stream_data;
   }
 
@@ -121,7 +189,8 @@ struct StreamData {
     std::unique_ptr<StreamData> stream_data(new StreamData);
     stream_data->stream_index = stream_index;
     stream_data->stream_data_type = StreamDataType::kScte35Event;
-    stream_data->scte35_event = std::move(scte35_event);
+    new (&stream_data->scte35_event_)
+        std::shared_ptr<const Scte35Event>(std::move(scte35_event));
     return stream_data;
   }
 
@@ -131,9 +200,57 @@ struct StreamData {
     std::unique_ptr<StreamData> stream_data(new StreamData);
     stream_data->stream_index = stream_index;
     stream_data->stream_data_type = StreamDataType::kCueEvent;
-    stream_data->cue_event = std::move(cue_event);
+    new (&stream_data->cue_event_)
+        std::shared_ptr<const CueEvent>(std::move(cue_event));
     return stream_data;
   }
+
+ private:
+  StreamData& operator=(const StreamData&) = delete;
+
+  // Returned for the payloads of the other types.
+  template <typename T>
+  static const std::shared_ptr<const T>& NullPayload() {
+    static const std::shared_ptr<const T>* null_payload =
+        new std::shared_ptr<const T>;
+    return *null_payload;
+  }
+
+  // Only the member of |stream_data_type| is constructed, none for kUnknown.
+  union {
+    std::shared_ptr<const StreamInfo> stream_info_;
+    std::shared_ptr<const MediaSample> media_sample_;
+    std::shared_ptr<const TextSample> text_sample_;
+    std::shared_ptr<const SegmentInfo> segment_info_;
+    std::shared_ptr<const Scte35Event> scte35_event_;
+    std::shared_ptr<const CueEvent> cue_event_;
+  };
+};
+
+/// Stream data passed downstream together, in order.
+typedef std::vector<std::unique_ptr<StreamData>> StreamDataBatch;
+
+/// Processing statistics of a media handler, only collected if enabled with
+/// MediaHandler::EnableStats().
+struct MediaHandlerStats {
+  /// Number of entries of @a time_histogram.
+  static const size_t kNumTimeBuckets = 20;
+
+  /// Number of stream data processed.
+  uint64_t num_stream_data = 0;
+  /// Time spent in Process() and ProcessBatch(), including the time spent in
+  /// the downstream handlers they dispatched to.
+  int64_t total_time_us = 0;
+  /// Time spent in the downstream handlers. For handlers which dispatch from
+  /// their own thread, like ThreadedHandler, this is not part of
+  /// @a total_time_us.
+  int64_t downstream_time_us = 0;
+  /// Entry i counts the Process() and ProcessBatch() calls which took less
+  /// than 2^i microseconds, including the downstream handlers. The last entry
+  /// also counts the longer calls.
+  std::array<uint64_t, kNumTimeBuckets> time_histogram = {};
+  /// Number of stream data queued in the handler.
+  size_t queue_depth = 0;
 };
 
 /// MediaHandler is the base media processing unit. Media handlers transform
@@ -174,6 +291,13 @@ class MediaHandler {
 
   static Status Chain(const std::vector<std::shared_ptr<MediaHandler>>& list);
 
+  /// Enables the collection of processing statistics, for all handlers. It
+  /// should be called before running the graph as it is not synchronized.
+  static void EnableStats(bool enabled);
+
+  /// @return the processing statistics collected so far. Thread safe.
+  MediaHandlerStats GetStats() const;
+
  protected:
   /// Internal implementation of initialize. Note that it should only initialize
   /// the MediaHandler itself. Downstream handlers are handled in Initialize().
@@ -185,16 +309,37 @@ class MediaHandler {
   /// handlers after finishing processing if needed.
   virtual Status Process(std::unique_ptr<StreamData> stream_data) = 0;
 
+  /// Process a batch of incoming stream data, all at the same input stream
+  /// index. The default implementation calls Process() on each of them in
+  /// order and stops at the first error.
+  virtual Status ProcessBatch(StreamDataBatch batch);
+
   /// Event handler for flush request at the specific input stream index.
   virtual Status OnFlushRequest(size_t input_stream_index);
 
   /// Validate if the stream at the specified index actually exists.
   virtual bool ValidateOutputStreamIndex(size_t stream_index) const;
 
+  /// @return the number of stream data queued in the handler, for
+  ///         statistics. Must be thread safe.
+  virtual size_t NumQueuedStreamData() const { return 0; }
+
   /// Dispatch the stream data to downstream handlers. Note that
   /// stream_data.stream_index should be the output stream index.
   Status Dispatch(std::unique_ptr<StreamData> stream_data) const;
 
+  /// Dispatch a batch of stream data to downstream handlers, preserving the
+  /// order. Consecutive stream data with the same stream_index, which should
+  /// be the output stream index, are passed to ProcessBatch() together.
+  Status DispatchBatch(StreamDataBatch batch) const;
+
+  /// Process a batch of incoming stream data with Process(), collecting the
+  /// stream data dispatched meanwhile, which are then dispatched with
+  /// DispatchBatch(). Handlers that only dispatch from within Process() can
+  /// implement ProcessBatch() with this so the downstream handlers get
+  /// batches too.
+  Status ProcessBatchAndDispatchBatch(StreamDataBatch batch);
+
   /// Dispatch the stream info to downstream handlers.
   Status DispatchStreamInfo(
       size_t stream_index,
@@ -270,6 +415,17 @@ class MediaHandler {
   // map.
   std::map<size_t, std::pair<std::shared_ptr<MediaHandler>, size_t>>
       output_handlers_;
+  // Collects the dispatched stream data in ProcessBatchAndDispatchBatch().
+  mutable StreamDataBatch* dispatched_batch_ = nullptr;
+
+  // Process() or ProcessBatch() of |handler| took |time_us| for
+  // |num_stream_data|, called from this handler.
+  void RecordDownstreamCall(MediaHandler* handler,
+                            uint64_t num_stream_data,
+                            int64_t time_us) const;
+
+  mutable base::Lock stats_lock_;
+  mutable MediaHandlerStats stats_;  // GUARDED_BY(stats_lock_)
 };
 
 }  // namespace media
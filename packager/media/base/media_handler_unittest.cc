@@ -0,0 +1,83 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <utility>
+
+#include "packager/media/base/media_handler.h"
+#include "packager/media/base/media_sample.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kStreamIndex = 1;
+const bool kIsKeyFrame = true;
+const uint8_t kData[] = {1, 2, 3};
+
+}  // namespace
+
+TEST(StreamDataTest, OnlyHoldsThePayloadOfItsType) {
+  std::shared_ptr<const MediaSample> sample =
+      MediaSample::CopyFrom(kData, sizeof(kData), kIsKeyFrame);
+  std::unique_ptr<StreamData> stream_data =
+      StreamData::FromMediaSample(kStreamIndex, sample);
+
+  EXPECT_EQ(kStreamIndex, stream_data->stream_index);
+  EXPECT_EQ(StreamDataType::kMediaSample, stream_data->stream_data_type);
+  EXPECT_EQ(sample, stream_data->media_sample());
+  EXPECT_FALSE(stream_data->stream_info());
+  EXPECT_FALSE(stream_data->text_sample());
+  EXPECT_FALSE(stream_data->segment_info());
+  EXPECT_FALSE(stream_data->scte35_event());
+  EXPECT_FALSE(stream_data->cue_event());
+  EXPECT_FALSE(stream_data->release_cue_event());
+  EXPECT_EQ(sample, stream_data->media_sample());
+}
+
+TEST(StreamDataTest, CopySharesThePayload) {
+  std::shared_ptr<CueEvent> cue_event = std::make_shared<CueEvent>();
+  std::unique_ptr<StreamData> stream_data =
+      StreamData::FromCueEvent(kStreamIndex, cue_event);
+
+  StreamData copy(*stream_data);
+  EXPECT_EQ(StreamDataType::kCueEvent, copy.stream_data_type);
+  EXPECT_EQ(cue_event, copy.cue_event());
+  EXPECT_EQ(cue_event, stream_data->cue_event());
+  EXPECT_EQ(3, cue_event.use_count());
+}
+
+TEST(StreamDataTest, MoveTakesThePayload) {
+  std::shared_ptr<CueEvent> cue_event = std::make_shared<CueEvent>();
+  std::unique_ptr<StreamData> stream_data =
+      StreamData::FromCueEvent(kStreamIndex, cue_event);
+
+  StreamData moved(std::move(*stream_data));
+  EXPECT_EQ(kStreamIndex, moved.stream_index);
+  EXPECT_EQ(cue_event, moved.cue_event());
+  EXPECT_FALSE(stream_data->cue_event());
+  EXPECT_EQ(2, cue_event.use_count());
+}
+
+TEST(StreamDataTest, ReleaseLeavesNoReference) {
+  std::shared_ptr<const MediaSample> sample =
+      MediaSample::CopyFrom(kData, sizeof(kData), kIsKeyFrame);
+  const MediaSample* sample_address = sample.get();
+  std::unique_ptr<StreamData> stream_data =
+      StreamData::FromMediaSample(kStreamIndex, std::move(sample));
+
+  std::shared_ptr<const MediaSample> released =
+      stream_data->release_media_sample();
+  EXPECT_EQ(sample_address, released.get());
+  EXPECT_EQ(1, released.use_count());
+  EXPECT_FALSE(stream_data->media_sample());
+  EXPECT_FALSE(stream_data->release_media_sample());
+}
+
+}  // namespace media
+}  // namespace shaka
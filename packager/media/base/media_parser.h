@@ -8,6 +8,7 @@
 #define PACKAGER_MEDIA_BASE_MEDIA_PARSER_H_
 
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 #include "packager/base/callback.h"
@@ -76,6 +77,56 @@ class MediaParser {
   /// @return true if successful.
   virtual bool Parse(const uint8_t* buf, int size) WARN_UNUSED_RESULT = 0;
 
+  /// Limits the samples to the tracks in @a track_ids. Parsers may skip
+  /// assembling and allocating the samples of the other tracks, which are not
+  /// emitted anymore. It is usually called from the init callback, once the
+  /// track ids are known. All the tracks are selected by default.
+  virtual void SetSelectedTracks(const std::set<uint32_t>& track_ids) {}
+
+  /// Keeps the encrypted samples encrypted, with their decrypt config, so they
+  /// can be decrypted downstream. The decryption key source passed to Init is
+  /// still used to fetch the keys. Must be called after Init and before any
+  /// data is parsed.
+  /// @return true if successful, false if the parser always decrypts the
+  ///         samples.
+  virtual bool DeferDecryption() { return false; }
+
+  /// Emits only the key frames of the video streams, each with a duration
+  /// extended up to the next key frame, e.g. for trick play outputs. The
+  /// other video samples are not read if the parser can skip them. Must be
+  /// called after Init and before any data is parsed.
+  /// @return true if successful, false if the parser does not support it.
+  virtual bool SetVideoKeyFramesOnly() { return false; }
+
+  /// Emits only the samples of the audio and video streams in a time range,
+  /// starting each stream at the sync sample at or before @a start_seconds,
+  /// so the samples before it are not read. The times are relative to the
+  /// timestamp of the first sample read. Must be called after
+  /// InitRandomAccess succeeds and before any sample is read.
+  /// @param start_seconds is the start of the time range.
+  /// @param end_seconds is the end of the time range. The samples decoded at
+  ///        or after it are not emitted. 0 means the end of the streams.
+  /// @return true if successful, false if the parser does not support it.
+  virtual bool SetTimeRange(double start_seconds, double end_seconds) {
+    return false;
+  }
+
+  /// Sets up random access reads of the media file, so only the data that is
+  /// needed is read, instead of parsing the file as a forward stream with
+  /// Parse. Must be called after Init and instead of Parse.
+  /// @param file_path is the path to the media file to be read.
+  /// @return true if successful, false otherwise, e.g. if random access is not
+  ///         supported for the file. The file can then be parsed with Parse.
+  virtual bool InitRandomAccess(const std::string& file_path) { return false; }
+
+  /// Reads and emits the next samples. Only valid after InitRandomAccess
+  /// succeeds.
+  /// @param[out] end_of_stream is set to true if all the samples are read.
+  /// @return true if successful, false otherwise.
+  virtual bool ReadNextChunk(bool* end_of_stream) WARN_UNUSED_RESULT {
+    return false;
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(MediaParser);
 };
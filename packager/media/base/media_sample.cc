@@ -60,6 +60,34 @@ std::shared_ptr<MediaSample> MediaSample::CopyFrom(const uint8_t* data,
       data, data_size, side_data, side_data_size, is_key_frame));
 }
 
+// static
+std::shared_ptr<MediaSample> MediaSample::FromSharedData(
+    std::shared_ptr<const uint8_t> data,
+    size_t data_size,
+    bool is_key_frame) {
+  // If you hit this CHECK you likely have a bug in a demuxer. Go fix it.
+  CHECK(data);
+  std::shared_ptr<MediaSample> sample(new MediaSample);
+  sample->is_key_frame_ = is_key_frame;
+  sample->TransferData(std::move(data), data_size);
+  return sample;
+}
+
+// static
+std::shared_ptr<MediaSample> MediaSample::FromVector(std::vector<uint8_t> data,
+                                                     bool is_key_frame) {
+  const size_t data_size = data.size();
+  std::shared_ptr<std::vector<uint8_t>> shared_vector(
+      new std::vector<uint8_t>(std::move(data)));
+  // The aliasing constructor keeps |shared_vector| alive as long as the data
+  // is referenced.
+  std::shared_ptr<uint8_t> shared_data(shared_vector, shared_vector->data());
+  std::shared_ptr<MediaSample> sample(new MediaSample);
+  sample->is_key_frame_ = is_key_frame;
+  sample->TransferData(std::move(shared_data), data_size);
+  return sample;
+}
+
 // static
 std::shared_ptr<MediaSample> MediaSample::FromMetadata(const uint8_t* metadata,
                                                        size_t metadata_size) {
@@ -87,9 +115,11 @@ std::shared_ptr<MediaSample> MediaSample::Clone() const {
   new_media_sample->is_encrypted_ = is_encrypted_;
   new_media_sample->data_ = data_;
   new_media_sample->data_size_ = data_size_;
+  new_media_sample->data_writable_ = data_writable_;
   new_media_sample->side_data_ = side_data_;
   new_media_sample->side_data_size_ = side_data_size_;
   new_media_sample->config_id_ = config_id_;
+  new_media_sample->arrival_time_ = arrival_time_;
   if (decrypt_config_) {
     new_media_sample->decrypt_config_.reset(new DecryptConfig(
         decrypt_config_->key_id(), decrypt_config_->iv(),
@@ -100,10 +130,18 @@ std::shared_ptr<MediaSample> MediaSample::Clone() const {
   return new_media_sample;
 }
 
+void MediaSample::TransferData(std::shared_ptr<const uint8_t> data,
+                               size_t data_size) {
+  data_ = std::move(data);
+  data_size_ = data_size;
+  data_writable_ = false;
+}
+
 void MediaSample::TransferData(std::shared_ptr<uint8_t> data,
                                size_t data_size) {
   data_ = std::move(data);
   data_size_ = data_size;
+  data_writable_ = true;
 }
 
 void MediaSample::SetData(const uint8_t* data, size_t data_size) {
@@ -113,6 +151,14 @@ void MediaSample::SetData(const uint8_t* data, size_t data_size) {
   TransferData(std::move(shared_data), data_size);
 }
 
+uint8_t* MediaSample::writable_data() {
+  DCHECK(!end_of_stream());
+  if (!is_data_writable())
+    SetData(data_.get(), data_size_);
+  // |data_| is owned by this sample only, so it is safe to modify.
+  return const_cast<uint8_t*>(data_.get());
+}
+
 std::string MediaSample::ToString() const {
   if (end_of_stream())
     return "End of stream sample\n";
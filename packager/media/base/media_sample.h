@@ -13,13 +13,16 @@
 #include <vector>
 
 #include "packager/base/logging.h"
+#include "packager/base/time/time.h"
 #include "packager/media/base/decrypt_config.h"
+#include "packager/media/base/object_pool.h"
 
 namespace shaka {
 namespace media {
 
-/// Class to hold a media sample.
-class MediaSample {
+/// Class to hold a media sample. MediaSample objects are allocated from a
+/// thread local pool, see PooledObject.
+class MediaSample : public PooledObject<MediaSample> {
  public:
   /// Create a MediaSample object from input.
   /// @param data points to the buffer containing the sample data.
@@ -45,6 +48,26 @@ class MediaSample {
                                                size_t side_data_size,
                                                bool is_key_frame);
 
+  /// Create a MediaSample object which shares the sample data with @a data.
+  /// No data copying is involved. @a data can be a slice of a larger
+  /// reference counted buffer, e.g. created with the std::shared_ptr aliasing
+  /// constructor. The data must not be modified afterwards.
+  /// @param data points to the buffer containing the sample data.
+  ///        Must not be NULL.
+  /// @param size indicates sample size in bytes.
+  /// @param is_key_frame indicates whether the sample is a key frame.
+  static std::shared_ptr<MediaSample> FromSharedData(
+      std::shared_ptr<const uint8_t> data,
+      size_t size,
+      bool is_key_frame);
+
+  /// Create a MediaSample object which takes over the sample data in @a data.
+  /// No data copying is involved.
+  /// @param data contains the sample data.
+  /// @param is_key_frame indicates whether the sample is a key frame.
+  static std::shared_ptr<MediaSample> FromVector(std::vector<uint8_t> data,
+                                                 bool is_key_frame);
+
   /// Create a MediaSample object from metadata.
   /// Unlike other factory methods, this cannot be a key frame. It must be only
   /// for metadata.
@@ -64,10 +87,19 @@ class MediaSample {
 
   virtual ~MediaSample();
 
-  /// Clone the object and return a new MediaSample.
+  /// Clone the object and return a new MediaSample. The sample data is shared
+  /// with the new MediaSample, and is only copied if either sample modifies it
+  /// with writable_data().
   std::shared_ptr<MediaSample> Clone() const;
 
-  /// Transfer data to this media sample. No data copying is involved.
+  /// Transfer data to this media sample. No data copying is involved. The
+  /// data is read-only, i.e. writable_data() copies it.
+  /// @param data points to the data to be transferred.
+  /// @param data_size is the size of the data to be transferred.
+  void TransferData(std::shared_ptr<const uint8_t> data, size_t data_size);
+
+  /// Transfer data to this media sample. No data copying is involved. The
+  /// data can be modified with writable_data() as long as it is not shared.
   /// @param data points to the data to be transferred.
   /// @param data_size is the size of the data to be transferred.
   void TransferData(std::shared_ptr<uint8_t> data, size_t data_size);
@@ -119,6 +151,25 @@ class MediaSample {
     return data_.get();
   }
 
+  /// @return the sample data for modification. The data is copied first,
+  ///         i.e. copy-on-write, unless it is writable and is not shared with
+  ///         other samples or buffers.
+  uint8_t* writable_data();
+
+  /// @return true if writable_data() does not copy the data.
+  bool is_data_writable() const {
+    DCHECK(!end_of_stream());
+    return data_writable_ && data_.use_count() == 1;
+  }
+
+  /// @return the reference counted sample data, which can be kept after the
+  ///         sample is destroyed. The data is shared, so writable_data()
+  ///         copies it as long as the returned reference is kept.
+  std::shared_ptr<const uint8_t> shared_data() const {
+    DCHECK(!end_of_stream());
+    return data_;
+  }
+
   size_t data_size() const {
     DCHECK(!end_of_stream());
     return data_size_;
@@ -150,6 +201,13 @@ class MediaSample {
     config_id_ = config_id;
   }
 
+  /// @return the time the sample arrived at the input, if stamped, to
+  ///         measure the latency it accumulates through the packager.
+  base::TimeTicks arrival_time() const { return arrival_time_; }
+  void set_arrival_time(base::TimeTicks arrival_time) {
+    arrival_time_ = arrival_time;
+  }
+
  protected:
   // Made it protected to disallow the constructor to be called directly.
   // Create a MediaSample. Buffer will be padded and aligned as necessary.
@@ -174,6 +232,9 @@ class MediaSample {
   // Main buffer data.
   std::shared_ptr<const uint8_t> data_;
   size_t data_size_ = 0;
+  // Set if |data_| is owned by the samples, i.e. it can be modified when it is
+  // not shared.
+  bool data_writable_ = false;
   // Contain additional buffers to complete the main one. Needed by WebM
   // http://www.matroska.org/technical/specs/index.html BlockAdditional[A5].
   // Not used by mp4 and other containers.
@@ -184,6 +245,9 @@ class MediaSample {
   // For now this is the cue identifier for WebVTT.
   std::string config_id_;
 
+  // Null unless the input stamps its samples.
+  base::TimeTicks arrival_time_;
+
   // Decrypt configuration.
   std::unique_ptr<DecryptConfig> decrypt_config_;
 
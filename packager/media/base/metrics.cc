@@ -0,0 +1,226 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/metrics.h"
+
+#include <inttypes.h>
+
+#include <utility>
+
+#include "packager/base/logging.h"
+#include "packager/base/macros.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/stringprintf.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+// Upper bounds of the latency histogram buckets, in seconds. Covers file
+// writes as well as network round trips to key servers.
+const double kLatencyBucketsInSeconds[] = {
+    0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1,
+    0.25,  0.5,    1,     2.5,  5,     10,   30,
+};
+const size_t kNumLatencyBuckets = arraysize(kLatencyBucketsInSeconds);
+
+std::string WithLabels(const std::string& name,
+                       const std::string& labels,
+                       const std::string& extra_label) {
+  std::string all_labels = labels;
+  if (!extra_label.empty()) {
+    if (!all_labels.empty())
+      all_labels += ",";
+    all_labels += extra_label;
+  }
+  return all_labels.empty() ? name : name + "{" + all_labels + "}";
+}
+
+}  // namespace
+
+Metrics* Metrics::GetInstance() {
+  // Never destroyed, so the metrics can be recorded from any thread until the
+  // very end of the process.
+  static Metrics* const metrics = new Metrics;
+  return metrics;
+}
+
+Metrics::Metrics() {}
+
+Metrics::~Metrics() {}
+
+void Metrics::Enable() {
+  enabled_ = true;
+}
+
+void Metrics::IncrementCounter(const std::string& name,
+                               const std::string& help,
+                               const std::string& labels,
+                               double value) {
+  if (!enabled_)
+    return;
+  base::AutoLock auto_lock(lock_);
+  Metric* metric = GetMetric(name, help, Type::kCounter);
+  if (metric)
+    metric->series[labels].sum += value;
+}
+
+void Metrics::ObserveLatency(const std::string& name,
+                             const std::string& help,
+                             const std::string& labels,
+                             base::TimeDelta latency) {
+  if (!enabled_)
+    return;
+  const double seconds = latency.InSecondsF();
+  base::AutoLock auto_lock(lock_);
+  Metric* metric = GetMetric(name, help, Type::kHistogram);
+  if (!metric)
+    return;
+  Series& series = metric->series[labels];
+  if (series.bucket_counts.empty())
+    series.bucket_counts.resize(kNumLatencyBuckets);
+  for (size_t i = 0; i < kNumLatencyBuckets; ++i) {
+    if (seconds <= kLatencyBucketsInSeconds[i]) {
+      ++series.bucket_counts[i];
+      break;
+    }
+  }
+  series.sum += seconds;
+  ++series.count;
+}
+
+std::string Metrics::ToPrometheusText() const {
+  std::string text;
+  base::AutoLock auto_lock(lock_);
+  for (const auto& name_and_metric : metrics_) {
+    const std::string& name = name_and_metric.first;
+    const Metric& metric = name_and_metric.second;
+    const bool is_histogram = metric.type == Type::kHistogram;
+    base::StringAppendF(&text, "# HELP %s %s\n# TYPE %s %s\n", name.c_str(),
+                        metric.help.c_str(), name.c_str(),
+                        is_histogram ? "histogram" : "counter");
+    for (const auto& labels_and_series : metric.series) {
+      const std::string& labels = labels_and_series.first;
+      const Series& series = labels_and_series.second;
+      if (!is_histogram) {
+        text += WithLabels(name, labels, "") + " " +
+                base::DoubleToString(series.sum) + "\n";
+        continue;
+      }
+      // Prometheus buckets are cumulative.
+      uint64_t cumulative_count = 0;
+      for (size_t i = 0; i < kNumLatencyBuckets; ++i) {
+        cumulative_count += series.bucket_counts[i];
+        base::StringAppendF(
+            &text, "%s %" PRIu64 "\n",
+            WithLabels(name + "_bucket", labels,
+                       base::StringPrintf("le=\"%g\"",
+                                          kLatencyBucketsInSeconds[i]))
+                .c_str(),
+            cumulative_count);
+      }
+      base::StringAppendF(
+          &text, "%s %" PRIu64 "\n",
+          WithLabels(name + "_bucket", labels, "le=\"+Inf\"").c_str(),
+          series.count);
+      text += WithLabels(name + "_sum", labels, "") + " " +
+              base::DoubleToString(series.sum) + "\n";
+      base::StringAppendF(&text, "%s %" PRIu64 "\n",
+                          WithLabels(name + "_count", labels, "").c_str(),
+                          series.count);
+    }
+  }
+  return text;
+}
+
+void Metrics::ResetForTesting() {
+  base::AutoLock auto_lock(lock_);
+  metrics_.clear();
+}
+
+Metrics::Metric* Metrics::GetMetric(const std::string& name,
+                                    const std::string& help,
+                                    Type type) {
+  lock_.AssertAcquired();
+  auto it = metrics_.find(name);
+  if (it == metrics_.end()) {
+    Metric& metric = metrics_[name];
+    metric.type = type;
+    metric.help = help;
+    return &metric;
+  }
+  if (it->second.type != type) {
+    LOG(DFATAL) << "Metric " << name << " recorded with different types.";
+    return nullptr;
+  }
+  return &it->second;
+}
+
+std::string MetricLabel(const std::string& key, const std::string& value) {
+  std::string label = key + "=\"";
+  for (const char c : value) {
+    switch (c) {
+      case '\\':
+        label += "\\\\";
+        break;
+      case '"':
+        label += "\\\"";
+        break;
+      case '\n':
+        label += "\\n";
+        break;
+      default:
+        label += c;
+        break;
+    }
+  }
+  label += "\"";
+  return label;
+}
+
+ScopedLatencyMetric::ScopedLatencyMetric(const char* name,
+                                         const char* help,
+                                         std::string labels)
+    : name_(name),
+      help_(help),
+      labels_(std::move(labels)),
+      enabled_(Metrics::GetInstance()->enabled()),
+      start_time_(enabled_ ? base::TimeTicks::Now() : base::TimeTicks()) {}
+
+ScopedLatencyMetric::~ScopedLatencyMetric() {
+  if (enabled_) {
+    Metrics::GetInstance()->ObserveLatency(
+        name_, help_, labels_, base::TimeTicks::Now() - start_time_);
+  }
+}
+
+void SegmentPublicationLatencyMetric::OnSegmentWritten(std::string labels) {
+  if (!Metrics::GetInstance()->enabled())
+    return;
+  base::AutoLock auto_lock(lock_);
+  unpublished_segments_.emplace_back(std::move(labels),
+                                     base::TimeTicks::Now());
+}
+
+void SegmentPublicationLatencyMetric::OnManifestPublished() {
+  std::vector<std::pair<std::string, base::TimeTicks>> published_segments;
+  {
+    base::AutoLock auto_lock(lock_);
+    published_segments.swap(unpublished_segments_);
+  }
+  const base::TimeTicks now = base::TimeTicks::Now();
+  for (const auto& segment : published_segments) {
+    Metrics::GetInstance()->ObserveLatency(
+        "packager_segment_to_manifest_seconds",
+        "Time between the writes of segments and the publication of the "
+        "manifests referencing them.",
+        segment.first, now - segment.second);
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
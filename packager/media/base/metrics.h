@@ -0,0 +1,150 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_METRICS_H_
+#define PACKAGER_MEDIA_BASE_METRICS_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+namespace media {
+
+/// Process-wide registry of operational metrics, i.e. counters and latency
+/// histograms, which are exported in the Prometheus text exposition format.
+/// Recording is a no-op until Enable() is called, so instrumented code does
+/// not pay for metrics nobody reads.
+///
+/// Metrics are recorded from the threads of all the jobs and exported from
+/// the metrics server thread. The registry is locked to update or export the
+/// series; whether it is enabled is read without locking.
+class Metrics {
+ public:
+  /// @return the process-wide registry.
+  static Metrics* GetInstance();
+
+  /// Enables recording of the metrics.
+  void Enable();
+  /// @return true if recording is enabled.
+  bool enabled() const { return enabled_; }
+
+  /// Adds @a value to a counter.
+  /// @param name is the name of the metric, e.g. "packager_segments_total".
+  /// @param help is the description of the metric.
+  /// @param labels identifies the time series of the metric, as created by
+  ///        MetricLabel(), and can be empty.
+  void IncrementCounter(const std::string& name,
+                        const std::string& help,
+                        const std::string& labels,
+                        double value = 1);
+
+  /// Records a latency in a histogram. See IncrementCounter() for the
+  /// parameters.
+  void ObserveLatency(const std::string& name,
+                      const std::string& help,
+                      const std::string& labels,
+                      base::TimeDelta latency);
+
+  /// @return all the metrics in the Prometheus text exposition format.
+  std::string ToPrometheusText() const;
+
+  /// Removes all the metrics. For testing only.
+  void ResetForTesting();
+
+ private:
+  Metrics();
+  ~Metrics();
+  Metrics(const Metrics&) = delete;
+  Metrics& operator=(const Metrics&) = delete;
+
+  enum class Type { kCounter, kHistogram };
+
+  struct Series {
+    // Counter value, or sum of the observations of a histogram.
+    double sum = 0;
+    // Histogram only.
+    uint64_t count = 0;
+    std::vector<uint64_t> bucket_counts;
+  };
+
+  struct Metric {
+    Type type = Type::kCounter;
+    std::string help;
+    std::map<std::string, Series> series;
+  };
+
+  Metric* GetMetric(const std::string& name,
+                    const std::string& help,
+                    Type type);
+
+  std::atomic<bool> enabled_{false};
+  mutable base::Lock lock_;
+  std::map<std::string, Metric> metrics_;
+};
+
+/// @return a label for use with Metrics, e.g. stream="video.mp4", with
+///         @a value escaped.
+std::string MetricLabel(const std::string& key, const std::string& value);
+
+/// Records the time between its construction and its destruction in a
+/// latency histogram, if metrics are enabled.
+class ScopedLatencyMetric {
+ public:
+  /// See Metrics::ObserveLatency() for the parameters.
+  ScopedLatencyMetric(const char* name, const char* help, std::string labels);
+  ~ScopedLatencyMetric();
+
+ private:
+  ScopedLatencyMetric(const ScopedLatencyMetric&) = delete;
+  ScopedLatencyMetric& operator=(const ScopedLatencyMetric&) = delete;
+
+  const char* const name_;
+  const char* const help_;
+  const std::string labels_;
+  const bool enabled_;
+  const base::TimeTicks start_time_;
+};
+
+/// Records the time between the writes of segments and the publication of
+/// the manifest referencing them in a latency histogram, if metrics are
+/// enabled.
+///
+/// The segments are reported from the muxer threads while the manifest may be
+/// published from another thread, so the write times are kept under a lock.
+class SegmentPublicationLatencyMetric {
+ public:
+  SegmentPublicationLatencyMetric() = default;
+
+  /// Called when a segment, or a partial segment, is written.
+  /// @param labels identifies the stream of the segment.
+  void OnSegmentWritten(std::string labels);
+  /// Called when the manifest referencing the segments written so far is
+  /// published.
+  void OnManifestPublished();
+
+ private:
+  SegmentPublicationLatencyMetric(const SegmentPublicationLatencyMetric&) =
+      delete;
+  SegmentPublicationLatencyMetric& operator=(
+      const SegmentPublicationLatencyMetric&) = delete;
+
+  base::Lock lock_;
+  // The labels and the write times of the segments not published yet.
+  std::vector<std::pair<std::string, base::TimeTicks>> unpublished_segments_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_METRICS_H_
@@ -0,0 +1,84 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/metrics.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::HasSubstr;
+
+namespace shaka {
+namespace media {
+
+class MetricsTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    metrics_->Enable();
+    metrics_->ResetForTesting();
+  }
+
+  void TearDown() override { metrics_->ResetForTesting(); }
+
+  Metrics* metrics_ = Metrics::GetInstance();
+};
+
+TEST_F(MetricsTest, Counter) {
+  const std::string labels = MetricLabel("stream", "a.mp4");
+  metrics_->IncrementCounter("bytes_total", "Bytes.", labels, 100);
+  metrics_->IncrementCounter("bytes_total", "Bytes.", labels, 20);
+  metrics_->IncrementCounter("bytes_total", "Bytes.",
+                             MetricLabel("stream", "b.mp4"), 5);
+
+  EXPECT_EQ(
+      "# HELP bytes_total Bytes.\n"
+      "# TYPE bytes_total counter\n"
+      "bytes_total{stream=\"a.mp4\"} 120\n"
+      "bytes_total{stream=\"b.mp4\"} 5\n",
+      metrics_->ToPrometheusText());
+}
+
+TEST_F(MetricsTest, Histogram) {
+  metrics_->ObserveLatency("latency_seconds", "Latency.", "",
+                           base::TimeDelta::FromMilliseconds(3));
+  metrics_->ObserveLatency("latency_seconds", "Latency.", "",
+                           base::TimeDelta::FromSeconds(60));
+
+  const std::string text = metrics_->ToPrometheusText();
+  EXPECT_THAT(text, HasSubstr("# TYPE latency_seconds histogram\n"));
+  EXPECT_THAT(text, HasSubstr("latency_seconds_bucket{le=\"0.0025\"} 0\n"));
+  EXPECT_THAT(text, HasSubstr("latency_seconds_bucket{le=\"0.005\"} 1\n"));
+  EXPECT_THAT(text, HasSubstr("latency_seconds_bucket{le=\"30\"} 1\n"));
+  EXPECT_THAT(text, HasSubstr("latency_seconds_bucket{le=\"+Inf\"} 2\n"));
+  EXPECT_THAT(text, HasSubstr("latency_seconds_sum 60.00"));
+  EXPECT_THAT(text, HasSubstr("latency_seconds_count 2\n"));
+}
+
+TEST_F(MetricsTest, LabelEscaping) {
+  EXPECT_EQ("file=\"a\\\\b\\\"c\\n\"", MetricLabel("file", "a\\b\"c\n"));
+}
+
+TEST_F(MetricsTest, SegmentPublicationLatency) {
+  SegmentPublicationLatencyMetric publication_latency;
+  publication_latency.OnSegmentWritten(MetricLabel("output", "a.mp4"));
+  publication_latency.OnSegmentWritten(MetricLabel("output", "a.mp4"));
+  publication_latency.OnSegmentWritten(MetricLabel("output", "b.mp4"));
+  publication_latency.OnManifestPublished();
+  // Only the segments written since the last publication are recorded.
+  publication_latency.OnManifestPublished();
+
+  const std::string text = metrics_->ToPrometheusText();
+  EXPECT_THAT(text,
+              HasSubstr("# TYPE packager_segment_to_manifest_seconds "
+                        "histogram\n"));
+  EXPECT_THAT(text, HasSubstr("packager_segment_to_manifest_seconds_count{"
+                              "output=\"a.mp4\"} 2\n"));
+  EXPECT_THAT(text, HasSubstr("packager_segment_to_manifest_seconds_count{"
+                              "output=\"b.mp4\"} 1\n"));
+}
+
+}  // namespace media
+}  // namespace shaka
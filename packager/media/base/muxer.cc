@@ -8,7 +8,10 @@
 
 #include <algorithm>
 
+#include "packager/base/logging.h"
+#include "packager/base/trace_event/trace_event.h"
 #include "packager/media/base/media_sample.h"
+#include "packager/media/base/metrics.h"
 #include "packager/media/base/muxer_util.h"
 #include "packager/status_macros.h"
 
@@ -44,11 +47,35 @@ void Muxer::SetProgressListener(
 Status Muxer::Process(std::unique_ptr<StreamData> stream_data) {
   Status status;
   switch (stream_data->stream_data_type) {
-    case StreamDataType::kStreamInfo:
-      streams_.push_back(std::move(stream_data->stream_info));
-      return ReinitializeMuxer(kStartTime);
+    case StreamDataType::kStreamInfo: {
+      // Stream infos of multiple input streams may not arrive in stream index
+      // order.
+      const size_t stream_index = stream_data->stream_index;
+      if (streams_.size() <= stream_index)
+        streams_.resize(stream_index + 1);
+      if (streams_[stream_index]) {
+        // The stream info of a stream changes after a cue event, e.g. between
+        // concatenated inputs with different codec configurations. The muxer
+        // is re-initialized with the new stream infos before the next media.
+        if (output_file_template_.empty() && !CanReinitializeInPlace()) {
+          return Status(error::UNIMPLEMENTED,
+                        "Changing the stream info of '" +
+                            options_.output_file_name +
+                            "' needs an output file name template.");
+        }
+        if (!reinitialize_pending_) {
+          RETURN_IF_ERROR(
+              FinalizeAndReinitializeLater(stream_index, kStartTime));
+        }
+        streams_[stream_index] = stream_data->release_stream_info();
+        return Status::OK;
+      }
+      streams_[stream_index] = stream_data->release_stream_info();
+      return ReinitializeMuxer(kStartTime, *streams_[stream_index]);
+    }
     case StreamDataType::kSegmentInfo: {
-      const auto& segment_info = *stream_data->segment_info;
+      RETURN_IF_ERROR(ReinitializeIfPending());
+      const auto& segment_info = *stream_data->segment_info();
       if (muxer_listener_ && segment_info.is_encrypted) {
         const EncryptionConfig* encryption_config =
             segment_info.key_rotation_encryption_config.get();
@@ -65,28 +92,54 @@ Status Muxer::Process(std::unique_ptr<StreamData> stream_data) {
           muxer_listener_->OnEncryptionStart();
         }
       }
-      return FinalizeSegment(stream_data->stream_index, segment_info);
+      TRACE_EVENT1("shaka", "Muxer::FinalizeSegment", "is_subsegment",
+                   segment_info.is_subsegment);
+      {
+        ScopedLatencyMetric write_latency(
+            "packager_segment_write_seconds",
+            "Time spent finalizing and writing segments.",
+            Metrics::GetInstance()->enabled() ? GetMetricLabels()
+                                              : std::string());
+        RETURN_IF_ERROR(
+            FinalizeSegment(stream_data->stream_index, segment_info));
+      }
+      ObserveInputToSegmentLatency(segment_info.is_subsegment);
+      return Status::OK;
+    }
+    case StreamDataType::kMediaSample: {
+      RETURN_IF_ERROR(ReinitializeIfPending());
+      const MediaSample& sample = *stream_data->media_sample();
+      if (segment_arrival_time_.is_null())
+        segment_arrival_time_ = sample.arrival_time();
+      if (subsegment_arrival_time_.is_null())
+        subsegment_arrival_time_ = sample.arrival_time();
+      RETURN_IF_ERROR(AddMediaSample(stream_data->stream_index, sample));
+      UpdateProgress(stream_data->stream_index,
+                     sample.pts() + sample.duration());
+      return Status::OK;
+    }
+    case StreamDataType::kTextSample: {
+      RETURN_IF_ERROR(ReinitializeIfPending());
+      const TextSample& sample = *stream_data->text_sample();
+      RETURN_IF_ERROR(AddTextSample(stream_data->stream_index, sample));
+      UpdateProgress(stream_data->stream_index, sample.EndTime());
+      return Status::OK;
     }
-    case StreamDataType::kMediaSample:
-      return AddMediaSample(stream_data->stream_index,
-                            *stream_data->media_sample);
-    case StreamDataType::kTextSample:
-      return AddTextSample(stream_data->stream_index,
-                           *stream_data->text_sample);
     case StreamDataType::kCueEvent:
       if (muxer_listener_) {
         const int64_t time_scale =
             streams_[stream_data->stream_index]->time_scale();
-        const double time_in_seconds = stream_data->cue_event->time_in_seconds;
+        const double time_in_seconds =
+            stream_data->cue_event()->time_in_seconds;
         const int64_t scaled_time =
             static_cast<int64_t>(time_in_seconds * time_scale);
         muxer_listener_->OnCueEvent(scaled_time,
-                                    stream_data->cue_event->cue_data);
+                                    stream_data->cue_event()->cue_data);
 
         // Finalize and re-initialize Muxer to generate different content files.
-        if (!output_file_template_.empty()) {
-          RETURN_IF_ERROR(Finalize());
-          RETURN_IF_ERROR(ReinitializeMuxer(scaled_time));
+        if (!output_file_template_.empty() && !reinitialize_pending_) {
+          RETURN_IF_ERROR(FinalizeAndReinitializeLater(
+              stream_data->stream_index, scaled_time));
         }
       }
       break;
@@ -100,6 +153,7 @@ Status Muxer::Process(std::unique_ptr<StreamData> stream_data) {
 }
 
 Status Muxer::OnFlushRequest(size_t input_stream_index) {
+  RETURN_IF_ERROR(ReinitializeIfPending());
   return Finalize();
 }
 
@@ -111,10 +165,11 @@ Status Muxer::AddTextSample(size_t stream_id, const TextSample& sample) {
   return Status::OK;
 }
 
-Status Muxer::ReinitializeMuxer(int64_t timestamp) {
-  if (muxer_listener_ && streams_.back()->is_encrypted()) {
+Status Muxer::ReinitializeMuxer(int64_t timestamp,
+                                const StreamInfo& stream_info) {
+  if (muxer_listener_ && stream_info.is_encrypted()) {
     const EncryptionConfig& encryption_config =
-        streams_.back()->encryption_config();
+        stream_info.encryption_config();
     muxer_listener_->OnEncryptionInfoReady(
         kInitialEncryptionInfo, encryption_config.protection_scheme,
         encryption_config.key_id, encryption_config.constant_iv,
@@ -131,5 +186,65 @@ Status Muxer::ReinitializeMuxer(int64_t timestamp) {
   return InitializeMuxer();
 }
 
+Status Muxer::FinalizeAndReinitializeLater(size_t stream_index,
+                                           int64_t timestamp) {
+  RETURN_IF_ERROR(Finalize());
+  reinitialize_pending_ = true;
+  reinitialize_stream_index_ = stream_index;
+  reinitialize_timestamp_ = timestamp;
+  return Status::OK;
+}
+
+Status Muxer::ReinitializeIfPending() {
+  if (!reinitialize_pending_)
+    return Status::OK;
+  reinitialize_pending_ = false;
+  return ReinitializeMuxer(reinitialize_timestamp_,
+                           *streams_[reinitialize_stream_index_]);
+}
+
+void Muxer::UpdateProgress(size_t stream_index, int64_t end_time) {
+  num_samples_.fetch_add(1, std::memory_order_relaxed);
+  DCHECK_LT(stream_index, streams_.size());
+  const uint32_t time_scale = streams_[stream_index]->time_scale();
+  if (time_scale == 0)
+    return;
+  const double end_time_in_seconds =
+      static_cast<double>(end_time) / time_scale;
+  // Only this thread writes the media time.
+  if (end_time_in_seconds > media_time_in_seconds_)
+    media_time_in_seconds_ = end_time_in_seconds;
+}
+
+std::string Muxer::GetMetricLabels() const {
+  return MetricLabel("output", options_.segment_template.empty()
+                                   ? options_.output_file_name
+                                   : options_.segment_template);
+}
+
+void Muxer::ObserveInputToSegmentLatency(bool is_subsegment) {
+  const base::TimeTicks arrival_time =
+      is_subsegment ? subsegment_arrival_time_ : segment_arrival_time_;
+  subsegment_arrival_time_ = base::TimeTicks();
+  if (!is_subsegment)
+    segment_arrival_time_ = base::TimeTicks();
+  if (arrival_time.is_null())
+    return;
+  const base::TimeDelta latency = base::TimeTicks::Now() - arrival_time;
+  if (is_subsegment) {
+    Metrics::GetInstance()->ObserveLatency(
+        "packager_input_to_subsegment_seconds",
+        "Time between the arrival of the first sample of subsegments, e.g. "
+        "low latency chunks, at the input and their writes.",
+        GetMetricLabels(), latency);
+  } else {
+    Metrics::GetInstance()->ObserveLatency(
+        "packager_input_to_segment_seconds",
+        "Time between the arrival of the first sample of segments at the "
+        "input and their writes.",
+        GetMetricLabels(), latency);
+  }
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -9,10 +9,13 @@
 #ifndef PACKAGER_MEDIA_BASE_MUXER_H_
 #define PACKAGER_MEDIA_BASE_MUXER_H_
 
+#include <atomic>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "packager/base/time/clock.h"
+#include "packager/base/time/time.h"
 #include "packager/media/base/media_handler.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/event/muxer_listener.h"
@@ -58,6 +61,13 @@ class Muxer : public MediaHandler {
     clock_ = clock;
   }
 
+  /// @return The number of media and text samples muxed so far. Can be called
+  ///         from any thread.
+  uint64_t num_samples() const { return num_samples_; }
+  /// @return The end of the last sample muxed so far, in seconds. Can be
+  ///         called from any thread.
+  double media_time_in_seconds() const { return media_time_in_seconds_; }
+
  protected:
   /// @name MediaHandler implementation overrides.
   /// @{
@@ -83,6 +93,11 @@ class Muxer : public MediaHandler {
   // Final clean up.
   virtual Status Finalize() = 0;
 
+  // Whether the muxer can go on with changed stream infos in the same
+  // outputs, i.e. InitializeMuxer() keeps the segment numbering. Otherwise the
+  // output file name must be a template.
+  virtual bool CanReinitializeInPlace() const { return false; }
+
   // Add a new media sample.  This does nothing by default; so subclasses that
   // handle media samples will need to replace this.
   virtual Status AddMediaSample(size_t stream_id, const MediaSample& sample);
@@ -97,8 +112,22 @@ class Muxer : public MediaHandler {
       const SegmentInfo& segment_info) = 0;
 
   // Re-initialize Muxer. Could be called on StreamInfo or CueEvent.
-  // |timestamp| may be used to set the output file name.
-  Status ReinitializeMuxer(int64_t timestamp);
+  // |timestamp| may be used to set the output file name. |stream_info| is the
+  // stream the StreamInfo or CueEvent is on.
+  Status ReinitializeMuxer(int64_t timestamp, const StreamInfo& stream_info);
+  // Finalizes the current outputs and re-initializes the muxer before the next
+  // media, so the stream infos that change after a cue event are used.
+  Status FinalizeAndReinitializeLater(size_t stream_index, int64_t timestamp);
+  Status ReinitializeIfPending();
+
+  // Identifies the output in Metrics.
+  std::string GetMetricLabels() const;
+  // Records the time since the first sample of the segment, or subsegment,
+  // just written arrived at the input, if the samples are stamped.
+  void ObserveInputToSegmentLatency(bool is_subsegment);
+  // Counts a sample muxed and advances the media time to its |end_time|, in
+  // the time scale of the stream.
+  void UpdateProgress(size_t stream_index, int64_t end_time);
 
   MuxerOptions options_;
   std::vector<std::shared_ptr<const StreamInfo>> streams_;
@@ -115,6 +144,19 @@ class Muxer : public MediaHandler {
   // be a template. In this case, there will be NumAdCues + 1 files generated.
   std::string output_file_template_;
   size_t output_file_index_ = 0;
+  // Set by FinalizeAndReinitializeLater().
+  bool reinitialize_pending_ = false;
+  size_t reinitialize_stream_index_ = 0;
+  int64_t reinitialize_timestamp_ = 0;
+
+  // Arrival times of the first samples of the current segment and subsegment.
+  // Null if the samples are not stamped.
+  base::TimeTicks segment_arrival_time_;
+  base::TimeTicks subsegment_arrival_time_;
+
+  // Progress of the output, read from other threads.
+  std::atomic<uint64_t> num_samples_{0};
+  std::atomic<double> media_time_in_seconds_{0};
 };
 
 }  // namespace media
@@ -10,12 +10,17 @@
 #include <stdint.h>
 
 #include <string>
+#include <vector>
 
 #include "packager/media/public/mp4_output_params.h"
 
 namespace shaka {
 namespace media {
 
+class SegmentCheckpoint;
+class SegmentDigestFile;
+enum class DigestAlgorithm;
+
 /// This structure contains the list of configuration options for Muxer.
 struct MuxerOptions {
   MuxerOptions();
@@ -45,6 +50,37 @@ struct MuxerOptions {
   /// User-specified bit rate for the media stream. If zero, the muxer will
   /// attempt to estimate.
   uint32_t bandwidth = 0;
+
+  /// Target segment duration in seconds, used by single file muxers to
+  /// estimate the number of segments before they are written. Zero if
+  /// unknown.
+  double segment_duration_in_seconds = 0;
+
+  /// Write every fragment of a segment to its own partial segment file as soon
+  /// as it is finalized, in addition to the segment, for Low-Latency HLS.
+  /// Only applies to fMP4 outputs with a segment template.
+  bool write_partial_segments = false;
+
+  /// Write every fragment of a segment to the segment file and flush it as soon
+  /// as it is finalized, e.g. for chunked transfer of low latency DASH
+  /// segments. 'sidx' is not generated in the media segments as it has to
+  /// precede the fragments. Only applies to fMP4 outputs with a segment
+  /// template.
+  bool write_chunked_segments = false;
+
+  /// If set, the media segments recorded in it as written by a previous run
+  /// are not written again, and the segments written are recorded in it. Only
+  /// applies to MP4 and MPEG2-TS outputs with a segment template. Not owned.
+  SegmentCheckpoint* segment_checkpoint = nullptr;
+
+  /// The digests computed for each media segment file as it is written, and
+  /// reported with MuxerListener::OnSegmentDigests(). Only applies to the
+  /// outputs with a segment template.
+  std::vector<DigestAlgorithm> segment_digests;
+
+  /// If set, the digests of the media segments are also recorded in it. Not
+  /// owned.
+  SegmentDigestFile* segment_digest_file = nullptr;
 };
 
 }  // namespace media
@@ -6,8 +6,6 @@
 
 #include "packager/media/base/muxer_util.h"
 
-#include <inttypes.h>
-
 #include <string>
 #include <vector>
 
@@ -113,55 +111,135 @@ std::string GetSegmentName(const std::string& segment_template,
                            uint32_t segment_index,
                            uint32_t bandwidth) {
   DCHECK_EQ(Status::OK, ValidateSegmentTemplate(segment_template));
+  return SegmentNameFormatter(segment_template)
+      .Format(segment_start_time, segment_index, bandwidth);
+}
 
-  std::vector<std::string> splits = base::SplitString(
-      segment_template, "$", base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
-  // "$" always appears in pairs, so there should be odd number of splits.
-  DCHECK_EQ(1u, splits.size() % 2);
-
-  std::string segment_name;
-  for (size_t i = 0; i < splits.size(); ++i) {
-    // Every second substring in split output should be an identifier.
-    // Simply copy the non-identifier part.
-    if (i % 2 == 0) {
-      segment_name += splits[i];
-      continue;
+SegmentNameFormatter::SegmentNameFormatter(
+    const std::string& segment_template) {
+  DCHECK(segment_template.empty() ||
+         ValidateSegmentTemplate(segment_template).ok());
+
+  Part part;
+  size_t pos = 0;
+  while (pos < segment_template.size()) {
+    const size_t start = segment_template.find('$', pos);
+    // "$" always appears in pairs.
+    const size_t end = start == std::string::npos
+                           ? std::string::npos
+                           : segment_template.find('$', start + 1);
+    if (end == std::string::npos) {
+      part.text.append(segment_template, pos, std::string::npos);
+      break;
     }
-    if (splits[i].empty()) {
+    part.text.append(segment_template, pos, start - pos);
+    pos = end + 1;
+    if (end == start + 1) {
       // "$$" is an escape sequence, replaced with a single "$".
-      segment_name += "$";
+      part.text += '$';
       continue;
     }
-    size_t format_pos = splits[i].find('%');
-    std::string identifier = splits[i].substr(0, format_pos);
-    DCHECK(identifier == "Number" || identifier == "Time" ||
-           identifier == "Bandwidth");
-
-    std::string format_tag;
-    if (format_pos != std::string::npos) {
-      format_tag = splits[i].substr(format_pos);
-      DCHECK_EQ(Status::OK, ValidateFormatTag(format_tag));
-      // Replace %d formatting to correctly format uint64_t.
-      format_tag = format_tag.substr(0, format_tag.size() - 1) + PRIu64;
-    } else {
-      // Default format tag "%01d", modified to format uint64_t correctly.
-      format_tag = "%01" PRIu64;
-    }
 
+    const std::string identifier_and_tag =
+        segment_template.substr(start + 1, end - start - 1);
+    const size_t format_pos = identifier_and_tag.find('%');
+    const std::string identifier = identifier_and_tag.substr(0, format_pos);
     if (identifier == "Number") {
-      // SegmentNumber starts from 1.
-      segment_name += base::StringPrintf(
-          format_tag.c_str(), static_cast<uint64_t>(segment_index + 1));
+      part.identifier = Identifier::kNumber;
     } else if (identifier == "Time") {
-      segment_name +=
-          base::StringPrintf(format_tag.c_str(), segment_start_time);
-    } else if (identifier == "Bandwidth") {
-      segment_name += base::StringPrintf(format_tag.c_str(),
-                                         static_cast<uint64_t>(bandwidth));
+      part.identifier = Identifier::kTime;
+    } else {
+      DCHECK_EQ("Bandwidth", identifier);
+      part.identifier = Identifier::kBandwidth;
     }
+    if (format_pos != std::string::npos) {
+      // The format tag follows this prototype: %0[width]d.
+      unsigned width = 1;
+      if (base::StringToUint(
+              identifier_and_tag.substr(
+                  format_pos + 2, identifier_and_tag.size() - format_pos - 3),
+              &width)) {
+        part.width = width;
+      }
+    }
+    parts_.push_back(std::move(part));
+    part = Part();
   }
+  if (!part.text.empty())
+    parts_.push_back(std::move(part));
+}
+
+std::string SegmentNameFormatter::Format(uint64_t segment_start_time,
+                                         uint32_t segment_index,
+                                         uint32_t bandwidth) const {
+  std::string segment_name;
+  Format(segment_start_time, segment_index, bandwidth, &segment_name);
   return segment_name;
 }
 
+void SegmentNameFormatter::Format(uint64_t segment_start_time,
+                                  uint32_t segment_index,
+                                  uint32_t bandwidth,
+                                  std::string* segment_name) const {
+  segment_name->clear();
+  for (const Part& part : parts_) {
+    segment_name->append(part.text);
+
+    uint64_t value = 0;
+    switch (part.identifier) {
+      case Identifier::kNone:
+        continue;
+      case Identifier::kNumber:
+        // SegmentNumber starts from 1.
+        value = static_cast<uint64_t>(segment_index) + 1;
+        break;
+      case Identifier::kTime:
+        value = segment_start_time;
+        break;
+      case Identifier::kBandwidth:
+        value = bandwidth;
+        break;
+    }
+
+    // The digits of |value|, from the last one.
+    char digits[20];
+    size_t num_digits = 0;
+    do {
+      digits[num_digits++] = '0' + value % 10;
+      value /= 10;
+    } while (value > 0);
+    if (part.width > num_digits)
+      segment_name->append(part.width - num_digits, '0');
+    while (num_digits > 0)
+      segment_name->push_back(digits[--num_digits]);
+  }
+}
+
+std::string GetPartialSegmentName(const std::string& segment_name,
+                                  uint32_t partial_segment_index) {
+  const std::string part_suffix =
+      base::StringPrintf(".part%u", partial_segment_index);
+  // Only a dot in the last path component starts the extension.
+  const size_t last_separator_pos = segment_name.find_last_of("/\\");
+  const size_t extension_pos = segment_name.rfind('.');
+  if (extension_pos == std::string::npos ||
+      (last_separator_pos != std::string::npos &&
+       extension_pos < last_separator_pos)) {
+    return segment_name + part_suffix;
+  }
+  std::string partial_segment_name = segment_name;
+  partial_segment_name.insert(extension_pos, part_suffix);
+  return partial_segment_name;
+}
+
+bool IsNewSegmentIndex(int64_t new_index, int64_t current_index) {
+  return new_index != current_index &&
+         // Index is calculated from pts, which could decrease. We do not expect
+         // it to decrease by more than one segment though, which could happen
+         // only if there is a big overlap in the timeline, in which case, we
+         // will create a new segment and leave it to the player to handle it.
+         new_index != current_index - 1;
+}
+
 }  // namespace media
 }  // namespace shaka
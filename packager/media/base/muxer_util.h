@@ -11,6 +11,9 @@
 
 #include <stdint.h>
 
+#include <string>
+#include <vector>
+
 #include "packager/status.h"
 
 namespace shaka {
@@ -37,6 +40,60 @@ std::string GetSegmentName(const std::string& segment_template,
                            uint32_t segment_index,
                            uint32_t bandwidth);
 
+/// A segment template parsed once, which builds the names of the segments
+/// without parsing the template again. Each muxer, or its segmenter, keeps
+/// one for its segments.
+class SegmentNameFormatter {
+ public:
+  /// @param segment_template is the segment template pattern, which should
+  ///        comply with ISO/IEC 23009-1:2012 5.3.9.4.4, or empty for muxers
+  ///        without segment template, which do not build segment names.
+  explicit SegmentNameFormatter(const std::string& segment_template);
+
+  /// Build the segment name from provided input, like GetSegmentName().
+  std::string Format(uint64_t segment_start_time,
+                     uint32_t segment_index,
+                     uint32_t bandwidth) const;
+
+  /// Same as above, but the name replaces the content of @a segment_name,
+  /// whose storage is reused.
+  void Format(uint64_t segment_start_time,
+              uint32_t segment_index,
+              uint32_t bandwidth,
+              std::string* segment_name) const;
+
+ private:
+  enum class Identifier { kNone, kNumber, kTime, kBandwidth };
+
+  // A part of the template: some text, then an identifier, if any.
+  struct Part {
+    std::string text;
+    Identifier identifier = Identifier::kNone;
+    // The minimum number of digits of the identifier value.
+    size_t width = 1;
+  };
+
+  std::vector<Part> parts_;
+};
+
+/// Build the name of a partial segment, i.e. a fragment of a segment written
+/// to its own file for low latency streaming.
+/// @param segment_name is the name of the containing segment.
+/// @param partial_segment_index specifies the index of the partial segment in
+///        the containing segment, starting from 0.
+/// @return The segment name with ".part<index>" inserted before the extension,
+///         e.g. "segment_1.part0.m4s".
+std::string GetPartialSegmentName(const std::string& segment_name,
+                                  uint32_t partial_segment_index);
+
+/// Tells whether a key frame starts a new segment, given the index of the
+/// segment its timestamp falls in.
+/// @param new_index is the segment index of the key frame, i.e. its timestamp
+///        divided by the segment duration.
+/// @param current_index is the index of the current segment.
+/// @return true if the key frame starts a new segment.
+bool IsNewSegmentIndex(int64_t new_index, int64_t current_index);
+
 }  // namespace media
 }  // namespace shaka
 
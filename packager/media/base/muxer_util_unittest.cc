@@ -153,5 +153,31 @@ TEST(MuxerUtilTest, GetSegmentNameLargeTime) {
                            kBandwidth));
 }
 
+TEST(MuxerUtilTest, SegmentNameFormatter) {
+  const SegmentNameFormatter formatter("foo$$_$Time%03d$-$Bandwidth$.m4s");
+  std::string segment_name = "previous_segment_name.m4s";
+  formatter.Format(12, 11, 1234, &segment_name);
+  EXPECT_EQ("foo$_012-1234.m4s", segment_name);
+  formatter.Format(1601599839840ULL, 12, 1234, &segment_name);
+  EXPECT_EQ("foo$_1601599839840-1234.m4s", segment_name);
+  EXPECT_EQ("foo$_000-0.m4s", formatter.Format(0, 0, 0));
+}
+
+TEST(MuxerUtilTest, GetPartialSegmentName) {
+  EXPECT_EQ("segment_1.part0.m4s", GetPartialSegmentName("segment_1.m4s", 0));
+  EXPECT_EQ("dir.v1/segment_1.part12",
+            GetPartialSegmentName("dir.v1/segment_1", 12));
+  EXPECT_EQ("segment.tar.part2.gz", GetPartialSegmentName("segment.tar.gz", 2));
+}
+
+TEST(MuxerUtilTest, IsNewSegmentIndex) {
+  EXPECT_TRUE(IsNewSegmentIndex(3, 2));
+  EXPECT_TRUE(IsNewSegmentIndex(5, 2));
+  EXPECT_FALSE(IsNewSegmentIndex(2, 2));
+  // The index may decrease by one with out of order timestamps.
+  EXPECT_FALSE(IsNewSegmentIndex(1, 2));
+  EXPECT_TRUE(IsNewSegmentIndex(0, 2));
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -0,0 +1,137 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_OBJECT_POOL_H_
+#define PACKAGER_MEDIA_BASE_OBJECT_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <new>
+
+namespace shaka {
+namespace media {
+
+/// Allocation counters of a pooled type.
+struct ObjectPoolStats {
+  /// Number of objects allocated.
+  uint64_t num_allocations = 0;
+  /// Number of allocations which were not served from the pool, i.e. the
+  /// allocations that went to the heap.
+  uint64_t num_heap_allocations = 0;
+};
+
+/// Base class which makes `new` and `delete` of the derived type T recycle the
+/// memory through a thread local free list, so allocating T in steady state
+/// does not go through malloc. Each pipeline runs on its own thread, so the
+/// free list is effectively per pipeline. It is safe to delete an object on a
+/// different thread than the one it is allocated on; the memory is recycled by
+/// the deleting thread.
+///
+/// Usage: class T : public PooledObject<T> { ... };
+template <typename T>
+class PooledObject {
+ public:
+  /// Maximum number of free objects kept per thread.
+  static const size_t kMaxFreeObjectsPerThread = 1024;
+
+  static void* operator new(size_t size) {
+    static_assert(sizeof(T) >= sizeof(FreeObject),
+                  "Pooled type is too small to hold a free list entry.");
+    num_allocations().fetch_add(1, std::memory_order_relaxed);
+    // Types derived from T may be larger; they are not pooled.
+    FreeList* free_list = GetFreeList();
+    if (size == sizeof(T) && free_list && free_list->head) {
+      FreeObject* object = free_list->head;
+      free_list->head = object->next;
+      --free_list->size;
+      return object;
+    }
+    num_heap_allocations().fetch_add(1, std::memory_order_relaxed);
+    return ::operator new(size);
+  }
+
+  static void operator delete(void* ptr, size_t size) {
+    if (!ptr)
+      return;
+    FreeList* free_list = GetFreeList();
+    if (size != sizeof(T) || !free_list ||
+        free_list->size >= kMaxFreeObjectsPerThread) {
+      ::operator delete(ptr);
+      return;
+    }
+    FreeObject* object = static_cast<FreeObject*>(ptr);
+    object->next = free_list->head;
+    free_list->head = object;
+    ++free_list->size;
+  }
+
+  /// @return The allocation counters of T across all threads.
+  static ObjectPoolStats GetObjectPoolStats() {
+    ObjectPoolStats stats;
+    stats.num_allocations = num_allocations().load(std::memory_order_relaxed);
+    stats.num_heap_allocations =
+        num_heap_allocations().load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ protected:
+  PooledObject() = default;
+  ~PooledObject() = default;
+
+ private:
+  struct FreeObject {
+    FreeObject* next;
+  };
+  struct FreeList {
+    ~FreeList() {
+      free_list_destroyed() = true;
+      while (head) {
+        FreeObject* next = head->next;
+        ::operator delete(head);
+        head = next;
+      }
+    }
+
+    FreeObject* head = nullptr;
+    size_t size = 0;
+  };
+
+  // Returns null if the free list of this thread has already been destroyed,
+  // i.e. during thread exit.
+  static FreeList* GetFreeList() {
+    if (free_list_destroyed())
+      return nullptr;
+    static thread_local FreeList free_list;
+    return &free_list;
+  }
+
+  // A trivially destructible flag, which stays valid after |free_list| is
+  // destroyed.
+  static bool& free_list_destroyed() {
+    static thread_local bool destroyed = false;
+    return destroyed;
+  }
+
+  static std::atomic<uint64_t>& num_allocations() {
+    static std::atomic<uint64_t> counter(0);
+    return counter;
+  }
+
+  static std::atomic<uint64_t>& num_heap_allocations() {
+    static std::atomic<uint64_t> counter(0);
+    return counter;
+  }
+};
+
+template <typename T>
+const size_t PooledObject<T>::kMaxFreeObjectsPerThread;
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_OBJECT_POOL_H_
@@ -0,0 +1,78 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "packager/media/base/object_pool.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+struct PooledTestObject : public PooledObject<PooledTestObject> {
+  uint64_t values[4];
+};
+
+struct DerivedPooledTestObject : public PooledTestObject {
+  uint64_t more_values[4];
+};
+
+}  // namespace
+
+TEST(ObjectPoolTest, ReusesFreedObjects) {
+  const ObjectPoolStats stats_before = PooledTestObject::GetObjectPoolStats();
+
+  std::unique_ptr<PooledTestObject> object(new PooledTestObject);
+  PooledTestObject* first_address = object.get();
+  object.reset();
+  object.reset(new PooledTestObject);
+  EXPECT_EQ(first_address, object.get());
+
+  const ObjectPoolStats stats_after = PooledTestObject::GetObjectPoolStats();
+  EXPECT_EQ(2u, stats_after.num_allocations - stats_before.num_allocations);
+  EXPECT_LE(stats_after.num_heap_allocations -
+                stats_before.num_heap_allocations,
+            1u);
+}
+
+TEST(ObjectPoolTest, NoHeapAllocationInSteadyState) {
+  const size_t kNumObjects = 100;
+  std::vector<std::unique_ptr<PooledTestObject>> objects;
+  // Warm up the pool.
+  for (size_t i = 0; i < kNumObjects; ++i)
+    objects.emplace_back(new PooledTestObject);
+  objects.clear();
+
+  const ObjectPoolStats stats_before = PooledTestObject::GetObjectPoolStats();
+  for (int round = 0; round < 10; ++round) {
+    for (size_t i = 0; i < kNumObjects; ++i)
+      objects.emplace_back(new PooledTestObject);
+    objects.clear();
+  }
+  const ObjectPoolStats stats_after = PooledTestObject::GetObjectPoolStats();
+  EXPECT_EQ(10 * kNumObjects,
+            stats_after.num_allocations - stats_before.num_allocations);
+  EXPECT_EQ(stats_before.num_heap_allocations,
+            stats_after.num_heap_allocations);
+}
+
+TEST(ObjectPoolTest, DerivedObjectsAreNotPooled) {
+  const ObjectPoolStats stats_before = PooledTestObject::GetObjectPoolStats();
+  for (int i = 0; i < 3; ++i) {
+    std::unique_ptr<DerivedPooledTestObject> object(
+        new DerivedPooledTestObject);
+    object.reset();
+  }
+  const ObjectPoolStats stats_after = PooledTestObject::GetObjectPoolStats();
+  EXPECT_EQ(3u, stats_after.num_heap_allocations -
+                    stats_before.num_heap_allocations);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -57,6 +57,27 @@ TEST_F(OffsetByteQueueTest, PeekAt) {
   EXPECT_EQ(0, size);
 }
 
+TEST_F(OffsetByteQueueTest, PushWithLargeQueuedData) {
+  uint8_t buf[100];
+  // Pushes are much larger than pops, so the queued data keeps growing.
+  for (int i = 0; i < 100; i++) {
+    for (int j = 0; j < 100; j++)
+      buf[j] = static_cast<uint8_t>(queue_->tail() + j);
+    queue_->Push(buf, sizeof(buf));
+    queue_->Pop(10);
+  }
+  EXPECT_EQ(384 + 1000, queue_->head());
+  EXPECT_EQ(512 + 10000, queue_->tail());
+
+  // The byte at each offset is the offset modulo 256.
+  const uint8_t* data;
+  int size;
+  queue_->Peek(&data, &size);
+  ASSERT_EQ(10000 - 1000 + 128, size);
+  for (int i = 0; i < size; i++)
+    ASSERT_EQ(static_cast<uint8_t>(queue_->head() + i), data[i]);
+}
+
 TEST_F(OffsetByteQueueTest, Trim) {
   EXPECT_TRUE(queue_->Trim(128));
   EXPECT_TRUE(queue_->Trim(384));
@@ -14,6 +14,7 @@
 #include "packager/base/strings/string_util.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/http_key_fetcher.h"
+#include "packager/media/base/key_cache.h"
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/protection_system_ids.h"
 #include "packager/status_macros.h"
@@ -152,7 +153,20 @@ Status PlayReadyKeySource::FetchKeysWithProgramIdentifier(
   std::string acquire_license_request = kAcquireLicenseRequest;
   base::ReplaceFirstSubstringAfterOffset(
       &acquire_license_request, 0, "$0", program_identifier);
+  const std::string cache_request =
+      server_url_ + "\n" + acquire_license_request;
   std::string acquire_license_response;
+  if (key_cache_ &&
+      key_cache_->Get(cache_request, &acquire_license_response) &&
+      SetKeyInformationFromServerResponse(
+          acquire_license_response, generate_playready_protection_system_,
+          encryption_key.get())
+          .ok()) {
+    encryption_key_ = std::move(encryption_key);
+    return Status::OK;
+  }
+  encryption_key.reset(new EncryptionKey);
+
   Status status = key_fetcher.FetchKeys(server_url_, acquire_license_request,
                                         &acquire_license_response);
   VLOG(1) << "Server response: " << acquire_license_response;
@@ -161,12 +175,18 @@ Status PlayReadyKeySource::FetchKeysWithProgramIdentifier(
   RETURN_IF_ERROR(SetKeyInformationFromServerResponse(
       acquire_license_response, generate_playready_protection_system_,
       encryption_key.get()));
+  if (key_cache_)
+    key_cache_->Put(cache_request, acquire_license_response);
 
   // PlayReady does not specify different streams.
   encryption_key_ = std::move(encryption_key);
   return Status::OK;
 }
 
+void PlayReadyKeySource::set_key_cache(std::unique_ptr<KeyCache> key_cache) {
+  key_cache_ = std::move(key_cache);
+}
+
 Status PlayReadyKeySource::FetchKeys(EmeInitDataType init_data_type,
                                      const std::vector<uint8_t>& init_data) {
   // Do nothing for PlayReady encryption/decryption.
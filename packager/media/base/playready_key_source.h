@@ -16,6 +16,8 @@
 namespace shaka {
 namespace media {
 
+class KeyCache;
+
 /// A key source that uses PlayReady for encryption.
 class PlayReadyKeySource : public KeySource {
  public:
@@ -41,6 +43,10 @@ class PlayReadyKeySource : public KeySource {
   /// @}
   virtual Status FetchKeysWithProgramIdentifier(const std::string& program_identifier);
 
+  /// Set a cache of the key server responses, which are then only requested
+  /// if not cached.
+  void set_key_cache(std::unique_ptr<KeyCache> key_cache);
+
   /// Creates a new PlayReadyKeySource from the given data.
   /// Returns null if the strings are invalid.
   /// Note: GetKey on the created key source will always return the same key
@@ -58,6 +64,7 @@ class PlayReadyKeySource : public KeySource {
 
   std::unique_ptr<EncryptionKey> encryption_key_;
   std::string server_url_;
+  std::unique_ptr<KeyCache> key_cache_;
 
   DISALLOW_COPY_AND_ASSIGN(PlayReadyKeySource);
 };
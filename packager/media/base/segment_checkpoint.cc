@@ -0,0 +1,111 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/segment_checkpoint.h"
+
+#include <inttypes.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_split.h"
+#include "packager/base/strings/stringprintf.h"
+
+namespace shaka {
+namespace media {
+
+SegmentCheckpoint::SegmentCheckpoint(const std::string& file_path)
+    : file_path_(file_path) {}
+
+SegmentCheckpoint::~SegmentCheckpoint() {}
+
+Status SegmentCheckpoint::Open(bool resume) {
+  base::AutoLock auto_lock(lock_);
+  DCHECK(!file_);
+  std::string records;
+  if (resume) {
+    std::string contents;
+    // A missing checkpoint means there is nothing to resume from.
+    if (File::GetFileSize(file_path_.c_str()) >= 0 &&
+        !File::ReadFileToString(file_path_.c_str(), &contents)) {
+      return Status(error::FILE_FAILURE,
+                    "Cannot read the segment checkpoint " + file_path_);
+    }
+    // The last record is incomplete if the previous run stopped while it was
+    // being written.
+    contents.resize(contents.rfind('\n') + 1);
+    for (const std::string& line : base::SplitString(
+             contents, "\n", base::KEEP_WHITESPACE,
+             base::SPLIT_WANT_NONEMPTY)) {
+      const size_t space = line.find(' ');
+      uint64_t size = 0;
+      if (space == std::string::npos ||
+          !base::StringToUint64(line.substr(0, space), &size)) {
+        return Status(error::PARSER_FAILURE,
+                      "Invalid segment checkpoint record: " + line);
+      }
+      written_segments_[line.substr(space + 1)] = size;
+      records += line + "\n";
+    }
+    LOG(INFO) << "Resuming with " << written_segments_.size()
+              << " segments written by the previous runs.";
+  }
+  // Drops the incomplete record, if any, so that new records are appended to
+  // the complete ones.
+  if (!File::WriteFileAtomically(file_path_.c_str(), records)) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot write the segment checkpoint " + file_path_);
+  }
+  file_.reset(File::Open(file_path_.c_str(), "a"));
+  if (!file_) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open the segment checkpoint " + file_path_);
+  }
+  return Status::OK;
+}
+
+bool SegmentCheckpoint::IsSegmentWritten(const std::string& file_name,
+                                         uint64_t size) const {
+  {
+    base::AutoLock auto_lock(lock_);
+    auto iter = written_segments_.find(file_name);
+    if (iter == written_segments_.end() || iter->second != size)
+      return false;
+  }
+  // The file may have been removed or changed since then.
+  const int64_t file_size = File::GetFileSize(file_name.c_str());
+  if (file_size < 0 || static_cast<uint64_t>(file_size) != size)
+    return false;
+  VLOG(1) << "Skipping " << file_name << " written by a previous run.";
+  return true;
+}
+
+Status SegmentCheckpoint::OnSegmentWritten(const std::string& file_name,
+                                           uint64_t size) {
+  const std::string record =
+      base::StringPrintf("%" PRIu64 " %s\n", size, file_name.c_str());
+  base::AutoLock auto_lock(lock_);
+  if (!file_)
+    return Status(error::INVALID_ARGUMENT, "Segment checkpoint is not open.");
+  if (file_->Write(record.data(), record.size()) !=
+          static_cast<int64_t>(record.size()) ||
+      !file_->Flush()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot write the segment checkpoint " + file_path_);
+  }
+  return Status::OK;
+}
+
+Status SegmentCheckpoint::Close() {
+  base::AutoLock auto_lock(lock_);
+  if (file_ && !file_.release()->Close()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot close the segment checkpoint " + file_path_);
+  }
+  return Status::OK;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,73 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_SEGMENT_CHECKPOINT_H_
+#define PACKAGER_MEDIA_BASE_SEGMENT_CHECKPOINT_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/status.h"
+
+namespace shaka {
+namespace media {
+
+/// Records the media segment files completely written by the muxers, so that
+/// a packaging job restarted after a failure, e.g. the preemption of a long
+/// VOD job, does not write them again. The records are appended to a local
+/// file, "<size> <file name>" per line, and flushed after every segment. A
+/// segment is skipped on resume if it was recorded and its file still has
+/// the recorded size.
+///
+/// The checkpoint is shared by the muxers of all the streams of a job, which
+/// look up and record their segments concurrently.
+class SegmentCheckpoint {
+ public:
+  /// @param file_path is the path of the checkpoint file.
+  explicit SegmentCheckpoint(const std::string& file_path);
+  ~SegmentCheckpoint();
+
+  /// Opens the checkpoint file to record the segments.
+  /// @param resume loads the segments recorded by a previous run, if the file
+  ///        exists, and records the new segments after them. Otherwise, the
+  ///        file is started over.
+  Status Open(bool resume);
+
+  /// @return true if @a file_name is recorded as completely written with
+  ///         @a size bytes and its file still has this size, i.e. it does not
+  ///         need to be written again.
+  bool IsSegmentWritten(const std::string& file_name, uint64_t size) const;
+
+  /// Records that @a file_name is completely written with @a size bytes.
+  Status OnSegmentWritten(const std::string& file_name, uint64_t size);
+
+  /// Closes the checkpoint file.
+  Status Close();
+
+ private:
+  SegmentCheckpoint(const SegmentCheckpoint&) = delete;
+  SegmentCheckpoint& operator=(const SegmentCheckpoint&) = delete;
+
+  const std::string file_path_;
+
+  mutable base::Lock lock_;
+  // Maps the file names to the sizes of the segments written by the previous
+  // runs. Guarded by |lock_|.
+  std::map<std::string, uint64_t> written_segments_;
+  // Guarded by |lock_|.
+  std::unique_ptr<File, FileCloser> file_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_SEGMENT_CHECKPOINT_H_
@@ -0,0 +1,91 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/segment_checkpoint.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/file/file.h"
+#include "packager/file/memory_file.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const char kCheckpointFile[] = "memory://segments.checkpoint";
+const char kSegment1[] = "memory://segment1.m4s";
+const char kSegment2[] = "memory://segment2.m4s";
+const char kSegmentContents[] = "segment";
+const uint64_t kSegmentSize = sizeof(kSegmentContents) - 1;
+const bool kResume = true;
+}  // namespace
+
+class SegmentCheckpointTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(File::WriteStringToFile(kSegment1, kSegmentContents));
+    ASSERT_TRUE(File::WriteStringToFile(kSegment2, kSegmentContents));
+  }
+
+  void TearDown() override { MemoryFile::DeleteAll(); }
+};
+
+TEST_F(SegmentCheckpointTest, ResumeWithoutFile) {
+  SegmentCheckpoint checkpoint(kCheckpointFile);
+  ASSERT_OK(checkpoint.Open(kResume));
+  EXPECT_FALSE(checkpoint.IsSegmentWritten(kSegment1, kSegmentSize));
+  ASSERT_OK(checkpoint.Close());
+}
+
+TEST_F(SegmentCheckpointTest, Resume) {
+  {
+    SegmentCheckpoint checkpoint(kCheckpointFile);
+    ASSERT_OK(checkpoint.Open(!kResume));
+    ASSERT_OK(checkpoint.OnSegmentWritten(kSegment1, kSegmentSize));
+    // Segments written in this run are written again if they are repeated.
+    EXPECT_FALSE(checkpoint.IsSegmentWritten(kSegment1, kSegmentSize));
+    ASSERT_OK(checkpoint.OnSegmentWritten(kSegment2, kSegmentSize));
+    ASSERT_OK(checkpoint.Close());
+  }
+  // The file of the second segment is changed since then.
+  ASSERT_TRUE(File::WriteStringToFile(kSegment2, "partial"));
+
+  SegmentCheckpoint checkpoint(kCheckpointFile);
+  ASSERT_OK(checkpoint.Open(kResume));
+  EXPECT_TRUE(checkpoint.IsSegmentWritten(kSegment1, kSegmentSize));
+  EXPECT_FALSE(checkpoint.IsSegmentWritten(kSegment1, kSegmentSize + 1));
+  EXPECT_FALSE(checkpoint.IsSegmentWritten(kSegment2, kSegmentSize));
+  ASSERT_OK(checkpoint.Close());
+}
+
+TEST_F(SegmentCheckpointTest, ResumeIgnoresIncompleteRecord) {
+  ASSERT_TRUE(File::WriteStringToFile(
+      kCheckpointFile, "7 memory://segment1.m4s\n7 memory://segm"));
+  {
+    SegmentCheckpoint checkpoint(kCheckpointFile);
+    ASSERT_OK(checkpoint.Open(kResume));
+    EXPECT_TRUE(checkpoint.IsSegmentWritten(kSegment1, kSegmentSize));
+    ASSERT_OK(checkpoint.OnSegmentWritten(kSegment2, kSegmentSize));
+    ASSERT_OK(checkpoint.Close());
+  }
+
+  std::string contents;
+  ASSERT_TRUE(File::ReadFileToString(kCheckpointFile, &contents));
+  EXPECT_EQ("7 memory://segment1.m4s\n7 memory://segment2.m4s\n", contents);
+}
+
+TEST_F(SegmentCheckpointTest, StartOverWithoutResume) {
+  ASSERT_TRUE(
+      File::WriteStringToFile(kCheckpointFile, "7 memory://segment1.m4s\n"));
+  SegmentCheckpoint checkpoint(kCheckpointFile);
+  ASSERT_OK(checkpoint.Open(!kResume));
+  EXPECT_FALSE(checkpoint.IsSegmentWritten(kSegment1, kSegmentSize));
+  ASSERT_OK(checkpoint.Close());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,152 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/segment_digest.h"
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/media/base/buffer_chain.h"
+#include "packager/media/base/buffer_writer.h"
+
+namespace shaka {
+namespace media {
+
+std::string DigestAlgorithmToString(DigestAlgorithm algorithm) {
+  switch (algorithm) {
+    case DigestAlgorithm::kMd5:
+      return "md5";
+    case DigestAlgorithm::kSha256:
+      return "sha256";
+  }
+  NOTREACHED();
+  return "";
+}
+
+bool ParseDigestAlgorithms(const std::string& names,
+                           std::vector<DigestAlgorithm>* algorithms) {
+  DCHECK(algorithms);
+  algorithms->clear();
+  for (const std::string& name :
+       base::SplitString(names, ",", base::TRIM_WHITESPACE,
+                         base::SPLIT_WANT_NONEMPTY)) {
+    if (name == "md5") {
+      algorithms->push_back(DigestAlgorithm::kMd5);
+    } else if (name == "sha256") {
+      algorithms->push_back(DigestAlgorithm::kSha256);
+    } else {
+      LOG(ERROR) << "Unknown segment digest algorithm " << name;
+      return false;
+    }
+  }
+  return true;
+}
+
+SegmentDigester::SegmentDigester(
+    const std::vector<DigestAlgorithm>& algorithms)
+    : algorithms_(algorithms) {
+  for (DigestAlgorithm algorithm : algorithms_) {
+    switch (algorithm) {
+      case DigestAlgorithm::kMd5:
+        md5_ = true;
+        break;
+      case DigestAlgorithm::kSha256:
+        sha256_ = true;
+        break;
+    }
+  }
+  if (md5_)
+    MD5_Init(&md5_context_);
+  if (sha256_)
+    SHA256_Init(&sha256_context_);
+}
+
+void SegmentDigester::Update(const uint8_t* data, size_t size) {
+  if (md5_)
+    MD5_Update(&md5_context_, data, size);
+  if (sha256_)
+    SHA256_Update(&sha256_context_, data, size);
+}
+
+void SegmentDigester::Update(const BufferChain& buffer) {
+  buffer.VisitBlocks(
+      [this](const uint8_t* data, size_t size) { Update(data, size); });
+}
+
+void SegmentDigester::Update(const BufferWriter& buffer) {
+  Update(buffer.Buffer(), buffer.Size());
+}
+
+std::vector<SegmentDigest> SegmentDigester::Finish() {
+  std::vector<uint8_t> md5(MD5_DIGEST_LENGTH);
+  std::vector<uint8_t> sha256(SHA256_DIGEST_LENGTH);
+  if (md5_)
+    MD5_Final(md5.data(), &md5_context_);
+  if (sha256_)
+    SHA256_Final(sha256.data(), &sha256_context_);
+
+  std::vector<SegmentDigest> digests;
+  for (DigestAlgorithm algorithm : algorithms_) {
+    digests.push_back({algorithm, algorithm == DigestAlgorithm::kMd5
+                                      ? md5
+                                      : sha256});
+  }
+  return digests;
+}
+
+SegmentDigestFile::SegmentDigestFile(const std::string& file_path)
+    : file_path_(file_path) {}
+
+SegmentDigestFile::~SegmentDigestFile() {}
+
+Status SegmentDigestFile::Open() {
+  base::AutoLock auto_lock(lock_);
+  DCHECK(!file_);
+  file_.reset(File::Open(file_path_.c_str(), "w"));
+  if (!file_) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open the segment digest file " + file_path_);
+  }
+  return Status::OK;
+}
+
+Status SegmentDigestFile::OnSegmentWritten(
+    const std::string& file_name,
+    const std::vector<SegmentDigest>& digests) {
+  std::string record;
+  for (const SegmentDigest& digest : digests) {
+    record += DigestAlgorithmToString(digest.algorithm) + ":" +
+              base::ToLowerASCII(
+                  base::HexEncode(digest.value.data(), digest.value.size())) +
+              " ";
+  }
+  record += file_name + "\n";
+  base::AutoLock auto_lock(lock_);
+  if (!file_) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Segment digest file is not open.");
+  }
+  if (file_->Write(record.data(), record.size()) !=
+          static_cast<int64_t>(record.size()) ||
+      !file_->Flush()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot write the segment digest file " + file_path_);
+  }
+  return Status::OK;
+}
+
+Status SegmentDigestFile::Close() {
+  base::AutoLock auto_lock(lock_);
+  if (file_ && !file_.release()->Close()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot close the segment digest file " + file_path_);
+  }
+  return Status::OK;
+}
+
+}  // namespace media
+}  // namespace shaka
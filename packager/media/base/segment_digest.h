@@ -0,0 +1,111 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_SEGMENT_DIGEST_H_
+#define PACKAGER_MEDIA_BASE_SEGMENT_DIGEST_H_
+
+#include <openssl/md5.h>
+#include <openssl/sha.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/status.h"
+
+namespace shaka {
+namespace media {
+
+class BufferChain;
+class BufferWriter;
+
+enum class DigestAlgorithm {
+  kMd5,
+  kSha256,
+};
+
+/// The digest of a media segment file.
+struct SegmentDigest {
+  DigestAlgorithm algorithm;
+  std::vector<uint8_t> value;
+};
+
+/// @return the name of @a algorithm, e.g. "sha256".
+std::string DigestAlgorithmToString(DigestAlgorithm algorithm);
+
+/// Parses a comma separated list of digest algorithm names, "md5" or
+/// "sha256".
+/// @return false if @a names has an unknown algorithm.
+bool ParseDigestAlgorithms(const std::string& names,
+                           std::vector<DigestAlgorithm>* algorithms);
+
+/// Computes the digests of a media segment from the buffers written to its
+/// file, so that the file does not have to be read again. BoringSSL uses the
+/// SHA extensions of the CPU if there are.
+class SegmentDigester {
+ public:
+  explicit SegmentDigester(const std::vector<DigestAlgorithm>& algorithms);
+
+  void Update(const uint8_t* data, size_t size);
+  void Update(const BufferChain& buffer);
+  void Update(const BufferWriter& buffer);
+
+  /// @return the digests of the data, in the order of the algorithms.
+  std::vector<SegmentDigest> Finish();
+
+ private:
+  SegmentDigester(const SegmentDigester&) = delete;
+  SegmentDigester& operator=(const SegmentDigester&) = delete;
+
+  const std::vector<DigestAlgorithm> algorithms_;
+  bool md5_ = false;
+  bool sha256_ = false;
+  MD5_CTX md5_context_;
+  SHA256_CTX sha256_context_;
+};
+
+/// Records the digests of the media segment files written by the muxers, e.g.
+/// for the CDN to check their integrity. The records are written to a file,
+/// "<algorithm>:<hex digest>... <file name>" per line, and flushed after every
+/// segment.
+///
+/// The file is shared by the muxers of all the streams, so the records are
+/// written under a lock and their lines are not interleaved.
+class SegmentDigestFile {
+ public:
+  /// @param file_path is the path of the digest file.
+  explicit SegmentDigestFile(const std::string& file_path);
+  ~SegmentDigestFile();
+
+  /// Opens the digest file, which is started over.
+  Status Open();
+
+  /// Records the digests of @a file_name.
+  Status OnSegmentWritten(const std::string& file_name,
+                          const std::vector<SegmentDigest>& digests);
+
+  /// Closes the digest file.
+  Status Close();
+
+ private:
+  SegmentDigestFile(const SegmentDigestFile&) = delete;
+  SegmentDigestFile& operator=(const SegmentDigestFile&) = delete;
+
+  const std::string file_path_;
+
+  base::Lock lock_;
+  // Guarded by |lock_|.
+  std::unique_ptr<File, FileCloser> file_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_SEGMENT_DIGEST_H_
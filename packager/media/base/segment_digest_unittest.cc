@@ -0,0 +1,85 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/segment_digest.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/file/file.h"
+#include "packager/file/memory_file.h"
+#include "packager/media/base/buffer_chain.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const char kDigestFile[] = "memory://segments.digests";
+const char kMd5OfAbc[] = "900150983CD24FB0D6963F7D28E17F72";
+const char kSha256OfAbc[] =
+    "BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD";
+
+std::string ToHex(const std::vector<uint8_t>& value) {
+  return base::HexEncode(value.data(), value.size());
+}
+}  // namespace
+
+TEST(SegmentDigestTest, ParseDigestAlgorithms) {
+  std::vector<DigestAlgorithm> algorithms;
+  ASSERT_TRUE(ParseDigestAlgorithms("sha256, md5", &algorithms));
+  ASSERT_EQ(2u, algorithms.size());
+  EXPECT_EQ(DigestAlgorithm::kSha256, algorithms[0]);
+  EXPECT_EQ(DigestAlgorithm::kMd5, algorithms[1]);
+
+  ASSERT_TRUE(ParseDigestAlgorithms("", &algorithms));
+  EXPECT_TRUE(algorithms.empty());
+  EXPECT_FALSE(ParseDigestAlgorithms("sha1", &algorithms));
+}
+
+TEST(SegmentDigestTest, Digester) {
+  SegmentDigester digester(
+      {DigestAlgorithm::kMd5, DigestAlgorithm::kSha256});
+  BufferWriter a;
+  a.AppendString("a");
+  BufferWriter b;
+  b.AppendString("b");
+  BufferChain chain;
+  chain.AppendBuffer(&b);
+  digester.Update(a);
+  digester.Update(chain);
+  digester.Update(reinterpret_cast<const uint8_t*>("c"), 1);
+
+  std::vector<SegmentDigest> digests = digester.Finish();
+  ASSERT_EQ(2u, digests.size());
+  EXPECT_EQ(DigestAlgorithm::kMd5, digests[0].algorithm);
+  EXPECT_EQ(kMd5OfAbc, ToHex(digests[0].value));
+  EXPECT_EQ(DigestAlgorithm::kSha256, digests[1].algorithm);
+  EXPECT_EQ(kSha256OfAbc, ToHex(digests[1].value));
+}
+
+TEST(SegmentDigestTest, DigestFile) {
+  SegmentDigester digester({DigestAlgorithm::kSha256});
+  digester.Update(reinterpret_cast<const uint8_t*>("abc"), 3);
+
+  SegmentDigestFile digest_file(kDigestFile);
+  ASSERT_OK(digest_file.Open());
+  ASSERT_OK(digest_file.OnSegmentWritten("segment 1.ts", digester.Finish()));
+  ASSERT_OK(digest_file.Close());
+
+  std::string contents;
+  ASSERT_TRUE(File::ReadFileToString(kDigestFile, &contents));
+  EXPECT_EQ(
+      "sha256:"
+      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad "
+      "segment 1.ts\n",
+      contents);
+  MemoryFile::DeleteAll();
+}
+
+}  // namespace media
+}  // namespace shaka
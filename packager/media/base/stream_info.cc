@@ -50,7 +50,8 @@ StreamInfo::StreamInfo(StreamType stream_type,
       language_(language),
       is_encrypted_(is_encrypted) {
   if (codec_config_size > 0) {
-    codec_config_.assign(codec_config, codec_config + codec_config_size);
+    codec_config_ = SharedStreamData<std::vector<uint8_t>>(
+        std::vector<uint8_t>(codec_config, codec_config + codec_config_size));
   }
 }
 
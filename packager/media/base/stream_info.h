@@ -9,6 +9,7 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "packager/media/base/encryption_config.h"
@@ -63,6 +64,27 @@ enum Codec {
   kCodecTtml,
 };
 
+/// Immutable data, e.g. a codec configuration, shared by the copies of the
+/// stream info which holds it. The handlers which Clone() a stream info to
+/// change a few of its fields, and the outputs a stream is fanned out to, thus
+/// do not copy the data. Setting the data replaces it for this copy only.
+template <typename T>
+class SharedStreamData {
+ public:
+  SharedStreamData() = default;
+  explicit SharedStreamData(T data)
+      : data_(std::make_shared<T>(std::move(data))) {}
+
+  const T& get() const {
+    // Leaked intentionally to avoid an exit-time destructor.
+    static const T* const kEmptyData = new T();
+    return data_ ? *data_ : *kEmptyData;
+  }
+
+ private:
+  std::shared_ptr<const T> data_;
+};
+
 /// Abstract class holds stream information.
 class StreamInfo {
  public:
@@ -99,18 +121,20 @@ class StreamInfo {
   uint64_t duration() const { return duration_; }
   Codec codec() const { return codec_; }
   const std::string& codec_string() const { return codec_string_; }
-  const std::vector<uint8_t>& codec_config() const { return codec_config_; }
+  const std::vector<uint8_t>& codec_config() const {
+    return codec_config_.get();
+  }
   const std::string& language() const { return language_; }
   bool is_encrypted() const { return is_encrypted_; }
   bool has_clear_lead() const { return has_clear_lead_; }
   const EncryptionConfig& encryption_config() const {
-    return encryption_config_;
+    return encryption_config_.get();
   }
 
   void set_duration(uint64_t duration) { duration_ = duration; }
   void set_codec(Codec codec) { codec_ = codec; }
   void set_codec_config(const std::vector<uint8_t>& data) {
-    codec_config_ = data;
+    codec_config_ = SharedStreamData<std::vector<uint8_t>>(data);
   }
   void set_codec_string(const std::string& codec_string) {
     codec_string_ = codec_string;
@@ -121,7 +145,7 @@ class StreamInfo {
     has_clear_lead_ = has_clear_lead;
   }
   void set_encryption_config(const EncryptionConfig& encryption_config) {
-    encryption_config_ = encryption_config;
+    encryption_config_ = SharedStreamData<EncryptionConfig>(encryption_config);
   }
 
  private:
@@ -141,14 +165,16 @@ class StreamInfo {
   bool is_encrypted_;
   // Whether the stream has clear lead.
   bool has_clear_lead_ = false;
-  EncryptionConfig encryption_config_;
+  // Includes the PSSHs of the key systems.
+  SharedStreamData<EncryptionConfig> encryption_config_;
   // Optional byte data required for some audio/video decoders such as Vorbis
   // codebooks.
-  std::vector<uint8_t> codec_config_;
+  SharedStreamData<std::vector<uint8_t>> codec_config_;
 
   // Not using DISALLOW_COPY_AND_ASSIGN here intentionally to allow the compiler
-  // generated copy constructor and assignment operator. Since the extra data is
-  // typically small, the performance impact is minimal.
+  // generated copy constructor and assignment operator. The codec
+  // configuration and the encryption config are shared by the copies, so
+  // copying is cheap.
 };
 
 }  // namespace media
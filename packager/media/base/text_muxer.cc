@@ -12,7 +12,8 @@
 namespace shaka {
 namespace media {
 
-TextMuxer::TextMuxer(const MuxerOptions& options) : Muxer(options) {}
+TextMuxer::TextMuxer(const MuxerOptions& options)
+    : Muxer(options), segment_name_formatter_(options.segment_template) {}
 TextMuxer::~TextMuxer() {}
 
 Status TextMuxer::InitializeMuxer() {
@@ -73,15 +74,14 @@ Status TextMuxer::FinalizeSegment(size_t stream_id,
                                   const SegmentInfo& segment_info) {
   total_duration_ms_ += segment_info.duration;
 
-  const std::string& segment_template = options().segment_template;
-  DCHECK(!segment_template.empty());
+  DCHECK(!options().segment_template.empty());
   const uint32_t index = segment_index_++;
   const uint64_t start = segment_info.start_timestamp;
   const uint64_t duration = segment_info.duration;
   const uint32_t bandwidth = options().bandwidth;
 
   const std::string filename =
-      GetSegmentName(segment_template, start, index, bandwidth);
+      segment_name_formatter_.Format(start, index, bandwidth);
   uint64_t size;
   RETURN_IF_ERROR(WriteToFile(filename, &size));
 
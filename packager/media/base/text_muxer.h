@@ -8,6 +8,7 @@
 #define PACKAGER_MEDIA_BASE_TEXT_MUXER_H_
 
 #include "packager/media/base/muxer.h"
+#include "packager/media/base/muxer_util.h"
 #include "packager/media/base/text_sample.h"
 #include "packager/media/base/text_stream_info.h"
 
@@ -36,6 +37,7 @@ class TextMuxer : public Muxer {
   /// also clear any buffered samples.
   virtual Status WriteToFile(const std::string& filename, uint64_t* size) = 0;
 
+  const SegmentNameFormatter segment_name_formatter_;
   uint64_t total_duration_ms_ = 0;
   uint64_t last_cue_ms_ = 0;
   uint32_t segment_index_ = 0;
@@ -0,0 +1,97 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/threaded_handler.h"
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/file/thread_class.h"
+
+namespace shaka {
+namespace media {
+
+ThreadedHandler::ThreadedHandler(size_t max_pending_stream_data)
+    : queue_(max_pending_stream_data),
+      flushed_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
+               base::WaitableEvent::InitialState::NOT_SIGNALED) {
+  DCHECK_GT(max_pending_stream_data, 0u);
+}
+
+ThreadedHandler::~ThreadedHandler() {
+  {
+    base::AutoLock auto_lock(lock_);
+    // Make the thread drop the stream data still in the queue.
+    if (status_.ok())
+      status_ = Status(error::CANCELLED, "ThreadedHandler destroyed.");
+  }
+  queue_.Stop();
+  // ClosureThread joins on destruction.
+  thread_.reset();
+}
+
+Status ThreadedHandler::InitializeInternal() {
+  if (num_input_streams() != 1 || next_output_stream_index() != 1) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Expects exactly one input and one output.");
+  }
+  thread_.reset(new ClosureThread(
+      "ThreadedHandler",
+      base::Bind(&ThreadedHandler::ThreadMain, base::Unretained(this))));
+  thread_->Start();
+  return Status::OK;
+}
+
+Status ThreadedHandler::Process(std::unique_ptr<StreamData> stream_data) {
+  RETURN_IF_ERROR(GetStatus());
+  StreamData* raw_stream_data = stream_data.release();
+  Status status = queue_.Push(raw_stream_data, kInfiniteTimeout);
+  if (!status.ok())
+    delete raw_stream_data;
+  return status;
+}
+
+Status ThreadedHandler::OnFlushRequest(size_t input_stream_index) {
+  DCHECK_EQ(input_stream_index, 0u);
+  RETURN_IF_ERROR(queue_.Push(nullptr, kInfiniteTimeout));
+  flushed_.Wait();
+  return GetStatus();
+}
+
+void ThreadedHandler::ThreadMain() {
+  SetCurrentThreadClass(ThreadClass::kMedia);
+  StreamData* raw_stream_data = nullptr;
+  while (queue_.Pop(&raw_stream_data, kInfiniteTimeout).ok()) {
+    std::unique_ptr<StreamData> stream_data(raw_stream_data);
+    // Stream data is dropped after an error, but flush requests are still
+    // acknowledged so the upstream thread does not block forever.
+    const bool failed = !GetStatus().ok();
+    if (!stream_data) {
+      Status status = failed ? Status::OK : FlushDownstream(0);
+      if (!status.ok()) {
+        base::AutoLock auto_lock(lock_);
+        status_.Update(status);
+      }
+      flushed_.Signal();
+      continue;
+    }
+    if (failed)
+      continue;
+    Status status = Dispatch(std::move(stream_data));
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to process stream data: " << status;
+      base::AutoLock auto_lock(lock_);
+      status_.Update(status);
+    }
+  }
+}
+
+Status ThreadedHandler::GetStatus() {
+  base::AutoLock auto_lock(lock_);
+  return status_;
+}
+
+}  // namespace media
+}  // namespace shaka
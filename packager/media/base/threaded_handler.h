@@ -0,0 +1,68 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_THREADED_HANDLER_H_
+#define PACKAGER_MEDIA_BASE_THREADED_HANDLER_H_
+
+#include <memory>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/media/base/media_handler.h"
+#include "packager/media/base/producer_consumer_queue.h"
+
+namespace shaka {
+namespace media {
+
+/// ThreadedHandler is a single input single output handler that passes the
+/// stream data to its downstream handlers on a dedicated thread. It decouples
+/// the upstream handlers, e.g. the demuxer, from the downstream handlers, so
+/// the streams of an input can be processed concurrently.
+///
+/// Stream data is queued up to a fixed limit, beyond which the upstream
+/// thread blocks. A flush request blocks until all the queued stream data
+/// and the flush have been processed downstream. Errors from the downstream
+/// handlers are reported on the next call to Process or OnFlushRequest.
+class ThreadedHandler : public MediaHandler {
+ public:
+  /// @param max_pending_stream_data is the maximum number of stream data
+  ///        queued for the downstream handlers. Should be positive.
+  explicit ThreadedHandler(size_t max_pending_stream_data);
+  ~ThreadedHandler() override;
+
+ protected:
+  /// @name MediaHandler implementation overrides.
+  /// @{
+  Status InitializeInternal() override;
+  Status Process(std::unique_ptr<StreamData> stream_data) override;
+  Status OnFlushRequest(size_t input_stream_index) override;
+  size_t NumQueuedStreamData() const override { return queue_.Size(); }
+  /// @}
+
+ private:
+  ThreadedHandler(const ThreadedHandler&) = delete;
+  ThreadedHandler& operator=(const ThreadedHandler&) = delete;
+
+  // Dispatches the queued stream data until the queue is stopped.
+  void ThreadMain();
+  Status GetStatus();
+
+  // A null entry is a flush request.
+  ProducerConsumerQueue<StreamData*> queue_;
+  // Signaled when a flush request has been processed.
+  base::WaitableEvent flushed_;
+  // Null until the handler is initialized.
+  std::unique_ptr<ClosureThread> thread_;
+
+  base::Lock lock_;
+  Status status_;  // GUARDED_BY(lock_)
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_THREADED_HANDLER_H_
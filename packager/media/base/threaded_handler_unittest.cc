@@ -0,0 +1,101 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/threaded_handler.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/media/base/media_handler_test_base.h"
+#include "packager/status_test_util.h"
+
+using ::testing::_;
+
+namespace shaka {
+namespace media {
+
+namespace {
+const size_t kStreamIndex = 0;
+const uint32_t kTimeScale = 1000;
+const int64_t kDuration = 10;
+const bool kKeyFrame = true;
+// Smaller than the number of samples in the tests, so the upstream thread
+// blocks on the queue.
+const size_t kMaxPendingStreamData = 2;
+}  // namespace
+
+class ThreadedHandlerTest : public MediaHandlerTestBase {
+ protected:
+  void SetUp() override {
+    threaded_handler_ =
+        std::make_shared<ThreadedHandler>(kMaxPendingStreamData);
+    ASSERT_OK(SetUpAndInitializeGraph(threaded_handler_, 1, 1));
+  }
+
+  std::shared_ptr<ThreadedHandler> threaded_handler_;
+};
+
+TEST_F(ThreadedHandlerTest, DispatchesInOrderBeforeFlush) {
+  const int kNumSamples = 10;
+  {
+    testing::InSequence s;
+    EXPECT_CALL(*Output(0), OnProcess(IsStreamInfo(kStreamIndex, _, _, _)));
+    for (int i = 0; i < kNumSamples; ++i) {
+      EXPECT_CALL(*Output(0),
+                  OnProcess(IsMediaSample(kStreamIndex, i * kDuration,
+                                          kDuration, _, _)));
+    }
+    EXPECT_CALL(*Output(0), OnFlush(kStreamIndex));
+  }
+
+  ASSERT_OK(Input(0)->Dispatch(StreamData::FromStreamInfo(
+      kStreamIndex, GetVideoStreamInfo(kTimeScale))));
+  for (int i = 0; i < kNumSamples; ++i) {
+    ASSERT_OK(Input(0)->Dispatch(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(i * kDuration, kDuration, kKeyFrame))));
+  }
+  // Flushing blocks until all the stream data has been processed downstream,
+  // so the expectations are satisfied when it returns.
+  ASSERT_OK(Input(0)->FlushAllDownstreams());
+  testing::Mock::VerifyAndClearExpectations(Output(0));
+}
+
+TEST_F(ThreadedHandlerTest, CollectsStats) {
+  MediaHandler::EnableStats(true);
+  const int kNumSamples = 10;
+  EXPECT_CALL(*Output(0), OnProcess(_)).Times(kNumSamples + 1);
+  EXPECT_CALL(*Output(0), OnFlush(kStreamIndex));
+
+  ASSERT_OK(Input(0)->Dispatch(StreamData::FromStreamInfo(
+      kStreamIndex, GetVideoStreamInfo(kTimeScale))));
+  for (int i = 0; i < kNumSamples; ++i) {
+    ASSERT_OK(Input(0)->Dispatch(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(i * kDuration, kDuration, kKeyFrame))));
+  }
+  ASSERT_OK(Input(0)->FlushAllDownstreams());
+  MediaHandler::EnableStats(false);
+
+  const MediaHandlerStats stats = threaded_handler_->GetStats();
+  EXPECT_EQ(static_cast<uint64_t>(kNumSamples + 1), stats.num_stream_data);
+  EXPECT_EQ(0u, stats.queue_depth);
+  uint64_t num_timed_calls = 0;
+  for (uint64_t count : stats.time_histogram)
+    num_timed_calls += count;
+  EXPECT_EQ(stats.num_stream_data, num_timed_calls);
+  EXPECT_EQ(static_cast<uint64_t>(kNumSamples + 1),
+            Output(0)->GetStats().num_stream_data);
+}
+
+TEST_F(ThreadedHandlerTest, DestroyedWithPendingStreamData) {
+  EXPECT_CALL(*Output(0), OnFlush(_)).Times(0);
+  ASSERT_OK(Input(0)->Dispatch(StreamData::FromStreamInfo(
+      kStreamIndex, GetVideoStreamInfo(kTimeScale))));
+  // Not flushed. The handler drops or dispatches the pending stream data on
+  // destruction without blocking.
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -54,7 +54,9 @@ class VideoStreamInfo : public StreamInfo {
   std::unique_ptr<StreamInfo> Clone() const override;
   /// @}
 
-  const std::vector<uint8_t>& extra_config() const { return extra_config_; }
+  const std::vector<uint8_t>& extra_config() const {
+    return extra_config_.get();
+  }
   H26xStreamFormat h26x_stream_format() const { return h26x_stream_format_; }
   uint16_t width() const { return width_; }
   uint16_t height() const { return height_; }
@@ -68,10 +70,12 @@ class VideoStreamInfo : public StreamInfo {
   uint8_t nalu_length_size() const { return nalu_length_size_; }
   uint32_t trick_play_factor() const { return trick_play_factor_; }
   uint32_t playback_rate() const { return playback_rate_; }
-  const std::vector<uint8_t>& eme_init_data() const { return eme_init_data_; }
+  const std::vector<uint8_t>& eme_init_data() const {
+    return eme_init_data_.get();
+  }
 
   void set_extra_config(const std::vector<uint8_t>& extra_config) {
-    extra_config_ = extra_config;
+    extra_config_ = SharedStreamData<std::vector<uint8_t>>(extra_config);
   }
   void set_width(uint32_t width) { width_ = width; }
   void set_height(uint32_t height) { height_ = height; }
@@ -88,13 +92,15 @@ class VideoStreamInfo : public StreamInfo {
   }
   void set_eme_init_data(const uint8_t* eme_init_data,
                          size_t eme_init_data_size) {
-    eme_init_data_.assign(eme_init_data, eme_init_data + eme_init_data_size);
+    eme_init_data_ = SharedStreamData<std::vector<uint8_t>>(
+        std::vector<uint8_t>(eme_init_data,
+                             eme_init_data + eme_init_data_size));
   }
 
  private:
   // Extra codec configuration in a stream of mp4 boxes. It is only applicable
   // to mp4 container only. It is needed by some codecs, e.g. Dolby Vision.
-  std::vector<uint8_t> extra_config_;
+  SharedStreamData<std::vector<uint8_t>> extra_config_;
   H26xStreamFormat h26x_stream_format_;
   uint16_t width_;
   uint16_t height_;
@@ -126,11 +132,11 @@ class VideoStreamInfo : public StreamInfo {
 
   // Container-specific data used by CDM to generate a license request:
   // https://w3c.github.io/encrypted-media/#initialization-data.
-  std::vector<uint8_t> eme_init_data_;
+  SharedStreamData<std::vector<uint8_t>> eme_init_data_;
 
   // Not using DISALLOW_COPY_AND_ASSIGN here intentionally to allow the compiler
-  // generated copy constructor and assignment operator. Since the extra data is
-  // typically small, the performance impact is minimal.
+  // generated copy constructor and assignment operator. The byte data is shared
+  // by the copies, so copying is cheap.
 };
 
 }  // namespace media
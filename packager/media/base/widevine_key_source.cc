@@ -7,11 +7,15 @@
 #include "packager/media/base/widevine_key_source.h"
 
 #include <gflags/gflags.h>
+#include <google/protobuf/arena.h>
 
 #include "packager/base/base64.h"
 #include "packager/base/bind.h"
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/file/thread_class.h"
 #include "packager/media/base/http_key_fetcher.h"
+#include "packager/media/base/key_cache.h"
+#include "packager/media/base/metrics.h"
 #include "packager/media/base/network_util.h"
 #include "packager/media/base/producer_consumer_queue.h"
 #include "packager/media/base/protection_system_ids.h"
@@ -40,6 +44,9 @@ const int kFirstRetryDelayMilliseconds = 1000;
 // Default crypto period count, which is the number of keys to fetch on every
 // key rotation enabled request.
 const int kDefaultCryptoPeriodCount = 10;
+// Default number of crypto periods to keep fetched ahead of the latest crypto
+// period requested.
+const uint32_t kDefaultKeyPrefetchCryptoPeriods = 4 * kDefaultCryptoPeriodCount;
 const int kGetKeyTimeoutInSeconds = 5 * 60;  // 5 minutes.
 const int kKeyFetchTimeoutInSeconds = 60;  // 1 minute.
 
@@ -92,27 +99,17 @@ WidevineKeySource::WidevineKeySource(const std::string& server_url,
           // protection system specified.
           protection_systems == ProtectionSystem::kNone ||
           has_flag(protection_systems, ProtectionSystem::kWidevine)),
-      key_production_thread_("KeyProductionThread",
-                             base::Bind(&WidevineKeySource::FetchKeysTask,
-                                        base::Unretained(this))),
       key_fetcher_(new HttpKeyFetcher(kKeyFetchTimeoutInSeconds)),
       server_url_(server_url),
       crypto_period_count_(kDefaultCryptoPeriodCount),
       protection_scheme_(protection_scheme),
-      start_key_production_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
-                            base::WaitableEvent::InitialState::NOT_SIGNALED) {
-  key_production_thread_.Start();
-}
+      key_prefetch_crypto_periods_(kDefaultKeyPrefetchCryptoPeriods),
+      key_production_changed_(&lock_) {}
 
 WidevineKeySource::~WidevineKeySource() {
-  if (key_pool_)
-    key_pool_->Stop();
-  if (key_production_thread_.HasBeenStarted()) {
-    // Signal the production thread to start key production if it is not
-    // signaled yet so the thread can be joined.
-    start_key_production_.Signal();
-    key_production_thread_.Join();
-  }
+  StopKeyProduction(Status::OK);
+  for (auto& key_production_thread : key_production_threads_)
+    key_production_thread->Join();
 }
 
 Status WidevineKeySource::FetchKeys(const std::vector<uint8_t>& content_id,
@@ -127,7 +124,7 @@ Status WidevineKeySource::FetchKeys(const std::vector<uint8_t>& content_id,
   if (enable_entitlement_license_)
     common_encryption_request_->set_enable_entitlement_license(true);
 
-  return FetchKeysInternal(!kEnableKeyRotation, 0, false);
+  return FetchKeysInternal(!kEnableKeyRotation, 0, false, nullptr);
 }
 
 Status WidevineKeySource::FetchKeys(EmeInitDataType init_data_type,
@@ -189,7 +186,7 @@ Status WidevineKeySource::FetchKeys(EmeInitDataType init_data_type,
     common_encryption_request_->set_pssh_data(pssh_data.data(),
                                               pssh_data.size());
   }
-  return FetchKeysInternal(!kEnableKeyRotation, 0, widevine_classic);
+  return FetchKeysInternal(!kEnableKeyRotation, 0, widevine_classic, nullptr);
 }
 
 Status WidevineKeySource::GetKey(const std::string& stream_label,
@@ -220,7 +217,6 @@ Status WidevineKeySource::GetCryptoPeriodKey(uint32_t crypto_period_index,
                                              uint32_t crypto_period_duration_in_seconds,
                                              const std::string& stream_label,
                                              EncryptionKey* key) {
-  DCHECK(key_production_thread_.HasBeenStarted());
   // TODO(kqyang): This is not elegant. Consider refactoring later.
   {
     base::AutoLock scoped_lock(lock_);
@@ -228,20 +224,39 @@ Status WidevineKeySource::GetCryptoPeriodKey(uint32_t crypto_period_index,
       crypto_period_duration_in_seconds_ = crypto_period_duration_in_seconds;
       // Another client may have a slightly smaller starting crypto period
       // index. Set the initial value to account for that.
-      first_crypto_period_index_ =
+      next_crypto_period_index_to_fetch_ =
           crypto_period_index ? crypto_period_index - 1 : 0;
+      next_crypto_period_index_to_push_ = next_crypto_period_index_to_fetch_;
       DCHECK(!key_pool_);
-      const size_t queue_size = crypto_period_count_ * 10;
-      key_pool_.reset(
-          new EncryptionKeyQueue(queue_size, first_crypto_period_index_));
-      start_key_production_.Signal();
+      // Peek() drops the keys more than half the capacity behind, so the pool
+      // holds the prefetched keys and those of every request in flight
+      // without blocking.
+      const size_t queue_size =
+          2 * (key_prefetch_crypto_periods_ +
+               crypto_period_count_ * max_concurrent_key_requests_);
+      key_pool_.reset(new EncryptionKeyQueue(
+          queue_size, next_crypto_period_index_to_fetch_));
+      for (uint32_t i = 0; i < max_concurrent_key_requests_; ++i) {
+        key_production_threads_.emplace_back(new ClosureThread(
+            "KeyProductionThread",
+            base::Bind(&WidevineKeySource::FetchKeysTask,
+                       base::Unretained(this))));
+        key_production_threads_.back()->Start();
+      }
       key_production_started_ = true;
     }  else if (crypto_period_duration_in_seconds_ !=
                 crypto_period_duration_in_seconds) {
       return Status(error::INVALID_ARGUMENT,
                     "Crypto period duration should not change.");
     }
+    if (crypto_period_index > latest_crypto_period_index_) {
+      latest_crypto_period_index_ = crypto_period_index;
+      key_production_changed_.Broadcast();
+    }
   }
+  ScopedLatencyMetric wait_latency(
+      "packager_key_wait_seconds",
+      "Time spent waiting for the keys of a crypto period.", "");
   return GetKeyInternal(crypto_period_index, stream_label, key);
 }
 
@@ -254,6 +269,10 @@ void WidevineKeySource::set_key_fetcher(
   key_fetcher_ = std::move(key_fetcher);
 }
 
+void WidevineKeySource::set_key_cache(std::unique_ptr<KeyCache> key_cache) {
+  key_cache_ = std::move(key_cache);
+}
+
 Status WidevineKeySource::GetKeyInternal(uint32_t crypto_period_index,
                                          const std::string& stream_label,
                                          EncryptionKey* key) {
@@ -265,6 +284,7 @@ Status WidevineKeySource::GetKeyInternal(uint32_t crypto_period_index,
                                   kGetKeyTimeoutInSeconds * 1000);
   if (!status.ok()) {
     if (status.error_code() == error::STOPPED) {
+      base::AutoLock scoped_lock(lock_);
       CHECK(!common_encryption_request_status_.ok());
       return common_encryption_request_status_;
     }
@@ -280,32 +300,100 @@ Status WidevineKeySource::GetKeyInternal(uint32_t crypto_period_index,
 }
 
 void WidevineKeySource::FetchKeysTask() {
-  // Wait until key production is signaled.
-  start_key_production_.Wait();
-  if (!key_pool_ || key_pool_->Stopped())
-    return;
-
-  Status status = FetchKeysInternal(kEnableKeyRotation,
-                                    first_crypto_period_index_,
-                                    false);
-  while (status.ok()) {
-    first_crypto_period_index_ += crypto_period_count_;
-    status = FetchKeysInternal(kEnableKeyRotation,
-                               first_crypto_period_index_,
-                               false);
+  SetCurrentThreadClass(ThreadClass::kIo);
+  while (true) {
+    uint32_t first_crypto_period_index = 0;
+    {
+      base::AutoLock scoped_lock(lock_);
+      // Wait until the keys fetched or being fetched do not cover the prefetch
+      // horizon past the latest crypto period requested.
+      while (!key_production_stopped_ &&
+             next_crypto_period_index_to_fetch_ >
+                 latest_crypto_period_index_ + key_prefetch_crypto_periods_) {
+        key_production_changed_.Wait();
+      }
+      if (key_production_stopped_)
+        return;
+      first_crypto_period_index = next_crypto_period_index_to_fetch_;
+      next_crypto_period_index_to_fetch_ += crypto_period_count_;
+    }
+
+    CryptoPeriodKeys crypto_period_keys;
+    Status status = FetchKeysInternal(kEnableKeyRotation,
+                                      first_crypto_period_index, false,
+                                      &crypto_period_keys);
+    if (status.ok() && crypto_period_keys.size() !=
+                           static_cast<size_t>(crypto_period_count_)) {
+      status = Status(error::SERVER_ERROR,
+                      "Unexpected number of crypto periods in key response.");
+    }
+    if (!status.ok()) {
+      StopKeyProduction(status);
+      return;
+    }
+
+    {
+      base::AutoLock scoped_lock(lock_);
+      // Concurrent requests may complete out of order, but the keys are
+      // pushed in crypto period order.
+      while (!key_production_stopped_ &&
+             next_crypto_period_index_to_push_ != first_crypto_period_index) {
+        key_production_changed_.Wait();
+      }
+      if (key_production_stopped_)
+        return;
+    }
+    for (const auto& encryption_keys : crypto_period_keys) {
+      if (!PushToKeyPool(encryption_keys))
+        return;
+    }
+    {
+      base::AutoLock scoped_lock(lock_);
+      next_crypto_period_index_to_push_ += crypto_period_count_;
+      key_production_changed_.Broadcast();
+    }
   }
-  common_encryption_request_status_ = status;
-  key_pool_->Stop();
 }
 
-Status WidevineKeySource::FetchKeysInternal(bool enable_key_rotation,
-                                            uint32_t first_crypto_period_index,
-                                            bool widevine_classic) {
+void WidevineKeySource::StopKeyProduction(const Status& status) {
+  base::AutoLock scoped_lock(lock_);
+  if (!status.ok() && common_encryption_request_status_.ok())
+    common_encryption_request_status_ = status;
+  key_production_stopped_ = true;
+  if (key_pool_)
+    key_pool_->Stop();
+  key_production_changed_.Broadcast();
+}
+
+Status WidevineKeySource::FetchKeysInternal(
+    bool enable_key_rotation,
+    uint32_t first_crypto_period_index,
+    bool widevine_classic,
+    CryptoPeriodKeys* crypto_period_keys) {
+  DCHECK_EQ(enable_key_rotation, crypto_period_keys != nullptr);
   CommonEncryptionRequest request;
   FillRequest(enable_key_rotation, first_crypto_period_index, &request);
 
+  // The unsigned request identifies the response in the key cache.
+  std::string cache_request;
+  if (key_cache_) {
+    cache_request = server_url_ + "\n" + request.SerializeAsString();
+    std::string cached_response;
+    bool transient_error = false;
+    if (key_cache_->Get(cache_request, &cached_response) &&
+        ExtractEncryptionKey(enable_key_rotation, widevine_classic,
+                             first_crypto_period_index, cached_response,
+                             &transient_error, crypto_period_keys)) {
+      return Status::OK;
+    }
+  }
+
   std::string message;
-  Status status = GenerateKeyMessage(request, &message);
+  Status status;
+  {
+    base::AutoLock scoped_lock(signer_lock_);
+    status = GenerateKeyMessage(request, &message);
+  }
   if (!status.ok())
     return status;
   VLOG(1) << "Message: " << message;
@@ -316,14 +404,23 @@ Status WidevineKeySource::FetchKeysInternal(bool enable_key_rotation,
   // Perform client side retries if seeing server transient error to workaround
   // server limitation.
   for (int i = 0; i < kNumTransientErrorRetries; ++i) {
-    status = key_fetcher_->FetchKeys(server_url_, message, &raw_response);
+    {
+      ScopedLatencyMetric fetch_latency(
+          "packager_key_fetch_seconds",
+          "Time spent fetching keys from the key server.", "");
+      status = key_fetcher_->FetchKeys(server_url_, message, &raw_response);
+    }
     if (status.ok()) {
       VLOG(1) << "Retry [" << i << "] Response:" << raw_response;
 
       bool transient_error = false;
       if (ExtractEncryptionKey(enable_key_rotation, widevine_classic,
-                               raw_response, &transient_error))
+                               first_crypto_period_index, raw_response,
+                               &transient_error, crypto_period_keys)) {
+        if (key_cache_)
+          key_cache_->Put(cache_request, raw_response);
         return Status::OK;
+      }
 
       if (!transient_error) {
         return Status(
@@ -398,18 +495,30 @@ Status WidevineKeySource::GenerateKeyMessage(
 bool WidevineKeySource::ExtractEncryptionKey(
     bool enable_key_rotation,
     bool widevine_classic,
+    uint32_t first_crypto_period_index,
     const std::string& response,
-    bool* transient_error) {
+    bool* transient_error,
+    CryptoPeriodKeys* crypto_period_keys) {
   DCHECK(transient_error);
   *transient_error = false;
-
-  SignedModularDrmResponse signed_response_proto;
+  if (crypto_period_keys)
+    crypto_period_keys->clear();
+
+  // The responses are parsed for every crypto period with key rotation. The
+  // many small allocations of the parsed tracks and PSSHs are made in a single
+  // arena, and released together.
+  google::protobuf::Arena arena;
+  SignedModularDrmResponse& signed_response_proto =
+      *google::protobuf::Arena::CreateMessage<SignedModularDrmResponse>(
+          &arena);
   if (!JsonStringToMessage(response, &signed_response_proto)) {
     LOG(ERROR) << "Failed to convert JSON to proto: " << response;
     return false;
   }
 
-  CommonEncryptionResponse response_proto;
+  CommonEncryptionResponse& response_proto =
+      *google::protobuf::Arena::CreateMessage<CommonEncryptionResponse>(
+          &arena);
   if (!JsonStringToMessage(signed_response_proto.response(), &response_proto)) {
     LOG(ERROR) << "Failed to convert JSON to proto: "
                << signed_response_proto.response();
@@ -429,7 +538,7 @@ bool WidevineKeySource::ExtractEncryptionKey(
              ? response_proto.tracks_size() >= crypto_period_count_
              : response_proto.tracks_size() >= 1);
 
-  uint32_t current_crypto_period_index = first_crypto_period_index_;
+  uint32_t current_crypto_period_index = first_crypto_period_index;
 
   std::vector<std::vector<uint8_t>> key_ids;
   for (const auto& track : response_proto.tracks()) {
@@ -450,8 +559,8 @@ bool WidevineKeySource::ExtractEncryptionKey(
                      << track.crypto_period_index();
           return false;
         }
-        if (!PushToKeyPool(&encryption_key_map))
-          return false;
+        crypto_period_keys->push_back(std::make_shared<EncryptionKeyMap>());
+        crypto_period_keys->back()->swap(encryption_key_map);
         ++current_crypto_period_index;
       }
     }
@@ -490,16 +599,16 @@ bool WidevineKeySource::ExtractEncryptionKey(
     return true;
   }
 
-  return PushToKeyPool(&encryption_key_map);
+  crypto_period_keys->push_back(std::make_shared<EncryptionKeyMap>());
+  crypto_period_keys->back()->swap(encryption_key_map);
+  return true;
 }
 
 bool WidevineKeySource::PushToKeyPool(
-    EncryptionKeyMap* encryption_key_map) {
+    const std::shared_ptr<EncryptionKeyMap>& encryption_keys) {
   DCHECK(key_pool_);
-  DCHECK(encryption_key_map);
-  auto encryption_key_map_shared = std::make_shared<EncryptionKeyMap>();
-  encryption_key_map_shared->swap(*encryption_key_map);
-  Status status = key_pool_->Push(encryption_key_map_shared, kInfiniteTimeout);
+  DCHECK(encryption_keys);
+  Status status = key_pool_->Push(encryption_keys, kInfiniteTimeout);
   if (!status.ok()) {
     DCHECK_EQ(error::STOPPED, status.error_code());
     return false;
@@ -9,7 +9,10 @@
 
 #include <map>
 #include <memory>
-#include "packager/base/synchronization/waitable_event.h"
+#include <vector>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/media/base/closure_thread.h"
 #include "packager/media/base/fourccs.h"
 #include "packager/media/base/key_source.h"
@@ -20,6 +23,7 @@ class CommonEncryptionRequest;
 
 namespace media {
 
+class KeyCache;
 class KeyFetcher;
 class RequestSigner;
 template <class T> class ProducerConsumerQueue;
@@ -68,29 +72,54 @@ class WidevineKeySource : public KeySource {
   /// @param key_fetcher points to the @b KeyFetcher object to be injected.
   void set_key_fetcher(std::unique_ptr<KeyFetcher> key_fetcher);
 
+  /// Set a cache of the key server responses, which are then only requested
+  /// if not cached.
+  void set_key_cache(std::unique_ptr<KeyCache> key_cache);
+
   void set_group_id(const std::vector<uint8_t>& group_id) {
     group_id_ = group_id;
   }
   void set_enable_entitlement_license(bool enable_entitlement_license) {
     enable_entitlement_license_ = enable_entitlement_license;
   }
+  /// Set the number of crypto periods to keep fetched ahead of the latest
+  /// crypto period requested with GetCryptoPeriodKey(). The next keys are
+  /// requested as soon as fewer crypto periods are left. Must be called before
+  /// the first GetCryptoPeriodKey().
+  void set_key_prefetch_crypto_periods(uint32_t key_prefetch_crypto_periods) {
+    key_prefetch_crypto_periods_ = key_prefetch_crypto_periods;
+  }
+  /// Set the maximum number of key rotation requests in flight, each for the
+  /// next crypto periods. Must be called before the first
+  /// GetCryptoPeriodKey().
+  void set_max_concurrent_key_requests(uint32_t max_concurrent_key_requests) {
+    DCHECK_GT(max_concurrent_key_requests, 0u);
+    max_concurrent_key_requests_ = max_concurrent_key_requests;
+  }
 
  private:
   typedef ProducerConsumerQueue<std::shared_ptr<EncryptionKeyMap>>
       EncryptionKeyQueue;
+  typedef std::vector<std::shared_ptr<EncryptionKeyMap>> CryptoPeriodKeys;
 
   // Internal routine for getting keys.
   Status GetKeyInternal(uint32_t crypto_period_index,
                         const std::string& stream_label,
                         EncryptionKey* key);
 
-  // The closure task to fetch keys repeatedly.
+  // The closure task to fetch keys repeatedly. It runs on each of the key
+  // production threads.
   void FetchKeysTask();
+  // Stop key production, with |status| as the reason if not OK.
+  void StopKeyProduction(const Status& status);
 
-  // Fetch keys from server.
+  // Fetch keys from server. With key rotation, |crypto_period_keys| gets the
+  // keys of each crypto period, otherwise the keys are merged into
+  // |encryption_key_map_|.
   Status FetchKeysInternal(bool enable_key_rotation,
                            uint32_t first_crypto_period_index,
-                           bool widevine_classic);
+                           bool widevine_classic,
+                           CryptoPeriodKeys* crypto_period_keys);
 
   // Fill |request| with necessary fields for Widevine encryption request.
   // |request| should not be NULL.
@@ -107,29 +136,42 @@ class WidevineKeySource : public KeySource {
   // should not be NULL.
   bool ExtractEncryptionKey(bool enable_key_rotation,
                             bool widevine_classic,
+                            uint32_t first_crypto_period_index,
                             const std::string& response,
-                            bool* transient_error);
+                            bool* transient_error,
+                            CryptoPeriodKeys* crypto_period_keys);
   // Push the keys to the key pool.
-  bool PushToKeyPool(EncryptionKeyMap* encryption_key_map);
+  bool PushToKeyPool(const std::shared_ptr<EncryptionKeyMap>& encryption_keys);
 
   // Indicates whether Widevine protection system should be generated.
   bool generate_widevine_protection_system_ = true;
 
-  ClosureThread key_production_thread_;
+  std::vector<std::unique_ptr<ClosureThread>> key_production_threads_;
   // The fetcher object used to fetch keys from the license service.
   // It is initialized to a default fetcher on class initialization.
   // Can be overridden using set_key_fetcher for testing or other purposes.
   std::unique_ptr<KeyFetcher> key_fetcher_;
+  std::unique_ptr<KeyCache> key_cache_;
   std::string server_url_;
   std::unique_ptr<RequestSigner> signer_;
+  // Serializes the signing of concurrent key requests.
+  base::Lock signer_lock_;
   std::unique_ptr<CommonEncryptionRequest> common_encryption_request_;
 
   const int crypto_period_count_;
   FourCC protection_scheme_ = FOURCC_NULL;
   base::Lock lock_;
   bool key_production_started_ = false;
-  base::WaitableEvent start_key_production_;
-  uint32_t first_crypto_period_index_ = 0;
+  uint32_t key_prefetch_crypto_periods_;
+  uint32_t max_concurrent_key_requests_ = 1;
+  // Signaled, with |lock_| held, when key production state below changes.
+  base::ConditionVariable key_production_changed_;
+  bool key_production_stopped_ = false;
+  uint32_t latest_crypto_period_index_ = 0;
+  // First crypto period index of the next key request.
+  uint32_t next_crypto_period_index_to_fetch_ = 0;
+  // Keys are pushed to |key_pool_| in order, starting with this crypto period.
+  uint32_t next_crypto_period_index_to_push_ = 0;
   uint32_t crypto_period_duration_in_seconds_ = 0;
   std::vector<uint8_t> group_id_;
   bool enable_entitlement_license_ = false;
@@ -655,6 +655,55 @@ TEST_P(WidevineKeySourceParameterizedTest, KeyRotationTest) {
   EXPECT_EQ(error::INVALID_ARGUMENT, status.error_code());
 }
 
+TEST_P(WidevineKeySourceParameterizedTest, KeyRotationPrefetchHorizon) {
+  const uint32_t kCryptoPeriodCount = 10;
+  const uint32_t kCryptoPeriodSeconds = 100;
+  // Without prefetching, keys are only requested for the crypto periods being
+  // requested: [7, 17) and then [17, 27).
+  const uint32_t kCryptoPeriodIndexes[] = {8, 16, 17, 26};
+  const uint32_t kFirstCryptoPeriodIndexes[] = {7, 17};
+
+  InSequence dummy;
+
+  EXPECT_CALL(*mock_request_signer_, GenerateSignature(_, _))
+      .WillOnce(Return(true));
+  std::string mock_response = base::StringPrintf(
+      kHttpResponseFormat, Base64Encode(GenerateMockLicenseResponse()).c_str());
+  EXPECT_CALL(*mock_key_fetcher_, FetchKeys(_, _, _))
+      .WillOnce(DoAll(SetArgPointee<2>(mock_response), Return(Status::OK)));
+
+  for (uint32_t first_crypto_period_index : kFirstCryptoPeriodIndexes) {
+    std::string expected_message = base::StringPrintf(
+        kCryptoPeriodRequestMessageFormat, Base64Encode(kContentId).c_str(),
+        kPolicy, first_crypto_period_index, kCryptoPeriodCount,
+        kCryptoPeriodSeconds, GetExpectedProtectionScheme().c_str());
+    EXPECT_CALL(*mock_request_signer_, GenerateSignature(expected_message, _))
+        .WillOnce(DoAll(SetArgPointee<1>(kMockSignature), Return(true)));
+
+    std::string mock_response = base::StringPrintf(
+        kHttpResponseFormat,
+        Base64Encode(GenerateMockKeyRotationLicenseResponse(
+                         first_crypto_period_index, kCryptoPeriodCount))
+            .c_str());
+    EXPECT_CALL(*mock_key_fetcher_, FetchKeys(_, _, _))
+        .WillOnce(DoAll(SetArgPointee<2>(mock_response), Return(Status::OK)));
+  }
+
+  CreateWidevineKeySource();
+  widevine_key_source_->set_signer(std::move(mock_request_signer_));
+  widevine_key_source_->set_key_prefetch_crypto_periods(0);
+  widevine_key_source_->set_max_concurrent_key_requests(2);
+  ASSERT_OK(widevine_key_source_->FetchKeys(content_id_, kPolicy));
+
+  EncryptionKey encryption_key;
+  for (uint32_t crypto_period_index : kCryptoPeriodIndexes) {
+    ASSERT_OK(widevine_key_source_->GetCryptoPeriodKey(
+        crypto_period_index, kCryptoPeriodSeconds, "SD", &encryption_key));
+    EXPECT_EQ(GetMockKey("SD", crypto_period_index),
+              ToString(encryption_key.key));
+  }
+}
+
 INSTANTIATE_TEST_CASE_P(WidevineKeySourceInstance,
                         WidevineKeySourceParameterizedTest,
                         Combine(Bool(),
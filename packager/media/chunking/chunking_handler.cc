@@ -7,25 +7,18 @@
 #include "packager/media/chunking/chunking_handler.h"
 
 #include <algorithm>
+#include <limits>
 
 #include "packager/base/logging.h"
+#include "packager/media/base/hot_path_log.h"
 #include "packager/media/base/media_sample.h"
+#include "packager/media/base/muxer_util.h"
 #include "packager/status_macros.h"
 
 namespace shaka {
 namespace media {
 namespace {
 const size_t kStreamIndex = 0;
-
-bool IsNewSegmentIndex(int64_t new_index, int64_t current_index) {
-  return new_index != current_index &&
-         // Index is calculated from pts, which could decrease. We do not expect
-         // it to decrease by more than one segment though, which could happen
-         // only if there is a big overlap in the timeline, in which case, we
-         // will create a new segment and leave it to the player to handle it.
-         new_index != current_index - 1;
-}
-
 }  // namespace
 
 ChunkingHandler::ChunkingHandler(const ChunkingParams& chunking_params)
@@ -44,14 +37,14 @@ Status ChunkingHandler::InitializeInternal() {
 Status ChunkingHandler::Process(std::unique_ptr<StreamData> stream_data) {
   switch (stream_data->stream_data_type) {
     case StreamDataType::kStreamInfo:
-      return OnStreamInfo(std::move(stream_data->stream_info));
+      return OnStreamInfo(stream_data->release_stream_info());
     case StreamDataType::kCueEvent:
-      return OnCueEvent(std::move(stream_data->cue_event));
+      return OnCueEvent(stream_data->release_cue_event());
     case StreamDataType::kSegmentInfo:
       VLOG(3) << "Droppping existing segment info.";
       return Status::OK;
     case StreamDataType::kMediaSample:
-      return OnMediaSample(std::move(stream_data->media_sample));
+      return OnMediaSample(stream_data->release_media_sample());
     default:
       VLOG(3) << "Stream data type "
               << static_cast<int>(stream_data->stream_data_type) << " ignored.";
@@ -59,6 +52,10 @@ Status ChunkingHandler::Process(std::unique_ptr<StreamData> stream_data) {
   }
 }
 
+Status ChunkingHandler::ProcessBatch(StreamDataBatch batch) {
+  return ProcessBatchAndDispatchBatch(std::move(batch));
+}
+
 Status ChunkingHandler::OnFlushRequest(size_t input_stream_index) {
   RETURN_IF_ERROR(EndSegmentIfStarted());
   return FlushDownstream(kStreamIndex);
@@ -95,7 +92,11 @@ Status ChunkingHandler::OnMediaSample(
   bool started_new_segment = false;
   const bool can_start_new_segment =
       sample->is_key_frame() || !chunking_params_.segment_sap_aligned;
-  if (can_start_new_segment) {
+  // This is called for every sample, e.g. every audio frame, so the indexes
+  // are only computed if the timestamp is out of the current bounds.
+  if (can_start_new_segment &&
+      (!segment_start_time_ || timestamp < segment_lower_bound_ ||
+       timestamp >= segment_upper_bound_)) {
     const int64_t segment_index =
         timestamp < cue_offset_ ? 0
                                 : (timestamp - cue_offset_) / segment_duration_;
@@ -110,12 +111,15 @@ Status ChunkingHandler::OnMediaSample(
       subsegment_start_time_ = timestamp;
       max_segment_time_ = timestamp + sample->duration();
       started_new_segment = true;
+      UpdateSegmentBounds();
+      UpdateSubsegmentBounds();
     }
   }
   if (!started_new_segment && IsSubsegmentEnabled()) {
     const bool can_start_new_subsegment =
         sample->is_key_frame() || !chunking_params_.subsegment_sap_aligned;
-    if (can_start_new_subsegment) {
+    if (can_start_new_subsegment && (timestamp < subsegment_lower_bound_ ||
+                                     timestamp >= subsegment_upper_bound_)) {
       const int64_t subsegment_index =
           (timestamp - segment_start_time_.value()) / subsegment_duration_;
       if (IsNewSegmentIndex(subsegment_index, current_subsegment_index_)) {
@@ -123,13 +127,15 @@ Status ChunkingHandler::OnMediaSample(
 
         RETURN_IF_ERROR(EndSubsegmentIfStarted());
         subsegment_start_time_ = timestamp;
+        UpdateSubsegmentBounds();
       }
     }
   }
 
-  VLOG(3) << "Sample ts: " << timestamp << " "
-          << " duration: " << sample->duration() << " scale: " << time_scale_
-          << (segment_start_time_ ? " dispatch " : " discard ");
+  HOT_PATH_LOG(kChunking) << "Sample ts: " << timestamp << " "
+                          << " duration: " << sample->duration()
+                          << " scale: " << time_scale_
+                          << (segment_start_time_ ? " dispatch " : " discard ");
   if (!segment_start_time_) {
     DCHECK(!subsegment_start_time_);
     // Discard samples before segment start. If the segment has started,
@@ -137,7 +143,11 @@ Status ChunkingHandler::OnMediaSample(
     return Status::OK;
   }
 
-  segment_start_time_ = std::min(segment_start_time_.value(), timestamp);
+  if (timestamp < segment_start_time_.value()) {
+    segment_start_time_ = timestamp;
+    // Subsegment indexes are relative to the segment start.
+    UpdateSubsegmentBounds();
+  }
   subsegment_start_time_ = std::min(subsegment_start_time_.value(), timestamp);
   max_segment_time_ =
       std::max(max_segment_time_, timestamp + sample->duration());
@@ -154,6 +164,30 @@ Status ChunkingHandler::EndSegmentIfStarted() const {
   return DispatchSegmentInfo(kStreamIndex, std::move(segment_info));
 }
 
+void ChunkingHandler::UpdateSegmentBounds() {
+  // Mirrors IsNewSegmentIndex(): the index may decrease by one, and timestamps
+  // before |cue_offset_| are in the first segment.
+  segment_lower_bound_ =
+      current_segment_index_ <= 1
+          ? std::numeric_limits<int64_t>::min()
+          : cue_offset_ + (current_segment_index_ - 1) * segment_duration_;
+  segment_upper_bound_ =
+      cue_offset_ + (current_segment_index_ + 1) * segment_duration_;
+}
+
+void ChunkingHandler::UpdateSubsegmentBounds() {
+  // Timestamps before the segment start are not in the bounds as integer
+  // division rounds towards zero.
+  const int64_t segment_start_time = segment_start_time_.value();
+  subsegment_lower_bound_ =
+      segment_start_time +
+      std::max<int64_t>(current_subsegment_index_ - 1, 0) *
+          subsegment_duration_;
+  subsegment_upper_bound_ =
+      segment_start_time + (current_subsegment_index_ + 1) *
+                               subsegment_duration_;
+}
+
 Status ChunkingHandler::EndSubsegmentIfStarted() const {
   if (!subsegment_start_time_)
     return Status::OK;
@@ -36,6 +36,12 @@ namespace media {
 ///
 /// This algorithm will make sure the chunks from different video streams are
 /// aligned if they have aligned GoPs.
+///
+/// The boundaries are computed independently in every stream on purpose: the
+/// computation is deterministic and costs a compare per sample, while sharing
+/// the boundaries of a reference stream would require the other streams to
+/// buffer samples until the reference stream reaches them, as the streams of
+/// an input are chunked in the same thread.
 class ChunkingHandler : public MediaHandler {
  public:
   explicit ChunkingHandler(const ChunkingParams& chunking_params);
@@ -46,6 +52,7 @@ class ChunkingHandler : public MediaHandler {
   /// @{
   Status InitializeInternal() override;
   Status Process(std::unique_ptr<StreamData> stream_data) override;
+  Status ProcessBatch(StreamDataBatch batch) override;
   Status OnFlushRequest(size_t input_stream_index) override;
   /// @}
 
@@ -62,6 +69,10 @@ class ChunkingHandler : public MediaHandler {
   Status EndSegmentIfStarted() const;
   Status EndSubsegmentIfStarted() const;
 
+  // Updates the bounds of the current (sub)segment from its index.
+  void UpdateSegmentBounds();
+  void UpdateSubsegmentBounds();
+
   bool IsSubsegmentEnabled() {
     return subsegment_duration_ > 0 &&
            subsegment_duration_ != segment_duration_;
@@ -78,6 +89,13 @@ class ChunkingHandler : public MediaHandler {
   // Current subsegment index, useful to determine where to do chunking.
   int64_t current_subsegment_index_ = -1;
 
+  // Samples with timestamps in [lower bound, upper bound) do not start a new
+  // (sub)segment, so the index is only computed for samples outside of it.
+  int64_t segment_lower_bound_ = 0;
+  int64_t segment_upper_bound_ = 0;
+  int64_t subsegment_lower_bound_ = 0;
+  int64_t subsegment_upper_bound_ = 0;
+
   base::Optional<int64_t> segment_start_time_;
   base::Optional<int64_t> subsegment_start_time_;
   int64_t max_segment_time_ = 0;
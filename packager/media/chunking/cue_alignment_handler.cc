@@ -8,6 +8,8 @@
 
 #include <algorithm>
 
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/media/base/metrics.h"
 #include "packager/status_macros.h"
 
 namespace shaka {
@@ -19,10 +21,10 @@ namespace {
 const size_t kMaxBufferSize = 1000;
 
 int64_t GetScaledTime(const StreamInfo& info, const StreamData& data) {
-  DCHECK(data.text_sample || data.media_sample);
+  DCHECK(data.text_sample() || data.media_sample());
 
-  if (data.text_sample) {
-    return data.text_sample->start_time();
+  if (data.text_sample()) {
+    return data.text_sample()->start_time();
   }
 
   if (info.stream_type() == kStreamText) {
@@ -37,11 +39,11 @@ int64_t GetScaledTime(const StreamInfo& info, const StreamData& data) {
     // Return the mid-point for audio because if the portion of the sample
     // after the cue point is bigger than the portion of the sample before
     // the cue point, the sample is placed after the cue.
-    return data.media_sample->pts() + data.media_sample->duration() / 2;
+    return data.media_sample()->pts() + data.media_sample()->duration() / 2;
   }
 
   DCHECK_EQ(info.stream_type(), kStreamVideo);
-  return data.media_sample->pts();
+  return data.media_sample()->pts();
 }
 
 double TimeInSeconds(const StreamInfo& info, const StreamData& data) {
@@ -52,9 +54,9 @@ double TimeInSeconds(const StreamInfo& info, const StreamData& data) {
 }
 
 double TextEndTimeInSeconds(const StreamInfo& info, const StreamData& data) {
-  DCHECK(data.text_sample);
+  DCHECK(data.text_sample());
 
-  const int64_t scaled_time = data.text_sample->EndTime();
+  const int64_t scaled_time = data.text_sample()->EndTime();
   const uint32_t time_scale = info.time_scale();
 
   return static_cast<double>(scaled_time) / time_scale;
@@ -62,11 +64,12 @@ double TextEndTimeInSeconds(const StreamInfo& info, const StreamData& data) {
 
 Status GetNextCue(double hint,
                   SyncPointQueue* sync_points,
+                  bool* waiting,
                   std::shared_ptr<const CueEvent>* out_cue) {
   DCHECK(sync_points);
   DCHECK(out_cue);
 
-  *out_cue = sync_points->GetNext(hint);
+  *out_cue = sync_points->GetNext(hint, waiting);
 
   // |*out_cue| will only be null if the job was cancelled.
   return *out_cue ? Status::OK
@@ -75,7 +78,19 @@ Status GetNextCue(double hint,
 }  // namespace
 
 CueAlignmentHandler::CueAlignmentHandler(SyncPointQueue* sync_points)
-    : sync_points_(sync_points) {}
+    : CueAlignmentHandler(sync_points, std::string()) {}
+
+CueAlignmentHandler::CueAlignmentHandler(SyncPointQueue* sync_points,
+                                         const std::string& input_name)
+    : sync_points_(sync_points), input_name_(input_name) {}
+
+void CueAlignmentHandler::LeaveSyncPoints() {
+  // The thread is only added to |sync_points_| on initialization.
+  if (!initialized() || left_sync_points_)
+    return;
+  sync_points_->RemoveThread(&waiting_at_hint_);
+  left_sync_points_ = true;
+}
 
 Status CueAlignmentHandler::InitializeInternal() {
   sync_points_->AddThread();
@@ -133,7 +148,8 @@ Status CueAlignmentHandler::OnFlushRequest(size_t stream_index) {
   // when we call |UseNextSyncPoint|.
   while (sync_points_->HasMore(hint_)) {
     std::shared_ptr<const CueEvent> next_cue;
-    RETURN_IF_ERROR(GetNextCue(hint_, sync_points_, &next_cue));
+    RETURN_IF_ERROR(
+        GetNextCue(hint_, sync_points_, &waiting_at_hint_, &next_cue));
     RETURN_IF_ERROR(UseNewSyncPoint(std::move(next_cue)));
   }
 
@@ -150,12 +166,12 @@ Status CueAlignmentHandler::OnFlushRequest(size_t stream_index) {
     // two at the cue point.
     for (auto& cue : stream.cues) {
       // |max_text_sample_end_time_seconds| is always 0 for non-text samples.
-      if (cue->cue_event->time_in_seconds <
+      if (cue->cue_event()->time_in_seconds <
           stream.max_text_sample_end_time_seconds) {
         RETURN_IF_ERROR(Dispatch(std::move(cue)));
       } else {
         VLOG(1) << "Ignore extra cue in stream " << cue->stream_index
-                << " with time " << cue->cue_event->time_in_seconds
+                << " with time " << cue->cue_event()->time_in_seconds
                 << "s in the end.";
       }
     }
@@ -169,20 +185,20 @@ Status CueAlignmentHandler::OnStreamInfo(std::unique_ptr<StreamData> data) {
   StreamState& stream_state = stream_states_[data->stream_index];
   // Keep a copy of the stream info so that we can check type and check
   // timescale.
-  stream_state.info = data->stream_info;
+  stream_state.info = data->stream_info();
 
   return Dispatch(std::move(data));
 }
 
 Status CueAlignmentHandler::OnVideoSample(std::unique_ptr<StreamData> sample) {
   DCHECK(sample);
-  DCHECK(sample->media_sample);
+  DCHECK(sample->media_sample());
 
   const size_t stream_index = sample->stream_index;
   StreamState& stream = stream_states_[stream_index];
 
   const double sample_time = TimeInSeconds(*stream.info, *sample);
-  const bool is_key_frame = sample->media_sample->is_key_frame();
+  const bool is_key_frame = sample->media_sample()->is_key_frame();
 
   if (is_key_frame && sample_time >= hint_) {
     auto next_sync = sync_points_->PromoteAt(sample_time);
@@ -206,7 +222,7 @@ Status CueAlignmentHandler::OnVideoSample(std::unique_ptr<StreamData> sample) {
 Status CueAlignmentHandler::OnNonVideoSample(
     std::unique_ptr<StreamData> sample) {
   DCHECK(sample);
-  DCHECK(sample->media_sample || sample->text_sample);
+  DCHECK(sample->media_sample() || sample->text_sample());
 
   const size_t stream_index = sample->stream_index;
   StreamState& stream_state = stream_states_[stream_index];
@@ -221,8 +237,9 @@ Status CueAlignmentHandler::OnNonVideoSample(
   // sync point.
   if (EveryoneWaitingAtHint()) {
     std::shared_ptr<const CueEvent> next_sync;
-    RETURN_IF_ERROR(GetNextCue(hint_, sync_points_, &next_sync));
-    RETURN_IF_ERROR(UseNewSyncPoint(next_sync));
+    RETURN_IF_ERROR(GetNextSyncPoint(stream_state, &next_sync));
+    if (next_sync)
+      RETURN_IF_ERROR(UseNewSyncPoint(next_sync));
   }
 
   return Status::OK;
@@ -241,7 +258,7 @@ Status CueAlignmentHandler::OnSample(std::unique_ptr<StreamData> sample) {
 
   const size_t stream_index = sample->stream_index;
 
-  if (sample->text_sample) {
+  if (sample->text_sample()) {
     StreamState& stream = stream_states_[stream_index];
     stream.max_text_sample_end_time_seconds =
         std::max(stream.max_text_sample_end_time_seconds,
@@ -267,6 +284,7 @@ Status CueAlignmentHandler::UseNewSyncPoint(
     stream.cues.push_back(StreamData::FromCueEvent(stream_index, new_sync));
 
     RETURN_IF_ERROR(RunThroughSamples(&stream));
+    ObserveWaitTime(stream_index, &stream);
   }
 
   return Status::OK;
@@ -284,7 +302,7 @@ bool CueAlignmentHandler::EveryoneWaitingAtHint() const {
 Status CueAlignmentHandler::AcceptSample(std::unique_ptr<StreamData> sample,
                                          StreamState* stream) {
   DCHECK(sample);
-  DCHECK(sample->media_sample || sample->text_sample);
+  DCHECK(sample->media_sample() || sample->text_sample());
   DCHECK(stream);
 
   // Need to cache the stream index as we will lose the pointer when we add
@@ -301,14 +319,18 @@ Status CueAlignmentHandler::AcceptSample(std::unique_ptr<StreamData> sample,
                   "Streams are not properly multiplexed.");
   }
 
-  return RunThroughSamples(stream);
+  RETURN_IF_ERROR(RunThroughSamples(stream));
+  // The samples left are at or after the hint.
+  if (!stream->samples.empty() && stream->wait_start_time.is_null())
+    stream->wait_start_time = base::TimeTicks::Now();
+  return Status::OK;
 }
 
 Status CueAlignmentHandler::RunThroughSamples(StreamState* stream) {
   // Step through all our samples until we find where we can insert the cue.
   // Think of this as a merge sort.
   while (stream->cues.size() && stream->samples.size()) {
-    const double cue_time = stream->cues.front()->cue_event->time_in_seconds;
+    const double cue_time = stream->cues.front()->cue_event()->time_in_seconds;
     const double sample_time =
         TimeInSeconds(*stream->info, *stream->samples.front());
 
@@ -332,5 +354,42 @@ Status CueAlignmentHandler::RunThroughSamples(StreamState* stream) {
 
   return Status::OK;
 }
+
+Status CueAlignmentHandler::GetNextSyncPoint(
+    const StreamState& stream,
+    std::shared_ptr<const CueEvent>* next_sync) {
+  const double horizon = sync_points_->horizon_in_seconds();
+  if (horizon > 0) {
+    *next_sync = sync_points_->TryGetNext(hint_, &waiting_at_hint_);
+    if (*next_sync)
+      return Status::OK;
+    if (!waiting_at_hint_)
+      return Status(error::CANCELLED, "SyncPointQueue is cancelled.");
+
+    // Keep processing the input while the samples are within the horizon.
+    DCHECK(!stream.samples.empty());
+    if (TimeInSeconds(*stream.info, *stream.samples.back()) < hint_ + horizon)
+      return Status::OK;
+    VLOG(2) << "Stream " << stream.samples.back()->stream_index
+            << " reached the horizon at " << hint_ + horizon << "s.";
+  }
+  return GetNextCue(hint_, sync_points_, &waiting_at_hint_, next_sync);
+}
+
+void CueAlignmentHandler::ObserveWaitTime(size_t stream_index,
+                                          StreamState* stream) {
+  if (stream->wait_start_time.is_null())
+    return;
+  const base::TimeTicks now = base::TimeTicks::Now();
+  Metrics::GetInstance()->ObserveLatency(
+      "packager_cue_alignment_wait_seconds",
+      "Time spent by a stream waiting for the next cue to be aligned.",
+      MetricLabel("input", input_name_) + "," +
+          MetricLabel("stream", base::SizeTToString(stream_index)),
+      now - stream->wait_start_time);
+  // The samples left are past the new hint, so the stream keeps waiting.
+  stream->wait_start_time =
+      stream->samples.empty() ? base::TimeTicks() : now;
+}
 }  // namespace media
 }  // namespace shaka
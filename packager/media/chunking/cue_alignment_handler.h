@@ -9,7 +9,9 @@
 
 #include <deque>
 #include <list>
+#include <string>
 
+#include "packager/base/time/time.h"
 #include "packager/media/base/media_handler.h"
 #include "packager/media/chunking/sync_point_queue.h"
 
@@ -23,11 +25,26 @@ namespace media {
 /// There should be a cue alignment handler per demuxer/thread and not per
 /// stream. A cue alignment handler must be one per thread in order to properly
 /// manage blocking.
+///
+/// If the sync points have a horizon, streams without video keep buffering
+/// samples up to the horizon past the hint, instead of blocking as soon as
+/// they reach the hint, while waiting for another thread to promote the cue.
+/// The time spent by each stream waiting at the hint is recorded in the
+/// "packager_cue_alignment_wait_seconds" metric.
 class CueAlignmentHandler : public MediaHandler {
  public:
   explicit CueAlignmentHandler(SyncPointQueue* sync_points);
+  /// @param input_name labels the metrics of the streams.
+  CueAlignmentHandler(SyncPointQueue* sync_points,
+                      const std::string& input_name);
   ~CueAlignmentHandler() = default;
 
+  /// Removes the thread of this handler from the sync points, so that the
+  /// other threads stop waiting for it at the next cue. Used when the job of
+  /// the handler is stopped before the end of its streams. The job must have
+  /// exited.
+  void LeaveSyncPoints();
+
  private:
   CueAlignmentHandler(const CueAlignmentHandler&) = delete;
   CueAlignmentHandler& operator=(const CueAlignmentHandler&) = delete;
@@ -46,6 +63,9 @@ class CueAlignmentHandler : public MediaHandler {
     // A list of cues that the stream should inject between media samples. When
     // there are no cues, the stream should run up to the hint.
     std::list<std::unique_ptr<StreamData>> cues;
+
+    // Set when the stream starts buffering samples at the hint.
+    base::TimeTicks wait_start_time;
   };
 
   // MediaHandler overrides.
@@ -73,7 +93,17 @@ class CueAlignmentHandler : public MediaHandler {
   // Dispatch all samples and cues (in the correct order) for the given stream.
   Status RunThroughSamples(StreamState* stream);
 
+  // Get the next cue at |hint_|, without blocking within the horizon of
+  // |sync_points_|. |*next_sync| is null if the stream can keep buffering
+  // samples.
+  Status GetNextSyncPoint(const StreamState& stream,
+                          std::shared_ptr<const CueEvent>* next_sync);
+
+  // Record the time spent by |stream| waiting at the hint, if any.
+  void ObserveWaitTime(size_t stream_index, StreamState* stream);
+
   SyncPointQueue* const sync_points_ = nullptr;
+  const std::string input_name_;
   std::deque<StreamState> stream_states_;
 
   // A common hint used by all streams. When a new cue is given to all streams,
@@ -85,6 +115,11 @@ class CueAlignmentHandler : public MediaHandler {
   // event. If all streams get to the hint and there are no video streams, the
   // thread will block until |sync_points_| gives back a promoted cue event.
   double hint_;
+
+  // Set if this thread is counted as waiting at |hint_| by |sync_points_|.
+  bool waiting_at_hint_ = false;
+  // Set once the thread is removed from |sync_points_|.
+  bool left_sync_points_ = false;
 };
 
 }  // namespace media
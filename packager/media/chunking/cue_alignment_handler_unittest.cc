@@ -9,7 +9,10 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "packager/base/bind.h"
+#include "packager/media/base/closure_thread.h"
 #include "packager/media/base/media_handler_test_base.h"
+#include "packager/media/base/metrics.h"
 #include "packager/media/chunking/cue_alignment_handler.h"
 #include "packager/media/public/ad_cue_generator_params.h"
 #include "packager/status_macros.h"
@@ -17,7 +20,9 @@
 
 using ::testing::_;
 using ::testing::ElementsAre;
+using ::testing::HasSubstr;
 using ::testing::IsEmpty;
+using ::testing::MockFunction;
 
 namespace shaka {
 namespace media {
@@ -94,6 +99,26 @@ class CueAlignmentHandlerTest : public MediaHandlerTestBase {
     return Input(input_index)->Dispatch(std::move(data));
   }
 
+  std::unique_ptr<SyncPointQueue> CreateSyncPointsWithHorizon(
+      double cue_time,
+      double horizon) {
+    AdCueGeneratorParams params;
+    Cuepoint cue;
+    cue.start_time_in_seconds = cue_time;
+    params.cue_points.push_back(cue);
+    params.cue_alignment_horizon_in_seconds = horizon;
+    return std::unique_ptr<SyncPointQueue>(new SyncPointQueue(params));
+  }
+
+  // Dispatches a key frame sample to |input_index| and records the status in
+  // |dispatch_status_|, to be run on another thread.
+  void DispatchKeyFrameInBackground(size_t input_index,
+                                    int64_t start_time,
+                                    int64_t duration) {
+    dispatch_status_ =
+        DispatchMediaSample(input_index, start_time, duration, kKeyFrame);
+  }
+
   Status FlushAll(std::initializer_list<size_t> inputs) {
     for (auto& input : inputs) {
       RETURN_IF_ERROR(Input(input)->FlushAllDownstreams());
@@ -101,6 +126,8 @@ class CueAlignmentHandlerTest : public MediaHandlerTestBase {
 
     return Status::OK;
   }
+
+  Status dispatch_status_;
 };
 
 TEST_F(CueAlignmentHandlerTest, VideoInputWithNoCues) {
@@ -609,6 +636,227 @@ TEST_F(CueAlignmentHandlerTest, TextAudioVideoInputWithCues) {
   ASSERT_OK(FlushAll({kTextStream, kAudioStream, kVideoStream}));
 }
 
+TEST_F(CueAlignmentHandlerTest, SyncPointsTryGetNext) {
+  const double kCueTime = 1.0;
+
+  AdCueGeneratorParams params;
+  Cuepoint cue;
+  cue.start_time_in_seconds = kCueTime;
+  params.cue_points.push_back(cue);
+  params.cue_alignment_horizon_in_seconds = 2.0;
+  SyncPointQueue sync_points(params);
+  sync_points.AddThread();
+  sync_points.AddThread();
+
+  const double hint = sync_points.GetHint(-1);
+  ASSERT_EQ(kCueTime, hint);
+
+  // The first thread does not block at the hint, but counts as waiting.
+  bool first_waiting = false;
+  EXPECT_FALSE(sync_points.TryGetNext(hint, &first_waiting));
+  EXPECT_TRUE(first_waiting);
+  EXPECT_FALSE(sync_points.TryGetNext(hint, &first_waiting));
+  EXPECT_TRUE(first_waiting);
+
+  // So the second thread self-promotes the cue when it reaches the hint.
+  bool second_waiting = false;
+  std::shared_ptr<const CueEvent> next_cue =
+      sync_points.TryGetNext(hint, &second_waiting);
+  ASSERT_TRUE(next_cue);
+  EXPECT_EQ(kCueTime, next_cue->time_in_seconds);
+  EXPECT_FALSE(second_waiting);
+
+  next_cue = sync_points.TryGetNext(hint, &first_waiting);
+  ASSERT_TRUE(next_cue);
+  EXPECT_EQ(kCueTime, next_cue->time_in_seconds);
+  EXPECT_FALSE(first_waiting);
+
+  sync_points.Cancel();
+  const double next_hint = sync_points.GetHint(kCueTime);
+  EXPECT_FALSE(sync_points.TryGetNext(next_hint, &first_waiting));
+  EXPECT_FALSE(first_waiting);
+}
+
+TEST_F(CueAlignmentHandlerTest, SyncPointsRemoveThread) {
+  const double kCueTime = 1.0;
+
+  AdCueGeneratorParams params;
+  Cuepoint cue;
+  cue.start_time_in_seconds = kCueTime;
+  params.cue_points.push_back(cue);
+  params.cue_alignment_horizon_in_seconds = 2.0;
+  SyncPointQueue sync_points(params);
+  sync_points.AddThread();
+  sync_points.AddThread();
+  sync_points.AddThread();
+
+  const double hint = sync_points.GetHint(-1);
+  bool first_waiting = false;
+  EXPECT_FALSE(sync_points.TryGetNext(hint, &first_waiting));
+  EXPECT_TRUE(first_waiting);
+
+  // The second thread leaves while waiting.
+  bool second_waiting = false;
+  EXPECT_FALSE(sync_points.TryGetNext(hint, &second_waiting));
+  EXPECT_TRUE(second_waiting);
+  sync_points.RemoveThread(&second_waiting);
+  EXPECT_FALSE(second_waiting);
+
+  // So the last thread self-promotes the cue when it reaches the hint.
+  bool third_waiting = false;
+  std::shared_ptr<const CueEvent> next_cue =
+      sync_points.TryGetNext(hint, &third_waiting);
+  ASSERT_TRUE(next_cue);
+  EXPECT_EQ(kCueTime, next_cue->time_in_seconds);
+}
+
+// Verify that an audio stream keeps processing its input within the horizon
+// past the cue, and releases the buffered samples once another input promotes
+// the cue.
+TEST_F(CueAlignmentHandlerTest, AudioInputBuffersWithinHorizon) {
+  const size_t kAudioStream = 0;
+
+  const int64_t kSampleDuration = 1000;
+  const int64_t kSample0Start = 0;
+  const int64_t kSample1Start = kSample0Start + kSampleDuration;
+  const int64_t kSample2Start = kSample1Start + kSampleDuration;
+  const int64_t kSample3Start = kSample2Start + kSampleDuration;
+
+  const double kCueTimeInSeconds = 1.0;
+  const double kHorizonInSeconds = 2.0;
+
+  Metrics* metrics = Metrics::GetInstance();
+  metrics->Enable();
+  metrics->ResetForTesting();
+
+  auto sync_points =
+      CreateSyncPointsWithHorizon(kCueTimeInSeconds, kHorizonInSeconds);
+  auto handler =
+      std::make_shared<CueAlignmentHandler>(sync_points.get(), "input.mp4");
+  ASSERT_OK(SetUpAndInitializeGraph(handler, kOneInput, kOneOutput));
+  // Another input, which has not reached the cue yet.
+  sync_points->AddThread();
+
+  MockFunction<void()> cue_promoted;
+  {
+    testing::InSequence s;
+
+    EXPECT_CALL(*Output(kAudioStream),
+                OnProcess(IsStreamInfo(_, kMsTimeScale, _, _)));
+    EXPECT_CALL(
+        *Output(kAudioStream),
+        OnProcess(IsMediaSample(_, kSample0Start, kSampleDuration, _, _)));
+    EXPECT_CALL(cue_promoted, Call());
+    EXPECT_CALL(*Output(kAudioStream),
+                OnProcess(IsCueEvent(_, kCueTimeInSeconds)));
+    EXPECT_CALL(
+        *Output(kAudioStream),
+        OnProcess(IsMediaSample(_, kSample1Start, kSampleDuration, _, _)));
+    EXPECT_CALL(
+        *Output(kAudioStream),
+        OnProcess(IsMediaSample(_, kSample2Start, kSampleDuration, _, _)));
+    EXPECT_CALL(
+        *Output(kAudioStream),
+        OnProcess(IsMediaSample(_, kSample3Start, kSampleDuration, _, _)));
+    EXPECT_CALL(*Output(kAudioStream), OnFlush(_));
+  }
+
+  ASSERT_OK(DispatchAudioInfo(kAudioStream));
+  ASSERT_OK(DispatchMediaSample(kAudioStream, kSample0Start, kSampleDuration,
+                                kKeyFrame));
+  // Samples 1 and 2 are within the horizon, so they are buffered without
+  // blocking.
+  ASSERT_OK(DispatchMediaSample(kAudioStream, kSample1Start, kSampleDuration,
+                                kKeyFrame));
+  ASSERT_OK(DispatchMediaSample(kAudioStream, kSample2Start, kSampleDuration,
+                                kKeyFrame));
+
+  // The audio input counts as waiting at the cue, so the other input promotes
+  // it without blocking.
+  std::shared_ptr<const CueEvent> cue =
+      sync_points->GetNext(kCueTimeInSeconds);
+  ASSERT_TRUE(cue);
+  EXPECT_EQ(kCueTimeInSeconds, cue->time_in_seconds);
+  cue_promoted.Call();
+
+  ASSERT_OK(DispatchMediaSample(kAudioStream, kSample3Start, kSampleDuration,
+                                kKeyFrame));
+  ASSERT_OK(FlushAll({kAudioStream}));
+
+  EXPECT_THAT(metrics->ToPrometheusText(),
+              HasSubstr("packager_cue_alignment_wait_seconds_count{"
+                        "input=\"input.mp4\",stream=\"0\"} 1\n"));
+  metrics->ResetForTesting();
+}
+
+// Verify that an audio stream blocks once its samples reach the horizon past
+// the cue, until the cue is promoted.
+TEST_F(CueAlignmentHandlerTest, AudioInputBlocksAtHorizon) {
+  const size_t kAudioStream = 0;
+
+  const int64_t kSampleDuration = 1000;
+  const int64_t kSample0Start = 0;
+  const int64_t kSample1Start = kSample0Start + kSampleDuration;
+  const int64_t kSample2Start = kSample1Start + kSampleDuration;
+
+  const double kCueTimeInSeconds = 1.0;
+  const double kHorizonInSeconds = 1.0;
+
+  auto sync_points =
+      CreateSyncPointsWithHorizon(kCueTimeInSeconds, kHorizonInSeconds);
+  auto handler = std::make_shared<CueAlignmentHandler>(sync_points.get());
+  ASSERT_OK(SetUpAndInitializeGraph(handler, kOneInput, kOneOutput));
+  // Another input, which has not reached the cue yet.
+  sync_points->AddThread();
+
+  MockFunction<void()> sample_dispatched;
+  {
+    testing::InSequence s;
+
+    EXPECT_CALL(*Output(kAudioStream),
+                OnProcess(IsStreamInfo(_, kMsTimeScale, _, _)));
+    EXPECT_CALL(
+        *Output(kAudioStream),
+        OnProcess(IsMediaSample(_, kSample0Start, kSampleDuration, _, _)));
+    EXPECT_CALL(*Output(kAudioStream),
+                OnProcess(IsCueEvent(_, kCueTimeInSeconds)));
+    EXPECT_CALL(
+        *Output(kAudioStream),
+        OnProcess(IsMediaSample(_, kSample1Start, kSampleDuration, _, _)));
+    EXPECT_CALL(
+        *Output(kAudioStream),
+        OnProcess(IsMediaSample(_, kSample2Start, kSampleDuration, _, _)));
+    EXPECT_CALL(sample_dispatched, Call());
+    EXPECT_CALL(*Output(kAudioStream), OnFlush(_));
+  }
+
+  ASSERT_OK(DispatchAudioInfo(kAudioStream));
+  ASSERT_OK(DispatchMediaSample(kAudioStream, kSample0Start, kSampleDuration,
+                                kKeyFrame));
+  ASSERT_OK(DispatchMediaSample(kAudioStream, kSample1Start, kSampleDuration,
+                                kKeyFrame));
+
+  {
+    // Sample 2 reaches the horizon, so its dispatch blocks until the cue is
+    // promoted, then releases the buffered samples with the cue.
+    ClosureThread thread(
+        "DispatchKeyFrame",
+        base::Bind(&CueAlignmentHandlerTest::DispatchKeyFrameInBackground,
+                   base::Unretained(this), kAudioStream, kSample2Start,
+                   kSampleDuration));
+    thread.Start();
+    // Whichever input reaches the cue last promotes it.
+    std::shared_ptr<const CueEvent> cue =
+        sync_points->GetNext(kCueTimeInSeconds);
+    ASSERT_TRUE(cue);
+    EXPECT_EQ(kCueTimeInSeconds, cue->time_in_seconds);
+  }
+  ASSERT_OK(dispatch_status_);
+  sample_dispatched.Call();
+
+  ASSERT_OK(FlushAll({kAudioStream}));
+}
+
 // TODO(kqyang): Add more tests, in particular, multi-thread tests.
 
 }  // namespace media
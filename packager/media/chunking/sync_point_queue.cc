@@ -10,11 +10,14 @@
 #include <algorithm>
 #include <limits>
 
+#include "packager/base/trace_event/trace_event.h"
+
 namespace shaka {
 namespace media {
 
 SyncPointQueue::SyncPointQueue(const AdCueGeneratorParams& params)
-    : sync_condition_(&lock_) {
+    : sync_condition_(&lock_),
+      horizon_in_seconds_(params.cue_alignment_horizon_in_seconds) {
   for (const Cuepoint& point : params.cue_points) {
     std::shared_ptr<CueEvent> event = std::make_shared<CueEvent>();
     event->time_in_seconds = point.start_time_in_seconds;
@@ -27,6 +30,21 @@ void SyncPointQueue::AddThread() {
   thread_count_++;
 }
 
+void SyncPointQueue::RemoveThread(bool* waiting) {
+  DCHECK(waiting);
+  {
+    base::AutoLock auto_lock(lock_);
+    DCHECK_GT(thread_count_, 0u);
+    if (*waiting) {
+      waiting_thread_count_--;
+      *waiting = false;
+    }
+    thread_count_--;
+  }
+  // The other threads may all be waiting now.
+  sync_condition_.Broadcast();
+}
+
 void SyncPointQueue::Cancel() {
   {
     base::AutoLock auto_lock(lock_);
@@ -53,32 +71,19 @@ double SyncPointQueue::GetHint(double time_in_seconds) {
 
 std::shared_ptr<const CueEvent> SyncPointQueue::GetNext(
     double hint_in_seconds) {
-  base::AutoLock auto_lock(lock_);
-  while (!cancelled_) {
-    // Find the promoted cue that would line up with our hint, which is the
-    // first cue that is not less than |hint_in_seconds|.
-    auto iter = promoted_.lower_bound(hint_in_seconds);
-    if (iter != promoted_.end()) {
-      return iter->second;
-    }
+  bool waiting = false;
+  return GetNextInternal(hint_in_seconds, true, &waiting);
+}
 
-    // Promote |hint_in_seconds| if everyone is waiting.
-    if (waiting_thread_count_ + 1 == thread_count_) {
-      std::shared_ptr<const CueEvent> cue = PromoteAtNoLocking(hint_in_seconds);
-      CHECK(cue);
-      return cue;
-    }
+std::shared_ptr<const CueEvent> SyncPointQueue::GetNext(double hint_in_seconds,
+                                                        bool* waiting) {
+  return GetNextInternal(hint_in_seconds, true, waiting);
+}
 
-    waiting_thread_count_++;
-    // This blocks until either a cue is promoted or all threads are blocked
-    // (in which case, the unpromoted cue at the hint will be self-promoted
-    // and returned - see section above). Spurious signal events are possible
-    // with most condition variable implementations, so if it returns, we go
-    // back and check if a cue is actually promoted or not.
-    sync_condition_.Wait();
-    waiting_thread_count_--;
-  }
-  return nullptr;
+std::shared_ptr<const CueEvent> SyncPointQueue::TryGetNext(
+    double hint_in_seconds,
+    bool* waiting) {
+  return GetNextInternal(hint_in_seconds, false, waiting);
 }
 
 std::shared_ptr<const CueEvent> SyncPointQueue::PromoteAt(
@@ -127,5 +132,61 @@ std::shared_ptr<const CueEvent> SyncPointQueue::PromoteAtNoLocking(
   return std::move(cue);
 }
 
+std::shared_ptr<const CueEvent> SyncPointQueue::GetNextInternal(
+    double hint_in_seconds,
+    bool block,
+    bool* waiting) {
+  DCHECK(waiting);
+  base::AutoLock auto_lock(lock_);
+  while (!cancelled_) {
+    // Find the promoted cue that would line up with our hint, which is the
+    // first cue that is not less than |hint_in_seconds|.
+    auto iter = promoted_.lower_bound(hint_in_seconds);
+    if (iter != promoted_.end()) {
+      if (*waiting) {
+        waiting_thread_count_--;
+        *waiting = false;
+      }
+      return iter->second;
+    }
+
+    // Promote |hint_in_seconds| if everyone else is waiting.
+    const size_t other_waiting_thread_count =
+        waiting_thread_count_ - (*waiting ? 1 : 0);
+    if (other_waiting_thread_count + 1 == thread_count_) {
+      if (*waiting) {
+        waiting_thread_count_--;
+        *waiting = false;
+      }
+      std::shared_ptr<const CueEvent> cue = PromoteAtNoLocking(hint_in_seconds);
+      CHECK(cue);
+      return cue;
+    }
+
+    // A thread that does not block still counts as waiting until it gets the
+    // cue, as it does not dispatch samples past the hint meanwhile.
+    if (!*waiting) {
+      waiting_thread_count_++;
+      *waiting = true;
+    }
+    if (!block)
+      return nullptr;
+
+    TRACE_EVENT1("shaka", "SyncPointQueue::Wait", "hint_in_seconds",
+                 hint_in_seconds);
+    // This blocks until either a cue is promoted or all threads are blocked
+    // (in which case, the unpromoted cue at the hint will be self-promoted
+    // and returned - see section above). Spurious signal events are possible
+    // with most condition variable implementations, so if it returns, we go
+    // back and check if a cue is actually promoted or not.
+    sync_condition_.Wait();
+  }
+  if (*waiting) {
+    waiting_thread_count_--;
+    *waiting = false;
+  }
+  return nullptr;
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -26,6 +26,14 @@ class SyncPointQueue {
   /// order to keep track of its clients.
   void AddThread();
 
+  /// Remove a thread added with AddThread(), e.g. when it is stopped before
+  /// reaching the end of its streams, so that the other threads do not wait
+  /// for it to reach the next cue. The thread must not be using this instance
+  /// anymore.
+  /// @param[in,out] waiting tells whether the thread was waiting, as returned
+  ///                by TryGetNext(). It is false on return.
+  void RemoveThread(bool* waiting);
+
   /// Cancel the queue and unblock all threads.
   void Cancel();
 
@@ -43,6 +51,23 @@ class SyncPointQueue {
   ///         self-promoted and returned) or Cancel() is called.
   std::shared_ptr<const CueEvent> GetNext(double hint_in_seconds);
 
+  /// Same as GetNext(), for a thread that may already be waiting at
+  /// @a hint_in_seconds after TryGetNext().
+  /// @param[in,out] waiting tells whether the thread is waiting. It is false
+  ///                on return.
+  std::shared_ptr<const CueEvent> GetNext(double hint_in_seconds,
+                                          bool* waiting);
+
+  /// Non-blocking version of GetNext(). If no cue after @a hint_in_seconds can
+  /// be returned yet, the thread is counted as waiting, so that the other
+  /// threads can self-promote the cue at the hint, and null is returned.
+  /// @param[in,out] waiting tells whether the thread is waiting. It is set to
+  ///                true if null is returned because no cue is available yet,
+  ///                false otherwise, i.e. if a cue is returned or if the queue
+  ///                is cancelled.
+  std::shared_ptr<const CueEvent> TryGetNext(double hint_in_seconds,
+                                             bool* waiting);
+
   /// Promote the first cue that is not greater than @a time_in_seconds. All
   /// unpromoted cues before the cue will be discarded.
   std::shared_ptr<const CueEvent> PromoteAt(double time_in_seconds);
@@ -52,6 +77,10 @@ class SyncPointQueue {
   ///         in undefined behavior.
   bool HasMore(double hint_in_seconds) const;
 
+  /// @return How far past the hint the threads may buffer samples, instead of
+  ///         blocking in GetNext(), while waiting for a cue to be promoted.
+  double horizon_in_seconds() const { return horizon_in_seconds_; }
+
  private:
   SyncPointQueue(const SyncPointQueue&) = delete;
   SyncPointQueue& operator=(const SyncPointQueue&) = delete;
@@ -60,11 +89,17 @@ class SyncPointQueue {
   // functions that have locks.
   std::shared_ptr<const CueEvent> PromoteAtNoLocking(double time_in_seconds);
 
+  // GetNext() and TryGetNext(), blocking if |block| is true.
+  std::shared_ptr<const CueEvent> GetNextInternal(double hint_in_seconds,
+                                                  bool block,
+                                                  bool* waiting);
+
   base::Lock lock_;
   base::ConditionVariable sync_condition_;
   size_t thread_count_ = 0;
   size_t waiting_thread_count_ = 0;
   bool cancelled_ = false;
+  const double horizon_in_seconds_ = 0;
 
   std::map<double, std::shared_ptr<CueEvent>> unpromoted_;
   std::map<double, std::shared_ptr<CueEvent>> promoted_;
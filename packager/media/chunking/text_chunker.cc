@@ -6,6 +6,8 @@
 
 #include "packager/media/chunking/text_chunker.h"
 
+#include <algorithm>
+
 #include "packager/status_macros.h"
 
 namespace shaka {
@@ -15,16 +17,22 @@ const size_t kStreamIndex = 0;
 }  // namespace
 
 TextChunker::TextChunker(double segment_duration_in_seconds)
-    : segment_duration_in_seconds_(segment_duration_in_seconds){};
+    : TextChunker(segment_duration_in_seconds, 0) {}
+
+TextChunker::TextChunker(double segment_duration_in_seconds,
+                         double max_empty_segment_duration_in_seconds)
+    : segment_duration_in_seconds_(segment_duration_in_seconds),
+      max_empty_segment_duration_in_seconds_(
+          max_empty_segment_duration_in_seconds) {}
 
 Status TextChunker::Process(std::unique_ptr<StreamData> data) {
   switch (data->stream_data_type) {
     case StreamDataType::kStreamInfo:
-      return OnStreamInfo(std::move(data->stream_info));
+      return OnStreamInfo(data->release_stream_info());
     case StreamDataType::kTextSample:
-      return OnTextSample(data->text_sample);
+      return OnTextSample(data->text_sample());
     case StreamDataType::kCueEvent:
-      return OnCueEvent(data->cue_event);
+      return OnCueEvent(data->cue_event());
     default:
       return Status(error::INTERNAL_ERROR,
                     "Invalid stream data type for this handler");
@@ -44,6 +52,8 @@ Status TextChunker::OnFlushRequest(size_t input_stream_index) {
 Status TextChunker::OnStreamInfo(std::shared_ptr<const StreamInfo> info) {
   time_scale_ = info->time_scale();
   segment_duration_ = ScaleTime(segment_duration_in_seconds_);
+  max_empty_segments_ = std::max<int64_t>(
+      ScaleTime(max_empty_segment_duration_in_seconds_) / segment_duration_, 1);
 
   return DispatchStreamInfo(kStreamIndex, std::move(info));
 }
@@ -61,7 +71,7 @@ Status TextChunker::OnCueEvent(std::shared_ptr<const CueEvent> event) {
 
   // Output all full segments before the segment that the cue event interupts.
   while (segment_start_ + segment_duration_ < event_time) {
-    RETURN_IF_ERROR(DispatchSegment(segment_duration_));
+    RETURN_IF_ERROR(DispatchSegment(NextSegmentDuration(event_time - 1)));
   }
 
   const int64_t shorten_duration = event_time - segment_start_;
@@ -87,7 +97,7 @@ Status TextChunker::OnTextSample(std::shared_ptr<const TextSample> sample) {
   // sample started.
   while (sample_start >= segment_start_ + segment_duration_) {
     // |DispatchSegment| will advance |segment_start_|.
-    RETURN_IF_ERROR(DispatchSegment(segment_duration_));
+    RETURN_IF_ERROR(DispatchSegment(NextSegmentDuration(sample_start)));
   }
 
   samples_in_current_segment_.push_back(std::move(sample));
@@ -125,6 +135,16 @@ Status TextChunker::DispatchSegment(int64_t duration) {
   return Status::OK;
 }
 
+int64_t TextChunker::NextSegmentDuration(int64_t end) const {
+  // The samples which are not in the list yet start at or after |end|, so the
+  // segments are empty up to |end| if there is no sample left in the list.
+  if (max_empty_segments_ <= 1 || !samples_in_current_segment_.empty())
+    return segment_duration_;
+  const int64_t num_segments = std::min(
+      (end - segment_start_) / segment_duration_, max_empty_segments_);
+  return std::max<int64_t>(num_segments, 1) * segment_duration_;
+}
+
 int64_t TextChunker::ScaleTime(double seconds) const {
   DCHECK_GT(time_scale_, 0) << "Need positive time scale to scale time.";
   return static_cast<int64_t>(seconds * time_scale_);
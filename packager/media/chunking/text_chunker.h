@@ -17,10 +17,16 @@ namespace media {
 // Media handler for taking a single stream of text samples and inserting
 // segment info based on a fixed segment duration and on cue events. The
 // only time a segment's duration will not match the fixed segment duration
-// is when a cue event is seen.
+// is when a cue event is seen, or when empty segments are coalesced.
 class TextChunker : public MediaHandler {
  public:
   explicit TextChunker(double segment_duration_in_seconds);
+  /// @param max_empty_segment_duration_in_seconds is the maximum duration of
+  ///        the segments covering periods with no samples. If positive,
+  ///        consecutive empty segments are coalesced into one segment of up
+  ///        to this duration, in multiples of the segment duration.
+  TextChunker(double segment_duration_in_seconds,
+              double max_empty_segment_duration_in_seconds);
 
  private:
   TextChunker(const TextChunker&) = delete;
@@ -42,15 +48,24 @@ class TextChunker : public MediaHandler {
   //       remove all samples that don't last into that segment.
   Status DispatchSegment(int64_t duration);
 
+  // Gets the duration of the next segment, which is to end at or before
+  // |end|. This is the segment duration, unless the segment is empty and
+  // empty segments are coalesced.
+  int64_t NextSegmentDuration(int64_t end) const;
+
   int64_t ScaleTime(double seconds) const;
 
   double segment_duration_in_seconds_;
+  double max_empty_segment_duration_in_seconds_;
 
   int64_t time_scale_ = -1;  // Set in OnStreamInfo
 
   // Time values are in scaled units.
   int64_t segment_start_ = -1;     // Set when the first sample comes in.
   int64_t segment_duration_ = -1;  // Set in OnStreamInfo.
+  // The maximum number of segments coalesced into an empty segment. Set in
+  // OnStreamInfo.
+  int64_t max_empty_segments_ = 1;
 
   // All samples that make up the current segment. We must store the samples
   // until the segment ends because a cue event may end the segment sooner
@@ -41,6 +41,13 @@ class TextChunkerTest : public MediaHandlerTestBase {
     return SetUpAndInitializeGraph(
         std::make_shared<TextChunker>(segment_duration), kInputs, kOutputs);
   }
+
+  Status Init(double segment_duration, double max_empty_segment_duration) {
+    return SetUpAndInitializeGraph(
+        std::make_shared<TextChunker>(segment_duration,
+                                      max_empty_segment_duration),
+        kInputs, kOutputs);
+  }
 };
 
 // Verify that the chunker will use the first sample's start time as the start
@@ -268,6 +275,72 @@ TEST_F(TextChunkerTest, OutputsEmptySegments) {
   ASSERT_OK(Input(kInput)->FlushAllDownstreams());
 }
 
+// Verify that empty segments are coalesced into segments of up to the
+// maximum empty segment duration, in multiples of the segment duration.
+//
+// Segment Duration = 100 MS
+// Max Empty Segment Duration = 300 MS
+//
+// TIME (ms):0     1     2     3     4     5     6
+//                 0     0     0     0     0     0
+//                 0     0     0     0     0     0
+// SAMPLES  :[-A-]                          [-B-]
+// SEGMENTS :      ^                 ^     ^     ^
+//
+TEST_F(TextChunkerTest, CoalescesEmptySegments) {
+  const double kSegmentDurationSec = 0.1;
+  const double kMaxEmptySegmentDurationSec = 0.3;
+  const int64_t kSegmentDurationMs = 100;
+
+  const int64_t kSampleAStart = 0;
+  const int64_t kSampleAEnd = 50;
+
+  const int64_t kSampleBStart = 550;
+  const int64_t kSampleBEnd = 600;
+
+  Init(kSegmentDurationSec, kMaxEmptySegmentDurationSec);
+
+  {
+    testing::InSequence s;
+
+    EXPECT_CALL(*Output(kOutput),
+                OnProcess(IsStreamInfo(kStreamIndex, _, _, _)));
+
+    EXPECT_CALL(*Output(kOutput),
+                OnProcess(IsTextSample(_, kNoId, kSampleAStart, kSampleAEnd)));
+    EXPECT_CALL(*Output(kOutput),
+                OnProcess(IsSegmentInfo(kStreamIndex, 0, kSegmentDurationMs,
+                                        !kSubSegment, !kEncrypted)));
+
+    // Empty segments, coalesced up to the maximum duration.
+    EXPECT_CALL(*Output(kOutput),
+                OnProcess(IsSegmentInfo(kStreamIndex, 100,
+                                        3 * kSegmentDurationMs, !kSubSegment,
+                                        !kEncrypted)));
+    EXPECT_CALL(*Output(kOutput),
+                OnProcess(IsSegmentInfo(kStreamIndex, 400, kSegmentDurationMs,
+                                        !kSubSegment, !kEncrypted)));
+
+    EXPECT_CALL(*Output(kOutput),
+                OnProcess(IsTextSample(_, kNoId, kSampleBStart, kSampleBEnd)));
+    EXPECT_CALL(*Output(kOutput),
+                OnProcess(IsSegmentInfo(kStreamIndex, 500, kSegmentDurationMs,
+                                        !kSubSegment, !kEncrypted)));
+
+    EXPECT_CALL(*Output(kOutput), OnFlush(kStreamIndex));
+  }
+
+  ASSERT_OK(Input(kInput)->Dispatch(StreamData::FromStreamInfo(
+      kStreamIndex, GetTextStreamInfo(kMsTimeScale))));
+  ASSERT_OK(Input(kInput)->Dispatch(StreamData::FromTextSample(
+      kStreamIndex,
+      GetTextSample(kNoId, kSampleAStart, kSampleAEnd, kNoPayload))));
+  ASSERT_OK(Input(kInput)->Dispatch(StreamData::FromTextSample(
+      kStreamIndex,
+      GetTextSample(kNoId, kSampleBStart, kSampleBEnd, kNoPayload))));
+  ASSERT_OK(Input(kInput)->FlushAllDownstreams());
+}
+
 // Verify that samples that overlap multiple samples get dispatch in all
 // segments.
 //
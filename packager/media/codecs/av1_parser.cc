@@ -280,13 +280,34 @@ bool AV1Parser::ParseOpenBitstreamUnit(BitReader* reader,
   VLOG(4) << "OBU " << obu_header.obu_type << " size " << obu_size;
 
   const size_t start_position = reader->bit_position();
+  // Whether the payload is skipped, including its trailing bits.
+  bool payload_skipped = false;
   switch (obu_header.obu_type) {
-    case OBU_SEQUENCE_HEADER:
-      RCHECK(ParseSequenceHeaderObu(reader));
+    case OBU_SEQUENCE_HEADER: {
+      // Sequence headers are usually repeated before every key frame. They are
+      // only parsed again if they change.
+      RCHECK(reader->bits_available() >= obu_size * 8);
+      const uint8_t* payload = reader->current_byte_ptr();
+      if (obu_size > 0 && sequence_header_obu_payload_.size() == obu_size &&
+          std::equal(payload, payload + obu_size,
+                     sequence_header_obu_payload_.begin())) {
+        RCHECK(reader->SkipBits(obu_size * 8));
+        payload_skipped = true;
+      } else {
+        RCHECK(ParseSequenceHeaderObu(reader));
+        sequence_header_obu_payload_.assign(payload, payload + obu_size);
+      }
       break;
+    }
     case OBU_FRAME_HEADER:
     case OBU_REDUNDENT_FRAME_HEADER:
-      RCHECK(ParseFrameHeaderObu(obu_header, reader));
+      if (frame_header_.seen_frame_header) {
+        // A copy of the frame header of the frame being decoded.
+        RCHECK(reader->SkipBits(obu_size * 8));
+        payload_skipped = true;
+      } else {
+        RCHECK(ParseFrameHeaderObu(obu_header, reader));
+      }
       break;
     case OBU_TILE_GROUP:
       RCHECK(ParseTileGroupObu(obu_size, reader, tiles));
@@ -297,13 +318,14 @@ bool AV1Parser::ParseOpenBitstreamUnit(BitReader* reader,
     default:
       // Skip all OBUs we are not interested.
       RCHECK(reader->SkipBits(obu_size * 8));
+      payload_skipped = true;
       break;
   }
 
   const size_t current_position = reader->bit_position();
   const size_t payload_bits = current_position - start_position;
   if (obu_header.obu_type == OBU_TILE_GROUP ||
-      obu_header.obu_type == OBU_FRAME) {
+      obu_header.obu_type == OBU_FRAME || payload_skipped) {
     RCHECK(payload_bits == obu_size * 8);
   } else if (obu_size > 0) {
     RCHECK(payload_bits <= obu_size * 8);
@@ -277,6 +277,8 @@ class AV1Parser {
   int GetQIndex(bool ignore_delta_q, int segment_id);
 
   SequenceHeaderObu sequence_header_;
+  // The payload |sequence_header_| is parsed from.
+  std::vector<uint8_t> sequence_header_obu_payload_;
   FrameHeaderObu frame_header_;
   static constexpr int kNumRefFrames = 8;
   ReferenceFrame reference_frames_[kNumRefFrames];
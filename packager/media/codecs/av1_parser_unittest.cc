@@ -30,5 +30,29 @@ TEST(AV1ParserTest, ParseIFrameSuccess) {
   EXPECT_THAT(tiles, ElementsAre(AV1Parser::Tile{0x1d, 0x4e1}));
 }
 
+TEST(AV1ParserTest, ParseRepeatedSequenceHeaderSuccess) {
+  const std::vector<uint8_t> buffer = ReadTestDataFile("av1-I-frame-320x240");
+
+  // The unchanged sequence header of the second frame is not parsed again.
+  AV1Parser parser;
+  std::vector<AV1Parser::Tile> tiles;
+  ASSERT_TRUE(parser.Parse(buffer.data(), buffer.size(), &tiles));
+  ASSERT_TRUE(parser.Parse(buffer.data(), buffer.size(), &tiles));
+  EXPECT_THAT(tiles, ElementsAre(AV1Parser::Tile{0x1d, 0x4e1}));
+}
+
+TEST(AV1ParserTest, SkipMetadataObu) {
+  // OBU_METADATA with obu_has_size_field, a two-byte payload and trailing
+  // bits.
+  std::vector<uint8_t> buffer = {0x2a, 0x02, 0x01, 0x80};
+  const std::vector<uint8_t> frame = ReadTestDataFile("av1-I-frame-320x240");
+  buffer.insert(buffer.end(), frame.begin(), frame.end());
+
+  AV1Parser parser;
+  std::vector<AV1Parser::Tile> tiles;
+  ASSERT_TRUE(parser.Parse(buffer.data(), buffer.size(), &tiles));
+  EXPECT_THAT(tiles, ElementsAre(AV1Parser::Tile{0x1d + 4, 0x4e1}));
+}
+
 }  // namespace media
 }  // namespace shaka
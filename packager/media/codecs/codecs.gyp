@@ -31,6 +31,8 @@
         'ec3_audio_util.h',
         'ac4_audio_util.cc',
         'ac4_audio_util.h',
+        'emulation_prevention.cc',
+        'emulation_prevention.h',
         'es_descriptor.cc',
         'es_descriptor.h',
         'h264_byte_to_unit_stream_converter.cc',
@@ -80,6 +82,7 @@
         'dovi_decoder_configuration_record_unittest.cc',
         'ec3_audio_util_unittest.cc',
         'ac4_audio_util_unittest.cc',
+        'emulation_prevention_unittest.cc',
         'es_descriptor_unittest.cc',
         'h264_byte_to_unit_stream_converter_unittest.cc',
         'h264_parser_unittest.cc',
@@ -103,5 +106,21 @@
         'codecs',
       ],
     },
+    {
+      # Not part of codecs_unittest, as the benchmarks take a while and their
+      # results are only meaningful in release builds.
+      'target_name': 'codecs_benchmarks',
+      'type': '<(gtest_target_type)',
+      'sources': [
+        'codecs_benchmarks.cc',
+      ],
+      'dependencies': [
+        '../../base/base.gyp:base',
+        '../../testing/gtest.gyp:gtest',
+        '../../testing/perf/perf_test.gyp:perf_test',
+        '../test/media_test.gyp:media_test_support',
+        'codecs',
+      ],
+    },
   ],
 }
@@ -0,0 +1,132 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Benchmarks of the codec parsers run on every encrypted frame to generate its
+// subsamples, and of the bit readers they are built on. The results are
+// reported in the format of testing/perf/perf_test.h, so they can be compared
+// across versions.
+//
+// Run from the packager repository root, e.g.
+//   out/Release/codecs_benchmarks --gtest_filter=CodecsBenchmark.*
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/base/time/time.h"
+#include "packager/media/base/bit_reader.h"
+#include "packager/media/codecs/av1_parser.h"
+#include "packager/media/codecs/h26x_bit_reader.h"
+#include "packager/media/test/test_data_util.h"
+#include "packager/testing/perf/perf_test.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const int kIterations = 100000;
+
+void PrintResults(const std::string& trace,
+                  size_t frame_size,
+                  base::TimeDelta total_time) {
+  const double seconds = total_time.InSecondsF();
+  perf_test::PrintResult("frame_time", "", trace,
+                         total_time.InMicrosecondsF() / kIterations, "us",
+                         true);
+  perf_test::PrintResult(
+      "throughput", "", trace,
+      seconds > 0 ? frame_size * kIterations / seconds / (1 << 20) : 0.0,
+      "MB/s", true);
+}
+
+// A slice header sized buffer of pseudo random bits.
+std::vector<uint8_t> MakeBitstream() {
+  std::vector<uint8_t> data(64);
+  uint32_t state = 1;
+  for (uint8_t& byte : data) {
+    state = state * 1103515245 + 12345;
+    byte = static_cast<uint8_t>(state >> 16);
+  }
+  return data;
+}
+
+}  // namespace
+
+// A key frame with its sequence header parsed as part of a stream, i.e. with
+// the sequence header state kept from the previous key frame.
+TEST(CodecsBenchmark, AV1KeyFrames) {
+  const std::vector<uint8_t> frame = ReadTestDataFile("av1-I-frame-320x240");
+  ASSERT_FALSE(frame.empty());
+
+  AV1Parser parser;
+  std::vector<AV1Parser::Tile> tiles;
+  const base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < kIterations; ++i)
+    ASSERT_TRUE(parser.Parse(frame.data(), frame.size(), &tiles));
+  PrintResults("AV1KeyFrames", frame.size(), base::TimeTicks::Now() - start);
+}
+
+// The same key frame parsed by a new parser every time.
+TEST(CodecsBenchmark, AV1KeyFramesWithoutState) {
+  const std::vector<uint8_t> frame = ReadTestDataFile("av1-I-frame-320x240");
+  ASSERT_FALSE(frame.empty());
+
+  std::vector<AV1Parser::Tile> tiles;
+  const base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < kIterations; ++i) {
+    AV1Parser parser;
+    ASSERT_TRUE(parser.Parse(frame.data(), frame.size(), &tiles));
+  }
+  PrintResults("AV1KeyFramesWithoutState", frame.size(),
+               base::TimeTicks::Now() - start);
+}
+
+// The fixed width fields read by all the codec parsers, e.g. AV1 OBU and
+// VP9 frame headers.
+TEST(CodecsBenchmark, BitReaderFields) {
+  const std::vector<uint8_t> data = MakeBitstream();
+  const size_t kFieldSizes[] = {1, 2, 3, 4, 5, 8, 12, 16, 32};
+
+  uint64_t sum = 0;
+  const base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < kIterations; ++i) {
+    BitReader reader(data.data(), data.size());
+    uint64_t value = 0;
+    for (size_t field = 0; reader.bits_available() > 0; ++field) {
+      const size_t field_size =
+          std::min(kFieldSizes[field % arraysize(kFieldSizes)],
+                   reader.bits_available());
+      ASSERT_TRUE(reader.ReadBits(field_size, &value));
+      sum += value;
+    }
+  }
+  PrintResults("BitReaderFields", data.size(), base::TimeTicks::Now() - start);
+  EXPECT_NE(0u, sum);
+}
+
+// The Exp-Golomb codes of H.264 and H.265 slice headers.
+TEST(CodecsBenchmark, H26xExpGolombCodes) {
+  const std::vector<uint8_t> data = MakeBitstream();
+
+  int64_t sum = 0;
+  const base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < kIterations; ++i) {
+    H26xBitReader reader;
+    ASSERT_TRUE(reader.Initialize(data.data(), data.size()));
+    int value = 0;
+    while (reader.NumBitsLeft() > 32 && reader.ReadUE(&value))
+      sum += value;
+  }
+  PrintResults("H26xExpGolombCodes", data.size(),
+               base::TimeTicks::Now() - start);
+  EXPECT_NE(0, sum);
+}
+
+}  // namespace media
+}  // namespace shaka
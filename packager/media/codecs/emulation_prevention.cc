@@ -0,0 +1,121 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/codecs/emulation_prevention.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+// Number of zero byte pair candidates checked per iteration by the vectorized
+// scan. A vector iteration reads up to two bytes past the block to check the
+// third byte of the last candidates.
+const uint64_t kScanBlockSize = 16;
+
+const uint8_t kEmulationPreventionByte = 0x03;
+
+inline bool InRange(uint8_t byte, uint8_t min_byte, uint8_t max_byte) {
+  return static_cast<uint8_t>(byte - min_byte) <= max_byte - min_byte;
+}
+
+inline bool IsZeroZeroSequence(const uint8_t* data,
+                               uint8_t min_third_byte,
+                               uint8_t max_third_byte) {
+  return data[0] == 0x00 && data[1] == 0x00 &&
+         InRange(data[2], min_third_byte, max_third_byte);
+}
+
+}  // namespace
+
+uint64_t FindZeroZeroSequence(const uint8_t* data,
+                              uint64_t data_size,
+                              uint8_t min_third_byte,
+                              uint8_t max_third_byte) {
+  DCHECK_LE(min_third_byte, max_third_byte);
+  uint64_t pos = 0;
+
+#if defined(__SSE2__)
+  // Zero byte pairs are rare in compressed data, so 16 positions are usually
+  // rejected at once.
+  const __m128i zero = _mm_setzero_si128();
+  while (data_size - pos >= kScanBlockSize + 2) {
+    const __m128i current =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+    const __m128i next =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 1));
+    const int candidates = _mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(current, zero), _mm_cmpeq_epi8(next, zero)));
+    if (candidates != 0) {
+      for (uint64_t i = 0; i < kScanBlockSize; ++i) {
+        if ((candidates & (1 << i)) &&
+            InRange(data[pos + i + 2], min_third_byte, max_third_byte)) {
+          return pos + i;
+        }
+      }
+    }
+    pos += kScanBlockSize;
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  // See above.
+  const uint8x16_t zero = vdupq_n_u8(0);
+  while (data_size - pos >= kScanBlockSize + 2) {
+    const uint8x16_t candidates =
+        vandq_u8(vceqq_u8(vld1q_u8(data + pos), zero),
+                 vceqq_u8(vld1q_u8(data + pos + 1), zero));
+    if (vmaxvq_u8(candidates) != 0) {
+      for (uint64_t i = 0; i < kScanBlockSize; ++i) {
+        if (IsZeroZeroSequence(data + pos + i, min_third_byte, max_third_byte))
+          return pos + i;
+      }
+    }
+    pos += kScanBlockSize;
+  }
+#endif
+
+  // Portable scan. A non-zero third byte rules out the next two positions as
+  // well, so up to three bytes are skipped at a time.
+  while (pos + 2 < data_size) {
+    if (IsZeroZeroSequence(data + pos, min_third_byte, max_third_byte))
+      return pos;
+    pos += data[pos + 2] != 0x00 ? 3 : 1;
+  }
+  return data_size;
+}
+
+void RemoveEmulationPreventionBytes(
+    const uint8_t* data,
+    uint64_t data_size,
+    std::vector<uint8_t>* rbsp,
+    std::vector<uint64_t>* removed_byte_positions) {
+  DCHECK(rbsp);
+
+  uint64_t pos = 0;
+  while (pos < data_size) {
+    const uint64_t offset =
+        FindZeroZeroSequence(data + pos, data_size - pos,
+                             kEmulationPreventionByte, kEmulationPreventionByte);
+    if (offset == data_size - pos)
+      break;
+    // Copy up to and including the two zero bytes and drop the 0x03.
+    rbsp->insert(rbsp->end(), data + pos, data + pos + offset + 2);
+    if (removed_byte_positions)
+      removed_byte_positions->push_back(rbsp->size());
+    pos += offset + 3;
+  }
+  rbsp->insert(rbsp->end(), data + pos, data + data_size);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,43 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_CODECS_EMULATION_PREVENTION_H_
+#define PACKAGER_MEDIA_CODECS_EMULATION_PREVENTION_H_
+
+#include <stdint.h>
+#include <vector>
+
+namespace shaka {
+namespace media {
+
+/// Finds the first three-byte sequence 0x00 0x00 0xXX in |data|, with 0xXX in
+/// [@a min_third_byte, @a max_third_byte]. Zero byte pairs are located 16
+/// bytes at a time where SIMD instructions are available.
+/// @return the offset of the sequence, or @a data_size if there is none.
+uint64_t FindZeroZeroSequence(const uint8_t* data,
+                              uint64_t data_size,
+                              uint8_t min_third_byte,
+                              uint8_t max_third_byte);
+
+/// Removes the emulation prevention bytes, i.e. the 0x03 in 0x00 0x00 0x03, in
+/// (a part of) a NAL unit. The part must not end inside a 0x00 0x00 0x03
+/// sequence, which is the case if it does not end with a zero byte.
+/// @param data is the escaped data.
+/// @param data_size is the size of @a data.
+/// @param[out] rbsp gets the unescaped data appended.
+/// @param[out] removed_byte_positions, if not null, gets the offsets in
+///             @a rbsp at which the emulation prevention bytes were removed
+///             appended, in ascending order.
+void RemoveEmulationPreventionBytes(
+    const uint8_t* data,
+    uint64_t data_size,
+    std::vector<uint8_t>* rbsp,
+    std::vector<uint64_t>* removed_byte_positions);
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_CODECS_EMULATION_PREVENTION_H_
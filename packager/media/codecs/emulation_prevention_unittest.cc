@@ -0,0 +1,102 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/media/codecs/emulation_prevention.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+// Reference implementation checking every byte.
+uint64_t FindZeroZeroSequenceByteByByte(const uint8_t* data,
+                                        uint64_t data_size,
+                                        uint8_t min_third_byte,
+                                        uint8_t max_third_byte) {
+  for (uint64_t i = 0; i + 2 < data_size; ++i) {
+    if (data[i] == 0x00 && data[i + 1] == 0x00 &&
+        data[i + 2] >= min_third_byte && data[i + 2] <= max_third_byte) {
+      return i;
+    }
+  }
+  return data_size;
+}
+}  // namespace
+
+TEST(EmulationPreventionTest, FindZeroZeroSequenceAtEveryOffset) {
+  // Long enough to go through the vectorized scan and the portable scan, with
+  // zero bytes that do not form a sequence.
+  const uint8_t kPattern[] = {0x00, 0x00, 0x04, 0x80, 0x00, 0xff, 0x00, 0x05};
+  const uint64_t kDataSize = 70;
+  std::vector<uint8_t> data(kDataSize);
+  for (uint64_t i = 0; i < kDataSize; ++i)
+    data[i] = kPattern[i % arraysize(kPattern)];
+
+  for (uint64_t data_size = 0; data_size <= kDataSize; ++data_size)
+    EXPECT_EQ(data_size, FindZeroZeroSequence(data.data(), data_size, 0, 3));
+
+  for (uint64_t sequence_offset = 0; sequence_offset + 3 <= kDataSize;
+       ++sequence_offset) {
+    std::vector<uint8_t> data_with_sequence = data;
+    data_with_sequence[sequence_offset] = 0x00;
+    data_with_sequence[sequence_offset + 1] = 0x00;
+    data_with_sequence[sequence_offset + 2] = 0x03;
+
+    for (uint8_t max_third_byte = 0; max_third_byte <= 3; ++max_third_byte) {
+      for (uint8_t min_third_byte = 0; min_third_byte <= max_third_byte;
+           ++min_third_byte) {
+        EXPECT_EQ(FindZeroZeroSequenceByteByByte(data_with_sequence.data(),
+                                                 kDataSize, min_third_byte,
+                                                 max_third_byte),
+                  FindZeroZeroSequence(data_with_sequence.data(), kDataSize,
+                                       min_third_byte, max_third_byte))
+            << "sequence at " << sequence_offset << " range ["
+            << static_cast<int>(min_third_byte) << ", "
+            << static_cast<int>(max_third_byte) << "]";
+      }
+    }
+  }
+}
+
+TEST(EmulationPreventionTest, RemoveEmulationPreventionBytes) {
+  const uint8_t kEscaped[] = {
+      0x01, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x01, 0x00,
+      0x00, 0x00, 0x03, 0x02, 0x00, 0x00, 0x03, 0x03, 0x00,
+  };
+  const uint8_t kUnescaped[] = {
+      0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+      0x00, 0x00, 0x02, 0x00, 0x00, 0x03, 0x00,
+  };
+  const uint64_t kRemovedBytePositions[] = {4, 6, 10, 13};
+
+  std::vector<uint8_t> rbsp = {0xaa};
+  std::vector<uint64_t> removed_byte_positions;
+  RemoveEmulationPreventionBytes(kEscaped, arraysize(kEscaped), &rbsp,
+                                 &removed_byte_positions);
+
+  std::vector<uint8_t> expected_rbsp = {0xaa};
+  expected_rbsp.insert(expected_rbsp.end(), std::begin(kUnescaped),
+                       std::end(kUnescaped));
+  EXPECT_EQ(expected_rbsp, rbsp);
+  EXPECT_EQ(std::vector<uint64_t>(std::begin(kRemovedBytePositions),
+                                  std::end(kRemovedBytePositions)),
+            removed_byte_positions);
+}
+
+TEST(EmulationPreventionTest, RemoveEmulationPreventionBytesNothingToRemove) {
+  const uint8_t kData[] = {0x00, 0x00, 0x01, 0x00, 0x00, 0x04, 0x03};
+
+  std::vector<uint8_t> rbsp;
+  RemoveEmulationPreventionBytes(kData, arraysize(kData), &rbsp, nullptr);
+  EXPECT_EQ(std::vector<uint8_t>(std::begin(kData), std::end(kData)), rbsp);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -63,6 +63,85 @@ TEST(H264ByteToUnitStreamConverter, KeepParameterSetsNalu) {
   EXPECT_EQ(expected_output_frame, output_frame);
 }
 
+TEST(H264ByteToUnitStreamConverter, ConvertInPlace) {
+  std::vector<uint8_t> frame = ReadTestDataFile("avc-byte-stream-frame.h264");
+  ASSERT_FALSE(frame.empty());
+
+  std::vector<uint8_t> expected_output_frame =
+      ReadTestDataFile("avc3-unit-stream-frame.h264");
+  ASSERT_FALSE(expected_output_frame.empty());
+
+  H264ByteToUnitStreamConverter converter(
+      H26xStreamFormat::kNalUnitStreamWithParameterSetNalus);
+  ASSERT_TRUE(converter.ConvertByteStreamToNalUnitStream(&frame));
+  EXPECT_EQ(expected_output_frame, frame);
+}
+
+TEST(H264ByteToUnitStreamConverter, ConvertInPlaceStripParameterSetsNalu) {
+  std::vector<uint8_t> frame = ReadTestDataFile("avc-byte-stream-frame.h264");
+  ASSERT_FALSE(frame.empty());
+
+  std::vector<uint8_t> expected_output_frame =
+      ReadTestDataFile("avc1-unit-stream-frame.h264");
+  ASSERT_FALSE(expected_output_frame.empty());
+
+  H264ByteToUnitStreamConverter converter(
+      H26xStreamFormat::kNalUnitStreamWithoutParameterSetNalus);
+  ASSERT_TRUE(converter.ConvertByteStreamToNalUnitStream(&frame));
+  EXPECT_EQ(expected_output_frame, frame);
+}
+
+TEST(H264ByteToUnitStreamConverter, ConvertInPlaceWithThreeByteStartCodes) {
+  const uint8_t kByteStream[] = {
+      0x00, 0x00, 0x01,  // Start code
+      0x06, 0xAA, 0xBB,
+      0x00, 0x00, 0x01,  // Start code
+      0x06, 0xCC,
+  };
+  const uint8_t kExpectedUnitStream[] = {
+      0x00, 0x00, 0x00, 0x03, 0x06, 0xAA, 0xBB,
+      0x00, 0x00, 0x00, 0x02, 0x06, 0xCC,
+  };
+  std::vector<uint8_t> frame(std::begin(kByteStream), std::end(kByteStream));
+
+  H264ByteToUnitStreamConverter converter(
+      H26xStreamFormat::kNalUnitStreamWithParameterSetNalus);
+  ASSERT_TRUE(converter.ConvertByteStreamToNalUnitStream(&frame));
+  EXPECT_EQ(std::vector<uint8_t>(std::begin(kExpectedUnitStream),
+                                 std::end(kExpectedUnitStream)),
+            frame);
+
+  std::vector<uint8_t> empty_frame;
+  EXPECT_FALSE(converter.ConvertByteStreamToNalUnitStream(&empty_frame));
+}
+
+TEST(H264ByteToUnitStreamConverter, ConvertNalus) {
+  std::vector<uint8_t> input_frame =
+      ReadTestDataFile("avc-byte-stream-frame.h264");
+  ASSERT_FALSE(input_frame.empty());
+
+  std::vector<uint8_t> expected_output_frame =
+      ReadTestDataFile("avc1-unit-stream-frame.h264");
+  ASSERT_FALSE(expected_output_frame.empty());
+
+  std::vector<Nalu> nalus;
+  NaluReader reader(Nalu::kH264, kIsAnnexbByteStream, input_frame.data(),
+                    input_frame.size());
+  Nalu nalu;
+  while (reader.Advance(&nalu) == NaluReader::kOk)
+    nalus.push_back(nalu);
+
+  H264ByteToUnitStreamConverter converter(
+      H26xStreamFormat::kNalUnitStreamWithoutParameterSetNalus);
+  std::vector<uint8_t> output_frame;
+  ASSERT_TRUE(converter.ConvertNalusToNalUnitStream(nalus, input_frame.size(),
+                                                    &output_frame));
+  EXPECT_EQ(expected_output_frame, output_frame);
+
+  EXPECT_FALSE(converter.ConvertNalusToNalUnitStream(
+      std::vector<Nalu>(), input_frame.size(), &output_frame));
+}
+
 TEST(H264ByteToUnitStreamConverter, ConversionFailure) {
   std::vector<uint8_t> input_frame(100, 0);
 
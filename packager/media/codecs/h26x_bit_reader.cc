@@ -5,10 +5,30 @@
 #include "packager/base/logging.h"
 #include "packager/media/codecs/h26x_bit_reader.h"
 
+#include <algorithm>
+
+#include "packager/media/codecs/emulation_prevention.h"
+
 namespace shaka {
 namespace media {
 namespace {
 
+// Number of escaped bytes unescaped at a time, which covers most slice
+// headers.
+const off_t kUnescapeWindowSize = 64;
+
+// Returns the number of leading zero bits of |value|, which is not 0.
+int CountLeadingZeros(uint32_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_clz(value);
+#else
+  int count = 0;
+  for (; (value & 0x80000000u) == 0; value <<= 1)
+    ++count;
+  return count;
+#endif
+}
+
 // Check if any bits in the least significant |valid_bits| are set to 1.
 bool CheckAnyBitsSet(int byte, int valid_bits) {
   return (byte & ((1 << valid_bits) - 1)) != 0;
@@ -17,12 +37,11 @@ bool CheckAnyBitsSet(int byte, int valid_bits) {
 }  // namespace
 
 H26xBitReader::H26xBitReader()
-    : data_(NULL),
-      bytes_left_(0),
+    : escaped_data_(NULL),
+      escaped_bytes_left_(0),
+      rbsp_pos_(0),
       curr_byte_(0),
-      num_remaining_bits_in_curr_byte_(0),
-      prev_two_bytes_(0),
-      emulation_prevention_bytes_(0) {}
+      num_remaining_bits_in_curr_byte_(0) {}
 
 H26xBitReader::~H26xBitReader() {}
 
@@ -32,41 +51,44 @@ bool H26xBitReader::Initialize(const uint8_t* data, off_t size) {
   if (size < 1)
     return false;
 
-  data_ = data;
-  bytes_left_ = size;
+  escaped_data_ = data;
+  escaped_bytes_left_ = size;
+  rbsp_.clear();
+  rbsp_pos_ = 0;
+  emulation_prevention_byte_positions_.clear();
   num_remaining_bits_in_curr_byte_ = 0;
-  // Initially set to 0xffff to accept all initial two-byte sequences.
-  prev_two_bytes_ = 0xffff;
-  emulation_prevention_bytes_ = 0;
 
   return true;
 }
 
 bool H26xBitReader::UpdateCurrByte() {
-  if (bytes_left_ < 1)
+  if (rbsp_pos_ == rbsp_.size() && !UnescapeNextWindow())
     return false;
 
-  // Emulation prevention three-byte detection.
-  // If a sequence of 0x000003 is found, skip (ignore) the last byte (0x03).
-  if (*data_ == 0x03 && (prev_two_bytes_ & 0xffff) == 0) {
-    // Detected 0x000003, skip last byte.
-    ++data_;
-    --bytes_left_;
-    ++emulation_prevention_bytes_;
-    // Need another full three bytes before we can detect the sequence again.
-    prev_two_bytes_ = 0xffff;
-
-    if (bytes_left_ < 1)
-      return false;
-  }
-
   // Load a new byte and advance pointers.
-  curr_byte_ = *data_++ & 0xff;
-  --bytes_left_;
+  curr_byte_ = rbsp_[rbsp_pos_++];
   num_remaining_bits_in_curr_byte_ = 8;
 
-  prev_two_bytes_ = (prev_two_bytes_ << 8) | curr_byte_;
+  return true;
+}
+
+bool H26xBitReader::UnescapeNextWindow() {
+  if (escaped_bytes_left_ < 1)
+    return false;
 
+  off_t window_size = std::min(escaped_bytes_left_, kUnescapeWindowSize);
+  // An emulation prevention three-byte sequence (0x000003) can only be split
+  // by a window ending with a zero byte.
+  while (window_size < escaped_bytes_left_ &&
+         escaped_data_[window_size - 1] == 0x00) {
+    ++window_size;
+  }
+  // The first two bytes of a window are never removed, so the window adds at
+  // least one byte to rbsp_.
+  RemoveEmulationPreventionBytes(escaped_data_, window_size, &rbsp_,
+                                 &emulation_prevention_byte_positions_);
+  escaped_data_ += window_size;
+  escaped_bytes_left_ -= window_size;
   return true;
 }
 
@@ -107,16 +129,23 @@ bool H26xBitReader::SkipBits(int num_bits) {
 }
 
 bool H26xBitReader::ReadUE(int* val) {
-  int num_bits = -1;
-  int bit;
+  int num_bits = 0;
   int rest;
 
-  // Count the number of contiguous zero bits.
-  do {
-    if (!ReadBits(1, &bit))
+  // Count the number of contiguous zero bits, skipping zero bytes at once and
+  // counting the leading zeros of the byte with the first one bit.
+  int bits = curr_byte_ & ((1 << num_remaining_bits_in_curr_byte_) - 1);
+  while (bits == 0) {
+    num_bits += num_remaining_bits_in_curr_byte_;
+    if (num_bits > 31 || !UpdateCurrByte())
       return false;
-    num_bits++;
-  } while (bit == 0);
+    bits = curr_byte_;
+  }
+  const int leading_zeros =
+      CountLeadingZeros(bits) - (32 - num_remaining_bits_in_curr_byte_);
+  num_bits += leading_zeros;
+  // The zeros and the one bit are consumed.
+  num_remaining_bits_in_curr_byte_ -= leading_zeros + 1;
 
   if (num_bits > 31)
     return false;
@@ -149,7 +178,15 @@ bool H26xBitReader::ReadSE(int* val) {
 }
 
 off_t H26xBitReader::NumBitsLeft() {
-  return (num_remaining_bits_in_curr_byte_ + bytes_left_ * 8);
+  // Count the emulation prevention bytes not read yet, so the result is in
+  // terms of the escaped stream.
+  const off_t emulation_prevention_bytes_left =
+      emulation_prevention_byte_positions_.size() -
+      NumEmulationPreventionBytesBeforeNextByte();
+  const off_t bytes_left = (rbsp_.size() - rbsp_pos_) +
+                           emulation_prevention_bytes_left +
+                           escaped_bytes_left_;
+  return (num_remaining_bits_in_curr_byte_ + bytes_left * 8);
 }
 
 bool H26xBitReader::HasMoreRBSPData() {
@@ -166,20 +203,29 @@ bool H26xBitReader::HasMoreRBSPData() {
     return true;
 
   // While the spec disallows it (7.4.1: "The last byte of the NAL unit shall
-  // not be equal to 0x00"), some streams have trailing null bytes anyway. We
-  // don't handle emulation prevention sequences because HasMoreRBSPData() is
-  // not used when parsing slices (where cabac_zero_word elements are legal).
-  for (off_t i = 0; i < bytes_left_; i++) {
-    if (data_[i] != 0)
+  // not be equal to 0x00"), some streams have trailing null bytes anyway.
+  // HasMoreRBSPData() is not used when parsing slices, so unescaping the rest
+  // of the stream is cheap.
+  while (UnescapeNextWindow()) {
+  }
+  for (size_t i = rbsp_pos_; i < rbsp_.size(); i++) {
+    if (rbsp_[i] != 0)
       return true;
   }
 
-  bytes_left_ = 0;
+  rbsp_pos_ = rbsp_.size();
   return false;
 }
 
 size_t H26xBitReader::NumEmulationPreventionBytesRead() {
-  return emulation_prevention_bytes_;
+  return NumEmulationPreventionBytesBeforeNextByte();
+}
+
+size_t H26xBitReader::NumEmulationPreventionBytesBeforeNextByte() const {
+  return std::lower_bound(emulation_prevention_byte_positions_.begin(),
+                          emulation_prevention_byte_positions_.end(),
+                          static_cast<uint64_t>(rbsp_pos_)) -
+         emulation_prevention_byte_positions_.begin();
 }
 
 }  // namespace media
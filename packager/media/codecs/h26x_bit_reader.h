@@ -10,6 +10,8 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <vector>
+
 #include "packager/base/macros.h"
 
 namespace shaka {
@@ -19,6 +21,9 @@ namespace media {
 // This is not a generic bit reader class, as it takes into account
 // H.264 stream-specific constraints, such as skipping emulation-prevention
 // bytes and stop bits. See spec for more details.
+// Emulation prevention bytes are removed in bulk as the stream is read, a
+// small window at a time, so parsing a slice header does not unescape the
+// whole slice. Sizes and positions are still in terms of the escaped stream.
 class H26xBitReader {
  public:
   H26xBitReader();
@@ -72,11 +77,29 @@ class H26xBitReader {
   // Return false on end of stream.
   bool UpdateCurrByte();
 
-  // Pointer to the next unread (not in curr_byte_) byte in the stream.
-  const uint8_t* data_;
+  // Unescape the next window of the escaped stream into rbsp_.
+  // Return false if the whole stream has been unescaped already.
+  bool UnescapeNextWindow();
+
+  // Return the number of emulation prevention bytes removed before the next
+  // unread byte.
+  size_t NumEmulationPreventionBytesBeforeNextByte() const;
+
+  // Pointer to the escaped stream not unescaped yet.
+  const uint8_t* escaped_data_;
+
+  // Bytes left in the escaped stream not unescaped yet.
+  off_t escaped_bytes_left_;
 
-  // Bytes left in the stream (without the curr_byte_).
-  off_t bytes_left_;
+  // The unescaped stream so far.
+  std::vector<uint8_t> rbsp_;
+
+  // Position of the next unread (not in curr_byte_) byte in rbsp_.
+  size_t rbsp_pos_;
+
+  // Offsets in rbsp_ at which emulation prevention bytes (0x000003) were
+  // removed, in ascending order.
+  std::vector<uint64_t> emulation_prevention_byte_positions_;
 
   // Contents of the current byte; first unread bit starting at position
   // 8 - num_remaining_bits_in_curr_byte_ from MSB.
@@ -85,13 +108,6 @@ class H26xBitReader {
   // Number of bits remaining in curr_byte_
   int num_remaining_bits_in_curr_byte_;
 
-  // Used in emulation prevention three byte detection (see spec).
-  // Initially set to 0xffff to accept all initial two-byte sequences.
-  int prev_two_bytes_;
-
-  // Number of emulation preventation bytes (0x000003) we met.
-  size_t emulation_prevention_bytes_;
-
   DISALLOW_COPY_AND_ASSIGN(H26xBitReader);
 };
 
@@ -4,6 +4,8 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "packager/media/codecs/h26x_bit_reader.h"
 
 namespace shaka {
@@ -130,5 +132,40 @@ TEST(H26xBitReaderTest, StopBitOccupyFullByte) {
   EXPECT_FALSE(reader.HasMoreRBSPData());
 }
 
+TEST(H26xBitReaderTest, EmulationPreventionBytes) {
+  H26xBitReader reader;
+  // Long enough for the emulation prevention bytes to be removed in more than
+  // one window, with a sequence crossing the end of the first window.
+  std::vector<uint8_t> rbsp(70, 0x11);
+  rbsp[1] = rbsp[2] = 0x00;
+  rbsp[3] = 0x03;
+  rbsp[62] = rbsp[63] = rbsp[64] = rbsp[65] = 0x00;
+  rbsp[66] = 0x03;
+  rbsp[67] = 0x01;
+  int dummy = 0;
+
+  EXPECT_TRUE(reader.Initialize(rbsp.data(), rbsp.size()));
+  EXPECT_EQ(reader.NumBitsLeft(), 70 * 8);
+
+  EXPECT_TRUE(reader.ReadBits(24, &dummy));
+  EXPECT_EQ(dummy, 0x110000);
+  EXPECT_EQ(reader.NumEmulationPreventionBytesRead(), 0u);
+  EXPECT_EQ(reader.NumBitsLeft(), 67 * 8);
+  EXPECT_TRUE(reader.ReadBits(8, &dummy));
+  EXPECT_EQ(dummy, 0x11);
+  EXPECT_EQ(reader.NumEmulationPreventionBytesRead(), 1u);
+  EXPECT_EQ(reader.NumBitsLeft(), 65 * 8);
+
+  // Read up to the zero bytes at 62.
+  EXPECT_TRUE(reader.SkipBits((62 - 5) * 8));
+  EXPECT_TRUE(reader.ReadBits(24, &dummy));
+  EXPECT_EQ(dummy, 0x000000);
+  EXPECT_TRUE(reader.ReadBits(16, &dummy));
+  EXPECT_EQ(dummy, 0x0001);
+  EXPECT_EQ(reader.NumEmulationPreventionBytesRead(), 2u);
+  EXPECT_EQ(reader.NumBitsLeft(), 2 * 8);
+  EXPECT_TRUE(reader.HasMoreRBSPData());
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -63,22 +63,107 @@ bool H26xByteToUnitStreamConverter::ConvertByteStreamToNalUnitStream(
     return false;
   }
 
-  while (reader.Advance(&nalu) == NaluReader::kOk) {
-    const uint64_t nalu_size = nalu.payload_size() + nalu.header_size();
-    DCHECK_LE(nalu_size, std::numeric_limits<uint32_t>::max());
+  while (reader.Advance(&nalu) == NaluReader::kOk)
+    AppendNalu(nalu, &output_buffer);
+
+  output_buffer.SwapBuffer(output_frame);
+  return true;
+}
+
+bool H26xByteToUnitStreamConverter::ConvertByteStreamToNalUnitStream(
+    std::vector<uint8_t>* frame) {
+  DCHECK(frame);
+
+  NaluReader reader(type_, kIsAnnexbByteStream, frame->data(), frame->size());
+  if (!reader.StartsWithStartCode()) {
+    LOG(ERROR) << "H.26x byte stream frame did not begin with start code.";
+    return false;
+  }
 
+  // The NAL units are collected first, as they are overwritten by the
+  // conversion. Each kept NAL unit can be converted in place if it does not
+  // start before the end of the previous one plus its 4-byte length.
+  std::vector<Nalu> nalus;
+  bool in_place = true;
+  size_t output_size = 0;
+  Nalu nalu;
+  while (reader.Advance(&nalu) == NaluReader::kOk) {
     if (ProcessNalu(nalu))
       continue;
+    const size_t nalu_offset = nalu.data() - frame->data();
+    output_size += kUnitStreamNaluLengthSize;
+    if (nalu_offset < output_size)
+      in_place = false;
+    output_size += nalu.payload_size() + nalu.header_size();
+    nalus.push_back(nalu);
+  }
 
-    // Append 4-byte length and NAL unit data to the buffer.
-    output_buffer.AppendInt(static_cast<uint32_t>(nalu_size));
-    output_buffer.AppendArray(nalu.data(), nalu_size);
+  if (!in_place) {
+    BufferWriter output_buffer(output_size);
+    for (const Nalu& kept_nalu : nalus)
+      AppendNaluData(kept_nalu, &output_buffer);
+    output_buffer.SwapBuffer(frame);
+    return true;
   }
 
+  uint8_t* output = frame->data();
+  for (const Nalu& kept_nalu : nalus) {
+    const uint64_t nalu_size =
+        kept_nalu.payload_size() + kept_nalu.header_size();
+    DCHECK_LE(nalu_size, std::numeric_limits<uint32_t>::max());
+    output[0] = static_cast<uint8_t>(nalu_size >> 24);
+    output[1] = static_cast<uint8_t>(nalu_size >> 16);
+    output[2] = static_cast<uint8_t>(nalu_size >> 8);
+    output[3] = static_cast<uint8_t>(nalu_size);
+    output += kUnitStreamNaluLengthSize;
+    // The NAL unit may overlap its new location.
+    if (output != kept_nalu.data())
+      memmove(output, kept_nalu.data(), nalu_size);
+    output += nalu_size;
+  }
+  frame->resize(output - frame->data());
+  return true;
+}
+
+bool H26xByteToUnitStreamConverter::ConvertNalusToNalUnitStream(
+    const std::vector<Nalu>& nalus,
+    size_t input_frame_size,
+    std::vector<uint8_t>* output_frame) {
+  DCHECK(output_frame);
+  if (nalus.empty()) {
+    LOG(ERROR) << "H.26x byte stream frame has no NAL unit.";
+    return false;
+  }
+
+  BufferWriter output_buffer(0);
+  output_frame->clear();
+  output_buffer.SwapBuffer(output_frame);
+  output_buffer.Reserve(input_frame_size + kStreamConversionOverhead);
+  for (const Nalu& nalu : nalus)
+    AppendNalu(nalu, &output_buffer);
+
   output_buffer.SwapBuffer(output_frame);
   return true;
 }
 
+void H26xByteToUnitStreamConverter::AppendNalu(const Nalu& nalu,
+                                               BufferWriter* output_buffer) {
+  if (ProcessNalu(nalu))
+    return;
+  AppendNaluData(nalu, output_buffer);
+}
+
+void H26xByteToUnitStreamConverter::AppendNaluData(
+    const Nalu& nalu,
+    BufferWriter* output_buffer) {
+  const uint64_t nalu_size = nalu.payload_size() + nalu.header_size();
+  DCHECK_LE(nalu_size, std::numeric_limits<uint32_t>::max());
+
+  // Append 4-byte length and NAL unit data to the buffer.
+  output_buffer->AppendInt(static_cast<uint32_t>(nalu_size));
+  output_buffer->AppendArray(nalu.data(), nalu_size);
+}
+
 void H26xByteToUnitStreamConverter::WarnIfNotMatch(
     int nalu_type,
     const uint8_t* nalu_ptr,
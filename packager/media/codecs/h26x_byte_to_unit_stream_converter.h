@@ -47,6 +47,31 @@ class H26xByteToUnitStreamConverter {
                                         size_t input_frame_size,
                                         std::vector<uint8_t>* output_frame);
 
+  /// Converts a whole byte stream encoded video frame to NAL unit stream
+  /// format in place. The start codes are overwritten with the NAL unit
+  /// lengths, and the NAL units moved back over those removed, so that the
+  /// buffer is reused; it is copied only if a 3-byte start code leaves no room
+  /// for a length.
+  /// @param frame is a buffer containing a whole H.26x frame in byte stream
+  ///        format, which receives the converted frame.
+  /// @return true if successful, false otherwise.
+  bool ConvertByteStreamToNalUnitStream(std::vector<uint8_t>* frame);
+
+  /// Converts a whole byte stream encoded video frame to NAL unit stream
+  /// format, given its NAL units. Unlike ConvertByteStreamToNalUnitStream, the
+  /// frame is not searched for start codes, e.g. if the caller has already
+  /// found them to locate the frame.
+  /// @param nalus are the NAL units of the frame, in order.
+  /// @param input_frame_size is the size of the H.26x frame in byte stream
+  ///        format, in bytes.
+  /// @param output_frame is a pointer to a vector which will receive the
+  ///        converted frame. Its capacity is reused, e.g. for a recycled
+  ///        buffer.
+  /// @return true if successful, false otherwise.
+  bool ConvertNalusToNalUnitStream(const std::vector<Nalu>& nalus,
+                                   size_t input_frame_size,
+                                   std::vector<uint8_t>* output_frame);
+
   /// Creates either an AVCDecoderConfigurationRecord or a
   /// HEVCDecoderConfigurationRecord from the units extracted from the byte
   /// stream.
@@ -75,6 +100,12 @@ class H26xByteToUnitStreamConverter {
   // not be copied to the buffer.
   virtual bool ProcessNalu(const Nalu& nalu) = 0;
 
+  // Appends |nalu| to |output_buffer| with a 4-byte length, unless it is
+  // handled by ProcessNalu.
+  void AppendNalu(const Nalu& nalu, BufferWriter* output_buffer);
+  // Appends |nalu| to |output_buffer| with a 4-byte length.
+  void AppendNaluData(const Nalu& nalu, BufferWriter* output_buffer);
+
   Nalu::CodecType type_;
   H26xStreamFormat stream_format_;
 
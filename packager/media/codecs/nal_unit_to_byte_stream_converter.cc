@@ -13,6 +13,7 @@
 #include "packager/media/base/buffer_reader.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/macros.h"
+#include "packager/media/codecs/emulation_prevention.h"
 #include "packager/media/codecs/nalu_reader.h"
 
 namespace shaka {
@@ -61,38 +62,27 @@ void AddAccessUnitDelimiter(BufferWriter* buffer_writer) {
 void EscapeNalByteSequence(const uint8_t* input,
                            size_t input_size,
                            BufferWriter* output_writer) {
-  // Keep track of consecutive zeros that it has seen (not including the current
-  // byte), so that the algorithm doesn't need to go back to check the same
-  // bytes.
-  int consecutive_zero_count = 0;
-  for (size_t i = 0; i < input_size; ++i) {
-    if (consecutive_zero_count <= 1) {
-      output_writer->AppendInt(input[i]);
-    } else if (consecutive_zero_count == 2) {
-      if (input[i] == 0 || input[i] == 1 || input[i] == 2 || input[i] == 3) {
-        // Must be escaped.
-        output_writer->AppendInt(kEmulationPreventionByte);
-      }
-
-      output_writer->AppendInt(input[i]);
-      // Note that input[i] can be 0.
-      // 00 00 00 00 00 00 should become
-      // 00 00 03 00 00 03 00 00 03
-      // So consecutive_zero_count is reset here and incremented below if
-      // input[i] is 0.
-      consecutive_zero_count = 0;
-    }
-
-    consecutive_zero_count = input[i] == 0 ? consecutive_zero_count + 1 : 0;
+  // Copy the runs between the sequences that must be escaped, i.e.
+  // 0x00 0x00 0x0{0,1,2,3}, in bulk and insert the emulation prevention byte
+  // before their third byte. The third byte may start the next sequence:
+  // 00 00 00 00 00 00 should become
+  // 00 00 03 00 00 03 00 00 03
+  size_t pos = 0;
+  while (pos < input_size) {
+    const size_t offset =
+        FindZeroZeroSequence(input + pos, input_size - pos, 0x00, 0x03);
+    if (offset == input_size - pos)
+      break;
+    output_writer->AppendArray(input + pos, offset + 2);
+    output_writer->AppendInt(kEmulationPreventionByte);
+    pos += offset + 2;
   }
+  output_writer->AppendArray(input + pos, input_size - pos);
 
   // ISO 14496-10 Section 7.4.1.1 mentions that if the last byte is 0 (which
   // only happens if RBSP has cabac_zero_word), 0x03 must be appended.
-  if (consecutive_zero_count > 0) {
-    DCHECK_GT(input_size, 0u);
-    DCHECK_EQ(input[input_size - 1], 0u);
+  if (input_size > 0 && input[input_size - 1] == 0x00)
     output_writer->AppendInt(kEmulationPreventionByte);
-  }
 }
 
 // This functions creates a new subsample entry (|clear_bytes|, |cipher_bytes|)
@@ -283,7 +273,11 @@ bool NalUnitToByteStreamConverter::ConvertUnitToByteStreamWithSubsamples(
 
   std::vector<SubsampleEntry> temp_subsamples;
 
-  BufferWriter buffer_writer(sample_size);
+  // Write to the memory of |output| so that it can be reused by the caller.
+  output->clear();
+  output->reserve(sample_size);
+  BufferWriter buffer_writer;
+  buffer_writer.SwapBuffer(output);
   buffer_writer.AppendArray(kNaluStartCode, arraysize(kNaluStartCode));
   AddAccessUnitDelimiter(&buffer_writer);
   if (is_key_frame)
@@ -6,10 +6,12 @@
 
 #include "packager/media/codecs/nalu_reader.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include "packager/base/logging.h"
 #include "packager/media/base/buffer_reader.h"
+#include "packager/media/codecs/emulation_prevention.h"
 #include "packager/media/codecs/h264_parser.h"
 
 namespace shaka {
@@ -20,6 +22,12 @@ inline bool IsStartCode(const uint8_t* data) {
   return data[0] == 0x00 && data[1] == 0x00 && data[2] == 0x01;
 }
 
+// Returns the offset of the first three-byte start code in |data|, or
+// |data_size| if there is none.
+uint64_t FindThreeByteStartCode(const uint8_t* data, uint64_t data_size) {
+  return FindZeroZeroSequence(data, data_size, 0x01, 0x01);
+}
+
 // Edits |subsamples| given the number of consumed bytes.
 void UpdateSubsamples(uint64_t consumed_bytes,
                       std::vector<SubsampleEntry>* subsamples) {
@@ -313,33 +321,26 @@ bool NaluReader::FindStartCode(const uint8_t* data,
                                uint64_t data_size,
                                uint64_t* offset,
                                uint8_t* start_code_size) {
-  uint64_t bytes_left = data_size;
-
-  while (bytes_left >= 3) {
-    if (IsStartCode(data)) {
-      // Found three-byte start code, set pointer at its beginning.
-      *offset = data_size - bytes_left;
-      *start_code_size = 3;
-
-      // If there is a zero byte before this start code,
-      // then it's actually a four-byte start code, so backtrack one byte.
-      if (*offset > 0 && *(data - 1) == 0x00) {
-        --(*offset);
-        ++(*start_code_size);
-      }
+  const uint64_t start_code_offset = FindThreeByteStartCode(data, data_size);
+  if (start_code_offset == data_size) {
+    // End of data: offset is pointing to the first byte that was not
+    // considered as a possible start of a start code.
+    *offset = std::max<uint64_t>(data_size, 2) - 2;
+    *start_code_size = 0;
+    return false;
+  }
 
-      return true;
-    }
+  // Found three-byte start code, set pointer at its beginning.
+  *offset = start_code_offset;
+  *start_code_size = 3;
 
-    ++data;
-    --bytes_left;
+  // If there is a zero byte before this start code,
+  // then it's actually a four-byte start code, so backtrack one byte.
+  if (*offset > 0 && data[*offset - 1] == 0x00) {
+    --(*offset);
+    ++(*start_code_size);
   }
-
-  // End of data: offset is pointing to the first byte that was not considered
-  // as a possible start of a start code.
-  *offset = data_size - bytes_left;
-  *start_code_size = 0;
-  return false;
+  return true;
 }
 
 // static
@@ -6,11 +6,33 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "packager/media/codecs/nalu_reader.h"
 
 namespace shaka {
 namespace media {
 
+namespace {
+// Reference implementation checking every byte.
+bool FindStartCodeByteByByte(const uint8_t* data,
+                             uint64_t data_size,
+                             uint64_t* offset,
+                             uint8_t* start_code_size) {
+  for (uint64_t i = 0; i + 2 < data_size; ++i) {
+    if (data[i] == 0x00 && data[i + 1] == 0x00 && data[i + 2] == 0x01) {
+      const bool four_bytes = i > 0 && data[i - 1] == 0x00;
+      *offset = four_bytes ? i - 1 : i;
+      *start_code_size = four_bytes ? 4 : 3;
+      return true;
+    }
+  }
+  *offset = data_size < 3 ? 0 : data_size - 2;
+  *start_code_size = 0;
+  return false;
+}
+}  // namespace
+
 TEST(NaluReaderTest, StartCodeSearch) {
   const uint8_t kNaluData[] = {
       0x01, 0x00, 0x00, 0x04, 0x23, 0x56,
@@ -41,6 +63,52 @@ TEST(NaluReaderTest, StartCodeSearch) {
   EXPECT_EQ(NaluReader::kEOStream, reader.Advance(&nalu));
 }
 
+TEST(NaluReaderTest, FindStartCodeAtEveryOffset) {
+  // Long enough to go through the vectorized scan and the portable scan, with
+  // zero bytes that are not start codes.
+  const uint8_t kPattern[] = {0x00, 0x00, 0x02, 0x80, 0x00, 0xff, 0x00};
+  const uint64_t kDataSize = 70;
+  std::vector<uint8_t> data(kDataSize);
+  for (uint64_t i = 0; i < kDataSize; ++i)
+    data[i] = kPattern[i % arraysize(kPattern)];
+
+  for (uint64_t data_size = 0; data_size <= kDataSize; ++data_size) {
+    uint64_t offset = 0;
+    uint8_t start_code_size = 0;
+    uint64_t expected_offset = 0;
+    uint8_t expected_start_code_size = 0;
+    ASSERT_FALSE(FindStartCodeByteByByte(data.data(), data_size,
+                                         &expected_offset,
+                                         &expected_start_code_size));
+    EXPECT_FALSE(NaluReader::FindStartCode(data.data(), data_size, &offset,
+                                           &start_code_size));
+    EXPECT_EQ(expected_offset, offset);
+    EXPECT_EQ(0u, start_code_size);
+  }
+
+  for (uint64_t start_code_offset = 0; start_code_offset + 3 <= kDataSize;
+       ++start_code_offset) {
+    std::vector<uint8_t> data_with_start_code = data;
+    data_with_start_code[start_code_offset] = 0x00;
+    data_with_start_code[start_code_offset + 1] = 0x00;
+    data_with_start_code[start_code_offset + 2] = 0x01;
+
+    uint64_t offset = 0;
+    uint8_t start_code_size = 0;
+    uint64_t expected_offset = 0;
+    uint8_t expected_start_code_size = 0;
+    ASSERT_TRUE(FindStartCodeByteByByte(
+        data_with_start_code.data(), kDataSize, &expected_offset,
+        &expected_start_code_size));
+    EXPECT_TRUE(NaluReader::FindStartCode(data_with_start_code.data(),
+                                          kDataSize, &offset,
+                                          &start_code_size));
+    EXPECT_EQ(expected_offset, offset) << "start code at "
+                                       << start_code_offset;
+    EXPECT_EQ(expected_start_code_size, start_code_size);
+  }
+}
+
 TEST(NaluReaderTest, StartCodeSearchWithStartCodeInsideNalUnit) {
   const uint8_t kNaluData[] = {
       0x01, 0x00, 0x00, 0x04, 0x23, 0x56,
@@ -6,6 +6,8 @@
 
 #include "packager/media/codecs/video_slice_header_parser.h"
 
+#include <string.h>
+
 #include "packager/media/base/rcheck.h"
 #include "packager/media/codecs/avc_decoder_configuration_record.h"
 #include "packager/media/codecs/hevc_decoder_configuration_record.h"
@@ -20,6 +22,17 @@ size_t NumBitsToNumBytes(size_t size_in_bits) {
   return (size_in_bits + 7) >> 3;
 }
 
+bool IsSameNalu(const Nalu& nalu, const std::vector<uint8_t>& other_nalu) {
+  const size_t nalu_size = nalu.header_size() + nalu.payload_size();
+  return other_nalu.size() == nalu_size &&
+         memcmp(nalu.data(), other_nalu.data(), nalu_size) == 0;
+}
+
+void CopyNalu(const Nalu& nalu, std::vector<uint8_t>* nalu_copy) {
+  nalu_copy->assign(nalu.data(),
+                    nalu.data() + nalu.header_size() + nalu.payload_size());
+}
+
 }  // namespace
 
 H264VideoSliceHeaderParser::H264VideoSliceHeaderParser() {}
@@ -35,8 +48,10 @@ bool H264VideoSliceHeaderParser::Initialize(
     const Nalu& nalu = config.nalu(i);
     if (nalu.type() == Nalu::H264_SPS) {
       RCHECK(parser_.ParseSps(nalu, &id) == H264Parser::kOk);
+      CopyNalu(nalu, &last_sps_);
     } else if (nalu.type() == Nalu::H264_PPS) {
       RCHECK(parser_.ParsePps(nalu, &id) == H264Parser::kOk);
+      CopyNalu(nalu, &last_pps_);
     }
   }
 
@@ -47,9 +62,22 @@ bool H264VideoSliceHeaderParser::ProcessNalu(const Nalu& nalu) {
   int id;
   switch (nalu.type()) {
     case Nalu::H264_SPS:
-      return parser_.ParseSps(nalu, &id) == H264Parser::kOk;
+      // Parsing the same parameter set again does not change the state.
+      if (IsSameNalu(nalu, last_sps_))
+        return true;
+      if (parser_.ParseSps(nalu, &id) != H264Parser::kOk)
+        return false;
+      CopyNalu(nalu, &last_sps_);
+      // Parsing a PPS depends on the SPS it refers to.
+      last_pps_.clear();
+      return true;
     case Nalu::H264_PPS:
-      return parser_.ParsePps(nalu, &id) == H264Parser::kOk;
+      if (IsSameNalu(nalu, last_pps_))
+        return true;
+      if (parser_.ParsePps(nalu, &id) != H264Parser::kOk)
+        return false;
+      CopyNalu(nalu, &last_pps_);
+      return true;
     default:
       return true;
   }
@@ -77,8 +105,10 @@ bool H265VideoSliceHeaderParser::Initialize(
     const Nalu& nalu = hevc_config.nalu(i);
     if (nalu.type() == Nalu::H265_SPS) {
       RCHECK(parser_.ParseSps(nalu, &id) == H265Parser::kOk);
+      CopyNalu(nalu, &last_sps_);
     } else if (nalu.type() == Nalu::H265_PPS) {
       RCHECK(parser_.ParsePps(nalu, &id) == H265Parser::kOk);
+      CopyNalu(nalu, &last_pps_);
     } else if (nalu.type() == Nalu::H265_VPS) {
       // Ignore since it does not affect video slice header parsing.
     } else {
@@ -94,9 +124,22 @@ bool H265VideoSliceHeaderParser::ProcessNalu(const Nalu& nalu) {
   int id;
   switch (nalu.type()) {
     case Nalu::H265_SPS:
-      return parser_.ParseSps(nalu, &id) == H265Parser::kOk;
+      // Parsing the same parameter set again does not change the state.
+      if (IsSameNalu(nalu, last_sps_))
+        return true;
+      if (parser_.ParseSps(nalu, &id) != H265Parser::kOk)
+        return false;
+      CopyNalu(nalu, &last_sps_);
+      // Parsing a PPS depends on the SPS it refers to.
+      last_pps_.clear();
+      return true;
     case Nalu::H265_PPS:
-      return parser_.ParsePps(nalu, &id) == H265Parser::kOk;
+      if (IsSameNalu(nalu, last_pps_))
+        return true;
+      if (parser_.ParsePps(nalu, &id) != H265Parser::kOk)
+        return false;
+      CopyNalu(nalu, &last_pps_);
+      return true;
     case Nalu::H265_VPS:
       // Ignore since it does not affect video slice header parsing.
       return true;
@@ -55,6 +55,10 @@ class H264VideoSliceHeaderParser : public VideoSliceHeaderParser {
 
  private:
   H264Parser parser_;
+  // The last parsed parameter sets. Streams usually repeat the same parameter
+  // sets in every key frame, which do not need to be parsed again.
+  std::vector<uint8_t> last_sps_;
+  std::vector<uint8_t> last_pps_;
 
   DISALLOW_COPY_AND_ASSIGN(H264VideoSliceHeaderParser);
 };
@@ -73,6 +77,10 @@ class H265VideoSliceHeaderParser : public VideoSliceHeaderParser {
 
  private:
   H265Parser parser_;
+  // The last parsed parameter sets. Streams usually repeat the same parameter
+  // sets in every key frame, which do not need to be parsed again.
+  std::vector<uint8_t> last_sps_;
+  std::vector<uint8_t> last_pps_;
 
   DISALLOW_COPY_AND_ASSIGN(H265VideoSliceHeaderParser);
 };
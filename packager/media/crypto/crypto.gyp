@@ -43,6 +43,23 @@
         'crypto',
       ]
     },
+    {
+      # Not part of crypto_unittest, as the benchmarks take a while and their
+      # results are only meaningful in release builds.
+      'target_name': 'crypto_benchmarks',
+      'type': '<(gtest_target_type)',
+      'sources': [
+        'crypto_benchmarks.cc',
+      ],
+      'dependencies': [
+        '../../base/base.gyp:base',
+        '../../testing/gtest.gyp:gtest',
+        '../../testing/perf/perf_test.gyp:perf_test',
+        '../base/media_base.gyp:media_base',
+        '../test/media_test.gyp:media_test_support',
+        'crypto',
+      ]
+    },
   ],
 }
 
@@ -0,0 +1,283 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Benchmarks of the encryption throughput of each protection scheme, for the
+// encryptors alone and for EncryptionHandler end-to-end. The results are
+// reported in the format of testing/perf/perf_test.h, so they can be compared
+// across versions and devices.
+//
+// Run from the packager repository root, e.g.
+//   out/Release/crypto_benchmarks --gtest_filter=CryptoBenchmark.*
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/time/time.h"
+#include "packager/media/base/aes_cryptor.h"
+#include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/fourccs.h"
+#include "packager/media/base/media_handler.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/raw_key_source.h"
+#include "packager/media/crypto/aes_encryptor_factory.h"
+#include "packager/media/crypto/encryption_handler.h"
+#include "packager/testing/perf/perf_test.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// Bytes encrypted per measurement, whatever the sample size.
+const size_t kBytesPerMeasurement = 64 << 20;
+const size_t kSampleSizes[] = {1 << 10, 16 << 10, 256 << 10};
+// The subsample layout has a subsample of this size, with
+// kSubsampleClearBytes clear bytes, in every kSubsampleSize bytes.
+const size_t kSubsampleSize = 4096;
+const size_t kSubsampleClearBytes = 64;
+// E-AC3 syncframes of 1536 bytes, i.e. frmsiz of 767.
+const size_t kEac3SyncframeSize = 1536;
+
+const uint8_t kKeyId[] = {
+    0xe5, 0x00, 0x7e, 0x6e, 0x9d, 0xcd, 0x5a, 0xc0,
+    0x95, 0x20, 0x2e, 0xd3, 0x75, 0x83, 0x82, 0xcd,
+};
+const uint8_t kKey[] = {
+    0x6f, 0xc9, 0x6f, 0xe6, 0x28, 0xa2, 0x65, 0xb1,
+    0x3a, 0xed, 0xde, 0xc0, 0xbc, 0x42, 0x1f, 0x4d,
+};
+const uint8_t kIv[] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+};
+// AAC-LC, 44.1 kHz, stereo.
+const uint8_t kAacCodecConfig[] = {0x12, 0x10};
+
+struct Scheme {
+  const char* name;
+  FourCC protection_scheme;
+  uint8_t crypt_byte_block;
+  uint8_t skip_byte_block;
+  Codec codec;
+};
+
+const Scheme kSchemes[] = {
+    {"cenc", FOURCC_cenc, 0, 0, kCodecH264},
+    {"cens", FOURCC_cens, 1, 9, kCodecH264},
+    {"cbc1", FOURCC_cbc1, 0, 0, kCodecH264},
+    {"cbcs", FOURCC_cbcs, 1, 9, kCodecH264},
+    {"sample-aes", kAppleSampleAesProtectionScheme, 1, 9, kCodecH264},
+    {"sample-aes-eac3", kAppleSampleAesProtectionScheme, 0, 0, kCodecEAC3},
+};
+
+void PrintThroughput(const std::string& measurement,
+                     const std::string& trace,
+                     size_t bytes,
+                     base::TimeDelta time) {
+  const double seconds = time.InSecondsF();
+  perf_test::PrintResult(measurement, "", trace,
+                         seconds > 0 ? bytes / seconds / (1 << 20) : 0.0,
+                         "MB/s", true);
+}
+
+// Returns a sample of |sample_size| bytes. E-AC3 samples are made of whole
+// syncframes instead, as SampleAesEc3Cryptor needs to parse them.
+std::vector<uint8_t> MakeSample(Codec codec, size_t sample_size) {
+  if (codec == kCodecEAC3) {
+    sample_size =
+        std::max<size_t>(sample_size / kEac3SyncframeSize, 1) *
+        kEac3SyncframeSize;
+  }
+  std::vector<uint8_t> sample(sample_size);
+  for (size_t i = 0; i < sample_size; ++i)
+    sample[i] = static_cast<uint8_t>(i * 31 + 7);
+  if (codec == kCodecEAC3) {
+    const uint16_t frmsiz = kEac3SyncframeSize / 2 - 1;
+    for (size_t i = 0; i < sample_size; i += kEac3SyncframeSize) {
+      sample[i] = 0x0B;
+      sample[i + 1] = 0x77;
+      sample[i + 2] = static_cast<uint8_t>(frmsiz >> 8);
+      sample[i + 3] = static_cast<uint8_t>(frmsiz);
+    }
+  }
+  return sample;
+}
+
+// Encrypts |sample| into |encrypted|, with a subsample every kSubsampleSize
+// bytes if |use_subsamples| is true.
+bool EncryptSample(const std::vector<uint8_t>& sample,
+                   bool use_subsamples,
+                   AesCryptor* encryptor,
+                   std::vector<uint8_t>* encrypted) {
+  if (!use_subsamples)
+    return encryptor->Crypt(sample.data(), sample.size(), encrypted->data());
+  for (size_t offset = 0; offset < sample.size(); offset += kSubsampleSize) {
+    const size_t subsample_size =
+        std::min(kSubsampleSize, sample.size() - offset);
+    const size_t clear_bytes = std::min(kSubsampleClearBytes, subsample_size);
+    memcpy(encrypted->data() + offset, sample.data() + offset, clear_bytes);
+    if (!encryptor->Crypt(sample.data() + offset + clear_bytes,
+                          subsample_size - clear_bytes,
+                          encrypted->data() + offset + clear_bytes)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Pushes stream data to the handlers downstream.
+class BenchmarkSource : public MediaHandler {
+ public:
+  Status Push(std::unique_ptr<StreamData> stream_data) {
+    return Dispatch(std::move(stream_data));
+  }
+
+ protected:
+  Status InitializeInternal() override { return Status::OK; }
+  Status Process(std::unique_ptr<StreamData> stream_data) override {
+    return Status(error::INTERNAL_ERROR, "The source has no input.");
+  }
+  // The source has a single output and no input.
+  bool ValidateOutputStreamIndex(size_t stream_index) const override {
+    return stream_index == 0;
+  }
+};
+
+// Drops the stream data, counting the media samples.
+class BenchmarkSink : public MediaHandler {
+ public:
+  size_t num_samples() const { return num_samples_; }
+
+ protected:
+  Status InitializeInternal() override { return Status::OK; }
+  Status Process(std::unique_ptr<StreamData> stream_data) override {
+    if (stream_data->stream_data_type == StreamDataType::kMediaSample)
+      ++num_samples_;
+    return Status::OK;
+  }
+
+ private:
+  size_t num_samples_ = 0;
+};
+
+}  // namespace
+
+class CryptoBenchmark : public ::testing::Test {
+ protected:
+  std::vector<uint8_t> key() const {
+    return std::vector<uint8_t>(std::begin(kKey), std::end(kKey));
+  }
+  std::vector<uint8_t> iv() const {
+    return std::vector<uint8_t>(std::begin(kIv), std::end(kIv));
+  }
+};
+
+// AesCtrEncryptor, AesCbcEncryptor, AesPatternCryptor and SampleAesEc3Cryptor,
+// as created by EncryptionHandler for each scheme.
+TEST_F(CryptoBenchmark, Encryptors) {
+  for (const Scheme& scheme : kSchemes) {
+    for (size_t sample_size : kSampleSizes) {
+      // Subsamples do not apply to the E-AC3 syncframes.
+      for (bool use_subsamples : {false, true}) {
+        if (use_subsamples && scheme.codec == kCodecEAC3)
+          continue;
+        const std::vector<uint8_t> sample =
+            MakeSample(scheme.codec, sample_size);
+        std::vector<uint8_t> encrypted(sample.size());
+        std::unique_ptr<AesCryptor> encryptor =
+            AesEncryptorFactory().CreateEncryptor(
+                scheme.protection_scheme, scheme.crypt_byte_block,
+                scheme.skip_byte_block, scheme.codec, key(), iv());
+        ASSERT_TRUE(encryptor) << scheme.name;
+
+        const size_t num_samples =
+            std::max<size_t>(kBytesPerMeasurement / sample.size(), 1);
+        const base::TimeTicks start = base::TimeTicks::Now();
+        for (size_t i = 0; i < num_samples; ++i) {
+          ASSERT_TRUE(EncryptSample(sample, use_subsamples, encryptor.get(),
+                                    &encrypted))
+              << scheme.name;
+          encryptor->UpdateIv();
+        }
+        PrintThroughput(
+            "encryptor_throughput",
+            base::StringPrintf("%s_%zuKB_%s", scheme.name, sample_size >> 10,
+                               use_subsamples ? "subsamples" : "full"),
+            num_samples * sample.size(), base::TimeTicks::Now() - start);
+      }
+    }
+  }
+}
+
+// EncryptionHandler end-to-end on an AAC stream, including the sample copies
+// and the subsample generation.
+TEST_F(CryptoBenchmark, EncryptionHandler) {
+  for (const Scheme& scheme : kSchemes) {
+    if (scheme.codec != kCodecH264)
+      continue;
+    for (size_t sample_size : kSampleSizes) {
+      RawKeyParams raw_key;
+      raw_key.key_map[""].key_id.assign(std::begin(kKeyId), std::end(kKeyId));
+      raw_key.key_map[""].key = key();
+      raw_key.key_map[""].iv = iv();
+      std::unique_ptr<RawKeySource> key_source = RawKeySource::Create(raw_key);
+      ASSERT_TRUE(key_source);
+
+      EncryptionParams encryption_params;
+      encryption_params.protection_scheme = scheme.protection_scheme;
+      encryption_params.stream_label_func =
+          [](const EncryptionParams::EncryptedStreamAttributes&) {
+            return std::string();
+          };
+
+      std::shared_ptr<BenchmarkSource> source(new BenchmarkSource);
+      std::shared_ptr<EncryptionHandler> encryption_handler(
+          new EncryptionHandler(encryption_params, key_source.get()));
+      std::shared_ptr<BenchmarkSink> sink(new BenchmarkSink);
+      ASSERT_TRUE(source->AddHandler(encryption_handler).ok());
+      ASSERT_TRUE(encryption_handler->AddHandler(sink).ok());
+      ASSERT_TRUE(source->Initialize().ok());
+
+      const uint32_t kTimeScale = 44100;
+      std::shared_ptr<StreamInfo> stream_info(new AudioStreamInfo(
+          0, kTimeScale, 0, kCodecAAC, "mp4a.40.2", kAacCodecConfig,
+          sizeof(kAacCodecConfig), 16, 2, kTimeScale, 0, 0, 0, 0, "und",
+          false));
+      ASSERT_TRUE(
+          source->Push(StreamData::FromStreamInfo(0, stream_info)).ok())
+          << scheme.name;
+
+      const std::vector<uint8_t> sample = MakeSample(kCodecAAC, sample_size);
+      const size_t num_samples =
+          std::max<size_t>(kBytesPerMeasurement / sample.size(), 1);
+      const base::TimeTicks start = base::TimeTicks::Now();
+      for (size_t i = 0; i < num_samples; ++i) {
+        std::shared_ptr<MediaSample> media_sample =
+            MediaSample::CopyFrom(sample.data(), sample.size(), true);
+        media_sample->set_dts(i * 1024);
+        media_sample->set_pts(i * 1024);
+        media_sample->set_duration(1024);
+        ASSERT_TRUE(
+            source->Push(StreamData::FromMediaSample(0, media_sample)).ok())
+            << scheme.name;
+      }
+      const base::TimeDelta time = base::TimeTicks::Now() - start;
+      ASSERT_EQ(num_samples, sink->num_samples());
+      PrintThroughput(
+          "handler_throughput",
+          base::StringPrintf("%s_%zuKB", scheme.name, sample_size >> 10),
+          num_samples * sample.size(), time);
+    }
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
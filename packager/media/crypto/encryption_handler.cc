@@ -10,10 +10,20 @@
 #include <stdint.h>
 
 #include <algorithm>
-
+#include <deque>
+#include <map>
+
+#include "packager/base/bind.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/threading/simple_thread.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/base/trace_event/trace_event.h"
 #include "packager/media/base/aes_encryptor.h"
 #include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/common_pssh_generator.h"
+#include "packager/media/base/decryptor_source.h"
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/macros.h"
 #include "packager/media/base/media_sample.h"
@@ -44,6 +54,10 @@ const uint8_t kKeyRotationDefaultIv[] = {
     0, 0, 0, 0, 0, 0, 0, 0,
 };
 
+// Maximum number of samples being encrypted per encryption thread before the
+// handler blocks waiting for the oldest sample to be encrypted.
+const size_t kMaxPendingSamplesPerThread = 4;
+
 std::string GetStreamLabelForEncryption(
     const StreamInfo& stream_info,
     const std::function<std::string(
@@ -122,13 +136,9 @@ void AddProtectionSystemIfNotExist(
   encryption_config->key_system_info.push_back(pssh_info);
 }
 
-Status FillProtectionSystemInfo(const EncryptionParams& encryption_params,
-                                const EncryptionKey& encryption_key,
-                                EncryptionConfig* encryption_config) {
-  // If generating dummy keys for key rotation, don't generate PSSH info.
-  if (encryption_key.key_ids.empty())
-    return Status::OK;
-
+Status GenerateProtectionSystemInfo(const EncryptionParams& encryption_params,
+                                    const EncryptionKey& encryption_key,
+                                    EncryptionConfig* encryption_config) {
   std::vector<std::unique_ptr<PsshGenerator>> pssh_generators;
   std::vector<std::vector<uint8_t>> no_pssh_systems;
   FillPsshGenerators(encryption_params, &pssh_generators, &no_pssh_systems);
@@ -158,8 +168,248 @@ Status FillProtectionSystemInfo(const EncryptionParams& encryption_params,
   return Status::OK;
 }
 
+// Caches the protection system info generated for the keys of a crypto
+// period. All the streams encrypted with the same keys get the same PSSH
+// boxes, and with key rotation they would otherwise all generate them at the
+// same time, at every crypto period boundary.
+class ProtectionSystemInfoCache {
+ public:
+  static ProtectionSystemInfoCache* GetInstance() {
+    // Intentionally leaked, as it may be used by handlers until exit.
+    static ProtectionSystemInfoCache* cache = new ProtectionSystemInfoCache;
+    return cache;
+  }
+
+  Status Fill(const EncryptionParams& encryption_params,
+              const EncryptionKey& encryption_key,
+              EncryptionConfig* encryption_config) {
+    const std::string cache_key =
+        GetCacheKey(encryption_params, encryption_key);
+    // The info is generated with the lock held, so other streams wait for it
+    // instead of generating it too.
+    base::AutoLock scoped_lock(lock_);
+    auto iter = entries_.find(cache_key);
+    if (iter != entries_.end()) {
+      encryption_config->key_system_info = iter->second;
+      return Status::OK;
+    }
+    RETURN_IF_ERROR(GenerateProtectionSystemInfo(
+        encryption_params, encryption_key, encryption_config));
+    entries_[cache_key] = encryption_config->key_system_info;
+    insertion_order_.push_back(cache_key);
+    if (insertion_order_.size() > kMaxEntries) {
+      entries_.erase(insertion_order_.front());
+      insertion_order_.pop_front();
+    }
+    return Status::OK;
+  }
+
+ private:
+  // Enough for the keys of every stream label over a few crypto periods.
+  static const size_t kMaxEntries = 64;
+
+  ProtectionSystemInfoCache() = default;
+  ProtectionSystemInfoCache(const ProtectionSystemInfoCache&) = delete;
+  ProtectionSystemInfoCache& operator=(const ProtectionSystemInfoCache&) =
+      delete;
+
+  // Everything the generated info depends on.
+  static std::string GetCacheKey(const EncryptionParams& encryption_params,
+                                 const EncryptionKey& encryption_key) {
+    BufferWriter writer;
+    writer.AppendInt(
+        static_cast<uint32_t>(encryption_params.protection_systems));
+    writer.AppendInt(encryption_params.protection_scheme);
+    writer.AppendInt(static_cast<uint8_t>(
+        encryption_params.key_provider == KeyProvider::kRawKey &&
+        !encryption_params.raw_key.pssh.empty()));
+    AppendField(encryption_params.playready_extra_header_data, &writer);
+    AppendField(encryption_key.key_id, &writer);
+    AppendField(encryption_key.key, &writer);
+    writer.AppendInt(static_cast<uint32_t>(encryption_key.key_ids.size()));
+    for (const auto& key_id : encryption_key.key_ids)
+      AppendField(key_id, &writer);
+    for (const auto& info : encryption_key.key_system_info) {
+      AppendField(info.system_id, &writer);
+      AppendField(info.psshs, &writer);
+    }
+    return std::string(writer.Buffer(), writer.Buffer() + writer.Size());
+  }
+
+  template <typename T>
+  static void AppendField(const T& field, BufferWriter* writer) {
+    writer->AppendInt(static_cast<uint32_t>(field.size()));
+    writer->AppendArray(reinterpret_cast<const uint8_t*>(field.data()),
+                        field.size());
+  }
+
+  base::Lock lock_;
+  std::map<std::string, std::vector<ProtectionSystemSpecificInfo>> entries_;
+  std::deque<std::string> insertion_order_;
+};
+
+Status FillProtectionSystemInfo(const EncryptionParams& encryption_params,
+                                const EncryptionKey& encryption_key,
+                                EncryptionConfig* encryption_config) {
+  // If generating dummy keys for key rotation, don't generate PSSH info.
+  if (encryption_key.key_ids.empty())
+    return Status::OK;
+
+  return ProtectionSystemInfoCache::GetInstance()->Fill(
+      encryption_params, encryption_key, encryption_config);
+}
+
+// Returns the number of bytes that are going to be passed to the encryptor
+// when encrypting a sample of size |sample_size| with |subsamples|.
+size_t GetNumCryptBytes(const std::vector<SubsampleEntry>& subsamples,
+                        size_t sample_size) {
+  if (subsamples.empty())
+    return sample_size;
+  size_t num_crypt_bytes = 0;
+  for (const SubsampleEntry& subsample : subsamples)
+    num_crypt_bytes += subsample.cipher_bytes;
+  return num_crypt_bytes;
+}
+
+// Encrypts |source| with size |source_size| into |dest| using |encryptor|.
+// The clear portions specified in |subsamples| are copied to |dest| as is.
+// |dest| should have at least |source_size| bytes.
+bool EncryptSampleData(const std::vector<SubsampleEntry>& subsamples,
+                       const uint8_t* source,
+                       size_t source_size,
+                       AesCryptor* encryptor,
+                       uint8_t* dest) {
+  DCHECK(source);
+  DCHECK(dest);
+  DCHECK(encryptor);
+  if (subsamples.empty())
+    return encryptor->Crypt(source, source_size, dest);
+
+  size_t total_size = 0;
+  for (const SubsampleEntry& subsample : subsamples) {
+    if (subsample.clear_bytes > 0) {
+      if (dest != source)
+        memcpy(dest, source, subsample.clear_bytes);
+      source += subsample.clear_bytes;
+      dest += subsample.clear_bytes;
+      total_size += subsample.clear_bytes;
+    }
+    if (subsample.cipher_bytes > 0) {
+      if (!encryptor->Crypt(source, subsample.cipher_bytes, dest))
+        return false;
+      source += subsample.cipher_bytes;
+      dest += subsample.cipher_bytes;
+      total_size += subsample.cipher_bytes;
+    }
+  }
+  DCHECK_EQ(total_size, source_size);
+  return true;
+}
+
 }  // namespace
 
+// Encrypts a single sample on a thread of the encryption thread pool, with its
+// own encryptor so samples can be encrypted out of order.
+class EncryptionHandler::SampleEncryptionTask
+    : public base::DelegateSimpleThread::Delegate {
+ public:
+  SampleEncryptionTask(std::unique_ptr<AesCryptor> encryptor,
+                       std::shared_ptr<const MediaSample> clear_sample,
+                       const std::vector<SubsampleEntry>& subsamples,
+                       std::shared_ptr<MediaSample> cipher_sample)
+      : encryptor_(std::move(encryptor)),
+        clear_sample_(std::move(clear_sample)),
+        subsamples_(subsamples),
+        cipher_sample_(std::move(cipher_sample)),
+        cipher_sample_data_(new uint8_t[clear_sample_->data_size()],
+                            std::default_delete<uint8_t[]>()),
+        done_event_(base::WaitableEvent::ResetPolicy::MANUAL,
+                    base::WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+  /// base::DelegateSimpleThread::Delegate implementation.
+  void Run() override {
+    success_ = EncryptSampleData(subsamples_, clear_sample_->data(),
+                                 clear_sample_->data_size(), encryptor_.get(),
+                                 cipher_sample_data_.get());
+    done_event_.Signal();
+  }
+
+  /// Waits for the encryption to complete.
+  /// @return The encrypted sample on success, nullptr otherwise.
+  std::shared_ptr<MediaSample> WaitForEncryptedSample() {
+    done_event_.Wait();
+    if (!success_)
+      return nullptr;
+    cipher_sample_->TransferData(std::move(cipher_sample_data_),
+                                 clear_sample_->data_size());
+    return cipher_sample_;
+  }
+
+ private:
+  SampleEncryptionTask(const SampleEncryptionTask&) = delete;
+  SampleEncryptionTask& operator=(const SampleEncryptionTask&) = delete;
+
+  std::unique_ptr<AesCryptor> encryptor_;
+  std::shared_ptr<const MediaSample> clear_sample_;
+  const std::vector<SubsampleEntry> subsamples_;
+  std::shared_ptr<MediaSample> cipher_sample_;
+  std::shared_ptr<uint8_t> cipher_sample_data_;
+  bool success_ = false;
+  base::WaitableEvent done_event_;
+};
+
+// Gets the key of a crypto period on a worker thread, ahead of the period, so
+// the key is ready when the period starts.
+class EncryptionHandler::CryptoPeriodKeyTask {
+ public:
+  CryptoPeriodKeyTask(KeySource* key_source,
+                      int64_t crypto_period_index,
+                      uint32_t crypto_period_duration_in_seconds,
+                      const std::string& stream_label)
+      : key_source_(key_source),
+        crypto_period_index_(crypto_period_index),
+        crypto_period_duration_in_seconds_(crypto_period_duration_in_seconds),
+        stream_label_(stream_label),
+        done_event_(base::WaitableEvent::ResetPolicy::MANUAL,
+                    base::WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+  void Start() {
+    base::WorkerPool::PostTask(
+        FROM_HERE,
+        base::Bind(&CryptoPeriodKeyTask::Run, base::Unretained(this)),
+        /* task_is_slow= */ true);
+  }
+
+  /// Waits for the key.
+  /// @return The status of the key request.
+  Status WaitForKey(EncryptionKey* key) {
+    done_event_.Wait();
+    *key = key_;
+    return status_;
+  }
+
+  int64_t crypto_period_index() const { return crypto_period_index_; }
+
+ private:
+  CryptoPeriodKeyTask(const CryptoPeriodKeyTask&) = delete;
+  CryptoPeriodKeyTask& operator=(const CryptoPeriodKeyTask&) = delete;
+
+  void Run() {
+    status_ = key_source_->GetCryptoPeriodKey(
+        crypto_period_index_, crypto_period_duration_in_seconds_,
+        stream_label_, &key_);
+    done_event_.Signal();
+  }
+
+  KeySource* const key_source_;
+  const int64_t crypto_period_index_;
+  const uint32_t crypto_period_duration_in_seconds_;
+  const std::string stream_label_;
+  EncryptionKey key_;
+  Status status_;
+  base::WaitableEvent done_event_;
+};
+
 EncryptionHandler::EncryptionHandler(const EncryptionParams& encryption_params,
                                      KeySource* key_source)
     : encryption_params_(encryption_params),
@@ -170,7 +420,20 @@ EncryptionHandler::EncryptionHandler(const EncryptionParams& encryption_params,
           new SubsampleGenerator(encryption_params.vp9_subsample_encryption)),
       encryptor_factory_(new AesEncryptorFactory) {}
 
-EncryptionHandler::~EncryptionHandler() = default;
+EncryptionHandler::~EncryptionHandler() {
+  // Pending tasks are referenced by the thread pool, which has to finish them
+  // before they are destroyed.
+  if (encryption_thread_pool_)
+    encryption_thread_pool_->JoinAll();
+  WaitForNextCryptoPeriodKey();
+}
+
+void EncryptionHandler::SetDecryptionKeySource(
+    KeySource* decryption_key_source) {
+  decryptor_source_.reset(
+      decryption_key_source ? new DecryptorSource(decryption_key_source)
+                            : nullptr);
+}
 
 Status EncryptionHandler::InitializeInternal() {
   if (!encryption_params_.stream_label_func) {
@@ -180,16 +443,26 @@ Status EncryptionHandler::InitializeInternal() {
     return Status(error::INVALID_ARGUMENT,
                   "Expects exactly one input and output.");
   }
+  if (encryption_params_.num_encryption_threads > 1) {
+    encryption_thread_pool_.reset(new base::DelegateSimpleThreadPool(
+        "EncryptionThread", encryption_params_.num_encryption_threads));
+    encryption_thread_pool_->Start();
+  }
   return Status::OK;
 }
 
 Status EncryptionHandler::Process(std::unique_ptr<StreamData> stream_data) {
+  // Samples being encrypted must be dispatched before any other stream data
+  // to preserve the order.
+  if (stream_data->stream_data_type != StreamDataType::kMediaSample)
+    RETURN_IF_ERROR(DispatchPendingSamples(0));
+
   switch (stream_data->stream_data_type) {
     case StreamDataType::kStreamInfo:
-      return ProcessStreamInfo(*stream_data->stream_info);
+      return ProcessStreamInfo(*stream_data->stream_info());
     case StreamDataType::kSegmentInfo: {
       std::shared_ptr<SegmentInfo> segment_info(new SegmentInfo(
-          *stream_data->segment_info));
+          *stream_data->segment_info()));
 
       segment_info->is_encrypted = remaining_clear_lead_ <= 0;
 
@@ -206,7 +479,7 @@ Status EncryptionHandler::Process(std::unique_ptr<StreamData> stream_data) {
       return DispatchSegmentInfo(kStreamIndex, segment_info);
     }
     case StreamDataType::kMediaSample:
-      return ProcessMediaSample(std::move(stream_data->media_sample));
+      return ProcessMediaSample(stream_data->release_media_sample());
     default:
       VLOG(3) << "Stream data type "
               << static_cast<int>(stream_data->stream_data_type) << " ignored.";
@@ -214,8 +487,20 @@ Status EncryptionHandler::Process(std::unique_ptr<StreamData> stream_data) {
   }
 }
 
+Status EncryptionHandler::ProcessBatch(StreamDataBatch batch) {
+  return ProcessBatchAndDispatchBatch(std::move(batch));
+}
+
+Status EncryptionHandler::OnFlushRequest(size_t input_stream_index) {
+  RETURN_IF_ERROR(DispatchPendingSamples(0));
+  // The key of the crypto period after the end of the stream is not needed,
+  // but the key source must not be used once the stream is flushed.
+  WaitForNextCryptoPeriodKey();
+  return MediaHandler::OnFlushRequest(input_stream_index);
+}
+
 Status EncryptionHandler::ProcessStreamInfo(const StreamInfo& clear_info) {
-  if (clear_info.is_encrypted()) {
+  if (clear_info.is_encrypted() && !decryptor_source_) {
     return Status(error::INVALID_ARGUMENT,
                   "Input stream is already encrypted.");
   }
@@ -263,13 +548,34 @@ Status EncryptionHandler::ProcessStreamInfo(const StreamInfo& clear_info) {
 
 Status EncryptionHandler::ProcessMediaSample(
     std::shared_ptr<const MediaSample> clear_sample) {
+  TRACE_EVENT0("shaka", "EncryptionHandler::ProcessMediaSample");
   DCHECK(clear_sample);
 
+  // An encrypted sample is either re-encrypted directly, or decrypted and then
+  // processed like the clear samples.
+  std::shared_ptr<const MediaSample> encrypted_sample;
+  if (clear_sample->is_encrypted()) {
+    if (remaining_clear_lead_ <= 0 && CanReencryptSample(*clear_sample))
+      encrypted_sample = std::move(clear_sample);
+    else
+      RETURN_IF_ERROR(DecryptSample(&clear_sample));
+  }
+  const MediaSample& sample =
+      encrypted_sample ? *encrypted_sample : *clear_sample;
+
   // Process the frame even if the frame is not encrypted as the next
-  // (encrypted) frame may be dependent on this clear frame.
+  // (encrypted) frame may be dependent on this clear frame. Subsamples are
+  // only needed if the frame is encrypted though.
   std::vector<SubsampleEntry> subsamples;
-  RETURN_IF_ERROR(subsample_generator_->GenerateSubsamples(
-      clear_sample->data(), clear_sample->data_size(), &subsamples));
+  if (encrypted_sample) {
+    subsamples = encrypted_sample->decrypt_config()->subsamples();
+  } else if (remaining_clear_lead_ > 0) {
+    RETURN_IF_ERROR(subsample_generator_->ProcessClearFrame(
+        clear_sample->data(), clear_sample->data_size()));
+  } else {
+    RETURN_IF_ERROR(subsample_generator_->GenerateSubsamples(
+        clear_sample->data(), clear_sample->data_size(), &subsamples));
+  }
 
   // Need to setup the encryptor for new segments even if this segment does not
   // need to be encrypted, so we can signal encryption metadata earlier to
@@ -277,18 +583,35 @@ Status EncryptionHandler::ProcessMediaSample(
   if (check_new_crypto_period_) {
     // |dts| can be negative, e.g. after EditList adjustments. Normalized to 0
     // in that case.
-    const int64_t dts = std::max(clear_sample->dts(), static_cast<int64_t>(0));
+    const int64_t dts = std::max(sample.dts(), static_cast<int64_t>(0));
     const int64_t current_crypto_period_index = dts / crypto_period_duration_;
     const uint32_t crypto_period_duration_in_seconds =
         static_cast<uint32_t>(encryption_params_.crypto_period_duration_in_seconds);
     if (current_crypto_period_index != prev_crypto_period_index_) {
       EncryptionKey encryption_key;
-      RETURN_IF_ERROR(key_source_->GetCryptoPeriodKey(
-          current_crypto_period_index, crypto_period_duration_in_seconds,
-          stream_label_, &encryption_key));
+      // The key is usually ready, as it has been requested when the previous
+      // crypto period started. Otherwise, e.g. after a gap in the stream, it
+      // is requested now.
+      std::unique_ptr<CryptoPeriodKeyTask> key_task =
+          std::move(next_crypto_period_key_task_);
+      if (key_task &&
+          key_task->crypto_period_index() == current_crypto_period_index) {
+        RETURN_IF_ERROR(key_task->WaitForKey(&encryption_key));
+      } else {
+        if (key_task)
+          key_task->WaitForKey(&encryption_key);
+        RETURN_IF_ERROR(key_source_->GetCryptoPeriodKey(
+            current_crypto_period_index, crypto_period_duration_in_seconds,
+            stream_label_, &encryption_key));
+      }
       if (!CreateEncryptor(encryption_key))
         return Status(error::ENCRYPTION_FAILURE, "Failed to create encryptor");
       prev_crypto_period_index_ = current_crypto_period_index;
+
+      next_crypto_period_key_task_.reset(new CryptoPeriodKeyTask(
+          key_source_, current_crypto_period_index + 1,
+          crypto_period_duration_in_seconds, stream_label_));
+      next_crypto_period_key_task_->Start();
     }
     check_new_crypto_period_ = false;
   }
@@ -296,53 +619,156 @@ Status EncryptionHandler::ProcessMediaSample(
   // Since there is no encryption needed right now, send the clear copy
   // downstream so we can save the costs of copying it.
   if (remaining_clear_lead_ > 0) {
+    RETURN_IF_ERROR(DispatchPendingSamples(0));
     return DispatchMediaSample(kStreamIndex, std::move(clear_sample));
   }
 
-  std::shared_ptr<uint8_t> cipher_sample_data(
-      new uint8_t[clear_sample->data_size()], std::default_delete<uint8_t[]>());
-
-  const uint8_t* source = clear_sample->data();
-  uint8_t* dest = cipher_sample_data.get();
-  if (!subsamples.empty()) {
-    size_t total_size = 0;
-    for (const SubsampleEntry& subsample : subsamples) {
-      if (subsample.clear_bytes > 0) {
-        memcpy(dest, source, subsample.clear_bytes);
-        source += subsample.clear_bytes;
-        dest += subsample.clear_bytes;
-        total_size += subsample.clear_bytes;
-      }
-      if (subsample.cipher_bytes > 0) {
-        EncryptBytes(source, subsample.cipher_bytes, dest);
-        source += subsample.cipher_bytes;
-        dest += subsample.cipher_bytes;
-        total_size += subsample.cipher_bytes;
-      }
-    }
-    DCHECK_EQ(total_size, clear_sample->data_size());
-  } else {
-    EncryptBytes(source, clear_sample->data_size(), dest);
-  }
-
-  std::shared_ptr<MediaSample> cipher_sample(clear_sample->Clone());
-  cipher_sample->TransferData(std::move(cipher_sample_data),
-                              clear_sample->data_size());
-
-  // Finish initializing the sample before sending it downstream. We must
-  // wait until now to finish the initialization as we will lose access to
-  // |decrypt_config| once we set it.
+  std::shared_ptr<MediaSample> cipher_sample(sample.Clone());
   cipher_sample->set_is_encrypted(true);
   std::unique_ptr<DecryptConfig> decrypt_config(new DecryptConfig(
       encryption_config_->key_id, encryptor_->iv(), subsamples,
       protection_scheme_, crypt_byte_block_, skip_byte_block_));
   cipher_sample->set_decrypt_config(std::move(decrypt_config));
 
+  if (encrypted_sample)
+    return ReencryptSample(*encrypted_sample, std::move(cipher_sample));
+
+  if (encryption_thread_pool_) {
+    return ScheduleSampleEncryption(std::move(clear_sample), subsamples,
+                                    std::move(cipher_sample));
+  }
+
+  // |cipher_sample| shares the clear data. Once |clear_sample| is released,
+  // the data is encrypted in place unless it is still shared, e.g. with the
+  // other outputs of a Replicator, in which case it is encrypted into a new
+  // buffer.
+  clear_sample.reset();
+  const size_t data_size = cipher_sample->data_size();
+  if (cipher_sample->is_data_writable()) {
+    uint8_t* data = cipher_sample->writable_data();
+    if (!EncryptSampleData(subsamples, data, data_size, encryptor_.get(),
+                           data)) {
+      return Status(error::ENCRYPTION_FAILURE, "Failed to encrypt sample.");
+    }
+  } else {
+    std::shared_ptr<uint8_t> cipher_sample_data(
+        new uint8_t[data_size], std::default_delete<uint8_t[]>());
+    if (!EncryptSampleData(subsamples, cipher_sample->data(), data_size,
+                           encryptor_.get(), cipher_sample_data.get())) {
+      return Status(error::ENCRYPTION_FAILURE, "Failed to encrypt sample.");
+    }
+    cipher_sample->TransferData(std::move(cipher_sample_data), data_size);
+  }
+
   encryptor_->UpdateIv();
 
   return DispatchMediaSample(kStreamIndex, std::move(cipher_sample));
 }
 
+bool EncryptionHandler::CanReencryptSample(const MediaSample& sample) const {
+  // The subsample layout is only known to be valid for the same protection
+  // scheme. The pattern does not affect it.
+  return sample.decrypt_config() &&
+         sample.decrypt_config()->protection_scheme() == protection_scheme_;
+}
+
+Status EncryptionHandler::DecryptSample(
+    std::shared_ptr<const MediaSample>* sample) {
+  const MediaSample& encrypted_sample = **sample;
+  if (!decryptor_source_ || !encrypted_sample.decrypt_config()) {
+    return Status(error::ENCRYPTION_FAILURE,
+                  "Cannot decrypt the encrypted input sample.");
+  }
+  std::shared_ptr<uint8_t> clear_sample_data(
+      new uint8_t[encrypted_sample.data_size()],
+      std::default_delete<uint8_t[]>());
+  if (!decryptor_source_->DecryptSampleBuffer(
+          encrypted_sample.decrypt_config(), encrypted_sample.data(),
+          encrypted_sample.data_size(), clear_sample_data.get())) {
+    return Status(error::ENCRYPTION_FAILURE, "Failed to decrypt sample.");
+  }
+  std::shared_ptr<MediaSample> clear_sample(encrypted_sample.Clone());
+  clear_sample->TransferData(std::move(clear_sample_data),
+                             encrypted_sample.data_size());
+  clear_sample->set_is_encrypted(false);
+  clear_sample->set_decrypt_config(nullptr);
+  *sample = std::move(clear_sample);
+  return Status::OK;
+}
+
+Status EncryptionHandler::ReencryptSample(
+    const MediaSample& encrypted_sample,
+    std::shared_ptr<MediaSample> cipher_sample) {
+  // The decryptors are not shared with the encryption thread pool, so the
+  // samples are re-encrypted on the calling thread.
+  RETURN_IF_ERROR(DispatchPendingSamples(0));
+
+  std::shared_ptr<uint8_t> cipher_sample_data(
+      new uint8_t[encrypted_sample.data_size()],
+      std::default_delete<uint8_t[]>());
+  if (!decryptor_source_->ReencryptSampleBuffer(
+          encrypted_sample.decrypt_config(), encrypted_sample.data(),
+          encrypted_sample.data_size(), encryptor_.get(),
+          cipher_sample_data.get())) {
+    return Status(error::ENCRYPTION_FAILURE, "Failed to re-encrypt sample.");
+  }
+  cipher_sample->TransferData(std::move(cipher_sample_data),
+                              encrypted_sample.data_size());
+
+  encryptor_->UpdateIv();
+
+  return DispatchMediaSample(kStreamIndex, std::move(cipher_sample));
+}
+
+Status EncryptionHandler::ScheduleSampleEncryption(
+    std::shared_ptr<const MediaSample> clear_sample,
+    const std::vector<SubsampleEntry>& subsamples,
+    std::shared_ptr<MediaSample> cipher_sample) {
+  DCHECK(encryption_thread_pool_);
+
+  // Each sample gets its own encryptor starting at the sample IV. |encryptor_|
+  // is only used to derive the IV of the next sample, which is known before
+  // this sample is encrypted.
+  std::unique_ptr<AesCryptor> sample_encryptor =
+      encryptor_factory_->CreateEncryptor(protection_scheme_, crypt_byte_block_,
+                                          skip_byte_block_, codec_, key_,
+                                          encryptor_->iv());
+  if (!sample_encryptor)
+    return Status(error::ENCRYPTION_FAILURE, "Failed to create encryptor");
+  encryptor_->UpdateIv(
+      GetNumCryptBytes(subsamples, clear_sample->data_size()));
+
+  std::unique_ptr<SampleEncryptionTask> task(new SampleEncryptionTask(
+      std::move(sample_encryptor), std::move(clear_sample), subsamples,
+      std::move(cipher_sample)));
+  encryption_thread_pool_->AddWork(task.get());
+  pending_tasks_.push_back(std::move(task));
+
+  return DispatchPendingSamples(
+      kMaxPendingSamplesPerThread *
+      static_cast<size_t>(encryption_params_.num_encryption_threads));
+}
+
+Status EncryptionHandler::DispatchPendingSamples(size_t max_pending_tasks) {
+  while (pending_tasks_.size() > max_pending_tasks) {
+    std::shared_ptr<MediaSample> cipher_sample =
+        pending_tasks_.front()->WaitForEncryptedSample();
+    pending_tasks_.pop_front();
+    if (!cipher_sample)
+      return Status(error::ENCRYPTION_FAILURE, "Failed to encrypt sample.");
+    RETURN_IF_ERROR(DispatchMediaSample(kStreamIndex, std::move(cipher_sample)));
+  }
+  return Status::OK;
+}
+
+void EncryptionHandler::WaitForNextCryptoPeriodKey() {
+  if (!next_crypto_period_key_task_)
+    return;
+  EncryptionKey unused_key;
+  next_crypto_period_key_task_->WaitForKey(&unused_key);
+  next_crypto_period_key_task_.reset();
+}
+
 void EncryptionHandler::SetupProtectionPattern(StreamType stream_type) {
   if (stream_type == kStreamVideo &&
       IsPatternEncryptionScheme(protection_scheme_)) {
@@ -364,6 +790,7 @@ bool EncryptionHandler::CreateEncryptor(const EncryptionKey& encryption_key) {
   if (!encryptor)
     return false;
   encryptor_ = std::move(encryptor);
+  key_ = encryption_key.key;
 
   encryption_config_.reset(new EncryptionConfig);
   encryption_config_->protection_scheme = protection_scheme_;
@@ -384,15 +811,6 @@ bool EncryptionHandler::CreateEncryptor(const EncryptionKey& encryption_key) {
   return status.ok();
 }
 
-void EncryptionHandler::EncryptBytes(const uint8_t* source,
-                                     size_t source_size,
-                                     uint8_t* dest) {
-  DCHECK(source);
-  DCHECK(dest);
-  DCHECK(encryptor_);
-  CHECK(encryptor_->Crypt(source, source_size, dest));
-}
-
 void EncryptionHandler::InjectSubsampleGeneratorForTesting(
     std::unique_ptr<SubsampleGenerator> generator) {
   subsample_generator_ = std::move(generator);
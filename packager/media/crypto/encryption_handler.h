@@ -7,15 +7,22 @@
 #ifndef PACKAGER_MEDIA_CRYPTO_ENCRYPTION_HANDLER_H_
 #define PACKAGER_MEDIA_CRYPTO_ENCRYPTION_HANDLER_H_
 
+#include <deque>
+
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/media_handler.h"
 #include "packager/media/public/crypto_params.h"
 
+namespace base {
+class DelegateSimpleThreadPool;
+}  // namespace base
+
 namespace shaka {
 namespace media {
 
 class AesCryptor;
 class AesEncryptorFactory;
+class DecryptorSource;
 class SubsampleGenerator;
 struct EncryptionKey;
 
@@ -26,16 +33,30 @@ class EncryptionHandler : public MediaHandler {
 
   ~EncryptionHandler() override;
 
+  /// Sets the key source to decrypt encrypted input samples, which are then
+  /// encrypted again. A sample encrypted with the same protection scheme
+  /// keeps its subsample layout and is re-encrypted in a single pass, without
+  /// a clear copy. Other samples, and the samples in the clear lead, are
+  /// decrypted first.
+  /// @param decryption_key_source is the key source with the keys of the
+  ///        input samples. May be null, and caller retains ownership.
+  void SetDecryptionKeySource(KeySource* decryption_key_source);
+
  protected:
   /// @name MediaHandler implementation overrides.
   /// @{
   Status InitializeInternal() override;
   Status Process(std::unique_ptr<StreamData> stream_data) override;
+  Status ProcessBatch(StreamDataBatch batch) override;
+  Status OnFlushRequest(size_t input_stream_index) override;
   /// @}
 
  private:
   friend class EncryptionHandlerTest;
 
+  class CryptoPeriodKeyTask;
+  class SampleEncryptionTask;
+
   EncryptionHandler(const EncryptionHandler&) = delete;
   EncryptionHandler& operator=(const EncryptionHandler&) = delete;
 
@@ -43,24 +64,29 @@ class EncryptionHandler : public MediaHandler {
   Status ProcessStreamInfo(const StreamInfo& stream_info);
   // Processes media sample and encrypts it if needed.
   Status ProcessMediaSample(std::shared_ptr<const MediaSample> clear_sample);
+  // Returns true if the encrypted |sample| can be re-encrypted with its
+  // subsample layout.
+  bool CanReencryptSample(const MediaSample& sample) const;
+  // Replaces the encrypted |sample| with a decrypted copy.
+  Status DecryptSample(std::shared_ptr<const MediaSample>* sample);
+  // Re-encrypts |encrypted_sample| into |cipher_sample| and dispatches it.
+  Status ReencryptSample(const MediaSample& encrypted_sample,
+                         std::shared_ptr<MediaSample> cipher_sample);
+  // Schedules encryption of |cipher_sample| on |encryption_thread_pool_|. The
+  // encrypted sample is dispatched in order by DispatchPendingSamples.
+  Status ScheduleSampleEncryption(
+      std::shared_ptr<const MediaSample> clear_sample,
+      const std::vector<SubsampleEntry>& subsamples,
+      std::shared_ptr<MediaSample> cipher_sample);
+  // Waits for the oldest pending encryption tasks to complete and dispatches
+  // the encrypted samples downstream until there are no more than
+  // |max_pending_tasks| tasks pending.
+  Status DispatchPendingSamples(size_t max_pending_tasks);
+  // Waits for the key of the next crypto period, if it is being requested.
+  void WaitForNextCryptoPeriodKey();
 
   void SetupProtectionPattern(StreamType stream_type);
   bool CreateEncryptor(const EncryptionKey& encryption_key);
-  // Encrypt an E-AC3 frame with size |source_size| according to SAMPLE-AES
-  // specification. |dest| should have at least |source_size| bytes.
-  bool SampleAesEncryptEac3Frame(const uint8_t* source,
-                                 size_t source_size,
-                                 uint8_t* dest);
-  // Encrypt an array with size |source_size|. |dest| should have at
-  // least |source_size| bytes.
-  void EncryptBytes(const uint8_t* source, size_t source_size, uint8_t* dest);
-
-  // An E-AC3 frame comprises of one or more syncframes. This function extracts
-  // the syncframe sizes from the source bytes.
-  // Returns false if the frame is not well formed.
-  bool ExtractEac3SyncframeSizes(const uint8_t* source,
-                                 size_t source_size,
-                                 std::vector<size_t>* syncframe_sizes);
 
   // Testing injections.
   void InjectSubsampleGeneratorForTesting(
@@ -75,6 +101,9 @@ class EncryptionHandler : public MediaHandler {
   // Current encryption config and encryptor.
   std::shared_ptr<EncryptionConfig> encryption_config_;
   std::unique_ptr<AesCryptor> encryptor_;
+  // Current encryption key, used to create per sample encryptors if samples
+  // are encrypted in parallel.
+  std::vector<uint8_t> key_;
   Codec codec_ = kUnknownCodec;
   // Remaining clear lead in the stream's time scale.
   int64_t remaining_clear_lead_ = 0;
@@ -83,13 +112,27 @@ class EncryptionHandler : public MediaHandler {
   // Previous crypto period index if key rotation is enabled.
   int64_t prev_crypto_period_index_ = -1;
   bool check_new_crypto_period_ = false;
+  // Requests the key of the crypto period after the current one, so that the
+  // next crypto period does not wait for its key. Null if key rotation is not
+  // enabled.
+  std::unique_ptr<CryptoPeriodKeyTask> next_crypto_period_key_task_;
 
   std::unique_ptr<SubsampleGenerator> subsample_generator_;
   std::unique_ptr<AesEncryptorFactory> encryptor_factory_;
+  // Decrypts the encrypted input samples. Null if there is no decryption key
+  // source.
+  std::unique_ptr<DecryptorSource> decryptor_source_;
   // Number of encrypted blocks (16-byte-block) in pattern based encryption.
   uint8_t crypt_byte_block_ = 0;
   /// Number of unencrypted blocks (16-byte-block) in pattern based encryption.
   uint8_t skip_byte_block_ = 0;
+
+  // Thread pool to encrypt samples in parallel. Null if samples are encrypted
+  // on the calling thread.
+  std::unique_ptr<base::DelegateSimpleThreadPool> encryption_thread_pool_;
+  // Encryption tasks scheduled on |encryption_thread_pool_| but not yet
+  // dispatched, in sample order.
+  std::deque<std::unique_ptr<SampleEncryptionTask>> pending_tasks_;
 };
 
 }  // namespace media
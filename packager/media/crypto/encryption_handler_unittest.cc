@@ -10,6 +10,7 @@
 #include <gtest/gtest.h>
 
 #include "packager/media/base/aes_cryptor.h"
+#include "packager/media/base/aes_decryptor.h"
 #include "packager/media/base/media_handler_test_base.h"
 #include "packager/media/base/mock_aes_cryptor.h"
 #include "packager/media/base/protection_system_ids.h"
@@ -126,6 +127,10 @@ class EncryptionHandlerTest : public MediaHandlerGraphTestBase {
     return encryption_handler_->Process(std::move(stream_data));
   }
 
+  Status OnFlushRequest(size_t input_stream_index) {
+    return encryption_handler_->OnFlushRequest(input_stream_index);
+  }
+
   EncryptionKey GetMockEncryptionKey() {
     EncryptionKey encryption_key;
     encryption_key.key_id.assign(kKeyId, kKeyId + sizeof(kKeyId));
@@ -337,7 +342,7 @@ TEST_P(EncryptionHandlerEncryptionTest, ClearLeadWithNoKeyRotation) {
       GetOutputStreamDataVector(),
       ElementsAre(IsStreamInfo(kStreamIndex, kTimeScale, kEncrypted, _)));
   const StreamInfo* stream_info =
-      GetOutputStreamDataVector().back()->stream_info.get();
+      GetOutputStreamDataVector().back()->stream_info().get();
   ASSERT_TRUE(stream_info);
   EXPECT_TRUE(stream_info->has_clear_lead());
   EXPECT_THAT(stream_info->encryption_config(),
@@ -366,7 +371,8 @@ TEST_P(EncryptionHandlerEncryptionTest, ClearLeadWithNoKeyRotation) {
                                           kSegmentDuration, !kIsSubsegment,
                                           is_encrypted)));
     if (is_encrypted) {
-      const auto* media_sample = output_stream_data.front()->media_sample.get();
+      const auto* media_sample =
+          output_stream_data.front()->media_sample().get();
       const auto* decrypt_config = media_sample->decrypt_config();
       EXPECT_EQ(std::vector<uint8_t>(kKeyId, kKeyId + sizeof(kKeyId)),
                 decrypt_config->key_id());
@@ -379,7 +385,7 @@ TEST_P(EncryptionHandlerEncryptionTest, ClearLeadWithNoKeyRotation) {
       EXPECT_EQ(GetExpectedSkipByteBlock(), decrypt_config->skip_byte_block());
     }
     EXPECT_FALSE(output_stream_data.back()
-                     ->segment_info->key_rotation_encryption_config);
+                     ->segment_info()->key_rotation_encryption_config);
     ClearOutputStreamDataVector();
   }
 }
@@ -408,7 +414,7 @@ TEST_P(EncryptionHandlerEncryptionTest, ClearLeadWithKeyRotation) {
       GetOutputStreamDataVector(),
       ElementsAre(IsStreamInfo(kStreamIndex, kTimeScale, kEncrypted, _)));
   const StreamInfo* stream_info =
-      GetOutputStreamDataVector().back()->stream_info.get();
+      GetOutputStreamDataVector().back()->stream_info().get();
   ASSERT_TRUE(stream_info);
   EXPECT_TRUE(stream_info->has_clear_lead());
   const EncryptionConfig& encryption_config = stream_info->encryption_config();
@@ -420,15 +426,19 @@ TEST_P(EncryptionHandlerEncryptionTest, ClearLeadWithKeyRotation) {
             encryption_config.key_id);
   ClearOutputStreamDataVector();
 
+  // The key of each crypto period is requested when the previous crypto period
+  // starts, so the key of the crypto period after the last one is requested
+  // too.
+  const int kNumCryptoPeriods = 3;
+  for (int i = 0; i <= kNumCryptoPeriods; ++i) {
+    EXPECT_CALL(mock_key_source_,
+                GetCryptoPeriodKey(i, kCryptoPeriodDurationInSeconds, _, _))
+        .WillOnce(DoAll(SetArgPointee<3>(GetMockEncryptionKey()),
+                        Return(Status::OK)));
+  }
+
   // There are five segments with the first two not encrypted.
   for (int i = 0; i < 5; ++i) {
-    if ((i % kSegmentsPerCryptoPeriod) == 0) {
-      EXPECT_CALL(mock_key_source_,
-                  GetCryptoPeriodKey(i / kSegmentsPerCryptoPeriod,
-                                     kCryptoPeriodDurationInSeconds, _, _))
-          .WillOnce(DoAll(SetArgPointee<3>(GetMockEncryptionKey()),
-                          Return(Status::OK)));
-    }
     // Use single-frame segment for testing.
     ASSERT_OK(Process(StreamData::FromMediaSample(
         kStreamIndex, GetMediaSample(i * kSegmentDuration, kSegmentDuration,
@@ -445,14 +455,16 @@ TEST_P(EncryptionHandlerEncryptionTest, ClearLeadWithKeyRotation) {
                                           kSegmentDuration, !kIsSubsegment,
                                           is_encrypted)));
     EXPECT_THAT(*output_stream_data.back()
-                     ->segment_info->key_rotation_encryption_config,
+                     ->segment_info()->key_rotation_encryption_config,
                 MatchEncryptionConfig(
                     protection_scheme_, GetExpectedCryptByteBlock(),
                     GetExpectedSkipByteBlock(), GetExpectedPerSampleIvSize(),
                     GetExpectedConstantIv(), GetMockEncryptionKey().key_id));
-    Mock::VerifyAndClearExpectations(&mock_key_source_);
     ClearOutputStreamDataVector();
   }
+  // Waits for the key request of the crypto period after the last one.
+  ASSERT_OK(OnFlushRequest(kStreamIndex));
+  Mock::VerifyAndClearExpectations(&mock_key_source_);
 }
 
 INSTANTIATE_TEST_CASE_P(ProtectionSchemes,
@@ -550,7 +562,7 @@ TEST_P(EncryptionHandlerSubsampleTest, SubsampleTest) {
                           IsMediaSample(kStreamIndex, 0, kSampleDuration,
                                         kEncrypted, _)));
 
-  const MediaSample& sample = *output_stream_data.back()->media_sample;
+  const MediaSample& sample = *output_stream_data.back()->media_sample();
   EXPECT_EQ(
       GetParam().expected_output,
       std::vector<uint8_t>(sample.data(), sample.data() + sample.data_size()));
@@ -559,6 +571,62 @@ TEST_P(EncryptionHandlerSubsampleTest, SubsampleTest) {
   EXPECT_EQ(GetParam().subsamples, decrypt_config.subsamples());
 }
 
+TEST_F(EncryptionHandlerTest, EncryptsUnsharedSampleDataInPlace) {
+  std::unique_ptr<MockAesCryptor> mock_encryptor(new MockAesCryptor);
+  EXPECT_CALL(*mock_encryptor, CryptInternal(_, _, _, _))
+      .WillRepeatedly(Invoke(MockEncrypt));
+  ASSERT_TRUE(mock_encryptor->SetIv(
+      std::vector<uint8_t>(std::begin(kIv), std::end(kIv))));
+
+  std::unique_ptr<MockAesEncryptorFactory> mock_encryptor_factory(
+      new MockAesEncryptorFactory);
+  EXPECT_CALL(*mock_encryptor_factory, CreateEncryptor(_, _, _, _, _, _))
+      .WillOnce(Return(ByMove(std::move(mock_encryptor))));
+  InjectEncryptorFactoryForTesting(std::move(mock_encryptor_factory));
+
+  EXPECT_CALL(mock_key_source_, GetKey(_, _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(GetMockEncryptionKey()), Return(Status::OK)));
+
+  ASSERT_OK(Process(StreamData::FromStreamInfo(
+      kStreamIndex, GetVideoStreamInfo(kTimeScale, kCodecH264))));
+
+  std::vector<uint8_t> expected_output(std::begin(kData), std::end(kData));
+  for (uint8_t& byte : expected_output)
+    byte += 0x10;
+
+  // The data of the first sample is still referenced, e.g. by another output
+  // of a Replicator, so it is left untouched.
+  std::shared_ptr<MediaSample> shared_sample =
+      GetMediaSample(0, kSampleDuration, kIsKeyFrame, kData, kDataSize);
+  ASSERT_OK(
+      Process(StreamData::FromMediaSample(kStreamIndex, shared_sample)));
+  // The data of the second sample is only referenced by the handler.
+  std::shared_ptr<MediaSample> unshared_sample = GetMediaSample(
+      kSampleDuration, kSampleDuration, kIsKeyFrame, kData, kDataSize);
+  const uint8_t* unshared_data = unshared_sample->data();
+  ASSERT_OK(Process(
+      StreamData::FromMediaSample(kStreamIndex, std::move(unshared_sample))));
+
+  EXPECT_EQ(std::vector<uint8_t>(std::begin(kData), std::end(kData)),
+            std::vector<uint8_t>(shared_sample->data(),
+                                 shared_sample->data() +
+                                     shared_sample->data_size()));
+
+  const auto& output_stream_data = GetOutputStreamDataVector();
+  ASSERT_EQ(3u, output_stream_data.size());
+  for (size_t i = 1; i < output_stream_data.size(); ++i) {
+    const MediaSample& sample = *output_stream_data[i]->media_sample();
+    EXPECT_TRUE(sample.is_encrypted());
+    EXPECT_EQ(expected_output, std::vector<uint8_t>(
+                                   sample.data(),
+                                   sample.data() + sample.data_size()));
+  }
+  EXPECT_NE(shared_sample->data(),
+            output_stream_data[1]->media_sample()->data());
+  EXPECT_EQ(unshared_data, output_stream_data[2]->media_sample()->data());
+}
+
 class EncryptionHandlerTrackTypeTest : public EncryptionHandlerTest {};
 
 TEST_F(EncryptionHandlerTrackTypeTest, AudioTrackType) {
@@ -625,7 +693,7 @@ TEST_F(EncryptionHandlerPsshTest, GeneratesPssh) {
   EXPECT_THAT(GetOutputStreamDataVector(),
               ElementsAre(IsStreamInfo(_, kTimeScale, kEncrypted, _)));
   const StreamInfo* stream_info =
-      GetOutputStreamDataVector().back()->stream_info.get();
+      GetOutputStreamDataVector().back()->stream_info().get();
 
   std::vector<uint8_t> widevine_system_id(
       kWidevineSystemId, kWidevineSystemId + arraysize(kWidevineSystemId));
@@ -659,7 +727,7 @@ TEST_F(EncryptionHandlerPsshTest, UsesKeyInfoFirst) {
   EXPECT_THAT(GetOutputStreamDataVector(),
               ElementsAre(IsStreamInfo(_, kTimeScale, kEncrypted, _)));
   const StreamInfo* stream_info =
-      GetOutputStreamDataVector().back()->stream_info.get();
+      GetOutputStreamDataVector().back()->stream_info().get();
 
   ASSERT_THAT(stream_info->encryption_config().key_system_info,
               ElementsAre(IsPsshInfoWithSystemId(widevine_system_id)));
@@ -668,5 +736,63 @@ TEST_F(EncryptionHandlerPsshTest, UsesKeyInfoFirst) {
       stream_info->encryption_config().key_system_info[0].psshs.empty());
 }
 
+class EncryptionHandlerParallelTest : public EncryptionHandlerTest {};
+
+TEST_F(EncryptionHandlerParallelTest, SamplesDispatchedInOrder) {
+  const int kNumSamples = 50;
+  const size_t kBaseSampleSize = 100;
+
+  EncryptionParams encryption_params;
+  encryption_params.protection_scheme = FOURCC_cenc;
+  encryption_params.num_encryption_threads = 4;
+  SetUpEncryptionHandler(encryption_params);
+  ASSERT_OK(encryption_handler_->Initialize());
+
+  EXPECT_CALL(mock_key_source_, GetKey(_, _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(GetMockEncryptionKey()), Return(Status::OK)));
+
+  ASSERT_OK(Process(StreamData::FromStreamInfo(
+      kStreamIndex, GetVideoStreamInfo(kTimeScale, kCodecH264))));
+  std::vector<std::vector<uint8_t>> clear_samples;
+  for (int i = 0; i < kNumSamples; ++i) {
+    // Use sample sizes which are not a multiple of block size so the IV of
+    // each sample depends on the size of all previous samples.
+    std::vector<uint8_t> data(kBaseSampleSize + i * 7);
+    for (size_t j = 0; j < data.size(); ++j)
+      data[j] = static_cast<uint8_t>(i + j);
+    ASSERT_OK(Process(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(i * kSampleDuration, kSampleDuration,
+                                     kIsKeyFrame, data.data(), data.size()))));
+    clear_samples.push_back(data);
+  }
+  ASSERT_OK(OnFlushRequest(kStreamIndex));
+
+  const auto& output_stream_data = GetOutputStreamDataVector();
+  ASSERT_EQ(static_cast<size_t>(kNumSamples + 1), output_stream_data.size());
+
+  const std::vector<uint8_t> key(std::begin(kKey), std::end(kKey));
+  std::vector<uint8_t> expected_iv(std::begin(kIv), std::end(kIv));
+  AesCtrEncryptor iv_generator;
+  ASSERT_TRUE(iv_generator.InitializeWithIv(key, expected_iv));
+  for (int i = 0; i < kNumSamples; ++i) {
+    const MediaSample& sample = *output_stream_data[i + 1]->media_sample();
+    EXPECT_EQ(static_cast<int64_t>(i * kSampleDuration), sample.pts());
+    ASSERT_TRUE(sample.decrypt_config());
+    EXPECT_EQ(iv_generator.iv(), sample.decrypt_config()->iv());
+
+    AesCtrDecryptor decryptor;
+    ASSERT_TRUE(
+        decryptor.InitializeWithIv(key, sample.decrypt_config()->iv()));
+    std::vector<uint8_t> decrypted;
+    ASSERT_TRUE(decryptor.Crypt(
+        std::vector<uint8_t>(sample.data(), sample.data() + sample.data_size()),
+        &decrypted));
+    EXPECT_EQ(clear_samples[i], decrypted);
+
+    iv_generator.UpdateIv(clear_samples[i].size());
+  }
+}
+
 }  // namespace media
 }  // namespace shaka
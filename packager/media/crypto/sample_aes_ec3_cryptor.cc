@@ -15,43 +15,40 @@ namespace shaka {
 namespace media {
 namespace {
 
-bool ExtractEac3SyncframeSizes(const uint8_t* source,
-                               size_t source_size,
-                               std::vector<size_t>* syncframe_sizes) {
-  DCHECK(source);
-  DCHECK(syncframe_sizes);
+// MPEG-2 Stream Encryption Format for HTTP Live Streaming 2.3.1.3 Enhanced
+// AC-3: The first 16 bytes, starting with the syncframe() header, are not
+// encrypted.
+const size_t kLeadingClearBytesSize = 16u;
 
-  syncframe_sizes->clear();
-  BufferReader frame(source, source_size);
+// Reads the header of the syncframe at the position of |frame| and skips the
+// syncframe.
+// @return false if the syncframe is not valid or not complete.
+bool SkipEac3Syncframe(BufferReader* frame, size_t* syncframe_size) {
   // ASTC Standard A/52:2012 Annex E: Enhanced AC-3.
-  while (frame.HasBytes(1)) {
-    uint16_t syncword;
-    if (!frame.Read2(&syncword)) {
-      LOG(ERROR) << "Not enough bytes for syncword.";
-      return false;
-    }
-    if (syncword != 0x0B77) {
-      LOG(ERROR) << "Invalid E-AC3 frame. Seeing 0x" << std::hex << syncword
-                 << std::dec
-                 << ". The sync frame does not start with "
-                    "the valid syncword 0x0B77.";
-      return false;
-    }
-    uint16_t stream_type_and_syncframe_size;
-    if (!frame.Read2(&stream_type_and_syncframe_size)) {
-      LOG(ERROR) << "Not enough bytes for syncframe size.";
-      return false;
-    }
-    // frmsiz = least significant 11 bits. syncframe_size is (frmsiz + 1) * 2.
-    const size_t syncframe_size =
-        ((stream_type_and_syncframe_size & 0x7FF) + 1) * 2;
-    if (!frame.SkipBytes(syncframe_size - sizeof(syncword) -
-                         sizeof(stream_type_and_syncframe_size))) {
-      LOG(ERROR) << "Not enough bytes for syncframe. Expecting "
-                 << syncframe_size << " bytes.";
-      return false;
-    }
-    syncframe_sizes->push_back(syncframe_size);
+  uint16_t syncword;
+  if (!frame->Read2(&syncword)) {
+    LOG(ERROR) << "Not enough bytes for syncword.";
+    return false;
+  }
+  if (syncword != 0x0B77) {
+    LOG(ERROR) << "Invalid E-AC3 frame. Seeing 0x" << std::hex << syncword
+               << std::dec
+               << ". The sync frame does not start with "
+                  "the valid syncword 0x0B77.";
+    return false;
+  }
+  uint16_t stream_type_and_syncframe_size;
+  if (!frame->Read2(&stream_type_and_syncframe_size)) {
+    LOG(ERROR) << "Not enough bytes for syncframe size.";
+    return false;
+  }
+  // frmsiz = least significant 11 bits. syncframe_size is (frmsiz + 1) * 2.
+  *syncframe_size = ((stream_type_and_syncframe_size & 0x7FF) + 1) * 2;
+  if (!frame->SkipBytes(*syncframe_size - sizeof(syncword) -
+                        sizeof(stream_type_and_syncframe_size))) {
+    LOG(ERROR) << "Not enough bytes for syncframe. Expecting "
+               << *syncframe_size << " bytes.";
+    return false;
   }
   return true;
 }
@@ -81,28 +78,35 @@ bool SampleAesEc3Cryptor::CryptInternal(const uint8_t* text,
   }
   *crypt_text_size = text_size;
 
-  std::vector<size_t> syncframe_sizes;
-  if (!ExtractEac3SyncframeSizes(text, text_size, &syncframe_sizes))
-    return false;
-
-  // MPEG-2 Stream Encryption Format for HTTP Live Streaming 2.3.1.3 Enhanced
-  // AC-3: The first 16 bytes, starting with the syncframe() header, are not
-  // encrypted.
-  const size_t kLeadingClearBytesSize = 16u;
+  // All the syncframes are validated first, so nothing is written if the
+  // frame is not valid. The syncframe sizes are read again when encrypting,
+  // which is cheaper than storing them.
+  size_t syncframe_size = 0;
+  BufferReader syncframes(text, text_size);
+  while (syncframes.HasBytes(1)) {
+    if (!SkipEac3Syncframe(&syncframes, &syncframe_size))
+      return false;
+  }
 
-  for (size_t syncframe_size : syncframe_sizes) {
-    memcpy(crypt_text, text, std::min(syncframe_size, kLeadingClearBytesSize));
+  BufferReader frame(text, text_size);
+  while (frame.HasBytes(1)) {
+    const size_t syncframe_start = frame.pos();
+    CHECK(SkipEac3Syncframe(&frame, &syncframe_size));
+    const uint8_t* syncframe = text + syncframe_start;
+    uint8_t* crypt_syncframe = crypt_text + syncframe_start;
+    if (crypt_text != text) {
+      memcpy(crypt_syncframe, syncframe,
+             std::min(syncframe_size, kLeadingClearBytesSize));
+    }
     if (syncframe_size > kLeadingClearBytesSize) {
       // The residual block is left untouched (copied without
       // encryption/decryption). No need to do special handling here.
-      if (!cryptor_->Crypt(text + kLeadingClearBytesSize,
+      if (!cryptor_->Crypt(syncframe + kLeadingClearBytesSize,
                            syncframe_size - kLeadingClearBytesSize,
-                           crypt_text + kLeadingClearBytesSize)) {
+                           crypt_syncframe + kLeadingClearBytesSize)) {
         return false;
       }
     }
-    text += syncframe_size;
-    crypt_text += syncframe_size;
   }
   return true;
 }
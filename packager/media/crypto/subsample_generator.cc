@@ -243,6 +243,22 @@ Status SubsampleGenerator::GenerateSubsamples(
   return Status::OK;
 }
 
+Status SubsampleGenerator::ProcessClearFrame(const uint8_t* frame,
+                                             size_t frame_size) {
+  switch (codec_) {
+    case kCodecH264:
+      FALLTHROUGH_INTENDED;
+    case kCodecH265:
+    case kCodecH265DolbyVision:
+      return ProcessParameterSetsInH26xFrame(frame, frame_size);
+    default: {
+      // The other parsers are cheap, but still keep states across frames.
+      std::vector<SubsampleEntry> subsamples;
+      return GenerateSubsamples(frame, frame_size, &subsamples);
+    }
+  }
+}
+
 void SubsampleGenerator::InjectVpxParserForTesting(
     std::unique_ptr<VPxParser> vpx_parser) {
   vpx_parser_ = std::move(vpx_parser);
@@ -344,6 +360,33 @@ Status SubsampleGenerator::GenerateSubsamplesFromH26xFrame(
   return Status::OK;
 }
 
+Status SubsampleGenerator::ProcessParameterSetsInH26xFrame(
+    const uint8_t* frame,
+    size_t frame_size) {
+  DCHECK_NE(nalu_length_size_, 0u);
+  DCHECK(header_parser_);
+
+  const Nalu::CodecType nalu_type =
+      (codec_ == kCodecH265 || codec_ == kCodecH265DolbyVision) ? Nalu::kH265
+                                                                : Nalu::kH264;
+  NaluReader reader(nalu_type, nalu_length_size_, frame, frame_size);
+
+  Nalu nalu;
+  NaluReader::Result result;
+  while ((result = reader.Advance(&nalu)) == NaluReader::kOk) {
+    // Video slice NAL units are skipped by |header_parser_|.
+    if (leading_clear_bytes_size_ == 0 && !header_parser_->ProcessNalu(nalu)) {
+      LOG(ERROR) << "Failed to process NAL unit: NAL type = " << nalu.type();
+      return Status(error::ENCRYPTION_FAILURE, "Failed to process NAL unit.");
+    }
+  }
+  if (result != NaluReader::kEOStream) {
+    LOG(ERROR) << "Failed to parse NAL units.";
+    return Status(error::ENCRYPTION_FAILURE, "Failed to parse NAL units.");
+  }
+  return Status::OK;
+}
+
 Status SubsampleGenerator::GenerateSubsamplesFromAV1Frame(
     const uint8_t* frame,
     size_t frame_size,
@@ -60,6 +60,15 @@ class SubsampleGenerator {
                                     size_t frame_size,
                                     std::vector<SubsampleEntry>* subsamples);
 
+  /// Processes a frame that is not encrypted, e.g. in the clear lead, in place
+  /// of GenerateSubsamples. The state the next (encrypted) frames may depend
+  /// on, e.g. parameter sets, is updated, but video slice headers are not
+  /// parsed as there are no subsamples to generate.
+  /// @param frame points to the start of the frame.
+  /// @param frame_size is the size of the frame.
+  /// @returns OK on success, an error status otherwise.
+  virtual Status ProcessClearFrame(const uint8_t* frame, size_t frame_size);
+
   // Testing injections.
   void InjectVpxParserForTesting(std::unique_ptr<VPxParser> vpx_parser);
   void InjectVideoSliceHeaderParserForTesting(
@@ -78,6 +87,8 @@ class SubsampleGenerator {
       const uint8_t* frame,
       size_t frame_size,
       std::vector<SubsampleEntry>* subsamples);
+  Status ProcessParameterSetsInH26xFrame(const uint8_t* frame,
+                                        size_t frame_size);
   Status GenerateSubsamplesFromAV1Frame(
       const uint8_t* frame,
       size_t frame_size,
@@ -366,6 +366,31 @@ TEST_P(SubsampleGeneratorTest, H264SubsampleEncryption) {
     EXPECT_THAT(subsamples, ElementsAreArray(kExpectedAlignedSubsamples));
 }
 
+TEST_P(SubsampleGeneratorTest, H264ClearFrameSliceHeadersNotParsed) {
+  SubsampleGenerator generator(kVP9SubsampleEncryption);
+  ASSERT_OK(
+      generator.Initialize(protection_scheme_, GetVideoStreamInfo(kCodecH264)));
+
+  constexpr uint8_t kFrame[] = {
+      // First NALU (nalu_size = 9).
+      0x09, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+      // Second non-video-slice NALU (nalu_size = 3).
+      0x03, 0x67, 0x02, 0x03};
+  constexpr size_t kFrameSize = sizeof(kFrame);
+
+  std::unique_ptr<MockVideoSliceHeaderParser> mock_video_slice_header_parser(
+      new MockVideoSliceHeaderParser);
+  EXPECT_CALL(*mock_video_slice_header_parser, ProcessNalu(_))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(*mock_video_slice_header_parser, GetHeaderSize(_)).Times(0);
+
+  generator.InjectVideoSliceHeaderParserForTesting(
+      std::move(mock_video_slice_header_parser));
+
+  ASSERT_OK(generator.ProcessClearFrame(kFrame, kFrameSize));
+}
+
 TEST_P(SubsampleGeneratorTest, AV1ParserFailed) {
   SubsampleGenerator generator(kVP9SubsampleEncryption);
   ASSERT_OK(
@@ -0,0 +1,255 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/demuxer/concat_demuxer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "packager/base/logging.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/stream_info.h"
+#include "packager/media/base/text_sample.h"
+#include "packager/media/demuxer/demuxer.h"
+#include "packager/status_macros.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// Whether the stream can go on with |next| without a new init segment.
+bool HasSameConfiguration(const StreamInfo& previous, const StreamInfo& next) {
+  return previous.stream_type() == next.stream_type() &&
+         previous.codec() == next.codec() &&
+         previous.time_scale() == next.time_scale() &&
+         previous.codec_config() == next.codec_config() &&
+         previous.is_encrypted() == next.is_encrypted();
+}
+
+}  // namespace
+
+class ConcatDemuxer::InputHandler : public MediaHandler {
+ public:
+  InputHandler(ConcatDemuxer* concat_demuxer, size_t stream_index)
+      : concat_demuxer_(concat_demuxer), stream_index_(stream_index) {}
+
+ protected:
+  Status InitializeInternal() override { return Status::OK; }
+
+  Status Process(std::unique_ptr<StreamData> stream_data) override {
+    StreamDataBatch batch;
+    batch.push_back(std::move(stream_data));
+    return ProcessBatch(std::move(batch));
+  }
+
+  Status ProcessBatch(StreamDataBatch batch) override {
+    return concat_demuxer_->OnInputBatch(stream_index_, std::move(batch));
+  }
+
+  Status OnFlushRequest(size_t input_stream_index) override {
+    return concat_demuxer_->OnInputFlushed(stream_index_);
+  }
+
+ private:
+  InputHandler(const InputHandler&) = delete;
+  InputHandler& operator=(const InputHandler&) = delete;
+
+  ConcatDemuxer* const concat_demuxer_;
+  const size_t stream_index_;
+};
+
+ConcatDemuxer::ConcatDemuxer(std::vector<std::shared_ptr<Demuxer>> demuxers)
+    : demuxers_(std::move(demuxers)) {}
+
+ConcatDemuxer::~ConcatDemuxer() {}
+
+Status ConcatDemuxer::SetHandler(const std::string& stream_label,
+                                 std::shared_ptr<MediaHandler> handler) {
+  const size_t stream_index = next_output_stream_index();
+  for (const auto& demuxer : demuxers_) {
+    RETURN_IF_ERROR(demuxer->SetHandler(
+        stream_label, std::make_shared<InputHandler>(this, stream_index)));
+  }
+  stream_infos_.resize(stream_index + 1);
+  pending_stream_infos_.resize(stream_index + 1);
+  return MediaHandler::SetHandler(stream_index, std::move(handler));
+}
+
+Status ConcatDemuxer::Run() {
+  bool done = false;
+  Status status;
+  while (!done)
+    status = RunStep(&done);
+  return status;
+}
+
+Status ConcatDemuxer::RunStep(bool* done) {
+  *done = true;
+  if (current_input_ >= demuxers_.size())
+    return Status::OK;
+  bool input_done = false;
+  RETURN_IF_ERROR(demuxers_[current_input_]->RunStep(&input_done));
+  if (input_done) {
+    ++current_input_;
+    input_start_in_seconds_ = end_time_in_seconds_;
+    input_offset_known_ = false;
+  }
+  *done = current_input_ == demuxers_.size();
+  return Status::OK;
+}
+
+bool ConcatDemuxer::IsReadyToRunStep() {
+  return current_input_ >= demuxers_.size() ||
+         demuxers_[current_input_]->IsReadyToRunStep();
+}
+
+void ConcatDemuxer::SetReadyEvent(base::WaitableEvent* event) {
+  for (const auto& demuxer : demuxers_)
+    demuxer->SetReadyEvent(event);
+}
+
+void ConcatDemuxer::Cancel() {
+  for (const auto& demuxer : demuxers_)
+    demuxer->Cancel();
+}
+
+Status ConcatDemuxer::InitializeInternal() {
+  if (demuxers_.empty())
+    return Status(error::INVALID_ARGUMENT, "No input to concatenate.");
+  for (const auto& demuxer : demuxers_)
+    RETURN_IF_ERROR(demuxer->Initialize());
+  return Status::OK;
+}
+
+Status ConcatDemuxer::OnInputBatch(size_t stream_index, StreamDataBatch batch) {
+  StreamDataBatch output;
+  output.reserve(batch.size());
+  for (auto& stream_data : batch) {
+    stream_data->stream_index = stream_index;
+    if (stream_data->stream_data_type == StreamDataType::kStreamInfo) {
+      if (current_input_ == 0) {
+        stream_infos_[stream_index] = stream_data->stream_info();
+        output.push_back(std::move(stream_data));
+      } else {
+        pending_stream_infos_[stream_index] = stream_data->stream_info();
+        stream_infos_pending_ = true;
+      }
+      continue;
+    }
+    if (stream_infos_pending_)
+      RETURN_IF_ERROR(DispatchPendingStreamInfos(&output));
+    output.push_back(ShiftTimestamps(std::move(stream_data)));
+  }
+  return DispatchBatch(std::move(output));
+}
+
+Status ConcatDemuxer::OnInputFlushed(size_t stream_index) {
+  // The downstream handlers go on with the next input.
+  if (current_input_ + 1 < demuxers_.size())
+    return Status::OK;
+  if (stream_infos_pending_) {
+    StreamDataBatch output;
+    RETURN_IF_ERROR(DispatchPendingStreamInfos(&output));
+    RETURN_IF_ERROR(DispatchBatch(std::move(output)));
+  }
+  return FlushDownstream(stream_index);
+}
+
+Status ConcatDemuxer::DispatchPendingStreamInfos(StreamDataBatch* output) {
+  stream_infos_pending_ = false;
+  bool same_configuration = true;
+  for (size_t i = 0; i < pending_stream_infos_.size(); ++i) {
+    if (pending_stream_infos_[i] && stream_infos_[i] &&
+        !HasSameConfiguration(*stream_infos_[i], *pending_stream_infos_[i])) {
+      same_configuration = false;
+    }
+  }
+  if (same_configuration) {
+    VLOG(1) << "Input " << current_input_
+            << " goes on with the same init segment.";
+    for (auto& stream_info : pending_stream_infos_)
+      stream_info.reset();
+    return Status::OK;
+  }
+
+  LOG(INFO) << "Input " << current_input_
+            << " has a different codec configuration, new Period at "
+            << input_start_in_seconds_ << " seconds.";
+  std::shared_ptr<CueEvent> cue_event = std::make_shared<CueEvent>();
+  cue_event->time_in_seconds = input_start_in_seconds_;
+  for (size_t i = 0; i < stream_infos_.size(); ++i) {
+    if (stream_infos_[i])
+      output->push_back(StreamData::FromCueEvent(i, cue_event));
+  }
+  for (size_t i = 0; i < pending_stream_infos_.size(); ++i) {
+    if (!pending_stream_infos_[i])
+      continue;
+    stream_infos_[i] = std::move(pending_stream_infos_[i]);
+    output->push_back(StreamData::FromStreamInfo(i, stream_infos_[i]));
+  }
+  return Status::OK;
+}
+
+std::unique_ptr<StreamData> ConcatDemuxer::ShiftTimestamps(
+    std::unique_ptr<StreamData> stream_data) {
+  const bool is_media_sample =
+      stream_data->stream_data_type == StreamDataType::kMediaSample;
+  if (!is_media_sample &&
+      stream_data->stream_data_type != StreamDataType::kTextSample) {
+    return stream_data;
+  }
+  const double time_scale =
+      stream_infos_[stream_data->stream_index]->time_scale();
+
+  // The inputs are aligned on the decoding time of their first sample, so the
+  // decoding timestamps keep increasing across the inputs.
+  if (!input_offset_known_) {
+    const int64_t start = is_media_sample
+                              ? stream_data->media_sample()->dts()
+                              : stream_data->text_sample()->start_time();
+    input_offset_in_seconds_ = input_start_in_seconds_ - start / time_scale;
+    input_offset_known_ = true;
+  }
+  const int64_t offset =
+      static_cast<int64_t>(std::llround(input_offset_in_seconds_ * time_scale));
+
+  int64_t end_time = 0;
+  if (is_media_sample) {
+    const MediaSample& sample = *stream_data->media_sample();
+    end_time = sample.pts() + offset + sample.duration();
+    if (offset != 0) {
+      // Only the timestamps change, so the sample is shifted in place unless
+      // it is shared, e.g. with the handlers of another output.
+      std::shared_ptr<const MediaSample> input_sample =
+          stream_data->release_media_sample();
+      std::shared_ptr<MediaSample> shifted_sample =
+          input_sample.use_count() == 1
+              ? std::const_pointer_cast<MediaSample>(input_sample)
+              : input_sample->Clone();
+      shifted_sample->set_dts(input_sample->dts() + offset);
+      shifted_sample->set_pts(input_sample->pts() + offset);
+      stream_data = StreamData::FromMediaSample(stream_data->stream_index,
+                                                std::move(shifted_sample));
+    }
+  } else {
+    const TextSample& sample = *stream_data->text_sample();
+    end_time = sample.EndTime() + offset;
+    if (offset != 0) {
+      std::shared_ptr<TextSample> shifted_sample = std::make_shared<TextSample>(
+          sample.id(), sample.start_time() + offset, sample.EndTime() + offset,
+          sample.settings(), sample.body());
+      shifted_sample->set_sub_stream_index(sample.sub_stream_index());
+      stream_data = StreamData::FromTextSample(stream_data->stream_index,
+                                               std::move(shifted_sample));
+    }
+  }
+  end_time_in_seconds_ =
+      std::max(end_time_in_seconds_, end_time / time_scale);
+  return stream_data;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,106 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_DEMUXER_CONCAT_DEMUXER_H_
+#define PACKAGER_MEDIA_DEMUXER_CONCAT_DEMUXER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/media/origin/origin_handler.h"
+#include "packager/status.h"
+
+namespace shaka {
+namespace media {
+
+class Demuxer;
+class StreamInfo;
+
+/// ConcatDemuxer plays a list of inputs back to back into a single set of
+/// streams, e.g. to package ad-stitched titles in one pass. The inputs are
+/// demuxed one after the other, and the timestamps of each input are shifted
+/// to start where the previous input ended, so the downstream handlers see
+/// one continuous stream and keep their state across the inputs.
+///
+/// The stream info of each stream is only dispatched again if the codec
+/// configuration of an input differs from the previous one. A cue event is
+/// then dispatched on every stream at the boundary, so the outputs start a
+/// new Period or discontinuity, followed by the stream infos of the input.
+class ConcatDemuxer : public OriginHandler {
+ public:
+  /// @param demuxers are the demuxers of the inputs, in playback order. They
+  ///        must all have the streams selected with SetHandler().
+  explicit ConcatDemuxer(std::vector<std::shared_ptr<Demuxer>> demuxers);
+  ~ConcatDemuxer() override;
+
+  /// Set the handler for the specified stream of the inputs.
+  /// @param stream_label can be 'audio', 'video', 'text' or stream number
+  ///        (zero based), as for Demuxer::SetHandler().
+  /// @param handler is the handler for the specified stream.
+  Status SetHandler(const std::string& stream_label,
+                    std::shared_ptr<MediaHandler> handler);
+
+  /// @name OriginHandler implementation overrides.
+  /// @{
+  Status Run() override;
+  Status RunStep(bool* done) override;
+  bool IsReadyToRunStep() override;
+  void SetReadyEvent(base::WaitableEvent* event) override;
+  void Cancel() override;
+  /// @}
+
+ protected:
+  /// @name MediaHandler implementation overrides.
+  /// @{
+  Status InitializeInternal() override;
+  Status Process(std::unique_ptr<StreamData> stream_data) override {
+    return Status(error::INTERNAL_ERROR,
+                  "ConcatDemuxer should not be the downstream handler.");
+  }
+  bool ValidateOutputStreamIndex(size_t stream_index) const override {
+    return true;
+  }
+  /// @}
+
+ private:
+  ConcatDemuxer(const ConcatDemuxer&) = delete;
+  ConcatDemuxer& operator=(const ConcatDemuxer&) = delete;
+
+  // Receives a stream of the current input and passes it to OnInputBatch().
+  class InputHandler;
+
+  // Shifts the timestamps of the stream data of the current input, which are
+  // for output stream |stream_index|, and dispatches them.
+  Status OnInputBatch(size_t stream_index, StreamDataBatch batch);
+  Status OnInputFlushed(size_t stream_index);
+  // Decides whether the stream infos of the current input start a new
+  // Period, once they are all known.
+  Status DispatchPendingStreamInfos(StreamDataBatch* output);
+  std::unique_ptr<StreamData> ShiftTimestamps(
+      std::unique_ptr<StreamData> stream_data);
+
+  std::vector<std::shared_ptr<Demuxer>> demuxers_;
+  size_t current_input_ = 0;
+  // Output stream index -> stream info of the stream.
+  std::vector<std::shared_ptr<const StreamInfo>> stream_infos_;
+  // The stream infos of the current input, held until its first sample.
+  std::vector<std::shared_ptr<const StreamInfo>> pending_stream_infos_;
+  bool stream_infos_pending_ = false;
+  // End of the inputs played so far, in seconds.
+  double end_time_in_seconds_ = 0;
+  // Start of the current input in the output timeline, in seconds.
+  double input_start_in_seconds_ = 0;
+  // Offset of the timestamps of the current input, in seconds. Known once its
+  // first sample is seen, and 0 for the first input.
+  double input_offset_in_seconds_ = 0;
+  bool input_offset_known_ = true;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_DEMUXER_CONCAT_DEMUXER_H_
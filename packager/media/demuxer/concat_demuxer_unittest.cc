@@ -0,0 +1,117 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/demuxer/concat_demuxer.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/media/base/media_handler_test_base.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/video_stream_info.h"
+#include "packager/media/demuxer/demuxer.h"
+#include "packager/media/test/test_data_util.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+std::shared_ptr<Demuxer> CreateDemuxer(const std::string& file_name) {
+  return std::make_shared<Demuxer>(
+      GetTestDataFilePath(file_name).AsUTF8Unsafe());
+}
+
+size_t CountStreamData(const std::vector<std::unique_ptr<StreamData>>& output,
+                       StreamDataType type) {
+  size_t count = 0;
+  for (const auto& stream_data : output) {
+    if (stream_data->stream_data_type == type)
+      ++count;
+  }
+  return count;
+}
+
+}  // namespace
+
+class ConcatDemuxerTest : public ::testing::Test {
+ protected:
+  std::shared_ptr<CachingMediaHandler> output_ =
+      std::make_shared<CachingMediaHandler>();
+};
+
+TEST_F(ConcatDemuxerTest, SameConfiguration) {
+  const char kInput[] = "bear-mpeg2-aac-only_frag.mp4";
+  ConcatDemuxer concat_demuxer({CreateDemuxer(kInput), CreateDemuxer(kInput)});
+  ASSERT_OK(concat_demuxer.SetHandler("audio", output_));
+  ASSERT_OK(concat_demuxer.Initialize());
+  ASSERT_OK(concat_demuxer.Run());
+
+  const auto& output = output_->Cache();
+  ASSERT_FALSE(output.empty());
+  EXPECT_EQ(StreamDataType::kStreamInfo, output[0]->stream_data_type);
+  // The stream info is not dispatched again for the second input.
+  EXPECT_EQ(1u, CountStreamData(output, StreamDataType::kStreamInfo));
+  EXPECT_EQ(0u, CountStreamData(output, StreamDataType::kCueEvent));
+  const size_t num_samples =
+      CountStreamData(output, StreamDataType::kMediaSample);
+  ASSERT_EQ(output.size() - 1, num_samples);
+  ASSERT_EQ(0u, num_samples % 2);
+
+  // The second input starts where the first one ends.
+  for (size_t i = 2; i < output.size(); ++i) {
+    const MediaSample& previous = *output[i - 1]->media_sample();
+    EXPECT_EQ(previous.dts() + previous.duration(),
+              output[i]->media_sample()->dts());
+  }
+  const MediaSample& first = *output[1]->media_sample();
+  const MediaSample& second_first =
+      *output[1 + num_samples / 2]->media_sample();
+  EXPECT_EQ(first.data_size(), second_first.data_size());
+  EXPECT_TRUE(second_first.is_key_frame());
+}
+
+TEST_F(ConcatDemuxerTest, DifferentConfiguration) {
+  ConcatDemuxer concat_demuxer({CreateDemuxer("bear-640x360.mp4"),
+                                CreateDemuxer("bear-320x180.mp4")});
+  ASSERT_OK(concat_demuxer.SetHandler("video", output_));
+  ASSERT_OK(concat_demuxer.Initialize());
+  ASSERT_OK(concat_demuxer.Run());
+
+  const auto& output = output_->Cache();
+  EXPECT_EQ(2u, CountStreamData(output, StreamDataType::kStreamInfo));
+  ASSERT_EQ(1u, CountStreamData(output, StreamDataType::kCueEvent));
+
+  size_t cue_index = 0;
+  while (output[cue_index]->stream_data_type != StreamDataType::kCueEvent)
+    ++cue_index;
+  ASSERT_LT(cue_index + 2, output.size());
+  // A new Period starts where the first input ends, with the stream info of
+  // the second input.
+  const MediaSample& last_sample = *output[cue_index - 1]->media_sample();
+  const uint32_t time_scale = output[0]->stream_info()->time_scale();
+  EXPECT_LE(static_cast<double>(last_sample.dts() + last_sample.duration()) /
+                time_scale,
+            output[cue_index]->cue_event()->time_in_seconds);
+  ASSERT_EQ(StreamDataType::kStreamInfo,
+            output[cue_index + 1]->stream_data_type);
+  const VideoStreamInfo& video_info = static_cast<const VideoStreamInfo&>(
+      *output[cue_index + 1]->stream_info());
+  EXPECT_EQ(320u, video_info.width());
+  EXPECT_GE(output[cue_index + 2]->media_sample()->dts(), last_sample.dts());
+}
+
+TEST_F(ConcatDemuxerTest, StreamNotAvailableInNextInput) {
+  ConcatDemuxer concat_demuxer(
+      {CreateDemuxer("bear-640x360.mp4"),
+       CreateDemuxer("bear-mpeg2-aac-only_frag.mp4")});
+  ASSERT_OK(concat_demuxer.SetHandler("video", output_));
+  ASSERT_OK(concat_demuxer.Initialize());
+  EXPECT_EQ(error::INVALID_ARGUMENT, concat_demuxer.Run().error_code());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -6,36 +6,67 @@
 
 #include "packager/media/demuxer/demuxer.h"
 
+#include <string.h>
+
 #include <algorithm>
+#include <set>
 
 #include "packager/base/bind.h"
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/trace_event/trace_event.h"
 #include "packager/file/file.h"
 #include "packager/media/base/decryptor_source.h"
+#include "packager/media/base/hot_path_log.h"
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/macros.h"
 #include "packager/media/base/media_sample.h"
+#include "packager/media/base/text_sample.h"
+#include "packager/media/base/metrics.h"
 #include "packager/media/base/stream_info.h"
 #include "packager/media/formats/mp2t/mp2t_media_parser.h"
 #include "packager/media/formats/mp4/mp4_media_parser.h"
 #include "packager/media/formats/webm/webm_media_parser.h"
 #include "packager/media/formats/webvtt/webvtt_parser.h"
 #include "packager/media/formats/wvm/wvm_media_parser.h"
+#include "packager/status_macros.h"
 
 namespace {
 // 65KB, sufficient to determine the container and likely all init data.
 const size_t kInitBufSize = 0x10000;
 const size_t kBufSize = 0x200000;  // 2MB
-// Maximum number of allowed queued samples. If we are receiving a lot of
-// samples before seeing init_event, something is not right. The number
-// set here is arbitrary though.
-const size_t kQueuedSamplesLimit = 10000;
+// Default budget of the samples queued before seeing init_event. If we are
+// receiving a lot of samples before seeing init_event, something is not right.
+// The budget set here is arbitrary though.
+const uint64_t kDefaultMaxQueuedSampleBytes = 256 << 20;  // 256MB
+// Maximum time an input read is delayed while the process-wide memory budget
+// is exceeded. Bounded, as the memory may only be released once this input is
+// read further, e.g. to complete a fragment.
+const int kMaxMemoryBudgetWaitInMs = 1000;
+// Maximum number of samples dispatched together.
+const size_t kMaxPendingSamples = 256;
 const size_t kInvalidStreamIndex = static_cast<size_t>(-1);
 const size_t kBaseVideoOutputStreamIndex = 0x100;
 const size_t kBaseAudioOutputStreamIndex = 0x200;
 const size_t kBaseTextOutputStreamIndex = 0x300;
 
+// Estimated memory used by a queued sample.
+size_t QueuedSampleSize(const shaka::media::MediaSample& sample) {
+  return sizeof(sample) + sample.data_size() + sample.side_data_size();
+}
+
+size_t TextFragmentSize(const shaka::media::TextFragment& fragment) {
+  size_t size = fragment.body.size() + fragment.image.size();
+  for (const auto& sub_fragment : fragment.sub_fragments)
+    size += sizeof(sub_fragment) + TextFragmentSize(sub_fragment);
+  return size;
+}
+
+size_t QueuedSampleSize(const shaka::media::TextSample& sample) {
+  return sizeof(sample) + sample.id().size() + TextFragmentSize(sample.body());
+}
+
 std::string GetStreamLabel(size_t stream_index) {
   switch (stream_index) {
     case kBaseVideoOutputStreamIndex:
@@ -74,7 +105,10 @@ namespace shaka {
 namespace media {
 
 Demuxer::Demuxer(const std::string& file_name)
-    : file_name_(file_name), buffer_(new uint8_t[kBufSize]) {}
+    : file_name_(file_name),
+      max_queued_sample_bytes_(kDefaultMaxQueuedSampleBytes),
+      queued_sample_memory_(MemorySubsystem::kDemuxerQueue),
+      buffer_(kBufSize) {}
 
 Demuxer::~Demuxer() {
   if (media_file_)
@@ -86,48 +120,83 @@ void Demuxer::SetKeySource(std::unique_ptr<KeySource> key_source) {
 }
 
 Status Demuxer::Run() {
-  LOG(INFO) << "Demuxer::Run() on file '" << file_name_ << "'.";
-  Status status = InitializeParser();
-  // ParserInitEvent callback is called after a few calls to Parse(), which sets
-  // up the streams. Only after that, we can verify the outputs below.
-  while (!all_streams_ready_ && status.ok())
-    status.Update(Parse());
-  // If no output is defined, then return success after receiving all stream
-  // info.
-  if (all_streams_ready_ && output_handlers().empty())
-    return Status::OK;
-  if (!init_event_status_.ok())
-    return init_event_status_;
-  if (!status.ok())
-    return status;
-  // Check if all specified outputs exists.
-  for (const auto& pair : output_handlers()) {
-    if (std::find(stream_indexes_.begin(), stream_indexes_.end(), pair.first) ==
-        stream_indexes_.end()) {
-      LOG(ERROR) << "Invalid argument, stream=" << GetStreamLabel(pair.first)
-                 << " not available.";
-      return Status(error::INVALID_ARGUMENT, "Stream not available");
-    }
-  }
-
-  while (!cancelled_ && status.ok())
-    status.Update(Parse());
-  if (cancelled_ && status.ok())
-    return Status(error::CANCELLED, "Demuxer run cancelled");
+  bool done = false;
+  Status status;
+  while (!done)
+    status = RunStep(&done);
+  return status;
+}
 
-  if (status.error_code() == error::END_OF_STREAM) {
-    for (size_t stream_index : stream_indexes_) {
-      status = FlushDownstream(stream_index);
+Status Demuxer::RunStep(bool* done) {
+  *done = true;
+  switch (run_state_) {
+    case RunState::kNotStarted:
+      LOG(INFO) << "Demuxer::Run() on file '" << file_name_ << "'.";
+      RETURN_IF_ERROR(InitializeParser());
+      run_state_ = RunState::kParsingStreamInfo;
+      break;
+    case RunState::kParsingStreamInfo: {
+      // ParserInitEvent callback is called after a few calls to Parse(),
+      // which sets up the streams. Only after that, we can verify the outputs
+      // below.
+      Status status = Parse();
+      if (!all_streams_ready_ && status.ok())
+        break;
+      // If no output is defined, then return success after receiving all
+      // stream info.
+      if (all_streams_ready_ && output_handlers().empty())
+        return Status::OK;
+      if (!init_event_status_.ok())
+        return init_event_status_;
       if (!status.ok())
         return status;
+      // Check if all specified outputs exists.
+      for (const auto& pair : output_handlers()) {
+        if (std::find(stream_indexes_.begin(), stream_indexes_.end(),
+                      pair.first) == stream_indexes_.end()) {
+          LOG(ERROR) << "Invalid argument, stream="
+                     << GetStreamLabel(pair.first) << " not available.";
+          return Status(error::INVALID_ARGUMENT, "Stream not available");
+        }
+      }
+      run_state_ = RunState::kParsing;
+      break;
+    }
+    case RunState::kParsing: {
+      if (cancelled_)
+        return Status(error::CANCELLED, "Demuxer run cancelled");
+      Status status = Parse();
+      if (status.error_code() == error::END_OF_STREAM) {
+        for (size_t stream_index : stream_indexes_)
+          RETURN_IF_ERROR(FlushDownstream(stream_index));
+        return Status::OK;
+      }
+      if (!status.ok())
+        return status;
+      break;
     }
-    return Status::OK;
   }
-  return status;
+  *done = false;
+  return Status::OK;
+}
+
+bool Demuxer::IsReadyToRunStep() {
+  // Random access parsers read the file themselves.
+  return cancelled_ || run_state_ == RunState::kNotStarted ||
+         random_access_parser_ || !media_file_ ||
+         media_file_->CanReadWithoutBlocking();
+}
+
+void Demuxer::SetReadyEvent(base::WaitableEvent* event) {
+  ready_event_ = event;
+  if (media_file_)
+    media_file_->SetReadableEvent(event);
 }
 
 void Demuxer::Cancel() {
   cancelled_ = true;
+  if (ready_event_)
+    ready_event_->Signal();
 }
 
 Status Demuxer::SetHandler(const std::string& stream_label,
@@ -159,19 +228,38 @@ Status Demuxer::InitializeParser() {
     return Status(error::FILE_FAILURE,
                   "Cannot open file for reading " + file_name_);
   }
+  if (ready_event_)
+    media_file_->SetReadableEvent(ready_event_);
 
   // Read enough bytes before detecting the container.
+  const uint8_t* data = buffer_.data();
   int64_t bytes_read = 0;
-  while (static_cast<size_t>(bytes_read) < kInitBufSize) {
-    int64_t read_result =
-        media_file_->Read(buffer_.get() + bytes_read, kInitBufSize);
-    if (read_result < 0)
+  if (media_file_->SupportsReadInPlace()) {
+    bytes_read = media_file_->ReadInPlace(&data, kInitBufSize);
+    if (bytes_read < 0)
       return Status(error::FILE_FAILURE, "Cannot read file " + file_name_);
-    if (read_result == 0)
-      break;
-    bytes_read += read_result;
+    // Files read in place a block at a time may return less, in which case
+    // the rest is gathered in |buffer_|.
+    if (bytes_read > 0 && static_cast<size_t>(bytes_read) < kInitBufSize) {
+      memcpy(buffer_.data(), data, bytes_read);
+      data = buffer_.data();
+    }
+  }
+  if (data == buffer_.data()) {
+    while (static_cast<size_t>(bytes_read) < kInitBufSize) {
+      int64_t read_result =
+          media_file_->Read(buffer_.data() + bytes_read, kInitBufSize);
+      if (read_result < 0)
+        return Status(error::FILE_FAILURE, "Cannot read file " + file_name_);
+      if (read_result == 0)
+        break;
+      bytes_read += read_result;
+    }
   }
-  container_name_ = DetermineContainer(buffer_.get(), bytes_read);
+  // The file extension is usually right, so probe for that container first
+  // instead of running through every probe.
+  container_name_ = DetermineContainer(
+      data, bytes_read, DetermineContainerFromFileName(file_name_));
 
   // Initialize media parser.
   switch (container_name_) {
@@ -200,7 +288,7 @@ Status Demuxer::InitializeParser() {
     case CONTAINER_UNKNOWN: {
       const int64_t kDumpSizeLimit = 512;
       LOG(ERROR) << "Failed to detect the container type from the buffer: "
-                 << base::HexEncode(buffer_.get(),
+                 << base::HexEncode(data,
                                     std::min(bytes_read, kDumpSizeLimit));
       return Status(error::INVALID_ARGUMENT,
                     "Failed to detect the container type.");
@@ -210,27 +298,70 @@ Status Demuxer::InitializeParser() {
                        << " is not supported.";
       return Status(error::UNIMPLEMENTED, "Container not supported.");
   }
+  if (parser_for_testing_)
+    parser_ = std::move(parser_for_testing_);
 
   parser_->Init(
       base::Bind(&Demuxer::ParserInitEvent, base::Unretained(this)),
       base::Bind(&Demuxer::NewMediaSampleEvent, base::Unretained(this)),
       base::Bind(&Demuxer::NewTextSampleEvent, base::Unretained(this)),
       key_source_.get());
+  decryption_deferred_ =
+      defer_decryption_ && key_source_ && parser_->DeferDecryption();
+  // Otherwise all the frames are passed, and the trick play handlers drop
+  // them.
+  if (video_key_frames_only_ && !parser_->SetVideoKeyFramesOnly()) {
+    VLOG(1) << "All the video frames of '" << file_name_
+            << "' are read, though only key frames are needed.";
+  }
 
-  // Handle trailing 'moov'.
-  if (container_name_ == CONTAINER_MOV &&
-      File::IsLocalRegularFile(file_name_.c_str())) {
+  const bool is_local_regular_file =
+      File::IsLocalRegularFile(file_name_.c_str());
+  // Local WebM files are read one Cluster at a time, skipping the blocks of
+  // the tracks that are not needed.
+  if (container_name_ == CONTAINER_WEBM && is_local_regular_file &&
+      parser_->InitRandomAccess(file_name_)) {
+    random_access_parser_ = parser_.get();
+    InitializeParserTimeRange();
+    return Status::OK;
+  }
+  if (container_name_ == CONTAINER_MOV && is_local_regular_file) {
+    mp4::MP4MediaParser* mp4_parser =
+        static_cast<mp4::MP4MediaParser*>(parser_.get());
+    // Non-fragmented files are read at the sample offsets from the sample
+    // tables, so the data of the tracks that are not needed is never read.
+    if (mp4_parser->InitRandomAccess(file_name_)) {
+      random_access_parser_ = mp4_parser;
+      InitializeParserTimeRange();
+      return Status::OK;
+    }
+    // Handle trailing 'moov'.
     // TODO(kqyang): Investigate whether we can reuse the existing file
     // descriptor |media_file_| instead of opening the same file again.
-    static_cast<mp4::MP4MediaParser*>(parser_.get())->LoadMoov(file_name_);
+    mp4_parser->LoadMoov(file_name_);
   }
-  if (!parser_->Parse(buffer_.get(), bytes_read)) {
+  if (!parser_->Parse(data, bytes_read)) {
     return Status(error::PARSER_FAILURE,
                   "Cannot parse media file " + file_name_);
   }
   return Status::OK;
 }
 
+void Demuxer::InitializeParserTimeRange() {
+  if (!has_time_range_ ||
+      !random_access_parser_->SetTimeRange(start_seconds_, end_seconds_)) {
+    return;
+  }
+  time_range_in_parser_ = true;
+  // Only the text streams are left to cut here.
+  for (auto iter = time_ranges_.begin(); iter != time_ranges_.end();) {
+    if (iter->second.is_text)
+      ++iter;
+    else
+      iter = time_ranges_.erase(iter);
+  }
+}
+
 void Demuxer::ParserInitEvent(
     const std::vector<std::shared_ptr<StreamInfo>>& stream_infos) {
   if (dump_stream_info_) {
@@ -277,7 +408,12 @@ void Demuxer::ParserInitEvent(
           stream_info->stream_type() != kStreamVideo) {
         stream_info->set_language(iter->second);
       }
-      if (stream_info->is_encrypted()) {
+      if (has_time_range_) {
+        StreamTimeRange& range = time_ranges_[stream_info->track_id()];
+        range.time_scale = stream_info->time_scale();
+        range.is_text = stream_info->stream_type() == kStreamText;
+      }
+      if (stream_info->is_encrypted() && !decryption_deferred_) {
         init_event_status_.Update(Status(error::INVALID_ARGUMENT,
                                          "A decryption key source is not "
                                          "provided for an encrypted stream."));
@@ -292,15 +428,24 @@ void Demuxer::ParserInitEvent(
     ++base_stream_index;
   }
   all_streams_ready_ = true;
+
+  // Let the parser skip the samples of the tracks without handlers.
+  std::set<uint32_t> selected_track_ids;
+  for (const auto& pair : track_id_to_stream_index_map_) {
+    if (pair.second != kInvalidStreamIndex)
+      selected_track_ids.insert(pair.first);
+  }
+  parser_->SetSelectedTracks(selected_track_ids);
 }
 
 bool Demuxer::NewMediaSampleEvent(uint32_t track_id,
                                   std::shared_ptr<MediaSample> sample) {
+  // For live inputs, e.g. UDP, the data is read as soon as it arrives.
+  if (!last_read_time_.is_null())
+    sample->set_arrival_time(last_read_time_);
   if (!all_streams_ready_) {
-    if (queued_media_samples_.size() >= kQueuedSamplesLimit) {
-      LOG(ERROR) << "Queued samples limit reached: " << kQueuedSamplesLimit;
+    if (!QueueSample(QueuedSampleSize(*sample)))
       return false;
-    }
     queued_media_samples_.emplace_back(track_id, sample);
     return true;
   }
@@ -313,18 +458,19 @@ bool Demuxer::NewMediaSampleEvent(uint32_t track_id,
                          queued_media_samples_.front().sample)) {
       return false;
     }
+    queued_sample_bytes_ -=
+        QueuedSampleSize(*queued_media_samples_.front().sample);
     queued_media_samples_.pop_front();
   }
+  queued_sample_memory_.Set(queued_sample_bytes_);
   return PushMediaSample(track_id, sample);
 }
 
 bool Demuxer::NewTextSampleEvent(uint32_t track_id,
                                  std::shared_ptr<TextSample> sample) {
   if (!all_streams_ready_) {
-    if (queued_text_samples_.size() >= kQueuedSamplesLimit) {
-      LOG(ERROR) << "Queued samples limit reached: " << kQueuedSamplesLimit;
+    if (!QueueSample(QueuedSampleSize(*sample)))
       return false;
-    }
     queued_text_samples_.emplace_back(track_id, sample);
     return true;
   }
@@ -337,11 +483,26 @@ bool Demuxer::NewTextSampleEvent(uint32_t track_id,
                         queued_text_samples_.front().sample)) {
       return false;
     }
+    queued_sample_bytes_ -=
+        QueuedSampleSize(*queued_text_samples_.front().sample);
     queued_text_samples_.pop_front();
   }
+  queued_sample_memory_.Set(queued_sample_bytes_);
   return PushTextSample(track_id, sample);
 }
 
+bool Demuxer::QueueSample(size_t sample_size) {
+  queued_sample_bytes_ += sample_size;
+  queued_sample_memory_.Set(queued_sample_bytes_);
+  if (queued_sample_bytes_ > max_queued_sample_bytes_) {
+    LOG(ERROR) << "Queued samples exceed the budget of "
+               << max_queued_sample_bytes_
+               << " bytes before the stream info of all the streams is known.";
+    return false;
+  }
+  return true;
+}
+
 bool Demuxer::PushMediaSample(uint32_t track_id,
                               std::shared_ptr<MediaSample> sample) {
   auto stream_index_iter = track_id_to_stream_index_map_.find(track_id);
@@ -351,13 +512,17 @@ bool Demuxer::PushMediaSample(uint32_t track_id,
   }
   if (stream_index_iter->second == kInvalidStreamIndex)
     return true;
-  Status status = DispatchMediaSample(stream_index_iter->second, sample);
-  if (!status.ok()) {
-    LOG(ERROR) << "Failed to process sample " << stream_index_iter->second
-               << " " << status;
-    return false;
+  HOT_PATH_LOG(kDemuxer) << "Track " << track_id << " sample:\n "
+                         << sample->ToString();
+  auto range_iter = time_ranges_.find(track_id);
+  if (range_iter != time_ranges_.end()) {
+    if (!time_ranges_set_)
+      SetTimeRangesFrom(range_iter->second, sample->pts());
+    return AddMediaSampleInTimeRange(stream_index_iter->second,
+                                     &range_iter->second, std::move(sample));
   }
-  return true;
+  return AddPendingSample(StreamData::FromMediaSample(
+      stream_index_iter->second, std::move(sample)));
 }
 
 bool Demuxer::PushTextSample(uint32_t track_id,
@@ -369,21 +534,199 @@ bool Demuxer::PushTextSample(uint32_t track_id,
   }
   if (stream_index_iter->second == kInvalidStreamIndex)
     return true;
-  Status status = DispatchTextSample(stream_index_iter->second, sample);
+  auto range_iter = time_ranges_.find(track_id);
+  if (range_iter != time_ranges_.end()) {
+    StreamTimeRange& range = range_iter->second;
+    if (!time_ranges_set_)
+      SetTimeRangesFrom(range, sample->start_time());
+    if (range.end > 0 && sample->start_time() >= range.end) {
+      range.ended = true;
+      return true;
+    }
+    // The cues overlapping the time range are kept whole.
+    if (range.ended || sample->EndTime() <= range.start)
+      return true;
+  }
+  return AddPendingSample(
+      StreamData::FromTextSample(stream_index_iter->second, std::move(sample)));
+}
+
+bool Demuxer::AddPendingSample(std::unique_ptr<StreamData> stream_data) {
+  pending_samples_.push_back(std::move(stream_data));
+  if (pending_samples_.size() < kMaxPendingSamples)
+    return true;
+  Status status = DispatchPendingSamples();
   if (!status.ok()) {
-    LOG(ERROR) << "Failed to process sample " << stream_index_iter->second
-               << " " << status;
+    LOG(ERROR) << "Failed to process samples " << status;
     return false;
   }
   return true;
 }
 
+void Demuxer::SetTimeRangesFrom(const StreamTimeRange& range,
+                                int64_t first_timestamp) {
+  DCHECK_GT(range.time_scale, 0u);
+  const double first_timestamp_seconds =
+      static_cast<double>(first_timestamp) / range.time_scale;
+  for (auto& pair : time_ranges_) {
+    StreamTimeRange& stream_range = pair.second;
+    const uint32_t time_scale = stream_range.time_scale;
+    stream_range.start = static_cast<int64_t>(
+        (first_timestamp_seconds + start_seconds_) * time_scale);
+    if (end_seconds_ > 0) {
+      stream_range.end = static_cast<int64_t>(
+          (first_timestamp_seconds + end_seconds_) * time_scale);
+    }
+  }
+  time_ranges_set_ = true;
+}
+
+bool Demuxer::AddMediaSampleInTimeRange(size_t stream_index,
+                                        StreamTimeRange* range,
+                                        std::shared_ptr<MediaSample> sample) {
+  if (range->ended)
+    return true;
+  if (!range->started) {
+    // The stream starts at the last sync sample at or before |range->start|,
+    // which is only known once the next sync sample is after it.
+    if (!sample->is_key_frame() || sample->pts() <= range->start) {
+      if (sample->is_key_frame()) {
+        range->lead_in.clear();
+      } else if (range->lead_in.empty()) {
+        // Cannot be decoded without a preceding sync sample.
+        return true;
+      }
+      range->lead_in.push_back(std::move(sample));
+      return true;
+    }
+    range->started = true;
+    std::vector<std::shared_ptr<MediaSample>> lead_in;
+    lead_in.swap(range->lead_in);
+    for (std::shared_ptr<MediaSample>& lead_in_sample : lead_in) {
+      if (!AddMediaSampleInTimeRange(stream_index, range,
+                                     std::move(lead_in_sample))) {
+        return false;
+      }
+    }
+  }
+  if (range->end > 0 && sample->dts() >= range->end) {
+    range->ended = true;
+    return true;
+  }
+  return AddPendingSample(
+      StreamData::FromMediaSample(stream_index, std::move(sample)));
+}
+
+bool Demuxer::AddPendingLeadIns() {
+  for (auto& pair : time_ranges_) {
+    StreamTimeRange& range = pair.second;
+    if (range.started || range.lead_in.empty())
+      continue;
+    range.started = true;
+    const MediaSample& last = *range.lead_in.back();
+    // Otherwise the stream ends before the time range.
+    if (last.pts() + last.duration() > range.start) {
+      const size_t stream_index = track_id_to_stream_index_map_[pair.first];
+      for (std::shared_ptr<MediaSample>& sample : range.lead_in) {
+        if (!AddMediaSampleInTimeRange(stream_index, &range,
+                                       std::move(sample))) {
+          return false;
+        }
+      }
+    }
+    range.lead_in.clear();
+  }
+  return true;
+}
+
+bool Demuxer::AllTimeRangesEnded() const {
+  for (const auto& pair : time_ranges_) {
+    if (!pair.second.ended)
+      return false;
+  }
+  return !time_ranges_.empty();
+}
+
 Status Demuxer::Parse() {
+  Status status = ReadAndParse();
+  if (!status.ok() && status.error_code() != error::END_OF_STREAM) {
+    pending_samples_.clear();
+    return status;
+  }
+  if (status.error_code() == error::END_OF_STREAM && !AddPendingLeadIns()) {
+    pending_samples_.clear();
+    return Status(error::PARSER_FAILURE, "Failed to process samples.");
+  }
+  // The samples emitted while flushing the parser at the end of the stream
+  // are dispatched too.
+  RETURN_IF_ERROR(DispatchPendingSamples());
+  return status;
+}
+
+Status Demuxer::DispatchPendingSamples() {
+  if (pending_samples_.empty())
+    return Status::OK;
+  StreamDataBatch batch;
+  batch.swap(pending_samples_);
+  return DispatchBatch(std::move(batch));
+}
+
+Status Demuxer::ReadAndParse() {
   DCHECK(media_file_);
   DCHECK(parser_);
-  DCHECK(buffer_);
+  DCHECK(buffer_.data());
+
+  // The rest of the input is not read once all the streams are past the time
+  // range. Parsers that cut the streams stop by themselves.
+  if (!time_range_in_parser_ && AllTimeRangesEnded())
+    return Status(error::END_OF_STREAM, "");
+
+  // Reading less input gives the outputs, and the other jobs, time to release
+  // memory.
+  if (MemoryBudget::GetInstance()->exceeded()) {
+    TRACE_EVENT0("shaka", "Demuxer::WaitForMemoryBudget");
+    MemoryBudget::GetInstance()->WaitForBudget(
+        base::TimeDelta::FromMilliseconds(kMaxMemoryBudgetWaitInMs));
+  }
 
-  int64_t bytes_read = media_file_->Read(buffer_.get(), kBufSize);
+  if (random_access_parser_) {
+    TRACE_EVENT0("shaka", "Demuxer::ReadNextChunk");
+    bool end_of_stream = false;
+    if (!random_access_parser_->ReadNextChunk(&end_of_stream)) {
+      return Status(error::PARSER_FAILURE,
+                    "Cannot parse media file " + file_name_);
+    }
+    if (end_of_stream) {
+      if (!parser_->Flush())
+        return Status(error::PARSER_FAILURE, "Failed to flush.");
+      return Status(error::END_OF_STREAM, "");
+    }
+    return Status::OK;
+  }
+
+  // Files read in place, i.e. memory mapped files and files read through
+  // io_uring, hand out pointers into their own memory, which avoids copying
+  // the whole input through |buffer_|. The latter read the next blocks while
+  // this one is parsed.
+  const uint8_t* data = buffer_.data();
+  int64_t bytes_read = 0;
+  {
+    TRACE_EVENT0("shaka", "Demuxer::Read");
+    // For live inputs, this is mostly the time spent waiting for input.
+    ScopedLatencyMetric read_latency(
+        "packager_input_read_seconds", "Time spent reading the input.",
+        MetricLabel("input", file_name_));
+    bytes_read = media_file_->SupportsReadInPlace()
+                     ? media_file_->ReadInPlace(&data, kBufSize)
+                     : media_file_->Read(buffer_.data(), kBufSize);
+  }
+  if (Metrics::GetInstance()->enabled())
+    last_read_time_ = base::TimeTicks::Now();
+  if (bytes_read > 0) {
+    Metrics::GetInstance()->IncrementCounter(
+        "packager_input_bytes_total", "Number of bytes read from the input.",
+        MetricLabel("input", file_name_), bytes_read);
+  }
   if (bytes_read == 0) {
     if (!parser_->Flush())
       return Status(error::PARSER_FAILURE, "Failed to flush.");
@@ -392,11 +735,16 @@ Status Demuxer::Parse() {
     return Status(error::FILE_FAILURE, "Cannot read file " + file_name_);
   }
 
-  return parser_->Parse(buffer_.get(), bytes_read)
+  TRACE_EVENT1("shaka", "Demuxer::Parse", "bytes", bytes_read);
+  return parser_->Parse(data, bytes_read)
              ? Status::OK
              : Status(error::PARSER_FAILURE,
                       "Cannot parse media file " + file_name_);
 }
 
+void Demuxer::InjectParserForTesting(std::unique_ptr<MediaParser> parser) {
+  parser_for_testing_ = std::move(parser);
+}
+
 }  // namespace media
 }  // namespace shaka
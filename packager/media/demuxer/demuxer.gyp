@@ -13,10 +13,13 @@
       'target_name': 'demuxer',
       'type': '<(component)',
       'sources': [
+        'concat_demuxer.cc',
+        'concat_demuxer.h',
         'demuxer.cc',
         'demuxer.h',
       ],
       'dependencies': [
+        '../../file/file.gyp:file',
         '../base/media_base.gyp:media_base',
         '../formats/mp2t/mp2t.gyp:mp2t',
         '../formats/mp4/mp4.gyp:mp4',
@@ -30,6 +33,7 @@
       'target_name': 'demuxer_unittest',
       'type': '<(gtest_target_type)',
       'sources': [
+        'concat_demuxer_unittest.cc',
         'demuxer_unittest.cc',
       ],
       'dependencies': [
@@ -12,6 +12,9 @@
 #include <vector>
 
 #include "packager/base/compiler_specific.h"
+#include "packager/base/time/time.h"
+#include "packager/file/large_buffer.h"
+#include "packager/file/memory_budget.h"
 #include "packager/media/base/container_names.h"
 #include "packager/media/origin/origin_handler.h"
 #include "packager/status.h"
@@ -44,10 +47,52 @@ class Demuxer : public OriginHandler {
   ///        demuxed.
   void SetKeySource(std::unique_ptr<KeySource> key_source);
 
+  /// @return the KeySource for media decryption, or null if there is none.
+  KeySource* key_source() const { return key_source_.get(); }
+
+  /// Leaves the encrypted samples encrypted if the parser supports it, so they
+  /// can be decrypted downstream with key_source(), e.g. to re-encrypt them
+  /// without a clear copy. Has no effect without a KeySource.
+  void set_defer_decryption(bool defer_decryption) {
+    defer_decryption_ = defer_decryption;
+  }
+
+  /// Passes only the key frames of the video streams, extended to the next
+  /// key frame, if the parser supports it, so the other video frames need not
+  /// be read. For inputs whose video only feeds trick play outputs.
+  void set_video_key_frames_only(bool video_key_frames_only) {
+    video_key_frames_only_ = video_key_frames_only;
+  }
+
+  /// Passes only the samples in a time range. Each audio and video stream
+  /// starts at its sync sample at or before @a start_seconds, and the samples
+  /// decoded at or after @a end_seconds are dropped. Parsers that support it
+  /// skip the data before the time range, and the input is not read past it.
+  /// The times are relative to the timestamp of the first sample of the
+  /// input, e.g. for MPEG2-TS inputs, whose timestamps do not start at 0.
+  /// @param start_seconds is the start of the time range.
+  /// @param end_seconds is the end of the time range, or 0 for the end of the
+  ///        input.
+  void set_time_range(double start_seconds, double end_seconds) {
+    has_time_range_ = true;
+    start_seconds_ = start_seconds;
+    end_seconds_ = end_seconds;
+  }
+
   /// Drive the remuxing from demuxer side (push). Read the file and push
   /// the Data to Muxer until Eof.
   Status Run() override;
 
+  /// Parse one buffer of the file. Run() is the same as calling this until
+  /// @a done is set.
+  Status RunStep(bool* done) override;
+
+  /// @return false if parsing the next buffer would wait for the input.
+  bool IsReadyToRunStep() override;
+
+  /// Signals @a event when data arrives from the input.
+  void SetReadyEvent(base::WaitableEvent* event) override;
+
   /// Cancel a demuxing job in progress. Will cause @a Run to exit with an error
   /// status of type CANCELLED.
   void Cancel() override;
@@ -71,6 +116,13 @@ class Demuxer : public OriginHandler {
   void SetLanguageOverride(const std::string& stream_label,
                            const std::string& language_override);
 
+  /// Sets the budget, in bytes, of the samples queued across all the streams
+  /// before their stream info is known. Demuxing fails once the queued
+  /// samples exceed it.
+  void set_max_queued_sample_bytes(uint64_t max_queued_sample_bytes) {
+    max_queued_sample_bytes_ = max_queued_sample_bytes;
+  }
+
   void set_dump_stream_info(bool dump_stream_info) {
     dump_stream_info_ = dump_stream_info;
   }
@@ -91,9 +143,26 @@ class Demuxer : public OriginHandler {
   /// @}
 
  private:
+  friend class DemuxerTest;
+
   Demuxer(const Demuxer&) = delete;
   Demuxer& operator=(const Demuxer&) = delete;
 
+  // The time range of a stream, in the stream's time scale. |start| and
+  // |end| are set once the first sample of the input is received.
+  struct StreamTimeRange {
+    int64_t start = 0;
+    // 0 if the stream is not cut at the end.
+    int64_t end = 0;
+    uint32_t time_scale = 0;
+    bool is_text = false;
+    bool started = false;
+    bool ended = false;
+    // The samples from the last sync sample before |start|, held until the
+    // stream is known to start there.
+    std::vector<std::shared_ptr<MediaSample>> lead_in;
+  };
+
   template <typename T>
   struct QueuedSample {
     QueuedSample(uint32_t track_id, std::shared_ptr<T> sample)
@@ -109,6 +178,9 @@ class Demuxer : public OriginHandler {
   // of the media file to extract stream information.
   // @return OK on success.
   Status InitializeParser();
+  // Lets the random access parser cut the audio and video streams to the time
+  // range if it supports it.
+  void InitializeParserTimeRange();
 
   // Parser init event.
   void ParserInitEvent(const std::vector<std::shared_ptr<StreamInfo>>& streams);
@@ -119,21 +191,67 @@ class Demuxer : public OriginHandler {
                            std::shared_ptr<MediaSample> sample);
   bool NewTextSampleEvent(uint32_t track_id,
                           std::shared_ptr<TextSample> sample);
+  // Accounts for a sample queued before ParserInitEvent().
+  // @return false if the queued samples exceed the budget.
+  bool QueueSample(size_t sample_size);
   // Helper function to push the sample to corresponding stream.
   bool PushMediaSample(uint32_t track_id, std::shared_ptr<MediaSample> sample);
   bool PushTextSample(uint32_t track_id, std::shared_ptr<TextSample> sample);
+  // Adds the sample to |pending_samples_|, dispatching them when there are
+  // enough.
+  bool AddPendingSample(std::unique_ptr<StreamData> stream_data);
+  // Sets the start and end of |time_ranges_| from the timestamp of the first
+  // sample of the input, in the time scale of |range|.
+  void SetTimeRangesFrom(const StreamTimeRange& range,
+                         int64_t first_timestamp);
+  // Cuts the stream to |range| before adding the sample.
+  bool AddMediaSampleInTimeRange(size_t stream_index,
+                                 StreamTimeRange* range,
+                                 std::shared_ptr<MediaSample> sample);
+  // Adds the lead-ins of the streams that did not start, which cover the
+  // start of the time range if the streams end right after it.
+  bool AddPendingLeadIns();
+  bool AllTimeRangesEnded() const;
 
-  // Read from the source and send it to the parser.
+  // Read from the source and send it to the parser, then dispatch the samples
+  // it emitted.
   Status Parse();
+  Status ReadAndParse();
+  // Dispatch |pending_samples_| downstream as a batch.
+  Status DispatchPendingSamples();
+
+  // Testing injection. |parser| replaces the parser of the container
+  // detected.
+  void InjectParserForTesting(std::unique_ptr<MediaParser> parser);
+
+  enum class RunState {
+    kNotStarted,
+    // Parsing until the stream info of all the streams is known.
+    kParsingStreamInfo,
+    kParsing,
+  };
 
   std::string file_name_;
   File* media_file_ = nullptr;
+  RunState run_state_ = RunState::kNotStarted;
   // A stream is considered ready after receiving the stream info.
   bool all_streams_ready_ = false;
   // Queued samples received in NewSampleEvent() before ParserInitEvent().
   std::deque<QueuedSample<MediaSample>> queued_media_samples_;
   std::deque<QueuedSample<TextSample>> queued_text_samples_;
+  // Estimated memory used by the queued samples, in bytes.
+  uint64_t queued_sample_bytes_ = 0;
+  uint64_t max_queued_sample_bytes_;
+  // |queued_sample_bytes_| accounted to the process-wide memory budget.
+  AccountedMemory queued_sample_memory_;
+  // Samples pushed while parsing, dispatched together after the parser
+  // returns.
+  StreamDataBatch pending_samples_;
   std::unique_ptr<MediaParser> parser_;
+  std::unique_ptr<MediaParser> parser_for_testing_;
+  // Points to |parser_| if the samples are read with random access reads
+  // instead of parsing the file as a stream. Null otherwise.
+  MediaParser* random_access_parser_ = nullptr;
   // TrackId -> StreamIndex map.
   std::map<uint32_t, size_t> track_id_to_stream_index_map_;
   // The list of stream indexes in the above map (in the same order as the input
@@ -142,11 +260,28 @@ class Demuxer : public OriginHandler {
   // StreamIndex -> language_override map.
   std::map<size_t, std::string> language_overrides_;
   MediaContainerName container_name_ = CONTAINER_UNKNOWN;
-  std::unique_ptr<uint8_t[]> buffer_;
+  LargeBuffer buffer_;
+  // Time the last data was read from the input, which the samples parsed
+  // from it are stamped with. Null unless metrics are enabled.
+  base::TimeTicks last_read_time_;
   std::unique_ptr<KeySource> key_source_;
   bool cancelled_ = false;
+  base::WaitableEvent* ready_event_ = nullptr;
   // Whether to dump stream info when it is received.
   bool dump_stream_info_ = false;
+  bool defer_decryption_ = false;
+  bool video_key_frames_only_ = false;
+  bool has_time_range_ = false;
+  double start_seconds_ = 0;
+  double end_seconds_ = 0;
+  // Whether the parser cuts the audio and video streams to the time range.
+  bool time_range_in_parser_ = false;
+  // TrackId -> time range of the streams cut here.
+  std::map<uint32_t, StreamTimeRange> time_ranges_;
+  // Whether the start and end of |time_ranges_| are set.
+  bool time_ranges_set_ = false;
+  // Whether the parser has left the encrypted samples encrypted.
+  bool decryption_deferred_ = false;
   Status init_event_status_;
 };
 
@@ -9,9 +9,19 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/file/file.h"
+#include "packager/file/memory_file.h"
+#include "packager/media/base/decryptor_source.h"
 #include "packager/media/base/media_handler_test_base.h"
+#include "packager/media/base/media_parser.h"
+#include "packager/media/base/media_sample.h"
 #include "packager/media/base/raw_key_source.h"
 #include "packager/media/test/test_data_util.h"
+#include "packager/status_macros.h"
 #include "packager/status_test_util.h"
 
 namespace shaka {
@@ -27,10 +37,95 @@ class MockKeySource : public RawKeySource {
   MOCK_METHOD2(GetKey,
                Status(const std::vector<uint8_t>& key_id, EncryptionKey* key));
 };
+
+// A parser which emits |num_queued_samples| samples of |sample_size| bytes
+// before |stream_info|, so that the demuxer queues them, then one more.
+class FakeMediaParser : public MediaParser {
+ public:
+  FakeMediaParser(std::shared_ptr<StreamInfo> stream_info,
+                  size_t num_queued_samples,
+                  size_t sample_size)
+      : stream_info_(std::move(stream_info)),
+        num_queued_samples_(num_queued_samples),
+        sample_data_(sample_size) {}
+
+  void Init(const InitCB& init_cb,
+            const NewMediaSampleCB& new_media_sample_cb,
+            const NewTextSampleCB& new_text_sample_cb,
+            KeySource* decryption_key_source) override {
+    init_cb_ = init_cb;
+    new_media_sample_cb_ = new_media_sample_cb;
+  }
+
+  bool Flush() override { return true; }
+
+  bool Parse(const uint8_t* buf, int size) override {
+    if (parsed_)
+      return true;
+    parsed_ = true;
+    const bool kIsKeyFrame = true;
+    for (size_t i = 0; i <= num_queued_samples_; ++i) {
+      if (i == num_queued_samples_)
+        init_cb_.Run({stream_info_});
+      std::shared_ptr<MediaSample> sample = MediaSample::CopyFrom(
+          sample_data_.data(), sample_data_.size(), kIsKeyFrame);
+      sample->set_dts(i);
+      sample->set_pts(i);
+      sample->set_duration(1);
+      if (!new_media_sample_cb_.Run(stream_info_->track_id(), sample))
+        return false;
+    }
+    return true;
+  }
+
+ private:
+  std::shared_ptr<StreamInfo> stream_info_;
+  const size_t num_queued_samples_;
+  const std::vector<uint8_t> sample_data_;
+  InitCB init_cb_;
+  NewMediaSampleCB new_media_sample_cb_;
+  bool parsed_ = false;
+};
+
+const char kFakeInput[] = "memory://input.vtt";
+// More than the demuxer reads to detect the container.
+const size_t kFakeInputSize = 1 << 17;
+const uint32_t kTimeScale = 1000;
+const size_t kNumQueuedSamples = 10;
+const size_t kSampleSize = 1000;
 }  // namespace
 
 class DemuxerTest : public MediaHandlerGraphTestBase {
  protected:
+  void TearDown() override { MemoryFile::DeleteAll(); }
+
+  // Demuxes samples from a FakeMediaParser with a budget of
+  // |max_queued_sample_bytes| for the queued samples.
+  // @return the status of the demuxer. |num_samples| is set to the number of
+  //         samples demuxed.
+  Status DemuxFakeInput(uint64_t max_queued_sample_bytes,
+                        size_t* num_samples) {
+    // The input only needs to be detected as some container.
+    std::string content = "WEBVTT\n\n";
+    content.resize(kFakeInputSize, '\n');
+    if (!File::WriteStringToFile(kFakeInput, content))
+      return Status(error::FILE_FAILURE, "Cannot write the input.");
+    Demuxer demuxer(kFakeInput);
+    demuxer.InjectParserForTesting(std::unique_ptr<MediaParser>(
+        new FakeMediaParser(GetVideoStreamInfo(kTimeScale), kNumQueuedSamples,
+                            kSampleSize)));
+    demuxer.set_max_queued_sample_bytes(max_queued_sample_bytes);
+    std::shared_ptr<CachingMediaHandler> handler(new CachingMediaHandler);
+    RETURN_IF_ERROR(demuxer.SetHandler("video", handler));
+    Status status = demuxer.Run();
+    *num_samples = 0;
+    for (const auto& stream_data : handler->Cache()) {
+      if (stream_data->stream_data_type == StreamDataType::kMediaSample)
+        ++*num_samples;
+    }
+    return status;
+  }
+
   EncryptionKey GetMockEncryptionKey() {
     const uint8_t kKeyId[]{
         0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
@@ -45,6 +140,70 @@ class DemuxerTest : public MediaHandlerGraphTestBase {
     encryption_key.key.assign(kKey, kKey + sizeof(kKey));
     return encryption_key;
   }
+
+  // Runs |demuxer| with a handler for its video stream.
+  // @return the video samples. |time_scale| is set to the time scale of the
+  //         video stream.
+  std::vector<std::shared_ptr<const MediaSample>> DemuxVideo(
+      Demuxer* demuxer,
+      uint32_t* time_scale) {
+    std::shared_ptr<CachingMediaHandler> handler(new CachingMediaHandler);
+    EXPECT_OK(demuxer->SetHandler("video", handler));
+    EXPECT_OK(demuxer->Run());
+    std::vector<std::shared_ptr<const MediaSample>> samples;
+    for (const auto& stream_data : handler->Cache()) {
+      if (stream_data->stream_data_type == StreamDataType::kStreamInfo)
+        *time_scale = stream_data->stream_info()->time_scale();
+      if (stream_data->stream_data_type == StreamDataType::kMediaSample)
+        samples.push_back(stream_data->media_sample());
+    }
+    return samples;
+  }
+
+  // Checks that the time range of |file_name| is relative to its first
+  // timestamp.
+  void TestTimeRange(const std::string& file_name) {
+    const double kStartSeconds = 1.0;
+    const double kEndSeconds = 2.0;
+    const std::string file_path =
+        GetTestDataFilePath(file_name).AsUTF8Unsafe();
+
+    uint32_t time_scale = 0;
+    Demuxer full_demuxer(file_path);
+    const std::vector<std::shared_ptr<const MediaSample>> all_samples =
+        DemuxVideo(&full_demuxer, &time_scale);
+    ASSERT_FALSE(all_samples.empty());
+    ASSERT_GT(time_scale, 0u);
+
+    Demuxer demuxer(file_path);
+    demuxer.set_time_range(kStartSeconds, kEndSeconds);
+    const std::vector<std::shared_ptr<const MediaSample>> samples =
+        DemuxVideo(&demuxer, &time_scale);
+
+    const int64_t first_timestamp = all_samples[0]->pts();
+    const int64_t start =
+        first_timestamp + static_cast<int64_t>(kStartSeconds * time_scale);
+    const int64_t end =
+        first_timestamp + static_cast<int64_t>(kEndSeconds * time_scale);
+    // From the last sync sample at or before the start, up to the first
+    // sample decoded at or after the end.
+    size_t first = 0;
+    for (size_t i = 0; i < all_samples.size(); ++i) {
+      if (all_samples[i]->is_key_frame() && all_samples[i]->pts() <= start)
+        first = i;
+    }
+    size_t last = first;
+    while (last < all_samples.size() && all_samples[last]->dts() < end)
+      ++last;
+    ASSERT_LT(first, last);
+    ASSERT_LT(last - first, all_samples.size());
+
+    ASSERT_EQ(last - first, samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+      EXPECT_EQ(all_samples[first + i]->pts(), samples[i]->pts());
+      EXPECT_EQ(all_samples[first + i]->data_size(), samples[i]->data_size());
+    }
+  }
 };
 
 TEST_F(DemuxerTest, FileNotFound) {
@@ -72,6 +231,138 @@ TEST_F(DemuxerTest, EncryptedContentWithKeySource) {
   EXPECT_OK(demuxer.Run());
 }
 
+// The samples whose decryption is deferred decrypt downstream to the samples
+// decrypted by the demuxer.
+TEST_F(DemuxerTest, DeferredDecryption) {
+  const std::string file_path =
+      GetAppTestDataFilePath("encryption/bear-640x360-video.mp4")
+          .AsUTF8Unsafe();
+  uint32_t time_scale = 0;
+
+  std::unique_ptr<MockKeySource> key_source(new MockKeySource);
+  EXPECT_CALL(*key_source, GetKey(_, _))
+      .WillRepeatedly(
+          DoAll(SetArgPointee<1>(GetMockEncryptionKey()), Return(Status::OK)));
+  Demuxer demuxer(file_path);
+  demuxer.SetKeySource(std::move(key_source));
+  const std::vector<std::shared_ptr<const MediaSample>> clear_samples =
+      DemuxVideo(&demuxer, &time_scale);
+
+  key_source.reset(new MockKeySource);
+  EXPECT_CALL(*key_source, GetKey(_, _))
+      .WillRepeatedly(
+          DoAll(SetArgPointee<1>(GetMockEncryptionKey()), Return(Status::OK)));
+  Demuxer deferring_demuxer(file_path);
+  deferring_demuxer.SetKeySource(std::move(key_source));
+  deferring_demuxer.set_defer_decryption(true);
+  const std::vector<std::shared_ptr<const MediaSample>> encrypted_samples =
+      DemuxVideo(&deferring_demuxer, &time_scale);
+
+  ASSERT_FALSE(clear_samples.empty());
+  ASSERT_EQ(clear_samples.size(), encrypted_samples.size());
+  DecryptorSource decryptor_source(deferring_demuxer.key_source());
+  size_t num_encrypted_samples = 0;
+  for (size_t i = 0; i < clear_samples.size(); ++i) {
+    const MediaSample& clear_sample = *clear_samples[i];
+    const MediaSample& encrypted_sample = *encrypted_samples[i];
+    EXPECT_FALSE(clear_sample.decrypt_config());
+    EXPECT_EQ(clear_sample.pts(), encrypted_sample.pts());
+    ASSERT_EQ(clear_sample.data_size(), encrypted_sample.data_size());
+    if (!encrypted_sample.decrypt_config()) {
+      // The clear lead.
+      EXPECT_EQ(std::vector<uint8_t>(clear_sample.data(),
+                                     clear_sample.data() +
+                                         clear_sample.data_size()),
+                std::vector<uint8_t>(encrypted_sample.data(),
+                                     encrypted_sample.data() +
+                                         encrypted_sample.data_size()));
+      continue;
+    }
+    ++num_encrypted_samples;
+    std::vector<uint8_t> decrypted(encrypted_sample.data_size());
+    ASSERT_TRUE(decryptor_source.DecryptSampleBuffer(
+        encrypted_sample.decrypt_config(), encrypted_sample.data(),
+        encrypted_sample.data_size(), decrypted.data()));
+    EXPECT_EQ(std::vector<uint8_t>(clear_sample.data(),
+                                   clear_sample.data() +
+                                       clear_sample.data_size()),
+              decrypted);
+  }
+  EXPECT_GT(num_encrypted_samples, 0u);
+}
+
+TEST_F(DemuxerTest, RunSteps) {
+  const std::string file_path =
+      GetTestDataFilePath("bear-640x360.mp4").AsUTF8Unsafe();
+  uint32_t time_scale = 0;
+  Demuxer demuxer(file_path);
+  const std::vector<std::shared_ptr<const MediaSample>> expected_samples =
+      DemuxVideo(&demuxer, &time_scale);
+
+  Demuxer stepped_demuxer(file_path);
+  std::shared_ptr<CachingMediaHandler> handler(new CachingMediaHandler);
+  ASSERT_OK(stepped_demuxer.SetHandler("video", handler));
+  int num_steps = 0;
+  bool done = false;
+  while (!done) {
+    EXPECT_TRUE(stepped_demuxer.IsReadyToRunStep());
+    ASSERT_OK(stepped_demuxer.RunStep(&done));
+    ++num_steps;
+  }
+  // A step parses a buffer, not the whole file.
+  EXPECT_GT(num_steps, 2);
+
+  std::vector<std::shared_ptr<const MediaSample>> samples;
+  for (const auto& stream_data : handler->Cache()) {
+    if (stream_data->stream_data_type == StreamDataType::kMediaSample)
+      samples.push_back(stream_data->media_sample());
+  }
+  ASSERT_EQ(expected_samples.size(), samples.size());
+  for (size_t i = 0; i < samples.size(); ++i) {
+    EXPECT_EQ(expected_samples[i]->pts(), samples[i]->pts());
+    EXPECT_EQ(expected_samples[i]->data_size(), samples[i]->data_size());
+  }
+}
+
+TEST_F(DemuxerTest, CancelledRunStep) {
+  Demuxer demuxer(GetTestDataFilePath("bear-640x360.mp4").AsUTF8Unsafe());
+  std::shared_ptr<CachingMediaHandler> handler(new CachingMediaHandler);
+  ASSERT_OK(demuxer.SetHandler("video", handler));
+  demuxer.Cancel();
+  EXPECT_TRUE(demuxer.IsReadyToRunStep());
+
+  Status status;
+  bool done = false;
+  while (!done)
+    status = demuxer.RunStep(&done);
+  EXPECT_EQ(error::CANCELLED, status.error_code());
+}
+
+TEST_F(DemuxerTest, QueuedSamplesWithinBudget) {
+  const uint64_t kMaxQueuedSampleBytes = 2 * kNumQueuedSamples * kSampleSize;
+  size_t num_samples = 0;
+  ASSERT_OK(DemuxFakeInput(kMaxQueuedSampleBytes, &num_samples));
+  EXPECT_EQ(kNumQueuedSamples + 1, num_samples);
+}
+
+TEST_F(DemuxerTest, QueuedSamplesExceedingBudget) {
+  // The data of the queued samples alone exceeds the budget.
+  const uint64_t kMaxQueuedSampleBytes = kNumQueuedSamples * kSampleSize - 1;
+  size_t num_samples = 0;
+  EXPECT_EQ(error::PARSER_FAILURE,
+            DemuxFakeInput(kMaxQueuedSampleBytes, &num_samples).error_code());
+  EXPECT_EQ(0u, num_samples);
+}
+
+TEST_F(DemuxerTest, TimeRangeMp4) {
+  TestTimeRange("bear-640x360.mp4");
+}
+
+// The timestamps of the input do not start at 0.
+TEST_F(DemuxerTest, TimeRangeTs) {
+  TestTimeRange("bear-640x360.ts");
+}
+
 // TODO(kqyang): Add more tests.
 
 }  // namespace media
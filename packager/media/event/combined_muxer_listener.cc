@@ -6,6 +6,10 @@
 
 #include "packager/media/event/combined_muxer_listener.h"
 
+#include "packager/media/base/segment_digest.h"
+#include "packager/media/event/muxer_listener_internal.h"
+#include "packager/mpd/base/media_info.pb.h"
+
 namespace shaka {
 namespace media {
 
@@ -37,9 +41,22 @@ void CombinedMuxerListener::OnMediaStart(const MuxerOptions& muxer_options,
                                          const StreamInfo& stream_info,
                                          uint32_t time_scale,
                                          ContainerType container_type) {
+  // The MediaInfo is generated once for all the listeners.
+  OnMediaStartWithMediaInfo(
+      muxer_options, stream_info, time_scale, container_type,
+      internal::GenerateMediaInfo(muxer_options, stream_info, time_scale,
+                                  container_type));
+}
+
+void CombinedMuxerListener::OnMediaStartWithMediaInfo(
+    const MuxerOptions& muxer_options,
+    const StreamInfo& stream_info,
+    uint32_t time_scale,
+    ContainerType container_type,
+    std::shared_ptr<const MediaInfo> media_info) {
   for (auto& listener : muxer_listeners_) {
-    listener->OnMediaStart(muxer_options, stream_info, time_scale,
-                           container_type);
+    listener->OnMediaStartWithMediaInfo(muxer_options, stream_info, time_scale,
+                                        container_type, media_info);
   }
 }
 
@@ -65,6 +82,28 @@ void CombinedMuxerListener::OnNewSegment(const std::string& file_name,
   }
 }
 
+void CombinedMuxerListener::OnNewPartialSegment(
+    const std::string& partial_segment_name,
+    int64_t start_time,
+    int64_t duration,
+    uint64_t partial_segment_file_size,
+    bool independent,
+    const std::string& next_partial_segment_name) {
+  for (auto& listener : muxer_listeners_) {
+    listener->OnNewPartialSegment(partial_segment_name, start_time, duration,
+                                  partial_segment_file_size, independent,
+                                  next_partial_segment_name);
+  }
+}
+
+void CombinedMuxerListener::OnSegmentDigests(
+    const std::string& segment_name,
+    const std::vector<SegmentDigest>& digests) {
+  for (auto& listener : muxer_listeners_) {
+    listener->OnSegmentDigests(segment_name, digests);
+  }
+}
+
 void CombinedMuxerListener::OnKeyFrame(int64_t timestamp,
                                        uint64_t start_byte_offset,
                                        uint64_t size) {
@@ -36,6 +36,12 @@ class CombinedMuxerListener : public MuxerListener {
                     const StreamInfo& stream_info,
                     uint32_t time_scale,
                     ContainerType container_type) override;
+  void OnMediaStartWithMediaInfo(
+      const MuxerOptions& muxer_options,
+      const StreamInfo& stream_info,
+      uint32_t time_scale,
+      ContainerType container_type,
+      std::shared_ptr<const MediaInfo> media_info) override;
   void OnSampleDurationReady(uint32_t sample_duration) override;
   void OnMediaEnd(const MediaRanges& media_ranges,
                   float duration_seconds) override;
@@ -43,6 +49,15 @@ class CombinedMuxerListener : public MuxerListener {
                     int64_t start_time,
                     int64_t duration,
                     uint64_t segment_file_size) override;
+  void OnNewPartialSegment(
+      const std::string& partial_segment_name,
+      int64_t start_time,
+      int64_t duration,
+      uint64_t partial_segment_file_size,
+      bool independent,
+      const std::string& next_partial_segment_name) override;
+  void OnSegmentDigests(const std::string& segment_name,
+                        const std::vector<SegmentDigest>& digests) override;
   void OnKeyFrame(int64_t timestamp, uint64_t start_byte_offset, uint64_t size);
   void OnCueEvent(int64_t timestamp, const std::string& cue_data) override;
   /// @}
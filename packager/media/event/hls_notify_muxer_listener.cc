@@ -86,12 +86,23 @@ void HlsNotifyMuxerListener::OnMediaStart(const MuxerOptions& muxer_options,
                                           const StreamInfo& stream_info,
                                           uint32_t time_scale,
                                           ContainerType container_type) {
-  std::unique_ptr<MediaInfo> media_info(new MediaInfo);
-  if (!internal::GenerateMediaInfo(muxer_options, stream_info, time_scale,
-                                   container_type, media_info.get())) {
+  OnMediaStartWithMediaInfo(
+      muxer_options, stream_info, time_scale, container_type,
+      internal::GenerateMediaInfo(muxer_options, stream_info, time_scale,
+                                  container_type));
+}
+
+void HlsNotifyMuxerListener::OnMediaStartWithMediaInfo(
+    const MuxerOptions& muxer_options,
+    const StreamInfo& stream_info,
+    uint32_t time_scale,
+    ContainerType container_type,
+    std::shared_ptr<const MediaInfo> generated_media_info) {
+  if (!generated_media_info) {
     LOG(ERROR) << "Failed to generate MediaInfo from input.";
     return;
   }
+  std::unique_ptr<MediaInfo> media_info(new MediaInfo(*generated_media_info));
   if (!characteristics_.empty()) {
     for (const std::string& characteristic : characteristics_)
       media_info->add_hls_characteristics(characteristic);
@@ -103,12 +114,15 @@ void HlsNotifyMuxerListener::OnMediaStart(const MuxerOptions& muxer_options,
   }
 
   // The content may be splitted into multiple files, but their MediaInfo
-  // should be compatible.
+  // should be compatible. Otherwise, e.g. when concatenated inputs have
+  // different codec configurations, the playlist goes on after a
+  // discontinuity.
   if (media_info_ &&
       !internal::IsMediaInfoCompatible(*media_info, *media_info_)) {
     LOG(WARNING) << "Incompatible MediaInfo " << media_info->ShortDebugString()
                  << " vs " << media_info_->ShortDebugString()
                  << ". The result manifest may not be playable.";
+    must_notify_discontinuity_ = true;
   }
   media_info_ = std::move(media_info);
 
@@ -116,6 +130,14 @@ void HlsNotifyMuxerListener::OnMediaStart(const MuxerOptions& muxer_options,
     return;
   }
 
+  if (stream_id_) {
+    // The muxer started over in the same playlist.
+    if (must_notify_discontinuity_) {
+      hls_notifier_->NotifyDiscontinuity(stream_id_.value());
+      must_notify_discontinuity_ = false;
+    }
+    return;
+  }
   if (!NotifyNewStream())
     return;
   DCHECK(stream_id_);
@@ -172,7 +194,10 @@ void HlsNotifyMuxerListener::OnMediaEnd(const MediaRanges& media_ranges,
     DCHECK(stream_id_);
   } else {
     // HLS is not interested in MediaInfo update.
+    if (must_notify_discontinuity_)
+      hls_notifier_->NotifyDiscontinuity(stream_id_.value());
   }
+  must_notify_discontinuity_ = false;
 
   // TODO(rkuroiwa); Keep track of which (sub)segments are encrypted so that the
   // notification is sent right before the enecrypted (sub)segments.
@@ -219,7 +244,7 @@ void HlsNotifyMuxerListener::OnMediaEnd(const MediaRanges& media_ranges,
       LOG(WARNING) << "Number of subsegment ranges (" << num_subsegments
                    << ") does not match the number of subsegments notified to "
                       "OnNewSegment() ("
-                   << event_info_.size() << ").";
+                   << subsegment_index << ").";
     }
   }
   event_info_.clear();
@@ -244,6 +269,24 @@ void HlsNotifyMuxerListener::OnNewSegment(const std::string& file_name,
   }
 }
 
+void HlsNotifyMuxerListener::OnNewPartialSegment(
+    const std::string& partial_segment_name,
+    int64_t start_time,
+    int64_t duration,
+    uint64_t partial_segment_file_size,
+    bool independent,
+    const std::string& next_partial_segment_name) {
+  // Partial segments are only generated for segment template outputs in live
+  // mode, so there is no need to delay the notification. I-Frames Only
+  // playlists do not list partial segments.
+  if (iframes_only_ || !media_info_->has_segment_template())
+    return;
+  const bool result = hls_notifier_->NotifyNewPartialSegment(
+      stream_id_.value(), partial_segment_name, start_time, duration,
+      partial_segment_file_size, independent, next_partial_segment_name);
+  LOG_IF(WARNING, !result) << "Failed to add new partial segment.";
+}
+
 void HlsNotifyMuxerListener::OnKeyFrame(int64_t timestamp,
                                         uint64_t start_byte_offset,
                                         uint64_t size) {
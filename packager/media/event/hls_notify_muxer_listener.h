@@ -61,6 +61,12 @@ class HlsNotifyMuxerListener : public MuxerListener {
                     const StreamInfo& stream_info,
                     uint32_t time_scale,
                     ContainerType container_type) override;
+  void OnMediaStartWithMediaInfo(
+      const MuxerOptions& muxer_options,
+      const StreamInfo& stream_info,
+      uint32_t time_scale,
+      ContainerType container_type,
+      std::shared_ptr<const MediaInfo> media_info) override;
   void OnSampleDurationReady(uint32_t sample_duration) override;
   void OnMediaEnd(const MediaRanges& media_ranges,
                   float duration_seconds) override;
@@ -68,6 +74,13 @@ class HlsNotifyMuxerListener : public MuxerListener {
                     int64_t start_time,
                     int64_t duration,
                     uint64_t segment_file_size) override;
+  void OnNewPartialSegment(
+      const std::string& partial_segment_name,
+      int64_t start_time,
+      int64_t duration,
+      uint64_t partial_segment_file_size,
+      bool independent,
+      const std::string& next_partial_segment_name) override;
   void OnKeyFrame(int64_t timestamp, uint64_t start_byte_offset, uint64_t size);
   void OnCueEvent(int64_t timestamp, const std::string& cue_data) override;
   /// @}
@@ -87,6 +100,8 @@ class HlsNotifyMuxerListener : public MuxerListener {
   base::Optional<uint32_t> stream_id_;
 
   bool must_notify_encryption_start_ = false;
+  // Set when the codec configuration changes after the stream is notified.
+  bool must_notify_discontinuity_ = false;
   // Cached encryption info before OnMediaStart() is called.
   std::vector<uint8_t> next_key_id_;
   std::vector<uint8_t> next_iv_;
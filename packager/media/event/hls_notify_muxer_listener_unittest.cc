@@ -18,10 +18,13 @@ namespace media {
 
 using ::testing::_;
 using ::testing::Bool;
+using ::testing::DoAll;
 using ::testing::ElementsAre;
 using ::testing::InSequence;
+using ::testing::Mock;
 using ::testing::Property;
 using ::testing::Return;
+using ::testing::SetArgPointee;
 using ::testing::StrEq;
 using ::testing::TestWithParam;
 
@@ -47,12 +50,21 @@ class MockHlsNotifier : public hls::HlsNotifier {
                     uint64_t duration,
                     uint64_t start_byte_offset,
                     uint64_t size));
+  MOCK_METHOD7(NotifyNewPartialSegment,
+               bool(uint32_t stream_id,
+                    const std::string& partial_segment_name,
+                    uint64_t start_time,
+                    uint64_t duration,
+                    uint64_t size,
+                    bool independent,
+                    const std::string& next_partial_segment_name));
   MOCK_METHOD4(NotifyKeyFrame,
                bool(uint32_t stream_id,
                     uint64_t timestamp,
                     uint64_t start_byte_offset,
                     uint64_t size));
   MOCK_METHOD2(NotifyCueEvent, bool(uint32_t stream_id, uint64_t timestamp));
+  MOCK_METHOD1(NotifyDiscontinuity, bool(uint32_t stream_id));
   MOCK_METHOD5(
       NotifyEncryptionUpdate,
       bool(uint32_t stream_id,
@@ -173,6 +185,38 @@ TEST_F(HlsNotifyMuxerListenerTest, OnMediaStart) {
                          MuxerListener::kContainerMpeg2ts);
 }
 
+// The muxer starts over in the same playlist, e.g. between concatenated
+// inputs, so the stream is only notified once.
+TEST_F(HlsNotifyMuxerListenerTest, OnMediaStartTwice) {
+  VideoStreamInfoParameters video_params = GetDefaultVideoStreamInfoParams();
+  std::shared_ptr<StreamInfo> video_stream_info =
+      CreateVideoStreamInfo(video_params);
+  video_params.width *= 2;
+  video_params.height *= 2;
+  std::shared_ptr<StreamInfo> larger_video_stream_info =
+      CreateVideoStreamInfo(video_params);
+
+  const uint32_t kStreamId = 1;
+  EXPECT_CALL(mock_notifier_, NotifyNewStream(_, _, _, _, _))
+      .WillOnce(DoAll(SetArgPointee<4>(kStreamId), Return(true)));
+  MuxerOptions muxer_options;
+  muxer_options.segment_template = "$Number$.ts";
+  listener_.OnMediaStart(muxer_options, *video_stream_info, 90000,
+                         MuxerListener::kContainerMpeg2ts);
+
+  // Same configuration.
+  EXPECT_CALL(mock_notifier_, NotifyDiscontinuity(_)).Times(0);
+  listener_.OnMediaStart(muxer_options, *video_stream_info, 90000,
+                         MuxerListener::kContainerMpeg2ts);
+  Mock::VerifyAndClearExpectations(&mock_notifier_);
+
+  EXPECT_CALL(mock_notifier_, NotifyNewStream(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(mock_notifier_, NotifyDiscontinuity(kStreamId))
+      .WillOnce(Return(true));
+  listener_.OnMediaStart(muxer_options, *larger_video_stream_info, 90000,
+                         MuxerListener::kContainerMpeg2ts);
+}
+
 // OnEncryptionStart() should call MuxerListener::NotifyEncryptionUpdate() after
 // OnEncryptionInfoReady() and OnMediaStart().
 TEST_F(HlsNotifyMuxerListenerTest, OnEncryptionStart) {
@@ -185,7 +229,7 @@ TEST_F(HlsNotifyMuxerListenerTest, OnEncryptionStart) {
   EXPECT_CALL(mock_notifier_, NotifyEncryptionUpdate(_, _, _, _, _)).Times(0);
   listener_.OnEncryptionInfoReady(kInitialEncryptionInfo, FOURCC_cbcs, key_id,
                                   iv, {{system_id, pssh}});
-  ::testing::Mock::VerifyAndClearExpectations(&mock_notifier_);
+  Mock::VerifyAndClearExpectations(&mock_notifier_);
 
   ON_CALL(mock_notifier_, NotifyNewStream(_, _, _, _, _))
       .WillByDefault(Return(true));
@@ -198,7 +242,7 @@ TEST_F(HlsNotifyMuxerListenerTest, OnEncryptionStart) {
   EXPECT_CALL(mock_notifier_, NotifyEncryptionUpdate(_, _, _, _, _)).Times(0);
   listener_.OnMediaStart(muxer_options, *video_stream_info, 90000,
                          MuxerListener::kContainerMpeg2ts);
-  ::testing::Mock::VerifyAndClearExpectations(&mock_notifier_);
+  Mock::VerifyAndClearExpectations(&mock_notifier_);
 
   EXPECT_CALL(mock_notifier_,
               NotifyEncryptionUpdate(_, key_id, system_id, iv, pssh))
@@ -219,7 +263,7 @@ TEST_F(HlsNotifyMuxerListenerTest, OnEncryptionStartBeforeMediaStart) {
   EXPECT_CALL(mock_notifier_, NotifyEncryptionUpdate(_, _, _, _, _)).Times(0);
   listener_.OnEncryptionInfoReady(kInitialEncryptionInfo, FOURCC_cbcs, key_id,
                                   iv, {{system_id, pssh}});
-  ::testing::Mock::VerifyAndClearExpectations(&mock_notifier_);
+  Mock::VerifyAndClearExpectations(&mock_notifier_);
 
   ON_CALL(mock_notifier_, NotifyNewStream(_, _, _, _, _))
       .WillByDefault(Return(true));
@@ -249,7 +293,7 @@ TEST_F(HlsNotifyMuxerListenerTest, NoEncryptionUpdateIfNotifyNewStreamFails) {
   EXPECT_CALL(mock_notifier_, NotifyEncryptionUpdate(_, _, _, _, _)).Times(0);
   listener_.OnEncryptionInfoReady(kInitialEncryptionInfo, FOURCC_cbcs, key_id,
                                   iv, GetDefaultKeySystemInfo());
-  ::testing::Mock::VerifyAndClearExpectations(&mock_notifier_);
+  Mock::VerifyAndClearExpectations(&mock_notifier_);
 
   EXPECT_CALL(mock_notifier_, NotifyNewStream(_, _, _, _, _))
       .WillOnce(Return(false));
@@ -298,7 +342,7 @@ TEST_F(HlsNotifyMuxerListenerTest, OnEncryptionInfoReadyWithProtectionScheme) {
 
   listener_.OnEncryptionInfoReady(kInitialEncryptionInfo, FOURCC_cenc, key_id,
                                   iv, GetDefaultKeySystemInfo());
-  ::testing::Mock::VerifyAndClearExpectations(&mock_notifier_);
+  Mock::VerifyAndClearExpectations(&mock_notifier_);
 
   ON_CALL(mock_notifier_,
           NotifyNewStream(HasEncryptionScheme("cenc"), _, _, _, _))
@@ -348,6 +392,27 @@ TEST_F(HlsNotifyMuxerListenerTest, OnNewSegmentAndCueEvent) {
                          kSegmentDuration, kSegmentSize);
 }
 
+TEST_F(HlsNotifyMuxerListenerTest, OnNewPartialSegment) {
+  ON_CALL(mock_notifier_, NotifyNewStream(_, _, _, _, _))
+      .WillByDefault(Return(true));
+  VideoStreamInfoParameters video_params = GetDefaultVideoStreamInfoParams();
+  std::shared_ptr<StreamInfo> video_stream_info =
+      CreateVideoStreamInfo(video_params);
+  MuxerOptions muxer_options;
+  muxer_options.segment_template = "$Number$.mp4";
+  listener_.OnMediaStart(muxer_options, *video_stream_info, 90000,
+                         MuxerListener::kContainerMp4);
+
+  EXPECT_CALL(mock_notifier_,
+              NotifyNewPartialSegment(_, StrEq("10.part0.mp4"),
+                                      kSegmentStartTime, kSegmentDuration,
+                                      kSegmentSize, true,
+                                      StrEq("10.part1.mp4")));
+  listener_.OnNewPartialSegment("10.part0.mp4", kSegmentStartTime,
+                                kSegmentDuration, kSegmentSize, true,
+                                "10.part1.mp4");
+}
+
 // Verify that the notifier is called for every segment in OnMediaEnd if
 // segment_template is not set.
 TEST_F(HlsNotifyMuxerListenerTest, NoSegmentTemplateOnMediaEnd) {
@@ -18,6 +18,8 @@
         'event_info.h',
         'hls_notify_muxer_listener.cc',
         'hls_notify_muxer_listener.h',
+        'metrics_muxer_listener.cc',
+        'metrics_muxer_listener.h',
         'mpd_notify_muxer_listener.cc',
         'mpd_notify_muxer_listener.h',
         'multi_codec_muxer_listener.cc',
@@ -27,6 +29,8 @@
         'muxer_listener_factory.h',
         'muxer_listener_internal.cc',
         'muxer_listener_internal.h',
+        'output_stats_muxer_listener.cc',
+        'output_stats_muxer_listener.h',
         'vod_media_info_dump_muxer_listener.cc',
         'vod_media_info_dump_muxer_listener.h',
       ],
@@ -0,0 +1,49 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/metrics_muxer_listener.h"
+
+#include "packager/media/base/metrics.h"
+#include "packager/media/base/muxer_options.h"
+
+namespace shaka {
+namespace media {
+
+void MetricsMuxerListener::OnMediaStart(const MuxerOptions& muxer_options,
+                                        const StreamInfo& stream_info,
+                                        uint32_t time_scale,
+                                        ContainerType container_type) {
+  labels_ = MetricLabel("output", muxer_options.segment_template.empty()
+                                      ? muxer_options.output_file_name
+                                      : muxer_options.segment_template);
+}
+
+void MetricsMuxerListener::OnNewSegment(const std::string& file_name,
+                                        int64_t start_time,
+                                        int64_t duration,
+                                        uint64_t segment_file_size) {
+  Metrics* metrics = Metrics::GetInstance();
+  metrics->IncrementCounter("packager_segments_total",
+                            "Number of segments written.", labels_);
+  metrics->IncrementCounter("packager_output_bytes_total",
+                            "Number of bytes of the segments written.",
+                            labels_, segment_file_size);
+}
+
+void MetricsMuxerListener::OnNewPartialSegment(
+    const std::string& partial_segment_name,
+    int64_t start_time,
+    int64_t duration,
+    uint64_t partial_segment_file_size,
+    bool independent,
+    const std::string& next_partial_segment_name) {
+  Metrics::GetInstance()->IncrementCounter(
+      "packager_partial_segments_total", "Number of partial segments written.",
+      labels_);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,66 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_EVENT_METRICS_MUXER_LISTENER_H_
+#define PACKAGER_MEDIA_EVENT_METRICS_MUXER_LISTENER_H_
+
+#include <string>
+#include <vector>
+
+#include "packager/media/event/muxer_listener.h"
+
+namespace shaka {
+namespace media {
+
+/// Counts the segments and the bytes written for an output in Metrics.
+class MetricsMuxerListener : public MuxerListener {
+ public:
+  MetricsMuxerListener() = default;
+
+  /// @name MuxerListener implementation overrides.
+  /// @{
+  void OnEncryptionInfoReady(bool is_initial_encryption_info,
+                             FourCC protection_scheme,
+                             const std::vector<uint8_t>& key_id,
+                             const std::vector<uint8_t>& iv,
+                             const std::vector<ProtectionSystemSpecificInfo>&
+                                 key_system_info) override {}
+  void OnEncryptionStart() override {}
+  void OnMediaStart(const MuxerOptions& muxer_options,
+                    const StreamInfo& stream_info,
+                    uint32_t time_scale,
+                    ContainerType container_type) override;
+  void OnSampleDurationReady(uint32_t sample_duration) override {}
+  void OnMediaEnd(const MediaRanges& media_ranges,
+                  float duration_seconds) override {}
+  void OnNewSegment(const std::string& file_name,
+                    int64_t start_time,
+                    int64_t duration,
+                    uint64_t segment_file_size) override;
+  void OnNewPartialSegment(
+      const std::string& partial_segment_name,
+      int64_t start_time,
+      int64_t duration,
+      uint64_t partial_segment_file_size,
+      bool independent,
+      const std::string& next_partial_segment_name) override;
+  void OnKeyFrame(int64_t timestamp,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override {}
+  void OnCueEvent(int64_t timestamp, const std::string& cue_data) override {}
+  /// @}
+
+ private:
+  MetricsMuxerListener(const MetricsMuxerListener&) = delete;
+  MetricsMuxerListener& operator=(const MetricsMuxerListener&) = delete;
+
+  std::string labels_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_EVENT_METRICS_MUXER_LISTENER_H_
@@ -11,6 +11,7 @@
 
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/protection_system_specific_info.h"
+#include "packager/media/base/segment_digest.h"
 #include "packager/media/base/stream_info.h"
 #include "packager/media/event/muxer_listener.h"
 
@@ -62,6 +63,18 @@ class MockMuxerListener : public MuxerListener {
                     int64_t duration,
                     uint64_t segment_file_size));
 
+  MOCK_METHOD6(OnNewPartialSegment,
+               void(const std::string& partial_segment_name,
+                    int64_t start_time,
+                    int64_t duration,
+                    uint64_t partial_segment_file_size,
+                    bool independent,
+                    const std::string& next_partial_segment_name));
+
+  MOCK_METHOD2(OnSegmentDigests,
+               void(const std::string& segment_name,
+                    const std::vector<SegmentDigest>& digests));
+
   MOCK_METHOD3(OnKeyFrame,
                void(int64_t timestamp,
                     uint64_t start_byte_offset,
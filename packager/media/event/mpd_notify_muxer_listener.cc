@@ -62,15 +62,23 @@ void MpdNotifyMuxerListener::OnMediaStart(
     const StreamInfo& stream_info,
     uint32_t time_scale,
     ContainerType container_type) {
-  std::unique_ptr<MediaInfo> media_info(new MediaInfo());
-  if (!internal::GenerateMediaInfo(muxer_options,
-                                   stream_info,
-                                   time_scale,
-                                   container_type,
-                                   media_info.get())) {
+  OnMediaStartWithMediaInfo(
+      muxer_options, stream_info, time_scale, container_type,
+      internal::GenerateMediaInfo(muxer_options, stream_info, time_scale,
+                                  container_type));
+}
+
+void MpdNotifyMuxerListener::OnMediaStartWithMediaInfo(
+    const MuxerOptions& muxer_options,
+    const StreamInfo& stream_info,
+    uint32_t time_scale,
+    ContainerType container_type,
+    std::shared_ptr<const MediaInfo> generated_media_info) {
+  if (!generated_media_info) {
     LOG(ERROR) << "Failed to generate MediaInfo from input.";
     return;
   }
+  std::unique_ptr<MediaInfo> media_info(new MediaInfo(*generated_media_info));
   for (const std::string& accessibility : accessibilities_)
     media_info->add_dash_accessibilities(accessibility);
   if (roles_.empty() && stream_info.stream_type() == kStreamText) {
@@ -100,6 +108,12 @@ void MpdNotifyMuxerListener::OnMediaStart(
   media_info_ = std::move(media_info);
 
   if (mpd_notifier_->dash_profile() == DashProfile::kLive) {
+    if (notification_id_) {
+      // The muxer started over in the same Representation.
+      mpd_notifier_->NotifyMediaInfoUpdate(notification_id_.value(),
+                                           *media_info_);
+      return;
+    }
     if (!NotifyNewContainer())
       return;
     DCHECK(notification_id_);
@@ -187,7 +201,7 @@ void MpdNotifyMuxerListener::OnNewSegment(const std::string& file_name,
     mpd_notifier_->NotifyNewSegment(notification_id_.value(), start_time,
                                     duration, segment_file_size);
     if (mpd_notifier_->mpd_type() == MpdType::kDynamic)
-      mpd_notifier_->Flush();
+      mpd_notifier_->RequestFlush(notification_id_.value());
   } else {
     EventInfo event_info;
     event_info.type = EventInfoType::kSegment;
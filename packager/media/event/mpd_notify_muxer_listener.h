@@ -44,6 +44,12 @@ class MpdNotifyMuxerListener : public MuxerListener {
                     const StreamInfo& stream_info,
                     uint32_t time_scale,
                     ContainerType container_type) override;
+  void OnMediaStartWithMediaInfo(
+      const MuxerOptions& muxer_options,
+      const StreamInfo& stream_info,
+      uint32_t time_scale,
+      ContainerType container_type,
+      std::shared_ptr<const MediaInfo> media_info) override;
   void OnSampleDurationReady(uint32_t sample_duration) override;
   void OnMediaEnd(const MediaRanges& media_ranges,
                   float duration_seconds) override;
@@ -22,8 +22,10 @@
 #include "packager/mpd/base/mpd_notifier.h"
 
 using ::testing::_;
+using ::testing::DoAll;
 using ::testing::InSequence;
 using ::testing::Return;
+using ::testing::SetArgPointee;
 
 namespace shaka {
 
@@ -721,6 +723,30 @@ TEST_P(MpdNotifyMuxerListenerTest, LiveWithKeyRotation) {
   FireOnMediaEndWithParams(GetDefaultOnMediaEndParams());
 }
 
+// The muxer starts over, e.g. between concatenated inputs, so the
+// Representation is updated instead of added again.
+TEST_P(MpdNotifyMuxerListenerTest, LiveOnMediaStartTwice) {
+  SetupForLive();
+  MuxerOptions muxer_options;
+  SetDefaultLiveMuxerOptions(&muxer_options);
+  VideoStreamInfoParameters video_params = GetDefaultVideoStreamInfoParams();
+  std::shared_ptr<StreamInfo> video_stream_info =
+      CreateVideoStreamInfo(video_params);
+
+  const uint32_t kContainerId = 3;
+  EXPECT_CALL(*notifier_, NotifyNewContainer(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(kContainerId), Return(true)));
+  EXPECT_CALL(*notifier_, NotifyMediaInfoUpdate(kContainerId, _))
+      .WillOnce(Return(true));
+
+  listener_->OnMediaStart(muxer_options, *video_stream_info,
+                          kDefaultReferenceTimeScale,
+                          MuxerListener::kContainerMp4);
+  listener_->OnMediaStart(muxer_options, *video_stream_info,
+                          kDefaultReferenceTimeScale,
+                          MuxerListener::kContainerMp4);
+}
+
 INSTANTIATE_TEST_CASE_P(StaticAndDynamic,
                         MpdNotifyMuxerListenerTest,
                         ::testing::Values(MpdType::kStatic, MpdType::kDynamic));
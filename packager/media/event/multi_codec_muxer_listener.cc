@@ -35,5 +35,25 @@ void MultiCodecMuxerListener::OnMediaStart(const MuxerOptions& muxer_options,
   LimitNumOfMuxerListners(num_codecs);
 }
 
+void MultiCodecMuxerListener::OnMediaStartWithMediaInfo(
+    const MuxerOptions& muxer_options,
+    const StreamInfo& stream_info,
+    uint32_t time_scale,
+    ContainerType container_type,
+    std::shared_ptr<const MediaInfo> media_info) {
+  // |media_info| can only be passed to the listener of a single codec, as the
+  // listener of each codec has its own MediaInfo.
+  MuxerListener* muxer_listener = MuxerListenerAt(0);
+  if (stream_info.codec_string().find(';') != std::string::npos ||
+      stream_info.codec_string().empty() || !muxer_listener) {
+    OnMediaStart(muxer_options, stream_info, time_scale, container_type);
+    return;
+  }
+  muxer_listener->OnMediaStartWithMediaInfo(muxer_options, stream_info,
+                                            time_scale, container_type,
+                                            std::move(media_info));
+  LimitNumOfMuxerListners(1);
+}
+
 }  // namespace media
 }  // namespace shaka
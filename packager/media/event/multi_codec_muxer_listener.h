@@ -29,6 +29,12 @@ class MultiCodecMuxerListener : public CombinedMuxerListener {
                     const StreamInfo& stream_info,
                     uint32_t time_scale,
                     ContainerType container_type) override;
+  void OnMediaStartWithMediaInfo(
+      const MuxerOptions& muxer_options,
+      const StreamInfo& stream_info,
+      uint32_t time_scale,
+      ContainerType container_type,
+      std::shared_ptr<const MediaInfo> media_info) override;
   /// @}
 
  private:
@@ -12,6 +12,7 @@
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/event/mock_muxer_listener.h"
 #include "packager/media/event/muxer_listener_test_helper.h"
+#include "packager/mpd/base/media_info.pb.h"
 
 namespace shaka {
 namespace media {
@@ -85,6 +86,29 @@ TEST_F(MultiCodecMuxerListenerTest, OnNewSegmentAfterOnMediaStartSingleCodec) {
                                      kSegmentDuration, kSegmentSize);
 }
 
+TEST_F(MultiCodecMuxerListenerTest, OnMediaStartWithMediaInfoSingleCodec) {
+  video_stream_info_->set_codec_string("codec_1");
+
+  // The MediaInfo is passed to the listener of the codec, whose default
+  // implementation calls OnMediaStart().
+  EXPECT_CALL(
+      *listener_for_first_codec_,
+      OnMediaStart(_, Property(&StreamInfo::codec_string, StrEq("codec_1")),
+                   kTimescale, kContainer))
+      .Times(1);
+
+  multi_codec_listener_.OnMediaStartWithMediaInfo(
+      muxer_options_, *video_stream_info_, kTimescale, kContainer,
+      std::make_shared<MediaInfo>());
+
+  EXPECT_CALL(*listener_for_first_codec_,
+              OnNewSegment(StrEq("new_segment_name10.ts"), kSegmentStartTime,
+                           kSegmentDuration, kSegmentSize));
+
+  multi_codec_listener_.OnNewSegment("new_segment_name10.ts", kSegmentStartTime,
+                                     kSegmentDuration, kSegmentSize);
+}
+
 TEST_F(MultiCodecMuxerListenerTest, OnMediaStartTwoCodecs) {
   video_stream_info_->set_codec_string("codec_1;codec_2");
 
@@ -11,6 +11,7 @@
 
 #include <stdint.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -19,10 +20,14 @@
 #include "packager/media/base/range.h"
 
 namespace shaka {
+
+class MediaInfo;
+
 namespace media {
 
 struct MuxerOptions;
 struct ProtectionSystemSpecificInfo;
+struct SegmentDigest;
 class StreamInfo;
 
 /// MuxerListener is an event handler that can be registered to a muxer.
@@ -100,6 +105,21 @@ class MuxerListener {
                             uint32_t time_scale,
                             ContainerType container_type) = 0;
 
+  /// Same as OnMediaStart(), with the MediaInfo generated from its arguments.
+  /// CombinedMuxerListener generates it once for all its listeners, which
+  /// copy it instead of generating it again. The default implementation calls
+  /// OnMediaStart().
+  /// @param media_info is the MediaInfo of the media, or null if it could not
+  ///        be generated.
+  virtual void OnMediaStartWithMediaInfo(
+      const MuxerOptions& muxer_options,
+      const StreamInfo& stream_info,
+      uint32_t time_scale,
+      ContainerType container_type,
+      std::shared_ptr<const MediaInfo> media_info) {
+    OnMediaStart(muxer_options, stream_info, time_scale, container_type);
+  }
+
   /// Called when the average sample duration of the media is determined.
   /// @param sample_duration in timescale of the media.
   virtual void OnSampleDurationReady(uint32_t sample_duration) = 0;
@@ -129,6 +149,37 @@ class MuxerListener {
                             int64_t duration,
                             uint64_t segment_file_size) = 0;
 
+  /// Called when a partial segment, i.e. a fragment of a segment written to its
+  /// own file for low latency streaming, has been written. It is called before
+  /// OnNewSegment() is called on the containing segment.
+  /// The default implementation does nothing.
+  /// @param partial_segment_name is the name of the new partial segment.
+  /// @param start_time is the start time of the partial segment, relative to
+  ///        the timescale specified by MediaInfo passed to OnMediaStart().
+  /// @param duration is the duration of the partial segment, relative to the
+  ///        timescale specified by MediaInfo passed to OnMediaStart().
+  /// @param partial_segment_file_size is the partial segment size in bytes.
+  /// @param independent is true if the partial segment starts with a key
+  ///        frame.
+  /// @param next_partial_segment_name is the name of the next partial segment
+  ///        of the stream.
+  virtual void OnNewPartialSegment(
+      const std::string& partial_segment_name,
+      int64_t start_time,
+      int64_t duration,
+      uint64_t partial_segment_file_size,
+      bool independent,
+      const std::string& next_partial_segment_name) {}
+
+  /// Called with the digests of a media segment file, computed as it is
+  /// written, when MuxerOptions::segment_digests is set. It is called before
+  /// OnNewSegment() is called on the segment.
+  /// The default implementation does nothing.
+  /// @param segment_name is the name of the segment.
+  /// @param digests are the digests of the segment file.
+  virtual void OnSegmentDigests(const std::string& segment_name,
+                                const std::vector<SegmentDigest>& digests) {}
+
   /// Called when there is a new key frame. For Video only. Note that it should
   /// be called before OnNewSegment is called on the containing segment.
   /// @param timestamp is in terms of the timescale of the media.
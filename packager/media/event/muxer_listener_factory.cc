@@ -11,8 +11,10 @@
 #include "packager/base/memory/ptr_util.h"
 #include "packager/base/strings/stringprintf.h"
 #include "packager/hls/base/hls_notifier.h"
+#include "packager/media/base/metrics.h"
 #include "packager/media/event/combined_muxer_listener.h"
 #include "packager/media/event/hls_notify_muxer_listener.h"
+#include "packager/media/event/metrics_muxer_listener.h"
 #include "packager/media/event/mpd_notify_muxer_listener.h"
 #include "packager/media/event/multi_codec_muxer_listener.h"
 #include "packager/media/event/muxer_listener.h"
@@ -26,12 +28,14 @@ const char kMediaInfoSuffix[] = ".media_info";
 
 std::unique_ptr<MuxerListener> CreateMediaInfoDumpListenerInternal(
     const std::string& output,
-    bool use_segment_list) {
+    bool use_segment_list,
+    VodMediaInfoDumpMuxerListener::Format format) {
   DCHECK(!output.empty());
 
-  std::unique_ptr<MuxerListener> listener(
+  std::unique_ptr<VodMediaInfoDumpMuxerListener> listener(
       new VodMediaInfoDumpMuxerListener(output + kMediaInfoSuffix, use_segment_list));
-  return listener;
+  listener->set_format(format);
+  return std::move(listener);
 }
 
 std::unique_ptr<MuxerListener> CreateMpdListenerInternal(
@@ -107,7 +111,8 @@ std::unique_ptr<MuxerListener> MuxerListenerFactory::CreateListener(
     if (output_media_info_) {
       combined_listener->AddListener(
           CreateMediaInfoDumpListenerInternal(stream.media_info_output,
-                                              use_segment_list_));
+                                              use_segment_list_,
+                                              media_info_format_));
     }
 
     if (mpd_notifier_ && !stream.hls_only) {
@@ -125,6 +130,15 @@ std::unique_ptr<MuxerListener> MuxerListenerFactory::CreateListener(
     multi_codec_listener->AddListener(std::move(combined_listener));
   }
 
+  if (Metrics::GetInstance()->enabled()) {
+    std::unique_ptr<CombinedMuxerListener> combined_listener(
+        new CombinedMuxerListener);
+    combined_listener->AddListener(std::move(multi_codec_listener));
+    combined_listener->AddListener(
+        std::unique_ptr<MuxerListener>(new MetricsMuxerListener));
+    return std::move(combined_listener);
+  }
+
   return std::move(multi_codec_listener);
 }
 
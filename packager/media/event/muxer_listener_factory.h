@@ -11,6 +11,8 @@
 #include <string>
 #include <vector>
 
+#include "packager/media/event/vod_media_info_dump_muxer_listener.h"
+
 namespace shaka {
 class MpdNotifier;
 
@@ -73,6 +75,11 @@ class MuxerListenerFactory {
   /// Create a listener for a stream.
   std::unique_ptr<MuxerListener> CreateListener(const StreamData& stream);
 
+  /// Set the format of the media info dump files. Text by default.
+  void set_media_info_format(VodMediaInfoDumpMuxerListener::Format format) {
+    media_info_format_ = format;
+  }
+
   /// Create an HLS listener if possible. If it is not possible to
   /// create an HLS listener, this method will return null.
   std::unique_ptr<MuxerListener> CreateHlsListener(const StreamData& stream);
@@ -87,6 +94,8 @@ class MuxerListenerFactory {
 
   /// This is set when mpd_notifier_ is NULL and --output_media_info is set.
   bool use_segment_list_;
+  VodMediaInfoDumpMuxerListener::Format media_info_format_ =
+      VodMediaInfoDumpMuxerListener::Format::kText;
 
   // A counter to track which stream we are on.
   int stream_index_ = 0;
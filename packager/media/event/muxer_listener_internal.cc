@@ -242,6 +242,19 @@ bool GenerateMediaInfo(const MuxerOptions& muxer_options,
   return true;
 }
 
+std::shared_ptr<const MediaInfo> GenerateMediaInfo(
+    const MuxerOptions& muxer_options,
+    const StreamInfo& stream_info,
+    uint32_t reference_time_scale,
+    MuxerListener::ContainerType container_type) {
+  std::shared_ptr<MediaInfo> media_info = std::make_shared<MediaInfo>();
+  if (!GenerateMediaInfo(muxer_options, stream_info, reference_time_scale,
+                         container_type, media_info.get())) {
+    return nullptr;
+  }
+  return media_info;
+}
+
 bool IsMediaInfoCompatible(const MediaInfo& media_info1,
                            const MediaInfo& media_info2) {
   return MessageDifferencer::Equals(
@@ -9,6 +9,7 @@
 
 #include <stdint.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -33,6 +34,14 @@ bool GenerateMediaInfo(const MuxerOptions& muxer_options,
                        MuxerListener::ContainerType container_type,
                        MediaInfo* media_info);
 
+/// Same as above, for the listeners sharing the generated MediaInfo.
+/// @return the generated MediaInfo, or null on failure.
+std::shared_ptr<const MediaInfo> GenerateMediaInfo(
+    const MuxerOptions& muxer_options,
+    const StreamInfo& stream_info,
+    uint32_t reference_time_scale_,
+    MuxerListener::ContainerType container_type);
+
 /// @return True if @a media_info1 and @a media_info2 are compatible. MediaInfos
 ///         are considered to be compatible if codec and container are the same.
 bool IsMediaInfoCompatible(const MediaInfo& media_info1,
@@ -0,0 +1,29 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/output_stats_muxer_listener.h"
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+
+OutputStatsMuxerListener::OutputStatsMuxerListener(std::shared_ptr<Stats> stats)
+    : stats_(std::move(stats)) {
+  DCHECK(stats_);
+}
+
+void OutputStatsMuxerListener::OnNewSegment(const std::string& file_name,
+                                            int64_t start_time,
+                                            int64_t duration,
+                                            uint64_t segment_file_size) {
+  stats_->num_segments.fetch_add(1, std::memory_order_relaxed);
+  stats_->bytes_written.fetch_add(segment_file_size,
+                                  std::memory_order_relaxed);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,70 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_EVENT_OUTPUT_STATS_MUXER_LISTENER_H_
+#define PACKAGER_MEDIA_EVENT_OUTPUT_STATS_MUXER_LISTENER_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/media/event/muxer_listener.h"
+
+namespace shaka {
+namespace media {
+
+/// Counts the bytes written for an output, for Packager::GetStats().
+class OutputStatsMuxerListener : public MuxerListener {
+ public:
+  /// The counters, shared with their readers as the listener is owned by the
+  /// muxer. They can be read from any thread.
+  struct Stats {
+    std::atomic<uint64_t> num_segments{0};
+    std::atomic<uint64_t> bytes_written{0};
+  };
+
+  /// @param stats receives the counters of the output.
+  explicit OutputStatsMuxerListener(std::shared_ptr<Stats> stats);
+
+  /// @name MuxerListener implementation overrides.
+  /// @{
+  void OnEncryptionInfoReady(bool is_initial_encryption_info,
+                             FourCC protection_scheme,
+                             const std::vector<uint8_t>& key_id,
+                             const std::vector<uint8_t>& iv,
+                             const std::vector<ProtectionSystemSpecificInfo>&
+                                 key_system_info) override {}
+  void OnEncryptionStart() override {}
+  void OnMediaStart(const MuxerOptions& muxer_options,
+                    const StreamInfo& stream_info,
+                    uint32_t time_scale,
+                    ContainerType container_type) override {}
+  void OnSampleDurationReady(uint32_t sample_duration) override {}
+  void OnMediaEnd(const MediaRanges& media_ranges,
+                  float duration_seconds) override {}
+  void OnNewSegment(const std::string& file_name,
+                    int64_t start_time,
+                    int64_t duration,
+                    uint64_t segment_file_size) override;
+  void OnKeyFrame(int64_t timestamp,
+                  uint64_t start_byte_offset,
+                  uint64_t size) override {}
+  void OnCueEvent(int64_t timestamp, const std::string& cue_data) override {}
+  /// @}
+
+ private:
+  OutputStatsMuxerListener(const OutputStatsMuxerListener&) = delete;
+  OutputStatsMuxerListener& operator=(const OutputStatsMuxerListener&) =
+      delete;
+
+  const std::shared_ptr<Stats> stats_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_EVENT_OUTPUT_STATS_MUXER_LISTENER_H_
@@ -12,6 +12,7 @@
 
 #include "packager/base/logging.h"
 #include "packager/file/file.h"
+#include "packager/media/base/gzip_util.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/protection_system_specific_info.h"
 #include "packager/media/base/stream_info.h"
@@ -48,16 +49,25 @@ void VodMediaInfoDumpMuxerListener::OnMediaStart(
     const StreamInfo& stream_info,
     uint32_t time_scale,
     ContainerType container_type) {
+  OnMediaStartWithMediaInfo(
+      muxer_options, stream_info, time_scale, container_type,
+      internal::GenerateMediaInfo(muxer_options, stream_info, time_scale,
+                                  container_type));
+}
+
+void VodMediaInfoDumpMuxerListener::OnMediaStartWithMediaInfo(
+    const MuxerOptions& muxer_options,
+    const StreamInfo& stream_info,
+    uint32_t time_scale,
+    ContainerType container_type,
+    std::shared_ptr<const MediaInfo> generated_media_info) {
   DCHECK(muxer_options.segment_template.empty());
-  media_info_.reset(new MediaInfo());
-  if (!internal::GenerateMediaInfo(muxer_options,
-                                   stream_info,
-                                   time_scale,
-                                   container_type,
-                                   media_info_.get())) {
+  if (!generated_media_info) {
+    media_info_.reset(new MediaInfo());
     LOG(ERROR) << "Failed to generate MediaInfo from input.";
     return;
   }
+  media_info_.reset(new MediaInfo(*generated_media_info));
 
   if (is_encrypted_) {
     internal::SetContentProtectionFields(protection_scheme_, default_key_id_,
@@ -85,7 +95,7 @@ void VodMediaInfoDumpMuxerListener::OnMediaEnd(const MediaRanges& media_ranges,
   }
   if (!media_info_->has_bandwidth())
     media_info_->set_bandwidth(max_bitrate_);
-  WriteMediaInfoToFile(*media_info_, output_file_name_);
+  WriteMediaInfoToFile(*media_info_, output_file_name_, format_);
 }
 
 void VodMediaInfoDumpMuxerListener::OnNewSegment(const std::string& file_name,
@@ -114,11 +124,41 @@ void VodMediaInfoDumpMuxerListener::OnCueEvent(int64_t timestamp,
 bool VodMediaInfoDumpMuxerListener::WriteMediaInfoToFile(
     const MediaInfo& media_info,
     const std::string& output_file_path) {
+  return WriteMediaInfoToFile(media_info, output_file_path, Format::kText);
+}
+
+// static
+bool VodMediaInfoDumpMuxerListener::WriteMediaInfoToFile(
+    const MediaInfo& media_info,
+    const std::string& output_file_path,
+    Format format) {
   std::string output_string;
-  if (!google::protobuf::TextFormat::PrintToString(media_info,
-                                                   &output_string)) {
-    LOG(ERROR) << "Failed to serialize MediaInfo to string.";
-    return false;
+  switch (format) {
+    case Format::kText:
+      if (!google::protobuf::TextFormat::PrintToString(media_info,
+                                                       &output_string)) {
+        LOG(ERROR) << "Failed to serialize MediaInfo to string.";
+        return false;
+      }
+      break;
+    case Format::kBinary:
+      if (!media_info.SerializeToString(&output_string)) {
+        LOG(ERROR) << "Failed to serialize MediaInfo to string.";
+        return false;
+      }
+      break;
+    case Format::kGzipBinary: {
+      std::string serialized;
+      if (!media_info.SerializeToString(&serialized)) {
+        LOG(ERROR) << "Failed to serialize MediaInfo to string.";
+        return false;
+      }
+      if (!GzipCompress(serialized, &output_string)) {
+        LOG(ERROR) << "Failed to compress MediaInfo.";
+        return false;
+      }
+      break;
+    }
   }
 
   File* file = File::Open(output_file_path.c_str(), "w");
@@ -27,6 +27,16 @@ namespace media {
 
 class VodMediaInfoDumpMuxerListener : public MuxerListener {
  public:
+  /// Format of the MediaInfo files.
+  enum class Format {
+    /// Protobuf text format, which is human readable.
+    kText,
+    /// Binary serialized protobuf, which is smaller and faster to parse.
+    kBinary,
+    /// Binary serialized protobuf, compressed with gzip.
+    kGzipBinary,
+  };
+
   VodMediaInfoDumpMuxerListener(const std::string& output_file_name, bool use_segment_list);
   ~VodMediaInfoDumpMuxerListener() override;
 
@@ -43,6 +53,12 @@ class VodMediaInfoDumpMuxerListener : public MuxerListener {
                     const StreamInfo& stream_info,
                     uint32_t time_scale,
                     ContainerType container_type) override;
+  void OnMediaStartWithMediaInfo(
+      const MuxerOptions& muxer_options,
+      const StreamInfo& stream_info,
+      uint32_t time_scale,
+      ContainerType container_type,
+      std::shared_ptr<const MediaInfo> media_info) override;
   void OnSampleDurationReady(uint32_t sample_duration) override;
   void OnMediaEnd(const MediaRanges& media_ranges,
                   float duration_seconds) override;
@@ -63,7 +79,17 @@ class VodMediaInfoDumpMuxerListener : public MuxerListener {
   static bool WriteMediaInfoToFile(const MediaInfo& media_info,
                                    const std::string& output_file_path);
 
+  /// Write @a media_info to @a output_file_path in @a format.
+  /// @param media_info is the MediaInfo to write out.
+  /// @param output_file_path is the path of the output file.
+  /// @param format is the format of the output file.
+  /// @return true on success, false otherwise.
+  static bool WriteMediaInfoToFile(const MediaInfo& media_info,
+                                   const std::string& output_file_path,
+                                   Format format);
+
   void set_use_segment_list(bool value) {use_segment_list_ = value;}
+  void set_format(Format format) { format_ = format; }
 
  private:
   std::string output_file_name_;
@@ -77,6 +103,7 @@ class VodMediaInfoDumpMuxerListener : public MuxerListener {
   std::vector<ProtectionSystemSpecificInfo> key_system_info_;
 
   bool use_segment_list_ = false;
+  Format format_ = Format::kText;
 
   DISALLOW_COPY_AND_ASSIGN(VodMediaInfoDumpMuxerListener);
 };
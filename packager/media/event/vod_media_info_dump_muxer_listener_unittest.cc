@@ -15,6 +15,7 @@
 #include "packager/base/files/file_util.h"
 #include "packager/file/file.h"
 #include "packager/media/base/fourccs.h"
+#include "packager/media/base/gzip_util.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/event/muxer_listener_test_helper.h"
@@ -322,5 +323,46 @@ TEST_F(VodMediaInfoDumpMuxerListenerTest, UnencryptedStream_Normal_SegmentList)
               FileContentEqualsProto(kExpectedProtobufOutput));
 }
 
+TEST_F(VodMediaInfoDumpMuxerListenerTest, WriteBinaryMediaInfo) {
+  MediaInfo media_info;
+  media_info.set_bandwidth(12345);
+  media_info.set_media_file_name("test_output_file_name.mp4");
+  media_info.set_media_duration_seconds(10.5);
+
+  const std::string file_name = temp_file_path_.AsUTF8Unsafe();
+  ASSERT_TRUE(VodMediaInfoDumpMuxerListener::WriteMediaInfoToFile(
+      media_info, file_name,
+      VodMediaInfoDumpMuxerListener::Format::kBinary));
+
+  std::string content;
+  ASSERT_TRUE(File::ReadFileToString(file_name.c_str(), &content));
+  MediaInfo actual_media_info;
+  ASSERT_TRUE(actual_media_info.ParseFromString(content));
+  EXPECT_TRUE(::google::protobuf::util::MessageDifferencer::Equals(
+      media_info, actual_media_info));
+}
+
+TEST_F(VodMediaInfoDumpMuxerListenerTest, WriteGzipBinaryMediaInfo) {
+  MediaInfo media_info;
+  media_info.set_bandwidth(12345);
+  media_info.set_media_file_name("test_output_file_name.mp4");
+
+  const std::string file_name = temp_file_path_.AsUTF8Unsafe();
+  ASSERT_TRUE(VodMediaInfoDumpMuxerListener::WriteMediaInfoToFile(
+      media_info, file_name,
+      VodMediaInfoDumpMuxerListener::Format::kGzipBinary));
+
+  std::string content;
+  ASSERT_TRUE(File::ReadFileToString(file_name.c_str(), &content));
+  EXPECT_TRUE(IsGzipCompressed(content));
+
+  std::string uncompressed;
+  ASSERT_TRUE(GzipDecompress(content, &uncompressed));
+  MediaInfo actual_media_info;
+  ASSERT_TRUE(actual_media_info.ParseFromString(uncompressed));
+  EXPECT_TRUE(::google::protobuf::util::MessageDifferencer::Equals(
+      media_info, actual_media_info));
+}
+
 }  // namespace media
 }  // namespace shaka
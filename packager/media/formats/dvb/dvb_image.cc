@@ -210,14 +210,22 @@ DvbImageBuilder::~DvbImageBuilder() {}
 bool DvbImageBuilder::AddPixel(BitDepth bit_depth,
                                uint8_t byte_code,
                                bool is_top_rows) {
+  return AddPixels(bit_depth, byte_code, 1, is_top_rows);
+}
+
+bool DvbImageBuilder::AddPixels(BitDepth bit_depth,
+                                uint8_t byte_code,
+                                size_t count,
+                                bool is_top_rows) {
   auto& pos = is_top_rows ? top_pos_ : bottom_pos_;
-  if (pos.x >= max_width_ || pos.y >= max_height_) {
+  if (pos.y >= max_height_ || count > max_width_ - pos.x) {
     LOG(ERROR) << "DVB-sub image cannot fit in region/window";
     return false;
   }
 
-  pixels_[pos.y * max_width_ + pos.x++] =
-      color_space_->GetColor(bit_depth, byte_code);
+  std::fill_n(&pixels_[pos.y * max_width_ + pos.x], count,
+              color_space_->GetColor(bit_depth, byte_code));
+  pos.x += static_cast<uint16_t>(count);
   if (pos.x > width_)
     width_ = pos.x;
   return true;
@@ -101,6 +101,13 @@ class DvbImageBuilder {
   uint16_t max_height() const { return max_height_; }
 
   bool AddPixel(BitDepth bit_depth, uint8_t byte_code, bool is_top_rows);
+  /// Adds a run of @a count pixels of the same color, which is looked up and
+  /// bounds checked once for the whole run.
+  /// @return True on success, false if the run does not fit the row.
+  bool AddPixels(BitDepth bit_depth,
+                 uint8_t byte_code,
+                 size_t count,
+                 bool is_top_rows);
   void NewRow(bool is_top_rows);
   /// Copies the top-rows to the bottom rows.
   void MirrorToBottomRows();
@@ -239,6 +239,27 @@ TEST(DvbImageBuilderTest, ValidatesMaxWidth) {
   ASSERT_FALSE(image.AddPixel(BitDepth::k8Bit, kRedId, kTopRow));
 }
 
+TEST(DvbImageBuilderTest, AddsPixelRuns) {
+  DvbImageColorSpace colors;
+  FillDefaultColorSpace(&colors);
+  const uint16_t kWidth = 6;
+
+  DvbImageBuilder image(&colors, kBlack, kWidth, 5);
+  ASSERT_TRUE(image.AddPixels(BitDepth::k8Bit, kRedId, kWidth, kTopRow));
+  image.NewRow(kTopRow);
+  ASSERT_TRUE(image.AddPixels(BitDepth::k8Bit, kGreenId, 2, kBottomRow));
+  ASSERT_TRUE(image.AddPixels(BitDepth::k8Bit, kGreenId, 4, kBottomRow));
+  // Runs that don't fit the row are rejected without adding any pixel.
+  ASSERT_FALSE(image.AddPixels(BitDepth::k8Bit, kBlueId, 1, kBottomRow));
+  image.NewRow(kBottomRow);
+  ASSERT_TRUE(image.AddPixels(BitDepth::k8Bit, kWhiteId, 3, kTopRow));
+  ASSERT_FALSE(image.AddPixels(BitDepth::k8Bit, kBlueId, 4, kTopRow));
+  ASSERT_TRUE(image.AddPixels(BitDepth::k8Bit, kWhiteId, 3, kTopRow));
+  image.NewRow(kTopRow);
+
+  CheckImagePixels(&image, kWidth, {kRed, kGreen, kWhite});
+}
+
 TEST(DvbImageBuilderTest, SupportsInconsistentWidths) {
   DvbImageColorSpace colors;
   FillDefaultColorSpace(&colors);
@@ -351,8 +351,8 @@ bool DvbSubParser::Parse2BitPixelData(bool is_top_fields,
         uint8_t count_minus_3;
         RCHECK(reader->ReadBits(3, &count_minus_3));
         RCHECK(reader->ReadBits(2, &peek));
-        for (uint8_t i = 0; i < count_minus_3 + 3; i++)
-          RCHECK(image->AddPixel(BitDepth::k2Bit, peek, is_top_fields));
+        RCHECK(image->AddPixels(BitDepth::k2Bit, peek, count_minus_3 + 3,
+                                is_top_fields));
       } else {
         uint8_t switch_2;
         RCHECK(reader->ReadBits(1, &switch_2));
@@ -364,20 +364,19 @@ bool DvbSubParser::Parse2BitPixelData(bool is_top_fields,
           if (switch_3 == 0) {
             break;
           } else if (switch_3 == 1) {
-            RCHECK(image->AddPixel(BitDepth::k2Bit, 0, is_top_fields));
-            RCHECK(image->AddPixel(BitDepth::k2Bit, 0, is_top_fields));
+            RCHECK(image->AddPixels(BitDepth::k2Bit, 0, 2, is_top_fields));
           } else if (switch_3 == 2) {
             uint8_t count_minus_12;
             RCHECK(reader->ReadBits(4, &count_minus_12));
             RCHECK(reader->ReadBits(2, &peek));
-            for (uint8_t i = 0; i < count_minus_12 + 12; i++)
-              RCHECK(image->AddPixel(BitDepth::k2Bit, peek, is_top_fields));
+            RCHECK(image->AddPixels(BitDepth::k2Bit, peek, count_minus_12 + 12,
+                                    is_top_fields));
           } else if (switch_3 == 3) {
             uint8_t count_minus_29;
             RCHECK(reader->ReadBits(8, &count_minus_29));
             RCHECK(reader->ReadBits(2, &peek));
-            for (uint8_t i = 0; i < count_minus_29 + 29; i++)
-              RCHECK(image->AddPixel(BitDepth::k2Bit, peek, is_top_fields));
+            RCHECK(image->AddPixels(BitDepth::k2Bit, peek, count_minus_29 + 29,
+                                    is_top_fields));
           }
         }
       }
@@ -403,8 +402,7 @@ bool DvbSubParser::Parse4BitPixelData(bool is_top_fields,
       if (switch_1 == 0) {
         RCHECK(reader->ReadBits(3, &peek));
         if (peek != 0) {
-          for (int i = 0; i < peek + 2; i++)
-            RCHECK(image->AddPixel(BitDepth::k4Bit, 0, is_top_fields));
+          RCHECK(image->AddPixels(BitDepth::k4Bit, 0, peek + 2, is_top_fields));
         } else {
           break;
         }
@@ -415,29 +413,28 @@ bool DvbSubParser::Parse4BitPixelData(bool is_top_fields,
           RCHECK(reader->ReadBits(2, &peek));  // run_length_4-7
           uint8_t code;
           RCHECK(reader->ReadBits(4, &code));
-          for (int i = 0; i < peek + 4; i++)
-            RCHECK(image->AddPixel(BitDepth::k4Bit, code, is_top_fields));
+          RCHECK(image->AddPixels(BitDepth::k4Bit, code, peek + 4,
+                                  is_top_fields));
         } else {
           uint8_t switch_3;
           RCHECK(reader->ReadBits(2, &switch_3));
           if (switch_3 == 0) {
             RCHECK(image->AddPixel(BitDepth::k4Bit, 0, is_top_fields));
           } else if (switch_3 == 1) {
-            RCHECK(image->AddPixel(BitDepth::k4Bit, 0, is_top_fields));
-            RCHECK(image->AddPixel(BitDepth::k4Bit, 0, is_top_fields));
+            RCHECK(image->AddPixels(BitDepth::k4Bit, 0, 2, is_top_fields));
           } else if (switch_3 == 2) {
             RCHECK(reader->ReadBits(4, &peek));  // run_length_9-24
             uint8_t code;
             RCHECK(reader->ReadBits(4, &code));
-            for (int i = 0; i < peek + 9; i++)
-              RCHECK(image->AddPixel(BitDepth::k4Bit, code, is_top_fields));
+            RCHECK(image->AddPixels(BitDepth::k4Bit, code, peek + 9,
+                                    is_top_fields));
           } else {
             // switch_3 == 3
             RCHECK(reader->ReadBits(8, &peek));  // run_length_25-280
             uint8_t code;
             RCHECK(reader->ReadBits(4, &code));
-            for (int i = 0; i < peek + 25; i++)
-              RCHECK(image->AddPixel(BitDepth::k4Bit, code, is_top_fields));
+            RCHECK(image->AddPixels(BitDepth::k4Bit, code, peek + 25,
+                                    is_top_fields));
           }
         }
       }
@@ -461,8 +458,7 @@ bool DvbSubParser::Parse8BitPixelData(bool is_top_fields,
       if (switch_1 == 0) {
         RCHECK(reader->ReadBits(7, &peek));
         if (peek != 0) {
-          for (uint8_t i = 0; i < peek; i++)
-            RCHECK(image->AddPixel(BitDepth::k8Bit, 0, is_top_fields));
+          RCHECK(image->AddPixels(BitDepth::k8Bit, 0, peek, is_top_fields));
         } else {
           break;
         }
@@ -470,8 +466,7 @@ bool DvbSubParser::Parse8BitPixelData(bool is_top_fields,
         uint8_t count;
         RCHECK(reader->ReadBits(7, &count));
         RCHECK(reader->ReadBits(8, &peek));
-        for (uint8_t i = 0; i < count; i++)
-          RCHECK(image->AddPixel(BitDepth::k8Bit, peek, is_top_fields));
+        RCHECK(image->AddPixels(BitDepth::k8Bit, peek, count, is_top_fields));
       }
     }
   }
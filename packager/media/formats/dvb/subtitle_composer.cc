@@ -9,6 +9,8 @@
 #include <png.h>
 #include <string.h>
 
+#include <algorithm>
+
 #include "packager/base/logging.h"
 
 namespace shaka {
@@ -19,6 +21,8 @@ namespace {
 const uint16_t kDefaultWidth = 720;
 const uint16_t kDefaultHeight = 576;
 const RgbaColor kTransparent{0, 0, 0, 0};
+// PNG palettes have at most 256 entries.
+const size_t kMaxPaletteSize = 256;
 
 struct PngFreeHelper {
   PngFreeHelper(png_structp* png, png_infop* info) : png(png), info(info) {}
@@ -35,18 +39,88 @@ void PngWriteData(png_structp png, png_bytep data, png_size_t length) {
 
 void PngFlushData(png_structp png) {}
 
-bool IsTransparent(const RgbaColor* colors, uint16_t width, uint16_t height) {
-  for (size_t i = 0; i < static_cast<size_t>(width) * height; i++) {
-    if (colors[i].a != 0)
-      return false;
+bool IsTransparent(const RgbaColor* colors,
+                   uint16_t stride,
+                   uint16_t width,
+                   uint16_t height) {
+  for (size_t y = 0; y < height; y++) {
+    for (size_t x = 0; x < width; x++) {
+      if (colors[y * stride + x].a != 0)
+        return false;
+    }
+  }
+  return true;
+}
+
+// Converts the pixels to indices in |palette|, which gets the colors of the
+// image.  Since the images are mostly runs of the same color, the color of
+// the previous pixel is checked first.
+// @return False if the image has too many colors for a palette.
+bool GetPaletteIndices(const RgbaColor* pixels,
+                       uint16_t stride,
+                       uint16_t width,
+                       uint16_t height,
+                       std::vector<RgbaColor>* palette,
+                       std::vector<uint8_t>* indices) {
+  palette->clear();
+  indices->resize(static_cast<size_t>(width) * height);
+  uint8_t index = 0;
+  for (size_t y = 0; y < height; y++) {
+    const RgbaColor* row = pixels + y * stride;
+    uint8_t* out = indices->data() + y * width;
+    for (size_t x = 0; x < width; x++) {
+      if (palette->empty() || row[x] != (*palette)[index]) {
+        auto it = std::find(palette->begin(), palette->end(), row[x]);
+        if (it == palette->end()) {
+          if (palette->size() == kMaxPaletteSize)
+            return false;
+          it = palette->insert(it, row[x]);
+        }
+        index = static_cast<uint8_t>(it - palette->begin());
+      }
+      out[x] = index;
+    }
   }
   return true;
 }
 
 bool GetImageData(const DvbImageBuilder* image,
+                  int compression_level,
+                  std::vector<RgbaColor>* palette,
+                  std::vector<uint8_t>* indices,
                   std::vector<uint8_t>* data,
                   uint16_t* width,
                   uint16_t* height) {
+  const RgbaColor* pixels;
+  if (!image->GetPixels(&pixels, width, height))
+    return false;
+
+  // Most images use a handful of colors, so they are written as indexed PNGs,
+  // which are smaller and faster to compress than RGBA ones.
+  const bool use_palette = GetPaletteIndices(pixels, image->max_width(),
+                                             *width, *height, palette, indices);
+  png_color png_palette[kMaxPaletteSize];
+  png_byte png_alpha[kMaxPaletteSize];
+  int num_alpha = 0;
+  if (use_palette) {
+    for (size_t i = 0; i < palette->size(); i++) {
+      png_palette[i].red = (*palette)[i].r;
+      png_palette[i].green = (*palette)[i].g;
+      png_palette[i].blue = (*palette)[i].b;
+      png_alpha[i] = (*palette)[i].a;
+      // Trailing opaque entries can be left out of the tRNS chunk.
+      if (png_alpha[i] != 0xff)
+        num_alpha = static_cast<int>(i + 1);
+    }
+    const bool is_transparent =
+        std::all_of(palette->begin(), palette->end(),
+                    [](const RgbaColor& color) { return color.a == 0; });
+    if (is_transparent)
+      return true;  // Skip empty/transparent images.
+  } else if (IsTransparent(pixels, image->max_width(), *width, *height)) {
+    return true;  // Skip empty/transparent images.
+  }
+
   // CAREFUL in this method since this uses long-jumps.  A long-jump causes the
   // execution to jump to another point *without executing returns*.  This
   // causes C++ objects to not get destroyed.  This also causes the same code to
@@ -56,6 +130,9 @@ bool GetImageData(const DvbImageBuilder* image,
   // everything should work fine.  If we early-return after the long-jump, the
   // destructors will still be called; if we long-jump, we won't call the
   // constructors since we're past that point.
+  //
+  // A png_struct cannot be rewound once png_write_end is called, so one is
+  // created per image; the palette and index buffers are reused instead.
   auto png =
       png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
   auto info = png_create_info_struct(png);
@@ -70,21 +147,32 @@ bool GetImageData(const DvbImageBuilder* image,
     return false;
   }
   png_set_write_fn(png, data, &PngWriteData, &PngFlushData);
-
-  const RgbaColor* pixels;
-  if (!image->GetPixels(&pixels, width, height))
-    return false;
-  if (IsTransparent(pixels, *width, *height))
-    return true;  // Skip empty/transparent images.
-  png_set_IHDR(png, info, *width, *height, 8, PNG_COLOR_TYPE_RGBA,
-               PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE,
-               PNG_FILTER_TYPE_BASE);
-  png_write_info(png, info);
-
-  const uint8_t* in_data = reinterpret_cast<const uint8_t*>(pixels);
-  for (size_t y = 0; y < *height; y++) {
-    size_t offset = image->max_width() * y * sizeof(RgbaColor);
-    png_write_row(png, in_data + offset);
+  png_set_compression_level(png, compression_level);
+
+  if (use_palette) {
+    png_set_IHDR(png, info, *width, *height, 8, PNG_COLOR_TYPE_PALETTE,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE,
+                 PNG_FILTER_TYPE_BASE);
+    png_set_PLTE(png, info, png_palette, static_cast<int>(palette->size()));
+    if (num_alpha > 0)
+      png_set_tRNS(png, info, png_alpha, num_alpha, nullptr);
+    // Row filters do not help indexed images, see the PNG spec, section 12.8.
+    png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+    png_write_info(png, info);
+
+    for (size_t y = 0; y < *height; y++)
+      png_write_row(png, indices->data() + y * *width);
+  } else {
+    png_set_IHDR(png, info, *width, *height, 8, PNG_COLOR_TYPE_RGBA,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE,
+                 PNG_FILTER_TYPE_BASE);
+    png_write_info(png, info);
+
+    const uint8_t* in_data = reinterpret_cast<const uint8_t*>(pixels);
+    for (size_t y = 0; y < *height; y++) {
+      size_t offset = image->max_width() * y * sizeof(RgbaColor);
+      png_write_row(png, in_data + offset);
+    }
   }
   png_write_end(png, nullptr);
 
@@ -94,10 +182,18 @@ bool GetImageData(const DvbImageBuilder* image,
 }  // namespace
 
 SubtitleComposer::SubtitleComposer()
-    : display_width_(kDefaultWidth), display_height_(kDefaultHeight) {}
+    : display_width_(kDefaultWidth),
+      display_height_(kDefaultHeight),
+      png_compression_level_(kDefaultPngCompressionLevel) {}
 
 SubtitleComposer::~SubtitleComposer() {}
 
+void SubtitleComposer::SetPngCompressionLevel(int level) {
+  DCHECK_GE(level, 0);
+  DCHECK_LE(level, 9);
+  png_compression_level_ = level;
+}
+
 void SubtitleComposer::SetDisplaySize(uint16_t width, uint16_t height) {
   display_width_ = width;
   display_height_ = height;
@@ -215,8 +311,10 @@ bool SubtitleComposer::GetSamples(
 
     uint16_t width, height;
     std::vector<uint8_t> image_data;
-    if (!GetImageData(&it->second, &image_data, &width, &height))
+    if (!GetImageData(&it->second, png_compression_level_, &png_palette_,
+                      &png_indices_, &image_data, &width, &height)) {
       return false;
+    }
     if (image_data.empty()) {
       VLOG(1) << "Skipping transparent object";
       continue;
@@ -18,6 +18,10 @@
 namespace shaka {
 namespace media {
 
+/// The default zlib compression level of the PNG images.  This is zlib's
+/// Z_BEST_SPEED, as the images are small and mostly runs of the same color.
+const int kDefaultPngCompressionLevel = 1;
+
 /// Holds pixel/caption data for a single DVB-sub page.  This composes
 /// multiple objects and creates TextSample objects from it.
 class SubtitleComposer {
@@ -27,6 +31,9 @@ class SubtitleComposer {
 
   DISALLOW_COPY_AND_ASSIGN(SubtitleComposer);
 
+  /// Sets the zlib compression level of the PNG images, from 0 (none) to 9
+  /// (best).  Defaults to kDefaultPngCompressionLevel.
+  void SetPngCompressionLevel(int level);
   void SetDisplaySize(uint16_t width, uint16_t height);
   bool SetRegionPosition(uint8_t region_id, uint16_t x, uint16_t y);
   bool SetRegionInfo(uint8_t region_id,
@@ -71,6 +78,10 @@ class SubtitleComposer {
   std::unordered_map<uint16_t, DvbImageBuilder> images_;  // Uses object_id.
   uint16_t display_width_;
   uint16_t display_height_;
+  int png_compression_level_;
+  // Reused across the images of GetSamples.
+  mutable std::vector<RgbaColor> png_palette_;
+  mutable std::vector<uint8_t> png_indices_;
 };
 
 }  // namespace media
@@ -22,6 +22,12 @@ void CreateDefaultImage(SubtitleComposer* composer, uint16_t object_id) {
   image->NewRow(true);
 }
 
+// Offset of the color type in the PNG file, after the signature and the IHDR
+// chunk header, width, height and bit depth.
+const size_t kPngColorTypeOffset = 25;
+const uint8_t kPngColorTypePalette = 3;
+const uint8_t kPngColorTypeRgba = 6;
+
 }  // namespace
 
 TEST(SubtitleComposerTest, PositionsSamples) {
@@ -173,5 +179,55 @@ TEST(SubtitleComposerTest, IgnoresEmptyImages) {
   EXPECT_EQ(samples.size(), 1u);
 }
 
+TEST(SubtitleComposerTest, WritesIndexedImages) {
+  const uint8_t kColorSpaceId = 1;
+  const uint16_t kRegionId = 1;
+  const uint16_t kObjectId = 2;
+
+  SubtitleComposer composer;
+  ASSERT_TRUE(composer.SetRegionInfo(kRegionId, kColorSpaceId, 10, 10));
+  ASSERT_TRUE(composer.SetObjectInfo(kObjectId, kRegionId, 0, 0, kNoBgColor));
+  auto* image = composer.GetObjectImage(kObjectId);
+  EXPECT_TRUE(image->AddPixels(BitDepth::k8Bit, 1, 5, true));
+  EXPECT_TRUE(image->AddPixels(BitDepth::k8Bit, 2, 5, true));
+  image->NewRow(true);
+
+  std::vector<std::shared_ptr<TextSample>> samples;
+  ASSERT_TRUE(composer.GetSamples(0, 1, &samples));
+  ASSERT_EQ(samples.size(), 1u);
+  const std::vector<uint8_t>& png = samples[0]->body().image;
+  ASSERT_GT(png.size(), kPngColorTypeOffset);
+  EXPECT_EQ(png[kPngColorTypeOffset], kPngColorTypePalette);
+}
+
+TEST(SubtitleComposerTest, WritesRgbaImagesWithManyColors) {
+  const uint8_t kColorSpaceId = 1;
+  const uint16_t kRegionId = 1;
+  const uint16_t kObjectId = 2;
+
+  SubtitleComposer composer;
+  composer.SetDisplaySize(300, 10);
+  ASSERT_TRUE(composer.SetRegionInfo(kRegionId, kColorSpaceId, 300, 10));
+  ASSERT_TRUE(composer.SetObjectInfo(kObjectId, kRegionId, 0, 0, kNoBgColor));
+  auto* color_space = composer.GetColorSpace(kColorSpaceId);
+  auto* image = composer.GetObjectImage(kObjectId);
+  // There are 256 8-bit colors, the transparent background is one more.
+  for (int i = 0; i < 256; i++) {
+    const uint8_t code = static_cast<uint8_t>(i);
+    color_space->SetColor(BitDepth::k8Bit, code, RgbaColor{code, 0, 0, 255});
+    EXPECT_TRUE(image->AddPixel(BitDepth::k8Bit, code, true));
+  }
+  image->NewRow(true);
+  EXPECT_TRUE(image->AddPixel(BitDepth::k8Bit, 0, true));
+  image->NewRow(true);
+
+  std::vector<std::shared_ptr<TextSample>> samples;
+  ASSERT_TRUE(composer.GetSamples(0, 1, &samples));
+  ASSERT_EQ(samples.size(), 1u);
+  const std::vector<uint8_t>& png = samples[0]->body().image;
+  ASSERT_GT(png.size(), kPngColorTypeOffset);
+  EXPECT_EQ(png[kPngColorTypeOffset], kPngColorTypeRgba);
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -0,0 +1,104 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp2t/access_unit_assembler.h"
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/codecs/h26x_byte_to_unit_stream_converter.h"
+
+namespace shaka {
+namespace media {
+namespace mp2t {
+
+namespace {
+
+// The free buffers kept, in bytes of capacity. Enough for the access units of
+// a few seconds of 4K HEVC, which the fragments being built hold at once.
+const size_t kMaxFreeBufferBytes = 64 << 20;
+
+}  // namespace
+
+class AccessUnitAssembler::BufferPool {
+ public:
+  // Returns an empty buffer of at least |capacity| bytes, recycled if any.
+  std::vector<uint8_t> Take(size_t capacity) {
+    std::vector<uint8_t> buffer;
+    {
+      base::AutoLock auto_lock(lock_);
+      if (!free_buffers_.empty()) {
+        buffer.swap(free_buffers_.back());
+        free_buffers_.pop_back();
+        free_bytes_ -= buffer.capacity();
+      }
+    }
+    buffer.reserve(capacity);
+    return buffer;
+  }
+
+  void Recycle(std::vector<uint8_t>* buffer) {
+    buffer->clear();
+    base::AutoLock auto_lock(lock_);
+    if (free_bytes_ + buffer->capacity() > kMaxFreeBufferBytes)
+      return;
+    free_bytes_ += buffer->capacity();
+    free_buffers_.emplace_back();
+    free_buffers_.back().swap(*buffer);
+  }
+
+ private:
+  base::Lock lock_;
+  std::vector<std::vector<uint8_t>> free_buffers_;
+  size_t free_bytes_ = 0;
+};
+
+AccessUnitAssembler::AccessUnitAssembler(
+    H26xByteToUnitStreamConverter* stream_converter)
+    : stream_converter_(stream_converter), buffer_pool_(new BufferPool) {
+  DCHECK(stream_converter_);
+}
+
+AccessUnitAssembler::~AccessUnitAssembler() {}
+
+std::shared_ptr<MediaSample> AccessUnitAssembler::Assemble(
+    const std::vector<Nalu>& nalus,
+    size_t access_unit_size,
+    bool is_key_frame) {
+  max_access_unit_size_ = std::max(max_access_unit_size_, access_unit_size);
+  std::unique_ptr<std::vector<uint8_t>> buffer(new std::vector<uint8_t>(
+      buffer_pool_->Take(max_access_unit_size_)));
+  if (!stream_converter_->ConvertNalusToNalUnitStream(nalus, access_unit_size,
+                                                      buffer.get())) {
+    DLOG(ERROR) << "Failure to convert video frame to unit stream format.";
+    buffer_pool_->Recycle(buffer.get());
+    return nullptr;
+  }
+
+  // The buffer goes back to the pool, if it still exists, once the sample and
+  // its clones are released.
+  std::weak_ptr<BufferPool> weak_pool = buffer_pool_;
+  std::shared_ptr<std::vector<uint8_t>> shared_buffer(
+      buffer.release(), [weak_pool](std::vector<uint8_t>* buffer) {
+        if (std::shared_ptr<BufferPool> pool = weak_pool.lock())
+          pool->Recycle(buffer);
+        delete buffer;
+      });
+  const size_t size = shared_buffer->size();
+  // The aliasing constructor keeps |shared_buffer| alive as long as the data
+  // is referenced.
+  std::shared_ptr<uint8_t> data(shared_buffer, shared_buffer->data());
+  std::shared_ptr<MediaSample> sample = MediaSample::CreateEmptyMediaSample();
+  sample->set_is_key_frame(is_key_frame);
+  sample->TransferData(std::move(data), size);
+  return sample;
+}
+
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
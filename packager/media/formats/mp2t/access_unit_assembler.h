@@ -0,0 +1,66 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_FORMATS_MP2T_ACCESS_UNIT_ASSEMBLER_H_
+#define PACKAGER_MEDIA_FORMATS_MP2T_ACCESS_UNIT_ASSEMBLER_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "packager/media/codecs/nalu_reader.h"
+
+namespace shaka {
+namespace media {
+
+class H26xByteToUnitStreamConverter;
+class MediaSample;
+
+namespace mp2t {
+
+/// Assembles the access units of an H.264/H.265 elementary stream into
+/// samples, in buffers which are recycled once the samples are released, so
+/// that large and frequent access units, e.g. of 4K HEVC, are not allocated,
+/// and page faulted in, one by one. The buffers are handed to the samples
+/// without copying them, and are sized from the largest access unit so far.
+class AccessUnitAssembler {
+ public:
+  /// @param stream_converter converts the access units to unit stream
+  ///        format. It is not owned and must outlive the assembler.
+  explicit AccessUnitAssembler(
+      H26xByteToUnitStreamConverter* stream_converter);
+  ~AccessUnitAssembler();
+
+  /// Converts an access unit to unit stream format into a sample.
+  /// @param nalus are the NAL units of the access unit, in order.
+  /// @param access_unit_size is the size of the access unit in byte stream
+  ///        format.
+  /// @param is_key_frame indicates whether the access unit is a key frame.
+  /// @return The sample, or null on failure.
+  std::shared_ptr<MediaSample> Assemble(const std::vector<Nalu>& nalus,
+                                        size_t access_unit_size,
+                                        bool is_key_frame);
+
+ private:
+  AccessUnitAssembler(const AccessUnitAssembler&) = delete;
+  AccessUnitAssembler& operator=(const AccessUnitAssembler&) = delete;
+
+  // The free buffers, shared with the samples as they may outlive the
+  // assembler. Thread safe, as the samples are released on other threads.
+  class BufferPool;
+
+  H26xByteToUnitStreamConverter* const stream_converter_;
+  const std::shared_ptr<BufferPool> buffer_pool_;
+  // Largest access unit so far, in byte stream format.
+  size_t max_access_unit_size_ = 0;
+};
+
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_FORMATS_MP2T_ACCESS_UNIT_ASSEMBLER_H_
@@ -0,0 +1,95 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp2t/access_unit_assembler.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/media/base/media_sample.h"
+#include "packager/media/codecs/h264_byte_to_unit_stream_converter.h"
+
+using ::testing::ElementsAreArray;
+
+namespace shaka {
+namespace media {
+namespace mp2t {
+
+namespace {
+
+// An IDR slice NAL unit, with a start code.
+const uint8_t kAccessUnit[] = {0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x00, 0x21};
+const size_t kStartCodeSize = 3;
+// The slice in unit stream format.
+const uint8_t kConvertedAccessUnit[] = {0x00, 0x00, 0x00, 0x05, 0x65,
+                                        0x88, 0x84, 0x00, 0x21};
+
+}  // namespace
+
+class AccessUnitAssemblerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    Nalu nalu;
+    ASSERT_TRUE(nalu.Initialize(Nalu::kH264, kAccessUnit + kStartCodeSize,
+                                sizeof(kAccessUnit) - kStartCodeSize));
+    nalus_.push_back(nalu);
+  }
+
+  std::shared_ptr<MediaSample> Assemble() {
+    return assembler_.Assemble(nalus_, sizeof(kAccessUnit), true);
+  }
+
+  H264ByteToUnitStreamConverter stream_converter_{
+      H26xStreamFormat::kNalUnitStreamWithoutParameterSetNalus};
+  AccessUnitAssembler assembler_{&stream_converter_};
+  std::vector<Nalu> nalus_;
+};
+
+TEST_F(AccessUnitAssemblerTest, Assemble) {
+  std::shared_ptr<MediaSample> sample = Assemble();
+  ASSERT_TRUE(sample);
+  EXPECT_TRUE(sample->is_key_frame());
+  EXPECT_THAT(std::vector<uint8_t>(sample->data(),
+                                   sample->data() + sample->data_size()),
+              ElementsAreArray(kConvertedAccessUnit));
+  // The sample can be encrypted in place.
+  EXPECT_TRUE(sample->is_data_writable());
+}
+
+TEST_F(AccessUnitAssemblerTest, RecyclesBuffers) {
+  std::shared_ptr<MediaSample> sample = Assemble();
+  ASSERT_TRUE(sample);
+  const uint8_t* data = sample->data();
+  sample.reset();
+
+  sample = Assemble();
+  ASSERT_TRUE(sample);
+  EXPECT_EQ(data, sample->data());
+  EXPECT_THAT(std::vector<uint8_t>(sample->data(),
+                                   sample->data() + sample->data_size()),
+              ElementsAreArray(kConvertedAccessUnit));
+
+  // The buffers still held by samples are not reused.
+  std::shared_ptr<MediaSample> other_sample = Assemble();
+  ASSERT_TRUE(other_sample);
+  EXPECT_NE(sample->data(), other_sample->data());
+}
+
+TEST_F(AccessUnitAssemblerTest, SampleOutlivesAssembler) {
+  std::shared_ptr<MediaSample> sample;
+  {
+    AccessUnitAssembler assembler(&stream_converter_);
+    sample = assembler.Assemble(nalus_, sizeof(kAccessUnit), false);
+    ASSERT_TRUE(sample);
+  }
+  EXPECT_THAT(std::vector<uint8_t>(sample->data(),
+                                   sample->data() + sample->data_size()),
+              ElementsAreArray(kConvertedAccessUnit));
+}
+
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
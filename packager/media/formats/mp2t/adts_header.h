@@ -27,6 +27,7 @@ class AdtsHeader : public AudioHeader {
   /// @name AudioHeader implementation overrides.
   /// @{
   bool IsSyncWord(const uint8_t* buf) const override;
+  uint8_t GetSyncWordFirstByte() const override;
   size_t GetMinFrameSize() const override;
   size_t GetSamplesPerFrame() const override;
   bool Parse(const uint8_t* adts_frame, size_t adts_frame_size) override;
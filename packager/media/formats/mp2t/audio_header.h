@@ -26,6 +26,10 @@ class AudioHeader {
   /// @return true if corresponds to a syncword.
   virtual bool IsSyncWord(const uint8_t* buf) const = 0;
 
+  /// @return The first byte of the syncword. It is used to skip the bytes
+  ///         which cannot start a syncword without calling IsSyncWord().
+  virtual uint8_t GetSyncWordFirstByte() const = 0;
+
   /// @return The minium frame size.
   virtual size_t GetMinFrameSize() const = 0;
 
@@ -0,0 +1,65 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp2t/crc32_mpeg2.h"
+
+namespace shaka {
+namespace media {
+namespace mp2t {
+
+namespace {
+
+const uint32_t kCrcPoly = 0x04c11db7;
+
+// Tables for slicing-by-8: |table[0]| is the usual byte-wise table and
+// |table[k][b]| is the CRC of byte |b| followed by |k| zero bytes, so eight
+// bytes are processed per iteration with independent lookups.
+struct CrcTables {
+  CrcTables() {
+    for (uint32_t b = 0; b < 256; ++b) {
+      uint32_t crc = b << 24;
+      for (int bit = 0; bit < 8; ++bit)
+        crc = (crc & 0x80000000) ? (crc << 1) ^ kCrcPoly : crc << 1;
+      table[0][b] = crc;
+    }
+    for (int k = 1; k < 8; ++k) {
+      for (int b = 0; b < 256; ++b) {
+        const uint32_t crc = table[k - 1][b];
+        table[k][b] = (crc << 8) ^ table[0][crc >> 24];
+      }
+    }
+  }
+
+  uint32_t table[8][256];
+};
+
+const CrcTables& GetCrcTables() {
+  static const CrcTables tables;
+  return tables;
+}
+
+}  // namespace
+
+uint32_t Crc32Mpeg2(const uint8_t* data, size_t data_size) {
+  const uint32_t(&table)[8][256] = GetCrcTables().table;
+  uint32_t crc = 0xFFFFFFFF;
+  for (; data_size >= 8; data += 8, data_size -= 8) {
+    crc ^= static_cast<uint32_t>(data[0]) << 24 |
+           static_cast<uint32_t>(data[1]) << 16 |
+           static_cast<uint32_t>(data[2]) << 8 | data[3];
+    crc = table[7][crc >> 24] ^ table[6][(crc >> 16) & 0xFF] ^
+          table[5][(crc >> 8) & 0xFF] ^ table[4][crc & 0xFF] ^
+          table[3][data[4]] ^ table[2][data[5]] ^ table[1][data[6]] ^
+          table[0][data[7]];
+  }
+  for (; data_size > 0; ++data, --data_size)
+    crc = table[0][(crc >> 24) ^ *data] ^ (crc << 8);
+  return crc;
+}
+
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,28 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_FORMATS_MP2T_CRC32_MPEG2_H_
+#define PACKAGER_MEDIA_FORMATS_MP2T_CRC32_MPEG2_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace shaka {
+namespace media {
+namespace mp2t {
+
+/// Computes the CRC32/MPEG2 of the PSI sections, i.e. polynomial 0x04c11db7,
+/// initial value 0xffffffff, no reflection and no final xor. See
+/// http://reveng.sourceforge.net/crc-catalogue/all.htm.
+/// @return the CRC of @a data. It is 0 if @a data is a section ending with its
+///         CRC_32 field, i.e. if the CRC is valid.
+uint32_t Crc32Mpeg2(const uint8_t* data, size_t data_size);
+
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_FORMATS_MP2T_CRC32_MPEG2_H_
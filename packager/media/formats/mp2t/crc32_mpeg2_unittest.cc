@@ -0,0 +1,70 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp2t/crc32_mpeg2.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace shaka {
+namespace media {
+namespace mp2t {
+
+namespace {
+
+// Bit-wise reference implementation.
+uint32_t ReferenceCrc32Mpeg2(const uint8_t* data, size_t data_size) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < data_size; ++i) {
+    crc ^= static_cast<uint32_t>(data[i]) << 24;
+    for (int bit = 0; bit < 8; ++bit)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+  return crc;
+}
+
+}  // namespace
+
+TEST(Crc32Mpeg2Test, CheckValue) {
+  const uint8_t kData[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  EXPECT_EQ(0x0376E6E7u, Crc32Mpeg2(kData, sizeof(kData)));
+  EXPECT_EQ(0xFFFFFFFFu, Crc32Mpeg2(kData, 0));
+}
+
+TEST(Crc32Mpeg2Test, MatchesReference) {
+  std::vector<uint8_t> data(1024);
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = static_cast<uint8_t>(i * 131 + 7);
+
+  // All the sizes and alignments around the 8 byte blocks.
+  for (size_t offset = 0; offset < 8; ++offset) {
+    for (size_t size = 0; size + offset <= 40; ++size) {
+      EXPECT_EQ(ReferenceCrc32Mpeg2(&data[offset], size),
+                Crc32Mpeg2(&data[offset], size))
+          << "offset " << offset << " size " << size;
+    }
+  }
+  EXPECT_EQ(ReferenceCrc32Mpeg2(data.data(), data.size()),
+            Crc32Mpeg2(data.data(), data.size()));
+}
+
+TEST(Crc32Mpeg2Test, SectionWithCrcIsZero) {
+  // PAT with program 1 on PID 0x20.
+  std::vector<uint8_t> section = {0x00, 0xB0, 0x0D, 0x00, 0x00, 0xC1,
+                                  0x00, 0x00, 0x00, 0x01, 0xE0, 0x20};
+  const uint32_t crc = Crc32Mpeg2(section.data(), section.size());
+  for (int shift = 24; shift >= 0; shift -= 8)
+    section.push_back(static_cast<uint8_t>(crc >> shift));
+  EXPECT_EQ(0u, Crc32Mpeg2(section.data(), section.size()));
+
+  section[5] ^= 0x01;
+  EXPECT_NE(0u, Crc32Mpeg2(section.data(), section.size()));
+}
+
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
@@ -5,6 +5,7 @@
 #include "packager/media/formats/mp2t/es_parser_audio.h"
 
 #include <stdint.h>
+#include <string.h>
 
 #include <algorithm>
 #include <list>
@@ -54,7 +55,17 @@ static bool LookForSyncWord(const uint8_t* raw_es,
     return false;
   }
 
+  const uint8_t sync_word_first_byte = audio_header->GetSyncWordFirstByte();
   for (int offset = pos; offset < max_offset; offset++) {
+    // In sync, a frame starts at |pos|. Otherwise, look for the first byte of
+    // the syncword with memchr, which is much faster than checking every byte.
+    if (raw_es[offset] != sync_word_first_byte) {
+      const void* next = memchr(&raw_es[offset], sync_word_first_byte,
+                                max_offset - offset);
+      if (!next)
+        break;
+      offset = static_cast<int>(static_cast<const uint8_t*>(next) - raw_es);
+    }
     const uint8_t* cur_buf = &raw_es[offset];
 
     if (!audio_header->IsSyncWord(cur_buf))
@@ -195,12 +206,12 @@ void EsParserAudio::Reset() {
 bool EsParserAudio::UpdateAudioConfiguration(const AudioHeader& audio_header) {
   const uint8_t kAacSampleSizeBits(16);
 
-  std::vector<uint8_t> audio_specific_config;
-  audio_header.GetAudioSpecificConfig(&audio_specific_config);
+  // This is called for every frame, so the vector is reused.
+  audio_header.GetAudioSpecificConfig(&audio_specific_config_);
 
   if (last_audio_decoder_config_) {
     // Verify that the audio decoder config has not changed.
-    if (last_audio_decoder_config_->codec_config() == audio_specific_config) {
+    if (last_audio_decoder_config_->codec_config() == audio_specific_config_) {
       // Audio configuration has not changed.
       return true;
     }
@@ -225,7 +236,7 @@ bool EsParserAudio::UpdateAudioConfiguration(const AudioHeader& audio_header) {
   last_audio_decoder_config_ = std::make_shared<AudioStreamInfo>(
       pid(), kMpeg2Timescale, kInfiniteDuration, codec,
       AudioStreamInfo::GetCodecString(codec, audio_header.GetObjectType()),
-      audio_specific_config.data(), audio_specific_config.size(),
+      audio_specific_config_.data(), audio_specific_config_.size(),
       kAacSampleSizeBits, audio_header.GetNumChannels(),
       extended_samples_per_second, 0 /* seek preroll */, 0 /* codec delay */,
       0 /* max bitrate */, 0 /* avg bitrate */, std::string(), false);
@@ -8,6 +8,7 @@
 #include <list>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "packager/base/callback.h"
 #include "packager/base/compiler_specific.h"
@@ -77,6 +78,8 @@ class EsParserAudio : public EsParser {
   std::unique_ptr<AudioTimestampHelper> audio_timestamp_helper_;
 
   std::shared_ptr<StreamInfo> last_audio_decoder_config_;
+  // The AudioSpecificConfig of the last frame.
+  std::vector<uint8_t> audio_specific_config_;
 };
 
 }  // namespace mp2t
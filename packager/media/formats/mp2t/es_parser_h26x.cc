@@ -8,11 +8,13 @@
 
 #include "packager/base/logging.h"
 #include "packager/base/numerics/safe_conversions.h"
+#include "packager/media/base/hot_path_log.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/offset_byte_queue.h"
 #include "packager/media/base/timestamp.h"
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/codecs/h26x_byte_to_unit_stream_converter.h"
+#include "packager/media/formats/mp2t/access_unit_assembler.h"
 #include "packager/media/formats/mp2t/mp2t_common.h"
 
 namespace shaka {
@@ -36,7 +38,9 @@ EsParserH26x::EsParserH26x(
       emit_sample_cb_(emit_sample_cb),
       type_(type),
       es_queue_(new media::OffsetByteQueue()),
-      stream_converter_(std::move(stream_converter)) {}
+      stream_converter_(std::move(stream_converter)),
+      access_unit_assembler_(
+          new AccessUnitAssembler(stream_converter_.get())) {}
 
 EsParserH26x::~EsParserH26x() {}
 
@@ -114,6 +118,7 @@ void EsParserH26x::Reset() {
   next_access_unit_position_set_ = false;
   next_access_unit_position_ = 0;
   current_nalu_info_.reset();
+  nalu_locations_.clear();
   timing_desc_list_.clear();
   pending_sample_ = std::shared_ptr<MediaSample>();
   pending_sample_duration_ = 0;
@@ -175,6 +180,9 @@ bool EsParserH26x::SearchForNalu(uint64_t* position, Nalu* nalu) {
                                        current_nalu_info_->position -
                                        current_nalu_info_->start_code_size;
     CHECK(nalu->Initialize(type_, current_nalu_ptr, current_nalu_size));
+    nalu_locations_.push_back(
+        {current_nalu_info_->position + current_nalu_info_->start_code_size,
+         current_nalu_size});
   }
   current_nalu_info_.swap(next_nalu_info_);
   return current_nalu_set ? true : SearchForNalu(position, nalu);
@@ -251,6 +259,10 @@ bool EsParserH26x::ParseInternal() {
 
     // Delete the data we have already processed.
     es_queue_->Trim(next_access_unit_position_);
+    while (!nalu_locations_.empty() &&
+           nalu_locations_.front().position < next_access_unit_position_) {
+      nalu_locations_.pop_front();
+    }
 
     current_access_unit_position_ = next_access_unit_position_;
     current_video_slice_info_ = video_slice_info;
@@ -290,29 +302,42 @@ bool EsParserH26x::EmitFrame(int64_t access_unit_pos,
     return false;
 
   // Emit a frame.
-  DVLOG(LOG_LEVEL_ES) << "Emit frame: stream_pos=" << access_unit_pos
-                      << " size=" << access_unit_size << " pts "
-                      << current_timing_desc.pts << " timing_desc_list size "
-                      << timing_desc_list_.size();
+  HOT_PATH_LOG(kEsParser) << "Emit frame: stream_pos=" << access_unit_pos
+                          << " size=" << access_unit_size << " pts "
+                          << current_timing_desc.pts
+                          << " timing_desc_list size "
+                          << timing_desc_list_.size();
   int es_size;
   const uint8_t* es;
   es_queue_->PeekAt(access_unit_pos, &es, &es_size);
 
-  // Convert frame to unit stream format.
-  std::vector<uint8_t> converted_frame;
-  if (!stream_converter_->ConvertByteStreamToNalUnitStream(
-          es, access_unit_size, &converted_frame)) {
-    DLOG(ERROR) << "Failure to convert video frame to unit stream format.";
-    return false;
+  // Collect the NAL units of the frame, dropping those of the frames before
+  // it, which were not emitted.
+  while (!nalu_locations_.empty() &&
+         nalu_locations_.front().position < access_unit_pos) {
+    nalu_locations_.pop_front();
   }
+  access_unit_nalus_.clear();
+  while (!nalu_locations_.empty() &&
+         nalu_locations_.front().position <
+             static_cast<uint64_t>(access_unit_pos + access_unit_size)) {
+    const NaluLocation& location = nalu_locations_.front();
+    Nalu nalu;
+    CHECK(nalu.Initialize(type_, es + (location.position - access_unit_pos),
+                          location.size));
+    access_unit_nalus_.push_back(nalu);
+    nalu_locations_.pop_front();
+  }
+
+  // Convert frame to unit stream format, in a recycled buffer.
+  std::shared_ptr<MediaSample> media_sample = access_unit_assembler_->Assemble(
+      access_unit_nalus_, access_unit_size, is_key_frame);
+  RCHECK(media_sample);
 
   // Update the video decoder configuration if needed.
   RCHECK(UpdateVideoDecoderConfig(pps_id));
 
-  // Create the media sample, emitting always the previous sample after
-  // calculating its duration.
-  std::shared_ptr<MediaSample> media_sample = MediaSample::CopyFrom(
-      converted_frame.data(), converted_frame.size(), is_key_frame);
+  // Emit always the previous sample after calculating its duration.
   media_sample->set_dts(current_timing_desc.dts);
   media_sample->set_pts(current_timing_desc.pts);
   if (pending_sample_) {
@@ -10,6 +10,7 @@
 #include <deque>
 #include <list>
 #include <memory>
+#include <vector>
 
 #include "packager/base/callback.h"
 #include "packager/base/compiler_specific.h"
@@ -24,6 +25,8 @@ class OffsetByteQueue;
 
 namespace mp2t {
 
+class AccessUnitAssembler;
+
 // A base class for common code between the H.264/H.265 es parsers.
 class EsParserH26x : public EsParser {
  public:
@@ -66,6 +69,11 @@ class EsParserH26x : public EsParser {
     uint64_t position = 0;
     uint8_t start_code_size = 0;
   };
+  // The location of a NAL unit in the ES queue, without its start code.
+  struct NaluLocation {
+    uint64_t position;
+    uint64_t size;
+  };
 
   // Processes a NAL unit found in ParseInternal. |video_slice_info| should not
   // be null, it will contain the video slice info if it is a video slice nalu
@@ -121,9 +129,16 @@ class EsParserH26x : public EsParser {
   std::unique_ptr<NaluInfo> current_nalu_info_;
   // This is really a temporary storage for the next nalu information.
   std::unique_ptr<NaluInfo> next_nalu_info_;
+  // The NAL units found by SearchForNalu and not emitted yet, so the access
+  // units are converted without searching them for start codes again.
+  std::deque<NaluLocation> nalu_locations_;
+  // The NAL units of the access unit being emitted, kept to reuse its memory.
+  std::vector<Nalu> access_unit_nalus_;
 
   // Filter to convert H.264/H.265 Annex B byte stream to unit stream.
   std::unique_ptr<H26xByteToUnitStreamConverter> stream_converter_;
+  // Assembles the converted access units in recycled buffers.
+  std::unique_ptr<AccessUnitAssembler> access_unit_assembler_;
 
   // Frame for which we do not yet have a duration.
   std::shared_ptr<MediaSample> pending_sample_;
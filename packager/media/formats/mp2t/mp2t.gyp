@@ -13,6 +13,8 @@
       'target_name': 'mp2t',
       'type': '<(component)',
       'sources': [
+        'access_unit_assembler.cc',
+        'access_unit_assembler.h',
         'ac3_header.cc',
         'ac3_header.h',
         'adts_header.cc',
@@ -20,6 +22,8 @@
         'audio_header.h',
         'continuity_counter.cc',
         'continuity_counter.h',
+        'crc32_mpeg2.cc',
+        'crc32_mpeg2.h',
         'es_parser_audio.cc',
         'es_parser_audio.h',
         'es_parser_dvb.cc',
@@ -47,6 +51,8 @@
         'ts_packet.h',
         'ts_packet_writer_util.cc',
         'ts_packet_writer_util.h',
+        'ts_passthrough.cc',
+        'ts_passthrough.h',
         'ts_section_pat.cc',
         'ts_section_pat.h',
         'ts_section_pes.cc',
@@ -65,6 +71,7 @@
         '../../base/media_base.gyp:media_base',
         '../../crypto/crypto.gyp:crypto',
         '../../codecs/codecs.gyp:codecs',
+        '../../origin/origin.gyp:origin',
         '../dvb/dvb.gyp:dvb',
       ],
     },
@@ -72,14 +79,17 @@
       'target_name': 'mp2t_unittest',
       'type': '<(gtest_target_type)',
       'sources': [
+        'access_unit_assembler_unittest.cc',
         'ac3_header_unittest.cc',
         'adts_header_unittest.cc',
+        'crc32_mpeg2_unittest.cc',
         'es_parser_h264_unittest.cc',
         'es_parser_h26x_unittest.cc',
         'mp2t_media_parser_unittest.cc',
         'mpeg1_header_unittest.cc',
         'pes_packet_generator_unittest.cc',
         'program_map_table_writer_unittest.cc',
+        'ts_passthrough_unittest.cc',
         'ts_segmenter_unittest.cc',
         'ts_writer_unittest.cc',
       ],
@@ -4,6 +4,7 @@
 
 #include "packager/media/formats/mp2t/mp2t_media_parser.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "packager/base/bind.h"
@@ -148,8 +149,11 @@ void PidState::ResetState() {
   continuity_counter_ = -1;
 }
 
+const int Mp2tMediaParser::kNumPids;
+
 Mp2tMediaParser::Mp2tMediaParser()
     : sbr_in_mimetype_(false),
+      pid_lookup_table_(kNumPids, nullptr),
       is_initialized_(false) {
 }
 
@@ -181,6 +185,7 @@ bool Mp2tMediaParser::Flush() {
   }
   bool result = EmitRemainingSamples();
   pids_.clear();
+  std::fill(pid_lookup_table_.begin(), pid_lookup_table_.end(), nullptr);
 
   // Remove any bytes left in the TS buffer.
   // (i.e. any partial TS packet => less than 188 bytes).
@@ -191,12 +196,26 @@ bool Mp2tMediaParser::Flush() {
 bool Mp2tMediaParser::Parse(const uint8_t* buf, int size) {
   DVLOG(2) << "Mp2tMediaParser::Parse size=" << size;
 
+  // Fast path: when no bytes are buffered, the synchronized TS packets at the
+  // start of |buf| are processed in place, which is the common case with
+  // packet aligned reads, e.g. UDP datagrams of 7 packets. Only the rest goes
+  // through the byte queue.
+  const uint8_t* ts_buffer;
+  int ts_buffer_size;
+  ts_byte_queue_.Peek(&ts_buffer, &ts_buffer_size);
+  if (ts_buffer_size == 0) {
+    while (size >= TsPacket::kPacketSize && TsPacket::Sync(buf, size) == 0 &&
+           TsPacket::Parse(buf, size, &ts_packet_)) {
+      RCHECK(ProcessTsPacket(ts_packet_));
+      buf += TsPacket::kPacketSize;
+      size -= TsPacket::kPacketSize;
+    }
+  }
+
   // Add the data to the parser state.
   ts_byte_queue_.Push(buf, size);
 
   while (true) {
-    const uint8_t* ts_buffer;
-    int ts_buffer_size;
     ts_byte_queue_.Peek(&ts_buffer, &ts_buffer_size);
     if (ts_buffer_size < TsPacket::kPacketSize)
       break;
@@ -211,35 +230,12 @@ bool Mp2tMediaParser::Parse(const uint8_t* buf, int size) {
     }
 
     // Parse the TS header, skipping 1 byte if the header is invalid.
-    std::unique_ptr<TsPacket> ts_packet(
-        TsPacket::Parse(ts_buffer, ts_buffer_size));
-    if (!ts_packet) {
+    if (!TsPacket::Parse(ts_buffer, ts_buffer_size, &ts_packet_)) {
       DVLOG(1) << "Error: invalid TS packet";
       ts_byte_queue_.Pop(1);
       continue;
     }
-    DVLOG(LOG_LEVEL_TS)
-        << "Processing PID=" << ts_packet->pid()
-        << " start_unit=" << ts_packet->payload_unit_start_indicator();
-
-    // Parse the section.
-    auto it = pids_.find(ts_packet->pid());
-    if (it == pids_.end() &&
-        ts_packet->pid() == TsSection::kPidPat) {
-      // Create the PAT state here if needed.
-      std::unique_ptr<TsSection> pat_section_parser(new TsSectionPat(
-          base::Bind(&Mp2tMediaParser::RegisterPmt, base::Unretained(this))));
-      std::unique_ptr<PidState> pat_pid_state(new PidState(
-          ts_packet->pid(), PidState::kPidPat, std::move(pat_section_parser)));
-      pat_pid_state->Enable();
-      it = pids_.emplace(ts_packet->pid(), std::move(pat_pid_state)).first;
-    }
-
-    if (it != pids_.end()) {
-      RCHECK(it->second->PushTsPacket(*ts_packet));
-    } else {
-      DVLOG(LOG_LEVEL_TS) << "Ignoring TS packet for pid: " << ts_packet->pid();
-    }
+    RCHECK(ProcessTsPacket(ts_packet_));
 
     // Go to the next packet.
     ts_byte_queue_.Pop(TsPacket::kPacketSize);
@@ -249,6 +245,59 @@ bool Mp2tMediaParser::Parse(const uint8_t* buf, int size) {
   return EmitRemainingSamples();
 }
 
+bool Mp2tMediaParser::ProcessTsPacket(const TsPacket& ts_packet) {
+  DVLOG(LOG_LEVEL_TS)
+      << "Processing PID=" << ts_packet.pid()
+      << " start_unit=" << ts_packet.payload_unit_start_indicator();
+
+  // Parse the section.
+  PidState* pid_state = pid_lookup_table_[ts_packet.pid()];
+  if (!pid_state && ts_packet.pid() == TsSection::kPidPat) {
+    // Create the PAT state here if needed.
+    std::unique_ptr<TsSection> pat_section_parser(new TsSectionPat(
+        base::Bind(&Mp2tMediaParser::RegisterPmt, base::Unretained(this))));
+    std::unique_ptr<PidState> pat_pid_state(new PidState(
+        ts_packet.pid(), PidState::kPidPat, std::move(pat_section_parser)));
+    pat_pid_state->Enable();
+    pid_state = AddPidState(ts_packet.pid(), std::move(pat_pid_state));
+  }
+
+  if (!pid_state) {
+    DVLOG(LOG_LEVEL_TS) << "Ignoring TS packet for pid: " << ts_packet.pid();
+    return true;
+  }
+  if (!IsPidSelected(ts_packet.pid(), *pid_state)) {
+    DVLOG(LOG_LEVEL_TS)
+        << "Ignoring TS packet for unselected pid: " << ts_packet.pid();
+    return true;
+  }
+  return pid_state->PushTsPacket(ts_packet);
+}
+
+PidState* Mp2tMediaParser::AddPidState(int pid,
+                                       std::unique_ptr<PidState> pid_state) {
+  DCHECK_GE(pid, 0);
+  DCHECK_LT(pid, kNumPids);
+  auto result = pids_.emplace(pid, std::move(pid_state));
+  if (result.second)
+    pid_lookup_table_[pid] = result.first->second.get();
+  return result.first->second.get();
+}
+
+void Mp2tMediaParser::SetSelectedTracks(const std::set<uint32_t>& track_ids) {
+  all_tracks_selected_ = false;
+  selected_track_ids_ = track_ids;
+}
+
+bool Mp2tMediaParser::IsPidSelected(int pid, const PidState& pid_state) const {
+  if (all_tracks_selected_ || pid_state.pid_type() == PidState::kPidPat ||
+      pid_state.pid_type() == PidState::kPidPmt) {
+    return true;
+  }
+  // The track id of an elementary stream is its pid.
+  return selected_track_ids_.count(static_cast<uint32_t>(pid)) > 0;
+}
+
 void Mp2tMediaParser::RegisterPmt(int program_number, int pmt_pid) {
   DVLOG(1) << "RegisterPmt:"
            << " program_number=" << program_number
@@ -270,7 +319,7 @@ void Mp2tMediaParser::RegisterPmt(int program_number, int pmt_pid) {
   std::unique_ptr<PidState> pmt_pid_state(
       new PidState(pmt_pid, PidState::kPidPmt, std::move(pmt_section_parser)));
   pmt_pid_state->Enable();
-  pids_.emplace(pmt_pid, std::move(pmt_pid_state));
+  AddPidState(pmt_pid, std::move(pmt_pid_state));
 }
 
 void Mp2tMediaParser::RegisterPes(int pmt_pid,
@@ -331,7 +380,7 @@ void Mp2tMediaParser::RegisterPes(int pmt_pid,
   std::unique_ptr<PidState> pes_pid_state(
       new PidState(pes_pid, pid_type, std::move(pes_section_parser)));
   pes_pid_state->Enable();
-  pids_.emplace(pes_pid, std::move(pes_pid_state));
+  AddPidState(pes_pid, std::move(pes_pid_state));
 }
 
 void Mp2tMediaParser::OnNewStreamInfo(
@@ -437,14 +486,17 @@ bool Mp2tMediaParser::EmitRemainingSamples() {
 
   // Buffer emission.
   for (const auto& pid_pair : pids_) {
-    for (auto sample : pid_pair.second->media_sample_queue_) {
-      RCHECK(new_media_sample_cb_.Run(pid_pair.first, sample));
+    // Samples queued before the tracks were selected are dropped if their
+    // track is not selected.
+    if (IsPidSelected(pid_pair.first, *pid_pair.second)) {
+      for (auto sample : pid_pair.second->media_sample_queue_) {
+        RCHECK(new_media_sample_cb_.Run(pid_pair.first, sample));
+      }
+      for (auto sample : pid_pair.second->text_sample_queue_) {
+        RCHECK(new_text_sample_cb_.Run(pid_pair.first, sample));
+      }
     }
     pid_pair.second->media_sample_queue_.clear();
-
-    for (auto sample : pid_pair.second->text_sample_queue_) {
-      RCHECK(new_text_sample_cb_.Run(pid_pair.first, sample));
-    }
     pid_pair.second->text_sample_queue_.clear();
   }
 
@@ -9,10 +9,13 @@
 #include <deque>
 #include <map>
 #include <memory>
+#include <set>
+#include <vector>
 
 #include "packager/media/base/byte_queue.h"
 #include "packager/media/base/media_parser.h"
 #include "packager/media/base/stream_info.h"
+#include "packager/media/formats/mp2t/ts_packet.h"
 #include "packager/media/formats/mp2t/ts_stream_type.h"
 
 namespace shaka {
@@ -23,7 +26,6 @@ class MediaSample;
 namespace mp2t {
 
 class PidState;
-class TsPacket;
 class TsSection;
 
 class Mp2tMediaParser : public MediaParser {
@@ -39,9 +41,21 @@ class Mp2tMediaParser : public MediaParser {
             KeySource* decryption_key_source) override;
   bool Flush() override WARN_UNUSED_RESULT;
   bool Parse(const uint8_t* buf, int size) override WARN_UNUSED_RESULT;
+  void SetSelectedTracks(const std::set<uint32_t>& track_ids) override;
   /// @}
 
  private:
+  // Number of PIDs, which are 13 bits.
+  static const int kNumPids = 1 << 13;
+
+  // Parses the section of |ts_packet| with the state of its PID.
+  // Return true if successful.
+  bool ProcessTsPacket(const TsPacket& ts_packet);
+
+  // Adds the state of |pid| if it does not have one yet.
+  // Returns the state of |pid|.
+  PidState* AddPidState(int pid, std::unique_ptr<PidState> pid_state);
+
   // Callback invoked to register a Program Map Table.
   // Note: Does nothing if the PID is already registered.
   void RegisterPmt(int program_number, int pmt_pid);
@@ -73,6 +87,10 @@ class Mp2tMediaParser : public MediaParser {
 
   bool EmitRemainingSamples();
 
+  // Whether the TS packets of |pid| are needed. The packets of PES pids of
+  // tracks that are not selected are dropped before PES assembly.
+  bool IsPidSelected(int pid, const PidState& pid_state) const;
+
   /// Set the value of the "SBR in mime-type" flag which leads to sample rate
   /// doubling. Default value is false.
   void set_sbr_in_mime_type(bool sbr_in_mimetype) {
@@ -89,13 +107,21 @@ class Mp2tMediaParser : public MediaParser {
   // Bytes of the TS media.
   ByteQueue ts_byte_queue_;
 
+  // Reused for parsing the TS packets.
+  TsPacket ts_packet_;
+
   // Map of PIDs and their states.  Use an ordered map so manifest generation
   // has a deterministic order.
   std::map<int, std::unique_ptr<PidState>> pids_;
+  // The states in |pids_| indexed by PID, for the lookup of every TS packet.
+  std::vector<PidState*> pid_lookup_table_;
 
   // Whether |init_cb_| has been invoked.
   bool is_initialized_;
 
+  bool all_tracks_selected_ = true;
+  std::set<uint32_t> selected_track_ids_;
+
   // A map used to track unsupported stream types and make sure the error is
   // only logged once.
   std::bitset<256> stream_type_logged_once_;
@@ -5,6 +5,7 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <set>
 #include <string>
 
 #include "packager/base/bind.h"
@@ -41,6 +42,7 @@ class Mp2tMediaParserTest : public testing::Test {
   int video_frame_count_;
   int64_t video_min_dts_;
   int64_t video_max_dts_;
+  bool select_video_only_ = false;
 
   bool AppendData(const uint8_t* data, size_t length) {
     return parser_->Parse(data, static_cast<int>(length));
@@ -67,6 +69,14 @@ class Mp2tMediaParserTest : public testing::Test {
       DVLOG(1) << stream_info->ToString();
       stream_map_[stream_info->track_id()] = stream_info;
     }
+    if (select_video_only_) {
+      std::set<uint32_t> video_track_ids;
+      for (const auto& stream_info : stream_infos) {
+        if (stream_info->stream_type() == kStreamVideo)
+          video_track_ids.insert(stream_info->track_id());
+      }
+      parser_->SetSelectedTracks(video_track_ids);
+    }
   }
 
   bool OnNewSample(uint32_t track_id, std::shared_ptr<MediaSample> sample) {
@@ -136,6 +146,23 @@ TEST_F(Mp2tMediaParserTest, UnalignedAppend512_H264) {
   EXPECT_EQ(82, video_frame_count_);
 }
 
+TEST_F(Mp2tMediaParserTest, AlignedAppend1316_H264) {
+  // Test appends of 7 TS packets, e.g. UDP datagrams, which are processed in
+  // place.
+  ParseMpeg2TsFile("bear-640x360.ts", 7 * 188);
+  EXPECT_EQ(79, video_frame_count_);
+  EXPECT_TRUE(parser_->Flush());
+  EXPECT_EQ(82, video_frame_count_);
+}
+
+TEST_F(Mp2tMediaParserTest, SelectedTracks) {
+  select_video_only_ = true;
+  ParseMpeg2TsFile("bear-640x360.ts", 512);
+  EXPECT_TRUE(parser_->Flush());
+  EXPECT_EQ(82, video_frame_count_);
+  EXPECT_EQ(0, audio_frame_count_);
+}
+
 TEST_F(Mp2tMediaParserTest, UnalignedAppend17_H265) {
   // Test small, non-segment-aligned appends.
   ParseMpeg2TsFile("bear-640x360-hevc.ts", 17);
@@ -100,6 +100,10 @@ bool Mpeg1Header::IsSyncWord(const uint8_t* buf) const {
          && ((buf[1] & 0b00000110) != 0b00000000);
 }
 
+uint8_t Mpeg1Header::GetSyncWordFirstByte() const {
+  return 0xff;
+}
+
 size_t Mpeg1Header::GetMinFrameSize() const {
   return kMpeg1HeaderMinSize + 1;
 }
@@ -79,8 +79,14 @@ bool PesPacketGenerator::Initialize(const StreamInfo& stream_info) {
 }
 
 bool PesPacketGenerator::PushSample(const MediaSample& sample) {
-  if (!current_processing_pes_)
-    current_processing_pes_.reset(new PesPacket());
+  if (!current_processing_pes_) {
+    if (recycled_pes_packets_.empty()) {
+      current_processing_pes_.reset(new PesPacket());
+    } else {
+      current_processing_pes_ = std::move(recycled_pes_packets_.back());
+      recycled_pes_packets_.pop_back();
+    }
+  }
 
   const int64_t pts =
       sample.pts() * timescale_scale_ + transport_stream_timestamp_offset_;
@@ -101,39 +107,42 @@ bool PesPacketGenerator::PushSample(const MediaSample& sample) {
   current_processing_pes_->set_dts(dts);
   if (stream_type_ == kStreamVideo) {
     DCHECK(converter_);
+    // The byte stream is not cached on the sample for other outputs: fMP4
+    // outputs keep the NAL unit length prefixes, so the conversion only runs
+    // once per TS output, and caching would cost a copy in the common case of
+    // a single TS output.
     std::vector<SubsampleEntry> subsamples;
     if (sample.decrypt_config())
       subsamples = sample.decrypt_config()->subsamples();
     const bool kEscapeEncryptedNalu = true;
-    std::vector<uint8_t> byte_stream;
+    std::vector<uint8_t>* byte_stream = current_processing_pes_->mutable_data();
+    byte_stream->clear();
     if (!converter_->ConvertUnitToByteStreamWithSubsamples(
             sample.data(), sample.data_size(), sample.is_key_frame(),
-            kEscapeEncryptedNalu, &byte_stream, &subsamples)) {
+            kEscapeEncryptedNalu, byte_stream, &subsamples)) {
       LOG(ERROR) << "Failed to convert sample to byte stream.";
       return false;
     }
 
-    current_processing_pes_->mutable_data()->swap(byte_stream);
     current_processing_pes_->set_stream_id(kVideoStreamId);
     pes_packets_.push_back(std::move(current_processing_pes_));
     return true;
   }
   DCHECK_EQ(stream_type_, kStreamAudio);
 
-  std::vector<uint8_t> audio_frame;
+  std::vector<uint8_t>* audio_frame = current_processing_pes_->mutable_data();
 
   // AAC is carried in ADTS.
   if (adts_converter_) {
     if (!adts_converter_->ConvertToADTS(sample.data(), sample.data_size(),
-                                        &audio_frame))
+                                        audio_frame))
       return false;
   } else {
-    audio_frame.assign(sample.data(), sample.data() + sample.data_size());
+    audio_frame->assign(sample.data(), sample.data() + sample.data_size());
   }
 
   // TODO(rkuriowa): Put multiple samples in the PES packet to reduce # of PES
   // packets.
-  current_processing_pes_->mutable_data()->swap(audio_frame);
   current_processing_pes_->set_stream_id(audio_stream_id_);
   pes_packets_.push_back(std::move(current_processing_pes_));
   return true;
@@ -154,6 +163,15 @@ bool PesPacketGenerator::Flush() {
   return true;
 }
 
+void PesPacketGenerator::RecyclePesPacket(
+    std::unique_ptr<PesPacket> pes_packet) {
+  // Packets are written shortly after they are generated, so only a few are
+  // in flight at any time.
+  const size_t kMaxRecycledPesPackets = 8;
+  if (recycled_pes_packets_.size() < kMaxRecycledPesPackets)
+    recycled_pes_packets_.push_back(std::move(pes_packet));
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
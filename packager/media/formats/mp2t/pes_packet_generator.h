@@ -9,6 +9,7 @@
 
 #include <list>
 #include <memory>
+#include <vector>
 
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/stream_info.h"
@@ -60,6 +61,10 @@ class PesPacketGenerator {
   /// @return true on success, false otherwise.
   virtual bool Flush();
 
+  /// Returns a PES packet from GetNextPesPacket() that has been written, so
+  /// that it is reused, with the memory of its data, for a later sample.
+  void RecyclePesPacket(std::unique_ptr<PesPacket> pes_packet);
+
  private:
   friend class PesPacketGeneratorTest;
 
@@ -80,6 +85,8 @@ class PesPacketGenerator {
   // Audio stream id PES packet is codec dependent.
   uint8_t audio_stream_id_ = 0;
   std::list<std::unique_ptr<PesPacket>> pes_packets_;
+  // PES packets returned by RecyclePesPacket().
+  std::vector<std::unique_ptr<PesPacket>> recycled_pes_packets_;
 
   DISALLOW_COPY_AND_ASSIGN(PesPacketGenerator);
 };
@@ -9,6 +9,7 @@
 
 #include <stdint.h>
 
+#include <memory>
 #include <vector>
 
 #include "packager/media/base/buffer_writer.h"
@@ -44,6 +45,24 @@ class ProgramMapTableWriter {
   // This is arbitrary number that is not reserved by the spec.
   static const uint8_t kElementaryPid = 0x50;
 
+  // Maximum number of elementary streams in the program. The PIDs of the
+  // elementary streams are consecutive starting from kElementaryPid.
+  static const size_t kMaxElementaryStreams = 16;
+
+  /// @return the PID of the elementary stream at @a stream_index in the
+  ///         program.
+  static uint8_t ElementaryPid(size_t stream_index);
+
+  /// Writes the elementary stream info, i.e. stream type, PID and
+  /// descriptors, of the stream(s) to the ES loop of a PMT.
+  /// @param encrypted specifies whether the stream(s) are encrypted.
+  /// @param elementary_pid is the PID of the (first) elementary stream.
+  /// @param writer is where the elementary stream info gets appended.
+  /// @return true on success, false otherwise.
+  virtual bool WriteElementaryStreamInfo(bool encrypted,
+                                         uint8_t elementary_pid,
+                                         BufferWriter* writer);
+
  protected:
   /// @return the underlying codec.
   Codec codec() const { return codec_; }
@@ -55,8 +74,13 @@ class ProgramMapTableWriter {
   // Writes descriptors for PMT (only needed for encrypted PMT).
   virtual bool WriteDescriptors(BufferWriter* writer) const = 0;
 
+  // Returns the PID of the TS packets carrying the PCR.
+  virtual uint8_t PcrPid() const;
+
   const Codec codec_;
   ContinuityCounter continuity_counter_;
+  // The TS packets of the clear and encrypted PMTs, rendered on first use.
+  // Only their continuity counters change from segment to segment.
   BufferWriter clear_pmt_;
   BufferWriter encrypted_pmt_;
 };
@@ -93,6 +117,37 @@ class AudioProgramMapTableWriter : public ProgramMapTableWriter {
   const std::vector<uint8_t> audio_specific_config_;
 };
 
+/// ProgramMapTableWriter for a program with multiple elementary streams, e.g.
+/// muxed audio and video. The PMT lists the elementary streams in order, with
+/// PIDs assigned by ElementaryPid().
+class MultiStreamProgramMapTableWriter : public ProgramMapTableWriter {
+ public:
+  /// @param stream_pmt_writers are the writers of the elementary streams in
+  ///        the program, in PID order.
+  /// @param pcr_stream_index is the index of the elementary stream carrying
+  ///        the PCR, which is usually the video stream.
+  MultiStreamProgramMapTableWriter(
+      std::vector<std::unique_ptr<ProgramMapTableWriter>> stream_pmt_writers,
+      size_t pcr_stream_index);
+  ~MultiStreamProgramMapTableWriter() override;
+
+  bool WriteElementaryStreamInfo(bool encrypted,
+                                 uint8_t elementary_pid,
+                                 BufferWriter* writer) override;
+
+ private:
+  MultiStreamProgramMapTableWriter(const MultiStreamProgramMapTableWriter&) =
+      delete;
+  MultiStreamProgramMapTableWriter& operator=(
+      const MultiStreamProgramMapTableWriter&) = delete;
+
+  uint8_t PcrPid() const override;
+  bool WriteDescriptors(BufferWriter* writer) const override;
+
+  std::vector<std::unique_ptr<ProgramMapTableWriter>> stream_pmt_writers_;
+  const size_t pcr_stream_index_;
+};
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
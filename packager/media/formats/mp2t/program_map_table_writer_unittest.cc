@@ -6,6 +6,7 @@
 
 #include <gtest/gtest.h>
 
+#include <memory>
 #include <vector>
 
 #include "packager/media/base/buffer_writer.h"
@@ -90,6 +91,23 @@ TEST_F(ProgramMapTableWriterTest, ClearH264) {
                           kPmtH264, arraysize(kPmtH264), buffer.Buffer()));
 }
 
+// The PMT packet is rendered once; only its continuity counter changes.
+TEST_F(ProgramMapTableWriterTest, ContinuityCounter) {
+  VideoProgramMapTableWriter writer(kCodecH264);
+  BufferWriter first_segment;
+  ASSERT_TRUE(writer.ClearSegmentPmt(&first_segment));
+  ASSERT_EQ(kTsPacketSize, first_segment.Size());
+
+  for (int i = 1; i <= 16; ++i) {
+    BufferWriter buffer;
+    ASSERT_TRUE(writer.ClearSegmentPmt(&buffer));
+    ASSERT_EQ(kTsPacketSize, buffer.Size());
+    EXPECT_EQ(0x30 | (i % 16), buffer.Buffer()[3]);
+    EXPECT_EQ(0, memcmp(first_segment.Buffer() + 4, buffer.Buffer() + 4,
+                        kTsPacketSize - 4));
+  }
+}
+
 // Verify that PSI for encrypted segments after clear lead is generated
 // correctly.
 TEST_F(ProgramMapTableWriterTest, EncryptedSegmentsAfterClearLeadH264) {
@@ -424,6 +442,54 @@ TEST_F(ProgramMapTableWriterTest, EncryptedSegmentsAc3Pmt) {
       kPmtEncryptedAc3, arraysize(kPmtEncryptedAc3), buffer.Buffer()));
 }
 
+// The video stream carries the PCR and the streams get consecutive PIDs.
+TEST_F(ProgramMapTableWriterTest, ClearMultiStreamAacH264) {
+  const std::vector<uint8_t> aac_audio_specific_config(
+      std::begin(kAacBasicProfileExtraData),
+      std::end(kAacBasicProfileExtraData));
+  std::vector<std::unique_ptr<ProgramMapTableWriter>> stream_pmt_writers;
+  stream_pmt_writers.emplace_back(
+      new AudioProgramMapTableWriter(kCodecAAC, aac_audio_specific_config));
+  stream_pmt_writers.emplace_back(new VideoProgramMapTableWriter(kCodecH264));
+  const size_t kPcrStreamIndex = 1;
+  MultiStreamProgramMapTableWriter writer(std::move(stream_pmt_writers),
+                                          kPcrStreamIndex);
+  BufferWriter buffer;
+  writer.ClearSegmentPmt(&buffer);
+
+  const uint8_t kExpectedPmtPrefix[] = {
+      0x47,  // Sync byte.
+      0x40,  // payload_unit_start_indicator set.
+      0x20,  // pid.
+      0x30,  // Adaptation field and payload are both present. counter = 0.
+      0x9C,  // Adaptation Field length.
+      0x00,  // All adaptation field flags 0.
+  };
+  const uint8_t kPmtAacH264[] = {
+      0x00,                    // pointer field
+      0x02,                    // table id must be 0x02.
+      0xB0,                    // assumes length is <= 256 bytes.
+      0x17,                    // length of the rest of this array.
+      0x00, 0x01,              // program number.
+      0xC1,                    // version 0, current next indicator 1.
+      0x00,                    // section number
+      0x00,                    // last section number.
+      0xE0,                    // first 3 bits reserved.
+      0x51,                    // PCR PID is the video stream's PID.
+      0xF0,                    // first 4 bits reserved.
+      0x00,                    // No descriptor at this level.
+      0x0F, 0xE0, 0x50,        // AAC stream_type -> PID.
+      0xF0, 0x00,              // Es_info_length is 0.
+      0x1B, 0xE0, 0x51,        // H264 stream_type -> PID.
+      0xF0, 0x00,              // Es_info_length is 0.
+      0x35, 0x61, 0xDD, 0x5E,  // CRC32.
+  };
+  ASSERT_EQ(kTsPacketSize, buffer.Size());
+  EXPECT_NO_FATAL_FAILURE(ExpectTsPacketEqual(
+      kExpectedPmtPrefix, arraysize(kExpectedPmtPrefix), 155, kPmtAacH264,
+      arraysize(kPmtAacH264), buffer.Buffer()));
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
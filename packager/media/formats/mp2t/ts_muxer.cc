@@ -17,36 +17,70 @@ const uint32_t kTsTimescale = 90000;
 TsMuxer::TsMuxer(const MuxerOptions& muxer_options) : Muxer(muxer_options) {}
 TsMuxer::~TsMuxer() {}
 
+Status TsMuxer::OnFlushRequest(size_t input_stream_index) {
+  // The segments are shared by all the streams, so they are finalized after
+  // the last stream is flushed. The other streams do not wait for the
+  // streams flushed before.
+  flushed_streams_.insert(input_stream_index);
+  if (flushed_streams_.size() < num_input_streams()) {
+    return segmenter_ ? segmenter_->FinishStream(input_stream_index)
+                      : Status::OK;
+  }
+  return Muxer::OnFlushRequest(input_stream_index);
+}
+
 Status TsMuxer::InitializeMuxer() {
-  if (streams().size() > 1u)
-    return Status(error::MUXER_FAILURE, "Cannot handle more than one streams.");
+  // Wait for the stream infos of all the streams.
+  if (streams().size() < num_input_streams())
+    return Status::OK;
+  for (const auto& stream : streams()) {
+    if (!stream)
+      return Status::OK;
+  }
 
+  // The segmenter is created again if the stream infos change, which goes on
+  // with the same segments.
+  const uint64_t segment_number = segmenter_ ? segmenter_->segment_number() : 0;
   segmenter_.reset(new TsSegmenter(options(), muxer_listener()));
-  Status status = segmenter_->Initialize(*streams()[0]);
+  segmenter_->set_segment_number(segment_number);
+  Status status = segmenter_->Initialize(streams());
   FireOnMediaStartEvent();
+  for (size_t stream_index : flushed_streams_) {
+    if (status.ok())
+      status = segmenter_->FinishStream(stream_index);
+  }
   return status;
 }
 
 Status TsMuxer::Finalize() {
+  if (!segmenter_) {
+    return Status(error::MUXER_FAILURE,
+                  "Finalized before receiving all the stream infos.");
+  }
   FireOnMediaEndEvent();
   return segmenter_->Finalize();
 }
 
 Status TsMuxer::AddMediaSample(size_t stream_id, const MediaSample& sample) {
-  DCHECK_EQ(stream_id, 0u);
-  if (num_samples_ < 2) {
+  if (!segmenter_) {
+    return Status(error::MUXER_FAILURE,
+                  "Received a sample before all the stream infos.");
+  }
+  if (stream_id == segmenter_->main_stream_index() && num_samples_ < 2) {
     sample_durations_[num_samples_] =
-        sample.duration() * kTsTimescale / streams().front()->time_scale();
+        sample.duration() * kTsTimescale / streams()[stream_id]->time_scale();
     if (num_samples_ == 1 && muxer_listener())
       muxer_listener()->OnSampleDurationReady(sample_durations_[num_samples_]);
     num_samples_++;
   }
-  return segmenter_->AddSample(sample);
+  return segmenter_->AddSample(stream_id, sample);
 }
 
 Status TsMuxer::FinalizeSegment(size_t stream_id,
                                 const SegmentInfo& segment_info) {
-  DCHECK_EQ(stream_id, 0u);
+  // The segments are driven by the main stream.
+  if (!segmenter_ || stream_id != segmenter_->main_stream_index())
+    return Status::OK;
   return segment_info.is_subsegment
              ? Status::OK
              : segmenter_->FinalizeSegment(segment_info.start_timestamp,
@@ -56,7 +90,9 @@ Status TsMuxer::FinalizeSegment(size_t stream_id,
 void TsMuxer::FireOnMediaStartEvent() {
   if (!muxer_listener())
     return;
-  muxer_listener()->OnMediaStart(options(), *streams().front(), kTsTimescale,
+  muxer_listener()->OnMediaStart(options(),
+                                 *streams()[segmenter_->main_stream_index()],
+                                 kTsTimescale,
                                  MuxerListener::kContainerMpeg2ts);
 }
 
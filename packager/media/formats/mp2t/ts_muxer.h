@@ -7,6 +7,8 @@
 #ifndef PACKAGER_MEDIA_FORMATS_MP2T_TS_MUXER_H_
 #define PACKAGER_MEDIA_FORMATS_MP2T_TS_MUXER_H_
 
+#include <set>
+
 #include "packager/base/macros.h"
 #include "packager/media/base/muxer.h"
 #include "packager/media/formats/mp2t/ts_segmenter.h"
@@ -16,12 +18,20 @@ namespace media {
 namespace mp2t {
 
 /// MPEG2 TS muxer.
-/// This is a single program, single elementary stream TS muxer.
+/// This is a single program TS muxer. The elementary streams of the input
+/// streams, e.g. audio and video, are muxed into the same segments, which are
+/// driven by the video stream if there is one.
 class TsMuxer : public Muxer {
  public:
   explicit TsMuxer(const MuxerOptions& muxer_options);
   ~TsMuxer() override;
 
+ protected:
+  /// @name MediaHandler implementation overrides.
+  /// @{
+  Status OnFlushRequest(size_t input_stream_index) override;
+  /// @}
+
  private:
   // Muxer implementation.
   Status InitializeMuxer() override;
@@ -29,6 +39,7 @@ class TsMuxer : public Muxer {
   Status AddMediaSample(size_t stream_id, const MediaSample& sample) override;
   Status FinalizeSegment(size_t stream_id,
                          const SegmentInfo& sample) override;
+  bool CanReinitializeInPlace() const override { return true; }
 
   void FireOnMediaStartEvent();
   void FireOnMediaEndEvent();
@@ -36,6 +47,8 @@ class TsMuxer : public Muxer {
   std::unique_ptr<TsSegmenter> segmenter_;
   int64_t sample_durations_[2];
   int64_t num_samples_ = 0;
+  // The indexes of the input streams flushed.
+  std::set<size_t> flushed_streams_;
 
   DISALLOW_COPY_AND_ASSIGN(TsMuxer);
 };
@@ -43,10 +43,18 @@ int TsPacket::Sync(const uint8_t* buf, int size) {
 
 // static
 TsPacket* TsPacket::Parse(const uint8_t* buf, int size) {
+  std::unique_ptr<TsPacket> ts_packet(new TsPacket());
+  if (!Parse(buf, size, ts_packet.get()))
+    return NULL;
+  return ts_packet.release();
+}
+
+// static
+bool TsPacket::Parse(const uint8_t* buf, int size, TsPacket* ts_packet) {
   if (size < kPacketSize) {
     DVLOG(1) << "Buffer does not hold one full TS packet:"
              << " buffer_size=" << size;
-    return NULL;
+    return false;
   }
 
   DCHECK_EQ(buf[0], kTsHeaderSyncword);
@@ -54,16 +62,15 @@ TsPacket* TsPacket::Parse(const uint8_t* buf, int size) {
     DVLOG(1) << "Not on a TS syncword:"
              << " buf[0]="
              << std::hex << static_cast<int>(buf[0]) << std::dec;
-    return NULL;
+    return false;
   }
 
-  std::unique_ptr<TsPacket> ts_packet(new TsPacket());
   bool status = ts_packet->ParseHeader(buf);
   if (!status) {
     DVLOG(1) << "Parsing header failed";
-    return NULL;
+    return false;
   }
-  return ts_packet.release();
+  return true;
 }
 
 TsPacket::TsPacket() {
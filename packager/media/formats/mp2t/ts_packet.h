@@ -29,6 +29,11 @@ class TsPacket {
   // Return NULL otherwise.
   static TsPacket* Parse(const uint8_t* buf, int size);
 
+  // Parse a TS packet into |ts_packet|, which can be reused across packets.
+  // Return true only when parsing was successful.
+  static bool Parse(const uint8_t* buf, int size, TsPacket* ts_packet);
+
+  TsPacket();
   ~TsPacket();
 
   // TS header accessors.
@@ -45,8 +50,6 @@ class TsPacket {
   int payload_size() const { return payload_size_; }
 
  private:
-  TsPacket();
-
   // Parse an Mpeg2 TS header.
   // The buffer size should be at least |kPacketSize|
   bool ParseHeader(const uint8_t* buf);
@@ -6,6 +6,10 @@
 
 #include "packager/media/formats/mp2t/ts_packet_writer_util.h"
 
+#include <string.h>
+
+#include <algorithm>
+
 #include "packager/base/logging.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/formats/mp2t/continuity_counter.h"
@@ -26,88 +30,95 @@ const int kTsPacketSize = 188;
 const int kTsPacketMaximumPayloadSize =
     kTsPacketSize - kTsPacketHeaderSize;
 
-// Used for adaptation field padding bytes.
-const uint8_t kPaddingBytes[] = {
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-};
-static_assert(arraysize(kPaddingBytes) >= kTsPacketMaximumPayloadSize,
-              "Padding array is not big enough.");
-
-// |remaining_data_size| is the amount of data that has to be written. This may
-// be bigger than a TS packet size.
-// |remaining_data_size| matters if it is short and requires padding.
-void WriteAdaptationField(bool has_pcr,
-                          uint64_t pcr_base,
-                          size_t remaining_data_size,
-                          BufferWriter* writer) {
-  // Special case where a TS packet requires 1 byte padding.
-  if (!has_pcr && remaining_data_size == kTsPacketMaximumPayloadSize - 1) {
-    writer->AppendInt(static_cast<uint8_t>(0));
-    return;
-  }
+// The size of the adaptation_field_length field.
+const int kAdaptationFieldLengthSize = 1;
+// The size of all leading flags (not including the adaptation_field_length).
+const int kAdaptationFieldHeaderSize = 1;
+// The size of an adaptation field carrying a PCR.
+const int kPcrAdaptationFieldSize =
+    kAdaptationFieldLengthSize + kAdaptationFieldHeaderSize + kPcrFieldsSize;
 
-  // The size of the field itself.
-  const int kAdaptationFieldLengthSize = 1;
-
-  // The size of all leading flags (not including the adaptation_field_length).
-  const int kAdaptationFieldHeaderSize = 1;
-  size_t adaptation_field_length =
-      kAdaptationFieldHeaderSize + (has_pcr ? kPcrFieldsSize : 0);
-  if (remaining_data_size < kTsPacketMaximumPayloadSize) {
-    const size_t current_ts_size = kTsPacketHeaderSize + remaining_data_size +
-                                   adaptation_field_length +
-                                   kAdaptationFieldLengthSize;
-    if (current_ts_size < kTsPacketSize) {
-      adaptation_field_length += kTsPacketSize - current_ts_size;
-    }
-  }
+// Used for adaptation field padding bytes.
+const uint8_t kPaddingByte = 0xFF;
+
+// Returns the number of TS packets needed to carry |payload_size| bytes.
+size_t NumTsPackets(size_t payload_size, bool has_pcr) {
+  // Only the first packet carries the PCR.
+  const size_t first_packet_payload_size =
+      kTsPacketMaximumPayloadSize - (has_pcr ? kPcrAdaptationFieldSize : 0);
+  if (payload_size <= first_packet_payload_size)
+    return 1;
+  return 1 + (payload_size - first_packet_payload_size +
+              kTsPacketMaximumPayloadSize - 1) /
+                 kTsPacketMaximumPayloadSize;
+}
 
-  writer->AppendInt(static_cast<uint8_t>(adaptation_field_length));
-  int remaining_bytes = static_cast<int>(adaptation_field_length);
-  writer->AppendInt(static_cast<uint8_t>(
+// Writes a TS packet carrying as much of |payload| as fits to |packet|, which
+// must have kTsPacketSize bytes. The adaptation field carries the PCR if
+// |kHasPcr| is true, and pads the packet if there is not enough payload left.
+// Returns the number of payload bytes written.
+template <bool kHasPcr>
+size_t WriteTsPacket(const uint8_t* payload,
+                     size_t payload_size,
+                     bool payload_unit_start_indicator,
+                     int pid,
+                     uint64_t pcr_base,
+                     ContinuityCounter* continuity_counter,
+                     uint8_t* packet) {
+  const size_t maximum_payload_size =
+      kTsPacketMaximumPayloadSize - (kHasPcr ? kPcrAdaptationFieldSize : 0);
+  const size_t bytes_to_write = std::min(payload_size, maximum_payload_size);
+  const size_t adaptation_field_size =
+      kTsPacketMaximumPayloadSize - bytes_to_write;
+  const bool has_adaptation_field = adaptation_field_size > 0;
+
+  packet[0] = kSyncByte;
+  // transport_error_indicator and transport_priority are both '0'.
+  const uint16_t pid_field =
+      static_cast<int>(payload_unit_start_indicator) << 14 | pid;
+  packet[1] = static_cast<uint8_t>(pid_field >> 8);
+  packet[2] = static_cast<uint8_t>(pid_field);
+  const uint8_t adaptation_field_control =
+      ((has_adaptation_field ? 1 : 0) << 1) | ((bytes_to_write != 0) ? 1 : 0);
+  // transport_scrambling_control is '00'.
+  packet[3] = static_cast<uint8_t>(adaptation_field_control << 4 |
+                                   continuity_counter->GetNext());
+
+  uint8_t* const adaptation_field = packet + kTsPacketHeaderSize;
+  if (has_adaptation_field) {
+    const size_t adaptation_field_length =
+        adaptation_field_size - kAdaptationFieldLengthSize;
+    adaptation_field[0] = static_cast<uint8_t>(adaptation_field_length);
+    // A TS packet requiring 1 byte padding has an empty adaptation field.
+    if (adaptation_field_length > 0) {
       // All flags except PCR_flag are 0.
-      static_cast<uint8_t>(has_pcr) << 4));
-  remaining_bytes -= 1;
-
-  if (has_pcr) {
-    // program_clock_reference_extension = 0.
-    const uint32_t most_significant_32bits_pcr =
-        static_cast<uint32_t>(pcr_base >> 1);
-    const uint16_t pcr_last_bit_reserved_and_pcr_extension =
-        ((pcr_base & 1) << 15) | 0x7e00;  // Set the 6 reserved bits to '1'
-    writer->AppendInt(most_significant_32bits_pcr);
-    writer->AppendInt(pcr_last_bit_reserved_and_pcr_extension);
-    remaining_bytes -= kPcrFieldsSize;
+      adaptation_field[1] = static_cast<uint8_t>(kHasPcr) << 4;
+      size_t padding_offset =
+          kAdaptationFieldLengthSize + kAdaptationFieldHeaderSize;
+      if (kHasPcr) {
+        // program_clock_reference_extension = 0.
+        const uint32_t most_significant_32bits_pcr =
+            static_cast<uint32_t>(pcr_base >> 1);
+        const uint16_t pcr_last_bit_reserved_and_pcr_extension =
+            ((pcr_base & 1) << 15) | 0x7e00;  // Set the 6 reserved bits to '1'
+        uint8_t* pcr = adaptation_field + padding_offset;
+        pcr[0] = static_cast<uint8_t>(most_significant_32bits_pcr >> 24);
+        pcr[1] = static_cast<uint8_t>(most_significant_32bits_pcr >> 16);
+        pcr[2] = static_cast<uint8_t>(most_significant_32bits_pcr >> 8);
+        pcr[3] = static_cast<uint8_t>(most_significant_32bits_pcr);
+        pcr[4] =
+            static_cast<uint8_t>(pcr_last_bit_reserved_and_pcr_extension >> 8);
+        pcr[5] = static_cast<uint8_t>(pcr_last_bit_reserved_and_pcr_extension);
+        padding_offset += kPcrFieldsSize;
+      }
+      DCHECK_LE(padding_offset, adaptation_field_size);
+      memset(adaptation_field + padding_offset, kPaddingByte,
+             adaptation_field_size - padding_offset);
+    }
   }
-  DCHECK_GE(remaining_bytes, 0);
-  if (remaining_bytes == 0)
-    return;
 
-  DCHECK_GE(static_cast<int>(arraysize(kPaddingBytes)), remaining_bytes);
-  writer->AppendArray(kPaddingBytes, remaining_bytes);
+  memcpy(adaptation_field + adaptation_field_size, payload, bytes_to_write);
+  return bytes_to_write;
 }
 
 }  // namespace
@@ -120,44 +131,36 @@ void WritePayloadToBufferWriter(const uint8_t* payload,
                                 uint64_t pcr_base,
                                 ContinuityCounter* continuity_counter,
                                 BufferWriter* writer) {
-  size_t payload_bytes_written = 0;
-
-  do {
-    const bool must_write_adaptation_header = has_pcr;
-    const size_t bytes_left = payload_size - payload_bytes_written;
-    const bool has_adaptation_field = must_write_adaptation_header ||
-                                      bytes_left < kTsPacketMaximumPayloadSize;
-
-    writer->AppendInt(kSyncByte);
-    writer->AppendInt(static_cast<uint16_t>(
-        // transport_error_indicator and transport_priority are both '0'.
-        static_cast<int>(payload_unit_start_indicator) << 14 | pid));
-
-    const uint8_t adaptation_field_control =
-        ((has_adaptation_field ? 1 : 0) << 1) | ((bytes_left != 0) ? 1 : 0);
-    // transport_scrambling_control is '00'.
-    writer->AppendInt(static_cast<uint8_t>(adaptation_field_control << 4 |
-                                           continuity_counter->GetNext()));
-
-    if (has_adaptation_field) {
-      const size_t before = writer->Size();
-      WriteAdaptationField(has_pcr, pcr_base, bytes_left, writer);
-      const size_t bytes_for_adaptation_field = writer->Size() - before;
-
-      const size_t write_bytes =
-          kTsPacketMaximumPayloadSize - bytes_for_adaptation_field;
-      writer->AppendArray(payload + payload_bytes_written, write_bytes);
-      payload_bytes_written += write_bytes;
-    } else {
-      writer->AppendArray(payload + payload_bytes_written,
-                          kTsPacketMaximumPayloadSize);
-      payload_bytes_written += kTsPacketMaximumPayloadSize;
-    }
+  // All the packets are written in place in one contiguous block.
+  const size_t num_packets = NumTsPackets(payload_size, has_pcr);
+  uint8_t* packet = writer->Grow(num_packets * kTsPacketSize);
+
+  // Only the first packet may carry the PCR and the payload unit start.
+  size_t payload_bytes_written =
+      has_pcr ? WriteTsPacket<true>(payload, payload_size,
+                                    payload_unit_start_indicator, pid,
+                                    pcr_base, continuity_counter, packet)
+              : WriteTsPacket<false>(payload, payload_size,
+                                     payload_unit_start_indicator, pid,
+                                     pcr_base, continuity_counter, packet);
+  for (size_t i = 1; i < num_packets; ++i) {
+    packet += kTsPacketSize;
+    payload_bytes_written += WriteTsPacket<false>(
+        payload + payload_bytes_written, payload_size - payload_bytes_written,
+        false, pid, 0, continuity_counter, packet);
+  }
+  DCHECK_EQ(payload_bytes_written, payload_size);
+}
 
-    // Once written, not needed for this payload.
-    has_pcr = false;
-    payload_unit_start_indicator = false;
-  } while (payload_bytes_written < payload_size);
+void WriteTsPacketsToBufferWriter(const BufferWriter& packets,
+                                  ContinuityCounter* continuity_counter,
+                                  BufferWriter* output) {
+  DCHECK_EQ(packets.Size() % kTsPacketSize, 0u);
+  uint8_t* packet = output->Grow(packets.Size());
+  memcpy(packet, packets.Buffer(), packets.Size());
+  uint8_t* const end = packet + packets.Size();
+  for (; packet < end; packet += kTsPacketSize)
+    packet[3] = (packet[3] & 0xF0) | continuity_counter->GetNext();
 }
 
 }  // namespace mp2t
@@ -40,6 +40,16 @@ void WritePayloadToBufferWriter(const uint8_t* payload,
                                 ContinuityCounter* continuity_counter,
                                 BufferWriter* output);
 
+/// Appends TS packets rendered once, e.g. PSI packets written by
+/// WritePayloadToBufferWriter(), to @a output with only their
+/// continuity_counter set.
+/// @param packets is the TS packets.
+/// @param continuity_counter gives the continuity_counter of each packet.
+/// @param output is where the TS packets get written.
+void WriteTsPacketsToBufferWriter(const BufferWriter& packets,
+                                  ContinuityCounter* continuity_counter,
+                                  BufferWriter* output);
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
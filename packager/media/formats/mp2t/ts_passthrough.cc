@@ -0,0 +1,395 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp2t/ts_passthrough.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/stream_info.h"
+#include "packager/media/base/text_sample.h"
+#include "packager/media/event/muxer_listener.h"
+#include "packager/media/formats/mp2t/mp2t_media_parser.h"
+#include "packager/media/formats/mp2t/program_map_table_writer.h"
+#include "packager/media/formats/mp2t/ts_packet.h"
+#include "packager/media/formats/mp2t/ts_writer.h"
+#include "packager/status_macros.h"
+
+namespace shaka {
+namespace media {
+namespace mp2t {
+
+namespace {
+
+const int64_t kTsTimescale = 90000;
+// The PTS are 33 bits.
+const int64_t kPtsWrapAround = 1LL << 33;
+const size_t kReadBlockSize = 1024 * TsPacket::kPacketSize;
+// The stream info and the first samples are expected within this size.
+const size_t kMaxProbeSize = 8 << 20;
+const uint8_t kTsSyncByte = 0x47;
+// Size of the PES header up to PES_header_data_length.
+const int kPesHeaderSize = 9;
+const int kPtsSize = 5;
+
+void SetStreamInfos(std::vector<std::shared_ptr<StreamInfo>>* stream_infos,
+                    const std::vector<std::shared_ptr<StreamInfo>>& parsed) {
+  *stream_infos = parsed;
+}
+
+bool SetSampleDuration(std::map<uint32_t, int64_t>* sample_durations,
+                       uint32_t track_id,
+                       std::shared_ptr<MediaSample> media_sample) {
+  if (media_sample->duration() > 0)
+    sample_durations->emplace(track_id, media_sample->duration());
+  return true;
+}
+
+bool IgnoreTextSample(uint32_t track_id,
+                      std::shared_ptr<TextSample> text_sample) {
+  return true;
+}
+
+int GetPid(const uint8_t* packet) {
+  return ((packet[1] & 0x1F) << 8) | packet[2];
+}
+
+void SetPid(int pid, uint8_t* packet) {
+  packet[1] = (packet[1] & 0xE0) | ((pid >> 8) & 0x1F);
+  packet[2] = pid & 0xFF;
+}
+
+bool HasPcr(const uint8_t* packet) {
+  // With an adaptation field, with PCR_flag set.
+  return (packet[3] & 0x20) && packet[4] > 0 && (packet[5] & 0x10);
+}
+
+// Returns true if |data| has the start of an IDR or IRAP NAL unit.
+bool HasKeyFrameNalu(Codec codec, const uint8_t* data, size_t size) {
+  const uint8_t kH264IdrSlice = 5;
+  const uint8_t kH265BlaWLp = 16;
+  const uint8_t kH265CraNut = 21;
+  for (size_t i = 0; i + 3 < size; ++i) {
+    if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1)
+      continue;
+    if (codec == kCodecH264) {
+      if ((data[i + 3] & 0x1F) == kH264IdrSlice)
+        return true;
+    } else {
+      const uint8_t type = (data[i + 3] >> 1) & 0x3F;
+      if (type >= kH265BlaWLp && type <= kH265CraNut)
+        return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+TsPassthrough::TsPassthrough(const std::string& file_name,
+                             const std::string& stream_selector,
+                             const MuxerOptions& options)
+    : file_name_(file_name),
+      stream_selector_(stream_selector),
+      options_(options),
+      segment_name_formatter_(options.segment_template) {}
+
+TsPassthrough::~TsPassthrough() {}
+
+void TsPassthrough::SetMuxerListener(
+    std::unique_ptr<MuxerListener> muxer_listener) {
+  muxer_listener_ = std::move(muxer_listener);
+}
+
+Status TsPassthrough::Open() {
+  DCHECK(!file_);
+  file_.reset(File::Open(file_name_.c_str(), "r"));
+  if (!file_) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file for reading " + file_name_);
+  }
+  RETURN_IF_ERROR(SelectStream());
+  if (!file_->Seek(0))
+    return Status(error::FILE_FAILURE, "Cannot seek in " + file_name_);
+
+  std::unique_ptr<ProgramMapTableWriter> pmt_writer;
+  if (stream_info_->stream_type() == kStreamAudio) {
+    pmt_writer.reset(new AudioProgramMapTableWriter(
+        stream_info_->codec(), stream_info_->codec_config()));
+  } else {
+    pmt_writer.reset(new VideoProgramMapTableWriter(stream_info_->codec()));
+  }
+  ts_writer_.reset(new TsWriter(std::move(pmt_writer)));
+  return Status::OK;
+}
+
+Status TsPassthrough::Run() {
+  if (!file_)
+    RETURN_IF_ERROR(Open());
+  LOG(INFO) << "Passing stream " << stream_selector_ << " of '" << file_name_
+            << "' through to '" << options_.segment_template << "'.";
+  if (muxer_listener_) {
+    muxer_listener_->OnMediaStart(options_, *stream_info_, kTsTimescale,
+                                  MuxerListener::kContainerMpeg2ts);
+    if (sample_duration_ > 0)
+      muxer_listener_->OnSampleDurationReady(sample_duration_);
+  }
+  segment_duration_ =
+      static_cast<int64_t>(options_.segment_duration_in_seconds * kTsTimescale);
+
+  std::vector<uint8_t> buffer(kReadBlockSize);
+  size_t buffer_size = 0;
+  TsPacket packet;
+  while (true) {
+    if (cancelled_)
+      return Status(error::CANCELLED, "TS passthrough cancelled");
+    const int64_t bytes_read =
+        file_->Read(buffer.data() + buffer_size, buffer.size() - buffer_size);
+    if (bytes_read < 0)
+      return Status(error::FILE_FAILURE, "Cannot read file " + file_name_);
+    if (bytes_read == 0)
+      break;
+    buffer_size += bytes_read;
+
+    size_t offset = 0;
+    for (; offset + TsPacket::kPacketSize <= buffer_size;
+         offset += TsPacket::kPacketSize) {
+      uint8_t* data = buffer.data() + offset;
+      if (!TsPacket::Parse(data, TsPacket::kPacketSize, &packet)) {
+        return Status(error::PARSER_FAILURE,
+                      "Invalid TS packet in " + file_name_);
+      }
+      RETURN_IF_ERROR(ProcessPacket(packet, data));
+    }
+    // Keeps the partial packet for the next read.
+    memmove(buffer.data(), buffer.data() + offset, buffer_size - offset);
+    buffer_size -= offset;
+  }
+  if (buffer_size > 0) {
+    LOG(WARNING) << "Ignoring " << buffer_size << " bytes at the end of "
+                 << file_name_;
+  }
+  if (segment_started_)
+    RETURN_IF_ERROR(WriteSegment(max_pts_ + sample_duration_));
+
+  if (muxer_listener_) {
+    // Same as TsMuxer.
+    muxer_listener_->OnMediaEnd(MuxerListener::MediaRanges(), 0);
+  }
+  return Status::OK;
+}
+
+void TsPassthrough::Cancel() {
+  cancelled_ = true;
+}
+
+Status TsPassthrough::SelectStream() {
+  std::vector<std::shared_ptr<StreamInfo>> stream_infos;
+  std::map<uint32_t, int64_t> sample_durations;
+  Mp2tMediaParser parser;
+  parser.Init(base::Bind(&SetStreamInfos, base::Unretained(&stream_infos)),
+              base::Bind(&SetSampleDuration,
+                         base::Unretained(&sample_durations)),
+              base::Bind(&IgnoreTextSample), nullptr);
+
+  // The PID of the first PCR, from the packets read at packet boundaries.
+  int pcr_pid = -1;
+  std::vector<uint8_t> buffer(kReadBlockSize);
+  size_t probe_size = 0;
+  while (probe_size < kMaxProbeSize) {
+    int64_t bytes_read = file_->Read(buffer.data(), buffer.size());
+    if (bytes_read < 0)
+      return Status(error::FILE_FAILURE, "Cannot read file " + file_name_);
+    if (bytes_read == 0) {
+      if (!parser.Flush())
+        return Status(error::PARSER_FAILURE, "Cannot parse " + file_name_);
+      break;
+    }
+    if (probe_size == 0 && buffer[0] != kTsSyncByte) {
+      return Status(error::UNIMPLEMENTED,
+                    file_name_ + " does not start with a TS packet.");
+    }
+    for (int64_t offset = 0;
+         pcr_pid < 0 && offset + TsPacket::kPacketSize <= bytes_read;
+         offset += TsPacket::kPacketSize) {
+      const uint8_t* packet = buffer.data() + offset;
+      if (packet[0] != kTsSyncByte) {
+        return Status(error::UNIMPLEMENTED,
+                      "TS packets are not contiguous in " + file_name_);
+      }
+      if (HasPcr(packet))
+        pcr_pid = GetPid(packet);
+    }
+    if (!parser.Parse(buffer.data(), static_cast<int>(bytes_read)))
+      return Status(error::PARSER_FAILURE, "Cannot parse " + file_name_);
+    probe_size += bytes_read;
+    if (!stream_infos.empty() && pcr_pid >= 0 &&
+        sample_durations.size() == stream_infos.size()) {
+      break;
+    }
+  }
+  if (stream_infos.empty())
+    return Status(error::PARSER_FAILURE, "No stream found in " + file_name_);
+
+  // Same stream selection as Demuxer.
+  if (stream_selector_ == "video" || stream_selector_ == "audio") {
+    const StreamType stream_type =
+        stream_selector_ == "video" ? kStreamVideo : kStreamAudio;
+    for (const std::shared_ptr<StreamInfo>& stream_info : stream_infos) {
+      if (stream_info->stream_type() == stream_type) {
+        stream_info_ = stream_info;
+        break;
+      }
+    }
+  } else {
+    size_t stream_index = 0;
+    if (base::StringToSizeT(stream_selector_, &stream_index) &&
+        stream_index < stream_infos.size()) {
+      stream_info_ = stream_infos[stream_index];
+    }
+  }
+  if (!stream_info_) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Invalid stream " + stream_selector_ + " in " + file_name_);
+  }
+  if (stream_info_->stream_type() != kStreamVideo &&
+      stream_info_->stream_type() != kStreamAudio) {
+    return Status(error::UNIMPLEMENTED,
+                  "Only audio and video streams are passed through.");
+  }
+  if (stream_info_->is_encrypted()) {
+    return Status(error::UNIMPLEMENTED,
+                  "Encrypted inputs are not passed through.");
+  }
+  pid_ = static_cast<int>(stream_info_->track_id());
+  // The PCR is kept with the packets of the stream.
+  if (pcr_pid != pid_) {
+    return Status(error::UNIMPLEMENTED,
+                  "The PCR is not carried by stream " + stream_selector_ +
+                      " of " + file_name_);
+  }
+  const auto sample_duration = sample_durations.find(pid_);
+  if (sample_duration != sample_durations.end())
+    sample_duration_ = sample_duration->second;
+  return Status::OK;
+}
+
+Status TsPassthrough::ProcessPacket(const TsPacket& packet, uint8_t* data) {
+  // The PSI, the other streams and the null packets are dropped.
+  if (packet.pid() != pid_)
+    return Status::OK;
+
+  int64_t pts = 0;
+  bool is_key_frame = false;
+  if (packet.payload_unit_start_indicator() &&
+      PeekPesHeader(packet, &pts, &is_key_frame)) {
+    max_pts_ = std::max(max_pts_, pts);
+    if (is_key_frame) {
+      const int64_t segment_index =
+          segment_duration_ > 0 ? pts / segment_duration_ : 0;
+      if (segment_started_ &&
+          IsNewSegmentIndex(segment_index, segment_index_)) {
+        RETURN_IF_ERROR(WriteSegment(pts));
+      }
+      if (!segment_started_) {
+        RETURN_IF_ERROR(StartSegment(pts));
+        segment_index_ = segment_index;
+      }
+    }
+  }
+  // The packets before the first key frame are dropped.
+  if (!segment_started_)
+    return Status::OK;
+  SetPid(ProgramMapTableWriter::ElementaryPid(0), data);
+  segment_buffer_.AppendArray(data, TsPacket::kPacketSize);
+  return Status::OK;
+}
+
+bool TsPassthrough::PeekPesHeader(const TsPacket& packet,
+                                  int64_t* pts,
+                                  bool* is_key_frame) {
+  const uint8_t* pes = packet.payload();
+  const int size = packet.payload_size();
+  if (size < kPesHeaderSize + kPtsSize || pes[0] != 0 || pes[1] != 0 ||
+      pes[2] != 1) {
+    return false;
+  }
+  const bool has_pts = (pes[7] & 0x80) != 0;
+  const int header_size = kPesHeaderSize + pes[8];
+  if (!has_pts || header_size > size)
+    return false;
+
+  const uint8_t* pts_bytes = pes + kPesHeaderSize;
+  int64_t timestamp = (static_cast<int64_t>(pts_bytes[0] & 0x0E) << 29) |
+                      (pts_bytes[1] << 22) | ((pts_bytes[2] & 0xFE) << 14) |
+                      (pts_bytes[3] << 7) | (pts_bytes[4] >> 1);
+  if (last_pts_ >= 0) {
+    // The closest to the last PTS.
+    timestamp += last_pts_ - last_pts_ % kPtsWrapAround;
+    if (timestamp < last_pts_ - kPtsWrapAround / 2) {
+      timestamp += kPtsWrapAround;
+    } else if (timestamp > last_pts_ + kPtsWrapAround / 2 &&
+               timestamp >= kPtsWrapAround) {
+      timestamp -= kPtsWrapAround;
+    }
+  }
+  last_pts_ = timestamp;
+  *pts = timestamp;
+
+  const Codec codec = stream_info_->codec();
+  *is_key_frame = stream_info_->stream_type() != kStreamVideo ||
+                  packet.random_access_indicator() ||
+                  HasKeyFrameNalu(codec, pes + header_size, size - header_size);
+  return true;
+}
+
+Status TsPassthrough::StartSegment(int64_t start_timestamp) {
+  DCHECK(!segment_started_);
+  segment_buffer_.Clear();
+  if (!ts_writer_->NewSegment(&segment_buffer_))
+    return Status(error::MUXER_FAILURE, "Failed to write PAT and PMT.");
+  segment_start_timestamp_ = start_timestamp;
+  segment_started_ = true;
+  return Status::OK;
+}
+
+Status TsPassthrough::WriteSegment(int64_t end_timestamp) {
+  DCHECK(segment_started_);
+  const std::string segment_path = segment_name_formatter_.Format(
+      segment_start_timestamp_, num_segments_++, options_.bandwidth);
+  const uint64_t file_size = segment_buffer_.Size();
+  std::unique_ptr<File, FileCloser> segment_file(
+      File::Open(segment_path.c_str(), "w"));
+  if (!segment_file) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file for write " + segment_path);
+  }
+  RETURN_IF_ERROR(segment_buffer_.WriteToFile(segment_file.get()));
+  if (!segment_file.release()->Close()) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close file " + segment_path +
+            ", possibly file permission issue or running out of disk space.");
+  }
+
+  if (muxer_listener_) {
+    muxer_listener_->OnNewSegment(segment_path, segment_start_timestamp_,
+                                  end_timestamp - segment_start_timestamp_,
+                                  file_size);
+  }
+  segment_started_ = false;
+  return Status::OK;
+}
+
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
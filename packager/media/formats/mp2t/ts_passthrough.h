@@ -0,0 +1,121 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_FORMATS_MP2T_TS_PASSTHROUGH_H_
+#define PACKAGER_MEDIA_FORMATS_MP2T_TS_PASSTHROUGH_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/base/muxer_util.h"
+#include "packager/media/origin/origin_handler.h"
+
+namespace shaka {
+namespace media {
+
+class MuxerListener;
+class StreamInfo;
+
+namespace mp2t {
+
+class TsPacket;
+class TsWriter;
+
+/// TsPassthrough copies an elementary stream of an MPEG-2 TS input to TS
+/// segments without reassembling its PES packets into samples. The segments
+/// are cut at the PES packets starting with a key frame, found from the
+/// random access indicator or the NAL units in the first TS packet of the
+/// PES. Each segment starts with a new PAT and PMT, as written by TsWriter,
+/// and the TS packets of the stream are copied with their PID rewritten; their
+/// continuity counters and PCRs are kept.
+///
+/// It is an alternative to the demuxer, chunking handler and TS muxer chain
+/// for the outputs that need neither encryption nor sample processing. Open()
+/// tells whether an input can be passed through.
+class TsPassthrough : public OriginHandler {
+ public:
+  /// @param file_name is the TS input.
+  /// @param stream_selector selects the stream of the input, as for Demuxer.
+  /// @param options is the options of the output, with a segment template.
+  TsPassthrough(const std::string& file_name,
+                const std::string& stream_selector,
+                const MuxerOptions& options);
+  ~TsPassthrough() override;
+
+  /// Sets the listener notified of the segments written.
+  void SetMuxerListener(std::unique_ptr<MuxerListener> muxer_listener);
+
+  /// Reads the beginning of the input to find the selected stream.
+  /// @return OK if the stream can be passed through, otherwise an error
+  ///         telling why it needs to be demuxed instead.
+  Status Open();
+
+  /// @name OriginHandler implementation overrides.
+  /// @{
+  Status Run() override;
+  void Cancel() override;
+  /// @}
+
+ protected:
+  /// @name MediaHandler implementation overrides.
+  /// @{
+  Status InitializeInternal() override { return Status::OK; }
+  /// @}
+
+ private:
+  TsPassthrough(const TsPassthrough&) = delete;
+  TsPassthrough& operator=(const TsPassthrough&) = delete;
+
+  // Selects the stream from the stream infos and the first samples of the
+  // input, and checks that it carries the PCR.
+  Status SelectStream();
+  Status ProcessPacket(const TsPacket& packet, uint8_t* data);
+  // Returns the PTS of the PES starting in |packet|, unwrapped, and whether
+  // it starts with a key frame. Returns false if the PES has no PTS.
+  bool PeekPesHeader(const TsPacket& packet,
+                     int64_t* pts,
+                     bool* is_key_frame);
+  Status StartSegment(int64_t start_timestamp);
+  Status WriteSegment(int64_t end_timestamp);
+
+  const std::string file_name_;
+  const std::string stream_selector_;
+  const MuxerOptions options_;
+  const SegmentNameFormatter segment_name_formatter_;
+  std::unique_ptr<MuxerListener> muxer_listener_;
+  std::unique_ptr<File, FileCloser> file_;
+
+  std::shared_ptr<StreamInfo> stream_info_;
+  // PID of the selected stream in the input.
+  int pid_ = -1;
+  // Duration of the first sample, in 90kHz.
+  int64_t sample_duration_ = 0;
+  std::unique_ptr<TsWriter> ts_writer_;
+
+  int64_t segment_duration_ = 0;
+  bool segment_started_ = false;
+  int64_t segment_index_ = 0;
+  int64_t segment_start_timestamp_ = 0;
+  uint32_t num_segments_ = 0;
+  BufferWriter segment_buffer_;
+  // The PTS are unwrapped from 33 bits.
+  int64_t last_pts_ = -1;
+  int64_t max_pts_ = 0;
+  bool cancelled_ = false;
+};
+
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_FORMATS_MP2T_TS_PASSTHROUGH_H_
@@ -0,0 +1,102 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp2t/ts_passthrough.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/file/file.h"
+#include "packager/media/base/stream_info.h"
+#include "packager/media/event/mock_muxer_listener.h"
+#include "packager/media/formats/mp2t/program_map_table_writer.h"
+#include "packager/media/formats/mp2t/ts_packet.h"
+#include "packager/media/test/test_data_util.h"
+#include "packager/status_test_util.h"
+
+using ::testing::_;
+using ::testing::InSequence;
+using ::testing::Property;
+
+namespace shaka {
+namespace media {
+namespace mp2t {
+
+namespace {
+// H.264 key frames at PTS 6006, 96096 and 186186, with the PCR on the video
+// PID, and AAC audio.
+const char kInputFile[] = "bear-640x360.ts";
+const char kSegmentTemplate[] = "memory://passthrough-$Number$.ts";
+const uint64_t kPacketSize = TsPacket::kPacketSize;
+}  // namespace
+
+class TsPassthroughTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    options_.segment_template = kSegmentTemplate;
+    options_.segment_duration_in_seconds = 1;
+  }
+
+  std::string input_ = GetTestDataFilePath(kInputFile).AsUTF8Unsafe();
+  MuxerOptions options_;
+};
+
+TEST_F(TsPassthroughTest, Video) {
+  std::unique_ptr<MockMuxerListener> listener(new MockMuxerListener);
+  {
+    InSequence s;
+    EXPECT_CALL(*listener,
+                OnMediaStart(_, Property(&StreamInfo::codec, kCodecH264),
+                             90000, MuxerListener::kContainerMpeg2ts));
+    EXPECT_CALL(*listener, OnSampleDurationReady(_));
+    // Each segment has a PAT and a PMT before the packets of the stream.
+    EXPECT_CALL(*listener, OnNewSegment("memory://passthrough-1.ts", 6006,
+                                        90090, (2 + 557) * kPacketSize));
+    EXPECT_CALL(*listener, OnNewSegment("memory://passthrough-2.ts", 96096,
+                                        90090, (2 + 679) * kPacketSize));
+    EXPECT_CALL(*listener, OnNewSegment("memory://passthrough-3.ts", 186186,
+                                        66066, (2 + 445) * kPacketSize));
+    EXPECT_CALL(*listener, OnMediaEndMock(_, _, _, _, _, _, _, _, _));
+  }
+  TsPassthrough passthrough(input_, "video", options_);
+  passthrough.SetMuxerListener(std::move(listener));
+  ASSERT_OK(passthrough.Run());
+
+  std::string segment;
+  ASSERT_TRUE(
+      File::ReadFileToString("memory://passthrough-2.ts", &segment));
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(segment.data());
+  TsPacket packet;
+  ASSERT_TRUE(TsPacket::Parse(data, kPacketSize, &packet));
+  EXPECT_EQ(0, packet.pid());
+  ASSERT_TRUE(TsPacket::Parse(data + kPacketSize, kPacketSize, &packet));
+  EXPECT_EQ(ProgramMapTableWriter::kPmtPid, packet.pid());
+  // The segment starts with the key frame, with its random access indicator
+  // and PCR kept.
+  ASSERT_TRUE(TsPacket::Parse(data + 2 * kPacketSize, kPacketSize, &packet));
+  EXPECT_EQ(ProgramMapTableWriter::ElementaryPid(0), packet.pid());
+  EXPECT_TRUE(packet.payload_unit_start_indicator());
+  EXPECT_TRUE(packet.random_access_indicator());
+  for (size_t offset = 2 * kPacketSize; offset < segment.size();
+       offset += kPacketSize) {
+    ASSERT_TRUE(TsPacket::Parse(data + offset, kPacketSize, &packet));
+    EXPECT_EQ(ProgramMapTableWriter::ElementaryPid(0), packet.pid());
+  }
+}
+
+TEST_F(TsPassthroughTest, PcrOnAnotherStream) {
+  TsPassthrough passthrough(input_, "audio", options_);
+  EXPECT_EQ(error::UNIMPLEMENTED, passthrough.Open().error_code());
+}
+
+TEST_F(TsPassthroughTest, InvalidStream) {
+  TsPassthrough passthrough(input_, "2", options_);
+  EXPECT_EQ(error::INVALID_ARGUMENT, passthrough.Open().error_code());
+}
+
+}  // namespace mp2t
+}  // namespace media
+}  // namespace shaka
@@ -6,10 +6,14 @@
 
 #include "packager/media/formats/mp2t/ts_segmenter.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/hot_path_log.h"
 #include "packager/media/base/muxer_util.h"
+#include "packager/media/base/segment_checkpoint.h"
+#include "packager/media/base/segment_digest.h"
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/event/muxer_listener.h"
 #include "packager/media/formats/mp2t/pes_packet.h"
@@ -23,6 +27,9 @@ namespace mp2t {
 
 namespace {
 const double kTsTimescale = 90000;
+// The longest stretch of media, in any stream, which is held waiting for the
+// PES packets of another stream.
+const int64_t kMaxInterleavingDelay = 10 * kTsTimescale;
 
 bool IsAudioCodec(Codec codec) {
   return codec >= kCodecAudio && codec < kCodecAudioMaxPlusOne;
@@ -32,84 +39,124 @@ bool IsVideoCodec(Codec codec) {
   return codec >= kCodecVideo && codec < kCodecVideoMaxPlusOne;
 }
 
+int64_t GetDtsOrPts(const PesPacket& pes_packet) {
+  return pes_packet.has_dts() ? pes_packet.dts() : pes_packet.pts();
+}
+
 }  // namespace
 
 TsSegmenter::TsSegmenter(const MuxerOptions& options, MuxerListener* listener)
     : muxer_options_(options),
+      segment_name_formatter_(options.segment_template),
       listener_(listener),
+      streams_(1),
       transport_stream_timestamp_offset_(
-          options.transport_stream_timestamp_offset_ms * kTsTimescale / 1000),
-      pes_packet_generator_(
-          new PesPacketGenerator(transport_stream_timestamp_offset_)) {}
+          options.transport_stream_timestamp_offset_ms * kTsTimescale / 1000) {
+  streams_[0].pes_packet_generator.reset(
+      new PesPacketGenerator(transport_stream_timestamp_offset_));
+}
 
 TsSegmenter::~TsSegmenter() {}
 
 Status TsSegmenter::Initialize(const StreamInfo& stream_info) {
   if (muxer_options_.segment_template.empty())
     return Status(error::MUXER_FAILURE, "Segment template not specified.");
-  if (!pes_packet_generator_->Initialize(stream_info)) {
-    return Status(error::MUXER_FAILURE,
-                  "Failed to initialize PesPacketGenerator.");
-  }
+  streams_.resize(1);
+  RETURN_IF_ERROR(InitializeStream(stream_info, &streams_[0]));
+  main_stream_index_ = 0;
+  timescale_scale_ = kTsTimescale / stream_info.time_scale();
+  return Status::OK;
+}
 
-  const StreamType stream_type = stream_info.stream_type();
-  if (stream_type != StreamType::kStreamVideo &&
-      stream_type != StreamType::kStreamAudio) {
-    LOG(ERROR) << "TsWriter cannot handle stream type " << stream_type
-               << " yet.";
-    return Status(error::MUXER_FAILURE, "Unsupported stream type.");
+Status TsSegmenter::Initialize(
+    const std::vector<std::shared_ptr<const StreamInfo>>& streams) {
+  if (muxer_options_.segment_template.empty())
+    return Status(error::MUXER_FAILURE, "Segment template not specified.");
+  if (streams.empty() ||
+      streams.size() > ProgramMapTableWriter::kMaxElementaryStreams) {
+    LOG(ERROR) << "Cannot mux " << streams.size() << " streams in TS.";
+    return Status(error::MUXER_FAILURE, "Unsupported number of streams.");
   }
 
-  codec_ = stream_info.codec();
-  if (stream_type == StreamType::kStreamAudio)
-    audio_codec_config_ = stream_info.codec_config();
-
-  timescale_scale_ = kTsTimescale / stream_info.time_scale();
+  streams_.resize(streams.size());
+  main_stream_index_ = 0;
+  bool has_video = false;
+  for (size_t i = 0; i < streams.size(); ++i) {
+    ElementaryStream& stream = streams_[i];
+    if (!stream.pes_packet_generator) {
+      stream.pes_packet_generator.reset(
+          new PesPacketGenerator(transport_stream_timestamp_offset_));
+    }
+    RETURN_IF_ERROR(InitializeStream(*streams[i], &stream));
+    if (!has_video && streams[i]->stream_type() == kStreamVideo) {
+      has_video = true;
+      main_stream_index_ = i;
+    }
+  }
+  timescale_scale_ = kTsTimescale / streams[main_stream_index_]->time_scale();
   return Status::OK;
 }
 
 Status TsSegmenter::Finalize() {
-  return Status::OK;
+  // The PES packets of the other streams after the last segment of the main
+  // stream, if any, are written to a last segment.
+  finalizing_ = true;
+  DrainPesPacketGenerators();
+  if (!ts_writer_) {
+    if (!HasPesPackets())
+      return Status::OK;
+    RETURN_IF_ERROR(CreateTsWriterIfReady(true));
+  }
+  RETURN_IF_ERROR(WriteReadyPesPackets());
+  DCHECK(!HasPesPackets());
+  // The last segment ends with the last sample of any stream.
+  int64_t end_timestamp = segment_start_timestamp_;
+  for (const ElementaryStream& stream : streams_)
+    end_timestamp = std::max(end_timestamp, stream.end_timestamp);
+  return WriteSegment(segment_start_timestamp_,
+                      end_timestamp - segment_start_timestamp_);
 }
 
-Status TsSegmenter::AddSample(const MediaSample& sample) {
-  if (!ts_writer_) {
-    std::unique_ptr<ProgramMapTableWriter> pmt_writer;
-    if (codec_ == kCodecAC3) {
-      // https://goo.gl/N7Tvqi MPEG-2 Stream Encryption Format for HTTP Live
-      // Streaming 2.3.2.2 AC-3 Setup: For AC-3, the setup_data in the
-      // audio_setup_information is the first 10 bytes of the audio data (the
-      // syncframe()).
-      // For unencrypted AC3, the setup_data is not used, so what is in there
-      // does not matter.
-      const size_t kSetupDataSize = 10u;
-      if (sample.data_size() < kSetupDataSize) {
-        LOG(ERROR) << "Sample is too small for AC3: " << sample.data_size();
-        return Status(error::MUXER_FAILURE, "Sample is too small for AC3.");
-      }
-      const std::vector<uint8_t> setup_data(sample.data(),
-                                            sample.data() + kSetupDataSize);
-      pmt_writer.reset(new AudioProgramMapTableWriter(codec_, setup_data));
-    } else if (IsAudioCodec(codec_)) {
-      pmt_writer.reset(
-          new AudioProgramMapTableWriter(codec_, audio_codec_config_));
-    } else {
-      DCHECK(IsVideoCodec(codec_));
-      pmt_writer.reset(new VideoProgramMapTableWriter(codec_));
-    }
-    ts_writer_.reset(new TsWriter(std::move(pmt_writer)));
+Status TsSegmenter::AddSample(size_t stream_index, const MediaSample& sample) {
+  DCHECK_LT(stream_index, streams_.size());
+  HOT_PATH_LOG(kTsSegmenter) << "Stream " << stream_index << " sample:\n "
+                             << sample.ToString();
+  ElementaryStream& stream = streams_[stream_index];
+  if (!ts_writer_ && !stream.pmt_writer) {
+    RETURN_IF_ERROR(CreatePmtWriter(&sample, &stream));
+    RETURN_IF_ERROR(CreateTsWriterIfReady(false));
   }
 
   if (sample.is_encrypted())
+    encrypted_ = true;
+  if (encrypted_ && ts_writer_)
     ts_writer_->SignalEncrypted();
 
-  if (!segment_started_ && !sample.is_key_frame())
+  if (stream_index == main_stream_index_ && !segment_started_ &&
+      !sample.is_key_frame()) {
     LOG(WARNING) << "A segment will start with a non key frame.";
+  }
 
-  if (!pes_packet_generator_->PushSample(sample)) {
+  if (!stream.pes_packet_generator->PushSample(sample)) {
     return Status(error::MUXER_FAILURE,
                   "Failed to add sample to PesPacketGenerator.");
   }
+  stream.end_timestamp = std::max(
+      stream.end_timestamp,
+      static_cast<int64_t>((sample.pts() + sample.duration()) *
+                           stream.timescale_scale) +
+          transport_stream_timestamp_offset_);
+  return WritePesPackets();
+}
+
+Status TsSegmenter::FinishStream(size_t stream_index) {
+  DCHECK_LT(stream_index, streams_.size());
+  ElementaryStream& stream = streams_[stream_index];
+  stream.finished = true;
+  if (!stream.pes_packet_generator->Flush()) {
+    return Status(error::MUXER_FAILURE,
+                  "Failed to flush PesPacketGenerator.");
+  }
   return WritePesPackets();
 }
 
@@ -119,13 +166,35 @@ void TsSegmenter::InjectTsWriterForTesting(std::unique_ptr<TsWriter> writer) {
 
 void TsSegmenter::InjectPesPacketGeneratorForTesting(
     std::unique_ptr<PesPacketGenerator> generator) {
-  pes_packet_generator_ = std::move(generator);
+  streams_[0].pes_packet_generator = std::move(generator);
 }
 
 void TsSegmenter::SetSegmentStartedForTesting(bool value) {
   segment_started_ = value;
 }
 
+Status TsSegmenter::InitializeStream(const StreamInfo& stream_info,
+                                     ElementaryStream* stream) {
+  if (!stream->pes_packet_generator->Initialize(stream_info)) {
+    return Status(error::MUXER_FAILURE,
+                  "Failed to initialize PesPacketGenerator.");
+  }
+
+  const StreamType stream_type = stream_info.stream_type();
+  if (stream_type != StreamType::kStreamVideo &&
+      stream_type != StreamType::kStreamAudio) {
+    LOG(ERROR) << "TsWriter cannot handle stream type " << stream_type
+               << " yet.";
+    return Status(error::MUXER_FAILURE, "Unsupported stream type.");
+  }
+
+  stream->codec = stream_info.codec();
+  stream->timescale_scale = kTsTimescale / stream_info.time_scale();
+  if (stream_type == StreamType::kStreamAudio)
+    stream->audio_codec_config = stream_info.codec_config();
+  return Status::OK;
+}
+
 Status TsSegmenter::StartSegmentIfNeeded(int64_t next_pts) {
   if (segment_started_)
     return Status::OK;
@@ -136,72 +205,293 @@ Status TsSegmenter::StartSegmentIfNeeded(int64_t next_pts) {
   return Status::OK;
 }
 
+Status TsSegmenter::CreatePmtWriter(const MediaSample* first_sample,
+                                    ElementaryStream* stream) {
+  if (stream->codec == kCodecAC3) {
+    // https://goo.gl/N7Tvqi MPEG-2 Stream Encryption Format for HTTP Live
+    // Streaming 2.3.2.2 AC-3 Setup: For AC-3, the setup_data in the
+    // audio_setup_information is the first 10 bytes of the audio data (the
+    // syncframe()).
+    // For unencrypted AC3, the setup_data is not used, so what is in there
+    // does not matter.
+    if (!first_sample)
+      return Status(error::MUXER_FAILURE, "No sample for AC3 setup data.");
+    const size_t kSetupDataSize = 10u;
+    if (first_sample->data_size() < kSetupDataSize) {
+      LOG(ERROR) << "Sample is too small for AC3: "
+                 << first_sample->data_size();
+      return Status(error::MUXER_FAILURE, "Sample is too small for AC3.");
+    }
+    const std::vector<uint8_t> setup_data(
+        first_sample->data(), first_sample->data() + kSetupDataSize);
+    stream->pmt_writer.reset(
+        new AudioProgramMapTableWriter(stream->codec, setup_data));
+  } else if (IsAudioCodec(stream->codec)) {
+    stream->pmt_writer.reset(new AudioProgramMapTableWriter(
+        stream->codec, stream->audio_codec_config));
+  } else {
+    DCHECK(IsVideoCodec(stream->codec));
+    stream->pmt_writer.reset(new VideoProgramMapTableWriter(stream->codec));
+  }
+  return Status::OK;
+}
+
+Status TsSegmenter::CreateTsWriterIfReady(bool force) {
+  if (ts_writer_)
+    return Status::OK;
+  for (ElementaryStream& stream : streams_) {
+    if (!stream.pmt_writer) {
+      if (!force)
+        return Status::OK;
+      RETURN_IF_ERROR(CreatePmtWriter(nullptr, &stream));
+    }
+  }
+
+  if (streams_.size() == 1) {
+    ts_writer_.reset(new TsWriter(std::move(streams_[0].pmt_writer)));
+    return Status::OK;
+  }
+  std::vector<std::unique_ptr<ProgramMapTableWriter>> pmt_writers;
+  for (ElementaryStream& stream : streams_)
+    pmt_writers.push_back(std::move(stream.pmt_writer));
+  std::unique_ptr<ProgramMapTableWriter> pmt_writer(
+      new MultiStreamProgramMapTableWriter(std::move(pmt_writers),
+                                           main_stream_index_));
+  ts_writer_.reset(new TsWriter(std::move(pmt_writer), main_stream_index_));
+  return Status::OK;
+}
+
+void TsSegmenter::DrainPesPacketGenerators() {
+  for (ElementaryStream& stream : streams_) {
+    while (stream.pes_packet_generator->NumberOfReadyPesPackets() > 0u) {
+      stream.pes_packets.push_back(
+          stream.pes_packet_generator->GetNextPesPacket());
+    }
+  }
+}
+
+bool TsSegmenter::HasPesPackets() const {
+  for (const ElementaryStream& stream : streams_) {
+    if (!stream.pes_packets.empty())
+      return true;
+  }
+  return false;
+}
+
+bool TsSegmenter::IsWaitingForStream(size_t stream_index) const {
+  DCHECK(streams_[stream_index].pes_packets.empty());
+  if (finalizing_ || streams_[stream_index].finished)
+    return false;
+  for (const ElementaryStream& stream : streams_) {
+    if (stream.pes_packets.size() > 1 &&
+        GetDtsOrPts(*stream.pes_packets.back()) -
+                GetDtsOrPts(*stream.pes_packets.front()) >
+            kMaxInterleavingDelay) {
+      return false;
+    }
+  }
+  return true;
+}
+
 Status TsSegmenter::WritePesPackets() {
-  while (pes_packet_generator_->NumberOfReadyPesPackets() > 0u) {
-    std::unique_ptr<PesPacket> pes_packet =
-        pes_packet_generator_->GetNextPesPacket();
+  DrainPesPacketGenerators();
+  // The PES packets are kept until the PMT is known.
+  if (!ts_writer_)
+    return Status::OK;
+  return WriteReadyPesPackets();
+}
 
-    Status status = StartSegmentIfNeeded(pes_packet->pts());
-    if (!status.ok())
-      return status;
+Status TsSegmenter::WriteReadyPesPackets() {
+  DCHECK(ts_writer_);
+  while (true) {
+    if (IsFirstPendingSegmentComplete()) {
+      const PendingSegment& segment = pending_segments_.front();
+      RETURN_IF_ERROR(WriteSegment(segment.start_timestamp, segment.duration));
+      pending_segments_.pop_front();
+      continue;
+    }
 
-    if (listener_ && IsVideoCodec(codec_) && pes_packet->is_key_frame()) {
+    const int stream_index = NextStreamToWrite();
+    if (stream_index < 0)
+      return Status::OK;
+    std::deque<std::unique_ptr<PesPacket>>& pes_packets =
+        streams_[stream_index].pes_packets;
+    std::unique_ptr<PesPacket> pes_packet = std::move(pes_packets.front());
+    pes_packets.pop_front();
+    if (static_cast<size_t>(stream_index) == main_stream_index_ &&
+        !pending_segments_.empty()) {
+      DCHECK_GT(pending_segments_.front().num_main_stream_pes_packets, 0u);
+      --pending_segments_.front().num_main_stream_pes_packets;
+    }
+    RETURN_IF_ERROR(WritePesPacket(stream_index, std::move(pes_packet)));
+  }
+}
 
-      uint64_t start_pos = segment_buffer_.Size();
-      const int64_t timestamp = pes_packet->pts();
-      if (!ts_writer_->AddPesPacket(std::move(pes_packet), &segment_buffer_))
-        return Status(error::MUXER_FAILURE, "Failed to add PES packet.");
+Status TsSegmenter::WritePesPacket(size_t stream_index,
+                                   std::unique_ptr<PesPacket> pes_packet) {
+  RETURN_IF_ERROR(StartSegmentIfNeeded(pes_packet->pts()));
+
+  if (listener_ && IsVideoCodec(streams_[stream_index].codec) &&
+      pes_packet->is_key_frame()) {
+    uint64_t start_pos = segment_buffer_.Size();
+    const int64_t timestamp = pes_packet->pts();
+    if (!ts_writer_->AddPesPacket(stream_index, *pes_packet,
+                                  &segment_buffer_)) {
+      return Status(error::MUXER_FAILURE, "Failed to add PES packet.");
+    }
 
-      uint64_t end_pos = segment_buffer_.Size();
+    uint64_t end_pos = segment_buffer_.Size();
 
-      listener_->OnKeyFrame(timestamp, start_pos, end_pos - start_pos);
-    } else {
-      if (!ts_writer_->AddPesPacket(std::move(pes_packet), &segment_buffer_))
-        return Status(error::MUXER_FAILURE, "Failed to add PES packet.");
+    listener_->OnKeyFrame(timestamp, start_pos, end_pos - start_pos);
+  } else {
+    if (!ts_writer_->AddPesPacket(stream_index, *pes_packet,
+                                  &segment_buffer_)) {
+      return Status(error::MUXER_FAILURE, "Failed to add PES packet.");
     }
   }
+  streams_[stream_index].pes_packet_generator->RecyclePesPacket(
+      std::move(pes_packet));
   return Status::OK;
 }
 
+int TsSegmenter::NextStreamToWrite() const {
+  const PendingSegment* pending_segment =
+      pending_segments_.empty() ? nullptr : &pending_segments_.front();
+  int next_stream_index = -1;
+  int64_t next_timestamp = 0;
+  for (size_t i = 0; i < streams_.size(); ++i) {
+    const std::deque<std::unique_ptr<PesPacket>>& pes_packets =
+        streams_[i].pes_packets;
+    if (i == main_stream_index_ && pending_segment &&
+        pending_segment->num_main_stream_pes_packets == 0) {
+      // The next PES packets of the main stream are in the next segment.
+      continue;
+    }
+    if (pes_packets.empty()) {
+      // The next PES packet of this stream could come first.
+      if (IsWaitingForStream(i))
+        return -1;
+      continue;
+    }
+    const int64_t timestamp = GetDtsOrPts(*pes_packets.front());
+    if (i != main_stream_index_ && pending_segment &&
+        timestamp >= pending_segment->end_timestamp) {
+      continue;
+    }
+    if (next_stream_index < 0 || timestamp < next_timestamp) {
+      next_stream_index = static_cast<int>(i);
+      next_timestamp = timestamp;
+    }
+  }
+  return next_stream_index;
+}
+
+bool TsSegmenter::IsFirstPendingSegmentComplete() const {
+  if (pending_segments_.empty())
+    return false;
+  const PendingSegment& segment = pending_segments_.front();
+  if (segment.num_main_stream_pes_packets > 0)
+    return false;
+  for (size_t i = 0; i < streams_.size(); ++i) {
+    if (i == main_stream_index_)
+      continue;
+    const std::deque<std::unique_ptr<PesPacket>>& pes_packets =
+        streams_[i].pes_packets;
+    if (pes_packets.empty()) {
+      if (IsWaitingForStream(i))
+        return false;
+    } else if (GetDtsOrPts(*pes_packets.front()) < segment.end_timestamp) {
+      return false;
+    }
+  }
+  return true;
+}
+
 Status TsSegmenter::FinalizeSegment(uint64_t start_timestamp,
                                     uint64_t duration) {
-  if (!pes_packet_generator_->Flush()) {
-    return Status(error::MUXER_FAILURE, "Failed to flush PesPacketGenerator.");
+  for (ElementaryStream& stream : streams_) {
+    if (!stream.pes_packet_generator->Flush()) {
+      return Status(error::MUXER_FAILURE,
+                    "Failed to flush PesPacketGenerator.");
+    }
   }
-  Status status = WritePesPackets();
-  if (!status.ok())
-    return status;
+  DrainPesPacketGenerators();
 
   // This method may be called from Finalize() so segment_started_ could
   // be false.
+  if (!segment_started_ && !HasPesPackets())
+    return Status::OK;
+  RETURN_IF_ERROR(CreateTsWriterIfReady(true));
+
+  PendingSegment segment;
+  segment.start_timestamp =
+      start_timestamp * timescale_scale_ + transport_stream_timestamp_offset_;
+  segment.duration = duration * timescale_scale_;
+  segment.end_timestamp = segment.start_timestamp + segment.duration;
+  // All the PES packets of the main stream so far are in this segment or in
+  // the pending segments before it.
+  segment.num_main_stream_pes_packets =
+      streams_[main_stream_index_].pes_packets.size();
+  for (const PendingSegment& pending_segment : pending_segments_) {
+    segment.num_main_stream_pes_packets -=
+        pending_segment.num_main_stream_pes_packets;
+  }
+  pending_segments_.push_back(segment);
+  return WriteReadyPesPackets();
+}
+
+Status TsSegmenter::WriteSegment(int64_t start_timestamp, int64_t duration) {
   if (!segment_started_)
     return Status::OK;
-  std::string segment_path =
-        GetSegmentName(muxer_options_.segment_template, segment_start_timestamp_,
-                       segment_number_++, muxer_options_.bandwidth);
+  std::string segment_path = segment_name_formatter_.Format(
+      segment_start_timestamp_, segment_number_++, muxer_options_.bandwidth);
 
   const int64_t file_size = segment_buffer_.Size();
-  std::unique_ptr<File, FileCloser> segment_file;
-  segment_file.reset(File::Open(segment_path.c_str(), "w"));
-  if (!segment_file) {
-    return Status(error::FILE_FAILURE,
-                  "Cannot open file for write " + segment_path);
+  std::vector<SegmentDigest> digests;
+  if (!muxer_options_.segment_digests.empty()) {
+    SegmentDigester digester(muxer_options_.segment_digests);
+    digester.Update(segment_buffer_);
+    digests = digester.Finish();
   }
+  SegmentCheckpoint* segment_checkpoint = muxer_options_.segment_checkpoint;
+  const bool written_before =
+      segment_checkpoint &&
+      segment_checkpoint->IsSegmentWritten(segment_path, file_size);
+  if (written_before) {
+    segment_buffer_.Clear();
+  } else {
+    std::unique_ptr<File, FileCloser> segment_file;
+    segment_file.reset(File::Open(segment_path.c_str(), "w"));
+    if (!segment_file) {
+      return Status(error::FILE_FAILURE,
+                    "Cannot open file for write " + segment_path);
+    }
 
-  RETURN_IF_ERROR(segment_buffer_.WriteToFile(segment_file.get()));
+    RETURN_IF_ERROR(segment_buffer_.WriteToFile(segment_file.get()));
 
-  if (!segment_file.release()->Close()) {
-    return Status(
-        error::FILE_FAILURE,
-        "Cannot close file " + segment_path +
-        ", possibly file permission issue or running out of disk space.");
+    if (!segment_file.release()->Close()) {
+      return Status(
+          error::FILE_FAILURE,
+          "Cannot close file " + segment_path +
+          ", possibly file permission issue or running out of disk space.");
+    }
+  }
+  if (segment_checkpoint && !written_before) {
+    RETURN_IF_ERROR(
+        segment_checkpoint->OnSegmentWritten(segment_path, file_size));
+  }
+  if (!digests.empty()) {
+    if (muxer_options_.segment_digest_file) {
+      RETURN_IF_ERROR(muxer_options_.segment_digest_file->OnSegmentWritten(
+          segment_path, digests));
+    }
+    if (listener_)
+      listener_->OnSegmentDigests(segment_path, digests);
   }
 
   if (listener_) {
-    listener_->OnNewSegment(segment_path,
-                            start_timestamp * timescale_scale_ +
-                                transport_stream_timestamp_offset_,
-                            duration * timescale_scale_, file_size);
+    listener_->OnNewSegment(segment_path, start_timestamp, duration,
+                            file_size);
   }
   segment_started_ = false;
 
@@ -7,10 +7,16 @@
 #ifndef PACKAGER_MEDIA_FORMATS_MP2T_TS_SEGMENTER_H_
 #define PACKAGER_MEDIA_FORMATS_MP2T_TS_SEGMENTER_H_
 
+#include <deque>
 #include <memory>
+#include <vector>
+
 #include "packager/file/file.h"
 #include "packager/media/base/muxer_options.h"
+#include "packager/media/base/muxer_util.h"
+#include "packager/media/formats/mp2t/pes_packet.h"
 #include "packager/media/formats/mp2t/pes_packet_generator.h"
+#include "packager/media/formats/mp2t/program_map_table_writer.h"
 #include "packager/media/formats/mp2t/ts_writer.h"
 #include "packager/status.h"
 
@@ -25,6 +31,12 @@ namespace mp2t {
 // TODO(rkuroiwa): For now, this implements multifile segmenter. Like other
 // make this an abstract super class and implement multifile and single file
 // segmenters.
+/// The segmenter writes a single program with one or more elementary streams,
+/// e.g. muxed audio and video. The PES packets of the elementary streams are
+/// interleaved in DTS order. The segments are driven by the main stream, which
+/// is the first video stream, or the first stream if there is no video. At most
+/// 10 seconds of PES packets are held waiting for the other streams, so a
+/// stream with a gap does not make the others buffer without bound.
 class TsSegmenter {
  public:
   // TODO(rkuroiwa): Add progress listener?
@@ -40,26 +52,58 @@ class TsSegmenter {
   /// @return OK on success.
   Status Initialize(const StreamInfo& stream_info);
 
-  /// Finalize the segmenter.
+  /// Initialize the object with multiple elementary streams.
+  /// @param streams are the stream infos of the elementary streams, in the
+  ///        order of the stream indexes passed to AddSample().
+  /// @return OK on success.
+  Status Initialize(
+      const std::vector<std::shared_ptr<const StreamInfo>>& streams);
+
+  /// Finalize the segmenter. The PES packets of the other streams after the
+  /// last segment of the main stream, if any, are written to a last segment.
   /// @return OK on success.
   Status Finalize();
 
   /// @param sample gets added to this object.
   /// @return OK on success.
-  Status AddSample(const MediaSample& sample);
+  Status AddSample(const MediaSample& sample) { return AddSample(0, sample); }
+
+  /// @param stream_index is the index of the elementary stream of @a sample.
+  /// @param sample gets added to this object.
+  /// @return OK on success.
+  Status AddSample(size_t stream_index, const MediaSample& sample);
+
+  /// Marks the end of an elementary stream, so the PES packets of the other
+  /// streams are not held waiting for it any more.
+  /// @param stream_index is the index of the elementary stream.
+  /// @return OK on success.
+  Status FinishStream(size_t stream_index);
 
   /// Flush all the samples that are (possibly) buffered and write them to the
   /// current segment, this will close the file. If a file is not already opened
   /// before calling this, this will open one and write them to file.
-  /// @param start_timestamp is the segment's start timestamp in the input
+  /// With multiple elementary streams, the segment is closed once the PES
+  /// packets of the other streams before the end of the segment are written.
+  /// @param start_timestamp is the segment's start timestamp in the main
   ///        stream's time scale.
-  /// @param duration is the segment's duration in the input stream's time
+  /// @param duration is the segment's duration in the main stream's time
   ///        scale.
   // TODO(kqyang): Remove the usage of segment start timestamp and duration in
   // xx_segmenter, which could cause confusions on which is the source of truth
   // as the segment start timestamp and duration could be tracked locally.
   Status FinalizeSegment(uint64_t start_timestamp, uint64_t duration);
 
+  /// @return the index of the stream that drives the segments.
+  size_t main_stream_index() const { return main_stream_index_; }
+
+  /// @return the number of the next segment in the segment template.
+  uint64_t segment_number() const { return segment_number_; }
+  /// Continues the segment numbering of a previous segmenter, e.g. when the
+  /// stream infos change between concatenated inputs.
+  void set_segment_number(uint64_t segment_number) {
+    segment_number_ = segment_number;
+  }
+
   /// Only for testing.
   void InjectTsWriterForTesting(std::unique_ptr<TsWriter> writer);
 
@@ -71,20 +115,83 @@ class TsSegmenter {
   void SetSegmentStartedForTesting(bool value);
 
  private:
+  struct ElementaryStream {
+    // Codec for the stream.
+    Codec codec = kUnknownCodec;
+    // Scale from the time scale of the stream to TS's timescale.
+    double timescale_scale = 1.0;
+    // The end of the last sample, in TS timescale, with the timestamp offset
+    // applied. -1 before the first sample.
+    int64_t end_timestamp = -1;
+    // Set by FinishStream().
+    bool finished = false;
+    std::vector<uint8_t> audio_codec_config;
+    std::unique_ptr<PesPacketGenerator> pes_packet_generator;
+    // Null until the first sample of the stream is seen. Moved to the TS
+    // writer when it is created.
+    std::unique_ptr<ProgramMapTableWriter> pmt_writer;
+    // PES packets that are not written yet.
+    std::deque<std::unique_ptr<PesPacket>> pes_packets;
+  };
+
+  // Segment of the main stream waiting for the PES packets of the other streams
+  // before its end.
+  struct PendingSegment {
+    // In TS timescale, with the timestamp offset applied.
+    int64_t start_timestamp = 0;
+    int64_t duration = 0;
+    int64_t end_timestamp = 0;
+    // The number of PES packets of the main stream in the segment that are not
+    // written yet.
+    size_t num_main_stream_pes_packets = 0;
+  };
+
+  Status InitializeStream(const StreamInfo& stream_info,
+                          ElementaryStream* stream);
+
   Status StartSegmentIfNeeded(int64_t next_pts);
 
-  // Writes PES packets (carried in TsPackets) to a buffer.
+  // Creates the PMT writer of |stream|. |first_sample| is used for the AC3
+  // setup data and may be null if the stream is not AC3.
+  Status CreatePmtWriter(const MediaSample* first_sample,
+                         ElementaryStream* stream);
+  // Creates the TS writer once the PMT writers of all the streams are created.
+  // If |force| is true, the missing PMT writers are created without samples.
+  Status CreateTsWriterIfReady(bool force);
+
+  // Moves the ready PES packets out of the PES packet generators.
+  void DrainPesPacketGenerators();
+  bool HasPesPackets() const;
+  // Whether the PES packets of the other streams wait for the next PES packet
+  // of the stream at |stream_index|, which has none queued.
+  bool IsWaitingForStream(size_t stream_index) const;
+  // Writes PES packets (carried in TsPackets) to a buffer, as far as the DTS
+  // order is known, and writes the pending segments that are complete.
   Status WritePesPackets();
+  Status WriteReadyPesPackets();
+  Status WritePesPacket(size_t stream_index,
+                        std::unique_ptr<PesPacket> pes_packet);
+  // Returns the index of the stream with the next PES packet to write, or -1
+  // if it is not known yet.
+  int NextStreamToWrite() const;
+  bool IsFirstPendingSegmentComplete() const;
+  // Writes the segment buffer to the next segment file. The timestamps are in
+  // TS timescale.
+  Status WriteSegment(int64_t start_timestamp, int64_t duration);
 
   const MuxerOptions& muxer_options_;
+  const SegmentNameFormatter segment_name_formatter_;
   MuxerListener* const listener_;
 
-  // Codec for the stream.
-  Codec codec_ = kUnknownCodec;
-  std::vector<uint8_t> audio_codec_config_;
+  std::vector<ElementaryStream> streams_;
+  size_t main_stream_index_ = 0;
+  // True if an encrypted sample has been seen.
+  bool encrypted_ = false;
+  // Set in Finalize(), after which there are no more samples.
+  bool finalizing_ = false;
 
   const uint32_t transport_stream_timestamp_offset_ = 0;
-  // Scale used to scale the input stream to TS's timesccale (which is 90000).
+  // Scale used to scale the main stream to TS's timesccale (which is 90000).
   // Used for calculating the duration in seconds fo the current segment.
   double timescale_scale_ = 1.0;
 
@@ -95,10 +202,11 @@ class TsSegmenter {
 
   BufferWriter segment_buffer_;
 
-  // Set to true if segment_buffer_ is initialized, set to false after
-  // FinalizeSegment() succeeds.
+  // Set to true if segment_buffer_ is initialized, set to false after the
+  // segment is written.
   bool segment_started_ = false;
-  std::unique_ptr<PesPacketGenerator> pes_packet_generator_;
+  // Segments finalized by the main stream but not written yet, in order.
+  std::deque<PendingSegment> pending_segments_;
 
   int64_t segment_start_timestamp_ = -1;
   DISALLOW_COPY_AND_ASSIGN(TsSegmenter);
@@ -7,6 +7,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "packager/file/memory_file.h"
 #include "packager/media/base/audio_stream_info.h"
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/event/mock_muxer_listener.h"
@@ -20,7 +21,10 @@ namespace shaka {
 namespace media {
 namespace mp2t {
 
+using ::testing::AnyNumber;
+using ::testing::Gt;
 using ::testing::InSequence;
+using ::testing::Mock;
 using ::testing::Return;
 using ::testing::Sequence;
 using ::testing::StrEq;
@@ -85,14 +89,13 @@ class MockTsWriter : public TsWriter {
   MOCK_METHOD1(NewSegment, bool(BufferWriter* buffer_writer));
   MOCK_METHOD0(SignalEncrypted, void());
 
-  // Similar to the hack above but takes a std::unique_ptr.
-  MOCK_METHOD2(AddPesPacketMock, bool(PesPacket* pes_packet,
+  MOCK_METHOD2(AddPesPacketMock, bool(const PesPacket* pes_packet,
 			  BufferWriter* buffer_writer));
-  bool AddPesPacket(std::unique_ptr<PesPacket> pes_packet,
-		  BufferWriter* buffer_writer) override {
+  bool AddPesPacket(size_t stream_index,
+                    const PesPacket& pes_packet,
+                    BufferWriter* buffer_writer) override {
      buffer_writer->AppendArray(kAnyData, arraysize(kAnyData));
-    // No need to keep the pes packet around for the current tests.
-    return AddPesPacketMock(pes_packet.get(), buffer_writer);
+    return AddPesPacketMock(&pes_packet, buffer_writer);
   }
 };
 
@@ -411,6 +414,115 @@ TEST_F(TsSegmenterTest, EncryptedSample) {
   EXPECT_OK(segmenter.AddSample(*sample2));
 }
 
+// Muxes two AC3 streams, which need no codec configuration, with real PES
+// packet generators and TS writer.
+class TsSegmenterMultipleStreamsTest : public ::testing::Test {
+ protected:
+  static const int64_t kSampleDuration = 3000;
+
+  TsSegmenterMultipleStreamsTest() : segmenter_(GetOptions(), &listener_) {}
+
+  void SetUp() override {
+    std::vector<std::shared_ptr<const StreamInfo>> streams;
+    for (int i = 0; i < 2; ++i) {
+      streams.emplace_back(new AudioStreamInfo(
+          kTrackId + i, kTimeScale, kDuration, kCodecAC3, "ac-3", nullptr, 0,
+          16, 2, 48000, 0, 0, 0, 0, kLanguage, kIsEncrypted));
+    }
+    ASSERT_OK(segmenter_.Initialize(streams));
+  }
+
+  void TearDown() override { MemoryFile::DeleteAll(); }
+
+  static MuxerOptions GetOptions() {
+    MuxerOptions options;
+    options.segment_template = "memory://muxed_$Number$.ts";
+    return options;
+  }
+
+  // Adds the AC3 sample of |stream_index| at |index| * kSampleDuration.
+  Status AddSample(size_t stream_index, int64_t index) {
+    // AC3 needs at least 10 bytes of setup data.
+    const uint8_t kAc3Data[16] = {0x0B, 0x77};
+    std::shared_ptr<MediaSample> sample =
+        MediaSample::CopyFrom(kAc3Data, sizeof(kAc3Data), kIsKeyFrame);
+    sample->set_pts(index * kSampleDuration);
+    sample->set_dts(index * kSampleDuration);
+    sample->set_duration(kSampleDuration);
+    return segmenter_.AddSample(stream_index, *sample);
+  }
+
+  MockMuxerListener listener_;
+  TsSegmenter segmenter_;
+};
+
+TEST_F(TsSegmenterMultipleStreamsTest, LastSegmentEndsWithLastSample) {
+  // The second stream goes on for two samples after the main stream.
+  const int64_t kNumMainSamples = 9;
+  const int64_t kNumOtherSamples = 11;
+  InSequence s;
+  EXPECT_CALL(listener_,
+              OnNewSegment("memory://muxed_1.ts", 0,
+                           kNumMainSamples * kSampleDuration, _));
+  EXPECT_CALL(listener_,
+              OnNewSegment("memory://muxed_2.ts",
+                           kNumMainSamples * kSampleDuration,
+                           (kNumOtherSamples - kNumMainSamples) *
+                               kSampleDuration,
+                           _));
+
+  for (int64_t i = 0; i < kNumOtherSamples; ++i) {
+    if (i < kNumMainSamples)
+      ASSERT_OK(AddSample(0, i));
+    ASSERT_OK(AddSample(1, i));
+  }
+  ASSERT_OK(segmenter_.FinalizeSegment(0, kNumMainSamples * kSampleDuration));
+  ASSERT_OK(segmenter_.Finalize());
+}
+
+TEST_F(TsSegmenterMultipleStreamsTest, FinishedStreamDoesNotHoldSegments) {
+  const int64_t kNumSamples = 9;
+  ASSERT_OK(AddSample(1, 0));
+  ASSERT_OK(segmenter_.FinishStream(1));
+  for (int64_t i = 0; i < kNumSamples; ++i)
+    ASSERT_OK(AddSample(0, i));
+
+  // The segment is written without waiting for Finalize().
+  EXPECT_CALL(listener_, OnNewSegment("memory://muxed_1.ts", 0,
+                                      kNumSamples * kSampleDuration, _));
+  ASSERT_OK(segmenter_.FinalizeSegment(0, kNumSamples * kSampleDuration));
+  Mock::VerifyAndClearExpectations(&listener_);
+
+  EXPECT_CALL(listener_, OnNewSegment(_, _, _, _)).Times(0);
+  ASSERT_OK(segmenter_.Finalize());
+}
+
+TEST_F(TsSegmenterMultipleStreamsTest, BufferingIsBounded) {
+  // The second stream has a single sample, and is not finished, so the main
+  // stream is only held for so long.
+  const int64_t kSamplesPerSegment = 60;
+  const int64_t kNumSegments = 7;
+  const int64_t kSegmentDuration = kSamplesPerSegment * kSampleDuration;
+  EXPECT_CALL(listener_,
+              OnNewSegment("memory://muxed_1.ts", 0, kSegmentDuration, _));
+  EXPECT_CALL(listener_, OnNewSegment(_, Gt(0), kSegmentDuration, _))
+      .Times(AnyNumber());
+
+  ASSERT_OK(AddSample(1, 0));
+  for (int64_t segment = 0; segment < kNumSegments; ++segment) {
+    for (int64_t i = 0; i < kSamplesPerSegment; ++i)
+      ASSERT_OK(AddSample(0, segment * kSamplesPerSegment + i));
+    ASSERT_OK(segmenter_.FinalizeSegment(segment * kSegmentDuration,
+                                         kSegmentDuration));
+  }
+  // Written before Finalize().
+  Mock::VerifyAndClearExpectations(&listener_);
+
+  EXPECT_CALL(listener_, OnNewSegment(_, _, kSegmentDuration, _))
+      .Times(AnyNumber());
+  ASSERT_OK(segmenter_.Finalize());
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
@@ -88,6 +88,8 @@ void WritePtsOrDts(uint8_t leading_bits,
 }
 
 bool WritePesToBuffer(const PesPacket& pes,
+                      int pid,
+                      bool has_pcr,
                       ContinuityCounter* continuity_counter,
                       BufferWriter* current_buffer) {
   // The size of the length field.
@@ -99,10 +101,9 @@ bool WritePesToBuffer(const PesPacket& pes,
       kTsPacketMaximumPayloadSize - kAdaptationFieldLengthSize -
       kAdaptationFieldHeaderSize - kPcrFieldSize;
   const uint64_t pcr_base = pes.has_dts() ? pes.dts() : pes.pts();
-  const int pid = ProgramMapTableWriter::kElementaryPid;
 
   // This writer will hold part of PES packet after PES_packet_length field.
-  BufferWriter pes_header_writer;
+  BufferWriter pes_header_writer(kTsPacketSize);
   // The first bit must be '10' for PES with video or audio stream id. The other
   // flags (bits) don't matter so they are 0.
   pes_header_writer.AppendInt(static_cast<uint8_t>(0x80));
@@ -136,66 +137,61 @@ bool WritePesToBuffer(const PesPacket& pes,
   first_ts_packet_buffer.AppendBuffer(pes_header_writer);
 
   const size_t available_payload =
-      kTsPacketMaxPayloadWithPcr - first_ts_packet_buffer.Size();
+      (has_pcr ? kTsPacketMaxPayloadWithPcr : kTsPacketMaximumPayloadSize) -
+      first_ts_packet_buffer.Size();
   const size_t bytes_consumed = std::min(pes.data().size(), available_payload);
   first_ts_packet_buffer.AppendArray(pes.data().data(), bytes_consumed);
 
-  BufferWriter output_writer;
+  // The TS packets are written to |current_buffer| directly.
   WritePayloadToBufferWriter(first_ts_packet_buffer.Buffer(),
                              first_ts_packet_buffer.Size(),
-                             kPayloadUnitStartIndicator, pid, kHasPcr, pcr_base,
-                             continuity_counter, &output_writer);
+                             kPayloadUnitStartIndicator, pid, has_pcr,
+                             pcr_base, continuity_counter, current_buffer);
 
   const size_t remaining_pes_data_size = pes.data().size() - bytes_consumed;
   if (remaining_pes_data_size > 0) {
     WritePayloadToBufferWriter(pes.data().data() + bytes_consumed,
                                remaining_pes_data_size,
                                !kPayloadUnitStartIndicator, pid, !kHasPcr, 0,
-                               continuity_counter, &output_writer);
+                               continuity_counter, current_buffer);
   }
-
-  current_buffer->AppendBuffer(output_writer);
   return true;
 }
 
 }  // namespace
 
-TsWriter::TsWriter(std::unique_ptr<ProgramMapTableWriter> pmt_writer)
-    : pmt_writer_(std::move(pmt_writer)) {}
+TsWriter::TsWriter(std::unique_ptr<ProgramMapTableWriter> pmt_writer,
+                   size_t pcr_stream_index)
+    : pmt_writer_(std::move(pmt_writer)),
+      pcr_stream_index_(pcr_stream_index) {
+  ContinuityCounter unused_continuity_counter;
+  WritePatToBuffer(kPat, arraysize(kPat), &unused_continuity_counter,
+                   &pat_packets_);
+}
 
 TsWriter::~TsWriter() {}
 
 bool TsWriter::NewSegment(BufferWriter* buffer) {
-  BufferWriter psi;
-  WritePatToBuffer(kPat, arraysize(kPat), &pat_continuity_counter_, &psi);
-  if (encrypted_) {
-    if (!pmt_writer_->EncryptedSegmentPmt(&psi)) {
-      return false;
-    }
-  } else {
-    if (!pmt_writer_->ClearSegmentPmt(&psi)) {
-      return false;
-    }
-  }
-  buffer->AppendBuffer(psi);
-
-  return true;
+  WriteTsPacketsToBufferWriter(pat_packets_, &pat_continuity_counter_, buffer);
+  return encrypted_ ? pmt_writer_->EncryptedSegmentPmt(buffer)
+                    : pmt_writer_->ClearSegmentPmt(buffer);
 }
 
 void TsWriter::SignalEncrypted() {
   encrypted_ = true;
 }
 
-bool TsWriter::AddPesPacket(std::unique_ptr<PesPacket> pes_packet,
-		            BufferWriter* buffer) {
-
-  if (!WritePesToBuffer(*pes_packet, &elementary_stream_continuity_counter_,
+bool TsWriter::AddPesPacket(size_t stream_index,
+                            const PesPacket& pes_packet,
+                            BufferWriter* buffer) {
+  if (!WritePesToBuffer(pes_packet,
+                        ProgramMapTableWriter::ElementaryPid(stream_index),
+                        stream_index == pcr_stream_index_,
+                        &elementary_stream_continuity_counters_[stream_index],
                         buffer)) {
     LOG(ERROR) << "Failed to write pes to buffer.";
     return false;
   }
-
-  // No need to keep pes_packet around so not passing it anywhere.
   return true;
 }
 
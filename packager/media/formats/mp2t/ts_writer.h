@@ -27,9 +27,15 @@ class ProgramMapTableWriter;
 
 /// This class takes PesPackets, encapsulates them into TS packets, and write
 /// the data to file. This also creates PSI from StreamInfo.
+/// The program may have multiple elementary streams, the PES packets of which
+/// are carried on the PIDs given by ProgramMapTableWriter::ElementaryPid().
 class TsWriter {
  public:
-  explicit TsWriter(std::unique_ptr<ProgramMapTableWriter> pmt_writer);
+  /// @param pmt_writer writes the PMT of the program.
+  /// @param pcr_stream_index is the index of the elementary stream that
+  ///        carries the PCR. It must match the PCR PID in the PMT.
+  explicit TsWriter(std::unique_ptr<ProgramMapTableWriter> pmt_writer,
+                    size_t pcr_stream_index = 0);
   virtual ~TsWriter();
 
   /// This will fail if the current segment is not finalized.
@@ -40,12 +46,23 @@ class TsWriter {
   /// Signals the writer that the rest of the segments are encrypted.
   virtual void SignalEncrypted();
 
+  /// Add PesPacket of the first elementary stream to the instance.
+  /// @param pes_packet gets added to the writer.
+  /// @param buffer to write pes packet.
+  /// @return true on success, false otherwise.
+  bool AddPesPacket(const PesPacket& pes_packet, BufferWriter* buffer) {
+    return AddPesPacket(0, pes_packet, buffer);
+  }
+
   /// Add PesPacket to the instance. PesPacket might not be added to the buffer
   /// immediately.
+  /// @param stream_index is the index of the elementary stream in the program.
   /// @param pes_packet gets added to the writer.
   /// @param buffer to write pes packet.
   /// @return true on success, false otherwise.
-  virtual bool AddPesPacket(std::unique_ptr<PesPacket> pes_packet, BufferWriter* buffer);
+  virtual bool AddPesPacket(size_t stream_index,
+                            const PesPacket& pes_packet,
+                            BufferWriter* buffer);
 
  private:
   TsWriter(const TsWriter&) = delete;
@@ -54,10 +71,14 @@ class TsWriter {
   // True if further segments generated by this instance should be encrypted.
   bool encrypted_ = false;
 
+  // The TS packet of the PAT, which only changes by its continuity counter.
+  BufferWriter pat_packets_;
   ContinuityCounter pat_continuity_counter_;
-  ContinuityCounter elementary_stream_continuity_counter_;
+  // Indexed by the elementary stream index.
+  std::map<size_t, ContinuityCounter> elementary_stream_continuity_counters_;
 
   std::unique_ptr<ProgramMapTableWriter> pmt_writer_;
+  const size_t pcr_stream_index_;
 };
 
 }  // namespace mp2t
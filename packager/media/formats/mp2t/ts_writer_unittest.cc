@@ -206,6 +206,27 @@ TEST_F(TsWriterTest, ClearSegmentPmtFailure) {
   EXPECT_FALSE(ts_writer.NewSegment(&buffer_writer));
 }
 
+// The PAT packet only changes by its continuity counter.
+TEST_F(TsWriterTest, PatContinuityCounter) {
+  std::unique_ptr<MockProgramMapTableWriter> mock_pmt_writer(
+      new MockProgramMapTableWriter());
+  EXPECT_CALL(*mock_pmt_writer, ClearSegmentPmt(_))
+      .WillRepeatedly(Return(true));
+  TsWriter ts_writer(std::move(mock_pmt_writer));
+
+  BufferWriter first_segment;
+  EXPECT_TRUE(ts_writer.NewSegment(&first_segment));
+  ASSERT_EQ(188u, first_segment.Size());
+  for (int i = 1; i <= 16; ++i) {
+    BufferWriter buffer_writer;
+    EXPECT_TRUE(ts_writer.NewSegment(&buffer_writer));
+    ASSERT_EQ(188u, buffer_writer.Size());
+    EXPECT_EQ(0x30 | (i % 16), buffer_writer.Buffer()[3]);
+    EXPECT_EQ(0, memcmp(first_segment.Buffer() + 4, buffer_writer.Buffer() + 4,
+                        kTsPacketSize - 4));
+  }
+}
+
 // Check the encrypted segments' PMT (after clear lead).
 TEST_F(TsWriterTest, EncryptedSegmentsH264Pmt) {
   std::unique_ptr<MockProgramMapTableWriter> mock_pmt_writer(
@@ -302,7 +323,7 @@ TEST_F(TsWriterTest, AddPesPacket) {
   };
   pes->mutable_data()->assign(kAnyData, kAnyData + arraysize(kAnyData));
 
-  EXPECT_TRUE(ts_writer.AddPesPacket(std::move(pes), &buffer_writer));
+  EXPECT_TRUE(ts_writer.AddPesPacket(*pes, &buffer_writer));
   
   // 3 TS Packets. PAT, PMT, and PES.
   
@@ -362,7 +383,7 @@ TEST_F(TsWriterTest, BigPesPacket) {
   const std::vector<uint8_t> big_data(400, 0x23);
   *pes->mutable_data() = big_data;
 
-  EXPECT_TRUE(ts_writer.AddPesPacket(std::move(pes), &buffer_writer));
+  EXPECT_TRUE(ts_writer.AddPesPacket(*pes, &buffer_writer));
 
   // The first TsPacket can only carry
   // 177 (TS packet size - header - adaptation_field) - 19 (PES header data) =
@@ -395,7 +416,7 @@ TEST_F(TsWriterTest, PesPtsZeroNoDts) {
   };
   pes->mutable_data()->assign(kAnyData, kAnyData + arraysize(kAnyData));
 
-  EXPECT_TRUE(ts_writer.AddPesPacket(std::move(pes), &buffer_writer));
+  EXPECT_TRUE(ts_writer.AddPesPacket(*pes, &buffer_writer));
 
   // 3 TS Packets. PAT, PMT, and PES.
   ASSERT_EQ(564u, buffer_writer.Size());
@@ -454,7 +475,7 @@ TEST_F(TsWriterTest, TsPacketPayload183Bytes) {
   std::vector<uint8_t> pes_payload(157 + 183, 0xAF);
   *pes->mutable_data() = pes_payload;
 
-  EXPECT_TRUE(ts_writer.AddPesPacket(std::move(pes), &buffer_writer));
+  EXPECT_TRUE(ts_writer.AddPesPacket(*pes, &buffer_writer));
 
   const uint8_t kExpectedOutputPrefix[] = {
       0x47,  // Sync byte.
@@ -476,6 +497,74 @@ TEST_F(TsWriterTest, TsPacketPayload183Bytes) {
       actual_prefix);
 }
 
+// Verify that the PES packets of a stream other than the PCR stream are
+// carried on the PID of the stream, without PCR.
+TEST_F(TsWriterTest, AddPesPacketOfSecondStream) {
+  std::vector<std::unique_ptr<ProgramMapTableWriter>> stream_pmt_writers;
+  stream_pmt_writers.emplace_back(
+      new VideoProgramMapTableWriter(kCodecForTesting));
+  stream_pmt_writers.emplace_back(
+      new AudioProgramMapTableWriter(kCodecAAC, std::vector<uint8_t>(2, 0x12)));
+  const size_t kPcrStreamIndex = 0;
+  TsWriter ts_writer(
+      std::unique_ptr<ProgramMapTableWriter>(new MultiStreamProgramMapTableWriter(
+          std::move(stream_pmt_writers), kPcrStreamIndex)),
+      kPcrStreamIndex);
+  BufferWriter buffer_writer;
+  EXPECT_TRUE(ts_writer.NewSegment(&buffer_writer));
+
+  std::unique_ptr<PesPacket> pes(new PesPacket());
+  pes->set_stream_id(0xC0);
+  pes->set_pts(0x900);
+  pes->set_dts(0x900);
+  const uint8_t kAnyData[] = {
+      0x12, 0x88, 0x4f, 0x4a,
+  };
+  pes->mutable_data()->assign(kAnyData, kAnyData + arraysize(kAnyData));
+
+  const size_t kStreamIndex = 1;
+  EXPECT_TRUE(
+      ts_writer.AddPesPacket(kStreamIndex, *pes, &buffer_writer));
+
+  // 3 TS Packets. PAT, PMT, and PES.
+  ASSERT_EQ(564u, buffer_writer.Size());
+
+  const int kPesStartPosition = 376;
+
+  const uint8_t kExpectedOutputPrefix[] = {
+      0x47,  // Sync byte.
+      0x40,  // payload_unit_start_indicator set.
+      0x51,  // pid of the second stream.
+      0x30,  // Adaptation field and payload are both present. counter = 0.
+      0xA0,  // Adaptation Field length.
+      0x00,  // No pcr.
+  };
+
+  const uint8_t kExpectedPayload[] = {
+      0x00, 0x00, 0x01,  // Start code.
+      0xC0,              // stream id.
+      0x00, 0x11,        // PES_packet_length.
+      0x80,              // Flags.
+      0xC0,              // PTS and DTS both present.
+      0x0A,              // PES_header_data_length.
+      0x31,  // Since PTS is 0 this is '0011' (fixed) and marker bit at LSB.
+      0x00,  // PTS leading bits 0.
+      0x01,  // PTS 0 followed by marker bit.
+      0x12,  // PTS 0x900 shifted.
+      0x01,  // PTS 0 followed by marker bit.
+      0x11,  // Fixed '0001' followed by marker bit at LSB.
+      0x00,  // DTS leading bits 0.
+      0x01,  // DTS 0 followed by marker bit.
+      0x12,  // DTS 0x900 shifted.
+      0x01,  // DTS 0 followed by marker bit.
+      0x12, 0x88, 0x4f, 0x4a,  // Payload.
+  };
+  EXPECT_NO_FATAL_FAILURE(ExpectTsPacketEqual(
+      kExpectedOutputPrefix, arraysize(kExpectedOutputPrefix), 159,
+      kExpectedPayload, arraysize(kExpectedPayload),
+      buffer_writer.Buffer() + kPesStartPosition));
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
@@ -27,6 +27,8 @@ void Box::Write(BufferWriter* writer) {
   // Compute and update box size.
   uint32_t size = ComputeSize();
   DCHECK_EQ(size, box_size_);
+  // The box, including its children, is written without reallocation.
+  writer->Reserve(box_size_);
 
   size_t buffer_size_before_write = writer->Size();
   BoxBuffer buffer(writer);
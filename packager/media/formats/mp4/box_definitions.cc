@@ -5,10 +5,12 @@
 #include "packager/media/formats/mp4/box_definitions.h"
 
 #include <gflags/gflags.h>
+#include <string.h>
 #include <algorithm>
 #include <limits>
 
 #include "packager/base/logging.h"
+#include "packager/base/sys_byteorder.h"
 #include "packager/media/base/bit_reader.h"
 #include "packager/media/base/macros.h"
 #include "packager/media/base/rcheck.h"
@@ -135,6 +137,75 @@ bool IsProtectionSchemeSupported(FourCC scheme) {
          scheme == FOURCC_cbc1 || scheme == FOURCC_cbcs;
 }
 
+// Writes the entry table of a fragment box, which can have thousands of
+// entries, in place in a region of the buffer grown once, instead of appending
+// the entries field by field.
+class EntryWriter {
+ public:
+  EntryWriter(BufferWriter* writer, size_t size)
+      : data_(writer->Grow(size)), end_(data_ + size) {}
+  ~EntryWriter() { DCHECK_EQ(data_, end_); }
+
+  void Write2(uint16_t v) {
+    v = base::HostToNet16(v);
+    WriteBytes(&v, sizeof(v));
+  }
+  void Write4(uint32_t v) {
+    v = base::HostToNet32(v);
+    WriteBytes(&v, sizeof(v));
+  }
+  void WriteNBytes(uint64_t v, size_t num_bytes) {
+    DCHECK_GE(sizeof(v), num_bytes);
+    v = base::HostToNet64(v);
+    WriteBytes(reinterpret_cast<const uint8_t*>(&v) + sizeof(v) - num_bytes,
+               num_bytes);
+  }
+  void WriteBytes(const void* data, size_t size) {
+    DCHECK_LE(size, static_cast<size_t>(end_ - data_));
+    memcpy(data_, data, size);
+    data_ += size;
+  }
+
+ private:
+  uint8_t* data_;
+  uint8_t* const end_;
+
+  DISALLOW_COPY_AND_ASSIGN(EntryWriter);
+};
+
+bool WriteSampleEncryptionEntries(
+    uint8_t iv_size,
+    bool has_subsamples,
+    std::vector<SampleEncryptionEntry>* sample_encryption_entries,
+    BufferWriter* writer) {
+  size_t entries_size = 0;
+  for (SampleEncryptionEntry& sample_encryption_entry :
+       *sample_encryption_entries) {
+    DCHECK_EQ(iv_size, sample_encryption_entry.initialization_vector.size());
+    if (has_subsamples)
+      RCHECK(!sample_encryption_entry.subsamples.empty());
+    else
+      sample_encryption_entry.subsamples.clear();
+    entries_size += sample_encryption_entry.ComputeSize();
+  }
+
+  EntryWriter entry_writer(writer, entries_size);
+  for (const SampleEncryptionEntry& sample_encryption_entry :
+       *sample_encryption_entries) {
+    entry_writer.WriteBytes(
+        sample_encryption_entry.initialization_vector.data(), iv_size);
+    if (!has_subsamples)
+      continue;
+    entry_writer.Write2(
+        static_cast<uint16_t>(sample_encryption_entry.subsamples.size()));
+    for (const SubsampleEntry& subsample : sample_encryption_entry.subsamples) {
+      entry_writer.Write2(subsample.clear_bytes);
+      entry_writer.Write4(subsample.cipher_bytes);
+    }
+  }
+  return true;
+}
+
 }  // namespace
 
 FileType::FileType() = default;
@@ -211,6 +282,12 @@ bool SampleAuxiliaryInformationOffset::ReadWriteInternal(BoxBuffer* buffer) {
   offsets.resize(count);
 
   size_t num_bytes = (version == 1) ? sizeof(uint64_t) : sizeof(uint32_t);
+  if (!buffer->Reading()) {
+    EntryWriter entry_writer(buffer->writer(), num_bytes * count);
+    for (uint64_t offset : offsets)
+      entry_writer.WriteNBytes(offset, num_bytes);
+    return true;
+  }
   for (uint32_t i = 0; i < count; ++i)
     RCHECK(buffer->ReadWriteUInt64NBytes(&offsets[i], num_bytes));
   return true;
@@ -347,6 +424,12 @@ bool SampleEncryption::ReadWriteInternal(BoxBuffer* buffer) {
       static_cast<uint32_t>(sample_encryption_entries.size());
   RCHECK(buffer->ReadWriteUInt32(&sample_count));
 
+  if (!buffer->Reading()) {
+    return WriteSampleEncryptionEntries(
+        iv_size, (flags & kUseSubsampleEncryption) != 0,
+        &sample_encryption_entries, buffer->writer());
+  }
+
   sample_encryption_entries.resize(sample_count);
   for (auto& sample_encryption_entry : sample_encryption_entries) {
     RCHECK(sample_encryption_entry.ReadWrite(
@@ -2627,6 +2710,28 @@ bool TrackFragmentRun::ReadWriteInternal(BoxBuffer* buffer) {
       DCHECK(sample_flags.size() == sample_count);
     if (sample_composition_time_offsets_present)
       DCHECK(sample_composition_time_offsets.size() == sample_count);
+
+    const size_t num_fields = (sample_duration_present ? 1 : 0) +
+                              (sample_size_present ? 1 : 0) +
+                              (sample_flags_present ? 1 : 0) +
+                              (sample_composition_time_offsets_present ? 1 : 0);
+    EntryWriter entry_writer(buffer->writer(),
+                             num_fields * sizeof(uint32_t) * sample_count);
+    for (uint32_t i = 0; i < sample_count; ++i) {
+      if (sample_duration_present)
+        entry_writer.Write4(sample_durations[i]);
+      if (sample_size_present)
+        entry_writer.Write4(sample_sizes[i]);
+      if (sample_flags_present)
+        entry_writer.Write4(sample_flags[i]);
+      // Version 0 and version 1 offsets only differ in signedness, which does
+      // not change the bits written.
+      if (sample_composition_time_offsets_present) {
+        entry_writer.Write4(
+            static_cast<uint32_t>(sample_composition_time_offsets[i]));
+      }
+    }
+    return true;
   }
 
   for (uint32_t i = 0; i < sample_count; ++i) {
@@ -1363,6 +1363,31 @@ TEST_F(BoxDefinitionsTest, TrackFragmentRun_NoSampleSize) {
   ASSERT_EQ(trun, trun_readback);
 }
 
+TEST_F(BoxDefinitionsTest, TrackFragmentRun_ManySamples) {
+  const uint32_t kSampleCount = 5000;
+  TrackFragmentRun trun;
+  trun.flags = TrackFragmentRun::kDataOffsetPresentMask |
+               TrackFragmentRun::kSampleDurationPresentMask |
+               TrackFragmentRun::kSampleSizePresentMask |
+               TrackFragmentRun::kSampleCompTimeOffsetsPresentMask;
+  trun.data_offset = 1234;
+  trun.sample_count = kSampleCount;
+  for (uint32_t i = 0; i < kSampleCount; ++i) {
+    trun.sample_durations.push_back(i % 3 + 1000);
+    trun.sample_sizes.push_back(i * 7);
+    trun.sample_composition_time_offsets.push_back(
+        static_cast<int64_t>(i % 5) * 1000 - 2000);
+  }
+  trun.Write(this->buffer_.get());
+  EXPECT_EQ(trun.box_size(), this->buffer_->Size());
+
+  TrackFragmentRun trun_readback;
+  ASSERT_TRUE(ReadBack(&trun_readback));
+  // Negative composition time offsets require version 1.
+  EXPECT_EQ(1, trun_readback.version);
+  ASSERT_EQ(trun, trun_readback);
+}
+
 TEST_F(BoxDefinitionsTest, TrackEncryptionConstantIv) {
   TrackEncryption tenc;
   tenc.default_is_protected = 1;
@@ -6,6 +6,7 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
 #include <limits>
 #include <memory>
 
@@ -24,10 +25,10 @@ BoxReader::BoxReader(const uint8_t* buf, size_t size)
 }
 
 BoxReader::~BoxReader() {
-  if (scanned_ && !children_.empty()) {
-    for (ChildMap::iterator itr = children_.begin(); itr != children_.end();
-         ++itr) {
-      DVLOG(1) << "Skipping unknown box: " << FourCCToString(itr->first);
+  if (scanned_) {
+    for (const Child& child : children_) {
+      if (!child.read)
+        DVLOG(1) << "Skipping unknown box: " << FourCCToString(child.type);
     }
   }
 }
@@ -68,22 +69,27 @@ bool BoxReader::ScanChildren() {
   DCHECK(!scanned_);
   scanned_ = true;
 
+  // Only the location of the children is kept. Their readers are created on
+  // the stack when they are read.
   while (pos() < size()) {
-    std::unique_ptr<BoxReader> child(
-        new BoxReader(&data()[pos()], size() - pos()));
+    BoxReader child(&data()[pos()], size() - pos());
     bool err;
-    if (!child->ReadHeader(&err))
+    if (!child.ReadHeader(&err))
       return false;
 
-    FourCC box_type = child->type();
-    size_t box_size = child->size();
-    children_.insert(std::pair<FourCC, std::unique_ptr<BoxReader>>(
-        box_type, std::move(child)));
-    VLOG(2) << "Child " << FourCCToString(box_type) << " size 0x" << std::hex
-            << box_size << std::dec;
-    RCHECK(SkipBytes(box_size));
+    children_.push_back({child.type(), pos(), false});
+    VLOG(2) << "Child " << FourCCToString(child.type()) << " size 0x"
+            << std::hex << child.size() << std::dec;
+    RCHECK(SkipBytes(child.size()));
   }
 
+  // Sorted by type, and by offset within a type, so the children of a type
+  // are found with a binary search, in the order of the buffer.
+  std::sort(children_.begin(), children_.end(),
+            [](const Child& lhs, const Child& rhs) {
+              return lhs.type != rhs.type ? lhs.type < rhs.type
+                                          : lhs.offset < rhs.offset;
+            });
   return true;
 }
 
@@ -91,24 +97,51 @@ bool BoxReader::ReadChild(Box* child) {
   DCHECK(scanned_);
   FourCC child_type = child->BoxType();
 
-  ChildMap::iterator itr = children_.find(child_type);
-  RCHECK(itr != children_.end());
+  auto range = FindChildren(child_type);
+  auto itr = std::find_if(range.first, range.second,
+                          [](const Child& entry) { return !entry.read; });
+  RCHECK(itr != range.second);
   DVLOG(2) << "Found a " << FourCCToString(child_type) << " box.";
-  RCHECK(child->Parse(itr->second.get()));
-  children_.erase(itr);
+  RCHECK(ParseChild(*itr, child));
+  itr->read = true;
   return true;
 }
 
 bool BoxReader::ChildExist(Box* child) {
-  return children_.count(child->BoxType()) > 0;
+  auto range = FindChildren(child->BoxType());
+  return std::any_of(range.first, range.second,
+                     [](const Child& entry) { return !entry.read; });
 }
 
 bool BoxReader::TryReadChild(Box* child) {
-  if (!children_.count(child->BoxType()))
+  if (!ChildExist(child))
     return true;
   return ReadChild(child);
 }
 
+std::pair<std::vector<BoxReader::Child>::iterator,
+          std::vector<BoxReader::Child>::iterator>
+BoxReader::FindChildren(FourCC type) {
+  struct CompareType {
+    bool operator()(const Child& child, FourCC type) const {
+      return child.type < type;
+    }
+    bool operator()(FourCC type, const Child& child) const {
+      return type < child.type;
+    }
+  };
+  return std::equal_range(children_.begin(), children_.end(), type,
+                          CompareType());
+}
+
+bool BoxReader::ParseChild(const Child& child, Box* box) {
+  BoxReader reader(&data()[child.offset], size() - child.offset);
+  bool err;
+  // The header was checked by ScanChildren().
+  RCHECK(reader.ReadHeader(&err));
+  return box->Parse(&reader);
+}
+
 bool BoxReader::ReadHeader(bool* err) {
   uint64_t size = 0;
   *err = false;
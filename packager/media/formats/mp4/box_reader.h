@@ -5,8 +5,8 @@
 #ifndef PACKAGER_MEDIA_FORMATS_MP4_BOX_READER_H_
 #define PACKAGER_MEDIA_FORMATS_MP4_BOX_READER_H_
 
-#include <map>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "packager/base/compiler_specific.h"
@@ -111,13 +111,26 @@ class BoxReader : public BufferReader {
   // true, the error is unrecoverable and the stream should be aborted.
   bool ReadHeader(bool* err);
 
-  FourCC type_;
+  // Location of a child box in the buffer. Its reader is created when the
+  // child is read.
+  struct Child {
+    FourCC type;
+    size_t offset;
+    bool read;
+  };
+
+  // @return the range of |children_| of type |type|.
+  std::pair<std::vector<Child>::iterator, std::vector<Child>::iterator>
+  FindChildren(FourCC type);
 
-  typedef std::multimap<FourCC, std::unique_ptr<BoxReader>> ChildMap;
+  // Reads the child at |child| with a reader on the stack.
+  bool ParseChild(const Child& child, Box* box);
 
-  // The set of child box FourCCs and their corresponding buffer readers. Only
+  FourCC type_;
+
+  // The child boxes, sorted by type, then in the order of the buffer. Only
   // valid if scanned_ is true.
-  ChildMap children_;
+  std::vector<Child> children_;
   bool scanned_;
 
   DISALLOW_COPY_AND_ASSIGN(BoxReader);
@@ -138,15 +151,21 @@ bool BoxReader::TryReadChildren(std::vector<T>* children) {
   children->resize(1);
   FourCC child_type = (*children)[0].BoxType();
 
-  ChildMap::iterator start_itr = children_.lower_bound(child_type);
-  ChildMap::iterator end_itr = children_.upper_bound(child_type);
-  children->resize(std::distance(start_itr, end_itr));
+  auto range = FindChildren(child_type);
+  size_t num_children = 0;
+  for (auto itr = range.first; itr != range.second; ++itr) {
+    if (!itr->read)
+      ++num_children;
+  }
+  children->resize(num_children);
   typename std::vector<T>::iterator child_itr = children->begin();
-  for (ChildMap::iterator itr = start_itr; itr != end_itr; ++itr) {
-    RCHECK(child_itr->Parse(itr->second.get()));
+  for (auto itr = range.first; itr != range.second; ++itr) {
+    if (itr->read)
+      continue;
+    RCHECK(ParseChild(*itr, &*child_itr));
+    itr->read = true;
     ++child_itr;
   }
-  children_.erase(start_itr, end_itr);
 
   DVLOG(2) << "Found " << children->size() << " " << FourCCToString(child_type)
            << " boxes.";
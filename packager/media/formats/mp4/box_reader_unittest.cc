@@ -164,6 +164,29 @@ TEST_F(BoxReaderTest, ScanChildrenTest) {
   EXPECT_TRUE(reader->TryReadChildren(&kids));
 }
 
+TEST_F(BoxReaderTest, InterleavedChildrenTest) {
+  static const uint8_t kData[] = {
+      0x00, 0x00, 0x00, 0x38, 's',  'k',  'i',  'p',  0x01, 0x02, 0x03, 0x04,
+      0x05, 0x06, 0x07, 0x08, 0xf9, 0x0a, 0x0b, 0x0c, 0xfd, 0x0e, 0x0f, 0x10,
+      // The children of the same type are not next to each other.
+      0x00, 0x00, 0x00, 0x0c, 'p',  's',  's',  'h',  0xde, 0xad, 0xbe, 0xef,
+      0x00, 0x00, 0x00, 0x08, 'f',  'r',  'e',  'e',
+      0x00, 0x00, 0x00, 0x0c, 'p',  's',  's',  'h',  0xfa, 0xce, 0xca, 0xfe,
+  };
+  std::vector<uint8_t> buf(kData, kData + sizeof(kData));
+  bool err;
+  std::unique_ptr<BoxReader> reader(
+      BoxReader::ReadBox(&buf[0], buf.size(), &err));
+  ASSERT_TRUE(reader);
+
+  SkipBox box;
+  EXPECT_TRUE(box.Parse(reader.get()));
+  ASSERT_EQ(2u, box.kids.size());
+  // Ensure the order of the buffer is preserved.
+  EXPECT_EQ(0xdeadbeef, box.kids[0].val);
+  EXPECT_EQ(0xfacecafe, box.kids[1].val);
+}
+
 TEST_F(BoxReaderTest, ReadAllChildrenTest) {
   std::vector<uint8_t> buf = GetBuf();
   // Modify buffer to exclude its last 'free' box.
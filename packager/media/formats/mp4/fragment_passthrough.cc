@@ -0,0 +1,616 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp4/fragment_passthrough.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/stream_info.h"
+#include "packager/media/event/muxer_listener.h"
+#include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/media/formats/mp4/box_reader.h"
+#include "packager/media/formats/mp4/mp4_media_parser.h"
+#include "packager/status_macros.h"
+
+namespace shaka {
+namespace media {
+namespace mp4 {
+
+namespace {
+
+// Track ID of the single track outputs, as written by MP4Muxer.
+const uint32_t kTrackId = 1;
+// Size of the header of a box with a 32-bit size.
+const size_t kBoxHeaderSize = 8;
+
+uint32_t ReadUInt32(const uint8_t* data) {
+  return (static_cast<uint32_t>(data[0]) << 24) |
+         (static_cast<uint32_t>(data[1]) << 16) |
+         (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+void WriteUInt32(uint32_t value, uint8_t* data) {
+  data[0] = static_cast<uint8_t>(value >> 24);
+  data[1] = static_cast<uint8_t>(value >> 16);
+  data[2] = static_cast<uint8_t>(value >> 8);
+  data[3] = static_cast<uint8_t>(value);
+}
+
+// Parses the header of the box at the beginning of |data|, which must hold
+// the whole box.
+bool ParseBoxHeader(const uint8_t* data,
+                    size_t size,
+                    FourCC* type,
+                    uint64_t* box_size,
+                    size_t* header_size) {
+  if (size < kBoxHeaderSize)
+    return false;
+  *type = static_cast<FourCC>(ReadUInt32(data + 4));
+  *header_size = kBoxHeaderSize;
+  *box_size = ReadUInt32(data);
+  if (*box_size == 1) {
+    *header_size += sizeof(uint64_t);
+    if (size < *header_size)
+      return false;
+    *box_size = (static_cast<uint64_t>(ReadUInt32(data + 8)) << 32) |
+                ReadUInt32(data + 12);
+  } else if (*box_size == 0) {
+    *box_size = size;
+  }
+  return *box_size >= *header_size && *box_size <= size;
+}
+
+// Returns the offsets in |data| of the children of type |type| of the
+// container box at |box_offset|.
+std::vector<size_t> FindChildBoxes(const std::vector<uint8_t>& data,
+                                   size_t box_offset,
+                                   FourCC type) {
+  std::vector<size_t> offsets;
+  FourCC box_type = FOURCC_NULL;
+  uint64_t box_size = 0;
+  size_t header_size = 0;
+  if (!ParseBoxHeader(data.data() + box_offset, data.size() - box_offset,
+                      &box_type, &box_size, &header_size)) {
+    return offsets;
+  }
+  const size_t end = box_offset + box_size;
+  size_t offset = box_offset + header_size;
+  while (offset < end) {
+    FourCC child_type = FOURCC_NULL;
+    uint64_t child_size = 0;
+    if (!ParseBoxHeader(data.data() + offset, end - offset, &child_type,
+                        &child_size, &header_size)) {
+      break;
+    }
+    if (child_type == type)
+      offsets.push_back(offset);
+    offset += child_size;
+  }
+  return offsets;
+}
+
+// Rewrites a 32-bit field of the full box at |box_offset|, which is at
+// |field_offset| after the version and flags, or at |field_offset_v1| in
+// version 1 boxes.
+bool RewriteFullBoxField(size_t box_offset,
+                         size_t field_offset,
+                         size_t field_offset_v1,
+                         uint32_t value,
+                         std::vector<uint8_t>* data) {
+  FourCC type = FOURCC_NULL;
+  uint64_t box_size = 0;
+  size_t header_size = 0;
+  if (!ParseBoxHeader(data->data() + box_offset, data->size() - box_offset,
+                      &type, &box_size, &header_size) ||
+      box_size < header_size + 1) {
+    return false;
+  }
+  const uint8_t version = (*data)[box_offset + header_size];
+  const size_t offset = box_offset + header_size + sizeof(uint32_t) +
+                        (version == 1 ? field_offset_v1 : field_offset);
+  if (offset + sizeof(uint32_t) > box_offset + box_size)
+    return false;
+  WriteUInt32(value, data->data() + offset);
+  return true;
+}
+
+// Sets the track ID in 'tkhd' and 'trex'.
+bool RewriteMovieTrackId(uint32_t track_id, std::vector<uint8_t>* moov) {
+  for (size_t trak : FindChildBoxes(*moov, 0, FOURCC_trak)) {
+    for (size_t tkhd : FindChildBoxes(*moov, trak, FOURCC_tkhd)) {
+      // After creation_time and modification_time.
+      RCHECK(RewriteFullBoxField(tkhd, 8, 16, track_id, moov));
+    }
+  }
+  for (size_t mvex : FindChildBoxes(*moov, 0, FOURCC_mvex)) {
+    for (size_t trex : FindChildBoxes(*moov, mvex, FOURCC_trex))
+      RCHECK(RewriteFullBoxField(trex, 0, 0, track_id, moov));
+  }
+  return true;
+}
+
+// Sets the sequence number in 'mfhd' and the track ID in 'tfhd'.
+bool RewriteFragmentHeaders(uint32_t sequence_number,
+                            uint32_t track_id,
+                            std::vector<uint8_t>* moof) {
+  for (size_t mfhd : FindChildBoxes(*moof, 0, FOURCC_mfhd))
+    RCHECK(RewriteFullBoxField(mfhd, 0, 0, sequence_number, moof));
+  for (size_t traf : FindChildBoxes(*moof, 0, FOURCC_traf)) {
+    for (size_t tfhd : FindChildBoxes(*moof, traf, FOURCC_tfhd))
+      RCHECK(RewriteFullBoxField(tfhd, 0, 0, track_id, moof));
+  }
+  return true;
+}
+
+Status ReadError(File* file) {
+  return Status(error::FILE_FAILURE, "Cannot read file " + file->file_name());
+}
+
+Status WriteError(File* file) {
+  return Status(error::FILE_FAILURE, "Cannot write file " + file->file_name());
+}
+
+// Reads the header of the next box in |file| to |box|. |payload_size| is set
+// to the size of the rest of the box. Returns END_OF_STREAM at the end of the
+// file.
+Status ReadBoxHeader(File* file,
+                     FourCC* type,
+                     uint64_t* payload_size,
+                     std::vector<uint8_t>* box) {
+  box->resize(kBoxHeaderSize);
+  const int64_t bytes_read = file->Read(box->data(), kBoxHeaderSize);
+  if (bytes_read == 0)
+    return Status(error::END_OF_STREAM, "");
+  if (bytes_read < 0 ||
+      !File::ReadFully(file, box->data() + bytes_read,
+                       kBoxHeaderSize - bytes_read)) {
+    return ReadError(file);
+  }
+  *type = static_cast<FourCC>(ReadUInt32(box->data() + 4));
+  uint64_t box_size = ReadUInt32(box->data());
+  if (box_size == 1) {
+    box->resize(kBoxHeaderSize + sizeof(uint64_t));
+    if (!File::ReadFully(file, box->data() + kBoxHeaderSize,
+                         sizeof(uint64_t))) {
+      return ReadError(file);
+    }
+    box_size = (static_cast<uint64_t>(ReadUInt32(box->data() + 8)) << 32) |
+               ReadUInt32(box->data() + 12);
+  } else if (box_size == 0) {
+    // The box extends to the end of the file.
+    uint64_t position = 0;
+    const int64_t file_size = file->Size();
+    if (!file->Tell(&position) || file_size < 0) {
+      return Status(error::FILE_FAILURE,
+                    "Cannot get the size of " + file->file_name());
+    }
+    box_size = file_size - position + kBoxHeaderSize;
+  }
+  if (box_size < box->size()) {
+    return Status(error::PARSER_FAILURE,
+                  "Invalid box size in " + file->file_name());
+  }
+  *payload_size = box_size - box->size();
+  return Status::OK;
+}
+
+// Reads |payload_size| bytes of box payload to the end of |box|.
+Status ReadBoxPayload(File* file,
+                      uint64_t payload_size,
+                      std::vector<uint8_t>* box) {
+  const size_t header_size = box->size();
+  box->resize(header_size + payload_size);
+  if (!File::ReadFully(file, box->data() + header_size, payload_size))
+    return ReadError(file);
+  return Status::OK;
+}
+
+Status SkipBoxPayload(File* file, uint64_t payload_size) {
+  uint64_t position = 0;
+  if (!file->Tell(&position) || !file->Seek(position + payload_size)) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot seek in " + file->file_name());
+  }
+  return Status::OK;
+}
+
+void SetStreamInfos(std::vector<std::shared_ptr<StreamInfo>>* stream_infos,
+                    const std::vector<std::shared_ptr<StreamInfo>>& parsed) {
+  *stream_infos = parsed;
+}
+
+bool RejectMediaSample(uint32_t track_id,
+                       std::shared_ptr<MediaSample> media_sample) {
+  return false;
+}
+
+bool RejectTextSample(uint32_t track_id,
+                      std::shared_ptr<TextSample> text_sample) {
+  return false;
+}
+
+// Returns true for the top-level boxes which are not copied to the output
+// segments.
+bool IsDroppedBox(FourCC type) {
+  switch (type) {
+    // Written again for the output segments.
+    case FOURCC_styp:
+    case FOURCC_sidx:
+    case FOURCC_ssix:
+    // Refers to the offsets in the input.
+    case FOURCC_mfra:
+    // Padding.
+    case FOURCC_free:
+    case FOURCC_skip:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+FragmentPassthrough::FragmentPassthrough(const std::string& file_name,
+                                         const MuxerOptions& options)
+    : file_name_(file_name),
+      options_(options),
+      segment_name_formatter_(options.segment_template) {}
+
+FragmentPassthrough::~FragmentPassthrough() {}
+
+void FragmentPassthrough::SetMuxerListener(
+    std::unique_ptr<MuxerListener> muxer_listener) {
+  muxer_listener_ = std::move(muxer_listener);
+}
+
+Status FragmentPassthrough::Open() {
+  DCHECK(!file_);
+  file_.reset(File::Open(file_name_.c_str(), "r"));
+  if (!file_) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file for reading " + file_name_);
+  }
+  while (moov_.empty()) {
+    FourCC type = FOURCC_NULL;
+    uint64_t payload_size = 0;
+    std::vector<uint8_t> box;
+    Status status = ReadBoxHeader(file_.get(), &type, &payload_size, &box);
+    if (status.error_code() == error::END_OF_STREAM)
+      return Status(error::PARSER_FAILURE, "No 'moov' in " + file_name_);
+    RETURN_IF_ERROR(status);
+    switch (type) {
+      case FOURCC_ftyp:
+      case FOURCC_moov:
+        RETURN_IF_ERROR(ReadBoxPayload(file_.get(), payload_size, &box));
+        (type == FOURCC_ftyp ? ftyp_ : moov_) = std::move(box);
+        break;
+      case FOURCC_moof:
+      case FOURCC_mdat:
+        return Status(error::UNIMPLEMENTED,
+                      "'moov' is not at the beginning of " + file_name_);
+      default:
+        RETURN_IF_ERROR(SkipBoxPayload(file_.get(), payload_size));
+        break;
+    }
+  }
+
+  bool err = false;
+  std::unique_ptr<BoxReader> reader(
+      BoxReader::ReadBox(ftyp_.data(), ftyp_.size(), &err));
+  FileType ftyp;
+  if (ftyp_.empty() || !reader || !ftyp.Parse(reader.get()))
+    return Status(error::PARSER_FAILURE, "Invalid 'ftyp' in " + file_name_);
+  // Same as MultiSegmentSegmenter.
+  styp_.reset(new SegmentType);
+  styp_->major_brand = ftyp.major_brand;
+  styp_->compatible_brands = ftyp.compatible_brands;
+  std::replace(styp_->compatible_brands.begin(),
+               styp_->compatible_brands.end(), FOURCC_cmfc, FOURCC_cmfs);
+
+  reader.reset(BoxReader::ReadBox(moov_.data(), moov_.size(), &err));
+  Movie moov;
+  if (!reader || !moov.Parse(reader.get()))
+    return Status(error::PARSER_FAILURE, "Invalid 'moov' in " + file_name_);
+  if (moov.tracks.size() != 1) {
+    return Status(error::UNIMPLEMENTED,
+                  "Only single track inputs are passed through.");
+  }
+  if (moov.extends.tracks.size() != 1)
+    return Status(error::UNIMPLEMENTED, file_name_ + " is not fragmented.");
+  // The demuxer applies the edit lists to the timestamps.
+  for (const EditListEntry& edit : moov.tracks[0].edit.list.edits) {
+    if (edit.media_time != 0) {
+      return Status(error::UNIMPLEMENTED,
+                    "Inputs with edit list offsets are not passed through.");
+    }
+  }
+  default_sample_duration_ = moov.extends.tracks[0].default_sample_duration;
+  default_sample_flags_ = moov.extends.tracks[0].default_sample_flags;
+
+  // The stream info for the listener is the one the demuxer would output.
+  std::vector<std::shared_ptr<StreamInfo>> stream_infos;
+  MP4MediaParser parser;
+  parser.Init(base::Bind(&SetStreamInfos, base::Unretained(&stream_infos)),
+              base::Bind(&RejectMediaSample), base::Bind(&RejectTextSample),
+              nullptr);
+  if (!parser.Parse(ftyp_.data(), static_cast<int>(ftyp_.size())) ||
+      !parser.Parse(moov_.data(), static_cast<int>(moov_.size())) ||
+      stream_infos.size() != 1) {
+    return Status(error::PARSER_FAILURE, "Invalid 'moov' in " + file_name_);
+  }
+  stream_info_ = stream_infos.front();
+  if (stream_info_->is_encrypted()) {
+    return Status(error::UNIMPLEMENTED,
+                  "Encrypted inputs are not passed through.");
+  }
+
+  if (!RewriteMovieTrackId(kTrackId, &moov_))
+    return Status(error::PARSER_FAILURE, "Invalid 'moov' in " + file_name_);
+  return Status::OK;
+}
+
+Status FragmentPassthrough::Run() {
+  if (!file_)
+    RETURN_IF_ERROR(Open());
+  LOG(INFO) << "Passing the fragments of '" << file_name_ << "' through to '"
+            << options_.segment_template << "'.";
+  RETURN_IF_ERROR(WriteInitSegment());
+  const uint32_t time_scale = stream_info_->time_scale();
+  if (muxer_listener_) {
+    muxer_listener_->OnMediaStart(options_, *stream_info_, time_scale,
+                                  MuxerListener::kContainerMp4);
+  }
+  const int64_t segment_duration =
+      static_cast<int64_t>(options_.segment_duration_in_seconds * time_scale);
+
+  while (true) {
+    if (cancelled_)
+      return Status(error::CANCELLED, "Fragment passthrough cancelled");
+    FourCC type = FOURCC_NULL;
+    uint64_t payload_size = 0;
+    std::vector<uint8_t> box;
+    Status status = ReadBoxHeader(file_.get(), &type, &payload_size, &box);
+    if (status.error_code() == error::END_OF_STREAM)
+      break;
+    RETURN_IF_ERROR(status);
+    if (type != FOURCC_moof) {
+      if (IsDroppedBox(type)) {
+        VLOG(2) << "Skipping box " << FourCCToString(type);
+        RETURN_IF_ERROR(SkipBoxPayload(file_.get(), payload_size));
+      } else {
+        VLOG(2) << "Passing box " << FourCCToString(type) << " through.";
+        RETURN_IF_ERROR(ReadBoxPayload(file_.get(), payload_size, &box));
+        other_boxes_.insert(other_boxes_.end(), box.begin(), box.end());
+      }
+      continue;
+    }
+    RETURN_IF_ERROR(ReadBoxPayload(file_.get(), payload_size, &box));
+
+    Fragment fragment;
+    RETURN_IF_ERROR(ReadFragment(std::move(box), &fragment));
+    const int64_t segment_index =
+        segment_duration > 0
+            ? static_cast<int64_t>(fragment.earliest_presentation_time) /
+                  segment_duration
+            : 0;
+    if (fragments_.empty()) {
+      segment_index_ = segment_index;
+    } else if (fragment.starts_with_sap &&
+               IsNewSegmentIndex(segment_index, segment_index_)) {
+      RETURN_IF_ERROR(WriteSegment());
+      segment_index_ = segment_index;
+    }
+    total_duration_ += fragment.duration;
+    fragments_.push_back(std::move(fragment));
+  }
+  if (!other_boxes_.empty()) {
+    if (fragments_.empty()) {
+      LOG(WARNING) << "Dropping the boxes after the last fragment of "
+                   << file_name_;
+    } else {
+      // Kept at the end of the last segment.
+      std::vector<uint8_t>& data = fragments_.back().data;
+      data.insert(data.end(), other_boxes_.begin(), other_boxes_.end());
+    }
+    other_boxes_.clear();
+  }
+  if (!fragments_.empty())
+    RETURN_IF_ERROR(WriteSegment());
+
+  if (muxer_listener_) {
+    muxer_listener_->OnMediaEnd(
+        MuxerListener::MediaRanges(),
+        static_cast<float>(total_duration_) / time_scale);
+  }
+  return Status::OK;
+}
+
+void FragmentPassthrough::Cancel() {
+  cancelled_ = true;
+}
+
+Status FragmentPassthrough::ReadFragment(std::vector<uint8_t> moof,
+                                         Fragment* fragment) {
+  bool err = false;
+  std::unique_ptr<BoxReader> reader(
+      BoxReader::ReadBox(moof.data(), moof.size(), &err));
+  MovieFragment movie_fragment;
+  if (!reader || !movie_fragment.Parse(reader.get()))
+    return Status(error::PARSER_FAILURE, "Invalid 'moof' in " + file_name_);
+  if (movie_fragment.tracks.size() != 1) {
+    return Status(error::UNIMPLEMENTED,
+                  "Fragments with multiple tracks are not passed through.");
+  }
+  const TrackFragment& traf = movie_fragment.tracks.front();
+  // The data offsets must be relative to 'moof', which is moved.
+  if (traf.header.flags & TrackFragmentHeader::kBaseDataOffsetPresentMask) {
+    return Status(error::UNIMPLEMENTED,
+                  "Fragments with absolute data offsets are not passed "
+                  "through.");
+  }
+  if (traf.decode_time_absent)
+    return Status(error::PARSER_FAILURE, "No 'tfdt' in " + file_name_);
+
+  const uint32_t default_sample_duration =
+      (traf.header.flags &
+       TrackFragmentHeader::kDefaultSampleDurationPresentMask)
+          ? traf.header.default_sample_duration
+          : default_sample_duration_;
+  const uint32_t default_sample_flags =
+      (traf.header.flags & TrackFragmentHeader::kDefaultSampleFlagsPresentMask)
+          ? traf.header.default_sample_flags
+          : default_sample_flags_;
+  int64_t decode_time = traf.decode_time.decode_time;
+  int64_t earliest_presentation_time = std::numeric_limits<int64_t>::max();
+  bool first_sample = true;
+  for (const TrackFragmentRun& run : traf.runs) {
+    for (uint32_t i = 0; i < run.sample_count; ++i) {
+      const uint32_t sample_duration = run.sample_durations.empty()
+                                           ? default_sample_duration
+                                           : run.sample_durations[i];
+      const int64_t composition_offset =
+          run.sample_composition_time_offsets.empty()
+              ? 0
+              : run.sample_composition_time_offsets[i];
+      if (first_sample) {
+        // The flags of the first sample may be the only ones in the run.
+        const uint32_t sample_flags =
+            run.sample_flags.empty() ? default_sample_flags
+                                     : run.sample_flags[0];
+        fragment->starts_with_sap =
+            !(sample_flags & TrackFragmentHeader::kNonKeySampleMask);
+        if (sample_duration_ == 0) {
+          sample_duration_ = sample_duration;
+          if (muxer_listener_)
+            muxer_listener_->OnSampleDurationReady(sample_duration_);
+        }
+        first_sample = false;
+      }
+      earliest_presentation_time = std::min(
+          earliest_presentation_time, decode_time + composition_offset);
+      decode_time += sample_duration;
+    }
+  }
+  if (first_sample)
+    return Status(error::PARSER_FAILURE, "Empty 'moof' in " + file_name_);
+  fragment->earliest_presentation_time = earliest_presentation_time;
+  fragment->duration = decode_time - traf.decode_time.decode_time;
+
+  if (!RewriteFragmentHeaders(++sequence_number_, kTrackId, &moof))
+    return Status(error::PARSER_FAILURE, "Invalid 'moof' in " + file_name_);
+
+  // The data offsets in 'trun' point to the 'mdat' right after 'moof'.
+  FourCC type = FOURCC_NULL;
+  uint64_t payload_size = 0;
+  // The boxes read since the previous fragment, e.g. 'emsg', are written
+  // right before 'moof'. The 'trun' data offsets are relative to 'moof', so
+  // they do not change.
+  fragment->data = std::move(other_boxes_);
+  other_boxes_.clear();
+  fragment->data.insert(fragment->data.end(), moof.begin(), moof.end());
+  const size_t moof_size = fragment->data.size();
+  std::vector<uint8_t> mdat_header;
+  RETURN_IF_ERROR(
+      ReadBoxHeader(file_.get(), &type, &payload_size, &mdat_header));
+  if (type != FOURCC_mdat) {
+    return Status(error::UNIMPLEMENTED,
+                  "'moof' is not followed by 'mdat' in " + file_name_);
+  }
+  // The media data is read at once, in place after 'moof'.
+  fragment->data.resize(moof_size + mdat_header.size());
+  std::copy(mdat_header.begin(), mdat_header.end(),
+            fragment->data.begin() + moof_size);
+  return ReadBoxPayload(file_.get(), payload_size, &fragment->data);
+}
+
+Status FragmentPassthrough::WriteInitSegment() {
+  std::unique_ptr<File, FileCloser> file(
+      File::Open(options_.output_file_name.c_str(), "w"));
+  if (!file) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file for write " + options_.output_file_name);
+  }
+  if (!File::WriteFully(file.get(), ftyp_.data(), ftyp_.size()) ||
+      !File::WriteFully(file.get(), moov_.data(), moov_.size())) {
+    return WriteError(file.get());
+  }
+  if (!file.release()->Close()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot close file " + options_.output_file_name);
+  }
+  return Status::OK;
+}
+
+Status FragmentPassthrough::WriteSegment() {
+  DCHECK(!fragments_.empty());
+  const uint64_t start_time = fragments_.front().earliest_presentation_time;
+  uint64_t segment_duration = 0;
+  for (const Fragment& fragment : fragments_)
+    segment_duration += fragment.duration;
+
+  BufferWriter buffer;
+  styp_->Write(&buffer);
+  if (options_.mp4_params.generate_sidx_in_media_segments) {
+    // One subsegment per fragment, as MultiSegmentSegmenter writes.
+    SegmentIndex sidx;
+    sidx.reference_id = kTrackId;
+    sidx.timescale = stream_info_->time_scale();
+    sidx.earliest_presentation_time = start_time;
+    for (const Fragment& fragment : fragments_) {
+      SegmentReference reference;
+      reference.referenced_size = static_cast<uint32_t>(fragment.data.size());
+      reference.subsegment_duration = static_cast<uint32_t>(fragment.duration);
+      reference.starts_with_sap = fragment.starts_with_sap;
+      reference.sap_type = fragment.starts_with_sap
+                               ? SegmentReference::Type1
+                               : SegmentReference::TypeUnknown;
+      reference.earliest_presentation_time =
+          fragment.earliest_presentation_time;
+      sidx.references.push_back(reference);
+    }
+    sidx.Write(&buffer);
+  }
+
+  const std::string file_name = segment_name_formatter_.Format(
+      start_time, num_segments_++, options_.bandwidth);
+  std::unique_ptr<File, FileCloser> file(File::Open(file_name.c_str(), "w"));
+  if (!file) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file for write " + file_name);
+  }
+  uint64_t segment_size = buffer.Size();
+  RETURN_IF_ERROR(buffer.WriteToFile(file.get()));
+  for (const Fragment& fragment : fragments_) {
+    if (!File::WriteFully(file.get(), fragment.data.data(),
+                          fragment.data.size())) {
+      return WriteError(file.get());
+    }
+    segment_size += fragment.data.size();
+  }
+  fragments_.clear();
+  // Close the file, which also does flushing, to make sure the file is written
+  // before manifest is updated.
+  if (!file.release()->Close()) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close file " + file_name +
+            ", possibly file permission issue or running out of disk space.");
+  }
+
+  if (muxer_listener_) {
+    muxer_listener_->OnNewSegment(file_name, start_time, segment_duration,
+                                  segment_size);
+  }
+  return Status::OK;
+}
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
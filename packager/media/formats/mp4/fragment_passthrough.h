@@ -0,0 +1,122 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_FORMATS_MP4_FRAGMENT_PASSTHROUGH_H_
+#define PACKAGER_MEDIA_FORMATS_MP4_FRAGMENT_PASSTHROUGH_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/base/muxer_util.h"
+#include "packager/media/origin/origin_handler.h"
+
+namespace shaka {
+namespace media {
+
+class MuxerListener;
+class StreamInfo;
+
+namespace mp4 {
+
+struct SegmentType;
+
+/// FragmentPassthrough remuxes a fragmented MP4 input with a single track,
+/// e.g. CMAF encoder outputs, to a segment template output without demuxing
+/// it. The 'moof' and 'mdat' boxes are copied as they are, except for the
+/// 'mfhd' sequence numbers and the track IDs, which are rewritten in place.
+/// The fragments are grouped into segments like ChunkingHandler does, i.e. a
+/// segment starts at the first fragment starting with a key frame past the
+/// segment duration, and each segment starts with a 'styp' and, if enabled,
+/// a 'sidx'. The timestamps are left unchanged. The other top-level boxes of
+/// the input, e.g. 'emsg' or 'prft', are copied before the 'moof' that
+/// follows them, except for 'styp', 'sidx', 'ssix', 'mfra', 'free' and
+/// 'skip', which are dropped.
+///
+/// It is an alternative to the demuxer, chunking handler and muxer chain for
+/// the outputs that need neither encryption nor re-segmentation. Open()
+/// tells whether an input can be passed through.
+class FragmentPassthrough : public OriginHandler {
+ public:
+  /// @param file_name is the fragmented MP4 input.
+  /// @param options is the options of the output, with a segment template.
+  FragmentPassthrough(const std::string& file_name,
+                      const MuxerOptions& options);
+  ~FragmentPassthrough() override;
+
+  /// Sets the listener notified of the init segment and the segments written.
+  void SetMuxerListener(std::unique_ptr<MuxerListener> muxer_listener);
+
+  /// Reads the 'ftyp' and 'moov' boxes of the input.
+  /// @return OK if the input can be passed through, otherwise an error telling
+  ///         why it needs to be demuxed instead.
+  Status Open();
+
+  /// @name OriginHandler implementation overrides.
+  /// @{
+  Status Run() override;
+  void Cancel() override;
+  /// @}
+
+ protected:
+  /// @name MediaHandler implementation overrides.
+  /// @{
+  Status InitializeInternal() override { return Status::OK; }
+  /// @}
+
+ private:
+  FragmentPassthrough(const FragmentPassthrough&) = delete;
+  FragmentPassthrough& operator=(const FragmentPassthrough&) = delete;
+
+  // A 'moof' and its 'mdat', as written to the output.
+  struct Fragment {
+    std::vector<uint8_t> data;
+    uint64_t earliest_presentation_time = 0;
+    uint64_t duration = 0;
+    bool starts_with_sap = false;
+  };
+
+  Status ReadFragment(std::vector<uint8_t> moof, Fragment* fragment);
+  Status WriteInitSegment();
+  Status WriteSegment();
+
+  const std::string file_name_;
+  const MuxerOptions options_;
+  const SegmentNameFormatter segment_name_formatter_;
+  std::unique_ptr<MuxerListener> muxer_listener_;
+  std::unique_ptr<File, FileCloser> file_;
+
+  // The 'ftyp' and 'moov' boxes of the input, with the track ID rewritten.
+  std::vector<uint8_t> ftyp_;
+  std::vector<uint8_t> moov_;
+  std::unique_ptr<SegmentType> styp_;
+  std::shared_ptr<StreamInfo> stream_info_;
+  // Defaults from 'trex'.
+  uint32_t default_sample_duration_ = 0;
+  uint32_t default_sample_flags_ = 0;
+
+  // The fragments of the current segment.
+  std::vector<Fragment> fragments_;
+  // The top-level boxes read since the last fragment, e.g. 'emsg'.
+  std::vector<uint8_t> other_boxes_;
+  int64_t segment_index_ = -1;
+  uint32_t num_segments_ = 0;
+  uint32_t sequence_number_ = 0;
+  uint32_t sample_duration_ = 0;
+  uint64_t total_duration_ = 0;
+  bool cancelled_ = false;
+};
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_FORMATS_MP4_FRAGMENT_PASSTHROUGH_H_
@@ -0,0 +1,193 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp4/fragment_passthrough.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/file/file.h"
+#include "packager/media/base/stream_info.h"
+#include "packager/media/event/mock_muxer_listener.h"
+#include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/media/formats/mp4/box_reader.h"
+#include "packager/media/test/test_data_util.h"
+#include "packager/status_test_util.h"
+
+using ::testing::_;
+using ::testing::InSequence;
+using ::testing::Property;
+
+namespace shaka {
+namespace media {
+namespace mp4 {
+
+namespace {
+// A single AAC track at 44.1kHz, in three fragments of 44, 44 and 31 frames.
+const char kInputFile[] = "bear-mpeg2-aac-only_frag.mp4";
+const uint32_t kTimeScale = 44100;
+const uint64_t kFragmentDuration = 44 * 1024;
+const char kInitSegment[] = "memory://init.mp4";
+const char kSegmentTemplate[] = "memory://segment-$Number$.m4s";
+
+std::vector<uint8_t> ReadFile(const std::string& file_name) {
+  std::string content;
+  EXPECT_TRUE(File::ReadFileToString(file_name.c_str(), &content));
+  return std::vector<uint8_t>(content.begin(), content.end());
+}
+
+// Returns the offsets of the top-level boxes of |data|, which all have a
+// 32-bit size.
+std::vector<size_t> GetBoxOffsets(const std::string& data) {
+  std::vector<size_t> offsets;
+  size_t offset = 0;
+  while (offset + 4 <= data.size()) {
+    offsets.push_back(offset);
+    const uint8_t* size = reinterpret_cast<const uint8_t*>(&data[offset]);
+    offset += (static_cast<size_t>(size[0]) << 24) | (size[1] << 16) |
+              (size[2] << 8) | size[3];
+  }
+  return offsets;
+}
+}  // namespace
+
+class FragmentPassthroughTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    options_.output_file_name = kInitSegment;
+    options_.segment_template = kSegmentTemplate;
+    options_.segment_duration_in_seconds = 2;
+  }
+
+  MuxerOptions options_;
+};
+
+TEST_F(FragmentPassthroughTest, Segments) {
+  options_.mp4_params.generate_sidx_in_media_segments = false;
+  std::unique_ptr<MockMuxerListener> listener(new MockMuxerListener);
+  {
+    InSequence s;
+    EXPECT_CALL(*listener,
+                OnMediaStart(_, Property(&StreamInfo::codec, kCodecAAC),
+                             kTimeScale, MuxerListener::kContainerMp4));
+    EXPECT_CALL(*listener, OnSampleDurationReady(1024));
+    // The second fragment starts within the segment duration of the first.
+    EXPECT_CALL(*listener, OnNewSegment("memory://segment-1.m4s", 0,
+                                        2 * kFragmentDuration, _));
+    EXPECT_CALL(*listener, OnNewSegment("memory://segment-2.m4s",
+                                        2 * kFragmentDuration, 31 * 1024, _));
+    EXPECT_CALL(*listener, OnMediaEndMock(_, _, _, _, _, _, _, _, _));
+  }
+  FragmentPassthrough passthrough(
+      GetTestDataFilePath(kInputFile).AsUTF8Unsafe(), options_);
+  passthrough.SetMuxerListener(std::move(listener));
+  ASSERT_OK(passthrough.Run());
+
+  std::vector<uint8_t> init_segment = ReadFile(kInitSegment);
+  bool err = false;
+  std::unique_ptr<BoxReader> reader(
+      BoxReader::ReadBox(init_segment.data(), init_segment.size(), &err));
+  ASSERT_TRUE(reader);
+  EXPECT_EQ(FOURCC_ftyp, reader->type());
+  std::vector<uint8_t> moov(init_segment.begin() + reader->size(),
+                            init_segment.end());
+  reader.reset(BoxReader::ReadBox(moov.data(), moov.size(), &err));
+  Movie movie;
+  ASSERT_TRUE(reader && movie.Parse(reader.get()));
+  EXPECT_EQ(1u, movie.tracks[0].header.track_id);
+
+  std::vector<uint8_t> segment = ReadFile("memory://segment-2.m4s");
+  reader.reset(BoxReader::ReadBox(segment.data(), segment.size(), &err));
+  ASSERT_TRUE(reader);
+  EXPECT_EQ(FOURCC_styp, reader->type());
+  size_t offset = reader->size();
+  reader.reset(BoxReader::ReadBox(segment.data() + offset,
+                                  segment.size() - offset, &err));
+  MovieFragment moof;
+  ASSERT_TRUE(reader && moof.Parse(reader.get()));
+  EXPECT_EQ(3u, moof.header.sequence_number);
+  EXPECT_EQ(1u, moof.tracks[0].header.track_id);
+  EXPECT_EQ(2 * kFragmentDuration, moof.tracks[0].decode_time.decode_time);
+  offset += reader->size();
+  reader.reset(BoxReader::ReadBox(segment.data() + offset,
+                                  segment.size() - offset, &err));
+  ASSERT_TRUE(reader);
+  EXPECT_EQ(FOURCC_mdat, reader->type());
+  EXPECT_EQ(segment.size(), offset + reader->size());
+}
+
+TEST_F(FragmentPassthroughTest, Sidx) {
+  options_.mp4_params.generate_sidx_in_media_segments = true;
+  FragmentPassthrough passthrough(
+      GetTestDataFilePath(kInputFile).AsUTF8Unsafe(), options_);
+  ASSERT_OK(passthrough.Run());
+
+  std::vector<uint8_t> segment = ReadFile("memory://segment-1.m4s");
+  bool err = false;
+  std::unique_ptr<BoxReader> reader(
+      BoxReader::ReadBox(segment.data(), segment.size(), &err));
+  ASSERT_TRUE(reader);
+  const size_t offset = reader->size();
+  reader.reset(BoxReader::ReadBox(segment.data() + offset,
+                                  segment.size() - offset, &err));
+  SegmentIndex sidx;
+  ASSERT_TRUE(reader && sidx.Parse(reader.get()));
+  EXPECT_EQ(kTimeScale, sidx.timescale);
+  ASSERT_EQ(2u, sidx.references.size());
+  EXPECT_EQ(kFragmentDuration, sidx.references[0].subsegment_duration);
+  EXPECT_TRUE(sidx.references[1].starts_with_sap);
+  EXPECT_EQ(segment.size(), offset + reader->size() +
+                                sidx.references[0].referenced_size +
+                                sidx.references[1].referenced_size);
+}
+
+TEST_F(FragmentPassthroughTest, OtherBoxes) {
+  const char kInput[] = "memory://input.mp4";
+  // An 'emsg' box with an empty payload, and a 'free' box.
+  const std::string kEmsg("\x00\x00\x00\x08emsg", 8);
+  const std::string kFree("\x00\x00\x00\x08free", 8);
+  std::string input;
+  ASSERT_TRUE(File::ReadFileToString(
+      GetTestDataFilePath(kInputFile).AsUTF8Unsafe().c_str(), &input));
+  // Before the 'moof' of the second fragment.
+  std::vector<size_t> moofs;
+  for (size_t offset : GetBoxOffsets(input)) {
+    if (input.compare(offset + 4, 4, "moof") == 0)
+      moofs.push_back(offset);
+  }
+  ASSERT_EQ(3u, moofs.size());
+  input.insert(moofs[1], kEmsg + kFree);
+  ASSERT_TRUE(File::WriteStringToFile(kInput, input));
+
+  options_.mp4_params.generate_sidx_in_media_segments = false;
+  FragmentPassthrough passthrough(kInput, options_);
+  ASSERT_OK(passthrough.Run());
+
+  std::string segment;
+  ASSERT_TRUE(File::ReadFileToString("memory://segment-1.m4s", &segment));
+  std::vector<std::string> types;
+  for (size_t offset : GetBoxOffsets(segment))
+    types.push_back(segment.substr(offset + 4, 4));
+  EXPECT_THAT(types, ::testing::ElementsAre("styp", "moof", "mdat", "emsg",
+                                            "moof", "mdat"));
+}
+
+TEST_F(FragmentPassthroughTest, RejectsEncryptedInput) {
+  FragmentPassthrough passthrough(
+      GetTestDataFilePath("bear-640x360-v_frag-cenc-senc.mp4").AsUTF8Unsafe(),
+      options_);
+  EXPECT_EQ(error::UNIMPLEMENTED, passthrough.Open().error_code());
+}
+
+TEST_F(FragmentPassthroughTest, RejectsMultipleTracks) {
+  FragmentPassthrough passthrough(
+      GetTestDataFilePath("bear-640x360-av_frag.mp4").AsUTF8Unsafe(), options_);
+  EXPECT_EQ(error::UNIMPLEMENTED, passthrough.Open().error_code());
+}
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
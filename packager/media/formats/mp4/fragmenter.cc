@@ -10,7 +10,8 @@
 #include <limits>
 
 #include "packager/media/base/audio_stream_info.h"
-#include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/buffer_chain.h"
+#include "packager/media/base/hot_path_log.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/formats/mp4/box_definitions.h"
 #include "packager/media/formats/mp4/key_frame_info.h"
@@ -35,12 +36,13 @@ void NewSampleEncryptionEntry(const DecryptConfig& decrypt_config,
                               bool use_constant_iv,
                               TrackFragment* traf) {
   SampleEncryption& sample_encryption = traf->sample_encryption;
-  SampleEncryptionEntry sample_encryption_entry;
+  // Filled in place to avoid copying the IV and subsamples once more.
+  sample_encryption.sample_encryption_entries.emplace_back();
+  SampleEncryptionEntry& sample_encryption_entry =
+      sample_encryption.sample_encryption_entries.back();
   if (!use_constant_iv)
     sample_encryption_entry.initialization_vector = decrypt_config.iv();
   sample_encryption_entry.subsamples = decrypt_config.subsamples();
-  sample_encryption.sample_encryption_entries.push_back(
-      sample_encryption_entry);
   traf->auxiliary_size.sample_info_sizes.push_back(
       sample_encryption_entry.ComputeSize());
 }
@@ -54,8 +56,11 @@ Fragmenter::Fragmenter(std::shared_ptr<const StreamInfo> stream_info,
       traf_(traf),
       edit_list_offset_(edit_list_offset),
       seek_preroll_(GetSeekPreroll(*stream_info_)),
+      is_video_(stream_info_->stream_type() == kStreamVideo),
+      use_constant_iv_(!stream_info_->encryption_config().constant_iv.empty()),
       earliest_presentation_time_(kInvalidTime),
-      first_sap_time_(kInvalidTime) {
+      first_sap_time_(kInvalidTime),
+      data_memory_(MemorySubsystem::kFragmenter) {
   DCHECK(stream_info_);
   DCHECK(traf);
 }
@@ -68,6 +73,7 @@ Status Fragmenter::AddSample(const MediaSample& sample) {
   const int64_t duration = sample.duration();
   if (duration == 0)
     LOG(WARNING) << "Unexpected sample with zero duration @ dts " << dts;
+  HOT_PATH_LOG(kFragmenter) << "Sample:\n " << sample.ToString();
 
   if (!fragment_initialized_)
     RETURN_IF_ERROR(InitializeFragment(dts));
@@ -82,19 +88,16 @@ Status Fragmenter::AddSample(const MediaSample& sample) {
   traf_->runs[0].sample_flags.push_back(
       sample.is_key_frame() ? 0 : TrackFragmentHeader::kNonKeySampleMask);
 
-  if (sample.decrypt_config()) {
-    NewSampleEncryptionEntry(
-        *sample.decrypt_config(),
-        !stream_info_->encryption_config().constant_iv.empty(), traf_);
-  }
+  if (sample.decrypt_config())
+    NewSampleEncryptionEntry(*sample.decrypt_config(), use_constant_iv_, traf_);
 
-  if (stream_info_->stream_type() == StreamType::kStreamVideo &&
-      sample.is_key_frame()) {
+  if (is_video_ && sample.is_key_frame()) {
     key_frame_infos_.push_back(
         {static_cast<uint64_t>(pts), data_->Size(), sample.data_size()});
   }
 
-  data_->AppendArray(sample.data(), sample.data_size());
+  data_->AppendSharedData(sample.shared_data(), sample.data_size());
+  data_memory_.Add(sample.data_size());
 
   traf_->runs[0].sample_composition_time_offsets.push_back(pts - dts);
   if (pts != dts)
@@ -136,9 +139,18 @@ Status Fragmenter::InitializeFragment(int64_t first_sample_dts) {
   const int64_t dts_before_edit = first_sample_dts + edit_list_offset_;
   traf_->decode_time.decode_time = dts_before_edit;
 
-  traf_->runs.clear();
+  // The run and the sample vectors are emptied rather than recreated, so they
+  // keep their storage from one fragment to the next.
   traf_->runs.resize(1);
-  traf_->runs[0].flags = TrackFragmentRun::kDataOffsetPresentMask;
+  TrackFragmentRun& run = traf_->runs[0];
+  run.version = 0;
+  run.flags = TrackFragmentRun::kDataOffsetPresentMask;
+  run.sample_count = 0;
+  run.data_offset = 0;
+  run.sample_flags.clear();
+  run.sample_sizes.clear();
+  run.sample_durations.clear();
+  run.sample_composition_time_offsets.clear();
   traf_->auxiliary_size.sample_info_sizes.clear();
   traf_->auxiliary_offset.offsets.clear();
   traf_->sample_encryption.sample_encryption_entries.clear();
@@ -151,7 +163,11 @@ Status Fragmenter::InitializeFragment(int64_t first_sample_dts) {
   fragment_duration_ = 0;
   earliest_presentation_time_ = kInvalidTime;
   first_sap_time_ = kInvalidTime;
-  data_.reset(new BufferWriter());
+  if (data_)
+    data_->Clear();
+  else
+    data_.reset(new BufferChain());
+  data_memory_.Set(0);
   key_frame_infos_.clear();
   return Status::OK;
 }
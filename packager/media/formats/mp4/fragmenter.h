@@ -11,12 +11,13 @@
 #include <vector>
 
 #include "packager/base/logging.h"
+#include "packager/file/memory_budget.h"
 #include "packager/status.h"
 
 namespace shaka {
 namespace media {
 
-class BufferWriter;
+class BufferChain;
 class MediaSample;
 class StreamInfo;
 
@@ -66,7 +67,7 @@ class Fragmenter {
   }
   bool fragment_initialized() const { return fragment_initialized_; }
   bool fragment_finalized() const { return fragment_finalized_; }
-  BufferWriter* data() { return data_.get(); }
+  BufferChain* data() { return data_.get(); }
   const std::vector<KeyFrameInfo>& key_frame_infos() const {
     return key_frame_infos_;
   }
@@ -89,12 +90,19 @@ class Fragmenter {
   TrackFragment* traf_ = nullptr;
   int64_t edit_list_offset_ = 0;
   int64_t seek_preroll_ = 0;
+  // The per-stream decisions of AddSample(), made once rather than for each
+  // sample.
+  const bool is_video_;
+  const bool use_constant_iv_;
   bool fragment_initialized_ = false;
   bool fragment_finalized_ = false;
   int64_t fragment_duration_ = 0;
   int64_t earliest_presentation_time_ = 0;
   int64_t first_sap_time_ = 0;
-  std::unique_ptr<BufferWriter> data_;
+  // References to the sample data in the fragment.
+  std::unique_ptr<BufferChain> data_;
+  // The size of |data_| accounted to the process-wide memory budget.
+  AccountedMemory data_memory_;
   // Saves key frames information, for Video.
   std::vector<KeyFrameInfo> key_frame_infos_;
 
@@ -26,6 +26,8 @@
         'composition_offset_iterator.h',
         'decoding_time_iterator.cc',
         'decoding_time_iterator.h',
+        'fragment_passthrough.cc',
+        'fragment_passthrough.h',
         'fragmenter.cc',
         'fragmenter.h',
         'key_frame_info.h',
@@ -35,6 +37,10 @@
         'mp4_muxer.h',
         'multi_segment_segmenter.cc',
         'multi_segment_segmenter.h',
+        'progressive_segmenter.cc',
+        'progressive_segmenter.h',
+        'sample_table_reader.cc',
+        'sample_table_reader.h',
         'segmenter.cc',
         'segmenter.h',
         'single_segment_segmenter.cc',
@@ -51,6 +57,7 @@
         '../../codecs/codecs.gyp:codecs',
         '../../event/media_event.gyp:media_event',
         '../../formats/ttml/ttml.gyp:ttml',
+        '../../origin/origin.gyp:origin',
       ],
     },
     {
@@ -62,7 +69,9 @@
         'chunk_info_iterator_unittest.cc',
         'composition_offset_iterator_unittest.cc',
         'decoding_time_iterator_unittest.cc',
+        'fragment_passthrough_unittest.cc',
         'mp4_media_parser_unittest.cc',
+        'mp4_muxer_unittest.cc',
         'sync_sample_iterator_unittest.cc',
         'track_run_iterator_unittest.cc',
       ],
@@ -70,7 +79,10 @@
         '../../../file/file.gyp:file',
         '../../../testing/gtest.gyp:gtest',
         '../../../testing/gmock.gyp:gmock',
+        '../../../third_party/boringssl/boringssl.gyp:boringssl',
         '../../../third_party/gflags/gflags.gyp:gflags',
+        '../../base/media_base.gyp:media_handler_test_base',
+        '../../event/media_event.gyp:mock_muxer_listener',
         '../../test/media_test.gyp:media_test_support',
         'mp4',
       ]
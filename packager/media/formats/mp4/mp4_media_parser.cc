@@ -208,6 +208,8 @@ void MP4MediaParser::Reset() {
 
 bool MP4MediaParser::Flush() {
   DCHECK_NE(state_, kWaitingForInit);
+  if (!EmitPendingKeyFrames())
+    return false;
   Reset();
   ChangeState(kParsingBoxes);
   return true;
@@ -322,6 +324,236 @@ bool MP4MediaParser::LoadMoov(const std::string& file_path) {
   return true;
 }
 
+bool MP4MediaParser::InitRandomAccess(const std::string& file_path) {
+  DCHECK_EQ(state_, kParsingBoxes);
+  DCHECK(!moov_);
+
+  std::unique_ptr<File, FileCloser> file(
+      File::OpenWithNoBuffering(file_path.c_str(), "r"));
+  if (!file) {
+    LOG(ERROR) << "Unable to open media file '" << file_path << "'";
+    return false;
+  }
+
+  // Locate the 'moov' box, wherever it is.
+  uint64_t file_position = 0;
+  uint64_t box_size = 0;
+  while (true) {
+    const uint32_t kBoxHeaderReadSize(16);
+    uint8_t header[kBoxHeaderReadSize];
+    if (!file->Seek(file_position)) {
+      LOG(WARNING) << "Filesystem does not support seeking on file '"
+                   << file_path << "'";
+      return false;
+    }
+    const int64_t bytes_read = file->Read(header, kBoxHeaderReadSize);
+    if (bytes_read <= 0) {
+      LOG(ERROR) << "Could not find 'moov' box in file '" << file_path << "'";
+      return false;
+    }
+    FourCC box_type;
+    bool err = false;
+    if (!BoxReader::StartBox(header, bytes_read, &box_type, &box_size, &err)) {
+      LOG(ERROR) << "Could not start box from file '" << file_path << "'";
+      return false;
+    }
+    if (box_type == FOURCC_moov)
+      break;
+    if (box_type == FOURCC_moof)
+      return false;
+    file_position += box_size;
+  }
+
+  // The sample tables are read as the samples are read, so they are left out
+  // of the 'moov' box.
+  std::vector<uint8_t> moov_data;
+  std::map<uint32_t, SampleTableBoxLocations> sample_tables;
+  if (!ReadMoovWithoutSampleTables(file.get(), file_position, box_size,
+                                   &moov_data, &sample_tables)) {
+    LOG(ERROR) << "Error reading 'moov' contents from file '" << file_path
+               << "'";
+    return false;
+  }
+  bool err = false;
+  std::unique_ptr<BoxReader> reader(
+      BoxReader::ReadBox(moov_data.data(), moov_data.size(), &err));
+  if (!reader || !reader->ScanChildren()) {
+    LOG(ERROR) << "Error parsing mp4 file '" << file_path << "'";
+    return false;
+  }
+  // The samples of fragmented files are not described in the sample tables.
+  MovieExtends extends;
+  if (reader->ChildExist(&extends)) {
+    VLOG(1) << "Fragmented file '" << file_path
+            << "' is not read with random access.";
+    return false;
+  }
+
+  reader.reset(BoxReader::ReadBox(moov_data.data(), moov_data.size(), &err));
+  DCHECK(reader);
+  random_access_file_ = std::move(file);
+  random_access_sample_tables_.swap(sample_tables);
+  if (!ParseMoov(reader.get())) {
+    LOG(ERROR) << "Error parsing mp4 file '" << file_path << "'";
+    random_access_file_.reset();
+    random_access_sample_tables_.clear();
+    moov_.reset();
+    Reset();
+    ChangeState(kError);
+    return false;
+  }
+  return true;
+}
+
+bool MP4MediaParser::ReadNextChunk(bool* end_of_stream) {
+  DCHECK(random_access_file_);
+  DCHECK(end_of_stream);
+
+  *end_of_stream = false;
+  if (state_ == kError)
+    return false;
+
+  // The rest of the file is not read once all the tracks are past the time
+  // range.
+  if (has_time_range_ && AllTrackTimeRangesEnded()) {
+    *end_of_stream = true;
+    return true;
+  }
+
+  for (; runs_->IsRunValid(); runs_->AdvanceRun()) {
+    // Skip the entire run if it is not audio nor video or not selected.
+    if (!runs_->IsSampleValid() || (!runs_->is_audio() && !runs_->is_video()) ||
+        !IsTrackSelected(runs_->track_id())) {
+      continue;
+    }
+    if (has_time_range_ && track_time_ranges_.empty())
+      InitTrackTimeRanges();
+    TrackTimeRange* range = GetCurrentTrackTimeRange();
+    if (range && range->ended)
+      continue;
+
+    if (runs_->AuxInfoNeedsToBeCached()) {
+      std::vector<uint8_t> aux_info(runs_->aux_info_size());
+      if (!File::ReadAt(random_access_file_.get(), runs_->aux_info_offset(),
+                        aux_info.size(), aux_info.data()) ||
+          !runs_->CacheAuxInfo(aux_info.data(), aux_info.size())) {
+        LOG(ERROR) << "Error reading auxiliary info.";
+        ChangeState(kError);
+        return false;
+      }
+    }
+
+    if (range && !range->started) {
+      if (!SkipToTimeRangeStart(range)) {
+        ChangeState(kError);
+        return false;
+      }
+      // Nothing else is read if the track does not start in this run.
+      if (range->ended || !runs_->IsSampleValid())
+        continue;
+    }
+
+    // Only the key frames of video runs are read, one at a time.
+    if (video_key_frames_only_ && runs_->is_video()) {
+      for (; runs_->IsSampleValid(); runs_->AdvanceSample()) {
+        if (range && range->end > 0 && runs_->dts() >= range->end) {
+          range->ended = true;
+          break;
+        }
+        std::shared_ptr<uint8_t> sample_data;
+        if (runs_->is_keyframe()) {
+          sample_data.reset(new uint8_t[runs_->sample_size()],
+                            std::default_delete<uint8_t[]>());
+          if (!File::ReadAt(random_access_file_.get(), runs_->sample_offset(),
+                            runs_->sample_size(), sample_data.get())) {
+            LOG(ERROR) << "Error reading " << runs_->sample_size()
+                       << " bytes at offset " << runs_->sample_offset();
+            ChangeState(kError);
+            return false;
+          }
+        }
+        if (!EmitSample(sample_data.get(), sample_data)) {
+          ChangeState(kError);
+          return false;
+        }
+      }
+      runs_->AdvanceRun();
+      return true;
+    }
+
+    // The data of the samples of a run is contiguous, so the remaining
+    // samples of the run are read at once. The samples reference slices of
+    // the chunk data instead of copying them.
+    const int64_t chunk_offset = runs_->sample_offset();
+    const int64_t chunk_size = runs_->GetRunEndOffset() - chunk_offset;
+    std::shared_ptr<uint8_t> chunk_data(new uint8_t[chunk_size],
+                                        std::default_delete<uint8_t[]>());
+    if (!File::ReadAt(random_access_file_.get(), chunk_offset, chunk_size,
+                      chunk_data.get())) {
+      LOG(ERROR) << "Error reading " << chunk_size << " bytes at offset "
+                 << chunk_offset;
+      ChangeState(kError);
+      return false;
+    }
+    for (; runs_->IsSampleValid(); runs_->AdvanceSample()) {
+      if (range && range->end > 0 && runs_->dts() >= range->end) {
+        range->ended = true;
+        break;
+      }
+      const int64_t offset_in_chunk = runs_->sample_offset() - chunk_offset;
+      std::shared_ptr<const uint8_t> sample_data(
+          chunk_data, chunk_data.get() + offset_in_chunk);
+      if (!EmitSample(sample_data.get(), sample_data)) {
+        ChangeState(kError);
+        return false;
+      }
+    }
+    runs_->AdvanceRun();
+    return true;
+  }
+
+  if (runs_->sample_table_error()) {
+    LOG(ERROR) << "Error reading sample tables.";
+    ChangeState(kError);
+    return false;
+  }
+  if (has_time_range_ && !EmitPendingLeadIns()) {
+    ChangeState(kError);
+    return false;
+  }
+  *end_of_stream = true;
+  return true;
+}
+
+void MP4MediaParser::SetSelectedTracks(const std::set<uint32_t>& track_ids) {
+  all_tracks_selected_ = false;
+  selected_track_ids_ = track_ids;
+}
+
+bool MP4MediaParser::DeferDecryption() {
+  // The streams and samples are left encrypted without |decryptor_source_|.
+  decryptor_source_.reset();
+  return true;
+}
+
+bool MP4MediaParser::SetVideoKeyFramesOnly() {
+  video_key_frames_only_ = true;
+  return true;
+}
+
+bool MP4MediaParser::SetTimeRange(double start_seconds, double end_seconds) {
+  if (!random_access_file_)
+    return false;
+  has_time_range_ = true;
+  start_seconds_ = start_seconds;
+  end_seconds_ = end_seconds;
+  return true;
+}
+
+bool MP4MediaParser::IsTrackSelected(uint32_t track_id) const {
+  return all_tracks_selected_ || selected_track_ids_.count(track_id) > 0;
+}
+
 bool MP4MediaParser::ParseBox(bool* err) {
   const uint8_t* buf;
   int size;
@@ -737,7 +969,12 @@ bool MP4MediaParser::ParseMoov(BoxReader* reader) {
   if (!FetchKeysIfNecessary(moov_->pssh))
     return false;
   runs_.reset(new TrackRunIterator(moov_.get()));
-  RCHECK(runs_->Init());
+  if (random_access_file_) {
+    RCHECK(runs_->InitStreaming(random_access_file_.get(),
+                                random_access_sample_tables_));
+  } else {
+    RCHECK(runs_->Init());
+  }
   ChangeState(kEmittingSamples);
   return true;
 }
@@ -795,6 +1032,13 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
     return true;
   }
 
+  // Skip the entire run if its track is not selected. Its data is discarded
+  // with the 'mdat' data that is not needed anymore.
+  if (!IsTrackSelected(runs_->track_id())) {
+    runs_->AdvanceRun();
+    return true;
+  }
+
   DCHECK(!(*err));
 
   const uint8_t* buf;
@@ -833,26 +1077,70 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
     return false;
   }
 
-  const uint8_t* media_data = buf;
-  const size_t media_data_size = runs_->sample_size();
+  if (!EmitSample(buf, nullptr)) {
+    *err = true;
+    return false;
+  }
+  runs_->AdvanceSample();
+  return true;
+}
+
+bool MP4MediaParser::EmitSample(
+    const uint8_t* media_data,
+    std::shared_ptr<const uint8_t> shared_media_data) {
+  return EmitSample(GetCurrentSampleInfo(), media_data,
+                    std::move(shared_media_data));
+}
+
+bool MP4MediaParser::EmitSample(
+    SampleInfo info,
+    const uint8_t* media_data,
+    std::shared_ptr<const uint8_t> shared_media_data) {
+  const bool key_frames_only = video_key_frames_only_ && info.is_video;
+  if (key_frames_only) {
+    auto pending = pending_key_frames_.find(info.track_id);
+    if (!info.is_keyframe) {
+      // The dropped frame is covered by the previous key frame, if any.
+      if (pending != pending_key_frames_.end()) {
+        pending->second->set_duration(pending->second->duration() +
+                                      info.duration);
+      }
+      return true;
+    }
+    if (pending != pending_key_frames_.end()) {
+      std::shared_ptr<MediaSample> key_frame = std::move(pending->second);
+      pending_key_frames_.erase(pending);
+      if (!new_sample_cb_.Run(info.track_id, key_frame)) {
+        LOG(ERROR) << "Failed to process the sample.";
+        return false;
+      }
+    }
+  }
+
+  const size_t media_data_size = info.size;
   // Use a dummy data size of 0 to avoid copying overhead.
   // Actual media data is set later.
   const size_t kDummyDataSize = 0;
   std::shared_ptr<MediaSample> stream_sample(
-      MediaSample::CopyFrom(media_data, kDummyDataSize, runs_->is_keyframe()));
+      MediaSample::CopyFrom(media_data, kDummyDataSize, info.is_keyframe));
 
-  if (runs_->is_encrypted()) {
+  if (info.is_encrypted) {
     std::shared_ptr<uint8_t> decrypted_media_data(
         new uint8_t[media_data_size], std::default_delete<uint8_t[]>());
-    std::unique_ptr<DecryptConfig> decrypt_config = runs_->GetDecryptConfig();
+    std::unique_ptr<DecryptConfig> decrypt_config =
+        std::move(info.decrypt_config);
     if (!decrypt_config) {
-      *err = true;
       LOG(ERROR) << "Missing decrypt config.";
       return false;
     }
 
     if (!decryptor_source_) {
-      stream_sample->SetData(media_data, media_data_size);
+      if (shared_media_data) {
+        stream_sample->TransferData(std::move(shared_media_data),
+                                    media_data_size);
+      } else {
+        stream_sample->SetData(media_data, media_data_size);
+      }
       // If the demuxer does not have the decryptor_source_, store
       // decrypt_config so that the demuxed sample can be decrypted later.
       stream_sample->set_decrypt_config(std::move(decrypt_config));
@@ -861,38 +1149,172 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
       if (!decryptor_source_->DecryptSampleBuffer(decrypt_config.get(),
                                                   media_data, media_data_size,
                                                   decrypted_media_data.get())) {
-        *err = true;
         LOG(ERROR) << "Cannot decrypt samples.";
         return false;
       }
       stream_sample->TransferData(std::move(decrypted_media_data),
                                   media_data_size);
     }
+  } else if (shared_media_data) {
+    stream_sample->TransferData(std::move(shared_media_data), media_data_size);
   } else {
     stream_sample->SetData(media_data, media_data_size);
   }
 
-  stream_sample->set_dts(runs_->dts());
-  stream_sample->set_pts(runs_->cts());
-  stream_sample->set_duration(runs_->duration());
+  stream_sample->set_dts(info.dts);
+  stream_sample->set_pts(info.cts);
+  stream_sample->set_duration(info.duration);
 
   DVLOG(3) << "Pushing frame: "
-           << ", key=" << runs_->is_keyframe()
-           << ", dur=" << runs_->duration()
-           << ", dts=" << runs_->dts()
-           << ", cts=" << runs_->cts()
-           << ", size=" << runs_->sample_size();
-
-  if (!new_sample_cb_.Run(runs_->track_id(), stream_sample)) {
-    *err = true;
+           << ", key=" << info.is_keyframe
+           << ", dur=" << info.duration
+           << ", dts=" << info.dts
+           << ", cts=" << info.cts
+           << ", size=" << info.size;
+
+  if (key_frames_only) {
+    pending_key_frames_[info.track_id] = std::move(stream_sample);
+    return true;
+  }
+  if (!new_sample_cb_.Run(info.track_id, stream_sample)) {
     LOG(ERROR) << "Failed to process the sample.";
     return false;
   }
+  return true;
+}
 
-  runs_->AdvanceSample();
+bool MP4MediaParser::EmitPendingKeyFrames() {
+  for (auto& pending : pending_key_frames_) {
+    if (!new_sample_cb_.Run(pending.first, pending.second)) {
+      LOG(ERROR) << "Failed to process the sample.";
+      return false;
+    }
+  }
+  pending_key_frames_.clear();
   return true;
 }
 
+MP4MediaParser::SampleInfo MP4MediaParser::GetCurrentSampleInfo() {
+  SampleInfo info;
+  info.track_id = runs_->track_id();
+  info.is_video = runs_->is_video();
+  info.is_keyframe = runs_->is_keyframe();
+  info.is_encrypted = runs_->is_encrypted();
+  info.offset = runs_->sample_offset();
+  info.size = runs_->sample_size();
+  info.dts = runs_->dts();
+  info.cts = runs_->cts();
+  info.duration = runs_->duration();
+  if (info.is_encrypted)
+    info.decrypt_config = runs_->GetDecryptConfig();
+  return info;
+}
+
+void MP4MediaParser::InitTrackTimeRanges() {
+  double first_timestamp_seconds = 0;
+  for (const Track& track : moov_->tracks) {
+    if (track.header.track_id == runs_->track_id()) {
+      first_timestamp_seconds = static_cast<double>(runs_->cts()) /
+                                track.media.header.timescale;
+      break;
+    }
+  }
+  for (const Track& track : moov_->tracks) {
+    const TrackType type =
+        track.media.information.sample_table.description.type;
+    if ((type != kAudio && type != kVideo) ||
+        !IsTrackSelected(track.header.track_id)) {
+      continue;
+    }
+    const uint32_t timescale = track.media.header.timescale;
+    TrackTimeRange& range = track_time_ranges_[track.header.track_id];
+    range.start = static_cast<int64_t>(
+        (first_timestamp_seconds + start_seconds_) * timescale);
+    if (end_seconds_ > 0) {
+      range.end = static_cast<int64_t>(
+          (first_timestamp_seconds + end_seconds_) * timescale);
+    }
+  }
+}
+
+MP4MediaParser::TrackTimeRange* MP4MediaParser::GetCurrentTrackTimeRange() {
+  if (!has_time_range_)
+    return nullptr;
+  auto iter = track_time_ranges_.find(runs_->track_id());
+  return iter == track_time_ranges_.end() ? nullptr : &iter->second;
+}
+
+bool MP4MediaParser::SkipToTimeRangeStart(TrackTimeRange* range) {
+  for (; runs_->IsSampleValid(); runs_->AdvanceSample()) {
+    // The track starts at the last sync sample at or before |range->start|,
+    // which is only known once the next sync sample is after it.
+    if (runs_->is_keyframe() && runs_->cts() > range->start) {
+      range->started = true;
+      return EmitLeadIn(range);
+    }
+    if (runs_->is_keyframe()) {
+      range->lead_in.clear();
+    } else if (range->lead_in.empty()) {
+      // Cannot be decoded without a preceding sync sample.
+      continue;
+    }
+    range->lead_in.push_back(GetCurrentSampleInfo());
+  }
+  return true;
+}
+
+bool MP4MediaParser::EmitLeadIn(TrackTimeRange* range) {
+  for (SampleInfo& info : range->lead_in) {
+    if (range->end > 0 && info.dts >= range->end) {
+      range->ended = true;
+      break;
+    }
+    std::shared_ptr<uint8_t> sample_data;
+    // Only the duration of the dropped frames is needed.
+    if (!video_key_frames_only_ || !info.is_video || info.is_keyframe) {
+      sample_data.reset(new uint8_t[info.size],
+                        std::default_delete<uint8_t[]>());
+      if (!File::ReadAt(random_access_file_.get(), info.offset, info.size,
+                        sample_data.get())) {
+        LOG(ERROR) << "Error reading " << info.size << " bytes at offset "
+                   << info.offset;
+        return false;
+      }
+    }
+    const uint8_t* media_data = sample_data.get();
+    if (!EmitSample(std::move(info), media_data, std::move(sample_data)))
+      return false;
+  }
+  range->lead_in.clear();
+  return true;
+}
+
+bool MP4MediaParser::EmitPendingLeadIns() {
+  for (auto& pair : track_time_ranges_) {
+    TrackTimeRange& range = pair.second;
+    if (range.started || range.lead_in.empty())
+      continue;
+    const SampleInfo& last = range.lead_in.back();
+    range.started = true;
+    if (last.cts + last.duration <= range.start) {
+      // The track ends before the time range.
+      range.lead_in.clear();
+      continue;
+    }
+    if (!EmitLeadIn(&range))
+      return false;
+  }
+  return true;
+}
+
+bool MP4MediaParser::AllTrackTimeRangesEnded() const {
+  for (const auto& pair : track_time_ranges_) {
+    if (!pair.second.ended)
+      return false;
+  }
+  return !track_time_ranges_.empty();
+}
+
 bool MP4MediaParser::ReadAndDiscardMDATsUntil(const int64_t offset) {
   bool err = false;
   while (mdat_tail_ < offset) {
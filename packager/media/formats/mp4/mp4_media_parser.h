@@ -11,12 +11,15 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <vector>
 
 #include "packager/base/callback_forward.h"
+#include "packager/file/file_closer.h"
 #include "packager/media/base/decryptor_source.h"
 #include "packager/media/base/media_parser.h"
 #include "packager/media/base/offset_byte_queue.h"
+#include "packager/media/formats/mp4/sample_table_reader.h"
 
 namespace shaka {
 namespace media {
@@ -40,8 +43,16 @@ class MP4MediaParser : public MediaParser {
             KeySource* decryption_key_source) override;
   bool Flush() override WARN_UNUSED_RESULT;
   bool Parse(const uint8_t* buf, int size) override WARN_UNUSED_RESULT;
+  void SetSelectedTracks(const std::set<uint32_t>& track_ids) override;
+  bool DeferDecryption() override;
+  bool SetVideoKeyFramesOnly() override;
   /// @}
 
+  /// Only supported with random access reads. The sample tables are scanned
+  /// up to the sync sample each stream starts at, and its data is read from
+  /// there, so the data before the time range is never read.
+  bool SetTimeRange(double start_seconds, double end_seconds) override;
+
   /// Handles ISO-BMFF containers which have the 'moov' box trailing the
   /// movie data ('mdat'). It does this by doing a sparse parse of the file
   /// to locate the 'moov' box, and parsing its contents if it is found to be
@@ -50,6 +61,23 @@ class MP4MediaParser : public MediaParser {
   /// @return true if successful, false otherwise.
   bool LoadMoov(const std::string& file_path);
 
+  /// Sets up random access reads of a non-fragmented ISO-BMFF file. The
+  /// 'moov' box is loaded wherever it is located, then the samples are read
+  /// at the offsets given by the sample tables, one read per chunk, instead of
+  /// parsing the file as a forward stream. The data of tracks that are not
+  /// selected is never read. Must be called after Init and instead of Parse.
+  /// @param file_path is the path to the media file to be read.
+  /// @return true if successful, false otherwise, e.g. if the file is
+  ///         fragmented. The file can still be parsed with Parse if it fails
+  ///         before the 'moov' box is parsed.
+  bool InitRandomAccess(const std::string& file_path) override;
+
+  /// Reads and emits the samples of the next chunk of a selected track. Only
+  /// valid after InitRandomAccess succeeds.
+  /// @param[out] end_of_stream is set to true if all the samples are read.
+  /// @return true if successful, false otherwise.
+  bool ReadNextChunk(bool* end_of_stream) override WARN_UNUSED_RESULT;
+
  private:
   enum State {
     kWaitingForInit,
@@ -58,6 +86,33 @@ class MP4MediaParser : public MediaParser {
     kError
   };
 
+  // Properties of a sample, taken from |runs_|.
+  struct SampleInfo {
+    uint32_t track_id = 0;
+    bool is_video = false;
+    bool is_keyframe = false;
+    bool is_encrypted = false;
+    int64_t offset = 0;
+    int size = 0;
+    int64_t dts = 0;
+    int64_t cts = 0;
+    int64_t duration = 0;
+    // Null if the sample is not encrypted.
+    std::unique_ptr<DecryptConfig> decrypt_config;
+  };
+
+  // The time range of a track, in the track's timescale.
+  struct TrackTimeRange {
+    int64_t start = 0;
+    // 0 if the track is not cut at the end.
+    int64_t end = 0;
+    bool started = false;
+    bool ended = false;
+    // The samples from the last sync sample before |start|, whose data is
+    // only read once the track is known to start there.
+    std::vector<SampleInfo> lead_in;
+  };
+
   bool ParseBox(bool* err);
   bool ParseMoov(mp4::BoxReader* reader);
   bool ParseMoof(mp4::BoxReader* reader);
@@ -79,6 +134,40 @@ class MP4MediaParser : public MediaParser {
 
   bool EnqueueSample(bool* err);
 
+  // Creates a sample from the current sample of |runs_| and emits it.
+  // |media_data| must point to the sample data. If |shared_media_data| is not
+  // null, it owns |media_data| and the sample references it instead of
+  // copying it, unless the sample is decrypted.
+  bool EmitSample(const uint8_t* media_data,
+                  std::shared_ptr<const uint8_t> shared_media_data);
+  // Same as above for the sample described by |info|.
+  bool EmitSample(SampleInfo info,
+                  const uint8_t* media_data,
+                  std::shared_ptr<const uint8_t> shared_media_data);
+
+  SampleInfo GetCurrentSampleInfo();
+
+  // Sets up |track_time_ranges_| for the selected tracks, relative to the
+  // timestamp of the current sample, which is the first sample read.
+  void InitTrackTimeRanges();
+  // @return the time range of the track of the current run, or null if the
+  //         track is not cut.
+  TrackTimeRange* GetCurrentTrackTimeRange();
+  // Advances |runs_| to the first sample the track starts at, or past the
+  // run, keeping the properties of the samples it may start with.
+  bool SkipToTimeRangeStart(TrackTimeRange* range);
+  // Reads and emits the samples held in the lead-in of |range|.
+  bool EmitLeadIn(TrackTimeRange* range);
+  // Emits the lead-ins of the tracks that did not start, which cover the
+  // start of the time range if the streams end right after it.
+  bool EmitPendingLeadIns();
+  bool AllTrackTimeRangesEnded() const;
+
+  bool IsTrackSelected(uint32_t track_id) const;
+
+  // Emits the key frames held in |pending_key_frames_|.
+  bool EmitPendingKeyFrames();
+
   void Reset();
 
   State state_;
@@ -102,6 +191,23 @@ class MP4MediaParser : public MediaParser {
   std::unique_ptr<Movie> moov_;
   std::unique_ptr<TrackRunIterator> runs_;
 
+  // Only set if the file is read with random access reads.
+  std::unique_ptr<File, FileCloser> random_access_file_;
+  std::map<uint32_t, SampleTableBoxLocations> random_access_sample_tables_;
+  bool all_tracks_selected_ = true;
+  std::set<uint32_t> selected_track_ids_;
+
+  bool video_key_frames_only_ = false;
+  // The last key frame of each video track, which is held until the next key
+  // frame so its duration covers the frames dropped in between.
+  std::map<uint32_t, std::shared_ptr<MediaSample>> pending_key_frames_;
+
+  bool has_time_range_ = false;
+  double start_seconds_ = 0;
+  double end_seconds_ = 0;
+  // Track id => time range of the selected audio and video tracks.
+  std::map<uint32_t, TrackTimeRange> track_time_ranges_;
+
   DISALLOW_COPY_AND_ASSIGN(MP4MediaParser);
 };
 
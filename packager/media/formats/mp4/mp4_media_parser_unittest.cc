@@ -4,6 +4,12 @@
 // license that can be found in the LICENSE file or at
 // https://developers.google.com/open-source/licenses/bsd
 
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -16,6 +22,8 @@
 #include "packager/media/formats/mp4/mp4_media_parser.h"
 #include "packager/media/test/test_data_util.h"
 
+DECLARE_uint64(mp4_sample_table_window_size);
+
 using ::testing::_;
 using ::testing::DoAll;
 using ::testing::Return;
@@ -53,6 +61,14 @@ class MP4MediaParserTest : public testing::Test {
   std::unique_ptr<MP4MediaParser> parser_;
   size_t num_streams_;
   size_t num_samples_;
+  std::set<uint32_t> sample_track_ids_;
+  std::map<uint32_t, std::vector<std::string>> samples_by_track_;
+  std::map<uint32_t, size_t> key_frames_by_track_;
+  std::map<uint32_t, int64_t> duration_by_track_;
+  std::map<uint32_t, std::vector<std::shared_ptr<MediaSample>>>
+      media_samples_by_track_;
+  // The track of the first sample emitted, or 0 if none.
+  uint32_t first_sample_track_id_ = 0;
 
   bool AppendData(const uint8_t* data, size_t length) {
     return parser_->Parse(data, static_cast<int>(length));
@@ -86,6 +102,14 @@ class MP4MediaParserTest : public testing::Test {
     DVLOG(2) << "Track Id: " << track_id << " "
              << sample->ToString();
     ++num_samples_;
+    if (first_sample_track_id_ == 0)
+      first_sample_track_id_ = track_id;
+    sample_track_ids_.insert(track_id);
+    samples_by_track_[track_id].push_back(sample->ToString());
+    if (sample->is_key_frame())
+      ++key_frames_by_track_[track_id];
+    duration_by_track_[track_id] += sample->duration();
+    media_samples_by_track_[track_id].push_back(sample);
     return true;
   }
 
@@ -108,6 +132,24 @@ class MP4MediaParserTest : public testing::Test {
     std::vector<uint8_t> buffer = ReadTestDataFile(filename);
     return AppendDataInPieces(buffer.data(), buffer.size(), append_bytes);
   }
+
+  bool ReadAllChunks() {
+    bool end_of_stream = false;
+    while (!end_of_stream) {
+      if (!parser_->ReadNextChunk(&end_of_stream))
+        return false;
+    }
+    return true;
+  }
+
+  bool ReadMP4FileWithRandomAccess(const std::string& filename) {
+    InitializeParser(NULL);
+    if (!parser_->InitRandomAccess(
+            GetTestDataFilePath(filename).AsUTF8Unsafe())) {
+      return false;
+    }
+    return ReadAllChunks();
+  }
 };
 
 TEST_F(MP4MediaParserTest, UnalignedAppend) {
@@ -240,6 +282,146 @@ TEST_F(MP4MediaParserTest, NON_FRAGMENTED_MP4) {
   EXPECT_EQ(201u, num_samples_);
 }
 
+TEST_F(MP4MediaParserTest, RandomAccessNonFragmented) {
+  EXPECT_TRUE(ReadMP4FileWithRandomAccess("bear-640x360.mp4"));
+  EXPECT_EQ(2u, num_streams_);
+  EXPECT_EQ(201u, num_samples_);
+}
+
+TEST_F(MP4MediaParserTest, RandomAccessTrailingMoov) {
+  EXPECT_TRUE(ReadMP4FileWithRandomAccess("bear-640x360-trailing-moov.mp4"));
+  EXPECT_EQ(2u, num_streams_);
+  EXPECT_EQ(201u, num_samples_);
+}
+
+TEST_F(MP4MediaParserTest, RandomAccessSmallSampleTableWindows) {
+  ASSERT_TRUE(ParseMP4File("bear-640x360.mp4", 512));
+  const std::map<uint32_t, std::vector<std::string>> expected_samples =
+      samples_by_track_;
+
+  // Read the sample table entries a few at a time.
+  const uint64_t window_size = FLAGS_mp4_sample_table_window_size;
+  FLAGS_mp4_sample_table_window_size = 20;
+  parser_.reset(new MP4MediaParser());
+  samples_by_track_.clear();
+  EXPECT_TRUE(ReadMP4FileWithRandomAccess("bear-640x360.mp4"));
+  FLAGS_mp4_sample_table_window_size = window_size;
+
+  EXPECT_EQ(201u, num_samples_);
+  EXPECT_EQ(expected_samples, samples_by_track_);
+}
+
+TEST_F(MP4MediaParserTest, RandomAccessSelectedTrack) {
+  InitializeParser(NULL);
+  ASSERT_TRUE(parser_->InitRandomAccess(
+      GetTestDataFilePath("bear-640x360.mp4").AsUTF8Unsafe()));
+  ASSERT_EQ(2u, num_streams_);
+  const uint32_t kSelectedTrackId = stream_map_.begin()->first;
+  parser_->SetSelectedTracks({kSelectedTrackId});
+  EXPECT_TRUE(ReadAllChunks());
+  EXPECT_GT(num_samples_, 0u);
+  EXPECT_LT(num_samples_, 201u);
+  EXPECT_EQ(std::set<uint32_t>({kSelectedTrackId}), sample_track_ids_);
+}
+
+TEST_F(MP4MediaParserTest, RandomAccessVideoKeyFramesOnly) {
+  ASSERT_TRUE(ReadMP4FileWithRandomAccess("bear-640x360.mp4"));
+  uint32_t video_track_id = 0;
+  uint32_t audio_track_id = 0;
+  for (const auto& stream : stream_map_) {
+    if (stream.second->stream_type() == kStreamVideo)
+      video_track_id = stream.first;
+    else
+      audio_track_id = stream.first;
+  }
+  ASSERT_NE(0u, video_track_id);
+  const std::map<uint32_t, size_t> expected_key_frames = key_frames_by_track_;
+  const std::map<uint32_t, int64_t> expected_durations = duration_by_track_;
+  const std::vector<std::string> expected_audio_samples =
+      samples_by_track_[audio_track_id];
+
+  parser_.reset(new MP4MediaParser());
+  samples_by_track_.clear();
+  key_frames_by_track_.clear();
+  duration_by_track_.clear();
+  InitializeParser(NULL);
+  ASSERT_TRUE(parser_->SetVideoKeyFramesOnly());
+  ASSERT_TRUE(parser_->InitRandomAccess(
+      GetTestDataFilePath("bear-640x360.mp4").AsUTF8Unsafe()));
+  ASSERT_TRUE(ReadAllChunks());
+  ASSERT_TRUE(parser_->Flush());
+
+  // Only the key frames of the video, which cover the whole duration.
+  EXPECT_EQ(expected_key_frames.at(video_track_id),
+            samples_by_track_[video_track_id].size());
+  EXPECT_EQ(expected_key_frames, key_frames_by_track_);
+  EXPECT_EQ(expected_durations, duration_by_track_);
+  EXPECT_EQ(expected_audio_samples, samples_by_track_[audio_track_id]);
+}
+
+TEST_F(MP4MediaParserTest, RandomAccessTimeRange) {
+  ASSERT_TRUE(ReadMP4FileWithRandomAccess("bear-640x360.mp4"));
+  const auto all_samples = media_samples_by_track_;
+  const auto all_sample_strings = samples_by_track_;
+  // The time range is relative to the timestamp of the first sample.
+  ASSERT_NE(0u, first_sample_track_id_);
+  const double first_timestamp_seconds =
+      static_cast<double>(all_samples.at(first_sample_track_id_)[0]->pts()) /
+      stream_map_[first_sample_track_id_]->time_scale();
+
+  const double kStartSeconds = 1.5;
+  const double kEndSeconds = 2.2;
+  parser_.reset(new MP4MediaParser());
+  samples_by_track_.clear();
+  media_samples_by_track_.clear();
+  InitializeParser(NULL);
+  EXPECT_FALSE(parser_->SetTimeRange(kStartSeconds, kEndSeconds));
+  ASSERT_TRUE(parser_->InitRandomAccess(
+      GetTestDataFilePath("bear-640x360.mp4").AsUTF8Unsafe()));
+  ASSERT_TRUE(parser_->SetTimeRange(kStartSeconds, kEndSeconds));
+  ASSERT_TRUE(ReadAllChunks());
+  ASSERT_TRUE(parser_->Flush());
+
+  for (const auto& track_samples : all_samples) {
+    const uint32_t track_id = track_samples.first;
+    const auto& samples = track_samples.second;
+    const uint32_t time_scale = stream_map_[track_id]->time_scale();
+    const int64_t start = static_cast<int64_t>(
+        (first_timestamp_seconds + kStartSeconds) * time_scale);
+    const int64_t end = static_cast<int64_t>(
+        (first_timestamp_seconds + kEndSeconds) * time_scale);
+    // From the last sync sample at or before the start, up to the first
+    // sample decoded at or after the end.
+    size_t first = 0;
+    for (size_t i = 0; i < samples.size(); ++i) {
+      if (samples[i]->is_key_frame() && samples[i]->pts() <= start)
+        first = i;
+    }
+    size_t last = first;
+    while (last < samples.size() && samples[last]->dts() < end)
+      ++last;
+    const std::vector<std::string>& sample_strings =
+        all_sample_strings.at(track_id);
+    const std::vector<std::string> expected_samples(
+        sample_strings.begin() + first, sample_strings.begin() + last);
+    EXPECT_LT(expected_samples.size(), samples.size());
+    EXPECT_EQ(expected_samples, samples_by_track_[track_id]);
+  }
+}
+
+TEST_F(MP4MediaParserTest, RandomAccessFragmentedNotSupported) {
+  InitializeParser(NULL);
+  EXPECT_FALSE(parser_->InitRandomAccess(
+      GetTestDataFilePath("bear-640x360-av_frag.mp4").AsUTF8Unsafe()));
+  EXPECT_EQ(0u, num_streams_);
+
+  // The file can still be parsed as a stream.
+  std::vector<uint8_t> buffer = ReadTestDataFile("bear-640x360-av_frag.mp4");
+  EXPECT_TRUE(AppendDataInPieces(buffer.data(), buffer.size(), 512));
+  EXPECT_EQ(2u, num_streams_);
+  EXPECT_EQ(201u, num_samples_);
+}
+
 TEST_F(MP4MediaParserTest, CencWithoutDecryptionSource) {
   EXPECT_TRUE(ParseMP4File("bear-640x360-v_frag-cenc-aux.mp4", 512));
   EXPECT_EQ(1u, num_streams_);
@@ -23,6 +23,7 @@
 #include "packager/media/event/muxer_listener.h"
 #include "packager/media/formats/mp4/box_definitions.h"
 #include "packager/media/formats/mp4/multi_segment_segmenter.h"
+#include "packager/media/formats/mp4/progressive_segmenter.h"
 #include "packager/media/formats/mp4/single_segment_segmenter.h"
 #include "packager/media/formats/ttml/ttml_generator.h"
 #include "packager/status_macros.h"
@@ -160,6 +161,20 @@ MP4Muxer::MP4Muxer(const MuxerOptions& options) : Muxer(options) {}
 MP4Muxer::~MP4Muxer() {}
 
 Status MP4Muxer::InitializeMuxer() {
+  const Mp4OutputParams& mp4_params = options().mp4_params;
+  // With a single stream, the init segment of live outputs can be written
+  // right away if the EditList offset is known in advance.
+  if (mp4_params.write_init_segment_early &&
+      !options().segment_template.empty() && streams().size() == 1) {
+    if (!edit_list_offset_) {
+      edit_list_offset_ = static_cast<int64_t>(
+          mp4_params.expected_edit_list_offset * streams()[0]->time_scale() +
+          0.5);
+      check_edit_list_offset_ = true;
+    }
+    to_be_initialized_ = false;
+    return DelayInitializeMuxer();
+  }
   // Muxer will be delay-initialized after seeing the first sample.
   to_be_initialized_ = true;
   return Status::OK;
@@ -191,6 +206,18 @@ Status MP4Muxer::AddMediaSample(size_t stream_id, const MediaSample& sample) {
     RETURN_IF_ERROR(UpdateEditListOffsetFromSample(sample));
     RETURN_IF_ERROR(DelayInitializeMuxer());
     to_be_initialized_ = false;
+  } else if (check_edit_list_offset_) {
+    check_edit_list_offset_ = false;
+    const int64_t expected_offset = edit_list_offset_.value();
+    edit_list_offset_.reset();
+    RETURN_IF_ERROR(UpdateEditListOffsetFromSample(sample));
+    LOG_IF(WARNING, edit_list_offset_.value() != expected_offset)
+        << "The EditList offset of '" << options().output_file_name << "' ("
+        << expected_offset << ") does not match the first sample, which needs "
+        << edit_list_offset_.value() << ". Adjust "
+        << "--mp4_expected_edit_list_offset.";
+    // The init segment has been written with the expected offset already.
+    edit_list_offset_ = expected_offset;
   }
   DCHECK(segmenter_);
   return segmenter_->AddSample(stream_id, sample);
@@ -295,7 +322,21 @@ Status MP4Muxer::DelayInitializeMuxer() {
     }
   }
 
-  if (options().segment_template.empty()) {
+  if (options().mp4_params.progressive) {
+    if (!options().segment_template.empty()) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Progressive MP4 output does not support segment "
+                    "templates.");
+    }
+    for (const auto& stream : streams()) {
+      if (stream->is_encrypted()) {
+        return Status(error::UNIMPLEMENTED,
+                      "Progressive MP4 output does not support encryption.");
+      }
+    }
+    segmenter_.reset(new ProgressiveSegmenter(options(), std::move(ftyp),
+                                              std::move(moov)));
+  } else if (options().segment_template.empty()) {
     segmenter_.reset(new SingleSegmentSegmenter(options(), std::move(ftyp),
                                                 std::move(moov)));
   } else {
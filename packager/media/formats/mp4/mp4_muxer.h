@@ -70,6 +70,9 @@ class MP4Muxer : public Muxer {
   // Assumes single stream (multiplexed a/v not supported yet).
   bool to_be_initialized_ = true;
   base::Optional<int64_t> edit_list_offset_;
+  // Whether |edit_list_offset_| was configured rather than derived from the
+  // first sample, and still needs to be checked against it.
+  bool check_edit_list_offset_ = false;
 
   std::unique_ptr<Segmenter> segmenter_;
 
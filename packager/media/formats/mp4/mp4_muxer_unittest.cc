@@ -0,0 +1,810 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp4/mp4_muxer.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <openssl/md5.h>
+#include <openssl/sha.h>
+
+#include "packager/base/files/file_path.h"
+#include "packager/base/files/file_util.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/file/file.h"
+#include "packager/file/memory_file.h"
+#include "packager/media/base/buffer_reader.h"
+#include "packager/media/base/media_handler_test_base.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/base/muxer_util.h"
+#include "packager/media/base/segment_digest.h"
+#include "packager/media/event/mock_muxer_listener.h"
+#include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/media/formats/mp4/box_reader.h"
+#include "packager/status_macros.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace mp4 {
+namespace {
+
+using ::testing::_;
+using ::testing::Invoke;
+
+const size_t kStreamIndex = 0;
+const bool kSubsegment = true;
+const bool kProgressive = true;
+const uint32_t kTimeScale = 1000;
+const int64_t kSampleDuration = 100;
+const int64_t kSegmentDuration = 1000;
+const size_t kNumSegments = 5;
+const size_t kSamplesPerSegment = kSegmentDuration / kSampleDuration;
+const size_t kNumSamples = kNumSegments * kSamplesPerSegment;
+
+const size_t kMaxSidxReferences = 2;
+
+const char kTempDir[] = "memory://temp";
+const char kInitSegmentName[] = "memory://init.mp4";
+const char kSegmentTemplate[] = "memory://segment_$Number$.m4s";
+const double kExpectedEditListOffsetInSeconds = 0.1;
+const uint64_t kReservedHeaderSize = 4096;
+
+struct TopLevelBox {
+  FourCC type;
+  size_t offset;
+  size_t size;
+};
+
+// Lists the top level boxes of |content|.
+std::vector<TopLevelBox> GetTopLevelBoxes(const std::string& content) {
+  std::vector<TopLevelBox> boxes;
+  BufferReader reader(reinterpret_cast<const uint8_t*>(content.data()),
+                      content.size());
+  while (reader.HasBytes(1)) {
+    TopLevelBox box;
+    box.offset = reader.pos();
+    uint32_t size = 0;
+    uint32_t type = 0;
+    uint64_t large_size = 0;
+    if (!reader.Read4(&size) || !reader.Read4(&type) ||
+        (size == 1 && !reader.Read8(&large_size))) {
+      ADD_FAILURE() << "Invalid box at offset " << box.offset;
+      break;
+    }
+    box.type = static_cast<FourCC>(type);
+    box.size = size == 1 ? large_size : size;
+    const size_t header_size = reader.pos() - box.offset;
+    if (box.size < header_size || !reader.SkipBytes(box.size - header_size)) {
+      ADD_FAILURE() << "Invalid box at offset " << box.offset;
+      break;
+    }
+    boxes.push_back(box);
+  }
+  return boxes;
+}
+
+// The samples have different sizes, and are filled with their index.
+std::vector<uint8_t> GetSampleData(size_t sample_index) {
+  return std::vector<uint8_t>(1 + sample_index % 8,
+                              static_cast<uint8_t>(sample_index));
+}
+
+std::vector<FourCC> GetTypes(const std::vector<TopLevelBox>& boxes) {
+  std::vector<FourCC> types;
+  for (const TopLevelBox& box : boxes)
+    types.push_back(box.type);
+  return types;
+}
+
+std::string ToLowerHex(const std::vector<uint8_t>& data) {
+  return base::ToLowerASCII(base::HexEncode(data.data(), data.size()));
+}
+
+}  // namespace
+
+class MP4MuxerTest : public MediaHandlerTestBase {
+ protected:
+  void TearDown() override { MemoryFile::DeleteAll(); }
+
+  MuxerOptions GetSingleSegmentOptions(const std::string& output_file_name) {
+    MuxerOptions options;
+    options.output_file_name = output_file_name;
+    options.temp_dir = kTempDir;
+    return options;
+  }
+
+  // Muxes |kNumSegments| segments of video, of |kSegmentDuration| each, with
+  // a muxer configured with |options|. Each segment is made of
+  // |num_fragments_per_segment| fragments.
+  Status Mux(const MuxerOptions& options,
+             size_t num_fragments_per_segment = 1) {
+    auto muxer = std::make_shared<MP4Muxer>(options);
+    if (muxer_listener_)
+      muxer->SetMuxerListener(std::move(muxer_listener_));
+    auto input = std::make_shared<FakeInputMediaHandler>();
+    RETURN_IF_ERROR(input->AddHandler(muxer));
+    RETURN_IF_ERROR(input->Initialize());
+    RETURN_IF_ERROR(input->Dispatch(StreamData::FromStreamInfo(
+        kStreamIndex, GetVideoStreamInfo(kTimeScale))));
+    const int64_t fragment_duration =
+        kSegmentDuration / num_fragments_per_segment;
+    size_t sample_index = 0;
+    for (size_t i = 0; i < kNumSegments; ++i) {
+      const int64_t segment_start = i * kSegmentDuration;
+      for (int64_t timestamp = segment_start;
+           timestamp < segment_start + kSegmentDuration;
+           timestamp += kSampleDuration) {
+        if (timestamp != segment_start &&
+            (timestamp - segment_start) % fragment_duration == 0) {
+          RETURN_IF_ERROR(input->Dispatch(StreamData::FromSegmentInfo(
+              kStreamIndex,
+              GetSegmentInfo(timestamp - fragment_duration, fragment_duration,
+                             kSubsegment))));
+        }
+        const std::vector<uint8_t> data = GetSampleData(sample_index++);
+        RETURN_IF_ERROR(input->Dispatch(StreamData::FromMediaSample(
+            kStreamIndex,
+            GetMediaSample(timestamp, kSampleDuration,
+                           timestamp == segment_start, data.data(),
+                           data.size()))));
+      }
+      RETURN_IF_ERROR(input->Dispatch(StreamData::FromSegmentInfo(
+          kStreamIndex,
+          GetSegmentInfo(segment_start, kSegmentDuration, !kSubsegment))));
+    }
+    return input->FlushAllDownstreams();
+  }
+
+  // Muxes the single segment output |output_file_name| and reads it into
+  // |content|.
+  void MuxSingleSegment(const std::string& output_file_name,
+                        uint64_t vod_header_reserved_size,
+                        bool progressive,
+                        std::string* content) {
+    MuxerOptions options = GetSingleSegmentOptions(output_file_name);
+    options.mp4_params.vod_header_reserved_size = vod_header_reserved_size;
+    options.mp4_params.progressive = progressive;
+    ASSERT_OK(Mux(options));
+    ASSERT_TRUE(File::ReadFileToString(output_file_name.c_str(), content));
+  }
+
+  MuxerOptions GetSegmentTemplateOptions(bool write_init_segment_early) {
+    MuxerOptions options;
+    options.output_file_name = kInitSegmentName;
+    options.segment_template = kSegmentTemplate;
+    options.mp4_params.write_init_segment_early = write_init_segment_early;
+    options.mp4_params.expected_edit_list_offset =
+        kExpectedEditListOffsetInSeconds;
+    return options;
+  }
+
+  // Parses the 'moov' box of the init segment |kInitSegmentName| into |moov|.
+  void ParseInitSegment(Movie* moov) {
+    std::string content;
+    ASSERT_TRUE(File::ReadFileToString(kInitSegmentName, &content));
+    const std::vector<TopLevelBox> boxes = GetTopLevelBoxes(content);
+    ASSERT_EQ(std::vector<FourCC>({FOURCC_ftyp, FOURCC_moov}),
+              GetTypes(boxes));
+    bool err = false;
+    std::unique_ptr<BoxReader> reader(BoxReader::ReadBox(
+        reinterpret_cast<const uint8_t*>(content.data()) + boxes[1].offset,
+        boxes[1].size, &err));
+    ASSERT_TRUE(reader);
+    ASSERT_TRUE(moov->Parse(reader.get()));
+    ASSERT_EQ(1u, moov->tracks.size());
+  }
+
+  // Parses the 'sidx' |box| of |content| into |sidx|.
+  void ParseSidx(const std::string& content,
+                 const TopLevelBox& box,
+                 SegmentIndex* sidx) {
+    ASSERT_EQ(FOURCC_sidx, box.type);
+    bool err = false;
+    std::unique_ptr<BoxReader> reader(BoxReader::ReadBox(
+        reinterpret_cast<const uint8_t*>(content.data()) + box.offset,
+        box.size, &err));
+    ASSERT_TRUE(reader);
+    ASSERT_TRUE(sidx->Parse(reader.get()));
+  }
+
+  // Muxes segments with |options| and checks that the MD5 and SHA-256
+  // digests of the segment files are reported to the listener and recorded in
+  // the digest file.
+  void MuxAndCheckSegmentDigests(MuxerOptions options,
+                                 size_t num_fragments_per_segment) {
+    const char kDigestFileName[] = "memory://digests.txt";
+    SegmentDigestFile digest_file(kDigestFileName);
+    ASSERT_OK(digest_file.Open());
+    options.segment_digests = {DigestAlgorithm::kMd5,
+                               DigestAlgorithm::kSha256};
+    options.segment_digest_file = &digest_file;
+
+    std::vector<std::string> reported_names;
+    std::vector<std::vector<SegmentDigest>> reported_digests;
+    std::unique_ptr<MockMuxerListener> listener(new MockMuxerListener());
+    EXPECT_CALL(*listener, OnSegmentDigests(_, _))
+        .Times(kNumSegments)
+        .WillRepeatedly(
+            Invoke([&](const std::string& segment_name,
+                       const std::vector<SegmentDigest>& digests) {
+              reported_names.push_back(segment_name);
+              reported_digests.push_back(digests);
+            }));
+    muxer_listener_ = std::move(listener);
+    ASSERT_OK(Mux(options, num_fragments_per_segment));
+    ASSERT_OK(digest_file.Close());
+
+    ASSERT_EQ(kNumSegments, reported_names.size());
+    std::string expected_records;
+    for (size_t i = 0; i < kNumSegments; ++i) {
+      const std::string segment_name = GetSegmentName(
+          options.segment_template, i * kSegmentDuration, i, 0);
+      std::string content;
+      ASSERT_TRUE(File::ReadFileToString(segment_name.c_str(), &content));
+      const uint8_t* data = reinterpret_cast<const uint8_t*>(content.data());
+      std::vector<uint8_t> md5(MD5_DIGEST_LENGTH);
+      MD5(data, content.size(), md5.data());
+      std::vector<uint8_t> sha256(SHA256_DIGEST_LENGTH);
+      SHA256(data, content.size(), sha256.data());
+
+      EXPECT_EQ(segment_name, reported_names[i]);
+      const std::vector<SegmentDigest>& digests = reported_digests[i];
+      ASSERT_EQ(2u, digests.size());
+      EXPECT_EQ(DigestAlgorithm::kMd5, digests[0].algorithm);
+      EXPECT_EQ(md5, digests[0].value) << segment_name;
+      EXPECT_EQ(DigestAlgorithm::kSha256, digests[1].algorithm);
+      EXPECT_EQ(sha256, digests[1].value) << segment_name;
+      expected_records += "md5:" + ToLowerHex(md5) + " sha256:" +
+                          ToLowerHex(sha256) + " " + segment_name + "\n";
+    }
+    std::string records;
+    ASSERT_TRUE(File::ReadFileToString(kDigestFileName, &records));
+    EXPECT_EQ(expected_records, records);
+  }
+
+  // Checks that the progressive file |content| has 'ftyp', 'moov', the
+  // optional 'free' box and 'mdat' at |expected_mdat_offset|, and that the
+  // sample tables index the samples in 'mdat'.
+  void VerifyProgressiveFile(const std::string& content,
+                             uint64_t expected_mdat_offset) {
+    const std::vector<TopLevelBox> boxes = GetTopLevelBoxes(content);
+    ASSERT_GE(boxes.size(), 3u);
+    EXPECT_EQ(FOURCC_ftyp, boxes[0].type);
+    EXPECT_EQ(FOURCC_moov, boxes[1].type);
+    const TopLevelBox& mdat = boxes.back();
+    EXPECT_EQ(FOURCC_mdat, mdat.type);
+    EXPECT_EQ(expected_mdat_offset, mdat.offset);
+    EXPECT_EQ(content.size(), mdat.offset + mdat.size);
+
+    bool err = false;
+    std::unique_ptr<BoxReader> reader(BoxReader::ReadBox(
+        reinterpret_cast<const uint8_t*>(content.data()) + boxes[1].offset,
+        boxes[1].size, &err));
+    ASSERT_TRUE(reader);
+    Movie moov;
+    ASSERT_TRUE(moov.Parse(reader.get()));
+    EXPECT_TRUE(moov.extends.tracks.empty());
+    ASSERT_EQ(1u, moov.tracks.size());
+    EXPECT_EQ(static_cast<uint64_t>(kNumSegments * kSegmentDuration),
+              moov.tracks[0].media.header.duration);
+    const SampleTable& sample_table =
+        moov.tracks[0].media.information.sample_table;
+
+    const std::vector<DecodingTime>& decoding_times =
+        sample_table.decoding_time_to_sample.decoding_time;
+    ASSERT_EQ(1u, decoding_times.size());
+    EXPECT_EQ(kNumSamples, decoding_times[0].sample_count);
+    EXPECT_EQ(static_cast<uint32_t>(kSampleDuration),
+              decoding_times[0].sample_delta);
+    EXPECT_TRUE(sample_table.composition_time_to_sample.composition_offset
+                    .empty());
+
+    std::vector<uint32_t> expected_sync_samples;
+    for (size_t i = 0; i < kNumSegments; ++i)
+      expected_sync_samples.push_back(1 + i * kSamplesPerSegment);
+    EXPECT_EQ(expected_sync_samples, sample_table.sync_sample.sample_number);
+
+    // A chunk per fragment, i.e. per segment.
+    const std::vector<ChunkInfo>& chunk_info =
+        sample_table.sample_to_chunk.chunk_info;
+    ASSERT_EQ(1u, chunk_info.size());
+    EXPECT_EQ(1u, chunk_info[0].first_chunk);
+    EXPECT_EQ(kSamplesPerSegment, chunk_info[0].samples_per_chunk);
+    const std::vector<uint64_t>& chunk_offsets =
+        sample_table.chunk_large_offset.offsets;
+    ASSERT_EQ(kNumSegments, chunk_offsets.size());
+    const std::vector<uint32_t>& sizes = sample_table.sample_size.sizes;
+    ASSERT_EQ(kNumSamples, sizes.size());
+
+    const uint64_t kMdatHeaderSize = 16;
+    uint64_t expected_chunk_offset = mdat.offset + kMdatHeaderSize;
+    for (size_t i = 0; i < kNumSamples; ++i) {
+      if (i % kSamplesPerSegment == 0) {
+        EXPECT_EQ(expected_chunk_offset, chunk_offsets[i / kSamplesPerSegment]);
+      }
+      const std::vector<uint8_t> data = GetSampleData(i);
+      ASSERT_EQ(data.size(), sizes[i]);
+      ASSERT_LE(expected_chunk_offset + sizes[i], content.size());
+      EXPECT_EQ(std::string(data.begin(), data.end()),
+                content.substr(expected_chunk_offset, sizes[i]))
+          << "sample " << i;
+      expected_chunk_offset += sizes[i];
+    }
+    EXPECT_EQ(content.size(), expected_chunk_offset);
+  }
+
+  // Set on the muxer of the next Mux() call if not null.
+  std::unique_ptr<MuxerListener> muxer_listener_;
+};
+
+TEST_F(MP4MuxerTest, SingleSegmentWithTempFile) {
+  std::string content;
+  ASSERT_NO_FATAL_FAILURE(
+      MuxSingleSegment("memory://output/temp_file.mp4", 0, !kProgressive,
+                       &content));
+
+  std::vector<FourCC> expected_types = {FOURCC_ftyp, FOURCC_moov, FOURCC_sidx};
+  for (size_t i = 0; i < kNumSegments; ++i) {
+    expected_types.push_back(FOURCC_moof);
+    expected_types.push_back(FOURCC_mdat);
+  }
+  EXPECT_EQ(expected_types, GetTypes(GetTopLevelBoxes(content)));
+}
+
+// The media is written after the reserved space, which the headers and a
+// 'free' box fill at the end.
+TEST_F(MP4MuxerTest, SingleSegmentInPlace) {
+  std::string temp_file_content;
+  ASSERT_NO_FATAL_FAILURE(MuxSingleSegment("memory://output/temp_file.mp4", 0,
+                                           !kProgressive, &temp_file_content));
+  std::string content;
+  ASSERT_NO_FATAL_FAILURE(MuxSingleSegment("memory://output/in_place.mp4",
+                                           kReservedHeaderSize, !kProgressive,
+                                           &content));
+
+  const std::vector<TopLevelBox> boxes = GetTopLevelBoxes(content);
+  ASSERT_GT(boxes.size(), 4u);
+  EXPECT_EQ(FOURCC_ftyp, boxes[0].type);
+  EXPECT_EQ(FOURCC_moov, boxes[1].type);
+  EXPECT_EQ(FOURCC_sidx, boxes[2].type);
+  EXPECT_EQ(FOURCC_free, boxes[3].type);
+  EXPECT_EQ(FOURCC_moof, boxes[4].type);
+  EXPECT_EQ(kReservedHeaderSize, boxes[4].offset);
+
+  // 'sidx' skips the 'free' box.
+  bool err = false;
+  std::unique_ptr<BoxReader> reader(BoxReader::ReadBox(
+      reinterpret_cast<const uint8_t*>(content.data()) + boxes[2].offset,
+      boxes[2].size, &err));
+  ASSERT_TRUE(reader);
+  SegmentIndex sidx;
+  ASSERT_TRUE(sidx.Parse(reader.get()));
+  EXPECT_EQ(boxes[3].size, sidx.first_offset);
+  EXPECT_EQ(kNumSegments, sidx.references.size());
+
+  // The media is the same as with a temporary file.
+  const std::vector<TopLevelBox> temp_file_boxes =
+      GetTopLevelBoxes(temp_file_content);
+  ASSERT_GT(temp_file_boxes.size(), 3u);
+  EXPECT_EQ(temp_file_content.substr(temp_file_boxes[3].offset),
+            content.substr(kReservedHeaderSize));
+}
+
+// The headers do not fit in the reserved space, so the media is moved to a
+// temporary file at the end.
+TEST_F(MP4MuxerTest, SingleSegmentInPlaceFallsBackToTempFile) {
+  std::string temp_file_content;
+  ASSERT_NO_FATAL_FAILURE(MuxSingleSegment("memory://output/temp_file.mp4", 0,
+                                           !kProgressive, &temp_file_content));
+  const std::vector<TopLevelBox> temp_file_boxes =
+      GetTopLevelBoxes(temp_file_content);
+  ASSERT_GT(temp_file_boxes.size(), 3u);
+  ASSERT_EQ(FOURCC_sidx, temp_file_boxes[2].type);
+  // Enough for 'ftyp' and 'moov' but not 'sidx'.
+  const uint64_t kInitSize = temp_file_boxes[2].offset;
+  const uint64_t kFreeBoxHeaderSize = 8;
+
+  std::string content;
+  ASSERT_NO_FATAL_FAILURE(MuxSingleSegment("memory://output/fallback.mp4",
+                                           kInitSize + kFreeBoxHeaderSize,
+                                           !kProgressive, &content));
+  const std::vector<TopLevelBox> boxes = GetTopLevelBoxes(content);
+  EXPECT_EQ(GetTypes(temp_file_boxes), GetTypes(boxes));
+  ASSERT_EQ(temp_file_boxes.size(), boxes.size());
+  EXPECT_EQ(temp_file_content.substr(temp_file_boxes[3].offset),
+            content.substr(boxes[3].offset));
+}
+
+// With more subsegments than |kMaxSidxReferences|, the top level 'sidx'
+// references subsidiary 'sidx' boxes, each followed by its subsegments.
+TEST_F(MP4MuxerTest, SingleSegmentWithSubsidiarySidx) {
+  std::string flat_content;
+  ASSERT_NO_FATAL_FAILURE(MuxSingleSegment("memory://output/flat.mp4", 0,
+                                           !kProgressive, &flat_content));
+  const std::vector<TopLevelBox> flat_boxes = GetTopLevelBoxes(flat_content);
+  ASSERT_GT(flat_boxes.size(), 3u);
+
+  MuxerOptions options =
+      GetSingleSegmentOptions("memory://output/hierarchy.mp4");
+  options.mp4_params.max_sidx_references = kMaxSidxReferences;
+  ASSERT_OK(Mux(options));
+  std::string content;
+  ASSERT_TRUE(File::ReadFileToString(options.output_file_name.c_str(),
+                                     &content));
+  const std::vector<TopLevelBox> boxes = GetTopLevelBoxes(content);
+
+  const size_t kNumSubsidiarySidxes =
+      (kNumSegments + kMaxSidxReferences - 1) / kMaxSidxReferences;
+  std::vector<FourCC> expected_types = {FOURCC_ftyp, FOURCC_moov, FOURCC_sidx};
+  for (size_t i = 0; i < kNumSegments; ++i) {
+    if (i % kMaxSidxReferences == 0)
+      expected_types.push_back(FOURCC_sidx);
+    expected_types.push_back(FOURCC_moof);
+    expected_types.push_back(FOURCC_mdat);
+  }
+  ASSERT_EQ(expected_types, GetTypes(boxes));
+
+  SegmentIndex top_sidx;
+  ASSERT_NO_FATAL_FAILURE(ParseSidx(content, boxes[2], &top_sidx));
+  EXPECT_EQ(0u, top_sidx.first_offset);
+  ASSERT_EQ(kNumSubsidiarySidxes, top_sidx.references.size());
+
+  size_t box_index = 3;
+  uint64_t earliest_presentation_time = 0;
+  for (const SegmentReference& sidx_reference : top_sidx.references) {
+    EXPECT_TRUE(sidx_reference.reference_type);
+    EXPECT_EQ(earliest_presentation_time,
+              sidx_reference.earliest_presentation_time);
+    const size_t sidx_offset = boxes[box_index].offset;
+
+    SegmentIndex sidx;
+    ASSERT_NO_FATAL_FAILURE(ParseSidx(content, boxes[box_index++], &sidx));
+    EXPECT_EQ(0u, sidx.first_offset);
+    EXPECT_EQ(earliest_presentation_time, sidx.earliest_presentation_time);
+    ASSERT_LE(sidx.references.size(), kMaxSidxReferences);
+    uint64_t duration = 0;
+    for (const SegmentReference& reference : sidx.references) {
+      EXPECT_FALSE(reference.reference_type);
+      EXPECT_EQ(boxes[box_index].size + boxes[box_index + 1].size,
+                reference.referenced_size);
+      EXPECT_EQ(static_cast<uint32_t>(kSegmentDuration),
+                reference.subsegment_duration);
+      duration += reference.subsegment_duration;
+      box_index += 2;
+    }
+    const size_t end_offset = box_index < boxes.size()
+                                  ? boxes[box_index].offset
+                                  : content.size();
+    EXPECT_EQ(end_offset - sidx_offset, sidx_reference.referenced_size);
+    EXPECT_EQ(duration, sidx_reference.subsegment_duration);
+    earliest_presentation_time += duration;
+  }
+  EXPECT_EQ(boxes.size(), box_index);
+
+  // The subsegments are the same as without subsidiary 'sidx' boxes.
+  std::string media;
+  for (const TopLevelBox& box : boxes) {
+    if (box.type == FOURCC_moof || box.type == FOURCC_mdat)
+      media += content.substr(box.offset, box.size);
+  }
+  EXPECT_EQ(flat_content.substr(flat_boxes[3].offset), media);
+}
+
+// A reserved header size is ignored with subsidiary 'sidx' boxes, which are
+// interleaved with the media.
+TEST_F(MP4MuxerTest, SingleSegmentInPlaceWithSubsidiarySidx) {
+  MuxerOptions options =
+      GetSingleSegmentOptions("memory://output/temp_file.mp4");
+  options.mp4_params.max_sidx_references = kMaxSidxReferences;
+  ASSERT_OK(Mux(options));
+  std::string temp_file_content;
+  ASSERT_TRUE(File::ReadFileToString(options.output_file_name.c_str(),
+                                     &temp_file_content));
+
+  options.output_file_name = "memory://output/in_place.mp4";
+  options.mp4_params.vod_header_reserved_size = kReservedHeaderSize;
+  ASSERT_OK(Mux(options));
+  std::string content;
+  ASSERT_TRUE(File::ReadFileToString(options.output_file_name.c_str(),
+                                     &content));
+  const std::vector<TopLevelBox> temp_file_boxes =
+      GetTopLevelBoxes(temp_file_content);
+  const std::vector<TopLevelBox> boxes = GetTopLevelBoxes(content);
+  EXPECT_EQ(GetTypes(temp_file_boxes), GetTypes(boxes));
+  ASSERT_GT(boxes.size(), 3u);
+  ASSERT_EQ(temp_file_boxes.size(), boxes.size());
+  EXPECT_EQ(temp_file_content.substr(temp_file_boxes[2].offset),
+            content.substr(boxes[2].offset));
+}
+
+// No hierarchy without 'sidx' in the media segments.
+TEST_F(MP4MuxerTest, NoSubsidiarySidxWithoutSidx) {
+  MuxerOptions options = GetSingleSegmentOptions("memory://output/no_sidx.mp4");
+  options.mp4_params.max_sidx_references = kMaxSidxReferences;
+  options.mp4_params.generate_sidx_in_media_segments = false;
+  ASSERT_OK(Mux(options));
+  std::string content;
+  ASSERT_TRUE(File::ReadFileToString(options.output_file_name.c_str(),
+                                     &content));
+
+  std::vector<FourCC> expected_types = {FOURCC_ftyp, FOURCC_moov};
+  for (size_t i = 0; i < kNumSegments; ++i) {
+    expected_types.push_back(FOURCC_moof);
+    expected_types.push_back(FOURCC_mdat);
+  }
+  EXPECT_EQ(expected_types, GetTypes(GetTopLevelBoxes(content)));
+}
+
+// A segment written in chunks is the same as a segment written at once,
+// without 'sidx', which would have to precede the chunks.
+TEST_F(MP4MuxerTest, ChunkedSegments) {
+  const size_t kNumFragmentsPerSegment = 2;
+  const char kWholeSegmentTemplate[] = "memory://whole/segment_$Number$.m4s";
+  const char kChunkedSegmentTemplate[] =
+      "memory://chunked/segment_$Number$.m4s";
+
+  MuxerOptions options = GetSegmentTemplateOptions(false);
+  options.segment_template = kWholeSegmentTemplate;
+  ASSERT_OK(Mux(options, kNumFragmentsPerSegment));
+  options.segment_template = kChunkedSegmentTemplate;
+  options.write_chunked_segments = true;
+  ASSERT_OK(Mux(options, kNumFragmentsPerSegment));
+
+  std::vector<FourCC> expected_types = {FOURCC_styp};
+  for (size_t i = 0; i < kNumFragmentsPerSegment; ++i) {
+    expected_types.push_back(FOURCC_moof);
+    expected_types.push_back(FOURCC_mdat);
+  }
+  for (size_t i = 0; i < kNumSegments; ++i) {
+    const uint64_t segment_start = i * kSegmentDuration;
+    std::string whole_content;
+    ASSERT_TRUE(File::ReadFileToString(
+        GetSegmentName(kWholeSegmentTemplate, segment_start, i, 0).c_str(),
+        &whole_content));
+    std::string content;
+    ASSERT_TRUE(File::ReadFileToString(
+        GetSegmentName(kChunkedSegmentTemplate, segment_start, i, 0).c_str(),
+        &content));
+
+    const std::vector<TopLevelBox> whole_boxes =
+        GetTopLevelBoxes(whole_content);
+    ASSERT_EQ(2 + 2 * kNumFragmentsPerSegment, whole_boxes.size());
+    EXPECT_EQ(FOURCC_sidx, whole_boxes[1].type);
+    const std::vector<TopLevelBox> boxes = GetTopLevelBoxes(content);
+    ASSERT_EQ(expected_types, GetTypes(boxes)) << "segment " << i;
+    EXPECT_EQ(whole_content.substr(0, whole_boxes[0].size),
+              content.substr(0, boxes[0].size));
+    EXPECT_EQ(whole_content.substr(whole_boxes[2].offset),
+              content.substr(boxes[1].offset));
+  }
+}
+
+// Every fragment is appended to the segment file, and flushed, as soon as it
+// is finalized. A local file is used as a memory file cannot be read while it
+// is open.
+TEST_F(MP4MuxerTest, ChunkedSegmentWrittenPerFragment) {
+  base::FilePath temp_dir;
+  ASSERT_TRUE(base::CreateNewTempDirectory(base::FilePath::StringType(),
+                                           &temp_dir));
+  const std::string segment_template =
+      temp_dir.AppendASCII("segment_$Number$.m4s").AsUTF8Unsafe();
+
+  MuxerOptions options = GetSegmentTemplateOptions(false);
+  options.segment_template = segment_template;
+  options.write_chunked_segments = true;
+  auto muxer = std::make_shared<MP4Muxer>(options);
+  auto input = std::make_shared<FakeInputMediaHandler>();
+  ASSERT_OK(input->AddHandler(muxer));
+  ASSERT_OK(input->Initialize());
+  ASSERT_OK(input->Dispatch(StreamData::FromStreamInfo(
+      kStreamIndex, GetVideoStreamInfo(kTimeScale))));
+
+  const std::string segment_name = GetSegmentName(segment_template, 0, 0, 0);
+  const int64_t kFragmentDuration = kSegmentDuration / 2;
+  size_t sample_index = 0;
+  for (int64_t timestamp = 0; timestamp < kSegmentDuration;
+       timestamp += kSampleDuration) {
+    if (timestamp == kFragmentDuration) {
+      std::string content;
+      EXPECT_FALSE(File::ReadFileToString(segment_name.c_str(), &content));
+      ASSERT_OK(input->Dispatch(StreamData::FromSegmentInfo(
+          kStreamIndex, GetSegmentInfo(0, kFragmentDuration, kSubsegment))));
+      // The first chunk is out before the end of the segment.
+      ASSERT_TRUE(File::ReadFileToString(segment_name.c_str(), &content));
+      EXPECT_EQ(std::vector<FourCC>({FOURCC_styp, FOURCC_moof, FOURCC_mdat}),
+                GetTypes(GetTopLevelBoxes(content)));
+    }
+    const std::vector<uint8_t> data = GetSampleData(sample_index++);
+    ASSERT_OK(input->Dispatch(StreamData::FromMediaSample(
+        kStreamIndex, GetMediaSample(timestamp, kSampleDuration,
+                                     timestamp == 0, data.data(),
+                                     data.size()))));
+  }
+  ASSERT_OK(input->Dispatch(StreamData::FromSegmentInfo(
+      kStreamIndex, GetSegmentInfo(0, kSegmentDuration, !kSubsegment))));
+
+  std::string content;
+  ASSERT_TRUE(File::ReadFileToString(segment_name.c_str(), &content));
+  EXPECT_EQ(std::vector<FourCC>({FOURCC_styp, FOURCC_moof, FOURCC_mdat,
+                                 FOURCC_moof, FOURCC_mdat}),
+            GetTypes(GetTopLevelBoxes(content)));
+  ASSERT_OK(input->FlushAllDownstreams());
+  base::DeleteFile(temp_dir, true);
+}
+
+// The partial segments of the segment left unfinished are deleted when the
+// muxing is aborted, those of the finished segments are kept.
+TEST_F(MP4MuxerTest, PartialSegmentsDeletedOnAbort) {
+  MuxerOptions options = GetSegmentTemplateOptions(false);
+  options.write_partial_segments = true;
+  auto muxer = std::make_shared<MP4Muxer>(options);
+  auto input = std::make_shared<FakeInputMediaHandler>();
+  ASSERT_OK(input->AddHandler(muxer));
+  ASSERT_OK(input->Initialize());
+  ASSERT_OK(input->Dispatch(StreamData::FromStreamInfo(
+      kStreamIndex, GetVideoStreamInfo(kTimeScale))));
+
+  // A segment of two fragments, then the first fragment of the next one.
+  const int64_t kFragmentDuration = kSegmentDuration / 2;
+  size_t sample_index = 0;
+  for (int64_t timestamp = 0; timestamp < kSegmentDuration + kFragmentDuration;
+       timestamp += kSampleDuration) {
+    if (timestamp == kFragmentDuration) {
+      ASSERT_OK(input->Dispatch(StreamData::FromSegmentInfo(
+          kStreamIndex, GetSegmentInfo(0, kFragmentDuration, kSubsegment))));
+    } else if (timestamp == kSegmentDuration) {
+      ASSERT_OK(input->Dispatch(StreamData::FromSegmentInfo(
+          kStreamIndex, GetSegmentInfo(0, kSegmentDuration, !kSubsegment))));
+    }
+    const std::vector<uint8_t> data = GetSampleData(sample_index++);
+    ASSERT_OK(input->Dispatch(StreamData::FromMediaSample(
+        kStreamIndex,
+        GetMediaSample(timestamp, kSampleDuration,
+                       timestamp % kSegmentDuration == 0, data.data(),
+                       data.size()))));
+  }
+  ASSERT_OK(input->Dispatch(StreamData::FromSegmentInfo(
+      kStreamIndex,
+      GetSegmentInfo(kSegmentDuration, kFragmentDuration, kSubsegment))));
+
+  const std::string first_segment_name =
+      GetSegmentName(kSegmentTemplate, 0, 0, 0);
+  const std::vector<std::string> kept_file_names = {
+      first_segment_name, GetPartialSegmentName(first_segment_name, 0),
+      GetPartialSegmentName(first_segment_name, 1)};
+  const std::string unfinished_file_name = GetPartialSegmentName(
+      GetSegmentName(kSegmentTemplate, kSegmentDuration, 1, 0), 0);
+  std::string content;
+  ASSERT_TRUE(
+      File::ReadFileToString(unfinished_file_name.c_str(), &content));
+
+  // Without flushing.
+  input.reset();
+  muxer.reset();
+  EXPECT_FALSE(
+      File::ReadFileToString(unfinished_file_name.c_str(), &content));
+  for (const std::string& file_name : kept_file_names) {
+    EXPECT_TRUE(File::ReadFileToString(file_name.c_str(), &content))
+        << file_name;
+  }
+}
+
+TEST_F(MP4MuxerTest, SegmentDigests) {
+  const size_t kNumFragmentsPerSegment = 2;
+  MuxAndCheckSegmentDigests(GetSegmentTemplateOptions(false),
+                            kNumFragmentsPerSegment);
+}
+
+// The digests cover the chunks written before the end of the segment.
+TEST_F(MP4MuxerTest, ChunkedSegmentDigests) {
+  const size_t kNumFragmentsPerSegment = 2;
+  MuxerOptions options = GetSegmentTemplateOptions(false);
+  options.write_chunked_segments = true;
+  MuxAndCheckSegmentDigests(options, kNumFragmentsPerSegment);
+}
+
+TEST_F(MP4MuxerTest, InitSegmentWrittenEarly) {
+  const bool kWriteInitSegmentEarly = true;
+  auto muxer = std::make_shared<MP4Muxer>(
+      GetSegmentTemplateOptions(kWriteInitSegmentEarly));
+  auto input = std::make_shared<FakeInputMediaHandler>();
+  ASSERT_OK(input->AddHandler(muxer));
+  ASSERT_OK(input->Initialize());
+  ASSERT_OK(input->Dispatch(StreamData::FromStreamInfo(
+      kStreamIndex, GetVideoStreamInfo(kTimeScale))));
+
+  // The init segment is written before the first sample, with the EditList
+  // derived from the expected offset.
+  Movie moov;
+  ASSERT_NO_FATAL_FAILURE(ParseInitSegment(&moov));
+  const int64_t kExpectedEditListOffset =
+      kExpectedEditListOffsetInSeconds * kTimeScale;
+  ASSERT_EQ(1u, moov.tracks[0].edit.list.edits.size());
+  EXPECT_EQ(kExpectedEditListOffset,
+            moov.tracks[0].edit.list.edits[0].media_time);
+
+  // The first sample does not need the offset. It is kept, since the init
+  // segment is out already.
+  const std::vector<uint8_t> data = GetSampleData(0);
+  const bool kIsKeyFrame = true;
+  ASSERT_OK(input->Dispatch(StreamData::FromMediaSample(
+      kStreamIndex, GetMediaSample(0, kSampleDuration, kIsKeyFrame,
+                                   data.data(), data.size()))));
+  ASSERT_OK(input->Dispatch(StreamData::FromSegmentInfo(
+      kStreamIndex, GetSegmentInfo(0, kSampleDuration, !kSubsegment))));
+  ASSERT_OK(input->FlushAllDownstreams());
+
+  ASSERT_NO_FATAL_FAILURE(ParseInitSegment(&moov));
+  ASSERT_EQ(1u, moov.tracks[0].edit.list.edits.size());
+  EXPECT_EQ(kExpectedEditListOffset,
+            moov.tracks[0].edit.list.edits[0].media_time);
+}
+
+TEST_F(MP4MuxerTest, InitSegmentWrittenAfterFirstSample) {
+  const bool kWriteInitSegmentEarly = true;
+  auto muxer = std::make_shared<MP4Muxer>(
+      GetSegmentTemplateOptions(!kWriteInitSegmentEarly));
+  auto input = std::make_shared<FakeInputMediaHandler>();
+  ASSERT_OK(input->AddHandler(muxer));
+  ASSERT_OK(input->Initialize());
+  ASSERT_OK(input->Dispatch(StreamData::FromStreamInfo(
+      kStreamIndex, GetVideoStreamInfo(kTimeScale))));
+
+  std::string content;
+  EXPECT_FALSE(File::ReadFileToString(kInitSegmentName, &content));
+}
+
+TEST_F(MP4MuxerTest, ProgressiveWithTempFile) {
+  std::string content;
+  ASSERT_NO_FATAL_FAILURE(MuxSingleSegment(
+      "memory://output/progressive.mp4", 0, kProgressive, &content));
+
+  const std::vector<TopLevelBox> boxes = GetTopLevelBoxes(content);
+  ASSERT_EQ(3u, boxes.size());
+  VerifyProgressiveFile(content, boxes[1].offset + boxes[1].size);
+}
+
+// The media is written after the reserved space, which 'ftyp', 'moov' and a
+// 'free' box fill at the end.
+TEST_F(MP4MuxerTest, ProgressiveInPlace) {
+  std::string content;
+  ASSERT_NO_FATAL_FAILURE(MuxSingleSegment("memory://output/progressive.mp4",
+                                           kReservedHeaderSize, kProgressive,
+                                           &content));
+
+  const std::vector<TopLevelBox> boxes = GetTopLevelBoxes(content);
+  ASSERT_EQ(4u, boxes.size());
+  EXPECT_EQ(FOURCC_free, boxes[2].type);
+  VerifyProgressiveFile(content, kReservedHeaderSize);
+}
+
+// 'moov' does not fit in the reserved space, so the media is moved to a
+// temporary file at the end.
+TEST_F(MP4MuxerTest, ProgressiveInPlaceFallsBackToTempFile) {
+  std::string temp_file_content;
+  ASSERT_NO_FATAL_FAILURE(MuxSingleSegment("memory://output/temp_file.mp4", 0,
+                                           kProgressive, &temp_file_content));
+  const std::vector<TopLevelBox> temp_file_boxes =
+      GetTopLevelBoxes(temp_file_content);
+  ASSERT_EQ(3u, temp_file_boxes.size());
+  // The sample tables are empty at the beginning, so this fits 'ftyp' and
+  // 'moov' then, but not at the end.
+  const uint64_t kReservedSize = temp_file_boxes[2].offset - 16;
+
+  std::string content;
+  ASSERT_NO_FATAL_FAILURE(MuxSingleSegment("memory://output/fallback.mp4",
+                                           kReservedSize, kProgressive,
+                                           &content));
+  const std::vector<TopLevelBox> boxes = GetTopLevelBoxes(content);
+  ASSERT_EQ(3u, boxes.size());
+  VerifyProgressiveFile(content, temp_file_boxes[2].offset);
+}
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
@@ -12,9 +12,12 @@
 #include "packager/base/strings/string_util.h"
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
+#include "packager/media/base/buffer_chain.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/muxer_util.h"
+#include "packager/media/base/segment_checkpoint.h"
+#include "packager/media/base/segment_digest.h"
 #include "packager/media/event/muxer_listener.h"
 #include "packager/media/formats/mp4/box_definitions.h"
 #include "packager/media/formats/mp4/key_frame_info.h"
@@ -29,7 +32,8 @@ MultiSegmentSegmenter::MultiSegmentSegmenter(const MuxerOptions& options,
                                              std::unique_ptr<Movie> moov)
     : Segmenter(options, std::move(ftyp), std::move(moov)),
       styp_(new SegmentType),
-      num_segments_(0) {
+      num_segments_(0),
+      segment_name_formatter_(options.segment_template) {
   // Use the same brands for styp as ftyp.
   styp_->major_brand = Segmenter::ftyp()->major_brand;
   styp_->compatible_brands = Segmenter::ftyp()->compatible_brands;
@@ -38,7 +42,14 @@ MultiSegmentSegmenter::MultiSegmentSegmenter(const MuxerOptions& options,
                FOURCC_cmfc, FOURCC_cmfs);
 }
 
-MultiSegmentSegmenter::~MultiSegmentSegmenter() {}
+MultiSegmentSegmenter::~MultiSegmentSegmenter() {
+  // The partial segments of a segment which is not finished, after a failure
+  // or an abort, would never be completed.
+  for (const std::string& file_name : partial_segment_file_names_) {
+    if (!File::Delete(file_name.c_str()))
+      LOG(WARNING) << "Cannot delete partial segment " << file_name;
+  }
+}
 
 bool MultiSegmentSegmenter::GetInitRange(size_t* offset, size_t* size) {
   VLOG(1) << "MultiSegmentSegmenter outputs init segment: "
@@ -71,6 +82,17 @@ Status MultiSegmentSegmenter::DoFinalizeSegment() {
   return WriteSegment();
 }
 
+Status MultiSegmentSegmenter::DoFinalizeFragment(
+    bool is_last_fragment_in_segment) {
+  if (options().segment_template.empty())
+    return Status::OK;
+  if (options().write_partial_segments)
+    RETURN_IF_ERROR(WritePartialSegment(is_last_fragment_in_segment));
+  if (options().write_chunked_segments)
+    RETURN_IF_ERROR(WriteSegmentChunk());
+  return Status::OK;
+}
+
 Status MultiSegmentSegmenter::WriteInitSegment() {
   DCHECK(ftyp());
   DCHECK(moov());
@@ -87,6 +109,119 @@ Status MultiSegmentSegmenter::WriteInitSegment() {
   return buffer->WriteToFile(file.get());
 }
 
+Status MultiSegmentSegmenter::WritePartialSegment(
+    bool is_last_fragment_in_segment) {
+  DCHECK(sidx());
+  DCHECK(fragment_buffer());
+  DCHECK(!sidx()->references.empty());
+
+  const SegmentReference& first_reference = sidx()->references.front();
+  const SegmentReference& reference = sidx()->references.back();
+  const std::string segment_name = segment_name_formatter_.Format(
+      first_reference.earliest_presentation_time, num_segments_,
+      options().bandwidth);
+  const std::string file_name =
+      GetPartialSegmentName(segment_name, num_partial_segments_);
+
+  BufferWriter buffer;
+  // Every partial segment is a continuation of the previous one, so only the
+  // first partial segment of a segment starts with 'styp'.
+  if (num_partial_segments_ == 0)
+    styp_->Write(&buffer);
+  DCHECK_LE(partial_segment_offset_, fragment_buffer()->Size());
+  const size_t partial_segment_size =
+      buffer.Size() + fragment_buffer()->Size() - partial_segment_offset_;
+
+  std::unique_ptr<File, FileCloser> file(File::Open(file_name.c_str(), "w"));
+  if (!file) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file for write " + file_name);
+  }
+  Status status;
+  if (buffer.Size() > 0)
+    status = buffer.WriteToFile(file.get());
+  if (status.ok()) {
+    status =
+        fragment_buffer()->WriteToFile(partial_segment_offset_, file.get());
+  }
+  // Make sure the file is written before the playlist is updated.
+  if (!file.release()->Close() && status.ok()) {
+    status = Status(
+        error::FILE_FAILURE,
+        "Cannot close file " + file_name +
+            ", possibly file permission issue or running out of disk space.");
+  }
+  if (!status.ok()) {
+    // Do not leave a truncated partial segment behind.
+    File::Delete(file_name.c_str());
+    return status;
+  }
+  partial_segment_file_names_.push_back(file_name);
+
+  // The next partial segment is either the next one in this segment or the
+  // first one in the next segment.
+  std::string next_file_name;
+  if (is_last_fragment_in_segment) {
+    const uint64_t next_segment_start_time =
+        reference.earliest_presentation_time + reference.subsegment_duration;
+    next_file_name = GetPartialSegmentName(
+        segment_name_formatter_.Format(next_segment_start_time,
+                                       num_segments_ + 1, options().bandwidth),
+        0);
+    num_partial_segments_ = 0;
+    partial_segment_offset_ = 0;
+    partial_segment_file_names_.clear();
+  } else {
+    next_file_name =
+        GetPartialSegmentName(segment_name, ++num_partial_segments_);
+    partial_segment_offset_ = fragment_buffer()->Size();
+  }
+
+  if (muxer_listener()) {
+    muxer_listener()->OnNewPartialSegment(
+        file_name, reference.earliest_presentation_time,
+        reference.subsegment_duration, partial_segment_size,
+        reference.starts_with_sap, next_file_name);
+  }
+  return Status::OK;
+}
+
+Status MultiSegmentSegmenter::WriteSegmentChunk() {
+  DCHECK(sidx());
+  DCHECK(fragment_buffer());
+  DCHECK(!sidx()->references.empty());
+
+  BufferWriter buffer;
+  if (!chunked_segment_file_) {
+    segment_name_formatter_.Format(
+        sidx()->references.front().earliest_presentation_time, num_segments_,
+        options().bandwidth, &chunked_segment_file_name_);
+    chunked_segment_file_.reset(
+        File::Open(chunked_segment_file_name_.c_str(), "w"));
+    if (!chunked_segment_file_) {
+      return Status(error::FILE_FAILURE,
+                    "Cannot open file for write " + chunked_segment_file_name_);
+    }
+    // Other outputs, e.g. HTTP uploads, forward the data as it is written,
+    // and Flush() ends an HTTP upload.
+    flush_chunks_ =
+        File::IsLocalRegularFile(chunked_segment_file_name_.c_str());
+    styp_->Write(&buffer);
+  }
+  DCHECK_LE(chunk_offset_, fragment_buffer()->Size());
+  if (buffer.Size() > 0)
+    RETURN_IF_ERROR(buffer.WriteToFile(chunked_segment_file_.get()));
+  RETURN_IF_ERROR(fragment_buffer()->WriteToFile(chunk_offset_,
+                                                 chunked_segment_file_.get()));
+  chunk_offset_ = fragment_buffer()->Size();
+  // Make the chunk available before the segment is complete.
+  if (flush_chunks_ && !chunked_segment_file_->Flush()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot flush file " + chunked_segment_file_name_);
+  }
+  return Status::OK;
+}
+
 Status MultiSegmentSegmenter::WriteSegment() {
   DCHECK(sidx());
   DCHECK(fragment_buffer());
@@ -101,7 +236,20 @@ Status MultiSegmentSegmenter::WriteSegment() {
   std::unique_ptr<BufferWriter> buffer(new BufferWriter());
   std::unique_ptr<File, FileCloser> file;
   std::string file_name;
-  if (options().segment_template.empty()) {
+  // The segment is already written if it is written in chunks, except for
+  // closing the file. There is no 'sidx' in the segment as it has to precede
+  // the fragments.
+  const bool written_in_chunks = !!chunked_segment_file_;
+  // Whether the segment is written to its own file, to be recorded in the
+  // segment checkpoint.
+  bool record_in_checkpoint = false;
+  if (written_in_chunks) {
+    file = std::move(chunked_segment_file_);
+    file_name = std::move(chunked_segment_file_name_);
+    ++num_segments_;
+    // Only for the segment header size. 'styp' is already written.
+    styp_->Write(buffer.get());
+  } else if (options().segment_template.empty()) {
     // Append the segment to output file if segment template is not specified.
     file_name = options().output_file_name.c_str();
     file.reset(File::Open(file_name.c_str(), "a"));
@@ -110,25 +258,59 @@ Status MultiSegmentSegmenter::WriteSegment() {
                                              options().output_file_name);
     }
   } else {
-    file_name = GetSegmentName(options().segment_template,
-                               sidx()->earliest_presentation_time,
-                               num_segments_++, options().bandwidth);
-    file.reset(File::Open(file_name.c_str(), "w"));
-    if (!file) {
-      return Status(error::FILE_FAILURE,
-                    "Cannot open file for write " + file_name);
-    }
+    // The file is opened once the segment is known not to be written before.
+    file_name = segment_name_formatter_.Format(
+        sidx()->earliest_presentation_time, num_segments_++,
+        options().bandwidth);
     styp_->Write(buffer.get());
   }
 
-  if (options().mp4_params.generate_sidx_in_media_segments)
+  if (options().mp4_params.generate_sidx_in_media_segments &&
+      !written_in_chunks) {
     sidx()->Write(buffer.get());
+  }
 
   const size_t segment_header_size = buffer->Size();
   const size_t segment_size = segment_header_size + fragment_buffer()->Size();
   DCHECK_NE(segment_size, 0u);
 
-  RETURN_IF_ERROR(buffer->WriteToFile(file.get()));
+  // The segment is made of |buffer| and the fragments, also when it is
+  // written in chunks, with 'styp' in |buffer|.
+  std::vector<SegmentDigest> digests;
+  if (!options().segment_digests.empty() &&
+      !options().segment_template.empty()) {
+    SegmentDigester digester(options().segment_digests);
+    digester.Update(*buffer);
+    digester.Update(*fragment_buffer());
+    digests = digester.Finish();
+  }
+
+  if (written_in_chunks) {
+    buffer->Clear();
+  } else {
+    // Writes the whole segment at once, so that callback outputs are handed
+    // it in one piece without copying.
+    BufferChain segment;
+    segment.AppendBuffer(buffer.get());
+    segment.AppendChain(*fragment_buffer());
+    SegmentCheckpoint* segment_checkpoint = options().segment_checkpoint;
+    const bool written_before =
+        !file && segment_checkpoint &&
+        segment_checkpoint->IsSegmentWritten(file_name, segment_size);
+    // Only the segment files can be skipped, the segments appended to the
+    // output file cannot.
+    record_in_checkpoint = !file && !written_before && segment_checkpoint;
+    if (!written_before) {
+      if (!file) {
+        file.reset(File::Open(file_name.c_str(), "w"));
+        if (!file) {
+          return Status(error::FILE_FAILURE,
+                        "Cannot open file for write " + file_name);
+        }
+      }
+      RETURN_IF_ERROR(segment.WriteToFile(file.get()));
+    }
+  }
   if (muxer_listener()) {
     for (const KeyFrameInfo& key_frame_info : key_frame_infos()) {
       muxer_listener()->OnKeyFrame(
@@ -137,16 +319,34 @@ Status MultiSegmentSegmenter::WriteSegment() {
           key_frame_info.size);
     }
   }
-  RETURN_IF_ERROR(fragment_buffer()->WriteToFile(file.get()));
+  if (written_in_chunks) {
+    DCHECK_EQ(chunk_offset_, fragment_buffer()->Size());
+    fragment_buffer()->Clear();
+    chunk_offset_ = 0;
+  } else {
+    fragment_buffer()->Clear();
+  }
 
   // Close the file, which also does flushing, to make sure the file is written
   // before manifest is updated.
-  if (!file.release()->Close()) {
+  if (file && !file.release()->Close()) {
     return Status(
         error::FILE_FAILURE,
         "Cannot close file " + file_name +
             ", possibly file permission issue or running out of disk space.");
   }
+  if (record_in_checkpoint) {
+    RETURN_IF_ERROR(options().segment_checkpoint->OnSegmentWritten(
+        file_name, segment_size));
+  }
+  if (!digests.empty()) {
+    if (options().segment_digest_file) {
+      RETURN_IF_ERROR(
+          options().segment_digest_file->OnSegmentWritten(file_name, digests));
+    }
+    if (muxer_listener())
+      muxer_listener()->OnSegmentDigests(file_name, digests);
+  }
 
   uint64_t segment_duration = 0;
   // ISO/IEC 23009-1:2012: the value shall be identical to sum of the the
@@ -7,6 +7,12 @@
 #ifndef PACKAGER_MEDIA_FORMATS_MP4_MULTI_SEGMENT_SEGMENTER_H_
 #define PACKAGER_MEDIA_FORMATS_MP4_MULTI_SEGMENT_SEGMENTER_H_
 
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/file/file_closer.h"
+#include "packager/media/base/muxer_util.h"
 #include "packager/media/formats/mp4/segmenter.h"
 
 namespace shaka {
@@ -39,13 +45,35 @@ class MultiSegmentSegmenter : public Segmenter {
   Status DoInitialize() override;
   Status DoFinalize() override;
   Status DoFinalizeSegment() override;
+  Status DoFinalizeFragment(bool is_last_fragment_in_segment) override;
 
   // Write segment to file.
   Status WriteInitSegment();
   Status WriteSegment();
+  // Write the last fragment to a partial segment file.
+  Status WritePartialSegment(bool is_last_fragment_in_segment);
+  // Append the last fragment to the segment file and flush it.
+  Status WriteSegmentChunk();
 
   std::unique_ptr<SegmentType> styp_;
   uint32_t num_segments_;
+  const SegmentNameFormatter segment_name_formatter_;
+  // Number of partial segments written for the current segment.
+  uint32_t num_partial_segments_ = 0;
+  // Offset in fragment_buffer() of the fragment not written to a partial
+  // segment yet.
+  size_t partial_segment_offset_ = 0;
+  // The partial segment files of the current segment, deleted if the segment
+  // is not finished.
+  std::vector<std::string> partial_segment_file_names_;
+  // The segment file being written in chunks, and its name.
+  std::unique_ptr<File, FileCloser> chunked_segment_file_;
+  std::string chunked_segment_file_name_;
+  // Whether to flush |chunked_segment_file_| after every chunk.
+  bool flush_chunks_ = false;
+  // Offset in fragment_buffer() of the fragment not written to
+  // |chunked_segment_file_| yet.
+  size_t chunk_offset_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(MultiSegmentSegmenter);
 };
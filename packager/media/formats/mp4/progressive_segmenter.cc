@@ -0,0 +1,470 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp4/progressive_segmenter.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "packager/file/file.h"
+#include "packager/file/file_util.h"
+#include "packager/media/base/buffer_chain.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/event/muxer_listener.h"
+#include "packager/media/formats/mp4/box_definitions.h"
+
+namespace shaka {
+namespace media {
+namespace mp4 {
+namespace {
+
+// 'mdat' is always written with a 64-bit size, as its size is not known when
+// the space for its header is reserved.
+const uint64_t kMdatHeaderSize = 16;
+
+uint64_t Rescale(uint64_t time_in_old_scale,
+                 uint32_t old_scale,
+                 uint32_t new_scale) {
+  return static_cast<double>(time_in_old_scale) / old_scale * new_scale;
+}
+
+// Appends the header of a 'mdat' box with |data_size| bytes of media data.
+void AppendMdatHeader(uint64_t data_size, BufferWriter* buffer) {
+  // A size of 1 means that the size follows the box type in 64 bits.
+  buffer->AppendInt(static_cast<uint32_t>(1));
+  buffer->AppendInt(static_cast<uint32_t>(FOURCC_mdat));
+  buffer->AppendInt(kMdatHeaderSize + data_size);
+}
+
+// Appends a sample with |value| to the run-length encoded |entries|, e.g. of
+// 'stts' or 'ctts'.
+template <typename Entry, typename Value>
+void AppendRunLengthEntry(Value value,
+                          Value Entry::*value_field,
+                          std::vector<Entry>* entries) {
+  if (!entries->empty() && entries->back().*value_field == value) {
+    ++entries->back().sample_count;
+    return;
+  }
+  Entry entry;
+  entry.sample_count = 1;
+  entry.*value_field = value;
+  entries->push_back(entry);
+}
+
+}  // namespace
+
+ProgressiveSegmenter::ProgressiveSegmenter(const MuxerOptions& options,
+                                           std::unique_ptr<FileType> ftyp,
+                                           std::unique_ptr<Movie> moov)
+    : Segmenter(options, std::move(ftyp), std::move(moov)) {}
+
+ProgressiveSegmenter::~ProgressiveSegmenter() {
+  if (output_file_)
+    output_file_.release()->Close();
+  if (temp_file_)
+    temp_file_.release()->Close();
+  if (!temp_file_name_.empty()) {
+    if (!File::Delete(temp_file_name_.c_str()))
+      LOG(ERROR) << "Unable to delete temporary file " << temp_file_name_;
+  }
+}
+
+bool ProgressiveSegmenter::GetInitRange(size_t* offset, size_t* size) {
+  // There is no initialization segment in a progressive file.
+  return false;
+}
+
+bool ProgressiveSegmenter::GetIndexRange(size_t* offset, size_t* size) {
+  // Samples are indexed by the sample tables in 'moov', not by 'sidx'.
+  return false;
+}
+
+std::vector<Range> ProgressiveSegmenter::GetSegmentRanges() {
+  return std::vector<Range>();
+}
+
+Status ProgressiveSegmenter::DoInitialize() {
+  // The file is neither a DASH segment nor a CMAF track file.
+  std::vector<FourCC>& brands = ftyp()->compatible_brands;
+  brands.erase(std::remove_if(brands.begin(), brands.end(),
+                              [](FourCC brand) {
+                                return brand == FOURCC_dash ||
+                                       brand == FOURCC_cmfc;
+                              }),
+               brands.end());
+
+  if (options().mp4_params.vod_header_reserved_size > 0 &&
+      InitializeInPlaceOutput()) {
+    return Status::OK;
+  }
+  return InitializeTempFile();
+}
+
+Status ProgressiveSegmenter::DoFinalize() {
+  DCHECK(ftyp());
+  DCHECK(moov());
+  FinalizeMovie();
+  if (output_file_)
+    return FinalizeInPlace();
+  return FinalizeWithTempFile();
+}
+
+Status ProgressiveSegmenter::DoFinalizeSegment() {
+  // Segments are only used to report the progress and the bitrate.
+  uint64_t segment_duration = 0;
+  uint64_t earliest_presentation_time = std::numeric_limits<uint64_t>::max();
+  for (const SegmentReference& reference : sidx()->references) {
+    segment_duration += reference.subsegment_duration;
+    earliest_presentation_time = std::min(
+        earliest_presentation_time, reference.earliest_presentation_time);
+  }
+  UpdateProgress(segment_duration);
+  if (muxer_listener()) {
+    muxer_listener()->OnSampleDurationReady(sample_duration());
+    muxer_listener()->OnNewSegment(options().output_file_name,
+                                   earliest_presentation_time,
+                                   segment_duration, segment_size_);
+  }
+  segment_size_ = 0;
+  return Status::OK;
+}
+
+Status ProgressiveSegmenter::DoFinalizeFragment(
+    bool is_last_fragment_in_segment) {
+  DCHECK(fragment_buffer());
+  MovieFragment* fragment = moof();
+  DCHECK(!fragment->tracks.empty());
+  DCHECK(!fragment->tracks[0].runs.empty());
+  // The run of the first track starts right after the 'moof' and 'mdat'
+  // headers, which are dropped.
+  const uint64_t fragment_header_size = fragment->tracks[0].runs[0].data_offset;
+  for (size_t i = 0; i < fragment->tracks.size(); ++i) {
+    const TrackFragment& traf = fragment->tracks[i];
+    DCHECK(!traf.runs.empty());
+    if (traf.runs[0].sample_count == 0)
+      continue;
+    AppendChunk(traf,
+                media_size_ + traf.runs[0].data_offset - fragment_header_size,
+                &moov()->tracks[i].media.information.sample_table);
+  }
+
+  const uint64_t data_size = fragment_buffer()->Size() - fragment_header_size;
+  Status status = fragment_buffer()->WriteToFile(
+      fragment_header_size,
+      output_file_ ? output_file_.get() : temp_file_.get());
+  if (!status.ok())
+    return status;
+  fragment_buffer()->Clear();
+  media_size_ += data_size;
+  segment_size_ += data_size;
+  return Status::OK;
+}
+
+bool ProgressiveSegmenter::InitializeInPlaceOutput() {
+  const uint64_t reserved_size = options().mp4_params.vod_header_reserved_size;
+  const uint64_t init_size = ftyp()->ComputeSize() + moov()->ComputeSize();
+  if (reserved_size > std::numeric_limits<uint32_t>::max() ||
+      reserved_size < init_size + kFreeBoxHeaderSize) {
+    LOG(WARNING) << "Ignoring reserved header size " << reserved_size
+                 << ": it should be at least " << init_size + kFreeBoxHeaderSize
+                 << " bytes and fit in 32 bits.";
+    return false;
+  }
+
+  output_file_.reset(File::Open(options().output_file_name.c_str(), "w"));
+  if (!output_file_)
+    return false;
+  if (!output_file_->Seek(0)) {
+    LOG(WARNING) << "Output file '" << options().output_file_name
+                 << "' does not support seeking. Media will be written to a "
+                    "temporary file instead.";
+    output_file_.release()->Close();
+    return false;
+  }
+
+  // Fill the reserved space with a 'free' box, which is rewritten with the
+  // headers in FinalizeInPlace(), followed by the 'mdat' header, which is
+  // rewritten with the actual size.
+  BufferWriter buffer;
+  AppendFreeBox(reserved_size, &buffer);
+  AppendMdatHeader(0, &buffer);
+  if (!buffer.WriteToFile(output_file_.get()).ok()) {
+    output_file_.release()->Close();
+    return false;
+  }
+  reserved_header_size_ = reserved_size;
+  return true;
+}
+
+Status ProgressiveSegmenter::InitializeTempFile() {
+  if (!TempFilePath(options().temp_dir, &temp_file_name_))
+    return Status(error::FILE_FAILURE, "Unable to create temporary file.");
+  temp_file_.reset(File::Open(temp_file_name_.c_str(), "w"));
+  return temp_file_
+             ? Status::OK
+             : Status(error::FILE_FAILURE,
+                      "Cannot open file to write " + temp_file_name_);
+}
+
+void ProgressiveSegmenter::AppendChunk(const TrackFragment& traf,
+                                       uint64_t chunk_offset,
+                                       SampleTable* sample_table) {
+  const TrackFragmentRun& run = traf.runs[0];
+  std::vector<uint64_t>& chunk_offsets =
+      sample_table->chunk_large_offset.offsets;
+  chunk_offsets.push_back(chunk_offset);
+
+  std::vector<ChunkInfo>& chunk_info = sample_table->sample_to_chunk.chunk_info;
+  if (chunk_info.empty() ||
+      chunk_info.back().samples_per_chunk != run.sample_count ||
+      chunk_info.back().sample_description_index !=
+          traf.header.sample_description_index) {
+    ChunkInfo info;
+    info.first_chunk = static_cast<uint32_t>(chunk_offsets.size());
+    info.samples_per_chunk = run.sample_count;
+    info.sample_description_index = traf.header.sample_description_index;
+    chunk_info.push_back(info);
+  }
+
+  // Fragmenter moves the values shared by all the samples of the run to the
+  // defaults in 'tfhd'.
+  std::vector<uint32_t>& sizes = sample_table->sample_size.sizes;
+  for (uint32_t i = 0; i < run.sample_count; ++i) {
+    sizes.push_back(run.sample_sizes.empty() ? traf.header.default_sample_size
+                                             : run.sample_sizes[i]);
+    AppendRunLengthEntry(run.sample_durations.empty()
+                             ? traf.header.default_sample_duration
+                             : run.sample_durations[i],
+                         &DecodingTime::sample_delta,
+                         &sample_table->decoding_time_to_sample.decoding_time);
+    AppendRunLengthEntry(
+        run.sample_composition_time_offsets[i],
+        &CompositionOffset::sample_offset,
+        &sample_table->composition_time_to_sample.composition_offset);
+
+    const uint32_t sample_flags = run.sample_flags.empty()
+                                      ? traf.header.default_sample_flags
+                                      : run.sample_flags[i];
+    if ((sample_flags & TrackFragmentHeader::kNonKeySampleMask) == 0) {
+      sample_table->sync_sample.sample_number.push_back(
+          static_cast<uint32_t>(sizes.size()));
+    }
+  }
+}
+
+void ProgressiveSegmenter::FinalizeMovie() {
+  // The movie is not fragmented.
+  moov()->extends.tracks.clear();
+  moov()->header.duration = moov()->extends.header.fragment_duration;
+
+  for (Track& track : moov()->tracks) {
+    SampleTable& sample_table = track.media.information.sample_table;
+
+    uint64_t duration = 0;
+    for (const DecodingTime& decoding_time :
+         sample_table.decoding_time_to_sample.decoding_time) {
+      duration += static_cast<uint64_t>(decoding_time.sample_count) *
+                  decoding_time.sample_delta;
+    }
+    const uint32_t timescale = track.media.header.timescale;
+    track.media.header.duration = duration;
+    track.header.duration =
+        Rescale(duration, timescale, moov()->header.timescale);
+    for (EditListEntry& edit : track.edit.list.edits) {
+      edit.segment_duration = Rescale(
+          duration > static_cast<uint64_t>(edit.media_time)
+              ? duration - edit.media_time
+              : 0,
+          timescale, moov()->header.timescale);
+    }
+
+    // 'ctts' is not needed if presentation and decoding timestamps match.
+    std::vector<CompositionOffset>& composition_offsets =
+        sample_table.composition_time_to_sample.composition_offset;
+    if (composition_offsets.size() == 1 &&
+        composition_offsets[0].sample_offset == 0) {
+      composition_offsets.clear();
+    }
+
+    // 'stsz' stores a single size if all the samples have the same size.
+    SampleSize& sample_size = sample_table.sample_size;
+    sample_size.sample_count = static_cast<uint32_t>(sample_size.sizes.size());
+    if (!sample_size.sizes.empty() &&
+        std::all_of(sample_size.sizes.begin(), sample_size.sizes.end(),
+                    [&sample_size](uint32_t size) {
+                      return size == sample_size.sizes[0];
+                    })) {
+      sample_size.sample_size = sample_size.sizes[0];
+      sample_size.sizes.clear();
+    }
+
+    // Every sample is a sync sample if 'stss' is not present.
+    if (sample_table.sync_sample.sample_number.size() ==
+        sample_size.sample_count) {
+      sample_table.sync_sample.sample_number.clear();
+    }
+
+    // Track level sample groups, e.g. 'roll', apply to all the samples.
+    sample_table.sample_to_groups.clear();
+    for (size_t i = 0; i < sample_table.sample_group_descriptions.size(); ++i) {
+      SampleToGroupEntry entry;
+      entry.sample_count = sample_size.sample_count;
+      entry.group_description_index = static_cast<uint32_t>(i + 1);
+      SampleToGroup sample_to_group;
+      sample_to_group.grouping_type =
+          sample_table.sample_group_descriptions[i].grouping_type;
+      sample_to_group.entries.push_back(entry);
+      sample_table.sample_to_groups.push_back(sample_to_group);
+    }
+  }
+}
+
+void ProgressiveSegmenter::SetMediaOffset(uint64_t media_offset) {
+  for (Track& track : moov()->tracks) {
+    for (uint64_t& offset :
+         track.media.information.sample_table.chunk_large_offset.offsets) {
+      offset = offset - media_offset_ + media_offset;
+    }
+  }
+  media_offset_ = media_offset;
+}
+
+Status ProgressiveSegmenter::FinalizeInPlace() {
+  DCHECK(output_file_);
+
+  SetMediaOffset(reserved_header_size_ + kMdatHeaderSize);
+  const uint64_t header_size = ftyp()->ComputeSize() + moov()->ComputeSize();
+  const uint64_t padding_size = reserved_header_size_ > header_size
+                                    ? reserved_header_size_ - header_size
+                                    : 0;
+  if (header_size > reserved_header_size_ ||
+      (padding_size > 0 && padding_size < kFreeBoxHeaderSize)) {
+    LOG(WARNING) << "Headers of " << header_size
+                 << " bytes do not fit in the reserved space of "
+                 << reserved_header_size_
+                 << " bytes. Rewriting the file through a temporary file.";
+    RETURN_IF_ERROR(MoveMediaToTempFile());
+    return FinalizeWithTempFile();
+  }
+
+  LOG(INFO) << "Update media header (moov) in place in '"
+            << options().output_file_name << "'.";
+
+  BufferWriter buffer;
+  ftyp()->Write(&buffer);
+  moov()->Write(&buffer);
+  if (padding_size > 0)
+    AppendFreeBox(padding_size, &buffer);
+  AppendMdatHeader(media_size_, &buffer);
+  DCHECK_EQ(reserved_header_size_ + kMdatHeaderSize, buffer.Size());
+
+  if (!output_file_->Seek(0)) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot seek in file " + options().output_file_name);
+  }
+  RETURN_IF_ERROR(buffer.WriteToFile(output_file_.get()));
+  if (!output_file_.release()->Close()) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close file " + options().output_file_name +
+            ", possibly file permission issue or running out of disk space.");
+  }
+  SetComplete();
+  return Status::OK;
+}
+
+Status ProgressiveSegmenter::MoveMediaToTempFile() {
+  DCHECK(output_file_);
+  if (!output_file_.release()->Close()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot close file " + options().output_file_name);
+  }
+  RETURN_IF_ERROR(InitializeTempFile());
+
+  std::unique_ptr<File, FileCloser> output_file(
+      File::Open(options().output_file_name.c_str(), "r"));
+  if (!output_file) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file to read " + options().output_file_name);
+  }
+  if (!output_file->Seek(reserved_header_size_ + kMdatHeaderSize)) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot seek in file " + options().output_file_name);
+  }
+  if (File::CopyFile(output_file.get(), temp_file_.get()) < 0) {
+    return Status(error::FILE_FAILURE,
+                  "Failed to copy media to " + temp_file_name_);
+  }
+  return Status::OK;
+}
+
+Status ProgressiveSegmenter::FinalizeWithTempFile() {
+  DCHECK(temp_file_);
+
+  // Close the temp file to prepare for reading later.
+  if (!temp_file_.release()->Close()) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close the temp file " + temp_file_name_ +
+            ", possibly file permission issue or running out of disk space.");
+  }
+
+  // The media follows the headers, whose size depends on whether the chunk
+  // offsets fit in 32 bits, so repeat until it settles.
+  uint64_t header_size = 0;
+  do {
+    SetMediaOffset(header_size);
+    header_size =
+        ftyp()->ComputeSize() + moov()->ComputeSize() + kMdatHeaderSize;
+  } while (header_size != media_offset_);
+
+  std::unique_ptr<File, FileCloser> file(
+      File::Open(options().output_file_name.c_str(), "w"));
+  if (!file) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file to write " + options().output_file_name);
+  }
+
+  LOG(INFO) << "Update media header (moov) and rewrite the file to '"
+            << options().output_file_name << "'.";
+
+  BufferWriter buffer;
+  ftyp()->Write(&buffer);
+  moov()->Write(&buffer);
+  AppendMdatHeader(media_size_, &buffer);
+  DCHECK_EQ(media_offset_, buffer.Size());
+  RETURN_IF_ERROR(buffer.WriteToFile(file.get()));
+
+  std::unique_ptr<File, FileCloser> temp_file(
+      File::Open(temp_file_name_.c_str(), "r"));
+  if (!temp_file) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file to read " + temp_file_name_);
+  }
+  if (File::CopyFile(temp_file.get(), file.get()) !=
+      static_cast<int64_t>(media_size_)) {
+    return Status(error::FILE_FAILURE,
+                  "Failed to copy media to " + options().output_file_name);
+  }
+  if (!temp_file.release()->Close()) {
+    return Status(error::FILE_FAILURE, "Cannot close the temp file " +
+                                           temp_file_name_ + " after reading.");
+  }
+  if (!file.release()->Close()) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close file " + options().output_file_name +
+            ", possibly file permission issue or running out of disk space.");
+  }
+  SetComplete();
+  return Status::OK;
+}
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
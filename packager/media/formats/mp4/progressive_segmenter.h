@@ -0,0 +1,99 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_FORMATS_MP4_PROGRESSIVE_SEGMENTER_H_
+#define PACKAGER_MEDIA_FORMATS_MP4_PROGRESSIVE_SEGMENTER_H_
+
+#include "packager/file/file_closer.h"
+#include "packager/media/formats/mp4/segmenter.h"
+
+namespace shaka {
+namespace media {
+namespace mp4 {
+
+struct SampleTable;
+struct TrackFragment;
+
+/// Segmenter for progressive (non-fragmented) MP4 files, with 'moov' before a
+/// single 'mdat', as expected by download-to-go and other progressive
+/// download clients. The fragments built by Segmenter are not written: their
+/// runs are appended to the sample tables ('stts', 'ctts', 'stsc', 'stsz',
+/// 'stco' / 'co64' and 'stss') of 'moov', each run becoming a chunk, and only
+/// their media data is written to 'mdat'.
+///
+/// If @b Mp4OutputParams.vod_header_reserved_size is positive, media is
+/// written in place after the reserved space, which is then rewritten with
+/// 'ftyp' and 'moov', so the media is written only once. Otherwise, or if the
+/// headers do not fit, the media goes through a temporary file as in
+/// SingleSegmentSegmenter. Encrypted streams are not supported.
+class ProgressiveSegmenter : public Segmenter {
+ public:
+  ProgressiveSegmenter(const MuxerOptions& options,
+                       std::unique_ptr<FileType> ftyp,
+                       std::unique_ptr<Movie> moov);
+  ~ProgressiveSegmenter() override;
+
+  /// @name Segmenter implementation overrides.
+  /// @{
+  bool GetInitRange(size_t* offset, size_t* size) override;
+  bool GetIndexRange(size_t* offset, size_t* size) override;
+  std::vector<Range> GetSegmentRanges() override;
+  /// @}
+
+ private:
+  // Segmenter implementation overrides.
+  Status DoInitialize() override;
+  Status DoFinalize() override;
+  Status DoFinalizeSegment() override;
+  Status DoFinalizeFragment(bool is_last_fragment_in_segment) override;
+
+  // Opens the output file and reserves
+  // |Mp4OutputParams.vod_header_reserved_size| bytes and the 'mdat' header at
+  // its beginning. Returns false if the output does not support it, in which
+  // case the temporary file is used instead.
+  bool InitializeInPlaceOutput();
+  Status InitializeTempFile();
+  // Appends the run of |traf|, which starts at |chunk_offset| in the media
+  // data, to |sample_table| as a new chunk.
+  void AppendChunk(const TrackFragment& traf,
+                   uint64_t chunk_offset,
+                   SampleTable* sample_table);
+  // Sets the durations in 'moov', and trims the sample tables which are not
+  // needed.
+  void FinalizeMovie();
+  // Makes the chunk offsets relative to the beginning of the file, with the
+  // media data starting at |media_offset|.
+  void SetMediaOffset(uint64_t media_offset);
+  // Writes the headers into the reserved space at the beginning of the output
+  // file. Falls back to FinalizeWithTempFile() if they do not fit.
+  Status FinalizeInPlace();
+  // Writes the headers followed by the media in the temporary file to the
+  // output file.
+  Status FinalizeWithTempFile();
+  // Moves the media written in place in the output file to a temporary file.
+  Status MoveMediaToTempFile();
+
+  std::string temp_file_name_;
+  std::unique_ptr<File, FileCloser> temp_file_;
+  // Output file when media is written in place, i.e. after a reserved space of
+  // |reserved_header_size_| bytes for the headers and the 'mdat' header.
+  std::unique_ptr<File, FileCloser> output_file_;
+  uint64_t reserved_header_size_ = 0;
+  // Size of the media data written so far.
+  uint64_t media_size_ = 0;
+  // Size of the media data written since the last segment.
+  uint64_t segment_size_ = 0;
+  // Offset of the media data which the chunk offsets are relative to.
+  uint64_t media_offset_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(ProgressiveSegmenter);
+};
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_FORMATS_MP4_PROGRESSIVE_SEGMENTER_H_
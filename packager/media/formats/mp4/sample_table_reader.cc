@@ -0,0 +1,454 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp4/sample_table_reader.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "packager/file/file.h"
+#include "packager/media/base/buffer_reader.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/fourccs.h"
+#include "packager/media/base/rcheck.h"
+
+namespace shaka {
+namespace media {
+namespace mp4 {
+
+namespace {
+
+const uint64_t kBoxHeaderSize = 8;
+const uint64_t kLargeBoxHeaderSize = 16;
+// Version, flags and entry count.
+const uint64_t kTableHeaderSize = 8;
+
+struct BoxHeader {
+  FourCC type = FOURCC_NULL;
+  uint64_t size = 0;
+  uint64_t header_size = 0;
+};
+
+// Sample tables of the track being copied.
+struct TrackTables {
+  uint32_t track_id = 0;
+  SampleTableBoxLocations boxes;
+};
+
+bool ReadUInt32At(File* file, uint64_t offset, uint32_t* value) {
+  uint8_t data[sizeof(*value)];
+  RCHECK(File::ReadAt(file, offset, sizeof(data), data));
+  BufferReader reader(data, sizeof(data));
+  return reader.Read4(value);
+}
+
+// Reads the header of the box at |offset|, which must end before |end|.
+bool ReadBoxHeader(File* file,
+                   uint64_t offset,
+                   uint64_t end,
+                   BoxHeader* header) {
+  RCHECK(end - offset >= kBoxHeaderSize);
+  uint8_t data[kLargeBoxHeaderSize];
+  RCHECK(File::ReadAt(file, offset, kBoxHeaderSize, data));
+  BufferReader reader(data, kBoxHeaderSize);
+  uint32_t size = 0;
+  uint32_t type = 0;
+  RCHECK(reader.Read4(&size) && reader.Read4(&type));
+  header->type = static_cast<FourCC>(type);
+  header->header_size = kBoxHeaderSize;
+  header->size = size;
+  if (size == 1) {
+    RCHECK(end - offset >= kLargeBoxHeaderSize);
+    RCHECK(File::ReadAt(file, offset + kBoxHeaderSize, sizeof(uint64_t),
+                        data + kBoxHeaderSize));
+    BufferReader large_size_reader(data + kBoxHeaderSize, sizeof(uint64_t));
+    RCHECK(large_size_reader.Read8(&header->size));
+    header->header_size = kLargeBoxHeaderSize;
+  } else if (size == 0) {
+    // The box extends to the end of its parent.
+    header->size = end - offset;
+  }
+  RCHECK(header->size >= header->header_size &&
+         header->size <= end - offset);
+  return true;
+}
+
+bool CopyBox(File* file,
+             uint64_t offset,
+             const BoxHeader& header,
+             TrackTables* track,
+             std::map<uint32_t, SampleTableBoxLocations>* sample_tables,
+             BufferWriter* writer);
+
+// Copies the boxes between |offset| and |end|.
+bool CopyBoxes(File* file,
+               uint64_t offset,
+               uint64_t end,
+               TrackTables* track,
+               std::map<uint32_t, SampleTableBoxLocations>* sample_tables,
+               BufferWriter* writer) {
+  while (offset < end) {
+    BoxHeader header;
+    RCHECK(ReadBoxHeader(file, offset, end, &header));
+    RCHECK(CopyBox(file, offset, header, track, sample_tables, writer));
+    offset += header.size;
+  }
+  return true;
+}
+
+// Copies a container box child by child. The size of the copy differs from the
+// size in the file if sample table entries are left out.
+bool CopyContainer(File* file,
+                   uint64_t offset,
+                   const BoxHeader& header,
+                   TrackTables* track,
+                   std::map<uint32_t, SampleTableBoxLocations>* sample_tables,
+                   BufferWriter* writer) {
+  BufferWriter children(0);
+  RCHECK(CopyBoxes(file, offset + header.header_size, offset + header.size,
+                   track, sample_tables, &children));
+  RCHECK(kBoxHeaderSize + children.Size() <=
+         std::numeric_limits<uint32_t>::max());
+  writer->AppendInt(static_cast<uint32_t>(kBoxHeaderSize + children.Size()));
+  writer->AppendInt(static_cast<uint32_t>(header.type));
+  writer->AppendBuffer(children);
+  return true;
+}
+
+// Copies the header of a sample table box with |num_kept_entries| of its
+// entries, and locates all of its entries in |entries|. |fixed_size| is the
+// size of the fields preceding the entries, after the box header.
+bool CopySampleTable(File* file,
+                     uint64_t offset,
+                     const BoxHeader& header,
+                     uint64_t fixed_size,
+                     uint64_t entry_size,
+                     uint32_t num_kept_entries,
+                     SampleTableEntries* entries,
+                     BufferWriter* writer) {
+  const uint64_t payload_offset = offset + header.header_size;
+  const uint64_t payload_size = header.size - header.header_size;
+  RCHECK(payload_size >= fixed_size);
+  // The entry count is the last fixed field.
+  uint32_t entry_count = 0;
+  RCHECK(ReadUInt32At(file, payload_offset + fixed_size - sizeof(uint32_t),
+                      &entry_count));
+  RCHECK(entry_count * entry_size <= payload_size - fixed_size);
+
+  entries->present = true;
+  entries->offset = payload_offset + fixed_size;
+  entries->entry_count = entry_count;
+
+  num_kept_entries = std::min(num_kept_entries, entry_count);
+  const uint64_t kept_size = fixed_size + num_kept_entries * entry_size;
+  writer->AppendInt(static_cast<uint32_t>(kBoxHeaderSize + kept_size));
+  writer->AppendInt(static_cast<uint32_t>(header.type));
+  uint8_t* data = writer->Grow(kept_size);
+  RCHECK(File::ReadAt(file, payload_offset, kept_size, data));
+  // Overwrite the entry count.
+  BufferWriter count(sizeof(uint32_t));
+  count.AppendInt(num_kept_entries);
+  std::copy(count.Buffer(), count.Buffer() + count.Size(),
+            data + fixed_size - sizeof(uint32_t));
+  return true;
+}
+
+bool CopyBox(File* file,
+             uint64_t offset,
+             const BoxHeader& header,
+             TrackTables* track,
+             std::map<uint32_t, SampleTableBoxLocations>* sample_tables,
+             BufferWriter* writer) {
+  const uint64_t payload_offset = offset + header.header_size;
+  const uint64_t payload_size = header.size - header.header_size;
+  switch (header.type) {
+    case FOURCC_moov:
+      return CopyContainer(file, offset, header, nullptr, sample_tables,
+                           writer);
+    case FOURCC_trak: {
+      TrackTables trak_tables;
+      RCHECK(CopyContainer(file, offset, header, &trak_tables, sample_tables,
+                           writer));
+      (*sample_tables)[trak_tables.track_id] = trak_tables.boxes;
+      return true;
+    }
+    case FOURCC_mdia:
+    case FOURCC_minf:
+    case FOURCC_stbl:
+      if (!track)
+        break;
+      return CopyContainer(file, offset, header, track, sample_tables, writer);
+    case FOURCC_tkhd:
+      if (!track)
+        break;
+      {
+        // The track id follows the creation and modification times.
+        uint32_t version_and_flags = 0;
+        RCHECK(ReadUInt32At(file, payload_offset, &version_and_flags));
+        const uint64_t track_id_position =
+            (version_and_flags >> 24) == 1 ? 20 : 12;
+        RCHECK(payload_size >= track_id_position + sizeof(uint32_t));
+        RCHECK(ReadUInt32At(file, payload_offset + track_id_position,
+                            &track->track_id));
+      }
+      break;
+    case FOURCC_stts:
+      if (!track)
+        break;
+      return CopySampleTable(file, offset, header, kTableHeaderSize, 8, 0,
+                             &track->boxes.decoding_time, writer);
+    case FOURCC_ctts:
+      if (!track)
+        break;
+      {
+        // The first entry is needed to adjust the timestamps of the track.
+        uint32_t version_and_flags = 0;
+        RCHECK(ReadUInt32At(file, payload_offset, &version_and_flags));
+        track->boxes.composition_offset_version = version_and_flags >> 24;
+      }
+      return CopySampleTable(file, offset, header, kTableHeaderSize, 8, 1,
+                             &track->boxes.composition_offset, writer);
+    case FOURCC_stsz:
+      if (!track)
+        break;
+      {
+        // Version, flags, sample size and sample count.
+        const uint64_t kSampleSizeHeaderSize = 12;
+        uint32_t sample_size = 0;
+        RCHECK(ReadUInt32At(file, payload_offset + 4, &sample_size));
+        if (sample_size != 0)
+          break;
+        return CopySampleTable(file, offset, header, kSampleSizeHeaderSize, 4,
+                               0, &track->boxes.sample_size, writer);
+      }
+    case FOURCC_stco:
+      if (!track)
+        break;
+      return CopySampleTable(file, offset, header, kTableHeaderSize, 4, 0,
+                             &track->boxes.chunk_offset, writer);
+    case FOURCC_co64:
+      if (!track)
+        break;
+      track->boxes.large_chunk_offsets = true;
+      return CopySampleTable(file, offset, header, kTableHeaderSize, 8, 0,
+                             &track->boxes.chunk_offset, writer);
+    case FOURCC_stss:
+      if (!track)
+        break;
+      return CopySampleTable(file, offset, header, kTableHeaderSize, 4, 0,
+                             &track->boxes.sync_sample, writer);
+    default:
+      break;
+  }
+
+  // Other boxes are copied as is.
+  RCHECK(File::ReadAt(file, offset, header.size, writer->Grow(header.size)));
+  return true;
+}
+
+}  // namespace
+
+bool ReadMoovWithoutSampleTables(
+    File* file,
+    uint64_t moov_offset,
+    uint64_t moov_size,
+    std::vector<uint8_t>* moov_data,
+    std::map<uint32_t, SampleTableBoxLocations>* sample_tables) {
+  DCHECK(file);
+  DCHECK(moov_data);
+  DCHECK(sample_tables);
+
+  BoxHeader header;
+  RCHECK(ReadBoxHeader(file, moov_offset, moov_offset + moov_size, &header));
+  RCHECK(header.type == FOURCC_moov);
+  BufferWriter writer(0);
+  RCHECK(CopyBox(file, moov_offset, header, nullptr, sample_tables, &writer));
+  writer.SwapBuffer(moov_data);
+  return true;
+}
+
+SampleTableReader::EntryWindow::EntryWindow() = default;
+SampleTableReader::EntryWindow::~EntryWindow() = default;
+
+void SampleTableReader::EntryWindow::Init(File* file,
+                                          const SampleTableEntries& entries,
+                                          size_t entry_size,
+                                          size_t window_size) {
+  file_ = file;
+  next_offset_ = entries.offset;
+  entries_left_ = entries.present ? entries.entry_count : 0;
+  entry_size_ = entry_size;
+  entries_per_window_ = std::max<size_t>(1, window_size / entry_size);
+  window_.clear();
+  window_position_ = 0;
+  read_error_ = false;
+}
+
+const uint8_t* SampleTableReader::EntryWindow::Next() {
+  if (window_position_ == window_.size()) {
+    if (entries_left_ == 0)
+      return nullptr;
+    const size_t num_entries =
+        std::min<size_t>(entries_left_, entries_per_window_);
+    window_.resize(num_entries * entry_size_);
+    window_position_ = 0;
+    if (!File::ReadAt(file_, next_offset_, window_.size(), window_.data())) {
+      LOG(ERROR) << "Error reading " << window_.size()
+                 << " bytes of sample table entries at offset "
+                 << next_offset_;
+      window_.clear();
+      entries_left_ = 0;
+      read_error_ = true;
+      return nullptr;
+    }
+    next_offset_ += window_.size();
+    entries_left_ -= static_cast<uint32_t>(num_entries);
+  }
+  const uint8_t* entry = window_.data() + window_position_;
+  window_position_ += entry_size_;
+  return entry;
+}
+
+SampleTableReader::SampleTableReader(File* file,
+                                     const Track& track,
+                                     const SampleTableBoxLocations& boxes,
+                                     size_t window_size)
+    : file_(file),
+      boxes_(boxes),
+      sample_size_(track.media.information.sample_table.sample_size),
+      window_size_(window_size),
+      chunk_info_(track.media.information.sample_table.sample_to_chunk) {}
+
+SampleTableReader::~SampleTableReader() = default;
+
+bool SampleTableReader::Init() {
+  chunk_offsets_.Init(file_, boxes_.chunk_offset,
+                      boxes_.large_chunk_offsets ? 8 : 4, window_size_);
+  sample_sizes_.Init(file_, boxes_.sample_size, 4, window_size_);
+  decoding_times_.Init(file_, boxes_.decoding_time, 8, window_size_);
+  composition_offsets_.Init(file_, boxes_.composition_offset, 8,
+                            window_size_);
+  sync_samples_.Init(file_, boxes_.sync_sample, 4, window_size_);
+
+  num_chunks_ = boxes_.chunk_offset.entry_count;
+  if (num_chunks_ == 0)
+    return true;
+  RCHECK(chunk_info_.IsValid());
+  RCHECK(ReadNextChunkOffset());
+  if (boxes_.sync_sample.present)
+    RCHECK(ReadNextSyncSample());
+  return true;
+}
+
+bool SampleTableReader::ReadChunk(uint64_t* chunk_offset,
+                                  uint32_t* num_samples,
+                                  uint32_t* sample_description_index) {
+  DCHECK(HasNextChunk());
+  RCHECK(chunk_info_.current_chunk() == chunk_index_ + 1);
+  *chunk_offset = next_chunk_offset_;
+  *num_samples = chunk_info_.samples_per_chunk();
+  *sample_description_index = chunk_info_.sample_description_index();
+
+  chunk_info_.AdvanceChunk();
+  ++chunk_index_;
+  if (HasNextChunk())
+    RCHECK(ReadNextChunkOffset());
+  return true;
+}
+
+bool SampleTableReader::ReadSample(uint32_t* size,
+                                   uint32_t* duration,
+                                   int64_t* composition_offset,
+                                   bool* is_sync_sample) {
+  if (sample_size_.sample_size != 0) {
+    *size = sample_size_.sample_size;
+  } else if (boxes_.sample_size.present) {
+    const uint8_t* entry = sample_sizes_.Next();
+    RCHECK(entry);
+    BufferReader reader(entry, 4);
+    RCHECK(reader.Read4(size));
+  } else {
+    RCHECK(sample_number_ <= sample_size_.sizes.size());
+    *size = sample_size_.sizes[sample_number_ - 1];
+  }
+
+  while (decoding_time_samples_left_ == 0) {
+    const uint8_t* entry = decoding_times_.Next();
+    RCHECK(entry);
+    BufferReader reader(entry, 8);
+    RCHECK(reader.Read4(&decoding_time_samples_left_) &&
+           reader.Read4(&sample_delta_));
+  }
+  --decoding_time_samples_left_;
+  *duration = sample_delta_;
+
+  if (boxes_.composition_offset.present) {
+    while (composition_offset_samples_left_ == 0) {
+      const uint8_t* entry = composition_offsets_.Next();
+      RCHECK(entry);
+      BufferReader reader(entry, 8);
+      RCHECK(reader.Read4(&composition_offset_samples_left_));
+      if (boxes_.composition_offset_version == 0) {
+        uint32_t sample_offset = 0;
+        RCHECK(reader.Read4(&sample_offset));
+        sample_offset_ = sample_offset;
+      } else {
+        int32_t sample_offset = 0;
+        RCHECK(reader.Read4s(&sample_offset));
+        sample_offset_ = sample_offset;
+      }
+    }
+    --composition_offset_samples_left_;
+  }
+  *composition_offset = sample_offset_;
+
+  if (boxes_.sync_sample.present) {
+    *is_sync_sample =
+        has_next_sync_sample_ && next_sync_sample_ == sample_number_;
+    if (*is_sync_sample)
+      RCHECK(ReadNextSyncSample());
+  } else {
+    *is_sync_sample = true;
+  }
+
+  ++sample_number_;
+  return true;
+}
+
+bool SampleTableReader::ReadNextChunkOffset() {
+  const uint8_t* entry = chunk_offsets_.Next();
+  RCHECK(entry);
+  if (boxes_.large_chunk_offsets) {
+    BufferReader reader(entry, 8);
+    return reader.Read8(&next_chunk_offset_);
+  }
+  BufferReader reader(entry, 4);
+  uint32_t chunk_offset = 0;
+  RCHECK(reader.Read4(&chunk_offset));
+  next_chunk_offset_ = chunk_offset;
+  return true;
+}
+
+bool SampleTableReader::ReadNextSyncSample() {
+  // Sync samples are in increasing order. Entries not after the previous sync
+  // sample are skipped.
+  const uint32_t previous_sync_sample =
+      has_next_sync_sample_ ? next_sync_sample_ : 0;
+  has_next_sync_sample_ = false;
+  while (const uint8_t* entry = sync_samples_.Next()) {
+    BufferReader reader(entry, 4);
+    RCHECK(reader.Read4(&next_sync_sample_));
+    if (next_sync_sample_ > previous_sync_sample) {
+      has_next_sync_sample_ = true;
+      break;
+    }
+  }
+  return !sync_samples_.read_error();
+}
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
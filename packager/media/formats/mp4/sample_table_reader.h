@@ -0,0 +1,180 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_FORMATS_MP4_SAMPLE_TABLE_READER_H_
+#define PACKAGER_MEDIA_FORMATS_MP4_SAMPLE_TABLE_READER_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/media/formats/mp4/chunk_info_iterator.h"
+
+namespace shaka {
+
+class File;
+
+namespace media {
+namespace mp4 {
+
+/// Location of the entries of a sample table box in a file.
+struct SampleTableEntries {
+  bool present = false;
+  /// File offset of the first entry.
+  uint64_t offset = 0;
+  uint32_t entry_count = 0;
+};
+
+/// Location of the sample tables of a track which are left out of the 'moov'
+/// box returned by ReadMoovWithoutSampleTables().
+struct SampleTableBoxLocations {
+  /// 'stts' entries.
+  SampleTableEntries decoding_time;
+  /// 'ctts' entries.
+  SampleTableEntries composition_offset;
+  uint8_t composition_offset_version = 0;
+  /// 'stsz' entries. Not present if the samples are of constant size or if
+  /// the sizes are in a 'stz2' box, which is kept in the 'moov' box.
+  SampleTableEntries sample_size;
+  /// 'stco' or 'co64' entries.
+  SampleTableEntries chunk_offset;
+  bool large_chunk_offsets = false;
+  /// 'stss' entries. Not present if every sample is a sync sample.
+  SampleTableEntries sync_sample;
+};
+
+/// Reads the 'moov' box of @a file without the entries of the sample tables
+/// that grow with the number of samples, i.e. 'stts', 'ctts', 'stsz', 'stco',
+/// 'co64' and 'stss'. These boxes are kept in @a moov_data with no entries,
+/// except for the first 'ctts' entry, and their entries are located in
+/// @a sample_tables instead.
+/// @param moov_offset is the file offset of the 'moov' box.
+/// @param moov_size is the size of the 'moov' box.
+/// @param[out] moov_data gets the 'moov' box.
+/// @param[out] sample_tables gets the sample table locations, by track id.
+/// @return true on success, false otherwise.
+bool ReadMoovWithoutSampleTables(
+    File* file,
+    uint64_t moov_offset,
+    uint64_t moov_size,
+    std::vector<uint8_t>* moov_data,
+    std::map<uint32_t, SampleTableBoxLocations>* sample_tables);
+
+/// Reads the chunks and samples of a track from sample tables located with
+/// ReadMoovWithoutSampleTables(). The entries are read from the file in
+/// windows of bounded size as they are needed, so memory use does not grow
+/// with the number of samples. 'stsc' and 'stz2' are read from the 'moov'
+/// box.
+class SampleTableReader {
+ public:
+  /// @param file is the file to read the entries from. It must outlive the
+  ///        reader.
+  /// @param track is the track, parsed from the 'moov' box returned by
+  ///        ReadMoovWithoutSampleTables(). It must outlive the reader.
+  /// @param boxes is the location of the sample tables of @a track.
+  /// @param window_size is the maximum size in bytes of the entries of a table
+  ///        kept in memory.
+  SampleTableReader(File* file,
+                    const Track& track,
+                    const SampleTableBoxLocations& boxes,
+                    size_t window_size);
+  ~SampleTableReader();
+
+  /// Reads the first entries of the tables.
+  /// @return true on success, false otherwise.
+  bool Init();
+
+  /// @return true if there is another chunk to read.
+  bool HasNextChunk() const { return chunk_index_ < num_chunks_; }
+  /// @return the file offset of the next chunk. Only valid if HasNextChunk().
+  uint64_t next_chunk_offset() const { return next_chunk_offset_; }
+
+  /// Advances to the next chunk, whose samples are then read with
+  /// ReadSample(). Requires HasNextChunk().
+  /// @param[out] chunk_offset gets the file offset of the chunk.
+  /// @param[out] num_samples gets the number of samples in the chunk.
+  /// @param[out] sample_description_index gets the one-based index of the
+  ///             sample description of the chunk.
+  /// @return true on success, false otherwise.
+  bool ReadChunk(uint64_t* chunk_offset,
+                 uint32_t* num_samples,
+                 uint32_t* sample_description_index);
+
+  /// Reads the next sample.
+  /// @return true on success, false otherwise.
+  bool ReadSample(uint32_t* size,
+                  uint32_t* duration,
+                  int64_t* composition_offset,
+                  bool* is_sync_sample);
+
+ private:
+  // Entries of a sample table box, read in windows of bounded size.
+  class EntryWindow {
+   public:
+    EntryWindow();
+    ~EntryWindow();
+
+    void Init(File* file,
+              const SampleTableEntries& entries,
+              size_t entry_size,
+              size_t window_size);
+    // @return the next entry, or null past the last entry or on read error.
+    const uint8_t* Next();
+    bool read_error() const { return read_error_; }
+
+   private:
+    File* file_ = nullptr;
+    uint64_t next_offset_ = 0;
+    uint32_t entries_left_ = 0;
+    size_t entry_size_ = 0;
+    size_t entries_per_window_ = 0;
+    std::vector<uint8_t> window_;
+    size_t window_position_ = 0;
+    bool read_error_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(EntryWindow);
+  };
+
+  bool ReadNextChunkOffset();
+  bool ReadNextSyncSample();
+
+  File* const file_;
+  const SampleTableBoxLocations boxes_;
+  const SampleSize& sample_size_;
+  const size_t window_size_;
+
+  ChunkInfoIterator chunk_info_;
+  EntryWindow chunk_offsets_;
+  EntryWindow sample_sizes_;
+  EntryWindow decoding_times_;
+  EntryWindow composition_offsets_;
+  EntryWindow sync_samples_;
+
+  uint32_t num_chunks_ = 0;
+  uint32_t chunk_index_ = 0;
+  uint64_t next_chunk_offset_ = 0;
+  // One-based number of the next sample.
+  uint32_t sample_number_ = 1;
+  // Samples left in the current 'stts' and 'ctts' entries.
+  uint32_t decoding_time_samples_left_ = 0;
+  uint32_t sample_delta_ = 0;
+  uint32_t composition_offset_samples_left_ = 0;
+  int64_t sample_offset_ = 0;
+  // One-based number of the next sync sample, if any.
+  bool has_next_sync_sample_ = false;
+  uint32_t next_sync_sample_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(SampleTableReader);
+};
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_FORMATS_MP4_SAMPLE_TABLE_READER_H_
@@ -7,8 +7,10 @@
 #include "packager/media/formats/mp4/segmenter.h"
 
 #include <algorithm>
+#include <limits>
 
 #include "packager/base/logging.h"
+#include "packager/media/base/buffer_chain.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/id3_tag.h"
 #include "packager/media/base/media_sample.h"
@@ -36,6 +38,8 @@ uint64_t Rescale(uint64_t time_in_old_scale,
 
 }  // namespace
 
+const uint64_t Segmenter::kFreeBoxHeaderSize;
+
 Segmenter::Segmenter(const MuxerOptions& options,
                      std::unique_ptr<FileType> ftyp,
                      std::unique_ptr<Movie> moov)
@@ -43,7 +47,7 @@ Segmenter::Segmenter(const MuxerOptions& options,
       ftyp_(std::move(ftyp)),
       moov_(std::move(moov)),
       moof_(new MovieFragment()),
-      fragment_buffer_(new BufferWriter()),
+      fragment_buffer_(new BufferChain()),
       sidx_(new SegmentIndex()) {}
 
 Segmenter::~Segmenter() {}
@@ -198,9 +202,11 @@ Status Segmenter::FinalizeSegment(size_t stream_id,
 
   const uint64_t moof_start_offset = fragment_buffer_->Size();
 
-  // Write the fragment to buffer.
-  moof_->Write(fragment_buffer_.get());
-  mdat.WriteHeader(fragment_buffer_.get());
+  // Write the fragment to buffer. The sample data is referenced, not copied.
+  BufferWriter fragment_header;
+  moof_->Write(&fragment_header);
+  mdat.WriteHeader(&fragment_header);
+  fragment_buffer_->AppendBuffer(&fragment_header);
 
   bool first_key_frame = true;
   for (const std::unique_ptr<Fragmenter>& fragmenter : fragmenters_) {
@@ -216,7 +222,7 @@ Status Segmenter::FinalizeSegment(size_t stream_id,
           {key_frame_info.timestamp, moof_start_offset,
            fragment_buffer_->Size() - moof_start_offset + key_frame_info.size});
     }
-    fragment_buffer_->AppendBuffer(*fragmenter->data());
+    fragment_buffer_->AppendChain(*fragmenter->data());
   }
 
   // Increase sequence_number for next fragment.
@@ -224,6 +230,9 @@ Status Segmenter::FinalizeSegment(size_t stream_id,
 
   for (std::unique_ptr<Fragmenter>& fragmenter : fragmenters_)
     fragmenter->ClearFragmentFinalized();
+  status = DoFinalizeFragment(!segment_info.is_subsegment);
+  if (!status.ok())
+    return status;
   if (!segment_info.is_subsegment) {
     Status status = DoFinalizeSegment();
     // Reset segment information to initial state.
@@ -234,6 +243,10 @@ Status Segmenter::FinalizeSegment(size_t stream_id,
   return Status::OK;
 }
 
+Status Segmenter::DoFinalizeFragment(bool is_last_fragment_in_segment) {
+  return Status::OK;
+}
+
 uint32_t Segmenter::GetReferenceTimeScale() const {
   return moov_->header.timescale;
 }
@@ -247,6 +260,14 @@ double Segmenter::GetDuration() const {
   return static_cast<double>(duration) / moov_->header.timescale;
 }
 
+void Segmenter::AppendFreeBox(uint64_t size, BufferWriter* buffer) {
+  DCHECK_GE(size, kFreeBoxHeaderSize);
+  DCHECK_LE(size, std::numeric_limits<uint32_t>::max());
+  buffer->AppendInt(static_cast<uint32_t>(size));
+  buffer->AppendInt(static_cast<uint32_t>(FOURCC_free));
+  buffer->AppendVector(std::vector<uint8_t>(size - kFreeBoxHeaderSize, 0));
+}
+
 void Segmenter::UpdateProgress(uint64_t progress) {
   accumulated_progress_ += progress;
 
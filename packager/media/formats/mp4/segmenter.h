@@ -24,6 +24,7 @@ struct EncryptionConfig;
 struct MuxerOptions;
 struct SegmentInfo;
 
+class BufferChain;
 class BufferWriter;
 class MediaSample;
 class MuxerListener;
@@ -101,6 +102,13 @@ class Segmenter {
   uint32_t sample_duration() const { return sample_duration_; }
 
  protected:
+  /// Size of the header of a 'free' box.
+  static const uint64_t kFreeBoxHeaderSize = 8;
+
+  /// Appends a 'free' box of @a size bytes, including the box header, e.g.
+  /// to reserve space in the file for boxes written later.
+  static void AppendFreeBox(uint64_t size, BufferWriter* buffer);
+
   /// Update segmentation progress using ProgressListener.
   void UpdateProgress(uint64_t progress);
   /// Set progress to 100%.
@@ -109,7 +117,8 @@ class Segmenter {
   const MuxerOptions& options() const { return options_; }
   FileType* ftyp() { return ftyp_.get(); }
   Movie* moov() { return moov_.get(); }
-  BufferWriter* fragment_buffer() { return fragment_buffer_.get(); }
+  MovieFragment* moof() { return moof_.get(); }
+  BufferChain* fragment_buffer() { return fragment_buffer_.get(); }
   SegmentIndex* sidx() { return sidx_.get(); }
   MuxerListener* muxer_listener() { return muxer_listener_; }
   uint64_t progress_target() { return progress_target_; }
@@ -125,6 +134,10 @@ class Segmenter {
   virtual Status DoInitialize() = 0;
   virtual Status DoFinalize() = 0;
   virtual Status DoFinalizeSegment() = 0;
+  // Called after a fragment is appended to fragment_buffer(), before
+  // DoFinalizeSegment() if it is the last fragment of the segment. The default
+  // implementation does nothing.
+  virtual Status DoFinalizeFragment(bool is_last_fragment_in_segment);
 
   uint32_t GetReferenceStreamId();
 
@@ -137,7 +150,7 @@ class Segmenter {
   std::unique_ptr<FileType> ftyp_;
   std::unique_ptr<Movie> moov_;
   std::unique_ptr<MovieFragment> moof_;
-  std::unique_ptr<BufferWriter> fragment_buffer_;
+  std::unique_ptr<BufferChain> fragment_buffer_;
   std::unique_ptr<SegmentIndex> sidx_;
   std::vector<std::unique_ptr<Fragmenter>> fragmenters_;
   MuxerListener* muxer_listener_ = nullptr;
@@ -7,9 +7,11 @@
 #include "packager/media/formats/mp4/single_segment_segmenter.h"
 
 #include <algorithm>
+#include <limits>
 
 #include "packager/file/file.h"
 #include "packager/file/file_util.h"
+#include "packager/media/base/buffer_chain.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/event/progress_listener.h"
@@ -19,6 +21,24 @@
 namespace shaka {
 namespace media {
 namespace mp4 {
+namespace {
+
+// Appends the byte ranges of the subsegments in |references|, which start at
+// |*offset|, to |ranges|, and advances |*offset| past them.
+void AppendSubsegmentRanges(const std::vector<SegmentReference>& references,
+                            uint64_t* offset,
+                            std::vector<Range>* ranges) {
+  for (const SegmentReference& segment_reference : references) {
+    Range r;
+    r.start = *offset;
+    // Ranges are inclusive, so -1 to the size.
+    r.end = r.start + segment_reference.referenced_size - 1;
+    *offset = r.end + 1;
+    ranges->push_back(r);
+  }
+}
+
+}  // namespace
 
 SingleSegmentSegmenter::SingleSegmentSegmenter(const MuxerOptions& options,
                                                std::unique_ptr<FileType> ftyp,
@@ -26,6 +46,8 @@ SingleSegmentSegmenter::SingleSegmentSegmenter(const MuxerOptions& options,
     : Segmenter(options, std::move(ftyp), std::move(moov)) {}
 
 SingleSegmentSegmenter::~SingleSegmentSegmenter() {
+  if (output_file_)
+    output_file_.release()->Close();
   if (temp_file_)
     temp_file_.release()->Close();
   if (!temp_file_name_.empty()) {
@@ -58,18 +80,24 @@ std::vector<Range> SingleSegmentSegmenter::GetSegmentRanges() {
                               ? vod_sidx_->ComputeSize()
                               : 0) +
                          vod_sidx_->first_offset;
-  for (const SegmentReference& segment_reference : vod_sidx_->references) {
-    Range r;
-    r.start = next_offset;
-    // Ranges are inclusive, so -1 to the size.
-    r.end = r.start + segment_reference.referenced_size - 1;
-    next_offset = r.end + 1;
-    ranges.push_back(r);
+  if (subsidiary_sidxes_.empty()) {
+    AppendSubsegmentRanges(vod_sidx_->references, &next_offset, &ranges);
+    return ranges;
+  }
+  // The subsegments follow their subsidiary 'sidx'.
+  for (SegmentIndex& sidx : subsidiary_sidxes_) {
+    next_offset += sidx.ComputeSize();
+    AppendSubsegmentRanges(sidx.references, &next_offset, &ranges);
   }
   return ranges;
 }
 
 Status SingleSegmentSegmenter::DoInitialize() {
+  if (options().mp4_params.vod_header_reserved_size > 0 &&
+      InitializeInPlaceOutput()) {
+    return Status::OK;
+  }
+
   // Single segment segmentation involves two stages:
   //   Stage 1: Create media subsegments from media samples
   //   Stage 2: Update media header (moov) which involves copying of media
@@ -77,7 +105,62 @@ Status SingleSegmentSegmenter::DoInitialize() {
   // Assumes stage 2 takes similar amount of time as stage 1. The previous
   // progress_target was set for stage 1. Times two to account for stage 2.
   set_progress_target(progress_target() * 2);
+  return InitializeTempFile();
+}
+
+Status SingleSegmentSegmenter::DoFinalize() {
+  DCHECK(ftyp());
+  DCHECK(moov());
+  DCHECK(vod_sidx_);
+
+  const size_t max_sidx_references = options().mp4_params.max_sidx_references;
+  if (options().mp4_params.generate_sidx_in_media_segments &&
+      max_sidx_references > 0 &&
+      vod_sidx_->references.size() > max_sidx_references) {
+    BuildSidxHierarchy();
+  }
+
+  if (output_file_)
+    return FinalizeInPlace();
+  // The target of 2nd stage of single segment segmentation.
+  return FinalizeWithTempFile(progress_target() * 0.5);
+}
 
+bool SingleSegmentSegmenter::InitializeInPlaceOutput() {
+  const uint64_t reserved_size = options().mp4_params.vod_header_reserved_size;
+  const uint64_t init_size = ftyp()->ComputeSize() + moov()->ComputeSize();
+  if (reserved_size > std::numeric_limits<uint32_t>::max() ||
+      reserved_size < init_size + kFreeBoxHeaderSize) {
+    LOG(WARNING) << "Ignoring reserved header size " << reserved_size
+                 << ": it should be at least " << init_size + kFreeBoxHeaderSize
+                 << " bytes and fit in 32 bits.";
+    return false;
+  }
+
+  output_file_.reset(File::Open(options().output_file_name.c_str(), "w"));
+  if (!output_file_)
+    return false;
+  if (!output_file_->Seek(0)) {
+    LOG(WARNING) << "Output file '" << options().output_file_name
+                 << "' does not support seeking. Media will be written to a "
+                    "temporary file instead.";
+    output_file_.release()->Close();
+    return false;
+  }
+
+  // Fill the reserved space with a 'free' box, which is rewritten with the
+  // headers in FinalizeInPlace().
+  BufferWriter buffer;
+  AppendFreeBox(reserved_size, &buffer);
+  if (!buffer.WriteToFile(output_file_.get()).ok()) {
+    output_file_.release()->Close();
+    return false;
+  }
+  reserved_header_size_ = reserved_size;
+  return true;
+}
+
+Status SingleSegmentSegmenter::InitializeTempFile() {
   if (!TempFilePath(options().temp_dir, &temp_file_name_))
     return Status(error::FILE_FAILURE, "Unable to create temporary file.");
   temp_file_.reset(File::Open(temp_file_name_.c_str(), "w"));
@@ -87,11 +170,97 @@ Status SingleSegmentSegmenter::DoInitialize() {
                       "Cannot open file to write " + temp_file_name_);
 }
 
-Status SingleSegmentSegmenter::DoFinalize() {
+Status SingleSegmentSegmenter::FinalizeInPlace() {
+  DCHECK(output_file_);
+
+  // Subsidiary 'sidx' boxes are interleaved with the media, so it has to be
+  // moved anyway.
+  if (!subsidiary_sidxes_.empty()) {
+    RETURN_IF_ERROR(MoveMediaToTempFile());
+    return FinalizeWithTempFile(0);
+  }
+
+  const bool write_sidx = options().mp4_params.generate_sidx_in_media_segments;
+  vod_sidx_->first_offset = 0;
+  const uint64_t header_size = ftyp()->ComputeSize() + moov()->ComputeSize() +
+                               (write_sidx ? vod_sidx_->ComputeSize() : 0);
+  const uint64_t padding_size = reserved_header_size_ > header_size
+                                    ? reserved_header_size_ - header_size
+                                    : 0;
+  if (header_size > reserved_header_size_ ||
+      (padding_size > 0 && padding_size < kFreeBoxHeaderSize)) {
+    LOG(WARNING) << "Headers of " << header_size
+                 << " bytes do not fit in the reserved space of "
+                 << reserved_header_size_
+                 << " bytes. Rewriting the file through a temporary file.";
+    RETURN_IF_ERROR(MoveMediaToTempFile());
+    return FinalizeWithTempFile(0);
+  }
+
+  // The 'free' box sits between the headers and the first 'moof', which 'sidx'
+  // accounts for with |first_offset|.
+  vod_sidx_->first_offset = padding_size;
+
+  LOG(INFO) << "Update media header (moov) in place in '"
+            << options().output_file_name << "'.";
+
+  BufferWriter buffer;
+  ftyp()->Write(&buffer);
+  moov()->Write(&buffer);
+  if (write_sidx)
+    vod_sidx_->Write(&buffer);
+  if (padding_size > 0)
+    AppendFreeBox(padding_size, &buffer);
+  DCHECK_EQ(reserved_header_size_, buffer.Size());
+
+  if (!output_file_->Seek(0)) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot seek in file " + options().output_file_name);
+  }
+  Status status = buffer.WriteToFile(output_file_.get());
+  if (!status.ok())
+    return status;
+  if (!output_file_.release()->Close()) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close file " + options().output_file_name +
+            ", possibly file permission issue or running out of disk space.");
+  }
+  SetComplete();
+  return Status::OK;
+}
+
+Status SingleSegmentSegmenter::MoveMediaToTempFile() {
+  DCHECK(output_file_);
+  if (!output_file_.release()->Close()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot close file " + options().output_file_name);
+  }
+  RETURN_IF_ERROR(InitializeTempFile());
+
+  std::unique_ptr<File, FileCloser> output_file(
+      File::Open(options().output_file_name.c_str(), "r"));
+  if (!output_file) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file to read " + options().output_file_name);
+  }
+  if (!output_file->Seek(reserved_header_size_)) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot seek in file " + options().output_file_name);
+  }
+  if (File::CopyFile(output_file.get(), temp_file_.get()) < 0) {
+    return Status(error::FILE_FAILURE,
+                  "Failed to copy media to " + temp_file_name_);
+  }
+  return Status::OK;
+}
+
+Status SingleSegmentSegmenter::FinalizeWithTempFile(
+    uint64_t re_segment_progress_target) {
   DCHECK(temp_file_);
-  DCHECK(ftyp());
-  DCHECK(moov());
-  DCHECK(vod_sidx_);
+
+  // The media starts right after the headers.
+  vod_sidx_->first_offset = 0;
 
   // Close the temp file to prepare for reading later.
   if (!temp_file_.release()->Close()) {
@@ -131,26 +300,25 @@ Status SingleSegmentSegmenter::DoFinalize() {
                   "Cannot open file to read " + temp_file_name_);
   }
 
-  // The target of 2nd stage of single segment segmentation.
-  const uint64_t re_segment_progress_target = progress_target() * 0.5;
-
-  const int kBufSize = 0x200000;  // 2MB.
-  std::unique_ptr<uint8_t[]> buf(new uint8_t[kBufSize]);
-  while (true) {
-    int64_t size = temp_file->Read(buf.get(), kBufSize);
-    if (size == 0) {
-      break;
-    } else if (size < 0) {
-      return Status(error::FILE_FAILURE,
-                    "Failed to read file " + temp_file_name_);
-    }
-    int64_t size_written = file->Write(buf.get(), size);
-    if (size_written != size) {
-      return Status(error::FILE_FAILURE,
-                    "Failed to write file " + options().output_file_name);
+  const size_t kBufSize = 0x200000;  // 2MB.
+  std::vector<uint8_t> buf(kBufSize);
+  const double progress_per_byte =
+      static_cast<double>(re_segment_progress_target) / temp_file->Size();
+  if (subsidiary_sidxes_.empty()) {
+    RETURN_IF_ERROR(CopyFromTempFile(temp_file.get(),
+                                     std::numeric_limits<uint64_t>::max(),
+                                     &buf, progress_per_byte, file.get()));
+  } else {
+    // Each subsidiary 'sidx' is followed by the subsegments it references.
+    for (size_t i = 0; i < subsidiary_sidxes_.size(); ++i) {
+      BufferWriter sidx_buffer;
+      subsidiary_sidxes_[i].Write(&sidx_buffer);
+      const uint64_t media_size =
+          vod_sidx_->references[i].referenced_size - sidx_buffer.Size();
+      RETURN_IF_ERROR(sidx_buffer.WriteToFile(file.get()));
+      RETURN_IF_ERROR(CopyFromTempFile(temp_file.get(), media_size, &buf,
+                                       progress_per_byte, file.get()));
     }
-    UpdateProgress(static_cast<double>(size) / temp_file->Size() *
-                   re_segment_progress_target);
   }
   if (!temp_file.release()->Close()) {
     return Status(error::FILE_FAILURE, "Cannot close the temp file " +
@@ -166,6 +334,67 @@ Status SingleSegmentSegmenter::DoFinalize() {
   return Status::OK;
 }
 
+Status SingleSegmentSegmenter::CopyFromTempFile(File* temp_file,
+                                                uint64_t size,
+                                                std::vector<uint8_t>* buffer,
+                                                double progress_per_byte,
+                                                File* file) {
+  const bool copy_to_end = size == std::numeric_limits<uint64_t>::max();
+  while (size > 0) {
+    const uint64_t bytes_to_read =
+        std::min(size, static_cast<uint64_t>(buffer->size()));
+    int64_t bytes_read = temp_file->Read(buffer->data(), bytes_to_read);
+    if (bytes_read == 0 && copy_to_end) {
+      break;
+    } else if (bytes_read <= 0) {
+      return Status(error::FILE_FAILURE,
+                    "Failed to read file " + temp_file_name_);
+    }
+    int64_t bytes_written = file->Write(buffer->data(), bytes_read);
+    if (bytes_written != bytes_read) {
+      return Status(error::FILE_FAILURE,
+                    "Failed to write file " + options().output_file_name);
+    }
+    size -= bytes_read;
+    UpdateProgress(bytes_read * progress_per_byte);
+  }
+  return Status::OK;
+}
+
+void SingleSegmentSegmenter::BuildSidxHierarchy() {
+  // A 'sidx' cannot hold more references than this.
+  const size_t max_references =
+      std::min(static_cast<size_t>(options().mp4_params.max_sidx_references),
+               static_cast<size_t>(std::numeric_limits<uint16_t>::max()));
+  std::vector<SegmentReference> references;
+  references.swap(vod_sidx_->references);
+  for (size_t begin = 0; begin < references.size(); begin += max_references) {
+    const size_t end = std::min(begin + max_references, references.size());
+    const SegmentReference& first_reference = references[begin];
+
+    SegmentIndex sidx;
+    sidx.reference_id = vod_sidx_->reference_id;
+    sidx.timescale = vod_sidx_->timescale;
+    sidx.earliest_presentation_time =
+        first_reference.earliest_presentation_time;
+    sidx.references.assign(references.begin() + begin,
+                           references.begin() + end);
+
+    // The reference covers the subsidiary 'sidx' and its subsegments, and
+    // starts where its first subsegment does.
+    SegmentReference sidx_reference = first_reference;
+    sidx_reference.reference_type = true;
+    sidx_reference.referenced_size = sidx.ComputeSize();
+    sidx_reference.subsegment_duration = 0;
+    for (const SegmentReference& reference : sidx.references) {
+      sidx_reference.referenced_size += reference.referenced_size;
+      sidx_reference.subsegment_duration += reference.subsegment_duration;
+    }
+    vod_sidx_->references.push_back(sidx_reference);
+    subsidiary_sidxes_.push_back(std::move(sidx));
+  }
+}
+
 Status SingleSegmentSegmenter::DoFinalizeSegment() {
   DCHECK(sidx());
   DCHECK(fragment_buffer());
@@ -216,9 +445,11 @@ Status SingleSegmentSegmenter::DoFinalizeSegment() {
                                    key_frame_info.size);
     }
   }
-  // Append fragment buffer to temp file.
+  // Append fragment buffer to the output file if media is written in place, or
+  // to the temp file otherwise.
   size_t segment_size = fragment_buffer()->Size();
-  Status status = fragment_buffer()->WriteToFile(temp_file_.get());
+  Status status = fragment_buffer()->WriteToFile(
+      output_file_ ? output_file_.get() : temp_file_.get());
   if (!status.ok()) return status;
 
   UpdateProgress(vod_ref.subsegment_duration);
@@ -45,9 +45,43 @@ class SingleSegmentSegmenter : public Segmenter {
   Status DoFinalize() override;
   Status DoFinalizeSegment() override;
 
+  // Opens the output file and reserves
+  // |Mp4OutputParams.vod_header_reserved_size| bytes at its beginning, so
+  // media can be written in place. Returns false if the output does not
+  // support it, in which case the temporary file is used instead.
+  bool InitializeInPlaceOutput();
+  Status InitializeTempFile();
+  // Writes the headers into the reserved space at the beginning of the output
+  // file. Falls back to FinalizeWithTempFile() if they do not fit.
+  Status FinalizeInPlace();
+  // Writes the headers followed by the media in the temporary file to the
+  // output file.
+  Status FinalizeWithTempFile(uint64_t re_segment_progress_target);
+  // Copies |size| bytes, or everything up to the end of the file if |size| is
+  // the maximum uint64_t, from |temp_file| to |file| through |buffer|.
+  Status CopyFromTempFile(File* temp_file,
+                          uint64_t size,
+                          std::vector<uint8_t>* buffer,
+                          double progress_per_byte,
+                          File* file);
+  // Moves the media written in place in the output file to a temporary file.
+  Status MoveMediaToTempFile();
+  // Moves the references of |vod_sidx_| to subsidiary 'sidx' boxes of at most
+  // |Mp4OutputParams.max_sidx_references| references each, and makes
+  // |vod_sidx_| reference these boxes instead.
+  void BuildSidxHierarchy();
+
   std::unique_ptr<SegmentIndex> vod_sidx_;
+  // Subsidiary 'sidx' boxes of a hierarchical index, each written right before
+  // the subsegments it references. Empty if |vod_sidx_| references the
+  // subsegments directly.
+  std::vector<SegmentIndex> subsidiary_sidxes_;
   std::string temp_file_name_;
   std::unique_ptr<File, FileCloser> temp_file_;
+  // Output file when media is written in place, i.e. after a reserved space of
+  // |reserved_header_size_| bytes for the headers.
+  std::unique_ptr<File, FileCloser> output_file_;
+  uint64_t reserved_header_size_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(SingleSegmentSegmenter);
 };
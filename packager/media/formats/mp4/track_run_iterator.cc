@@ -10,9 +10,16 @@ DEFINE_bool(mp4_reset_initial_composition_offset_to_zero,
             true,
             "MP4 only. If it is true, reset the initial composition offset to "
             "zero, i.e. by assuming that there is a missing EditList.");
+DEFINE_uint64(mp4_sample_table_window_size,
+              64 * 1024,
+              "MP4 only. Maximum size in bytes of the entries of each sample "
+              "table kept in memory when a non-fragmented file is read with "
+              "random access. The sample tables are read as the samples are "
+              "read, so memory use does not grow with the number of samples.");
 
 #include <algorithm>
 #include <limits>
+#include <utility>
 
 #include "packager/media/base/buffer_reader.h"
 #include "packager/media/base/fourccs.h"
@@ -37,16 +44,16 @@ namespace shaka {
 namespace media {
 namespace mp4 {
 
-struct SampleInfo {
-  int64_t size;
-  int64_t duration;
-  int64_t cts_offset;
-  bool is_keyframe;
+// Locates the CENC information of a sample in the arrays of its run.
+struct SampleEncryptionInfo {
+  size_t iv_offset;
+  uint8_t iv_size;
+  size_t subsample_offset;
+  uint16_t subsample_count;
 };
 
 struct TrackRunInfo {
   uint32_t track_id;
-  std::vector<SampleInfo> samples;
   int64_t timescale;
   int64_t start_dts;
   int64_t sample_start_offset;
@@ -55,19 +62,49 @@ struct TrackRunInfo {
   const AudioSampleEntry* audio_description;
   const VideoSampleEntry* video_description;
 
-  // Stores sample encryption entries, which is populated from 'senc' box if it
-  // is available, otherwise will try to load from cenc auxiliary information.
-  std::vector<SampleEncryptionEntry> sample_encryption_entries;
+  // Stores the sample encryption information, which is populated from 'senc'
+  // box if it is available, otherwise will try to load from cenc auxiliary
+  // information. The IVs and the subsamples of all the samples of the run are
+  // stored in two flat arrays, so parsing them does not allocate per sample.
+  std::vector<SampleEncryptionInfo> sample_encryption_info;
+  std::vector<uint8_t> sample_ivs;
+  std::vector<SubsampleEntry> sample_subsamples;
 
-  // These variables are useful to load |sample_encryption_entries| from cenc
+  // These variables are useful to load |sample_encryption_info| from cenc
   // auxiliary information when 'senc' box is not available.
   int64_t aux_info_start_offset;  // Only valid if aux_info_total_size > 0.
   int aux_info_default_size;
   std::vector<uint8_t> aux_info_sizes;  // Populated if default_size == 0.
   int aux_info_total_size;
 
+  // The sample table of the run is stored as one array per field, which keeps
+  // runs with many samples compact and cache-friendly to iterate. Offsets and
+  // decoding times are prefix sums, so any sample is looked up in O(1).
+  // |sample_offsets| and |sample_dts| have one more entry than there are
+  // samples: the offset and the decoding time just past the last sample.
+  std::vector<int64_t> sample_offsets;
+  std::vector<int64_t> sample_dts;
+  // Empty if the composition offsets of all the samples are zero.
+  std::vector<int64_t> cts_offsets;
+  std::vector<bool> is_keyframes;
+
   TrackRunInfo();
   ~TrackRunInfo();
+
+  size_t num_samples() const { return is_keyframes.size(); }
+
+  // Starts the sample table. |sample_start_offset| and |start_dts| should be
+  // set.
+  void InitSamples(size_t num_samples);
+  void AddSample(int64_t size,
+                 int64_t duration,
+                 int64_t cts_offset,
+                 bool is_keyframe);
+  // Parses the sample encryption entry of the next sample from |reader|,
+  // appending its IV and subsamples to the arrays of the run.
+  bool ParseSampleEncryptionEntry(uint8_t iv_size,
+                                  bool has_subsamples,
+                                  BufferReader* reader);
 };
 
 TrackRunInfo::TrackRunInfo()
@@ -83,39 +120,98 @@ TrackRunInfo::TrackRunInfo()
       aux_info_total_size(0) {}
 TrackRunInfo::~TrackRunInfo() {}
 
+bool TrackRunInfo::ParseSampleEncryptionEntry(uint8_t iv_size,
+                                              bool has_subsamples,
+                                              BufferReader* reader) {
+  SampleEncryptionInfo info;
+  info.iv_offset = sample_ivs.size();
+  info.iv_size = iv_size;
+  info.subsample_offset = sample_subsamples.size();
+  info.subsample_count = 0;
+
+  RCHECK(reader->HasBytes(iv_size));
+  sample_ivs.insert(sample_ivs.end(), reader->data() + reader->pos(),
+                    reader->data() + reader->pos() + iv_size);
+  RCHECK(reader->SkipBytes(iv_size));
+
+  if (has_subsamples) {
+    RCHECK(reader->Read2(&info.subsample_count));
+    RCHECK(info.subsample_count > 0);
+    for (uint16_t i = 0; i < info.subsample_count; ++i) {
+      SubsampleEntry subsample;
+      RCHECK(reader->Read2(&subsample.clear_bytes) &&
+             reader->Read4(&subsample.cipher_bytes));
+      sample_subsamples.push_back(subsample);
+    }
+  }
+  sample_encryption_info.push_back(info);
+  return true;
+}
+
+void TrackRunInfo::InitSamples(size_t num_samples) {
+  sample_offsets.reserve(num_samples + 1);
+  sample_offsets.assign(1, sample_start_offset);
+  sample_dts.reserve(num_samples + 1);
+  sample_dts.assign(1, start_dts);
+  cts_offsets.clear();
+  is_keyframes.reserve(num_samples);
+  is_keyframes.clear();
+}
+
+void TrackRunInfo::AddSample(int64_t size,
+                             int64_t duration,
+                             int64_t cts_offset,
+                             bool is_keyframe) {
+  DCHECK(!sample_offsets.empty() && !sample_dts.empty());
+  sample_offsets.push_back(sample_offsets.back() + size);
+  sample_dts.push_back(sample_dts.back() + duration);
+  // The composition offsets are only stored from the first non-zero one.
+  if (cts_offset != 0 && cts_offsets.empty())
+    cts_offsets.resize(is_keyframes.size(), 0);
+  if (!cts_offsets.empty())
+    cts_offsets.push_back(cts_offset);
+  is_keyframes.push_back(is_keyframe);
+}
+
+struct StreamingTrack {
+  const Track* track;
+  std::unique_ptr<SampleTableReader> sample_table_reader;
+  int64_t next_run_start_dts;
+};
+
 TrackRunIterator::TrackRunIterator(const Movie* moov)
-    : moov_(moov), sample_dts_(0), sample_offset_(0) {
+    : moov_(moov), sample_index_(0) {
   CHECK(moov);
 }
 
 TrackRunIterator::~TrackRunIterator() {}
 
-static void PopulateSampleInfo(const TrackExtends& trex,
-                               const TrackFragmentHeader& tfhd,
-                               const TrackFragmentRun& trun,
-                               const size_t i,
-                               SampleInfo* sample_info) {
+static void AddTrackFragmentRunSample(const TrackExtends& trex,
+                                      const TrackFragmentHeader& tfhd,
+                                      const TrackFragmentRun& trun,
+                                      const size_t i,
+                                      TrackRunInfo* tri) {
+  int64_t size;
   if (i < trun.sample_sizes.size()) {
-    sample_info->size = trun.sample_sizes[i];
+    size = trun.sample_sizes[i];
   } else if (tfhd.default_sample_size > 0) {
-    sample_info->size = tfhd.default_sample_size;
+    size = tfhd.default_sample_size;
   } else {
-    sample_info->size = trex.default_sample_size;
+    size = trex.default_sample_size;
   }
 
+  int64_t duration;
   if (i < trun.sample_durations.size()) {
-    sample_info->duration = trun.sample_durations[i];
+    duration = trun.sample_durations[i];
   } else if (tfhd.default_sample_duration > 0) {
-    sample_info->duration = tfhd.default_sample_duration;
+    duration = tfhd.default_sample_duration;
   } else {
-    sample_info->duration = trex.default_sample_duration;
+    duration = trex.default_sample_duration;
   }
 
-  if (i < trun.sample_composition_time_offsets.size()) {
-    sample_info->cts_offset = trun.sample_composition_time_offsets[i];
-  } else {
-    sample_info->cts_offset = 0;
-  }
+  const int64_t cts_offset = i < trun.sample_composition_time_offsets.size()
+                                 ? trun.sample_composition_time_offsets[i]
+                                 : 0;
 
   uint32_t flags;
   if (i < trun.sample_flags.size()) {
@@ -125,7 +221,9 @@ static void PopulateSampleInfo(const TrackExtends& trex,
   } else {
     flags = trex.default_sample_flags;
   }
-  sample_info->is_keyframe = !(flags & TrackFragmentHeader::kNonKeySampleMask);
+  const bool is_keyframe = !(flags & TrackFragmentHeader::kNonKeySampleMask);
+
+  tri->AddSample(size, duration, cts_offset, is_keyframe);
 }
 
 // In well-structured encrypted media, each track run will be immediately
@@ -156,8 +254,37 @@ class CompareMinTrackRunDataOffset {
   }
 };
 
+// Sets the sample description of a chunk of a non-fragmented file.
+static bool SetChunkSampleDescription(const SampleDescription& stsd,
+                                      uint32_t desc_idx,
+                                      TrackRunInfo* tri) {
+  RCHECK(desc_idx > 0);  // Descriptions are one-indexed in the file.
+  desc_idx -= 1;
+
+  tri->track_type = stsd.type;
+  if (tri->track_type == kAudio) {
+    RCHECK(!stsd.audio_entries.empty());
+    if (desc_idx > stsd.audio_entries.size())
+      desc_idx = 0;
+    tri->audio_description = &stsd.audio_entries[desc_idx];
+    // We don't support encrypted non-fragmented mp4 for now.
+    RCHECK(tri->audio_description->sinf.info.track_encryption
+               .default_is_protected == 0);
+  } else if (tri->track_type == kVideo) {
+    RCHECK(!stsd.video_entries.empty());
+    if (desc_idx > stsd.video_entries.size())
+      desc_idx = 0;
+    tri->video_description = &stsd.video_entries[desc_idx];
+    // We don't support encrypted non-fragmented mp4 for now.
+    RCHECK(tri->video_description->sinf.info.track_encryption
+               .default_is_protected == 0);
+  }
+  return true;
+}
+
 bool TrackRunIterator::Init() {
   runs_.clear();
+  streaming_ = false;
 
   for (std::vector<Track>::const_iterator trak = moov_->tracks.begin();
        trak != moov_->tracks.end(); ++trak) {
@@ -218,42 +345,20 @@ bool TrackRunIterator::Init() {
       tri.start_dts = run_start_dts;
       tri.sample_start_offset = chunk_offset_vector[chunk_index];
 
-      uint32_t desc_idx = chunk_info.sample_description_index();
-      RCHECK(desc_idx > 0);  // Descriptions are one-indexed in the file.
-      desc_idx -= 1;
-
-      tri.track_type = stsd.type;
-      if (tri.track_type == kAudio) {
-        RCHECK(!stsd.audio_entries.empty());
-        if (desc_idx > stsd.audio_entries.size())
-          desc_idx = 0;
-        tri.audio_description = &stsd.audio_entries[desc_idx];
-        // We don't support encrypted non-fragmented mp4 for now.
-        RCHECK(tri.audio_description->sinf.info.track_encryption
-                   .default_is_protected == 0);
-      } else if (tri.track_type == kVideo) {
-        RCHECK(!stsd.video_entries.empty());
-        if (desc_idx > stsd.video_entries.size())
-          desc_idx = 0;
-        tri.video_description = &stsd.video_entries[desc_idx];
-        // We don't support encrypted non-fragmented mp4 for now.
-        RCHECK(tri.video_description->sinf.info.track_encryption
-                   .default_is_protected == 0);
-      }
+      RCHECK(SetChunkSampleDescription(
+          stsd, chunk_info.sample_description_index(), &tri));
 
       uint32_t samples_per_chunk = chunk_info.samples_per_chunk();
-      tri.samples.resize(samples_per_chunk);
+      tri.InitSamples(samples_per_chunk);
       for (uint32_t k = 0; k < samples_per_chunk; ++k) {
-        SampleInfo& sample = tri.samples[k];
-        sample.size = sample_size.sample_size != 0
+        tri.AddSample(sample_size.sample_size != 0
                           ? sample_size.sample_size
-                          : sample_size.sizes[sample_index];
-        sample.duration = decoding_time.sample_delta();
-        sample.cts_offset =
-            has_composition_offset ? composition_offset.sample_offset() : 0;
-        sample.is_keyframe = sync_sample.IsSyncSample();
-
-        run_start_dts += sample.duration;
+                          : sample_size.sizes[sample_index],
+                      decoding_time.sample_delta(),
+                      has_composition_offset
+                          ? composition_offset.sample_offset()
+                          : 0,
+                      sync_sample.IsSyncSample());
 
         // Advance to next sample. Should success except for last sample.
         ++sample_index;
@@ -270,8 +375,9 @@ bool TrackRunIterator::Init() {
             RCHECK(composition_offset.AdvanceSample());
         }
       }
+      run_start_dts = tri.sample_dts.back();
 
-      runs_.push_back(tri);
+      runs_.push_back(std::move(tri));
     }
   }
 
@@ -281,6 +387,91 @@ bool TrackRunIterator::Init() {
   return true;
 }
 
+bool TrackRunIterator::InitStreaming(
+    File* file,
+    const std::map<uint32_t, SampleTableBoxLocations>& sample_tables) {
+  runs_.clear();
+  streaming_tracks_.clear();
+  streaming_ = true;
+  sample_table_error_ = false;
+
+  for (const Track& trak : moov_->tracks) {
+    const SampleDescription& stsd =
+        trak.media.information.sample_table.description;
+    if (stsd.type != kAudio && stsd.type != kVideo) {
+      DVLOG(1) << "Skipping unhandled track type";
+      continue;
+    }
+    auto boxes = sample_tables.find(trak.header.track_id);
+    RCHECK(boxes != sample_tables.end());
+
+    StreamingTrack streaming_track;
+    streaming_track.track = &trak;
+    streaming_track.sample_table_reader.reset(new SampleTableReader(
+        file, trak, boxes->second,
+        static_cast<size_t>(FLAGS_mp4_sample_table_window_size)));
+    RCHECK(streaming_track.sample_table_reader->Init());
+    streaming_track.next_run_start_dts =
+        GetTimestampAdjustment(*moov_, trak, nullptr);
+    streaming_tracks_.push_back(std::move(streaming_track));
+  }
+
+  if (!ReadNextStreamingRun()) {
+    sample_table_error_ = true;
+    return false;
+  }
+  return true;
+}
+
+bool TrackRunIterator::ReadNextStreamingRun() {
+  runs_.clear();
+  run_itr_ = runs_.end();
+
+  StreamingTrack* next_track = nullptr;
+  uint64_t next_chunk_offset = 0;
+  for (StreamingTrack& streaming_track : streaming_tracks_) {
+    const SampleTableReader& reader = *streaming_track.sample_table_reader;
+    if (reader.HasNextChunk() &&
+        (!next_track || reader.next_chunk_offset() < next_chunk_offset)) {
+      next_track = &streaming_track;
+      next_chunk_offset = reader.next_chunk_offset();
+    }
+  }
+  if (!next_track)
+    return true;
+
+  const Track& trak = *next_track->track;
+  SampleTableReader* reader = next_track->sample_table_reader.get();
+  TrackRunInfo tri;
+  tri.track_id = trak.header.track_id;
+  tri.timescale = trak.media.header.timescale;
+  tri.start_dts = next_track->next_run_start_dts;
+
+  uint64_t chunk_offset = 0;
+  uint32_t samples_per_chunk = 0;
+  uint32_t desc_idx = 0;
+  RCHECK(reader->ReadChunk(&chunk_offset, &samples_per_chunk, &desc_idx));
+  tri.sample_start_offset = chunk_offset;
+  RCHECK(SetChunkSampleDescription(
+      trak.media.information.sample_table.description, desc_idx, &tri));
+
+  tri.InitSamples(samples_per_chunk);
+  for (uint32_t k = 0; k < samples_per_chunk; ++k) {
+    uint32_t size = 0;
+    uint32_t duration = 0;
+    int64_t cts_offset = 0;
+    bool is_keyframe = false;
+    RCHECK(reader->ReadSample(&size, &duration, &cts_offset, &is_keyframe));
+    tri.AddSample(size, duration, cts_offset, is_keyframe);
+  }
+  next_track->next_run_start_dts = tri.sample_dts.back();
+
+  runs_.push_back(std::move(tri));
+  run_itr_ = runs_.begin();
+  ResetRun();
+  return true;
+}
+
 bool TrackRunIterator::Init(const MovieFragment& moof) {
   runs_.clear();
 
@@ -335,20 +526,27 @@ bool TrackRunIterator::Init(const MovieFragment& moof) {
     }
 
     // SampleEncryptionEntries should not have been parsed, without having
-    // iv_size. Parse the box now.
+    // iv_size. The box is parsed now, straight into the runs.
     DCHECK(traf.sample_encryption.sample_encryption_entries.empty());
-    std::vector<SampleEncryptionEntry> sample_encryption_entries;
-    if (!traf.sample_encryption.sample_encryption_data.empty()) {
+    const std::vector<uint8_t>& sample_encryption_data =
+        traf.sample_encryption.sample_encryption_data;
+    BufferReader sample_encryption_reader(sample_encryption_data.data(),
+                                          sample_encryption_data.size());
+    uint32_t sample_encryption_count = 0;
+    uint8_t default_per_sample_iv_size = 0;
+    if (!sample_encryption_data.empty()) {
       RCHECK(audio_sample_entry || video_sample_entry);
-      const uint8_t default_per_sample_iv_size =
+      default_per_sample_iv_size =
           audio_sample_entry
               ? audio_sample_entry->sinf.info.track_encryption
                     .default_per_sample_iv_size
               : video_sample_entry->sinf.info.track_encryption
                     .default_per_sample_iv_size;
-      RCHECK(traf.sample_encryption.ParseFromSampleEncryptionData(
-          default_per_sample_iv_size, &sample_encryption_entries));
+      RCHECK(sample_encryption_reader.Read4(&sample_encryption_count));
     }
+    const bool has_subsamples =
+        (traf.sample_encryption.flags &
+         SampleEncryption::kUseSubsampleEncryption) != 0;
 
     int64_t run_start_dts = traf.decode_time_absent
                                 ? next_fragment_start_dts_[i]
@@ -377,12 +575,14 @@ bool TrackRunIterator::Init(const MovieFragment& moof) {
       // Populate sample encryption entries from SampleEncryption 'senc' box if
       // it is available; otherwise initialize aux_info variables, which will
       // be used to populate sample encryption entries later in CacheAuxInfo.
-      if (!sample_encryption_entries.empty()) {
-        RCHECK(sample_encryption_entries.size() >=
-               sample_count_sum + trun.sample_count);
+      if (sample_encryption_count > 0) {
+        RCHECK(sample_encryption_count >= sample_count_sum + trun.sample_count);
+        tri.sample_encryption_info.reserve(trun.sample_count);
+        tri.sample_ivs.reserve(trun.sample_count * default_per_sample_iv_size);
         for (size_t k = 0; k < trun.sample_count; ++k) {
-          tri.sample_encryption_entries.push_back(
-              sample_encryption_entries[sample_count_sum + k]);
+          RCHECK(tri.ParseSampleEncryptionEntry(default_per_sample_iv_size,
+                                                has_subsamples,
+                                                &sample_encryption_reader));
         }
       } else if (traf.auxiliary_offset.offsets.size() > j) {
         // Collect information from the auxiliary_offset entry with the same
@@ -418,12 +618,11 @@ bool TrackRunIterator::Init(const MovieFragment& moof) {
         }
       }
 
-      tri.samples.resize(trun.sample_count);
-      for (size_t k = 0; k < trun.sample_count; k++) {
-        PopulateSampleInfo(*trex, traf.header, trun, k, &tri.samples[k]);
-        run_start_dts += tri.samples[k].duration;
-      }
-      runs_.push_back(tri);
+      tri.InitSamples(trun.sample_count);
+      for (size_t k = 0; k < trun.sample_count; k++)
+        AddTrackFragmentRunSample(*trex, traf.header, trun, k, &tri);
+      run_start_dts = tri.sample_dts.back();
+      runs_.push_back(std::move(tri));
       sample_count_sum += trun.sample_count;
     }
     next_fragment_start_dts_[i] = run_start_dts;
@@ -436,6 +635,14 @@ bool TrackRunIterator::Init(const MovieFragment& moof) {
 }
 
 void TrackRunIterator::AdvanceRun() {
+  if (streaming_) {
+    if (!ReadNextStreamingRun()) {
+      sample_table_error_ = true;
+      runs_.clear();
+      run_itr_ = runs_.end();
+    }
+    return;
+  }
   ++run_itr_;
   ResetRun();
 }
@@ -443,16 +650,12 @@ void TrackRunIterator::AdvanceRun() {
 void TrackRunIterator::ResetRun() {
   if (!IsRunValid())
     return;
-  sample_dts_ = run_itr_->start_dts;
-  sample_offset_ = run_itr_->sample_start_offset;
-  sample_itr_ = run_itr_->samples.begin();
+  sample_index_ = 0;
 }
 
 void TrackRunIterator::AdvanceSample() {
   DCHECK(IsSampleValid());
-  sample_dts_ += sample_itr_->duration;
-  sample_offset_ += sample_itr_->size;
-  ++sample_itr_;
+  ++sample_index_;
 }
 
 // This implementation only indicates a need for caching if CENC auxiliary
@@ -460,28 +663,31 @@ void TrackRunIterator::AdvanceSample() {
 bool TrackRunIterator::AuxInfoNeedsToBeCached() {
   DCHECK(IsRunValid());
   return is_encrypted() && aux_info_size() > 0 &&
-         run_itr_->sample_encryption_entries.size() == 0;
+         run_itr_->sample_encryption_info.empty();
 }
 
 // This implementation currently only caches CENC auxiliary info.
 bool TrackRunIterator::CacheAuxInfo(const uint8_t* buf, int buf_size) {
   RCHECK(AuxInfoNeedsToBeCached() && buf_size >= aux_info_size());
 
-  std::vector<SampleEncryptionEntry>& sample_encryption_entries =
-      runs_[run_itr_ - runs_.begin()].sample_encryption_entries;
-  sample_encryption_entries.resize(run_itr_->samples.size());
+  TrackRunInfo& run = runs_[run_itr_ - runs_.begin()];
+  const uint8_t iv_size = track_encryption().default_per_sample_iv_size;
+  run.sample_encryption_info.reserve(run.num_samples());
+  run.sample_ivs.reserve(run.num_samples() * iv_size);
   int64_t pos = 0;
-  for (size_t i = 0; i < run_itr_->samples.size(); i++) {
-    int info_size = run_itr_->aux_info_default_size;
+  for (size_t i = 0; i < run.num_samples(); i++) {
+    int info_size = run.aux_info_default_size;
     if (!info_size)
-      info_size = run_itr_->aux_info_sizes[i];
+      info_size = run.aux_info_sizes[i];
 
     BufferReader reader(buf + pos, info_size);
-    const bool has_subsamples =
-        info_size > track_encryption().default_per_sample_iv_size;
-    RCHECK(sample_encryption_entries[i].ParseFromBuffer(
-        track_encryption().default_per_sample_iv_size, has_subsamples,
-        &reader));
+    const bool has_subsamples = info_size > iv_size;
+    if (!run.ParseSampleEncryptionEntry(iv_size, has_subsamples, &reader)) {
+      run.sample_encryption_info.clear();
+      run.sample_ivs.clear();
+      run.sample_subsamples.clear();
+      return false;
+    }
     pos += info_size;
   }
 
@@ -491,7 +697,7 @@ bool TrackRunIterator::CacheAuxInfo(const uint8_t* buf, int buf_size) {
 bool TrackRunIterator::IsRunValid() const { return run_itr_ != runs_.end(); }
 
 bool TrackRunIterator::IsSampleValid() const {
-  return IsRunValid() && (sample_itr_ != run_itr_->samples.end());
+  return IsRunValid() && sample_index_ < run_itr_->num_samples();
 }
 
 // Because tracks are in sorted order and auxiliary information is cached when
@@ -504,7 +710,7 @@ int64_t TrackRunIterator::GetMaxClearOffset() {
   int64_t offset = kInvalidOffset;
 
   if (IsSampleValid()) {
-    offset = std::min(offset, sample_offset_);
+    offset = std::min(offset, sample_offset());
     if (AuxInfoNeedsToBeCached())
       offset = std::min(offset, aux_info_offset());
   }
@@ -521,6 +727,11 @@ int64_t TrackRunIterator::GetMaxClearOffset() {
   return offset;
 }
 
+int64_t TrackRunIterator::GetRunEndOffset() const {
+  DCHECK(IsRunValid());
+  return run_itr_->sample_offsets.back();
+}
+
 uint32_t TrackRunIterator::track_id() const {
   DCHECK(IsRunValid());
   return run_itr_->track_id;
@@ -563,32 +774,36 @@ const VideoSampleEntry& TrackRunIterator::video_description() const {
 
 int64_t TrackRunIterator::sample_offset() const {
   DCHECK(IsSampleValid());
-  return sample_offset_;
+  return run_itr_->sample_offsets[sample_index_];
 }
 
 int TrackRunIterator::sample_size() const {
   DCHECK(IsSampleValid());
-  return sample_itr_->size;
+  return static_cast<int>(run_itr_->sample_offsets[sample_index_ + 1] -
+                          run_itr_->sample_offsets[sample_index_]);
 }
 
 int64_t TrackRunIterator::dts() const {
   DCHECK(IsSampleValid());
-  return sample_dts_;
+  return run_itr_->sample_dts[sample_index_];
 }
 
 int64_t TrackRunIterator::cts() const {
   DCHECK(IsSampleValid());
-  return sample_dts_ + sample_itr_->cts_offset;
+  if (run_itr_->cts_offsets.empty())
+    return dts();
+  return dts() + run_itr_->cts_offsets[sample_index_];
 }
 
 int64_t TrackRunIterator::duration() const {
   DCHECK(IsSampleValid());
-  return sample_itr_->duration;
+  return run_itr_->sample_dts[sample_index_ + 1] -
+         run_itr_->sample_dts[sample_index_];
 }
 
 bool TrackRunIterator::is_keyframe() const {
   DCHECK(IsSampleValid());
-  return sample_itr_->is_keyframe;
+  return run_itr_->is_keyframes[sample_index_];
 }
 
 const TrackEncryption& TrackRunIterator::track_encryption() const {
@@ -602,23 +817,31 @@ std::unique_ptr<DecryptConfig> TrackRunIterator::GetDecryptConfig() {
   std::vector<uint8_t> iv;
   std::vector<SubsampleEntry> subsamples;
 
-  size_t sample_idx = sample_itr_ - run_itr_->samples.begin();
-  if (sample_idx < run_itr_->sample_encryption_entries.size()) {
-    const SampleEncryptionEntry& sample_encryption_entry =
-        run_itr_->sample_encryption_entries[sample_idx];
+  if (sample_index_ < run_itr_->sample_encryption_info.size()) {
+    const SampleEncryptionInfo& info =
+        run_itr_->sample_encryption_info[sample_index_];
     DCHECK(is_encrypted());
     DCHECK(!AuxInfoNeedsToBeCached());
 
-    const size_t total_size_of_subsamples =
-        sample_encryption_entry.GetTotalSizeOfSubsamples();
+    const SubsampleEntry* first_subsample =
+        run_itr_->sample_subsamples.data() + info.subsample_offset;
+    const SubsampleEntry* last_subsample =
+        first_subsample + info.subsample_count;
+    size_t total_size_of_subsamples = 0;
+    for (const SubsampleEntry* subsample = first_subsample;
+         subsample != last_subsample; ++subsample) {
+      total_size_of_subsamples +=
+          subsample->clear_bytes + subsample->cipher_bytes;
+    }
     if (total_size_of_subsamples != 0 &&
         total_size_of_subsamples != static_cast<size_t>(sample_size())) {
       LOG(ERROR) << "Incorrect CENC subsample size.";
       return std::unique_ptr<DecryptConfig>();
     }
 
-    iv = sample_encryption_entry.initialization_vector;
-    subsamples = sample_encryption_entry.subsamples;
+    const uint8_t* iv_data = run_itr_->sample_ivs.data() + info.iv_offset;
+    iv.assign(iv_data, iv_data + info.iv_size);
+    subsamples.assign(first_subsample, last_subsample);
   }
 
   FourCC protection_scheme = is_audio() ? audio_description().sinf.type.type
@@ -10,15 +10,19 @@
 #include <vector>
 
 #include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/media/formats/mp4/sample_table_reader.h"
 
 namespace shaka {
+
+class File;
+
 namespace media {
 
 class DecryptConfig;
 
 namespace mp4 {
 
-struct SampleInfo;
+struct StreamingTrack;
 struct TrackRunInfo;
 
 class TrackRunIterator {
@@ -40,12 +44,26 @@ class TrackRunIterator {
   /// @return true on success, false otherwise.
   bool Init(const MovieFragment& moof);
 
+  /// For non-fragmented mp4 read with ReadMoovWithoutSampleTables(), sets up
+  /// the iterator to read the chunks one at a time from the sample tables in
+  /// @a file, so only one run is kept in memory.
+  /// @param file is the file to read the sample tables from. It must outlive
+  ///        the iterator.
+  /// @param sample_tables is the location of the sample tables by track id.
+  /// @return true on success, false otherwise.
+  bool InitStreaming(
+      File* file,
+      const std::map<uint32_t, SampleTableBoxLocations>& sample_tables);
+
   /// @return true if the iterator points to a valid run, false if past the
   ///         last run.
   bool IsRunValid() const;
   /// @return true if the iterator points to a valid sample, false if past the
   ///         last sample.
   bool IsSampleValid() const;
+  /// @return true if the next run could not be read from the sample tables.
+  ///         Only set by InitStreaming() and AdvanceRun().
+  bool sample_table_error() const { return sample_table_error_; }
 
   /// Advance iterator to the next run. Require that the iterator point to a
   /// valid run.
@@ -72,6 +90,12 @@ class TrackRunIterator {
   ///         head of the MOOF box).
   int64_t GetMaxClearOffset();
 
+  /// @return the offset just past the data of the last sample of the current
+  ///         run. The data of the samples of a run is contiguous, so it spans
+  ///         from the run's first sample offset to this offset. Only valid if
+  ///         IsRunValid().
+  int64_t GetRunEndOffset() const;
+
   /// @name Properties of the current run. Only valid if IsRunValid().
   /// @{
   uint32_t track_id() const;
@@ -103,6 +127,9 @@ class TrackRunIterator {
 
  private:
   void ResetRun();
+  // Reads the chunk with the lowest offset among the streaming tracks as the
+  // only run.
+  bool ReadNextStreamingRun();
   const TrackEncryption& track_encryption() const;
   int64_t GetTimestampAdjustment(const Movie& movie,
                                  const Track& track,
@@ -112,15 +139,18 @@ class TrackRunIterator {
 
   std::vector<TrackRunInfo> runs_;
   std::vector<TrackRunInfo>::const_iterator run_itr_;
-  std::vector<SampleInfo>::const_iterator sample_itr_;
+  // Index of the current sample in the current run.
+  size_t sample_index_;
+
+  // Only set up by InitStreaming().
+  std::vector<StreamingTrack> streaming_tracks_;
+  bool streaming_ = false;
+  bool sample_table_error_ = false;
 
   // Track the start dts of the next segment, only useful if decode_time box is
   // absent.
   std::vector<int64_t> next_fragment_start_dts_;
 
-  int64_t sample_dts_;
-  int64_t sample_offset_;
-
   // TrackId => adjustment map.
   std::map<uint32_t, int64_t> timestamp_adjustment_map_;
 
@@ -471,6 +471,29 @@ TEST_F(TrackRunIteratorTest, ReorderingTest) {
   EXPECT_EQ(iter_->duration(), 3);
 }
 
+TEST_F(TrackRunIteratorTest, CompositionOffsetsAfterZeroOffsets) {
+  FLAGS_mp4_reset_initial_composition_offset_to_zero = false;
+  iter_.reset(new TrackRunIterator(&moov_));
+
+  MovieFragment moof = CreateFragment();
+  std::vector<int64_t>& cts_offsets =
+      moof.tracks[1].runs[0].sample_composition_time_offsets;
+  cts_offsets.assign(10, 0);
+  cts_offsets[3] = 7;
+  moof.tracks[1].decode_time.decode_time = 0;
+
+  ASSERT_TRUE(iter_->Init(moof));
+  iter_->AdvanceRun();
+  int64_t sample_end_offset = iter_->sample_offset();
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(iter_->cts(), iter_->dts() + cts_offsets[i]);
+    sample_end_offset += iter_->sample_size();
+    iter_->AdvanceSample();
+  }
+  EXPECT_FALSE(iter_->IsSampleValid());
+  EXPECT_EQ(sample_end_offset, iter_->GetRunEndOffset());
+}
+
 TEST_F(TrackRunIteratorTest, ReorderingTest_WithEditList) {
   FLAGS_mp4_reset_initial_composition_offset_to_zero = false;
 
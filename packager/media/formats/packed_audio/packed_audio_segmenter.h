@@ -8,6 +8,7 @@
 #define PACKAGER_MEDIA_FORMATS_PACKED_AUDIO_PACKED_AUDIO_SEGMENTER_H_
 
 #include <memory>
+#include <vector>
 
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/stream_info.h"
@@ -95,6 +96,8 @@ class PackedAudioSegmenter {
   std::string audio_setup_information_;
   // AAC is carried in ADTS.
   std::unique_ptr<AACAudioSpecificConfig> adts_converter_;
+  // Reused for every ADTS frame so that its memory is only allocated once.
+  std::vector<uint8_t> adts_frame_;
 
   BufferWriter segment_buffer_;
 };
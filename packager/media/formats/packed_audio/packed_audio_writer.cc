@@ -7,6 +7,7 @@
 #include "packager/media/formats/packed_audio/packed_audio_writer.h"
 
 #include "packager/media/base/muxer_util.h"
+#include "packager/media/base/segment_digest.h"
 #include "packager/media/formats/packed_audio/packed_audio_segmenter.h"
 #include "packager/status_macros.h"
 
@@ -18,8 +19,8 @@ PackedAudioWriter::PackedAudioWriter(const MuxerOptions& muxer_options)
       transport_stream_timestamp_offset_(
           muxer_options.transport_stream_timestamp_offset_ms *
           kPackedAudioTimescale / 1000),
-      segmenter_(new PackedAudioSegmenter(transport_stream_timestamp_offset_)) {
-}
+      segmenter_(new PackedAudioSegmenter(transport_stream_timestamp_offset_)),
+      segment_name_formatter_(muxer_options.segment_template) {}
 
 PackedAudioWriter::~PackedAudioWriter() = default;
 
@@ -78,15 +79,30 @@ Status PackedAudioWriter::FinalizeSegment(size_t stream_id,
   std::string segment_path =
       options().segment_template.empty()
           ? options().output_file_name
-          : GetSegmentName(options().segment_template, segment_timestamp,
-                           segment_number_++, options().bandwidth);
+          : segment_name_formatter_.Format(
+                segment_timestamp, segment_number_++, options().bandwidth);
 
   // Save |segment_size| as it will be cleared after writing.
   const size_t segment_size = segmenter_->segment_buffer()->Size();
+  std::vector<SegmentDigest> digests;
+  if (!options().segment_digests.empty() && !output_file_) {
+    SegmentDigester digester(options().segment_digests);
+    digester.Update(*segmenter_->segment_buffer());
+    digests = digester.Finish();
+  }
 
   RETURN_IF_ERROR(WriteSegment(segment_path, segmenter_->segment_buffer()));
   total_duration_ += segment_info.duration;
 
+  if (!digests.empty()) {
+    if (options().segment_digest_file) {
+      RETURN_IF_ERROR(options().segment_digest_file->OnSegmentWritten(
+          segment_path, digests));
+    }
+    if (muxer_listener())
+      muxer_listener()->OnSegmentDigests(segment_path, digests);
+  }
+
   if (muxer_listener()) {
     muxer_listener()->OnNewSegment(
         segment_path, segment_timestamp + transport_stream_timestamp_offset_,
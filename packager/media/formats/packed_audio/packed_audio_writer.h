@@ -9,6 +9,7 @@
 
 #include "packager/file/file_closer.h"
 #include "packager/media/base/muxer.h"
+#include "packager/media/base/muxer_util.h"
 
 namespace shaka {
 namespace media {
@@ -53,6 +54,7 @@ class PackedAudioWriter : public Muxer {
   uint64_t total_duration_ = 0;
 
   // Used in multi-segment mode for segment template.
+  const SegmentNameFormatter segment_name_formatter_;
   uint64_t segment_number_ = 0;
 };
 
@@ -97,11 +97,11 @@ TEST_P(PackedAudioWriterTest, InitializeWithStreamInfo) {
   auto stream_info_data =
       StreamData::FromStreamInfo(kStreamIndex, GetAudioStreamInfo(kTimescale));
   EXPECT_CALL(*mock_muxer_listener_ptr_,
-              OnMediaStart(_, Ref(*stream_info_data->stream_info),
+              OnMediaStart(_, Ref(*stream_info_data->stream_info()),
                            kPackedAudioTimescale,
                            MuxerListener::kContainerPackedAudio));
   EXPECT_CALL(*mock_segmenter_ptr_,
-              Initialize(Ref(*stream_info_data->stream_info)));
+              Initialize(Ref(*stream_info_data->stream_info())));
   ASSERT_OK(Input(kInput)->Dispatch(std::move(stream_info_data)));
 }
 
@@ -113,7 +113,7 @@ TEST_P(PackedAudioWriterTest, Sample) {
       kStreamIndex, GetMediaSample(kTimestamp, kDuration, kKeyFrame));
 
   EXPECT_CALL(*mock_segmenter_ptr_,
-              AddSample(Ref(*sample_stream_data->media_sample)));
+              AddSample(Ref(*sample_stream_data->media_sample())));
   ASSERT_OK(Input(kInput)->Dispatch(std::move(sample_stream_data)));
 }
 
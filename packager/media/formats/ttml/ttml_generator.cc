@@ -7,8 +7,9 @@
 #include "packager/media/formats/ttml/ttml_generator.h"
 
 #include "packager/base/base64.h"
+#include "packager/base/logging.h"
 #include "packager/base/strings/stringprintf.h"
-#include "packager/media/base/rcheck.h"
+#include "packager/mpd/base/xml/xml_node.h"
 
 namespace shaka {
 namespace media {
@@ -39,6 +40,71 @@ std::string ToTtmlSize(const TextNumber& x, const TextNumber& y) {
                             kSuffixMap[static_cast<int>(y.type)]);
 }
 
+// Appends the indentation of an element at |level| if |format| is set.
+void AppendIndent(int level, bool format, std::string* out) {
+  if (format)
+    out->append(2 * level, ' ');
+}
+
+void AppendNewline(bool format, std::string* out) {
+  if (format)
+    out->push_back('\n');
+}
+
+bool IsStyled(const TextFragment& fragment) {
+  return fragment.style.bold || fragment.style.italic ||
+         fragment.style.underline;
+}
+
+std::string ImageId(size_t image_id) {
+  return "img_" + std::to_string(image_id);
+}
+
+size_t CountImages(const TextFragment& fragment) {
+  if (fragment.newline || !fragment.body.empty())
+    return 0;
+  if (!fragment.image.empty())
+    return 1;
+  size_t count = 0;
+  for (const auto& sub_fragment : fragment.sub_fragments)
+    count += CountImages(sub_fragment);
+  return count;
+}
+
+// The content of an XML element: a <p> holds its fragment as a child, a
+// <span> holds the content of its fragment.  Unstyled fragments are merged
+// into the element of their parent; newlines and styled fragments are
+// elements of their own.
+struct ElementContent {
+  bool has_children = false;
+  // libxml doesn't format the children of elements with text.
+  bool has_text = false;
+  // The number of images of the element and its descendants.
+  size_t image_count = 0;
+  // The last image of the element, which is its background image, as a
+  // number in |image_count|, or 0 if there is none.
+  size_t background_image = 0;
+};
+
+void GetElementContent(const TextFragment& fragment,
+                       bool is_child,
+                       ElementContent* content) {
+  if (is_child && (fragment.newline || IsStyled(fragment))) {
+    content->has_children = true;
+    content->image_count += CountImages(fragment);
+    return;
+  }
+  if (!fragment.body.empty()) {
+    content->has_children = true;
+    content->has_text = true;
+  } else if (!fragment.image.empty()) {
+    content->background_image = ++content->image_count;
+  } else {
+    for (const auto& sub_fragment : fragment.sub_fragments)
+      GetElementContent(sub_fragment, true, content);
+  }
+}
+
 }  // namespace
 
 const char* TtmlGenerator::kTtNamespace = "http://www.w3.org/ns/ttml";
@@ -50,79 +116,91 @@ TtmlGenerator::~TtmlGenerator() {}
 void TtmlGenerator::Initialize(const std::map<std::string, TextRegion>& regions,
                                const std::string& language,
                                uint32_t time_scale) {
-  regions_ = regions;
   language_ = language;
   time_scale_ = time_scale;
-}
-
-void TtmlGenerator::AddSample(const TextSample& sample) {
-  samples_.emplace_back(sample);
-}
 
-void TtmlGenerator::Reset() {
-  samples_.clear();
-}
-
-bool TtmlGenerator::Dump(std::string* result) const {
-  xml::XmlNode root("tt");
-  RCHECK(root.SetStringAttribute("xmlns", kTtNamespace));
-  RCHECK(root.SetStringAttribute("xmlns:tts",
-                                 "http://www.w3.org/ns/ttml#styling"));
+  document_start_ = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<tt";
+  xml::AppendAttribute("xmlns", kTtNamespace, &document_start_);
+  xml::AppendAttribute("xmlns:tts", "http://www.w3.org/ns/ttml#styling",
+                       &document_start_);
+  xml::AppendAttribute("xml:lang", language_, &document_start_);
 
+  head_ = ">\n";
+  if (regions.empty()) {
+    head_ += "  <head/>\n";
+    return;
+  }
+  head_ += "  <head>\n";
   bool did_log = false;
-  xml::XmlNode head("head");
-  RCHECK(root.SetStringAttribute("xml:lang", language_));
-  for (const auto& pair : regions_) {
+  for (const auto& pair : regions) {
     if (!did_log && (pair.second.region_anchor_x.value != 0 &&
                      pair.second.region_anchor_y.value != 0)) {
       LOG(WARNING) << "TTML doesn't support non-0 region anchor";
       did_log = true;
     }
 
-    xml::XmlNode region("region");
-    const auto origin =
-        ToTtmlSize(pair.second.window_anchor_x, pair.second.window_anchor_y);
-    const auto extent = ToTtmlSize(pair.second.width, pair.second.height);
-    RCHECK(region.SetStringAttribute("xml:id", pair.first));
-    RCHECK(region.SetStringAttribute("tts:origin", origin));
-    RCHECK(region.SetStringAttribute("tts:extent", extent));
-    RCHECK(head.AddChild(std::move(region)));
+    head_ += "    <region";
+    xml::AppendAttribute("xml:id", pair.first, &head_);
+    xml::AppendAttribute(
+        "tts:origin",
+        ToTtmlSize(pair.second.window_anchor_x, pair.second.window_anchor_y),
+        &head_);
+    xml::AppendAttribute("tts:extent",
+                         ToTtmlSize(pair.second.width, pair.second.height),
+                         &head_);
+    head_ += "/>\n";
   }
-  RCHECK(root.AddChild(std::move(head)));
+  head_ += "  </head>\n";
+}
 
+void TtmlGenerator::AddSample(const TextSample& sample) {
+  samples_.emplace_back(sample);
+}
+
+void TtmlGenerator::Reset() {
+  samples_.clear();
+}
+
+bool TtmlGenerator::Dump(std::string* result) const {
+  body_.clear();
+  metadata_.clear();
   size_t image_count = 0;
-  xml::XmlNode metadata("metadata");
-  xml::XmlNode body("body");
-  xml::XmlNode div("div");
-  for (const auto& sample : samples_) {
-    RCHECK(AddSampleToXml(sample, &div, &metadata, &image_count));
+  for (const auto& sample : samples_)
+    WriteSample(sample, &image_count);
+
+  result->clear();
+  result->reserve(document_start_.size() + head_.size() + metadata_.size() +
+                  body_.size() + 100);
+  result->append(document_start_);
+  if (image_count > 0) {
+    xml::AppendAttribute("xmlns:smpte",
+                         "http://www.smpte-ra.org/schemas/2052-1/2010/smpte-tt",
+                         result);
   }
-  RCHECK(body.AddChild(std::move(div)));
+  result->append(head_);
   if (image_count > 0) {
-    RCHECK(root.SetStringAttribute(
-        "xmlns:smpte", "http://www.smpte-ra.org/schemas/2052-1/2010/smpte-tt"));
-    RCHECK(root.AddChild(std::move(metadata)));
+    result->append("  <metadata>\n");
+    result->append(metadata_);
+    result->append("  </metadata>\n");
   }
-  RCHECK(root.AddChild(std::move(body)));
-
-  *result = root.ToString(/* comment= */ "");
+  result->append("  <body>\n");
+  if (body_.empty()) {
+    result->append("    <div/>\n");
+  } else {
+    result->append("    <div>\n");
+    result->append(body_);
+    result->append("    </div>\n");
+  }
+  result->append("  </body>\n</tt>\n");
   return true;
 }
 
-bool TtmlGenerator::AddSampleToXml(const TextSample& sample,
-                                   xml::XmlNode* body,
-                                   xml::XmlNode* metadata,
-                                   size_t* image_count) const {
-  xml::XmlNode p("p");
-  RCHECK(p.SetStringAttribute("xml:space", "preserve"));
-  RCHECK(p.SetStringAttribute("begin",
-                              ToTtmlTime(sample.start_time(), time_scale_)));
-  RCHECK(
-      p.SetStringAttribute("end", ToTtmlTime(sample.EndTime(), time_scale_)));
-  RCHECK(ConvertFragmentToXml(sample.body(), &p, metadata, image_count));
-  if (!sample.id().empty())
-    RCHECK(p.SetStringAttribute("xml:id", sample.id()));
+void TtmlGenerator::WriteSample(const TextSample& sample,
+                                size_t* image_count) const {
+  // The <p> elements are children of <div>.
+  const int kLevel = 3;
 
+  std::string region;
   const auto& settings = sample.settings();
   if (settings.line || settings.position || settings.width || settings.height) {
     // TTML positioning needs to be from a region.
@@ -138,101 +216,151 @@ bool TtmlGenerator::AddSampleToXml(const TextSample& sample,
         settings.width.value_or(TextNumber(100, TextUnitType::kPercent)),
         settings.height.value_or(TextNumber(100, TextUnitType::kPercent)));
 
-    const std::string id = kRegionIdPrefix + std::to_string(region_id_++);
-    xml::XmlNode region("region");
-    RCHECK(region.SetStringAttribute("xml:id", id));
-    RCHECK(region.SetStringAttribute("tts:origin", origin));
-    RCHECK(region.SetStringAttribute("tts:extent", extent));
-    RCHECK(p.SetStringAttribute("region", id));
-    RCHECK(body->AddChild(std::move(region)));
-  } else if (!settings.region.empty()) {
-    RCHECK(p.SetStringAttribute("region", settings.region));
+    region = kRegionIdPrefix + std::to_string(region_id_++);
+    AppendIndent(kLevel, true, &body_);
+    body_.append("<region");
+    xml::AppendAttribute("xml:id", region, &body_);
+    xml::AppendAttribute("tts:origin", origin, &body_);
+    xml::AppendAttribute("tts:extent", extent, &body_);
+    body_.append("/>\n");
+  } else {
+    region = settings.region;
   }
 
+  ElementContent content;
+  GetElementContent(sample.body(), true, &content);
+
+  AppendIndent(kLevel, true, &body_);
+  body_.append("<p");
+  xml::AppendAttribute("xml:space", "preserve", &body_);
+  xml::AppendAttribute("begin", ToTtmlTime(sample.start_time(), time_scale_),
+                       &body_);
+  xml::AppendAttribute("end", ToTtmlTime(sample.EndTime(), time_scale_),
+                       &body_);
+  if (content.background_image > 0) {
+    xml::AppendAttribute(
+        "smpte:backgroundImage",
+        "#" + ImageId(*image_count + content.background_image), &body_);
+  }
+  if (!sample.id().empty())
+    xml::AppendAttribute("xml:id", sample.id(), &body_);
+  if (!region.empty())
+    xml::AppendAttribute("region", region, &body_);
   if (settings.writing_direction != WritingDirection::kHorizontal) {
     const char* dir =
         settings.writing_direction == WritingDirection::kVerticalGrowingLeft
             ? "tbrl"
             : "tblr";
-    RCHECK(p.SetStringAttribute("tts:writingMode", dir));
+    xml::AppendAttribute("tts:writingMode", dir, &body_);
   }
-  if (settings.text_alignment != TextAlignment::kStart) {
-    switch (settings.text_alignment) {
-      case TextAlignment::kStart:  // To avoid compiler warning.
-      case TextAlignment::kCenter:
-        RCHECK(p.SetStringAttribute("tts:textAlign", "center"));
-        break;
-      case TextAlignment::kEnd:
-        RCHECK(p.SetStringAttribute("tts:textAlign", "end"));
-        break;
-      case TextAlignment::kLeft:
-        RCHECK(p.SetStringAttribute("tts:textAlign", "left"));
-        break;
-      case TextAlignment::kRight:
-        RCHECK(p.SetStringAttribute("tts:textAlign", "right"));
-        break;
-    }
+  switch (settings.text_alignment) {
+    case TextAlignment::kStart:
+      break;
+    case TextAlignment::kCenter:
+      xml::AppendAttribute("tts:textAlign", "center", &body_);
+      break;
+    case TextAlignment::kEnd:
+      xml::AppendAttribute("tts:textAlign", "end", &body_);
+      break;
+    case TextAlignment::kLeft:
+      xml::AppendAttribute("tts:textAlign", "left", &body_);
+      break;
+    case TextAlignment::kRight:
+      xml::AppendAttribute("tts:textAlign", "right", &body_);
+      break;
   }
 
-  RCHECK(body->AddChild(std::move(p)));
-  return true;
+  if (!content.has_children) {
+    body_.append("/>\n");
+    // The images still go in the metadata.
+    WriteFragment(sample.body(), true, kLevel + 1, false, image_count);
+    return;
+  }
+  const bool format = !content.has_text;
+  body_.push_back('>');
+  AppendNewline(format, &body_);
+  WriteFragment(sample.body(), true, kLevel + 1, format, image_count);
+  AppendIndent(kLevel, format, &body_);
+  body_.append("</p>\n");
 }
 
-bool TtmlGenerator::ConvertFragmentToXml(const TextFragment& body,
-                                         xml::XmlNode* parent,
-                                         xml::XmlNode* metadata,
-                                         size_t* image_count) const {
-  if (body.newline) {
-    xml::XmlNode br("br");
-    return parent->AddChild(std::move(br));
+void TtmlGenerator::WriteFragment(const TextFragment& fragment,
+                                  bool is_child,
+                                  int level,
+                                  bool format,
+                                  size_t* image_count) const {
+  if (is_child && fragment.newline) {
+    AppendIndent(level, format, &body_);
+    body_.append("<br/>");
+    AppendNewline(format, &body_);
+    return;
   }
 
   // If we have new styles, add a new <span>.
-  xml::XmlNode span("span");
-  xml::XmlNode* node = parent;
-  if (body.style.bold || body.style.italic || body.style.underline) {
-    node = &span;
-    if (body.style.bold) {
-      RCHECK(span.SetStringAttribute("tts:fontWeight",
-                                     *body.style.bold ? "bold" : "normal"));
+  if (is_child && IsStyled(fragment)) {
+    ElementContent content;
+    GetElementContent(fragment, false, &content);
+
+    AppendIndent(level, format, &body_);
+    body_.append("<span");
+    if (fragment.style.bold) {
+      xml::AppendAttribute("tts:fontWeight",
+                           *fragment.style.bold ? "bold" : "normal", &body_);
     }
-    if (body.style.italic) {
-      RCHECK(span.SetStringAttribute("tts:fontStyle",
-                                     *body.style.italic ? "italic" : "normal"));
+    if (fragment.style.italic) {
+      xml::AppendAttribute("tts:fontStyle",
+                           *fragment.style.italic ? "italic" : "normal",
+                           &body_);
     }
-    if (body.style.underline) {
-      RCHECK(span.SetStringAttribute(
+    if (fragment.style.underline) {
+      xml::AppendAttribute(
           "tts:textDecoration",
-          *body.style.underline ? "underline" : "noUnderline"));
+          *fragment.style.underline ? "underline" : "noUnderline", &body_);
     }
+    if (content.background_image > 0) {
+      xml::AppendAttribute(
+          "smpte:backgroundImage",
+          "#" + ImageId(*image_count + content.background_image), &body_);
+    }
+
+    if (!content.has_children) {
+      body_.append("/>");
+      WriteFragment(fragment, false, level + 1, false, image_count);
+    } else {
+      const bool child_format = format && !content.has_text;
+      body_.push_back('>');
+      AppendNewline(child_format, &body_);
+      WriteFragment(fragment, false, level + 1, child_format, image_count);
+      AppendIndent(level, child_format, &body_);
+      body_.append("</span>");
+    }
+    AppendNewline(format, &body_);
+    return;
   }
 
-  if (!body.body.empty()) {
-    node->AddContent(body.body);
-  } else if (!body.image.empty()) {
-    std::string image_data(body.image.begin(), body.image.end());
-    std::string base64_data;
-    base::Base64Encode(image_data, &base64_data);
-    std::string id = "img_" + std::to_string(++*image_count);
-
-    xml::XmlNode image_xml("smpte:image");
-    RCHECK(image_xml.SetStringAttribute("imageType", "PNG"));
-    RCHECK(image_xml.SetStringAttribute("encoding", "Base64"));
-    RCHECK(image_xml.SetStringAttribute("xml:id", id));
-    image_xml.SetContent(base64_data);
-    RCHECK(metadata->AddChild(std::move(image_xml)));
-
-    RCHECK(node->SetStringAttribute("smpte:backgroundImage", "#" + id));
+  if (!fragment.body.empty()) {
+    xml::AppendEscapedText(fragment.body, &body_);
+  } else if (!fragment.image.empty()) {
+    WriteImage(fragment, ++*image_count);
   } else {
-    for (const auto& frag : body.sub_fragments) {
-      if (!ConvertFragmentToXml(frag, node, metadata, image_count))
-        return false;
-    }
+    for (const auto& sub_fragment : fragment.sub_fragments)
+      WriteFragment(sub_fragment, true, level, format, image_count);
   }
+}
 
-  if (body.style.bold || body.style.italic || body.style.underline)
-    RCHECK(parent->AddChild(std::move(span)));
-  return true;
+void TtmlGenerator::WriteImage(const TextFragment& fragment,
+                               size_t image_id) const {
+  std::string image_data(fragment.image.begin(), fragment.image.end());
+  std::string base64_data;
+  base::Base64Encode(image_data, &base64_data);
+
+  metadata_.append("    <smpte:image");
+  xml::AppendAttribute("imageType", "PNG", &metadata_);
+  xml::AppendAttribute("encoding", "Base64", &metadata_);
+  xml::AppendAttribute("xml:id", ImageId(image_id), &metadata_);
+  metadata_.push_back('>');
+  xml::AppendEscapedText(base64_data, &metadata_);
+  metadata_.append("</smpte:image>\n");
 }
 
 }  // namespace ttml
@@ -13,12 +13,14 @@
 
 #include "packager/media/base/text_sample.h"
 #include "packager/media/base/text_stream_info.h"
-#include "packager/mpd/base/xml/xml_node.h"
 
 namespace shaka {
 namespace media {
 namespace ttml {
 
+/// Generates TTML documents from text samples.  The documents are written
+/// directly as text, with the same formatting as libxml, instead of building
+/// an XML tree per document.
 class TtmlGenerator {
  public:
   explicit TtmlGenerator();
@@ -35,19 +37,25 @@ class TtmlGenerator {
   bool Dump(std::string* result) const;
 
  private:
-  bool AddSampleToXml(const TextSample& sample,
-                      xml::XmlNode* body,
-                      xml::XmlNode* metadata,
-                      size_t* image_count) const;
-  bool ConvertFragmentToXml(const TextFragment& fragment,
-                            xml::XmlNode* parent,
-                            xml::XmlNode* metadata,
-                            size_t* image_count) const;
+  void WriteSample(const TextSample& sample, size_t* image_count) const;
+  void WriteFragment(const TextFragment& fragment,
+                     bool is_child,
+                     int level,
+                     bool format,
+                     size_t* image_count) const;
+  void WriteImage(const TextFragment& fragment, size_t image_id) const;
 
   std::list<TextSample> samples_;
-  std::map<std::string, TextRegion> regions_;
   std::string language_;
   uint32_t time_scale_;
+  // The start of the document, up to the attributes of the root element, and
+  // the <head> element.  These are rendered once in Initialize().
+  std::string document_start_;
+  std::string head_;
+  // Buffers of the <body> and <metadata> elements, which are reused across
+  // documents.
+  mutable std::string body_;
+  mutable std::string metadata_;
   // This is modified in "const" methods to create unique IDs.
   mutable uint32_t region_id_ = 0;
 };
@@ -130,6 +130,34 @@ TEST_F(TtmlMuxerTest, HandlesStyles) {
   ParseSingleCue(kExpectedOutput, properties);
 }
 
+TEST_F(TtmlMuxerTest, HandlesStylesWithText) {
+  // Elements with text are not formatted, and neither are their children.
+  const char* kExpectedOutput =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<tt xmlns=\"http://www.w3.org/ns/ttml\" "
+      "xmlns:tts=\"http://www.w3.org/ns/ttml#styling\" xml:lang=\"\">\n"
+      "  <head/>\n"
+      "  <body>\n"
+      "    <div>\n"
+      "      <p xml:space=\"preserve\" begin=\"00:00:05.00\" "
+      "end=\"00:00:06.00\">foo <span tts:fontWeight=\"bold\">"
+      "<span tts:fontStyle=\"italic\">bar</span><br/></span></p>\n"
+      "    </div>\n"
+      "  </body>\n"
+      "</tt>\n";
+
+  TestProperties properties;
+  properties.body.sub_fragments.emplace_back(kNoStyles, "foo ");
+  properties.body.sub_fragments.emplace_back();
+  TextFragment* bold = &properties.body.sub_fragments.back();
+  bold->style.bold = true;
+  bold->sub_fragments.emplace_back(kNoStyles, "bar");
+  bold->sub_fragments.back().style.italic = true;
+  bold->sub_fragments.emplace_back(kNoStyles, kNewline);
+
+  ParseSingleCue(kExpectedOutput, properties);
+}
+
 TEST_F(TtmlMuxerTest, HandlesRegions) {
   const char* kExpectedOutput =
       "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
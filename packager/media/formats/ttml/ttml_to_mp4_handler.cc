@@ -59,9 +59,9 @@ Status TtmlToMp4Handler::Process(std::unique_ptr<StreamData> stream_data) {
 
 Status TtmlToMp4Handler::OnStreamInfo(std::unique_ptr<StreamData> stream_data) {
   DCHECK(stream_data);
-  DCHECK(stream_data->stream_info);
+  DCHECK(stream_data->stream_info());
 
-  auto clone = stream_data->stream_info->Clone();
+  auto clone = stream_data->stream_info()->Clone();
   clone->set_codec(kCodecTtml);
   clone->set_codec_string("ttml");
 
@@ -77,34 +77,33 @@ Status TtmlToMp4Handler::OnStreamInfo(std::unique_ptr<StreamData> stream_data) {
 
 Status TtmlToMp4Handler::OnCueEvent(std::unique_ptr<StreamData> stream_data) {
   DCHECK(stream_data);
-  DCHECK(stream_data->cue_event);
+  DCHECK(stream_data->cue_event());
   return Dispatch(std::move(stream_data));
 }
 
 Status TtmlToMp4Handler::OnSegmentInfo(
     std::unique_ptr<StreamData> stream_data) {
   DCHECK(stream_data);
-  DCHECK(stream_data->segment_info);
+  DCHECK(stream_data->segment_info());
 
-  const auto& segment = stream_data->segment_info;
+  const auto& segment = stream_data->segment_info();
 
-  std::string data;
-  if (!generator_.Dump(&data))
+  if (!generator_.Dump(&document_))
     return Status(error::INTERNAL_ERROR, "Error generating XML");
   generator_.Reset();
 
   RETURN_IF_ERROR(DispatchMediaSample(
-      kTrackId,
-      CreateMediaSample(data, segment->start_timestamp, segment->duration)));
+      kTrackId, CreateMediaSample(document_, segment->start_timestamp,
+                                  segment->duration)));
 
   return Dispatch(std::move(stream_data));
 }
 
 Status TtmlToMp4Handler::OnTextSample(std::unique_ptr<StreamData> stream_data) {
   DCHECK(stream_data);
-  DCHECK(stream_data->text_sample);
+  DCHECK(stream_data->text_sample());
 
-  auto& sample = stream_data->text_sample;
+  auto& sample = stream_data->text_sample();
 
   // Ignore empty samples. This will create gaps, but we will handle that
   // later.
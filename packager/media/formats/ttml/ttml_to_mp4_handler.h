@@ -8,6 +8,7 @@
 #define PACKAGER_MEDIA_FORMATS_TTML_TTML_TO_MP4_HANDLER_H_
 
 #include <memory>
+#include <string>
 
 #include "packager/media/base/media_handler.h"
 #include "packager/media/formats/ttml/ttml_generator.h"
@@ -34,6 +35,8 @@ class TtmlToMp4Handler : public MediaHandler {
   Status OnTextSample(std::unique_ptr<StreamData> stream_data);
 
   TtmlGenerator generator_;
+  // The document of the segment, whose buffer is reused across segments.
+  std::string document_;
 };
 
 }  // namespace ttml
@@ -96,18 +96,11 @@ Status UpdateTrackForEncryption(const std::vector<uint8_t>& key_id,
   return Status::OK;
 }
 
-void UpdateFrameForEncryption(MediaSample* sample) {
-  DCHECK(sample);
-  BufferWriter header_buffer;
-  WriteEncryptedFrameHeader(sample->decrypt_config(), &header_buffer);
-
-  const size_t sample_size = header_buffer.Size() + sample->data_size();
-  std::shared_ptr<uint8_t> new_sample_data(new uint8_t[sample_size],
-                                           std::default_delete<uint8_t[]>());
-  memcpy(new_sample_data.get(), header_buffer.Buffer(), header_buffer.Size());
-  memcpy(&new_sample_data.get()[header_buffer.Size()], sample->data(),
-         sample->data_size());
-  sample->TransferData(std::move(new_sample_data), sample_size);
+void WriteFrameForEncryption(const MediaSample& sample, BufferWriter* frame) {
+  DCHECK(frame);
+  frame->Clear();
+  WriteEncryptedFrameHeader(sample.decrypt_config(), frame);
+  frame->AppendArray(sample.data(), sample.data_size());
 }
 
 }  // namespace webm
@@ -15,6 +15,7 @@
 namespace shaka {
 namespace media {
 
+class BufferWriter;
 class MediaSample;
 
 namespace webm {
@@ -24,9 +25,12 @@ namespace webm {
 Status UpdateTrackForEncryption(const std::vector<uint8_t>& key_id,
                                 mkvmuxer::Track* track);
 
-/// Update the frame with signal bytes and encryption information if it is
-/// encrypted.
-void UpdateFrameForEncryption(MediaSample* sample);
+/// Writes the frame of @a sample for an encrypted track, i.e. the signal byte,
+/// the IV and partitions if the sample is encrypted, and then the sample data,
+/// in a single pass.
+/// @param frame is cleared and receives the frame. Its buffer is kept, so
+///        reusing it avoids an allocation per frame.
+void WriteFrameForEncryption(const MediaSample& sample, BufferWriter* frame);
 
 }  // namespace webm
 }  // namespace media
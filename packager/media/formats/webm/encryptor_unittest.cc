@@ -8,6 +8,7 @@
 
 #include <gtest/gtest.h>
 #include <memory>
+#include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/formats/webm/webm_constants.h"
 #include "packager/status_test_util.h"
@@ -47,12 +48,22 @@ TEST(EncryptionUtilTest, UpdateTrackWithEmptyKeyId) {
 
 TEST(EncryptionUtilTest, SampleNotEncrypted) {
   auto sample = MediaSample::CopyFrom(kData, sizeof(kData), kKeyFrame);
-  UpdateFrameForEncryption(sample.get());
-  ASSERT_EQ(sizeof(kData) + 1, sample->data_size());
-  EXPECT_EQ(0u, sample->data()[0]);
+  BufferWriter frame;
+  WriteFrameForEncryption(*sample, &frame);
+  ASSERT_EQ(sizeof(kData) + 1, frame.Size());
+  EXPECT_EQ(0u, frame.Buffer()[0]);
   EXPECT_EQ(std::vector<uint8_t>(kData, kData + sizeof(kData)),
-            std::vector<uint8_t>(sample->data() + 1,
-                                 sample->data() + sample->data_size()));
+            std::vector<uint8_t>(frame.Buffer() + 1,
+                                 frame.Buffer() + frame.Size()));
+}
+
+TEST(EncryptionUtilTest, FrameBufferReused) {
+  auto sample = MediaSample::CopyFrom(kData, sizeof(kData), kKeyFrame);
+  BufferWriter frame;
+  frame.AppendArray(kKeyId, sizeof(kKeyId));
+  WriteFrameForEncryption(*sample, &frame);
+  ASSERT_EQ(sizeof(kData) + 1, frame.Size());
+  EXPECT_EQ(0u, frame.Buffer()[0]);
 }
 
 namespace {
@@ -112,27 +123,28 @@ TEST_P(EncryptionUtilEncryptedTest, SampleEncrypted) {
                             test_case.subsamples + test_case.num_subsamples)));
   sample->set_decrypt_config(std::move(decrypt_config));
 
-  UpdateFrameForEncryption(sample.get());
+  BufferWriter frame;
+  WriteFrameForEncryption(*sample, &frame);
   ASSERT_EQ(
       sizeof(kData) + sizeof(kIv) + test_case.subsample_partition_data_size + 1,
-      sample->data_size());
+      frame.Size());
   if (test_case.num_subsamples > 0)
-    EXPECT_EQ(kWebMEncryptedSignal | kWebMPartitionedSignal, sample->data()[0]);
+    EXPECT_EQ(kWebMEncryptedSignal | kWebMPartitionedSignal, frame.Buffer()[0]);
   else
-    EXPECT_EQ(kWebMEncryptedSignal, sample->data()[0]);
+    EXPECT_EQ(kWebMEncryptedSignal, frame.Buffer()[0]);
   EXPECT_EQ(std::vector<uint8_t>(kIv, kIv + sizeof(kIv)),
-            std::vector<uint8_t>(sample->data() + 1,
-                                 sample->data() + 1 + sizeof(kIv)));
+            std::vector<uint8_t>(frame.Buffer() + 1,
+                                 frame.Buffer() + 1 + sizeof(kIv)));
   EXPECT_EQ(std::vector<uint8_t>(test_case.subsample_partition_data,
                                  test_case.subsample_partition_data +
                                      test_case.subsample_partition_data_size),
-            std::vector<uint8_t>(sample->data() + 1 + sizeof(kIv),
-                                 sample->data() + 1 + sizeof(kIv) +
+            std::vector<uint8_t>(frame.Buffer() + 1 + sizeof(kIv),
+                                 frame.Buffer() + 1 + sizeof(kIv) +
                                      test_case.subsample_partition_data_size));
   EXPECT_EQ(std::vector<uint8_t>(kData, kData + sizeof(kData)),
-            std::vector<uint8_t>(sample->data() + 1 + sizeof(kIv) +
+            std::vector<uint8_t>(frame.Buffer() + 1 + sizeof(kIv) +
                                      test_case.subsample_partition_data_size,
-                                 sample->data() + sample->data_size()));
+                                 frame.Buffer() + frame.Size()));
 }
 
 namespace {
@@ -6,12 +6,25 @@
 
 #include "packager/media/formats/webm/mkv_writer.h"
 
+#include "packager/third_party/libwebm/src/webmids.hpp"
+
 namespace shaka {
 namespace media {
 
+namespace {
+// Data is written out at least this often, so a large Cluster is not held in
+// memory entirely.
+const size_t kMaxBufferSize = 1 << 20;
+}  // namespace
+
 MkvWriter::MkvWriter() : position_(0) {}
 
-MkvWriter::~MkvWriter() {}
+MkvWriter::~MkvWriter() {
+  // The file is closed by |file_|, but the buffered data still needs to be
+  // written.
+  if (file_)
+    FlushBuffer();
+}
 
 Status MkvWriter::Open(const std::string& name) {
   DCHECK(!file_);
@@ -23,12 +36,14 @@ Status MkvWriter::Open(const std::string& name) {
   // on File.
   seekable_ = file_->Seek(0);
   position_ = 0;
+  write_failed_ = false;
   return Status::OK;
 }
 
 Status MkvWriter::Close() {
   const std::string file_name = file_->file_name();
-  if (!file_.release()->Close()) {
+  const bool flushed = FlushBuffer();
+  if (!file_.release()->Close() || !flushed) {
     return Status(
         error::FILE_FAILURE,
         "Cannot close file " + file_name +
@@ -39,8 +54,21 @@ Status MkvWriter::Close() {
 
 mkvmuxer::int32 MkvWriter::Write(const void* buf, mkvmuxer::uint32 len) {
   DCHECK(file_);
+  if (write_failed_)
+    return -1;
+
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(buf);
+  if (buffer_.size() + len > kMaxBufferSize) {
+    if (!FlushBuffer())
+      return -1;
+  }
+  if (len < kMaxBufferSize) {
+    buffer_.insert(buffer_.end(), data, data + len);
+    position_ += len;
+    return 0;
+  }
 
-  const char* data = reinterpret_cast<const char*>(buf);
+  // Large data is written directly.
   int64_t total_bytes_written = 0;
   while (total_bytes_written < len) {
     const int64_t written =
@@ -62,6 +90,8 @@ int64_t MkvWriter::WriteFromFile(File* source) {
 
 int64_t MkvWriter::WriteFromFile(File* source, int64_t max_copy) {
   DCHECK(file_);
+  if (!FlushBuffer())
+    return -1;
 
   const int64_t size = File::CopyFile(source, file_.get(), max_copy);
   if (size < 0)
@@ -77,6 +107,8 @@ mkvmuxer::int64 MkvWriter::Position() const {
 
 mkvmuxer::int32 MkvWriter::Position(mkvmuxer::int64 position) {
   DCHECK(file_);
+  if (!FlushBuffer())
+    return -1;
 
   if (file_->Seek(position)) {
     position_ = position;
@@ -91,7 +123,32 @@ bool MkvWriter::Seekable() const {
 }
 
 void MkvWriter::ElementStartNotify(mkvmuxer::uint64 element_id,
-                                   mkvmuxer::int64 position) {}
+                                   mkvmuxer::int64 position) {
+  // Errors are reported by the next write.
+  if (element_id == mkvmuxer::kMkvCluster)
+    FlushBuffer();
+}
+
+bool MkvWriter::FlushBuffer() {
+  if (write_failed_)
+    return false;
+
+  uint64_t total_bytes_written = 0;
+  while (total_bytes_written < buffer_.size()) {
+    const int64_t written = file_->Write(buffer_.data() + total_bytes_written,
+                                         buffer_.size() - total_bytes_written);
+    if (written < 0) {
+      LOG(ERROR) << "Failed to write to " << file_->file_name();
+      write_failed_ = true;
+      buffer_.clear();
+      return false;
+    }
+    total_bytes_written += written;
+  }
+  // Keeps the capacity for the next Cluster.
+  buffer_.clear();
+  return true;
+}
 
 }  // namespace media
 }  // namespace shaka
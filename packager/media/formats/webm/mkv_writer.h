@@ -9,6 +9,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "packager/file/file_closer.h"
 #include "packager/status.h"
@@ -18,6 +19,10 @@ namespace shaka {
 namespace media {
 
 /// An implementation of IMkvWriter using our File type.
+/// mkvmuxer writes every element separately, so the data is buffered, and
+/// written to the File when a new Cluster starts, before seeking and when
+/// closing, i.e. with a single write per Cluster unless it is large. The
+/// buffer is reused, including across files if the writer is reopened.
 class MkvWriter : public mkvmuxer::IMkvWriter {
  public:
   MkvWriter();
@@ -28,8 +33,11 @@ class MkvWriter : public mkvmuxer::IMkvWriter {
   /// @param name The path to the file to open.
   /// @return Whether the operation succeeded.
   Status Open(const std::string& name);
-  /// Closes the file.  MUST call Open before calling any other methods.
+  /// Flushes the buffered data and closes the file.  MUST call Open before
+  /// calling any other methods.
   Status Close();
+  /// @return true if a file is open.
+  bool is_open() const { return static_cast<bool>(file_); }
 
   /// Writes out @a len bytes of @a buf.
   /// @return 0 on success.
@@ -45,7 +53,8 @@ class MkvWriter : public mkvmuxer::IMkvWriter {
   /// Element start notification. Called whenever an element identifier is about
   /// to be written to the stream.  @a element_id is the element identifier, and
   /// @a position is the location in the WebM stream where the first octet of
-  /// the element identifier will be written.
+  /// the element identifier will be written. The buffered data is written out
+  /// when a Cluster starts.
   /// Note: the |MkvId| enumeration in webmids.hpp defines element values.
   void ElementStartNotify(mkvmuxer::uint64 element_id,
                           mkvmuxer::int64 position) override;
@@ -61,7 +70,15 @@ class MkvWriter : public mkvmuxer::IMkvWriter {
   File* file() { return file_.get(); }
 
  private:
+  // Writes the buffered data to the file.
+  // @return true on success.
+  bool FlushBuffer();
+
   std::unique_ptr<File, FileCloser> file_;
+  // Data written but not yet passed to |file_|.
+  std::vector<uint8_t> buffer_;
+  // Set if writing the buffered data failed; all the following writes fail.
+  bool write_failed_ = false;
   // Keep track of the position and whether we can seek.
   mkvmuxer::int64 position_;
   bool seekable_;
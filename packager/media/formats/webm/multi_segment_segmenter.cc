@@ -8,6 +8,7 @@
 
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/muxer_util.h"
+#include "packager/media/base/segment_digest.h"
 #include "packager/media/base/stream_info.h"
 #include "packager/media/event/muxer_listener.h"
 #include "packager/status_macros.h"
@@ -18,7 +19,9 @@ namespace media {
 namespace webm {
 
 MultiSegmentSegmenter::MultiSegmentSegmenter(const MuxerOptions& options)
-    : Segmenter(options), num_segment_(0) {}
+    : Segmenter(options),
+      num_segment_(0),
+      segment_name_formatter_(options.segment_template) {}
 
 MultiSegmentSegmenter::~MultiSegmentSegmenter() {}
 
@@ -32,22 +35,43 @@ Status MultiSegmentSegmenter::FinalizeSegment(uint64_t start_timestamp,
     return Status(error::FILE_FAILURE, "Error finalizing segment.");
 
   if (!is_subsegment) {
-    std::string segment_name =
-        GetSegmentName(options().segment_template, start_timestamp,
-                       num_segment_, options().bandwidth);
+    std::string segment_name = segment_name_formatter_.Format(
+        start_timestamp, num_segment_, options().bandwidth);
 
     // Close the file, which also does flushing, to make sure the file is
     // written before manifest is updated.
     RETURN_IF_ERROR(writer_->Close());
 
-    if (!File::Copy(temp_file_name_.c_str(), segment_name.c_str()))
-      return Status(error::FILE_FAILURE, "Failure to copy memory file.");
+    std::vector<SegmentDigest> digests;
+    if (options().segment_digests.empty()) {
+      if (!File::Copy(temp_file_name_.c_str(), segment_name.c_str()))
+        return Status(error::FILE_FAILURE, "Failure to copy memory file.");
+    } else {
+      // The memory file is read once for both the copy and the digests.
+      std::string segment;
+      if (!File::ReadFileToString(temp_file_name_.c_str(), &segment) ||
+          !File::WriteStringToFile(segment_name.c_str(), segment)) {
+        return Status(error::FILE_FAILURE, "Failure to copy memory file.");
+      }
+      SegmentDigester digester(options().segment_digests);
+      digester.Update(reinterpret_cast<const uint8_t*>(segment.data()),
+                      segment.size());
+      digests = digester.Finish();
+    }
 
     if (!File::Delete(temp_file_name_.c_str()))
       return Status(error::FILE_FAILURE, "Failure to delete memory file.");
 
     num_segment_++;
 
+    if (!digests.empty()) {
+      if (options().segment_digest_file) {
+        RETURN_IF_ERROR(options().segment_digest_file->OnSegmentWritten(
+            segment_name, digests));
+      }
+      if (muxer_listener())
+        muxer_listener()->OnSegmentDigests(segment_name, digests);
+    }
     if (muxer_listener()) {
       const uint64_t size = cluster()->Size();
       muxer_listener()->OnNewSegment(segment_name, start_timestamp,
@@ -89,11 +113,12 @@ Status MultiSegmentSegmenter::NewSegment(uint64_t start_timestamp,
                                          bool is_subsegment) {
   if (!is_subsegment) {
     temp_file_name_ =
-        "memory://" + GetSegmentName(options().segment_template,
-                                     start_timestamp, num_segment_,
-                                     options().bandwidth);
+        "memory://" + segment_name_formatter_.Format(
+                          start_timestamp, num_segment_, options().bandwidth);
 
-    writer_.reset(new MkvWriter);
+    // Reuse the writer, and so its buffer, for every segment.
+    if (writer_->is_open())
+      RETURN_IF_ERROR(writer_->Close());
     Status status = writer_->Open(temp_file_name_);
 
     if (!status.ok())
@@ -9,6 +9,7 @@
 
 #include <memory>
 
+#include "packager/media/base/muxer_util.h"
 #include "packager/media/formats/webm/mkv_writer.h"
 #include "packager/media/formats/webm/segmenter.h"
 #include "packager/status.h"
@@ -48,6 +49,7 @@ class MultiSegmentSegmenter : public Segmenter {
 
   std::unique_ptr<MkvWriter> writer_;
   uint32_t num_segment_;
+  const SegmentNameFormatter segment_name_formatter_;
   std::string temp_file_name_;
 
   DISALLOW_COPY_AND_ASSIGN(MultiSegmentSegmenter);
@@ -185,9 +185,6 @@ Status Segmenter::AddSample(const MediaSample& source_sample) {
   if (!status.ok())
     return status;
 
-  if (is_encrypted_)
-    UpdateFrameForEncryption(sample.get());
-
   new_subsegment_ = false;
   new_segment_ = false;
   prev_sample_ = sample;
@@ -379,7 +376,17 @@ Status Segmenter::WriteFrame(bool write_duration) {
   // is not set, then a SimpleBlock will still be written.
   mkvmuxer::Frame frame;
 
-  if (!frame.Init(prev_sample_->data(), prev_sample_->data_size())) {
+  // The encryption header is written with the sample data into a reused
+  // buffer, instead of into a new copy of the sample, as the frame makes its
+  // own copy anyway.
+  const uint8_t* frame_data = prev_sample_->data();
+  size_t frame_size = prev_sample_->data_size();
+  if (is_encrypted_) {
+    WriteFrameForEncryption(*prev_sample_, &encrypted_frame_);
+    frame_data = encrypted_frame_.Buffer();
+    frame_size = encrypted_frame_.Size();
+  }
+  if (!frame.Init(frame_data, frame_size)) {
     return Status(error::MUXER_FAILURE,
                   "Error adding sample to segment: Frame::Init failed");
   }
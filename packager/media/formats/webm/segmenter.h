@@ -10,6 +10,7 @@
 #include <memory>
 
 #include "packager/base/optional.h"
+#include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/range.h"
 #include "packager/media/formats/webm/mkv_writer.h"
 #include "packager/media/formats/webm/seek_head.h"
@@ -100,6 +101,7 @@ class Segmenter {
   int track_id() const { return track_id_; }
   uint64_t segment_payload_pos() const { return segment_payload_pos_; }
 
+  uint64_t time_scale() const { return time_scale_; }
   uint64_t duration() const { return duration_; }
 
   virtual Status DoInitialize() = 0;
@@ -122,6 +124,9 @@ class Segmenter {
 
   // Store the previous sample so we know which one is the last frame.
   std::shared_ptr<const MediaSample> prev_sample_;
+  // The frame of |prev_sample_| with its encryption header if the track is
+  // encrypted. Reused across frames.
+  BufferWriter encrypted_frame_;
   // The reference frame timestamp; used to populate the ReferenceBlock element
   // when writing non-keyframe BlockGroups.
   uint64_t reference_frame_timestamp_ = 0;
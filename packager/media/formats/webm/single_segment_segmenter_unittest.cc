@@ -6,6 +6,7 @@
 
 #include <gtest/gtest.h>
 #include <memory>
+#include "packager/file/file.h"
 #include "packager/media/formats/webm/segmenter_test_base.h"
 
 namespace shaka {
@@ -289,5 +290,72 @@ TEST_F(SingleSegmentSegmenterTest, ReallyLargeTimestamp) {
   }
 }
 
+TEST_F(SingleSegmentSegmenterTest, WritesCuesInReservedSpace) {
+  MuxerOptions options = CreateMuxerOptions();
+  options.segment_duration_in_seconds = 5;
+  ASSERT_NO_FATAL_FAILURE(InitializeSegmenter(options));
+
+  // Write the samples to the Segmenter.
+  for (int i = 0; i < 8; i++) {
+    if (i == 5) {
+      ASSERT_OK(segmenter_->FinalizeSegment(0, 5 * kDuration, !kSubsegment));
+    }
+    std::shared_ptr<MediaSample> sample =
+        CreateSample(kKeyFrame, kDuration, kNoSideData);
+    ASSERT_OK(segmenter_->AddSample(*sample));
+  }
+  ASSERT_OK(
+      segmenter_->FinalizeSegment(5 * kDuration, 8 * kDuration, !kSubsegment));
+  ASSERT_OK(segmenter_->Finalize());
+
+  // Verify the resulting data.
+  ClusterParser parser;
+  ASSERT_NO_FATAL_FAILURE(parser.PopulateFromSegment(OutputFileName()));
+  ASSERT_EQ(2u, parser.cluster_count());
+  EXPECT_EQ(5u, parser.GetFrameCountForCluster(0));
+  EXPECT_EQ(3u, parser.GetFrameCountForCluster(1));
+
+  // The Cues immediately follow the header and precede the clusters.
+  uint64_t init_start = 0;
+  uint64_t init_end = 0;
+  uint64_t index_start = 0;
+  uint64_t index_end = 0;
+  ASSERT_TRUE(segmenter_->GetInitRangeStartAndEnd(&init_start, &init_end));
+  ASSERT_TRUE(segmenter_->GetIndexRangeStartAndEnd(&index_start, &index_end));
+  EXPECT_EQ(init_end + 1, index_start);
+  std::vector<Range> ranges = segmenter_->GetSegmentRanges();
+  ASSERT_EQ(2u, ranges.size());
+  EXPECT_LT(index_end, ranges[0].start);
+  EXPECT_EQ(File::GetFileSize(OutputFileName().c_str()),
+            static_cast<int64_t>(ranges[1].end + 1));
+}
+
+TEST_F(SingleSegmentSegmenterTest, WritesCuesAtEndIfReservedSpaceIsTooSmall) {
+  MuxerOptions options = CreateMuxerOptions();
+  // Only reserves space for three Cue points.
+  options.segment_duration_in_seconds = 8;
+  ASSERT_NO_FATAL_FAILURE(InitializeSegmenter(options));
+
+  // Write the samples to the Segmenter, one cluster each.
+  for (int i = 0; i < 8; i++) {
+    std::shared_ptr<MediaSample> sample =
+        CreateSample(kKeyFrame, kDuration, kNoSideData);
+    ASSERT_OK(segmenter_->AddSample(*sample));
+    ASSERT_OK(segmenter_->FinalizeSegment(i * kDuration, kDuration,
+                                          !kSubsegment));
+  }
+  ASSERT_OK(segmenter_->Finalize());
+
+  ClusterParser parser;
+  ASSERT_NO_FATAL_FAILURE(parser.PopulateFromSegment(OutputFileName()));
+  ASSERT_EQ(8u, parser.cluster_count());
+
+  uint64_t index_start = 0;
+  uint64_t index_end = 0;
+  ASSERT_TRUE(segmenter_->GetIndexRangeStartAndEnd(&index_start, &index_end));
+  EXPECT_EQ(File::GetFileSize(OutputFileName().c_str()),
+            static_cast<int64_t>(index_end + 1));
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -7,6 +7,9 @@
 #include "packager/media/formats/webm/two_pass_single_segment_segmenter.h"
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
 
 #include "packager/file/file_util.h"
 #include "packager/media/base/media_sample.h"
@@ -20,6 +23,29 @@ namespace shaka {
 namespace media {
 namespace webm {
 namespace {
+// Smallest Void element: the ID and a one byte size.
+const uint64_t kMinVoidElementSize = 2;
+
+// Writes a Void element of exactly |size| bytes, which should be at least
+// kMinVoidElementSize. Unlike mkvmuxer::WriteVoidElement, this supports any
+// such size and writes the payload at once.
+bool WriteVoid(uint64_t size, mkvmuxer::IMkvWriter* writer) {
+  DCHECK_GE(size, kMinVoidElementSize);
+  const uint64_t kVoidIdSize = 1;
+  // A one byte size is only used for small elements, so the payload size
+  // always fits.
+  const int32_t size_size = size <= 9 ? 1 : 8;
+  const uint64_t payload_size = size - kVoidIdSize - size_size;
+  if (mkvmuxer::WriteID(writer, mkvmuxer::kMkvVoid) != 0 ||
+      mkvmuxer::WriteUIntSize(writer, payload_size, size_size) != 0) {
+    return false;
+  }
+  if (payload_size == 0)
+    return true;
+  const std::vector<uint8_t> payload(payload_size);
+  return writer->Write(payload.data(), payload_size) == 0;
+}
+
 // Cues will be inserted before clusters. All clusters will be shifted down by
 // the size of cues. However, cluster positions affect the size of cues. This
 // function adjusts cues size iteratively until it is stable.
@@ -69,6 +95,30 @@ TwoPassSingleSegmentSegmenter::TwoPassSingleSegmentSegmenter(
 TwoPassSingleSegmentSegmenter::~TwoPassSingleSegmentSegmenter() {}
 
 Status TwoPassSingleSegmentSegmenter::DoInitialize() {
+  const uint64_t cues_size = EstimateCuesSize();
+  if (cues_size > 0) {
+    std::unique_ptr<MkvWriter> output(new MkvWriter);
+    Status status = output->Open(options().output_file_name);
+    if (!status.ok())
+      return status;
+    if (output->Seekable()) {
+      set_writer(std::move(output));
+      status = SingleSegmentSegmenter::DoInitialize();
+      if (!status.ok())
+        return status;
+      // Reserve space for the Cues between the header and the clusters, like
+      // the SeekHead is reserved in the header.
+      if (!WriteVoid(cues_size, writer()))
+        return Status(error::FILE_FAILURE, "Error reserving space for Cues.");
+      cues_void_size_ = cues_size;
+      seek_head()->set_cluster_pos(writer()->Position() -
+                                   segment_payload_pos());
+      return Status::OK;
+    }
+    // Keep the output open, as it may not support being opened twice.
+    output_writer_ = std::move(output);
+  }
+
   // Assume the amount of time to copy the temp file as the same amount
   // of time as to make it.
   set_progress_target(duration() * 2);
@@ -85,6 +135,9 @@ Status TwoPassSingleSegmentSegmenter::DoInitialize() {
 }
 
 Status TwoPassSingleSegmentSegmenter::DoFinalize() {
+  if (cues_void_size_ > 0)
+    return FinalizeInPlace();
+
   const uint64_t header_size = init_end() + 1;
   const uint64_t cues_pos = header_size - segment_payload_pos();
   const uint64_t cues_size = UpdateCues(cues());
@@ -92,10 +145,13 @@ Status TwoPassSingleSegmentSegmenter::DoFinalize() {
   seek_head()->set_cluster_pos(cues_pos + cues_size);
 
   // Write the header to the real output file.
-  std::unique_ptr<MkvWriter> real_writer(new MkvWriter);
-  Status status = real_writer->Open(options().output_file_name);
-  if (!status.ok())
-    return status;
+  std::unique_ptr<MkvWriter> real_writer = std::move(output_writer_);
+  if (!real_writer) {
+    real_writer.reset(new MkvWriter);
+    Status status = real_writer->Open(options().output_file_name);
+    if (!status.ok())
+      return status;
+  }
 
   const uint64_t file_size = writer()->Position() + cues_size;
   Status temp = WriteSegmentHeader(file_size, real_writer.get());
@@ -137,6 +193,71 @@ Status TwoPassSingleSegmentSegmenter::DoFinalize() {
   return real_writer->Close();
 }
 
+uint64_t TwoPassSingleSegmentSegmenter::EstimateCuesSize() {
+  const double segment_duration = options().segment_duration_in_seconds;
+  if (segment_duration <= 0 || duration() == 0 || time_scale() == 0)
+    return 0;
+  // Segments are cut at the first key frame after the segment boundary, so the
+  // first and the last segments may be partial.
+  const uint64_t num_cue_points =
+      static_cast<uint64_t>(std::ceil(static_cast<double>(duration()) /
+                                      time_scale() / segment_duration)) +
+      2;
+
+  // The cluster positions are not known yet, so assume the largest possible
+  // values.
+  const uint64_t kMaxValue = std::numeric_limits<uint64_t>::max();
+  const uint64_t track_positions_payload_size =
+      mkvmuxer::EbmlElementSize(mkvmuxer::kMkvCueTrack,
+                                static_cast<uint64_t>(track_id())) +
+      mkvmuxer::EbmlElementSize(mkvmuxer::kMkvCueClusterPosition, kMaxValue);
+  const uint64_t cue_point_payload_size =
+      mkvmuxer::EbmlElementSize(mkvmuxer::kMkvCueTime, kMaxValue) +
+      mkvmuxer::EbmlMasterElementSize(mkvmuxer::kMkvCueTrackPositions,
+                                      track_positions_payload_size) +
+      track_positions_payload_size;
+  const uint64_t cue_point_size =
+      mkvmuxer::EbmlMasterElementSize(mkvmuxer::kMkvCuePoint,
+                                      cue_point_payload_size) +
+      cue_point_payload_size;
+  const uint64_t cues_payload_size = num_cue_points * cue_point_size;
+  return mkvmuxer::EbmlMasterElementSize(mkvmuxer::kMkvCues,
+                                         cues_payload_size) +
+         cues_payload_size;
+}
+
+Status TwoPassSingleSegmentSegmenter::FinalizeInPlace() {
+  const uint64_t cues_size = cues()->Size();
+  if (cues_size != cues_void_size_ &&
+      cues_size + kMinVoidElementSize > cues_void_size_) {
+    LOG(WARNING) << "Cues size " << cues_size << " exceeds the reserved size "
+                 << cues_void_size_ << ". Writing Cues to the end of the file.";
+    return SingleSegmentSegmenter::DoFinalize();
+  }
+
+  const uint64_t file_size = writer()->Position();
+  const uint64_t cues_pos = init_end() + 1;
+  if (writer()->Position(cues_pos) != 0)
+    return Status(error::FILE_FAILURE, "Error seeking to Cues.");
+
+  set_index_start(cues_pos);
+  seek_head()->set_cues_pos(cues_pos - segment_payload_pos());
+  if (!cues()->Write(writer()))
+    return Status(error::FILE_FAILURE, "Error writing Cues data.");
+  set_index_end(writer()->Position() - 1);
+
+  // Fill the rest of the reserved space.
+  const uint64_t void_size = cues_void_size_ - cues_size;
+  if (void_size > 0 && !WriteVoid(void_size, writer()))
+    return Status(error::FILE_FAILURE, "Error writing Void element.");
+
+  if (writer()->Position(0) != 0)
+    return Status(error::FILE_FAILURE, "Error seeking to Segment header.");
+  Status status = WriteSegmentHeader(file_size, writer());
+  status.Update(writer()->Close());
+  return status;
+}
+
 bool TwoPassSingleSegmentSegmenter::CopyFileWithClusterRewrite(
     File* source,
     MkvWriter* dest,
@@ -23,6 +23,9 @@ namespace webm {
 
 /// An implementation of a Segmenter for a single-segment that performs two
 /// passes.  This does not use seeking and is used for non-seekable files.
+/// If the output is seekable and the number of clusters can be estimated, the
+/// Cues are written in place in a Void element reserved before the clusters
+/// instead, in a single pass.
 class TwoPassSingleSegmentSegmenter : public SingleSegmentSegmenter {
  public:
   explicit TwoPassSingleSegmentSegmenter(const MuxerOptions& options);
@@ -33,6 +36,12 @@ class TwoPassSingleSegmentSegmenter : public SingleSegmentSegmenter {
   Status DoFinalize() override;
 
  private:
+  /// @return The maximum size of the Cues for the estimated number of
+  ///         clusters, or 0 if the number of clusters cannot be estimated.
+  uint64_t EstimateCuesSize();
+  /// Writes the Cues in the Void element reserved by DoInitialize.
+  Status FinalizeInPlace();
+
   /// Copies the data from source to destination while rewriting the Cluster
   /// sizes to the correct values.  This assumes that both @a source and
   /// @a dest are at the same position and that the headers have already
@@ -42,6 +51,11 @@ class TwoPassSingleSegmentSegmenter : public SingleSegmentSegmenter {
                                   uint64_t last_size);
 
   std::string temp_file_name_;
+  // The real output, if it was opened before the first pass.
+  std::unique_ptr<MkvWriter> output_writer_;
+  // Size of the Void element reserved for the Cues; 0 if performing two
+  // passes.
+  uint64_t cues_void_size_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(TwoPassSingleSegmentSegmenter);
 };
@@ -78,6 +78,7 @@
         'tracks_builder.h',
         'webm_cluster_parser_unittest.cc',
         'webm_content_encodings_client_unittest.cc',
+        'webm_media_parser_unittest.cc',
         'webm_parser_unittest.cc',
         'webm_tracks_parser_unittest.cc',
         'webm_webvtt_parser_unittest.cc',
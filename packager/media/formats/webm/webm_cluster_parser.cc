@@ -99,6 +99,15 @@ bool WebMClusterParser::Flush() {
 int WebMClusterParser::Parse(const uint8_t* buf, int size) {
   int result = parser_.Parse(buf, size);
 
+  // The Block of a BlockGroup is referenced in |buf| until the end of the
+  // BlockGroup, so it is only copied if the BlockGroup continues in the next
+  // buffer.
+  if (block_ && !block_data_) {
+    block_data_.reset(new uint8_t[block_data_size_]);
+    memcpy(block_data_.get(), block_, block_data_size_);
+    block_ = block_data_.get();
+  }
+
   if (result < 0) {
     cluster_ended_ = false;
     return result;
@@ -129,11 +138,25 @@ int WebMClusterParser::Parse(const uint8_t* buf, int size) {
   return result;
 }
 
+void WebMClusterParser::SetSelectedTracks(
+    const std::set<uint32_t>& track_ids) {
+  all_tracks_selected_ = false;
+  selected_track_ids_ = track_ids;
+}
+
+bool WebMClusterParser::IsTrackSkipped(int64_t track_num) const {
+  if (ignored_tracks_.find(track_num) != ignored_tracks_.end())
+    return true;
+  return initialized_ && !all_tracks_selected_ &&
+         selected_track_ids_.count(static_cast<uint32_t>(track_num)) == 0;
+}
+
 WebMParserClient* WebMClusterParser::OnListStart(int id) {
   if (id == kWebMIdCluster) {
     cluster_timecode_ = -1;
     cluster_start_time_ = kNoTimestamp;
   } else if (id == kWebMIdBlockGroup) {
+    block_ = nullptr;
     block_data_.reset();
     block_data_size_ = -1;
     block_duration_ = -1;
@@ -154,15 +177,16 @@ bool WebMClusterParser::OnListEnd(int id) {
     return true;
 
   // Make sure the BlockGroup actually had a Block.
-  if (block_data_size_ == -1) {
+  if (!block_) {
     LOG(ERROR) << "Block missing from BlockGroup.";
     return false;
   }
 
   bool result = ParseBlock(
-      false, block_data_.get(), block_data_size_, block_additional_data_.get(),
+      false, block_, block_data_size_, block_additional_data_.get(),
       block_additional_data_size_, block_duration_,
       discard_padding_set_ ? discard_padding_ : 0, reference_block_set_);
+  block_ = nullptr;
   block_data_.reset();
   block_data_size_ = -1;
   block_duration_ = -1;
@@ -248,13 +272,13 @@ bool WebMClusterParser::OnBinary(int id, const uint8_t* data, int size) {
       return ParseBlock(true, data, size, NULL, 0, -1, 0, false);
 
     case kWebMIdBlock:
-      if (block_data_) {
+      if (block_) {
         LOG(ERROR) << "More than 1 Block in a BlockGroup is not "
                       "supported.";
         return false;
       }
-      block_data_.reset(new uint8_t[size]);
-      memcpy(block_data_.get(), data, size);
+      // Copied in Parse() only if the BlockGroup does not end in this buffer.
+      block_ = data;
       block_data_size_ = size;
       return true;
 
@@ -356,6 +380,14 @@ bool WebMClusterParser::OnBlock(bool is_simple_block,
   }
   DCHECK_NE(stream_type, kStreamUnknown);
 
+  // The blocks of the tracks that are not selected are still needed to
+  // initialize the streams, e.g. the first video frame for the VPx codec
+  // configuration.
+  if (initialized_ && !all_tracks_selected_ &&
+      selected_track_ids_.count(static_cast<uint32_t>(track_num)) == 0) {
+    return true;
+  }
+
   last_block_timecode_ = timecode;
 
   int64_t timestamp = (cluster_timecode_ + timecode) * timecode_multiplier_;
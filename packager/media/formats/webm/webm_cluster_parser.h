@@ -148,6 +148,14 @@ class WebMClusterParser : public WebMParserClient {
   /// @return The number of bytes parsed on success.
   int Parse(const uint8_t* buf, int size);
 
+  /// Limits the samples to the tracks in @a track_ids. The blocks of the other
+  /// tracks are skipped once the streams are initialized.
+  void SetSelectedTracks(const std::set<uint32_t>& track_ids);
+
+  /// @return true if the blocks of track @a track_num are currently skipped,
+  ///         so they do not need to be passed to Parse.
+  bool IsTrackSkipped(int64_t track_num) const;
+
   int64_t cluster_start_time() const { return cluster_start_time_; }
 
   /// @return true if the last Parse() call stopped at the end of a cluster.
@@ -193,6 +201,8 @@ class WebMClusterParser : public WebMParserClient {
   std::shared_ptr<VideoStreamInfo> video_stream_info_;
   VPCodecConfigurationRecord vp_config_;
   std::set<int64_t> ignored_tracks_;
+  bool all_tracks_selected_ = true;
+  std::set<uint32_t> selected_track_ids_;
 
   std::unique_ptr<DecryptorSource> decryptor_source_;
   std::string audio_encryption_key_id_;
@@ -207,6 +217,9 @@ class WebMClusterParser : public WebMParserClient {
   MediaParser::InitCB init_cb_;
 
   int64_t last_block_timecode_ = -1;
+  // The Block of the current BlockGroup. Points into the buffer being parsed,
+  // or into |block_data_| if the BlockGroup spans Parse() calls.
+  const uint8_t* block_ = nullptr;
   std::unique_ptr<uint8_t[]> block_data_;
   int block_data_size_ = -1;
   int64_t block_duration_ = -1;
@@ -666,6 +666,40 @@ TEST_F(WebMClusterParserTest, ParseBlockGroup) {
   ASSERT_TRUE(VerifyBuffers(kBlockInfo, block_count));
 }
 
+// The Block is referenced in the input buffer until the end of its BlockGroup,
+// so it must be copied when the BlockGroup spans Parse() calls.
+TEST_F(WebMClusterParserTest, ParseBlockGroupWithMultipleCalls) {
+  const BlockInfo kBlockInfo[] = {
+      {kAudioTrackNum, 0, 23, false, NULL, 0, true},
+  };
+  int block_count = arraysize(kBlockInfo);
+
+  const uint8_t kClusterData[] = {
+    0x1F, 0x43, 0xB6, 0x75, 0x8F,  // Cluster(size=15)
+    0xE7, 0x81, 0x00,  // Timecode(size=1, value=0)
+    0xA0, 0x8A,  // BlockGroup(size=10)
+    0xA1, 0x85, 0x81, 0x00, 0x00, 0x00, 0xaa,  // Block(size=5, track=1, ts=0)
+    0x9B, 0x81, 0x17,  // BlockDuration(size=1, value=23)
+  };
+  const int kClusterSize = arraysize(kClusterData);
+  // Everything up to and including the Block.
+  const int kFirstParseSize = 17;
+
+  // The buffer is overwritten after each call, as the caller may reuse it.
+  std::vector<uint8_t> buffer(kClusterData, kClusterData + kFirstParseSize);
+  EXPECT_EQ(kFirstParseSize, parser_->Parse(buffer.data(), buffer.size()));
+  std::fill(buffer.begin(), buffer.end(), 0);
+  EXPECT_TRUE(audio_buffers_.empty());
+
+  buffer.assign(kClusterData + kFirstParseSize, kClusterData + kClusterSize);
+  EXPECT_EQ(kClusterSize - kFirstParseSize,
+            parser_->Parse(buffer.data(), buffer.size()));
+  ASSERT_EQ(1u, audio_buffers_.size());
+  ASSERT_EQ(1u, audio_buffers_[0]->data_size());
+  EXPECT_EQ(0xaa, audio_buffers_[0]->data()[0]);
+  ASSERT_TRUE(VerifyBuffers(kBlockInfo, block_count));
+}
+
 TEST_F(WebMClusterParserTest, ParseSimpleBlockAndBlockGroupMixture) {
   const BlockInfo kBlockInfo[] = {
       {kAudioTrackNum, 0, 23, true, NULL, 0, false},
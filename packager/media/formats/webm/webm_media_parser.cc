@@ -4,11 +4,13 @@
 
 #include "packager/media/formats/webm/webm_media_parser.h"
 
+#include <algorithm>
 #include <string>
 
 #include "packager/base/callback.h"
 #include "packager/base/callback_helpers.h"
 #include "packager/base/logging.h"
+#include "packager/file/file.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/timestamp.h"
 #include "packager/media/formats/webm/webm_cluster_parser.h"
@@ -20,6 +22,78 @@
 namespace shaka {
 namespace media {
 
+namespace {
+
+// Large enough for the headers of a BlockGroup and its Block, and the track
+// number.
+const int kBlockPeekSize = 32;
+// The largest element ID and size.
+const int kMaxElementHeaderSize = 12;
+
+// Reads the header of the element at |offset| of |file|.
+// Returns the size of the header, or a non-positive value on failure or at the
+// end of the file.
+int ReadElementHeader(File* file,
+                      uint64_t offset,
+                      int* id,
+                      int64_t* element_size) {
+  uint8_t header[kMaxElementHeaderSize];
+  if (!file->Seek(offset))
+    return -1;
+  int64_t bytes_read = 0;
+  while (bytes_read < kMaxElementHeaderSize) {
+    const int64_t result =
+        file->Read(header + bytes_read, kMaxElementHeaderSize - bytes_read);
+    if (result < 0)
+      return -1;
+    if (result == 0)
+      break;
+    bytes_read += result;
+  }
+  return WebMParseElementHeader(header, static_cast<int>(bytes_read), id,
+                                element_size);
+}
+
+// Parses the track number at the start of the payload of a Block or a
+// SimpleBlock. Returns false if it does not fit in |size|.
+bool ParseBlockTrackNumber(const uint8_t* buf, int size, int64_t* track_num) {
+  if (size < 1)
+    return false;
+  int length = 1;
+  uint8_t mask = 0x80;
+  while (length <= 8 && !(buf[0] & mask)) {
+    mask >>= 1;
+    ++length;
+  }
+  if (length > 8 || length > size)
+    return false;
+  *track_num = buf[0] & (mask - 1);
+  for (int i = 1; i < length; ++i)
+    *track_num = (*track_num << 8) | buf[i];
+  return true;
+}
+
+// Parses the track number of the SimpleBlock or BlockGroup in |buf|, which
+// starts with the payload of the element. Returns false if it is not known.
+bool ParseTrackNumber(int id,
+                      const uint8_t* buf,
+                      int size,
+                      int64_t* track_num) {
+  if (id == kWebMIdSimpleBlock)
+    return ParseBlockTrackNumber(buf, size, track_num);
+  if (id != kWebMIdBlockGroup)
+    return false;
+  // The Block usually comes first in the BlockGroup.
+  int child_id = 0;
+  int64_t child_size = 0;
+  const int result = WebMParseElementHeader(buf, size, &child_id, &child_size);
+  if (result <= 0 || child_id != kWebMIdBlock)
+    return false;
+  return ParseBlockTrackNumber(buf + result, size - result, track_num);
+}
+
+}  // namespace
+
 WebMMediaParser::WebMMediaParser()
     : state_(kWaitingForInit), unknown_segment_size_(false) {}
 
@@ -54,6 +128,13 @@ bool WebMMediaParser::Flush() {
   return result;
 }
 
+void WebMMediaParser::SetSelectedTracks(const std::set<uint32_t>& track_ids) {
+  all_tracks_selected_ = false;
+  selected_track_ids_ = track_ids;
+  if (cluster_parser_)
+    cluster_parser_->SetSelectedTracks(track_ids);
+}
+
 bool WebMMediaParser::Parse(const uint8_t* buf, int size) {
   DCHECK_NE(state_, kWaitingForInit);
 
@@ -102,6 +183,188 @@ bool WebMMediaParser::Parse(const uint8_t* buf, int size) {
   return true;
 }
 
+bool WebMMediaParser::InitRandomAccess(const std::string& file_path) {
+  DCHECK_EQ(state_, kParsingHeaders);
+  DCHECK(!cluster_parser_);
+
+  std::unique_ptr<File, FileCloser> file(
+      File::OpenWithNoBuffering(file_path.c_str(), "r"));
+  if (!file) {
+    LOG(ERROR) << "Unable to open media file '" << file_path << "'";
+    return false;
+  }
+
+  // Locate the top level elements by their headers. The Cues are not used as
+  // they may not list every Cluster.
+  uint64_t position = 0;
+  uint64_t segment_end = 0;
+  std::vector<uint8_t> info_and_tracks;
+  std::vector<std::pair<uint64_t, uint64_t>> clusters;
+  while (segment_end == 0 || position < segment_end) {
+    int id = 0;
+    int64_t element_size = 0;
+    const int header_size =
+        ReadElementHeader(file.get(), position, &id, &element_size);
+    if (header_size <= 0) {
+      if (segment_end == 0 || header_size < 0) {
+        VLOG(1) << "Unable to locate the elements of '" << file_path << "'";
+        return false;
+      }
+      // The file is shorter than the Segment size.
+      break;
+    }
+    if (element_size == kWebMUnknownSize) {
+      VLOG(1) << "Element of unknown size in '" << file_path
+              << "', which is not read with random access.";
+      return false;
+    }
+    const uint64_t total_size = header_size + element_size;
+    switch (id) {
+      case kWebMIdSegment:
+        if (segment_end != 0) {
+          LOG(WARNING) << "Multiple Segments in '" << file_path << "'";
+          return false;
+        }
+        segment_end = position + total_size;
+        position += header_size;
+        continue;
+      case kWebMIdInfo:
+      case kWebMIdTracks: {
+        // Parsed together, Info first.
+        if ((id == kWebMIdInfo) != info_and_tracks.empty())
+          return false;
+        const size_t offset = info_and_tracks.size();
+        info_and_tracks.resize(offset + total_size);
+        if (!File::ReadAt(file.get(), position, total_size,
+                          &info_and_tracks[offset])) {
+          return false;
+        }
+        break;
+      }
+      case kWebMIdCluster:
+        clusters.emplace_back(position, total_size);
+        break;
+      default:
+        break;
+    }
+    position += total_size;
+  }
+
+  if (info_and_tracks.empty() || clusters.empty())
+    return false;
+  const int result = ParseInfoAndTracks(
+      info_and_tracks.data(), static_cast<int>(info_and_tracks.size()));
+  if (result != static_cast<int>(info_and_tracks.size())) {
+    LOG(ERROR) << "Error parsing the Info and Tracks of '" << file_path << "'";
+    return false;
+  }
+
+  ChangeState(kParsingClusters);
+  random_access_file_ = std::move(file);
+  clusters_ = std::move(clusters);
+  next_cluster_index_ = 0;
+  return true;
+}
+
+bool WebMMediaParser::ReadNextChunk(bool* end_of_stream) {
+  DCHECK(random_access_file_);
+  DCHECK(end_of_stream);
+
+  *end_of_stream = false;
+  if (state_ == kError)
+    return false;
+  if (next_cluster_index_ == clusters_.size()) {
+    *end_of_stream = true;
+    return true;
+  }
+
+  const std::pair<uint64_t, uint64_t>& cluster = clusters_[next_cluster_index_];
+  ++next_cluster_index_;
+  std::vector<uint8_t> data;
+  if (!ReadCluster(cluster.first, cluster.second, &data)) {
+    LOG(ERROR) << "Error reading Cluster at offset " << cluster.first;
+    ChangeState(kError);
+    return false;
+  }
+
+  const uint8_t* cur = data.data();
+  int cur_size = static_cast<int>(data.size());
+  while (cur_size > 0) {
+    const int result = cluster_parser_->Parse(cur, cur_size);
+    if (result <= 0) {
+      ChangeState(kError);
+      return false;
+    }
+    cur += result;
+    cur_size -= result;
+  }
+  return true;
+}
+
+bool WebMMediaParser::ReadCluster(uint64_t cluster_offset,
+                                  uint64_t cluster_size,
+                                  std::vector<uint8_t>* data) {
+  File* file = random_access_file_.get();
+  if (all_tracks_selected_) {
+    data->resize(cluster_size);
+    return File::ReadAt(file, cluster_offset, cluster_size, data->data());
+  }
+
+  int id = 0;
+  int64_t payload_size = 0;
+  const int header_size =
+      ReadElementHeader(file, cluster_offset, &id, &payload_size);
+  if (header_size <= 0)
+    return false;
+  const uint64_t cluster_end = cluster_offset + cluster_size;
+
+  // The Cluster is rebuilt with the elements kept, with an 8 byte size.
+  const int kClusterIdSize = 4;
+  const int kClusterSizeSize = 8;
+  const int kClusterHeaderSize = kClusterIdSize + kClusterSizeSize;
+  data->resize(kClusterHeaderSize);
+  uint64_t position = cluster_offset + header_size;
+  while (position < cluster_end) {
+    uint8_t peek[kBlockPeekSize];
+    const int peek_size = static_cast<int>(
+        std::min<uint64_t>(kBlockPeekSize, cluster_end - position));
+    if (!File::ReadAt(file, position, peek_size, peek))
+      return false;
+    int element_id = 0;
+    int64_t element_size = 0;
+    const int element_header_size =
+        WebMParseElementHeader(peek, peek_size, &element_id, &element_size);
+    if (element_header_size <= 0 || element_size == kWebMUnknownSize)
+      return false;
+    const uint64_t total_size = element_header_size + element_size;
+    if (position + total_size > cluster_end)
+      return false;
+
+    int64_t track_num = 0;
+    const bool skipped =
+        ParseTrackNumber(element_id, peek + element_header_size,
+                         peek_size - element_header_size, &track_num) &&
+        cluster_parser_->IsTrackSkipped(track_num);
+    if (!skipped) {
+      const size_t offset = data->size();
+      data->resize(offset + total_size);
+      if (!File::ReadAt(file, position, total_size, &(*data)[offset]))
+        return false;
+    }
+    position += total_size;
+  }
+
+  BufferWriter header(kClusterHeaderSize);
+  header.AppendInt(static_cast<uint32_t>(kWebMIdCluster));
+  // A 0x01 marker followed by 7 bytes of value.
+  header.AppendInt(static_cast<uint8_t>(0x01));
+  header.AppendNBytes(data->size() - kClusterHeaderSize, kClusterSizeSize - 1);
+  DCHECK_EQ(header.Size(), static_cast<size_t>(kClusterHeaderSize));
+  std::copy(header.Buffer(), header.Buffer() + kClusterHeaderSize,
+            data->begin());
+  return true;
+}
+
 void WebMMediaParser::ChangeState(State new_state) {
   DVLOG(1) << "ChangeState() : " << state_ << " -> " << new_state;
   state_ = new_state;
@@ -215,6 +478,8 @@ int WebMMediaParser::ParseInfoAndTracks(const uint8_t* data, int size) {
       tracks_parser.audio_encryption_key_id(),
       tracks_parser.video_encryption_key_id(), new_sample_cb_, init_cb_,
       decryption_key_source_));
+  if (!all_tracks_selected_)
+    cluster_parser_->SetSelectedTracks(selected_track_ids_);
 
   return bytes_parsed;
 }
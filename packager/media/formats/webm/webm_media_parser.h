@@ -5,8 +5,14 @@
 #ifndef PACKAGER_MEDIA_FORMATS_WEBM_WEBM_MEDIA_PARSER_H_
 #define PACKAGER_MEDIA_FORMATS_WEBM_WEBM_MEDIA_PARSER_H_
 
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "packager/base/callback_forward.h"
 #include "packager/base/compiler_specific.h"
+#include "packager/file/file_closer.h"
 #include "packager/media/base/byte_queue.h"
 #include "packager/media/base/media_parser.h"
 
@@ -28,8 +34,25 @@ class WebMMediaParser : public MediaParser {
             KeySource* decryption_key_source) override;
   bool Flush() override WARN_UNUSED_RESULT;
   bool Parse(const uint8_t* buf, int size) override WARN_UNUSED_RESULT;
+  void SetSelectedTracks(const std::set<uint32_t>& track_ids) override;
   /// @}
 
+  /// Sets up random access reads of a WebM file with a known Segment size.
+  /// The top level elements are located up front by their headers, the Info
+  /// and Tracks are parsed, then the file is read one Cluster at a time. The
+  /// blocks of the tracks that are not selected are skipped without being
+  /// read. Must be called after Init and instead of Parse.
+  /// @param file_path is the path to the media file to be read.
+  /// @return true if successful, false otherwise, e.g. for a live stream. The
+  ///         file can still be parsed with Parse if it fails.
+  bool InitRandomAccess(const std::string& file_path) override;
+
+  /// Reads and emits the samples of the next Cluster. Only valid after
+  /// InitRandomAccess succeeds.
+  /// @param[out] end_of_stream is set to true if all the Clusters are read.
+  /// @return true if successful, false otherwise.
+  bool ReadNextChunk(bool* end_of_stream) override WARN_UNUSED_RESULT;
+
  private:
   enum State {
     kWaitingForInit,
@@ -59,6 +82,13 @@ class WebMMediaParser : public MediaParser {
   // Returning > 0 indicates success & the number of bytes parsed.
   int ParseCluster(const uint8_t* data, int size);
 
+  // Reads the Cluster at |cluster_offset| of |cluster_size| bytes into |data|.
+  // The blocks of the skipped tracks are left out, with the Cluster size
+  // updated accordingly.
+  bool ReadCluster(uint64_t cluster_offset,
+                   uint64_t cluster_size,
+                   std::vector<uint8_t>* data);
+
   // Fetch keys for the input key ids. Returns true on success, false otherwise.
   bool FetchKeysIfNecessary(const std::string& audio_encryption_key_id,
                             const std::string& video_encryption_key_id);
@@ -72,8 +102,16 @@ class WebMMediaParser : public MediaParser {
   bool unknown_segment_size_;
 
   std::unique_ptr<WebMClusterParser> cluster_parser_;
+  bool all_tracks_selected_ = true;
+  std::set<uint32_t> selected_track_ids_;
   ByteQueue byte_queue_;
 
+  // Used for random access reads only.
+  std::unique_ptr<File, FileCloser> random_access_file_;
+  // Offset and size of the Clusters in |random_access_file_|.
+  std::vector<std::pair<uint64_t, uint64_t>> clusters_;
+  size_t next_cluster_index_ = 0;
+
   DISALLOW_COPY_AND_ASSIGN(WebMMediaParser);
 };
 
@@ -0,0 +1,130 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/webm/webm_media_parser.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "packager/base/bind.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/stream_info.h"
+#include "packager/media/test/test_data_util.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const char kMediaFile[] = "bear-320x240.webm";
+const char kLiveMediaFile[] = "bear-320x240-live.webm";
+}  // namespace
+
+class WebMMediaParserTest : public testing::Test {
+ protected:
+  void InitF(const std::vector<std::shared_ptr<StreamInfo>>& streams) {
+    for (const auto& stream_info : streams)
+      track_ids_.insert(stream_info->track_id());
+  }
+
+  bool NewSampleF(uint32_t track_id, std::shared_ptr<MediaSample> sample) {
+    ++num_samples_;
+    ++num_samples_per_track_[track_id];
+    return true;
+  }
+
+  bool NewTextSampleF(uint32_t track_id, std::shared_ptr<TextSample> sample) {
+    return false;
+  }
+
+  void InitializeParser() {
+    parser_.reset(new WebMMediaParser);
+    track_ids_.clear();
+    num_samples_ = 0;
+    num_samples_per_track_.clear();
+    parser_->Init(
+        base::Bind(&WebMMediaParserTest::InitF, base::Unretained(this)),
+        base::Bind(&WebMMediaParserTest::NewSampleF, base::Unretained(this)),
+        base::Bind(&WebMMediaParserTest::NewTextSampleF,
+                   base::Unretained(this)),
+        nullptr);
+  }
+
+  bool ParseWebMFile(const std::string& filename) {
+    std::vector<uint8_t> buffer = ReadTestDataFile(filename);
+    return parser_->Parse(buffer.data(), static_cast<int>(buffer.size())) &&
+           parser_->Flush();
+  }
+
+  bool ReadAllChunks() {
+    bool end_of_stream = false;
+    while (!end_of_stream) {
+      if (!parser_->ReadNextChunk(&end_of_stream))
+        return false;
+    }
+    return parser_->Flush();
+  }
+
+  std::unique_ptr<WebMMediaParser> parser_;
+  std::set<uint32_t> track_ids_;
+  size_t num_samples_ = 0;
+  std::map<uint32_t, size_t> num_samples_per_track_;
+};
+
+TEST_F(WebMMediaParserTest, RandomAccessReadsAllSamples) {
+  InitializeParser();
+  ASSERT_TRUE(ParseWebMFile(kMediaFile));
+  const size_t num_stream_samples = num_samples_;
+
+  InitializeParser();
+  ASSERT_TRUE(parser_->InitRandomAccess(
+      GetTestDataFilePath(kMediaFile).AsUTF8Unsafe()));
+  ASSERT_TRUE(ReadAllChunks());
+  EXPECT_EQ(2u, track_ids_.size());
+  EXPECT_EQ(num_stream_samples, num_samples_);
+  EXPECT_EQ(2u, num_samples_per_track_.size());
+}
+
+TEST_F(WebMMediaParserTest, RandomAccessSelectedTrack) {
+  InitializeParser();
+  ASSERT_TRUE(ParseWebMFile(kMediaFile));
+  const std::map<uint32_t, size_t> num_stream_samples_per_track =
+      num_samples_per_track_;
+
+  InitializeParser();
+  ASSERT_TRUE(parser_->InitRandomAccess(
+      GetTestDataFilePath(kMediaFile).AsUTF8Unsafe()));
+  // The streams are initialized from the first Cluster.
+  bool end_of_stream = false;
+  ASSERT_TRUE(parser_->ReadNextChunk(&end_of_stream));
+  ASSERT_EQ(2u, track_ids_.size());
+
+  const uint32_t kSelectedTrackId = *track_ids_.begin();
+  const uint32_t kSkippedTrackId = *track_ids_.rbegin();
+  parser_->SetSelectedTracks({kSelectedTrackId});
+  ASSERT_TRUE(ReadAllChunks());
+  EXPECT_EQ(num_stream_samples_per_track.at(kSelectedTrackId),
+            num_samples_per_track_[kSelectedTrackId]);
+  EXPECT_LT(num_samples_per_track_[kSkippedTrackId],
+            num_stream_samples_per_track.at(kSkippedTrackId));
+}
+
+TEST_F(WebMMediaParserTest, RandomAccessLiveNotSupported) {
+  InitializeParser();
+  EXPECT_FALSE(parser_->InitRandomAccess(
+      GetTestDataFilePath(kLiveMediaFile).AsUTF8Unsafe()));
+
+  // The file can still be parsed as a stream.
+  ASSERT_TRUE(ParseWebMFile(kLiveMediaFile));
+  EXPECT_GT(num_samples_, 0u);
+}
+
+}  // namespace media
+}  // namespace shaka
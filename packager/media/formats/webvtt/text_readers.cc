@@ -68,42 +68,105 @@ void LineReader::Flush() {
   should_flush_ = true;
 }
 
-BlockReader::BlockReader() : should_flush_(false) {}
+BlockReader::BlockReader() : scan_offset_(0), should_flush_(false) {}
 
 void BlockReader::PushData(const uint8_t* data, size_t data_size) {
-  source_.PushData(data, data_size);
+  PopScannedData();
+  buffer_.Push(data, static_cast<int>(data_size));
   should_flush_ = false;
 }
 
-bool BlockReader::Next(std::vector<std::string>* out) {
+bool BlockReader::Next(std::vector<base::StringPiece>* out) {
   DCHECK(out);
+  PopScannedData();
+
+  const uint8_t* data;
+  int data_size;
+  buffer_.Peek(&data, &data_size);
 
   bool end_block = false;
   // Read through lines until a non-empty line is found. With a non-empty
   // line is found, start adding the lines to the output and once an empty
   // line if found again, stop adding lines and exit.
-  std::string line;
-  while (source_.Next(&line)) {
-    if (!temp_.empty() && line.empty()) {
+  size_t line_size;
+  size_t next_start;
+  while (FindLine(data, data_size, scan_offset_, &line_size, &next_start)) {
+    const size_t line_start = scan_offset_;
+    scan_offset_ = next_start;
+    if (!lines_.empty() && line_size == 0) {
       end_block = true;
       break;
     }
-    if (!line.empty()) {
-      temp_.emplace_back(std::move(line));
-    }
+    if (line_size > 0)
+      lines_.push_back({line_start, line_size});
   }
 
-  if (!end_block && (!should_flush_ || temp_.empty()))
+  if (!end_block && (!should_flush_ || lines_.empty()))
     return false;
 
-  *out = std::move(temp_);
+  // TODO(modmaker): Handle character encodings?
+  out->clear();
+  for (const Line& line : lines_) {
+    out->emplace_back(reinterpret_cast<const char*>(data) + line.offset,
+                      line.size);
+  }
+  lines_.clear();
   return true;
 }
 
 void BlockReader::Flush() {
-  source_.Flush();
   should_flush_ = true;
 }
 
+bool BlockReader::FindLine(const uint8_t* data,
+                           size_t data_size,
+                           size_t start,
+                           size_t* line_size,
+                           size_t* next_start) const {
+  size_t i;
+  size_t skip = 0;
+  for (i = start; i < data_size; i++) {
+    // Handle \n
+    if (data[i] == '\n') {
+      skip = 1;
+      break;
+    }
+
+    // Handle \r and \r\n
+    if (data[i] == '\r') {
+      // Only read if we can see the next character; this ensures we don't get
+      // the '\n' in the next PushData.
+      if (i + 1 == data_size) {
+        if (!should_flush_)
+          return false;
+        skip = 1;
+      } else {
+        if (data[i + 1] == '\n')
+          skip = 2;
+        else
+          skip = 1;
+      }
+      break;
+    }
+  }
+
+  if (i == data_size && (!should_flush_ || i == start)) {
+    return false;
+  }
+
+  *line_size = i - start;
+  *next_start = i + skip;
+  return true;
+}
+
+void BlockReader::PopScannedData() {
+  // The lines of an incomplete block are kept in the buffer, as offsets from
+  // the front of the queue.
+  if (!lines_.empty() || scan_offset_ == 0)
+    return;
+  buffer_.Pop(static_cast<int>(scan_offset_));
+  scan_offset_ = 0;
+}
+
 }  // namespace media
 }  // namespace shaka
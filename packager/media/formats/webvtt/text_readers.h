@@ -11,6 +11,7 @@
 #include <string>
 #include <vector>
 
+#include "packager/base/strings/string_piece.h"
 #include "packager/media/base/byte_queue.h"
 #include "packager/status.h"
 
@@ -40,15 +41,21 @@ class LineReader {
   bool should_flush_;
 };
 
+/// Reads blocks of lines, i.e. lines separated by blank lines.  The lines are
+/// tokenized directly from the input buffer, so no string is created per line
+/// or per block; a block that is not complete yet is not scanned again when
+/// more data is pushed.
 class BlockReader {
  public:
   BlockReader();
 
-  /// Pushes data onto the end of the buffer.
+  /// Pushes data onto the end of the buffer.  This invalidates the lines of
+  /// the block returned by the previous call to Next.
   void PushData(const uint8_t* data, size_t data_size);
-  /// Reads the next block from the buffer.
+  /// Reads the next block from the buffer.  The lines point into the buffer
+  /// and are valid until the next call to Next or PushData.
   /// @return True if a block is read, false if there is no block in the buffer.
-  bool Next(std::vector<std::string>* out);
+  bool Next(std::vector<base::StringPiece>* out);
   /// Indicates that no more data is coming and that calls to Next should
   /// return even possibly-incomplete data.
   void Flush();
@@ -57,8 +64,28 @@ class BlockReader {
   BlockReader(const BlockReader&) = delete;
   BlockReader operator=(const BlockReader&) = delete;
 
-  LineReader source_;
-  std::vector<std::string> temp_;
+  // A line of the current block, as an offset in the buffer.
+  struct Line {
+    size_t offset;
+    size_t size;
+  };
+
+  // Finds the line starting at |start| in |data|.  Lines are split based on
+  // https://w3c.github.io/webvtt/#webvtt-line-terminator
+  // @return True if a line is found, false if there is no line in |data|.
+  bool FindLine(const uint8_t* data,
+                size_t data_size,
+                size_t start,
+                size_t* line_size,
+                size_t* next_start) const;
+  // Pops the data which is scanned and not part of an incomplete block.
+  void PopScannedData();
+
+  ByteQueue buffer_;
+  // The offset in the buffer up to which lines are scanned.
+  size_t scan_offset_;
+  // The lines scanned so far of the current block.
+  std::vector<Line> lines_;
   bool should_flush_;
 };
 
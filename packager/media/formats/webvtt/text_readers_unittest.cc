@@ -118,7 +118,7 @@ TEST(TextReadersTest, ReadBlocksReadMultilineBlock) {
   reader.PushData(text, sizeof(text) - 1);
   reader.Flush();
 
-  std::vector<std::string> block;
+  std::vector<base::StringPiece> block;
   ASSERT_TRUE(reader.Next(&block));
   EXPECT_THAT(block, ElementsAre("block 1 - line 1", "block 1 - line 2"));
   ASSERT_FALSE(reader.Next(&block));
@@ -137,7 +137,7 @@ TEST(TextReadersTest, ReadBlocksSkipBlankLinesBeforeBlocks) {
   reader.PushData(text, sizeof(text) - 1);
   reader.Flush();
 
-  std::vector<std::string> block;
+  std::vector<base::StringPiece> block;
 
   ASSERT_TRUE(reader.Next(&block));
   EXPECT_THAT(block, ElementsAre("block 1"));
@@ -154,7 +154,7 @@ TEST(TextReadersTest, ReadBlocksWithOnlyBlankLines) {
   reader.PushData(text, sizeof(text) - 1);
   reader.Flush();
 
-  std::vector<std::string> block;
+  std::vector<base::StringPiece> block;
   ASSERT_FALSE(reader.Next(&block));
 }
 
@@ -169,7 +169,7 @@ TEST(TextReadersTest, ReadBlocksMultipleReads) {
   BlockReader reader;
   reader.PushData(text1, sizeof(text1) - 1);
 
-  std::vector<std::string> block;
+  std::vector<base::StringPiece> block;
   ASSERT_FALSE(reader.Next(&block));
   reader.PushData(text2, sizeof(text2) - 1);
   reader.Flush();
@@ -178,5 +178,31 @@ TEST(TextReadersTest, ReadBlocksMultipleReads) {
   EXPECT_THAT(block, ElementsAre("block 1", "block 2"));
 }
 
+TEST(TextReadersTest, ReadBlocksSplitAcrossPushes) {
+  const uint8_t text1[] = "\n\nblock 1 - li";
+  const uint8_t text2[] = "ne 1\r";
+  const uint8_t text3[] = "\nblock 1 - line 2\r\n\r";
+  const uint8_t text4[] = "\nblock 2";
+
+  BlockReader reader;
+  std::vector<base::StringPiece> block;
+  reader.PushData(text1, sizeof(text1) - 1);
+  ASSERT_FALSE(reader.Next(&block));
+  reader.PushData(text2, sizeof(text2) - 1);
+  ASSERT_FALSE(reader.Next(&block));
+  reader.PushData(text3, sizeof(text3) - 1);
+  ASSERT_FALSE(reader.Next(&block));
+  reader.PushData(text4, sizeof(text4) - 1);
+
+  ASSERT_TRUE(reader.Next(&block));
+  EXPECT_THAT(block, ElementsAre("block 1 - line 1", "block 1 - line 2"));
+  ASSERT_FALSE(reader.Next(&block));
+
+  reader.Flush();
+  ASSERT_TRUE(reader.Next(&block));
+  EXPECT_THAT(block, ElementsAre("block 2"));
+  ASSERT_FALSE(reader.Next(&block));
+}
+
 }  // namespace media
 }  // namespace shaka
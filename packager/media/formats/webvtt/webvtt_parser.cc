@@ -19,12 +19,12 @@ namespace {
 
 const uint64_t kStreamIndex = 0;
 
-std::string BlockToString(const std::string* block, size_t size) {
+std::string BlockToString(const base::StringPiece* block, size_t size) {
   std::string out = " --- BLOCK START ---\n";
 
   for (size_t i = 0; i < size; i++) {
     out.append("    ");
-    out.append(block[i]);
+    block[i].AppendToString(&out);
     out.append("\n");
   }
 
@@ -37,7 +37,7 @@ std::string BlockToString(const std::string* block, size_t size) {
 // word "NOTE" (followed by a space or newline), and end at the first blank
 // line.
 // SOURCE: https://www.w3.org/TR/webvtt1
-bool IsLikelyNote(const std::string& line) {
+bool IsLikelyNote(const base::StringPiece& line) {
   return line == "NOTE" ||
          base::StartsWith(line, "NOTE ", base::CompareCase::SENSITIVE) ||
          base::StartsWith(line, "NOTE\t", base::CompareCase::SENSITIVE);
@@ -46,8 +46,8 @@ bool IsLikelyNote(const std::string& line) {
 // As cue time is the only part of a WEBVTT file that is allowed to have
 // "-->" appear, then if the given line contains it, we can safely assume
 // that the line is likely to be a cue time.
-bool IsLikelyCueTiming(const std::string& line) {
-  return line.find("-->") != std::string::npos;
+bool IsLikelyCueTiming(const base::StringPiece& line) {
+  return line.find("-->") != base::StringPiece::npos;
 }
 
 // A WebVTT cue identifier is any sequence of one or more characters not
@@ -55,15 +55,15 @@ bool IsLikelyCueTiming(const std::string& line) {
 // U+003E GREATER-THAN SIGN), nor containing any U+000A LINE FEED (LF)
 // characters or U+000D CARRIAGE RETURN (CR) characters.
 // SOURCE: https://www.w3.org/TR/webvtt1/#webvtt-cue-identifier
-bool MaybeCueId(const std::string& line) {
-  return line.find("-->") == std::string::npos;
+bool MaybeCueId(const base::StringPiece& line) {
+  return line.find("-->") == base::StringPiece::npos;
 }
 
 // Check to see if the block is likely a style block. Style blocks are
 // identified as any block that starts with a line that only contains
 // "STYLE".
 // SOURCE: https://w3c.github.io/webvtt/#styling
-bool IsLikelyStyle(const std::string& line) {
+bool IsLikelyStyle(const base::StringPiece& line) {
   return base::TrimWhitespaceASCII(line, base::TRIM_TRAILING) == "STYLE";
 }
 
@@ -71,7 +71,7 @@ bool IsLikelyStyle(const std::string& line) {
 // identified as any block that starts with a line that only contains
 // "REGION".
 // SOURCE: https://w3c.github.io/webvtt/#webvtt-region
-bool IsLikelyRegion(const std::string& line) {
+bool IsLikelyRegion(const base::StringPiece& line) {
   return base::TrimWhitespaceASCII(line, base::TRIM_TRAILING) == "REGION";
 }
 
@@ -215,7 +215,7 @@ bool WebVttParser::Parse(const uint8_t* buf, int size) {
 
 bool WebVttParser::Parse() {
   if (!initialized_) {
-    std::vector<std::string> block;
+    std::vector<base::StringPiece> block;
     if (!reader_.Next(&block)) {
       return true;
     }
@@ -235,7 +235,7 @@ bool WebVttParser::Parse() {
     initialized_ = true;
   }
 
-  std::vector<std::string> block;
+  std::vector<base::StringPiece> block;
   while (reader_.Next(&block)) {
     if (!ParseBlock(block))
       return false;
@@ -243,7 +243,7 @@ bool WebVttParser::Parse() {
   return true;
 }
 
-bool WebVttParser::ParseBlock(const std::vector<std::string>& block) {
+bool WebVttParser::ParseBlock(const std::vector<base::StringPiece>& block) {
   // NOTE
   if (IsLikelyNote(block[0])) {
     // We can safely ignore the whole block.
@@ -259,7 +259,7 @@ bool WebVttParser::ParseBlock(const std::vector<std::string>& block) {
       for (size_t i = 1; i < block.size(); i++) {
         if (!css_styles_.empty())
           css_styles_ += "\n";
-        css_styles_ += block[i];
+        block[i].AppendToString(&css_styles_);
       }
     }
     return true;
@@ -294,7 +294,7 @@ bool WebVttParser::ParseBlock(const std::vector<std::string>& block) {
   return false;
 }
 
-bool WebVttParser::ParseRegion(const std::vector<std::string>& block) {
+bool WebVttParser::ParseRegion(const std::vector<base::StringPiece>& block) {
   TextRegion region;
   std::string region_id;
   // Fill in defaults.  Some may already be this, but set them anyway.
@@ -321,7 +321,8 @@ bool WebVttParser::ParseRegion(const std::vector<std::string>& block) {
     }
 
     base::StringPairs pairs;
-    if (!base::SplitStringIntoKeyValuePairs(line, ':', ' ', &pairs)) {
+    if (!base::SplitStringIntoKeyValuePairs(line.as_string(), ':', ' ',
+                                            &pairs)) {
       LOG(ERROR) << "Invalid WebVTT settings: " << line;
       return false;
     }
@@ -381,18 +382,20 @@ bool WebVttParser::ParseRegion(const std::vector<std::string>& block) {
   return true;
 }
 
-bool WebVttParser::ParseCueWithNoId(const std::vector<std::string>& block) {
+bool WebVttParser::ParseCueWithNoId(
+    const std::vector<base::StringPiece>& block) {
   return ParseCue("", block.data(), block.size());
 }
 
-bool WebVttParser::ParseCueWithId(const std::vector<std::string>& block) {
+bool WebVttParser::ParseCueWithId(
+    const std::vector<base::StringPiece>& block) {
   return ParseCue(block[0], block.data() + 1, block.size() - 1);
 }
 
-bool WebVttParser::ParseCue(const std::string& id,
-                            const std::string* block,
+bool WebVttParser::ParseCue(const base::StringPiece& id,
+                            const base::StringPiece* block,
                             size_t block_size) {
-  const std::vector<std::string> time_and_style = base::SplitString(
+  const std::vector<base::StringPiece> time_and_style = base::SplitStringPiece(
       block[0], " ", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
 
   uint64_t start_time = 0;
@@ -434,16 +437,17 @@ bool WebVttParser::ParseCue(const std::string& id,
   TextSettings settings;
   for (size_t i = 3; i < time_and_style.size(); i++) {
     const auto pos = time_and_style[i].find(':');
-    if (pos == std::string::npos) {
+    if (pos == base::StringPiece::npos) {
       continue;
     }
 
-    const std::string key = time_and_style[i].substr(0, pos);
-    const std::string value = time_and_style[i].substr(pos + 1);
+    const std::string key = time_and_style[i].substr(0, pos).as_string();
+    const std::string value = time_and_style[i].substr(pos + 1).as_string();
     ParseSettings(key, value, &settings);
   }
 
-  // The rest of the block is the payload.
+  // The rest of the block is the payload.  This is where the strings of the
+  // cue are created, now that the cue is complete.
   // TODO: Parse tags to support <b>, <i>, etc.
   TextFragment body;
   TextFragmentStyle no_styles;
@@ -451,11 +455,12 @@ bool WebVttParser::ParseCue(const std::string& id,
     if (i > 1) {
       body.sub_fragments.emplace_back(no_styles, /* newline= */ true);
     }
-    body.sub_fragments.emplace_back(no_styles, block[i]);
+    body.sub_fragments.emplace_back(no_styles, block[i].as_string());
   }
 
   const auto sample =
-      std::make_shared<TextSample>(id, start_time, end_time, settings, body);
+      std::make_shared<TextSample>(id.as_string(), start_time, end_time,
+                                   settings, body);
   return new_text_sample_cb_.Run(kStreamIndex, sample);
 }
 
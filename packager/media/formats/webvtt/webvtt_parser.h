@@ -11,6 +11,7 @@
 #include <string>
 #include <vector>
 
+#include "packager/base/strings/string_piece.h"
 #include "packager/media/base/media_parser.h"
 #include "packager/media/base/text_sample.h"
 #include "packager/media/base/text_stream_info.h"
@@ -33,12 +34,12 @@ class WebVttParser : public MediaParser {
 
  private:
   bool Parse();
-  bool ParseBlock(const std::vector<std::string>& block);
-  bool ParseRegion(const std::vector<std::string>& block);
-  bool ParseCueWithNoId(const std::vector<std::string>& block);
-  bool ParseCueWithId(const std::vector<std::string>& block);
-  bool ParseCue(const std::string& id,
-                const std::string* block,
+  bool ParseBlock(const std::vector<base::StringPiece>& block);
+  bool ParseRegion(const std::vector<base::StringPiece>& block);
+  bool ParseCueWithNoId(const std::vector<base::StringPiece>& block);
+  bool ParseCueWithId(const std::vector<base::StringPiece>& block);
+  bool ParseCue(const base::StringPiece& id,
+                const base::StringPiece* block,
                 size_t block_size);
 
   void DispatchTextStreamInfo();
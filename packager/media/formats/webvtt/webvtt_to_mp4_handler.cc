@@ -8,6 +8,7 @@
 
 #include <algorithm>
 #include <map>
+#include <vector>
 
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/formats/mp4/box_buffer.h"
@@ -70,21 +71,12 @@ void WriteSample(const TextSample& sample, BufferWriter* out) {
   box.Write(out);
 }
 
-void WriteSamples(const std::list<const TextSample*>& samples,
-                  BufferWriter* writer) {
-  DCHECK_GE(samples.size(), 0u);
-
-  for (const auto& sample : samples) {
-    WriteSample(*sample, writer);
-  }
-}
-
 void WriteEmptySample(BufferWriter* writer) {
   mp4::VTTEmptyCueBox box;
   box.Write(writer);
 }
 
-std::shared_ptr<MediaSample> CreateMediaSample(const BufferWriter& buffer,
+std::shared_ptr<MediaSample> CreateMediaSample(std::vector<uint8_t> data,
                                                int64_t start_time,
                                                int64_t end_time) {
   DCHECK_GE(start_time, 0);
@@ -93,7 +85,7 @@ std::shared_ptr<MediaSample> CreateMediaSample(const BufferWriter& buffer,
   const bool kIsKeyFrame = true;
 
   std::shared_ptr<MediaSample> sample =
-      MediaSample::CopyFrom(buffer.Buffer(), buffer.Size(), kIsKeyFrame);
+      MediaSample::FromVector(std::move(data), kIsKeyFrame);
   sample->set_pts(start_time);
   sample->set_dts(start_time);
   sample->set_duration(end_time - start_time);
@@ -127,14 +119,14 @@ Status WebVttToMp4Handler::Process(std::unique_ptr<StreamData> stream_data) {
 Status WebVttToMp4Handler::OnStreamInfo(
     std::unique_ptr<StreamData> stream_data) {
   DCHECK(stream_data);
-  DCHECK(stream_data->stream_info);
+  DCHECK(stream_data->stream_info());
 
   return Dispatch(std::move(stream_data));
 }
 
 Status WebVttToMp4Handler::OnCueEvent(std::unique_ptr<StreamData> stream_data) {
   DCHECK(stream_data);
-  DCHECK(stream_data->cue_event);
+  DCHECK(stream_data->cue_event());
 
   if (current_segment_.size()) {
     return Status(error::INTERNAL_ERROR,
@@ -147,9 +139,9 @@ Status WebVttToMp4Handler::OnCueEvent(std::unique_ptr<StreamData> stream_data) {
 Status WebVttToMp4Handler::OnSegmentInfo(
     std::unique_ptr<StreamData> stream_data) {
   DCHECK(stream_data);
-  DCHECK(stream_data->segment_info);
+  DCHECK(stream_data->segment_info());
 
-  const auto& segment = stream_data->segment_info;
+  const auto& segment = stream_data->segment_info();
 
   int64_t segment_start = segment->start_timestamp;
   int64_t segment_duration = segment->duration;
@@ -157,6 +149,13 @@ Status WebVttToMp4Handler::OnSegmentInfo(
 
   RETURN_IF_ERROR(DispatchCurrentSegment(segment_start, segment_end));
   current_segment_.clear();
+  // The samples which end in this segment are not sent again.
+  for (auto it = cue_boxes_.begin(); it != cue_boxes_.end();) {
+    if (it->second.sample->EndTime() <= segment_end)
+      it = cue_boxes_.erase(it);
+    else
+      ++it;
+  }
 
   return Dispatch(std::move(stream_data));
 }
@@ -164,9 +163,9 @@ Status WebVttToMp4Handler::OnSegmentInfo(
 Status WebVttToMp4Handler::OnTextSample(
     std::unique_ptr<StreamData> stream_data) {
   DCHECK(stream_data);
-  DCHECK(stream_data->text_sample);
+  DCHECK(stream_data->text_sample());
 
-  auto& sample = stream_data->text_sample;
+  auto& sample = stream_data->text_sample();
 
   // Ignore empty samples. This will create gaps, but we will handle that
   // later.
@@ -174,9 +173,20 @@ Status WebVttToMp4Handler::OnTextSample(
     return Status::OK;
   }
 
+  // Samples spanning several segments are sent again for each of them, and
+  // are only serialized the first time.
+  CueBox& cue_box = cue_boxes_[sample.get()];
+  if (!cue_box.sample) {
+    cue_box.sample = sample;
+    box_writer_.Clear();
+    WriteSample(*sample, &box_writer_);
+    cue_box.box.assign(box_writer_.Buffer(),
+                       box_writer_.Buffer() + box_writer_.Size());
+  }
+
   // Add the new text sample to the cache of samples that belong in the
   // current segment.
-  current_segment_.push_back(std::move(stream_data->text_sample));
+  current_segment_.push_back(stream_data->release_text_sample());
   return Status::OK;
 }
 
@@ -249,16 +259,31 @@ Status WebVttToMp4Handler::MergeDispatchSamples(
     const std::list<const TextSample*>& state) {
   DCHECK_GT(end_time, start_time);
 
-  box_writer_.Clear();
-
+  std::vector<uint8_t> data;
   if (state.size()) {
-    WriteSamples(state, &box_writer_);
+    std::vector<const std::vector<uint8_t>*> boxes;
+    size_t data_size = 0;
+    for (const TextSample* sample : state) {
+      DCHECK(cue_boxes_.count(sample));
+      boxes.push_back(&cue_boxes_[sample].box);
+      data_size += boxes.back()->size();
+    }
+    data.reserve(data_size);
+    for (const std::vector<uint8_t>* box : boxes)
+      data.insert(data.end(), box->begin(), box->end());
   } else {
-    WriteEmptySample(&box_writer_);
+    if (empty_cue_box_.empty()) {
+      box_writer_.Clear();
+      WriteEmptySample(&box_writer_);
+      empty_cue_box_.assign(box_writer_.Buffer(),
+                            box_writer_.Buffer() + box_writer_.Size());
+    }
+    data = empty_cue_box_;
   }
 
   return DispatchMediaSample(
-      kTrackId, CreateMediaSample(box_writer_, start_time, end_time));
+      kTrackId, CreateMediaSample(std::move(data), start_time, end_time));
 }
+
 }  // namespace media
 }  // namespace shaka
@@ -10,7 +10,10 @@
 #include <stdint.h>
 
 #include <list>
+#include <map>
+#include <memory>
 #include <queue>
+#include <vector>
 
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/media_handler.h"
@@ -45,7 +48,17 @@ class WebVttToMp4Handler : public MediaHandler {
 
   std::list<std::shared_ptr<const TextSample>> current_segment_;
 
-  // This is the current state of the box we are writing.
+  // The VTTCueBoxes of the samples, serialized once for all the sections and
+  // segments the samples are on screen in. |sample| keeps the key alive, so
+  // that its address is not reused by another sample.
+  struct CueBox {
+    std::shared_ptr<const TextSample> sample;
+    std::vector<uint8_t> box;
+  };
+  std::map<const TextSample*, CueBox> cue_boxes_;
+  std::vector<uint8_t> empty_cue_box_;
+
+  // The boxes are serialized into this buffer first, which is reused.
   BufferWriter box_writer_;
 };
 
@@ -31,7 +31,7 @@ const char* kEmptyPayload = "";
 }  // namespace
 
 MATCHER_P(MediaSampleContainsId, id, "") {
-  auto& sample = arg->media_sample;
+  auto& sample = arg->media_sample();
 
   if (!sample) {
     return false;
@@ -697,5 +697,44 @@ TEST_F(WebVttToMp4HandlerTest, CrossSegmentSamples) {
   ASSERT_OK(DispatchSegment(kSegment2Start, kSegment2End));
   ASSERT_OK(Flush());
 }
+
+// The text chunker sends the same sample again for each segment it spans,
+// whose cue box is then only serialized once.
+//
+// |[------ SEGMENT ------]|[------ SEGMENT ------]|
+// |[------ SAMPLE -------|-----------------------]|
+TEST_F(WebVttToMp4HandlerTest, SameSampleInSegments) {
+  const int64_t kSegmentDuration = 10000;
+  const int64_t kSegment1Start = 0;
+  const int64_t kSegment2Start = 10000;
+  const int64_t kSampleEnd = 20000;
+
+  ASSERT_OK(SetUpTestGraph());
+
+  {
+    testing::InSequence s;
+
+    EXPECT_CALL(*Out(), OnProcess(IsStreamInfo(kStreamIndex, _, _, _)));
+    for (int64_t segment_start : {kSegment1Start, kSegment2Start}) {
+      EXPECT_CALL(*Out(), OnProcess(AllOf(
+                              IsMediaSample(kStreamIndex, segment_start,
+                                            kSegmentDuration, !kEncrypted, _),
+                              MediaSampleContainsId(kId1))));
+      EXPECT_CALL(*Out(), OnProcess(IsSegmentInfo(
+                              kStreamIndex, segment_start, kSegmentDuration,
+                              !kSubSegment, !kEncrypted)));
+    }
+    EXPECT_CALL(*Out(), OnFlush(kStreamIndex));
+  }
+
+  std::shared_ptr<const TextSample> sample =
+      GetTextSample(kId1, kSegment1Start, kSampleEnd, kSimplePayload);
+  ASSERT_OK(DispatchStream());
+  ASSERT_OK(In()->Dispatch(StreamData::FromTextSample(kStreamIndex, sample)));
+  ASSERT_OK(DispatchSegment(kSegment1Start, kSegment2Start));
+  ASSERT_OK(In()->Dispatch(StreamData::FromTextSample(kStreamIndex, sample)));
+  ASSERT_OK(DispatchSegment(kSegment2Start, kSampleEnd));
+  ASSERT_OK(Flush());
+}
 }  // namespace media
 }  // namespace shaka
@@ -4,6 +4,8 @@
 
 #include "packager/media/formats/wvm/wvm_media_parser.h"
 
+#include <string.h>
+
 #include <map>
 #include <sstream>
 #include <vector>
@@ -134,6 +136,13 @@ bool WvmMediaParser::Parse(const uint8_t* buf, int size) {
       case StartCode1:
         if (*read_ptr == kStartCode1) {
           parse_state_ = StartCode2;
+        } else {
+          // Out of sync: jump straight to the next candidate start code byte
+          // instead of checking every byte of the skipped data.
+          const uint8_t* next = static_cast<const uint8_t*>(
+              memchr(read_ptr, kStartCode1, end - read_ptr));
+          read_ptr = next ? next : end;
+          continue;
         }
         break;
       case StartCode2:
@@ -445,9 +454,10 @@ bool WvmMediaParser::Parse(const uint8_t* buf, int size) {
         }
         pes_packet_bytes_ -= num_bytes;
         if (pes_stream_id_ !=  kV2MetadataStreamId) {
-          sample_data_.resize(sample_data_.size() + num_bytes);
-          memcpy(&sample_data_[sample_data_.size() - num_bytes], read_ptr,
-                 num_bytes);
+          // Append the whole contiguous run without zero-filling it first;
+          // |sample_data_| keeps its capacity across samples.
+          sample_data_.insert(sample_data_.end(), read_ptr,
+                              read_ptr + num_bytes);
         }
         prev_pes_stream_id_ = pes_stream_id_;
         read_ptr += num_bytes;
@@ -822,14 +832,13 @@ bool WvmMediaParser::Output(bool output_encrypted_sample) {
     media_sample_->set_is_encrypted(true);
   } else {
     if ((prev_pes_stream_id_ & kPesStreamIdVideoMask) == kPesStreamIdVideo) {
-      // Convert video stream to unit stream and get config.
-      std::vector<uint8_t> nal_unit_stream;
+      // Convert video stream to unit stream, in place, and get config.
       if (!byte_to_unit_stream_converter_.ConvertByteStreamToNalUnitStream(
-              sample_data_.data(), sample_data_.size(), &nal_unit_stream)) {
+              &sample_data_)) {
         LOG(ERROR) << "Could not convert h.264 byte stream sample";
         return false;
       }
-      media_sample_->SetData(nal_unit_stream.data(), nal_unit_stream.size());
+      media_sample_->SetData(sample_data_.data(), sample_data_.size());
       if (!is_initialized_) {
         // Set extra data for video stream from AVC Decoder Config Record.
         // Also, set codec string from the AVC Decoder Config Record.
@@ -15,10 +15,27 @@
       'sources': [
         'origin_handler.cc',
         'origin_handler.h',
+        'synthetic_source.cc',
+        'synthetic_source.h',
       ],
       'dependencies': [
         '../base/media_base.gyp:media_base',
+        '../codecs/codecs.gyp:codecs',
       ],
     },
+    {
+      'target_name': 'origin_unittest',
+      'type': '<(gtest_target_type)',
+      'sources': [
+        'synthetic_source_unittest.cc',
+      ],
+      'dependencies': [
+        '../../testing/gtest.gyp:gtest',
+        '../../testing/gmock.gyp:gmock',
+        '../base/media_base.gyp:media_handler_test_base',
+        '../test/media_test.gyp:media_test_support',
+        'origin',
+      ]
+    },
   ],
 }
@@ -9,6 +9,11 @@
 namespace shaka {
 namespace media {
 
+Status OriginHandler::RunStep(bool* done) {
+  *done = true;
+  return Run();
+}
+
 // Origin handlers are always at the start of a pipeline (chain or handlers)
 // and therefore should never receive input via |Process|.
 Status OriginHandler::Process(std::unique_ptr<StreamData> stream_data) {
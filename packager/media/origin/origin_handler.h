@@ -7,8 +7,13 @@
 #ifndef PACKAGER_MEDIA_ORIGIN_ORIGIN_HANDLER_H_
 #define PACKAGER_MEDIA_ORIGIN_ORIGIN_HANDLER_H_
 
+#include "packager/base/time/time.h"
 #include "packager/media/base/media_handler.h"
 
+namespace base {
+class WaitableEvent;
+}  // namespace base
+
 namespace shaka {
 namespace media {
 
@@ -26,6 +31,28 @@ class OriginHandler : public MediaHandler {
   // be used.
   virtual Status Run() = 0;
 
+  // Do a bounded amount of the work of |Run|, e.g. parse one buffer of input,
+  // so that several handlers can take turns on a single thread. |done| is set
+  // to true once the work is complete or has failed, in which case the
+  // status is what |Run| would return. The default implementation runs |Run|
+  // to completion.
+  virtual Status RunStep(bool* done);
+
+  // Returns false if |RunStep| would block waiting for input, so that other
+  // handlers can be run in the meantime.
+  virtual bool IsReadyToRunStep() { return true; }
+
+  // Sets |event| to be signaled when |IsReadyToRunStep| may have become true,
+  // e.g. on input or on |Cancel|, so that a thread running several handlers
+  // can wait for them instead of polling. |event| must outlive the handler.
+  virtual void SetReadyEvent(base::WaitableEvent* event) {}
+
+  // Returns how long |IsReadyToRunStep| may stay false without the event of
+  // |SetReadyEvent| being signaled, e.g. for the handlers paced by the clock.
+  virtual base::TimeDelta GetMaxTimeUntilReady() {
+    return base::TimeDelta::Max();
+  }
+
   // Non-blocking call to the handler, requesting that it exit the
   // current call to |Run|. The handler should stop processing data
   // as soon is convenient.
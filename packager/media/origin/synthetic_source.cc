@@ -0,0 +1,496 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/origin/synthetic_source.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "packager/base/logging.h"
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/bit_writer.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/fourccs.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/video_stream_info.h"
+#include "packager/media/codecs/avc_decoder_configuration_record.h"
+#include "packager/media/codecs/nal_unit_to_byte_stream_converter.h"
+#include "packager/status_macros.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kVideoStreamIndex = 0;
+const size_t kAudioStreamIndex = 1;
+const int kVideoTrackId = 1;
+const int kAudioTrackId = 2;
+
+// H.264 constrained baseline profile, i.e. without B frames.
+const uint8_t kH264ProfileIndication = 66;
+const uint8_t kH264ProfileCompatibility = 0xC0;
+const uint8_t kNaluLengthSize = 4;
+// frame_num is coded on log2_max_frame_num_minus4 + 4 bits.
+const uint32_t kLog2MaxFrameNumMinus4 = 4;
+// NAL unit headers, with nal_ref_idc and nal_unit_type.
+const uint8_t kSpsNaluHeader = 0x67;
+const uint8_t kPpsNaluHeader = 0x68;
+const uint8_t kIdrSliceNaluHeader = 0x65;
+// The frames between the key frames are not used as references, so they all
+// have the same slice header.
+const uint8_t kNonRefSliceNaluHeader = 0x01;
+// slice_type values for the slices of a picture with a single slice type.
+const uint32_t kPSliceType = 5;
+const uint32_t kISliceType = 7;
+
+const uint32_t kAacFrameSize = 1024;
+const uint8_t kAacLcObjectType = 2;
+const uint32_t kAacSampleRates[] = {96000, 88200, 64000, 48000, 44100,
+                                    32000, 24000, 22050, 16000, 12000,
+                                    11025, 8000,  7350};
+
+void WriteUe(uint32_t value, BitWriter* writer) {
+  // Exp-Golomb code: value + 1 preceded by as many zeros as its bits but one.
+  const uint32_t code = value + 1;
+  size_t num_bits = 0;
+  while ((code >> num_bits) > 1)
+    ++num_bits;
+  if (num_bits > 0)
+    writer->WriteBits(0, num_bits);
+  writer->WriteBits(code, num_bits + 1);
+}
+
+void WriteSe(int32_t value, BitWriter* writer) {
+  WriteUe(value > 0 ? 2 * value - 1 : -2 * value, writer);
+}
+
+// Appends rbsp_trailing_bits().
+void WriteTrailingBits(BitWriter* writer) {
+  writer->WriteBits(1, 1);
+  writer->Flush();
+}
+
+std::vector<uint8_t> ToNalu(uint8_t nalu_header,
+                            const std::vector<uint8_t>& rbsp) {
+  BufferWriter writer;
+  writer.AppendInt(nalu_header);
+  EscapeNalByteSequence(rbsp.data(), rbsp.size(), &writer);
+  std::vector<uint8_t> nalu;
+  writer.SwapBuffer(&nalu);
+  return nalu;
+}
+
+uint32_t NumMacroblocks(uint16_t size) {
+  return (size + 15) / 16;
+}
+
+uint8_t GetH264Level(const SyntheticSourceParams& params) {
+  const uint32_t frame_macroblocks =
+      NumMacroblocks(params.width) * NumMacroblocks(params.height);
+  const uint64_t macroblocks_per_second =
+      static_cast<uint64_t>(frame_macroblocks) * params.frame_rate;
+  // Table A-1 limits of levels 3.1, 4.0 and 5.1.
+  if (frame_macroblocks <= 3600 && macroblocks_per_second <= 108000)
+    return 31;
+  if (frame_macroblocks <= 8192 && macroblocks_per_second <= 245760)
+    return 40;
+  if (frame_macroblocks <= 36864 && macroblocks_per_second <= 983040)
+    return 51;
+  return 52;
+}
+
+std::vector<uint8_t> GenerateSps(const SyntheticSourceParams& params,
+                                 uint8_t level) {
+  std::vector<uint8_t> rbsp;
+  BitWriter writer(&rbsp);
+  writer.WriteBits(kH264ProfileIndication, 8);
+  writer.WriteBits(kH264ProfileCompatibility, 8);
+  writer.WriteBits(level, 8);
+  WriteUe(0, &writer);  // seq_parameter_set_id
+  WriteUe(kLog2MaxFrameNumMinus4, &writer);
+  // pic_order_cnt_type 2, i.e. output order is decoding order.
+  WriteUe(2, &writer);
+  WriteUe(1, &writer);  // max_num_ref_frames
+  writer.WriteBits(0, 1);  // gaps_in_frame_num_value_allowed_flag
+  const uint32_t width_in_mbs = NumMacroblocks(params.width);
+  const uint32_t height_in_mbs = NumMacroblocks(params.height);
+  WriteUe(width_in_mbs - 1, &writer);
+  WriteUe(height_in_mbs - 1, &writer);
+  writer.WriteBits(1, 1);  // frame_mbs_only_flag
+  writer.WriteBits(1, 1);  // direct_8x8_inference_flag
+  // The cropping offsets are in units of 2 pixels in 4:2:0.
+  const uint32_t crop_right = (width_in_mbs * 16 - params.width) / 2;
+  const uint32_t crop_bottom = (height_in_mbs * 16 - params.height) / 2;
+  const bool frame_cropping = crop_right > 0 || crop_bottom > 0;
+  writer.WriteBits(frame_cropping ? 1 : 0, 1);
+  if (frame_cropping) {
+    WriteUe(0, &writer);
+    WriteUe(crop_right, &writer);
+    WriteUe(0, &writer);
+    WriteUe(crop_bottom, &writer);
+  }
+  writer.WriteBits(0, 1);  // vui_parameters_present_flag
+  WriteTrailingBits(&writer);
+  return ToNalu(kSpsNaluHeader, rbsp);
+}
+
+std::vector<uint8_t> GeneratePps() {
+  std::vector<uint8_t> rbsp;
+  BitWriter writer(&rbsp);
+  WriteUe(0, &writer);     // pic_parameter_set_id
+  WriteUe(0, &writer);     // seq_parameter_set_id
+  writer.WriteBits(0, 1);  // entropy_coding_mode_flag, i.e. CAVLC
+  writer.WriteBits(0, 1);  // bottom_field_pic_order_in_frame_present_flag
+  WriteUe(0, &writer);     // num_slice_groups_minus1
+  WriteUe(0, &writer);     // num_ref_idx_l0_default_active_minus1
+  WriteUe(0, &writer);     // num_ref_idx_l1_default_active_minus1
+  writer.WriteBits(0, 1);  // weighted_pred_flag
+  writer.WriteBits(0, 2);  // weighted_bipred_idc
+  WriteSe(0, &writer);     // pic_init_qp_minus26
+  WriteSe(0, &writer);     // pic_init_qs_minus26
+  WriteSe(0, &writer);     // chroma_qp_index_offset
+  writer.WriteBits(0, 1);  // deblocking_filter_control_present_flag
+  writer.WriteBits(0, 1);  // constrained_intra_pred_flag
+  writer.WriteBits(0, 1);  // redundant_pic_cnt_present_flag
+  WriteTrailingBits(&writer);
+  return ToNalu(kPpsNaluHeader, rbsp);
+}
+
+std::vector<uint8_t> GenerateAvcDecoderConfig(const std::vector<uint8_t>& sps,
+                                              const std::vector<uint8_t>& pps,
+                                              uint8_t level) {
+  BufferWriter writer;
+  writer.AppendInt(static_cast<uint8_t>(1));  // configurationVersion
+  writer.AppendInt(kH264ProfileIndication);
+  writer.AppendInt(kH264ProfileCompatibility);
+  writer.AppendInt(level);
+  writer.AppendInt(static_cast<uint8_t>(0xFC | (kNaluLengthSize - 1)));
+  writer.AppendInt(static_cast<uint8_t>(0xE1));  // One SPS.
+  writer.AppendInt(static_cast<uint16_t>(sps.size()));
+  writer.AppendVector(sps);
+  writer.AppendInt(static_cast<uint8_t>(1));  // One PPS.
+  writer.AppendInt(static_cast<uint16_t>(pps.size()));
+  writer.AppendVector(pps);
+  std::vector<uint8_t> config;
+  writer.SwapBuffer(&config);
+  return config;
+}
+
+// Appends |size| bytes of noise-like data which does not need emulation
+// prevention, i.e. without zero bytes.
+void AppendFiller(size_t size, BufferWriter* writer) {
+  uint32_t state = static_cast<uint32_t>(size);
+  for (size_t i = 0; i < size; ++i) {
+    state = state * 1103515245u + 12345u;
+    writer->AppendInt(static_cast<uint8_t>((state >> 24) | 1));
+  }
+}
+
+// Generates a length-prefixed slice NAL unit of |frame_size| bytes, or
+// larger if the header does not fit.
+std::shared_ptr<const std::vector<uint8_t>> GenerateFrame(bool idr,
+                                                          uint32_t idr_pic_id,
+                                                          size_t frame_size) {
+  std::vector<uint8_t> rbsp;
+  BitWriter writer(&rbsp);
+  WriteUe(0, &writer);  // first_mb_in_slice
+  WriteUe(idr ? kISliceType : kPSliceType, &writer);
+  WriteUe(0, &writer);  // pic_parameter_set_id
+  // frame_num: 0 for IDR pictures, and the following non-reference pictures
+  // all follow it.
+  writer.WriteBits(idr ? 0 : 1, kLog2MaxFrameNumMinus4 + 4);
+  if (idr) {
+    WriteUe(idr_pic_id, &writer);
+    writer.WriteBits(0, 1);  // no_output_of_prior_pics_flag
+    writer.WriteBits(0, 1);  // long_term_reference_flag
+  } else {
+    writer.WriteBits(0, 1);  // num_ref_idx_active_override_flag
+    writer.WriteBits(0, 1);  // ref_pic_list_modification_flag_l0
+  }
+  WriteSe(0, &writer);  // slice_qp_delta
+  writer.Flush();
+  const std::vector<uint8_t> slice_header =
+      ToNalu(idr ? kIdrSliceNaluHeader : kNonRefSliceNaluHeader, rbsp);
+
+  const size_t min_size = kNaluLengthSize + slice_header.size() + 1;
+  const size_t nalu_size = std::max(frame_size, min_size) - kNaluLengthSize;
+  BufferWriter frame;
+  frame.AppendNBytes(nalu_size, kNaluLengthSize);
+  frame.AppendVector(slice_header);
+  AppendFiller(nalu_size - slice_header.size(), &frame);
+  std::shared_ptr<std::vector<uint8_t>> data(new std::vector<uint8_t>);
+  frame.SwapBuffer(data.get());
+  return data;
+}
+
+}  // namespace
+
+struct SyntheticSource::Stream {
+  size_t stream_index = 0;
+  std::shared_ptr<const StreamInfo> stream_info;
+  int64_t sample_duration = 0;
+  // End of the stream in the stream's time scale, or 0 if it is endless.
+  int64_t end = 0;
+  // Number of samples in a group starting with a key frame.
+  uint32_t key_frame_interval = 1;
+  // Data of the key frames, which alternate to keep consecutive IDR pictures
+  // distinct, and of the other samples. The samples share it.
+  std::shared_ptr<const std::vector<uint8_t>> key_frames[2];
+  std::shared_ptr<const std::vector<uint8_t>> frame;
+  int64_t num_samples = 0;
+
+  int64_t next_pts() const { return num_samples * sample_duration; }
+  bool ended() const { return end > 0 && next_pts() >= end; }
+  double next_time_in_seconds() const {
+    return static_cast<double>(next_pts()) / stream_info->time_scale();
+  }
+};
+
+SyntheticSource::SyntheticSource(const SyntheticSourceParams& params)
+    : params_(params) {}
+
+SyntheticSource::~SyntheticSource() {}
+
+Status SyntheticSource::SetHandler(const std::string& stream_label,
+                                   std::shared_ptr<MediaHandler> handler) {
+  size_t stream_index = kVideoStreamIndex;
+  if (stream_label == "audio") {
+    stream_index = kAudioStreamIndex;
+  } else if (stream_label != "video") {
+    return Status(error::INVALID_ARGUMENT,
+                  "Invalid synthetic stream: " + stream_label);
+  }
+  return MediaHandler::SetHandler(stream_index, std::move(handler));
+}
+
+Status SyntheticSource::Run() {
+  bool done = false;
+  Status status;
+  while (!done) {
+    if (params_.real_time && started_ && !cancelled_) {
+      Stream* stream = NextStream();
+      const base::TimeDelta wait =
+          stream ? TimeUntilCaptured(*stream) : base::TimeDelta();
+      if (wait > base::TimeDelta())
+        base::PlatformThread::Sleep(wait);
+    }
+    status = RunStep(&done);
+  }
+  return status;
+}
+
+Status SyntheticSource::RunStep(bool* done) {
+  *done = true;
+  if (cancelled_)
+    return Status(error::CANCELLED, "Synthetic source run cancelled");
+  if (!started_) {
+    LOG(INFO) << "SyntheticSource::Run() with video " << (video_ ? "on" : "off")
+              << " and audio " << (audio_ ? "on" : "off") << ".";
+    for (Stream* stream : {video_.get(), audio_.get()}) {
+      if (stream) {
+        RETURN_IF_ERROR(
+            DispatchStreamInfo(stream->stream_index, stream->stream_info));
+      }
+    }
+    started_ = true;
+    start_time_ = base::TimeTicks::Now();
+    *done = false;
+    return Status::OK;
+  }
+  Stream* stream = NextStream();
+  if (!stream)
+    return FlushAllDownstreams();
+  if (!params_.real_time || TimeUntilCaptured(*stream) <= base::TimeDelta())
+    RETURN_IF_ERROR(DispatchNextSample(stream));
+  *done = false;
+  return Status::OK;
+}
+
+bool SyntheticSource::IsReadyToRunStep() {
+  if (cancelled_ || !started_ || !params_.real_time)
+    return true;
+  Stream* stream = NextStream();
+  return !stream || TimeUntilCaptured(*stream) <= base::TimeDelta();
+}
+
+base::TimeDelta SyntheticSource::GetMaxTimeUntilReady() {
+  // Only the capture times make it ready.
+  if (cancelled_ || !started_ || !params_.real_time)
+    return base::TimeDelta();
+  Stream* stream = NextStream();
+  return stream ? TimeUntilCaptured(*stream) : base::TimeDelta();
+}
+
+void SyntheticSource::SetReadyEvent(base::WaitableEvent* event) {
+  ready_event_ = event;
+}
+
+void SyntheticSource::Cancel() {
+  cancelled_ = true;
+  if (ready_event_)
+    ready_event_->Signal();
+}
+
+Status SyntheticSource::InitializeInternal() {
+  if (output_handlers().count(kVideoStreamIndex) > 0) {
+    if (params_.width == 0 || params_.height == 0 || params_.width % 2 != 0 ||
+        params_.height % 2 != 0 || params_.frame_rate == 0 ||
+        params_.gop_size == 0) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Invalid synthetic video parameters.");
+    }
+    video_ = CreateVideoStream();
+  }
+  if (output_handlers().count(kAudioStreamIndex) > 0) {
+    const uint32_t* sample_rates_end =
+        kAacSampleRates + arraysize(kAacSampleRates);
+    if (std::find(kAacSampleRates, sample_rates_end,
+                  params_.sampling_frequency) == sample_rates_end ||
+        params_.num_channels == 0 || params_.num_channels > 6) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Invalid synthetic audio parameters.");
+    }
+    audio_ = CreateAudioStream();
+  }
+  return Status::OK;
+}
+
+bool SyntheticSource::ValidateOutputStreamIndex(size_t stream_index) const {
+  return (stream_index == kVideoStreamIndex && params_.has_video) ||
+         (stream_index == kAudioStreamIndex && params_.has_audio);
+}
+
+std::unique_ptr<SyntheticSource::Stream> SyntheticSource::CreateVideoStream()
+    const {
+  std::unique_ptr<Stream> stream(new Stream);
+  stream->stream_index = kVideoStreamIndex;
+  // The frame durations are exact with this time scale.
+  const uint32_t time_scale = params_.frame_rate * 1000;
+  stream->sample_duration = 1000;
+  if (params_.duration_in_seconds > 0)
+    stream->end =
+        static_cast<int64_t>(params_.duration_in_seconds * time_scale);
+  stream->key_frame_interval = params_.gop_size;
+
+  const uint64_t gop_bytes = static_cast<uint64_t>(params_.video_bitrate) *
+                             params_.gop_size / params_.frame_rate / 8;
+  const size_t frame_size = static_cast<size_t>(
+      gop_bytes / (params_.gop_size - 1 + kKeyFrameWeight));
+  for (uint32_t idr_pic_id = 0; idr_pic_id < 2; ++idr_pic_id) {
+    stream->key_frames[idr_pic_id] =
+        GenerateFrame(true, idr_pic_id, frame_size * kKeyFrameWeight);
+  }
+  stream->frame = GenerateFrame(false, 0, frame_size);
+
+  const uint8_t level = GetH264Level(params_);
+  const std::vector<uint8_t> codec_config =
+      GenerateAvcDecoderConfig(GenerateSps(params_, level), GeneratePps(),
+                               level);
+  const uint32_t kPixelWidth = 1;
+  const uint32_t kPixelHeight = 1;
+  const uint8_t kTransferCharacteristics = 0;
+  const uint32_t kTrickPlayFactor = 0;
+  stream->stream_info = std::make_shared<VideoStreamInfo>(
+      kVideoTrackId, time_scale, stream->end, kCodecH264,
+      H26xStreamFormat::kNalUnitStreamWithoutParameterSetNalus,
+      AVCDecoderConfigurationRecord::GetCodecString(
+          FOURCC_avc1, kH264ProfileIndication, kH264ProfileCompatibility,
+          level),
+      codec_config.data(), codec_config.size(), params_.width, params_.height,
+      kPixelWidth, kPixelHeight, kTransferCharacteristics, kTrickPlayFactor,
+      kNaluLengthSize, std::string(), false);
+  return stream;
+}
+
+std::unique_ptr<SyntheticSource::Stream> SyntheticSource::CreateAudioStream()
+    const {
+  std::unique_ptr<Stream> stream(new Stream);
+  stream->stream_index = kAudioStreamIndex;
+  const uint32_t time_scale = params_.sampling_frequency;
+  stream->sample_duration = kAacFrameSize;
+  if (params_.duration_in_seconds > 0)
+    stream->end =
+        static_cast<int64_t>(params_.duration_in_seconds * time_scale);
+
+  const size_t frame_size = std::max<size_t>(
+      1, static_cast<uint64_t>(params_.audio_bitrate) * kAacFrameSize /
+             params_.sampling_frequency / 8);
+  BufferWriter frame;
+  AppendFiller(frame_size, &frame);
+  std::shared_ptr<std::vector<uint8_t>> data(new std::vector<uint8_t>);
+  frame.SwapBuffer(data.get());
+  stream->key_frames[0] = stream->key_frames[1] = stream->frame = data;
+
+  // AudioSpecificConfig: audioObjectType, samplingFrequencyIndex and
+  // channelConfiguration.
+  const uint8_t frequency_index = static_cast<uint8_t>(
+      std::find(kAacSampleRates, kAacSampleRates + arraysize(kAacSampleRates),
+                params_.sampling_frequency) -
+      kAacSampleRates);
+  const uint8_t codec_config[] = {
+      static_cast<uint8_t>((kAacLcObjectType << 3) | (frequency_index >> 1)),
+      static_cast<uint8_t>(((frequency_index & 1) << 7) |
+                           (params_.num_channels << 3)),
+  };
+  const uint8_t kSampleBits = 16;
+  const uint64_t kSeekPrerollNs = 0;
+  const uint64_t kCodecDelayNs = 0;
+  stream->stream_info = std::make_shared<AudioStreamInfo>(
+      kAudioTrackId, time_scale, stream->end, kCodecAAC, "mp4a.40.2",
+      codec_config, sizeof(codec_config), kSampleBits, params_.num_channels,
+      params_.sampling_frequency, kSeekPrerollNs, kCodecDelayNs,
+      params_.audio_bitrate, params_.audio_bitrate, std::string(), false);
+  return stream;
+}
+
+SyntheticSource::Stream* SyntheticSource::NextStream() const {
+  Stream* next_stream = nullptr;
+  for (Stream* stream : {video_.get(), audio_.get()}) {
+    if (!stream || stream->ended())
+      continue;
+    if (!next_stream || stream->next_time_in_seconds() <
+                            next_stream->next_time_in_seconds()) {
+      next_stream = stream;
+    }
+  }
+  return next_stream;
+}
+
+base::TimeDelta SyntheticSource::TimeUntilCaptured(const Stream& stream) const {
+  // A sample is output once all of it is captured.
+  const double captured_time_in_seconds =
+      static_cast<double>(stream.next_pts() + stream.sample_duration) /
+      stream.stream_info->time_scale();
+  return start_time_ +
+         base::TimeDelta::FromMicroseconds(
+             static_cast<int64_t>(captured_time_in_seconds * 1e6)) -
+         base::TimeTicks::Now();
+}
+
+Status SyntheticSource::DispatchNextSample(Stream* stream) {
+  const bool is_key_frame =
+      stream->num_samples % stream->key_frame_interval == 0;
+  const std::shared_ptr<const std::vector<uint8_t>>& data =
+      is_key_frame
+          ? stream->key_frames[(stream->num_samples /
+                                stream->key_frame_interval) % 2]
+          : stream->frame;
+  std::shared_ptr<MediaSample> sample = MediaSample::FromSharedData(
+      std::shared_ptr<const uint8_t>(data, data->data()), data->size(),
+      is_key_frame);
+  sample->set_pts(stream->next_pts());
+  sample->set_dts(stream->next_pts());
+  sample->set_duration(stream->sample_duration);
+  ++stream->num_samples;
+  return DispatchMediaSample(stream->stream_index, std::move(sample));
+}
+
+}  // namespace media
+}  // namespace shaka
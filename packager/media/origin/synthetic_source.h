@@ -0,0 +1,117 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_ORIGIN_SYNTHETIC_SOURCE_H_
+#define PACKAGER_MEDIA_ORIGIN_SYNTHETIC_SOURCE_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "packager/base/time/time.h"
+#include "packager/media/origin/origin_handler.h"
+
+namespace shaka {
+namespace media {
+
+/// Parameters of the streams generated by SyntheticSource.
+struct SyntheticSourceParams {
+  /// Generates an H.264 video stream if true.
+  bool has_video = true;
+  /// Width and height of the video, in pixels. They must be even.
+  uint16_t width = 1280;
+  uint16_t height = 720;
+  /// Frame rate of the video, in frames per second.
+  uint32_t frame_rate = 30;
+  /// Number of frames in a group of pictures, starting with a key frame.
+  uint32_t gop_size = 60;
+  /// Average bitrate of the video, in bits per second. The key frames take
+  /// SyntheticSource::kKeyFrameWeight times the size of the other frames.
+  uint32_t video_bitrate = 3000000;
+
+  /// Generates an AAC-LC audio stream if true.
+  bool has_audio = true;
+  uint32_t sampling_frequency = 48000;
+  uint8_t num_channels = 2;
+  /// Bitrate of the audio, in bits per second.
+  uint32_t audio_bitrate = 128000;
+
+  /// Duration of the streams, in seconds. The streams are endless if it is
+  /// not positive, i.e. until SyntheticSource::Cancel() is called.
+  double duration_in_seconds = 0;
+  /// Outputs the samples as they would be captured, i.e. paced with the wall
+  /// clock, if true. Otherwise, they are output as fast as the pipeline takes
+  /// them.
+  bool real_time = true;
+};
+
+/// SyntheticSource generates live-like streams without an encoder, for load
+/// testing the packaging pipelines: an H.264 video stream with valid
+/// parameter sets and slice headers, so the samples can be encrypted with
+/// subsamples, and an AAC-LC audio stream. The slice data and the audio
+/// frames are filler bytes, sized from the configured bitrates.
+///
+/// The outputs are set up like the Demuxer ones, with the "video" and
+/// "audio" stream labels.
+class SyntheticSource : public OriginHandler {
+ public:
+  /// The key frames are this many times the size of the other video frames.
+  static const uint32_t kKeyFrameWeight = 5;
+
+  explicit SyntheticSource(const SyntheticSourceParams& params);
+  ~SyntheticSource() override;
+
+  /// Connects the generated stream with @a stream_label, "video" or "audio",
+  /// to @a handler.
+  Status SetHandler(const std::string& stream_label,
+                    std::shared_ptr<MediaHandler> handler);
+
+  /// @name OriginHandler implementation overrides.
+  /// @{
+  Status Run() override;
+  Status RunStep(bool* done) override;
+  bool IsReadyToRunStep() override;
+  base::TimeDelta GetMaxTimeUntilReady() override;
+  void SetReadyEvent(base::WaitableEvent* event) override;
+  void Cancel() override;
+  /// @}
+
+ protected:
+  /// @name MediaHandler implementation overrides.
+  /// @{
+  Status InitializeInternal() override;
+  bool ValidateOutputStreamIndex(size_t stream_index) const override;
+  /// @}
+
+ private:
+  SyntheticSource(const SyntheticSource&) = delete;
+  SyntheticSource& operator=(const SyntheticSource&) = delete;
+
+  struct Stream;
+
+  std::unique_ptr<Stream> CreateVideoStream() const;
+  std::unique_ptr<Stream> CreateAudioStream() const;
+  // Returns the stream with the earliest next sample, or null if all the
+  // streams have ended.
+  Stream* NextStream() const;
+  // Returns the time until the next sample of |stream| is captured.
+  base::TimeDelta TimeUntilCaptured(const Stream& stream) const;
+  Status DispatchNextSample(Stream* stream);
+
+  const SyntheticSourceParams params_;
+  std::unique_ptr<Stream> video_;
+  std::unique_ptr<Stream> audio_;
+  bool started_ = false;
+  base::TimeTicks start_time_;
+  bool cancelled_ = false;
+  base::WaitableEvent* ready_event_ = nullptr;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_ORIGIN_SYNTHETIC_SOURCE_H_
@@ -0,0 +1,145 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/origin/synthetic_source.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/fourccs.h"
+#include "packager/media/base/media_handler_test_base.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/video_stream_info.h"
+#include "packager/media/codecs/avc_decoder_configuration_record.h"
+#include "packager/media/codecs/nalu_reader.h"
+#include "packager/media/codecs/video_slice_header_parser.h"
+#include "packager/status_macros.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const uint16_t kWidth = 1920;
+const uint16_t kHeight = 1080;
+const uint32_t kFrameRate = 30;
+const uint32_t kGopSize = 15;
+const uint32_t kVideoBitrate = 4000000;
+const uint32_t kAudioBitrate = 96000;
+}  // namespace
+
+class SyntheticSourceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    params_.width = kWidth;
+    params_.height = kHeight;
+    params_.frame_rate = kFrameRate;
+    params_.gop_size = kGopSize;
+    params_.video_bitrate = kVideoBitrate;
+    params_.audio_bitrate = kAudioBitrate;
+    params_.duration_in_seconds = 1;
+    params_.real_time = false;
+  }
+
+  Status RunSource() {
+    SyntheticSource source(params_);
+    if (params_.has_video)
+      RETURN_IF_ERROR(source.SetHandler("video", video_output_));
+    if (params_.has_audio)
+      RETURN_IF_ERROR(source.SetHandler("audio", audio_output_));
+    RETURN_IF_ERROR(source.Initialize());
+    return source.Run();
+  }
+
+  SyntheticSourceParams params_;
+  std::shared_ptr<CachingMediaHandler> video_output_ =
+      std::make_shared<CachingMediaHandler>();
+  std::shared_ptr<CachingMediaHandler> audio_output_ =
+      std::make_shared<CachingMediaHandler>();
+};
+
+TEST_F(SyntheticSourceTest, Video) {
+  params_.has_audio = false;
+  ASSERT_OK(RunSource());
+
+  const auto& outputs = video_output_->Cache();
+  ASSERT_EQ(1u + kFrameRate, outputs.size());
+  ASSERT_EQ(StreamDataType::kStreamInfo, outputs[0]->stream_data_type);
+  const VideoStreamInfo& stream_info =
+      static_cast<const VideoStreamInfo&>(*outputs[0]->stream_info());
+  EXPECT_EQ(kCodecH264, stream_info.codec());
+  EXPECT_EQ(kWidth, stream_info.width());
+  EXPECT_EQ(kHeight, stream_info.height());
+
+  AVCDecoderConfigurationRecord avc_config;
+  ASSERT_TRUE(avc_config.Parse(stream_info.codec_config()));
+  EXPECT_EQ(kWidth, avc_config.coded_width());
+  EXPECT_EQ(kHeight, avc_config.coded_height());
+  EXPECT_EQ(stream_info.codec_string(),
+            avc_config.GetCodecString(FOURCC_avc1));
+
+  // The slice headers are parsed for subsample encryption.
+  H264VideoSliceHeaderParser header_parser;
+  ASSERT_TRUE(header_parser.Initialize(stream_info.codec_config()));
+  uint64_t total_size = 0;
+  for (size_t i = 1; i < outputs.size(); ++i) {
+    ASSERT_EQ(StreamDataType::kMediaSample, outputs[i]->stream_data_type);
+    const MediaSample& sample = *outputs[i]->media_sample();
+    EXPECT_EQ((i - 1) % kGopSize == 0, sample.is_key_frame());
+    EXPECT_EQ(static_cast<int64_t>(i - 1) * sample.duration(), sample.pts());
+    total_size += sample.data_size();
+
+    NaluReader reader(Nalu::kH264, stream_info.nalu_length_size(),
+                      sample.data(), sample.data_size());
+    Nalu nalu;
+    ASSERT_EQ(NaluReader::kOk, reader.Advance(&nalu));
+    ASSERT_TRUE(nalu.is_video_slice());
+    EXPECT_GT(header_parser.GetHeaderSize(nalu), 0);
+    EXPECT_EQ(NaluReader::kEOStream, reader.Advance(&nalu));
+  }
+  EXPECT_NEAR(kVideoBitrate / 8, total_size, kVideoBitrate / 8 / 100);
+}
+
+TEST_F(SyntheticSourceTest, Audio) {
+  params_.has_video = false;
+  ASSERT_OK(RunSource());
+
+  const auto& outputs = audio_output_->Cache();
+  // 47 AAC frames of 1024 samples cover a second at 48kHz.
+  ASSERT_EQ(1u + 47, outputs.size());
+  const AudioStreamInfo& stream_info =
+      static_cast<const AudioStreamInfo&>(*outputs[0]->stream_info());
+  EXPECT_EQ(kCodecAAC, stream_info.codec());
+  EXPECT_EQ(48000u, stream_info.sampling_frequency());
+  EXPECT_EQ(2u, stream_info.num_channels());
+  EXPECT_EQ(std::vector<uint8_t>({0x11, 0x90}), stream_info.codec_config());
+  for (size_t i = 1; i < outputs.size(); ++i) {
+    EXPECT_TRUE(outputs[i]->media_sample()->is_key_frame());
+    EXPECT_EQ(static_cast<int64_t>(i - 1) * 1024,
+              outputs[i]->media_sample()->pts());
+  }
+}
+
+TEST_F(SyntheticSourceTest, RealTime) {
+  params_.duration_in_seconds = 0.2;
+  params_.real_time = true;
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  ASSERT_OK(RunSource());
+  // Allows for the rounding of the capture times to microseconds.
+  EXPECT_GE((base::TimeTicks::Now() - start_time).InMilliseconds(), 190);
+  EXPECT_EQ(1u + 6, video_output_->Cache().size());
+}
+
+TEST_F(SyntheticSourceTest, InvalidStream) {
+  SyntheticSource source(params_);
+  EXPECT_FALSE(source.SetHandler("text", video_output_).ok());
+  params_.has_audio = false;
+  SyntheticSource video_only_source(params_);
+  EXPECT_FALSE(video_only_source.SetHandler("audio", audio_output_).ok());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -23,6 +23,12 @@ struct Cuepoint {
 struct AdCueGeneratorParams {
   /// List of cuepoints.
   std::vector<Cuepoint> cue_points;
+
+  /// How far, in seconds, past the next cue a stream without video may buffer
+  /// samples while waiting for the other streams to promote the cue. The
+  /// stream keeps processing its input meanwhile. If it is zero, the stream
+  /// blocks as soon as it reaches the next cue.
+  double cue_alignment_horizon_in_seconds = 0;
 };
 
 }  // namespace shaka
@@ -25,6 +25,13 @@ struct ChunkingParams {
   /// Setting to subsegment_sap_aligned to true but segment_sap_aligned to false
   /// is not allowed.
   bool subsegment_sap_aligned = true;
+
+  /// Maximum duration in seconds of the text segments covering periods with
+  /// no cues. If positive, consecutive empty text segments are coalesced into
+  /// segments of up to this duration, in multiples of the segment duration,
+  /// which cuts the number of segment files and manifest updates for sparse
+  /// subtitles. Zero disables coalescing.
+  double max_empty_text_segment_duration_in_seconds = 0;
 };
 
 }  // namespace shaka
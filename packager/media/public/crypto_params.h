@@ -98,6 +98,11 @@ struct WidevineEncryptionParams {
   std::vector<uint8_t> group_id;
   /// Enables entitlement license when set to true.
   bool enable_entitlement_license;
+  /// With key rotation, the number of crypto periods to keep fetched ahead of
+  /// the latest crypto period requested for encryption.
+  uint32_t key_prefetch_crypto_periods = 40;
+  /// With key rotation, the maximum number of key requests in flight.
+  uint32_t max_concurrent_key_requests = 1;
 };
 
 /// PlayReady encryption parameters.
@@ -158,6 +163,15 @@ struct EncryptionParams {
   /// Extra XML data to add to PlayReady data.
   std::string playready_extra_header_data;
 
+  /// Directory of a cache of the Widevine and PlayReady key server responses,
+  /// reused by restarted and sibling packager processes. No cache if empty.
+  std::string key_cache_dir;
+  /// The 16-byte AES key the key cache files are encrypted with. Required with
+  /// `key_cache_dir`.
+  std::vector<uint8_t> key_cache_key;
+  /// How long a cached key server response is reused, in seconds.
+  int64_t key_cache_validity_in_seconds = 24 * 60 * 60;
+
   /// Clear lead duration in seconds.
   double clear_lead_in_seconds = 0;
   /// The protection scheme: "cenc", "cens", "cbc1", "cbcs".
@@ -182,6 +196,10 @@ struct EncryptionParams {
   double crypto_period_duration_in_seconds = kNoKeyRotation;
   /// Enable/disable subsample encryption for VP9.
   bool vp9_subsample_encryption = true;
+  /// Number of threads used to encrypt the samples of a single stream. Samples
+  /// are encrypted in parallel and re-sequenced before being dispatched
+  /// downstream. A value of 0 or 1 encrypts samples on the calling thread.
+  int num_encryption_threads = 1;
 
   /// Encrypted stream information that is used to determine stream label.
   struct EncryptedStreamAttributes {
@@ -0,0 +1,50 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_PUBLIC_HANDLER_STATS_PARAMS_H_
+#define PACKAGER_MEDIA_PUBLIC_HANDLER_STATS_PARAMS_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace shaka {
+
+/// Media handler statistics related parameters.
+struct HandlerStatsParams {
+  /// If set, the number of stream data processed, the processing times and
+  /// the queue depths of the media handlers of each stream are collected, and
+  /// passed to the callback as a JSON string every @a interval_in_seconds and
+  /// once more when packaging ends. The statistics are keyed by stream label,
+  /// i.e. input:stream_selector, plus the output for the muxers.
+  std::function<void(const std::string& stats_json)> stats_callback;
+  /// Interval between two calls to @a stats_callback while packaging.
+  double interval_in_seconds = 10;
+};
+
+/// Progress of an output stream, as returned by Packager::GetStats().
+struct StreamStats {
+  /// Label of the stream, i.e. input:stream_selector.
+  std::string stream_label;
+  /// Output file name, or segment template.
+  std::string output;
+  /// Number of media and text samples written to the output.
+  uint64_t num_samples = 0;
+  /// End of the last sample written to the output, in seconds.
+  double media_time_in_seconds = 0;
+  /// Number of bytes of the (sub)segments written to the output.
+  uint64_t bytes_written = 0;
+  /// Number of stream data queued in each stage of the stream, e.g.
+  /// ("ThreadedHandler", 12), in processing order.
+  std::vector<std::pair<std::string, size_t>> queue_depths;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_PUBLIC_HANDLER_STATS_PARAMS_H_
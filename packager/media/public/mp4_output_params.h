@@ -7,6 +7,8 @@
 #ifndef PACKAGER_MEDIA_PUBLIC_MP4_OUTPUT_PARAMS_H_
 #define PACKAGER_MEDIA_PUBLIC_MP4_OUTPUT_PARAMS_H_
 
+#include <stdint.h>
+
 namespace shaka {
 
 /// MP4 (ISO-BMFF) output related parameters.
@@ -20,6 +22,48 @@ struct Mp4OutputParams {
   /// Note that it is required by spec if segment_template contains $Times$
   /// specifier.
   bool generate_sidx_in_media_segments = true;
+  /// Space, in bytes, to reserve at the beginning of single segment
+  /// (on-demand) MP4 outputs for the 'ftyp', 'moov' and 'sidx' boxes. If
+  /// positive, media is written directly to the output file after the reserved
+  /// space instead of going through a temporary file, and the unused part of
+  /// the reserved space is padded with a 'free' box. A 'sidx' takes 12 bytes
+  /// per subsegment. If the boxes do not fit, or the output is not seekable,
+  /// the temporary file is used as before.
+  uint64_t vod_header_reserved_size = 0;
+  /// If positive, the 'sidx' of single segment (on-demand) outputs with more
+  /// subsegments than this is written as a two level hierarchy: a small
+  /// top-level 'sidx' referencing subsidiary 'sidx' boxes of at most this many
+  /// references each, which are placed right before the subsegments they
+  /// index. Players then only need the top-level index to start. A single
+  /// 'sidx' holds at most 65535 references. Requires players supporting
+  /// hierarchical 'sidx'.
+  uint32_t max_sidx_references = 0;
+  /// Write the init segment of segment template (live) outputs as soon as the
+  /// stream is known instead of waiting for the first sample, so players can
+  /// fetch it earlier. The EditList is then derived from
+  /// |expected_edit_list_offset| instead of from the first sample.
+  bool write_init_segment_early = false;
+  /// Used with |write_init_segment_early|. The expected offset, in seconds,
+  /// between the presentation and decoding timestamps of the first sample
+  /// (e.g. with B-frames), or the duration of the audio priming samples. A
+  /// warning is logged if the first sample does not match it.
+  double expected_edit_list_offset = 0;
+  /// Write progressive (non-fragmented) MP4 files, with 'moov' before a single
+  /// 'mdat', instead of fragmented ones. Applies to single segment outputs
+  /// without encryption. Media is written only once if
+  /// |vod_header_reserved_size| is large enough for 'moov', whose sample
+  /// tables take 4 to 20 bytes per sample, depending on how regular the
+  /// durations and composition offsets are, plus about 16 bytes per fragment;
+  /// otherwise it goes through a temporary file.
+  bool progressive = false;
+  /// Copy the fragments of single track fragmented MP4 inputs, e.g. CMAF
+  /// encoder outputs, to segment template outputs without demuxing them.
+  /// Only the 'styp', 'sidx', 'mfhd' sequence numbers and track IDs are
+  /// rewritten; a segment holds the input fragments up to the segment
+  /// duration. Streams that need encryption, re-segmentation (e.g. sync
+  /// points, ad cues or a fragment duration) or other sample processing are
+  /// demuxed as before.
+  bool fragment_passthrough = false;
 };
 
 }  // namespace shaka
@@ -16,6 +16,7 @@
         'ad_cue_generator_params.h',
         'chunking_params.h',
         'crypto_params.h',
+        'handler_stats_params.h',
         'mp4_output_params.h',
       ],
     },
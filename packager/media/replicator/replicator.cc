@@ -16,8 +16,14 @@ Status Replicator::InitializeInternal() {
 Status Replicator::Process(std::unique_ptr<StreamData> stream_data) {
   Status status;
 
+  size_t outputs_left = output_handlers().size();
   for (auto& out : output_handlers()) {
-    std::unique_ptr<StreamData> copy(new StreamData(*stream_data));
+    // The last output gets the original message, so it holds the only
+    // reference to the message if the other outputs have released theirs.
+    std::unique_ptr<StreamData> copy =
+        --outputs_left == 0
+            ? std::move(stream_data)
+            : std::unique_ptr<StreamData>(new StreamData(*stream_data));
     copy->stream_index = out.first;
 
     status.Update(Dispatch(std::move(copy)));
@@ -15,7 +15,9 @@ namespace media {
 /// The replicator takes a single input and send the messages to multiple
 /// downstream handlers. The messages that are sent downstream are not copies,
 /// they are the original message. It is the responsibility of downstream
-/// handlers to make a copy before modifying the message.
+/// handlers to make a copy before modifying the message, e.g. with
+/// MediaSample::Clone() and MediaSample::writable_data(), which only copy the
+/// sample data if it is still shared with the other outputs.
 class Replicator : public MediaHandler {
  private:
   Status InitializeInternal() override;
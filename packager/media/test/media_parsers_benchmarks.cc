@@ -0,0 +1,125 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Benchmarks of the parse throughput of each MediaParser, over the test data
+// files. The files are passed to the parsers in chunks, as the Demuxer does.
+// The results are reported in the format of testing/perf/perf_test.h, so they
+// can be compared across versions.
+//
+// Run from the packager repository root, e.g.
+//   out/Release/media_parsers_benchmarks \
+//       --gtest_filter=MediaParsersBenchmark.*
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/bind.h"
+#include "packager/base/time/time.h"
+#include "packager/media/base/media_parser.h"
+#include "packager/media/formats/mp2t/mp2t_media_parser.h"
+#include "packager/media/formats/mp4/mp4_media_parser.h"
+#include "packager/media/formats/webm/webm_media_parser.h"
+#include "packager/media/formats/webvtt/webvtt_parser.h"
+#include "packager/media/formats/wvm/wvm_media_parser.h"
+#include "packager/media/test/test_data_util.h"
+#include "packager/testing/perf/perf_test.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// Bytes parsed per measurement, whatever the file size.
+const size_t kBytesPerMeasurement = 64 << 20;
+// The size of the reads of the Demuxer.
+const size_t kChunkSize = 0x200000;
+
+void OnInit(const std::vector<std::shared_ptr<StreamInfo>>& stream_infos) {}
+
+bool OnNewMediaSample(size_t* num_samples,
+                      uint32_t track_id,
+                      std::shared_ptr<MediaSample> sample) {
+  ++*num_samples;
+  return true;
+}
+
+bool OnNewTextSample(size_t* num_samples,
+                     uint32_t track_id,
+                     std::shared_ptr<TextSample> sample) {
+  ++*num_samples;
+  return true;
+}
+
+// Parses |file_name| with a new Parser each time, until kBytesPerMeasurement
+// bytes are parsed, and prints the throughput.
+template <typename Parser>
+void RunParser(const std::string& trace, const std::string& file_name) {
+  const std::vector<uint8_t> data = ReadTestDataFile(file_name);
+  ASSERT_FALSE(data.empty());
+  const size_t iterations =
+      std::max<size_t>(1, kBytesPerMeasurement / data.size());
+
+  size_t num_samples = 0;
+  const base::TimeTicks start = base::TimeTicks::Now();
+  for (size_t i = 0; i < iterations; ++i) {
+    Parser parser;
+    parser.Init(base::Bind(&OnInit),
+                base::Bind(&OnNewMediaSample, &num_samples),
+                base::Bind(&OnNewTextSample, &num_samples), nullptr);
+    for (size_t pos = 0; pos < data.size(); pos += kChunkSize) {
+      const size_t size = std::min(kChunkSize, data.size() - pos);
+      ASSERT_TRUE(parser.Parse(data.data() + pos, static_cast<int>(size)));
+    }
+    ASSERT_TRUE(parser.Flush());
+  }
+  const double seconds = (base::TimeTicks::Now() - start).InSecondsF();
+  ASSERT_LT(0u, num_samples);
+
+  perf_test::PrintResult(
+      "throughput", "", trace,
+      seconds > 0 ? data.size() * iterations / seconds / (1 << 20) : 0.0,
+      "MB/s", true);
+  perf_test::PrintResult("sample_rate", "", trace,
+                         seconds > 0 ? num_samples / seconds : 0.0,
+                         "samples/s", true);
+}
+
+}  // namespace
+
+TEST(MediaParsersBenchmark, Mp4) {
+  RunParser<mp4::MP4MediaParser>("Mp4", "bear-640x360.mp4");
+}
+
+TEST(MediaParsersBenchmark, Mp4Fragmented) {
+  RunParser<mp4::MP4MediaParser>("Mp4Fragmented", "bear-640x360-av_frag.mp4");
+}
+
+TEST(MediaParsersBenchmark, Mp4Encrypted) {
+  RunParser<mp4::MP4MediaParser>("Mp4Encrypted",
+                                 "bear-640x360-v_frag-cenc-senc.mp4");
+}
+
+TEST(MediaParsersBenchmark, Mp2t) {
+  RunParser<mp2t::Mp2tMediaParser>("Mp2t", "bear-640x360.ts");
+}
+
+TEST(MediaParsersBenchmark, WebM) {
+  RunParser<WebMMediaParser>("WebM", "bear-640x360.webm");
+}
+
+TEST(MediaParsersBenchmark, Wvm) {
+  RunParser<wvm::WvmMediaParser>("Wvm", "bear-640x360.wvm");
+}
+
+TEST(MediaParsersBenchmark, WebVtt) {
+  RunParser<WebVttParser>("WebVtt", "bear-english.vtt");
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -31,5 +31,25 @@
         'run_tests_with_atexit_manager',
       ],
     },
+    {
+      # Not part of the unit tests, as the benchmarks take a while and their
+      # results are only meaningful in release builds.
+      'target_name': 'media_parsers_benchmarks',
+      'type': '<(gtest_target_type)',
+      'sources': [
+        'media_parsers_benchmarks.cc',
+      ],
+      'dependencies': [
+        '../../base/base.gyp:base',
+        '../../testing/gtest.gyp:gtest',
+        '../../testing/perf/perf_test.gyp:perf_test',
+        '../formats/mp2t/mp2t.gyp:mp2t',
+        '../formats/mp4/mp4.gyp:mp4',
+        '../formats/webm/webm.gyp:webm',
+        '../formats/webvtt/webvtt.gyp:webvtt',
+        '../formats/wvm/wvm.gyp:wvm',
+        'media_test_support',
+      ],
+    },
   ],
 }
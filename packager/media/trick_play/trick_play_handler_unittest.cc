@@ -300,5 +300,55 @@ TEST_F(TrickPlayHandlerTest, TrickTrackWithSamplesAndSegments) {
   ASSERT_OK(Flush());
 }
 
+// The outputs of a single handler get the trick play streams of different
+// factors.
+TEST_F(TrickPlayHandlerTest, MultipleFactors) {
+  const size_t kTwoOutputs = 2;
+  const size_t kFactor1Output = 0;
+  const size_t kFactor2Output = 1;
+
+  const int64_t kFrameDuration = 100;
+  const int64_t kFrame0 = 0;
+  const int64_t kFrame2 = 200;
+  const int64_t kFrame4 = 400;
+  const int64_t kFrame6 = 600;
+
+  ASSERT_OK(MediaHandlerTestBase::SetUpAndInitializeGraph(
+      std::make_shared<TrickPlayHandler>(std::vector<uint32_t>{1u, 2u}),
+      kInputCount, kTwoOutputs));
+
+  // Key frame every two frames. The first output uses every key frame and the
+  // second output every second key frame.
+  {
+    testing::InSequence s;
+    EXPECT_CALL(*Output(kFactor1Output),
+                OnProcess(IsVideoStream(kFactor1Output, 1u, 2u)));
+    for (int64_t frame : {kFrame0, kFrame2, kFrame4, kFrame6}) {
+      EXPECT_CALL(*Output(kFactor1Output),
+                  OnProcess(IsMediaSample(kFactor1Output, frame,
+                                          kFrameDuration * 2, _, kKeyFrame)));
+    }
+    EXPECT_CALL(*Output(kFactor1Output), OnFlush(_));
+  }
+  {
+    testing::InSequence s;
+    EXPECT_CALL(*Output(kFactor2Output),
+                OnProcess(IsVideoStream(kFactor2Output, 2u, 4u)));
+    for (int64_t frame : {kFrame0, kFrame4}) {
+      EXPECT_CALL(*Output(kFactor2Output),
+                  OnProcess(IsMediaSample(kFactor2Output, frame,
+                                          kFrameDuration * 4, _, kKeyFrame)));
+    }
+    EXPECT_CALL(*Output(kFactor2Output), OnFlush(_));
+  }
+
+  ASSERT_OK(DispatchVideoInfo());
+  for (int64_t frame = 0; frame < 8; ++frame) {
+    ASSERT_OK(DispatchSample(frame * kFrameDuration, kFrameDuration,
+                             frame % 2 == 0));
+  }
+  ASSERT_OK(Flush());
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -190,6 +190,7 @@ Representation* AdaptationSet::AddRepresentation(const MediaInfo& media_info) {
     return NULL;
   }
   UpdateFromMediaInfo(media_info);
+  ++xml_version_;
   Representation* representation_ptr = new_representation.get();
   representation_map_[representation_ptr->id()] = std::move(new_representation);
   return representation_ptr;
@@ -205,6 +206,7 @@ Representation* AdaptationSet::CopyRepresentation(
       new Representation(representation, std::move(listener)));
 
   UpdateFromMediaInfo(new_representation->GetMediaInfo());
+  ++xml_version_;
   Representation* representation_ptr = new_representation.get();
   representation_map_[representation_ptr->id()] = std::move(new_representation);
   return representation_ptr;
@@ -214,21 +216,25 @@ void AdaptationSet::AddContentProtectionElement(
     const ContentProtectionElement& content_protection_element) {
   content_protection_elements_.push_back(content_protection_element);
   RemoveDuplicateAttributes(&content_protection_elements_.back());
+  ++xml_version_;
 }
 
 void AdaptationSet::UpdateContentProtectionPssh(const std::string& drm_uuid,
                                                 const std::string& pssh) {
   UpdateContentProtectionPsshHelper(drm_uuid, pssh,
                                     &content_protection_elements_);
+  ++xml_version_;
 }
 
 void AdaptationSet::AddAccessibility(const std::string& scheme,
                                      const std::string& value) {
   accessibilities_.push_back(Accessibility{scheme, value});
+  ++xml_version_;
 }
 
 void AdaptationSet::AddRole(Role role) {
   roles_.insert(role);
+  ++xml_version_;
 }
 
 // Creates a copy of <AdaptationSet> xml element, iterate thru all the
@@ -377,11 +383,13 @@ void AdaptationSet::ForceSetSegmentAlignment(bool segment_alignment) {
   segments_aligned_ =
       segment_alignment ? kSegmentAlignmentTrue : kSegmentAlignmentFalse;
   force_set_segment_alignment_ = true;
+  ++xml_version_;
 }
 
 void AdaptationSet::AddAdaptationSetSwitching(
     const AdaptationSet* adaptation_set) {
   switchable_adaptation_sets_.push_back(adaptation_set);
+  ++xml_version_;
 }
 
 // For dynamic MPD, storing all start_time and duration will out-of-memory
@@ -399,16 +407,26 @@ void AdaptationSet::OnNewSegmentForRepresentation(uint32_t representation_id,
     representation_segment_start_times_[representation_id].push_back(
         start_time);
   }
+  ++xml_version_;
 }
 
 void AdaptationSet::OnSetFrameRateForRepresentation(uint32_t representation_id,
                                                     uint32_t frame_duration,
                                                     uint32_t timescale) {
   RecordFrameRate(frame_duration, timescale);
+  ++xml_version_;
 }
 
 void AdaptationSet::AddTrickPlayReference(const AdaptationSet* adaptation_set) {
   trick_play_references_.push_back(adaptation_set);
+  ++xml_version_;
+}
+
+uint64_t AdaptationSet::GetXmlVersion() const {
+  uint64_t xml_version = xml_version_;
+  for (const auto& representation_pair : representation_map_)
+    xml_version += representation_pair.second->xml_version();
+  return xml_version;
 }
 
 const std::list<Representation*> AdaptationSet::GetRepresentations() const {
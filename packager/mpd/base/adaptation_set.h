@@ -129,7 +129,10 @@ class AdaptationSet {
 
   /// Set AdaptationSet@id.
   /// @param id is the new ID to be set.
-  void set_id(uint32_t id) { id_ = id; }
+  void set_id(uint32_t id) {
+    id_ = id;
+    ++xml_version_;
+  }
 
   /// Notifies the AdaptationSet instance that a new (sub)segment was added to
   /// the Representation with @a representation_id.
@@ -169,6 +172,10 @@ class AdaptationSet {
   // Return the list of Representations in this AdaptationSet.
   const std::list<Representation*> GetRepresentations() const;
 
+  /// @return A number that changes whenever the element generated by GetXml()
+  ///         may change, including changes to the Representations.
+  uint64_t GetXmlVersion() const;
+
   /// @return true if it is a video AdaptationSet.
   bool IsVideo() const;
 
@@ -177,7 +184,10 @@ class AdaptationSet {
 
   /// Set AdaptationSet@codec.
   /// @param codec is the new codec to be set.
-  void set_codec(const std::string& codec) { codec_ = codec; };
+  void set_codec(const std::string& codec) {
+    codec_ = codec;
+    ++xml_version_;
+  };
 
  protected:
   /// @param language is the language of this AdaptationSet. Mainly relevant for
@@ -299,6 +309,9 @@ class AdaptationSet {
   SegmentAligmentStatus segments_aligned_;
   bool force_set_segment_alignment_;
 
+  // Incremented whenever anything GetXml() depends on changes.
+  uint64_t xml_version_ = 0;
+
   // Keeps track of segment start times of Representations.
   // For static MPD, this will not be cleared, all the segment start times are
   // stored in this. This should not out-of-memory for a reasonable length
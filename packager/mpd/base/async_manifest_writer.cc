@@ -0,0 +1,71 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/async_manifest_writer.h"
+
+#include "packager/base/bind.h"
+#include "packager/base/threading/worker_pool.h"
+
+namespace shaka {
+
+AsyncManifestWriter::AsyncManifestWriter() : idle_condition_(&lock_) {}
+
+AsyncManifestWriter::~AsyncManifestWriter() {
+  Flush();
+}
+
+void AsyncManifestWriter::Write(const std::string& file_path,
+                                const std::string& content) {
+  base::AutoLock auto_lock(lock_);
+  bool replaced = false;
+  for (auto& pending_write : pending_writes_) {
+    if (pending_write.first == file_path) {
+      pending_write.second = content;
+      replaced = true;
+      break;
+    }
+  }
+  if (!replaced)
+    pending_writes_.emplace_back(file_path, content);
+
+  if (!thread_running_) {
+    thread_running_ = true;
+    base::WorkerPool::PostTask(
+        FROM_HERE,
+        base::Bind(&AsyncManifestWriter::ThreadMain, base::Unretained(this)),
+        /* task_is_slow= */ true);
+  }
+}
+
+bool AsyncManifestWriter::Flush() {
+  base::AutoLock auto_lock(lock_);
+  while (thread_running_)
+    idle_condition_.Wait();
+  const bool result = !write_failed_;
+  write_failed_ = false;
+  return result;
+}
+
+void AsyncManifestWriter::ThreadMain() {
+  base::AutoLock auto_lock(lock_);
+  while (!pending_writes_.empty()) {
+    const std::pair<std::string, std::string> write =
+        std::move(pending_writes_.front());
+    pending_writes_.pop_front();
+
+    bool result = false;
+    {
+      base::AutoUnlock auto_unlock(lock_);
+      result = file_writer_.Write(write.first, write.second);
+    }
+    if (!result)
+      write_failed_ = true;
+  }
+  thread_running_ = false;
+  idle_condition_.Broadcast();
+}
+
+}  // namespace shaka
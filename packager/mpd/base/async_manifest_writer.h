@@ -0,0 +1,59 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MPD_BASE_ASYNC_MANIFEST_WRITER_H_
+#define MPD_BASE_ASYNC_MANIFEST_WRITER_H_
+
+#include <list>
+#include <string>
+#include <utility>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/mpd/base/manifest_file_writer.h"
+
+namespace shaka {
+
+/// Writes manifests on a worker thread, so the threads producing the manifest
+/// snapshots never block on manifest I/O, e.g. a slow HTTP upload. Writes are
+/// latest-wins: a pending write to a file is replaced by a newer snapshot of
+/// the same file. Files are written in the order they were first scheduled.
+/// Writes that would not change the file are skipped, see ManifestFileWriter.
+/// This class is thread safe.
+class AsyncManifestWriter {
+ public:
+  AsyncManifestWriter();
+  /// Waits for the pending writes to complete.
+  ~AsyncManifestWriter();
+
+  /// Schedules @a content to be written to @a file_path atomically. Returns
+  /// immediately.
+  void Write(const std::string& file_path, const std::string& content);
+
+  /// Waits for the pending writes to complete.
+  /// @return false if any write failed since the last call to Flush().
+  bool Flush();
+
+ private:
+  AsyncManifestWriter(const AsyncManifestWriter&) = delete;
+  AsyncManifestWriter& operator=(const AsyncManifestWriter&) = delete;
+
+  void ThreadMain();
+
+  base::Lock lock_;
+  // Signaled when the worker thread exits.
+  base::ConditionVariable idle_condition_;
+  // Pairs of file path and content.
+  std::list<std::pair<std::string, std::string>> pending_writes_;
+  bool thread_running_ = false;
+  bool write_failed_ = false;
+  // Only used by the worker thread.
+  ManifestFileWriter file_writer_;
+};
+
+}  // namespace shaka
+
+#endif  // MPD_BASE_ASYNC_MANIFEST_WRITER_H_
@@ -0,0 +1,62 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/async_manifest_writer.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/file/file.h"
+#include "packager/file/memory_file.h"
+
+namespace shaka {
+
+namespace {
+const char kManifestPath1[] = "memory://manifest1.mpd";
+const char kManifestPath2[] = "memory://manifest2.m3u8";
+}  // namespace
+
+class AsyncManifestWriterTest : public ::testing::Test {
+ protected:
+  void TearDown() override { MemoryFile::DeleteAll(); }
+
+  std::string ReadFile(const char* file_path) {
+    std::string content;
+    EXPECT_TRUE(File::ReadFileToString(file_path, &content));
+    return content;
+  }
+
+  AsyncManifestWriter writer_;
+};
+
+TEST_F(AsyncManifestWriterTest, Write) {
+  writer_.Write(kManifestPath1, "content1");
+  writer_.Write(kManifestPath2, "content2");
+  ASSERT_TRUE(writer_.Flush());
+  EXPECT_EQ("content1", ReadFile(kManifestPath1));
+  EXPECT_EQ("content2", ReadFile(kManifestPath2));
+}
+
+TEST_F(AsyncManifestWriterTest, LatestWins) {
+  const int kNumWrites = 100;
+  for (int i = 0; i < kNumWrites; ++i)
+    writer_.Write(kManifestPath1, base::IntToString(i));
+  ASSERT_TRUE(writer_.Flush());
+  EXPECT_EQ(base::IntToString(kNumWrites - 1), ReadFile(kManifestPath1));
+}
+
+TEST_F(AsyncManifestWriterTest, FlushWithoutWrites) {
+  EXPECT_TRUE(writer_.Flush());
+}
+
+TEST_F(AsyncManifestWriterTest, WriteFailure) {
+  writer_.Write("/non_existent_dir/manifest.mpd", "content");
+  EXPECT_FALSE(writer_.Flush());
+  // The failure is reported once.
+  EXPECT_TRUE(writer_.Flush());
+}
+
+}  // namespace shaka
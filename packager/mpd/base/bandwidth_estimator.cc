@@ -10,11 +10,26 @@
 #include <cmath>
 #include <numeric>
 
+#include <gflags/gflags.h>
+
 #include "packager/base/logging.h"
 
+DEFINE_double(bandwidth_estimation_window,
+              0,
+              "Window, in seconds, of the bandwidth estimates in DASH "
+              "@bandwidth and HLS BANDWIDTH and AVERAGE-BANDWIDTH. The "
+              "average bandwidth is a moving average weighted towards the "
+              "last window and the peak bandwidth is the max over the "
+              "segments in the last window. The whole stream is used if it is "
+              "not positive. Useful for long running live streams.");
+
 namespace shaka {
 
-BandwidthEstimator::BandwidthEstimator() = default;
+BandwidthEstimator::BandwidthEstimator()
+    : BandwidthEstimator(FLAGS_bandwidth_estimation_window) {}
+
+BandwidthEstimator::BandwidthEstimator(double window_seconds)
+    : window_seconds_(window_seconds) {}
 
 BandwidthEstimator::~BandwidthEstimator() = default;
 
@@ -29,10 +44,22 @@ void BandwidthEstimator::AddBlock(uint64_t size_in_bytes, double duration) {
   const uint64_t size_in_bits = size_in_bytes * kBitsInByte;
   total_size_in_bits_ += size_in_bits;
   total_duration_ += duration;
+  const Block block = {size_in_bits, duration, total_duration_};
+
+  if (window_seconds_ > 0) {
+    // The weight of the new block grows with its duration, such that a block
+    // of |window_seconds_| weighs 1 - 1/e.
+    const double bitrate = size_in_bits / duration;
+    const double weight = 1.0 - std::exp(-duration / window_seconds_);
+    average_bitrate_ = average_bitrate_ == 0
+                           ? bitrate
+                           : average_bitrate_ +
+                                 weight * (bitrate - average_bitrate_);
+  }
 
   const size_t kTargetDurationThreshold = 10;
   if (initial_blocks_.size() < kTargetDurationThreshold) {
-    initial_blocks_.push_back({size_in_bits, duration});
+    initial_blocks_.push_back(block);
     return;
   }
 
@@ -40,23 +67,23 @@ void BandwidthEstimator::AddBlock(uint64_t size_in_bytes, double duration) {
     // Use the average duration as the target block duration. It will be used
     // to filter small blocks from bandwidth calculation.
     target_block_duration_ = GetAverageBlockDuration();
-    for (const Block& block : initial_blocks_) {
-      max_bitrate_ =
-          std::max(max_bitrate_, GetBitrate(block, target_block_duration_));
-    }
-    return;
+    for (const Block& initial_block : initial_blocks_)
+      UpdateMax(initial_block);
   }
-  max_bitrate_ = std::max(max_bitrate_, GetBitrate({size_in_bits, duration},
-                                                   target_block_duration_));
+  UpdateMax(block);
 }
 
 uint64_t BandwidthEstimator::Estimate() const {
+  if (window_seconds_ > 0)
+    return static_cast<uint64_t>(ceil(average_bitrate_));
   if (total_duration_ == 0)
     return 0;
   return static_cast<uint64_t>(ceil(total_size_in_bits_ / total_duration_));
 }
 
 uint64_t BandwidthEstimator::Max() const {
+  if (window_seconds_ > 0 && !windowed_bitrates_.empty())
+    return windowed_bitrates_.front().bitrate;
   if (max_bitrate_ != 0)
     return max_bitrate_;
 
@@ -110,4 +137,22 @@ uint64_t BandwidthEstimator::GetBitrate(const Block& block,
   return static_cast<uint64_t>(ceil(block.size_in_bits / block.duration));
 }
 
+void BandwidthEstimator::UpdateMax(const Block& block) {
+  const uint64_t bitrate = GetBitrate(block, target_block_duration_);
+  if (window_seconds_ <= 0) {
+    max_bitrate_ = std::max(max_bitrate_, bitrate);
+    return;
+  }
+  // Blocks with lower bitrates ending earlier can never be the max again.
+  while (!windowed_bitrates_.empty() &&
+         windowed_bitrates_.back().bitrate <= bitrate) {
+    windowed_bitrates_.pop_back();
+  }
+  windowed_bitrates_.push_back({bitrate, block.end_time});
+  while (windowed_bitrates_.front().end_time <=
+         total_duration_ - window_seconds_) {
+    windowed_bitrates_.pop_front();
+  }
+}
+
 }  // namespace shaka
@@ -9,13 +9,24 @@
 
 #include <stdint.h>
 
+#include <deque>
 #include <vector>
 
 namespace shaka {
 
+/// Estimates the average and the peak bandwidth of a stream from its blocks,
+/// i.e. segments. By default both are computed over the whole stream. With a
+/// positive window, e.g. for 24/7 live streams, the average is an exponentially
+/// weighted moving average and the peak is the max over the blocks that ended
+/// within the window, so the estimates follow the recent content in memory
+/// bounded by the window.
 class BandwidthEstimator {
  public:
+  /// Uses --bandwidth_estimation_window as the window.
   BandwidthEstimator();
+  /// @param window_seconds is the window of the estimates in seconds. The whole
+  ///        stream is used if it is not positive.
+  explicit BandwidthEstimator(double window_seconds);
   ~BandwidthEstimator();
 
   /// @param size is the size of the block in bytes. Should be positive.
@@ -41,12 +52,20 @@ class BandwidthEstimator {
   struct Block {
     uint64_t size_in_bits;
     double duration;
+    // The sum of the durations of the blocks up to this block, inclusive.
+    double end_time;
+  };
+  struct WindowedBitrate {
+    uint64_t bitrate;
+    double end_time;
   };
   // Return the average block duration of the blocks in |initial_blocks_|.
   double GetAverageBlockDuration() const;
   // Return the bitrate of the block. Note that a bitrate of 0 is returned if
   // the block duration is less than 50% of target block duration.
   uint64_t GetBitrate(const Block& block, double target_block_duration) const;
+  // Accounts the bitrate of |block| in the peak bandwidth.
+  void UpdateMax(const Block& block);
 
   std::vector<Block> initial_blocks_;
   // Target block duration will be estimated from the average duration of the
@@ -56,6 +75,12 @@ class BandwidthEstimator {
   uint64_t total_size_in_bits_ = 0;
   double total_duration_ = 0;
   uint64_t max_bitrate_ = 0;
+
+  const double window_seconds_ = 0;
+  double average_bitrate_ = 0;
+  // The candidates for the max bitrate in the window, in decreasing order of
+  // bitrate and increasing order of end time.
+  std::deque<WindowedBitrate> windowed_bitrates_;
 };
 
 }  // namespace shaka
@@ -63,4 +63,38 @@ TEST(BandwidthEstimatorTest, ExcludeShortBlocksMore) {
   EXPECT_EQ(kExpectedMax, be.Max());
 }
 
+TEST(BandwidthEstimatorTest, WindowedMax) {
+  const double kDuration = 1.0;
+  const double kWindowSeconds = 5.0;
+  BandwidthEstimator be(kWindowSeconds);
+
+  for (int i = 0; i < 10; ++i)
+    be.AddBlock(100, kDuration);
+  be.AddBlock(1000, kDuration);
+  EXPECT_EQ(1000 * kBitsInByte, be.Max());
+
+  // The large block stays in the window for |kWindowSeconds|.
+  for (int i = 0; i < 4; ++i)
+    be.AddBlock(100, kDuration);
+  EXPECT_EQ(1000 * kBitsInByte, be.Max());
+  be.AddBlock(100, kDuration);
+  EXPECT_EQ(100 * kBitsInByte, be.Max());
+}
+
+TEST(BandwidthEstimatorTest, WindowedAverage) {
+  const double kDuration = 1.0;
+  const double kWindowSeconds = 10.0;
+  BandwidthEstimator be(kWindowSeconds);
+
+  for (int i = 0; i < 100; ++i)
+    be.AddBlock(100, kDuration);
+  EXPECT_EQ(100 * kBitsInByte, be.Estimate());
+
+  // The average converges to the bitrate of the recent blocks, unlike the
+  // average of the whole stream which would be 150 * kBitsInByte.
+  for (int i = 0; i < 100; ++i)
+    be.AddBlock(200, kDuration);
+  EXPECT_EQ(200 * kBitsInByte, be.Estimate());
+}
+
 } // namespace shaka
@@ -0,0 +1,154 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/manifest_checkpoint.h"
+
+#include <string.h>
+
+#include <memory>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+
+namespace shaka {
+
+namespace {
+
+const char kCheckpointHeader[] = "shaka-packager-checkpoint 1\n";
+
+// Parses the record of a state, i.e. "<key size> <state size>\n<key><state>\n",
+// at |*position| of |contents|, and moves |*position| past it.
+bool ParseRecord(const std::string& contents,
+                 size_t* position,
+                 std::string* key,
+                 std::string* state) {
+  const size_t line_end = contents.find('\n', *position);
+  if (line_end == std::string::npos)
+    return false;
+  const std::string sizes = contents.substr(*position, line_end - *position);
+  const size_t space = sizes.find(' ');
+  size_t key_size = 0;
+  size_t state_size = 0;
+  if (space == std::string::npos ||
+      !base::StringToSizeT(sizes.substr(0, space), &key_size) ||
+      !base::StringToSizeT(sizes.substr(space + 1), &state_size)) {
+    return false;
+  }
+  const size_t key_start = line_end + 1;
+  if (contents.size() - key_start < key_size + state_size + 1 ||
+      contents[key_start + key_size + state_size] != '\n') {
+    return false;
+  }
+  *key = contents.substr(key_start, key_size);
+  *state = contents.substr(key_start + key_size, state_size);
+  *position = key_start + key_size + state_size + 1;
+  return true;
+}
+
+}  // namespace
+
+ManifestCheckpoint::ManifestCheckpoint(const std::string& file_path,
+                                       double interval_in_seconds)
+    : file_path_(file_path),
+      interval_(base::TimeDelta::FromMicroseconds(static_cast<int64_t>(
+          interval_in_seconds * base::Time::kMicrosecondsPerSecond))) {}
+
+ManifestCheckpoint::~ManifestCheckpoint() {}
+
+bool ManifestCheckpoint::Load() {
+  {
+    std::unique_ptr<File, FileCloser> file(
+        File::Open(file_path_.c_str(), "r"));
+    if (!file) {
+      LOG(INFO) << "No checkpoint to resume from in " << file_path_ << ".";
+      return true;
+    }
+  }
+  std::string contents;
+  if (!File::ReadFileToString(file_path_.c_str(), &contents)) {
+    LOG(ERROR) << "Failed to read the checkpoint " << file_path_;
+    return false;
+  }
+  if (contents.compare(0, strlen(kCheckpointHeader), kCheckpointHeader) != 0) {
+    LOG(ERROR) << "Invalid checkpoint " << file_path_;
+    return false;
+  }
+
+  std::map<std::string, std::string> states;
+  size_t position = strlen(kCheckpointHeader);
+  while (position < contents.size()) {
+    std::string key;
+    std::string state;
+    if (!ParseRecord(contents, &position, &key, &state)) {
+      LOG(ERROR) << "Invalid checkpoint " << file_path_ << " at offset "
+                 << position;
+      return false;
+    }
+    states[key] = state;
+  }
+  LOG(INFO) << "Resuming from the checkpoint " << file_path_ << " with "
+            << states.size() << " states.";
+
+  base::AutoLock auto_lock(lock_);
+  states_.swap(states);
+  return true;
+}
+
+std::string ManifestCheckpoint::GetState(const std::string& key) const {
+  base::AutoLock auto_lock(lock_);
+  auto iter = states_.find(key);
+  return iter == states_.end() ? "" : iter->second;
+}
+
+void ManifestCheckpoint::SetState(const std::string& key,
+                                  const std::string& state) {
+  base::AutoLock auto_lock(lock_);
+  std::string& current_state = states_[key];
+  if (current_state == state)
+    return;
+  current_state = state;
+  updated_ = true;
+}
+
+bool ManifestCheckpoint::MaybeWrite() {
+  {
+    base::AutoLock auto_lock(lock_);
+    if (!updated_ || (!last_write_time_.is_null() &&
+                      base::TimeTicks::Now() - last_write_time_ < interval_)) {
+      return true;
+    }
+  }
+  return Write();
+}
+
+bool ManifestCheckpoint::Write() {
+  base::AutoLock write_lock(write_lock_);
+  std::string contents = kCheckpointHeader;
+  {
+    base::AutoLock auto_lock(lock_);
+    if (!updated_)
+      return true;
+    for (const auto& key_state : states_) {
+      base::StringAppendF(&contents, "%zu %zu\n", key_state.first.size(),
+                          key_state.second.size());
+      contents += key_state.first + key_state.second + "\n";
+    }
+    updated_ = false;
+    last_write_time_ = base::TimeTicks::Now();
+  }
+  if (!File::WriteFileAtomically(file_path_.c_str(), contents)) {
+    LOG(ERROR) << "Failed to write the checkpoint " << file_path_;
+    base::AutoLock auto_lock(lock_);
+    updated_ = true;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace shaka
@@ -0,0 +1,76 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MPD_BASE_MANIFEST_CHECKPOINT_H_
+#define MPD_BASE_MANIFEST_CHECKPOINT_H_
+
+#include <map>
+#include <string>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+
+/// Checkpoint of the state of the live manifests, e.g. the segments in the
+/// live window of the HLS playlists and of the DASH Representations, and the
+/// media sequence and segment numbers, so that a restarted packager continues
+/// the manifests instead of starting them over. The state of each manifest
+/// element is an opaque string, identified by a key, e.g. "hls:" followed by
+/// the playlist file name. The checkpoint is kept in memory and written to a
+/// local file atomically, so loading it at startup only takes the time to
+/// read a small file.
+///
+/// The states are set concurrently by the HLS and DASH notifiers. The file is
+/// written without holding the lock of the states, so a slow write does not
+/// block the manifest updates.
+class ManifestCheckpoint {
+ public:
+  /// @param file_path is the path of the checkpoint file.
+  /// @param interval_in_seconds is the minimum interval between the writes of
+  ///        MaybeWrite(). Every call writes the checkpoint if it is not
+  ///        positive.
+  ManifestCheckpoint(const std::string& file_path, double interval_in_seconds);
+  ~ManifestCheckpoint();
+
+  /// Loads the checkpoint file. Nothing is loaded if it does not exist.
+  /// @return false if the file exists but cannot be read or parsed.
+  bool Load();
+
+  /// @return the state of @a key, or an empty string if there is none.
+  std::string GetState(const std::string& key) const;
+
+  /// Sets the state of @a key, written with the next write.
+  void SetState(const std::string& key, const std::string& state);
+
+  /// Writes the checkpoint if it is updated since the previous write, and if
+  /// the interval has elapsed since then.
+  /// @return false if the write failed, true otherwise.
+  bool MaybeWrite();
+
+  /// Writes the checkpoint if it is updated since the previous write.
+  /// @return false if the write failed, true otherwise.
+  bool Write();
+
+ private:
+  ManifestCheckpoint(const ManifestCheckpoint&) = delete;
+  ManifestCheckpoint& operator=(const ManifestCheckpoint&) = delete;
+
+  const std::string file_path_;
+  const base::TimeDelta interval_;
+
+  mutable base::Lock lock_;
+  // Guarded by |lock_|.
+  std::map<std::string, std::string> states_;
+  bool updated_ = false;
+  base::TimeTicks last_write_time_;
+  // Serializes the writes, which are done without holding |lock_|.
+  base::Lock write_lock_;
+};
+
+}  // namespace shaka
+
+#endif  // MPD_BASE_MANIFEST_CHECKPOINT_H_
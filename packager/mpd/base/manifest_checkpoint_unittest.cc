@@ -0,0 +1,82 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/manifest_checkpoint.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/file/file.h"
+#include "packager/file/memory_file.h"
+
+namespace shaka {
+
+namespace {
+const char kCheckpointFile[] = "memory://checkpoint";
+// Written on every update.
+const double kNoInterval = 0;
+const double kLongInterval = 3600;
+}  // namespace
+
+class ManifestCheckpointTest : public ::testing::Test {
+ protected:
+  void TearDown() override { MemoryFile::DeleteAll(); }
+};
+
+TEST_F(ManifestCheckpointTest, LoadWithoutFile) {
+  ManifestCheckpoint checkpoint(kCheckpointFile, kNoInterval);
+  EXPECT_TRUE(checkpoint.Load());
+  EXPECT_EQ("", checkpoint.GetState("hls:playlist.m3u8"));
+}
+
+TEST_F(ManifestCheckpointTest, WriteAndLoad) {
+  // States may contain new lines and spaces.
+  const std::string kHlsState = "media_sequence_number 5\nsegment 0 10 a b\n";
+  const std::string kDashState = "start_number 3\n";
+  {
+    ManifestCheckpoint checkpoint(kCheckpointFile, kNoInterval);
+    checkpoint.SetState("hls:playlist.m3u8", kHlsState);
+    checkpoint.SetState("dash:segment_$Number$.m4s", kDashState);
+    EXPECT_TRUE(checkpoint.MaybeWrite());
+  }
+
+  ManifestCheckpoint checkpoint(kCheckpointFile, kNoInterval);
+  ASSERT_TRUE(checkpoint.Load());
+  EXPECT_EQ(kHlsState, checkpoint.GetState("hls:playlist.m3u8"));
+  EXPECT_EQ(kDashState, checkpoint.GetState("dash:segment_$Number$.m4s"));
+  EXPECT_EQ("", checkpoint.GetState("hls:other.m3u8"));
+}
+
+TEST_F(ManifestCheckpointTest, MaybeWriteWaitsForInterval) {
+  ManifestCheckpoint checkpoint(kCheckpointFile, kLongInterval);
+  checkpoint.SetState("key", "state1");
+  ASSERT_TRUE(checkpoint.MaybeWrite());
+  checkpoint.SetState("key", "state2");
+  ASSERT_TRUE(checkpoint.MaybeWrite());
+
+  ManifestCheckpoint loaded_checkpoint(kCheckpointFile, kNoInterval);
+  ASSERT_TRUE(loaded_checkpoint.Load());
+  EXPECT_EQ("state1", loaded_checkpoint.GetState("key"));
+
+  // Write() does not wait for the interval.
+  ASSERT_TRUE(checkpoint.Write());
+  ASSERT_TRUE(loaded_checkpoint.Load());
+  EXPECT_EQ("state2", loaded_checkpoint.GetState("key"));
+}
+
+TEST_F(ManifestCheckpointTest, LoadInvalidFile) {
+  ASSERT_TRUE(File::WriteStringToFile(kCheckpointFile, "not a checkpoint"));
+  ManifestCheckpoint checkpoint(kCheckpointFile, kNoInterval);
+  EXPECT_FALSE(checkpoint.Load());
+}
+
+TEST_F(ManifestCheckpointTest, LoadTruncatedFile) {
+  ASSERT_TRUE(File::WriteStringToFile(
+      kCheckpointFile, "shaka-packager-checkpoint 1\n3 10\nkeystate"));
+  ManifestCheckpoint checkpoint(kCheckpointFile, kNoInterval);
+  EXPECT_FALSE(checkpoint.Load());
+}
+
+}  // namespace shaka
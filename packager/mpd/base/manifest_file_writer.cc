@@ -0,0 +1,98 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/manifest_file_writer.h"
+
+#include <gflags/gflags.h>
+
+#include <functional>
+
+#include "packager/base/logging.h"
+#include "packager/base/time/time.h"
+#include "packager/file/file.h"
+#include "packager/media/base/gzip_util.h"
+#include "packager/media/base/metrics.h"
+
+DEFINE_double(manifest_write_latency_budget,
+              0,
+              "Budget, in seconds, for writing a manifest. A warning is "
+              "logged for every manifest write taking longer than the budget. "
+              "Disabled if it is not positive.");
+
+DEFINE_bool(manifest_gzip_variant,
+            false,
+            "Also write every manifest compressed with gzip, to the manifest "
+            "path with a '.gz' suffix, so that origin servers can serve the "
+            "compressed manifest without compressing it on every request.");
+
+namespace shaka {
+
+ManifestFileWriter::ManifestFileWriter() {}
+
+ManifestFileWriter::~ManifestFileWriter() {}
+
+bool ManifestFileWriter::Write(const std::string& file_path,
+                               const std::string& content) {
+  const size_t content_hash = std::hash<std::string>()(content);
+  auto iter = content_hashes_.find(file_path);
+  if (iter != content_hashes_.end() && iter->second == content_hash) {
+    media::Metrics::GetInstance()->IncrementCounter(
+        "packager_manifest_writes_skipped_total",
+        "Number of manifest writes skipped as the manifest did not change.",
+        media::MetricLabel("manifest", file_path));
+    return true;
+  }
+
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  const bool result =
+      File::WriteFileAtomically(file_path.c_str(), content) &&
+      (!FLAGS_manifest_gzip_variant || WriteGzipVariant(file_path, content));
+  const base::TimeDelta latency = base::TimeTicks::Now() - start_time;
+  media::Metrics::GetInstance()->ObserveLatency(
+      "packager_manifest_write_seconds", "Time spent writing manifests.",
+      media::MetricLabel("manifest", file_path), latency);
+  if (FLAGS_manifest_write_latency_budget > 0 &&
+      latency.InSecondsF() > FLAGS_manifest_write_latency_budget) {
+    LOG(WARNING) << "Writing manifest " << file_path << " took "
+                 << latency.InSecondsF() << " seconds, exceeding the budget of "
+                 << FLAGS_manifest_write_latency_budget << " seconds.";
+    media::Metrics::GetInstance()->IncrementCounter(
+        "packager_manifest_writes_over_budget_total",
+        "Number of manifest writes exceeding the latency budget.",
+        media::MetricLabel("manifest", file_path));
+  }
+
+  if (!result) {
+    LOG(ERROR) << "Failed to write manifest to: " << file_path;
+    content_hashes_.erase(file_path);
+    return false;
+  }
+  content_hashes_[file_path] = content_hash;
+  return true;
+}
+
+bool ManifestFileWriter::WriteGzipVariant(const std::string& file_path,
+                                          const std::string& content) {
+  if (!gzip_compressor_) {
+    // Manifests are compressed once and served many times, so the best
+    // compression is worth its cost.
+    gzip_compressor_.reset(
+        new media::GzipCompressor(media::GzipCompressor::kBestCompression));
+  }
+  if (!gzip_compressor_->Compress(content, &gzip_output_)) {
+    LOG(ERROR) << "Failed to compress manifest " << file_path;
+    return false;
+  }
+
+  const std::string gzip_file_path = file_path + ".gz";
+  if (!File::WriteFileAtomically(gzip_file_path.c_str(), gzip_output_)) {
+    LOG(ERROR) << "Failed to write manifest to: " << gzip_file_path;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace shaka
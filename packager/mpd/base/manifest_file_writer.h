@@ -0,0 +1,58 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MPD_BASE_MANIFEST_FILE_WRITER_H_
+#define MPD_BASE_MANIFEST_FILE_WRITER_H_
+
+#include <map>
+#include <memory>
+#include <string>
+
+namespace shaka {
+
+namespace media {
+class GzipCompressor;
+}  // namespace media
+
+/// Writes manifests to files atomically. A write is skipped if the file was
+/// last written with identical content by this object, e.g. when a key frame
+/// or an encryption update with the same key does not change the manifest,
+/// which saves a request to the origin server for HTTP outputs. The write
+/// latency is recorded and a warning is logged if it exceeds
+/// --manifest_write_latency_budget. With --manifest_gzip_variant, every
+/// manifest is also written compressed with gzip to "<file>.gz", so that
+/// origin servers can serve it without compressing it on every request. This
+/// is not thread safe; callers are expected to synchronize the calls.
+class ManifestFileWriter {
+ public:
+  ManifestFileWriter();
+  ~ManifestFileWriter();
+
+  /// Writes @a content to @a file_path atomically, unless the content did not
+  /// change since the last write to @a file_path.
+  /// @return true on success or if the write is skipped, false otherwise.
+  bool Write(const std::string& file_path, const std::string& content);
+
+ private:
+  ManifestFileWriter(const ManifestFileWriter&) = delete;
+  ManifestFileWriter& operator=(const ManifestFileWriter&) = delete;
+
+  // Writes |content| compressed with gzip to |file_path| + ".gz".
+  bool WriteGzipVariant(const std::string& file_path,
+                        const std::string& content);
+
+  // File path => hash of the content last written to the file. Only hashes
+  // are kept so that large manifests are not held in memory twice.
+  std::map<std::string, size_t> content_hashes_;
+  // The compressor and its output buffer are reused across the writes, so
+  // that they are only allocated once. Only set with --manifest_gzip_variant.
+  std::unique_ptr<media::GzipCompressor> gzip_compressor_;
+  std::string gzip_output_;
+};
+
+}  // namespace shaka
+
+#endif  // MPD_BASE_MANIFEST_FILE_WRITER_H_
@@ -0,0 +1,97 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/manifest_file_writer.h"
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include "packager/file/file.h"
+#include "packager/file/memory_file.h"
+#include "packager/media/base/gzip_util.h"
+
+DECLARE_bool(manifest_gzip_variant);
+
+namespace shaka {
+
+namespace {
+const char kManifestPath1[] = "memory://manifest1.mpd";
+const char kManifestPath2[] = "memory://manifest2.m3u8";
+
+std::string GzipDecompress(const std::string& input) {
+  std::string output;
+  EXPECT_TRUE(media::GzipDecompress(input, &output));
+  return output;
+}
+}  // namespace
+
+class ManifestFileWriterTest : public ::testing::Test {
+ protected:
+  void TearDown() override { MemoryFile::DeleteAll(); }
+
+  bool FileExists(const char* file_path) {
+    std::string content;
+    return File::ReadFileToString(file_path, &content);
+  }
+
+  std::string ReadFile(const char* file_path) {
+    std::string content;
+    EXPECT_TRUE(File::ReadFileToString(file_path, &content));
+    return content;
+  }
+
+  ManifestFileWriter writer_;
+};
+
+TEST_F(ManifestFileWriterTest, Write) {
+  ASSERT_TRUE(writer_.Write(kManifestPath1, "content1"));
+  ASSERT_TRUE(writer_.Write(kManifestPath2, "content2"));
+  EXPECT_EQ("content1", ReadFile(kManifestPath1));
+  EXPECT_EQ("content2", ReadFile(kManifestPath2));
+
+  ASSERT_TRUE(writer_.Write(kManifestPath1, "content3"));
+  EXPECT_EQ("content3", ReadFile(kManifestPath1));
+}
+
+TEST_F(ManifestFileWriterTest, SkipUnchangedContent) {
+  ASSERT_TRUE(writer_.Write(kManifestPath1, "content1"));
+  // Deleting the file shows whether the next write is skipped.
+  ASSERT_TRUE(File::Delete(kManifestPath1));
+  ASSERT_TRUE(writer_.Write(kManifestPath1, "content1"));
+  EXPECT_FALSE(FileExists(kManifestPath1));
+
+  // The same content is still written to other files.
+  ASSERT_TRUE(writer_.Write(kManifestPath2, "content1"));
+  EXPECT_EQ("content1", ReadFile(kManifestPath2));
+
+  ASSERT_TRUE(writer_.Write(kManifestPath1, "content2"));
+  EXPECT_EQ("content2", ReadFile(kManifestPath1));
+}
+
+TEST_F(ManifestFileWriterTest, WriteFailure) {
+  const char kInvalidPath[] = "/non_existent_dir/manifest.mpd";
+  EXPECT_FALSE(writer_.Write(kInvalidPath, "content"));
+  // A failed write is not skipped when retried.
+  EXPECT_FALSE(writer_.Write(kInvalidPath, "content"));
+}
+
+TEST_F(ManifestFileWriterTest, GzipVariant) {
+  FLAGS_manifest_gzip_variant = true;
+  const std::string kGzipPath1 = std::string(kManifestPath1) + ".gz";
+  ASSERT_TRUE(writer_.Write(kManifestPath1, "content1"));
+  ASSERT_TRUE(writer_.Write(kManifestPath2, "content2"));
+  EXPECT_EQ("content1", ReadFile(kManifestPath1));
+  EXPECT_EQ("content1", GzipDecompress(ReadFile(kGzipPath1.c_str())));
+
+  // The compressor is reused for the next writes.
+  ASSERT_TRUE(writer_.Write(kManifestPath1, "content3"));
+  EXPECT_EQ("content3", GzipDecompress(ReadFile(kGzipPath1.c_str())));
+  const std::string kGzipPath2 = std::string(kManifestPath2) + ".gz";
+  EXPECT_EQ("content2", GzipDecompress(ReadFile(kGzipPath2.c_str())));
+  FLAGS_manifest_gzip_variant = false;
+}
+
+}  // namespace shaka
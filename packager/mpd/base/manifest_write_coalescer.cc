@@ -0,0 +1,38 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/manifest_write_coalescer.h"
+
+#include "packager/base/time/default_clock.h"
+
+namespace shaka {
+
+ManifestWriteCoalescer::ManifestWriteCoalescer(double window_in_seconds)
+    : window_(base::TimeDelta::FromSecondsD(
+          window_in_seconds > 0 ? window_in_seconds : 0)),
+      clock_(new base::DefaultClock()) {}
+
+ManifestWriteCoalescer::~ManifestWriteCoalescer() {}
+
+void ManifestWriteCoalescer::AddStream(uint32_t stream_id) {
+  streams_.insert(stream_id);
+}
+
+bool ManifestWriteCoalescer::OnStreamUpdated(uint32_t stream_id) {
+  updated_streams_.insert(stream_id);
+  if (window_.is_zero() || last_write_time_.is_null())
+    return true;
+  if (updated_streams_.size() >= streams_.size())
+    return true;
+  return clock_->Now() - last_write_time_ >= window_;
+}
+
+void ManifestWriteCoalescer::OnManifestWritten() {
+  updated_streams_.clear();
+  last_write_time_ = clock_->Now();
+}
+
+}  // namespace shaka
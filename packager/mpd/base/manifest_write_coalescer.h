@@ -0,0 +1,68 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MPD_BASE_MANIFEST_WRITE_COALESCER_H_
+#define MPD_BASE_MANIFEST_WRITE_COALESCER_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <set>
+
+#include "packager/base/time/clock.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+
+/// Coalesces the manifest write requests of the streams described by a single
+/// manifest. A manifest is written once every stream has reported an update
+/// since the previous write, or once the coalescing window has elapsed since
+/// the previous write, whichever comes first. This is not thread safe; callers
+/// are expected to synchronize the calls.
+class ManifestWriteCoalescer {
+ public:
+  /// @param window_in_seconds is the coalescing window. Every update results
+  ///        in a write if it is not positive.
+  explicit ManifestWriteCoalescer(double window_in_seconds);
+  ~ManifestWriteCoalescer();
+
+  /// Registers a stream described by the manifest.
+  void AddStream(uint32_t stream_id);
+
+  /// Records an update of the stream.
+  /// @return true if the manifest should be written now. The caller should
+  ///         call OnManifestWritten() after writing the manifest.
+  bool OnStreamUpdated(uint32_t stream_id);
+
+  /// Called after the manifest is written, either as a result of
+  /// OnStreamUpdated() or a forced flush.
+  void OnManifestWritten();
+
+  /// @return The streams updated since the previous write.
+  const std::set<uint32_t>& updated_streams() const {
+    return updated_streams_;
+  }
+
+  /// Testing only method to override the clock used for the window.
+  void InjectClockForTesting(std::unique_ptr<base::Clock> clock) {
+    clock_ = std::move(clock);
+  }
+
+ private:
+  ManifestWriteCoalescer(const ManifestWriteCoalescer&) = delete;
+  ManifestWriteCoalescer& operator=(const ManifestWriteCoalescer&) = delete;
+
+  const base::TimeDelta window_;
+  std::unique_ptr<base::Clock> clock_;
+  std::set<uint32_t> streams_;
+  std::set<uint32_t> updated_streams_;
+  // Null until the first write.
+  base::Time last_write_time_;
+};
+
+}  // namespace shaka
+
+#endif  // MPD_BASE_MANIFEST_WRITE_COALESCER_H_
@@ -0,0 +1,87 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/manifest_write_coalescer.h"
+
+#include <gtest/gtest.h>
+
+namespace shaka {
+
+namespace {
+
+const double kWindowInSeconds = 2.0;
+const uint32_t kStreamId1 = 1;
+const uint32_t kStreamId2 = 2;
+const uint32_t kStreamId3 = 3;
+
+// A clock which returns the time pointed to by |time|, which is owned by the
+// test, so the test can advance the time after injecting the clock.
+class TestClock : public base::Clock {
+ public:
+  explicit TestClock(const base::Time* time) : time_(time) {}
+  ~TestClock() override {}
+  base::Time Now() override { return *time_; }
+
+ private:
+  const base::Time* time_;
+};
+
+}  // namespace
+
+class ManifestWriteCoalescerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    now_ = base::Time::UnixEpoch() + base::TimeDelta::FromDays(1);
+    coalescer_.InjectClockForTesting(
+        std::unique_ptr<base::Clock>(new TestClock(&now_)));
+    coalescer_.AddStream(kStreamId1);
+    coalescer_.AddStream(kStreamId2);
+    coalescer_.AddStream(kStreamId3);
+  }
+
+  base::Time now_;
+  ManifestWriteCoalescer coalescer_{kWindowInSeconds};
+};
+
+TEST_F(ManifestWriteCoalescerTest, FirstUpdateIsWrittenImmediately) {
+  EXPECT_TRUE(coalescer_.OnStreamUpdated(kStreamId1));
+}
+
+TEST_F(ManifestWriteCoalescerTest, WritesWhenAllStreamsUpdated) {
+  coalescer_.OnManifestWritten();
+
+  EXPECT_FALSE(coalescer_.OnStreamUpdated(kStreamId1));
+  EXPECT_FALSE(coalescer_.OnStreamUpdated(kStreamId2));
+  // Repeated updates from the same stream are coalesced.
+  EXPECT_FALSE(coalescer_.OnStreamUpdated(kStreamId2));
+  EXPECT_EQ(2u, coalescer_.updated_streams().size());
+  EXPECT_TRUE(coalescer_.OnStreamUpdated(kStreamId3));
+
+  coalescer_.OnManifestWritten();
+  EXPECT_TRUE(coalescer_.updated_streams().empty());
+  EXPECT_FALSE(coalescer_.OnStreamUpdated(kStreamId1));
+}
+
+TEST_F(ManifestWriteCoalescerTest, WritesWhenWindowElapsed) {
+  coalescer_.OnManifestWritten();
+
+  now_ += base::TimeDelta::FromSecondsD(kWindowInSeconds / 2);
+  EXPECT_FALSE(coalescer_.OnStreamUpdated(kStreamId1));
+  now_ += base::TimeDelta::FromSecondsD(kWindowInSeconds / 2);
+  EXPECT_TRUE(coalescer_.OnStreamUpdated(kStreamId1));
+}
+
+TEST(ManifestWriteCoalescerNoWindowTest, WritesEveryUpdate) {
+  ManifestWriteCoalescer coalescer(0);
+  coalescer.AddStream(kStreamId1);
+  coalescer.AddStream(kStreamId2);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(coalescer.OnStreamUpdated(kStreamId1));
+    coalescer.OnManifestWritten();
+  }
+}
+
+}  // namespace shaka
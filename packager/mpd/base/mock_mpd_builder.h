@@ -77,6 +77,8 @@ class MockRepresentation : public Representation {
                void(const std::string& drm_uuid, const std::string& pssh));
   MOCK_METHOD3(AddNewSegment,
                void(int64_t start_time, int64_t duration, uint64_t size));
+  MOCK_CONST_METHOD0(GetCheckpointState, std::string());
+  MOCK_METHOD1(RestoreCheckpointState, bool(const std::string& state));
   MOCK_METHOD1(SetSampleDuration, void(uint32_t sample_duration));
   MOCK_CONST_METHOD0(GetMediaInfo, const MediaInfo&());
 };
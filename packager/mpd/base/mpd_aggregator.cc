@@ -0,0 +1,103 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/mpd_aggregator.h"
+
+#include <vector>
+
+#include "packager/base/logging.h"
+#include "packager/mpd/base/media_info.pb.h"
+#include "packager/mpd/base/mpd_notifier.h"
+
+namespace shaka {
+
+namespace {
+
+std::vector<uint8_t> ToVector(const std::string& bytes) {
+  return std::vector<uint8_t>(bytes.begin(), bytes.end());
+}
+
+}  // namespace
+
+MpdAggregator::MpdAggregator(MpdNotifier* notifier) : notifier_(notifier) {
+  DCHECK(notifier_);
+}
+
+MpdAggregator::~MpdAggregator() {}
+
+bool MpdAggregator::HandleEvents(const std::string& serialized_events) {
+  MpdNotifierEvents events;
+  if (!events.ParseFromString(serialized_events)) {
+    LOG(ERROR) << "Failed to parse the MPD notifications.";
+    return false;
+  }
+  base::AutoLock auto_lock(lock_);
+  uint64_t& last_sequence_number = last_sequence_numbers_[events.node_id()];
+  for (const MpdNotifierEvent& event : events.events()) {
+    if (event.has_sequence_number()) {
+      if (event.sequence_number() <= last_sequence_number)
+        continue;
+      // An event which fails is not handled again either.
+      last_sequence_number = event.sequence_number();
+    }
+    if (!HandleEvent(events.node_id(), event))
+      return false;
+  }
+  return notifier_->Flush();
+}
+
+bool MpdAggregator::HandleEvent(uint64_t node_id,
+                                const MpdNotifierEvent& event) {
+  const auto key = std::make_pair(node_id, event.container_id());
+  if (event.type() == MpdNotifierEvent::NEW_CONTAINER) {
+    const MediaInfo& media_info = event.media_info();
+    const std::string& name = media_info.has_segment_template()
+                                  ? media_info.segment_template()
+                                  : media_info.media_file_name();
+    auto iter = container_ids_by_name_.find(name);
+    if (iter != container_ids_by_name_.end()) {
+      VLOG(1) << "Continuing the container of " << name;
+      container_ids_[key] = iter->second;
+      return true;
+    }
+    uint32_t container_id = 0;
+    if (!notifier_->NotifyNewContainer(media_info, &container_id))
+      return false;
+    container_ids_[key] = container_id;
+    container_ids_by_name_[name] = container_id;
+    return true;
+  }
+
+  auto iter = container_ids_.find(key);
+  if (iter == container_ids_.end()) {
+    LOG(ERROR) << "Unknown container " << event.container_id()
+               << " of packager " << node_id;
+    return false;
+  }
+  const uint32_t container_id = iter->second;
+  switch (event.type()) {
+    case MpdNotifierEvent::SAMPLE_DURATION:
+      return notifier_->NotifySampleDuration(container_id,
+                                             event.sample_duration());
+    case MpdNotifierEvent::NEW_SEGMENT:
+      return notifier_->NotifyNewSegment(container_id, event.start_time(),
+                                         event.duration(), event.size());
+    case MpdNotifierEvent::CUE_EVENT:
+      return notifier_->NotifyCueEvent(container_id, event.timestamp());
+    case MpdNotifierEvent::ENCRYPTION_UPDATE:
+      return notifier_->NotifyEncryptionUpdate(
+          container_id, event.drm_uuid(), ToVector(event.key_id()),
+          ToVector(event.pssh()));
+    case MpdNotifierEvent::MEDIA_INFO_UPDATE:
+      return notifier_->NotifyMediaInfoUpdate(container_id,
+                                              event.media_info());
+    default:
+      LOG(ERROR) << "Unknown MPD notification type " << event.type();
+      return false;
+  }
+}
+
+}  // namespace shaka
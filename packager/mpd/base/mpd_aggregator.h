@@ -0,0 +1,64 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MPD_BASE_MPD_AGGREGATOR_H_
+#define PACKAGER_MPD_BASE_MPD_AGGREGATOR_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+
+class MpdNotifier;
+class MpdNotifierEvent;
+
+/// Generates a single MPD from the notifications of the RemoteMpdNotifiers of
+/// several packagers, by replaying them on a local MpdNotifier.
+///
+/// The containers are identified by their segment template, or their media
+/// file name, so that a restarted packager goes on with the Representations
+/// of its streams.
+///
+/// The notifications a packager sends again, e.g. after a lost response, are
+/// only handled once, see MpdNotifierEvent.sequence_number.
+class MpdAggregator {
+ public:
+  /// @param notifier generates the MPD. It is not owned and must outlive the
+  ///        aggregator.
+  explicit MpdAggregator(MpdNotifier* notifier);
+  ~MpdAggregator();
+
+  /// Replays the notifications of a packager, then flushes the MPD.
+  /// @param serialized_events is a serialized MpdNotifierEvents, as sent by
+  ///        RemoteMpdNotifier.
+  /// @return true on success, false otherwise.
+  bool HandleEvents(const std::string& serialized_events);
+
+ private:
+  MpdAggregator(const MpdAggregator&) = delete;
+  MpdAggregator& operator=(const MpdAggregator&) = delete;
+
+  bool HandleEvent(uint64_t node_id, const MpdNotifierEvent& event);
+
+  MpdNotifier* const notifier_;
+  // The events of different packagers are replayed one batch at a time.
+  base::Lock lock_;
+  // (node ID, container ID in the packager) => container ID in |notifier_|.
+  std::map<std::pair<uint64_t, uint32_t>, uint32_t> container_ids_;
+  // Segment template or media file name => container ID in |notifier_|.
+  std::map<std::string, uint32_t> container_ids_by_name_;
+  // Node ID => sequence number of the last event handled.
+  std::map<uint64_t, uint64_t> last_sequence_numbers_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_MPD_BASE_MPD_AGGREGATOR_H_
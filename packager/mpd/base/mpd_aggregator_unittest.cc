@@ -0,0 +1,239 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/mpd/base/mock_mpd_notifier.h"
+#include "packager/mpd/base/mpd_aggregator.h"
+#include "packager/mpd/base/mpd_options.h"
+#include "packager/mpd/base/remote_mpd_notifier.h"
+
+namespace shaka {
+
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::ElementsAre;
+using ::testing::InSequence;
+using ::testing::Property;
+using ::testing::Return;
+using ::testing::SetArgPointee;
+
+namespace {
+
+const uint32_t kAggregatedContainerId = 5;
+
+// Keeps the events instead of sending them.
+class TestRemoteMpdNotifier : public RemoteMpdNotifier {
+ public:
+  explicit TestRemoteMpdNotifier(const MpdOptions& mpd_options)
+      : RemoteMpdNotifier(mpd_options, "http://aggregator/") {}
+
+  using RemoteMpdNotifier::set_max_pending_events_for_testing;
+
+  std::vector<std::string> sent_events;
+  bool send_result = true;
+  // The events reach the aggregator, but the response is lost.
+  bool lose_responses = false;
+
+ protected:
+  bool SendEvents(const std::string& serialized_events) override {
+    if (send_result)
+      sent_events.push_back(serialized_events);
+    return send_result && !lose_responses;
+  }
+};
+
+MediaInfo GetMediaInfo(const std::string& segment_template) {
+  MediaInfo media_info;
+  media_info.mutable_video_info()->set_codec("avc1");
+  media_info.set_segment_template(segment_template);
+  return media_info;
+}
+
+}  // namespace
+
+class MpdAggregatorTest : public ::testing::Test {
+ protected:
+  MpdOptions mpd_options_;
+  MockMpdNotifier mock_notifier_{mpd_options_};
+  MpdAggregator aggregator_{&mock_notifier_};
+};
+
+TEST_F(MpdAggregatorTest, ReplaysNotifications) {
+  TestRemoteMpdNotifier remote_notifier(mpd_options_);
+  uint32_t container_id = 0;
+  ASSERT_TRUE(remote_notifier.NotifyNewContainer(
+      GetMediaInfo("video_$Number$.m4s"), &container_id));
+  ASSERT_TRUE(remote_notifier.NotifyNewSegment(container_id, 0, 100, 1000));
+  ASSERT_TRUE(remote_notifier.NotifyCueEvent(container_id, 100));
+  ASSERT_TRUE(remote_notifier.NotifyEncryptionUpdate(
+      container_id, "uuid", std::vector<uint8_t>{1, 2},
+      std::vector<uint8_t>{3}));
+  ASSERT_TRUE(remote_notifier.Flush());
+  ASSERT_EQ(1u, remote_notifier.sent_events.size());
+
+  InSequence s;
+  EXPECT_CALL(mock_notifier_,
+              NotifyNewContainer(Property(&MediaInfo::segment_template,
+                                          "video_$Number$.m4s"),
+                                 _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(kAggregatedContainerId), Return(true)));
+  EXPECT_CALL(mock_notifier_,
+              NotifyNewSegment(kAggregatedContainerId, 0, 100, 1000))
+      .WillOnce(Return(true));
+  EXPECT_CALL(mock_notifier_, NotifyCueEvent(kAggregatedContainerId, 100))
+      .WillOnce(Return(true));
+  EXPECT_CALL(mock_notifier_,
+              NotifyEncryptionUpdate(kAggregatedContainerId, "uuid",
+                                     ElementsAre(1, 2), ElementsAre(3)))
+      .WillOnce(Return(true));
+  EXPECT_CALL(mock_notifier_, Flush()).WillOnce(Return(true));
+  EXPECT_TRUE(aggregator_.HandleEvents(remote_notifier.sent_events[0]));
+}
+
+TEST_F(MpdAggregatorTest, ResendsAfterFailure) {
+  TestRemoteMpdNotifier remote_notifier(mpd_options_);
+  uint32_t container_id = 0;
+  ASSERT_TRUE(remote_notifier.NotifyNewContainer(
+      GetMediaInfo("video_$Number$.m4s"), &container_id));
+  remote_notifier.send_result = false;
+  EXPECT_FALSE(remote_notifier.Flush());
+
+  remote_notifier.send_result = true;
+  ASSERT_TRUE(remote_notifier.NotifyNewSegment(container_id, 0, 100, 1000));
+  ASSERT_TRUE(remote_notifier.Flush());
+  ASSERT_EQ(1u, remote_notifier.sent_events.size());
+
+  // The container is sent before the segment.
+  InSequence s;
+  EXPECT_CALL(mock_notifier_, NotifyNewContainer(_, _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(kAggregatedContainerId), Return(true)));
+  EXPECT_CALL(mock_notifier_,
+              NotifyNewSegment(kAggregatedContainerId, 0, 100, 1000))
+      .WillOnce(Return(true));
+  EXPECT_CALL(mock_notifier_, Flush()).WillOnce(Return(true));
+  EXPECT_TRUE(aggregator_.HandleEvents(remote_notifier.sent_events[0]));
+}
+
+TEST_F(MpdAggregatorTest, IgnoresEventsSentAgain) {
+  TestRemoteMpdNotifier remote_notifier(mpd_options_);
+  uint32_t container_id = 0;
+  ASSERT_TRUE(remote_notifier.NotifyNewContainer(
+      GetMediaInfo("video_$Number$.m4s"), &container_id));
+  ASSERT_TRUE(remote_notifier.NotifyNewSegment(container_id, 0, 100, 1000));
+  remote_notifier.lose_responses = true;
+  EXPECT_FALSE(remote_notifier.Flush());
+
+  remote_notifier.lose_responses = false;
+  ASSERT_TRUE(remote_notifier.NotifyNewSegment(container_id, 100, 100, 1000));
+  ASSERT_TRUE(remote_notifier.Flush());
+  ASSERT_EQ(2u, remote_notifier.sent_events.size());
+
+  InSequence s;
+  EXPECT_CALL(mock_notifier_, NotifyNewContainer(_, _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(kAggregatedContainerId), Return(true)));
+  EXPECT_CALL(mock_notifier_,
+              NotifyNewSegment(kAggregatedContainerId, 0, 100, 1000))
+      .WillOnce(Return(true));
+  EXPECT_CALL(mock_notifier_, Flush()).WillOnce(Return(true));
+  // Only the new segment is handled from the events sent again.
+  EXPECT_CALL(mock_notifier_,
+              NotifyNewSegment(kAggregatedContainerId, 100, 100, 1000))
+      .WillOnce(Return(true));
+  EXPECT_CALL(mock_notifier_, Flush()).WillOnce(Return(true));
+  EXPECT_TRUE(aggregator_.HandleEvents(remote_notifier.sent_events[0]));
+  EXPECT_TRUE(aggregator_.HandleEvents(remote_notifier.sent_events[1]));
+}
+
+TEST_F(MpdAggregatorTest, DropsOldestSegmentsWhenQueueIsFull) {
+  TestRemoteMpdNotifier remote_notifier(mpd_options_);
+  remote_notifier.set_max_pending_events_for_testing(3);
+  uint32_t container_id = 0;
+  ASSERT_TRUE(remote_notifier.NotifyNewContainer(
+      GetMediaInfo("video_$Number$.m4s"), &container_id));
+  for (uint64_t start_time = 0; start_time < 400; start_time += 100) {
+    ASSERT_TRUE(
+        remote_notifier.NotifyNewSegment(container_id, start_time, 100, 1000));
+  }
+  ASSERT_TRUE(remote_notifier.Flush());
+  ASSERT_EQ(1u, remote_notifier.sent_events.size());
+
+  // The container is kept.
+  InSequence s;
+  EXPECT_CALL(mock_notifier_, NotifyNewContainer(_, _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(kAggregatedContainerId), Return(true)));
+  EXPECT_CALL(mock_notifier_,
+              NotifyNewSegment(kAggregatedContainerId, 200, 100, 1000))
+      .WillOnce(Return(true));
+  EXPECT_CALL(mock_notifier_,
+              NotifyNewSegment(kAggregatedContainerId, 300, 100, 1000))
+      .WillOnce(Return(true));
+  EXPECT_CALL(mock_notifier_, Flush()).WillOnce(Return(true));
+  EXPECT_TRUE(aggregator_.HandleEvents(remote_notifier.sent_events[0]));
+}
+
+TEST_F(MpdAggregatorTest, MultiplePackagers) {
+  TestRemoteMpdNotifier remote_notifier1(mpd_options_);
+  TestRemoteMpdNotifier remote_notifier2(mpd_options_);
+  uint32_t container_id1 = 0;
+  uint32_t container_id2 = 0;
+  // Both packagers use the same container ID for different streams.
+  ASSERT_TRUE(remote_notifier1.NotifyNewContainer(
+      GetMediaInfo("video_1080p_$Number$.m4s"), &container_id1));
+  ASSERT_TRUE(remote_notifier2.NotifyNewContainer(
+      GetMediaInfo("video_720p_$Number$.m4s"), &container_id2));
+  ASSERT_EQ(container_id1, container_id2);
+  ASSERT_TRUE(remote_notifier1.NotifyNewSegment(container_id1, 0, 100, 2000));
+  ASSERT_TRUE(remote_notifier2.NotifyNewSegment(container_id2, 0, 100, 1000));
+  ASSERT_TRUE(remote_notifier1.Flush());
+  ASSERT_TRUE(remote_notifier2.Flush());
+
+  EXPECT_CALL(mock_notifier_, NotifyNewContainer(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(1), Return(true)))
+      .WillOnce(DoAll(SetArgPointee<1>(2), Return(true)));
+  EXPECT_CALL(mock_notifier_, NotifyNewSegment(1, 0, 100, 2000))
+      .WillOnce(Return(true));
+  EXPECT_CALL(mock_notifier_, NotifyNewSegment(2, 0, 100, 1000))
+      .WillOnce(Return(true));
+  EXPECT_CALL(mock_notifier_, Flush()).Times(2).WillRepeatedly(Return(true));
+  EXPECT_TRUE(aggregator_.HandleEvents(remote_notifier1.sent_events[0]));
+  EXPECT_TRUE(aggregator_.HandleEvents(remote_notifier2.sent_events[0]));
+}
+
+TEST_F(MpdAggregatorTest, RestartedPackager) {
+  TestRemoteMpdNotifier remote_notifier1(mpd_options_);
+  TestRemoteMpdNotifier remote_notifier2(mpd_options_);
+  uint32_t container_id = 0;
+  ASSERT_TRUE(remote_notifier1.NotifyNewContainer(
+      GetMediaInfo("video_$Number$.m4s"), &container_id));
+  ASSERT_TRUE(remote_notifier1.Flush());
+  ASSERT_TRUE(remote_notifier2.NotifyNewContainer(
+      GetMediaInfo("video_$Number$.m4s"), &container_id));
+  ASSERT_TRUE(remote_notifier2.NotifyNewSegment(container_id, 100, 100, 1000));
+  ASSERT_TRUE(remote_notifier2.Flush());
+
+  // The stream goes on in the same container.
+  EXPECT_CALL(mock_notifier_, NotifyNewContainer(_, _))
+      .WillOnce(
+          DoAll(SetArgPointee<1>(kAggregatedContainerId), Return(true)));
+  EXPECT_CALL(mock_notifier_,
+              NotifyNewSegment(kAggregatedContainerId, 100, 100, 1000))
+      .WillOnce(Return(true));
+  EXPECT_CALL(mock_notifier_, Flush()).Times(2).WillRepeatedly(Return(true));
+  EXPECT_TRUE(aggregator_.HandleEvents(remote_notifier1.sent_events[0]));
+  EXPECT_TRUE(aggregator_.HandleEvents(remote_notifier2.sent_events[0]));
+}
+
+TEST_F(MpdAggregatorTest, InvalidEvents) {
+  EXPECT_FALSE(aggregator_.HandleEvents("invalid"));
+}
+
+}  // namespace shaka
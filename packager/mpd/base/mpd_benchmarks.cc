@@ -0,0 +1,140 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Benchmarks of the dynamic MPD generation, i.e. MpdBuilder::ToString() and
+// the MPD write, as the number of Representations, Periods and segments
+// grows. SimpleMpdNotifier is driven with synthetic timelines, then the
+// time and the number of allocations per flush are reported in the format of
+// testing/perf/perf_test.h, so they can be compared across versions.
+//
+// Run from the packager repository root, e.g.
+//   out/Release/mpd_benchmarks --gtest_filter=MpdBenchmark.*
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/time/time.h"
+#include "packager/mpd/base/media_info.pb.h"
+#include "packager/mpd/base/mpd_options.h"
+#include "packager/mpd/base/simple_mpd_notifier.h"
+#include "packager/mpd/test/allocation_counter.h"
+#include "packager/testing/perf/perf_test.h"
+
+namespace shaka {
+namespace {
+
+const char kMpdOutput[] = "memory://benchmark.mpd";
+const uint32_t kTimeScale = 90000;
+const uint64_t kSegmentDuration = 2 * kTimeScale;
+const uint64_t kSegmentSize = 500000;
+// A cue, i.e. a new Period, every this many segments with cues.
+const size_t kSegmentsPerPeriod = 150;
+const size_t kNumFlushes = 10;
+
+const size_t kNumRepresentations[] = {1, 10, 50};
+const size_t kNumSegments[] = {100, 1000, 10000, 100000};
+
+MediaInfo GetVideoMediaInfo(size_t representation) {
+  MediaInfo media_info;
+  MediaInfo::VideoInfo* video_info = media_info.mutable_video_info();
+  video_info->set_codec("avc1.64001f");
+  video_info->set_width(1280);
+  video_info->set_height(720);
+  video_info->set_time_scale(kTimeScale);
+  video_info->set_frame_duration(3000);
+  video_info->set_pixel_width(1);
+  video_info->set_pixel_height(1);
+  media_info.set_container_type(MediaInfo::CONTAINER_MP4);
+  media_info.set_reference_time_scale(kTimeScale);
+  media_info.set_bandwidth(1000000 * (representation + 1));
+  media_info.set_init_segment_name(
+      base::StringPrintf("video_%zu_init.mp4", representation));
+  media_info.set_segment_template(
+      base::StringPrintf("video_%zu_$Number$.m4s", representation));
+  return media_info;
+}
+
+// The segment durations vary slightly, as with real encoders, so that the
+// SegmentTimelines have an S element per segment at worst.
+uint64_t GetSegmentDuration(size_t segment) {
+  return kSegmentDuration + (segment % 3) * 3000;
+}
+
+}  // namespace
+
+class MpdBenchmark : public ::testing::Test {
+ protected:
+  void RunBenchmark(size_t num_representations,
+                    size_t num_segments,
+                    bool with_cues) {
+    MpdOptions mpd_options;
+    mpd_options.dash_profile = DashProfile::kLive;
+    mpd_options.mpd_type = MpdType::kDynamic;
+    mpd_options.mpd_params.mpd_output = kMpdOutput;
+    SimpleMpdNotifier notifier(mpd_options);
+    ASSERT_TRUE(notifier.Init());
+
+    std::vector<uint32_t> container_ids(num_representations);
+    for (size_t i = 0; i < num_representations; ++i) {
+      ASSERT_TRUE(
+          notifier.NotifyNewContainer(GetVideoMediaInfo(i), &container_ids[i]));
+    }
+    uint64_t start_time = 0;
+    size_t segment = 0;
+    auto add_segment = [&]() {
+      const uint64_t duration = GetSegmentDuration(segment);
+      for (uint32_t container_id : container_ids) {
+        if (with_cues && segment > 0 && segment % kSegmentsPerPeriod == 0)
+          ASSERT_TRUE(notifier.NotifyCueEvent(container_id, start_time));
+        ASSERT_TRUE(notifier.NotifyNewSegment(container_id, start_time,
+                                              duration, kSegmentSize));
+      }
+      start_time += duration;
+      ++segment;
+    };
+    while (segment < num_segments)
+      add_segment();
+
+    // A new segment for every Representation between the flushes, as in
+    // steady state.
+    base::TimeDelta flush_time;
+    uint64_t num_allocations = 0;
+    for (size_t i = 0; i < kNumFlushes; ++i) {
+      add_segment();
+      const uint64_t allocations_before = GetNumAllocations();
+      const base::TimeTicks flush_start = base::TimeTicks::Now();
+      ASSERT_TRUE(notifier.Flush());
+      flush_time += base::TimeTicks::Now() - flush_start;
+      num_allocations += GetNumAllocations() - allocations_before;
+    }
+
+    const std::string trace = base::StringPrintf(
+        "%zu_representations_%zu_segments%s", num_representations,
+        num_segments, with_cues ? "_cues" : "");
+    perf_test::PrintResult("mpd_flush_time", "", trace,
+                           flush_time.InMillisecondsF() / kNumFlushes, "ms",
+                           true);
+    perf_test::PrintResult(
+        "mpd_flush_allocations", "", trace,
+        static_cast<size_t>(num_allocations / kNumFlushes), "allocations",
+        true);
+  }
+};
+
+TEST_F(MpdBenchmark, Flush) {
+  for (size_t num_representations : kNumRepresentations) {
+    for (size_t num_segments : kNumSegments) {
+      RunBenchmark(num_representations, num_segments, false);
+      RunBenchmark(num_representations, num_segments, true);
+    }
+  }
+}
+
+}  // namespace shaka
@@ -6,6 +6,8 @@
 
 #include "packager/mpd/base/mpd_builder.h"
 
+#include <string.h>
+
 #include <algorithm>
 
 #include "packager/base/files/file_path.h"
@@ -13,9 +15,9 @@
 #include "packager/base/optional.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/stringprintf.h"
-#include "packager/base/synchronization/lock.h"
 #include "packager/base/time/default_clock.h"
 #include "packager/base/time/time.h"
+#include "packager/file/file.h"
 #include "packager/media/base/rcheck.h"
 #include "packager/mpd/base/adaptation_set.h"
 #include "packager/mpd/base/mpd_utils.h"
@@ -30,6 +32,9 @@ using xml::XmlNode;
 
 namespace {
 
+// MPD@id, which MPD patches refer to. There is a single MPD per packager.
+const char kMpdId[] = "mpd";
+
 bool AddMpdNameSpaceInfo(XmlNode* mpd) {
   DCHECK(mpd);
 
@@ -73,6 +78,25 @@ bool Positive(double d) {
   return d > 0.0;
 }
 
+bool IsMpdPatchEnabled(const MpdOptions& mpd_options) {
+  return mpd_options.mpd_type == MpdType::kDynamic &&
+         !mpd_options.mpd_params.mpd_patch_output.empty();
+}
+
+// Returns the directory of the MPD at |mpd_path|, ending with a separator, or
+// an empty path if |mpd_path| is empty.
+FilePath GetMpdDirectory(const std::string& mpd_path) {
+  const std::string kFileProtocol("file://");
+  std::string mpd_file_path = (mpd_path.find(kFileProtocol) == 0)
+                                  ? mpd_path.substr(kFileProtocol.size())
+                                  : mpd_path;
+  if (mpd_file_path.empty())
+    return FilePath();
+  return FilePath::FromUTF8Unsafe(mpd_file_path)
+      .DirName()
+      .AsEndingWithSeparator();
+}
+
 // Return current time in XML DateTime format. The value is in UTC, so the
 // string ends with a 'Z'.
 std::string XmlDateTimeNowWithOffset(
@@ -97,7 +121,13 @@ bool SetIfPositive(const char* attr_name, double value, XmlNode* mpd) {
 std::string MakePathRelative(const std::string& media_path,
                              const FilePath& parent_path) {
   FilePath relative_path;
-  const FilePath child_path = FilePath::FromUTF8Unsafe(media_path);
+  // Outputs written with direct I/O are referred to by their path.
+  const size_t prefix_size =
+      media_path.compare(0, strlen(kDirectFilePrefix), kDirectFilePrefix) == 0
+          ? strlen(kDirectFilePrefix)
+          : 0;
+  const FilePath child_path =
+      FilePath::FromUTF8Unsafe(media_path.substr(prefix_size));
   const bool is_child =
       parent_path.AppendRelativePath(child_path, &relative_path);
   if (!is_child)
@@ -105,32 +135,6 @@ std::string MakePathRelative(const std::string& media_path,
   return relative_path.NormalizePathSeparatorsTo('/').AsUTF8Unsafe();
 }
 
-// Spooky static initialization/cleanup of libxml.
-class LibXmlInitializer {
- public:
-  LibXmlInitializer() : initialized_(false) {
-    base::AutoLock lock(lock_);
-    if (!initialized_) {
-      xmlInitParser();
-      initialized_ = true;
-    }
-  }
-
-  ~LibXmlInitializer() {
-    base::AutoLock lock(lock_);
-    if (initialized_) {
-      xmlCleanupParser();
-      initialized_ = false;
-    }
-  }
-
- private:
-  base::Lock lock_;
-  bool initialized_;
-
-  DISALLOW_COPY_AND_ASSIGN(LibXmlInitializer);
-};
-
 }  // namespace
 
 MpdBuilder::MpdBuilder(const MpdOptions& mpd_options)
@@ -158,7 +162,6 @@ Period* MpdBuilder::GetOrCreatePeriod(double start_time_in_seconds) {
 
 bool MpdBuilder::ToString(std::string* output) {
   DCHECK(output);
-  static LibXmlInitializer lib_xml_initializer;
 
   auto mpd = GenerateMpd();
   if (!mpd)
@@ -171,6 +174,13 @@ bool MpdBuilder::ToString(std::string* output) {
                            GetPackagerProjectUrl().c_str(), version.c_str());
   }
   *output = mpd->ToString(version);
+
+  if (IsMpdPatchEnabled(mpd_options_)) {
+    patch_.clear();
+    if (previous_mpd_ && !GeneratePatch(*previous_mpd_, *mpd, &patch_))
+      return false;
+    previous_mpd_ = std::move(mpd);
+  }
   return true;
 }
 
@@ -186,6 +196,10 @@ base::Optional<xml::XmlNode> MpdBuilder::GenerateMpd() {
       return base::nullopt;
   }
 
+  // Must be after BaseURL and before Period elements.
+  if (!AddPatchLocation(&mpd))
+    return base::nullopt;
+
   bool output_period_duration = false;
   if (mpd_options_.mpd_type == MpdType::kStatic) {
     UpdatePeriodDurationAndPresentationTimestamp();
@@ -275,6 +289,9 @@ bool MpdBuilder::AddDynamicMpdInfo(XmlNode* mpd_node) {
   static const char kDynamicMpdType[] = "dynamic";
   RCHECK(mpd_node->SetStringAttribute("type", kDynamicMpdType));
 
+  if (IsMpdPatchEnabled(mpd_options_))
+    RCHECK(mpd_node->SetStringAttribute("id", kMpdId));
+
   // No offset from NOW.
   RCHECK(mpd_node->SetStringAttribute(
       "publishTime", XmlDateTimeNowWithOffset(0, clock_.get())));
@@ -314,6 +331,51 @@ bool MpdBuilder::AddDynamicMpdInfo(XmlNode* mpd_node) {
                        mpd_node);
 }
 
+bool MpdBuilder::AddPatchLocation(XmlNode* mpd_node) {
+  DCHECK(mpd_node);
+  if (!IsMpdPatchEnabled(mpd_options_))
+    return true;
+
+  const std::string& patch_output = mpd_options_.mpd_params.mpd_patch_output;
+  const FilePath mpd_dir = GetMpdDirectory(mpd_options_.mpd_params.mpd_output);
+  XmlNode patch_location("PatchLocation");
+  patch_location.SetContent(mpd_dir.empty()
+                                ? patch_output
+                                : MakePathRelative(patch_output, mpd_dir));
+  return mpd_node->AddChild(std::move(patch_location));
+}
+
+bool MpdBuilder::GeneratePatch(const XmlNode& original,
+                               const XmlNode& mpd,
+                               std::string* patch) {
+  std::string original_publish_time;
+  std::string publish_time;
+  RCHECK(original.GetAttribute("publishTime", &original_publish_time));
+  RCHECK(mpd.GetAttribute("publishTime", &publish_time));
+
+  static const char kMpdPatchNamespace[] =
+      "urn:mpeg:dash:schema:mpd-patch:2020";
+  static const char kXmlNamespaceXsi[] =
+      "http://www.w3.org/2001/XMLSchema-instance";
+  static const char kDashSchemaMpdPatch2020[] =
+      "urn:mpeg:dash:schema:mpd-patch:2020 DASH-MPD-PATCH.xsd";
+
+  // Clients apply the patch only to the MPD with |originalPublishTime|, and
+  // fetch the full MPD otherwise.
+  XmlNode patch_node("Patch");
+  RCHECK(patch_node.SetStringAttribute("xmlns", kMpdPatchNamespace));
+  RCHECK(patch_node.SetStringAttribute("xmlns:xsi", kXmlNamespaceXsi));
+  RCHECK(patch_node.SetStringAttribute("xsi:schemaLocation",
+                                       kDashSchemaMpdPatch2020));
+  RCHECK(patch_node.SetStringAttribute("mpdId", kMpdId));
+  RCHECK(patch_node.SetStringAttribute("originalPublishTime",
+                                       original_publish_time));
+  RCHECK(patch_node.SetStringAttribute("publishTime", publish_time));
+  mpd.AddPatchOperations(original, &patch_node);
+  *patch = patch_node.ToString("");
+  return true;
+}
+
 bool MpdBuilder::AddUtcTiming(XmlNode* mpd_node) {
   DCHECK(mpd_node);
   DCHECK_EQ(MpdType::kDynamic, mpd_options_.mpd_type);
@@ -415,28 +477,19 @@ void MpdBuilder::UpdatePeriodDurationAndPresentationTimestamp() {
 void MpdBuilder::MakePathsRelativeToMpd(const std::string& mpd_path,
                                         MediaInfo* media_info) {
   DCHECK(media_info);
-  const std::string kFileProtocol("file://");
-  std::string mpd_file_path = (mpd_path.find(kFileProtocol) == 0)
-                                  ? mpd_path.substr(kFileProtocol.size())
-                                  : mpd_path;
-
-  if (!mpd_file_path.empty()) {
-    const FilePath mpd_dir(FilePath::FromUTF8Unsafe(mpd_file_path)
-                               .DirName()
-                               .AsEndingWithSeparator());
-    if (!mpd_dir.empty()) {
-      if (media_info->has_media_file_name()) {
-        media_info->set_media_file_url(
-            MakePathRelative(media_info->media_file_name(), mpd_dir));
-      }
-      if (media_info->has_init_segment_name()) {
-        media_info->set_init_segment_url(
-            MakePathRelative(media_info->init_segment_name(), mpd_dir));
-      }
-      if (media_info->has_segment_template()) {
-        media_info->set_segment_template_url(
-            MakePathRelative(media_info->segment_template(), mpd_dir));
-      }
+  const FilePath mpd_dir = GetMpdDirectory(mpd_path);
+  if (!mpd_dir.empty()) {
+    if (media_info->has_media_file_name()) {
+      media_info->set_media_file_url(
+          MakePathRelative(media_info->media_file_name(), mpd_dir));
+    }
+    if (media_info->has_init_segment_name()) {
+      media_info->set_init_segment_url(
+          MakePathRelative(media_info->init_segment_name(), mpd_dir));
+    }
+    if (media_info->has_segment_template()) {
+      media_info->set_segment_template_url(
+          MakePathRelative(media_info->segment_template(), mpd_dir));
     }
   }
 }
@@ -5,14 +5,10 @@
 // https://developers.google.com/open-source/licenses/bsd
 //
 /// All the methods that are virtual are virtual for mocking.
-/// NOTE: Inclusion of this module will cause xmlInitParser and xmlCleanupParser
-///       to be called at static initialization / deinitialization time.
 
 #ifndef MPD_BASE_MPD_BUILDER_H_
 #define MPD_BASE_MPD_BUILDER_H_
 
-#include <libxml/tree.h>
-
 #include <list>
 #include <memory>
 #include <string>
@@ -58,6 +54,12 @@ class MpdBuilder {
   // TODO(kqyang): Handle file IO in this class as in HLS media_playlist?
   virtual bool ToString(std::string* output) WARN_UNUSED_RESULT;
 
+  /// @return the MPD Patch which turns the MPD written by the previous
+  ///         ToString() call into the one written by the last call, or an
+  ///         empty string if there is none, e.g. if
+  ///         MpdParams.mpd_patch_output is not set.
+  const std::string& patch() const { return patch_; }
+
   /// Adjusts the fields of MediaInfo so that paths are relative to the
   /// specified MPD path.
   /// @param mpd_path is the file path of the MPD file.
@@ -66,6 +68,18 @@ class MpdBuilder {
   static void MakePathsRelativeToMpd(const std::string& mpd_path,
                                      MediaInfo* media_info);
 
+  /// @return the @availabilityStartTime of the dynamic MPD, or an empty string
+  ///         if it is not determined yet.
+  const std::string& availability_start_time() const {
+    return availability_start_time_;
+  }
+
+  /// Sets the @availabilityStartTime of the dynamic MPD, e.g. to the one of a
+  /// previous run to resume from, instead of calculating it.
+  void set_availability_start_time(const std::string& availability_start_time) {
+    availability_start_time_ = availability_start_time;
+  }
+
   // Inject a |clock| that returns the current time.
   /// This is for testing.
   void InjectClockForTesting(std::unique_ptr<base::Clock> clock) {
@@ -98,6 +112,14 @@ class MpdBuilder {
   // Same as AddStaticMpdInfo() but for 'dynamic' MPDs.
   bool AddDynamicMpdInfo(xml::XmlNode* mpd_node) WARN_UNUSED_RESULT;
 
+  // Adds the PatchLocation element if MPD patches are enabled.
+  bool AddPatchLocation(xml::XmlNode* mpd_node) WARN_UNUSED_RESULT;
+
+  // Generates the Patch document which turns |original| into |mpd|.
+  bool GeneratePatch(const xml::XmlNode& original,
+                     const xml::XmlNode& mpd,
+                     std::string* patch) WARN_UNUSED_RESULT;
+
   // Add UTCTiming element if utc timing is provided.
   bool AddUtcTiming(xml::XmlNode* mpd_node) WARN_UNUSED_RESULT;
 
@@ -120,6 +142,11 @@ class MpdBuilder {
   std::list<std::string> base_urls_;
   std::string availability_start_time_;
 
+  // The last generated MPD, to generate the next patch from. Only kept if MPD
+  // patches are enabled.
+  base::Optional<xml::XmlNode> previous_mpd_;
+  std::string patch_;
+
   uint32_t period_counter_ = 0;
   uint32_t representation_counter_ = 0;
 
@@ -258,6 +258,34 @@ TEST_F(LiveMpdBuilderTest, MultiplePeriodCheckXmlTest) {
                                  "  <Period id=\"2\" start=\"PT8S\"/>\n"));
 }
 
+TEST_F(LiveMpdBuilderTest, MpdPatch) {
+  mutable_mpd_options()->mpd_params.mpd_output = "dash/live.mpd";
+  mutable_mpd_options()->mpd_params.mpd_patch_output = "dash/live_patch.mpd";
+  const double kPeriod1StartTimeSeconds = 0.0;
+  const double kPeriod2StartTimeSeconds = 3.1;
+  mpd_.GetOrCreatePeriod(kPeriod1StartTimeSeconds);
+
+  std::string mpd_doc;
+  ASSERT_TRUE(mpd_.ToString(&mpd_doc));
+  EXPECT_THAT(mpd_doc, HasSubstr(" type=\"dynamic\" id=\"mpd\""));
+  EXPECT_THAT(mpd_doc,
+              HasSubstr("  <PatchLocation>live_patch.mpd</PatchLocation>\n"
+                        "  <Period id=\"0\" start=\"PT0S\"/>\n"));
+  // There is no previous MPD to patch.
+  EXPECT_EQ("", mpd_.patch());
+
+  mpd_.GetOrCreatePeriod(kPeriod2StartTimeSeconds);
+  ASSERT_TRUE(mpd_.ToString(&mpd_doc));
+  EXPECT_THAT(mpd_.patch(),
+              HasSubstr(" mpdId=\"mpd\""
+                        " originalPublishTime=\"2016-01-11T15:10:24Z\""
+                        " publishTime=\"2016-01-11T15:10:24Z\">\n"
+                        "  <add sel=\"/MPD\">\n"
+                        "    <Period id=\"1\" start=\"PT3.1S\"/>\n"
+                        "  </add>\n"
+                        "</Patch>\n"));
+}
+
 // Check whether the attributes are set correctly for dynamic <MPD> element.
 // This test must use ASSERT_EQ for comparison because XmlEqual() cannot
 // handle namespaces correctly yet.
@@ -104,6 +104,13 @@ class MpdNotifier {
   /// forces a flush.
   virtual bool Flush() = 0;
 
+  /// Call this method to request a flush after the container is updated.
+  /// Unlike Flush(), implementations might coalesce the requests from
+  /// different containers into a single write.
+  /// @param container_id Container ID obtained from calling
+  ///        NotifyNewContainer().
+  virtual bool RequestFlush(uint32_t container_id) { return Flush(); }
+
   /// @return include_mspr_pro option flag
   bool include_mspr_pro() const { return mpd_options_.mpd_params.include_mspr_pro; }
 
@@ -8,12 +8,13 @@
 
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_util.h"
-#include "packager/file/file.h"
 #include "packager/mpd/base/mpd_utils.h"
 
 namespace shaka {
 
-bool WriteMpdToFile(const std::string& output_path, MpdBuilder* mpd_builder) {
+bool WriteMpdToFile(const std::string& output_path,
+                    MpdBuilder* mpd_builder,
+                    ManifestFileWriter* file_writer) {
   CHECK(!output_path.empty());
 
   std::string mpd;
@@ -21,12 +22,7 @@ bool WriteMpdToFile(const std::string& output_path, MpdBuilder* mpd_builder) {
     LOG(ERROR) << "Failed to write MPD to string.";
     return false;
   }
-
-  if (!File::WriteFileAtomically(output_path.c_str(), mpd)) {
-    LOG(ERROR) << "Failed to write mpd to: " << output_path;
-    return false;
-  }
-  return true;
+  return file_writer->Write(output_path, mpd);
 }
 
 ContentType GetContentType(const MediaInfo& media_info) {
@@ -14,6 +14,7 @@
 #include <vector>
 
 #include "packager/base/base64.h"
+#include "packager/mpd/base/manifest_file_writer.h"
 #include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/base/mpd_builder.h"
 
@@ -29,7 +30,11 @@ enum ContentType {
 /// Outputs MPD to @a output_path.
 /// @param output_path is the path to the MPD output location.
 /// @param mpd_builder is the MPD builder instance.
-bool WriteMpdToFile(const std::string& output_path, MpdBuilder* mpd_builder);
+/// @param file_writer writes the MPD, skipping the write if the MPD did not
+///        change since it last wrote @a output_path.
+bool WriteMpdToFile(const std::string& output_path,
+                    MpdBuilder* mpd_builder,
+                    ManifestFileWriter* file_writer);
 
 /// Determines the content type of |media_info|.
 /// @param media_info is the information about the media.
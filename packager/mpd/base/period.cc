@@ -131,6 +131,16 @@ base::Optional<xml::XmlNode> Period::GetXml(bool output_period_duration) {
         return adaptation_set_a->id() < adaptation_set_b->id();
       });
 
+  uint64_t xml_version = adaptation_sets_.size();
+  for (const auto& adaptation_set : adaptation_sets_)
+    xml_version += adaptation_set->GetXmlVersion();
+  const bool unchanged =
+      last_xml_version_ == xml_version &&
+      last_output_period_duration_ == output_period_duration &&
+      last_duration_seconds_ == duration_seconds_;
+  if (unchanged && cached_xml_)
+    return cached_xml_->Clone();
+
   xml::XmlNode period("Period");
 
   // Required for 'dynamic' MPDs.
@@ -154,6 +164,16 @@ base::Optional<xml::XmlNode> Period::GetXml(bool output_period_duration) {
       return base::nullopt;
     }
   }
+
+  last_xml_version_ = xml_version;
+  last_output_period_duration_ = output_period_duration;
+  last_duration_seconds_ = duration_seconds_;
+  // Only keep a copy once the Period stops changing, so that the active Period,
+  // which changes on every call, is not copied needlessly.
+  if (unchanged)
+    cached_xml_.emplace(period.Clone());
+  else
+    cached_xml_.reset();
   return period;
 }
 
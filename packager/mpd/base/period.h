@@ -44,6 +44,9 @@ class Period {
       bool content_protection_in_adaptation_set);
 
   /// Generates <Period> xml element with its child AdaptationSet elements.
+  /// The element of a Period that did not change since the previous call,
+  /// e.g. a closed Period of a multi-period live presentation, is kept and
+  /// returned as a copy until the Period changes again.
   /// @return On success returns a non-NULL scoped_xml_ptr. Otherwise returns a
   ///         NULL scoped_xml_ptr.
   base::Optional<xml::XmlNode> GetXml(bool output_period_duration);
@@ -160,6 +163,15 @@ class Period {
         protected_content_map_;
   };
   ProtectedAdaptationSetMap protected_adaptation_set_map_;
+
+  // The sum of the AdaptationSet versions seen by the last GetXml() call and
+  // its parameters. Used to detect whether the Period has changed since.
+  base::Optional<uint64_t> last_xml_version_;
+  bool last_output_period_duration_ = false;
+  double last_duration_seconds_ = 0;
+  // The element generated by the last GetXml() call, if the Period did not
+  // change between the last two calls.
+  base::Optional<xml::XmlNode> cached_xml_;
 };
 
 }  // namespace shaka
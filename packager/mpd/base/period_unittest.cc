@@ -173,6 +173,57 @@ TEST_F(PeriodTest, DynamicMpdGetXml) {
               XmlNodeEqual(kExpectedXml));
 }
 
+// The element of an unchanged Period is reused, but any change to the Period
+// must still be reflected in the element.
+TEST_F(PeriodTest, GetXmlOfUnchangedPeriod) {
+  const char kVideoMediaInfo[] =
+      "video_info {\n"
+      "  codec: 'avc1'\n"
+      "  width: 1280\n"
+      "  height: 720\n"
+      "  time_scale: 10\n"
+      "  frame_duration: 10\n"
+      "  pixel_width: 1\n"
+      "  pixel_height: 1\n"
+      "}\n"
+      "container_type: 1\n";
+  mpd_options_.mpd_type = MpdType::kDynamic;
+
+  EXPECT_CALL(testable_period_, NewAdaptationSet(_, _, _))
+      .WillOnce(Return(ByMove(std::move(default_adaptation_set_))));
+
+  ASSERT_EQ(default_adaptation_set_ptr_,
+            testable_period_.GetOrCreateAdaptationSet(
+                ConvertToMediaInfo(kVideoMediaInfo),
+                content_protection_in_adaptation_set_));
+
+  const char kExpectedXml[] =
+      "<Period id=\"9\" start=\"PT5.6S\">"
+      "  <AdaptationSet contentType=\"\"/>"
+      "</Period>";
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_THAT(testable_period_.GetXml(!kOutputPeriodDuration),
+                XmlNodeEqual(kExpectedXml));
+  }
+
+  default_adaptation_set_ptr_->set_id(3);
+  const char kExpectedXmlWithId[] =
+      "<Period id=\"9\" start=\"PT5.6S\">"
+      "  <AdaptationSet id=\"3\" contentType=\"\"/>"
+      "</Period>";
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_THAT(testable_period_.GetXml(!kOutputPeriodDuration),
+                XmlNodeEqual(kExpectedXmlWithId));
+  }
+
+  const char kExpectedXmlWithDuration[] =
+      "<Period id=\"9\" duration=\"PT0S\">"
+      "  <AdaptationSet id=\"3\" contentType=\"\"/>"
+      "</Period>";
+  EXPECT_THAT(testable_period_.GetXml(kOutputPeriodDuration),
+              XmlNodeEqual(kExpectedXmlWithDuration));
+}
+
 TEST_F(PeriodTest, SetDurationAndGetXml) {
   const char kVideoMediaInfo[] =
       "video_info {\n"
@@ -0,0 +1,215 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/remote_mpd_notifier.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/rand_util.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/file/file_closer.h"
+#include "packager/file/http_file.h"
+
+namespace shaka {
+
+namespace {
+const char kContentType[] = "application/x-protobuf";
+const uint32_t kTimeoutInSeconds = 10;
+const size_t kBufferSize = 1024;
+// Hours of segments of a ladder.
+const size_t kMaxPendingEvents = 100000;
+// Keeps the requests small when catching up after an outage.
+const size_t kMaxEventsPerRequest = 1000;
+}  // namespace
+
+RemoteMpdNotifier::RemoteMpdNotifier(const MpdOptions& mpd_options,
+                                     const std::string& aggregator_url)
+    : MpdNotifier(mpd_options),
+      aggregator_url_(aggregator_url),
+      node_id_(base::RandUint64()),
+      max_pending_events_(kMaxPendingEvents),
+      idle_condition_(&lock_) {}
+
+RemoteMpdNotifier::~RemoteMpdNotifier() {
+  base::AutoLock auto_lock(lock_);
+  while (thread_running_)
+    idle_condition_.Wait();
+}
+
+bool RemoteMpdNotifier::Init() {
+  return true;
+}
+
+bool RemoteMpdNotifier::NotifyNewContainer(const MediaInfo& media_info,
+                                           uint32_t* container_id) {
+  DCHECK(container_id);
+  base::AutoLock auto_lock(lock_);
+  *container_id = next_container_id_++;
+  *AddEvent(MpdNotifierEvent::NEW_CONTAINER, *container_id)
+       ->mutable_media_info() = media_info;
+  return true;
+}
+
+bool RemoteMpdNotifier::NotifySampleDuration(uint32_t container_id,
+                                             uint32_t sample_duration) {
+  base::AutoLock auto_lock(lock_);
+  AddEvent(MpdNotifierEvent::SAMPLE_DURATION, container_id)
+      ->set_sample_duration(sample_duration);
+  return true;
+}
+
+bool RemoteMpdNotifier::NotifyNewSegment(uint32_t container_id,
+                                         uint64_t start_time,
+                                         uint64_t duration,
+                                         uint64_t size) {
+  base::AutoLock auto_lock(lock_);
+  MpdNotifierEvent* event =
+      AddEvent(MpdNotifierEvent::NEW_SEGMENT, container_id);
+  event->set_start_time(start_time);
+  event->set_duration(duration);
+  event->set_size(size);
+  return true;
+}
+
+bool RemoteMpdNotifier::NotifyCueEvent(uint32_t container_id,
+                                       uint64_t timestamp) {
+  base::AutoLock auto_lock(lock_);
+  AddEvent(MpdNotifierEvent::CUE_EVENT, container_id)->set_timestamp(timestamp);
+  return true;
+}
+
+bool RemoteMpdNotifier::NotifyEncryptionUpdate(
+    uint32_t container_id,
+    const std::string& drm_uuid,
+    const std::vector<uint8_t>& new_key_id,
+    const std::vector<uint8_t>& new_pssh) {
+  base::AutoLock auto_lock(lock_);
+  MpdNotifierEvent* event =
+      AddEvent(MpdNotifierEvent::ENCRYPTION_UPDATE, container_id);
+  event->set_drm_uuid(drm_uuid);
+  event->set_key_id(new_key_id.data(), new_key_id.size());
+  event->set_pssh(new_pssh.data(), new_pssh.size());
+  return true;
+}
+
+bool RemoteMpdNotifier::NotifyMediaInfoUpdate(uint32_t container_id,
+                                              const MediaInfo& media_info) {
+  base::AutoLock auto_lock(lock_);
+  *AddEvent(MpdNotifierEvent::MEDIA_INFO_UPDATE, container_id)
+       ->mutable_media_info() = media_info;
+  return true;
+}
+
+bool RemoteMpdNotifier::Flush() {
+  base::AutoLock auto_lock(lock_);
+  StartSendingIfNeeded();
+  while (thread_running_)
+    idle_condition_.Wait();
+  return !send_failed_;
+}
+
+bool RemoteMpdNotifier::RequestFlush(uint32_t container_id) {
+  base::AutoLock auto_lock(lock_);
+  StartSendingIfNeeded();
+  return true;
+}
+
+bool RemoteMpdNotifier::SendEvents(const std::string& serialized_events) {
+  std::unique_ptr<HttpFile, FileCloser> file(
+      new HttpFile(HttpMethod::kPost, aggregator_url_, kContentType,
+                   std::vector<std::string>(), kTimeoutInSeconds));
+  if (!file->Open()) {
+    LOG(ERROR) << "Cannot open " << aggregator_url_;
+    return false;
+  }
+  if (file->Write(serialized_events.data(), serialized_events.size()) !=
+      static_cast<int64_t>(serialized_events.size())) {
+    LOG(ERROR) << "Failed to send the MPD notifications to "
+               << aggregator_url_;
+    return false;
+  }
+  file->Flush();
+  // The response is empty, but is read to complete the request.
+  char buffer[kBufferSize];
+  while (file->Read(buffer, kBufferSize) > 0) {
+  }
+  return file.release()->CloseWithStatus().ok();
+}
+
+MpdNotifierEvent* RemoteMpdNotifier::AddEvent(MpdNotifierEvent::Type type,
+                                              uint32_t container_id) {
+  if (pending_events_.size() >= max_pending_events_)
+    DropOldestSegmentEvent();
+  pending_events_.emplace_back();
+  MpdNotifierEvent* event = &pending_events_.back();
+  event->set_type(type);
+  event->set_container_id(container_id);
+  event->set_sequence_number(next_sequence_number_++);
+  return event;
+}
+
+void RemoteMpdNotifier::DropOldestSegmentEvent() {
+  // The other events are rare, and needed to replay the segments.
+  auto iter = std::find_if(
+      pending_events_.begin() + num_events_in_flight_, pending_events_.end(),
+      [](const MpdNotifierEvent& event) {
+        return event.type() == MpdNotifierEvent::NEW_SEGMENT;
+      });
+  if (iter == pending_events_.end())
+    return;
+  pending_events_.erase(iter);
+  if (!dropping_events_) {
+    LOG(WARNING) << "Too many MPD notifications queued for "
+                 << aggregator_url_ << ". Dropping the oldest segments.";
+    dropping_events_ = true;
+  }
+}
+
+void RemoteMpdNotifier::StartSendingIfNeeded() {
+  if (thread_running_ || pending_events_.empty())
+    return;
+  thread_running_ = true;
+  send_failed_ = false;
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&RemoteMpdNotifier::SendThreadMain, base::Unretained(this)),
+      /* task_is_slow= */ true);
+}
+
+void RemoteMpdNotifier::SendThreadMain() {
+  base::AutoLock auto_lock(lock_);
+  while (!pending_events_.empty()) {
+    num_events_in_flight_ =
+        std::min(pending_events_.size(), kMaxEventsPerRequest);
+    MpdNotifierEvents events;
+    events.set_node_id(node_id_);
+    for (size_t i = 0; i < num_events_in_flight_; ++i)
+      *events.add_events() = pending_events_[i];
+
+    bool result = false;
+    {
+      base::AutoUnlock auto_unlock(lock_);
+      result = SendEvents(events.SerializeAsString());
+    }
+    if (!result) {
+      // The events are sent again, before the newer ones, on the next flush.
+      num_events_in_flight_ = 0;
+      send_failed_ = true;
+      break;
+    }
+    pending_events_.erase(pending_events_.begin(),
+                          pending_events_.begin() + num_events_in_flight_);
+    num_events_in_flight_ = 0;
+    dropping_events_ = false;
+  }
+  thread_running_ = false;
+  idle_condition_.Broadcast();
+}
+
+}  // namespace shaka
@@ -0,0 +1,118 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MPD_BASE_REMOTE_MPD_NOTIFIER_H_
+#define PACKAGER_MPD_BASE_REMOTE_MPD_NOTIFIER_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/mpd/base/media_info.pb.h"
+#include "packager/mpd/base/mpd_notifier.h"
+
+namespace shaka {
+
+/// An MpdNotifier which sends the notifications to an MPD aggregator, see
+/// MpdAggregator, instead of generating the MPD. Several packagers, e.g. each
+/// packaging some of the renditions of a ladder on a different host, send to
+/// the same aggregator, which generates a single MPD for all their streams.
+///
+/// The notifications are queued, and sent in HTTP POST requests on a worker
+/// thread when a flush is requested, so that a slow or unreachable aggregator
+/// does not block the packaging threads. Notifications which fail to be sent
+/// are sent again, in order, on the next flush. Each notification carries a
+/// sequence number, so that the aggregator ignores the ones it already
+/// handled. While the aggregator is unreachable, the oldest new segment
+/// notifications are dropped beyond a maximum number of queued notifications.
+///
+/// The segments of the streams are aligned across the packagers as long as
+/// they package the same input with the same segment duration.
+class RemoteMpdNotifier : public MpdNotifier {
+ public:
+  /// @param aggregator_url is the URL the notifications are posted to.
+  RemoteMpdNotifier(const MpdOptions& mpd_options,
+                    const std::string& aggregator_url);
+  /// Waits for the notifications being sent.
+  ~RemoteMpdNotifier() override;
+
+  /// None of the methods send the notifications until RequestFlush() or
+  /// Flush() is called.
+  /// @name MpdNotifier implemetation overrides.
+  /// @{
+  bool Init() override;
+  bool NotifyNewContainer(const MediaInfo& media_info, uint32_t* id) override;
+  bool NotifySampleDuration(uint32_t container_id,
+                            uint32_t sample_duration) override;
+  bool NotifyNewSegment(uint32_t container_id,
+                        uint64_t start_time,
+                        uint64_t duration,
+                        uint64_t size) override;
+  bool NotifyCueEvent(uint32_t container_id, uint64_t timestamp) override;
+  bool NotifyEncryptionUpdate(uint32_t container_id,
+                              const std::string& drm_uuid,
+                              const std::vector<uint8_t>& new_key_id,
+                              const std::vector<uint8_t>& new_pssh) override;
+  bool NotifyMediaInfoUpdate(uint32_t container_id,
+                             const MediaInfo& media_info) override;
+  /// Waits for the queued notifications to be sent.
+  /// @return false if they failed to be sent.
+  bool Flush() override;
+  /// Starts sending the queued notifications, and returns immediately.
+  bool RequestFlush(uint32_t container_id) override;
+  /// @}
+
+ protected:
+  /// Sends @a serialized_events, a serialized MpdNotifierEvents, to the
+  /// aggregator. Virtual for testing.
+  /// @return true on success, false otherwise.
+  virtual bool SendEvents(const std::string& serialized_events);
+
+  void set_max_pending_events_for_testing(size_t max_pending_events) {
+    max_pending_events_ = max_pending_events;
+  }
+
+ private:
+  RemoteMpdNotifier(const RemoteMpdNotifier&) = delete;
+  RemoteMpdNotifier& operator=(const RemoteMpdNotifier&) = delete;
+
+  // Queues an event of |type| on |container_id|, to be filled by the caller.
+  // |lock_| must be held.
+  MpdNotifierEvent* AddEvent(MpdNotifierEvent::Type type,
+                             uint32_t container_id);
+  // Drops the oldest NEW_SEGMENT event which is not being sent. |lock_| must
+  // be held.
+  void DropOldestSegmentEvent();
+  // Starts the worker thread if there are events to send and it is not
+  // running. |lock_| must be held.
+  void StartSendingIfNeeded();
+  void SendThreadMain();
+
+  const std::string aggregator_url_;
+  // Container IDs are only unique within a packager.
+  const uint64_t node_id_;
+  size_t max_pending_events_;
+
+  base::Lock lock_;
+  // Signaled when the worker thread exits.
+  base::ConditionVariable idle_condition_;
+  // The events not sent yet, in order.
+  std::deque<MpdNotifierEvent> pending_events_;
+  // The number of events at the front of |pending_events_| being sent.
+  size_t num_events_in_flight_ = 0;
+  uint64_t next_sequence_number_ = 1;
+  uint32_t next_container_id_ = 0;
+  bool thread_running_ = false;
+  bool send_failed_ = false;
+  // Whether events were dropped since the last successful send.
+  bool dropping_events_ = false;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_MPD_BASE_REMOTE_MPD_NOTIFIER_H_
@@ -8,11 +8,16 @@
 
 #include <gflags/gflags.h>
 
+#include <inttypes.h>
+#include <stdio.h>
+
 #include <algorithm>
 
 #include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_split.h"
 #include "packager/base/strings/stringprintf.h"
-#include "packager/file/file.h"
+#include "packager/file/file_deletion_queue.h"
 #include "packager/media/base/muxer_util.h"
 #include "packager/mpd/base/mpd_options.h"
 #include "packager/mpd/base/mpd_utils.h"
@@ -160,12 +165,14 @@ void Representation::AddContentProtectionElement(
     const ContentProtectionElement& content_protection_element) {
   content_protection_elements_.push_back(content_protection_element);
   RemoveDuplicateAttributes(&content_protection_elements_.back());
+  InvalidateXml();
 }
 
 void Representation::UpdateContentProtectionPssh(const std::string& drm_uuid,
                                                  const std::string& pssh) {
   UpdateContentProtectionPsshHelper(drm_uuid, pssh,
                                     &content_protection_elements_);
+  InvalidateXml();
 }
 
 void Representation::AddNewSegment(int64_t start_time,
@@ -175,6 +182,7 @@ void Representation::AddNewSegment(int64_t start_time,
     LOG(WARNING) << "Got segment with start_time and duration == 0. Ignoring.";
     return;
   }
+  InvalidateXml();
 
   // In order for the oldest segment to be accessible for at least
   // |time_shift_buffer_depth| seconds, the latest segment should not be in the
@@ -193,7 +201,60 @@ void Representation::AddNewSegment(int64_t start_time,
       size, static_cast<double>(duration) / media_info_.reference_time_scale());
 }
 
+std::string Representation::GetCheckpointState() const {
+  std::string state = base::StringPrintf("start_number %u\n", start_number_);
+  for (const SegmentInfo& segment_info : segment_infos_) {
+    base::StringAppendF(&state, "segment %" PRId64 " %" PRId64 " %d\n",
+                        segment_info.start_time, segment_info.duration,
+                        segment_info.repeat);
+  }
+  return state;
+}
+
+bool Representation::RestoreCheckpointState(const std::string& state) {
+  DCHECK(segment_infos_.empty());
+  uint32_t start_number = start_number_;
+  std::deque<SegmentInfo> segment_infos;
+  int64_t buffer_depth = 0;
+  for (const std::string& line : base::SplitString(
+           state, "\n", base::KEEP_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    SegmentInfo segment_info;
+    int end = 0;
+    if (line.compare(0, 13, "start_number ") == 0 &&
+        base::StringToUint(line.substr(13), &start_number)) {
+      continue;
+    }
+    if (sscanf(line.c_str(), "segment %" SCNd64 " %" SCNd64 " %d%n",
+               &segment_info.start_time, &segment_info.duration,
+               &segment_info.repeat, &end) != 3 ||
+        static_cast<size_t>(end) != line.size() || segment_info.duration <= 0 ||
+        segment_info.repeat < 0) {
+      LOG(ERROR) << "Invalid checkpoint state of Representation " << id_
+                 << ": " << line;
+      return false;
+    }
+    segment_infos.push_back(segment_info);
+    buffer_depth += segment_info.duration * (segment_info.repeat + 1);
+  }
+
+  InvalidateXml();
+  start_number_ = start_number;
+  segment_infos_.swap(segment_infos);
+  current_buffer_depth_ = buffer_depth;
+  if (state_change_listener_) {
+    for (const SegmentInfo& segment_info : segment_infos_) {
+      for (int i = 0; i <= segment_info.repeat; ++i) {
+        state_change_listener_->OnNewSegmentForRepresentation(
+            segment_info.start_time + segment_info.duration * i,
+            segment_info.duration);
+      }
+    }
+  }
+  return true;
+}
+
 void Representation::SetSampleDuration(uint32_t frame_duration) {
+  InvalidateXml();
   // Sample duration is used to generate approximate SegmentTimeline.
   // Text is required to have exactly the same segment duration.
   if (media_info_.has_audio_info() || media_info_.has_video_info())
@@ -228,6 +289,12 @@ base::Optional<xml::XmlNode> Representation::GetXml() {
                                  ? media_info_.bandwidth()
                                  : bandwidth_estimator_.Max();
 
+  if (cached_xml_ &&
+      cached_xml_suppression_flags_ == output_suppression_flags_) {
+    output_suppression_flags_ = 0;
+    return cached_xml_->Clone();
+  }
+
   DCHECK(!(HasVODOnlyFields(media_info_) && HasLiveOnlyFields(media_info_)));
 
   xml::RepresentationXmlNode representation;
@@ -272,17 +339,29 @@ base::Optional<xml::XmlNode> Representation::GetXml() {
     return base::nullopt;
   }
 
+  // The segments written in chunks are available once their first chunk is
+  // available.
+  const MpdParams& mpd_params = mpd_options_.mpd_params;
+  const double availability_time_offset =
+      mpd_params.low_latency_dash_mode &&
+              mpd_options_.mpd_type == MpdType::kDynamic
+          ? mpd_params.target_segment_duration -
+                mpd_params.target_chunk_duration
+          : 0;
   if (HasLiveOnlyFields(media_info_) &&
       !representation.AddLiveOnlyInfo(media_info_, segment_infos_,
-                                      start_number_)) {
+                                      start_number_,
+                                      availability_time_offset)) {
     LOG(ERROR) << "Failed to add Live info.";
     return base::nullopt;
   }
   // TODO(rkuroiwa): It is likely that all representations have the exact same
   // SegmentTemplate. Optimize and propagate the tag up to AdaptationSet level.
 
+  cached_xml_.emplace(std::move(representation));
+  cached_xml_suppression_flags_ = output_suppression_flags_;
   output_suppression_flags_ = 0;
-  return std::move(representation);
+  return cached_xml_->Clone();
 }
 
 void Representation::SuppressOnce(SuppressFlag flag) {
@@ -295,6 +374,7 @@ void Representation::SetPresentationTimeOffset(
   if (pto <= 0)
     return;
   media_info_.set_presentation_time_offset(pto);
+  InvalidateXml();
 }
 
 bool Representation::GetStartAndEndTimestamps(
@@ -394,6 +474,14 @@ bool Representation::ApproximiatelyEqual(int64_t time1, int64_t time2) const {
   // target duration of 2 seconds, the closest segment duration would be 1.984
   // or 2.00533.
 
+  // A user specified tolerance overrides the default one below.
+  const double tolerance =
+      mpd_options_.mpd_params.approximate_segment_timeline_tolerance;
+  if (tolerance > 0) {
+    return std::abs(time1 - time2) <=
+           static_cast<int64_t>(tolerance * media_info_.reference_time_scale());
+  }
+
   // An arbitrary error threshold cap. This makes sure that the error is not too
   // large for large samples.
   const double kErrorThresholdSeconds = 0.05;
@@ -431,8 +519,8 @@ void Representation::SlideWindow() {
   if (current_buffer_depth_ <= time_shift_buffer_depth)
     return;
 
-  std::list<SegmentInfo>::iterator first = segment_infos_.begin();
-  std::list<SegmentInfo>::iterator last = first;
+  std::deque<SegmentInfo>::iterator first = segment_infos_.begin();
+  std::deque<SegmentInfo>::iterator last = first;
   for (; last != segment_infos_.end(); ++last) {
     // Remove the current segment only if it falls completely out of time shift
     // buffer range.
@@ -461,12 +549,7 @@ void Representation::RemoveOldSegment(SegmentInfo* segment_info) {
                             start_number_ - 1, media_info_.bandwidth()));
   while (segments_to_be_removed_.size() >
          mpd_options_.mpd_params.preserved_segments_outside_live_window) {
-    VLOG(2) << "Deleting " << segments_to_be_removed_.front();
-    if (!File::Delete(segments_to_be_removed_.front().c_str())) {
-      LOG(WARNING) << "Failed to delete " << segments_to_be_removed_.front()
-                   << "; Will retry later.";
-      break;
-    }
+    FileDeletionQueue::GetInstance()->Delete(segments_to_be_removed_.front());
     segments_to_be_removed_.pop_front();
   }
 }
@@ -11,6 +11,7 @@
 
 #include <stdint.h>
 
+#include <deque>
 #include <list>
 #include <memory>
 
@@ -101,6 +102,16 @@ class Representation {
                              int64_t duration,
                              uint64_t size);
 
+  /// @return the state of the Representation to checkpoint, i.e. the segments
+  ///         in the live window and the number of the first one.
+  virtual std::string GetCheckpointState() const;
+
+  /// Restores the state returned by GetCheckpointState() of a previous run,
+  /// so that the Representation continues where it stopped. Must be called
+  /// before any segment is added.
+  /// @return true on success, false if @a state cannot be parsed.
+  virtual bool RestoreCheckpointState(const std::string& state);
+
   /// Set the sample duration of this Representation.
   /// Sample duration is not available right away especially for live. This
   /// allows setting the sample duration after the Representation has been
@@ -141,7 +152,16 @@ class Representation {
   /// @return ID number for <Representation>.
   uint32_t id() const { return id_; }
 
-  void set_media_info(const MediaInfo& media_info) { media_info_ = media_info; }
+  /// @return A number that changes whenever the element generated by GetXml()
+  ///         changes.
+  uint64_t xml_version() const { return xml_version_; }
+
+  /// Replaces the MediaInfo of the Representation with @a media_info, which
+  /// gets the previous MediaInfo in return. This avoids copying MediaInfo.
+  void SwapMediaInfo(MediaInfo* media_info) {
+    media_info_.Swap(media_info);
+    InvalidateXml();
+  }
 
  protected:
   /// @param media_info is a MediaInfo containing information on the media.
@@ -205,6 +225,13 @@ class Representation {
   // Get Representation as string. For debugging.
   std::string RepresentationAsString() const;
 
+  // Drops the cached <Representation> element. Must be called whenever
+  // anything GetXml() depends on changes.
+  void InvalidateXml() {
+    cached_xml_.reset();
+    ++xml_version_;
+  }
+
   // Init() checks that only one of VideoInfo, AudioInfo, or TextInfo is set. So
   // any logic using this can assume only one set.
   MediaInfo media_info_;
@@ -212,10 +239,13 @@ class Representation {
 
   int64_t current_buffer_depth_ = 0;
   // TODO(kqyang): Address sliding window issue with multiple periods.
-  std::list<SegmentInfo> segment_infos_;
+  // Run-length encoded, see SegmentInfo::repeat. A deque keeps the segments
+  // in contiguous blocks, which are popped from the front in O(1) as the
+  // window slides.
+  std::deque<SegmentInfo> segment_infos_;
   // A list to hold the file names of the segments to be removed temporarily.
   // Once a file is actually removed, it is removed from the list.
-  std::list<std::string> segments_to_be_removed_;
+  std::deque<std::string> segments_to_be_removed_;
 
   const uint32_t id_;
   std::string mime_type_;
@@ -240,6 +270,15 @@ class Representation {
   // Segments with duration difference less than one frame duration are
   // considered to have the same duration.
   uint32_t frame_duration_ = 0;
+
+  // The element generated by the last GetXml() call with
+  // |cached_xml_suppression_flags_|. It is returned (as a copy) as long as the
+  // Representation does not change, so that flushing an MPD with many
+  // Representations only regenerates the ones that got new segments.
+  base::Optional<xml::XmlNode> cached_xml_;
+  int cached_xml_suppression_flags_ = 0;
+  // Incremented by InvalidateXml().
+  uint64_t xml_version_ = 0;
 };
 
 }  // namespace shaka
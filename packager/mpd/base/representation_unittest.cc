@@ -14,6 +14,7 @@
 #include "packager/base/strings/stringprintf.h"
 #include "packager/file/file.h"
 #include "packager/file/file_closer.h"
+#include "packager/file/file_deletion_queue.h"
 #include "packager/mpd/base/mpd_options.h"
 #include "packager/mpd/test/mpd_builder_test_helper.h"
 #include "packager/mpd/test/xml_compare.h"
@@ -510,6 +511,53 @@ TEST_F(SegmentTemplateTest, OneSegmentNormal) {
   EXPECT_THAT(representation_->GetXml(), XmlNodeEqual(ExpectedXml()));
 }
 
+TEST_F(SegmentTemplateTest, CachedXmlUpdatedOnNewSegment) {
+  const int64_t kStartTime = 0;
+  const int64_t kDuration = 10;
+  const uint64_t kSize = 128;
+  AddSegments(kStartTime, kDuration, kSize, 0);
+  EXPECT_THAT(representation_->GetXml(), XmlNodeEqual(ExpectedXml()));
+  // Unchanged Representation returns the cached element.
+  EXPECT_THAT(representation_->GetXml(), XmlNodeEqual(ExpectedXml()));
+
+  AddSegments(kStartTime + kDuration, kDuration, kSize, 0);
+  expected_s_elements_ = "<S t=\"0\" d=\"10\" r=\"1\"/>";
+  EXPECT_THAT(representation_->GetXml(), XmlNodeEqual(ExpectedXml()));
+}
+
+TEST_F(SegmentTemplateTest, LowLatencyAvailabilityTimeOffset) {
+  mpd_options_.mpd_params.low_latency_dash_mode = true;
+  mpd_options_.mpd_params.target_segment_duration = 2;
+  mpd_options_.mpd_params.target_chunk_duration = 0.5;
+  representation_ =
+      CreateRepresentation(ConvertToMediaInfo(GetDefaultMediaInfo()),
+                           kAnyRepresentationId, NoListener());
+  ASSERT_TRUE(representation_->Init());
+
+  const int64_t kStartTime = 0;
+  const int64_t kDuration = 2000;
+  const uint64_t kSize = 128;
+  AddSegments(kStartTime, kDuration, kSize, 0);
+
+  const char kOutputTemplate[] =
+      "<Representation id=\"1\" bandwidth=\"%" PRIu64
+      "\" "
+      " codecs=\"avc1.010101\" mimeType=\"video/mp4\" sar=\"1:1\" "
+      " width=\"720\" height=\"480\" frameRate=\"10/5\">\n"
+      "  <SegmentTemplate timescale=\"1000\" "
+      "   initialization=\"init.mp4\" media=\"$Time$.mp4\" "
+      "   startNumber=\"1\" availabilityTimeOffset=\"1.5\" "
+      "   availabilityTimeComplete=\"false\">\n"
+      "    <SegmentTimeline>\n"
+      "      <S t=\"0\" d=\"2000\"/>\n"
+      "    </SegmentTimeline>\n"
+      "  </SegmentTemplate>\n"
+      "</Representation>\n";
+  EXPECT_THAT(representation_->GetXml(),
+              XmlNodeEqual(base::StringPrintf(kOutputTemplate,
+                                              bandwidth_estimator_.Max())));
+}
+
 TEST_F(SegmentTemplateTest, RepresentationClone) {
   MediaInfo media_info = ConvertToMediaInfo(GetDefaultMediaInfo());
   media_info.set_segment_template_url("$Number$.mp4");
@@ -693,6 +741,31 @@ TEST_F(SegmentTemplateTest, OverlappingSegmentsWithinErrorRange) {
   EXPECT_THAT(representation_->GetXml(), XmlNodeEqual(ExpectedXml()));
 }
 
+TEST_F(SegmentTemplateTest, RestoreCheckpointState) {
+  const int64_t kStartTime = 0;
+  const int64_t kDuration = 10;
+  const uint64_t kSize = 128;
+  AddSegments(kStartTime, kDuration, kSize, 2);
+  AddSegments(kStartTime + 3 * kDuration, 2 * kDuration, kSize, 0);
+  const std::string state = representation_->GetCheckpointState();
+  EXPECT_EQ("start_number 1\nsegment 0 10 2\nsegment 30 20 0\n", state);
+
+  std::unique_ptr<Representation> restored_representation =
+      CreateRepresentation(ConvertToMediaInfo(GetDefaultMediaInfo()),
+                           kAnyRepresentationId, NoListener());
+  ASSERT_TRUE(restored_representation->Init());
+  EXPECT_FALSE(
+      restored_representation->RestoreCheckpointState("segment 0 10\n"));
+  ASSERT_TRUE(restored_representation->RestoreCheckpointState(state));
+  EXPECT_EQ(state, restored_representation->GetCheckpointState());
+
+  // The restored Representation continues the timeline.
+  restored_representation->AddNewSegment(kStartTime + 5 * kDuration,
+                                         2 * kDuration, kSize);
+  EXPECT_EQ("start_number 1\nsegment 0 10 2\nsegment 30 20 1\n",
+            restored_representation->GetCheckpointState());
+}
+
 class SegmentTimelineTestBase : public SegmentTemplateTest {
  public:
   void SetUp() override {
@@ -911,6 +984,41 @@ TEST_P(ApproximateSegmentTimelineTest, FillSmallOverlap) {
               XmlNodeEqual(ExpectedXml(expected_s_elements)));
 }
 
+TEST_P(ApproximateSegmentTimelineTest, SegmentsWithinTolerance) {
+  // Larger than the sample duration, which is the default tolerance.
+  const int64_t kTolerance = 3;
+  mpd_options_.mpd_params.approximate_segment_timeline_tolerance =
+      static_cast<double>(kTolerance) / kDefaultTimeScale;
+
+  const int64_t kStartTime = 0;
+  const int64_t kDurationSmaller = kScaledTargetSegmentDuration - kTolerance;
+  const int64_t kDurationLarger = kScaledTargetSegmentDuration + kTolerance;
+  const uint64_t kSize = 128;
+  AddSegments(kStartTime, kDurationSmaller, kSize, 0);
+  AddSegments(kStartTime + kDurationSmaller, kDurationLarger, kSize, 0);
+  AddSegments(kStartTime + kDurationSmaller + kDurationLarger, kDurationSmaller,
+              kSize, 0);
+
+  std::string expected_s_elements;
+  if (allow_approximate_segment_timeline_) {
+    int kNumSegments = 3;
+    expected_s_elements =
+        base::StringPrintf(kSElementTemplate, kStartTime,
+                           kScaledTargetSegmentDuration, kNumSegments - 1);
+  } else {
+    expected_s_elements =
+        base::StringPrintf(kSElementTemplateWithoutR, kStartTime,
+                           kDurationSmaller) +
+        base::StringPrintf(kSElementTemplateWithoutR,
+                           kStartTime + kDurationSmaller, kDurationLarger) +
+        base::StringPrintf(kSElementTemplateWithoutR,
+                           kStartTime + kDurationSmaller + kDurationLarger,
+                           kDurationSmaller);
+  }
+  EXPECT_THAT(representation_->GetXml(),
+              XmlNodeEqual(ExpectedXml(expected_s_elements)));
+}
+
 // Check the segments are grouped correctly when sample duration is not
 // available, which happens for text streams.
 // See https://github.com/google/shaka-packager/issues/417 for the background.
@@ -1279,6 +1387,7 @@ class RepresentationDeleteSegmentsTest : public SegmentTimelineTestBase {
   }
 
   bool SegmentDeleted(const std::string& segment_name) {
+    FileDeletionQueue::GetInstance()->Flush();
     std::unique_ptr<File, FileCloser> file_closer(
         File::Open(segment_name.c_str(), "r"));
     return file_closer.get() == nullptr;
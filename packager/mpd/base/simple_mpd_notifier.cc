@@ -8,6 +8,8 @@
 
 #include "packager/base/logging.h"
 #include "packager/base/stl_util.h"
+#include "packager/base/trace_event/trace_event.h"
+#include "packager/media/base/metrics.h"
 #include "packager/mpd/base/adaptation_set.h"
 #include "packager/mpd/base/mpd_builder.h"
 #include "packager/mpd/base/mpd_notifier_util.h"
@@ -17,19 +19,35 @@
 
 namespace shaka {
 
+namespace {
+const char kMpdCheckpointKey[] = "dash:mpd";
+}  // namespace
+
 SimpleMpdNotifier::SimpleMpdNotifier(const MpdOptions& mpd_options)
     : MpdNotifier(mpd_options),
       output_path_(mpd_options.mpd_params.mpd_output),
+      patch_output_path_(mpd_options.mpd_params.mpd_patch_output),
       mpd_builder_(new MpdBuilder(mpd_options)),
       content_protection_in_adaptation_set_(
-          mpd_options.mpd_params.generate_dash_if_iop_compliant_mpd) {
+          mpd_options.mpd_params.generate_dash_if_iop_compliant_mpd),
+      write_coalescer_(
+          mpd_options.mpd_params.manifest_write_coalescing_window) {
   for (const std::string& base_url : mpd_options.mpd_params.base_urls)
     mpd_builder_->AddBaseUrl(base_url);
+  if (mpd_options.mpd_params.async_manifest_writes)
+    manifest_writer_.reset(new AsyncManifestWriter());
 }
 
 SimpleMpdNotifier::~SimpleMpdNotifier() {}
 
 bool SimpleMpdNotifier::Init() {
+  if (checkpoint_) {
+    // So that the segments restored keep their availability times.
+    const std::string availability_start_time =
+        checkpoint_->GetState(kMpdCheckpointKey);
+    if (!availability_start_time.empty())
+      mpd_builder_->set_availability_start_time(availability_start_time);
+  }
   return true;
 }
 
@@ -44,7 +62,7 @@ bool SimpleMpdNotifier::NotifyNewContainer(const MediaInfo& media_info,
   MediaInfo adjusted_media_info(media_info);
   MpdBuilder::MakePathsRelativeToMpd(output_path_, &adjusted_media_info);
 
-  base::AutoLock auto_lock(lock_);
+  base::subtle::AutoWriteLock write_lock(lock_);
   const double kPeriodStartTimeSeconds = 0.0;
   Period* period = mpd_builder_->GetOrCreatePeriod(kPeriodStartTimeSeconds);
   DCHECK(period);
@@ -59,27 +77,37 @@ bool SimpleMpdNotifier::NotifyNewContainer(const MediaInfo& media_info,
     return false;
 
   *container_id = representation->id();
-  if (content_protection_in_adaptation_set_) {
-    // ContentProtection elements are already added to AdaptationSet above.
-    // Use RepresentationId to AdaptationSet map to update ContentProtection
-    // in AdaptationSet in NotifyEncryptionUpdate.
-    representation_id_to_adaptation_set_[representation->id()] = adaptation_set;
-  } else {
+  // ContentProtection elements are already added to AdaptationSet above if
+  // |content_protection_in_adaptation_set_| is set.
+  if (!content_protection_in_adaptation_set_)
     AddContentProtectionElements(media_info, representation);
+  AddContainer(representation, adaptation_set);
+
+  if (checkpoint_ && media_info.has_segment_template()) {
+    const std::string key = "dash:" + media_info.segment_template();
+    const std::string state = checkpoint_->GetState(key);
+    if (!state.empty() && !representation->RestoreCheckpointState(state)) {
+      LOG(WARNING) << "Failed to restore Representation "
+                   << media_info.segment_template()
+                   << " from the checkpoint. Starting it over.";
+    }
+    checkpoint_keys_[representation->id()] = key;
   }
-  representation_map_[representation->id()] = representation;
+
+  base::AutoLock coalescer_lock(coalescer_lock_);
+  write_coalescer_.AddStream(representation->id());
   return true;
 }
 
 bool SimpleMpdNotifier::NotifySampleDuration(uint32_t container_id,
                                              uint32_t sample_duration) {
-  base::AutoLock auto_lock(lock_);
-  auto it = representation_map_.find(container_id);
-  if (it == representation_map_.end()) {
-    LOG(ERROR) << "Unexpected container_id: " << container_id;
+  base::subtle::AutoReadLock read_lock(lock_);
+  Representation* representation = nullptr;
+  base::Lock* adaptation_set_lock = nullptr;
+  if (!GetContainer(container_id, &representation, &adaptation_set_lock))
     return false;
-  }
-  it->second->SetSampleDuration(sample_duration);
+  base::AutoLock auto_lock(*adaptation_set_lock);
+  representation->SetSampleDuration(sample_duration);
   return true;
 }
 
@@ -87,19 +115,27 @@ bool SimpleMpdNotifier::NotifyNewSegment(uint32_t container_id,
                                          uint64_t start_time,
                                          uint64_t duration,
                                          uint64_t size) {
-  base::AutoLock auto_lock(lock_);
-  auto it = representation_map_.find(container_id);
-  if (it == representation_map_.end()) {
-    LOG(ERROR) << "Unexpected container_id: " << container_id;
+  base::subtle::AutoReadLock read_lock(lock_);
+  Representation* representation = nullptr;
+  base::Lock* adaptation_set_lock = nullptr;
+  if (!GetContainer(container_id, &representation, &adaptation_set_lock))
     return false;
-  }
-  it->second->AddNewSegment(start_time, duration, size);
+  base::AutoLock auto_lock(*adaptation_set_lock);
+  representation->AddNewSegment(start_time, duration, size);
+  const MediaInfo& media_info = representation->GetMediaInfo();
+  publication_latency_.OnSegmentWritten(media::MetricLabel(
+      "output", media_info.has_segment_template()
+                    ? media_info.segment_template()
+                    : media_info.media_file_name()));
+  auto key = checkpoint_keys_.find(container_id);
+  if (key != checkpoint_keys_.end())
+    checkpoint_->SetState(key->second, representation->GetCheckpointState());
   return true;
 }
 
 bool SimpleMpdNotifier::NotifyCueEvent(uint32_t container_id,
                                        uint64_t timestamp) {
-  base::AutoLock auto_lock(lock_);
+  base::subtle::AutoWriteLock write_lock(lock_);
   auto it = representation_map_.find(container_id);
   if (it == representation_map_.end()) {
     LOG(ERROR) << "Unexpected container_id: " << container_id;
@@ -129,15 +165,11 @@ bool SimpleMpdNotifier::NotifyCueEvent(uint32_t container_id,
   if (!representation)
     return false;
 
-  if (content_protection_in_adaptation_set_) {
-    // ContentProtection elements are already added to AdaptationSet above.
-    // Use RepresentationId to AdaptationSet map to update ContentProtection
-    // in AdaptationSet in NotifyEncryptionUpdate.
-    representation_id_to_adaptation_set_[representation->id()] = adaptation_set;
-  } else {
+  // ContentProtection elements are already added to AdaptationSet above if
+  // |content_protection_in_adaptation_set_| is set.
+  if (!content_protection_in_adaptation_set_)
     AddContentProtectionElements(media_info, representation);
-  }
-  representation_map_[representation->id()] = representation;
+  AddContainer(representation, adaptation_set);
   return true;
 }
 
@@ -146,44 +178,124 @@ bool SimpleMpdNotifier::NotifyEncryptionUpdate(
     const std::string& drm_uuid,
     const std::vector<uint8_t>& new_key_id,
     const std::vector<uint8_t>& new_pssh) {
-  base::AutoLock auto_lock(lock_);
-  auto it = representation_map_.find(container_id);
-  if (it == representation_map_.end()) {
-    LOG(ERROR) << "Unexpected container_id: " << container_id;
+  base::subtle::AutoReadLock read_lock(lock_);
+  Representation* representation = nullptr;
+  base::Lock* adaptation_set_lock = nullptr;
+  if (!GetContainer(container_id, &representation, &adaptation_set_lock))
     return false;
-  }
+  base::AutoLock auto_lock(*adaptation_set_lock);
 
   if (content_protection_in_adaptation_set_) {
     AdaptationSet* adaptation_set_for_representation =
-        representation_id_to_adaptation_set_[it->second->id()];
+        representation_id_to_adaptation_set_.at(representation->id());
     adaptation_set_for_representation->UpdateContentProtectionPssh(
         drm_uuid, Uint8VectorToBase64(new_pssh));
   } else {
-    it->second->UpdateContentProtectionPssh(drm_uuid,
-                                            Uint8VectorToBase64(new_pssh));
+    representation->UpdateContentProtectionPssh(drm_uuid,
+                                                Uint8VectorToBase64(new_pssh));
   }
   return true;
 }
 
 bool SimpleMpdNotifier::NotifyMediaInfoUpdate(uint32_t container_id,
                                               const MediaInfo& media_info) {
-  base::AutoLock auto_lock(lock_);
-  auto it = representation_map_.find(container_id);
-  if (it == representation_map_.end()) {
-    LOG(ERROR) << "Unexpected container_id: " << container_id;
-    return false;
-  }
-
   MediaInfo adjusted_media_info(media_info);
   MpdBuilder::MakePathsRelativeToMpd(output_path_, &adjusted_media_info);
 
-  it->second->set_media_info(adjusted_media_info);
+  base::subtle::AutoReadLock read_lock(lock_);
+  Representation* representation = nullptr;
+  base::Lock* adaptation_set_lock = nullptr;
+  if (!GetContainer(container_id, &representation, &adaptation_set_lock))
+    return false;
+  base::AutoLock auto_lock(*adaptation_set_lock);
+  representation->SwapMediaInfo(&adjusted_media_info);
   return true;
 }
 
 bool SimpleMpdNotifier::Flush() {
-  base::AutoLock auto_lock(lock_);
-  return WriteMpdToFile(output_path_, mpd_builder_.get());
+  TRACE_EVENT0("shaka", "SimpleMpdNotifier::Flush");
+  {
+    base::AutoLock coalescer_lock(coalescer_lock_);
+    write_coalescer_.OnManifestWritten();
+  }
+  base::subtle::AutoWriteLock write_lock(lock_);
+  return WriteMpd() && SaveCheckpoint(true) &&
+         (!manifest_writer_ || manifest_writer_->Flush());
+}
+
+bool SimpleMpdNotifier::RequestFlush(uint32_t container_id) {
+  {
+    base::AutoLock coalescer_lock(coalescer_lock_);
+    if (!write_coalescer_.OnStreamUpdated(container_id))
+      return true;
+    write_coalescer_.OnManifestWritten();
+  }
+  // The MPD is generated from the latest state, so it does not matter if
+  // another flush is generated in between.
+  base::subtle::AutoWriteLock write_lock(lock_);
+  return WriteMpd() && SaveCheckpoint(false);
+}
+
+bool SimpleMpdNotifier::WriteMpd() {
+  std::string mpd;
+  if (!mpd_builder_->ToString(&mpd)) {
+    LOG(ERROR) << "Failed to write MPD to string.";
+    return false;
+  }
+  // The patch is for the clients of the previous MPD, so it is written first.
+  // Clients which get a patch that does not apply to their MPD fetch the full
+  // MPD instead.
+  const std::string& patch = mpd_builder_->patch();
+  if (manifest_writer_) {
+    if (!patch.empty())
+      manifest_writer_->Write(patch_output_path_, patch);
+    manifest_writer_->Write(output_path_, mpd);
+    // Counted as published when handed to the writer.
+    publication_latency_.OnManifestPublished();
+    return true;
+  }
+  if (!(patch.empty() || file_writer_.Write(patch_output_path_, patch)) ||
+      !file_writer_.Write(output_path_, mpd)) {
+    return false;
+  }
+  publication_latency_.OnManifestPublished();
+  return true;
+}
+
+bool SimpleMpdNotifier::SaveCheckpoint(bool flush) {
+  if (!checkpoint_)
+    return true;
+  // @availabilityStartTime is determined when the MPD is first generated.
+  const std::string& availability_start_time =
+      mpd_builder_->availability_start_time();
+  if (!availability_start_time.empty())
+    checkpoint_->SetState(kMpdCheckpointKey, availability_start_time);
+  return flush ? checkpoint_->Write() : checkpoint_->MaybeWrite();
+}
+
+void SimpleMpdNotifier::AddContainer(Representation* representation,
+                                     AdaptationSet* adaptation_set) {
+  representation_map_[representation->id()] = representation;
+  representation_id_to_adaptation_set_[representation->id()] = adaptation_set;
+  std::unique_ptr<base::Lock>& adaptation_set_lock =
+      adaptation_set_locks_[adaptation_set];
+  if (!adaptation_set_lock)
+    adaptation_set_lock.reset(new base::Lock);
+}
+
+bool SimpleMpdNotifier::GetContainer(uint32_t container_id,
+                                     Representation** representation,
+                                     base::Lock** adaptation_set_lock) {
+  auto it = representation_map_.find(container_id);
+  if (it == representation_map_.end()) {
+    LOG(ERROR) << "Unexpected container_id: " << container_id;
+    return false;
+  }
+  *representation = it->second;
+  const AdaptationSet* adaptation_set =
+      representation_id_to_adaptation_set_.at(container_id);
+  *adaptation_set_lock = adaptation_set_locks_.at(adaptation_set).get();
+  return true;
 }
 
 }  // namespace shaka
@@ -13,6 +13,12 @@
 #include <vector>
 
 #include "packager/base/synchronization/lock.h"
+#include "packager/base/synchronization/read_write_lock.h"
+#include "packager/media/base/metrics.h"
+#include "packager/mpd/base/async_manifest_writer.h"
+#include "packager/mpd/base/manifest_checkpoint.h"
+#include "packager/mpd/base/manifest_file_writer.h"
+#include "packager/mpd/base/manifest_write_coalescer.h"
 #include "packager/mpd/base/mpd_notifier.h"
 #include "packager/mpd/base/mpd_notifier_util.h"
 
@@ -50,14 +56,46 @@ class SimpleMpdNotifier : public MpdNotifier {
   bool NotifyMediaInfoUpdate(uint32_t container_id,
                              const MediaInfo& media_info) override;
   bool Flush() override;
+  bool RequestFlush(uint32_t container_id) override;
   /// @}
 
+  /// Sets the checkpoint which the MPD is restored from when the containers
+  /// are added, and saved to when it is written. Must be called before
+  /// Init().
+  /// @param checkpoint is not owned and must outlive the notifier.
+  void set_checkpoint(ManifestCheckpoint* checkpoint) {
+    checkpoint_ = checkpoint;
+  }
+
  private:
   SimpleMpdNotifier(const SimpleMpdNotifier&) = delete;
   SimpleMpdNotifier& operator=(const SimpleMpdNotifier&) = delete;
 
   friend class SimpleMpdNotifierTest;
 
+  // Serializes the MPD and its patch, if any, and writes them, or schedules
+  // them to be written by |manifest_writer_| if it is set. |lock_| must be
+  // held exclusively.
+  bool WriteMpd();
+
+  // Saves the state of the MPD to |checkpoint_| once it is written. Writes
+  // the checkpoint file if |flush| is set, or if the checkpoint interval has
+  // elapsed. |lock_| must be held exclusively.
+  bool SaveCheckpoint(bool flush);
+
+  // Registers |representation| of |adaptation_set| as a container. |lock_|
+  // must be held exclusively.
+  void AddContainer(Representation* representation,
+                    AdaptationSet* adaptation_set);
+
+  // Looks up the container. |lock_| must be held.
+  // @param representation is set to the Representation of the container.
+  // @param adaptation_set_lock is set to the lock to hold while updating it.
+  // @return true if the container exists, false otherwise.
+  bool GetContainer(uint32_t container_id,
+                    Representation** representation,
+                    base::Lock** adaptation_set_lock);
+
   // Testing only method. Returns a pointer to MpdBuilder.
   MpdBuilder* MpdBuilderForTesting() const { return mpd_builder_.get(); }
 
@@ -68,15 +106,39 @@ class SimpleMpdNotifier : public MpdNotifier {
 
   // MPD output path.
   std::string output_path_;
+  // MPD Patch output path. Empty if MPD patches are not enabled.
+  std::string patch_output_path_;
   std::unique_ptr<MpdBuilder> mpd_builder_;
   bool content_protection_in_adaptation_set_ = true;
-  base::Lock lock_;
+  // Updates of a single container hold |lock_| shared, together with the lock
+  // of its AdaptationSet, so that containers in different AdaptationSets are
+  // updated concurrently. Adding containers or Periods and generating the MPD
+  // hold |lock_| exclusively.
+  base::subtle::ReadWriteLock lock_;
+  // Guards |write_coalescer_|. Never acquired before |lock_|.
+  base::Lock coalescer_lock_;
+  ManifestWriteCoalescer write_coalescer_;
+  // Only set if the MPD is written asynchronously.
+  std::unique_ptr<AsyncManifestWriter> manifest_writer_;
+  // Writes the MPD if it is written synchronously.
+  ManifestFileWriter file_writer_;
+  media::SegmentPublicationLatencyMetric publication_latency_;
+
+  // Not owned. Only set to resume from and to save checkpoints.
+  ManifestCheckpoint* checkpoint_ = nullptr;
+  // Maps Representation ID to the checkpoint key of the Representation. Only
+  // Representations with a SegmentTemplate are checkpointed.
+  std::map<uint32_t, std::string> checkpoint_keys_;
 
   uint32_t next_adaptation_set_id_ = 0;
   // Maps Representation ID to Representation.
   std::map<uint32_t, Representation*> representation_map_;
-  // Maps Representation ID to AdaptationSet. This is for updating the PSSH.
+  // Maps Representation ID to AdaptationSet.
   std::map<uint32_t, AdaptationSet*> representation_id_to_adaptation_set_;
+  // The Representations of an AdaptationSet share state, e.g. for the segment
+  // alignment checks, so they are updated under a lock per AdaptationSet.
+  std::map<const AdaptationSet*, std::unique_ptr<base::Lock>>
+      adaptation_set_locks_;
 };
 
 }  // namespace shaka
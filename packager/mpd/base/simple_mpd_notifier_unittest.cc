@@ -8,8 +8,14 @@
 #include <google/protobuf/util/message_differencer.h>
 #include <gtest/gtest.h>
 
+#include <functional>
+
 #include "packager/base/files/file_path.h"
 #include "packager/base/files/file_util.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/threading/simple_thread.h"
+#include "packager/file/file.h"
 #include "packager/mpd/base/mock_mpd_builder.h"
 #include "packager/mpd/base/mpd_builder.h"
 #include "packager/mpd/base/mpd_options.h"
@@ -20,6 +26,7 @@ namespace shaka {
 
 using ::testing::_;
 using ::testing::Eq;
+using ::testing::Invoke;
 using ::testing::Ref;
 using ::testing::Return;
 using ::testing::ReturnRef;
@@ -35,6 +42,25 @@ MATCHER_P(EqualsProto, message, "") {
   return ::google::protobuf::util::MessageDifferencer::Equals(arg, message);
 }
 
+// Long enough for a blocked notification to be considered deadlocked.
+const int64_t kTimeoutInSeconds = 10;
+
+// Runs |task| on a new thread, joined on destruction.
+class TaskThread : public base::SimpleThread {
+ public:
+  explicit TaskThread(std::function<void()> task)
+      : base::SimpleThread("TaskThread"), task_(std::move(task)) {
+    Start();
+  }
+
+  ~TaskThread() override { Join(); }
+
+  void Run() override { task_(); }
+
+ private:
+  const std::function<void()> task_;
+};
+
 }  // namespace
 
 class SimpleMpdNotifierTest : public ::testing::Test {
@@ -165,6 +191,20 @@ TEST_F(SimpleMpdNotifierTest, NotifyNewContainerAndSampleDurationNoMock) {
   EXPECT_TRUE(notifier.Flush());
 }
 
+TEST_F(SimpleMpdNotifierTest, AsyncManifestWritesNoMock) {
+  empty_mpd_option_.mpd_params.async_manifest_writes = true;
+  SimpleMpdNotifier notifier(empty_mpd_option_);
+  uint32_t container_id;
+  EXPECT_TRUE(notifier.NotifyNewContainer(valid_media_info1_, &container_id));
+  EXPECT_TRUE(notifier.RequestFlush(container_id));
+  EXPECT_TRUE(notifier.Flush());
+
+  std::string mpd;
+  ASSERT_TRUE(File::ReadFileToString(
+      empty_mpd_option_.mpd_params.mpd_output.c_str(), &mpd));
+  EXPECT_NE(std::string::npos, mpd.find("<Representation"));
+}
+
 TEST_F(SimpleMpdNotifierTest, NotifyNewSegment) {
   SimpleMpdNotifier notifier(empty_mpd_option_);
 
@@ -195,6 +235,46 @@ TEST_F(SimpleMpdNotifierTest, NotifyNewSegment) {
                                         kSegmentDuration, kSegmentSize));
 }
 
+// Verify that the flush requests are coalesced until all the Representations
+// have requested a flush.
+TEST_F(SimpleMpdNotifierTest, RequestFlushCoalesced) {
+  const double kLongCoalescingWindow = 3600;
+  empty_mpd_option_.mpd_params.manifest_write_coalescing_window =
+      kLongCoalescingWindow;
+  SimpleMpdNotifier notifier(empty_mpd_option_);
+
+  const uint32_t kRepresentationId1 = 1u;
+  const uint32_t kRepresentationId2 = 2u;
+  std::unique_ptr<MockMpdBuilder> mock_mpd_builder(new MockMpdBuilder());
+  std::unique_ptr<MockRepresentation> mock_representation1(
+      new MockRepresentation(kRepresentationId1));
+  std::unique_ptr<MockRepresentation> mock_representation2(
+      new MockRepresentation(kRepresentationId2));
+
+  EXPECT_CALL(*mock_mpd_builder, GetOrCreatePeriod(_))
+      .WillRepeatedly(Return(default_mock_period_.get()));
+  EXPECT_CALL(*default_mock_period_, GetOrCreateAdaptationSet(_, _))
+      .WillRepeatedly(Return(default_mock_adaptation_set_.get()));
+  EXPECT_CALL(*default_mock_adaptation_set_, AddRepresentation(_))
+      .WillOnce(Return(mock_representation1.get()))
+      .WillOnce(Return(mock_representation2.get()));
+  // The first request is written immediately; the next two are coalesced into
+  // a single write.
+  EXPECT_CALL(*mock_mpd_builder, ToString(_))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+
+  uint32_t container_id1;
+  uint32_t container_id2;
+  SetMpdBuilder(&notifier, std::move(mock_mpd_builder));
+  EXPECT_TRUE(notifier.NotifyNewContainer(valid_media_info1_, &container_id1));
+  EXPECT_TRUE(notifier.NotifyNewContainer(valid_media_info2_, &container_id2));
+
+  EXPECT_TRUE(notifier.RequestFlush(container_id1));
+  EXPECT_TRUE(notifier.RequestFlush(container_id1));
+  EXPECT_TRUE(notifier.RequestFlush(container_id2));
+}
+
 TEST_F(SimpleMpdNotifierTest, NotifyCueEvent) {
   SimpleMpdNotifier notifier(empty_mpd_option_);
 
@@ -333,6 +413,129 @@ TEST_F(SimpleMpdNotifierTest,
 }
 
 // Test multiple media info with some belongs to the same AdaptationSets.
+// Verify that the Representations of different AdaptationSets are updated
+// concurrently: the update of the first one blocks until the second one is
+// updated.
+TEST_F(SimpleMpdNotifierTest, NotifyNewSegmentConcurrently) {
+  SimpleMpdNotifier notifier(empty_mpd_option_);
+  std::unique_ptr<MockMpdBuilder> mock_mpd_builder(new MockMpdBuilder());
+  std::unique_ptr<MockAdaptationSet> adaptation_set1(new MockAdaptationSet());
+  std::unique_ptr<MockAdaptationSet> adaptation_set2(new MockAdaptationSet());
+  std::unique_ptr<MockRepresentation> representation1(
+      new MockRepresentation(1));
+  std::unique_ptr<MockRepresentation> representation2(
+      new MockRepresentation(2));
+
+  EXPECT_CALL(*mock_mpd_builder, GetOrCreatePeriod(_))
+      .WillRepeatedly(Return(default_mock_period_.get()));
+  EXPECT_CALL(*default_mock_period_,
+              GetOrCreateAdaptationSet(EqualsProto(valid_media_info1_), _))
+      .WillOnce(Return(adaptation_set1.get()));
+  EXPECT_CALL(*adaptation_set1, AddRepresentation(_))
+      .WillOnce(Return(representation1.get()));
+  EXPECT_CALL(*default_mock_period_,
+              GetOrCreateAdaptationSet(EqualsProto(valid_media_info2_), _))
+      .WillOnce(Return(adaptation_set2.get()));
+  EXPECT_CALL(*adaptation_set2, AddRepresentation(_))
+      .WillOnce(Return(representation2.get()));
+
+  uint32_t container_id1;
+  uint32_t container_id2;
+  SetMpdBuilder(&notifier, std::move(mock_mpd_builder));
+  ASSERT_TRUE(notifier.NotifyNewContainer(valid_media_info1_, &container_id1));
+  ASSERT_TRUE(notifier.NotifyNewContainer(valid_media_info2_, &container_id2));
+
+  base::WaitableEvent first_update_started(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  base::WaitableEvent second_update_done(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  bool second_update_done_first = false;
+
+  const uint64_t kStartTime = 0u;
+  const uint32_t kSegmentDuration = 100u;
+  const uint64_t kSegmentSize = 123456u;
+  EXPECT_CALL(*representation1,
+              AddNewSegment(kStartTime, kSegmentDuration, kSegmentSize))
+      .WillOnce(Invoke([&](uint64_t, uint64_t, uint64_t) {
+        first_update_started.Signal();
+        second_update_done_first = second_update_done.TimedWait(
+            base::TimeDelta::FromSeconds(kTimeoutInSeconds));
+      }));
+  EXPECT_CALL(*representation2,
+              AddNewSegment(kStartTime, kSegmentDuration, kSegmentSize))
+      .WillOnce(Invoke([&](uint64_t, uint64_t, uint64_t) {
+        second_update_done.Signal();
+      }));
+
+  {
+    TaskThread thread([&]() {
+      EXPECT_TRUE(notifier.NotifyNewSegment(container_id1, kStartTime,
+                                            kSegmentDuration, kSegmentSize));
+    });
+    first_update_started.Wait();
+    EXPECT_TRUE(notifier.NotifyNewSegment(container_id2, kStartTime,
+                                          kSegmentDuration, kSegmentSize));
+  }
+  EXPECT_TRUE(second_update_done_first);
+}
+
+// Verify that the manifest is not generated while a Representation is being
+// updated.
+TEST_F(SimpleMpdNotifierTest, FlushWaitsForNotifyNewSegment) {
+  SimpleMpdNotifier notifier(empty_mpd_option_);
+  std::unique_ptr<MockMpdBuilder> mock_mpd_builder(new MockMpdBuilder());
+  MockMpdBuilder* mock_mpd_builder_ptr = mock_mpd_builder.get();
+  std::unique_ptr<MockRepresentation> mock_representation(
+      new MockRepresentation(1));
+
+  EXPECT_CALL(*mock_mpd_builder, GetOrCreatePeriod(_))
+      .WillOnce(Return(default_mock_period_.get()));
+  EXPECT_CALL(*default_mock_period_, GetOrCreateAdaptationSet(_, _))
+      .WillOnce(Return(default_mock_adaptation_set_.get()));
+  EXPECT_CALL(*default_mock_adaptation_set_, AddRepresentation(_))
+      .WillOnce(Return(mock_representation.get()));
+
+  uint32_t container_id;
+  SetMpdBuilder(&notifier, std::move(mock_mpd_builder));
+  ASSERT_TRUE(notifier.NotifyNewContainer(valid_media_info1_, &container_id));
+
+  base::WaitableEvent update_started(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  base::WaitableEvent flush_started(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  bool update_done = false;
+  bool flushed_after_update = false;
+
+  EXPECT_CALL(*mock_representation, AddNewSegment(_, _, _))
+      .WillOnce(Invoke([&](uint64_t, uint64_t, uint64_t) {
+        update_started.Signal();
+        // Give Flush() a chance to run: it must not generate the manifest
+        // before this update returns.
+        flush_started.Wait();
+        base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(100));
+        update_done = true;
+      }));
+  EXPECT_CALL(*mock_mpd_builder_ptr, ToString(_))
+      .WillOnce(Invoke([&](std::string*) {
+        flushed_after_update = update_done;
+        return true;
+      }));
+
+  {
+    TaskThread thread([&]() {
+      EXPECT_TRUE(notifier.NotifyNewSegment(container_id, 0, 100, 123456));
+    });
+    update_started.Wait();
+    flush_started.Signal();
+    EXPECT_TRUE(notifier.Flush());
+  }
+  EXPECT_TRUE(flushed_after_update);
+}
+
 TEST_F(SimpleMpdNotifierTest, MultipleMediaInfo) {
   SimpleMpdNotifier notifier(empty_mpd_option_);
   std::unique_ptr<MockMpdBuilder> mock_mpd_builder(new MockMpdBuilder());
@@ -5,11 +5,12 @@
 // https://developers.google.com/open-source/licenses/bsd
 //
 // unique_ptr alias for libxml2 objects. Deleters for the objects are also
-// defined in this file.
+// defined in this file, along with the libxml2 parser initialization.
 
 #ifndef MPD_BASE_XML_SCOPED_XML_PTR_H_
 #define MPD_BASE_XML_SCOPED_XML_PTR_H_
 
+#include <libxml/parser.h>
 #include <libxml/tree.h>
 #include <libxml/xmlschemas.h>
 
@@ -40,6 +41,26 @@ struct XmlDeleter {
 template <typename XmlType>
 using scoped_xml_ptr = std::unique_ptr<XmlType, XmlDeleter>;
 
+/// Initializes the libxml2 parser on construction, and cleans it up on
+/// destruction.
+class LibXmlInitializer {
+ public:
+  LibXmlInitializer() { xmlInitParser(); }
+  ~LibXmlInitializer() { xmlCleanupParser(); }
+
+ private:
+  LibXmlInitializer(const LibXmlInitializer&) = delete;
+  LibXmlInitializer& operator=(const LibXmlInitializer&) = delete;
+};
+
+/// Initializes the libxml2 parser once per process, and cleans it up at exit.
+/// Must be called before XML is parsed with libxml2, as the parser is not
+/// thread safe until it is initialized. MPDs are written without libxml2, so
+/// only the code parsing XML calls this.
+inline void InitializeLibXml() {
+  static LibXmlInitializer lib_xml_initializer;
+}
+
 }  // namespace xml
 }  // namespace shaka
 
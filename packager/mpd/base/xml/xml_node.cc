@@ -7,11 +7,12 @@
 #include "packager/mpd/base/xml/xml_node.h"
 
 #include <gflags/gflags.h>
-#include <libxml/tree.h>
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include <set>
+#include <utility>
 
 #include "packager/base/logging.h"
 #include "packager/base/macros.h"
@@ -21,7 +22,6 @@
 #include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/base/mpd_utils.h"
 #include "packager/mpd/base/segment_info.h"
-#include "packager/mpd/base/xml/scoped_xml_ptr.h"
 
 DEFINE_bool(segment_template_constant_duration,
             false,
@@ -34,6 +34,12 @@ DEFINE_bool(dash_add_last_segment_number_when_needed,
             "set to http://dashif.org/guidelines/last-segment-number with "
             "the @value set to the last segment number.");
 
+DEFINE_bool(dash_compact_segment_timeline,
+            false,
+            "Omits S@t in SegmentTimeline for segments starting where the "
+            "previous S element ends, which makes long SegmentTimelines "
+            "considerably smaller.");
+
 namespace shaka {
 
 using xml::XmlNode;
@@ -51,7 +57,7 @@ std::string RangeToString(const Range& range) {
 
 // Check if segments are continuous and all segments except the last one are of
 // the same duration.
-bool IsTimelineConstantDuration(const std::list<SegmentInfo>& segment_infos,
+bool IsTimelineConstantDuration(const std::deque<SegmentInfo>& segment_infos,
                                 uint32_t start_number) {
   if (!FLAGS_segment_template_constant_duration)
     return false;
@@ -77,11 +83,19 @@ bool IsTimelineConstantDuration(const std::list<SegmentInfo>& segment_infos,
   return expected_last_segment_start_time == last_segment.start_time;
 }
 
-bool PopulateSegmentTimeline(const std::list<SegmentInfo>& segment_infos,
+bool PopulateSegmentTimeline(const std::deque<SegmentInfo>& segment_infos,
                              XmlNode* segment_timeline) {
+  int64_t previous_segment_end_time = -1;
   for (const SegmentInfo& segment_info : segment_infos) {
     XmlNode s_element("S");
-    RCHECK(s_element.SetIntegerAttribute("t", segment_info.start_time));
+    // S@t defaults to the end of the previous S element.
+    if (!FLAGS_dash_compact_segment_timeline ||
+        segment_info.start_time != previous_segment_end_time) {
+      RCHECK(s_element.SetIntegerAttribute("t", segment_info.start_time));
+    }
+    previous_segment_end_time =
+        segment_info.start_time +
+        segment_info.duration * (segment_info.repeat + 1);
     RCHECK(s_element.SetIntegerAttribute("d", segment_info.duration));
     if (segment_info.repeat > 0)
       RCHECK(s_element.SetIntegerAttribute("r", segment_info.repeat));
@@ -99,37 +113,407 @@ void CollectNamespaceFromName(const std::string& name,
     namespaces->insert(name.substr(0, pos));
 }
 
-void TraverseAttrsAndCollectNamespaces(const xmlAttr* attr,
-                                       std::set<std::string>* namespaces) {
-  for (const xmlAttr* cur_attr = attr; cur_attr; cur_attr = cur_attr->next) {
-    CollectNamespaceFromName(reinterpret_cast<const char*>(cur_attr->name),
-                             namespaces);
-  }
+// Appends the decimal |value| without a temporary string.
+void AppendUint64(uint64_t value, std::string* out) {
+  char digits[20];
+  size_t size = 0;
+  do {
+    digits[size++] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+  while (size > 0)
+    out->push_back(digits[--size]);
 }
 
-void TraverseNodesAndCollectNamespaces(const xmlNode* node,
-                                       std::set<std::string>* namespaces) {
-  for (const xmlNode* cur_node = node; cur_node; cur_node = cur_node->next) {
-    CollectNamespaceFromName(reinterpret_cast<const char*>(cur_node->name),
-                             namespaces);
+}  // namespace
+
+namespace xml {
 
-    TraverseNodesAndCollectNamespaces(cur_node->children, namespaces);
-    TraverseAttrsAndCollectNamespaces(cur_node->properties, namespaces);
+void AppendEscapedText(const std::string& text, std::string* out) {
+  for (const char c : text) {
+    switch (c) {
+      case '<':
+        out->append("&lt;");
+        break;
+      case '>':
+        out->append("&gt;");
+        break;
+      case '&':
+        out->append("&amp;");
+        break;
+      case '\r':
+        out->append("&#13;");
+        break;
+      default:
+        out->push_back(c);
+        break;
+    }
   }
 }
 
-}  // namespace
-
-namespace xml {
+void AppendAttribute(const std::string& name,
+                     const std::string& value,
+                     std::string* out) {
+  out->push_back(' ');
+  out->append(name);
+  out->append("=\"");
+  for (const char c : value) {
+    switch (c) {
+      case '\n':
+        out->append("&#10;");
+        break;
+      case '\r':
+        out->append("&#13;");
+        break;
+      case '\t':
+        out->append("&#9;");
+        break;
+      case '"':
+        out->append("&quot;");
+        break;
+      case '<':
+        out->append("&lt;");
+        break;
+      case '>':
+        out->append("&gt;");
+        break;
+      case '&':
+        out->append("&amp;");
+        break;
+      default:
+        out->push_back(c);
+        break;
+    }
+  }
+  out->push_back('"');
+}
 
+// A compact element or text node. Unlike a libxml DOM, the names and values
+// are plain strings and the tree is only walked once, to write the document.
 class XmlNode::Impl {
  public:
-  scoped_xml_ptr<xmlNode> node;
+  std::unique_ptr<Impl> Clone() const {
+    std::unique_ptr<Impl> copy(new Impl);
+    copy->name = name;
+    copy->attributes = attributes;
+    copy->text = text;
+    copy->range_attribute = range_attribute;
+    copy->ranges = ranges;
+    copy->children.reserve(children.size());
+    for (const auto& child : children)
+      copy->children.push_back(child->Clone());
+    return copy;
+  }
+
+  void SetAttribute(const std::string& attribute_name,
+                    const std::string& value) {
+    // Like libxml, an attribute set again keeps its position.
+    for (auto& attribute : attributes) {
+      if (attribute.first == attribute_name) {
+        attribute.second = value;
+        return;
+      }
+    }
+    attributes.emplace_back(attribute_name, value);
+  }
+
+  void AddText(const std::string& content) {
+    if (content.empty())
+      return;
+    // Adjacent text is merged into a single text node, as libxml does.
+    if (!children.empty() && children.back()->name.empty()) {
+      children.back()->text += content;
+      return;
+    }
+    std::unique_ptr<Impl> text_node(new Impl);
+    text_node->text = content;
+    children.push_back(std::move(text_node));
+  }
+
+  void CollectNamespaces(std::set<std::string>* namespaces) const {
+    CollectNamespaceFromName(name, namespaces);
+    CollectNamespaceFromName(range_attribute, namespaces);
+    for (const auto& attribute : attributes)
+      CollectNamespaceFromName(attribute.first, namespaces);
+    for (const auto& child : children)
+      child->CollectNamespaces(namespaces);
+  }
+
+  // Appends to |patch| the MPD Patch operations, i.e. RFC 5261 XML patch
+  // operations, which turn |original|, selected by |selector|, into this
+  // element. The child elements are matched by their keys (see
+  // GetChildKeys()): the elements around the first run of matching elements
+  // are removed or added, and the matching elements are compared recursively.
+  // A live SegmentTimeline update thus becomes the removal of the S elements
+  // which left the window, the update of the last S@r and the addition of the
+  // new S elements.
+  void AddPatchOperations(const Impl& original,
+                          const std::string& selector,
+                          Impl* patch) const {
+    // The operations select the elements of the runs added by
+    // AddRangeElements() one by one, like the other elements.
+    if (HasRangeElements() || original.HasRangeElements()) {
+      ExpandRangeElements()->AddPatchOperations(
+          *original.ExpandRangeElements(), selector, patch);
+      return;
+    }
+
+    const std::vector<std::string> original_keys = original.GetChildKeys();
+    const std::vector<std::string> keys = GetChildKeys();
+    size_t original_begin = 0;
+    size_t begin = 0;
+    size_t length = 0;
+    for (size_t i = 0; i < original_keys.size() && length == 0; ++i) {
+      auto iter = std::find(keys.begin(), keys.end(), original_keys[i]);
+      if (iter == keys.end())
+        continue;
+      original_begin = i;
+      begin = iter - keys.begin();
+      while (original_begin + length < original_keys.size() &&
+             begin + length < keys.size() &&
+             original_keys[original_begin + length] == keys[begin + length]) {
+        ++length;
+      }
+    }
+
+    // Elements with text, and elements whose child elements all changed, are
+    // replaced as a whole.
+    if (HasText() || original.HasText() ||
+        (length == 0 && !children.empty() && !original.children.empty())) {
+      std::string xml;
+      std::string original_xml;
+      Write(0, /* format= */ false, &xml);
+      original.Write(0, /* format= */ false, &original_xml);
+      if (xml != original_xml)
+        patch->AddOperation("replace", selector)->children.push_back(Clone());
+      return;
+    }
+
+    for (const auto& attribute : attributes) {
+      const std::string* original_value =
+          original.FindAttribute(attribute.first);
+      if (!original_value) {
+        Impl* operation = patch->AddOperation("add", selector);
+        operation->SetAttribute("type", "@" + attribute.first);
+        operation->AddText(attribute.second);
+      } else if (*original_value != attribute.second) {
+        patch->AddOperation("replace", selector + "/@" + attribute.first)
+            ->AddText(attribute.second);
+      }
+    }
+    for (const auto& attribute : original.attributes) {
+      if (!FindAttribute(attribute.first))
+        patch->AddOperation("remove", selector + "/@" + attribute.first);
+    }
+
+    // The operations are applied in order, so the elements after the matching
+    // ones are removed first, from the last one, so that the positions of the
+    // others do not change, then the elements before them, each of which is
+    // the first one with its name when it is removed.
+    for (size_t i = original.children.size(); i > original_begin + length; --i)
+      patch->AddOperation("remove",
+                          selector + "/" + original.ChildSelector(i - 1, 0));
+    for (size_t i = 0; i < original_begin; ++i)
+      patch->AddOperation("remove",
+                          selector + "/" + original.ChildSelector(i, i));
+    // Only the matching elements are left.
+    for (size_t i = 0; i < length; ++i) {
+      children[begin + i]->AddPatchOperations(
+          *original.children[original_begin + i],
+          selector + "/" + ChildSelector(begin + i, begin), patch);
+    }
+    if (begin + length < children.size()) {
+      Impl* operation = patch->AddOperation("add", selector);
+      for (size_t i = begin + length; i < children.size(); ++i)
+        operation->children.push_back(children[i]->Clone());
+    }
+    if (begin > 0) {
+      Impl* operation = patch->AddOperation(
+          "add", selector + "/" + ChildSelector(begin, begin));
+      operation->SetAttribute("pos", "before");
+      for (size_t i = 0; i < begin; ++i)
+        operation->children.push_back(children[i]->Clone());
+    }
+  }
+
+  // Appends the node at |level| to |out|, formatted like
+  // xmlDocDumpFormatMemoryEnc() does if |format| is set: children are
+  // indented by two spaces per level, one per line, unless the element
+  // contains text.
+  void Write(int level, bool format, std::string* out) const {
+    if (name.empty()) {
+      AppendEscapedText(text, out);
+      return;
+    }
+    if (!range_attribute.empty()) {
+      WriteRangeElements(level, format, out);
+      return;
+    }
+    out->push_back('<');
+    out->append(name);
+    for (const auto& attribute : attributes)
+      AppendAttribute(attribute.first, attribute.second, out);
+    if (children.empty()) {
+      out->append("/>");
+      return;
+    }
+    out->push_back('>');
+
+    const bool format_children = format && !HasText();
+    if (format_children)
+      out->push_back('\n');
+    for (const auto& child : children) {
+      if (format_children)
+        out->append(2 * (level + 1), ' ');
+      child->Write(level + 1, format_children, out);
+      if (format_children)
+        out->push_back('\n');
+    }
+    if (format_children)
+      out->append(2 * level, ' ');
+    out->append("</");
+    out->append(name);
+    out->push_back('>');
+  }
+
+  // Appends the run of elements of a node added by AddRangeElements(), each
+  // on its own line at |level| if |format| is set.
+  void WriteRangeElements(int level, bool format, std::string* out) const {
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      if (i > 0 && format) {
+        out->push_back('\n');
+        out->append(2 * level, ' ');
+      }
+      out->push_back('<');
+      out->append(name);
+      out->push_back(' ');
+      out->append(range_attribute);
+      out->append("=\"");
+      AppendUint64(ranges[i].first, out);
+      out->push_back('-');
+      AppendUint64(ranges[i].second, out);
+      out->append("\"/>");
+    }
+  }
+
+  const std::string* FindAttribute(const std::string& attribute_name) const {
+    for (const auto& attribute : attributes) {
+      if (attribute.first == attribute_name)
+        return &attribute.second;
+    }
+    return nullptr;
+  }
+
+  bool HasText() const {
+    return std::any_of(children.begin(), children.end(),
+                       [](const std::unique_ptr<Impl>& child) {
+                         return child->name.empty();
+                       });
+  }
+
+  bool HasRangeElements() const {
+    return std::any_of(children.begin(), children.end(),
+                       [](const std::unique_ptr<Impl>& child) {
+                         return !child->range_attribute.empty();
+                       });
+  }
+
+  // Returns a copy of this element where the runs of elements added by
+  // AddRangeElements() are replaced with an element node per range.
+  std::unique_ptr<Impl> ExpandRangeElements() const {
+    std::unique_ptr<Impl> copy(new Impl);
+    copy->name = name;
+    copy->attributes = attributes;
+    for (const auto& child : children) {
+      if (child->range_attribute.empty()) {
+        copy->children.push_back(child->Clone());
+        continue;
+      }
+      for (const auto& range : child->ranges) {
+        std::unique_ptr<Impl> element(new Impl);
+        element->name = child->name;
+        element->SetAttribute(child->range_attribute,
+                              base::Uint64ToString(range.first) + "-" +
+                                  base::Uint64ToString(range.second));
+        copy->children.push_back(std::move(element));
+      }
+    }
+    return copy;
+  }
+
+  // Returns the keys which identify the child elements across MPD updates:
+  // the name and @id of the elements which have one, the start time of the S
+  // elements, whose @t may be omitted, and the name of the other elements.
+  std::vector<std::string> GetChildKeys() const {
+    std::vector<std::string> keys;
+    uint64_t start_time = 0;
+    for (const auto& child : children) {
+      const std::string* id = child->FindAttribute("id");
+      if (id) {
+        keys.push_back(child->name + "#" + *id);
+      } else if (child->name == "S") {
+        const std::string* t = child->FindAttribute("t");
+        const std::string* d = child->FindAttribute("d");
+        const std::string* r = child->FindAttribute("r");
+        uint64_t duration = 0;
+        uint64_t repeat = 0;
+        if (t)
+          base::StringToUint64(*t, &start_time);
+        if (d)
+          base::StringToUint64(*d, &duration);
+        if (r)
+          base::StringToUint64(*r, &repeat);
+        keys.push_back("S@" + base::Uint64ToString(start_time));
+        start_time += duration * (repeat + 1);
+      } else {
+        keys.push_back(child->name);
+      }
+    }
+    return keys;
+  }
+
+  // Returns the XPath selector of the child element at |index|, relative to
+  // this element, if the elements before |first| are not there.
+  std::string ChildSelector(size_t index, size_t first) const {
+    const Impl& child = *children[index];
+    const std::string* id = child.FindAttribute("id");
+    if (id)
+      return child.name + "[@id='" + *id + "']";
+    size_t position = 0;
+    for (size_t i = first; i <= index; ++i) {
+      if (children[i]->name == child.name)
+        ++position;
+    }
+    return child.name + "[" + base::SizeTToString(position) + "]";
+  }
+
+  Impl* AddOperation(const std::string& operation,
+                     const std::string& selector) {
+    std::unique_ptr<Impl> node(new Impl);
+    node->name = operation;
+    node->SetAttribute("sel", selector);
+    children.push_back(std::move(node));
+    return children.back().get();
+  }
+
+  // The name of the element, or empty for a text node.
+  std::string name;
+  // The attributes in the order they are first set.
+  std::vector<std::pair<std::string, std::string>> attributes;
+  // The text of a text node.
+  std::string text;
+  // The child elements and text nodes in document order.
+  std::vector<std::unique_ptr<Impl>> children;
+  // For a run of empty elements named |name| added by AddRangeElements(), the
+  // attribute set to the ranges and the ranges. The elements are written
+  // directly from them instead of being nodes of their own.
+  std::string range_attribute;
+  std::vector<std::pair<uint64_t, uint64_t>> ranges;
 };
 
 XmlNode::XmlNode(const std::string& name) : impl_(new Impl) {
-  impl_->node.reset(xmlNewNode(NULL, BAD_CAST name.c_str()));
-  DCHECK(impl_->node);
+  DCHECK(!name.empty());
+  impl_->name = name;
 }
 
 XmlNode::XmlNode(XmlNode&&) = default;
@@ -138,68 +522,66 @@ XmlNode::~XmlNode() {}
 
 XmlNode& XmlNode::operator=(XmlNode&&) = default;
 
+XmlNode XmlNode::Clone() const {
+  XmlNode copy(impl_->name);
+  copy.impl_ = impl_->Clone();
+  return copy;
+}
+
 bool XmlNode::AddChild(XmlNode child) {
-  DCHECK(impl_->node);
-  DCHECK(child.impl_->node);
-  RCHECK(xmlAddChild(impl_->node.get(), child.impl_->node.get()));
+  DCHECK(impl_);
+  DCHECK(child.impl_);
+  impl_->children.push_back(std::move(child.impl_));
+  return true;
+}
 
-  // Reaching here means the ownership of |child| transfered to |node|.
-  // Release the pointer so that it doesn't get destructed in this scope.
-  ignore_result(child.impl_->node.release());
+bool XmlNode::AddRangeElements(
+    const std::string& name,
+    const std::string& attribute_name,
+    const google::protobuf::RepeatedPtrField<Range>& ranges) {
+  DCHECK(impl_);
+  DCHECK(!name.empty());
+  DCHECK(!attribute_name.empty());
+  if (ranges.empty())
+    return true;
+  std::unique_ptr<Impl> run(new Impl);
+  run->name = name;
+  run->range_attribute = attribute_name;
+  run->ranges.reserve(ranges.size());
+  for (const Range& range : ranges)
+    run->ranges.emplace_back(range.begin(), range.end());
+  impl_->children.push_back(std::move(run));
   return true;
 }
 
 bool XmlNode::AddElements(const std::vector<Element>& elements) {
-  for (size_t element_index = 0; element_index < elements.size();
-       ++element_index) {
-    const Element& child_element = elements[element_index];
+  for (const Element& child_element : elements) {
     XmlNode child_node(child_element.name);
-    for (std::map<std::string, std::string>::const_iterator attribute_it =
-             child_element.attributes.begin();
-         attribute_it != child_element.attributes.end(); ++attribute_it) {
-      RCHECK(child_node.SetStringAttribute(attribute_it->first,
-                                           attribute_it->second));
-    }
-
-    // Note that somehow |SetContent| needs to be called before |AddElements|
-    // otherwise the added children will be overwritten by the content.
+    for (const auto& attribute : child_element.attributes)
+      RCHECK(child_node.SetStringAttribute(attribute.first, attribute.second));
     child_node.SetContent(child_element.content);
-
     // Recursively set children for the child.
     RCHECK(child_node.AddElements(child_element.subelements));
-
-    if (!xmlAddChild(impl_->node.get(), child_node.impl_->node.get())) {
-      LOG(ERROR) << "Failed to set child " << child_element.name
-                 << " to parent element "
-                 << reinterpret_cast<const char*>(impl_->node->name);
-      return false;
-    }
-    // Reaching here means the ownership of |child_node| transfered to |node|.
-    // Release the pointer so that it doesn't get destructed in this scope.
-    child_node.impl_->node.release();
+    RCHECK(AddChild(std::move(child_node)));
   }
   return true;
 }
 
 bool XmlNode::SetStringAttribute(const std::string& attribute_name,
                                  const std::string& attribute) {
-  DCHECK(impl_->node);
-  return xmlSetProp(impl_->node.get(), BAD_CAST attribute_name.c_str(),
-                    BAD_CAST attribute.c_str()) != nullptr;
+  DCHECK(impl_);
+  impl_->SetAttribute(attribute_name, attribute);
+  return true;
 }
 
 bool XmlNode::SetIntegerAttribute(const std::string& attribute_name,
                                   uint64_t number) {
-  DCHECK(impl_->node);
-  return xmlSetProp(impl_->node.get(), BAD_CAST attribute_name.c_str(),
-                    BAD_CAST(base::Uint64ToString(number).c_str())) != nullptr;
+  return SetStringAttribute(attribute_name, base::Uint64ToString(number));
 }
 
 bool XmlNode::SetFloatingPointAttribute(const std::string& attribute_name,
                                         double number) {
-  DCHECK(impl_->node);
-  return xmlSetProp(impl_->node.get(), BAD_CAST attribute_name.c_str(),
-                    BAD_CAST(base::DoubleToString(number).c_str())) != nullptr;
+  return SetStringAttribute(attribute_name, base::DoubleToString(number));
 }
 
 bool XmlNode::SetId(uint32_t id) {
@@ -207,58 +589,47 @@ bool XmlNode::SetId(uint32_t id) {
 }
 
 void XmlNode::AddContent(const std::string& content) {
-  DCHECK(impl_->node);
-  xmlNodeAddContent(impl_->node.get(), BAD_CAST content.c_str());
+  DCHECK(impl_);
+  impl_->AddText(content);
 }
 
 void XmlNode::SetContent(const std::string& content) {
-  DCHECK(impl_->node);
-  xmlNodeSetContent(impl_->node.get(), BAD_CAST content.c_str());
+  DCHECK(impl_);
+  impl_->children.clear();
+  impl_->AddText(content);
 }
 
 std::set<std::string> XmlNode::ExtractReferencedNamespaces() const {
   std::set<std::string> namespaces;
-  TraverseNodesAndCollectNamespaces(impl_->node.get(), &namespaces);
+  impl_->CollectNamespaces(&namespaces);
   return namespaces;
 }
 
 std::string XmlNode::ToString(const std::string& comment) const {
-  // Create an xmlDoc from xmlNodePtr. The node is copied so ownership does not
-  // transfer.
-  xml::scoped_xml_ptr<xmlDoc> doc(xmlNewDoc(BAD_CAST "1.0"));
-  if (comment.empty()) {
-    xmlDocSetRootElement(doc.get(), xmlCopyNode(impl_->node.get(), true));
-  } else {
-    xml::scoped_xml_ptr<xmlNode> comment_xml(
-        xmlNewDocComment(doc.get(), BAD_CAST comment.c_str()));
-    xmlDocSetRootElement(doc.get(), comment_xml.get());
-    xmlAddSibling(comment_xml.release(), xmlCopyNode(impl_->node.get(), true));
-  }
-
-  // Format the xmlDoc to string.
-  static const int kNiceFormat = 1;
-  int doc_str_size = 0;
-  xmlChar* doc_str = nullptr;
-  xmlDocDumpFormatMemoryEnc(doc.get(), &doc_str, &doc_str_size, "UTF-8",
-                            kNiceFormat);
-  std::string output(doc_str, doc_str + doc_str_size);
-  xmlFree(doc_str);
+  std::string output = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+  if (!comment.empty())
+    output += "<!--" + comment + "-->\n";
+  impl_->Write(0, /* format= */ true, &output);
+  output.push_back('\n');
   return output;
 }
 
+void XmlNode::AddPatchOperations(const XmlNode& original,
+                                 XmlNode* patch) const {
+  DCHECK(patch);
+  DCHECK_EQ(impl_->name, original.impl_->name);
+  impl_->AddPatchOperations(*original.impl_, "/" + impl_->name,
+                            patch->impl_.get());
+}
+
 bool XmlNode::GetAttribute(const std::string& name, std::string* value) const {
-  xml::scoped_xml_ptr<xmlChar> str(
-      xmlGetProp(impl_->node.get(), BAD_CAST name.c_str()));
-  if (!str)
+  const std::string* attribute = impl_->FindAttribute(name);
+  if (!attribute)
     return false;
-  *value = reinterpret_cast<const char*>(str.get());
+  *value = *attribute;
   return true;
 }
 
-xmlNode* XmlNode::GetRawPtr() const {
-  return impl_->node.get();
-}
-
 RepresentationBaseXmlNode::RepresentationBaseXmlNode(const std::string& name)
     : XmlNode(name) {}
 RepresentationBaseXmlNode::~RepresentationBaseXmlNode() {}
@@ -442,15 +813,11 @@ bool RepresentationXmlNode::AddVODOnlyInfo(const MediaInfo& media_info,
   }
 
   // Since the SegmentURLs here do not have a @media element,
-  // BaseURL element is mapped to the @media attribute.
+  // BaseURL element is mapped to the @media attribute. There is one per
+  // subsegment, so they are written directly from the ranges.
   if (use_segment_list) {
-    for (const Range& subsegment_range : media_info.subsegment_ranges()) {
-      XmlNode subsegment("SegmentURL");
-      RCHECK(subsegment.SetStringAttribute("mediaRange",
-                                           RangeToString(subsegment_range)));
-
-      RCHECK(child.AddChild(std::move(subsegment)));
-    }
+    RCHECK(child.AddRangeElements("SegmentURL", "mediaRange",
+                                  media_info.subsegment_ranges()));
   }
 
   RCHECK(AddChild(std::move(child)));
@@ -459,8 +826,9 @@ bool RepresentationXmlNode::AddVODOnlyInfo(const MediaInfo& media_info,
 
 bool RepresentationXmlNode::AddLiveOnlyInfo(
     const MediaInfo& media_info,
-    const std::list<SegmentInfo>& segment_infos,
-    uint32_t start_number) {
+    const std::deque<SegmentInfo>& segment_infos,
+    uint32_t start_number,
+    double availability_time_offset) {
   XmlNode segment_template("SegmentTemplate");
   if (media_info.has_reference_time_scale()) {
     RCHECK(segment_template.SetIntegerAttribute(
@@ -483,6 +851,13 @@ bool RepresentationXmlNode::AddLiveOnlyInfo(
     RCHECK(segment_template.SetIntegerAttribute("startNumber", start_number));
   }
 
+  if (availability_time_offset > 0) {
+    RCHECK(segment_template.SetFloatingPointAttribute(
+        "availabilityTimeOffset", availability_time_offset));
+    RCHECK(segment_template.SetStringAttribute("availabilityTimeComplete",
+                                               "false"));
+  }
+
   if (!segment_infos.empty()) {
     // Don't use SegmentTimeline if all segments except the last one are of
     // the same duration.
@@ -4,15 +4,18 @@
 // license that can be found in the LICENSE file or at
 // https://developers.google.com/open-source/licenses/bsd
 //
-// Classes to wrap XML operations. XmlNode is a generic wrapper class for
-// XmlNode in libxml2. There are also MPD XML specific classes as well.
+// Classes to build XML documents. XmlNode is a generic XML element, which is
+// written directly as text instead of through a libxml2 DOM. There are also MPD
+// XML specific classes as well.
 
 #ifndef MPD_BASE_XML_XML_NODE_H_
 #define MPD_BASE_XML_XML_NODE_H_
 
 #include <stdint.h>
 
+#include <deque>
 #include <list>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -22,20 +25,11 @@
 #include "packager/mpd/base/content_protection_element.h"
 #include "packager/mpd/base/media_info.pb.h"
 
-typedef struct _xmlNode xmlNode;
-
 namespace shaka {
 
 class MpdBuilder;
 struct SegmentInfo;
 
-namespace xml {
-class XmlNode;
-}  // namespace xml
-
-// Defined in tests under mpd/test/xml_compare.h
-bool XmlEqual(const std::string& xml1, const xml::XmlNode& xml2);
-
 namespace xml {
 
 /// These classes are wrapper classes for XML elements for generating MPD.
@@ -56,6 +50,16 @@ class XmlNode {
   /// @return true on success, false otherwise.
   bool AddChild(XmlNode child) WARN_UNUSED_RESULT;
 
+  /// Adds an empty child element named @a name per range in @a ranges, with
+  /// the attribute @a attribute_name set to the range, e.g.
+  /// <SegmentURL mediaRange="0-99"/>. The elements are written directly from
+  /// the ranges instead of being built as nodes, which keeps lists of tens of
+  /// thousands of elements cheap.
+  bool AddRangeElements(const std::string& name,
+                        const std::string& attribute_name,
+                        const google::protobuf::RepeatedPtrField<Range>& ranges)
+      WARN_UNUSED_RESULT;
+
   /// Adds Elements to this node using the Element struct.
   bool AddElements(const std::vector<Element>& elements) WARN_UNUSED_RESULT;
 
@@ -84,21 +88,31 @@ class XmlNode {
   /// Similar to SetContent, but appends to the end of existing content.
   void AddContent(const std::string& content);
 
-  /// Set the contents of an XML element using a string.
-  /// This cannot set child elements because <> will become &lt; and &rt;
+  /// Set the contents of an XML element using a string, replacing its
+  /// children.
+  /// This cannot set child elements because <> will become &lt; and &gt;
   /// This should be used to set the text for the element, e.g. setting
   /// a URL for <BaseURL> element.
   /// @param content is a string containing the text-encoded child elements to
   ///        be added to the element.
   void SetContent(const std::string& content);
 
+  /// @return A deep copy of this element and its descendants.
+  XmlNode Clone() const;
+
   /// @return namespaces used in the node and its descendents.
   std::set<std::string> ExtractReferencedNamespaces() const;
 
   /// @param comment The body of a comment to add to the top of the XML.
-  /// @return A string containing the XML.
+  /// @return A string containing the XML, formatted like libxml2 does.
   std::string ToString(const std::string& comment) const;
 
+  /// Adds the MPD Patch operations, i.e. RFC 5261 XML patch operations, which
+  /// turn @a original into this element to @a patch.
+  /// @param original is the previous version of this element.
+  /// @param patch is the Patch element to add the operations to.
+  void AddPatchOperations(const XmlNode& original, XmlNode* patch) const;
+
   /// Gets the attribute with the given name.
   /// @param name The name of the attribute to get.
   /// @param value [OUT] where to put the resulting value.
@@ -106,13 +120,8 @@ class XmlNode {
   bool GetAttribute(const std::string& name, std::string* value) const;
 
  private:
-  friend bool shaka::XmlEqual(const std::string& xml1,
-                              const xml::XmlNode& xml2);
-  xmlNode* GetRawPtr() const;
-
-  // Don't use xmlNode directly so we don't have to forward-declare a bunch of
-  // libxml types to define the scoped_xml_ptr type.  This allows us to only
-  // include libxml headers in a few source files.
+  // The element, its attributes and its children. Moving an XmlNode, e.g. to
+  // add it as a child, does not copy them.
   class Impl;
   std::unique_ptr<Impl> impl_;
 
@@ -217,9 +226,14 @@ class RepresentationXmlNode : public RepresentationBaseXmlNode {
 
   /// @param segment_infos is a set of SegmentInfos. This method assumes that
   ///        SegmentInfos are sorted by its start time.
+  /// @param availability_time_offset is the availabilityTimeOffset, in
+  ///        seconds, of the segments written in chunks for low latency
+  ///        streaming. availabilityTimeComplete is set to false along with it.
+  ///        Neither is set if it is not positive.
   bool AddLiveOnlyInfo(const MediaInfo& media_info,
-                       const std::list<SegmentInfo>& segment_infos,
-                       uint32_t start_number) WARN_UNUSED_RESULT;
+                       const std::deque<SegmentInfo>& segment_infos,
+                       uint32_t start_number,
+                       double availability_time_offset) WARN_UNUSED_RESULT;
 
  private:
   // Add AudioChannelConfiguration element. Note that it is a required element
@@ -234,6 +248,16 @@ class RepresentationXmlNode : public RepresentationBaseXmlNode {
   DISALLOW_COPY_AND_ASSIGN(RepresentationXmlNode);
 };
 
+/// Appends @a text to @a out, escaped as the content of an element the same
+/// way libxml2 escapes it.
+void AppendEscapedText(const std::string& text, std::string* out);
+
+/// Appends the attribute @a name to @a out, with @a value escaped the same
+/// way libxml2 escapes attribute values, e.g. ` name="a &amp; b"`.
+void AppendAttribute(const std::string& name,
+                     const std::string& value,
+                     std::string* out);
+
 }  // namespace xml
 }  // namespace shaka
 #endif  // MPD_BASE_XML_XML_NODE_H_
@@ -9,6 +9,7 @@
 #include <gtest/gtest.h>
 #include <libxml/tree.h>
 
+#include <deque>
 #include <list>
 
 #include "packager/base/logging.h"
@@ -20,6 +21,7 @@
 
 DECLARE_bool(segment_template_constant_duration);
 DECLARE_bool(dash_add_last_segment_number_when_needed);
+DECLARE_bool(dash_compact_segment_timeline);
 
 
 using ::testing::ElementsAre;
@@ -29,6 +31,8 @@ namespace xml {
 
 namespace {
 
+const double kNoAvailabilityTimeOffset = 0;
+
 // Template so that it works for ContentProtectionXml and
 // ContentProtectionXml::Element.
 template <typename XmlElement>
@@ -179,6 +183,197 @@ TEST(XmlNodeTest, ExtractReferencedNamespacesFromAttributes) {
 // namespaces without context, e.g. <cenc:pssh> element.
 // The MpdBuilderTests work because the MPD element has xmlns:cenc attribute.
 // Tests that have <cenc:pssh> is in mpd_builder_unittest.
+TEST(XmlNodeTest, ToString) {
+  XmlNode empty_child("EmptyChild");
+  ASSERT_TRUE(empty_child.SetStringAttribute("a", "1"));
+  ASSERT_TRUE(empty_child.SetIntegerAttribute("b", 2));
+  // Setting an attribute again keeps its position.
+  ASSERT_TRUE(empty_child.SetStringAttribute("a", "<1> & \"2\""));
+
+  XmlNode text_child("TextChild");
+  text_child.SetContent("a < b & c");
+
+  // The children of an element with text are not formatted.
+  XmlNode mixed_child("MixedChild");
+  mixed_child.AddContent("text");
+  ASSERT_TRUE(mixed_child.AddChild(XmlNode("Inline")));
+
+  XmlNode nested_child("NestedChild");
+  ASSERT_TRUE(nested_child.AddChild(std::move(text_child)));
+
+  XmlNode root("Root");
+  ASSERT_TRUE(root.AddChild(std::move(empty_child)));
+  ASSERT_TRUE(root.AddChild(std::move(nested_child)));
+  ASSERT_TRUE(root.AddChild(std::move(mixed_child)));
+
+  EXPECT_EQ(
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<!--comment-->\n"
+      "<Root>\n"
+      "  <EmptyChild a=\"&lt;1&gt; &amp; &quot;2&quot;\" b=\"2\"/>\n"
+      "  <NestedChild>\n"
+      "    <TextChild>a &lt; b &amp; c</TextChild>\n"
+      "  </NestedChild>\n"
+      "  <MixedChild>text<Inline/></MixedChild>\n"
+      "</Root>\n",
+      root.ToString("comment"));
+}
+
+TEST(XmlNodeTest, AddRangeElements) {
+  google::protobuf::RepeatedPtrField<Range> ranges;
+  Range* range = ranges.Add();
+  range->set_begin(0);
+  range->set_end(99);
+  range = ranges.Add();
+  range->set_begin(100);
+  range->set_end(18446744073709551615ULL);
+
+  XmlNode list("List");
+  ASSERT_TRUE(list.AddChild(XmlNode("First")));
+  ASSERT_TRUE(list.AddRangeElements("Item", "range", ranges));
+  ASSERT_TRUE(list.AddRangeElements(
+      "Item", "range", google::protobuf::RepeatedPtrField<Range>()));
+  XmlNode root("Root");
+  ASSERT_TRUE(root.AddChild(list.Clone()));
+
+  EXPECT_EQ(
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<Root>\n"
+      "  <List>\n"
+      "    <First/>\n"
+      "    <Item range=\"0-99\"/>\n"
+      "    <Item range=\"100-18446744073709551615\"/>\n"
+      "  </List>\n"
+      "</Root>\n",
+      root.ToString(""));
+  EXPECT_THAT(list, XmlNodeEqual("<List>"
+                                 "<First/>"
+                                 "<Item range=\"0-99\"/>"
+                                 "<Item range=\"100-18446744073709551615\"/>"
+                                 "</List>"));
+}
+
+TEST(XmlNodeTest, SetContentReplacesChildren) {
+  XmlNode node("A");
+  ASSERT_TRUE(node.AddChild(XmlNode("B")));
+  node.SetContent("content1");
+  node.AddContent("content2");
+  EXPECT_THAT(node, XmlNodeEqual("<A>content1content2</A>"));
+
+  XmlNode clone = node.Clone();
+  clone.SetContent("");
+  EXPECT_THAT(clone, XmlNodeEqual("<A/>"));
+  EXPECT_THAT(node, XmlNodeEqual("<A>content1content2</A>"));
+}
+
+TEST(XmlNodeTest, AddPatchOperations) {
+  // Makes an MPD with a SegmentTimeline of |segments|, where S@t is omitted
+  // if it is negative.
+  struct Segment {
+    int64_t t;
+    uint64_t d;
+    uint64_t r;
+  };
+  auto make_mpd = [](const std::string& publish_time,
+                     const std::vector<Segment>& segments) {
+    XmlNode segment_timeline("SegmentTimeline");
+    for (const Segment& segment : segments) {
+      XmlNode s("S");
+      if (segment.t >= 0)
+        EXPECT_TRUE(s.SetIntegerAttribute("t", segment.t));
+      EXPECT_TRUE(s.SetIntegerAttribute("d", segment.d));
+      if (segment.r > 0)
+        EXPECT_TRUE(s.SetIntegerAttribute("r", segment.r));
+      EXPECT_TRUE(segment_timeline.AddChild(std::move(s)));
+    }
+    XmlNode segment_template("SegmentTemplate");
+    EXPECT_TRUE(segment_template.AddChild(std::move(segment_timeline)));
+    XmlNode adaptation_set("AdaptationSet");
+    EXPECT_TRUE(adaptation_set.SetId(1));
+    EXPECT_TRUE(adaptation_set.AddChild(std::move(segment_template)));
+    XmlNode period("Period");
+    EXPECT_TRUE(period.SetId(0));
+    EXPECT_TRUE(period.AddChild(std::move(adaptation_set)));
+    XmlNode base_url("BaseURL");
+    base_url.SetContent("http://example.com/");
+    XmlNode mpd("MPD");
+    EXPECT_TRUE(mpd.SetStringAttribute("publishTime", publish_time));
+    EXPECT_TRUE(mpd.AddChild(std::move(base_url)));
+    EXPECT_TRUE(mpd.AddChild(std::move(period)));
+    return mpd;
+  };
+
+  // The first S element leaves the window, the last one is repeated and a new
+  // one is added.
+  XmlNode original = make_mpd("1", {{0, 2, 2}, {-1, 3, 0}, {-1, 2, 1}});
+  XmlNode mpd = make_mpd("2", {{6, 3, 0}, {-1, 2, 2}, {-1, 4, 0}});
+
+  XmlNode patch("Patch");
+  mpd.AddPatchOperations(original, &patch);
+  const std::string kTimeline =
+      "/MPD/Period[@id='0']/AdaptationSet[@id='1']/SegmentTemplate[1]/"
+      "SegmentTimeline[1]";
+  EXPECT_EQ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<Patch>\n"
+            "  <replace sel=\"/MPD/@publishTime\">2</replace>\n"
+            "  <remove sel=\"" + kTimeline + "/S[1]\"/>\n"
+            "  <add sel=\"" + kTimeline + "/S[1]\" type=\"@t\">6</add>\n"
+            "  <replace sel=\"" + kTimeline + "/S[2]/@r\">2</replace>\n"
+            "  <add sel=\"" + kTimeline + "\">\n"
+            "    <S d=\"4\"/>\n"
+            "  </add>\n"
+            "</Patch>\n",
+            patch.ToString(""));
+
+  // There are no operations if nothing changed.
+  XmlNode empty_patch("Patch");
+  mpd.AddPatchOperations(mpd.Clone(), &empty_patch);
+  EXPECT_THAT(empty_patch, XmlNodeEqual("<Patch/>"));
+}
+
+// The elements added by AddRangeElements() are patched one by one.
+TEST(XmlNodeTest, AddPatchOperationsWithRangeElements) {
+  auto make_representation = [](const std::vector<uint64_t>& range_ends) {
+    google::protobuf::RepeatedPtrField<Range> ranges;
+    uint64_t begin = 0;
+    for (uint64_t end : range_ends) {
+      Range* range = ranges.Add();
+      range->set_begin(begin);
+      range->set_end(end);
+      begin = end + 1;
+    }
+    XmlNode segment_list("SegmentList");
+    EXPECT_TRUE(segment_list.AddChild(XmlNode("Initialization")));
+    EXPECT_TRUE(segment_list.AddRangeElements("SegmentURL", "mediaRange",
+                                              ranges));
+    XmlNode representation("Representation");
+    EXPECT_TRUE(representation.SetId(1));
+    EXPECT_TRUE(representation.AddChild(std::move(segment_list)));
+    return representation;
+  };
+
+  // The last range grows and a range is added.
+  XmlNode original = make_representation({99, 199});
+  XmlNode representation = make_representation({99, 249, 299});
+
+  XmlNode patch("Patch");
+  representation.AddPatchOperations(original, &patch);
+  const std::string kSegmentList = "/Representation/SegmentList[1]";
+  EXPECT_EQ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<Patch>\n"
+            "  <replace sel=\"" + kSegmentList +
+                "/SegmentURL[2]/@mediaRange\">100-249</replace>\n"
+            "  <add sel=\"" + kSegmentList + "\">\n"
+            "    <SegmentURL mediaRange=\"250-299\"/>\n"
+            "  </add>\n"
+            "</Patch>\n",
+            patch.ToString(""));
+
+  XmlNode empty_patch("Patch");
+  representation.AddPatchOperations(representation.Clone(), &empty_patch);
+  EXPECT_THAT(empty_patch, XmlNodeEqual("<Patch/>"));
+}
+
 TEST(XmlNodeTest, AddContentProtectionElements) {
   std::list<ContentProtectionElement> content_protections;
   ContentProtectionElement content_protection_widevine;
@@ -369,12 +564,12 @@ TEST_F(LiveSegmentTimelineTest, OneSegmentInfo) {
   const uint64_t kDuration = 100;
   const uint64_t kRepeat = 9;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kStartTime, kDuration, kRepeat},
   };
   RepresentationXmlNode representation;
-  ASSERT_TRUE(
-      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber));
+  ASSERT_TRUE(representation.AddLiveOnlyInfo(
+      media_info_, segment_infos, kStartNumber, kNoAvailabilityTimeOffset));
 
   EXPECT_THAT(
       representation,
@@ -390,12 +585,12 @@ TEST_F(LiveSegmentTimelineTest, OneSegmentInfoNonZeroStartTime) {
   const uint64_t kDuration = 100;
   const uint64_t kRepeat = 9;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kNonZeroStartTime, kDuration, kRepeat},
   };
   RepresentationXmlNode representation;
-  ASSERT_TRUE(
-      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber));
+  ASSERT_TRUE(representation.AddLiveOnlyInfo(
+      media_info_, segment_infos, kStartNumber, kNoAvailabilityTimeOffset));
 
   EXPECT_THAT(representation,
               XmlNodeEqual(
@@ -414,12 +609,12 @@ TEST_F(LiveSegmentTimelineTest, OneSegmentInfoMatchingStartTimeAndNumber) {
   const uint64_t kDuration = 100;
   const uint64_t kRepeat = 9;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kNonZeroStartTime, kDuration, kRepeat},
   };
   RepresentationXmlNode representation;
-  ASSERT_TRUE(
-      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber));
+  ASSERT_TRUE(representation.AddLiveOnlyInfo(
+      media_info_, segment_infos, kStartNumber, kNoAvailabilityTimeOffset));
 
   EXPECT_THAT(
       representation,
@@ -440,13 +635,13 @@ TEST_F(LiveSegmentTimelineTest, AllSegmentsSameDurationExpectLastOne) {
   const uint64_t kDuration2 = 200;
   const uint64_t kRepeat2 = 0;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kStartTime1, kDuration1, kRepeat1},
       {kStartTime2, kDuration2, kRepeat2},
   };
   RepresentationXmlNode representation;
-  ASSERT_TRUE(
-      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber));
+  ASSERT_TRUE(representation.AddLiveOnlyInfo(
+      media_info_, segment_infos, kStartNumber, kNoAvailabilityTimeOffset));
 
   EXPECT_THAT(
       representation,
@@ -467,13 +662,13 @@ TEST_F(LiveSegmentTimelineTest, SecondSegmentInfoNonZeroRepeat) {
   const uint64_t kDuration2 = 200;
   const uint64_t kRepeat2 = 1;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kStartTime1, kDuration1, kRepeat1},
       {kStartTime2, kDuration2, kRepeat2},
   };
   RepresentationXmlNode representation;
-  ASSERT_TRUE(
-      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber));
+  ASSERT_TRUE(representation.AddLiveOnlyInfo(
+      media_info_, segment_infos, kStartNumber, kNoAvailabilityTimeOffset));
 
   EXPECT_THAT(representation,
               XmlNodeEqual(
@@ -499,13 +694,13 @@ TEST_F(LiveSegmentTimelineTest, TwoSegmentInfoWithGap) {
   const uint64_t kDuration2 = 200;
   const uint64_t kRepeat2 = 0;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kStartTime1, kDuration1, kRepeat1},
       {kStartTime2, kDuration2, kRepeat2},
   };
   RepresentationXmlNode representation;
-  ASSERT_TRUE(
-      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber));
+  ASSERT_TRUE(representation.AddLiveOnlyInfo(
+      media_info_, segment_infos, kStartNumber, kNoAvailabilityTimeOffset));
 
   EXPECT_THAT(representation,
               XmlNodeEqual(
@@ -519,20 +714,62 @@ TEST_F(LiveSegmentTimelineTest, TwoSegmentInfoWithGap) {
                   "</Representation>"));
 }
 
+TEST_F(LiveSegmentTimelineTest, CompactSegmentTimeline) {
+  const uint32_t kStartNumber = 1;
+
+  const uint64_t kStartTime1 = 0;
+  const uint64_t kDuration1 = 100;
+  const uint64_t kRepeat1 = 9;
+
+  const uint64_t kStartTime2 = kStartTime1 + (kRepeat1 + 1) * kDuration1;
+  const uint64_t kDuration2 = 200;
+  const uint64_t kRepeat2 = 1;
+
+  const uint64_t kGap = 100;
+  const uint64_t kStartTime3 =
+      kGap + kStartTime2 + (kRepeat2 + 1) * kDuration2;
+  const uint64_t kDuration3 = 100;
+  const uint64_t kRepeat3 = 0;
+
+  std::deque<SegmentInfo> segment_infos = {
+      {kStartTime1, kDuration1, kRepeat1},
+      {kStartTime2, kDuration2, kRepeat2},
+      {kStartTime3, kDuration3, kRepeat3},
+  };
+  RepresentationXmlNode representation;
+  FLAGS_dash_compact_segment_timeline = true;
+
+  ASSERT_TRUE(representation.AddLiveOnlyInfo(
+      media_info_, segment_infos, kStartNumber, kNoAvailabilityTimeOffset));
+
+  EXPECT_THAT(representation,
+              XmlNodeEqual(
+                  "<Representation>"
+                  "  <SegmentTemplate media=\"$Number$.m4s\" startNumber=\"1\">"
+                  "    <SegmentTimeline>"
+                  "      <S t=\"0\" d=\"100\" r=\"9\"/>"
+                  "      <S d=\"200\" r=\"1\"/>"
+                  "      <S t=\"1500\" d=\"100\"/>"
+                  "    </SegmentTimeline>"
+                  "  </SegmentTemplate>"
+                  "</Representation>"));
+  FLAGS_dash_compact_segment_timeline = false;
+}
+
 TEST_F(LiveSegmentTimelineTest, LastSegmentNumberSupplementalProperty) {
   const uint32_t kStartNumber = 1;
   const uint64_t kStartTime = 0;
   const uint64_t kDuration = 100;
   const uint64_t kRepeat = 9;
 
-  std::list<SegmentInfo> segment_infos = {
+  std::deque<SegmentInfo> segment_infos = {
       {kStartTime, kDuration, kRepeat},
   };
   RepresentationXmlNode representation;
   FLAGS_dash_add_last_segment_number_when_needed = true;
 
-  ASSERT_TRUE(
-      representation.AddLiveOnlyInfo(media_info_, segment_infos, kStartNumber));
+  ASSERT_TRUE(representation.AddLiveOnlyInfo(
+      media_info_, segment_infos, kStartNumber, kNoAvailabilityTimeOffset));
 
   EXPECT_THAT(
       representation,
@@ -545,6 +782,31 @@ TEST_F(LiveSegmentTimelineTest, LastSegmentNumberSupplementalProperty) {
   FLAGS_dash_add_last_segment_number_when_needed = false;
 }
 
+TEST_F(LiveSegmentTimelineTest, AvailabilityTimeOffset) {
+  const uint32_t kStartNumber = 1;
+  const uint64_t kStartTime = 0;
+  const uint64_t kDuration = 100;
+  const uint64_t kRepeat = 9;
+  const double kAvailabilityTimeOffset = 1.5;
+
+  std::deque<SegmentInfo> segment_infos = {
+      {kStartTime, kDuration, kRepeat},
+  };
+  RepresentationXmlNode representation;
+  ASSERT_TRUE(representation.AddLiveOnlyInfo(
+      media_info_, segment_infos, kStartNumber, kAvailabilityTimeOffset));
+
+  EXPECT_THAT(
+      representation,
+      XmlNodeEqual("<Representation>"
+                   "  <SegmentTemplate media=\"$Number$.m4s\" "
+                   "                   startNumber=\"1\" "
+                   "                   availabilityTimeOffset=\"1.5\" "
+                   "                   availabilityTimeComplete=\"false\" "
+                   "                   duration=\"100\"/>"
+                   "</Representation>"));
+}
+
 // Creating a separate Test Suite for RepresentationXmlNode::AddVODOnlyInfo
 class OnDemandVODSegmentTest : public ::testing::Test {
 };
@@ -715,5 +977,17 @@ TEST_F(OnDemandVODSegmentTest, SegmentUrlWithMediaRanges) {
                    "</Representation>"));
 }
 
+TEST(XmlEscapeTest, AppendEscapedText) {
+  std::string out = "<p>";
+  AppendEscapedText("a < b && \"c\"\r\n", &out);
+  EXPECT_EQ("<p>a &lt; b &amp;&amp; \"c\"&#13;\n", out);
+}
+
+TEST(XmlEscapeTest, AppendAttribute) {
+  std::string out = "<p";
+  AppendAttribute("title", "a < \"b\"\t&\n", &out);
+  EXPECT_EQ("<p title=\"a &lt; &quot;b&quot;&#9;&amp;&#10;\"", out);
+}
+
 }  // namespace xml
 }  // namespace shaka
@@ -29,11 +29,22 @@
       'target_name': 'manifest_base',
       'type': 'static_library',
       'sources': [
+        'base/async_manifest_writer.cc',
+        'base/async_manifest_writer.h',
         'base/bandwidth_estimator.cc',
         'base/bandwidth_estimator.h',
+        'base/manifest_checkpoint.cc',
+        'base/manifest_checkpoint.h',
+        'base/manifest_file_writer.cc',
+        'base/manifest_file_writer.h',
+        'base/manifest_write_coalescer.cc',
+        'base/manifest_write_coalescer.h',
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        '../file/file.gyp:file',
+        '../media/base/media_base.gyp:media_base',
+        '../third_party/gflags/gflags.gyp:gflags',
       ],
     },
     {
@@ -44,6 +55,8 @@
         'base/adaptation_set.h',
         'base/content_protection_element.cc',
         'base/content_protection_element.h',
+        'base/mpd_aggregator.cc',
+        'base/mpd_aggregator.h',
         'base/mpd_builder.cc',
         'base/mpd_builder.h',
         'base/mpd_notifier_util.cc',
@@ -54,6 +67,8 @@
         'base/mpd_utils.h',
         'base/period.cc',
         'base/period.h',
+        'base/remote_mpd_notifier.cc',
+        'base/remote_mpd_notifier.h',
         'base/representation.cc',
         'base/representation.h',
         'base/segment_info.h',
@@ -79,6 +94,24 @@
         'media_info_proto',
       ],
     },
+    {
+      # Not part of mpd_unittest, as the benchmarks take a while and their
+      # results are only meaningful in release builds.
+      'target_name': 'mpd_benchmarks',
+      'type': '<(gtest_target_type)',
+      'sources': [
+        'base/mpd_benchmarks.cc',
+        'test/allocation_counter.cc',
+        'test/allocation_counter.h',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../media/test/media_test.gyp:run_tests_with_atexit_manager',
+        '../testing/gtest.gyp:gtest',
+        '../testing/perf/perf_test.gyp:perf_test',
+        'mpd_builder',
+      ],
+    },
     {
       'target_name': 'mpd_mocks',
       'type': '<(component)',
@@ -98,7 +131,12 @@
       'type': '<(gtest_target_type)',
       'sources': [
         'base/adaptation_set_unittest.cc',
+        'base/async_manifest_writer_unittest.cc',
         'base/bandwidth_estimator_unittest.cc',
+        'base/manifest_checkpoint_unittest.cc',
+        'base/manifest_file_writer_unittest.cc',
+        'base/manifest_write_coalescer_unittest.cc',
+        'base/mpd_aggregator_unittest.cc',
         'base/mpd_builder_unittest.cc',
         'base/mpd_utils_unittest.cc',
         'base/period_unittest.cc',
@@ -114,6 +152,7 @@
       'dependencies': [
         '../base/base.gyp:base',
         '../file/file.gyp:file',
+        '../media/base/media_base.gyp:media_base',
         '../media/test/media_test.gyp:run_tests_with_atexit_manager',
         '../testing/gmock.gyp:gmock',
         '../testing/gtest.gyp:gtest',
@@ -132,6 +171,7 @@
       ],
       'dependencies': [
         '../file/file.gyp:file',
+        '../media/base/media_base.gyp:media_base',
         '../third_party/gflags/gflags.gyp:gflags',
         'mpd_builder',
         'mpd_mocks',
@@ -74,6 +74,12 @@ struct MpdParams {
   /// Ignored if $Time$ is used in segment template, since $Time$ requires
   /// accurate Segment Timeline.
   bool allow_approximate_segment_timeline = false;
+  /// Tolerance, in seconds, within which segment times are considered equal
+  /// when 'allow_approximate_segment_timeline' is enabled. Defaults to one
+  /// sample, capped at 50 milliseconds, if it is not positive. A larger
+  /// tolerance lets segments with jittery durations, e.g. audio segments cut
+  /// on AAC frame boundaries, merge into fewer SegmentTimeline entries.
+  double approximate_segment_timeline_tolerance = 0;
   /// This is the target segment duration requested by the user. The actual
   /// segment duration may be different to the target segment duration.
   /// This parameter is included here to calculate the approximate
@@ -91,6 +97,38 @@ struct MpdParams {
   /// content is huge and the total number of (sub)segment references
   /// is greater than what the sidx atom allows (65535).
   bool use_segment_list = false;
+  /// Window, in seconds, to coalesce the MPD writes triggered by new segments
+  /// of different Representations in dynamic MPDs. The MPD is written once
+  /// all Representations have reported a new segment, or once the window has
+  /// elapsed since the previous write. Every new segment triggers a write if
+  /// it is not positive.
+  double manifest_write_coalescing_window = 0;
+  /// Write the dynamic MPD on a worker thread, so the media threads do not
+  /// block on the MPD output. An explicit flush still waits for the write.
+  bool async_manifest_writes = false;
+  /// Path of the MPD Patch for dynamic MPDs. If set, every MPD update also
+  /// writes a Patch document with the changes since the previous MPD, e.g.
+  /// the S elements added to and removed from the SegmentTimelines, to this
+  /// path, and the MPD gets an @id and a PatchLocation element referring to
+  /// it. Clients can then fetch the small patch instead of the full MPD.
+  std::string mpd_patch_output;
+  /// Generate low latency DASH output for dynamic MPDs. Every fragment of an
+  /// fMP4 segment is flushed to the segment file as soon as it is finalized,
+  /// i.e. the segments can be delivered with chunked transfer encoding, and
+  /// SegmentTemplate signals availabilityTimeOffset and
+  /// availabilityTimeComplete="false".
+  bool low_latency_dash_mode = false;
+  /// This is the target chunk, i.e. fragment, duration. It is used with
+  /// 'target_segment_duration' to compute availabilityTimeOffset. It will be
+  /// populated from subsegment duration specified in ChunkingParams if not
+  /// specified.
+  double target_chunk_duration = 0;
+  /// URL of an MPD aggregator, i.e. a packager run with --mpd_aggregator_port.
+  /// If set, the MPD is not generated here. The notifications of the streams
+  /// are sent to the aggregator instead, which generates a single MPD for the
+  /// streams of all the packagers sending to it, e.g. the renditions of a
+  /// ladder packaged on different hosts.
+  std::string mpd_aggregator_url;
 };
 
 }  // namespace shaka
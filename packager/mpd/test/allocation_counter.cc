@@ -0,0 +1,37 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/test/allocation_counter.h"
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+namespace {
+std::atomic<uint64_t> g_num_allocations(0);
+}  // namespace
+
+// operator new[] and the nothrow variants call this operator by default.
+void* operator new(size_t size) {
+  g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = malloc(size ? size : 1);
+  if (!ptr)
+    abort();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+namespace shaka {
+
+uint64_t GetNumAllocations() {
+  return g_num_allocations.load(std::memory_order_relaxed);
+}
+
+}  // namespace shaka
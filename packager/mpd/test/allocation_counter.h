@@ -0,0 +1,21 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MPD_TEST_ALLOCATION_COUNTER_H_
+#define MPD_TEST_ALLOCATION_COUNTER_H_
+
+#include <stdint.h>
+
+namespace shaka {
+
+// Returns the number of calls to the global operator new so far. The
+// operator is replaced, to count the calls, in the executables linking
+// allocation_counter.cc, i.e. the manifest benchmarks.
+uint64_t GetNumAllocations();
+
+}  // namespace shaka
+
+#endif  // MPD_TEST_ALLOCATION_COUNTER_H_
@@ -62,6 +62,7 @@ MediaInfo GetTestMediaInfo(const std::string& media_info_file_name) {
 }
 
 bool ValidateMpdSchema(const std::string& mpd) {
+  xml::InitializeLibXml();
   xml::scoped_xml_ptr<xmlDoc> doc(
       xmlParseMemory(mpd.data(), mpd.size()));
   if (!doc) {
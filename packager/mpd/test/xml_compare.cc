@@ -15,6 +15,7 @@ namespace shaka {
 
 namespace {
 xml::scoped_xml_ptr<xmlDoc> GetDocFromString(const std::string& xml_str) {
+  xml::InitializeLibXml();
   return xml::scoped_xml_ptr<xmlDoc>(
       xmlReadMemory(xml_str.data(), xml_str.size(), NULL, NULL, 0));
 }
@@ -162,15 +163,7 @@ bool XmlEqual(const std::string& xml1,
 }
 
 bool XmlEqual(const std::string& xml1, const xml::XmlNode& xml2) {
-  xml::scoped_xml_ptr<xmlDoc> xml1_doc(GetDocFromString(xml1));
-  if (!xml1_doc) {
-    LOG(ERROR) << "xml1 is not valid XML.";
-    return false;
-  }
-  xmlNodePtr xml1_root_element = xmlDocGetRootElement(xml1_doc.get());
-  if (!xml1_root_element)
-    return false;
-  return CompareNodes(xml1_root_element, xml2.GetRawPtr());
+  return XmlEqual(xml1, xml2.ToString(/* comment= */ ""));
 }
 
 std::string XmlNodeToString(const base::Optional<xml::XmlNode>& xml_node) {
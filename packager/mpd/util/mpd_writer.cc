@@ -7,12 +7,14 @@
 #include "packager/mpd/util/mpd_writer.h"
 
 #include <gflags/gflags.h>
+#include <google/protobuf/io/tokenizer.h>
 #include <google/protobuf/text_format.h>
 #include <stdint.h>
 
 #include "packager/base/files/file_path.h"
 #include "packager/base/files/file_util.h"
 #include "packager/file/file.h"
+#include "packager/media/base/gzip_util.h"
 #include "packager/mpd/base/mpd_builder.h"
 #include "packager/mpd/base/mpd_notifier.h"
 #include "packager/mpd/base/mpd_utils.h"
@@ -38,6 +40,29 @@ class SimpleMpdNotifierFactory : public MpdNotifierFactory {
   }
 };
 
+// Ignores the errors of parsing a MediaInfo that is not in text format.
+class SilentErrorCollector : public ::google::protobuf::io::ErrorCollector {
+ public:
+  void AddError(int line, int column, const std::string& message) override {}
+};
+
+// Parses |content| as a MediaInfo in text format, or binary serialized,
+// possibly compressed with gzip.
+bool ParseMediaInfo(const std::string& content, MediaInfo* media_info) {
+  if (media::IsGzipCompressed(content)) {
+    std::string uncompressed;
+    return media::GzipDecompress(content, &uncompressed) &&
+           media_info->ParseFromString(uncompressed);
+  }
+
+  ::google::protobuf::TextFormat::Parser parser;
+  SilentErrorCollector error_collector;
+  parser.RecordErrorsTo(&error_collector);
+  if (parser.ParseFromString(content, media_info))
+    return true;
+  return media_info->ParseFromString(content);
+}
+
 }  // namespace
 
 MpdWriter::MpdWriter() : notifier_factory_(new SimpleMpdNotifierFactory()) {}
@@ -51,9 +76,8 @@ bool MpdWriter::AddFile(const std::string& media_info_path) {
   }
 
   MediaInfo media_info;
-  if (!::google::protobuf::TextFormat::ParseFromString(file_content,
-                                                       &media_info)) {
-    LOG(ERROR) << "Failed to parse " << file_content << " to MediaInfo.";
+  if (!ParseMediaInfo(file_content, &media_info)) {
+    LOG(ERROR) << "Failed to parse " << media_info_path << " to MediaInfo.";
     return false;
   }
 
@@ -53,7 +53,8 @@ class MpdWriter {
   // Add |media_info_path| for MPD generation.
   // The content of |media_info_path| should be a string representation of
   // MediaInfo, i.e. the content should be a result of using
-  // google::protobuf::TestFormat::Print*() methods.
+  // google::protobuf::TestFormat::Print*() methods, or a binary serialized
+  // MediaInfo, which is faster to parse, possibly compressed with gzip.
   // If necessary, this method can be called after WriteMpd*() methods.
   bool AddFile(const std::string& media_info_path);
 
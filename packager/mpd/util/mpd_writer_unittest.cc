@@ -5,10 +5,13 @@
 // https://developers.google.com/open-source/licenses/bsd
 
 #include <gmock/gmock.h>
+#include <google/protobuf/text_format.h>
 #include <gtest/gtest.h>
 
 #include "packager/base/files/file_util.h"
 #include "packager/base/path_service.h"
+#include "packager/media/base/gzip_util.h"
+#include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/base/mock_mpd_notifier.h"
 #include "packager/mpd/base/mpd_options.h"
 #include "packager/mpd/test/mpd_builder_test_helper.h"
@@ -67,10 +70,86 @@ class MpdWriterTest : public ::testing::Test {
     mpd_writer_.SetMpdNotifierFactoryForTest(std::move(notifier_factory_));
   }
 
+  const std::list<MediaInfo>& media_infos() const {
+    return mpd_writer_.media_infos_;
+  }
+
   std::unique_ptr<TestMpdNotifierFactory> notifier_factory_;
   MpdWriter mpd_writer_;
 };
 
+// Verify that a binary serialized MediaInfo is read like a text one.
+TEST_F(MpdWriterTest, AddBinaryFile) {
+  const base::FilePath text_file =
+      GetTestDataFilePath(kFileNameVideoMediaInfo1);
+  std::string text_content;
+  ASSERT_TRUE(base::ReadFileToString(text_file, &text_content));
+  MediaInfo media_info;
+  ASSERT_TRUE(::google::protobuf::TextFormat::ParseFromString(text_content,
+                                                              &media_info));
+  const std::string binary_content = media_info.SerializeAsString();
+
+  base::FilePath binary_file;
+  ASSERT_TRUE(base::CreateTemporaryFile(&binary_file));
+  ASSERT_EQ(static_cast<int>(binary_content.size()),
+            base::WriteFile(binary_file, binary_content.data(),
+                            binary_content.size()));
+
+  EXPECT_TRUE(mpd_writer_.AddFile(text_file.AsUTF8Unsafe()));
+  EXPECT_TRUE(mpd_writer_.AddFile(binary_file.AsUTF8Unsafe()));
+  ASSERT_EQ(2u, media_infos().size());
+  EXPECT_EQ(media_infos().front().SerializeAsString(),
+            media_infos().back().SerializeAsString());
+  base::DeleteFile(binary_file, false);
+}
+
+// Verify that a gzip compressed binary MediaInfo is read like a text one.
+TEST_F(MpdWriterTest, AddGzipBinaryFile) {
+  const base::FilePath text_file =
+      GetTestDataFilePath(kFileNameVideoMediaInfo1);
+  std::string text_content;
+  ASSERT_TRUE(base::ReadFileToString(text_file, &text_content));
+  MediaInfo media_info;
+  ASSERT_TRUE(::google::protobuf::TextFormat::ParseFromString(text_content,
+                                                              &media_info));
+  std::string gzip_content;
+  ASSERT_TRUE(
+      media::GzipCompress(media_info.SerializeAsString(), &gzip_content));
+
+  base::FilePath gzip_file;
+  ASSERT_TRUE(base::CreateTemporaryFile(&gzip_file));
+  ASSERT_EQ(static_cast<int>(gzip_content.size()),
+            base::WriteFile(gzip_file, gzip_content.data(),
+                            gzip_content.size()));
+
+  EXPECT_TRUE(mpd_writer_.AddFile(text_file.AsUTF8Unsafe()));
+  EXPECT_TRUE(mpd_writer_.AddFile(gzip_file.AsUTF8Unsafe()));
+  ASSERT_EQ(2u, media_infos().size());
+  EXPECT_EQ(media_infos().front().SerializeAsString(),
+            media_infos().back().SerializeAsString());
+  base::DeleteFile(gzip_file, false);
+}
+
+// Verify that a truncated gzip file is rejected.
+TEST_F(MpdWriterTest, AddTruncatedGzipBinaryFile) {
+  MediaInfo media_info;
+  media_info.set_bandwidth(12345);
+  std::string gzip_content;
+  ASSERT_TRUE(
+      media::GzipCompress(media_info.SerializeAsString(), &gzip_content));
+  gzip_content.resize(gzip_content.size() / 2);
+
+  base::FilePath gzip_file;
+  ASSERT_TRUE(base::CreateTemporaryFile(&gzip_file));
+  ASSERT_EQ(static_cast<int>(gzip_content.size()),
+            base::WriteFile(gzip_file, gzip_content.data(),
+                            gzip_content.size()));
+
+  EXPECT_FALSE(mpd_writer_.AddFile(gzip_file.AsUTF8Unsafe()));
+  EXPECT_TRUE(media_infos().empty());
+  base::DeleteFile(gzip_file, false);
+}
+
 // Verify that writing mpd to a file works.
 // Also check that base URLs are passed correctly.
 TEST_F(MpdWriterTest, WriteMpdToFile) {
@@ -7,26 +7,40 @@
 #include "packager/packager.h"
 
 #include <algorithm>
+#include <atomic>
+#include <map>
+#include <set>
+#include <tuple>
 
 #include "packager/app/job_manager.h"
 #include "packager/app/libcrypto_threading.h"
+#include "packager/app/media_handler_stats_reporter.h"
 #include "packager/app/muxer_factory.h"
 #include "packager/app/packager_util.h"
 #include "packager/app/single_thread_job_manager.h"
+#include "packager/app/thread_pool_job_manager.h"
+#include "packager/app/trace_writer.h"
 #include "packager/app/stream_descriptor.h"
 #include "packager/base/at_exit.h"
+#include "packager/base/bind.h"
 #include "packager/base/files/file_path.h"
 #include "packager/base/logging.h"
 #include "packager/base/optional.h"
 #include "packager/base/path_service.h"
+#include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/base/threading/simple_thread.h"
 #include "packager/base/time/clock.h"
 #include "packager/file/file.h"
+#include "packager/file/file_deletion_queue.h"
+#include "packager/file/file_upload_queue.h"
+#include "packager/file/memory_budget.h"
 #include "packager/hls/base/hls_notifier.h"
 #include "packager/hls/base/simple_hls_notifier.h"
-#include "packager/media/base/cc_stream_filter.h"
+#include "packager/media/base/cc_stream_router.h"
+#include "packager/media/base/closure_thread.h"
 #include "packager/media/base/container_names.h"
 #include "packager/media/base/fourccs.h"
 #include "packager/media/base/key_source.h"
@@ -34,20 +48,30 @@
 #include "packager/media/base/muxer.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/muxer_util.h"
+#include "packager/media/base/segment_checkpoint.h"
+#include "packager/media/base/segment_digest.h"
+#include "packager/media/base/threaded_handler.h"
 #include "packager/media/chunking/chunking_handler.h"
 #include "packager/media/chunking/cue_alignment_handler.h"
 #include "packager/media/chunking/text_chunker.h"
 #include "packager/media/crypto/encryption_handler.h"
+#include "packager/media/demuxer/concat_demuxer.h"
 #include "packager/media/demuxer/demuxer.h"
+#include "packager/media/event/combined_muxer_listener.h"
 #include "packager/media/event/muxer_listener_factory.h"
+#include "packager/media/event/output_stats_muxer_listener.h"
 #include "packager/media/event/vod_media_info_dump_muxer_listener.h"
+#include "packager/media/formats/mp2t/ts_passthrough.h"
+#include "packager/media/formats/mp4/fragment_passthrough.h"
 #include "packager/media/formats/ttml/ttml_to_mp4_handler.h"
 #include "packager/media/formats/webvtt/text_padder.h"
 #include "packager/media/formats/webvtt/webvtt_to_mp4_handler.h"
 #include "packager/media/replicator/replicator.h"
 #include "packager/media/trick_play/trick_play_handler.h"
+#include "packager/mpd/base/manifest_checkpoint.h"
 #include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/base/mpd_builder.h"
+#include "packager/mpd/base/remote_mpd_notifier.h"
 #include "packager/mpd/base/simple_mpd_notifier.h"
 #include "packager/status_macros.h"
 #include "packager/version/version.h"
@@ -61,6 +85,7 @@ using media::KeySource;
 using media::MuxerOptions;
 using media::SingleThreadJobManager;
 using media::SyncPointQueue;
+using media::ThreadPoolJobManager;
 
 namespace media {
 namespace {
@@ -69,6 +94,19 @@ const char kMediaInfoSuffix[] = ".media_info";
 
 const int64_t kDefaultTextZeroBiasMs = 10 * 60 * 1000;  // 10 minutes
 
+// Maximum number of stream data queued per stream, or per output, when the
+// streams, or the outputs, are processed in parallel.
+const size_t kMaxPendingStreamData = 64;
+
+VodMediaInfoDumpMuxerListener::Format GetMediaInfoFormat(
+    const PackagingParams& packaging_params) {
+  if (!packaging_params.binary_media_info)
+    return VodMediaInfoDumpMuxerListener::Format::kText;
+  return packaging_params.compress_media_info
+             ? VodMediaInfoDumpMuxerListener::Format::kGzipBinary
+             : VodMediaInfoDumpMuxerListener::Format::kBinary;
+}
+
 MuxerListenerFactory::StreamData ToMuxerListenerData(
     const StreamDescriptor& stream) {
   MuxerListenerFactory::StreamData data;
@@ -197,6 +235,40 @@ bool IsTextStream(const StreamDescriptor& stream) {
   return output_format == CONTAINER_WEBVTT || output_format == CONTAINER_TTML;
 }
 
+// Returns true if the TS outputs of |stream| and |other| can share their
+// segment template, i.e. be muxed into the same segments.
+// Whether some jobs may never complete: the UDP inputs never end, and live
+// playlists are generated for inputs which may not end either.
+bool IsLivePackaging(const PackagingParams& packaging_params,
+                     const std::vector<StreamDescriptor>& stream_descriptors) {
+  for (const StreamDescriptor& descriptor : stream_descriptors) {
+    if (base::StartsWith(descriptor.input, "udp://",
+                         base::CompareCase::SENSITIVE)) {
+      return true;
+    }
+  }
+  if (stream_descriptors.empty() ||
+      stream_descriptors.begin()->segment_template.empty()) {
+    return false;
+  }
+  const HlsParams& hls_params = packaging_params.hls_params;
+  const MpdParams& mpd_params = packaging_params.mpd_params;
+  return (!hls_params.master_playlist_output.empty() &&
+          hls_params.playlist_type != HlsPlaylistType::kVod) ||
+         (!mpd_params.mpd_output.empty() &&
+          !mpd_params.generate_static_live_mpd);
+}
+
+bool CanShareSegmentTemplate(const StreamDescriptor& stream,
+                             const StreamDescriptor& other) {
+  return GetOutputFormat(stream) == CONTAINER_MPEG2TS &&
+         GetOutputFormat(other) == CONTAINER_MPEG2TS &&
+         stream.input == other.input &&
+         stream.stream_selector != other.stream_selector &&
+         !IsTextStream(stream) && !IsTextStream(other) &&
+         stream.trick_play_factor == 0 && other.trick_play_factor == 0;
+}
+
 Status ValidateStreamDescriptor(bool dump_stream_info,
                                 const StreamDescriptor& stream) {
   if (stream.input.empty()) {
@@ -221,6 +293,12 @@ Status ValidateStreamDescriptor(bool dump_stream_info,
                   "Stream stream_selector not specified.");
   }
 
+  if (!stream.next_inputs.empty() &&
+      (stream.start_time_in_seconds > 0 || stream.end_time_in_seconds > 0)) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Stream next_inputs cannot be used with a time range.");
+  }
+
   // If a segment template is provided, it must be valid.
   if (stream.segment_template.length()) {
     RETURN_IF_ERROR(ValidateSegmentTemplate(stream.segment_template));
@@ -309,7 +387,8 @@ Status ValidateParams(const PackagingParams& packaging_params,
   const bool on_demand_dash_profile =
       stream_descriptors.begin()->segment_template.empty();
   std::set<std::string> outputs;
-  std::set<std::string> segment_templates;
+  // The first stream descriptor of each segment template.
+  std::map<std::string, const StreamDescriptor*> segment_templates;
   for (const auto& descriptor : stream_descriptors) {
     if (on_demand_dash_profile != descriptor.segment_template.empty()) {
       return Status(error::INVALID_ARGUMENT,
@@ -346,15 +425,25 @@ Status ValidateParams(const PackagingParams& packaging_params,
       outputs.insert(descriptor.output);
     }
     if (!descriptor.segment_template.empty()) {
-      if (segment_templates.find(descriptor.segment_template) !=
-          segment_templates.end()) {
+      auto first_descriptor =
+          segment_templates.find(descriptor.segment_template);
+      if (first_descriptor == segment_templates.end()) {
+        segment_templates[descriptor.segment_template] = &descriptor;
+      } else if (!CanShareSegmentTemplate(*first_descriptor->second,
+                                          descriptor)) {
         return Status(error::INVALID_ARGUMENT,
                       "Seeing duplicated segment templates '" +
                           descriptor.segment_template +
                           "' in stream descriptors. Every segment template "
-                          "must be unique.");
+                          "must be unique, except for the TS outputs of the "
+                          "audio and video streams of the same input.");
+      } else if (packaging_params.process_streams_in_parallel &&
+                 !packaging_params.single_threaded) {
+        return Status(error::INVALID_ARGUMENT,
+                      "Streams sharing the segment template '" +
+                          descriptor.segment_template +
+                          "' cannot be processed in parallel.");
       }
-      segment_templates.insert(descriptor.segment_template);
     }
   }
 
@@ -374,6 +463,48 @@ Status ValidateParams(const PackagingParams& packaging_params,
                   "on-demand profile (not using segment_template or segment list).");
   }
 
+  const MpdParams& mpd_params = packaging_params.mpd_params;
+  if (mpd_params.low_latency_dash_mode) {
+    if (on_demand_dash_profile || mpd_params.generate_static_live_mpd) {
+      return Status(error::INVALID_ARGUMENT,
+                    "DASH low latency mode requires segment_template and a "
+                    "dynamic MPD.");
+    }
+    if (mpd_params.target_chunk_duration <= 0 &&
+        packaging_params.chunking_params.subsegment_duration_in_seconds <= 0) {
+      return Status(error::INVALID_ARGUMENT,
+                    "DASH low latency mode requires --fragment_duration, which "
+                    "defines the chunk duration.");
+    }
+  }
+  if (!mpd_params.mpd_aggregator_url.empty()) {
+    if (on_demand_dash_profile) {
+      return Status(error::INVALID_ARGUMENT,
+                    "The MPD aggregator requires segment_template.");
+    }
+    if (!mpd_params.mpd_output.empty()) {
+      return Status(error::INVALID_ARGUMENT,
+                    "The MPD is generated by the MPD aggregator, so "
+                    "--mpd_output cannot be set with --mpd_aggregator_url.");
+    }
+  }
+
+  const HlsParams& hls_params = packaging_params.hls_params;
+  if (hls_params.low_latency_mode) {
+    if (on_demand_dash_profile ||
+        hls_params.playlist_type == HlsPlaylistType::kVod) {
+      return Status(error::INVALID_ARGUMENT,
+                    "HLS low latency mode requires segment_template and "
+                    "--hls_playlist_type LIVE or EVENT.");
+    }
+    if (hls_params.target_part_duration <= 0 &&
+        packaging_params.chunking_params.subsegment_duration_in_seconds <= 0) {
+      return Status(error::INVALID_ARGUMENT,
+                    "HLS low latency mode requires --fragment_duration, which "
+                    "defines the partial segment duration.");
+    }
+  }
+
   return Status::OK;
 }
 
@@ -450,6 +581,10 @@ Status CreateDemuxer(const StreamDescriptor& stream,
                      std::shared_ptr<Demuxer>* new_demuxer) {
   std::shared_ptr<Demuxer> demuxer = std::make_shared<Demuxer>(stream.input);
   demuxer->set_dump_stream_info(packaging_params.test_params.dump_stream_info);
+  if (packaging_params.max_queued_sample_bytes > 0) {
+    demuxer->set_max_queued_sample_bytes(
+        packaging_params.max_queued_sample_bytes);
+  }
 
   if (packaging_params.decryption_params.key_provider != KeyProvider::kNone) {
     std::unique_ptr<KeySource> decryption_key_source(
@@ -462,14 +597,43 @@ Status CreateDemuxer(const StreamDescriptor& stream,
     demuxer->SetKeySource(std::move(decryption_key_source));
   }
 
+  if (stream.start_time_in_seconds > 0 || stream.end_time_in_seconds > 0) {
+    demuxer->set_time_range(stream.start_time_in_seconds,
+                            stream.end_time_in_seconds);
+  }
+
   *new_demuxer = std::move(demuxer);
   return Status::OK;
 }
 
+// Use Sample AES in MPEG2TS.
+// TODO(kqyang): Consider adding a new flag to enable Sample AES as we
+// will support CENC in TS in the future.
+bool UseSampleAes(const StreamDescriptor& stream) {
+  const MediaContainerName output_format = GetOutputFormat(stream);
+  return output_format == CONTAINER_MPEG2TS ||
+         output_format == CONTAINER_AAC || output_format == CONTAINER_AC3 ||
+         output_format == CONTAINER_EAC3;
+}
+
+// The stream descriptor settings CreateEncryptionHandler() depends on, i.e.
+// skip_encryption, drm_label and Sample AES. The outputs of a stream with the
+// same settings share a single EncryptionHandler.
+typedef std::tuple<bool, std::string, bool> EncryptionGroup;
+
+EncryptionGroup GetEncryptionGroup(const StreamDescriptor& stream) {
+  // Text is not encrypted.
+  if (IsTextStream(stream))
+    return EncryptionGroup();
+  return std::make_tuple(stream.skip_encryption, stream.drm_label,
+                         UseSampleAes(stream));
+}
+
 std::shared_ptr<MediaHandler> CreateEncryptionHandler(
     const PackagingParams& packaging_params,
     const StreamDescriptor& stream,
-    KeySource* key_source) {
+    KeySource* key_source,
+    KeySource* decryption_key_source) {
   if (stream.skip_encryption) {
     return nullptr;
   }
@@ -481,13 +645,7 @@ std::shared_ptr<MediaHandler> CreateEncryptionHandler(
   // Make a copy so that we can modify it for this specific stream.
   EncryptionParams encryption_params = packaging_params.encryption_params;
 
-  // Use Sample AES in MPEG2TS.
-  // TODO(kqyang): Consider adding a new flag to enable Sample AES as we
-  // will support CENC in TS in the future.
-  if (GetOutputFormat(stream) == CONTAINER_MPEG2TS ||
-      GetOutputFormat(stream) == CONTAINER_AAC ||
-      GetOutputFormat(stream) == CONTAINER_AC3 ||
-      GetOutputFormat(stream) == CONTAINER_EAC3) {
+  if (UseSampleAes(stream)) {
     VLOG(1) << "Use Apple Sample AES encryption for MPEG2TS or Packed Audio.";
     encryption_params.protection_scheme = kAppleSampleAesProtectionScheme;
   }
@@ -507,15 +665,19 @@ std::shared_ptr<MediaHandler> CreateEncryptionHandler(
         kDefaultMaxHdPixels, kDefaultMaxUhd1Pixels, std::placeholders::_1);
   }
 
-  return std::make_shared<EncryptionHandler>(encryption_params, key_source);
+  std::shared_ptr<EncryptionHandler> encryption_handler =
+      std::make_shared<EncryptionHandler>(encryption_params, key_source);
+  encryption_handler->SetDecryptionKeySource(decryption_key_source);
+  return encryption_handler;
 }
 
 std::unique_ptr<MediaHandler> CreateTextChunker(
     const ChunkingParams& chunking_params) {
   const float segment_length_in_seconds =
       chunking_params.segment_duration_in_seconds;
-  return std::unique_ptr<MediaHandler>(
-      new TextChunker(segment_length_in_seconds));
+  return std::unique_ptr<MediaHandler>(new TextChunker(
+      segment_length_in_seconds,
+      chunking_params.max_empty_text_segment_duration_in_seconds));
 }
 
 Status CreateTtmlJobs(
@@ -573,7 +735,8 @@ Status CreateTtmlJobs(
 
       if (packaging_params.output_media_info) {
         VodMediaInfoDumpMuxerListener::WriteMediaInfoToFile(
-            text_media_info, stream.output + kMediaInfoSuffix);
+            text_media_info, stream.output + kMediaInfoSuffix,
+            GetMediaInfoFormat(packaging_params));
       }
     }
   }
@@ -581,97 +744,515 @@ Status CreateTtmlJobs(
   return Status::OK;
 }
 
-Status CreateAudioVideoJobs(
+// Adds |handler| to the statistics reported by |stats_reporter|, if any.
+void AddHandlerStats(MediaHandlerStatsReporter* stats_reporter,
+                     const std::string& stream_label,
+                     const std::string& handler_name,
+                     const std::shared_ptr<MediaHandler>& handler) {
+  if (stats_reporter)
+    stats_reporter->AddHandler(stream_label, handler_name, handler);
+}
+
+// Returns why |stream| cannot be copied to its output by a FragmentPassthrough
+// or a TsPassthrough, or an empty string if it can as far as the packaging
+// settings go. The passthrough's Open() then checks the input itself.
+std::string GetPassthroughBlocker(const StreamDescriptor& stream,
+                                  const PackagingParams& packaging_params,
+                                  const MuxerOptions& options,
+                                  bool encrypted,
+                                  bool has_sync_points) {
+  if (IsTextStream(stream))
+    return "text stream";
+  if (stream.segment_template.empty())
+    return "not a segment template output";
+  if (stream.trick_play_factor)
+    return "trick play";
+  if (encrypted && !stream.skip_encryption)
+    return "encryption";
+  if (packaging_params.decryption_params.key_provider != KeyProvider::kNone)
+    return "decryption";
+  if (has_sync_points)
+    return "ad cues";
+  if (packaging_params.chunking_params.subsegment_duration_in_seconds > 0)
+    return "fragment duration";
+  if (options.write_partial_segments || options.write_chunked_segments)
+    return "partial or chunked segments";
+  if (options.segment_checkpoint || !options.segment_digests.empty())
+    return "segment checkpoint or digests";
+  if (!stream.language.empty())
+    return "language override";
+  if (stream.start_time_in_seconds > 0 || stream.end_time_in_seconds > 0)
+    return "time range";
+  if (!stream.next_inputs.empty())
+    return "next inputs";
+  if (!stream.hls_iframe_playlist_name.empty())
+    return "I-frame playlist";
+  if (!File::IsLocalRegularFile(stream.input.c_str()))
+    return "not a local file";
+  return "";
+}
+
+// Adds a passthrough job for each stream descriptor which can be copied to its
+// output without demuxing, i.e. a FragmentPassthrough for the single stream
+// descriptor of a fragmented MP4 input with --mp4_fragment_passthrough, or a
+// TsPassthrough for TS outputs with --ts_passthrough. Adds them to
+// |passthrough_streams|; the others are demuxed as usual.
+Status CreatePassthroughJobs(
     const std::vector<std::reference_wrapper<const StreamDescriptor>>& streams,
     const PackagingParams& packaging_params,
     KeySource* encryption_key_source,
     SyncPointQueue* sync_points,
     MuxerListenerFactory* muxer_listener_factory,
     MuxerFactory* muxer_factory,
-    JobManager* job_manager) {
+    JobManager* job_manager,
+    std::set<const StreamDescriptor*>* passthrough_streams) {
+  std::map<std::string, size_t> num_input_streams;
+  // The streams muxed together into the same TS segments are demuxed.
+  std::map<std::string, size_t> num_segment_template_streams;
+  for (const StreamDescriptor& stream : streams) {
+    ++num_input_streams[stream.input];
+    if (!stream.segment_template.empty())
+      ++num_segment_template_streams[stream.segment_template];
+  }
+
+  for (const StreamDescriptor& stream : streams) {
+    const MediaContainerName output_format = GetOutputFormat(stream);
+    const bool mp4_passthrough =
+        packaging_params.mp4_output_params.fragment_passthrough &&
+        output_format == CONTAINER_MOV && !stream.output.empty() &&
+        num_input_streams[stream.input] == 1;
+    const bool ts_passthrough =
+        packaging_params.ts_passthrough &&
+        output_format == CONTAINER_MPEG2TS &&
+        num_segment_template_streams[stream.segment_template] == 1;
+    if (!mp4_passthrough && !ts_passthrough)
+      continue;
+    const MuxerOptions options = muxer_factory->CreateMuxerOptions(stream);
+    const std::string blocker = GetPassthroughBlocker(
+        stream, packaging_params, options, encryption_key_source != nullptr,
+        sync_points != nullptr);
+    if (!blocker.empty()) {
+      VLOG(1) << "Demuxing " << stream.input << ":" << stream.stream_selector
+              << ": " << blocker;
+      continue;
+    }
+
+    std::unique_ptr<MuxerListener> muxer_listener =
+        muxer_listener_factory->CreateListener(ToMuxerListenerData(stream));
+    std::shared_ptr<OriginHandler> passthrough;
+    Status status;
+    if (mp4_passthrough) {
+      auto fragment_passthrough =
+          std::make_shared<mp4::FragmentPassthrough>(stream.input, options);
+      status = fragment_passthrough->Open();
+      fragment_passthrough->SetMuxerListener(std::move(muxer_listener));
+      passthrough = std::move(fragment_passthrough);
+    } else {
+      auto ts_passthrough = std::make_shared<mp2t::TsPassthrough>(
+          stream.input, stream.stream_selector, options);
+      status = ts_passthrough->Open();
+      ts_passthrough->SetMuxerListener(std::move(muxer_listener));
+      passthrough = std::move(ts_passthrough);
+    }
+    if (!status.ok()) {
+      VLOG(1) << "Demuxing " << stream.input << ":" << stream.stream_selector
+              << ": " << status;
+      continue;
+    }
+    job_manager->Add("RemuxJob", passthrough);
+    passthrough_streams->insert(&stream);
+  }
+  return Status::OK;
+}
+
+Status CreateAudioVideoJobs(
+    const std::vector<std::reference_wrapper<const StreamDescriptor>>&
+        all_streams,
+    const PackagingParams& packaging_params,
+    KeySource* encryption_key_source,
+    SyncPointQueue* sync_points,
+    MuxerListenerFactory* muxer_listener_factory,
+    MuxerFactory* muxer_factory,
+    MediaHandlerStatsReporter* stats_reporter,
+    JobManager* job_manager,
+    std::vector<std::shared_ptr<CueAlignmentHandler>>* cue_aligners_out) {
   DCHECK(muxer_listener_factory);
   DCHECK(muxer_factory);
   DCHECK(job_manager);
+  // With --mp4_fragment_passthrough or --ts_passthrough, the streams which
+  // need no sample processing are copied by their own jobs, and the others
+  // demuxed below.
+  std::set<const StreamDescriptor*> passthrough_streams;
+  if (packaging_params.mp4_output_params.fragment_passthrough ||
+      packaging_params.ts_passthrough) {
+    RETURN_IF_ERROR(CreatePassthroughJobs(
+        all_streams, packaging_params, encryption_key_source, sync_points,
+        muxer_listener_factory, muxer_factory, job_manager,
+        &passthrough_streams));
+  }
+  std::vector<std::reference_wrapper<const StreamDescriptor>> streams;
+  for (const StreamDescriptor& stream : all_streams) {
+    if (passthrough_streams.count(&stream) == 0)
+      streams.push_back(stream);
+  }
+
   // Store all the demuxers in a map so that we can look up a stream's demuxer.
-  // This is step one in making this part of the pipeline less dependant on
-  // order.
-  std::map<std::string, std::shared_ptr<Demuxer>> sources;
-  std::map<std::string, std::shared_ptr<MediaHandler>> cue_aligners;
+  // There is a single demuxer per input, whatever the number of stream
+  // descriptors reading from it, so each input is read once. Its streams fan
+  // out to their outputs through Replicators below, and run on their own
+  // threads with --process_streams_in_parallel and --mux_outputs_in_parallel.
+  // The inputs with next inputs are demuxed one after the other by a
+  // ConcatDemuxer, which is their source instead.
+  std::map<std::string, std::shared_ptr<OriginHandler>> sources;
+  std::map<std::string, std::vector<std::shared_ptr<Demuxer>>> demuxers;
+  std::map<std::string, std::shared_ptr<ConcatDemuxer>> concat_demuxers;
+  std::map<std::string, std::shared_ptr<CueAlignmentHandler>> cue_aligners;
+  // The time range of each input, which its single demuxer is cut to.
+  std::map<std::string, std::pair<double, double>> time_ranges;
 
   for (const StreamDescriptor& stream : streams) {
+    const std::pair<double, double> time_range(stream.start_time_in_seconds,
+                                               stream.end_time_in_seconds);
     bool seen_input_before = sources.find(stream.input) != sources.end();
     if (seen_input_before) {
+      if (time_ranges[stream.input] != time_range) {
+        return Status(error::INVALID_ARGUMENT,
+                      "All the streams of input " + stream.input +
+                          " must have the same start_time and end_time.");
+      }
+      if (demuxers[stream.input].size() != 1 + stream.next_inputs.size()) {
+        return Status(error::INVALID_ARGUMENT,
+                      "All the streams of input " + stream.input +
+                          " must have the same next_inputs.");
+      }
       continue;
     }
+    time_ranges[stream.input] = time_range;
 
+    std::vector<std::shared_ptr<Demuxer>>& input_demuxers =
+        demuxers[stream.input];
+    input_demuxers.resize(1 + stream.next_inputs.size());
     RETURN_IF_ERROR(
-        CreateDemuxer(stream, packaging_params, &sources[stream.input]));
+        CreateDemuxer(stream, packaging_params, &input_demuxers[0]));
+    for (size_t i = 0; i < stream.next_inputs.size(); ++i) {
+      StreamDescriptor next_stream = stream;
+      next_stream.input = stream.next_inputs[i];
+      RETURN_IF_ERROR(
+          CreateDemuxer(next_stream, packaging_params, &input_demuxers[i + 1]));
+    }
+    if (stream.next_inputs.empty()) {
+      sources[stream.input] = input_demuxers[0];
+    } else {
+      // The cue events starting new Periods between the inputs would not be
+      // aligned with the ad cues.
+      if (sync_points) {
+        return Status(error::INVALID_ARGUMENT,
+                      "Stream next_inputs cannot be used with ad cues.");
+      }
+      concat_demuxers[stream.input] =
+          std::make_shared<ConcatDemuxer>(input_demuxers);
+      sources[stream.input] = concat_demuxers[stream.input];
+    }
     cue_aligners[stream.input] =
-        sync_points ? std::make_shared<CueAlignmentHandler>(sync_points)
-                    : nullptr;
+        sync_points
+            ? std::make_shared<CueAlignmentHandler>(sync_points, stream.input)
+            : nullptr;
+    AddHandlerStats(stats_reporter, stream.input,
+                    stream.next_inputs.empty() ? "Demuxer" : "ConcatDemuxer",
+                    sources[stream.input]);
   }
 
+  // The inputs with only text streams, e.g. WebVTT files, carry a few cues a
+  // minute, so their jobs share a thread instead of leaving one idle each.
+  // Without sync points only, as the cue alignment of a job may wait for the
+  // others.
+  std::set<std::string> text_only_inputs;
+  for (const StreamDescriptor& stream : streams) {
+    if (IsTextStream(stream))
+      text_only_inputs.insert(stream.input);
+  }
+  for (const StreamDescriptor& stream : streams) {
+    if (!IsTextStream(stream))
+      text_only_inputs.erase(stream.input);
+  }
   for (auto& source : sources) {
-    job_manager->Add("RemuxJob", source.second);
+    if (!sync_points && text_only_inputs.count(source.first) > 0)
+      job_manager->AddToSharedThread("TextJobs", source.second);
+    else
+      job_manager->Add("RemuxJob", source.second);
+  }
+  if (cue_aligners_out && sync_points) {
+    for (auto& cue_aligner : cue_aligners)
+      cue_aligners_out->push_back(cue_aligner.second);
   }
 
-  // Replicators are shared among all streams with the same input and stream
-  // selector.
-  std::shared_ptr<MediaHandler> replicator;
+  // The handlers of a stream are shared among all stream descriptors with the
+  // same input and stream selector, and so is the encryption among those with
+  // the same encryption settings. A Replicator passes the samples to each of
+  // their outputs; it is left out if there is a single one, so the samples of
+  // a plain remux go from the demuxer to the muxer with no extra copy.
+  // The first stream descriptor and the number of outputs of each encryption
+  // group of each stream.
+  std::map<std::pair<std::string, std::string>,
+           std::map<EncryptionGroup, std::pair<const StreamDescriptor*, size_t>>>
+      stream_outputs;
+  // The trick play factors of the outputs of each encryption group of each
+  // stream, in the order of the outputs.
+  std::map<std::pair<std::string, std::string>,
+           std::map<EncryptionGroup, std::vector<uint32_t>>>
+      trick_play_factors;
+  // The outputs of each text stream, in order. The text samples of the streams
+  // with sub-streams, e.g. DVB subtitle pages, are routed by a single
+  // CcStreamRouter to the outputs with their cc_index.
+  std::map<std::pair<std::string, std::string>,
+           std::vector<CcStreamRouter::Output>>
+      text_outputs;
+  for (const StreamDescriptor& stream : streams) {
+    if (stream.output.empty() && stream.segment_template.empty())
+      continue;
+    if (IsTextStream(stream)) {
+      CcStreamRouter::Output output;
+      output.language = stream.language;
+      output.cc_index = stream.cc_index;
+      text_outputs[std::make_pair(stream.input, stream.stream_selector)]
+          .push_back(output);
+    }
+    auto& group_outputs =
+        stream_outputs[std::make_pair(stream.input, stream.stream_selector)]
+                      [GetEncryptionGroup(stream)];
+    if (!group_outputs.first)
+      group_outputs.first = &stream;
+    if (stream.trick_play_factor) {
+      // The trick play outputs of a group share a single TrickPlayHandler.
+      auto& factors = trick_play_factors[std::make_pair(
+          stream.input, stream.stream_selector)][GetEncryptionGroup(stream)];
+      if (factors.empty())
+        ++group_outputs.second;
+      factors.push_back(stream.trick_play_factor);
+    } else {
+      ++group_outputs.second;
+    }
+  }
+  // The samples of an encrypted input whose audio and video outputs are all
+  // encrypted again are not decrypted by the demuxer. The EncryptionHandlers
+  // re-encrypt them directly, without a clear copy.
+  if (encryption_key_source) {
+    std::set<std::string> inputs_with_clear_outputs;
+    for (const auto& stream_output : stream_outputs) {
+      for (const auto& group_output : stream_output.second) {
+        const StreamDescriptor& group_stream = *group_output.second.first;
+        if (group_stream.skip_encryption && !IsTextStream(group_stream))
+          inputs_with_clear_outputs.insert(group_stream.input);
+      }
+    }
+    for (auto& input_demuxers : demuxers) {
+      if (inputs_with_clear_outputs.count(input_demuxers.first) > 0)
+        continue;
+      for (auto& demuxer : input_demuxers.second)
+        demuxer->set_defer_decryption(true);
+    }
+  }
 
-  std::string previous_input;
-  std::string previous_selector;
+  // The inputs whose video only feeds trick play outputs, e.g. preview
+  // streams, are demuxed without reading their other video frames.
+  std::set<std::string> inputs_with_full_video;
+  for (const StreamDescriptor& stream : streams) {
+    if (stream.output.empty() && stream.segment_template.empty())
+      continue;
+    if (stream.trick_play_factor == 0 && stream.stream_selector != "audio" &&
+        !IsTextStream(stream)) {
+      inputs_with_full_video.insert(stream.input);
+    }
+  }
+  for (auto& input_demuxers : demuxers) {
+    if (inputs_with_full_video.count(input_demuxers.first) > 0)
+      continue;
+    for (auto& demuxer : input_demuxers.second)
+      demuxer->set_video_key_frames_only(true);
+  }
 
+  // The TS muxers shared by the streams with the same segment template, which
+  // are muxed into the same segments.
+  std::map<std::string, std::shared_ptr<Muxer>> shared_ts_muxers;
+
+  // The last handler shared by the outputs of each encryption group of the
+  // current stream, and the TrickPlayHandler shared by its trick play outputs.
+  std::map<EncryptionGroup, std::shared_ptr<MediaHandler>> stream_handlers;
+  std::map<EncryptionGroup, std::shared_ptr<MediaHandler>> trick_play_handlers;
+
+  std::map<std::string, size_t> num_segment_template_streams;
   for (const StreamDescriptor& stream : streams) {
-    // Get the demuxer for this stream.
-    auto& demuxer = sources[stream.input];
-    auto& cue_aligner = cue_aligners[stream.input];
+    if (!stream.segment_template.empty())
+      ++num_segment_template_streams[stream.segment_template];
+  }
 
-    const bool new_input_file = stream.input != previous_input;
-    const bool new_stream =
-        new_input_file || previous_selector != stream.stream_selector;
-    const bool is_text = IsTextStream(stream);
-    previous_input = stream.input;
-    previous_selector = stream.stream_selector;
+  std::string previous_input;
+  std::string previous_selector;
 
+  for (const StreamDescriptor& stream : streams) {
     // If the stream has no output, then there is no reason setting-up the rest
     // of the pipeline.
     if (stream.output.empty() && stream.segment_template.empty()) {
       continue;
     }
 
+    // Get the demuxers for this stream.
+    const auto& input_demuxers = demuxers[stream.input];
+    const auto concat_demuxer = concat_demuxers.find(stream.input);
+    auto& cue_aligner = cue_aligners[stream.input];
+
+    const bool new_stream = stream.input != previous_input ||
+                            previous_selector != stream.stream_selector;
+    const bool is_text = IsTextStream(stream);
+    previous_input = stream.input;
+    previous_selector = stream.stream_selector;
+    const std::string stream_label =
+        stream.input + ":" + stream.stream_selector;
+
     // Just because it is a different stream descriptor does not mean it is a
     // new stream. Multiple stream descriptors may have the same stream but
     // only differ by trick play factor.
     if (new_stream) {
       if (!stream.language.empty()) {
-        demuxer->SetLanguageOverride(stream.stream_selector, stream.language);
+        for (const auto& demuxer : input_demuxers)
+          demuxer->SetLanguageOverride(stream.stream_selector, stream.language);
       }
 
       std::vector<std::shared_ptr<MediaHandler>> handlers;
       if (is_text) {
         handlers.emplace_back(
             std::make_shared<TextPadder>(kDefaultTextZeroBiasMs));
+        AddHandlerStats(stats_reporter, stream_label, "TextPadder",
+                        handlers.back());
       }
       if (sync_points) {
         handlers.emplace_back(cue_aligner);
+        AddHandlerStats(stats_reporter, stream.input, "CueAlignmentHandler",
+                        handlers.back());
+      }
+      if (packaging_params.process_streams_in_parallel &&
+          !packaging_params.single_threaded) {
+        handlers.emplace_back(
+            std::make_shared<ThreadedHandler>(kMaxPendingStreamData));
+        AddHandlerStats(stats_reporter, stream_label, "ThreadedHandler",
+                        handlers.back());
       }
       if (!is_text) {
         handlers.emplace_back(std::make_shared<ChunkingHandler>(
             packaging_params.chunking_params));
-        handlers.emplace_back(CreateEncryptionHandler(packaging_params, stream,
-                                                      encryption_key_source));
+        AddHandlerStats(stats_reporter, stream_label, "ChunkingHandler",
+                        handlers.back());
       }
 
-      replicator = std::make_shared<Replicator>();
-      handlers.emplace_back(replicator);
+      const auto& group_outputs = stream_outputs[std::make_pair(
+          stream.input, stream.stream_selector)];
+      // With different encryption settings, the chunked samples go through a
+      // first Replicator to one EncryptionHandler per encryption group.
+      const bool multiple_groups = group_outputs.size() > 1;
+      if (multiple_groups) {
+        handlers.emplace_back(std::make_shared<Replicator>());
+        AddHandlerStats(stats_reporter, stream_label, "Replicator",
+                        handlers.back());
+      }
+      handlers.erase(
+          std::remove(handlers.begin(), handlers.end(), nullptr),
+          handlers.end());
+      DCHECK(!handlers.empty());
 
       RETURN_IF_ERROR(MediaHandler::Chain(handlers));
-      RETURN_IF_ERROR(demuxer->SetHandler(stream.stream_selector, handlers[0]));
+      RETURN_IF_ERROR(
+          concat_demuxer != concat_demuxers.end()
+              ? concat_demuxer->second->SetHandler(stream.stream_selector,
+                                                   handlers[0])
+              : input_demuxers[0]->SetHandler(stream.stream_selector,
+                                              handlers[0]));
+
+      stream_handlers.clear();
+      trick_play_handlers.clear();
+      for (const auto& group_output : group_outputs) {
+        const StreamDescriptor& group_stream = *group_output.second.first;
+        const size_t num_group_outputs = group_output.second.second;
+        const std::string group_label =
+            multiple_groups
+                ? stream_label + ":" + (group_stream.output.empty()
+                                            ? group_stream.segment_template
+                                            : group_stream.output)
+                : stream_label;
+
+        std::vector<std::shared_ptr<MediaHandler>> group_handlers = {
+            handlers.back()};
+        if (!is_text) {
+          group_handlers.emplace_back(CreateEncryptionHandler(
+              packaging_params, group_stream, encryption_key_source,
+              demuxer->key_source()));
+          AddHandlerStats(stats_reporter, group_label, "EncryptionHandler",
+                          group_handlers.back());
+        }
+        const std::vector<CcStreamRouter::Output>& cc_outputs =
+            text_outputs[std::make_pair(stream.input,
+                                        stream.stream_selector)];
+        if (std::any_of(cc_outputs.begin(), cc_outputs.end(),
+                        [](const CcStreamRouter::Output& output) {
+                          return output.cc_index >= 0;
+                        })) {
+          group_handlers.emplace_back(
+              std::make_shared<CcStreamRouter>(cc_outputs));
+          AddHandlerStats(stats_reporter, group_label, "CcStreamRouter",
+                          group_handlers.back());
+        } else if (num_group_outputs > 1) {
+          group_handlers.emplace_back(std::make_shared<Replicator>());
+          AddHandlerStats(stats_reporter, group_label, "Replicator",
+                          group_handlers.back());
+        }
+        // Without encryption and with a single output, the muxer follows the
+        // shared handlers directly.
+        group_handlers.erase(std::remove(group_handlers.begin(),
+                                         group_handlers.end(), nullptr),
+                             group_handlers.end());
+        RETURN_IF_ERROR(MediaHandler::Chain(group_handlers));
+        stream_handlers[group_output.first] = group_handlers.back();
+
+        // The output stream indices of the TrickPlayHandler follow the order
+        // of the trick play outputs, as they are added in the same order.
+        const std::vector<uint32_t>& factors =
+            trick_play_factors[std::make_pair(stream.input,
+                                              stream.stream_selector)]
+                              [group_output.first];
+        if (!factors.empty()) {
+          std::shared_ptr<MediaHandler> trick_play_handler =
+              std::make_shared<TrickPlayHandler>(factors);
+          AddHandlerStats(stats_reporter, group_label, "TrickPlayHandler",
+                          trick_play_handler);
+          RETURN_IF_ERROR(
+              group_handlers.back()->AddHandler(trick_play_handler));
+          trick_play_handlers[group_output.first] =
+              std::move(trick_play_handler);
+        }
+      }
     }
+    std::shared_ptr<MediaHandler> stream_handler =
+        stream.trick_play_factor
+            ? trick_play_handlers[GetEncryptionGroup(stream)]
+            : stream_handlers[GetEncryptionGroup(stream)];
+    DCHECK(stream_handler);
 
     // Create the muxer (output) for this track.
     const auto output_format = GetOutputFormat(stream);
+    const std::string& output_name =
+        stream.output.empty() ? stream.segment_template : stream.output;
+    if (output_format == CONTAINER_MPEG2TS) {
+      // The other streams of the segment template go to the muxer of its
+      // first stream, whose listener reports the segments.
+      const auto shared_muxer =
+          shared_ts_muxers.find(stream.segment_template);
+      if (shared_muxer != shared_ts_muxers.end()) {
+        AddHandlerStats(stats_reporter, stream_label, "Muxer:" + output_name,
+                        shared_muxer->second);
+        RETURN_IF_ERROR(
+            MediaHandler::Chain({stream_handler, shared_muxer->second}));
+        continue;
+      }
+    }
     std::shared_ptr<Muxer> muxer =
         muxer_factory->CreateMuxer(output_format, stream);
     if (!muxer) {
@@ -682,21 +1263,22 @@ Status CreateAudioVideoJobs(
 
     std::unique_ptr<MuxerListener> muxer_listener =
         muxer_listener_factory->CreateListener(ToMuxerListenerData(stream));
+    if (stats_reporter) {
+      // Counts the bytes written, for Packager::GetStats().
+      auto output_stats = std::make_shared<OutputStatsMuxerListener::Stats>();
+      std::unique_ptr<CombinedMuxerListener> combined_listener(
+          new CombinedMuxerListener);
+      combined_listener->AddListener(std::move(muxer_listener));
+      combined_listener->AddListener(std::unique_ptr<MuxerListener>(
+          new OutputStatsMuxerListener(output_stats)));
+      muxer_listener = std::move(combined_listener);
+      stats_reporter->AddOutput(stream.input, stream_label, output_name, muxer,
+                                output_stats);
+    }
     muxer->SetMuxerListener(std::move(muxer_listener));
 
     std::vector<std::shared_ptr<MediaHandler>> handlers;
-    handlers.emplace_back(replicator);
-
-    // Trick play is optional.
-    if (stream.trick_play_factor) {
-      handlers.emplace_back(
-          std::make_shared<TrickPlayHandler>(stream.trick_play_factor));
-    }
-
-    if (stream.cc_index >= 0) {
-      handlers.emplace_back(
-          std::make_shared<CcStreamFilter>(stream.language, stream.cc_index));
-    }
+    handlers.emplace_back(stream_handler);
 
     if (is_text &&
         (!stream.segment_template.empty() || output_format == CONTAINER_MOV)) {
@@ -713,13 +1295,32 @@ Status CreateAudioVideoJobs(
       }
     }
 
+    // A muxer shared by several streams takes them from a single thread.
+    const bool shared_muxer =
+        output_format == CONTAINER_MPEG2TS &&
+        num_segment_template_streams[stream.segment_template] > 1;
+    if (shared_muxer)
+      shared_ts_muxers[stream.segment_template] = muxer;
+    if (packaging_params.mux_outputs_in_parallel &&
+        !packaging_params.single_threaded && !shared_muxer) {
+      handlers.emplace_back(
+          std::make_shared<ThreadedHandler>(kMaxPendingStreamData));
+      AddHandlerStats(stats_reporter, stream_label,
+                      "ThreadedHandler:" + output_name, handlers.back());
+    }
+
     handlers.emplace_back(muxer);
+    AddHandlerStats(stats_reporter, stream_label, "Muxer:" + output_name,
+                    muxer);
     RETURN_IF_ERROR(MediaHandler::Chain(handlers));
   }
 
   return Status::OK;
 }
 
+// Creates and initializes the jobs packaging |stream_descriptors|. The cue
+// alignment handlers of the jobs, if any, are added to |cue_aligners| if it is
+// not null.
 Status CreateAllJobs(const std::vector<StreamDescriptor>& stream_descriptors,
                      const PackagingParams& packaging_params,
                      MpdNotifier* mpd_notifier,
@@ -727,12 +1328,19 @@ Status CreateAllJobs(const std::vector<StreamDescriptor>& stream_descriptors,
                      SyncPointQueue* sync_points,
                      MuxerListenerFactory* muxer_listener_factory,
                      MuxerFactory* muxer_factory,
-                     JobManager* job_manager) {
+                     MediaHandlerStatsReporter* stats_reporter,
+                     JobManager* job_manager,
+                     std::vector<std::shared_ptr<CueAlignmentHandler>>*
+                         cue_aligners) {
   DCHECK(muxer_factory);
   DCHECK(muxer_listener_factory);
   DCHECK(job_manager);
 
-  // Group all streams based on which pipeline they will use.
+  // Group all streams based on which pipeline they will use. Only TTML inputs,
+  // which are copied as is, are left out of the audio/video pipeline. The text
+  // streams of the other inputs, e.g. DVB-sub or teletext in TS, go through it,
+  // so they share the single demuxer of their input with its audio and video
+  // streams.
   std::vector<std::reference_wrapper<const StreamDescriptor>> ttml_streams;
   std::vector<std::reference_wrapper<const StreamDescriptor>>
       audio_video_streams;
@@ -787,27 +1395,191 @@ Status CreateAllJobs(const std::vector<StreamDescriptor>& stream_descriptors,
                                  muxer_factory, mpd_notifier, job_manager));
   RETURN_IF_ERROR(CreateAudioVideoJobs(
       audio_video_streams, packaging_params, encryption_key_source, sync_points,
-      muxer_listener_factory, muxer_factory, job_manager));
+      muxer_listener_factory, muxer_factory, stats_reporter, job_manager,
+      cue_aligners));
 
   // Initialize processing graph.
   return job_manager->InitializeJobs();
 }
 
+// Copies |stream_descriptors| to |streams_for_jobs|, with the inputs and
+// outputs going through the buffer callbacks if set, and the languages in
+// ISO-639-2.
+Status PrepareStreamsForJobs(
+    const BufferCallbackParams& buffer_callback_params,
+    const std::vector<StreamDescriptor>& stream_descriptors,
+    std::vector<StreamDescriptor>* streams_for_jobs) {
+  for (const StreamDescriptor& descriptor : stream_descriptors) {
+    // We may need to overwrite some values, so make a copy first.
+    StreamDescriptor copy = descriptor;
+
+    if (buffer_callback_params.read_func) {
+      copy.input = File::MakeCallbackFileName(buffer_callback_params,
+                                              descriptor.input);
+      for (std::string& next_input : copy.next_inputs) {
+        next_input =
+            File::MakeCallbackFileName(buffer_callback_params, next_input);
+      }
+    }
+
+    if (buffer_callback_params.write_func ||
+        buffer_callback_params.write_buffers_func) {
+      copy.output = File::MakeCallbackFileName(buffer_callback_params,
+                                               descriptor.output);
+      copy.segment_template = File::MakeCallbackFileName(
+          buffer_callback_params, descriptor.segment_template);
+    }
+
+    // Update language to ISO_639_2 code if set.
+    if (!copy.language.empty()) {
+      copy.language = LanguageToISO_639_2(descriptor.language);
+      if (copy.language == "und") {
+        return Status(
+            error::INVALID_ARGUMENT,
+            "Unknown/invalid language specified: " + descriptor.language);
+      }
+    }
+
+    streams_for_jobs->push_back(copy);
+  }
+  return Status::OK;
+}
+
+// Creates the encryption key source once a stream needs it, instead of when
+// encryption is configured, as creating it may fetch the keys from the key
+// server, which is wasted if all the streams skip encryption.
+Status CreateEncryptionKeySourceIfNeeded(
+    const EncryptionParams& encryption_params,
+    const std::vector<StreamDescriptor>& stream_descriptors,
+    std::unique_ptr<KeySource>* encryption_key_source) {
+  if (encryption_params.key_provider == KeyProvider::kNone ||
+      *encryption_key_source) {
+    return Status::OK;
+  }
+  const bool needs_encryption = std::any_of(
+      stream_descriptors.begin(), stream_descriptors.end(),
+      [](const StreamDescriptor& stream) { return !stream.skip_encryption; });
+  if (!needs_encryption)
+    return Status::OK;
+  *encryption_key_source = CreateEncryptionKeySource(
+      static_cast<media::FourCC>(encryption_params.protection_scheme),
+      encryption_params);
+  if (!*encryption_key_source)
+    return Status(error::INVALID_ARGUMENT, "Failed to create key source.");
+  return Status::OK;
+}
+
 }  // namespace
 }  // namespace media
 
 struct Packager::PackagerInternal {
   media::FakeClock fake_clock;
   std::unique_ptr<KeySource> encryption_key_source;
+  // Outlives the notifiers which save to it.
+  std::unique_ptr<ManifestCheckpoint> checkpoint;
   std::unique_ptr<MpdNotifier> mpd_notifier;
   std::unique_ptr<hls::HlsNotifier> hls_notifier;
+  // Outlives the muxers which record to it.
+  std::unique_ptr<media::SegmentCheckpoint> segment_checkpoint;
+  std::unique_ptr<media::SegmentDigestFile> segment_digest_file;
   BufferCallbackParams buffer_callback_params;
   std::unique_ptr<media::JobManager> job_manager;
+  std::unique_ptr<media::MediaHandlerStatsReporter> stats_reporter;
+  std::unique_ptr<media::TraceWriter> trace_writer;
+  // Set once Run() or RunAsync() is called.
+  bool run_started = false;
+  // Set once the pipeline completes. The Packager can then be initialized
+  // again. Set on the packaging thread with RunAsync().
+  std::atomic<bool> run_completed{false};
+
+  // Used by AddStreams() to create the jobs of the added streams.
+  PackagingParams packaging_params;
+  std::unique_ptr<media::MuxerFactory> muxer_factory;
+  std::unique_ptr<media::MuxerListenerFactory> muxer_listener_factory;
+
+  // The streams added with AddStreams().
+  struct StreamGroup {
+    std::vector<std::shared_ptr<media::CueAlignmentHandler>> cue_aligners;
+  };
+  // Serializes AddStreams() and RemoveStreams(), and protects the members
+  // below.
+  base::Lock stream_groups_lock;
+  // All the stream descriptors, including the removed ones, so that their
+  // outputs are not reused.
+  std::vector<StreamDescriptor> stream_descriptors;
+  std::map<uint32_t, StreamGroup> stream_groups;
+  uint32_t next_stream_group_id = 0;
+
+  // Set by RunAsync(), along with the packaging thread, the completion
+  // callback and the status of the pipeline.
+  bool run_async = false;
+  std::unique_ptr<media::ClosureThread> run_thread;
+  std::function<void(const Status& status)> completion_callback;
+  Status async_status;
+
+  // Runs the jobs and flushes the manifests.
+  Status RunJobs();
+  // Runs the pipeline to completion.
+  Status Run();
+  // Runs the pipeline on |run_thread|, then calls |completion_callback|.
+  void RunAndNotify();
 };
 
+Status Packager::PackagerInternal::RunJobs() {
+  if (stats_reporter)
+    stats_reporter->Start();
+  const Status status = job_manager->RunJobs();
+  if (stats_reporter)
+    stats_reporter->Stop();
+  RETURN_IF_ERROR(status);
+  if (segment_checkpoint)
+    RETURN_IF_ERROR(segment_checkpoint->Close());
+  if (segment_digest_file)
+    RETURN_IF_ERROR(segment_digest_file->Close());
+
+  if (hls_notifier) {
+    if (!hls_notifier->Flush())
+      return Status(error::INVALID_ARGUMENT, "Failed to flush Hls.");
+  }
+  if (mpd_notifier) {
+    if (!mpd_notifier->Flush())
+      return Status(error::INVALID_ARGUMENT, "Failed to flush Mpd.");
+  }
+  if (trace_writer)
+    RETURN_IF_ERROR(trace_writer->Stop());
+  return Status::OK;
+}
+
+Status Packager::PackagerInternal::Run() {
+  Status status = RunJobs();
+  // The segments out of the live window are deleted in the background.
+  FileDeletionQueue::GetInstance()->Flush();
+  // So are the HTTP outputs uploaded, if enabled.
+  if (FileUploadQueue::IsEnabled() &&
+      !FileUploadQueue::GetInstance()->Flush() && status.ok()) {
+    status = Status(error::FILE_FAILURE,
+                    "Failed to upload some of the outputs after retries.");
+  }
+  if (packaging_params.memory_budget_bytes > 0)
+    LOG(INFO) << MemoryBudget::GetInstance()->ToString();
+  run_completed = true;
+  return status;
+}
+
+void Packager::PackagerInternal::RunAndNotify() {
+  async_status = Run();
+  if (completion_callback)
+    completion_callback(async_status);
+}
+
 Packager::Packager() {}
 
-Packager::~Packager() {}
+Packager::~Packager() {
+  // Waits for the pipeline started with RunAsync(), if any. ClosureThread
+  // joins on destruction.
+  if (internal_)
+    internal_->run_thread.reset();
+}
 
 Status Packager::Initialize(
     const PackagingParams& packaging_params,
@@ -816,10 +1588,15 @@ Status Packager::Initialize(
   static base::AtExitManager exit;
   static media::LibcryptoThreading libcrypto_threading;
 
-  if (internal_)
+  if (internal_ && !internal_->run_completed)
     return Status(error::INVALID_ARGUMENT, "Already initialized.");
+  // Waits for the packaging thread of RunAsync(), if any, to exit.
+  if (internal_)
+    internal_->run_thread.reset();
 
   RETURN_IF_ERROR(media::ValidateParams(packaging_params, stream_descriptors));
+  // Release the previous job, if any, before setting up the new one.
+  internal_.reset();
 
   if (!packaging_params.test_params.injected_library_version.empty()) {
     SetPackagerVersionForTesting(
@@ -828,16 +1605,21 @@ Status Packager::Initialize(
 
   std::unique_ptr<PackagerInternal> internal(new PackagerInternal);
 
-  // Create encryption key source if needed.
-  if (packaging_params.encryption_params.key_provider != KeyProvider::kNone) {
-    internal->encryption_key_source = CreateEncryptionKeySource(
-        static_cast<media::FourCC>(
-            packaging_params.encryption_params.protection_scheme),
-        packaging_params.encryption_params);
-    if (!internal->encryption_key_source)
-      return Status(error::INVALID_ARGUMENT, "Failed to create key source.");
+  if (packaging_params.memory_budget_bytes > 0) {
+    MemoryBudget::GetInstance()->set_limit(
+        packaging_params.memory_budget_bytes);
+  }
+
+  if (!packaging_params.trace_output.empty()) {
+    internal->trace_writer.reset(
+        new media::TraceWriter(packaging_params.trace_output));
+    internal->trace_writer->Start();
   }
 
+  RETURN_IF_ERROR(media::CreateEncryptionKeySourceIfNeeded(
+      packaging_params.encryption_params, stream_descriptors,
+      &internal->encryption_key_source));
+
   // Update MPD output and HLS output if needed.
   MpdParams mpd_params = packaging_params.mpd_params;
   HlsParams hls_params = packaging_params.hls_params;
@@ -848,10 +1630,19 @@ Status Packager::Initialize(
       packaging_params.chunking_params.segment_duration_in_seconds;
   mpd_params.target_segment_duration = target_segment_duration;
   hls_params.target_segment_duration = target_segment_duration;
+  if (mpd_params.target_chunk_duration <= 0) {
+    mpd_params.target_chunk_duration =
+        packaging_params.chunking_params.subsegment_duration_in_seconds;
+  }
+  if (hls_params.target_part_duration <= 0) {
+    hls_params.target_part_duration =
+        packaging_params.chunking_params.subsegment_duration_in_seconds;
+  }
 
   // Store callback params to make it available during packaging.
   internal->buffer_callback_params = packaging_params.buffer_callback_params;
-  if (internal->buffer_callback_params.write_func) {
+  if (internal->buffer_callback_params.write_func ||
+      internal->buffer_callback_params.write_buffers_func) {
     mpd_params.mpd_output = File::MakeCallbackFileName(
         internal->buffer_callback_params, mpd_params.mpd_output);
     hls_params.master_playlist_output = File::MakeCallbackFileName(
@@ -872,21 +1663,52 @@ Status Packager::Initialize(
   hls_params.is_independent_segments =
       packaging_params.chunking_params.segment_sap_aligned;
 
+  if (!packaging_params.checkpoint_file.empty()) {
+    internal->checkpoint.reset(
+        new ManifestCheckpoint(packaging_params.checkpoint_file,
+                               packaging_params.checkpoint_interval));
+    if (packaging_params.resume_from_checkpoint &&
+        !internal->checkpoint->Load()) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Failed to load the checkpoint " +
+                        packaging_params.checkpoint_file);
+    }
+  }
+
   if (!mpd_params.mpd_output.empty()) {
     const bool on_demand_dash_profile =
         stream_descriptors.begin()->segment_template.empty();
     const MpdOptions mpd_options =
         media::GetMpdOptions(on_demand_dash_profile, mpd_params);
-    internal->mpd_notifier.reset(new SimpleMpdNotifier(mpd_options));
+    std::unique_ptr<SimpleMpdNotifier> mpd_notifier(
+        new SimpleMpdNotifier(mpd_options));
+    if (!on_demand_dash_profile)
+      mpd_notifier->set_checkpoint(internal->checkpoint.get());
+    internal->mpd_notifier = std::move(mpd_notifier);
     if (!internal->mpd_notifier->Init()) {
       LOG(ERROR) << "MpdNotifier failed to initialize.";
       return Status(error::INVALID_ARGUMENT,
                     "Failed to initialize MpdNotifier.");
     }
   }
+  if (!mpd_params.mpd_aggregator_url.empty()) {
+    // Only the live profile is supported with the aggregator.
+    internal->mpd_notifier.reset(new RemoteMpdNotifier(
+        media::GetMpdOptions(false, mpd_params),
+        mpd_params.mpd_aggregator_url));
+  }
 
   if (!hls_params.master_playlist_output.empty()) {
-    internal->hls_notifier.reset(new hls::SimpleHlsNotifier(hls_params));
+    std::unique_ptr<hls::SimpleHlsNotifier> hls_notifier(
+        new hls::SimpleHlsNotifier(hls_params));
+    if (hls_params.playlist_type != HlsPlaylistType::kVod)
+      hls_notifier->set_checkpoint(internal->checkpoint.get());
+    internal->hls_notifier = std::move(hls_notifier);
+    if (!internal->hls_notifier->Init()) {
+      LOG(ERROR) << "HlsNotifier failed to initialize.";
+      return Status(error::INVALID_ARGUMENT,
+                    "Failed to initialize HlsNotifier.");
+    }
   }
 
   std::unique_ptr<SyncPointQueue> sync_points;
@@ -895,59 +1717,88 @@ Status Packager::Initialize(
         new SyncPointQueue(packaging_params.ad_cue_generator_params));
   }
   if (packaging_params.single_threaded) {
+    if (packaging_params.interleave_jobs && sync_points) {
+      LOG(WARNING) << "interleave_jobs is ignored as cue alignment requires "
+                      "all the streams to be processed concurrently.";
+    }
+    const bool interleave_jobs =
+        packaging_params.interleave_jobs && !sync_points;
     internal->job_manager.reset(
-        new SingleThreadJobManager(std::move(sync_points)));
+        new SingleThreadJobManager(std::move(sync_points), interleave_jobs));
+  } else if (packaging_params.num_worker_threads > 0 && !sync_points &&
+             !media::IsLivePackaging(packaging_params, stream_descriptors)) {
+    internal->job_manager.reset(new ThreadPoolJobManager(
+        std::move(sync_points),
+        static_cast<size_t>(packaging_params.num_worker_threads)));
   } else {
+    if (packaging_params.num_worker_threads > 0 && sync_points) {
+      LOG(WARNING) << "num_worker_threads is ignored as cue alignment "
+                      "requires all the streams to be processed concurrently.";
+    } else if (packaging_params.num_worker_threads > 0) {
+      LOG(WARNING) << "num_worker_threads is ignored for live packaging, as a "
+                      "live job never completes and would keep its worker "
+                      "thread from the jobs waiting for one.";
+    }
     internal->job_manager.reset(new JobManager(std::move(sync_points)));
   }
 
   std::vector<StreamDescriptor> streams_for_jobs;
+  RETURN_IF_ERROR(media::PrepareStreamsForJobs(
+      internal->buffer_callback_params, stream_descriptors, &streams_for_jobs));
 
-  for (const StreamDescriptor& descriptor : stream_descriptors) {
-    // We may need to overwrite some values, so make a copy first.
-    StreamDescriptor copy = descriptor;
-
-    if (internal->buffer_callback_params.read_func) {
-      copy.input = File::MakeCallbackFileName(internal->buffer_callback_params,
-                                              descriptor.input);
-    }
+  if (packaging_params.handler_stats_params.stats_callback)
+    media::MediaHandler::EnableStats(true);
+  // Also tracks the progress of the outputs for GetStats().
+  internal->stats_reporter.reset(new media::MediaHandlerStatsReporter(
+      packaging_params.handler_stats_params));
 
-    if (internal->buffer_callback_params.write_func) {
-      copy.output = File::MakeCallbackFileName(internal->buffer_callback_params,
-                                               descriptor.output);
-      copy.segment_template = File::MakeCallbackFileName(
-          internal->buffer_callback_params, descriptor.segment_template);
+  internal->muxer_factory.reset(new media::MuxerFactory(packaging_params));
+  if (packaging_params.test_params.inject_fake_clock) {
+    internal->muxer_factory->OverrideClock(&internal->fake_clock);
+  }
+  if (!packaging_params.segment_checkpoint_file.empty()) {
+    internal->segment_checkpoint.reset(
+        new media::SegmentCheckpoint(packaging_params.segment_checkpoint_file));
+    RETURN_IF_ERROR(internal->segment_checkpoint->Open(
+        packaging_params.resume_from_checkpoint));
+    internal->muxer_factory->SetSegmentCheckpoint(
+        internal->segment_checkpoint.get());
+  }
+  if (!packaging_params.segment_digests.empty() ||
+      !packaging_params.segment_digest_file.empty()) {
+    std::vector<media::DigestAlgorithm> segment_digests;
+    if (!media::ParseDigestAlgorithms(packaging_params.segment_digests,
+                                      &segment_digests) ||
+        segment_digests.empty()) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Invalid segment_digests: " +
+                        packaging_params.segment_digests);
     }
-
-    // Update language to ISO_639_2 code if set.
-    if (!copy.language.empty()) {
-      copy.language = LanguageToISO_639_2(descriptor.language);
-      if (copy.language == "und") {
-        return Status(
-            error::INVALID_ARGUMENT,
-            "Unknown/invalid language specified: " + descriptor.language);
-      }
+    if (!packaging_params.segment_digest_file.empty()) {
+      internal->segment_digest_file.reset(new media::SegmentDigestFile(
+          packaging_params.segment_digest_file));
+      RETURN_IF_ERROR(internal->segment_digest_file->Open());
     }
-
-    streams_for_jobs.push_back(copy);
-  }
-
-  media::MuxerFactory muxer_factory(packaging_params);
-  if (packaging_params.test_params.inject_fake_clock) {
-    muxer_factory.OverrideClock(&internal->fake_clock);
+    internal->muxer_factory->SetSegmentDigests(
+        segment_digests, internal->segment_digest_file.get());
   }
 
-  media::MuxerListenerFactory muxer_listener_factory(
+  internal->muxer_listener_factory.reset(new media::MuxerListenerFactory(
       packaging_params.output_media_info,
       packaging_params.mpd_params.use_segment_list,
-      internal->mpd_notifier.get(), internal->hls_notifier.get());
+      internal->mpd_notifier.get(), internal->hls_notifier.get()));
+  internal->muxer_listener_factory->set_media_info_format(
+      media::GetMediaInfoFormat(packaging_params));
 
   RETURN_IF_ERROR(media::CreateAllJobs(
       streams_for_jobs, packaging_params, internal->mpd_notifier.get(),
       internal->encryption_key_source.get(),
-      internal->job_manager->sync_points(), &muxer_listener_factory,
-      &muxer_factory, internal->job_manager.get()));
+      internal->job_manager->sync_points(),
+      internal->muxer_listener_factory.get(), internal->muxer_factory.get(),
+      internal->stats_reporter.get(), internal->job_manager.get(), nullptr));
 
+  internal->packaging_params = packaging_params;
+  internal->stream_descriptors = stream_descriptors;
   internal_ = std::move(internal);
   return Status::OK;
 }
@@ -955,17 +1806,132 @@ Status Packager::Initialize(
 Status Packager::Run() {
   if (!internal_)
     return Status(error::INVALID_ARGUMENT, "Not yet initialized.");
+  if (internal_->run_started)
+    return Status(error::INVALID_ARGUMENT, "Already run.");
+  internal_->run_started = true;
+  return internal_->Run();
+}
 
-  RETURN_IF_ERROR(internal_->job_manager->RunJobs());
+Status Packager::RunAsync(
+    std::function<void(const Status& status)> completion_callback) {
+  if (!internal_)
+    return Status(error::INVALID_ARGUMENT, "Not yet initialized.");
+  if (internal_->run_started)
+    return Status(error::INVALID_ARGUMENT, "Already run.");
+  internal_->run_started = true;
+  internal_->run_async = true;
+  internal_->completion_callback = std::move(completion_callback);
+  internal_->run_thread.reset(new media::ClosureThread(
+      "PackagerRun", base::Bind(&PackagerInternal::RunAndNotify,
+                                base::Unretained(internal_.get()))));
+  internal_->run_thread->Start();
+  return Status::OK;
+}
 
-  if (internal_->hls_notifier) {
-    if (!internal_->hls_notifier->Flush())
-      return Status(error::INVALID_ARGUMENT, "Failed to flush Hls.");
+Status Packager::Wait() {
+  if (!internal_ || !internal_->run_async)
+    return Status(error::INVALID_ARGUMENT, "Not run with RunAsync().");
+  // ClosureThread joins on destruction.
+  internal_->run_thread.reset();
+  return internal_->async_status;
+}
+
+std::vector<StreamStats> Packager::GetStats() const {
+  if (!internal_ || !internal_->stats_reporter)
+    return std::vector<StreamStats>();
+  return internal_->stats_reporter->GetStreamStats();
+}
+
+Status Packager::AddStreams(
+    const std::vector<StreamDescriptor>& stream_descriptors,
+    uint32_t* stream_group_id) {
+  DCHECK(stream_group_id);
+  if (!internal_)
+    return Status(error::INVALID_ARGUMENT, "Not yet initialized.");
+
+  if (stream_descriptors.empty()) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Stream descriptors cannot be empty.");
   }
-  if (internal_->mpd_notifier) {
-    if (!internal_->mpd_notifier->Flush())
-      return Status(error::INVALID_ARGUMENT, "Failed to flush Mpd.");
+
+  base::AutoLock auto_lock(internal_->stream_groups_lock);
+  const PackagingParams& packaging_params = internal_->packaging_params;
+  // Validate the added streams along with the existing ones, e.g. so that
+  // their outputs are unique.
+  std::vector<StreamDescriptor> all_stream_descriptors =
+      internal_->stream_descriptors;
+  for (const StreamDescriptor& descriptor : stream_descriptors) {
+    // The demuxer of an input cannot be shared with a running job.
+    for (const StreamDescriptor& existing : internal_->stream_descriptors) {
+      if (descriptor.input == existing.input) {
+        return Status(error::INVALID_ARGUMENT,
+                      "Cannot add streams of input '" + descriptor.input +
+                          "', which is already being packaged.");
+      }
+    }
+    all_stream_descriptors.push_back(descriptor);
+  }
+  RETURN_IF_ERROR(
+      media::ValidateParams(packaging_params, all_stream_descriptors));
+
+  // The added streams may be the first ones to be encrypted.
+  RETURN_IF_ERROR(media::CreateEncryptionKeySourceIfNeeded(
+      packaging_params.encryption_params, stream_descriptors,
+      &internal_->encryption_key_source));
+
+  std::vector<StreamDescriptor> streams_for_jobs;
+  RETURN_IF_ERROR(media::PrepareStreamsForJobs(
+      internal_->buffer_callback_params, stream_descriptors,
+      &streams_for_jobs));
+
+  // The jobs are created and initialized in a temporary JobManager, then
+  // moved to the running one. They are not added to the handler statistics,
+  // which cannot be extended once reporting started.
+  media::JobManager jobs(nullptr);
+  PackagerInternal::StreamGroup stream_group;
+  Status status = media::CreateAllJobs(
+      streams_for_jobs, packaging_params, internal_->mpd_notifier.get(),
+      internal_->encryption_key_source.get(),
+      internal_->job_manager->sync_points(),
+      internal_->muxer_listener_factory.get(),
+      internal_->muxer_factory.get(), nullptr, &jobs,
+      &stream_group.cue_aligners);
+  const uint32_t group_id = internal_->next_stream_group_id++;
+  if (status.ok())
+    status = internal_->job_manager->AddInitializedJobs(group_id, &jobs);
+  if (!status.ok()) {
+    // The cue alignment handlers joined the sync points on initialization.
+    for (auto& cue_aligner : stream_group.cue_aligners)
+      cue_aligner->LeaveSyncPoints();
+    return status;
+  }
+
+  internal_->stream_descriptors.insert(internal_->stream_descriptors.end(),
+                                       stream_descriptors.begin(),
+                                       stream_descriptors.end());
+  internal_->stream_groups[group_id] = std::move(stream_group);
+  *stream_group_id = group_id;
+  return Status::OK;
+}
+
+Status Packager::RemoveStreams(uint32_t stream_group_id) {
+  if (!internal_)
+    return Status(error::INVALID_ARGUMENT, "Not yet initialized.");
+
+  base::AutoLock auto_lock(internal_->stream_groups_lock);
+  auto iter = internal_->stream_groups.find(stream_group_id);
+  if (iter == internal_->stream_groups.end()) {
+    return Status(error::NOT_FOUND, "Stream group " +
+                                        base::UintToString(stream_group_id) +
+                                        " not found.");
   }
+
+  RETURN_IF_ERROR(internal_->job_manager->StopJobs(stream_group_id));
+  // The jobs have exited, so the other jobs no longer need to wait for them
+  // at the next cue.
+  for (auto& cue_aligner : iter->second.cue_aligners)
+    cue_aligner->LeaveSyncPoints();
+  internal_->stream_groups.erase(iter);
   return Status::OK;
 }
 
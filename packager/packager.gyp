@@ -14,16 +14,24 @@
       'type': '<(libpackager_type)',
       'sources': [
         # TODO(kqyang): Clean up the file path.
+        'app/interleaved_jobs.cc',
+        'app/interleaved_jobs.h',
         'app/job_manager.cc',
         'app/job_manager.h',
         'app/muxer_factory.cc',
         'app/muxer_factory.h',
         'app/libcrypto_threading.cc',
         'app/libcrypto_threading.h',
+        'app/media_handler_stats_reporter.cc',
+        'app/media_handler_stats_reporter.h',
         'app/packager_util.cc',
         'app/packager_util.h',
         'app/single_thread_job_manager.cc',
         'app/single_thread_job_manager.h',
+        'app/thread_pool_job_manager.cc',
+        'app/thread_pool_job_manager.h',
+        'app/trace_writer.cc',
+        'app/trace_writer.h',
         'packager.cc',
         'packager.h',
       ],
@@ -70,12 +78,18 @@
         'app/ad_cue_generator_flags.h',
         'app/crypto_flags.cc',
         'app/crypto_flags.h',
+        'app/embedded_http_server.cc',
+        'app/embedded_http_server.h',
         'app/gflags_hex_bytes.cc',
         'app/gflags_hex_bytes.h',
         'app/hls_flags.cc',
         'app/hls_flags.h',
         'app/manifest_flags.cc',
         'app/manifest_flags.h',
+        'app/metrics_server.cc',
+        'app/metrics_server.h',
+        'app/mpd_aggregator_server.cc',
+        'app/mpd_aggregator_server.h',
         'app/mpd_flags.cc',
         'app/mpd_flags.h',
         'app/muxer_flags.cc',
@@ -89,6 +103,8 @@
         'app/protection_system_flags.h',
         'app/retired_flags.cc',
         'app/retired_flags.h',
+        'app/segment_server.cc',
+        'app/segment_server.h',
         'app/stream_descriptor.cc',
         'app/stream_descriptor.h',
         'app/validate_flag.cc',
@@ -101,7 +117,9 @@
       'dependencies': [
         'base/base.gyp:base',
         'libpackager',
+        'mpd/mpd.gyp:mpd_builder',
         'third_party/gflags/gflags.gyp:gflags',
+        'third_party/libevent/libevent.gyp:libevent',
         'tools/license_notice.gyp:license_notice',
       ],
       'conditions': [
@@ -128,6 +146,7 @@
       ],
       'dependencies': [
         'base/base.gyp:base',
+        'file/file.gyp:file',
         'mpd/mpd.gyp:mpd_util',
         'third_party/gflags/gflags.gyp:gflags',
         'tools/license_notice.gyp:license_notice',
@@ -153,6 +172,29 @@
         'testing/gtest.gyp:gtest_main',
       ],
     },
+    {
+      # Not part of packager_builder_tests, as the benchmarks take a while and
+      # their results are only meaningful in release builds.
+      'target_name': 'packager_benchmarks',
+      'type': '<(gtest_target_type)',
+      'sources': [
+        'packager_benchmarks.cc',
+      ],
+      'conditions': [
+        ['libpackager_type == "shared_library"', {
+          'defines': [
+            'SHARED_LIBRARY_BUILD',
+          ],
+        }],
+      ],
+      'dependencies': [
+        'base/base.gyp:base',
+        'libpackager',
+        'testing/gtest.gyp:gtest',
+        'testing/gtest.gyp:gtest_main',
+        'testing/perf/perf_test.gyp:perf_test',
+      ],
+    },
     {
       'target_name': 'packager_test_py_copy',
       'type': 'none',
@@ -200,6 +242,46 @@
         }],
       ],
     },
+    {
+      'target_name': 'app_unittest',
+      'type': '<(gtest_target_type)',
+      'sources': [
+        'app/embedded_http_server.cc',
+        'app/embedded_http_server.h',
+        'app/fake_origin_handler.h',
+        'app/interleaved_jobs.cc',
+        'app/interleaved_jobs.h',
+        'app/interleaved_jobs_unittest.cc',
+        'app/job_manager.cc',
+        'app/job_manager.h',
+        'app/job_manager_unittest.cc',
+        'app/libcrypto_threading.cc',
+        'app/libcrypto_threading.h',
+        'app/mpd_aggregator_server.cc',
+        'app/mpd_aggregator_server.h',
+        'app/mpd_aggregator_server_unittest.cc',
+        'app/segment_server.cc',
+        'app/segment_server.h',
+        'app/segment_server_unittest.cc',
+        'app/single_thread_job_manager.cc',
+        'app/single_thread_job_manager.h',
+        'app/single_thread_job_manager_unittest.cc',
+      ],
+      'dependencies': [
+        'base/base.gyp:base',
+        'file/file.gyp:file',
+        'media/base/media_base.gyp:media_base',
+        'media/chunking/chunking.gyp:chunking',
+        'media/origin/origin.gyp:origin',
+        'media/test/media_test.gyp:run_tests_with_atexit_manager',
+        'mpd/mpd.gyp:mpd_builder',
+        'mpd/mpd.gyp:mpd_mocks',
+        'testing/gmock.gyp:gmock',
+        'testing/gtest.gyp:gtest',
+        'third_party/boringssl/boringssl.gyp:boringssl',
+        'third_party/libevent/libevent.gyp:libevent',
+      ],
+    },
     {
       'target_name': 'status_unittest',
       'type': '<(gtest_target_type)',
@@ -217,6 +299,7 @@
       'target_name': 'packager_builder_tests',
       'type': 'none',
       'dependencies': [
+        'app_unittest',
         'file/file.gyp:file_unittest',
         'hls/hls.gyp:hls_unittest',
         'media/base/media_base.gyp:media_base_unittest',
@@ -233,6 +316,7 @@
         'media/formats/webm/webm.gyp:webm_unittest',
         'media/formats/webvtt/webvtt.gyp:webvtt_unittest',
         'media/formats/wvm/wvm.gyp:wvm_unittest',
+        'media/origin/origin.gyp:origin_unittest',
         'media/trick_play/trick_play.gyp:trick_play_unittest',
         'mpd/mpd.gyp:mpd_unittest',
         'packager_test',
@@ -7,6 +7,7 @@
 #ifndef PACKAGER_PACKAGER_H_
 #define PACKAGER_PACKAGER_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -16,6 +17,7 @@
 #include "packager/media/public/ad_cue_generator_params.h"
 #include "packager/media/public/chunking_params.h"
 #include "packager/media/public/crypto_params.h"
+#include "packager/media/public/handler_stats_params.h"
 #include "packager/media/public/mp4_output_params.h"
 #include "packager/mpd/public/mpd_params.h"
 #include "packager/status.h"
@@ -44,6 +46,12 @@ struct PackagingParams {
   /// audio) timestamps to compensate for possible negative timestamps in the
   /// input.
   uint32_t transport_stream_timestamp_offset_ms = 0;
+  /// Copy the TS packets of the streams of MPEG2-TS inputs to MPEG2-TS
+  /// segment template outputs without reassembling their PES packets. The
+  /// segments are cut at the PES packets starting with a key frame, and get
+  /// a new PAT and PMT. Streams that need encryption or sample processing, or
+  /// which do not carry the PCR, are demuxed as before.
+  bool ts_passthrough = false;
   /// Chunking (segmentation) related parameters.
   ChunkingParams chunking_params;
 
@@ -53,9 +61,77 @@ struct PackagingParams {
   /// Create a human readable format of MediaInfo. The output file name will be
   /// the name specified by output flag, suffixed with `.media_info`.
   bool output_media_info = false;
+  /// Write the MediaInfo files as binary serialized protobuf instead of the
+  /// human readable text format. They are smaller and faster to parse, e.g.
+  /// by mpd_generator, in particular with `use_segment_list`.
+  bool binary_media_info = false;
+  /// Compress the binary MediaInfo files with gzip. Only used with
+  /// `binary_media_info`.
+  bool compress_media_info = false;
   /// Only use a single thread to generate output.  This is useful in tests to
   /// avoid non-deterministic outputs.
   bool single_threaded = false;
+  /// With `single_threaded`, run the jobs in turns, one buffer of input at a
+  /// time, skipping the jobs waiting for input, instead of one after the
+  /// other. This allows live jobs to share the single thread. Ignored if ad
+  /// cues need to be aligned across streams.
+  bool interleave_jobs = false;
+  /// Number of worker threads used to run the packaging jobs. If positive, the
+  /// jobs, one per input, share a fixed pool of worker threads instead of
+  /// using one thread per job. 0 means one thread per job. Ignored if
+  /// `single_threaded` is set, if ad cues need to be aligned across streams,
+  /// which requires all the jobs to run concurrently, or for live packaging,
+  /// i.e. with UDP inputs or live playlists, as live jobs never release their
+  /// worker threads.
+  int num_worker_threads = 0;
+  /// Process each stream of an input on its own thread, decoupled from the
+  /// thread demuxing the input, so chunking, encryption and muxing of the
+  /// streams of a single input run concurrently. Each stream is still
+  /// packaged in a single ordered pass, i.e. it is not split into time ranges
+  /// packaged concurrently, so a single stream input does not benefit from it.
+  /// Ignored if `single_threaded` is set.
+  bool process_streams_in_parallel = false;
+  /// Mux and write each output on its own thread, decoupled from the thread
+  /// chunking and encrypting its stream, so a slow output, e.g. an HTTP
+  /// upload, does not stall the parsing and the other outputs until its
+  /// queue is full. Ignored if `single_threaded` is set.
+  bool mux_outputs_in_parallel = false;
+  /// Budget, in bytes, of the samples each demuxer queues across its streams
+  /// until the stream info of all of them is known. Demuxing the input fails
+  /// once it is exceeded. 0 means the default budget of 256MB.
+  uint64_t max_queued_sample_bytes = 0;
+  /// Budget, in bytes, of the memory held by the IO caches, the samples
+  /// queued by the demuxers and in the fragments being built, and the
+  /// store:// files, shared by all the packagers of the process. While it is
+  /// exceeded, input reads are delayed so the outputs catch up. The memory use
+  /// is logged when Run() completes. 0 means no budget.
+  uint64_t memory_budget_bytes = 0;
+  /// Path of the local file where the state of the live manifests, e.g. the
+  /// segments in the live window and the sequence numbers, is checkpointed
+  /// as they are updated. Empty means no checkpoint.
+  std::string checkpoint_file;
+  /// Minimum interval, in seconds, between the writes of `checkpoint_file`.
+  /// 0 means the checkpoint is written on every manifest update.
+  double checkpoint_interval = 0;
+  /// Path of the local file where the media segment files written are
+  /// recorded, e.g. for long VOD jobs which may be interrupted. Only MP4 and
+  /// MPEG2-TS outputs with a segment template are recorded. Empty means no
+  /// record.
+  std::string segment_checkpoint_file;
+  /// Resume from `checkpoint_file` and `segment_checkpoint_file` if they
+  /// exist, so that a restarted packager continues the live manifests
+  /// instead of starting them over, and does not write again the segments
+  /// which are already written.
+  bool resume_from_checkpoint = false;
+  /// Comma separated list of the digests, "md5" and "sha256", computed for
+  /// each media segment file as it is written, e.g. for the integrity checks
+  /// of a CDN. Only applies to the outputs with a segment template. Empty
+  /// means no digest.
+  std::string segment_digests;
+  /// Path of the file where the digests of the media segment files are
+  /// recorded, "<algorithm>:<hex digest>... <file name>" per line. Requires
+  /// `segment_digests`.
+  std::string segment_digest_file;
   /// DASH MPD related parameters.
   MpdParams mpd_params;
   /// HLS related parameters.
@@ -68,6 +144,15 @@ struct PackagingParams {
   /// Buffer callback params.
   BufferCallbackParams buffer_callback_params;
 
+  /// Media handler statistics parameters.
+  HandlerStatsParams handler_stats_params;
+
+  /// If set, the trace events of the packaging jobs, e.g. demuxing, parsing,
+  /// encryption, segment finalization, file writes and manifest flushes, are
+  /// written to this file in the Chrome trace JSON format when Run()
+  /// completes.
+  std::string trace_output;
+
   // Parameters for testing. Do not use in production.
   TestParams test_params;
 };
@@ -84,7 +169,8 @@ struct StreamDescriptor {
   /// Specifies output file path or init segment path (if segment template is
   /// specified). Can be empty for self initialization media segments.
   std::string output;
-  /// Specifies segment template. Can be empty.
+  /// Specifies segment template. Can be empty. The TS outputs of the audio and
+  /// video streams of the same input may share it, to be muxed together.
   std::string segment_template;
 
   /// Optional value which specifies output container format, e.g. "mp4". If not
@@ -140,14 +226,41 @@ struct StreamDescriptor {
   bool dash_only = false;
   /// Set to true to indicate that the stream is for hls only.
   bool hls_only = false;
+
+  /// Optional start of the time range of the input to package, in seconds,
+  /// from the first timestamp of the input. Each audio and video stream
+  /// starts at its sync sample at or before it. Must be the same for all the
+  /// streams of an input.
+  double start_time_in_seconds = 0;
+  /// Optional end of the time range of the input to package, in seconds,
+  /// from the first timestamp of the input. The samples decoded at or after
+  /// it are left out. 0 means the end of the input. Must be the same for all
+  /// the streams of an input.
+  double end_time_in_seconds = 0;
+  /// Optional inputs played after `input`, back to back, into the same
+  /// outputs, e.g. for ad-stitched titles. Their timestamps are shifted to
+  /// follow the previous input. The init segment is kept if their codec
+  /// configuration is the same, otherwise a new Period is started, which
+  /// needs an output file name template except for TS outputs, and HLS
+  /// playlists get a discontinuity. Must be the same for all the streams of an
+  /// input.
+  std::vector<std::string> next_inputs;
 };
 
+/// Packages a job, i.e. a set of streams, at a time. A Packager can be reused
+/// to package a sequence of jobs, by calling Initialize() again once Run()
+/// returns, and multiple Packagers can run jobs concurrently in the same
+/// process. The process wide resources, e.g. the BoringSSL setup, the HTTP
+/// connection pool, the pooled output I/O threads and the on-disk key cache,
+/// are set up once and shared by all the jobs, which avoids paying the
+/// startup cost of a packager process for every short job.
 class SHAKA_EXPORT Packager {
  public:
   Packager();
   ~Packager();
 
-  /// Initialize packaging pipeline.
+  /// Initialize packaging pipeline. Can be called again after Run() returns
+  /// to package another job, which releases the previous one.
   /// @param packaging_params contains the packaging parameters.
   /// @param stream_descriptors a list of stream descriptors.
   /// @return OK on success, an appropriate error code on failure.
@@ -156,11 +269,64 @@ class SHAKA_EXPORT Packager {
       const std::vector<StreamDescriptor>& stream_descriptors);
 
   /// Run the pipeline to completion (or failed / been cancelled). Note
-  /// that it blocks until completion.
+  /// that it blocks until completion. Can only be called once per
+  /// Initialize().
   /// @return OK on success, an appropriate error code on failure.
   Status Run();
 
-  /// Cancel packaging. Note that it has to be called from another thread.
+  /// Like Run(), but runs the pipeline on its own thread and returns
+  /// immediately, so that a process can drive many jobs without a thread
+  /// blocking on each. Cancel(), AddStreams(), RemoveStreams() and GetStats()
+  /// can be called while it runs. Can only be called once per Initialize(),
+  /// instead of Run().
+  /// @param completion_callback is called on the packaging thread with the
+  ///        status Run() would return, once the pipeline completes. It must
+  ///        not call Initialize() or destroy the Packager. Can be null.
+  /// @return OK if the pipeline is started, an appropriate error code
+  ///         otherwise, in which case @a completion_callback is not called.
+  Status RunAsync(
+      std::function<void(const Status& status)> completion_callback);
+
+  /// Waits for the pipeline started with RunAsync() to complete. The
+  /// Packager can then be initialized again. Destroying the Packager or
+  /// calling Initialize() also waits for it.
+  /// @return The status Run() would return.
+  Status Wait();
+
+  /// Get the progress of the output streams of the job. Can be called from
+  /// any thread, e.g. while Run() blocks on another thread, but not
+  /// concurrently with Initialize(). The streams added with AddStreams() and
+  /// the outputs copied without demuxing, e.g. with `ts_passthrough`, are not
+  /// included.
+  /// @return The progress of the output streams, one entry per output.
+  std::vector<StreamStats> GetStats() const;
+
+  /// Add streams to the packaging, typically to a live packaging blocking in
+  /// Run() on another thread, e.g. a rendition to the ladder of a channel.
+  /// The streams are packaged by new jobs, which share the manifests, the
+  /// encryption keys and the ad cue alignment of the running jobs. Not
+  /// supported with `single_threaded` or `num_worker_threads`.
+  /// @param stream_descriptors the streams to add. Their inputs must not be
+  ///        used by the other streams. They are validated along with the
+  ///        other streams, e.g. all or none of them have segment templates.
+  /// @param[out] stream_group_id identifies the added streams for
+  ///             RemoveStreams().
+  /// @return OK on success, an appropriate error code on failure.
+  Status AddStreams(const std::vector<StreamDescriptor>& stream_descriptors,
+                    uint32_t* stream_group_id);
+
+  /// Stop packaging streams added with AddStreams(), without stopping the
+  /// other streams. It blocks until their jobs exit, which, with ad cue
+  /// alignment, may take until the other jobs reach the next cue. The streams
+  /// are left in the manifests as they are, and their outputs cannot be
+  /// reused.
+  /// @param stream_group_id identifies the streams, as returned by
+  ///        AddStreams().
+  /// @return OK on success, an appropriate error code on failure.
+  Status RemoveStreams(uint32_t stream_group_id);
+
+  /// Cancel packaging. Note that it has to be called from another thread, and
+  /// not concurrently with Initialize().
   void Cancel();
 
   /// @return The version of the library.
@@ -0,0 +1,232 @@
+// Copyright 2020 Google LLC All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// End-to-end benchmarks of canonical packaging pipelines. Each benchmark
+// packages checked-in media to memory files a few times and reports the
+// throughput and the peak resident set size of the process in the format of
+// testing/perf/perf_test.h, so results can be collected and compared across
+// versions.
+//
+// Run from the packager repository root, e.g.
+//   out/Release/packager_benchmarks --gtest_filter=PackagerBenchmark.*
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/time/time.h"
+#include "packager/packager.h"
+#include "packager/testing/perf/perf_test.h"
+
+#if !defined(OS_WIN)
+#include <sys/resource.h>
+#endif  // !defined(OS_WIN)
+
+namespace shaka {
+namespace {
+
+const char kTestDataDir[] = "packager/media/test/data/";
+const int kIterations = 10;
+const double kSegmentDurationInSeconds = 2.0;
+const uint8_t kKeyId[] = {
+    0xe5, 0x00, 0x7e, 0x6e, 0x9d, 0xcd, 0x5a, 0xc0,
+    0x95, 0x20, 0x2e, 0xd3, 0x75, 0x83, 0x82, 0xcd,
+};
+const uint8_t kKey[]{
+    0x6f, 0xc9, 0x6f, 0xe6, 0x28, 0xa2, 0x65, 0xb1,
+    0x3a, 0xed, 0xde, 0xc0, 0xbc, 0x42, 0x1f, 0x4d,
+};
+
+// Returns the size of the file in bytes, or a negative value on error.
+int64_t GetLocalFileSize(const std::string& file_name) {
+  FILE* f = fopen(file_name.c_str(), "rb");
+  if (!f)
+    return -1;
+  int64_t size = -1;
+  if (fseek(f, 0, SEEK_END) == 0)
+    size = ftell(f);
+  fclose(f);
+  return size;
+}
+
+// Returns the peak resident set size of the process in kilobytes, or 0 if it
+// is not available on the platform.
+size_t GetPeakRssInKb() {
+#if !defined(OS_WIN)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+#if defined(__APPLE__)
+  // ru_maxrss is in bytes on Mac.
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif  // defined(__APPLE__)
+#else
+  return 0;
+#endif  // !defined(OS_WIN)
+}
+
+}  // namespace
+
+class PackagerBenchmark : public ::testing::Test {
+ public:
+  void SetUp() override {
+    if (GetLocalFileSize(GetInputPath("bear-640x360.mp4")) < 0) {
+      FAIL() << "The benchmark is expected to run from packager repository "
+                "root.";
+    }
+  }
+
+ protected:
+  std::string GetInputPath(const std::string& file_name) {
+    return std::string(kTestDataDir) + file_name;
+  }
+
+  // Outputs are overwritten in every iteration, so memory use does not grow
+  // with the number of iterations.
+  std::string GetOutputPath(const std::string& file_name) {
+    return base::StringPrintf(
+        "memory://benchmark/%s/%s",
+        ::testing::UnitTest::GetInstance()->current_test_info()->name(),
+        file_name.c_str());
+  }
+
+  PackagingParams SetupPackagingParams() {
+    PackagingParams packaging_params;
+    packaging_params.chunking_params.segment_duration_in_seconds =
+        kSegmentDurationInSeconds;
+    return packaging_params;
+  }
+
+  void EnableRawKeyEncryption(uint32_t protection_scheme,
+                              PackagingParams* packaging_params) {
+    EncryptionParams& encryption_params = packaging_params->encryption_params;
+    encryption_params.key_provider = KeyProvider::kRawKey;
+    encryption_params.protection_scheme = protection_scheme;
+    encryption_params.raw_key.key_map[""].key_id.assign(std::begin(kKeyId),
+                                                        std::end(kKeyId));
+    encryption_params.raw_key.key_map[""].key.assign(std::begin(kKey),
+                                                     std::end(kKey));
+  }
+
+  StreamDescriptor MakeStreamDescriptor(const std::string& input_file_name,
+                                        const std::string& stream_selector,
+                                        const std::string& output,
+                                        const std::string& segment_template) {
+    StreamDescriptor descriptor;
+    descriptor.input = GetInputPath(input_file_name);
+    descriptor.stream_selector = stream_selector;
+    if (!output.empty())
+      descriptor.output = GetOutputPath(output);
+    if (!segment_template.empty())
+      descriptor.segment_template = GetOutputPath(segment_template);
+    return descriptor;
+  }
+
+  // Runs the pipeline kIterations times and reports the results.
+  // |input_file_name| is the input the throughput is computed from.
+  void RunBenchmark(const std::string& input_file_name,
+                    const PackagingParams& packaging_params,
+                    const std::vector<StreamDescriptor>& stream_descriptors) {
+    const int64_t input_size = GetLocalFileSize(GetInputPath(input_file_name));
+    ASSERT_GT(input_size, 0);
+
+    base::TimeDelta total_time;
+    for (int i = 0; i < kIterations; ++i) {
+      Packager packager;
+      ASSERT_EQ(Status::OK,
+                packager.Initialize(packaging_params, stream_descriptors));
+      const base::TimeTicks start = base::TimeTicks::Now();
+      ASSERT_EQ(Status::OK, packager.Run());
+      total_time += base::TimeTicks::Now() - start;
+    }
+
+    const std::string trace =
+        ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    const double seconds = total_time.InSecondsF();
+    perf_test::PrintResult("pipeline_time", "", trace,
+                           total_time.InMillisecondsF() / kIterations, "ms",
+                           true);
+    perf_test::PrintResult(
+        "pipeline_throughput", "", trace,
+        seconds > 0 ? input_size * kIterations / seconds / (1 << 20) : 0.0,
+        "MB/s", true);
+    perf_test::PrintResult("peak_rss", "", trace, GetPeakRssInKb(), "KB",
+                           false);
+  }
+};
+
+TEST_F(PackagerBenchmark, Mp4ToFragmentedMp4Clear) {
+  PackagingParams packaging_params = SetupPackagingParams();
+  packaging_params.mpd_params.mpd_output = GetOutputPath("output.mpd");
+  std::vector<StreamDescriptor> stream_descriptors = {
+      MakeStreamDescriptor("bear-640x360.mp4", "audio", "audio.mp4", ""),
+      MakeStreamDescriptor("bear-640x360.mp4", "video", "video.mp4", ""),
+  };
+  RunBenchmark("bear-640x360.mp4", packaging_params, stream_descriptors);
+}
+
+TEST_F(PackagerBenchmark, Mp4ToFragmentedMp4Cenc) {
+  PackagingParams packaging_params = SetupPackagingParams();
+  EnableRawKeyEncryption(EncryptionParams::kProtectionSchemeCenc,
+                         &packaging_params);
+  std::vector<StreamDescriptor> stream_descriptors = {
+      MakeStreamDescriptor("bear-640x360.mp4", "audio", "audio.mp4", ""),
+      MakeStreamDescriptor("bear-640x360.mp4", "video", "video.mp4", ""),
+  };
+  RunBenchmark("bear-640x360.mp4", packaging_params, stream_descriptors);
+}
+
+TEST_F(PackagerBenchmark, Mp4ToSegmentedMp4Cbcs) {
+  PackagingParams packaging_params = SetupPackagingParams();
+  EnableRawKeyEncryption(EncryptionParams::kProtectionSchemeCbcs,
+                         &packaging_params);
+  packaging_params.mpd_params.mpd_output = GetOutputPath("output.mpd");
+  std::vector<StreamDescriptor> stream_descriptors = {
+      MakeStreamDescriptor("bear-640x360.mp4", "audio", "audio_init.mp4",
+                           "audio_$Number$.m4s"),
+      MakeStreamDescriptor("bear-640x360.mp4", "video", "video_init.mp4",
+                           "video_$Number$.m4s"),
+  };
+  RunBenchmark("bear-640x360.mp4", packaging_params, stream_descriptors);
+}
+
+TEST_F(PackagerBenchmark, TsToHls) {
+  PackagingParams packaging_params = SetupPackagingParams();
+  packaging_params.hls_params.master_playlist_output =
+      GetOutputPath("master.m3u8");
+  std::vector<StreamDescriptor> stream_descriptors = {
+      MakeStreamDescriptor("bear-640x360.ts", "audio", "", "audio_$Number$.ts"),
+      MakeStreamDescriptor("bear-640x360.ts", "video", "", "video_$Number$.ts"),
+  };
+  stream_descriptors[0].hls_playlist_name = "audio.m3u8";
+  stream_descriptors[1].hls_playlist_name = "video.m3u8";
+  RunBenchmark("bear-640x360.ts", packaging_params, stream_descriptors);
+}
+
+TEST_F(PackagerBenchmark, WebMToWebM) {
+  PackagingParams packaging_params = SetupPackagingParams();
+  packaging_params.mpd_params.mpd_output = GetOutputPath("output.mpd");
+  std::vector<StreamDescriptor> stream_descriptors = {
+      MakeStreamDescriptor("bear-640x360.webm", "video", "video.webm", ""),
+  };
+  RunBenchmark("bear-640x360.webm", packaging_params, stream_descriptors);
+}
+
+TEST_F(PackagerBenchmark, WebVttToMp4) {
+  PackagingParams packaging_params = SetupPackagingParams();
+  packaging_params.mpd_params.mpd_output = GetOutputPath("output.mpd");
+  std::vector<StreamDescriptor> stream_descriptors = {
+      MakeStreamDescriptor("bear-english.vtt", "text", "text.mp4", ""),
+  };
+  RunBenchmark("bear-english.vtt", packaging_params, stream_descriptors);
+}
+
+}  // namespace shaka
@@ -7,6 +7,12 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+
+#include "packager/file/file.h"
 #include "packager/packager.h"
 
 using testing::_;
@@ -17,12 +23,14 @@ using testing::Return;
 using testing::ReturnArg;
 using testing::StrEq;
 using testing::UnitTest;
+using testing::UnorderedElementsAre;
 using testing::WithArgs;
 
 namespace shaka {
 namespace {
 
 const char kTestFile[] = "packager/media/test/data/bear-640x360.mp4";
+const char kSmallerTestFile[] = "packager/media/test/data/bear-320x180.mp4";
 const char kOutputVideo[] = "output_video.mp4";
 const char kOutputVideoTemplate[] = "output_video_$Number$.m4s";
 const char kOutputAudio[] = "output_audio.mp4";
@@ -112,6 +120,245 @@ TEST_F(PackagerTest, Success) {
   ASSERT_EQ(Status::OK, packager.Run());
 }
 
+TEST_F(PackagerTest, ReusedForMultipleJobs) {
+  Packager packager;
+  ASSERT_EQ(Status::OK, packager.Initialize(SetupPackagingParams(),
+                                            SetupStreamDescriptors()));
+  ASSERT_EQ(Status::OK, packager.Run());
+  EXPECT_EQ(error::INVALID_ARGUMENT, packager.Run().error_code());
+
+  std::vector<StreamDescriptor> stream_descriptors = SetupStreamDescriptors();
+  stream_descriptors[0].output = GetFullPath("second_output_video.mp4");
+  ASSERT_EQ(Status::OK,
+            packager.Initialize(SetupPackagingParams(), stream_descriptors));
+  ASSERT_EQ(Status::OK, packager.Run());
+}
+
+TEST_F(PackagerTest, RunAsync) {
+  Packager packager;
+  ASSERT_EQ(Status::OK, packager.Initialize(SetupPackagingParams(),
+                                            SetupStreamDescriptors()));
+  MockFunction<void(const Status& status)> completion_callback;
+  EXPECT_CALL(completion_callback, Call(Status::OK));
+  ASSERT_EQ(Status::OK,
+            packager.RunAsync(completion_callback.AsStdFunction()));
+  EXPECT_EQ(error::INVALID_ARGUMENT, packager.Run().error_code());
+  ASSERT_EQ(Status::OK, packager.Wait());
+
+  // The Packager can be reused.
+  std::vector<StreamDescriptor> stream_descriptors = SetupStreamDescriptors();
+  stream_descriptors[0].output = GetFullPath("second_output_video.mp4");
+  ASSERT_EQ(Status::OK,
+            packager.Initialize(SetupPackagingParams(), stream_descriptors));
+  ASSERT_EQ(Status::OK, packager.RunAsync(nullptr));
+  EXPECT_EQ(Status::OK, packager.Wait());
+}
+
+TEST_F(PackagerTest, WaitWithoutRunAsync) {
+  Packager packager;
+  ASSERT_EQ(Status::OK, packager.Initialize(SetupPackagingParams(),
+                                            SetupStreamDescriptors()));
+  ASSERT_EQ(Status::OK, packager.Run());
+  EXPECT_EQ(error::INVALID_ARGUMENT, packager.Wait().error_code());
+}
+
+TEST_F(PackagerTest, GetStats) {
+  Packager packager;
+  EXPECT_TRUE(packager.GetStats().empty());
+  ASSERT_EQ(Status::OK, packager.Initialize(SetupPackagingParams(),
+                                            SetupStreamDescriptors()));
+  ASSERT_EQ(Status::OK, packager.Run());
+
+  std::vector<std::string> outputs;
+  for (const StreamStats& stream_stats : packager.GetStats()) {
+    outputs.push_back(stream_stats.output);
+    EXPECT_THAT(stream_stats.stream_label, HasSubstr(kTestFile));
+    EXPECT_GT(stream_stats.num_samples, 0u);
+    // bear-640x360.mp4 is 2.7 seconds long.
+    EXPECT_GT(stream_stats.media_time_in_seconds, 2.0);
+    EXPECT_GT(stream_stats.bytes_written, 0u);
+    // Nothing is queued once packaging completes.
+    for (const auto& queue_depth : stream_stats.queue_depths)
+      EXPECT_EQ(0u, queue_depth.second) << queue_depth.first;
+  }
+  EXPECT_THAT(outputs, UnorderedElementsAre(GetFullPath(kOutputVideo),
+                                            GetFullPath(kOutputAudio)));
+}
+
+TEST_F(PackagerTest, InitializeTwiceWithoutRun) {
+  Packager packager;
+  ASSERT_EQ(Status::OK, packager.Initialize(SetupPackagingParams(),
+                                            SetupStreamDescriptors()));
+  EXPECT_EQ(error::INVALID_ARGUMENT,
+            packager.Initialize(SetupPackagingParams(),
+                                SetupStreamDescriptors())
+                .error_code());
+}
+
+TEST_F(PackagerTest, AddStreams) {
+  Packager packager;
+  ASSERT_EQ(Status::OK, packager.Initialize(SetupPackagingParams(),
+                                            SetupStreamDescriptors()));
+
+  // The same file through another path is a different input.
+  StreamDescriptor stream_descriptor;
+  stream_descriptor.input = std::string("./") + kTestFile;
+  stream_descriptor.stream_selector = "video";
+  stream_descriptor.output = GetFullPath("added_output_video.mp4");
+  uint32_t stream_group_id = 0;
+  ASSERT_EQ(Status::OK,
+            packager.AddStreams({stream_descriptor}, &stream_group_id));
+  ASSERT_EQ(Status::OK, packager.Run());
+}
+
+TEST_F(PackagerTest, AddStreamsAfterRun) {
+  Packager packager;
+  ASSERT_EQ(Status::OK, packager.Initialize(SetupPackagingParams(),
+                                            SetupStreamDescriptors()));
+  ASSERT_EQ(Status::OK, packager.Run());
+
+  StreamDescriptor stream_descriptor;
+  stream_descriptor.input = std::string("./") + kTestFile;
+  stream_descriptor.stream_selector = "video";
+  stream_descriptor.output = GetFullPath("added_output_video.mp4");
+  uint32_t stream_group_id = 0;
+  EXPECT_EQ(error::INVALID_ARGUMENT,
+            packager.AddStreams({stream_descriptor}, &stream_group_id)
+                .error_code());
+}
+
+TEST_F(PackagerTest, AddStreamsOfInputInUse) {
+  Packager packager;
+  ASSERT_EQ(Status::OK, packager.Initialize(SetupPackagingParams(),
+                                            SetupStreamDescriptors()));
+
+  StreamDescriptor stream_descriptor;
+  stream_descriptor.input = kTestFile;
+  stream_descriptor.stream_selector = "video";
+  stream_descriptor.output = GetFullPath("added_output_video.mp4");
+  uint32_t stream_group_id = 0;
+  EXPECT_EQ(error::INVALID_ARGUMENT,
+            packager.AddStreams({stream_descriptor}, &stream_group_id)
+                .error_code());
+}
+
+TEST_F(PackagerTest, RemoveStreamsNotAdded) {
+  Packager packager;
+  ASSERT_EQ(Status::OK, packager.Initialize(SetupPackagingParams(),
+                                            SetupStreamDescriptors()));
+  EXPECT_EQ(error::NOT_FOUND, packager.RemoveStreams(0).error_code());
+}
+
+TEST_F(PackagerTest, SuccessWithOutputsMuxedInParallel) {
+  PackagingParams packaging_params = SetupPackagingParams();
+  packaging_params.process_streams_in_parallel = true;
+  packaging_params.mux_outputs_in_parallel = true;
+  Packager packager;
+  ASSERT_EQ(Status::OK,
+            packager.Initialize(packaging_params, SetupStreamDescriptors()));
+  ASSERT_EQ(Status::OK, packager.Run());
+}
+
+TEST_F(PackagerTest, SuccessWithOutputsOfDifferentEncryption) {
+  PackagingParams packaging_params = SetupPackagingParams();
+  packaging_params.test_params.inject_fake_clock = true;
+  std::vector<StreamDescriptor> stream_descriptors = SetupStreamDescriptors();
+  StreamDescriptor stream_descriptor = stream_descriptors[0];
+  const std::string clear_output = GetFullPath("output_video_clear.mp4");
+  const std::string clear_output_copy =
+      GetFullPath("output_video_clear_copy.mp4");
+  stream_descriptor.output = clear_output;
+  stream_descriptor.skip_encryption = true;
+  stream_descriptors.push_back(stream_descriptor);
+  stream_descriptor.output = clear_output_copy;
+  stream_descriptors.push_back(stream_descriptor);
+
+  {
+    Packager packager;
+    ASSERT_EQ(Status::OK,
+              packager.Initialize(packaging_params, stream_descriptors));
+    ASSERT_EQ(Status::OK, packager.Run());
+  }
+
+  // The clear outputs are the same as the output of a packaging without
+  // encryption.
+  const std::string reference_output = GetFullPath("reference_output.mp4");
+  stream_descriptor.output = reference_output;
+  stream_descriptor.skip_encryption = false;
+  packaging_params.encryption_params = EncryptionParams();
+  packaging_params.mpd_params.mpd_output = GetFullPath("reference.mpd");
+  {
+    Packager packager;
+    ASSERT_EQ(Status::OK,
+              packager.Initialize(packaging_params, {stream_descriptor}));
+    ASSERT_EQ(Status::OK, packager.Run());
+  }
+
+  std::string reference_content;
+  std::string clear_content;
+  std::string clear_content_copy;
+  std::string encrypted_content;
+  ASSERT_TRUE(File::ReadFileToString(reference_output.c_str(),
+                                     &reference_content));
+  ASSERT_TRUE(File::ReadFileToString(clear_output.c_str(), &clear_content));
+  ASSERT_TRUE(
+      File::ReadFileToString(clear_output_copy.c_str(), &clear_content_copy));
+  ASSERT_TRUE(File::ReadFileToString(GetFullPath(kOutputVideo).c_str(),
+                                     &encrypted_content));
+  EXPECT_EQ(reference_content, clear_content);
+  EXPECT_EQ(reference_content, clear_content_copy);
+  // The first output of the stream is still encrypted.
+  EXPECT_NE(std::string::npos, encrypted_content.find("encv"));
+  EXPECT_EQ(std::string::npos, clear_content.find("encv"));
+}
+
+// A stream with a single output is muxed without a Replicator. The output is
+// the same as with one.
+TEST_F(PackagerTest, SingleOutputOfAStream) {
+  PackagingParams packaging_params = SetupPackagingParams();
+  packaging_params.test_params.inject_fake_clock = true;
+  StreamDescriptor stream_descriptor = SetupStreamDescriptors()[0];
+  stream_descriptor.skip_encryption = true;
+
+  const std::string single_output = GetFullPath("single_output.mp4");
+  stream_descriptor.output = single_output;
+  {
+    Packager packager;
+    ASSERT_EQ(Status::OK,
+              packager.Initialize(packaging_params, {stream_descriptor}));
+    ASSERT_EQ(Status::OK, packager.Run());
+  }
+
+  const std::string replicated_output = GetFullPath("replicated_output.mp4");
+  const std::string other_replicated_output =
+      GetFullPath("other_replicated_output.mp4");
+  std::vector<StreamDescriptor> stream_descriptors;
+  stream_descriptor.output = replicated_output;
+  stream_descriptors.push_back(stream_descriptor);
+  stream_descriptor.output = other_replicated_output;
+  stream_descriptors.push_back(stream_descriptor);
+  packaging_params.mpd_params.mpd_output =
+      GetFullPath("replicated_output.mpd");
+  {
+    Packager packager;
+    ASSERT_EQ(Status::OK,
+              packager.Initialize(packaging_params, stream_descriptors));
+    ASSERT_EQ(Status::OK, packager.Run());
+  }
+
+  std::string single_content;
+  std::string replicated_content;
+  std::string other_replicated_content;
+  ASSERT_TRUE(File::ReadFileToString(single_output.c_str(), &single_content));
+  ASSERT_TRUE(
+      File::ReadFileToString(replicated_output.c_str(), &replicated_content));
+  ASSERT_TRUE(File::ReadFileToString(other_replicated_output.c_str(),
+                                     &other_replicated_content));
+  EXPECT_FALSE(single_content.empty());
+  EXPECT_EQ(single_content, replicated_content);
+  EXPECT_EQ(single_content, other_replicated_content);
+}
+
 TEST_F(PackagerTest, MissingStreamDescriptors) {
   std::vector<StreamDescriptor> stream_descriptors;
   Packager packager;
@@ -185,6 +432,52 @@ TEST_F(PackagerTest, DuplicatedSegmentTemplates) {
               HasSubstr("duplicated segment templates"));
 }
 
+TEST_F(PackagerTest, TsOutputsShareSegmentTemplate) {
+  auto packaging_params = SetupPackagingParams();
+  packaging_params.encryption_params.key_provider = KeyProvider::kNone;
+  packaging_params.mpd_params.mpd_output.clear();
+
+  std::vector<StreamDescriptor> stream_descriptors;
+  StreamDescriptor stream_descriptor;
+  stream_descriptor.input = kTestFile;
+  stream_descriptor.stream_selector = "video";
+  stream_descriptor.segment_template = GetFullPath("output_$Number$.ts");
+  stream_descriptors.push_back(stream_descriptor);
+  stream_descriptor.stream_selector = "audio";
+  stream_descriptors.push_back(stream_descriptor);
+
+  Packager packager;
+  ASSERT_EQ(Status::OK,
+            packager.Initialize(packaging_params, stream_descriptors));
+  ASSERT_EQ(Status::OK, packager.Run());
+
+  // The first segment has the PES packets of both streams.
+  std::string segment;
+  ASSERT_TRUE(File::ReadFileToString(GetFullPath("output_1.ts").c_str(),
+                                     &segment));
+  EXPECT_NE(std::string::npos, segment.find(std::string("\0\0\1\xE0", 4)));
+  EXPECT_NE(std::string::npos, segment.find(std::string("\0\0\1\xC0", 4)));
+}
+
+TEST_F(PackagerTest, SharedSegmentTemplateProcessedInParallel) {
+  auto packaging_params = SetupPackagingParams();
+  packaging_params.process_streams_in_parallel = true;
+
+  std::vector<StreamDescriptor> stream_descriptors;
+  StreamDescriptor stream_descriptor;
+  stream_descriptor.input = kTestFile;
+  stream_descriptor.stream_selector = "video";
+  stream_descriptor.segment_template = GetFullPath("output_$Number$.ts");
+  stream_descriptors.push_back(stream_descriptor);
+  stream_descriptor.stream_selector = "audio";
+  stream_descriptors.push_back(stream_descriptor);
+
+  Packager packager;
+  auto status = packager.Initialize(packaging_params, stream_descriptors);
+  ASSERT_EQ(error::INVALID_ARGUMENT, status.error_code());
+  EXPECT_THAT(status.error_message(), HasSubstr("in parallel"));
+}
+
 TEST_F(PackagerTest, SegmentAlignedAndSubsegmentNotAligned) {
   auto packaging_params = SetupPackagingParams();
   packaging_params.chunking_params.segment_sap_aligned = true;
@@ -250,6 +543,56 @@ TEST_F(PackagerTest, ReadFromBuffer) {
   fclose(file_ptr);
 }
 
+// With live packaging, every job gets its own thread whatever the number of
+// worker threads, as a live job never releases its worker thread.
+TEST_F(PackagerTest, WorkerThreadsIgnoredForLivePackaging) {
+  auto packaging_params = SetupPackagingParams();
+  packaging_params.num_worker_threads = 1;
+
+  // The first input is only read once the second one is, i.e. once both jobs
+  // run concurrently.
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool second_input_read = false;
+  FILE* first_file = fopen(kTestFile, "rb");
+  ASSERT_TRUE(first_file);
+  FILE* second_file = fopen(kSmallerTestFile, "rb");
+  ASSERT_TRUE(second_file);
+  packaging_params.buffer_callback_params.read_func =
+      [&](const std::string& name, void* buffer, uint64_t length) -> int64_t {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (name == kSmallerTestFile) {
+      second_input_read = true;
+      condition.notify_all();
+      return fread(buffer, sizeof(char), length, second_file);
+    }
+    const std::chrono::seconds kTimeout(10);
+    if (!condition.wait_for(lock, kTimeout,
+                            [&] { return second_input_read; })) {
+      return -1;
+    }
+    return fread(buffer, sizeof(char), length, first_file);
+  };
+
+  std::vector<StreamDescriptor> stream_descriptors(2);
+  stream_descriptors[0].input = kTestFile;
+  stream_descriptors[0].stream_selector = "video";
+  stream_descriptors[0].output = GetFullPath("first_init.mp4");
+  stream_descriptors[0].segment_template = GetFullPath("first_$Number$.m4s");
+  stream_descriptors[1].input = kSmallerTestFile;
+  stream_descriptors[1].stream_selector = "video";
+  stream_descriptors[1].output = GetFullPath("second_init.mp4");
+  stream_descriptors[1].segment_template = GetFullPath("second_$Number$.m4s");
+
+  Packager packager;
+  ASSERT_EQ(Status::OK,
+            packager.Initialize(packaging_params, stream_descriptors));
+  EXPECT_EQ(Status::OK, packager.Run());
+
+  fclose(first_file);
+  fclose(second_file);
+}
+
 TEST_F(PackagerTest, ReadFromBufferFailed) {
   auto packaging_params = SetupPackagingParams();
 
@@ -266,6 +609,54 @@ TEST_F(PackagerTest, ReadFromBufferFailed) {
   ASSERT_EQ(error::FILE_FAILURE, packager.Run().error_code());
 }
 
+// The TS muxer goes on with the stream info of the second input in the same
+// segments, after an HLS discontinuity.
+TEST_F(PackagerTest, ConcatenatedInputsWithDifferentConfigurations) {
+  auto packaging_params = SetupPackagingParams();
+  packaging_params.mpd_params.mpd_output.clear();
+  packaging_params.hls_params.master_playlist_output =
+      GetFullPath("master.m3u8");
+  packaging_params.encryption_params.key_provider = KeyProvider::kNone;
+
+  StreamDescriptor stream_descriptor;
+  stream_descriptor.input = kTestFile;
+  stream_descriptor.next_inputs.push_back(kSmallerTestFile);
+  stream_descriptor.stream_selector = "video";
+  stream_descriptor.segment_template = GetFullPath("video_$Number$.ts");
+  stream_descriptor.hls_playlist_name = "video.m3u8";
+
+  Packager packager;
+  ASSERT_EQ(Status::OK,
+            packager.Initialize(packaging_params, {stream_descriptor}));
+  ASSERT_EQ(Status::OK, packager.Run());
+
+  std::string playlist;
+  ASSERT_TRUE(File::ReadFileToString(GetFullPath("video.m3u8").c_str(),
+                                     &playlist));
+  const char kDiscontinuity[] = "#EXT-X-DISCONTINUITY\n";
+  const size_t discontinuity_position = playlist.find(kDiscontinuity);
+  ASSERT_NE(std::string::npos, discontinuity_position);
+  EXPECT_EQ(std::string::npos,
+            playlist.find(kDiscontinuity, discontinuity_position + 1));
+
+  // The segment numbering goes on across the inputs.
+  std::vector<std::string> segments;
+  size_t line_start = 0;
+  while (line_start < playlist.size()) {
+    size_t line_end = playlist.find('\n', line_start);
+    if (line_end == std::string::npos)
+      line_end = playlist.size();
+    if (playlist[line_start] != '#')
+      segments.push_back(playlist.substr(line_start, line_end - line_start));
+    line_start = line_end + 1;
+  }
+  ASSERT_GT(segments.size(), 2u);
+  EXPECT_EQ(segments.size(),
+            std::set<std::string>(segments.begin(), segments.end()).size());
+  EXPECT_EQ("video_" + std::to_string(segments.size()) + ".ts",
+            segments.back());
+}
+
 // TODO(kqyang): Add more tests.
 
 }  // namespace shaka
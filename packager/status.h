@@ -8,6 +8,7 @@
 #define PACKAGER_STATUS_H_
 
 #include <iostream>
+#include <memory>
 #include <string>
 
 #if defined(SHARED_LIBRARY_BUILD)
@@ -135,10 +136,12 @@ class SHAKA_EXPORT Status {
 
   bool ok() const { return error_code_ == error::OK; }
   error::Code error_code() const { return error_code_; }
-  const std::string& error_message() const { return error_message_; }
+  const std::string& error_message() const;
 
   bool operator==(const Status& x) const {
-    return error_code_ == x.error_code() && error_message_ == x.error_message();
+    return error_code_ == x.error_code() &&
+           (error_message_ == x.error_message_ ||
+            error_message() == x.error_message());
   }
   bool operator!=(const Status& x) const { return !(*this == x); }
 
@@ -147,7 +150,11 @@ class SHAKA_EXPORT Status {
 
  private:
   error::Code error_code_;
-  std::string error_message_;
+  // Only allocated for the errors with a message, so the statuses passed
+  // along on success, e.g. for each sample through the media handlers, are
+  // copied and destroyed without touching the heap. It is shared by the
+  // copies of the status, as it is never modified.
+  std::shared_ptr<const std::string> error_message_;
 
   // Not using DISALLOW_COPY_AND_ASSIGN here intentionally to allow the compiler
   // generated copy constructor and assignment operator.
@@ -54,6 +54,13 @@ TEST(Status, Copy) {
   ASSERT_EQ(a, b);
 }
 
+TEST(Status, CopyOutlivesOriginal) {
+  std::unique_ptr<Status> a(new Status(error::CANCELLED, "message"));
+  Status b(*a);
+  a.reset();
+  CheckStatus(b, error::CANCELLED, "message");
+}
+
 TEST(Status, Assign) {
   Status a(error::CANCELLED, "message");
   Status b;